@@ -0,0 +1,176 @@
+/*
+ * ChaCha20 and XChaCha20 stream ciphers, NEON accelerated
+ *
+ * The core is the CRYPTOGAMS ChaCha20 for ARMv8 by Andy Polyakov, as also
+ * used by the WireGuard zinc library.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation.
+ */
+
+#include <asm/hwcap.h>
+#include <asm/neon.h>
+#include <crypto/algapi.h>
+#include <crypto/chacha.h>
+#include <linux/crypto.h>
+#include <linux/kernel.h>
+#include <linux/module.h>
+
+asmlinkage void chacha20_arm64(u8 *out, const u8 *in, size_t len,
+			       const u32 key[8], const u32 counter[4]);
+asmlinkage void chacha20_arm64_neon(u8 *out, const u8 *in, size_t len,
+				    const u32 key[8], const u32 counter[4]);
+
+/* Below this the scalar code is faster than saving the NEON state */
+#define CHACHA20_NEON_MIN	(CHACHA_BLOCK_SIZE * 3)
+
+static void chacha20_neon_docrypt(u32 *state, u8 *dst, const u8 *src,
+				  unsigned int bytes)
+{
+	if (bytes >= CHACHA20_NEON_MIN) {
+		kernel_neon_begin();
+		chacha20_arm64_neon(dst, src, bytes, &state[4], &state[12]);
+		kernel_neon_end();
+	} else {
+		chacha20_arm64(dst, src, bytes, &state[4], &state[12]);
+	}
+	state[12] += DIV_ROUND_UP(bytes, CHACHA_BLOCK_SIZE);
+}
+
+/*
+ * The walk hands out at most a page at a time, which also bounds how long
+ * preemption stays off inside each NEON section.
+ */
+static int chacha20_neon_stream_xor(struct blkcipher_desc *desc,
+				    struct scatterlist *dst,
+				    struct scatterlist *src,
+				    unsigned int nbytes,
+				    struct chacha_ctx *ctx, u8 *iv)
+{
+	struct blkcipher_walk walk;
+	u32 state[16];
+	int err;
+
+	blkcipher_walk_init(&walk, dst, src, nbytes);
+	err = blkcipher_walk_virt_block(desc, &walk, CHACHA_BLOCK_SIZE);
+
+	crypto_chacha_init(state, ctx, iv);
+
+	while (walk.nbytes >= CHACHA_BLOCK_SIZE) {
+		chacha20_neon_docrypt(state, walk.dst.virt.addr,
+				      walk.src.virt.addr,
+				      rounddown(walk.nbytes,
+						CHACHA_BLOCK_SIZE));
+		err = blkcipher_walk_done(desc, &walk,
+					  walk.nbytes % CHACHA_BLOCK_SIZE);
+	}
+
+	if (walk.nbytes) {
+		chacha20_neon_docrypt(state, walk.dst.virt.addr,
+				      walk.src.virt.addr, walk.nbytes);
+		err = blkcipher_walk_done(desc, &walk, 0);
+	}
+
+	return err;
+}
+
+static int chacha20_neon(struct blkcipher_desc *desc, struct scatterlist *dst,
+			 struct scatterlist *src, unsigned int nbytes)
+{
+	struct chacha_ctx *ctx = crypto_blkcipher_ctx(desc->tfm);
+
+	return chacha20_neon_stream_xor(desc, dst, src, nbytes, ctx,
+					desc->info);
+}
+
+static int xchacha20_neon(struct blkcipher_desc *desc, struct scatterlist *dst,
+			  struct scatterlist *src, unsigned int nbytes)
+{
+	struct chacha_ctx *ctx = crypto_blkcipher_ctx(desc->tfm);
+	u8 *iv = desc->info;
+	struct chacha_ctx subctx;
+	u32 state[16];
+	u8 real_iv[16];
+
+	/* Compute the subkey given the original key and first 128 nonce bits */
+	crypto_chacha_init(state, ctx, iv);
+	hchacha_block(state, subctx.key, ctx->nrounds);
+	subctx.nrounds = ctx->nrounds;
+
+	/* Build the real IV */
+	memcpy(&real_iv[0], iv + 24, 8); /* stream position */
+	memcpy(&real_iv[8], iv + 16, 8); /* remaining 64 nonce bits */
+
+	return chacha20_neon_stream_xor(desc, dst, src, nbytes, &subctx,
+					real_iv);
+}
+
+static struct crypto_alg algs[] = {
+	{
+		.cra_name		= "chacha20",
+		.cra_driver_name	= "chacha20-neon",
+		.cra_priority		= 300,
+		.cra_flags		= CRYPTO_ALG_TYPE_BLKCIPHER,
+		.cra_blocksize		= 1,
+		.cra_type		= &crypto_blkcipher_type,
+		.cra_ctxsize		= sizeof(struct chacha_ctx),
+		.cra_alignmask		= sizeof(u32) - 1,
+		.cra_module		= THIS_MODULE,
+		.cra_u			= {
+			.blkcipher = {
+				.min_keysize	= CHACHA_KEY_SIZE,
+				.max_keysize	= CHACHA_KEY_SIZE,
+				.ivsize		= CHACHA_IV_SIZE,
+				.geniv		= "seqiv",
+				.setkey		= crypto_chacha20_setkey,
+				.encrypt	= chacha20_neon,
+				.decrypt	= chacha20_neon,
+			},
+		},
+	}, {
+		.cra_name		= "xchacha20",
+		.cra_driver_name	= "xchacha20-neon",
+		.cra_priority		= 300,
+		.cra_flags		= CRYPTO_ALG_TYPE_BLKCIPHER,
+		.cra_blocksize		= 1,
+		.cra_type		= &crypto_blkcipher_type,
+		.cra_ctxsize		= sizeof(struct chacha_ctx),
+		.cra_alignmask		= sizeof(u32) - 1,
+		.cra_module		= THIS_MODULE,
+		.cra_u			= {
+			.blkcipher = {
+				.min_keysize	= CHACHA_KEY_SIZE,
+				.max_keysize	= CHACHA_KEY_SIZE,
+				.ivsize		= XCHACHA_IV_SIZE,
+				.geniv		= "seqiv",
+				.setkey		= crypto_chacha20_setkey,
+				.encrypt	= xchacha20_neon,
+				.decrypt	= xchacha20_neon,
+			},
+		},
+	},
+};
+
+static int __init chacha20_neon_mod_init(void)
+{
+	if (!(elf_hwcap & HWCAP_ASIMD))
+		return -ENODEV;
+
+	return crypto_register_algs(algs, ARRAY_SIZE(algs));
+}
+
+static void __exit chacha20_neon_mod_fini(void)
+{
+	crypto_unregister_algs(algs, ARRAY_SIZE(algs));
+}
+
+module_init(chacha20_neon_mod_init);
+module_exit(chacha20_neon_mod_fini);
+
+MODULE_LICENSE("GPL v2");
+MODULE_DESCRIPTION("ChaCha20 and XChaCha20 stream ciphers, NEON accelerated");
+MODULE_ALIAS_CRYPTO("chacha20");
+MODULE_ALIAS_CRYPTO("chacha20-neon");
+MODULE_ALIAS_CRYPTO("xchacha20");
+MODULE_ALIAS_CRYPTO("xchacha20-neon");
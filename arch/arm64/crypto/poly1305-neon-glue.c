@@ -0,0 +1,221 @@
+/*
+ * Poly1305 authenticator algorithm, RFC7539, NEON accelerated
+ *
+ * The core is the CRYPTOGAMS Poly1305 for ARMv8 by Andy Polyakov, as also
+ * used by the WireGuard zinc library.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation.
+ */
+
+#include <asm/hwcap.h>
+#include <asm/neon.h>
+#include <asm/unaligned.h>
+#include <crypto/algapi.h>
+#include <crypto/internal/hash.h>
+#include <crypto/poly1305.h>
+#include <linux/crypto.h>
+#include <linux/kernel.h>
+#include <linux/module.h>
+
+struct poly1305_neon_desc_ctx {
+	/*
+	 * Assembly state: hash, is_base2_26 flag and key, followed by the
+	 * key powers the NEON code derives on first use.
+	 */
+	u64 state[24];
+	/* finalize key */
+	u32 s[4];
+	/* partial buffer */
+	u8 buf[POLY1305_BLOCK_SIZE];
+	/* bytes used in partial buffer */
+	unsigned int buflen;
+	/* r key has been set */
+	bool rset;
+	/* s key has been set */
+	bool sset;
+};
+
+/* The hash switches to base 2^26 once the NEON code has run */
+#define POLY1305_NEON_IS_BASE2_26(dctx)	((dctx)->state[3])
+
+/* Below this the scalar code is faster than saving the NEON state */
+#define POLY1305_NEON_MIN	(POLY1305_BLOCK_SIZE * 8)
+
+asmlinkage void poly1305_init_arm64(void *state, const u8 key[16]);
+asmlinkage void poly1305_blocks_arm64(void *state, const u8 *src, size_t len,
+				      u32 padbit);
+asmlinkage void poly1305_blocks_arm64_neon(void *state, const u8 *src,
+					   size_t len, u32 padbit);
+asmlinkage void poly1305_emit_arm64_neon(void *state, u8 mac[16],
+					 const u32 nonce[4]);
+
+static int poly1305_neon_init(struct shash_desc *desc)
+{
+	struct poly1305_neon_desc_ctx *dctx = shash_desc_ctx(desc);
+
+	dctx->buflen = 0;
+	dctx->rset = false;
+	dctx->sset = false;
+
+	return 0;
+}
+
+static void poly1305_neon_blocks(struct poly1305_neon_desc_ctx *dctx,
+				 const u8 *src, unsigned int len, u32 padbit)
+{
+	unsigned int bytes;
+
+	/*
+	 * Once in base 2^26 the hash stays with the NEON code, which also
+	 * handles short inputs in that representation.
+	 */
+	if (len < POLY1305_NEON_MIN && !POLY1305_NEON_IS_BASE2_26(dctx)) {
+		poly1305_blocks_arm64(dctx->state, src, len, padbit);
+		return;
+	}
+
+	/* NEON disables preemption, so yield after each page */
+	while (len) {
+		bytes = min_t(unsigned int, len, PAGE_SIZE);
+
+		kernel_neon_begin();
+		poly1305_blocks_arm64_neon(dctx->state, src, bytes, padbit);
+		kernel_neon_end();
+
+		src += bytes;
+		len -= bytes;
+	}
+}
+
+/* Consume the key from the start of @src; returns the bytes left */
+static unsigned int poly1305_neon_setdesckey(struct poly1305_neon_desc_ctx *dctx,
+					     const u8 *src, unsigned int srclen)
+{
+	if (!dctx->rset) {
+		poly1305_init_arm64(dctx->state, src);
+		src += POLY1305_BLOCK_SIZE;
+		srclen -= POLY1305_BLOCK_SIZE;
+		dctx->rset = true;
+	}
+	if (srclen >= POLY1305_BLOCK_SIZE) {
+		dctx->s[0] = get_unaligned_le32(src +  0);
+		dctx->s[1] = get_unaligned_le32(src +  4);
+		dctx->s[2] = get_unaligned_le32(src +  8);
+		dctx->s[3] = get_unaligned_le32(src + 12);
+		srclen -= POLY1305_BLOCK_SIZE;
+		dctx->sset = true;
+	}
+	return srclen;
+}
+
+/* @srclen is a multiple of the block size */
+static void poly1305_neon_process(struct poly1305_neon_desc_ctx *dctx,
+				  const u8 *src, unsigned int srclen)
+{
+	unsigned int datalen;
+
+	if (unlikely(!dctx->sset)) {
+		datalen = poly1305_neon_setdesckey(dctx, src, srclen);
+		src += srclen - datalen;
+		srclen = datalen;
+	}
+	if (srclen)
+		poly1305_neon_blocks(dctx, src, srclen, 1);
+}
+
+static int poly1305_neon_update(struct shash_desc *desc,
+				const u8 *src, unsigned int srclen)
+{
+	struct poly1305_neon_desc_ctx *dctx = shash_desc_ctx(desc);
+	unsigned int bytes;
+
+	if (unlikely(dctx->buflen)) {
+		bytes = min(srclen, POLY1305_BLOCK_SIZE - dctx->buflen);
+		memcpy(dctx->buf + dctx->buflen, src, bytes);
+		src += bytes;
+		srclen -= bytes;
+		dctx->buflen += bytes;
+
+		if (dctx->buflen == POLY1305_BLOCK_SIZE) {
+			poly1305_neon_process(dctx, dctx->buf,
+					      POLY1305_BLOCK_SIZE);
+			dctx->buflen = 0;
+		}
+	}
+
+	if (likely(srclen >= POLY1305_BLOCK_SIZE)) {
+		bytes = round_down(srclen, POLY1305_BLOCK_SIZE);
+		poly1305_neon_process(dctx, src, bytes);
+		src += bytes;
+		srclen -= bytes;
+	}
+
+	if (unlikely(srclen)) {
+		dctx->buflen = srclen;
+		memcpy(dctx->buf, src, srclen);
+	}
+
+	return 0;
+}
+
+static int poly1305_neon_final(struct shash_desc *desc, u8 *dst)
+{
+	struct poly1305_neon_desc_ctx *dctx = shash_desc_ctx(desc);
+	u8 mac[POLY1305_DIGEST_SIZE];
+
+	if (unlikely(!dctx->sset))
+		return -ENOKEY;
+
+	if (unlikely(dctx->buflen)) {
+		dctx->buf[dctx->buflen++] = 1;
+		memset(dctx->buf + dctx->buflen, 0,
+		       POLY1305_BLOCK_SIZE - dctx->buflen);
+		poly1305_neon_blocks(dctx, dctx->buf, POLY1305_BLOCK_SIZE, 0);
+	}
+
+	/* The emit code only uses general purpose registers */
+	poly1305_emit_arm64_neon(dctx->state, mac, dctx->s);
+	memcpy(dst, mac, sizeof(mac));
+
+	return 0;
+}
+
+static struct shash_alg alg = {
+	.digestsize	= POLY1305_DIGEST_SIZE,
+	.init		= poly1305_neon_init,
+	.update		= poly1305_neon_update,
+	.final		= poly1305_neon_final,
+	.descsize	= sizeof(struct poly1305_neon_desc_ctx),
+	.base		= {
+		.cra_name		= "poly1305",
+		.cra_driver_name	= "poly1305-neon",
+		.cra_priority		= 300,
+		.cra_flags		= CRYPTO_ALG_TYPE_SHASH,
+		.cra_alignmask		= sizeof(u32) - 1,
+		.cra_blocksize		= POLY1305_BLOCK_SIZE,
+		.cra_module		= THIS_MODULE,
+	},
+};
+
+static int __init poly1305_neon_mod_init(void)
+{
+	if (!(elf_hwcap & HWCAP_ASIMD))
+		return -ENODEV;
+
+	return crypto_register_shash(&alg);
+}
+
+static void __exit poly1305_neon_mod_exit(void)
+{
+	crypto_unregister_shash(&alg);
+}
+
+module_init(poly1305_neon_mod_init);
+module_exit(poly1305_neon_mod_exit);
+
+MODULE_LICENSE("GPL v2");
+MODULE_DESCRIPTION("Poly1305 authenticator, NEON accelerated");
+MODULE_ALIAS_CRYPTO("poly1305");
+MODULE_ALIAS_CRYPTO("poly1305-neon");
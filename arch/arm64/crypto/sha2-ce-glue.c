@@ -37,6 +37,9 @@ static inline void __cfi_sha2_ce_transform(struct sha256_state *sst,
 #define sha2_ce_transform __cfi_sha2_ce_transform
 #endif
 
+asmlinkage void __sha256_ce_transform2x(u32 *st1, u32 *st2, u8 const *src1,
+					u8 const *src2, int blocks);
+
 const u32 sha256_ce_offsetof_count = offsetof(struct sha256_ce_state,
 					      sst.count);
 const u32 sha256_ce_offsetof_finalize = offsetof(struct sha256_ce_state,
@@ -89,11 +92,74 @@ static int sha256_ce_final(struct shash_desc *desc, u8 *out)
 	return sha256_base_finish(desc, out);
 }
 
+/*
+ * Hashes two messages of the same length from the common state in @desc.
+ * The partial block held in the state and the padding are assembled here,
+ * so the interleaved transform only ever sees whole blocks.
+ */
+static int sha256_ce_finup_mb(struct shash_desc *desc,
+			      const u8 * const data[], unsigned int len,
+			      u8 * const outs[], unsigned int num_msgs)
+{
+	struct sha256_ce_state *sctx = shash_desc_ctx(desc);
+	unsigned int partial = sctx->sst.count % SHA256_BLOCK_SIZE;
+	unsigned int ds = crypto_shash_digestsize(desc->tfm);
+	unsigned int head, tail, blocks, pad, i, j;
+	u64 bits = (sctx->sst.count + len) << 3;
+	u8 buf[2][SHA256_BLOCK_SIZE * 2];
+	u32 st[2][SHA256_DIGEST_SIZE / 4];
+
+	head = partial ? SHA256_BLOCK_SIZE - partial : 0;
+	if (num_msgs != 2 || len < head)
+		return -EOPNOTSUPP;
+
+	blocks = (len - head) / SHA256_BLOCK_SIZE;
+	tail = (len - head) % SHA256_BLOCK_SIZE;
+	pad = tail < SHA256_BLOCK_SIZE - sizeof(bits) ? SHA256_BLOCK_SIZE :
+						       SHA256_BLOCK_SIZE * 2;
+
+	memcpy(st[0], sctx->sst.state, sizeof(st[0]));
+	memcpy(st[1], sctx->sst.state, sizeof(st[1]));
+
+	kernel_neon_begin();
+	if (partial) {
+		for (i = 0; i < 2; i++) {
+			memcpy(buf[i], sctx->sst.buf, partial);
+			memcpy(buf[i] + partial, data[i], head);
+		}
+		__sha256_ce_transform2x(st[0], st[1], buf[0], buf[1], 1);
+	}
+
+	if (blocks)
+		__sha256_ce_transform2x(st[0], st[1], data[0] + head,
+					data[1] + head, blocks);
+
+	for (i = 0; i < 2; i++) {
+		memcpy(buf[i], data[i] + len - tail, tail);
+		buf[i][tail] = 0x80;
+		memset(buf[i] + tail + 1, 0, pad - tail - 1 - sizeof(bits));
+		put_unaligned_be64(bits, buf[i] + pad - sizeof(bits));
+	}
+	__sha256_ce_transform2x(st[0], st[1], buf[0], buf[1],
+				pad / SHA256_BLOCK_SIZE);
+	kernel_neon_end();
+
+	for (i = 0; i < 2; i++)
+		for (j = 0; j < ds / sizeof(u32); j++)
+			put_unaligned_be32(st[i][j], outs[i] + j * sizeof(u32));
+
+	memzero_explicit(buf, sizeof(buf));
+	memzero_explicit(st, sizeof(st));
+	return 0;
+}
+
 static struct shash_alg algs[] = { {
 	.init			= sha224_base_init,
 	.update			= sha256_ce_update,
 	.final			= sha256_ce_final,
 	.finup			= sha256_ce_finup,
+	.finup_mb		= sha256_ce_finup_mb,
+	.mb_max_msgs		= 2,
 	.descsize		= sizeof(struct sha256_ce_state),
 	.digestsize		= SHA224_DIGEST_SIZE,
 	.base			= {
@@ -109,6 +175,8 @@ static struct shash_alg algs[] = { {
 	.update			= sha256_ce_update,
 	.final			= sha256_ce_final,
 	.finup			= sha256_ce_finup,
+	.finup_mb		= sha256_ce_finup_mb,
+	.mb_max_msgs		= 2,
 	.descsize		= sizeof(struct sha256_ce_state),
 	.digestsize		= SHA256_DIGEST_SIZE,
 	.base			= {
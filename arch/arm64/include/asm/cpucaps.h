@@ -41,7 +41,8 @@
 #define ARM64_WORKAROUND_1188873		20
 #define ARM64_SPECTRE_BHB			21
 #define ARM64_WORKAROUND_1742098		22
+#define ARM64_HAS_COPY_PREFETCH			23
 
-#define ARM64_NCAPS				23
+#define ARM64_NCAPS				24
 
 #endif /* __ASM_CPUCAPS_H */
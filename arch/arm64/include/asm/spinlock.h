@@ -20,6 +20,50 @@
 #include <asm/spinlock_types.h>
 #include <asm/processor.h>
 
+#ifdef CONFIG_QUEUED_SPINLOCKS
+
+/*
+ * The generic helpers rely on the lock acquisition being a full barrier,
+ * which acquire semantics on arm64 do not give us. Order the read of the
+ * lock word against any locks we took before, and serialise against a
+ * concurrent locker by writing back the unlocked value as the ticket
+ * lock below does.
+ */
+static inline int queued_spin_is_locked(struct qspinlock *lock)
+{
+	smp_mb();
+	return atomic_read(&lock->val);
+}
+#define queued_spin_is_locked queued_spin_is_locked
+
+static inline void queued_spin_unlock_wait(struct qspinlock *lock)
+{
+	u32 val;
+
+	smp_mb();
+	for (;;) {
+		val = atomic_read(&lock->val);
+
+		/* Unlocked, and nobody slipped in before our writeback */
+		if (!val && !atomic_cmpxchg_acquire(&lock->val, 0, 0))
+			return;
+
+		if (val & _Q_LOCKED_MASK)
+			break;
+
+		/* Pending only, wait until we observe the lock */
+		cpu_relax();
+	}
+
+	/* Any unlock is good */
+	smp_cond_load_acquire(&lock->val.counter, !(VAL & _Q_LOCKED_MASK));
+}
+#define queued_spin_unlock_wait queued_spin_unlock_wait
+
+#include <asm-generic/qspinlock.h>
+
+#else /* !CONFIG_QUEUED_SPINLOCKS */
+
 /*
  * Spinlock implementation.
  *
@@ -186,6 +230,8 @@ static inline int arch_spin_is_contended(arch_spinlock_t *lock)
 }
 #define arch_spin_is_contended	arch_spin_is_contended
 
+#endif /* CONFIG_QUEUED_SPINLOCKS */
+
 #include <asm/qrwlock.h>
 
 #define arch_read_lock_flags(lock, flags) arch_read_lock(lock)
@@ -20,6 +20,10 @@
 # error "please don't include this file directly"
 #endif
 
+#ifdef CONFIG_QUEUED_SPINLOCKS
+#include <asm-generic/qspinlock_types.h>
+#else
+
 #include <linux/types.h>
 
 #define TICKET_SHIFT	16
@@ -36,6 +40,8 @@ typedef struct {
 
 #define __ARCH_SPIN_LOCK_UNLOCKED	{ 0 , 0 }
 
+#endif /* CONFIG_QUEUED_SPINLOCKS */
+
 #include <asm-generic/qrwlock_types.h>
 
 #endif
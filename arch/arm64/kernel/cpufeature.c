@@ -763,6 +763,22 @@ static bool has_no_hw_prefetch(const struct arm64_cpu_capabilities *entry, int _
 		MIDR_CPU_VAR_REV(1, MIDR_REVISION_MASK));
 }
 
+static bool has_inorder_copy(const struct arm64_cpu_capabilities *entry,
+			     int __unused)
+{
+	static const struct midr_range inorder_list[] = {
+		MIDR_ALL_VERSIONS(MIDR_CORTEX_A53),
+		MIDR_ALL_VERSIONS(MIDR_CORTEX_A55),
+		{},
+	};
+
+	/*
+	 * In-order cores stall on each load miss of the copy loops, so
+	 * they gain from software prefetch well ahead of the source.
+	 */
+	return is_midr_in_range_list(read_cpuid_id(), inorder_list);
+}
+
 static bool runs_at_el2(const struct arm64_cpu_capabilities *entry, int __unused)
 {
 	return is_kernel_in_hyp_mode();
@@ -940,6 +956,12 @@ static const struct arm64_cpu_capabilities arm64_features[] = {
 		.type = ARM64_CPUCAP_SYSTEM_FEATURE,
 		.matches = has_no_hw_prefetch,
 	},
+	{
+		.desc = "Software prefetching in copy routines",
+		.capability = ARM64_HAS_COPY_PREFETCH,
+		.type = ARM64_CPUCAP_SYSTEM_FEATURE,
+		.matches = has_inorder_copy,
+	},
 #ifdef CONFIG_ARM64_UAO
 	{
 		.desc = "User Access Override",
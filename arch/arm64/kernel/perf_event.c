@@ -28,6 +28,7 @@
 #include <linux/of.h>
 #include <linux/perf/arm_pmu.h>
 #include <linux/platform_device.h>
+#include <linux/sysctl.h>
 
 static DEFINE_PER_CPU(bool, is_hotplugging);
 
@@ -526,12 +527,41 @@ static struct attribute_group armv8_pmuv3_events_attr_group = {
 };
 
 PMU_FORMAT_ATTR(event, "config:0-9");
+PMU_FORMAT_ATTR(rdpmc, "config1:1");
+
+/* attr.config1 bit requesting direct EL0 access to the counter */
+#define ARMV8_PMU_CONFIG1_RDPMC	(1ULL << 1)
 
 static struct attribute *armv8_pmuv3_format_attrs[] = {
 	&format_attr_event.attr,
+	&format_attr_rdpmc.attr,
 	NULL,
 };
 
+/*
+ * Self-monitoring tasks may read their counters straight from EL0 when
+ * the event asks for it with config1:1 and kernel.perf_user_access is set.
+ * While such a task runs, PMUSERENR_EL0 gives EL0 read access to the
+ * cycle and event counters; counters that are not in use are zeroed first
+ * so nothing left over from other contexts is exposed.
+ */
+static int sysctl_perf_user_access __read_mostly;
+static int zero;
+static int one = 1;
+
+static struct ctl_table armv8_pmu_sysctl_table[] = {
+	{
+		.procname	= "perf_user_access",
+		.data		= &sysctl_perf_user_access,
+		.maxlen		= sizeof(int),
+		.mode		= 0644,
+		.proc_handler	= proc_dointvec_minmax,
+		.extra1		= &zero,
+		.extra2		= &one,
+	},
+	{ }
+};
+
 static struct attribute_group armv8_pmuv3_format_attr_group = {
 	.name = "format",
 	.attrs = armv8_pmuv3_format_attrs,
@@ -673,6 +703,63 @@ static inline int armv8pmu_disable_intens(int idx)
 	return idx;
 }
 
+static void armv8pmu_write_evcntr(int idx, u32 value)
+{
+	if (armv8pmu_select_counter(idx) == idx)
+		write_sysreg(value, pmxevcntr_el0);
+}
+
+static bool armv8pmu_event_el0_read(struct perf_event *event)
+{
+	return event->hw.flags & ARMPMU_EVT_EL0_READ;
+}
+
+static void armv8pmu_enable_user_access(struct arm_pmu *cpu_pmu)
+{
+	struct pmu_hw_events *cpuc = this_cpu_ptr(cpu_pmu->hw_events);
+	int idx;
+
+	/* Clear any unused counters to avoid leaking their contents */
+	for_each_clear_bit(idx, cpuc->used_mask, cpu_pmu->num_events) {
+		if (idx == ARMV8_IDX_CYCLE_COUNTER)
+			write_sysreg(0, pmccntr_el0);
+		else
+			armv8pmu_write_evcntr(idx, 0);
+	}
+
+	write_sysreg(ARMV8_PMU_USERENR_ER | ARMV8_PMU_USERENR_CR,
+		     pmuserenr_el0);
+}
+
+static void armv8pmu_disable_user_access(void)
+{
+	write_sysreg(0, pmuserenr_el0);
+}
+
+/*
+ * EL0 access is only granted while the current task owns an active event
+ * that asked for it; it is re-evaluated every time the PMU is enabled,
+ * which includes each context switch of a task with perf events.
+ */
+static bool armv8pmu_want_user_access(struct arm_pmu *cpu_pmu)
+{
+	struct pmu_hw_events *cpuc = this_cpu_ptr(cpu_pmu->hw_events);
+	int idx;
+
+	if (!sysctl_perf_user_access)
+		return false;
+
+	for_each_set_bit(idx, cpuc->used_mask, cpu_pmu->num_events) {
+		struct perf_event *event = cpuc->events[idx];
+
+		if (event && armv8pmu_event_el0_read(event) &&
+		    event->ctx && event->ctx->task == current)
+			return true;
+	}
+
+	return false;
+}
+
 static inline u32 armv8pmu_getreset_flags(void)
 {
 	u32 value;
@@ -756,6 +843,11 @@ static void armv8pmu_start(struct arm_pmu *cpu_pmu)
 	struct pmu_hw_events *events = this_cpu_ptr(cpu_pmu->hw_events);
 
 	raw_spin_lock_irqsave(&events->pmu_lock, flags);
+	if (armv8pmu_want_user_access(cpu_pmu))
+		armv8pmu_enable_user_access(cpu_pmu);
+	else
+		armv8pmu_disable_user_access();
+
 	/* Enable all counters */
 	armv8pmu_pmcr_write(armv8pmu_pmcr_read() | ARMV8_PMU_PMCR_E);
 	raw_spin_unlock_irqrestore(&events->pmu_lock, flags);
@@ -893,6 +985,13 @@ static int armv8pmu_set_event_filter(struct hw_perf_event *event,
 	if (attr->exclude_user)
 		config_base |= ARMV8_PMU_EXCLUDE_EL0;
 
+	/* Direct EL0 reads are only offered to per-task events */
+	if ((attr->config1 & ARMV8_PMU_CONFIG1_RDPMC) && event->target &&
+	    sysctl_perf_user_access)
+		event->flags |= ARMPMU_EVT_EL0_READ;
+	else
+		event->flags &= ~ARMPMU_EVT_EL0_READ;
+
 	/*
 	 * Install the filter into config_base as this is used to
 	 * construct the event type.
@@ -1061,6 +1160,32 @@ static int armv8pmu_probe_pmu(struct arm_pmu *cpu_pmu)
 	return ret;
 }
 
+/*
+ * perf_event_mmap_page::index is the counter number plus one, with 32
+ * standing for the cycle counter, or 0 when userspace must use read().
+ */
+static int armv8pmu_user_event_idx(struct perf_event *event)
+{
+	if (!sysctl_perf_user_access || !armv8pmu_event_el0_read(event))
+		return 0;
+
+	if (event->hw.idx == ARMV8_IDX_CYCLE_COUNTER)
+		return 32;
+
+	return ARMV8_IDX_TO_COUNTER(event->hw.idx) + 1;
+}
+
+void arch_perf_update_userpage(struct perf_event *event,
+			       struct perf_event_mmap_page *userpg, u64 now)
+{
+	if (event->pmu->event_idx != armv8pmu_user_event_idx)
+		return;
+
+	userpg->cap_user_rdpmc = sysctl_perf_user_access &&
+				 armv8pmu_event_el0_read(event);
+	userpg->pmc_width = 32;
+}
+
 static void armv8_pmu_init(struct arm_pmu *cpu_pmu)
 {
 	cpu_pmu->handle_irq		= armv8pmu_handle_irq,
@@ -1074,6 +1199,7 @@ static void armv8_pmu_init(struct arm_pmu *cpu_pmu)
 	cpu_pmu->reset			= armv8pmu_reset,
 	cpu_pmu->max_period		= (1LLU << 32) - 1,
 	cpu_pmu->set_event_filter	= armv8pmu_set_event_filter;
+	cpu_pmu->pmu.event_idx		= armv8pmu_user_event_idx;
 }
 
 static int armv8_pmuv3_init(struct arm_pmu *cpu_pmu)
@@ -1233,3 +1359,10 @@ static struct platform_driver armv8_pmu_driver = {
 };
 
 builtin_platform_driver(armv8_pmu_driver);
+
+static int __init armv8_pmu_sysctl_init(void)
+{
+	register_sysctl("kernel", armv8_pmu_sysctl_table);
+	return 0;
+}
+device_initcall(armv8_pmu_sysctl_init);
@@ -1108,6 +1108,13 @@ static struct request *__get_request(struct request_list *rl, int op,
 	if (rl->count[is_sync] >= (3 * q->nr_requests / 2))
 		return ERR_PTR(-ENOMEM);
 
+	/*
+	 * Hold back groups that would push a latency protected group over
+	 * its target.
+	 */
+	if (may_queue != ELV_MQUEUE_MUST && blk_throtl_rl_limited(rl))
+		goto rq_starved;
+
 	q->nr_rqs[is_sync]++;
 	rl->count[is_sync]++;
 	rl->starved[is_sync] = 0;
@@ -2768,6 +2775,7 @@ void blk_finish_request(struct request *req, int error)
 		blk_unprep_request(req);
 
 	blk_account_io_done(req);
+	blk_throtl_rq_done(req);
 
 	if (req->end_io)
 		req->end_io(req, error);
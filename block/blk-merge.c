@@ -723,6 +723,11 @@ static void blk_account_io_merge(struct request *req)
 	}
 }
 
+/*
+ * @bio must be the one that ends where @nxt starts.  For a request that is
+ * its biotail: the DUN range of the first bio of a multi-bio request never
+ * lines up with the bio that follows the request.
+ */
 static bool crypto_not_mergeable(const struct bio *bio, const struct bio *nxt)
 {
 	return (!pfk_allow_merge_bio(bio, nxt));
@@ -755,7 +760,7 @@ static int attempt_merge(struct request_queue *q, struct request *req,
 	    !blk_write_same_mergeable(req->bio, next->bio))
 		return 0;
 
-	if (crypto_not_mergeable(req->bio, next->bio))
+	if (crypto_not_mergeable(req->biotail, next->bio))
 		return 0;
 	/*
 	 * If we are allowed to merge, then append bio list
@@ -873,7 +878,7 @@ bool blk_rq_merge_ok(struct request *rq, struct bio *bio)
 int blk_try_merge(struct request *rq, struct bio *bio)
 {
 	if (blk_rq_pos(rq) + blk_rq_sectors(rq) == bio->bi_iter.bi_sector) {
-		if (crypto_not_mergeable(rq->bio, bio))
+		if (crypto_not_mergeable(rq->biotail, bio))
 			return ELEVATOR_NO_MERGE;
 		return ELEVATOR_BACK_MERGE;
 	} else if (blk_rq_pos(rq) - bio_sectors(bio) ==
@@ -21,6 +21,18 @@ static int throtl_quantum = 32;
 /* Throttling is performed over 100ms slice and after that slice is renewed */
 static unsigned long throtl_slice = HZ/10;	/* 100 ms */
 
+/*
+ * Read latency of protected groups is sampled over windows of this length.
+ * The depth allowed to other groups is re-evaluated at the end of each.
+ */
+static unsigned long throtl_lat_window = HZ/10;	/* 100 ms */
+
+/* Fewer completions than this in a window are not enough for a p90 */
+#define THROTL_LAT_MIN_SAMPLES	8
+
+/* log2 buckets of read latency in usecs, the last one catches the rest */
+#define THROTL_LAT_BUCKETS	20
+
 static struct blkcg_policy blkcg_policy_throtl;
 
 /* A workqueue to queue throttle related work */
@@ -133,6 +145,22 @@ struct throtl_grp {
 	/* When did we start a new slice */
 	unsigned long slice_start[2];
 	unsigned long slice_end[2];
+
+	/*
+	 * Read latency protection.  A group with a latency target set is
+	 * protected: while its p90 read latency is over the target, the
+	 * number of requests other groups may have allocated on the queue
+	 * is cut down, see blk_throtl_rq_done().
+	 */
+	unsigned int lat_target_us;
+	unsigned int lat_hist[THROTL_LAT_BUCKETS];
+	unsigned int lat_samples;
+	unsigned long lat_window_start;
+
+	/* latency stats, exported through throttle.latency_stat */
+	unsigned int lat_p90_us;
+	uint64_t lat_missed;
+	uint64_t lat_limited;
 };
 
 struct throtl_data
@@ -147,6 +175,16 @@ struct throtl_data
 
 	/* Work for dispatching throttled bios */
 	struct work_struct dispatch_work;
+
+	/*
+	 * Requests each unprotected group may have allocated while a
+	 * protected group misses its latency target, 0 if unlimited.
+	 */
+	unsigned int lat_depth;
+	/* last time a protected group missed its target */
+	unsigned long lat_miss_time;
+	/* last completion from a protected group */
+	unsigned long lat_active_time;
 };
 
 static void throtl_pending_timer_fn(unsigned long arg);
@@ -338,6 +376,7 @@ static struct blkg_policy_data *throtl_pd_alloc(gfp_t gfp, int node)
 	tg->bps[WRITE] = -1;
 	tg->iops[READ] = -1;
 	tg->iops[WRITE] = -1;
+	tg->lat_target_us = -1;
 
 	return &tg->pd;
 }
@@ -1234,6 +1273,29 @@ static ssize_t tg_set_conf_uint(struct kernfs_open_file *of,
 	return tg_set_conf(of, buf, nbytes, off, false);
 }
 
+static u64 tg_prfill_latency_stat(struct seq_file *sf,
+				  struct blkg_policy_data *pd, int off)
+{
+	struct throtl_grp *tg = pd_to_tg(pd);
+	struct throtl_data *td = tg->td;
+	const char *dname = blkg_dev_name(pd->blkg);
+
+	if (!dname)
+		return 0;
+
+	seq_printf(sf, "%s p90_us=%u missed=%llu limited=%llu depth=%u\n",
+		   dname, tg->lat_p90_us, tg->lat_missed, tg->lat_limited,
+		   td->lat_depth);
+	return 0;
+}
+
+static int tg_print_latency_stat(struct seq_file *sf, void *v)
+{
+	blkcg_print_blkgs(sf, css_to_blkcg(seq_css(sf)), tg_prfill_latency_stat,
+			  &blkcg_policy_throtl, 0, false);
+	return 0;
+}
+
 static struct cftype throtl_legacy_files[] = {
 	{
 		.name = "throttle.read_bps_device",
@@ -1269,6 +1331,16 @@ static struct cftype throtl_legacy_files[] = {
 		.private = (unsigned long)&blkcg_policy_throtl,
 		.seq_show = blkg_print_stat_ios,
 	},
+	{
+		.name = "throttle.read_latency_target_us",
+		.private = offsetof(struct throtl_grp, lat_target_us),
+		.seq_show = tg_print_conf_uint,
+		.write = tg_set_conf_uint,
+	},
+	{
+		.name = "throttle.latency_stat",
+		.seq_show = tg_print_latency_stat,
+	},
 	{ }	/* terminate */
 };
 
@@ -1559,6 +1631,119 @@ void blk_throtl_drain(struct request_queue *q)
 	spin_lock_irq(q->queue_lock);
 }
 
+static void throtl_lat_window_end(struct throtl_grp *tg,
+				  struct request_queue *q)
+{
+	struct throtl_data *td = tg->td;
+	unsigned int i, sum = 0, p90_us = 0;
+
+	if (tg->lat_samples < THROTL_LAT_MIN_SAMPLES)
+		goto reset;
+
+	for (i = 0; i < THROTL_LAT_BUCKETS; i++) {
+		sum += tg->lat_hist[i];
+		if (sum * 10 >= tg->lat_samples * 9) {
+			p90_us = 1U << i;
+			break;
+		}
+	}
+	tg->lat_p90_us = p90_us;
+
+	if (p90_us > tg->lat_target_us) {
+		/* halve what the others may have in flight */
+		tg->lat_missed++;
+		td->lat_miss_time = jiffies;
+		td->lat_depth = max(1U, (td->lat_depth ?: q->nr_requests) / 2);
+	} else if (td->lat_depth &&
+		   time_after(jiffies, td->lat_miss_time + throtl_lat_window)) {
+		/* no protected group missed for a window, back off gently */
+		td->lat_depth += max(1U, td->lat_depth / 4);
+		if (td->lat_depth >= q->nr_requests)
+			td->lat_depth = 0;
+	}
+
+	throtl_log(&td->service_queue, "lat p90=%uus target=%uus depth=%u",
+		   p90_us, tg->lat_target_us, td->lat_depth);
+reset:
+	memset(tg->lat_hist, 0, sizeof(tg->lat_hist));
+	tg->lat_samples = 0;
+	tg->lat_window_start = jiffies;
+}
+
+/**
+ * blk_throtl_rq_done - account the completion latency of a request
+ * @rq: the completed request
+ *
+ * Reads issued by a group with a latency target are sampled into the
+ * group's latency histogram.  At the end of each window the p90 is
+ * checked against the target and the depth allowed to unprotected groups
+ * is halved if it was missed, or slowly raised back otherwise.
+ *
+ * Called with queue_lock held.
+ */
+void blk_throtl_rq_done(struct request *rq)
+{
+	struct request_queue *q = rq->q;
+	struct throtl_grp *tg;
+	u64 now = sched_clock();
+	unsigned int lat_us, bucket;
+
+	if (!q->td || !rq->rl || rq->cmd_type != REQ_TYPE_FS ||
+	    rq_data_dir(rq) != READ)
+		return;
+
+	tg = blkg_to_tg(rq->rl->blkg);
+	if (!tg || tg->lat_target_us == -1)
+		return;
+
+	if (now <= rq_start_time_ns(rq))
+		return;
+	lat_us = min_t(u64, div_u64(now - rq_start_time_ns(rq), NSEC_PER_USEC),
+		       UINT_MAX);
+	bucket = lat_us ? min(ilog2(lat_us) + 1, THROTL_LAT_BUCKETS - 1) : 0;
+	tg->lat_hist[bucket]++;
+	tg->lat_samples++;
+	tg->td->lat_active_time = jiffies;
+
+	if (time_after(jiffies, tg->lat_window_start + throtl_lat_window))
+		throtl_lat_window_end(tg, q);
+}
+
+/**
+ * blk_throtl_rl_limited - check an allocation against the latency depth
+ * @rl: request_list the request would be allocated from
+ *
+ * Returns true if @rl belongs to an unprotected group that already has as
+ * many requests allocated as protected groups currently allow.  Waiters
+ * are woken up as requests of @rl are freed.
+ *
+ * Called with queue_lock held.
+ */
+bool blk_throtl_rl_limited(struct request_list *rl)
+{
+	struct throtl_data *td = rl->q->td;
+	struct throtl_grp *tg;
+
+	if (!td || !td->lat_depth)
+		return false;
+
+	/* the protected groups went idle, drop the limit */
+	if (time_after(jiffies, td->lat_active_time + 2 * throtl_lat_window)) {
+		td->lat_depth = 0;
+		return false;
+	}
+
+	tg = blkg_to_tg(rl->blkg);
+	if (!tg || tg->lat_target_us != -1)
+		return false;
+
+	if (rl->count[BLK_RW_SYNC] + rl->count[BLK_RW_ASYNC] < td->lat_depth)
+		return false;
+
+	tg->lat_limited++;
+	return true;
+}
+
 int blk_throtl_init(struct request_queue *q)
 {
 	struct throtl_data *td;
@@ -0,0 +1,616 @@
+/*
+ *  Latency target i/o scheduler.
+ *
+ *  Reads and sync writes are served in FIFO order against separate
+ *  completion latency targets. While either target is being missed,
+ *  async writeback and background (idle class) I/O, such as f2fs garbage
+ *  collection, are throttled down to a trickle. Requests issued from the
+ *  blkio cgroup named by prio_cgroup are served ahead of their class.
+ *
+ *  See Documentation/block/latency-iosched.txt
+ */
+#include <linux/kernel.h>
+#include <linux/fs.h>
+#include <linux/blkdev.h>
+#include <linux/blk-cgroup.h>
+#include <linux/elevator.h>
+#include <linux/bio.h>
+#include <linux/ioprio.h>
+#include <linux/iocontext.h>
+#include <linux/module.h>
+#include <linux/slab.h>
+#include <linux/init.h>
+#include <linux/ktime.h>
+#include <linux/rbtree.h>
+
+static const int read_target_us = 2000;	  /* completion latency target for reads */
+static const int sync_write_target_us = 10000; /* ditto for sync writes */
+static const int async_expire = 5 * HZ;	  /* max time an async write is held back */
+static const int async_depth = 8;	  /* async requests in flight, targets met */
+static const int throttle_depth = 1;	  /* ditto, while a target is missed */
+
+#define LAT_CGROUP_NAME_LEN	32
+
+enum lat_class {
+	LAT_READ,
+	LAT_SYNC_WRITE,
+	LAT_ASYNC,
+	LAT_NR_CLASSES,
+};
+
+/* the sync classes are those with a latency target */
+#define LAT_NR_TARGETS		LAT_ASYNC
+
+/* rq->elv.priv[0] holds the class and priority, priv[1] the insert time */
+#define LAT_PRIO		(1UL << 8)
+#define LAT_CLASS_MASK		(LAT_PRIO - 1)
+
+struct lat_data {
+	/*
+	 * run time data
+	 */
+
+	/*
+	 * requests are present on both sort_list, for merging, and on the
+	 * fifo of their class, normal or prio
+	 */
+	struct rb_root sort_list[2];
+	struct list_head fifo_list[LAT_NR_CLASSES][2];
+
+	unsigned int in_flight[LAT_NR_CLASSES];
+	unsigned int avg_lat_us[LAT_NR_TARGETS];	/* moving average */
+	bool throttled;
+
+	/* statistics */
+	unsigned long missed[LAT_NR_TARGETS];
+	unsigned long throttle_cnt;
+	unsigned long prio_cnt;
+
+	/*
+	 * settings that change how the i/o scheduler behaves
+	 */
+	int target_us[LAT_NR_TARGETS];
+	int async_expire;
+	int async_depth;
+	int throttle_depth;
+	int front_merges;
+
+	spinlock_t prio_lock;			/* protects prio_cgroup */
+	char prio_cgroup[LAT_CGROUP_NAME_LEN];
+};
+
+static inline unsigned long lat_now_us(void)
+{
+	return (unsigned long)ktime_to_us(ktime_get());
+}
+
+static inline enum lat_class lat_rq_class(struct request *rq)
+{
+	return (unsigned long)rq->elv.priv[0] & LAT_CLASS_MASK;
+}
+
+static inline int lat_rq_prio(struct request *rq)
+{
+	return !!((unsigned long)rq->elv.priv[0] & LAT_PRIO);
+}
+
+static inline struct rb_root *
+lat_rb_root(struct lat_data *ld, struct request *rq)
+{
+	return &ld->sort_list[rq_data_dir(rq)];
+}
+
+#ifdef CONFIG_BLK_CGROUP
+/*
+ * Is @bio, or the current task for a bio without a cgroup, issued from
+ * the priority cgroup?
+ */
+static bool lat_is_prio(struct lat_data *ld, struct bio *bio)
+{
+	char name[LAT_CGROUP_NAME_LEN];
+	struct blkcg *blkcg;
+	unsigned long flags;
+	bool prio;
+
+	rcu_read_lock();
+	blkcg = bio_blkcg(bio);
+	cgroup_name(blkcg->css.cgroup, name, sizeof(name));
+	rcu_read_unlock();
+
+	spin_lock_irqsave(&ld->prio_lock, flags);
+	prio = ld->prio_cgroup[0] && !strcmp(name, ld->prio_cgroup);
+	spin_unlock_irqrestore(&ld->prio_lock, flags);
+
+	return prio;
+}
+#else
+static inline bool lat_is_prio(struct lat_data *ld, struct bio *bio)
+{
+	return false;
+}
+#endif
+
+static int
+lat_set_request(struct request_queue *q, struct request *rq, struct bio *bio,
+		gfp_t gfp_mask)
+{
+	struct lat_data *ld = q->elevator->elevator_data;
+	struct io_context *ioc = current->io_context;
+	unsigned long flags;
+
+	/* idle class I/O, e.g. a garbage collection thread, is background */
+	if (!rq_is_sync(rq) ||
+	    (ioc && IOPRIO_PRIO_CLASS(ioc->ioprio) == IOPRIO_CLASS_IDLE))
+		flags = LAT_ASYNC;
+	else if (rq_data_dir(rq) == READ)
+		flags = LAT_READ;
+	else
+		flags = LAT_SYNC_WRITE;
+
+	if (lat_is_prio(ld, bio))
+		flags |= LAT_PRIO;
+
+	rq->elv.priv[0] = (void *)flags;
+	return 0;
+}
+
+static inline void
+lat_add_rq_rb(struct lat_data *ld, struct request *rq)
+{
+	elv_rb_add(lat_rb_root(ld, rq), rq);
+}
+
+/*
+ * add rq to rbtree and fifo
+ */
+static void
+lat_add_request(struct request_queue *q, struct request *rq)
+{
+	struct lat_data *ld = q->elevator->elevator_data;
+	enum lat_class class = lat_rq_class(rq);
+	int prio = lat_rq_prio(rq);
+
+	lat_add_rq_rb(ld, rq);
+
+	rq->elv.priv[1] = (void *)lat_now_us();
+	if (class == LAT_ASYNC)
+		rq->fifo_time = jiffies + ld->async_expire;
+	if (prio)
+		ld->prio_cnt++;
+	list_add_tail(&rq->queuelist, &ld->fifo_list[class][prio]);
+}
+
+/*
+ * remove rq from rbtree and fifo.
+ */
+static void lat_remove_request(struct request_queue *q, struct request *rq)
+{
+	struct lat_data *ld = q->elevator->elevator_data;
+
+	rq_fifo_clear(rq);
+	elv_rb_del(lat_rb_root(ld, rq), rq);
+}
+
+static int
+lat_merge(struct request_queue *q, struct request **req, struct bio *bio)
+{
+	struct lat_data *ld = q->elevator->elevator_data;
+	struct request *__rq;
+
+	/*
+	 * check for front merge
+	 */
+	if (ld->front_merges) {
+		sector_t sector = bio_end_sector(bio);
+
+		__rq = elv_rb_find(&ld->sort_list[bio_data_dir(bio)], sector);
+		if (__rq) {
+			BUG_ON(sector != blk_rq_pos(__rq));
+
+			if (elv_bio_merge_ok(__rq, bio)) {
+				*req = __rq;
+				return ELEVATOR_FRONT_MERGE;
+			}
+		}
+	}
+
+	return ELEVATOR_NO_MERGE;
+}
+
+static void lat_merged_request(struct request_queue *q,
+			       struct request *req, int type)
+{
+	struct lat_data *ld = q->elevator->elevator_data;
+
+	/*
+	 * if the merge was a front merge, we need to reposition request
+	 */
+	if (type == ELEVATOR_FRONT_MERGE) {
+		elv_rb_del(lat_rb_root(ld, req), req);
+		lat_add_rq_rb(ld, req);
+	}
+}
+
+/*
+ * only merge requests that sit on the same fifo, so that a merge can not
+ * move a request between classes
+ */
+static int lat_allow_rq_merge(struct request_queue *q, struct request *rq,
+			      struct request *next)
+{
+	return rq->elv.priv[0] == next->elv.priv[0];
+}
+
+static void
+lat_merged_requests(struct request_queue *q, struct request *req,
+		    struct request *next)
+{
+	/*
+	 * if next was queued before rq, take over its age and its position
+	 * in the fifo (next will be deleted)
+	 */
+	if (!list_empty(&req->queuelist) && !list_empty(&next->queuelist)) {
+		if ((long)((unsigned long)next->elv.priv[1] -
+			   (unsigned long)req->elv.priv[1]) < 0) {
+			list_move(&req->queuelist, &next->queuelist);
+			req->elv.priv[1] = next->elv.priv[1];
+			req->fifo_time = next->fifo_time;
+		}
+	}
+
+	/*
+	 * kill knowledge of next, this one is a goner
+	 */
+	lat_remove_request(q, next);
+}
+
+/*
+ * move request from sort list to dispatch queue.
+ */
+static inline void
+lat_move_to_dispatch(struct lat_data *ld, struct request *rq)
+{
+	struct request_queue *q = rq->q;
+
+	lat_remove_request(q, rq);
+	elv_dispatch_add_tail(q, rq);
+}
+
+/*
+ * oldest request of @class, prio fifo first
+ */
+static struct request *lat_fifo_head(struct lat_data *ld, enum lat_class class)
+{
+	if (!list_empty(&ld->fifo_list[class][1]))
+		return rq_entry_fifo(ld->fifo_list[class][1].next);
+	if (!list_empty(&ld->fifo_list[class][0]))
+		return rq_entry_fifo(ld->fifo_list[class][0].next);
+	return NULL;
+}
+
+static inline bool lat_waited(struct lat_data *ld, struct request *rq,
+			      int target_us)
+{
+	return lat_now_us() - (unsigned long)rq->elv.priv[1] >= target_us;
+}
+
+/*
+ * May another async request go to the driver? While a target is missed
+ * async I/O only runs when no sync I/O is in flight.
+ */
+static bool lat_may_dispatch_async(struct lat_data *ld)
+{
+	if (!ld->throttled)
+		return ld->in_flight[LAT_ASYNC] < ld->async_depth;
+
+	return !ld->in_flight[LAT_READ] && !ld->in_flight[LAT_SYNC_WRITE] &&
+		ld->in_flight[LAT_ASYNC] < ld->throttle_depth;
+}
+
+/*
+ * lat_dispatch_requests selects the next request: a sync write that has
+ * waited past its target, then reads, then sync writes, then async
+ * requests that have expired or are not throttled.
+ */
+static int lat_dispatch_requests(struct request_queue *q, int force)
+{
+	struct lat_data *ld = q->elevator->elevator_data;
+	struct request *rq;
+	int class, dispatched = 0;
+
+	if (unlikely(force)) {
+		for (class = 0; class < LAT_NR_CLASSES; class++) {
+			while ((rq = lat_fifo_head(ld, class))) {
+				lat_move_to_dispatch(ld, rq);
+				dispatched++;
+			}
+		}
+		return dispatched;
+	}
+
+	rq = lat_fifo_head(ld, LAT_SYNC_WRITE);
+	if (rq && lat_waited(ld, rq, ld->target_us[LAT_SYNC_WRITE]))
+		goto dispatch_request;
+
+	rq = lat_fifo_head(ld, LAT_READ);
+	if (rq)
+		goto dispatch_request;
+
+	rq = lat_fifo_head(ld, LAT_SYNC_WRITE);
+	if (rq)
+		goto dispatch_request;
+
+	rq = lat_fifo_head(ld, LAT_ASYNC);
+	if (rq && (time_after_eq(jiffies, (unsigned long)rq->fifo_time) ||
+		   lat_may_dispatch_async(ld)))
+		goto dispatch_request;
+
+	return 0;
+
+dispatch_request:
+	lat_move_to_dispatch(ld, rq);
+	return 1;
+}
+
+static void lat_activate_request(struct request_queue *q, struct request *rq)
+{
+	struct lat_data *ld = q->elevator->elevator_data;
+
+	ld->in_flight[lat_rq_class(rq)]++;
+}
+
+static void lat_deactivate_request(struct request_queue *q,
+				   struct request *rq)
+{
+	struct lat_data *ld = q->elevator->elevator_data;
+
+	WARN_ON(!ld->in_flight[lat_rq_class(rq)]);
+	ld->in_flight[lat_rq_class(rq)]--;
+}
+
+/*
+ * Track the queue to completion latency of the sync classes and throttle
+ * async I/O while either average is over its target. Throttling stops once
+ * both are back under 3/4 of their target.
+ */
+static void lat_completed_request(struct request_queue *q, struct request *rq)
+{
+	struct lat_data *ld = q->elevator->elevator_data;
+	enum lat_class class = lat_rq_class(rq);
+	unsigned long lat_us;
+	bool over = false, under = true;
+	int i;
+
+	lat_deactivate_request(q, rq);
+	if (class == LAT_ASYNC)
+		return;
+
+	lat_us = lat_now_us() - (unsigned long)rq->elv.priv[1];
+	if (lat_us > ld->target_us[class])
+		ld->missed[class]++;
+	ld->avg_lat_us[class] = ld->avg_lat_us[class] -
+				(ld->avg_lat_us[class] >> 3) +
+				(min_t(unsigned long, lat_us, INT_MAX) >> 3);
+
+	for (i = 0; i < LAT_NR_TARGETS; i++) {
+		if (ld->avg_lat_us[i] > ld->target_us[i])
+			over = true;
+		if (ld->avg_lat_us[i] > ld->target_us[i] / 4 * 3)
+			under = false;
+	}
+
+	if (over && !ld->throttled) {
+		ld->throttled = true;
+		ld->throttle_cnt++;
+	} else if (under) {
+		ld->throttled = false;
+	}
+}
+
+static void lat_exit_queue(struct elevator_queue *e)
+{
+	struct lat_data *ld = e->elevator_data;
+	int class;
+
+	for (class = 0; class < LAT_NR_CLASSES; class++) {
+		BUG_ON(!list_empty(&ld->fifo_list[class][0]));
+		BUG_ON(!list_empty(&ld->fifo_list[class][1]));
+	}
+
+	kfree(ld);
+}
+
+/*
+ * initialize elevator private data (lat_data).
+ */
+static int lat_init_queue(struct request_queue *q, struct elevator_type *e)
+{
+	struct lat_data *ld;
+	struct elevator_queue *eq;
+	int class;
+
+	eq = elevator_alloc(q, e);
+	if (!eq)
+		return -ENOMEM;
+
+	ld = kzalloc_node(sizeof(*ld), GFP_KERNEL, q->node);
+	if (!ld) {
+		kobject_put(&eq->kobj);
+		return -ENOMEM;
+	}
+	eq->elevator_data = ld;
+
+	for (class = 0; class < LAT_NR_CLASSES; class++) {
+		INIT_LIST_HEAD(&ld->fifo_list[class][0]);
+		INIT_LIST_HEAD(&ld->fifo_list[class][1]);
+	}
+	ld->sort_list[READ] = RB_ROOT;
+	ld->sort_list[WRITE] = RB_ROOT;
+	ld->target_us[LAT_READ] = read_target_us;
+	ld->target_us[LAT_SYNC_WRITE] = sync_write_target_us;
+	ld->async_expire = async_expire;
+	ld->async_depth = async_depth;
+	ld->throttle_depth = throttle_depth;
+	ld->front_merges = 1;
+	spin_lock_init(&ld->prio_lock);
+	strlcpy(ld->prio_cgroup, "top-app", sizeof(ld->prio_cgroup));
+
+	spin_lock_irq(q->queue_lock);
+	q->elevator = eq;
+	spin_unlock_irq(q->queue_lock);
+	return 0;
+}
+
+/*
+ * sysfs parts below
+ */
+
+static ssize_t
+lat_var_show(int var, char *page)
+{
+	return sprintf(page, "%d\n", var);
+}
+
+static ssize_t
+lat_var_store(int *var, const char *page, size_t count)
+{
+	char *p = (char *) page;
+
+	*var = simple_strtol(p, &p, 10);
+	return count;
+}
+
+#define SHOW_FUNCTION(__FUNC, __VAR, __CONV)				\
+static ssize_t __FUNC(struct elevator_queue *e, char *page)		\
+{									\
+	struct lat_data *ld = e->elevator_data;				\
+	int __data = __VAR;						\
+	if (__CONV)							\
+		__data = jiffies_to_msecs(__data);			\
+	return lat_var_show(__data, (page));				\
+}
+SHOW_FUNCTION(lat_read_target_us_show, ld->target_us[LAT_READ], 0);
+SHOW_FUNCTION(lat_sync_write_target_us_show, ld->target_us[LAT_SYNC_WRITE], 0);
+SHOW_FUNCTION(lat_async_expire_show, ld->async_expire, 1);
+SHOW_FUNCTION(lat_async_depth_show, ld->async_depth, 0);
+SHOW_FUNCTION(lat_throttle_depth_show, ld->throttle_depth, 0);
+SHOW_FUNCTION(lat_front_merges_show, ld->front_merges, 0);
+#undef SHOW_FUNCTION
+
+#define STORE_FUNCTION(__FUNC, __PTR, MIN, MAX, __CONV)			\
+static ssize_t __FUNC(struct elevator_queue *e, const char *page, size_t count)	\
+{									\
+	struct lat_data *ld = e->elevator_data;				\
+	int __data;							\
+	int ret = lat_var_store(&__data, (page), count);		\
+	if (__data < (MIN))						\
+		__data = (MIN);						\
+	else if (__data > (MAX))					\
+		__data = (MAX);						\
+	if (__CONV)							\
+		*(__PTR) = msecs_to_jiffies(__data);			\
+	else								\
+		*(__PTR) = __data;					\
+	return ret;							\
+}
+STORE_FUNCTION(lat_read_target_us_store, &ld->target_us[LAT_READ], 1, INT_MAX, 0);
+STORE_FUNCTION(lat_sync_write_target_us_store, &ld->target_us[LAT_SYNC_WRITE], 1, INT_MAX, 0);
+STORE_FUNCTION(lat_async_expire_store, &ld->async_expire, 0, INT_MAX, 1);
+STORE_FUNCTION(lat_async_depth_store, &ld->async_depth, 1, INT_MAX, 0);
+STORE_FUNCTION(lat_throttle_depth_store, &ld->throttle_depth, 1, INT_MAX, 0);
+STORE_FUNCTION(lat_front_merges_store, &ld->front_merges, 0, 1, 0);
+#undef STORE_FUNCTION
+
+static ssize_t lat_prio_cgroup_show(struct elevator_queue *e, char *page)
+{
+	struct lat_data *ld = e->elevator_data;
+	unsigned long flags;
+	ssize_t len;
+
+	spin_lock_irqsave(&ld->prio_lock, flags);
+	len = sprintf(page, "%s\n", ld->prio_cgroup);
+	spin_unlock_irqrestore(&ld->prio_lock, flags);
+	return len;
+}
+
+static ssize_t lat_prio_cgroup_store(struct elevator_queue *e,
+				     const char *page, size_t count)
+{
+	struct lat_data *ld = e->elevator_data;
+	char name[LAT_CGROUP_NAME_LEN];
+	unsigned long flags;
+
+	strlcpy(name, page, sizeof(name));
+
+	spin_lock_irqsave(&ld->prio_lock, flags);
+	strlcpy(ld->prio_cgroup, strim(name), sizeof(ld->prio_cgroup));
+	spin_unlock_irqrestore(&ld->prio_lock, flags);
+	return count;
+}
+
+static ssize_t lat_stats_show(struct elevator_queue *e, char *page)
+{
+	struct lat_data *ld = e->elevator_data;
+
+	return sprintf(page,
+		       "read_avg_us %u\nread_missed %lu\nsync_write_avg_us %u\nsync_write_missed %lu\nthrottled %d\nthrottle_cnt %lu\nprio_cnt %lu\n",
+		       ld->avg_lat_us[LAT_READ], ld->missed[LAT_READ],
+		       ld->avg_lat_us[LAT_SYNC_WRITE],
+		       ld->missed[LAT_SYNC_WRITE], ld->throttled,
+		       ld->throttle_cnt, ld->prio_cnt);
+}
+
+#define LAT_ATTR(name) \
+	__ATTR(name, S_IRUGO|S_IWUSR, lat_##name##_show, \
+				      lat_##name##_store)
+
+static struct elv_fs_entry lat_attrs[] = {
+	LAT_ATTR(read_target_us),
+	LAT_ATTR(sync_write_target_us),
+	LAT_ATTR(async_expire),
+	LAT_ATTR(async_depth),
+	LAT_ATTR(throttle_depth),
+	LAT_ATTR(front_merges),
+	LAT_ATTR(prio_cgroup),
+	__ATTR(stats, S_IRUGO, lat_stats_show, NULL),
+	__ATTR_NULL
+};
+
+static struct elevator_type iosched_latency = {
+	.ops = {
+		.elevator_merge_fn = 		lat_merge,
+		.elevator_merged_fn =		lat_merged_request,
+		.elevator_merge_req_fn =	lat_merged_requests,
+		.elevator_allow_rq_merge_fn =	lat_allow_rq_merge,
+		.elevator_dispatch_fn =		lat_dispatch_requests,
+		.elevator_add_req_fn =		lat_add_request,
+		.elevator_activate_req_fn =	lat_activate_request,
+		.elevator_deactivate_req_fn =	lat_deactivate_request,
+		.elevator_completed_req_fn =	lat_completed_request,
+		.elevator_former_req_fn =	elv_rb_former_request,
+		.elevator_latter_req_fn =	elv_rb_latter_request,
+		.elevator_set_req_fn =		lat_set_request,
+		.elevator_init_fn =		lat_init_queue,
+		.elevator_exit_fn =		lat_exit_queue,
+	},
+
+	.elevator_attrs = lat_attrs,
+	.elevator_name = "latency",
+	.elevator_owner = THIS_MODULE,
+};
+
+static int __init lat_init(void)
+{
+	return elv_register(&iosched_latency);
+}
+
+static void __exit lat_exit(void)
+{
+	elv_unregister(&iosched_latency);
+}
+
+module_init(lat_init);
+module_exit(lat_exit);
+
+MODULE_LICENSE("GPL");
+MODULE_DESCRIPTION("latency target IO scheduler");
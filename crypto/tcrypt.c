@@ -1610,6 +1610,13 @@ static int do_test(const char *alg, u32 type, u32 mask, int m)
 				  speed_template_32);
 		break;
 
+	case 215:
+		test_cipher_speed("xchacha20", ENCRYPT, sec, NULL, 0,
+				  speed_template_32);
+		test_cipher_speed("xchacha12", ENCRYPT, sec, NULL, 0,
+				  speed_template_32);
+		break;
+
 	case 219:
 		test_cipher_speed("adiantum(xchacha12,aes)", ENCRYPT, sec, NULL,
 				  0, speed_template_32);
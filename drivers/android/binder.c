@@ -56,6 +56,8 @@
 #include <linux/file.h>
 #include <linux/freezer.h>
 #include <linux/fs.h>
+#include <linux/hash.h>
+#include <linux/ktime.h>
 #include <linux/list.h>
 #include <linux/miscdevice.h>
 #include <linux/module.h>
@@ -138,6 +140,15 @@ enum {
 static uint32_t binder_debug_mask = 0;
 module_param_named(debug_mask, binder_debug_mask, uint, 0644);
 
+/*
+ * Prefer a waiting thread that last ran on a CPU sharing a cache with the
+ * sender when picking a target thread for a synchronous transaction.
+ */
+static bool binder_cluster_affine;
+module_param_named(cluster_affine, binder_cluster_affine, bool, 0644);
+
+#define BINDER_AFFINE_SCAN_MAX 8
+
 static char *binder_devices_param = CONFIG_ANDROID_BINDER_DEVICES;
 module_param_named(devices, binder_devices_param, charp, S_IRUGO);
 
@@ -198,6 +209,8 @@ struct binder_stats {
 	atomic_t bc[_IOC_NR(BC_REPLY_SG) + 1];
 	atomic_t obj_created[BINDER_STAT_COUNT];
 	atomic_t obj_deleted[BINDER_STAT_COUNT];
+	atomic_t sync_wake_local;
+	atomic_t sync_wake_remote;
 };
 
 static struct binder_stats binder_stats;
@@ -685,8 +698,168 @@ struct binder_transaction {
 	 * during thread teardown
 	 */
 	spinlock_t lock;
+#ifdef CONFIG_ANDROID_BINDER_LATENCY_HIST
+	/**
+	 * @lat:           latency histograms of the target (node, code)
+	 * @lat_start_ns:  time the transaction was started by the sender
+	 * @lat_queued_ns: time the transaction was queued to the target
+	 * @lat_woken_ns:  time a target thread was woken for it
+	 */
+	struct binder_lat_hist *lat;
+	u64 lat_start_ns;
+	u64 lat_queued_ns;
+	u64 lat_woken_ns;
+#endif
 };
 
+#ifdef CONFIG_ANDROID_BINDER_LATENCY_HIST
+enum binder_lat_phase {
+	BINDER_LAT_ALLOC,
+	BINDER_LAT_QUEUE,
+	BINDER_LAT_WAKE,
+	BINDER_LAT_REPLY,
+	BINDER_LAT_PHASE_COUNT,
+};
+
+static const char * const binder_lat_phase_strings[] = {
+	"alloc",
+	"queue",
+	"wake",
+	"reply",
+};
+
+/*
+ * Bucket 0 counts latencies below 1us, bucket n counts latencies in
+ * [2^(n-1), 2^n) us and the last bucket everything above.
+ */
+#define BINDER_LAT_BUCKETS		16
+#define BINDER_LAT_ENTRIES_SHIFT	8
+#define BINDER_LAT_ENTRIES		(1 << BINDER_LAT_ENTRIES_SHIFT)
+#define BINDER_LAT_PROBES		8
+
+/**
+ * struct binder_lat_hist - latency histograms for one (node, code) pair
+ * @key:      node debug_id in the upper and transaction code in the
+ *            lower 32 bits, 0 while the slot is unused
+ * @pid:      pid of the process owning the node
+ * @sum_us:   sum of all recorded latencies per phase
+ * @buckets:  log2 histogram per phase
+ *
+ * Slots are claimed with a cmpxchg on @key and never released until
+ * the table is reset, so lookups and updates are lock free.
+ */
+struct binder_lat_hist {
+	u64 key;
+	int pid;
+	atomic64_t sum_us[BINDER_LAT_PHASE_COUNT];
+	atomic_t buckets[BINDER_LAT_PHASE_COUNT][BINDER_LAT_BUCKETS];
+};
+
+static struct binder_lat_hist binder_lat_hists[BINDER_LAT_ENTRIES];
+static atomic_t binder_lat_dropped;
+
+static struct binder_lat_hist *binder_lat_get(struct binder_node *node,
+					      int pid, uint32_t code)
+{
+	u64 key = ((u64)(u32)node->debug_id << 32) | code;
+	u32 hash = hash_64(key, BINDER_LAT_ENTRIES_SHIFT);
+	struct binder_lat_hist *h;
+	u64 cur;
+	int i;
+
+	for (i = 0; i < BINDER_LAT_PROBES; i++) {
+		h = &binder_lat_hists[(hash + i) & (BINDER_LAT_ENTRIES - 1)];
+		cur = READ_ONCE(h->key);
+		if (cur == key)
+			return h;
+		if (cur)
+			continue;
+		cur = cmpxchg64(&h->key, 0, key);
+		if (!cur) {
+			WRITE_ONCE(h->pid, pid);
+			return h;
+		}
+		if (cur == key)
+			return h;
+	}
+	atomic_inc(&binder_lat_dropped);
+	return NULL;
+}
+
+static void binder_lat_record(struct binder_lat_hist *h,
+			      enum binder_lat_phase phase, u64 since_ns)
+{
+	u64 us;
+	int bucket;
+
+	if (!h || !since_ns)
+		return;
+	us = div_u64(ktime_get_ns() - since_ns, NSEC_PER_USEC);
+	bucket = us ? min_t(int, ilog2(us) + 1, BINDER_LAT_BUCKETS - 1) : 0;
+	atomic_inc(&h->buckets[phase][bucket]);
+	atomic64_add(us, &h->sum_us[phase]);
+}
+
+static inline u64 binder_lat_clock(void)
+{
+	return ktime_get_ns();
+}
+
+static void binder_lat_txn_start(struct binder_transaction *t,
+				 struct binder_proc *target_proc,
+				 struct binder_node *target_node,
+				 u64 start_ns)
+{
+	t->lat = binder_lat_get(target_node, target_proc->pid, t->code);
+	t->lat_start_ns = start_ns;
+}
+
+static inline void binder_lat_txn_alloc(struct binder_transaction *t,
+					u64 start_ns)
+{
+	binder_lat_record(t->lat, BINDER_LAT_ALLOC, start_ns);
+}
+
+static inline void binder_lat_txn_queued(struct binder_transaction *t)
+{
+	if (t->lat)
+		t->lat_queued_ns = ktime_get_ns();
+}
+
+static inline void binder_lat_txn_woken(struct binder_transaction *t)
+{
+	if (t->lat)
+		t->lat_woken_ns = ktime_get_ns();
+}
+
+static void binder_lat_txn_dequeued(struct binder_transaction *t)
+{
+	binder_lat_record(t->lat, BINDER_LAT_QUEUE, t->lat_queued_ns);
+	binder_lat_record(t->lat, BINDER_LAT_WAKE, t->lat_woken_ns);
+}
+
+static inline void binder_lat_txn_replied(struct binder_transaction *t)
+{
+	binder_lat_record(t->lat, BINDER_LAT_REPLY, t->lat_start_ns);
+}
+#else
+static inline u64 binder_lat_clock(void)
+{
+	return 0;
+}
+
+static inline void binder_lat_txn_start(struct binder_transaction *t,
+					struct binder_proc *target_proc,
+					struct binder_node *target_node,
+					u64 start_ns) {}
+static inline void binder_lat_txn_alloc(struct binder_transaction *t,
+					u64 start_ns) {}
+static inline void binder_lat_txn_queued(struct binder_transaction *t) {}
+static inline void binder_lat_txn_woken(struct binder_transaction *t) {}
+static inline void binder_lat_txn_dequeued(struct binder_transaction *t) {}
+static inline void binder_lat_txn_replied(struct binder_transaction *t) {}
+#endif
+
 /**
  * struct binder_object - union of flat binder object types
  * @hdr:   generic object header
@@ -1103,6 +1276,57 @@ binder_select_thread_ilocked(struct binder_proc *proc)
 	return thread;
 }
 
+/**
+ * binder_select_thread_affine_ilocked() - select a thread for a sync txn
+ * @proc:	process to select a thread from
+ *
+ * Like binder_select_thread_ilocked(), but when binder_cluster_affine is
+ * set, the first few waiting threads are scanned for one whose last CPU
+ * shares a cache with the current CPU. Whether the selected thread is
+ * cache local to the sender is accounted in the binder stats.
+ *
+ * Return:	a waiting thread taken off the waiting_threads list or NULL.
+ */
+static struct binder_thread *
+binder_select_thread_affine_ilocked(struct binder_proc *proc)
+{
+	struct binder_thread *thread, *selected = NULL;
+	int cpu = raw_smp_processor_id();
+	int scanned = 0;
+
+	assert_spin_locked(&proc->inner_lock);
+	if (!binder_cluster_affine)
+		goto select;
+
+	list_for_each_entry(thread, &proc->waiting_threads,
+			    waiting_thread_node) {
+		if (cpus_share_cache(cpu, task_cpu(thread->task))) {
+			selected = thread;
+			break;
+		}
+		if (++scanned >= BINDER_AFFINE_SCAN_MAX)
+			break;
+	}
+
+select:
+	if (!selected)
+		selected = list_first_entry_or_null(&proc->waiting_threads,
+						    struct binder_thread,
+						    waiting_thread_node);
+	if (!selected)
+		return NULL;
+
+	list_del_init(&selected->waiting_thread_node);
+	if (cpus_share_cache(cpu, task_cpu(selected->task))) {
+		atomic_inc(&binder_stats.sync_wake_local);
+		atomic_inc(&proc->stats.sync_wake_local);
+	} else {
+		atomic_inc(&binder_stats.sync_wake_remote);
+		atomic_inc(&proc->stats.sync_wake_remote);
+	}
+	return selected;
+}
+
 /**
  * binder_wakeup_thread_ilocked() - wakes up a thread for doing proc work.
  * @proc:	process to wake up a thread in
@@ -2931,6 +3155,7 @@ static int binder_proc_transaction(struct binder_transaction *t,
 	bool pending_async = false;
 
 	BUG_ON(!node);
+	binder_lat_txn_queued(t);
 	binder_node_lock(node);
 	node_prio.prio = node->min_priority;
 	node_prio.sched_policy = node->sched_policy;
@@ -2960,7 +3185,8 @@ static int binder_proc_transaction(struct binder_transaction *t,
 	}
 
 	if (!thread && !pending_async)
-		thread = binder_select_thread_ilocked(proc);
+		thread = oneway ? binder_select_thread_ilocked(proc) :
+			binder_select_thread_affine_ilocked(proc);
 
 	if (thread) {
 		binder_transaction_priority(thread->task, t, node_prio,
@@ -2972,8 +3198,10 @@ static int binder_proc_transaction(struct binder_transaction *t,
 		binder_enqueue_work_ilocked(&t->work, &node->async_todo);
 	}
 
-	if (!pending_async)
+	if (!pending_async) {
+		binder_lat_txn_woken(t);
 		binder_wakeup_thread_ilocked(proc, thread, !oneway /* sync */);
+	}
 
 	proc->outstanding_txns++;
 	binder_inner_proc_unlock(proc);
@@ -3050,6 +3278,8 @@ static void binder_transaction(struct binder_proc *proc,
 	int t_debug_id = atomic_inc_return(&binder_last_id);
 	char *secctx = NULL;
 	u32 secctx_sz = 0;
+	u64 lat_start_ns = binder_lat_clock();
+	u64 lat_alloc_ns;
 
 	e = binder_transaction_log_add(&binder_transaction_log);
 	e->debug_id = t_debug_id;
@@ -3269,6 +3499,8 @@ static void binder_transaction(struct binder_proc *proc,
 	t->to_thread = target_thread;
 	t->code = tr->code;
 	t->flags = tr->flags;
+	if (!reply)
+		binder_lat_txn_start(t, target_proc, target_node, lat_start_ns);
 	if (!(t->flags & TF_ONE_WAY) &&
 	    binder_supported_policy(current->policy)) {
 		/* Inherit supported policies for synchronous transactions */
@@ -3323,9 +3555,11 @@ static void binder_transaction(struct binder_proc *proc,
 
 	trace_binder_transaction(reply, t, target_node);
 
+	lat_alloc_ns = binder_lat_clock();
 	t->buffer = binder_alloc_new_buf(&target_proc->alloc, tr->data_size,
 		tr->offsets_size, extra_buffers_size,
 		!reply && (t->flags & TF_ONE_WAY), current->tgid);
+	binder_lat_txn_alloc(reply ? in_reply_to : t, lat_alloc_ns);
 	if (IS_ERR(t->buffer)) {
 		/*
 		 * -ESRCH indicates VMA cleared. The target is dying.
@@ -3614,6 +3848,7 @@ static void binder_transaction(struct binder_proc *proc,
 		binder_inner_proc_unlock(target_proc);
 		wake_up_interruptible_sync(&target_thread->wait);
 		binder_restore_priority(current, in_reply_to->saved_priority);
+		binder_lat_txn_replied(in_reply_to);
 		binder_free_transaction(in_reply_to);
 	} else if (!(t->flags & TF_ONE_WAY)) {
 		BUG_ON(t->buffer->async_transaction != 0);
@@ -4370,6 +4605,7 @@ static int binder_thread_read(struct binder_proc *proc,
 		case BINDER_WORK_TRANSACTION: {
 			binder_inner_proc_unlock(proc);
 			t = container_of(w, struct binder_transaction, work);
+			binder_lat_txn_dequeued(t);
 		} break;
 		case BINDER_WORK_RETURN_ERROR: {
 			struct binder_error *e = container_of(
@@ -5380,6 +5616,18 @@ static long binder_ioctl(struct file *filp, unsigned int cmd, unsigned long arg)
 		binder_inner_proc_unlock(proc);
 		break;
 	}
+	case BINDER_SET_WARM_PAGES: {
+		uint32_t nr_pages;
+
+		if (copy_from_user(&nr_pages, ubuf, sizeof(nr_pages))) {
+			ret = -EFAULT;
+			goto err;
+		}
+		ret = binder_alloc_set_warm_pages(&proc->alloc, nr_pages);
+		if (ret)
+			goto err;
+		break;
+	}
 	default:
 		ret = -EINVAL;
 		goto err;
@@ -6117,6 +6365,12 @@ static void print_binder_stats(struct seq_file *m, const char *prefix,
 				created - deleted,
 				created);
 	}
+
+	if (atomic_read(&stats->sync_wake_local) ||
+	    atomic_read(&stats->sync_wake_remote))
+		seq_printf(m, "%ssync wakeups: same cluster %d other cluster %d\n",
+			   prefix, atomic_read(&stats->sync_wake_local),
+			   atomic_read(&stats->sync_wake_remote));
 }
 
 static void print_binder_proc_stats(struct seq_file *m,
@@ -6170,6 +6424,8 @@ static void print_binder_proc_stats(struct seq_file *m,
 	seq_printf(m, "  buffers: %d\n", count);
 
 	binder_alloc_print_pages(m, &proc->alloc);
+	binder_alloc_print_free(m, &proc->alloc);
+	binder_alloc_print_async(m, &proc->alloc);
 
 	count = 0;
 	binder_inner_proc_lock(proc);
@@ -6316,6 +6572,78 @@ static int binder_transaction_log_show(struct seq_file *m, void *unused)
 	return 0;
 }
 
+#ifdef CONFIG_ANDROID_BINDER_LATENCY_HIST
+static int binder_latency_show(struct seq_file *m, void *unused)
+{
+	struct binder_lat_hist *h;
+	int i, phase, bucket;
+
+	BUILD_BUG_ON(ARRAY_SIZE(binder_lat_phase_strings) !=
+		     BINDER_LAT_PHASE_COUNT);
+	seq_printf(m, "binder latency (us, log2 buckets, dropped %d):\n",
+		   atomic_read(&binder_lat_dropped));
+	for (i = 0; i < BINDER_LAT_ENTRIES; i++) {
+		u64 key;
+
+		h = &binder_lat_hists[i];
+		key = READ_ONCE(h->key);
+		if (!key)
+			continue;
+		seq_printf(m, "node %u code %u proc %d\n",
+			   (u32)(key >> 32), (u32)key, READ_ONCE(h->pid));
+		for (phase = 0; phase < BINDER_LAT_PHASE_COUNT; phase++) {
+			unsigned int count = 0;
+
+			for (bucket = 0; bucket < BINDER_LAT_BUCKETS; bucket++)
+				count += atomic_read(&h->buckets[phase][bucket]);
+			if (!count)
+				continue;
+			seq_printf(m, "  %s: count %u avg %llu:",
+				   binder_lat_phase_strings[phase], count,
+				   div_u64(atomic64_read(&h->sum_us[phase]),
+					   count));
+			for (bucket = 0; bucket < BINDER_LAT_BUCKETS; bucket++)
+				seq_printf(m, " %d",
+					   atomic_read(&h->buckets[phase][bucket]));
+			seq_puts(m, "\n");
+		}
+	}
+	return 0;
+}
+
+static int binder_latency_open(struct inode *inode, struct file *file)
+{
+	return single_open(file, binder_latency_show, inode->i_private);
+}
+
+/* Any write resets the table so that stale nodes do not pin slots */
+static ssize_t binder_latency_write(struct file *file,
+				    const char __user *ubuf,
+				    size_t count, loff_t *ppos)
+{
+	int i;
+
+	for (i = 0; i < BINDER_LAT_ENTRIES; i++) {
+		struct binder_lat_hist *h = &binder_lat_hists[i];
+
+		WRITE_ONCE(h->key, 0);
+		memset(h->sum_us, 0, sizeof(h->sum_us));
+		memset(h->buckets, 0, sizeof(h->buckets));
+	}
+	atomic_set(&binder_lat_dropped, 0);
+	return count;
+}
+
+static const struct file_operations binder_latency_fops = {
+	.owner = THIS_MODULE,
+	.open = binder_latency_open,
+	.read = seq_read,
+	.write = binder_latency_write,
+	.llseek = seq_lseek,
+	.release = single_release,
+};
+#endif
+
 static const struct file_operations binder_fops = {
 	.owner = THIS_MODULE,
 	.poll = binder_poll,
@@ -6405,6 +6733,13 @@ static int __init binder_init(void)
 				    binder_debugfs_dir_entry_root,
 				    &binder_transaction_log_failed,
 				    &binder_transaction_log_fops);
+#ifdef CONFIG_ANDROID_BINDER_LATENCY_HIST
+		debugfs_create_file("latency",
+				    0644,
+				    binder_debugfs_dir_entry_root,
+				    NULL,
+				    &binder_latency_fops);
+#endif
 	}
 
 	/*
@@ -18,7 +18,9 @@
 #define pr_fmt(fmt) KBUILD_MODNAME ": " fmt
 
 #include <asm/cacheflush.h>
+#include <linux/bitops.h>
 #include <linux/list.h>
+#include <linux/log2.h>
 #include <linux/mm.h>
 #include <linux/module.h>
 #include <linux/rtmutex.h>
@@ -73,6 +75,17 @@ static size_t binder_alloc_buffer_size(struct binder_alloc *alloc,
 	return binder_buffer_next(buffer)->user_data - buffer->user_data;
 }
 
+/*
+ * Size class of a small free buffer: class n holds free buffers of at
+ * least 1 << (n + BINDER_ALLOC_SMALL_MIN_SHIFT) bytes and less than twice
+ * that. Buffer sizes are always multiples of sizeof(void *), so @size is
+ * never below 1 << BINDER_ALLOC_SMALL_MIN_SHIFT.
+ */
+static int binder_alloc_size_class(size_t size)
+{
+	return ilog2(size) - BINDER_ALLOC_SMALL_MIN_SHIFT;
+}
+
 static void binder_insert_free_buffer(struct binder_alloc *alloc,
 				      struct binder_buffer *new_buffer)
 {
@@ -90,6 +103,16 @@ static void binder_insert_free_buffer(struct binder_alloc *alloc,
 		     "%d: add free buffer, size %zd, at %pK\n",
 		      alloc->pid, new_buffer_size, new_buffer);
 
+	if (new_buffer_size < BINDER_ALLOC_SMALL_MAX) {
+		int class = binder_alloc_size_class(new_buffer_size);
+
+		new_buffer->free_list = 1;
+		list_add(&new_buffer->free_entry, &alloc->free_lists[class]);
+		__set_bit(class, &alloc->free_lists_mask);
+		return;
+	}
+	new_buffer->free_list = 0;
+
 	while (*p) {
 		parent = *p;
 		buffer = rb_entry(parent, struct binder_buffer, rb_node);
@@ -106,6 +129,148 @@ static void binder_insert_free_buffer(struct binder_alloc *alloc,
 	rb_insert_color(&new_buffer->rb_node, &alloc->free_buffers);
 }
 
+/*
+ * The size of a free buffer must not change while it is on a free list
+ * or in the free_buffers tree, so callers remove it before splitting it
+ * or merging its successor into it.
+ */
+static void binder_remove_free_buffer(struct binder_alloc *alloc,
+				      struct binder_buffer *buffer)
+{
+	int class;
+
+	BUG_ON(!buffer->free);
+
+	if (!buffer->free_list) {
+		rb_erase(&buffer->rb_node, &alloc->free_buffers);
+		return;
+	}
+
+	class = binder_alloc_size_class(binder_alloc_buffer_size(alloc, buffer));
+	list_del(&buffer->free_entry);
+	if (list_empty(&alloc->free_lists[class]))
+		__clear_bit(class, &alloc->free_lists_mask);
+	buffer->free_list = 0;
+}
+
+/**
+ * binder_alloc_find_free_buffer() - find a free buffer of at least @size
+ * @alloc:	binder_alloc for this proc
+ * @size:	requested size in bytes
+ *
+ * Small requests are served in O(1) from the first non-empty size class
+ * whose buffers are all large enough. If none is available the rb tree
+ * is searched for a best fit, and as a last resort the size class that
+ * @size itself falls into is scanned.
+ *
+ * Return:	a free buffer of at least @size bytes or NULL
+ */
+static struct binder_buffer *binder_alloc_find_free_buffer(
+		struct binder_alloc *alloc, size_t size)
+{
+	struct rb_node *n = alloc->free_buffers.rb_node;
+	struct rb_node *best_fit = NULL;
+	struct binder_buffer *buffer;
+	size_t buffer_size;
+	int class;
+
+	if (size < BINDER_ALLOC_SMALL_MAX) {
+		/* an exact or near fit at the head of our own class */
+		class = binder_alloc_size_class(size);
+		buffer = list_first_entry_or_null(&alloc->free_lists[class],
+						  struct binder_buffer,
+						  free_entry);
+		if (buffer && binder_alloc_buffer_size(alloc, buffer) >= size)
+			goto found_in_list;
+
+		class = find_next_bit(&alloc->free_lists_mask,
+				      BINDER_ALLOC_SMALL_CLASSES,
+				      order_base_2(size) -
+				      BINDER_ALLOC_SMALL_MIN_SHIFT);
+		if (class < BINDER_ALLOC_SMALL_CLASSES) {
+			buffer = list_first_entry(&alloc->free_lists[class],
+						  struct binder_buffer,
+						  free_entry);
+			goto found_in_list;
+		}
+	}
+
+	while (n) {
+		buffer = rb_entry(n, struct binder_buffer, rb_node);
+		BUG_ON(!buffer->free);
+		buffer_size = binder_alloc_buffer_size(alloc, buffer);
+
+		if (size < buffer_size) {
+			best_fit = n;
+			n = n->rb_left;
+		} else if (size > buffer_size)
+			n = n->rb_right;
+		else {
+			best_fit = n;
+			break;
+		}
+	}
+	if (best_fit) {
+		alloc->free_tree_hits++;
+		return rb_entry(best_fit, struct binder_buffer, rb_node);
+	}
+
+	if (size < BINDER_ALLOC_SMALL_MAX) {
+		class = binder_alloc_size_class(size);
+		list_for_each_entry(buffer, &alloc->free_lists[class],
+				    free_entry) {
+			if (binder_alloc_buffer_size(alloc, buffer) >= size)
+				goto found_in_list;
+		}
+	}
+	return NULL;
+
+found_in_list:
+	BUG_ON(!buffer->free);
+	alloc->free_list_hits++;
+	return buffer;
+}
+
+/**
+ * binder_alloc_free_space_locked() - summarize free buffers
+ * @alloc:	binder_alloc for this proc
+ * @count:	returns number of free buffers
+ * @small:	returns number of free buffers on the size class lists
+ * @total:	returns total free bytes
+ * @largest:	returns size of the largest free buffer
+ */
+static void binder_alloc_free_space_locked(struct binder_alloc *alloc,
+					   size_t *count, size_t *small,
+					   size_t *total, size_t *largest)
+{
+	struct binder_buffer *buffer;
+	struct rb_node *n;
+	size_t buffer_size;
+	int class;
+
+	*count = *small = *total = *largest = 0;
+
+	for (n = rb_first(&alloc->free_buffers); n != NULL; n = rb_next(n)) {
+		buffer = rb_entry(n, struct binder_buffer, rb_node);
+		buffer_size = binder_alloc_buffer_size(alloc, buffer);
+		(*count)++;
+		*total += buffer_size;
+		if (buffer_size > *largest)
+			*largest = buffer_size;
+	}
+	for (class = 0; class < BINDER_ALLOC_SMALL_CLASSES; class++) {
+		list_for_each_entry(buffer, &alloc->free_lists[class],
+				    free_entry) {
+			buffer_size = binder_alloc_buffer_size(alloc, buffer);
+			(*count)++;
+			(*small)++;
+			*total += buffer_size;
+			if (buffer_size > *largest)
+				*largest = buffer_size;
+		}
+	}
+}
+
 static void binder_insert_allocated_buffer_locked(
 		struct binder_alloc *alloc, struct binder_buffer *new_buffer)
 {
@@ -186,6 +351,63 @@ struct binder_buffer *binder_alloc_prepare_to_free(struct binder_alloc *alloc,
 	return buffer;
 }
 
+/*
+ * Pages for a range are allocated up to BINDER_ALLOC_BULK_PAGES at a time,
+ * preferring a single high order allocation split into order-0 pages.
+ */
+#define BINDER_ALLOC_BULK_PAGES 16
+
+struct binder_page_batch {
+	struct page *pages[BINDER_ALLOC_BULK_PAGES];
+	int nr;
+	int next;
+};
+
+static void binder_page_batch_fill(struct binder_page_batch *batch, int nr)
+{
+	gfp_t gfp = GFP_KERNEL | __GFP_HIGHMEM | __GFP_ZERO;
+	struct page *page;
+	int order, i;
+
+	nr = clamp(nr, 1, BINDER_ALLOC_BULK_PAGES);
+	batch->nr = 0;
+	batch->next = 0;
+
+	order = ilog2(nr);
+	if (order) {
+		page = alloc_pages(gfp | __GFP_NORETRY | __GFP_NOWARN, order);
+		if (page) {
+			split_page(page, order);
+			for (i = 0; i < (1 << order); i++)
+				batch->pages[batch->nr++] = page + i;
+			return;
+		}
+	}
+
+	while (batch->nr < nr) {
+		page = alloc_page(gfp);
+		if (!page)
+			break;
+		batch->pages[batch->nr++] = page;
+	}
+}
+
+static struct page *binder_page_batch_get(struct binder_page_batch *batch,
+					  int wanted)
+{
+	if (batch->next == batch->nr)
+		binder_page_batch_fill(batch, wanted);
+	if (batch->next == batch->nr)
+		return NULL;
+	return batch->pages[batch->next++];
+}
+
+static void binder_page_batch_release(struct binder_page_batch *batch)
+{
+	while (batch->next < batch->nr)
+		__free_page(batch->pages[batch->next++]);
+}
+
 static int binder_update_page_range(struct binder_alloc *alloc, int allocate,
 				    void __user *start, void __user *end)
 {
@@ -194,6 +416,8 @@ static int binder_update_page_range(struct binder_alloc *alloc, int allocate,
 	struct binder_lru_page *page;
 	struct vm_area_struct *vma = NULL;
 	struct mm_struct *mm = NULL;
+	struct binder_page_batch batch = { .nr = 0, .next = 0 };
+	int missing = 0;
 	bool need_mm = false;
 
 	binder_alloc_debug(BINDER_DEBUG_BUFFER_ALLOC,
@@ -210,11 +434,10 @@ static int binder_update_page_range(struct binder_alloc *alloc, int allocate,
 
 	for (page_addr = start; page_addr < end; page_addr += PAGE_SIZE) {
 		page = &alloc->pages[(page_addr - alloc->buffer) / PAGE_SIZE];
-		if (!page->page_ptr) {
-			need_mm = true;
-			break;
-		}
+		if (!page->page_ptr)
+			missing++;
 	}
+	need_mm = missing > 0;
 
 	if (need_mm && mmget_not_zero(alloc->vma_vm_mm))
 		mm = alloc->vma_vm_mm;
@@ -247,8 +470,13 @@ static int binder_update_page_range(struct binder_alloc *alloc, int allocate,
 		if (page->page_ptr) {
 			trace_binder_alloc_lru_start(alloc, index);
 
-			on_lru = list_lru_del(&binder_alloc_lru, &page->lru);
-			WARN_ON(!on_lru);
+			if (page->parked) {
+				page->parked = false;
+			} else {
+				on_lru = list_lru_del(&binder_alloc_lru,
+						      &page->lru);
+				WARN_ON(!on_lru);
+			}
 
 			trace_binder_alloc_lru_end(alloc, index);
 			continue;
@@ -258,9 +486,7 @@ static int binder_update_page_range(struct binder_alloc *alloc, int allocate,
 			goto err_page_ptr_cleared;
 
 		trace_binder_alloc_page_start(alloc, index);
-		page->page_ptr = alloc_page(GFP_KERNEL |
-					    __GFP_HIGHMEM |
-					    __GFP_ZERO);
+		page->page_ptr = binder_page_batch_get(&batch, missing--);
 		if (!page->page_ptr) {
 			pr_err("%d: binder_alloc_buf failed for page at %pK\n",
 				alloc->pid, page_addr);
@@ -287,6 +513,7 @@ static int binder_update_page_range(struct binder_alloc *alloc, int allocate,
 		up_read(&mm->mmap_sem);
 		mmput(mm);
 	}
+	binder_page_batch_release(&batch);
 	return 0;
 
 free_range:
@@ -300,8 +527,13 @@ static int binder_update_page_range(struct binder_alloc *alloc, int allocate,
 
 		trace_binder_free_lru_start(alloc, index);
 
-		ret = list_lru_add(&binder_alloc_lru, &page->lru);
-		WARN_ON(!ret);
+		if (index < alloc->warm_pages) {
+			/* keep warm pages resident and away from the shrinker */
+			page->parked = true;
+		} else {
+			ret = list_lru_add(&binder_alloc_lru, &page->lru);
+			WARN_ON(!ret);
+		}
 
 		trace_binder_free_lru_end(alloc, index);
 		continue;
@@ -318,33 +550,222 @@ static int binder_update_page_range(struct binder_alloc *alloc, int allocate,
 		up_read(&mm->mmap_sem);
 		mmput(mm);
 	}
+	binder_page_batch_release(&batch);
 	return vma ? -ENOMEM : -ESRCH;
 }
 
+/**
+ * binder_alloc_set_warm_pages() - set the number of pages kept resident
+ * @alloc:	binder_alloc for this proc
+ * @nr_pages:	number of pages at the start of the buffer space to keep warm
+ *
+ * Pages below the warm watermark are populated right away and are not
+ * handed to the shrinker when the buffers using them are freed, so that
+ * hot services do not allocate and map pages in the transaction path.
+ * Pages above a lowered watermark are returned to the shrinker LRU.
+ *
+ * Return:	0 on success or a negative errno
+ */
+int binder_alloc_set_warm_pages(struct binder_alloc *alloc, size_t nr_pages)
+{
+	struct binder_lru_page *page;
+	size_t i, run, old;
+	int ret = 0;
+
+	mutex_lock(&alloc->mutex);
+	if (!alloc->vma) {
+		ret = -ESRCH;
+		goto out;
+	}
+	nr_pages = min_t(size_t, nr_pages, alloc->buffer_size / PAGE_SIZE);
+	old = alloc->warm_pages;
+	alloc->warm_pages = nr_pages;
+
+	for (i = nr_pages; i < old; i++) {
+		page = &alloc->pages[i];
+		if (page->parked) {
+			page->parked = false;
+			list_lru_add(&binder_alloc_lru, &page->lru);
+		}
+	}
+
+	for (i = old; i < nr_pages; i = run) {
+		page = &alloc->pages[i];
+		run = i + 1;
+		if (page->page_ptr) {
+			if (list_lru_del(&binder_alloc_lru, &page->lru))
+				page->parked = true;
+			continue;
+		}
+		while (run < nr_pages && !alloc->pages[run].page_ptr)
+			run++;
+		/* a failed populate must put its pages back on the LRU */
+		alloc->warm_pages = i;
+		ret = binder_update_page_range(alloc, 1,
+					       alloc->buffer + i * PAGE_SIZE,
+					       alloc->buffer + run * PAGE_SIZE);
+		if (ret)
+			goto out;
+		for (; i < run; i++)
+			alloc->pages[i].parked = true;
+	}
+	alloc->warm_pages = nr_pages;
+out:
+	mutex_unlock(&alloc->mutex);
+	return ret;
+}
+
+/*
+ * The last 1/BINDER_ASYNC_RESERVE_DIV of the async space can only be taken
+ * by senders below their fair share, so that a single process flooding a
+ * service with oneway transactions cannot lock every other sender out.
+ */
+#define BINDER_ASYNC_RESERVE_DIV	8
+
+static struct binder_async_sender *
+binder_async_sender_find(struct binder_alloc *alloc, int pid)
+{
+	struct rb_node *n = alloc->async_senders.rb_node;
+	struct binder_async_sender *sender;
+
+	while (n) {
+		sender = rb_entry(n, struct binder_async_sender, rb_node);
+		if (pid < sender->pid)
+			n = n->rb_left;
+		else if (pid > sender->pid)
+			n = n->rb_right;
+		else
+			return sender;
+	}
+	return NULL;
+}
+
+static struct binder_async_sender *
+binder_async_sender_get(struct binder_alloc *alloc, int pid)
+{
+	struct rb_node **p = &alloc->async_senders.rb_node;
+	struct rb_node *parent = NULL;
+	struct binder_async_sender *sender;
+
+	while (*p) {
+		parent = *p;
+		sender = rb_entry(parent, struct binder_async_sender, rb_node);
+		if (pid < sender->pid)
+			p = &parent->rb_left;
+		else if (pid > sender->pid)
+			p = &parent->rb_right;
+		else
+			return sender;
+	}
+
+	sender = kzalloc(sizeof(*sender), GFP_KERNEL);
+	if (!sender)
+		return NULL;
+	sender->pid = pid;
+	rb_link_node(&sender->rb_node, parent, p);
+	rb_insert_color(&sender->rb_node, &alloc->async_senders);
+	alloc->nr_async_senders++;
+	return sender;
+}
+
+static size_t binder_async_fair_share(struct binder_alloc *alloc,
+				      struct binder_async_sender *sender)
+{
+	size_t nr = alloc->nr_async_senders + (sender ? 0 : 1);
+
+	return alloc->buffer_size / 2 / nr;
+}
+
+/*
+ * Returns 0 if @pid may take @size bytes of async space, -ENOSPC otherwise.
+ */
+static int binder_async_admit_locked(struct binder_alloc *alloc, int pid,
+				     size_t size)
+{
+	struct binder_async_sender *sender;
+	size_t reserve = alloc->buffer_size / 2 / BINDER_ASYNC_RESERVE_DIV;
+
+	sender = binder_async_sender_find(alloc, pid);
+
+	if (alloc->free_async_space < size) {
+		binder_alloc_debug(BINDER_DEBUG_BUFFER_ALLOC,
+			     "%d: binder_alloc_buf size %zd failed, no async space left\n",
+			      alloc->pid, size);
+		alloc->async_full_stalls++;
+		goto stall;
+	}
+
+	if (sender && alloc->free_async_space - size < reserve &&
+	    sender->size + size > binder_async_fair_share(alloc, sender)) {
+		binder_alloc_debug(BINDER_DEBUG_USER_ERROR,
+			     "%d: pid %d over its async share, %zd bytes in %zd buffers\n",
+			      alloc->pid, pid, sender->size, sender->buffers);
+		alloc->async_share_stalls++;
+		goto stall;
+	}
+
+	return 0;
+
+stall:
+	if (sender)
+		sender->stalls++;
+	return -ENOSPC;
+}
+
+static void binder_async_charge_locked(struct binder_alloc *alloc,
+				       struct binder_buffer *buffer,
+				       size_t size)
+{
+	struct binder_async_sender *sender;
+
+	sender = binder_async_sender_get(alloc, buffer->pid);
+	if (!sender)
+		return;
+	sender->size += size;
+	sender->buffers++;
+	buffer->async_charged = 1;
+}
+
+static void binder_async_uncharge_locked(struct binder_alloc *alloc,
+					 struct binder_buffer *buffer,
+					 size_t size)
+{
+	struct binder_async_sender *sender;
+
+	if (!buffer->async_charged)
+		return;
+	buffer->async_charged = 0;
+
+	sender = binder_async_sender_find(alloc, buffer->pid);
+	if (WARN_ON(!sender))
+		return;
+	sender->size -= size;
+	sender->buffers--;
+	if (sender->size <= binder_async_fair_share(alloc, sender))
+		sender->over_share = false;
+	if (!sender->buffers) {
+		rb_erase(&sender->rb_node, &alloc->async_senders);
+		alloc->nr_async_senders--;
+		kfree(sender);
+	}
+}
+
 static bool debug_low_async_space_locked(struct binder_alloc *alloc, int pid)
 {
 	/*
-	 * Find the amount and size of buffers allocated by the current caller;
+	 * Check the amount and size of buffers held by the current caller;
 	 * The idea is that once we cross the threshold, whoever is responsible
 	 * for the low async space is likely to try to send another async txn,
-	 * and at some point we'll catch them in the act. This is more efficient
-	 * than keeping a map per pid.
+	 * and at some point we'll catch them in the act.
 	 */
-	struct rb_node *n = alloc->free_buffers.rb_node;
-	struct binder_buffer *buffer;
+	struct binder_async_sender *sender;
 	size_t total_alloc_size = 0;
 	size_t num_buffers = 0;
 
-	for (n = rb_first(&alloc->allocated_buffers); n != NULL;
-		 n = rb_next(n)) {
-		buffer = rb_entry(n, struct binder_buffer, rb_node);
-		if (buffer->pid != pid)
-			continue;
-		if (!buffer->async_transaction)
-			continue;
-		total_alloc_size += binder_alloc_buffer_size(alloc, buffer)
-			+ sizeof(struct binder_buffer);
-		num_buffers++;
+	sender = binder_async_sender_find(alloc, pid);
+	if (sender) {
+		total_alloc_size = sender->size;
+		num_buffers = sender->buffers;
 	}
 
 	/*
@@ -364,6 +785,24 @@ static bool debug_low_async_space_locked(struct binder_alloc *alloc, int pid)
 	return false;
 }
 
+/*
+ * A sender that grows past its fair share is told so once, through the
+ * oneway spam suspect flag, so that it can back off before it stalls.
+ */
+static bool binder_async_over_share_locked(struct binder_alloc *alloc,
+					   int pid)
+{
+	struct binder_async_sender *sender;
+
+	sender = binder_async_sender_find(alloc, pid);
+	if (!sender || sender->over_share || alloc->nr_async_senders < 2 ||
+	    sender->size <= binder_async_fair_share(alloc, sender))
+		return false;
+
+	sender->over_share = true;
+	return true;
+}
+
 static struct binder_buffer *binder_alloc_new_buf_locked(
 				struct binder_alloc *alloc,
 				size_t data_size,
@@ -372,13 +811,12 @@ static struct binder_buffer *binder_alloc_new_buf_locked(
 				int is_async,
 				int pid)
 {
-	struct rb_node *n = alloc->free_buffers.rb_node;
+	struct rb_node *n;
 	struct binder_buffer *buffer;
 	size_t buffer_size;
-	struct rb_node *best_fit = NULL;
 	void __user *has_page_addr;
 	void __user *end_page_addr;
-	size_t size, data_offsets_size;
+	size_t size, data_offsets_size, async_size;
 	int ret;
 
 	if (alloc->vma == NULL) {
@@ -404,39 +842,24 @@ static struct binder_buffer *binder_alloc_new_buf_locked(
 				alloc->pid, extra_buffers_size);
 		return ERR_PTR(-EINVAL);
 	}
-	if (is_async &&
-	    alloc->free_async_space < size + sizeof(struct binder_buffer)) {
-		binder_alloc_debug(BINDER_DEBUG_BUFFER_ALLOC,
-			     "%d: binder_alloc_buf size %zd failed, no async space left\n",
-			      alloc->pid, size);
-		return ERR_PTR(-ENOSPC);
+	async_size = size + sizeof(struct binder_buffer);
+	if (is_async) {
+		ret = binder_async_admit_locked(alloc, pid, async_size);
+		if (ret)
+			return ERR_PTR(ret);
 	}
 
 	/* Pad 0-size buffers so they get assigned unique addresses */
 	size = max(size, sizeof(void *));
 
-	while (n) {
-		buffer = rb_entry(n, struct binder_buffer, rb_node);
-		BUG_ON(!buffer->free);
-		buffer_size = binder_alloc_buffer_size(alloc, buffer);
-
-		if (size < buffer_size) {
-			best_fit = n;
-			n = n->rb_left;
-		} else if (size > buffer_size)
-			n = n->rb_right;
-		else {
-			best_fit = n;
-			break;
-		}
-	}
-	if (best_fit == NULL) {
+	buffer = binder_alloc_find_free_buffer(alloc, size);
+	if (buffer == NULL) {
 		size_t allocated_buffers = 0;
 		size_t largest_alloc_size = 0;
 		size_t total_alloc_size = 0;
-		size_t free_buffers = 0;
-		size_t largest_free_size = 0;
-		size_t total_free_size = 0;
+		size_t free_buffers, small_free_buffers;
+		size_t largest_free_size;
+		size_t total_free_size;
 
 		for (n = rb_first(&alloc->allocated_buffers); n != NULL;
 		     n = rb_next(n)) {
@@ -447,15 +870,12 @@ static struct binder_buffer *binder_alloc_new_buf_locked(
 			if (buffer_size > largest_alloc_size)
 				largest_alloc_size = buffer_size;
 		}
-		for (n = rb_first(&alloc->free_buffers); n != NULL;
-		     n = rb_next(n)) {
-			buffer = rb_entry(n, struct binder_buffer, rb_node);
-			buffer_size = binder_alloc_buffer_size(alloc, buffer);
-			free_buffers++;
-			total_free_size += buffer_size;
-			if (buffer_size > largest_free_size)
-				largest_free_size = buffer_size;
-		}
+		binder_alloc_free_space_locked(alloc, &free_buffers,
+					       &small_free_buffers,
+					       &total_free_size,
+					       &largest_free_size);
+		if (total_free_size >= size)
+			alloc->frag_failures++;
 		binder_alloc_debug(BINDER_DEBUG_USER_ERROR,
 				   "%d: binder_alloc_buf size %zd failed, no address space\n",
 				   alloc->pid, size);
@@ -466,10 +886,7 @@ static struct binder_buffer *binder_alloc_new_buf_locked(
 				   free_buffers, largest_free_size);
 		return ERR_PTR(-ENOSPC);
 	}
-	if (n == NULL) {
-		buffer = rb_entry(best_fit, struct binder_buffer, rb_node);
-		buffer_size = binder_alloc_buffer_size(alloc, buffer);
-	}
+	buffer_size = binder_alloc_buffer_size(alloc, buffer);
 
 	binder_alloc_debug(BINDER_DEBUG_BUFFER_ALLOC,
 		     "%d: binder_alloc_buf size %zd got buffer %pK size %zd\n",
@@ -477,7 +894,6 @@ static struct binder_buffer *binder_alloc_new_buf_locked(
 
 	has_page_addr = (void __user *)
 		(((uintptr_t)buffer->user_data + buffer_size) & PAGE_MASK);
-	WARN_ON(n && buffer_size != size);
 	end_page_addr =
 		(void __user *)PAGE_ALIGN((uintptr_t)buffer->user_data + size);
 	if (end_page_addr > has_page_addr)
@@ -496,13 +912,15 @@ static struct binder_buffer *binder_alloc_new_buf_locked(
 			       __func__, alloc->pid);
 			goto err_alloc_buf_struct_failed;
 		}
+		binder_remove_free_buffer(alloc, buffer);
 		new_buffer->user_data = (u8 __user *)buffer->user_data + size;
 		list_add(&new_buffer->entry, &buffer->entry);
 		new_buffer->free = 1;
 		binder_insert_free_buffer(alloc, new_buffer);
+	} else {
+		binder_remove_free_buffer(alloc, buffer);
 	}
 
-	rb_erase(best_fit, &alloc->free_buffers);
 	buffer->free = 0;
 	buffer->allow_user_free = 0;
 	binder_insert_allocated_buffer_locked(alloc, buffer);
@@ -517,6 +935,7 @@ static struct binder_buffer *binder_alloc_new_buf_locked(
 	buffer->oneway_spam_suspect = false;
 	if (is_async) {
 		alloc->free_async_space -= size + sizeof(struct binder_buffer);
+		binder_async_charge_locked(alloc, buffer, async_size);
 		binder_alloc_debug(BINDER_DEBUG_BUFFER_ALLOC_ASYNC,
 			     "%d: binder_alloc_buf size %zd async free %zd\n",
 			      alloc->pid, size, alloc->free_async_space);
@@ -530,6 +949,8 @@ static struct binder_buffer *binder_alloc_new_buf_locked(
 		} else {
 			alloc->oneway_spam_detected = false;
 		}
+		if (binder_async_over_share_locked(alloc, pid))
+			buffer->oneway_spam_suspect = true;
 	}
 	return buffer;
 
@@ -654,6 +1075,8 @@ static void binder_free_buf_locked(struct binder_alloc *alloc,
 
 	if (buffer->async_transaction) {
 		alloc->free_async_space += size + sizeof(struct binder_buffer);
+		binder_async_uncharge_locked(alloc, buffer,
+					     size + sizeof(struct binder_buffer));
 
 		binder_alloc_debug(BINDER_DEBUG_BUFFER_ALLOC_ASYNC,
 			     "%d: binder_free_buf size %zd async free %zd\n",
@@ -671,7 +1094,7 @@ static void binder_free_buf_locked(struct binder_alloc *alloc,
 		struct binder_buffer *next = binder_buffer_next(buffer);
 
 		if (next->free) {
-			rb_erase(&next->rb_node, &alloc->free_buffers);
+			binder_remove_free_buffer(alloc, next);
 			binder_delete_free_buffer(alloc, next);
 		}
 	}
@@ -679,8 +1102,8 @@ static void binder_free_buf_locked(struct binder_alloc *alloc,
 		struct binder_buffer *prev = binder_buffer_prev(buffer);
 
 		if (prev->free) {
+			binder_remove_free_buffer(alloc, prev);
 			binder_delete_free_buffer(alloc, buffer);
-			rb_erase(&prev->rb_node, &alloc->free_buffers);
 			buffer = prev;
 		}
 	}
@@ -901,12 +1324,15 @@ void binder_alloc_print_pages(struct seq_file *m,
 	int active = 0;
 	int lru = 0;
 	int free = 0;
+	int parked = 0;
 
 	mutex_lock(&alloc->mutex);
 	for (i = 0; i < alloc->buffer_size / PAGE_SIZE; i++) {
 		page = &alloc->pages[i];
 		if (!page->page_ptr)
 			free++;
+		else if (page->parked)
+			parked++;
 		else if (list_empty(&page->lru))
 			active++;
 		else
@@ -915,6 +1341,60 @@ void binder_alloc_print_pages(struct seq_file *m,
 	mutex_unlock(&alloc->mutex);
 	seq_printf(m, "  pages: %d:%d:%d\n", active, lru, free);
 	seq_printf(m, "  pages high watermark: %zu\n", alloc->pages_high);
+	if (alloc->warm_pages)
+		seq_printf(m, "  warm pages: %zu parked %d\n",
+			   alloc->warm_pages, parked);
+}
+
+/**
+ * binder_alloc_print_free() - print free space and fragmentation stats
+ * @m:     seq_file for output via seq_printf()
+ * @alloc: binder_alloc for this proc
+ */
+void binder_alloc_print_free(struct seq_file *m,
+			     struct binder_alloc *alloc)
+{
+	size_t count, small, total, largest;
+	size_t list_hits, tree_hits, frag_failures;
+
+	mutex_lock(&alloc->mutex);
+	binder_alloc_free_space_locked(alloc, &count, &small, &total,
+				       &largest);
+	list_hits = alloc->free_list_hits;
+	tree_hits = alloc->free_tree_hits;
+	frag_failures = alloc->frag_failures;
+	mutex_unlock(&alloc->mutex);
+	seq_printf(m, "  free buffers: %zu (small %zu) total %zu largest %zu\n",
+		   count, small, total, largest);
+	seq_printf(m, "  free list hits: %zu tree hits: %zu\n",
+		   list_hits, tree_hits);
+	seq_printf(m, "  fragmentation: %zu%% failures %zu\n",
+		   total ? (total - largest) * 100 / total : 0,
+		   frag_failures);
+}
+
+/**
+ * binder_alloc_print_async() - print async space usage per sender
+ * @m:     seq_file for output via seq_printf()
+ * @alloc: binder_alloc for this proc
+ */
+void binder_alloc_print_async(struct seq_file *m,
+			      struct binder_alloc *alloc)
+{
+	struct binder_async_sender *sender;
+	struct rb_node *n;
+
+	mutex_lock(&alloc->mutex);
+	seq_printf(m, "  async stalls: full %zu share %zu senders %zu\n",
+		   alloc->async_full_stalls, alloc->async_share_stalls,
+		   alloc->nr_async_senders);
+	for (n = rb_first(&alloc->async_senders); n; n = rb_next(n)) {
+		sender = rb_entry(n, struct binder_async_sender, rb_node);
+		seq_printf(m, "    pid %d: %zu bytes in %zu buffers stalls %zu%s\n",
+			   sender->pid, sender->size, sender->buffers,
+			   sender->stalls, sender->over_share ? " over" : "");
+	}
+	mutex_unlock(&alloc->mutex);
 }
 
 /**
@@ -1054,9 +1534,13 @@ static struct shrinker binder_shrinker = {
  */
 void binder_alloc_init(struct binder_alloc *alloc)
 {
+	int i;
+
 	alloc->pid = current->group_leader->pid;
 	mutex_init(&alloc->mutex);
 	INIT_LIST_HEAD(&alloc->buffers);
+	for (i = 0; i < BINDER_ALLOC_SMALL_CLASSES; i++)
+		INIT_LIST_HEAD(&alloc->free_lists[i]);
 }
 
 int binder_alloc_shrinker_init(void)
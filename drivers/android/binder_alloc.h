@@ -32,10 +32,23 @@
 extern struct list_lru binder_alloc_lru;
 struct binder_transaction;
 
+/*
+ * Free buffers smaller than BINDER_ALLOC_SMALL_MAX bytes are kept on
+ * segregated free lists, one per power-of-two size class, so that the
+ * common small transaction can be served without walking the
+ * size-sorted free_buffers rb tree. Larger free buffers stay in the tree.
+ */
+#define BINDER_ALLOC_SMALL_MIN_SHIFT	2
+#define BINDER_ALLOC_SMALL_MAX_SHIFT	12
+#define BINDER_ALLOC_SMALL_MAX		(1UL << BINDER_ALLOC_SMALL_MAX_SHIFT)
+#define BINDER_ALLOC_SMALL_CLASSES	\
+	(BINDER_ALLOC_SMALL_MAX_SHIFT - BINDER_ALLOC_SMALL_MIN_SHIFT)
+
 /**
  * struct binder_buffer - buffer used for binder transactions
  * @entry:              entry alloc->buffers
  * @rb_node:            node for allocated_buffers/free_buffers rb trees
+ * @free_entry:         entry in one of alloc->free_lists (small free buffers)
  * @free:               %true if buffer is free
  * @clear_on_free:      %true if buffer must be zeroed after use
  * @allow_user_free:    %true if user is allowed to free buffer
@@ -43,6 +56,9 @@ struct binder_transaction;
  * @oneway_spam_suspect: %true if total async allocate size just exceed
  * spamming detect threshold
  * @debug_id:           unique ID for debugging
+ * @free_list:          %true if free buffer is on a size class list
+ *                      rather than in the free_buffers rb tree
+ * @async_charged:      %true if the buffer is charged to an async sender
  * @transaction:        pointer to associated struct binder_transaction
  * @target_node:        struct binder_node associated with this buffer
  * @data_size:          size of @transaction data
@@ -55,14 +71,19 @@ struct binder_transaction;
  */
 struct binder_buffer {
 	struct list_head entry; /* free and allocated entries by address */
-	struct rb_node rb_node; /* free entry by size or allocated entry */
-				/* by address */
+	union {
+		struct rb_node rb_node; /* free entry by size or allocated */
+					/* entry by address */
+		struct list_head free_entry; /* small free entry by class */
+	};
 	unsigned free:1;
 	unsigned clear_on_free:1;
 	unsigned allow_user_free:1;
 	unsigned async_transaction:1;
 	unsigned oneway_spam_suspect:1;
 	unsigned debug_id:27;
+	unsigned free_list:1;
+	unsigned async_charged:1;
 
 	struct binder_transaction *transaction;
 
@@ -74,16 +95,38 @@ struct binder_buffer {
 	int    pid;
 };
 
+/**
+ * struct binder_async_sender - async space held by one sending process
+ * @rb_node:            entry in binder_alloc->async_senders, sorted by pid
+ * @pid:                pid of the sender
+ * @size:               async space charged to the sender, including the
+ *                      struct binder_buffer overhead
+ * @buffers:            number of async buffers charged to the sender
+ * @stalls:             oneway transactions of the sender that were refused
+ * @over_share:         %true once the sender was told it is over its share
+ */
+struct binder_async_sender {
+	struct rb_node rb_node;
+	int pid;
+	size_t size;
+	size_t buffers;
+	size_t stalls;
+	bool over_share;
+};
+
 /**
  * struct binder_lru_page - page object used for binder shrinker
  * @page_ptr: pointer to physical page in mmap'd space
  * @lru:      entry in binder_alloc_lru
  * @alloc:    binder_alloc for a proc
+ * @parked:   %true if the page is resident but unused and kept off
+ *            binder_alloc_lru because it is below the warm watermark
  */
 struct binder_lru_page {
 	struct list_head lru;
 	struct page *page_ptr;
 	struct binder_alloc *alloc;
+	bool parked;
 };
 
 /**
@@ -97,6 +140,9 @@ struct binder_lru_page {
  * @buffers:            list of all buffers for this proc
  * @free_buffers:       rb tree of buffers available for allocation
  *                      sorted by size
+ * @free_lists:         lists of small free buffers, one per power-of-two
+ *                      size class
+ * @free_lists_mask:    bitmap of non-empty @free_lists
  * @allocated_buffers:  rb tree of allocated buffers sorted by address
  * @free_async_space:   VA space available for async buffers. This is
  *                      initialized at mmap time to 1/2 the full VA space
@@ -104,8 +150,20 @@ struct binder_lru_page {
  * @buffer_size:        size of address space specified via mmap
  * @pid:                pid for associated binder_proc (invariant after init)
  * @pages_high:         high watermark of offset in @pages
+ * @warm_pages:         number of pages at the start of the address space
+ *                      kept resident instead of being put on the shrinker
+ *                      LRU when unused
  * @oneway_spam_detected: %true if oneway spam detection fired, clear that
  * flag once the async buffer has returned to a healthy state
+ * @free_list_hits:     allocations served from @free_lists
+ * @free_tree_hits:     allocations served from @free_buffers
+ * @frag_failures:      allocations that failed although the total free
+ *                      space would have been large enough
+ * @async_senders:      rb tree of struct binder_async_sender
+ * @nr_async_senders:   number of entries in @async_senders
+ * @async_full_stalls:  async allocations refused for lack of async space
+ * @async_share_stalls: async allocations refused because the sender was
+ *                      over its share and the space left is reserved
  *
  * Bookkeeping structure for per-proc address space management for binder
  * buffers. It is normally initialized during binder_init() and binder_mmap()
@@ -119,6 +177,8 @@ struct binder_alloc {
 	void __user *buffer;
 	struct list_head buffers;
 	struct rb_root free_buffers;
+	struct list_head free_lists[BINDER_ALLOC_SMALL_CLASSES];
+	unsigned long free_lists_mask;
 	struct rb_root allocated_buffers;
 	size_t free_async_space;
 	struct binder_lru_page *pages;
@@ -126,7 +186,15 @@ struct binder_alloc {
 	uint32_t buffer_free;
 	int pid;
 	size_t pages_high;
+	size_t warm_pages;
 	bool oneway_spam_detected;
+	size_t free_list_hits;
+	size_t free_tree_hits;
+	size_t frag_failures;
+	struct rb_root async_senders;
+	size_t nr_async_senders;
+	size_t async_full_stalls;
+	size_t async_share_stalls;
 };
 
 #ifdef CONFIG_ANDROID_BINDER_IPC_SELFTEST
@@ -154,11 +222,17 @@ extern void binder_alloc_free_buf(struct binder_alloc *alloc,
 extern int binder_alloc_mmap_handler(struct binder_alloc *alloc,
 				     struct vm_area_struct *vma);
 extern void binder_alloc_deferred_release(struct binder_alloc *alloc);
+extern int binder_alloc_set_warm_pages(struct binder_alloc *alloc,
+				       size_t nr_pages);
 extern int binder_alloc_get_allocated_count(struct binder_alloc *alloc);
 extern void binder_alloc_print_allocated(struct seq_file *m,
 					 struct binder_alloc *alloc);
 void binder_alloc_print_pages(struct seq_file *m,
 			      struct binder_alloc *alloc);
+void binder_alloc_print_free(struct seq_file *m,
+			     struct binder_alloc *alloc);
+void binder_alloc_print_async(struct seq_file *m,
+			      struct binder_alloc *alloc);
 
 /**
  * binder_alloc_get_free_async_space() - get free space available for async
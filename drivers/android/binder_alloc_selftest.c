@@ -280,6 +280,92 @@ static void binder_selftest_alloc_offset(struct binder_alloc *alloc,
 	}
 }
 
+#define FREE_LIST_BUFFER_NUM 16
+#define FREE_LIST_BUFFER_SIZE 64
+
+static bool binder_selftest_free_space_merged(struct binder_alloc *alloc)
+{
+	struct rb_node *n = rb_first(&alloc->free_buffers);
+	struct binder_buffer *buffer;
+
+	if (alloc->free_lists_mask || !n || rb_next(n))
+		return false;
+	buffer = rb_entry(n, struct binder_buffer, rb_node);
+	return buffer->user_data == alloc->buffer &&
+		list_is_singular(&alloc->buffers);
+}
+
+/**
+ * binder_selftest_free_list() - Test the small buffer size class lists.
+ * @alloc: Pointer to alloc struct.
+ *
+ * Punch small holes into the address space by freeing every other buffer
+ * of a run of small allocations, check that the holes are tracked on the
+ * size class lists and that requests of the same size are served from
+ * them rather than by splitting the large free buffer. Finally check that freeing
+ * everything merges the address space back into a single free buffer.
+ */
+static void binder_selftest_free_list(struct binder_alloc *alloc)
+{
+	struct binder_buffer *buffers[FREE_LIST_BUFFER_NUM];
+	struct binder_buffer *refill[FREE_LIST_BUFFER_NUM / 2];
+	void __user *holes[FREE_LIST_BUFFER_NUM / 2];
+	int i, j;
+
+	for (i = 0; i < FREE_LIST_BUFFER_NUM; i++) {
+		buffers[i] = binder_alloc_new_buf(alloc, FREE_LIST_BUFFER_SIZE,
+						  0, 0, 0, 0);
+		if (IS_ERR(buffers[i])) {
+			pr_err("free list: alloc %d failed\n", i);
+			binder_selftest_failures++;
+			while (--i >= 0)
+				binder_alloc_free_buf(alloc, buffers[i]);
+			return;
+		}
+	}
+
+	for (i = 0; i < FREE_LIST_BUFFER_NUM / 2; i++) {
+		holes[i] = buffers[2 * i]->user_data;
+		binder_alloc_free_buf(alloc, buffers[2 * i]);
+	}
+
+	if (!alloc->free_lists_mask) {
+		pr_err("free list: holes not on size class lists\n");
+		binder_selftest_failures++;
+	}
+
+	for (i = 0; i < FREE_LIST_BUFFER_NUM / 2; i++) {
+		refill[i] = binder_alloc_new_buf(alloc, FREE_LIST_BUFFER_SIZE,
+						 0, 0, 0, 0);
+		if (IS_ERR(refill[i])) {
+			pr_err("free list: refill %d failed\n", i);
+			binder_selftest_failures++;
+			continue;
+		}
+		for (j = 0; j < FREE_LIST_BUFFER_NUM / 2; j++) {
+			if (refill[i]->user_data == holes[j])
+				break;
+		}
+		if (j == FREE_LIST_BUFFER_NUM / 2) {
+			pr_err("free list: refill %d not served from a hole\n",
+			       i);
+			binder_selftest_failures++;
+		}
+	}
+
+	for (i = 0; i < FREE_LIST_BUFFER_NUM / 2; i++) {
+		if (!IS_ERR(refill[i]))
+			binder_alloc_free_buf(alloc, refill[i]);
+		binder_alloc_free_buf(alloc, buffers[2 * i + 1]);
+	}
+
+	if (!binder_selftest_free_space_merged(alloc)) {
+		pr_err("free list: free space not merged\n");
+		binder_selftest_failures++;
+	}
+	binder_selftest_free_page(alloc);
+}
+
 /**
  * binder_selftest_alloc() - Test alloc and free of buffer pages.
  * @alloc: Pointer to alloc struct.
@@ -287,7 +373,8 @@ static void binder_selftest_alloc_offset(struct binder_alloc *alloc,
  * Allocate BUFFER_NUM buffers to cover all page alignment cases,
  * then free them in all orders possible. Check that pages are
  * correctly allocated, put onto lru when buffers are freed, and
- * are freed when binder_alloc_free_page is called.
+ * are freed when binder_alloc_free_page is called. Then exercise the
+ * small buffer size class lists.
  */
 void binder_selftest_alloc(struct binder_alloc *alloc)
 {
@@ -300,6 +387,7 @@ void binder_selftest_alloc(struct binder_alloc *alloc)
 		goto done;
 	pr_info("STARTED\n");
 	binder_selftest_alloc_offset(alloc, end_offset, 0);
+	binder_selftest_free_list(alloc);
 	binder_selftest_run = false;
 	if (binder_selftest_failures > 0)
 		pr_info("%d tests FAILED\n", binder_selftest_failures);
@@ -17,6 +17,7 @@
  * subsystem list maintains.
  */
 
+#include <linux/debugfs.h>
 #include <linux/device.h>
 #include <linux/kallsyms.h>
 #include <linux/export.h>
@@ -26,7 +27,12 @@
 #include <linux/pm-trace.h>
 #include <linux/pm_wakeirq.h>
 #include <linux/interrupt.h>
+#include <linux/of.h>
+#include <linux/of_platform.h>
+#include <linux/seq_file.h>
 #include <linux/sched.h>
+#include <linux/slab.h>
+#include <linux/sort.h>
 #include <linux/async.h>
 #include <linux/suspend.h>
 #include <trace/events/power.h>
@@ -61,6 +67,27 @@ static pm_message_t pm_transition;
 
 static int async_error;
 
+/*
+ * The slowest resume callbacks of the last system resume, reported through
+ * debugfs so that the devices dominating resume latency can be found without
+ * booting with pm_print_times.
+ */
+#define DPM_SLOW_NR		16
+#define DPM_SLOW_NAME_LEN	40
+
+struct dpm_slow_entry {
+	char name[DPM_SLOW_NAME_LEN];
+	const char *info;
+	s64 usecs;
+	bool async;
+};
+
+static struct dpm_slow_entry dpm_slow[DPM_SLOW_NR];
+static DEFINE_SPINLOCK(dpm_slow_lock);
+static unsigned int dpm_slow_cycles;
+static s64 dpm_slow_total_usecs;
+static ktime_t dpm_resume_starttime;
+
 static char *pm_verb(int event)
 {
 	switch (event) {
@@ -117,6 +144,29 @@ void device_pm_unlock(void)
 	mutex_unlock(&dpm_list_mtx);
 }
 
+/**
+ * dpm_of_init_async - Allow asynchronous resume from the device tree.
+ * @dev: Device being added.
+ *
+ * A "linux,pm-async" property on the device node, or on any ancestor node,
+ * lets the device resume in parallel with the rest of dpm_list.  This way a
+ * whole subsystem can be switched over without touching its drivers.
+ * Suspend is still done in list order.  Dependencies other than the parent
+ * can be listed in "linux,pm-depends".
+ */
+static void dpm_of_init_async(struct device *dev)
+{
+	struct device_node *np;
+
+	for (np = of_node_get(dev->of_node); np; np = of_get_next_parent(np)) {
+		if (of_property_read_bool(np, "linux,pm-async")) {
+			dev->power.async_resume = true;
+			of_node_put(np);
+			break;
+		}
+	}
+}
+
 /**
  * device_pm_add - Add a device to the PM core's list of active devices.
  * @dev: Device to add to the list.
@@ -130,6 +180,7 @@ void device_pm_add(struct device *dev)
 	pr_debug("PM: Adding info for %s:%s\n",
 		 dev->bus ? dev->bus->name : "No Bus", dev_name(dev));
 	device_pm_check_callbacks(dev);
+	dpm_of_init_async(dev);
 	mutex_lock(&dpm_list_mtx);
 	if (dev->parent && dev->parent->power.is_prepared)
 		dev_warn(dev, "parent %s should not be sleeping\n",
@@ -211,6 +262,46 @@ static ktime_t initcall_debug_start(struct device *dev)
 	return calltime;
 }
 
+static bool dpm_is_resume(pm_message_t state)
+{
+	switch (state.event) {
+	case PM_EVENT_RESUME:
+	case PM_EVENT_THAW:
+	case PM_EVENT_RESTORE:
+	case PM_EVENT_RECOVER:
+		return true;
+	default:
+		return false;
+	}
+}
+
+static void dpm_slow_reset(void)
+{
+	spin_lock_irq(&dpm_slow_lock);
+	memset(dpm_slow, 0, sizeof(dpm_slow));
+	dpm_slow_total_usecs = 0;
+	spin_unlock_irq(&dpm_slow_lock);
+}
+
+static void dpm_slow_record(struct device *dev, char *info, s64 usecs)
+{
+	struct dpm_slow_entry *e, *min = &dpm_slow[0];
+	unsigned long flags;
+
+	spin_lock_irqsave(&dpm_slow_lock, flags);
+	for (e = dpm_slow; e < dpm_slow + DPM_SLOW_NR; e++)
+		if (e->usecs < min->usecs)
+			min = e;
+	if (usecs > min->usecs) {
+		strlcpy(min->name, dev_name(dev), sizeof(min->name));
+		min->info = info;
+		min->usecs = usecs;
+		min->async = dev->power.async_suspend ||
+			     dev->power.async_resume;
+	}
+	spin_unlock_irqrestore(&dpm_slow_lock, flags);
+}
+
 static void initcall_debug_report(struct device *dev, ktime_t calltime,
 				  int error, pm_message_t state, char *info)
 {
@@ -392,6 +483,8 @@ static int dpm_run_callback(pm_callback_t cb, struct device *dev,
 		return 0;
 
 	calltime = initcall_debug_start(dev);
+	if (dpm_is_resume(state) && !pm_print_times_enabled)
+		calltime = ktime_get();
 
 	pm_dev_dbg(dev, state, info);
 	trace_device_pm_callback_start(dev, info, state.event);
@@ -400,6 +493,9 @@ static int dpm_run_callback(pm_callback_t cb, struct device *dev,
 	suspend_report_result(cb, error);
 
 	initcall_debug_report(dev, calltime, error, state, info);
+	if (dpm_is_resume(state))
+		dpm_slow_record(dev, info,
+				ktime_us_delta(ktime_get(), calltime));
 
 	return error;
 }
@@ -531,6 +627,44 @@ static bool is_async(struct device *dev)
 		&& !pm_trace_is_enabled();
 }
 
+static bool is_async_resume(struct device *dev)
+{
+	return is_async(dev) || (dev->power.async_resume && pm_async_enabled
+		&& !pm_trace_is_enabled());
+}
+
+#ifdef CONFIG_OF
+/**
+ * dpm_wait_for_of_deps - Wait for the devices listed in "linux,pm-depends".
+ * @dev: Device resumed asynchronously.
+ *
+ * Devices made asynchronous from the device tree no longer resume after
+ * the devices that precede them in dpm_list, so the dependencies that list
+ * order provided have to be restated in the device tree.
+ */
+static void dpm_wait_for_of_deps(struct device *dev)
+{
+	struct platform_device *pdev;
+	struct device_node *np;
+	int i = 0;
+
+	if (!dev->of_node || !dev->power.async_resume)
+		return;
+
+	while ((np = of_parse_phandle(dev->of_node, "linux,pm-depends", i++))) {
+		pdev = of_find_device_by_node(np);
+		of_node_put(np);
+		if (!pdev)
+			continue;
+
+		dpm_wait(&pdev->dev, true);
+		put_device(&pdev->dev);
+	}
+}
+#else
+static inline void dpm_wait_for_of_deps(struct device *dev) {}
+#endif
+
 static void async_resume_noirq(void *data, async_cookie_t cookie)
 {
 	struct device *dev = (struct device *)data;
@@ -757,6 +891,8 @@ static int device_resume(struct device *dev, pm_message_t state, bool async)
 	}
 
 	dpm_wait(dev->parent, async);
+	if (async)
+		dpm_wait_for_of_deps(dev);
 	dpm_watchdog_set(&wd, dev);
 	device_lock(dev);
 
@@ -858,7 +994,7 @@ void dpm_resume(pm_message_t state)
 
 	list_for_each_entry(dev, &dpm_suspended_list, power.entry) {
 		reinit_completion(&dev->power.completion);
-		if (is_async(dev)) {
+		if (is_async_resume(dev)) {
 			get_device(dev);
 			async_schedule(async_resume, dev);
 		}
@@ -867,7 +1003,7 @@ void dpm_resume(pm_message_t state)
 	while (!list_empty(&dpm_suspended_list)) {
 		dev = to_device(dpm_suspended_list.next);
 		get_device(dev);
-		if (!is_async(dev)) {
+		if (!is_async_resume(dev)) {
 			int error;
 
 			mutex_unlock(&dpm_list_mtx);
@@ -986,8 +1122,17 @@ void dpm_complete(pm_message_t state)
  */
 void dpm_resume_end(pm_message_t state)
 {
+	if (!ktime_to_ns(dpm_resume_starttime))
+		dpm_resume_starttime = ktime_get();
+
 	dpm_resume(state);
 	dpm_complete(state);
+
+	spin_lock_irq(&dpm_slow_lock);
+	dpm_slow_total_usecs = ktime_us_delta(ktime_get(),
+					      dpm_resume_starttime);
+	dpm_slow_cycles++;
+	spin_unlock_irq(&dpm_slow_lock);
 }
 EXPORT_SYMBOL_GPL(dpm_resume_end);
 
@@ -1707,6 +1852,9 @@ int dpm_suspend_start(pm_message_t state)
 {
 	int error;
 
+	dpm_slow_reset();
+	dpm_resume_starttime = ktime_set(0, 0);
+
 	error = dpm_prepare(state);
 	if (error) {
 		suspend_stats.failed_prepare++;
@@ -1789,3 +1937,67 @@ void device_pm_check_callbacks(struct device *dev)
 		 !dev->driver->suspend && !dev->driver->resume));
 	spin_unlock_irqrestore(&dev->power.lock, flags);
 }
+
+#ifdef CONFIG_DEBUG_FS
+static int dpm_slow_cmp(const void *a, const void *b)
+{
+	const struct dpm_slow_entry *ea = a, *eb = b;
+
+	if (ea->usecs == eb->usecs)
+		return 0;
+	return ea->usecs < eb->usecs ? 1 : -1;
+}
+
+static int dpm_slow_show(struct seq_file *m, void *unused)
+{
+	struct dpm_slow_entry *entries;
+	unsigned int cycles;
+	s64 total;
+	int i;
+
+	entries = kmalloc(sizeof(dpm_slow), GFP_KERNEL);
+	if (!entries)
+		return -ENOMEM;
+
+	spin_lock_irq(&dpm_slow_lock);
+	memcpy(entries, dpm_slow, sizeof(dpm_slow));
+	cycles = dpm_slow_cycles;
+	total = dpm_slow_total_usecs;
+	spin_unlock_irq(&dpm_slow_lock);
+
+	sort(entries, DPM_SLOW_NR, sizeof(*entries), dpm_slow_cmp, NULL);
+
+	seq_printf(m, "cycles: %u\nlast resume: %lld usecs\n\n",
+		   cycles, total);
+	seq_printf(m, "%-40s %-24s %5s %10s\n",
+		   "device", "callback", "async", "usecs");
+	for (i = 0; i < DPM_SLOW_NR && entries[i].usecs; i++)
+		seq_printf(m, "%-40s %-24s %5s %10lld\n", entries[i].name,
+			   entries[i].info ?: "", entries[i].async ? "y" : "n",
+			   entries[i].usecs);
+
+	kfree(entries);
+	return 0;
+}
+
+static int dpm_slow_open(struct inode *inode, struct file *file)
+{
+	return single_open(file, dpm_slow_show, NULL);
+}
+
+static const struct file_operations dpm_slow_fops = {
+	.owner = THIS_MODULE,
+	.open = dpm_slow_open,
+	.read = seq_read,
+	.llseek = seq_lseek,
+	.release = single_release,
+};
+
+static int __init dpm_slow_debugfs_init(void)
+{
+	debugfs_create_file("pm_resume_slowest", S_IRUGO, NULL, NULL,
+			    &dpm_slow_fops);
+	return 0;
+}
+late_initcall(dpm_slow_debugfs_init);
+#endif
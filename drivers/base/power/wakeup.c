@@ -19,6 +19,9 @@
 #include <trace/events/power.h>
 #include <linux/irq.h>
 #include <linux/irqdesc.h>
+#include <linux/percpu.h>
+#include <linux/seqlock.h>
+#include <linux/wakeup_stats.h>
 
 #include "power.h"
 
@@ -35,21 +38,77 @@ unsigned int pm_wakeup_irq __read_mostly;
 static bool pm_abort_suspend __read_mostly;
 
 /*
- * Combined counters of registered wakeup events and wakeup events in progress.
- * They need to be modified together atomically, so it's better to use one
- * atomic variable to hold them both.
+ * Counters of registered wakeup events and wakeup events in progress.
+ *
+ * They are kept per CPU so that activating and deactivating wakeup sources on
+ * different CPUs does not bounce a shared cache line.  A source may be
+ * activated on one CPU and deactivated on another, so the in-progress count of
+ * a single CPU may be negative; only the sum over all CPUs is meaningful.  The
+ * counters of each CPU are only modified by that CPU with interrupts disabled
+ * (under the wakeup source's lock) and are covered by a seqcount, which lets
+ * split_counters() take a consistent snapshot of the sums without a lock.
  */
-static atomic_t combined_event_count = ATOMIC_INIT(0);
+struct wakeup_event_counters {
+	seqcount_t	seq;
+	unsigned int	registered;
+	int		in_progress;
+};
+
+static DEFINE_PER_CPU(struct wakeup_event_counters, wakeup_event_counters);
 
+/* Layout of the combined value passed to the wakeup_source tracepoints. */
 #define IN_PROGRESS_BITS	(sizeof(int) * 4)
 #define MAX_IN_PROGRESS		((1 << IN_PROGRESS_BITS) - 1)
 
+static void wakeup_events_add(unsigned int registered, int in_progress)
+{
+	struct wakeup_event_counters *wec = this_cpu_ptr(&wakeup_event_counters);
+
+	raw_write_seqcount_begin(&wec->seq);
+	wec->registered += registered;
+	wec->in_progress += in_progress;
+	raw_write_seqcount_end(&wec->seq);
+}
+
+/*
+ * The sums are consistent if no CPU updated its counters between the first
+ * and the second read of its sequence count.  The counts only ever grow, so
+ * it is enough to compare their sums.
+ */
 static void split_counters(unsigned int *cnt, unsigned int *inpr)
 {
-	unsigned int comb = atomic_read(&combined_event_count);
+	struct wakeup_event_counters *wec;
+	unsigned int start, end, registered;
+	int in_progress, cpu;
+
+	do {
+		start = end = registered = 0;
+		in_progress = 0;
+
+		for_each_possible_cpu(cpu) {
+			wec = per_cpu_ptr(&wakeup_event_counters, cpu);
+			start += raw_read_seqcount_begin(&wec->seq);
+			registered += READ_ONCE(wec->registered);
+			in_progress += READ_ONCE(wec->in_progress);
+		}
+
+		smp_rmb();
+		for_each_possible_cpu(cpu) {
+			wec = per_cpu_ptr(&wakeup_event_counters, cpu);
+			end += READ_ONCE(wec->seq.sequence);
+		}
+	} while (start != end);
+
+	*cnt = registered;
+	*inpr = in_progress;
+}
+
+static unsigned int combined_event_count(void)
+{
+	unsigned int cnt, inpr;
 
-	*cnt = (comb >> IN_PROGRESS_BITS);
-	*inpr = comb & MAX_IN_PROGRESS;
+	split_counters(&cnt, &inpr);
+	return (cnt << IN_PROGRESS_BITS) | (inpr & MAX_IN_PROGRESS);
 }
 
 /* A preserved old value of the events counter. */
@@ -530,8 +589,6 @@ static bool wakeup_source_not_registered(struct wakeup_source *ws)
  */
 static void wakeup_source_activate(struct wakeup_source *ws)
 {
-	unsigned int cec;
-
 	if (WARN_ONCE(wakeup_source_not_registered(ws),
 			"unregistered wakeup source\n"))
 		return;
@@ -549,9 +606,10 @@ static void wakeup_source_activate(struct wakeup_source *ws)
 		ws->start_prevent_time = ws->last_time;
 
 	/* Increment the counter of events in progress. */
-	cec = atomic_inc_return(&combined_event_count);
+	wakeup_events_add(0, 1);
 
-	trace_wakeup_source_activate(ws->name, cec);
+	if (trace_wakeup_source_activate_enabled())
+		trace_wakeup_source_activate(ws->name, combined_event_count());
 }
 
 /**
@@ -637,7 +695,7 @@ static inline void update_prevent_sleep_time(struct wakeup_source *ws,
  */
 static void wakeup_source_deactivate(struct wakeup_source *ws)
 {
-	unsigned int cnt, inpr, cec;
+	unsigned int cnt, inpr;
 	ktime_t duration;
 	ktime_t now;
 
@@ -675,12 +733,23 @@ static void wakeup_source_deactivate(struct wakeup_source *ws)
 	 * Increment the counter of registered wakeup events and decrement the
 	 * couter of wakeup events in progress simultaneously.
 	 */
-	cec = atomic_add_return(MAX_IN_PROGRESS, &combined_event_count);
-	trace_wakeup_source_deactivate(ws->name, cec);
+	wakeup_events_add(1, -1);
 
-	split_counters(&cnt, &inpr);
-	if (!inpr && waitqueue_active(&wakeup_count_wait_queue))
-		wake_up(&wakeup_count_wait_queue);
+	if (trace_wakeup_source_deactivate_enabled())
+		trace_wakeup_source_deactivate(ws->name,
+					       combined_event_count());
+
+	/*
+	 * Pairs with prepare_to_wait() in pm_get_wakeup_count(): either the
+	 * waiter sees the updated counters or we see it on the wait queue.
+	 * The counters are only summed up when somebody is waiting.
+	 */
+	smp_mb();
+	if (waitqueue_active(&wakeup_count_wait_queue)) {
+		split_counters(&cnt, &inpr);
+		if (!inpr)
+			wake_up(&wakeup_count_wait_queue);
+	}
 }
 
 /**
@@ -1029,28 +1098,31 @@ void pm_wakep_autosleep_enabled(bool set)
 #endif /* CONFIG_PM_AUTOSLEEP */
 
 static struct dentry *wakeup_sources_stats_dentry;
+static struct dentry *wakeup_sources_bin_dentry;
 
 /**
- * print_wakeup_source_stats - Print wakeup source statistics information.
- * @m: seq_file to print the statistics into.
- * @ws: Wakeup source object to print the statistics for.
+ * wakeup_source_get_stats - Take a snapshot of wakeup source statistics.
+ * @ws: Wakeup source object to take the snapshot of.
+ * @rec: Record to store the statistics in.
  */
-static int print_wakeup_source_stats(struct seq_file *m,
-				     struct wakeup_source *ws)
+static void wakeup_source_get_stats(struct wakeup_source *ws,
+				    struct wakeup_stats_record *rec)
 {
 	unsigned long flags;
 	ktime_t total_time;
 	ktime_t max_time;
-	unsigned long active_count;
 	ktime_t active_time;
 	ktime_t prevent_sleep_time;
 
+	memset(rec, 0, sizeof(*rec));
+	if (ws->name)
+		strlcpy(rec->name, ws->name, sizeof(rec->name));
+
 	spin_lock_irqsave(&ws->lock, flags);
 
 	total_time = ws->total_time;
 	max_time = ws->max_time;
 	prevent_sleep_time = ws->prevent_sleep_time;
-	active_count = ws->active_count;
 	if (ws->active) {
 		ktime_t now = ktime_get();
 
@@ -1066,44 +1138,108 @@ static int print_wakeup_source_stats(struct seq_file *m,
 		active_time = ktime_set(0, 0);
 	}
 
-	seq_printf(m, "%-32s\t%lu\t\t%lu\t\t%lu\t\t%lu\t\t%lld\t\t%lld\t\t%lld\t\t%lld\t\t%lld\n",
-		   ws->name, active_count, ws->event_count,
-		   ws->wakeup_count, ws->expire_count,
-		   ktime_to_ms(active_time), ktime_to_ms(total_time),
-		   ktime_to_ms(max_time), ktime_to_ms(ws->last_time),
-		   ktime_to_ms(prevent_sleep_time));
+	rec->active_count = ws->active_count;
+	rec->event_count = ws->event_count;
+	rec->wakeup_count = ws->wakeup_count;
+	rec->expire_count = ws->expire_count;
+	rec->active_time = ktime_to_ns(active_time);
+	rec->total_time = ktime_to_ns(total_time);
+	rec->max_time = ktime_to_ns(max_time);
+	rec->last_change = ktime_to_ns(ws->last_time);
+	rec->prevent_suspend_time = ktime_to_ns(prevent_sleep_time);
+	rec->active = ws->active;
 
 	spin_unlock_irqrestore(&ws->lock, flags);
+}
 
-	return 0;
+/*
+ * Both statistics files are walked one wakeup source at a time, so a large
+ * number of sources does not make seq_read() rebuild the whole output each
+ * time its buffer has to grow.  The first element is the header, the last one
+ * holds the statistics of deleted sources.
+ */
+static void *wakeup_sources_seq_start(struct seq_file *m, loff_t *pos)
+{
+	struct wakeup_source *ws;
+	int *srcuidx = m->private;
+	loff_t n = *pos;
+
+	*srcuidx = srcu_read_lock(&wakeup_srcu);
+	if (!n)
+		return SEQ_START_TOKEN;
+
+	list_for_each_entry_rcu(ws, &wakeup_sources, entry) {
+		if (!--n)
+			return ws;
+	}
+
+	return n == 1 ? &deleted_ws : NULL;
+}
+
+static void *wakeup_sources_seq_next(struct seq_file *m, void *v, loff_t *pos)
+{
+	struct wakeup_source *ws = v;
+	struct list_head *prev;
+
+	++*pos;
+	if (ws == &deleted_ws)
+		return NULL;
+
+	prev = v == SEQ_START_TOKEN ? &wakeup_sources : &ws->entry;
+	ws = list_next_or_null_rcu(&wakeup_sources, prev, struct wakeup_source,
+				   entry);
+
+	return ws ? ws : &deleted_ws;
+}
+
+static void wakeup_sources_seq_stop(struct seq_file *m, void *v)
+{
+	int *srcuidx = m->private;
+
+	srcu_read_unlock(&wakeup_srcu, *srcuidx);
 }
 
 /**
- * wakeup_sources_stats_show - Print wakeup sources statistics information.
+ * wakeup_sources_stats_seq_show - Print wakeup source statistics information.
  * @m: seq_file to print the statistics into.
+ * @v: Wakeup source object to print the statistics for.
  */
-static int wakeup_sources_stats_show(struct seq_file *m, void *unused)
+static int wakeup_sources_stats_seq_show(struct seq_file *m, void *v)
 {
-	struct wakeup_source *ws;
-	int srcuidx;
-
-	seq_puts(m, "name\t\t\t\t\tactive_count\tevent_count\twakeup_count\t"
-		"expire_count\tactive_since\ttotal_time\tmax_time\t"
-		"last_change\tprevent_suspend_time\n");
+	struct wakeup_source *ws = v;
+	struct wakeup_stats_record rec;
+
+	if (v == SEQ_START_TOKEN) {
+		seq_puts(m, "name\t\t\t\t\tactive_count\tevent_count\twakeup_count\t"
+			"expire_count\tactive_since\ttotal_time\tmax_time\t"
+			"last_change\tprevent_suspend_time\n");
+		return 0;
+	}
 
-	srcuidx = srcu_read_lock(&wakeup_srcu);
-	list_for_each_entry_rcu(ws, &wakeup_sources, entry)
-		print_wakeup_source_stats(m, ws);
-	srcu_read_unlock(&wakeup_srcu, srcuidx);
+	wakeup_source_get_stats(ws, &rec);
 
-	print_wakeup_source_stats(m, &deleted_ws);
+	seq_printf(m, "%-32s\t%llu\t\t%llu\t\t%llu\t\t%llu\t\t%lld\t\t%lld\t\t%lld\t\t%lld\t\t%lld\n",
+		   ws->name, rec.active_count, rec.event_count,
+		   rec.wakeup_count, rec.expire_count,
+		   div_s64(rec.active_time, NSEC_PER_MSEC),
+		   div_s64(rec.total_time, NSEC_PER_MSEC),
+		   div_s64(rec.max_time, NSEC_PER_MSEC),
+		   div_s64(rec.last_change, NSEC_PER_MSEC),
+		   div_s64(rec.prevent_suspend_time, NSEC_PER_MSEC));
 
 	return 0;
 }
 
+static const struct seq_operations wakeup_sources_stats_seq_ops = {
+	.start = wakeup_sources_seq_start,
+	.next = wakeup_sources_seq_next,
+	.stop = wakeup_sources_seq_stop,
+	.show = wakeup_sources_stats_seq_show,
+};
+
 static int wakeup_sources_stats_open(struct inode *inode, struct file *file)
 {
-	return single_open(file, wakeup_sources_stats_show, NULL);
+	return seq_open_private(file, &wakeup_sources_stats_seq_ops, sizeof(int));
 }
 
 static const struct file_operations wakeup_sources_stats_fops = {
@@ -1111,13 +1247,62 @@ static const struct file_operations wakeup_sources_stats_fops = {
 	.open = wakeup_sources_stats_open,
 	.read = seq_read,
 	.llseek = seq_lseek,
-	.release = single_release,
+	.release = seq_release_private,
+};
+
+/**
+ * wakeup_sources_bin_seq_show - Write wakeup source statistics records.
+ * @m: seq_file to write the records into.
+ * @v: Wakeup source object to write the record for.
+ *
+ * The layout is described in <linux/wakeup_stats.h>.
+ */
+static int wakeup_sources_bin_seq_show(struct seq_file *m, void *v)
+{
+	struct wakeup_stats_record rec;
+	struct wakeup_stats_header hdr;
+
+	if (v == SEQ_START_TOKEN) {
+		memset(&hdr, 0, sizeof(hdr));
+		hdr.version = WAKEUP_STATS_VERSION;
+		hdr.record_size = sizeof(rec);
+		split_counters(&hdr.wakeup_count, &hdr.in_progress);
+		seq_write(m, &hdr, sizeof(hdr));
+		return 0;
+	}
+
+	wakeup_source_get_stats(v, &rec);
+	seq_write(m, &rec, sizeof(rec));
+
+	return 0;
+}
+
+static const struct seq_operations wakeup_sources_bin_seq_ops = {
+	.start = wakeup_sources_seq_start,
+	.next = wakeup_sources_seq_next,
+	.stop = wakeup_sources_seq_stop,
+	.show = wakeup_sources_bin_seq_show,
+};
+
+static int wakeup_sources_bin_open(struct inode *inode, struct file *file)
+{
+	return seq_open_private(file, &wakeup_sources_bin_seq_ops, sizeof(int));
+}
+
+static const struct file_operations wakeup_sources_bin_fops = {
+	.owner = THIS_MODULE,
+	.open = wakeup_sources_bin_open,
+	.read = seq_read,
+	.llseek = seq_lseek,
+	.release = seq_release_private,
 };
 
 static int __init wakeup_sources_debugfs_init(void)
 {
 	wakeup_sources_stats_dentry = debugfs_create_file("wakeup_sources",
 			S_IRUGO, NULL, NULL, &wakeup_sources_stats_fops);
+	wakeup_sources_bin_dentry = debugfs_create_file("wakeup_sources_bin",
+			S_IRUGO, NULL, NULL, &wakeup_sources_bin_fops);
 	return 0;
 }
 
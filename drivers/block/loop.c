@@ -86,6 +86,16 @@ static DEFINE_MUTEX(loop_index_mutex);
 static int max_part;
 static int part_shift;
 
+/*
+ * Number of hardware queues, each served by its own worker thread.
+ * 0 picks one per online CPU, up to LOOP_DEFAULT_HW_QUEUES.
+ */
+#define LOOP_DEFAULT_HW_QUEUES	4
+static unsigned int hw_queues;
+
+/* Use direct I/O to the backing file whenever it supports it */
+static bool default_dio = true;
+
 static int transfer_xor(struct loop_device *lo, int cmd,
 			struct page *raw_page, unsigned raw_off,
 			struct page *loop_page, unsigned loop_off,
@@ -571,7 +581,7 @@ struct switch_request {
 static inline void loop_update_dio(struct loop_device *lo)
 {
 	__loop_update_dio(lo, io_is_direct(lo->lo_backing_file) |
-			lo->use_dio);
+			lo->use_dio | lo->auto_dio);
 }
 
 /*
@@ -881,19 +891,45 @@ static void loop_config_discard(struct loop_device *lo)
 
 static void loop_unprepare_queue(struct loop_device *lo)
 {
-	kthread_flush_worker(&lo->worker);
-	kthread_stop(lo->worker_task);
+	unsigned int i;
+
+	for (i = 0; i < lo->nr_workers; i++) {
+		kthread_flush_worker(&lo->workers[i].worker);
+		kthread_stop(lo->workers[i].task);
+	}
+	kfree(lo->workers);
+	lo->workers = NULL;
+	lo->nr_workers = 0;
 }
 
 static int loop_prepare_queue(struct loop_device *lo)
 {
-	kthread_init_worker(&lo->worker);
-	lo->worker_task = kthread_run(kthread_worker_fn,
-			&lo->worker, "loop%d", lo->lo_number);
-	if (IS_ERR(lo->worker_task))
+	unsigned int i, nr = lo->tag_set.nr_hw_queues;
+	struct loop_worker *w;
+
+	lo->workers = kcalloc(nr, sizeof(*lo->workers), GFP_KERNEL);
+	if (!lo->workers)
 		return -ENOMEM;
-	set_user_nice(lo->worker_task, MIN_NICE);
+
+	for (i = 0; i < nr; i++) {
+		w = &lo->workers[i];
+		kthread_init_worker(&w->worker);
+		if (nr == 1)
+			w->task = kthread_run(kthread_worker_fn, &w->worker,
+					      "loop%d", lo->lo_number);
+		else
+			w->task = kthread_run(kthread_worker_fn, &w->worker,
+					      "loop%d-%u", lo->lo_number, i);
+		if (IS_ERR(w->task))
+			goto out_stop;
+		set_user_nice(w->task, MIN_NICE);
+		lo->nr_workers++;
+	}
 	return 0;
+
+out_stop:
+	loop_unprepare_queue(lo);
+	return -ENOMEM;
 }
 
 static int
@@ -1055,6 +1091,7 @@ static int loop_configure(struct loop_device *lo, fmode_t mode,
 	set_device_ro(bdev, (lo->lo_flags & LO_FLAGS_READ_ONLY) != 0);
 
 	lo->use_dio = lo->lo_flags & LO_FLAGS_DIRECT_IO;
+	lo->auto_dio = default_dio && !lo->use_dio;
 	lo->lo_device = bdev;
 	lo->lo_backing_file = file;
 	lo->old_gfp_mask = mapping_gfp_mask(mapping);
@@ -1244,7 +1281,7 @@ loop_set_status(struct loop_device *lo, const struct loop_info64 *info)
 	loop_config_discard(lo);
 
 	/* update dio if lo_offset or transfer is changed */
-	__loop_update_dio(lo, lo->use_dio);
+	__loop_update_dio(lo, lo->use_dio || lo->auto_dio);
 
  exit:
 	blk_mq_unfreeze_queue(lo->lo_queue);
@@ -1421,6 +1458,8 @@ static int loop_set_dio(struct loop_device *lo, unsigned long arg)
 	if (lo->lo_state != Lo_bound)
 		goto out;
 
+	/* an explicit choice from userspace overrides default_dio */
+	lo->auto_dio = false;
 	__loop_update_dio(lo, !!arg);
 	if (lo->use_dio == !!arg)
 		return 0;
@@ -1774,6 +1813,10 @@ module_param(max_loop, int, S_IRUGO);
 MODULE_PARM_DESC(max_loop, "Maximum number of loop devices");
 module_param(max_part, int, S_IRUGO);
 MODULE_PARM_DESC(max_part, "Maximum number of partitions per loop device");
+module_param(hw_queues, uint, S_IRUGO);
+MODULE_PARM_DESC(hw_queues, "Number of hardware queues and workers per loop device (0 = auto)");
+module_param(default_dio, bool, S_IRUGO | S_IWUSR);
+MODULE_PARM_DESC(default_dio, "Use direct I/O to the backing file when it is supported");
 MODULE_LICENSE("GPL");
 MODULE_ALIAS_BLOCKDEV_MAJOR(LOOP_MAJOR);
 
@@ -1836,7 +1879,7 @@ static int loop_queue_rq(struct blk_mq_hw_ctx *hctx,
 		break;
 	}
 
-	kthread_queue_work(&lo->worker, &cmd->work);
+	kthread_queue_work(&lo->workers[hctx->queue_num].worker, &cmd->work);
 
 	return BLK_MQ_RQ_QUEUE_OK;
 }
@@ -1911,7 +1954,8 @@ static int loop_add(struct loop_device **l, int i)
 
 	err = -ENOMEM;
 	lo->tag_set.ops = &loop_mq_ops;
-	lo->tag_set.nr_hw_queues = 1;
+	lo->tag_set.nr_hw_queues = hw_queues ?:
+		min_t(unsigned int, num_online_cpus(), LOOP_DEFAULT_HW_QUEUES);
 	lo->tag_set.queue_depth = 128;
 	lo->tag_set.numa_node = NUMA_NO_NODE;
 	lo->tag_set.cmd_size = sizeof(struct loop_cmd);
@@ -26,6 +26,11 @@ enum {
 
 struct loop_func_table;
 
+struct loop_worker {
+	struct kthread_worker	worker;
+	struct task_struct	*task;
+};
+
 struct loop_device {
 	int		lo_number;
 	atomic_t	lo_refcnt;
@@ -56,9 +61,10 @@ struct loop_device {
 	spinlock_t		lo_lock;
 	int			lo_state;
 	struct mutex		lo_ctl_mutex;
-	struct kthread_worker	worker;
-	struct task_struct	*worker_task;
+	struct loop_worker	*workers;	/* one per hardware queue */
+	unsigned int		nr_workers;
 	bool			use_dio;
+	bool			auto_dio;	/* dio not chosen by userspace */
 	bool			sysfs_inited;
 
 	struct request_queue	*lo_queue;
@@ -0,0 +1,147 @@
+/*
+ * Content based deduplication of zram objects.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version
+ * 2 of the License, or (at your option) any later version.
+ */
+
+#include <linux/kernel.h>
+#include <linux/slab.h>
+#include <linux/vmalloc.h>
+#include <linux/hash.h>
+#include <linux/xxhash.h>
+
+#include "zram_drv.h"
+
+/* One bucket per four pages of disk, within sane bounds */
+#define ZRAM_DEDUP_MIN_BITS	8
+#define ZRAM_DEDUP_MAX_BITS	20
+
+u32 zram_dedup_checksum(const void *mem, unsigned int len)
+{
+	return (u32)xxh64(mem, len, 0);
+}
+
+static struct hlist_head *zram_dedup_bucket(struct zram *zram, u32 checksum)
+{
+	return &zram->dedup_hash[hash_32(checksum, zram->dedup_bits)];
+}
+
+/*
+ * Look for a stored object identical to the @len bytes at @mem and take
+ * a reference on it. May be called with preemption disabled.
+ */
+struct zram_dedup_entry *zram_dedup_find(struct zram *zram, const void *mem,
+				unsigned int len, u32 checksum)
+{
+	struct hlist_head *head = zram_dedup_bucket(zram, checksum);
+	struct zram_dedup_entry *entry;
+
+	atomic64_inc(&zram->stats.dedup_lookups);
+
+	spin_lock(&zram->dedup_lock);
+	hlist_for_each_entry(entry, head, node) {
+		void *obj;
+		bool match;
+
+		if (entry->checksum != checksum || entry->len != len)
+			continue;
+
+		obj = zs_map_object(zram->mem_pool, entry->handle, ZS_MM_RO);
+		match = !memcmp(obj, mem, len);
+		zs_unmap_object(zram->mem_pool, entry->handle);
+		if (!match)
+			continue;
+
+		entry->refcount++;
+		spin_unlock(&zram->dedup_lock);
+
+		atomic64_inc(&zram->stats.dedup_hits);
+		atomic64_add(len, &zram->stats.dup_data_size);
+		return entry;
+	}
+	spin_unlock(&zram->dedup_lock);
+
+	return NULL;
+}
+
+/*
+ * Publish a freshly stored object so later writes can share it. Returns
+ * NULL if no entry could be allocated; the caller then keeps @handle as
+ * a plain, unshared slot.
+ */
+struct zram_dedup_entry *zram_dedup_insert(struct zram *zram,
+				unsigned long handle, unsigned int len,
+				u32 checksum)
+{
+	struct zram_dedup_entry *entry;
+
+	entry = kmalloc(sizeof(*entry), GFP_NOIO | __GFP_NOWARN);
+	if (!entry)
+		return NULL;
+
+	entry->handle = handle;
+	entry->len = len;
+	entry->checksum = checksum;
+	entry->refcount = 1;
+
+	spin_lock(&zram->dedup_lock);
+	hlist_add_head(&entry->node, zram_dedup_bucket(zram, checksum));
+	spin_unlock(&zram->dedup_lock);
+
+	atomic64_add(sizeof(*entry), &zram->stats.meta_data_size);
+	return entry;
+}
+
+/* Drop a slot's reference; the last one frees the zsmalloc object */
+void zram_dedup_put(struct zram *zram, struct zram_dedup_entry *entry)
+{
+	unsigned int len = entry->len;
+
+	spin_lock(&zram->dedup_lock);
+	if (--entry->refcount) {
+		spin_unlock(&zram->dedup_lock);
+		atomic64_sub(len, &zram->stats.dup_data_size);
+		return;
+	}
+	hlist_del(&entry->node);
+	spin_unlock(&zram->dedup_lock);
+
+	zs_free(zram->mem_pool, entry->handle);
+	atomic64_sub(len, &zram->stats.compr_data_size);
+	atomic64_sub(sizeof(*entry), &zram->stats.meta_data_size);
+	kfree(entry);
+}
+
+bool zram_dedup_enabled(struct zram *zram)
+{
+	return zram->dedup_hash;
+}
+
+int zram_dedup_init(struct zram *zram, size_t num_pages)
+{
+	unsigned int bits;
+
+	if (!zram->use_dedup)
+		return 0;
+
+	bits = num_pages > 4 ? ilog2(num_pages) - 2 : 0;
+	bits = clamp_t(unsigned int, bits, ZRAM_DEDUP_MIN_BITS,
+			ZRAM_DEDUP_MAX_BITS);
+
+	zram->dedup_hash = vzalloc(sizeof(struct hlist_head) << bits);
+	if (!zram->dedup_hash)
+		return -ENOMEM;
+
+	zram->dedup_bits = bits;
+	spin_lock_init(&zram->dedup_lock);
+	return 0;
+}
+
+void zram_dedup_fini(struct zram *zram)
+{
+	vfree(zram->dedup_hash);
+	zram->dedup_hash = NULL;
+}
@@ -0,0 +1,74 @@
+/*
+ * Content based deduplication of zram objects.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version
+ * 2 of the License, or (at your option) any later version.
+ */
+
+#ifndef _ZRAM_DEDUP_H_
+#define _ZRAM_DEDUP_H_
+
+struct zram;
+
+/*
+ * One stored object shared by every slot whose content hashes and
+ * compares equal to it. Slots flagged ZRAM_DEDUP point here instead
+ * of holding the zsmalloc handle directly.
+ */
+struct zram_dedup_entry {
+	struct hlist_node node;
+	unsigned long handle;
+	unsigned int len;
+	u32 checksum;
+	unsigned long refcount;		/* protected by zram->dedup_lock */
+};
+
+#ifdef CONFIG_ZRAM_DEDUP
+u32 zram_dedup_checksum(const void *mem, unsigned int len);
+struct zram_dedup_entry *zram_dedup_find(struct zram *zram, const void *mem,
+				unsigned int len, u32 checksum);
+struct zram_dedup_entry *zram_dedup_insert(struct zram *zram,
+				unsigned long handle, unsigned int len,
+				u32 checksum);
+void zram_dedup_put(struct zram *zram, struct zram_dedup_entry *entry);
+
+bool zram_dedup_enabled(struct zram *zram);
+int zram_dedup_init(struct zram *zram, size_t num_pages);
+void zram_dedup_fini(struct zram *zram);
+#else
+static inline u32 zram_dedup_checksum(const void *mem, unsigned int len)
+{
+	return 0;
+}
+
+static inline struct zram_dedup_entry *zram_dedup_find(struct zram *zram,
+			const void *mem, unsigned int len, u32 checksum)
+{
+	return NULL;
+}
+
+static inline struct zram_dedup_entry *zram_dedup_insert(struct zram *zram,
+			unsigned long handle, unsigned int len, u32 checksum)
+{
+	return NULL;
+}
+
+static inline void zram_dedup_put(struct zram *zram,
+			struct zram_dedup_entry *entry) { }
+
+static inline bool zram_dedup_enabled(struct zram *zram)
+{
+	return false;
+}
+
+static inline int zram_dedup_init(struct zram *zram, size_t num_pages)
+{
+	return 0;
+}
+
+static inline void zram_dedup_fini(struct zram *zram) { }
+#endif
+
+#endif /* _ZRAM_DEDUP_H_ */
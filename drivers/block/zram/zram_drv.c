@@ -41,6 +41,8 @@ static DEFINE_MUTEX(zram_index_mutex);
 
 static int zram_major;
 static const char *default_compressor = CONFIG_ZRAM_DEFAULT_COMP_ALGORITHM;
+/* per-cpu workers compressing asynchronous writes */
+static struct workqueue_struct *zram_comp_wq;
 
 /* Module params (documentation at end) */
 static unsigned int num_devices = 1;
@@ -51,6 +53,8 @@ static unsigned int num_devices = 1;
 static size_t huge_class_size;
 
 static void zram_free_page(struct zram *zram, size_t index);
+static int zram_read_from_zspool(struct zram *zram, struct page *page,
+				 u32 index);
 static int zram_bvec_read(struct zram *zram, struct bio_vec *bvec,
 				u32 index, int offset, struct bio *bio);
 
@@ -80,8 +84,17 @@ static inline struct zram *dev_to_zram(struct device *dev)
 	return (struct zram *)dev_to_disk(dev)->private_data;
 }
 
+static struct zram_dedup_entry *zram_get_dedup_entry(struct zram *zram,
+							u32 index)
+{
+	return (struct zram_dedup_entry *)zram->table[index].handle;
+}
+
 static unsigned long zram_get_handle(struct zram *zram, u32 index)
 {
+	/* Shared objects are reached through their dedup entry */
+	if (zram->table[index].flags & BIT(ZRAM_DEDUP))
+		return zram_get_dedup_entry(zram, index)->handle;
 	return zram->table[index].handle;
 }
 
@@ -109,6 +122,24 @@ static void zram_clear_flag(struct zram *zram, u32 index,
 	zram->table[index].flags &= ~BIT(flag);
 }
 
+static unsigned int zram_get_idle_age(struct zram *zram, u32 index)
+{
+	return (zram->table[index].flags >> ZRAM_IDLE_AGE) & ZRAM_IDLE_AGE_MAX;
+}
+
+static void zram_set_idle_age(struct zram *zram, u32 index, unsigned int age)
+{
+	zram->table[index].flags &=
+		~((unsigned long)ZRAM_IDLE_AGE_MAX << ZRAM_IDLE_AGE);
+	zram->table[index].flags |= (unsigned long)age << ZRAM_IDLE_AGE;
+}
+
+static void zram_clear_idle(struct zram *zram, u32 index)
+{
+	zram_clear_flag(zram, index, ZRAM_IDLE);
+	zram_set_idle_age(zram, index, 0);
+}
+
 static inline void zram_set_element(struct zram *zram, u32 index,
 			unsigned long element)
 {
@@ -297,6 +328,7 @@ static ssize_t idle_store(struct device *dev,
 {
 	struct zram *zram = dev_to_zram(dev);
 	unsigned long nr_pages = zram->disksize >> PAGE_SHIFT;
+	unsigned int age;
 	int index;
 	char mode_buf[8];
 	ssize_t sz;
@@ -324,9 +356,23 @@ static ssize_t idle_store(struct device *dev,
 		 * See the comment in writeback_store.
 		 */
 		zram_slot_lock(zram, index);
-		if (zram_allocated(zram, index) &&
-				!zram_test_flag(zram, index, ZRAM_UNDER_WB))
+		if (!zram_allocated(zram, index) ||
+				zram_test_flag(zram, index, ZRAM_UNDER_WB))
+			goto next;
+
+		/*
+		 * A slot still idle from an earlier pass moves to the next
+		 * age bucket, so how long each bucket means is up to how
+		 * often userspace marks pages idle.
+		 */
+		if (zram_test_flag(zram, index, ZRAM_IDLE)) {
+			age = zram_get_idle_age(zram, index);
+			if (age < ZRAM_IDLE_AGE_MAX)
+				zram_set_idle_age(zram, index, age + 1);
+		} else {
 			zram_set_flag(zram, index, ZRAM_IDLE);
+		}
+next:
 		zram_slot_unlock(zram, index);
 	}
 
@@ -561,19 +607,37 @@ static ssize_t backing_dev_store(struct device *dev,
 	return err;
 }
 
-static unsigned long alloc_block_bdev(struct zram *zram)
+/*
+ * Reserve a run of *nr contiguous blocks, settling for a shorter run when
+ * the backing device is too fragmented. Returns the first block and sets
+ * *nr to the run length, or returns 0 when the device is full.
+ */
+static unsigned long alloc_block_bdev(struct zram *zram, unsigned int *nr)
 {
-	unsigned long blk_idx = 1;
+	unsigned int want = *nr, i;
+	unsigned long blk_idx;
 retry:
 	/* skip 0 bit to confuse zram.handle = 0 */
-	blk_idx = find_next_zero_bit(zram->bitmap, zram->nr_pages, blk_idx);
-	if (blk_idx == zram->nr_pages)
-		return 0;
-
-	if (test_and_set_bit(blk_idx, zram->bitmap))
+	blk_idx = bitmap_find_next_zero_area(zram->bitmap, zram->nr_pages,
+					     1, want, 0);
+	if (blk_idx >= zram->nr_pages) {
+		if (want == 1)
+			return 0;
+		want >>= 1;
 		goto retry;
+	}
 
-	atomic64_inc(&zram->stats.bd_count);
+	for (i = 0; i < want; i++) {
+		if (test_and_set_bit(blk_idx + i, zram->bitmap)) {
+			/* lost a race with another writeback */
+			while (i--)
+				clear_bit(blk_idx + i, zram->bitmap);
+			goto retry;
+		}
+	}
+
+	atomic64_add(want, &zram->stats.bd_count);
+	*nr = want;
 	return blk_idx;
 }
 
@@ -628,130 +692,86 @@ static int read_from_bdev_async(struct zram *zram, struct bio_vec *bvec,
 #define HUGE_WRITEBACK 1
 #define IDLE_WRITEBACK 2
 
-static ssize_t writeback_store(struct device *dev,
-		struct device_attribute *attr, const char *buf, size_t len)
-{
-	struct zram *zram = dev_to_zram(dev);
-	unsigned long nr_pages = zram->disksize >> PAGE_SHIFT;
-	unsigned long index;
-	struct bio bio;
-	struct page *page;
-	ssize_t ret, sz;
-	char mode_buf[8];
-	int mode = -1;
-	unsigned long blk_idx = 0;
-
-	sz = strscpy(mode_buf, buf, sizeof(mode_buf));
-	if (sz <= 0)
-		return -EINVAL;
-
-	/* ignore trailing newline */
-	if (mode_buf[sz - 1] == '\n')
-		mode_buf[sz - 1] = 0x00;
-
-	if (!strcmp(mode_buf, "idle"))
-		mode = IDLE_WRITEBACK;
-	else if (!strcmp(mode_buf, "huge"))
-		mode = HUGE_WRITEBACK;
-
-	if (mode == -1)
-		return -EINVAL;
-
-	down_read(&zram->init_lock);
-	if (!init_done(zram)) {
-		ret = -EINVAL;
-		goto release_init_lock;
-	}
+/* Slots written back with a single bio */
+#define ZRAM_WB_BATCH 32
 
-	if (!zram->backing_dev) {
-		ret = -ENODEV;
-		goto release_init_lock;
-	}
+/*
+ * Give back a slot picked for writeback that did not make it to the
+ * backing device.
+ */
+static void zram_wb_cancel(struct zram *zram, unsigned long index)
+{
+	zram_slot_lock(zram, index);
+	zram_clear_flag(zram, index, ZRAM_UNDER_WB);
+	zram_clear_idle(zram, index);
+	zram_slot_unlock(zram, index);
+}
 
-	page = alloc_page(GFP_KERNEL);
-	if (!page) {
-		ret = -ENOMEM;
-		goto release_init_lock;
-	}
+/*
+ * Pick the next slots to write back, starting at *index, and read them
+ * into @pages. Returns how many were picked.
+ */
+static unsigned int zram_wb_gather(struct zram *zram, unsigned long *index,
+				   unsigned long nr_pages, int mode,
+				   unsigned int min_age, struct page **pages,
+				   unsigned long *slots, unsigned int max)
+{
+	unsigned int nr = 0;
 
-	for (index = 0; index < nr_pages; index++) {
+	for (; *index < nr_pages && nr < max; (*index)++) {
+		unsigned long i = *index;
 		struct bio_vec bvec;
 
-		bvec.bv_page = page;
+		bvec.bv_page = pages[nr];
 		bvec.bv_len = PAGE_SIZE;
 		bvec.bv_offset = 0;
 
-		spin_lock(&zram->wb_limit_lock);
-		if (zram->wb_limit_enable && !zram->bd_wb_limit) {
-			spin_unlock(&zram->wb_limit_lock);
-			ret = -EIO;
-			break;
-		}
-		spin_unlock(&zram->wb_limit_lock);
-
-		if (!blk_idx) {
-			blk_idx = alloc_block_bdev(zram);
-			if (!blk_idx) {
-				ret = -ENOSPC;
-				break;
-			}
-		}
-
-		zram_slot_lock(zram, index);
-		if (!zram_allocated(zram, index))
+		zram_slot_lock(zram, i);
+		if (!zram_allocated(zram, i))
 			goto next;
 
-		if (zram_test_flag(zram, index, ZRAM_WB) ||
-				zram_test_flag(zram, index, ZRAM_SAME) ||
-				zram_test_flag(zram, index, ZRAM_UNDER_WB))
+		if (zram_test_flag(zram, i, ZRAM_WB) ||
+				zram_test_flag(zram, i, ZRAM_SAME) ||
+				zram_test_flag(zram, i, ZRAM_UNDER_WB))
 			goto next;
 
 		if (mode == IDLE_WRITEBACK &&
-			  !zram_test_flag(zram, index, ZRAM_IDLE))
+			  (!zram_test_flag(zram, i, ZRAM_IDLE) ||
+			   zram_get_idle_age(zram, i) < min_age))
 			goto next;
 		if (mode == HUGE_WRITEBACK &&
-			  !zram_test_flag(zram, index, ZRAM_HUGE))
+			  !zram_test_flag(zram, i, ZRAM_HUGE))
 			goto next;
 		/*
 		 * Clearing ZRAM_UNDER_WB is duty of caller.
 		 * IOW, zram_free_page never clear it.
 		 */
-		zram_set_flag(zram, index, ZRAM_UNDER_WB);
+		zram_set_flag(zram, i, ZRAM_UNDER_WB);
 		/* Need for hugepage writeback racing */
-		zram_set_flag(zram, index, ZRAM_IDLE);
-		zram_slot_unlock(zram, index);
-		if (zram_bvec_read(zram, &bvec, index, 0, NULL)) {
-			zram_slot_lock(zram, index);
-			zram_clear_flag(zram, index, ZRAM_UNDER_WB);
-			zram_clear_flag(zram, index, ZRAM_IDLE);
-			zram_slot_unlock(zram, index);
+		zram_set_flag(zram, i, ZRAM_IDLE);
+		zram_slot_unlock(zram, i);
+		if (zram_bvec_read(zram, &bvec, i, 0, NULL)) {
+			zram_wb_cancel(zram, i);
 			continue;
 		}
+		slots[nr++] = i;
+		continue;
+next:
+		zram_slot_unlock(zram, i);
+	}
 
-		bio_init(&bio);
+	return nr;
+}
 
-		bio.bi_max_vecs = 1;
-		bio.bi_io_vec = &bvec;
-		bio.bi_bdev = zram->bdev;
+/* Point the written back slots at their blocks on the backing device */
+static void zram_wb_commit(struct zram *zram, unsigned long *slots,
+			   unsigned int nr, unsigned long blk_idx)
+{
+	unsigned int i;
 
-		bio.bi_iter.bi_sector = blk_idx * (PAGE_SIZE >> 9);
-		bio_set_op_attrs(&bio, REQ_OP_WRITE, REQ_SYNC);
-		bio_add_page(&bio, bvec.bv_page, bvec.bv_len,
-				bvec.bv_offset);
-		/*
-		 * XXX: A single page IO would be inefficient for write
-		 * but it would be not bad as starter.
-		 */
-		ret = submit_bio_wait(&bio);
-		if (ret) {
-			zram_slot_lock(zram, index);
-			zram_clear_flag(zram, index, ZRAM_UNDER_WB);
-			zram_clear_flag(zram, index, ZRAM_IDLE);
-			zram_slot_unlock(zram, index);
-			continue;
-		}
+	for (i = 0; i < nr; i++) {
+		unsigned long index = slots[i];
 
-		atomic64_inc(&zram->stats.bd_writes);
 		/*
 		 * We released zram_slot_lock so need to check if the slot was
 		 * changed. If there is freeing for the slot, we can catch it
@@ -765,15 +785,15 @@ static ssize_t writeback_store(struct device *dev,
 		if (!zram_allocated(zram, index) ||
 			  !zram_test_flag(zram, index, ZRAM_IDLE)) {
 			zram_clear_flag(zram, index, ZRAM_UNDER_WB);
-			zram_clear_flag(zram, index, ZRAM_IDLE);
+			zram_clear_idle(zram, index);
+			free_block_bdev(zram, blk_idx + i);
 			goto next;
 		}
 
 		zram_free_page(zram, index);
 		zram_clear_flag(zram, index, ZRAM_UNDER_WB);
 		zram_set_flag(zram, index, ZRAM_WB);
-		zram_set_element(zram, index, blk_idx);
-		blk_idx = 0;
+		zram_set_element(zram, index, blk_idx + i);
 		atomic64_inc(&zram->stats.pages_stored);
 		spin_lock(&zram->wb_limit_lock);
 		if (zram->wb_limit_enable && zram->bd_wb_limit > 0)
@@ -782,11 +802,147 @@ static ssize_t writeback_store(struct device *dev,
 next:
 		zram_slot_unlock(zram, index);
 	}
+}
+
+/*
+ * Slots are gathered in index order and written to a contiguous run of
+ * blocks with a single bio, so neighbouring swap slots end up next to
+ * each other on the backing device and swap readahead reads them back
+ * sequentially.
+ */
+static ssize_t writeback_store(struct device *dev,
+		struct device_attribute *attr, const char *buf, size_t len)
+{
+	struct zram *zram = dev_to_zram(dev);
+	unsigned long nr_pages = zram->disksize >> PAGE_SHIFT;
+	unsigned long index = 0;
+	struct page *pages[ZRAM_WB_BATCH] = { NULL };
+	unsigned long slots[ZRAM_WB_BATCH];
+	unsigned int min_age = 0;
+	struct blk_plug plug;
+	ssize_t ret = len, sz;
+	char mode_buf[8];
+	int mode = -1;
+	unsigned int i;
 
-	if (blk_idx)
-		free_block_bdev(zram, blk_idx);
+	sz = strscpy(mode_buf, buf, sizeof(mode_buf));
+	if (sz <= 0)
+		return -EINVAL;
+
+	/* ignore trailing newline */
+	if (mode_buf[sz - 1] == '\n')
+		mode_buf[sz - 1] = 0x00;
+
+	/* "idle:N" only writes back slots in idle age bucket N or older */
+	if (!strncmp(mode_buf, "idle:", 5)) {
+		if (kstrtouint(mode_buf + 5, 10, &min_age) ||
+				min_age > ZRAM_IDLE_AGE_MAX)
+			return -EINVAL;
+		mode_buf[4] = 0x00;
+	}
+
+	if (!strcmp(mode_buf, "idle"))
+		mode = IDLE_WRITEBACK;
+	else if (!strcmp(mode_buf, "huge"))
+		mode = HUGE_WRITEBACK;
+
+	if (mode == -1)
+		return -EINVAL;
+
+	down_read(&zram->init_lock);
+	if (!init_done(zram)) {
+		ret = -EINVAL;
+		goto release_init_lock;
+	}
+
+	if (!zram->backing_dev) {
+		ret = -ENODEV;
+		goto release_init_lock;
+	}
+
+	for (i = 0; i < ZRAM_WB_BATCH; i++) {
+		pages[i] = alloc_page(GFP_KERNEL);
+		if (!pages[i]) {
+			ret = -ENOMEM;
+			goto free_pages;
+		}
+	}
+
+	blk_start_plug(&plug);
+	while (index < nr_pages) {
+		unsigned int nr, batch = ZRAM_WB_BATCH;
+		unsigned long blk_idx;
+		struct bio *bio;
+		int err;
+
+		spin_lock(&zram->wb_limit_lock);
+		if (zram->wb_limit_enable) {
+			u64 budget = zram->bd_wb_limit >> (PAGE_SHIFT - 12);
+
+			if (!budget) {
+				spin_unlock(&zram->wb_limit_lock);
+				ret = -EIO;
+				break;
+			}
+			batch = min_t(u64, batch, budget);
+		}
+		spin_unlock(&zram->wb_limit_lock);
+
+		nr = zram_wb_gather(zram, &index, nr_pages, mode, min_age,
+				    pages, slots, batch);
+		if (!nr)
+			break;
+
+		batch = nr;
+		blk_idx = alloc_block_bdev(zram, &batch);
+		if (!blk_idx) {
+			for (i = 0; i < nr; i++)
+				zram_wb_cancel(zram, slots[i]);
+			ret = -ENOSPC;
+			break;
+		}
+
+		/*
+		 * No contiguous run was long enough for the whole batch; put
+		 * the rest back so the next batch picks them up again.
+		 */
+		if (batch < nr) {
+			for (i = batch; i < nr; i++) {
+				zram_slot_lock(zram, slots[i]);
+				zram_clear_flag(zram, slots[i], ZRAM_UNDER_WB);
+				zram_slot_unlock(zram, slots[i]);
+			}
+			index = slots[batch];
+			nr = batch;
+		}
+
+		bio = bio_alloc(GFP_KERNEL, nr);
+		bio->bi_bdev = zram->bdev;
+		bio->bi_iter.bi_sector = blk_idx * (PAGE_SIZE >> 9);
+		bio_set_op_attrs(bio, REQ_OP_WRITE, REQ_SYNC);
+		for (i = 0; i < nr; i++)
+			bio_add_page(bio, pages[i], PAGE_SIZE, 0);
+
+		err = submit_bio_wait(bio);
+		bio_put(bio);
+		if (err) {
+			for (i = 0; i < nr; i++) {
+				zram_wb_cancel(zram, slots[i]);
+				free_block_bdev(zram, blk_idx + i);
+			}
+			ret = err;
+			continue;
+		}
+
+		atomic64_add(nr, &zram->stats.bd_writes);
+		zram_wb_commit(zram, slots, nr, blk_idx);
+		cond_resched();
+	}
+	blk_finish_plug(&plug);
 	ret = len;
-	__free_page(page);
+free_pages:
+	for (i = 0; i < ZRAM_WB_BATCH && pages[i]; i++)
+		__free_page(pages[i]);
 release_init_lock:
 	up_read(&zram->init_lock);
 
@@ -878,7 +1034,7 @@ static void zram_debugfs_destroy(void)
 
 static void zram_accessed(struct zram *zram, u32 index)
 {
-	zram_clear_flag(zram, index, ZRAM_IDLE);
+	zram_clear_idle(zram, index);
 	zram->table[index].ac_time = ktime_get_boottime();
 }
 
@@ -919,13 +1075,15 @@ static ssize_t read_block_state(struct file *file, char __user *buf,
 
 		ts = ktime_to_timespec64(zram->table[index].ac_time);
 		copied = snprintf(kbuf + written, count,
-			"%12zd %12lld.%06lu %c%c%c%c\n",
+			"%12zd %12lld.%06lu %c%c%c%c%c%c\n",
 			index, (s64)ts.tv_sec,
 			ts.tv_nsec / NSEC_PER_USEC,
 			zram_test_flag(zram, index, ZRAM_SAME) ? 's' : '.',
 			zram_test_flag(zram, index, ZRAM_WB) ? 'w' : '.',
 			zram_test_flag(zram, index, ZRAM_HUGE) ? 'h' : '.',
-			zram_test_flag(zram, index, ZRAM_IDLE) ? 'i' : '.');
+			zram_test_flag(zram, index, ZRAM_IDLE) ? 'i' : '.',
+			zram_test_flag(zram, index, ZRAM_RECOMP) ? 'r' : '.',
+			zram_test_flag(zram, index, ZRAM_DEDUP) ? 'd' : '.');
 
 		if (count <= copied) {
 			zram_slot_unlock(zram, index);
@@ -972,7 +1130,7 @@ static void zram_debugfs_create(void) {};
 static void zram_debugfs_destroy(void) {};
 static void zram_accessed(struct zram *zram, u32 index)
 {
-	zram_clear_flag(zram, index, ZRAM_IDLE);
+	zram_clear_idle(zram, index);
 };
 static void zram_debugfs_register(struct zram *zram) {};
 static void zram_debugfs_unregister(struct zram *zram) {};
@@ -999,6 +1157,63 @@ static ssize_t max_comp_streams_store(struct device *dev,
 	return len;
 }
 
+static ssize_t async_write_show(struct device *dev,
+		struct device_attribute *attr, char *buf)
+{
+	struct zram *zram = dev_to_zram(dev);
+
+	return scnprintf(buf, PAGE_SIZE, "%d\n", READ_ONCE(zram->async_write));
+}
+
+static ssize_t async_write_store(struct device *dev,
+		struct device_attribute *attr, const char *buf, size_t len)
+{
+	struct zram *zram = dev_to_zram(dev);
+	bool val;
+
+	if (strtobool(buf, &val))
+		return -EINVAL;
+
+	WRITE_ONCE(zram->async_write, val);
+	return len;
+}
+
+#ifdef CONFIG_ZRAM_DEDUP
+static ssize_t use_dedup_show(struct device *dev,
+		struct device_attribute *attr, char *buf)
+{
+	struct zram *zram = dev_to_zram(dev);
+	bool val;
+
+	down_read(&zram->init_lock);
+	val = zram->use_dedup;
+	up_read(&zram->init_lock);
+
+	return scnprintf(buf, PAGE_SIZE, "%d\n", val);
+}
+
+static ssize_t use_dedup_store(struct device *dev,
+		struct device_attribute *attr, const char *buf, size_t len)
+{
+	struct zram *zram = dev_to_zram(dev);
+	bool val;
+
+	if (strtobool(buf, &val))
+		return -EINVAL;
+
+	down_write(&zram->init_lock);
+	if (init_done(zram)) {
+		up_write(&zram->init_lock);
+		pr_info("Can't change dedup usage for initialized device\n");
+		return -EBUSY;
+	}
+	zram->use_dedup = val;
+	up_write(&zram->init_lock);
+
+	return len;
+}
+#endif
+
 static ssize_t comp_algorithm_show(struct device *dev,
 		struct device_attribute *attr, char *buf)
 {
@@ -1040,6 +1255,180 @@ static ssize_t comp_algorithm_store(struct device *dev,
 	return len;
 }
 
+static ssize_t recomp_algorithm_show(struct device *dev,
+		struct device_attribute *attr, char *buf)
+{
+	size_t sz;
+	struct zram *zram = dev_to_zram(dev);
+
+	down_read(&zram->init_lock);
+	sz = zcomp_available_show(zram->recomp_algorithm, buf);
+	up_read(&zram->init_lock);
+
+	return sz;
+}
+
+static ssize_t recomp_algorithm_store(struct device *dev,
+		struct device_attribute *attr, const char *buf, size_t len)
+{
+	struct zram *zram = dev_to_zram(dev);
+	char compressor[ARRAY_SIZE(zram->recomp_algorithm)];
+	size_t sz;
+
+	strlcpy(compressor, buf, sizeof(compressor));
+	/* ignore trailing newline */
+	sz = strlen(compressor);
+	if (sz > 0 && compressor[sz - 1] == '\n')
+		compressor[sz - 1] = 0x00;
+
+	/* "none" disables recompression */
+	if (!strcmp(compressor, "none"))
+		compressor[0] = 0x00;
+	else if (!zcomp_available_algorithm(compressor))
+		return -EINVAL;
+
+	down_write(&zram->init_lock);
+	if (init_done(zram)) {
+		up_write(&zram->init_lock);
+		pr_info("Can't change algorithm for initialized device\n");
+		return -EBUSY;
+	}
+
+	strcpy(zram->recomp_algorithm, compressor);
+	up_write(&zram->init_lock);
+	return len;
+}
+
+/*
+ * Recompress one idle slot with the secondary algorithm. The slot lock is
+ * held throughout so neither writes nor writeback can race with us; a slot
+ * the secondary algorithm can not shrink is marked so that later passes
+ * leave it alone. Caller should hold this table index entry's bit_spinlock.
+ */
+static int zram_recompress(struct zram *zram, u32 index, struct page *page)
+{
+	unsigned long handle;
+	unsigned int comp_len_old, comp_len_new, age;
+	struct zcomp_strm *zstrm;
+	void *src, *dst;
+	int ret;
+
+	comp_len_old = zram_get_obj_size(zram, index);
+	age = zram_get_idle_age(zram, index);
+	ret = zram_read_from_zspool(zram, page, index);
+	if (ret)
+		return ret;
+
+	zstrm = zcomp_stream_get(zram->recomp);
+	src = kmap_atomic(page);
+	ret = zcomp_compress(zstrm, src, &comp_len_new);
+	kunmap_atomic(src);
+	if (ret) {
+		zcomp_stream_put(zram->recomp);
+		return ret;
+	}
+
+	if (comp_len_new >= huge_class_size || comp_len_new >= comp_len_old) {
+		zcomp_stream_put(zram->recomp);
+		zram_set_flag(zram, index, ZRAM_INCOMPRESSIBLE);
+		return 0;
+	}
+
+	/* we can't sleep here, so don't enter direct reclaim */
+	handle = zs_malloc(zram->mem_pool, comp_len_new,
+			__GFP_KSWAPD_RECLAIM |
+			__GFP_NOWARN |
+			__GFP_HIGHMEM |
+			__GFP_MOVABLE |
+			__GFP_CMA);
+	if (!handle) {
+		zcomp_stream_put(zram->recomp);
+		return -ENOMEM;
+	}
+
+	dst = zs_map_object(zram->mem_pool, handle, ZS_MM_WO);
+	memcpy(dst, zstrm->buffer, comp_len_new);
+	zcomp_stream_put(zram->recomp);
+	zs_unmap_object(zram->mem_pool, handle);
+
+	zram_free_page(zram, index);
+	zram_set_handle(zram, index, handle);
+	zram_set_obj_size(zram, index, comp_len_new);
+	zram_set_flag(zram, index, ZRAM_RECOMP);
+	/* the page is no hotter than it was, keep it visible to writeback */
+	zram_set_flag(zram, index, ZRAM_IDLE);
+	zram_set_idle_age(zram, index, age);
+
+	atomic64_add(comp_len_new, &zram->stats.compr_data_size);
+	atomic64_inc(&zram->stats.pages_stored);
+	atomic64_inc(&zram->stats.recomp_pages);
+	return 0;
+}
+
+static void zram_recompress_work(struct work_struct *work)
+{
+	struct zram *zram = container_of(work, struct zram, recomp_work);
+	unsigned long nr_pages, index;
+	struct page *page;
+	int ret = 0;
+
+	down_read(&zram->init_lock);
+	if (!init_done(zram) || !zram->recomp)
+		goto release_init_lock;
+
+	page = alloc_page(GFP_KERNEL);
+	if (!page)
+		goto release_init_lock;
+
+	nr_pages = zram->disksize >> PAGE_SHIFT;
+	for (index = 0; index < nr_pages && ret != -ENOMEM; index++) {
+		zram_slot_lock(zram, index);
+		if (!zram_allocated(zram, index))
+			goto next;
+
+		if (zram_test_flag(zram, index, ZRAM_WB) ||
+				zram_test_flag(zram, index, ZRAM_SAME) ||
+				zram_test_flag(zram, index, ZRAM_UNDER_WB) ||
+				zram_test_flag(zram, index, ZRAM_RECOMP) ||
+				zram_test_flag(zram, index, ZRAM_INCOMPRESSIBLE) ||
+				zram_test_flag(zram, index, ZRAM_DEDUP))
+			goto next;
+
+		if (!zram_test_flag(zram, index, ZRAM_IDLE))
+			goto next;
+
+		ret = zram_recompress(zram, index, page);
+next:
+		zram_slot_unlock(zram, index);
+		cond_resched();
+	}
+
+	__free_page(page);
+release_init_lock:
+	up_read(&zram->init_lock);
+}
+
+static ssize_t recompress_store(struct device *dev,
+		struct device_attribute *attr, const char *buf, size_t len)
+{
+	struct zram *zram = dev_to_zram(dev);
+	ssize_t ret = len;
+
+	if (!sysfs_streq(buf, "idle"))
+		return -EINVAL;
+
+	down_read(&zram->init_lock);
+	if (!init_done(zram))
+		ret = -EINVAL;
+	else if (!zram->recomp)
+		ret = -ENODEV;
+	else
+		queue_work(system_unbound_wq, &zram->recomp_work);
+	up_read(&zram->init_lock);
+
+	return ret;
+}
+
 static ssize_t compact_store(struct device *dev,
 		struct device_attribute *attr, const char *buf, size_t len)
 {
@@ -1065,11 +1454,13 @@ static ssize_t io_stat_show(struct device *dev,
 
 	down_read(&zram->init_lock);
 	ret = scnprintf(buf, PAGE_SIZE,
-			"%8llu %8llu %8llu %8llu\n",
+			"%8llu %8llu %8llu %8llu %8llu %8llu\n",
 			(u64)atomic64_read(&zram->stats.failed_reads),
 			(u64)atomic64_read(&zram->stats.failed_writes),
 			(u64)atomic64_read(&zram->stats.invalid_io),
-			(u64)atomic64_read(&zram->stats.notify_free));
+			(u64)atomic64_read(&zram->stats.notify_free),
+			(u64)atomic64_read(&zram->stats.async_writes),
+			(u64)atomic64_read(&zram->stats.async_depth));
 	up_read(&zram->init_lock);
 
 	return ret;
@@ -1096,7 +1487,7 @@ static ssize_t mm_stat_show(struct device *dev,
 	max_used = atomic_long_read(&zram->stats.max_used_pages);
 
 	ret = scnprintf(buf, PAGE_SIZE,
-			"%8llu %8llu %8llu %8lu %8ld %8llu %8lu %8llu\n",
+			"%8llu %8llu %8llu %8lu %8ld %8llu %8lu %8llu %8llu %8llu %8llu %8llu %8llu\n",
 			orig_size << PAGE_SHIFT,
 			(u64)atomic64_read(&zram->stats.compr_data_size),
 			mem_used << PAGE_SHIFT,
@@ -1104,7 +1495,12 @@ static ssize_t mm_stat_show(struct device *dev,
 			max_used << PAGE_SHIFT,
 			(u64)atomic64_read(&zram->stats.same_pages),
 			atomic_long_read(&pool_stats.pages_compacted),
-			(u64)atomic64_read(&zram->stats.huge_pages));
+			(u64)atomic64_read(&zram->stats.huge_pages),
+			(u64)atomic64_read(&zram->stats.recomp_pages),
+			(u64)atomic64_read(&zram->stats.dup_data_size),
+			(u64)atomic64_read(&zram->stats.meta_data_size),
+			(u64)atomic64_read(&zram->stats.dedup_hits),
+			(u64)atomic64_read(&zram->stats.dedup_lookups));
 	up_read(&zram->init_lock);
 
 	return ret;
@@ -1137,12 +1533,28 @@ static ssize_t debug_stat_show(struct device *dev,
 	struct zram *zram = dev_to_zram(dev);
 	ssize_t ret;
 
+	int cpu;
+
 	down_read(&zram->init_lock);
 	ret = scnprintf(buf, PAGE_SIZE,
 			"version: %d\n%8llu %8llu\n",
 			version,
 			(u64)atomic64_read(&zram->stats.writestall),
 			(u64)atomic64_read(&zram->stats.miss_free));
+	/* cpu, queued, max queued, pages compressed, ns spent compressing */
+	for_each_online_cpu(cpu) {
+		struct zram_comp_worker *worker;
+
+		worker = per_cpu_ptr(zram->comp_workers, cpu);
+		if (!worker->pages && !worker->depth)
+			continue;
+		spin_lock(&worker->lock);
+		ret += scnprintf(buf + ret, PAGE_SIZE - ret,
+				"worker%d: %8u %8u %8llu %12llu\n",
+				cpu, worker->depth, worker->max_depth,
+				worker->pages, worker->busy_ns);
+		spin_unlock(&worker->lock);
+	}
 	up_read(&zram->init_lock);
 
 	return ret;
@@ -1164,6 +1576,7 @@ static void zram_meta_free(struct zram *zram, u64 disksize)
 	for (index = 0; index < num_pages; index++)
 		zram_free_page(zram, index);
 
+	zram_dedup_fini(zram);
 	zs_destroy_pool(zram->mem_pool);
 	vfree(zram->table);
 }
@@ -1183,6 +1596,12 @@ static bool zram_meta_alloc(struct zram *zram, u64 disksize)
 		return false;
 	}
 
+	if (zram_dedup_init(zram, num_pages)) {
+		zs_destroy_pool(zram->mem_pool);
+		vfree(zram->table);
+		return false;
+	}
+
 	if (!huge_class_size)
 		huge_class_size = zs_huge_class_size(zram->mem_pool);
 	return true;
@@ -1200,8 +1619,15 @@ static void zram_free_page(struct zram *zram, size_t index)
 #ifdef CONFIG_ZRAM_MEMORY_TRACKING
 	zram->table[index].ac_time.tv64 = 0;
 #endif
-	if (zram_test_flag(zram, index, ZRAM_IDLE))
-		zram_clear_flag(zram, index, ZRAM_IDLE);
+	zram_clear_idle(zram, index);
+
+	if (zram_test_flag(zram, index, ZRAM_RECOMP)) {
+		zram_clear_flag(zram, index, ZRAM_RECOMP);
+		atomic64_dec(&zram->stats.recomp_pages);
+	}
+
+	if (zram_test_flag(zram, index, ZRAM_INCOMPRESSIBLE))
+		zram_clear_flag(zram, index, ZRAM_INCOMPRESSIBLE);
 
 	if (zram_test_flag(zram, index, ZRAM_HUGE)) {
 		zram_clear_flag(zram, index, ZRAM_HUGE);
@@ -1228,6 +1654,12 @@ static void zram_free_page(struct zram *zram, size_t index)
 	if (!handle)
 		return;
 
+	if (zram_test_flag(zram, index, ZRAM_DEDUP)) {
+		zram_dedup_put(zram, zram_get_dedup_entry(zram, index));
+		zram_clear_flag(zram, index, ZRAM_DEDUP);
+		goto out;
+	}
+
 	zs_free(zram->mem_pool, handle);
 
 	atomic64_sub(zram_get_obj_size(zram, index),
@@ -1240,28 +1672,18 @@ static void zram_free_page(struct zram *zram, size_t index)
 		~(1UL << ZRAM_LOCK | 1UL << ZRAM_UNDER_WB));
 }
 
-static int __zram_bvec_read(struct zram *zram, struct page *page, u32 index,
-				struct bio *bio, bool partial_io)
+/*
+ * Decompress a slot that lives in zsmalloc (or is same filled) into @page.
+ * Caller should hold this table index entry's bit_spinlock.
+ */
+static int zram_read_from_zspool(struct zram *zram, struct page *page,
+				 u32 index)
 {
 	int ret;
 	unsigned long handle;
 	unsigned int size;
 	void *src, *dst;
 
-	zram_slot_lock(zram, index);
-	if (zram_test_flag(zram, index, ZRAM_WB)) {
-		struct bio_vec bvec;
-
-		zram_slot_unlock(zram, index);
-
-		bvec.bv_page = page;
-		bvec.bv_len = PAGE_SIZE;
-		bvec.bv_offset = 0;
-		return read_from_bdev(zram, &bvec,
-				zram_get_element(zram, index),
-				bio, partial_io);
-	}
-
 	handle = zram_get_handle(zram, index);
 	if (!handle || zram_test_flag(zram, index, ZRAM_SAME)) {
 		unsigned long value;
@@ -1271,7 +1693,6 @@ static int __zram_bvec_read(struct zram *zram, struct page *page, u32 index,
 		mem = kmap_atomic(page);
 		zram_fill_page(mem, PAGE_SIZE, value);
 		kunmap_atomic(mem);
-		zram_slot_unlock(zram, index);
 		return 0;
 	}
 
@@ -1284,14 +1705,43 @@ static int __zram_bvec_read(struct zram *zram, struct page *page, u32 index,
 		kunmap_atomic(dst);
 		ret = 0;
 	} else {
-		struct zcomp_strm *zstrm = zcomp_stream_get(zram->comp);
+		struct zcomp *comp = zram->comp;
+		struct zcomp_strm *zstrm;
 
+		if (zram_test_flag(zram, index, ZRAM_RECOMP))
+			comp = zram->recomp;
+
+		zstrm = zcomp_stream_get(comp);
 		dst = kmap_atomic(page);
 		ret = zcomp_decompress(zstrm, src, size, dst);
 		kunmap_atomic(dst);
-		zcomp_stream_put(zram->comp);
+		zcomp_stream_put(comp);
 	}
 	zs_unmap_object(zram->mem_pool, handle);
+
+	return ret;
+}
+
+static int __zram_bvec_read(struct zram *zram, struct page *page, u32 index,
+				struct bio *bio, bool partial_io)
+{
+	int ret;
+
+	zram_slot_lock(zram, index);
+	if (zram_test_flag(zram, index, ZRAM_WB)) {
+		struct bio_vec bvec;
+
+		zram_slot_unlock(zram, index);
+
+		bvec.bv_page = page;
+		bvec.bv_len = PAGE_SIZE;
+		bvec.bv_offset = 0;
+		return read_from_bdev(zram, &bvec,
+				zram_get_element(zram, index),
+				bio, partial_io);
+	}
+
+	ret = zram_read_from_zspool(zram, page, index);
 	zram_slot_unlock(zram, index);
 
 	/* Should NEVER happen. Return bio error if it does. */
@@ -1346,6 +1796,8 @@ static int __zram_bvec_write(struct zram *zram, struct bio_vec *bvec,
 	struct page *page = bvec->bv_page;
 	unsigned long element = 0;
 	enum zram_pageflags flags = 0;
+	struct zram_dedup_entry *entry = NULL;
+	u32 checksum = 0;
 
 	mem = kmap_atomic(page);
 	if (page_same_filled(mem, &element)) {
@@ -1372,6 +1824,23 @@ static int __zram_bvec_write(struct zram *zram, struct bio_vec *bvec,
 
 	if (comp_len >= huge_class_size)
 		comp_len = PAGE_SIZE;
+
+	if (zram_dedup_enabled(zram)) {
+		src = zstrm->buffer;
+		if (comp_len == PAGE_SIZE)
+			src = kmap_atomic(page);
+		checksum = zram_dedup_checksum(src, comp_len);
+		/* The slow path already owns a handle, just store into it */
+		if (!handle)
+			entry = zram_dedup_find(zram, src, comp_len, checksum);
+		if (comp_len == PAGE_SIZE)
+			kunmap_atomic(src);
+		if (entry) {
+			zcomp_stream_put(zram->comp);
+			goto out;
+		}
+	}
+
 	/*
 	 * handle allocation has 2 paths:
 	 * a) fast path is executed with preemption disabled (for
@@ -1424,6 +1893,9 @@ static int __zram_bvec_write(struct zram *zram, struct bio_vec *bvec,
 	zcomp_stream_put(zram->comp);
 	zs_unmap_object(zram->mem_pool, handle);
 	atomic64_add(comp_len, &zram->stats.compr_data_size);
+
+	if (zram_dedup_enabled(zram))
+		entry = zram_dedup_insert(zram, handle, comp_len, checksum);
 out:
 	/*
 	 * Free memory associated with this sector
@@ -1440,7 +1912,11 @@ static int __zram_bvec_write(struct zram *zram, struct bio_vec *bvec,
 	if (flags) {
 		zram_set_flag(zram, index, flags);
 		zram_set_element(zram, index, element);
-	}  else {
+	} else if (entry) {
+		zram_set_flag(zram, index, ZRAM_DEDUP);
+		zram_set_handle(zram, index, (unsigned long)entry);
+		zram_set_obj_size(zram, index, comp_len);
+	} else {
 		zram_set_handle(zram, index, handle);
 		zram_set_obj_size(zram, index, comp_len);
 	}
@@ -1492,6 +1968,131 @@ static int zram_bvec_write(struct zram *zram, struct bio_vec *bvec,
 	return ret;
 }
 
+/* One full page write handed to a compression worker */
+struct zram_comp_req {
+	struct list_head list;
+	struct page *page;
+	u32 index;
+	struct bio *bio;		/* NULL for ->rw_page writes */
+	unsigned long start_time;
+};
+
+static void zram_comp_req_end(struct zram *zram, struct zram_comp_req *req,
+			      int ret)
+{
+	generic_end_io_acct(REQ_OP_WRITE, &zram->disk->part0,
+			req->start_time);
+
+	zram_slot_lock(zram, req->index);
+	zram_accessed(zram, req->index);
+	zram_slot_unlock(zram, req->index);
+
+	if (unlikely(ret < 0))
+		atomic64_inc(&zram->stats.failed_writes);
+
+	if (req->bio) {
+		if (unlikely(ret < 0))
+			req->bio->bi_error = ret;
+		bio_endio(req->bio);
+	} else {
+		page_endio(req->page, true, ret < 0 ? ret : 0);
+	}
+}
+
+static void zram_comp_work(struct work_struct *work)
+{
+	struct zram_comp_worker *worker =
+		container_of(work, struct zram_comp_worker, work);
+	struct zram *zram = worker->zram;
+	struct zram_comp_req *req, *tmp;
+	unsigned int nr = 0;
+	LIST_HEAD(reqs);
+	u64 start;
+
+	spin_lock(&worker->lock);
+	list_splice_init(&worker->reqs, &reqs);
+	spin_unlock(&worker->lock);
+
+	start = ktime_get_ns();
+	list_for_each_entry_safe(req, tmp, &reqs, list) {
+		struct bio_vec bvec;
+		int ret;
+
+		bvec.bv_page = req->page;
+		bvec.bv_len = PAGE_SIZE;
+		bvec.bv_offset = 0;
+
+		ret = __zram_bvec_write(zram, &bvec, req->index, req->bio);
+		zram_comp_req_end(zram, req, ret);
+		kfree(req);
+		nr++;
+	}
+
+	spin_lock(&worker->lock);
+	worker->depth -= nr;
+	worker->pages += nr;
+	worker->busy_ns += ktime_get_ns() - start;
+	spin_unlock(&worker->lock);
+	atomic64_sub(nr, &zram->stats.async_depth);
+	atomic64_add(nr, &zram->stats.async_writes);
+}
+
+/* Spread writes round robin over the online cpus */
+static unsigned int zram_next_worker(struct zram *zram)
+{
+	unsigned int cpu;
+
+	cpu = (unsigned int)atomic_inc_return(&zram->next_worker) % nr_cpu_ids;
+	cpu = cpumask_next(cpu - 1, cpu_online_mask);
+	if (cpu >= nr_cpu_ids)
+		cpu = cpumask_first(cpu_online_mask);
+
+	return cpu;
+}
+
+/*
+ * Hand a full page write to the next compression worker. Returns 1 if the
+ * write was queued; the worker then completes @bio (or the page when there
+ * is no bio) once the page is stored. Returns 0 if the caller should write
+ * the page synchronously.
+ */
+static int zram_queue_write(struct zram *zram, struct bio_vec *bvec,
+			    u32 index, struct bio *bio,
+			    unsigned long start_time)
+{
+	struct zram_comp_worker *worker;
+	struct zram_comp_req *req;
+	unsigned int cpu;
+
+	if (!READ_ONCE(zram->async_write) || is_partial_io(bvec) ||
+			bvec->bv_offset)
+		return 0;
+
+	req = kmalloc(sizeof(*req), GFP_NOWAIT | __GFP_NOWARN);
+	if (!req)
+		return 0;
+
+	req->page = bvec->bv_page;
+	req->index = index;
+	req->bio = bio;
+	req->start_time = start_time;
+	if (bio)
+		bio_inc_remaining(bio);
+
+	cpu = zram_next_worker(zram);
+	worker = per_cpu_ptr(zram->comp_workers, cpu);
+
+	spin_lock(&worker->lock);
+	list_add_tail(&req->list, &worker->reqs);
+	if (++worker->depth > worker->max_depth)
+		worker->max_depth = worker->depth;
+	spin_unlock(&worker->lock);
+	atomic64_inc(&zram->stats.async_depth);
+
+	queue_work_on(cpu, zram_comp_wq, &worker->work);
+	return 1;
+}
+
 /*
  * zram_bio_discard - handler on discard request
  * @index: physical block index in PAGE_SIZE units
@@ -1551,6 +2152,9 @@ static int zram_bvec_rw(struct zram *zram, struct bio_vec *bvec, u32 index,
 		flush_dcache_page(bvec->bv_page);
 	} else {
 		atomic64_inc(&zram->stats.num_writes);
+		/* accounting is finished by the worker */
+		if (zram_queue_write(zram, bvec, index, bio, start_time))
+			return 1;
 		ret = zram_bvec_write(zram, bvec, index, offset, bio);
 	}
 
@@ -1699,11 +2303,22 @@ static int zram_rw_page(struct block_device *bdev, sector_t sector,
 	return ret;
 }
 
+/* Wait for every queued asynchronous write to be stored */
+static void zram_flush_comp_workers(struct zram *zram)
+{
+	int cpu;
+
+	for_each_possible_cpu(cpu)
+		flush_work(&per_cpu_ptr(zram->comp_workers, cpu)->work);
+}
+
 static void zram_reset_device(struct zram *zram)
 {
-	struct zcomp *comp;
+	struct zcomp *comp, *recomp;
 	u64 disksize;
 
+	cancel_work_sync(&zram->recomp_work);
+	zram_flush_comp_workers(zram);
 	down_write(&zram->init_lock);
 
 	zram->limit_pages = 0;
@@ -1714,6 +2329,8 @@ static void zram_reset_device(struct zram *zram)
 	}
 
 	comp = zram->comp;
+	recomp = zram->recomp;
+	zram->recomp = NULL;
 	disksize = zram->disksize;
 	zram->disksize = 0;
 
@@ -1725,6 +2342,8 @@ static void zram_reset_device(struct zram *zram)
 	zram_meta_free(zram, disksize);
 	memset(&zram->stats, 0, sizeof(zram->stats));
 	zcomp_destroy(comp);
+	if (recomp)
+		zcomp_destroy(recomp);
 	reset_bdev(zram);
 }
 
@@ -1761,6 +2380,18 @@ static ssize_t disksize_store(struct device *dev,
 		goto out_free_meta;
 	}
 
+	if (zram->recomp_algorithm[0]) {
+		zram->recomp = zcomp_create(zram->recomp_algorithm);
+		if (IS_ERR(zram->recomp)) {
+			pr_err("Cannot initialise %s recompressing backend\n",
+					zram->recomp_algorithm);
+			err = PTR_ERR(zram->recomp);
+			zram->recomp = NULL;
+			zcomp_destroy(comp);
+			goto out_free_meta;
+		}
+	}
+
 	zram->comp = comp;
 	zram->disksize = disksize;
 	set_capacity(zram->disk, zram->disksize >> SECTOR_SHIFT);
@@ -1852,7 +2483,13 @@ static DEVICE_ATTR_WO(mem_limit);
 static DEVICE_ATTR_WO(mem_used_max);
 static DEVICE_ATTR_WO(idle);
 static DEVICE_ATTR_RW(max_comp_streams);
+static DEVICE_ATTR_RW(async_write);
+#ifdef CONFIG_ZRAM_DEDUP
+static DEVICE_ATTR_RW(use_dedup);
+#endif
 static DEVICE_ATTR_RW(comp_algorithm);
+static DEVICE_ATTR_RW(recomp_algorithm);
+static DEVICE_ATTR_WO(recompress);
 #ifdef CONFIG_ZRAM_WRITEBACK
 static DEVICE_ATTR_RW(backing_dev);
 static DEVICE_ATTR_WO(writeback);
@@ -1869,7 +2506,13 @@ static struct attribute *zram_disk_attrs[] = {
 	&dev_attr_mem_used_max.attr,
 	&dev_attr_idle.attr,
 	&dev_attr_max_comp_streams.attr,
+	&dev_attr_async_write.attr,
+#ifdef CONFIG_ZRAM_DEDUP
+	&dev_attr_use_dedup.attr,
+#endif
 	&dev_attr_comp_algorithm.attr,
+	&dev_attr_recomp_algorithm.attr,
+	&dev_attr_recompress.attr,
 #ifdef CONFIG_ZRAM_WRITEBACK
 	&dev_attr_backing_dev.attr,
 	&dev_attr_writeback.attr,
@@ -1902,18 +2545,35 @@ static int zram_add(void)
 {
 	struct zram *zram;
 	struct request_queue *queue;
-	int ret, device_id;
+	int ret, device_id, cpu;
 
 	zram = kzalloc(sizeof(struct zram), GFP_KERNEL);
 	if (!zram)
 		return -ENOMEM;
 
+	zram->comp_workers = alloc_percpu(struct zram_comp_worker);
+	if (!zram->comp_workers) {
+		ret = -ENOMEM;
+		goto out_free_dev;
+	}
+
+	for_each_possible_cpu(cpu) {
+		struct zram_comp_worker *worker;
+
+		worker = per_cpu_ptr(zram->comp_workers, cpu);
+		INIT_WORK(&worker->work, zram_comp_work);
+		worker->zram = zram;
+		spin_lock_init(&worker->lock);
+		INIT_LIST_HEAD(&worker->reqs);
+	}
+
 	ret = idr_alloc(&zram_index_idr, zram, 0, 0, GFP_KERNEL);
 	if (ret < 0)
-		goto out_free_dev;
+		goto out_free_workers;
 	device_id = ret;
 
 	init_rwsem(&zram->init_lock);
+	INIT_WORK(&zram->recomp_work, zram_recompress_work);
 #ifdef CONFIG_ZRAM_WRITEBACK
 	spin_lock_init(&zram->wb_limit_lock);
 #endif
@@ -1992,6 +2652,8 @@ static int zram_add(void)
 	blk_cleanup_queue(queue);
 out_free_idr:
 	idr_remove(&zram_index_idr, device_id);
+out_free_workers:
+	free_percpu(zram->comp_workers);
 out_free_dev:
 	kfree(zram);
 	return ret;
@@ -2025,8 +2687,11 @@ static int zram_remove(struct zram *zram)
 	pr_info("Removed device: %s\n", zram->disk->disk_name);
 
 	del_gendisk(zram->disk);
+	/* sysfs is gone, nobody can queue recompression any more */
+	cancel_work_sync(&zram->recomp_work);
 	blk_cleanup_queue(zram->disk->queue);
 	put_disk(zram->disk);
+	free_percpu(zram->comp_workers);
 	kfree(zram);
 	return 0;
 }
@@ -2108,15 +2773,26 @@ static void destroy_devices(void)
 	zram_debugfs_destroy();
 	idr_destroy(&zram_index_idr);
 	unregister_blkdev(zram_major, "zram");
+	destroy_workqueue(zram_comp_wq);
 }
 
 static int __init zram_init(void)
 {
 	int ret;
 
+	/*
+	 * Asynchronous writes are issued from the swap out path, so the
+	 * workers need a rescuer to make forward progress under pressure.
+	 */
+	zram_comp_wq = alloc_workqueue("zram_comp",
+				       WQ_HIGHPRI | WQ_MEM_RECLAIM, 0);
+	if (!zram_comp_wq)
+		return -ENOMEM;
+
 	ret = class_register(&zram_control_class);
 	if (ret) {
 		pr_err("Unable to register zram-control class\n");
+		destroy_workqueue(zram_comp_wq);
 		return ret;
 	}
 
@@ -2125,6 +2801,7 @@ static int __init zram_init(void)
 	if (zram_major <= 0) {
 		pr_err("Unable to get major number\n");
 		class_unregister(&zram_control_class);
+		destroy_workqueue(zram_comp_wq);
 		return -EBUSY;
 	}
 
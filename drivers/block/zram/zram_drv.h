@@ -18,8 +18,10 @@
 #include <linux/rwsem.h>
 #include <linux/zsmalloc.h>
 #include <linux/crypto.h>
+#include <linux/workqueue.h>
 
 #include "zcomp.h"
+#include "zram_dedup.h"
 
 #define SECTORS_PER_PAGE_SHIFT	(PAGE_SHIFT - SECTOR_SHIFT)
 #define SECTORS_PER_PAGE	(1 << SECTORS_PER_PAGE_SHIFT)
@@ -37,9 +39,14 @@
  * zram is mainly used for memory efficiency so we want to keep memory
  * footprint small so we can squeeze size and flags into a field.
  * The lower ZRAM_FLAG_SHIFT bits is for object size (excluding header),
- * the higher bits is for zram_pageflags.
+ * the higher bits is for zram_pageflags. An object is at most PAGE_SIZE,
+ * so PAGE_SHIFT + 1 bits are enough for its size.
  */
-#define ZRAM_FLAG_SHIFT 24
+#define ZRAM_FLAG_SHIFT (PAGE_SHIFT + 1)
+
+/* Idle slots age through ZRAM_IDLE_AGE_MAX buckets, see idle_store() */
+#define ZRAM_IDLE_AGE_BITS	2
+#define ZRAM_IDLE_AGE_MAX	((1 << ZRAM_IDLE_AGE_BITS) - 1)
 
 /* Flags for zram pages (table[page_no].flags) */
 enum zram_pageflags {
@@ -50,6 +57,11 @@ enum zram_pageflags {
 	ZRAM_UNDER_WB,	/* page is under writeback */
 	ZRAM_HUGE,	/* Incompressible page */
 	ZRAM_IDLE,	/* not accessed page since last idle marking */
+	ZRAM_RECOMP,	/* compressed with the secondary algorithm */
+	ZRAM_INCOMPRESSIBLE, /* secondary algorithm did not shrink it */
+	ZRAM_DEDUP,	/* handle points to a shared zram_dedup_entry */
+	ZRAM_IDLE_AGE,	/* first bit of the idle age bucket */
+	__ZRAM_IDLE_AGE_END = ZRAM_IDLE_AGE + ZRAM_IDLE_AGE_BITS - 1,
 
 	__NR_ZRAM_PAGEFLAGS,
 };
@@ -82,6 +94,13 @@ struct zram_stats {
 	atomic_long_t max_used_pages;	/* no. of maximum pages stored */
 	atomic64_t writestall;		/* no. of write slow paths */
 	atomic64_t miss_free;		/* no. of missed free */
+	atomic64_t recomp_pages;	/* no. of pages stored recompressed */
+	atomic64_t async_writes;	/* no. of pages compressed by workers */
+	atomic64_t async_depth;		/* no. of pages queued to workers */
+	atomic64_t dup_data_size;	/* compressed bytes saved by dedup */
+	atomic64_t meta_data_size;	/* bytes spent on dedup entries */
+	atomic64_t dedup_hits;		/* no. of writes that shared an object */
+	atomic64_t dedup_lookups;	/* no. of writes looked up for dedup */
 #ifdef	CONFIG_ZRAM_WRITEBACK
 	atomic64_t bd_count;		/* no. of pages in backing device */
 	atomic64_t bd_reads;		/* no. of reads from backing device */
@@ -89,6 +108,21 @@ struct zram_stats {
 #endif
 };
 
+/*
+ * Per-cpu compression worker for asynchronous writes. Requests are queued
+ * under @lock and the whole list is compressed in one go by @work.
+ */
+struct zram_comp_worker {
+	struct work_struct work;
+	struct zram *zram;
+	spinlock_t lock;
+	struct list_head reqs;
+	unsigned int depth;		/* requests currently queued */
+	unsigned int max_depth;
+	u64 pages;			/* pages compressed */
+	u64 busy_ns;			/* time spent compressing them */
+};
+
 struct zram {
 	struct zram_table_entry *table;
 	struct zs_pool *mem_pool;
@@ -108,6 +142,30 @@ struct zram {
 	 */
 	u64 disksize;	/* bytes */
 	char compressor[CRYPTO_MAX_ALG_NAME];
+	/*
+	 * Optional stronger algorithm idle pages are recompressed with in
+	 * the background; empty when disabled.
+	 */
+	struct zcomp *recomp;
+	char recomp_algorithm[CRYPTO_MAX_ALG_NAME];
+	struct work_struct recomp_work;
+	/*
+	 * Hand full page writes to the per-cpu compression workers and
+	 * complete the bio once they are stored.
+	 */
+	bool async_write;
+	atomic_t next_worker;
+	struct zram_comp_worker __percpu *comp_workers;
+#ifdef CONFIG_ZRAM_DEDUP
+	/*
+	 * Identical objects are stored once and shared through a hash of
+	 * their content; see zram_dedup.c.
+	 */
+	bool use_dedup;
+	spinlock_t dedup_lock;
+	struct hlist_head *dedup_hash;
+	unsigned int dedup_bits;
+#endif
 	/*
 	 * zram is claimed so open request will be failed
 	 */
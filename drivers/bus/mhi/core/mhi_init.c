@@ -200,6 +200,9 @@ void mhi_deinit_free_irq(struct mhi_controller *mhi_cntrl)
 		if (!mhi_event->request_irq)
 			continue;
 
+		if (mhi_event->cpu >= 0)
+			irq_set_affinity_hint(mhi_cntrl->irq[mhi_event->msi],
+					      NULL);
 		free_irq(mhi_cntrl->irq[mhi_event->msi], mhi_event);
 	}
 
@@ -232,6 +235,17 @@ int mhi_init_irq_setup(struct mhi_controller *mhi_cntrl)
 				mhi_cntrl->irq[mhi_event->msi], i);
 			goto error_request;
 		}
+
+		/*
+		 * client managed rings are polled from the irq context that
+		 * schedules the client (napi), so pinning the irq also pins
+		 * the data path of that ring.
+		 */
+		if (mhi_event->cpu >= 0 &&
+		    irq_set_affinity_hint(mhi_cntrl->irq[mhi_event->msi],
+					  cpumask_of(mhi_event->cpu)))
+			MHI_ERR("Failed to set affinity of ev:%d to cpu:%d\n",
+				i, mhi_event->cpu);
 	}
 
 	return 0;
@@ -241,6 +255,9 @@ int mhi_init_irq_setup(struct mhi_controller *mhi_cntrl)
 		if (!mhi_event->request_irq)
 			continue;
 
+		if (mhi_event->cpu >= 0)
+			irq_set_affinity_hint(mhi_cntrl->irq[mhi_event->msi],
+					      NULL);
 		free_irq(mhi_cntrl->irq[mhi_event->msi], mhi_event);
 	}
 	free_irq(mhi_cntrl->irq[0], mhi_cntrl);
@@ -916,6 +933,7 @@ static int of_parse_ev_cfg(struct mhi_controller *mhi_cntrl,
 			   struct device_node *of_node)
 {
 	int i, ret, num = 0;
+	u32 cpu;
 	struct mhi_event *mhi_event;
 	struct device_node *child;
 
@@ -977,6 +995,12 @@ static int of_parse_ev_cfg(struct mhi_controller *mhi_cntrl,
 		if (ret)
 			goto error_ev_cfg;
 
+		ret = of_property_read_u32(child, "mhi,cpu", &cpu);
+		if (!ret && cpu < nr_cpu_ids && cpu_possible(cpu))
+			mhi_event->cpu = cpu;
+		else
+			mhi_event->cpu = -1;
+
 		ret = of_property_read_u32(child, "mhi,brstmode",
 					   &mhi_event->db_cfg.brstmode);
 		if (ret || MHI_INVALID_BRSTMODE(mhi_event->db_cfg.brstmode))
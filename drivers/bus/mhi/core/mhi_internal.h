@@ -640,9 +640,16 @@ struct mhi_event {
 	bool cl_manage;
 	bool offload_ev; /* managed by a device driver */
 	bool request_irq; /* has dedicated interrupt handler */
+	int cpu; /* irq affinity, -1 if not pinned */
 	spinlock_t lock;
 	struct mhi_chan *mhi_chan; /* dedicated to channel */
 	struct tasklet_struct task;
+
+	/* mhi_poll() stats for client managed rings, under lock */
+	u64 polls;
+	u64 poll_events;
+	u64 poll_exhausted; /* polls that used up the whole budget */
+	u64 poll_empty;
 	int (*process_event)(struct mhi_controller *mhi_cntrl,
 			     struct mhi_event *mhi_event,
 			     u32 event_quota);
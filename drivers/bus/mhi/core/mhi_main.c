@@ -2053,6 +2053,13 @@ int mhi_debugfs_mhi_event_show(struct seq_file *m, void *d)
 				   er_ctxt->rp, er_ctxt->wp,
 				   (u64)mhi_to_physical(ring, ring->rp),
 				   (u64)mhi_event->db_cfg.db_val);
+			if (mhi_event->cl_manage)
+				seq_printf(m,
+					   " cpu:%d polls:%llu events:%llu exhausted:%llu empty:%llu\n",
+					   mhi_event->cpu, mhi_event->polls,
+					   mhi_event->poll_events,
+					   mhi_event->poll_exhausted,
+					   mhi_event->poll_empty);
 		}
 	}
 
@@ -2208,6 +2215,14 @@ int mhi_poll(struct mhi_device *mhi_dev,
 
 	spin_lock_bh(&mhi_event->lock);
 	ret = mhi_event->process_event(mhi_cntrl, mhi_event, budget);
+	mhi_event->polls++;
+	if (ret > 0) {
+		mhi_event->poll_events += ret;
+		if (ret >= budget)
+			mhi_event->poll_exhausted++;
+	} else if (!ret) {
+		mhi_event->poll_empty++;
+	}
 	spin_unlock_bh(&mhi_event->lock);
 
 	return ret;
@@ -783,7 +783,7 @@ static void mhi_netdev_push_skb(struct mhi_netdev *mhi_netdev,
 			mhi_result->bytes_xferd, mhi_netdev->mru);
 	skb->dev = mhi_netdev->ndev;
 	skb->protocol = mhi_netdev_ip_type_trans(*(u8 *)mhi_buf->buf);
-	netif_receive_skb(skb);
+	napi_gro_receive(mhi_netdev->napi, skb);
 }
 
 static void mhi_netdev_xfer_dl_cb(struct mhi_device *mhi_dev,
@@ -23,6 +23,7 @@
 #include <linux/cdev.h>
 #include <linux/list.h>
 #include <linux/hash.h>
+#include <linux/hashtable.h>
 #include <linux/msm_ion.h>
 #include <soc/qcom/secure_buffer.h>
 #include <soc/qcom/glink.h>
@@ -51,6 +52,12 @@
 #include <linux/debugfs.h>
 #include <linux/pm_qos.h>
 #include <linux/stat.h>
+#include <linux/eventfd.h>
+#include <linux/poll.h>
+#include <linux/seq_file.h>
+
+#define CREATE_TRACE_POINTS
+#include <trace/events/fastrpc.h>
 
 #define TZ_PIL_PROTECT_MEM_SUBSYS_ID 0x0C
 #define TZ_PIL_CLEAR_PROTECT_MEM_SUBSYS_ID 0x0D
@@ -107,7 +114,7 @@
 #define FASTRPC_GLINK_INTENT_NUM  (16)
 
 #define PERF_KEYS \
-	"count:flush:map:copy:rpmsg:getargs:putargs:invalidate:invoke:tid:ptr"
+	"count:flush:map:copy:rpmsg:getargs:putargs:invalidate:invoke:tid:flushbytes:ptr"
 #define FASTRPC_STATIC_HANDLE_PROCESS_GROUP (1)
 #define FASTRPC_STATIC_HANDLE_DSP_UTILITIES (2)
 #define FASTRPC_STATIC_HANDLE_LISTENER (3)
@@ -117,6 +124,10 @@
 #define MAX_SIZE_LIMIT (0x78000000)
 #define INIT_FILELEN_MAX (2*1024*1024)
 #define INIT_MEMLEN_MAX  (8*1024*1024)
+#define FASTRPC_MAP_CACHE_BITS (4)
+#define FASTRPC_ASYNC_JOBS_MAX (64)
+#define FASTRPC_LAT_BUCKETS (20)	/* log2 of the invoke time in us */
+#define FASTRPC_LAT_ENTRIES_MAX (64)	/* handle/method pairs per process */
 
 #define PERF_END (void)0
 
@@ -220,6 +231,15 @@ struct overlap {
 	uintptr_t offset;
 };
 
+enum fastrpc_lat_phase {
+	FASTRPC_LAT_GETARGS,
+	FASTRPC_LAT_INVARGS,
+	FASTRPC_LAT_SEND,
+	FASTRPC_LAT_REMOTE,	/* until the caller resumes or reaps the job */
+	FASTRPC_LAT_PUTARGS,
+	FASTRPC_LAT_PHASES,
+};
+
 struct smq_invoke_ctx {
 	struct hlist_node hn;
 	struct completion work;
@@ -245,6 +265,26 @@ struct smq_invoke_ctx {
 	uint64_t ctxid;
 	void *handle;
 	const void *ptr;
+	int async;
+	bool async_queued;
+	uint64_t jobid;
+	remote_arg_t *upra;		/* user argument list for put_args */
+	struct list_head async_node;
+	uint32_t rhandle;
+	ktime_t lat_ts;
+	uint64_t lat_ns[FASTRPC_LAT_PHASES];
+};
+
+/* Invoke latency of one remote handle and method, for the latency node */
+struct fastrpc_lat_stats {
+	struct hlist_node hn;
+	uint32_t handle;
+	uint32_t method;
+	uint64_t count;
+	uint64_t errors;
+	uint64_t max_ns;
+	uint64_t phase_ns[FASTRPC_LAT_PHASES];
+	uint32_t hist[FASTRPC_LAT_BUCKETS];
 };
 
 struct fastrpc_ctx_lst {
@@ -364,6 +404,12 @@ struct fastrpc_mmap {
 	uintptr_t attr;
 	bool is_filemap; /* flag to indicate map used in process init */
 	unsigned int ctx_refs; /* Indicates reference count for context map */
+	bool cacheable; /* taken by an invoke, may idle in the map cache */
+	struct list_head lru;
+	/* Range last flushed and cpu_write_seq of buf at that time */
+	uint64_t clean_va;
+	size_t clean_len;
+	int clean_seq;
 };
 
 enum fastrpc_perfkeys {
@@ -376,7 +422,9 @@ enum fastrpc_perfkeys {
 	PERF_PUTARGS = 6,
 	PERF_INVARGS = 7,
 	PERF_INVOKE = 8,
-	PERF_KEY_MAX = 9,
+	PERF_TID = 9,
+	PERF_FLUSH_BYTES = 10,
+	PERF_KEY_MAX = 11,
 };
 
 struct fastrpc_perf {
@@ -390,9 +438,18 @@ struct fastrpc_perf {
 	int64_t invargs;
 	int64_t invoke;
 	int64_t tid;
+	int64_t flush_bytes;
 	struct hlist_node hn;
 };
 
+struct fastrpc_map_stats {
+	uint64_t hits;
+	uint64_t misses;
+	uint64_t evictions;
+	uint64_t invokes;
+	uint64_t map_ns;
+};
+
 struct fastrpc_file {
 	struct hlist_node hn;
 	spinlock_t hlock;
@@ -426,10 +483,30 @@ struct fastrpc_file {
 	/* Identifies the device (MINOR_NUM_DEV / MINOR_NUM_SECURE_DEV) */
 	int dev_minor;
 	char *debug_buf;
+	/* Idle invoke maps kept SMMU mapped, protected by fl_map_mutex */
+	DECLARE_HASHTABLE(map_cache, FASTRPC_MAP_CACHE_BITS);
+	struct list_head map_lru;
+	size_t map_cache_bytes;
+	struct fastrpc_map_stats map_stats;
+	/* Async jobs, async_done holds the completed ones until reaped */
+	spinlock_t async_lock;
+	struct list_head async_done;
+	wait_queue_head_t async_wait;
+	struct eventfd_ctx *async_efd;
+	uint64_t async_jobid;
+	int async_pending;
+	/* Per handle/method latency, protected by hlock */
+	struct hlist_head lat_stats;
+	int lat_entries;
 };
 
 static struct fastrpc_apps gfa;
 
+static unsigned int map_cache_max_kb = 32768;
+module_param(map_cache_max_kb, uint, 0644);
+MODULE_PARM_DESC(map_cache_max_kb,
+	"Idle invoke buffer mappings kept per process in KB, 0 to disable");
+
 static struct fastrpc_channel_ctx gcinfo[NUM_CHANNELS] = {
 	{
 		.name = "adsprpc-smd",
@@ -745,6 +822,108 @@ static int fastrpc_mmap_remove(struct fastrpc_file *fl, uintptr_t va,
 	return -ENOTTY;
 }
 
+static void fastrpc_mmap_free(struct fastrpc_mmap *map, uint32_t flags);
+
+/*
+ * Drop idle maps from the LRU tail until the cache fits in limit, a limit
+ * of 0 empties the cache. Called with fl_map_mutex held.
+ */
+static void fastrpc_mmap_cache_evict(struct fastrpc_file *fl, size_t limit)
+{
+	struct fastrpc_mmap *map;
+
+	while (!list_empty(&fl->map_lru) &&
+			(!limit || fl->map_cache_bytes > limit)) {
+		map = list_last_entry(&fl->map_lru, struct fastrpc_mmap, lru);
+		list_del_init(&map->lru);
+		hash_del(&map->hn);
+		fl->map_cache_bytes -= map->size;
+		fl->map_stats.evictions++;
+		fastrpc_mmap_free(map, 1);
+	}
+}
+
+/* Drop the idle maps of an fd the client explicitly unmapped */
+static int fastrpc_mmap_cache_drop(struct fastrpc_file *fl, int fd)
+{
+	struct fastrpc_mmap *map;
+	struct hlist_node *n;
+	int err = -ENOENT;
+
+	hash_for_each_possible_safe(fl->map_cache, map, n, hn, fd) {
+		if (map->fd != fd)
+			continue;
+		list_del_init(&map->lru);
+		hash_del(&map->hn);
+		fl->map_cache_bytes -= map->size;
+		fastrpc_mmap_free(map, 1);
+		err = 0;
+	}
+	return err;
+}
+
+/*
+ * Park an invoke buffer whose last reference went away instead of tearing
+ * down its SMMU mapping, so the next invoke on the same fd can skip the
+ * import, attach and map. Called with fl_map_mutex held.
+ */
+static bool fastrpc_mmap_cache_put(struct fastrpc_mmap *map)
+{
+	struct fastrpc_file *fl = map->fl;
+	size_t limit = (size_t)map_cache_max_kb << 10;
+
+	if (!map->cacheable || map->flags || map->refs || map->ctx_refs ||
+		map->raddr || map->is_filemap ||
+		(map->attr & FASTRPC_ATTR_KEEP_MAP))
+		return false;
+	if (!map->size || map->size > limit || fl->file_close)
+		return false;
+
+	hash_add(fl->map_cache, &map->hn, map->fd);
+	list_add(&map->lru, &fl->map_lru);
+	fl->map_cache_bytes += map->size;
+	fastrpc_mmap_cache_evict(fl, limit);
+	return true;
+}
+
+/*
+ * An idle map is only reused while the fd still refers to the same dma_buf,
+ * which also catches an fd number recycled for another buffer.
+ */
+static int fastrpc_mmap_cache_get(struct fastrpc_file *fl, int fd,
+		unsigned int attr, uintptr_t va, size_t len,
+		struct fastrpc_mmap **ppmap)
+{
+	struct fastrpc_mmap *map;
+	struct dma_buf *buf;
+	int err = -ENOENT;
+
+	if (hash_empty(fl->map_cache))
+		goto bail;
+	buf = dma_buf_get(fd);
+	if (IS_ERR_OR_NULL(buf))
+		goto bail;
+	hash_for_each_possible(fl->map_cache, map, hn, fd) {
+		if (map->fd != fd || map->buf != buf || map->attr != attr ||
+			va < map->va || va + len > map->va + map->len)
+			continue;
+		hash_del(&map->hn);
+		list_del_init(&map->lru);
+		fl->map_cache_bytes -= map->size;
+		fl->map_stats.hits++;
+		map->refs = 1;
+		fastrpc_mmap_add(map);
+		*ppmap = map;
+		err = 0;
+		break;
+	}
+	dma_buf_put(buf);
+bail:
+	if (err)
+		fl->map_stats.misses++;
+	return err;
+}
+
 static void fastrpc_mmap_free(struct fastrpc_mmap *map, uint32_t flags)
 {
 	struct fastrpc_apps *me = &gfa;
@@ -787,6 +966,8 @@ static void fastrpc_mmap_free(struct fastrpc_mmap *map, uint32_t flags)
 			hlist_del_init(&map->hn);
 		if (map->refs > 0 && !flags)
 			return;
+		if (!flags && fastrpc_mmap_cache_put(map))
+			return;
 	}
 	if (map->flags == ADSP_MMAP_HEAP_ADDR ||
 				map->flags == ADSP_MMAP_REMOTE_HEAP_ADDR) {
@@ -868,11 +1049,14 @@ static int fastrpc_mmap_create(struct fastrpc_file *fl, int fd,
 	chan = &apps->channel[cid];
 	if (!fastrpc_mmap_find(fl, fd, va, len, mflags, 1, ppmap))
 		return 0;
+	if (!mflags && !fastrpc_mmap_cache_get(fl, fd, attr, va, len, ppmap))
+		return 0;
 	map = kzalloc(sizeof(*map), GFP_KERNEL);
 	VERIFY(err, !IS_ERR_OR_NULL(map));
 	if (err)
 		goto bail;
 	INIT_HLIST_NODE(&map->hn);
+	INIT_LIST_HEAD(&map->lru);
 	map->flags = mflags;
 	map->refs = 1;
 	map->fl = fl;
@@ -1258,6 +1442,7 @@ static int context_alloc(struct fastrpc_file *fl, uint32_t kernel,
 
 	INIT_HLIST_NODE(&ctx->hn);
 	hlist_add_fake(&ctx->hn);
+	INIT_LIST_HEAD(&ctx->async_node);
 	ctx->fl = fl;
 	ctx->maps = (struct fastrpc_mmap **)(&ctx[1]);
 	ctx->lpra = (remote_arg_t *)(&ctx->maps[bufs]);
@@ -1290,6 +1475,7 @@ static int context_alloc(struct fastrpc_file *fl, uint32_t kernel,
 	}
 	ctx->crc = (uint32_t *)invokefd->crc;
 	ctx->sc = invoke->sc;
+	ctx->rhandle = invoke->handle;
 	if (bufs) {
 		VERIFY(err, 0 == context_build_overlap(ctx));
 		if (err)
@@ -1349,6 +1535,12 @@ static void context_free(struct smq_invoke_ctx *ctx)
 	spin_lock(&ctx->fl->hlock);
 	hlist_del_init(&ctx->hn);
 	spin_unlock(&ctx->fl->hlock);
+	if (ctx->async) {
+		spin_lock_irqsave(&ctx->fl->async_lock, irq_flags);
+		list_del_init(&ctx->async_node);
+		ctx->fl->async_pending--;
+		spin_unlock_irqrestore(&ctx->fl->async_lock, irq_flags);
+	}
 	mutex_lock(&ctx->fl->fl_map_mutex);
 	for (i = 0; i < nbufs; ++i) {
 		if (ctx->maps[i] && ctx->maps[i]->ctx_refs)
@@ -1379,10 +1571,111 @@ static void context_free(struct smq_invoke_ctx *ctx)
 	kfree(ctx);
 }
 
+/*
+ * Async jobs have no waiter, queue them once for the owner to reap, a
+ * response racing with an SSR notification must not queue them twice.
+ */
+static void context_async_done(struct smq_invoke_ctx *ctx)
+{
+	struct fastrpc_file *fl = ctx->fl;
+	unsigned long irq_flags = 0;
+
+	spin_lock_irqsave(&fl->async_lock, irq_flags);
+	if (!ctx->async_queued) {
+		ctx->async_queued = true;
+		list_add_tail(&ctx->async_node, &fl->async_done);
+		if (fl->async_efd)
+			eventfd_signal(fl->async_efd, 1);
+	}
+	spin_unlock_irqrestore(&fl->async_lock, irq_flags);
+	wake_up_interruptible(&fl->async_wait);
+}
+
+static void context_wake(struct smq_invoke_ctx *ctx)
+{
+	complete(&ctx->work);
+	if (ctx->async)
+		context_async_done(ctx);
+}
+
 static void context_notify_user(struct smq_invoke_ctx *ctx, int retval)
 {
 	ctx->retval = retval;
-	complete(&ctx->work);
+	context_wake(ctx);
+}
+
+/* Charge the time since the previous mark to phase */
+static inline void context_lat_mark(struct smq_invoke_ctx *ctx, int phase)
+{
+	ktime_t now = ktime_get();
+
+	ctx->lat_ns[phase] += ktime_to_ns(ktime_sub(now, ctx->lat_ts));
+	ctx->lat_ts = now;
+}
+
+static void context_lat_stats_update(struct fastrpc_lat_stats *stats,
+				struct smq_invoke_ctx *ctx, int err)
+{
+	uint64_t total = 0, us;
+	int i, bucket;
+
+	if (err) {
+		stats->errors++;
+		return;
+	}
+	for (i = 0; i < FASTRPC_LAT_PHASES; i++) {
+		stats->phase_ns[i] += ctx->lat_ns[i];
+		total += ctx->lat_ns[i];
+	}
+	stats->count++;
+	stats->max_ns = max(stats->max_ns, total);
+	us = div_u64(total, NSEC_PER_USEC);
+	bucket = us ? min(ilog2(us) + 1, FASTRPC_LAT_BUCKETS - 1) : 0;
+	stats->hist[bucket]++;
+}
+
+/*
+ * Always on aggregation of the invoke phases per remote handle and method,
+ * a process is limited to FASTRPC_LAT_ENTRIES_MAX pairs.
+ */
+static void context_lat_account(struct smq_invoke_ctx *ctx, int err)
+{
+	struct fastrpc_file *fl = ctx->fl;
+	struct fastrpc_lat_stats *stats, *new = NULL;
+	uint32_t method = REMOTE_SCALARS_METHOD(ctx->sc);
+
+	trace_fastrpc_invoke_latency(fl->tgid, ctx->rhandle, method, err,
+		ctx->lat_ns[FASTRPC_LAT_GETARGS],
+		ctx->lat_ns[FASTRPC_LAT_INVARGS],
+		ctx->lat_ns[FASTRPC_LAT_SEND],
+		ctx->lat_ns[FASTRPC_LAT_REMOTE],
+		ctx->lat_ns[FASTRPC_LAT_PUTARGS]);
+	for (;;) {
+		spin_lock(&fl->hlock);
+		hlist_for_each_entry(stats, &fl->lat_stats, hn) {
+			if (stats->handle == ctx->rhandle &&
+				stats->method == method)
+				break;
+		}
+		if (!stats && new) {
+			hlist_add_head(&new->hn, &fl->lat_stats);
+			fl->lat_entries++;
+			stats = new;
+			new = NULL;
+		}
+		if (stats || fl->lat_entries >= FASTRPC_LAT_ENTRIES_MAX)
+			break;
+		spin_unlock(&fl->hlock);
+		new = kzalloc(sizeof(*new), GFP_KERNEL);
+		if (!new)
+			return;
+		new->handle = ctx->rhandle;
+		new->method = method;
+	}
+	if (stats)
+		context_lat_stats_update(stats, ctx, err);
+	spin_unlock(&fl->hlock);
+	kfree(new);
 }
 
 
@@ -1393,7 +1686,7 @@ static void fastrpc_notify_users(struct fastrpc_file *me)
 
 	spin_lock(&me->hlock);
 	hlist_for_each_entry_safe(ictx, n, &me->clst.pending, hn) {
-		complete(&ictx->work);
+		context_wake(ictx);
 	}
 	hlist_for_each_entry_safe(ictx, n, &me->clst.interrupted, hn) {
 		complete(&ictx->work);
@@ -1411,7 +1704,7 @@ static void fastrpc_notify_users_staticpd_pdr(struct fastrpc_file *me)
 	spin_lock(&me->hlock);
 	hlist_for_each_entry_safe(ictx, n, &me->clst.pending, hn) {
 		if (ictx->msg.pid)
-			complete(&ictx->work);
+			context_wake(ictx);
 	}
 	hlist_for_each_entry_safe(ictx, n, &me->clst.interrupted, hn) {
 		if (ictx->msg.pid)
@@ -1507,6 +1800,22 @@ static void fastrpc_file_list_dtor(struct fastrpc_apps *me)
 	} while (free);
 }
 
+/*
+ * A CPU_SYNC buffer needs no flush while the range was flushed before and
+ * no cpu write access was signalled on its dma_buf since. *seq is the
+ * sequence to record once the range has been flushed.
+ */
+static bool fastrpc_mmap_is_clean(struct fastrpc_mmap *map, uint64_t va,
+		size_t len, int *seq)
+{
+	if (!map || !map->buf || !(map->attr & FASTRPC_ATTR_CPU_SYNC))
+		return false;
+	*seq = atomic_read(&map->buf->cpu_write_seq);
+	return map->clean_len && map->clean_seq == *seq &&
+		va >= map->clean_va &&
+		va + len <= map->clean_va + map->clean_len;
+}
+
 static int get_args(uint32_t kernel, struct smq_invoke_ctx *ctx)
 {
 	struct fastrpc_apps *me = &gfa;
@@ -1526,6 +1835,8 @@ static int get_args(uint32_t kernel, struct smq_invoke_ctx *ctx)
 	uint64_t *fdlist;
 	uint32_t *crclist;
 	int64_t *perf_counter = getperfcounter(ctx->fl, PERF_COUNT);
+	int64_t *flush_bytes = NULL;
+	ktime_t start;
 
 	/* calculate size of the metadata */
 	rpra = NULL;
@@ -1533,6 +1844,7 @@ static int get_args(uint32_t kernel, struct smq_invoke_ctx *ctx)
 	pages = smq_phy_page_start(sc, list);
 	ipage = pages;
 
+	start = ktime_get();
 	PERF(ctx->fl->profile, GET_COUNTER(perf_counter, PERF_MAP),
 	for (i = 0; i < bufs; ++i) {
 		uintptr_t buf = (uintptr_t)lpra[i].buf.pv;
@@ -1549,14 +1861,18 @@ static int get_args(uint32_t kernel, struct smq_invoke_ctx *ctx)
 					attrs, buf, len,
 					mflags, &ctx->maps[i]);
 		}
-		if (ctx->maps[i])
+		if (ctx->maps[i]) {
 			ctx->maps[i]->ctx_refs++;
+			ctx->maps[i]->cacheable = true;
+		}
 		mutex_unlock(&ctx->fl->fl_map_mutex);
 		ipage += 1;
 	}
 	PERF_END);
 	handles = REMOTE_SCALARS_INHANDLES(sc) + REMOTE_SCALARS_OUTHANDLES(sc);
 	mutex_lock(&ctx->fl->fl_map_mutex);
+	ctx->fl->map_stats.invokes++;
+	ctx->fl->map_stats.map_ns += ktime_to_ns(ktime_sub(ktime_get(), start));
 	for (i = bufs; i < bufs + handles; i++) {
 		int dmaflags = 0;
 
@@ -1739,10 +2055,14 @@ static int get_args(uint32_t kernel, struct smq_invoke_ctx *ctx)
 	}
 	PERF_END);
 
+	if (ctx->fl->profile)
+		flush_bytes = GET_COUNTER(perf_counter, PERF_FLUSH_BYTES);
 	PERF(ctx->fl->profile, GET_COUNTER(perf_counter, PERF_FLUSH),
 	for (oix = 0; oix < inbufs + outbufs; ++oix) {
 		int i = ctx->overps[oix]->raix;
 		struct fastrpc_mmap *map = ctx->maps[i];
+		unsigned int cache_op = ION_IOC_CLEAN_INV_CACHES;
+		int seq = 0;
 
 		if (map && map->uncached)
 			continue;
@@ -1754,16 +2074,29 @@ static int get_args(uint32_t kernel, struct smq_invoke_ctx *ctx)
 
 		if (rpra && lrpra && rpra[i].buf.len &&
 			ctx->overps[oix]->mstart) {
-			if (map && map->handle)
+			if (fastrpc_mmap_is_clean(map, rpra[i].buf.pv,
+					rpra[i].buf.len, &seq))
+				continue;
+			if (map && map->handle) {
+				if (i >= inbufs &&
+				(map->attr & FASTRPC_ATTR_DSP_WRITE_ONLY))
+					cache_op = ION_IOC_INV_CACHES;
 				msm_ion_do_cache_op(ctx->fl->apps->client,
 					map->handle,
 					uint64_to_ptr(rpra[i].buf.pv),
-					rpra[i].buf.len,
-					ION_IOC_CLEAN_INV_CACHES);
-			else
+					rpra[i].buf.len, cache_op);
+			} else {
 				dmac_flush_range(uint64_to_ptr(rpra[i].buf.pv),
 					uint64_to_ptr(rpra[i].buf.pv
 						+ rpra[i].buf.len));
+			}
+			if (flush_bytes && cache_op == ION_IOC_CLEAN_INV_CACHES)
+				*flush_bytes += rpra[i].buf.len;
+			if (map && (map->attr & FASTRPC_ATTR_CPU_SYNC)) {
+				map->clean_va = rpra[i].buf.pv;
+				map->clean_len = rpra[i].buf.len;
+				map->clean_seq = seq;
+			}
 		}
 	}
 	PERF_END);
@@ -2125,6 +2458,7 @@ static int fastrpc_internal_invoke(struct fastrpc_file *fl, uint32_t mode,
 	VERIFY(err, 0 == context_alloc(fl, kernel, inv, &ctx));
 	if (err)
 		goto bail;
+	ctx->lat_ts = ktime_get();
 
 	if (REMOTE_SCALARS_LENGTH(ctx->sc)) {
 		PERF(fl->profile, GET_COUNTER(perf_counter, PERF_GETARGS),
@@ -2133,16 +2467,19 @@ static int fastrpc_internal_invoke(struct fastrpc_file *fl, uint32_t mode,
 		if (err)
 			goto bail;
 	}
+	context_lat_mark(ctx, FASTRPC_LAT_GETARGS);
 
 	if (!fl->sctx->smmu.coherent) {
 		PERF(fl->profile, GET_COUNTER(perf_counter, PERF_INVARGS),
 		inv_args_pre(ctx);
 		PERF_END);
+		context_lat_mark(ctx, FASTRPC_LAT_INVARGS);
 	}
 
 	PERF(fl->profile, GET_COUNTER(perf_counter, PERF_LINK),
 	VERIFY(err, 0 == fastrpc_invoke_send(ctx, kernel, invoke->handle));
 	PERF_END);
+	context_lat_mark(ctx, FASTRPC_LAT_SEND);
 
 	if (err)
 		goto bail;
@@ -2155,10 +2492,12 @@ static int fastrpc_internal_invoke(struct fastrpc_file *fl, uint32_t mode,
 		if (err)
 			goto bail;
 	}
+	context_lat_mark(ctx, FASTRPC_LAT_REMOTE);
 	PERF(fl->profile, GET_COUNTER(perf_counter, PERF_INVARGS),
 	if (!fl->sctx->smmu.coherent)
 		inv_args(ctx);
 	PERF_END);
+	context_lat_mark(ctx, FASTRPC_LAT_INVARGS);
 
 	VERIFY(err, 0 == (err = ctx->retval));
 	if (err)
@@ -2167,13 +2506,16 @@ static int fastrpc_internal_invoke(struct fastrpc_file *fl, uint32_t mode,
 	PERF(fl->profile, GET_COUNTER(perf_counter, PERF_PUTARGS),
 	VERIFY(err, 0 == put_args(kernel, ctx, invoke->pra));
 	PERF_END);
+	context_lat_mark(ctx, FASTRPC_LAT_PUTARGS);
 	if (err)
 		goto bail;
  bail:
-	if (ctx && interrupted == -ERESTARTSYS)
+	if (ctx && interrupted == -ERESTARTSYS) {
 		context_save_interrupted(ctx);
-	else if (ctx)
+	} else if (ctx) {
+		context_lat_account(ctx, err);
 		context_free(ctx);
+	}
 	if (fl->ssrcount != fl->apps->channel[cid].ssrcount)
 		err = ECONNRESET;
 
@@ -2194,6 +2536,214 @@ static int fastrpc_internal_invoke(struct fastrpc_file *fl, uint32_t mode,
 	return err;
 }
 
+/*
+ * Queue an invoke without waiting for the remote reply, the job completes
+ * through fastrpc_internal_async_response() once the reply is in.
+ */
+static int fastrpc_internal_invoke_async(struct fastrpc_file *fl,
+				struct fastrpc_ioctl_invoke_async *ia)
+{
+	struct smq_invoke_ctx *ctx = NULL;
+	struct fastrpc_ioctl_invoke *invoke = &ia->inv.inv;
+	int64_t *perf_counter = NULL;
+	unsigned long irq_flags = 0;
+	uint64_t jobid = 0;
+	int err = 0, cid = -1;
+
+	cid = fl->cid;
+	VERIFY(err, cid >= ADSP_DOMAIN_ID && cid < NUM_CHANNELS);
+	if (err) {
+		err = -ECHRNG;
+		goto bail;
+	}
+	VERIFY(err, fl->sctx != NULL);
+	if (err) {
+		err = -EBADR;
+		goto bail;
+	}
+	/* static handles rely on the caller waiting for the reply */
+	VERIFY(err, invoke->handle > FASTRPC_STATIC_HANDLE_MAX);
+	if (err) {
+		err = -EINVAL;
+		goto bail;
+	}
+	if (fl->sctx->smmu.faults) {
+		err = FASTRPC_ENOSUCH;
+		goto bail;
+	}
+	perf_counter = getperfcounter(fl, PERF_COUNT);
+
+	spin_lock_irqsave(&fl->async_lock, irq_flags);
+	if (fl->async_pending < FASTRPC_ASYNC_JOBS_MAX) {
+		fl->async_pending++;
+		jobid = ++fl->async_jobid;
+	} else {
+		err = -EBUSY;
+	}
+	spin_unlock_irqrestore(&fl->async_lock, irq_flags);
+	if (err)
+		goto bail;
+
+	VERIFY(err, 0 == context_alloc(fl, 0, &ia->inv, &ctx));
+	if (err) {
+		spin_lock_irqsave(&fl->async_lock, irq_flags);
+		fl->async_pending--;
+		spin_unlock_irqrestore(&fl->async_lock, irq_flags);
+		ctx = NULL;
+		goto bail;
+	}
+	ctx->async = 1;
+	ctx->jobid = jobid;
+	ctx->upra = invoke->pra;
+	ctx->lat_ts = ktime_get();
+
+	if (REMOTE_SCALARS_LENGTH(ctx->sc)) {
+		PERF(fl->profile, GET_COUNTER(perf_counter, PERF_GETARGS),
+		VERIFY(err, 0 == get_args(0, ctx));
+		PERF_END);
+		if (err)
+			goto bail;
+	}
+	context_lat_mark(ctx, FASTRPC_LAT_GETARGS);
+
+	if (!fl->sctx->smmu.coherent) {
+		PERF(fl->profile, GET_COUNTER(perf_counter, PERF_INVARGS),
+		inv_args_pre(ctx);
+		PERF_END);
+		context_lat_mark(ctx, FASTRPC_LAT_INVARGS);
+	}
+
+	PERF(fl->profile, GET_COUNTER(perf_counter, PERF_LINK),
+	VERIFY(err, 0 == fastrpc_invoke_send(ctx, 0, invoke->handle));
+	PERF_END);
+	if (err)
+		goto bail;
+	context_lat_mark(ctx, FASTRPC_LAT_SEND);
+
+	ia->jobid = jobid;
+	ctx = NULL;
+bail:
+	if (ctx) {
+		context_lat_account(ctx, err);
+		context_free(ctx);
+	}
+	return err;
+}
+
+/* Queue invokes until the first one that fails */
+static int fastrpc_internal_invoke_batch(struct fastrpc_file *fl,
+				struct fastrpc_ioctl_invoke_batch *batch)
+{
+	struct fastrpc_ioctl_invoke_async ia;
+	uint32_t i;
+	int err = 0;
+
+	VERIFY(err, batch->count && batch->count <= FASTRPC_ASYNC_JOBS_MAX);
+	if (err) {
+		err = -EINVAL;
+		goto bail;
+	}
+	for (i = 0; i < batch->count; i++) {
+		K_COPY_FROM_USER(err, 0, &ia, &batch->invokes[i], sizeof(ia));
+		if (err)
+			break;
+		err = fastrpc_internal_invoke_async(fl, &ia);
+		if (err)
+			break;
+		K_COPY_TO_USER(err, 0, &batch->invokes[i].jobid, &ia.jobid,
+				sizeof(ia.jobid));
+		if (err) {
+			i++;
+			break;
+		}
+	}
+	batch->submitted = i;
+	if (i)
+		err = 0;
+bail:
+	return err;
+}
+
+/*
+ * Reap one completed async job. Output buffers are invalidated and copied
+ * back here, in the context of the process that queued the job.
+ */
+static int fastrpc_internal_async_response(struct fastrpc_file *fl,
+				struct fastrpc_ioctl_async_response *ar,
+				bool nonblock)
+{
+	struct smq_invoke_ctx *ctx = NULL;
+	int64_t *perf_counter = getperfcounter(fl, PERF_COUNT);
+	unsigned long irq_flags = 0;
+	int err = 0, cid = fl->cid;
+
+	while (!ctx) {
+		spin_lock_irqsave(&fl->async_lock, irq_flags);
+		ctx = list_first_entry_or_null(&fl->async_done,
+				struct smq_invoke_ctx, async_node);
+		if (ctx)
+			list_del_init(&ctx->async_node);
+		else if (!fl->async_pending)
+			err = -ENOENT;
+		spin_unlock_irqrestore(&fl->async_lock, irq_flags);
+		if (err)
+			goto bail;
+		if (ctx)
+			break;
+		if (nonblock) {
+			err = -EAGAIN;
+			goto bail;
+		}
+		err = wait_event_interruptible(fl->async_wait,
+				!list_empty_careful(&fl->async_done));
+		if (err)
+			goto bail;
+	}
+
+	context_lat_mark(ctx, FASTRPC_LAT_REMOTE);
+	PERF(fl->profile, GET_COUNTER(perf_counter, PERF_INVARGS),
+	if (!fl->sctx->smmu.coherent)
+		inv_args(ctx);
+	PERF_END);
+	context_lat_mark(ctx, FASTRPC_LAT_INVARGS);
+
+	VERIFY(err, 0 == (err = ctx->retval));
+	if (!err) {
+		PERF(fl->profile, GET_COUNTER(perf_counter, PERF_PUTARGS),
+		VERIFY(err, 0 == put_args(0, ctx, ctx->upra));
+		PERF_END);
+		context_lat_mark(ctx, FASTRPC_LAT_PUTARGS);
+	}
+	ar->jobid = ctx->jobid;
+	context_lat_account(ctx, err);
+	context_free(ctx);
+	if (fl->ssrcount != fl->apps->channel[cid].ssrcount)
+		err = ECONNRESET;
+	ar->result = err;
+	err = 0;
+bail:
+	return err;
+}
+
+static int fastrpc_set_async_eventfd(struct fastrpc_file *fl, int fd)
+{
+	struct eventfd_ctx *efd = NULL, *old;
+	unsigned long irq_flags = 0;
+
+	if (fd >= 0) {
+		efd = eventfd_ctx_fdget(fd);
+		if (IS_ERR(efd))
+			return PTR_ERR(efd);
+	}
+	spin_lock_irqsave(&fl->async_lock, irq_flags);
+	old = fl->async_efd;
+	fl->async_efd = efd;
+	spin_unlock_irqrestore(&fl->async_lock, irq_flags);
+	if (old)
+		eventfd_ctx_put(old);
+	return 0;
+}
+
 static int fastrpc_get_adsp_session(char *name, int *session)
 {
 	struct fastrpc_apps *me = &gfa;
@@ -2982,7 +3532,8 @@ static int fastrpc_internal_munmap_fd(struct fastrpc_file *fl,
 		goto bail;
 	mutex_lock(&fl->map_mutex);
 	mutex_lock(&fl->fl_map_mutex);
-	if (fastrpc_mmap_find(fl, ud->fd, ud->va, ud->len, 0, 0, &map)) {
+	if (fastrpc_mmap_find(fl, ud->fd, ud->va, ud->len, 0, 0, &map) &&
+		fastrpc_mmap_cache_drop(fl, ud->fd)) {
 		pr_err("adsprpc: mapping not found to unmap %d va %llx %x\n",
 			ud->fd, (unsigned long long)ud->va,
 			(unsigned int)ud->len);
@@ -3226,6 +3777,18 @@ static void fastrpc_session_free(struct fastrpc_channel_ctx *chan,
 	mutex_unlock(&me->smd_mutex);
 }
 
+static void fastrpc_lat_stats_free(struct fastrpc_file *fl)
+{
+	struct fastrpc_lat_stats *stats;
+	struct hlist_node *n;
+
+	hlist_for_each_entry_safe(stats, n, &fl->lat_stats, hn) {
+		hlist_del(&stats->hn);
+		kfree(stats);
+	}
+	fl->lat_entries = 0;
+}
+
 static int fastrpc_file_free(struct fastrpc_file *fl)
 {
 	struct hlist_node *n = NULL;
@@ -3243,6 +3806,8 @@ static int fastrpc_file_free(struct fastrpc_file *fl)
 	hlist_del_init(&fl->hn);
 	spin_unlock(&fl->apps->hlock);
 	kfree(fl->debug_buf);
+	fastrpc_set_async_eventfd(fl, -1);
+	fastrpc_lat_stats_free(fl);
 
 	if (!fl->sctx) {
 		kfree(fl);
@@ -3265,6 +3830,7 @@ static int fastrpc_file_free(struct fastrpc_file *fl)
 		}
 		fastrpc_mmap_free(lmap, 1);
 	} while (lmap);
+	fastrpc_mmap_cache_evict(fl, 0);
 	mutex_unlock(&fl->fl_map_mutex);
 	if (fl->refcount && (fl->ssrcount == fl->apps->channel[cid].ssrcount))
 		kref_put_mutex(&fl->apps->channel[cid].kref,
@@ -3613,6 +4179,19 @@ static ssize_t fastrpc_debugfs_read(struct file *filp, char __user *buffer,
 			map->secure, map->attr);
 		}
 		mutex_unlock(&fl->map_mutex);
+		mutex_lock(&fl->fl_map_mutex);
+		len += scnprintf(fileinfo + len, DEBUGFS_SIZE - len,
+			"\n%s %4s %zu\n", "map_cache_bytes", ":",
+			fl->map_cache_bytes);
+		len += scnprintf(fileinfo + len, DEBUGFS_SIZE - len,
+			"%s %s %llu/%llu/%llu\n", "hits/misses/evicts", ":",
+			fl->map_stats.hits, fl->map_stats.misses,
+			fl->map_stats.evictions);
+		len += scnprintf(fileinfo + len, DEBUGFS_SIZE - len,
+			"%s %8s %llu\n\n", "avg_map_ns", ":",
+			fl->map_stats.invokes ? div64_u64(fl->map_stats.map_ns,
+				fl->map_stats.invokes) : 0);
+		mutex_unlock(&fl->fl_map_mutex);
 		len += scnprintf(fileinfo + len, DEBUGFS_SIZE - len,
 				"%s %d\n\n",
 				"KERNEL MEMORY ALLOCATION:", 1);
@@ -3680,6 +4259,55 @@ static const struct file_operations debugfs_fops = {
 	.open = fastrpc_debugfs_open,
 	.read = fastrpc_debugfs_read,
 };
+
+static int fastrpc_latency_show(struct seq_file *s, void *unused)
+{
+	static const char * const phases[FASTRPC_LAT_PHASES] = {
+		"getargs", "invargs", "send", "remote", "putargs",
+	};
+	struct fastrpc_apps *me = &gfa;
+	struct fastrpc_lat_stats *stats;
+	struct fastrpc_file *fl;
+	int i;
+
+	seq_puts(s, "times in us, hist bucket n counts invokes of [2^(n-1), 2^n) us\n");
+	spin_lock(&me->hlock);
+	hlist_for_each_entry(fl, &me->drivers, hn) {
+		spin_lock(&fl->hlock);
+		hlist_for_each_entry(stats, &fl->lat_stats, hn) {
+			uint64_t cnt = max_t(uint64_t, stats->count, 1);
+
+			seq_printf(s, "tgid %d cid %d handle 0x%x method %u count %llu errors %llu max %llu\n",
+				fl->tgid, fl->cid, stats->handle,
+				stats->method, stats->count, stats->errors,
+				div_u64(stats->max_ns, NSEC_PER_USEC));
+			seq_puts(s, "  avg");
+			for (i = 0; i < FASTRPC_LAT_PHASES; i++)
+				seq_printf(s, " %s %llu", phases[i],
+					div64_u64(stats->phase_ns[i],
+						cnt * NSEC_PER_USEC));
+			seq_puts(s, "\n  hist");
+			for (i = 0; i < FASTRPC_LAT_BUCKETS; i++)
+				seq_printf(s, " %u", stats->hist[i]);
+			seq_puts(s, "\n");
+		}
+		spin_unlock(&fl->hlock);
+	}
+	spin_unlock(&me->hlock);
+	return 0;
+}
+
+static int fastrpc_latency_open(struct inode *inode, struct file *file)
+{
+	return single_open(file, fastrpc_latency_show, inode->i_private);
+}
+
+static const struct file_operations fastrpc_latency_fops = {
+	.open = fastrpc_latency_open,
+	.read = seq_read,
+	.llseek = seq_lseek,
+	.release = single_release,
+};
 static int fastrpc_channel_open(struct fastrpc_file *fl)
 {
 	struct fastrpc_apps *me = &gfa;
@@ -3784,6 +4412,12 @@ static int fastrpc_device_open(struct inode *inode, struct file *filp)
 	context_list_ctor(&fl->clst);
 	spin_lock_init(&fl->hlock);
 	INIT_HLIST_HEAD(&fl->maps);
+	INIT_HLIST_HEAD(&fl->lat_stats);
+	spin_lock_init(&fl->async_lock);
+	INIT_LIST_HEAD(&fl->async_done);
+	init_waitqueue_head(&fl->async_wait);
+	hash_init(fl->map_cache);
+	INIT_LIST_HEAD(&fl->map_lru);
 	INIT_HLIST_HEAD(&fl->perf);
 	INIT_HLIST_HEAD(&fl->cached_bufs);
 	INIT_HLIST_HEAD(&fl->remote_bufs);
@@ -3988,6 +4622,9 @@ static long fastrpc_device_ioctl(struct file *file, unsigned int ioctl_num,
 		struct fastrpc_ioctl_perf perf;
 		struct fastrpc_ioctl_control cp;
 		struct fastrpc_ioctl_dsp_capabilities dsp_cap;
+		struct fastrpc_ioctl_invoke_async inv_async;
+		struct fastrpc_ioctl_invoke_batch batch;
+		struct fastrpc_ioctl_async_response async_rsp;
 	} p;
 	union {
 		struct fastrpc_ioctl_mmap mmap;
@@ -4039,6 +4676,51 @@ static long fastrpc_device_ioctl(struct file *file, unsigned int ioctl_num,
 		if (err)
 			goto bail;
 		break;
+	case FASTRPC_IOCTL_INVOKE_ASYNC:
+		K_COPY_FROM_USER(err, 0, &p.inv_async, param,
+						sizeof(p.inv_async));
+		if (err)
+			goto bail;
+		VERIFY(err, 0 == (err = fastrpc_internal_invoke_async(fl,
+						&p.inv_async)));
+		if (err)
+			goto bail;
+		K_COPY_TO_USER(err, 0, param, &p.inv_async,
+						sizeof(p.inv_async));
+		if (err)
+			goto bail;
+		break;
+	case FASTRPC_IOCTL_INVOKE_BATCH:
+		K_COPY_FROM_USER(err, 0, &p.batch, param, sizeof(p.batch));
+		if (err)
+			goto bail;
+		VERIFY(err, 0 == (err = fastrpc_internal_invoke_batch(fl,
+						&p.batch)));
+		if (err)
+			goto bail;
+		K_COPY_TO_USER(err, 0, param, &p.batch, sizeof(p.batch));
+		if (err)
+			goto bail;
+		break;
+	case FASTRPC_IOCTL_ASYNC_RESPONSE:
+		VERIFY(err, 0 == (err = fastrpc_internal_async_response(fl,
+				&p.async_rsp, file->f_flags & O_NONBLOCK)));
+		if (err)
+			goto bail;
+		K_COPY_TO_USER(err, 0, param, &p.async_rsp,
+						sizeof(p.async_rsp));
+		if (err)
+			goto bail;
+		break;
+	case FASTRPC_IOCTL_ASYNC_EVENTFD:
+		K_COPY_FROM_USER(err, 0, &info, param, sizeof(info));
+		if (err)
+			goto bail;
+		VERIFY(err, 0 == (err = fastrpc_set_async_eventfd(fl,
+						(int)info)));
+		if (err)
+			goto bail;
+		break;
 	case FASTRPC_IOCTL_MMAP:
 		K_COPY_FROM_USER(err, 0, &p.mmap, param,
 						sizeof(p.mmap));
@@ -4336,9 +5018,24 @@ static int fastrpc_get_service_location_notify(struct notifier_block *nb,
 	return NOTIFY_DONE;
 }
 
+static unsigned int fastrpc_device_poll(struct file *file,
+					struct poll_table_struct *wait)
+{
+	struct fastrpc_file *fl = (struct fastrpc_file *)file->private_data;
+	unsigned int mask = 0;
+
+	if (!fl)
+		return POLLERR;
+	poll_wait(file, &fl->async_wait, wait);
+	if (!list_empty_careful(&fl->async_done))
+		mask |= POLLIN | POLLRDNORM;
+	return mask;
+}
+
 static const struct file_operations fops = {
 	.open = fastrpc_device_open,
 	.release = fastrpc_device_release,
+	.poll = fastrpc_device_poll,
 	.unlocked_ioctl = fastrpc_device_ioctl,
 	.compat_ioctl = compat_fastrpc_device_ioctl,
 };
@@ -4737,6 +5434,8 @@ static int __init fastrpc_device_init(void)
 	int err = 0, i;
 
 	debugfs_root = debugfs_create_dir("adsprpc", NULL);
+	debugfs_create_file("latency", 0444, debugfs_root, NULL,
+				&fastrpc_latency_fops);
 	memset(me, 0, sizeof(*me));
 	fastrpc_init(me);
 	me->dev = NULL;
@@ -34,6 +34,13 @@
 #define FASTRPC_IOCTL_MUNMAP_FD _IOWR('R', 13, struct fastrpc_ioctl_munmap_fd)
 #define FASTRPC_IOCTL_GET_DSP_INFO \
 			_IOWR('R', 16, struct fastrpc_ioctl_dsp_capabilities)
+#define FASTRPC_IOCTL_INVOKE_ASYNC \
+			_IOWR('R', 17, struct fastrpc_ioctl_invoke_async)
+#define FASTRPC_IOCTL_INVOKE_BATCH \
+			_IOWR('R', 18, struct fastrpc_ioctl_invoke_batch)
+#define FASTRPC_IOCTL_ASYNC_RESPONSE \
+			_IOWR('R', 19, struct fastrpc_ioctl_async_response)
+#define FASTRPC_IOCTL_ASYNC_EVENTFD _IOWR('R', 20, int)
 
 #define FASTRPC_GLINK_GUID "fastrpcglink-apps-dsp"
 #define FASTRPC_SMD_GUID "fastrpcsmd-apps-dsp"
@@ -55,6 +62,18 @@
 /* Fastrpc attribute for no map */
 #define FASTRPC_ATTR_NOMAP   (16)
 
+/*
+ * CPU writes to the buffer are bracketed by DMA_BUF_IOCTL_SYNC, so the
+ * driver may skip flushing it while it is unchanged since the last flush
+ */
+#define FASTRPC_ATTR_CPU_SYNC   (32)
+
+/*
+ * Output buffer the remote overwrites completely, stale CPU lines are
+ * discarded instead of written back before the call
+ */
+#define FASTRPC_ATTR_DSP_WRITE_ONLY   (64)
+
 /* Driver should operate in parallel with the co-processor */
 #define FASTRPC_MODE_PARALLEL    0
 
@@ -73,6 +92,9 @@
 #define FASTRPC_INIT_CREATE_STATIC  2
 #define FASTRPC_INIT_ATTACH_SENSORS 3
 
+/* Retrives the method index from the scalars parameter */
+#define REMOTE_SCALARS_METHOD(sc)        (((sc) >> 24) & 0x1f)
+
 /* Retrives number of input buffers from the scalars parameter */
 #define REMOTE_SCALARS_INBUFS(sc)        (((sc) >> 16) & 0x0ff)
 
@@ -191,6 +213,27 @@ struct fastrpc_ioctl_invoke_crc {
 	unsigned int *crc;
 };
 
+/*
+ * Queued invoke, the argument buffers must stay valid until the job is
+ * reaped with FASTRPC_IOCTL_ASYNC_RESPONSE
+ */
+struct fastrpc_ioctl_invoke_async {
+	struct fastrpc_ioctl_invoke_crc inv;
+	uint64_t jobid;		/* returned job identifier */
+};
+
+struct fastrpc_ioctl_invoke_batch {
+	struct fastrpc_ioctl_invoke_async *invokes;	/* jobs to queue */
+	uint32_t count;		/* number of jobs */
+	uint32_t submitted;	/* jobs queued before the first failure */
+};
+
+struct fastrpc_ioctl_async_response {
+	uint64_t jobid;		/* job that completed */
+	int32_t result;		/* result of the remote call */
+	uint32_t reserved;
+};
+
 struct fastrpc_ioctl_init {
 	uint32_t flags;		/* one of FASTRPC_INIT_* macros */
 	uintptr_t file;		/* pointer to elf file */
@@ -22,6 +22,8 @@
 #include <linux/delay.h>
 #include <linux/kmemleak.h>
 #include <linux/uaccess.h>
+#include <linux/vmalloc.h>
+#include <linux/log2.h>
 #include "diagchar.h"
 #include "diag_memorydevice.h"
 #include "diagfwd_bridge.h"
@@ -135,9 +137,64 @@ void diag_md_close_all(void)
 	diag_ws_reset(DIAG_WS_MUX);
 }
 
+/*
+ * Copy one packet into the session ring. Returns -ENOMEM and counts a drop
+ * against the peripheral when the client has not made enough room.
+ */
+static int diag_md_ring_write(struct diag_md_ring *ring, int proc,
+			      int peripheral, unsigned char *buf, int len)
+{
+	struct diag_md_ring_hdr *hdr = ring->hdr;
+	struct diag_md_ring_rec *rec;
+	unsigned long flags;
+	uint32_t tail, used, off, pad, rec_len;
+
+	rec_len = ALIGN(sizeof(*rec) + len, DIAG_MD_RING_ALIGN);
+
+	spin_lock_irqsave(&ring->lock, flags);
+	tail = smp_load_acquire(&hdr->tail);
+	used = ring->head - tail;
+	off = ring->head & (ring->size - 1);
+	pad = (off + rec_len > ring->size) ? ring->size - off : 0;
+
+	/* A tail ahead of head is the client's bug; treat it as full */
+	if (rec_len > ring->size || used > ring->size ||
+	    ring->size - used < pad + rec_len) {
+		if (peripheral < DIAG_MD_RING_MAX_PERIPH)
+			hdr->drops[peripheral]++;
+		spin_unlock_irqrestore(&ring->lock, flags);
+		return -ENOMEM;
+	}
+
+	if (pad) {
+		rec = (struct diag_md_ring_rec *)(ring->data + off);
+		rec->len = pad - sizeof(*rec);
+		rec->proc = proc;
+		rec->peripheral = peripheral;
+		rec->flags = DIAG_MD_RING_F_PAD;
+		ring->head += pad;
+		off = 0;
+	}
+
+	rec = (struct diag_md_ring_rec *)(ring->data + off);
+	rec->len = len;
+	rec->proc = proc;
+	rec->peripheral = peripheral;
+	rec->flags = 0;
+	memcpy(rec + 1, buf, len);
+	ring->head += rec_len;
+
+	smp_store_release(&hdr->head, ring->head);
+	spin_unlock_irqrestore(&ring->lock, flags);
+
+	return 0;
+}
+
+
 int diag_md_write(int id, unsigned char *buf, int len, int ctx)
 {
 	int i, peripheral, pid = 0;
+	int err;
 	uint8_t found = 0;
 	unsigned long flags;
 	struct diag_md_info *ch = NULL;
@@ -167,6 +224,27 @@ int diag_md_write(int id, unsigned char *buf, int len, int ctx)
 		return -EINVAL;
 	}
 
+	/*
+	 * A session with a ring gets the packet copied straight to the
+	 * shared buffer, so the peripheral buffer is released here instead
+	 * of waiting in the table for a read.
+	 */
+	if (session_info->ring) {
+		err = diag_md_ring_write(session_info->ring, id, peripheral,
+					 buf, len);
+		if (!err) {
+			spin_lock_irqsave(&ch->lock, flags);
+			if (ch->ops && ch->ops->write_done)
+				ch->ops->write_done(buf, len, ctx,
+						    DIAG_MEMORY_DEVICE_MODE);
+			spin_unlock_irqrestore(&ch->lock, flags);
+		}
+		mutex_unlock(&driver->md_session_lock);
+		if (!err)
+			wake_up_interruptible(&driver->wait_q);
+		return err;
+	}
+
 	spin_lock_irqsave(&ch->lock, flags);
 	for (i = 0; i < ch->num_tbl_entries && !found; i++) {
 		if (ch->tbl[i].buf != buf)
@@ -397,6 +475,95 @@ int diag_md_close_peripheral(int id, uint8_t peripheral)
 	return 0;
 }
 
+static void diag_md_ring_release(struct kref *kref)
+{
+	struct diag_md_ring *ring = container_of(kref, struct diag_md_ring,
+						 kref);
+
+	vfree(ring->vaddr);
+	kfree(ring);
+}
+
+struct diag_md_ring *diag_md_ring_alloc(uint32_t size)
+{
+	struct diag_md_ring *ring;
+
+	if (size < DIAG_MD_RING_MIN_SIZE || size > DIAG_MD_RING_MAX_SIZE ||
+	    !is_power_of_2(size))
+		return ERR_PTR(-EINVAL);
+
+	ring = kzalloc(sizeof(*ring), GFP_KERNEL);
+	if (!ring)
+		return ERR_PTR(-ENOMEM);
+
+	/* The header gets a page of its own so the data area is aligned */
+	ring->map_size = PAGE_SIZE + size;
+	ring->vaddr = vmalloc_user(ring->map_size);
+	if (!ring->vaddr) {
+		kfree(ring);
+		return ERR_PTR(-ENOMEM);
+	}
+
+	kref_init(&ring->kref);
+	spin_lock_init(&ring->lock);
+	ring->size = size;
+	ring->hdr = ring->vaddr;
+	ring->data = (uint8_t *)ring->vaddr + PAGE_SIZE;
+	ring->hdr->version = DIAG_MD_RING_VERSION;
+	ring->hdr->size = size;
+	ring->hdr->data_offset = PAGE_SIZE;
+
+	return ring;
+}
+
+void diag_md_ring_put(struct diag_md_ring *ring)
+{
+	if (ring)
+		kref_put(&ring->kref, diag_md_ring_release);
+}
+
+bool diag_md_ring_empty(struct diag_md_ring *ring)
+{
+	return ring->head == READ_ONCE(ring->hdr->tail);
+}
+
+static void diag_md_ring_vm_open(struct vm_area_struct *vma)
+{
+	struct diag_md_ring *ring = vma->vm_private_data;
+
+	kref_get(&ring->kref);
+}
+
+static void diag_md_ring_vm_close(struct vm_area_struct *vma)
+{
+	diag_md_ring_put(vma->vm_private_data);
+}
+
+static const struct vm_operations_struct diag_md_ring_vm_ops = {
+	.open = diag_md_ring_vm_open,
+	.close = diag_md_ring_vm_close,
+};
+
+int diag_md_ring_mmap(struct diag_md_ring *ring, struct vm_area_struct *vma)
+{
+	int err;
+
+	if (vma->vm_pgoff ||
+	    vma->vm_end - vma->vm_start != ring->map_size)
+		return -EINVAL;
+
+	err = remap_vmalloc_range(vma, ring->vaddr, 0);
+	if (err)
+		return err;
+
+	vma->vm_flags |= VM_DONTCOPY;
+	vma->vm_private_data = ring;
+	vma->vm_ops = &diag_md_ring_vm_ops;
+	kref_get(&ring->kref);
+
+	return 0;
+}
+
 int diag_md_init(void)
 {
 	int i, j;
@@ -13,6 +13,9 @@
 #ifndef DIAG_MEMORYDEVICE_H
 #define DIAG_MEMORYDEVICE_H
 
+#include <linux/kref.h>
+#include <linux/mm.h>
+
 #define DIAG_MD_LOCAL		0
 #define DIAG_MD_LOCAL_LAST	1
 #define DIAG_MD_BRIDGE_BASE	DIAG_MD_LOCAL_LAST
@@ -44,6 +47,25 @@ struct diag_md_info {
 	struct diag_mux_ops *ops;
 };
 
+#define DIAG_MD_RING_MIN_SIZE	PAGE_SIZE
+#define DIAG_MD_RING_MAX_SIZE	(16 * 1024 * 1024)
+
+/*
+ * Kernel side of a memory device ring. The session holds one reference and
+ * every mapping of the ring holds another, so the buffer outlives a session
+ * that closes while the client still has it mapped.
+ */
+struct diag_md_ring {
+	struct kref kref;
+	spinlock_t lock;
+	void *vaddr;
+	struct diag_md_ring_hdr *hdr;
+	uint8_t *data;
+	uint32_t size;
+	uint32_t head;
+	uint32_t map_size;
+};
+
 extern struct diag_md_info diag_md[NUM_DIAG_MD_DEV];
 
 int diag_md_init(void);
@@ -57,4 +79,8 @@ int diag_md_close_peripheral(int id, uint8_t peripheral);
 int diag_md_write(int id, unsigned char *buf, int len, int ctx);
 int diag_md_copy_to_user(char __user *buf, int *pret, size_t buf_size,
 			 struct diag_md_session_t *info);
+struct diag_md_ring *diag_md_ring_alloc(uint32_t size);
+void diag_md_ring_put(struct diag_md_ring *ring);
+int diag_md_ring_mmap(struct diag_md_ring *ring, struct vm_area_struct *vma);
+bool diag_md_ring_empty(struct diag_md_ring *ring);
 #endif
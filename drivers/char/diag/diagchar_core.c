@@ -22,6 +22,7 @@
 #include <linux/sched.h>
 #include <linux/ratelimit.h>
 #include <linux/timer.h>
+#include <linux/poll.h>
 #include <linux/sched.h>
 #ifdef CONFIG_DIAG_OVER_USB
 #include <linux/usb/usbdiag.h>
@@ -1322,6 +1323,7 @@ static void diag_md_session_exit(void)
 			diag_event_mask_free(session_info->event_mask);
 			kfree(session_info->event_mask);
 			session_info->event_mask = NULL;
+			diag_md_ring_put(session_info->ring);
 			kfree(session_info);
 			session_info = NULL;
 			driver->md_session_map[i] = NULL;
@@ -1462,6 +1464,8 @@ static void diag_md_session_close(int pid)
 	kfree(session_info->event_mask);
 	session_info->event_mask = NULL;
 	del_timer(&session_info->hdlc_reset_timer);
+	diag_md_ring_put(session_info->ring);
+	session_info->ring = NULL;
 
 	for (i = 0; i < NUM_MD_SESSIONS && !found; i++) {
 		if (driver->md_session_map[i] != NULL)
@@ -2448,6 +2452,47 @@ static int diag_ioctl_query_pd_logging(struct diag_logging_mode_param_t *param)
 	return ret;
 }
 
+static int diag_ioctl_md_ring_setup(unsigned long ioarg)
+{
+	struct diag_md_ring_setup param;
+	struct diag_md_session_t *session_info = NULL;
+	struct diag_md_ring *ring = NULL;
+	int err = 0;
+
+	if (copy_from_user(&param, (void __user *)ioarg, sizeof(param)))
+		return -EFAULT;
+
+	ring = diag_md_ring_alloc(param.size);
+	if (IS_ERR(ring))
+		return PTR_ERR(ring);
+
+	mutex_lock(&driver->md_session_lock);
+	session_info = diag_md_session_get_pid(current->tgid);
+	if (!session_info)
+		err = -EINVAL;
+	else if (session_info->ring)
+		err = -EBUSY;
+	else
+		session_info->ring = ring;
+	mutex_unlock(&driver->md_session_lock);
+
+	if (err) {
+		diag_md_ring_put(ring);
+		return err;
+	}
+
+	DIAG_LOG(DIAG_DEBUG_USERSPACE,
+		 "diag: md ring of %u bytes set up for pid %d\n",
+		 param.size, current->tgid);
+
+	param.data_offset = ring->hdr->data_offset;
+	param.map_size = ring->map_size;
+	if (copy_to_user((void __user *)ioarg, &param, sizeof(param)))
+		return -EFAULT;
+
+	return 0;
+}
+
 static void diag_ioctl_query_session_pid(struct diag_query_pid_t *param)
 {
 	int prev_pid = 0, test_pid = 0, i = 0, count = 0;
@@ -2796,6 +2841,9 @@ long diagchar_compat_ioctl(struct file *filp,
 		else
 			result = 0;
 		break;
+	case DIAG_IOCTL_MD_RING_SETUP:
+		result = diag_ioctl_md_ring_setup(ioarg);
+		break;
 	}
 	return result;
 }
@@ -2946,6 +2994,9 @@ long diagchar_ioctl(struct file *filp,
 		else
 			result = 0;
 		break;
+	case DIAG_IOCTL_MD_RING_SETUP:
+		result = diag_ioctl_md_ring_setup(ioarg);
+		break;
 	}
 	return result;
 }
@@ -4103,6 +4154,38 @@ static int diag_real_time_info_init(void)
 	return 0;
 }
 
+static unsigned int diagchar_poll(struct file *file, poll_table *wait)
+{
+	struct diag_md_session_t *session_info = NULL;
+	unsigned int mask = 0;
+
+	poll_wait(file, &driver->wait_q, wait);
+
+	mutex_lock(&driver->md_session_lock);
+	session_info = diag_md_session_get_pid(current->tgid);
+	if (!session_info || !session_info->ring)
+		mask = DEFAULT_POLLMASK;
+	else if (!diag_md_ring_empty(session_info->ring))
+		mask = POLLIN | POLLRDNORM;
+	mutex_unlock(&driver->md_session_lock);
+
+	return mask;
+}
+
+static int diagchar_mmap(struct file *file, struct vm_area_struct *vma)
+{
+	struct diag_md_session_t *session_info = NULL;
+	int err = -EINVAL;
+
+	mutex_lock(&driver->md_session_lock);
+	session_info = diag_md_session_get_pid(current->tgid);
+	if (session_info && session_info->ring)
+		err = diag_md_ring_mmap(session_info->ring, vma);
+	mutex_unlock(&driver->md_session_lock);
+
+	return err;
+}
+
 static const struct file_operations diagcharfops = {
 	.owner = THIS_MODULE,
 	.read = diagchar_read,
@@ -4111,6 +4194,8 @@ static const struct file_operations diagcharfops = {
 	.compat_ioctl = diagchar_compat_ioctl,
 #endif
 	.unlocked_ioctl = diagchar_ioctl,
+	.poll = diagchar_poll,
+	.mmap = diagchar_mmap,
 	.open = diagchar_open,
 	.release = diagchar_close
 };
@@ -4207,6 +4292,7 @@ static int __init diagchar_init(void)
 
 	pr_debug("diagfwd initializing ..\n");
 	ret = 0;
+	diag_hdlc_selftest();
 	driver = kzalloc(sizeof(struct diagchar_dev) + 5, GFP_KERNEL);
 	if (!driver)
 		return -ENOMEM;
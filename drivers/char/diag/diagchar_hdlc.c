@@ -20,6 +20,7 @@
 #include <linux/uaccess.h>
 #include <linux/ratelimit.h>
 #include <linux/crc-ccitt.h>
+#include <asm/unaligned.h>
 #include "diagchar_hdlc.h"
 #include "diagchar.h"
 
@@ -31,6 +32,33 @@ MODULE_LICENSE("GPL v2");
 #define CRC_16_L_STEP(xx_crc, xx_c) \
 	crc_ccitt_byte(xx_crc, xx_c)
 
+#define HDLC_HAS_BYTE(w, c) \
+	((((w) ^ REPEAT_BYTE(c)) - REPEAT_BYTE(0x01)) & \
+	 ~((w) ^ REPEAT_BYTE(c)) & REPEAT_BYTE(0x80))
+
+/*
+ * Return the number of leading bytes of @buf, at most @len, that need no
+ * escaping. Scans a word at a time so runs of plain data can be copied and
+ * CRC'd in bulk.
+ */
+static size_t diag_hdlc_plain_len(const uint8_t *buf, size_t len)
+{
+	unsigned long w;
+	size_t i = 0;
+
+	while (len - i >= sizeof(w)) {
+		w = get_unaligned((const unsigned long *)(buf + i));
+		if (HDLC_HAS_BYTE(w, CONTROL_CHAR) || HDLC_HAS_BYTE(w, ESC_CHAR))
+			break;
+		i += sizeof(w);
+	}
+
+	while (i < len && buf[i] != CONTROL_CHAR && buf[i] != ESC_CHAR)
+		i++;
+
+	return i;
+}
+
 void diag_hdlc_encode(struct diag_send_desc_type *src_desc,
 		      struct diag_hdlc_dest_type *enc)
 {
@@ -42,6 +70,7 @@ void diag_hdlc_encode(struct diag_send_desc_type *src_desc,
 	unsigned char src_byte = 0;
 	enum diag_send_state_enum_type state;
 	unsigned int used = 0;
+	size_t run;
 
 	if (!src_desc || !enc)
 		return;
@@ -70,26 +99,29 @@ void diag_hdlc_encode(struct diag_send_desc_type *src_desc,
 		 */
 		while (src <= src_last && dest <= dest_last) {
 
-			src_byte = *src++;
-			if ((src_byte == CONTROL_CHAR) ||
-			    (src_byte == ESC_CHAR)) {
-				/* If the escape character is not the
-				 * last byte
-				 */
-				if (dest != dest_last) {
-					crc = CRC_16_L_STEP(crc, src_byte);
-					*dest++ = ESC_CHAR;
-					used++;
-					*dest++ = src_byte ^ ESC_MASK;
-					used++;
-				} else {
-					src--;
-					break;
-				}
-			} else {
+			/* Copy the run up to the next byte to escape */
+			run = diag_hdlc_plain_len(src,
+					min(src_last - src, dest_last - dest) + 1);
+			if (run) {
+				memcpy(dest, src, run);
+				crc = crc_ccitt(crc, src, run);
+				src += run;
+				dest += run;
+				used += run;
+				continue;
+			}
+
+			/* If the escape character is not the last byte */
+			src_byte = *src;
+			if (dest != dest_last) {
 				crc = CRC_16_L_STEP(crc, src_byte);
-				*dest++ = src_byte;
+				*dest++ = ESC_CHAR;
+				used++;
+				*dest++ = src_byte ^ ESC_MASK;
 				used++;
+				src++;
+			} else {
+				break;
 			}
 		}
 
@@ -156,6 +188,7 @@ int diag_hdlc_decode(struct diag_hdlc_decode_type *hdlc)
 
 	unsigned int len = 0;
 	unsigned int i;
+	size_t run;
 	uint8_t src_byte;
 
 	int pkt_bnd = HDLC_INCOMPLETE;
@@ -175,7 +208,22 @@ int diag_hdlc_decode(struct diag_hdlc_decode_type *hdlc)
 		dest_ptr = &dest_ptr[hdlc->dest_idx];
 		dest_length = hdlc->dest_size - hdlc->dest_idx;
 
-		for (i = 0; i < src_length; i++) {
+		i = 0;
+		while (i < src_length) {
+
+			/* Copy the run up to the next escape or flag byte */
+			if (!hdlc->escaping) {
+				run = diag_hdlc_plain_len(&src_ptr[i],
+					min(src_length - i, dest_length - len));
+				if (run) {
+					memcpy(&dest_ptr[len], &src_ptr[i], run);
+					len += run;
+					i += run;
+					if (len >= dest_length)
+						break;
+					continue;
+				}
+			}
 
 			src_byte = src_ptr[i];
 
@@ -189,9 +237,11 @@ int diag_hdlc_decode(struct diag_hdlc_decode_type *hdlc)
 					break;
 				}
 				dest_ptr[len++] = src_ptr[++i] ^ ESC_MASK;
-			} else if (src_byte == CONTROL_CHAR) {
-				if (msg_start && i == 0 && src_length > 1)
+			} else {
+				if (msg_start && i == 0 && src_length > 1) {
+					i++;
 					continue;
+				}
 				/* Byte 0x7E will be considered as end of
 				 * packet
 				 */
@@ -199,14 +249,11 @@ int diag_hdlc_decode(struct diag_hdlc_decode_type *hdlc)
 				i++;
 				pkt_bnd = HDLC_COMPLETE;
 				break;
-			} else {
-				dest_ptr[len++] = src_byte;
 			}
 
-			if (len >= dest_length) {
-				i++;
+			i++;
+			if (len >= dest_length)
 				break;
-			}
 		}
 
 		hdlc->src_idx += i;
@@ -0,0 +1,339 @@
+/* Copyright (c) 2018, The Linux Foundation. All rights reserved.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 and
+ * only version 2 as published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ */
+
+#define pr_fmt(fmt) "diag: hdlc selftest: " fmt
+
+#include <linux/kernel.h>
+#include <linux/random.h>
+#include <linux/slab.h>
+#include <linux/string.h>
+#include <linux/crc-ccitt.h>
+#include "diagchar_hdlc.h"
+#include "diagchar.h"
+
+#define HDLC_TEST_MAX_LEN	600
+#define HDLC_TEST_ENC_LEN	(2 * HDLC_TEST_MAX_LEN + 8)
+#define HDLC_TEST_ITER_MAX	(4 * HDLC_TEST_ENC_LEN)
+
+struct diag_hdlc_test_buf {
+	uint8_t src[HDLC_TEST_MAX_LEN];
+	uint8_t ref[HDLC_TEST_ENC_LEN];
+	uint8_t out[HDLC_TEST_ENC_LEN];
+	uint8_t dec_ref[HDLC_TEST_ENC_LEN];
+	uint8_t dec_out[HDLC_TEST_ENC_LEN];
+};
+
+static const unsigned int diag_hdlc_test_lens[] = {
+	1, 2, 3, 7, 8, 9, 15, 16, 17, 63, 64, 65, 255, 256, 511,
+	HDLC_TEST_MAX_LEN,
+};
+
+static const unsigned int diag_hdlc_test_chunks[] = {
+	2, 3, 5, 8, 13, 64, HDLC_TEST_ENC_LEN,
+};
+
+/* Byte at a time reference, as diag_hdlc_encode() used to be */
+static void diag_hdlc_encode_ref(struct diag_send_desc_type *src_desc,
+				 struct diag_hdlc_dest_type *enc)
+{
+	uint8_t *dest = enc->dest;
+	uint8_t *dest_last = enc->dest_last;
+	const uint8_t *src = src_desc->pkt;
+	const uint8_t *src_last = src_desc->last;
+	enum diag_send_state_enum_type state = src_desc->state;
+	unsigned char src_byte;
+	uint16_t crc;
+
+	if (state == DIAG_STATE_START) {
+		crc = 0xFFFF;
+		state++;
+	} else {
+		crc = enc->crc;
+	}
+
+	while (src <= src_last && dest <= dest_last) {
+		src_byte = *src++;
+		if (src_byte == CONTROL_CHAR || src_byte == ESC_CHAR) {
+			if (dest == dest_last) {
+				src--;
+				break;
+			}
+			crc = crc_ccitt_byte(crc, src_byte);
+			*dest++ = ESC_CHAR;
+			*dest++ = src_byte ^ ESC_MASK;
+		} else {
+			crc = crc_ccitt_byte(crc, src_byte);
+			*dest++ = src_byte;
+		}
+	}
+
+	if (src > src_last) {
+		if (state == DIAG_STATE_BUSY) {
+			if (src_desc->terminate) {
+				crc = ~crc;
+				state++;
+			} else {
+				state = DIAG_STATE_COMPLETE;
+			}
+		}
+
+		while (dest <= dest_last && state >= DIAG_STATE_CRC1 &&
+		       state < DIAG_STATE_TERM) {
+			src_byte = crc & 0xFF;
+			if (src_byte == CONTROL_CHAR || src_byte == ESC_CHAR) {
+				if (dest == dest_last)
+					break;
+				*dest++ = ESC_CHAR;
+				*dest++ = src_byte ^ ESC_MASK;
+			} else {
+				*dest++ = src_byte;
+			}
+			crc >>= 8;
+			state++;
+		}
+
+		if (state == DIAG_STATE_TERM && dest_last >= dest) {
+			*dest++ = CONTROL_CHAR;
+			state++;
+		}
+	}
+
+	enc->dest = dest;
+	enc->crc = crc;
+	src_desc->pkt = src;
+	src_desc->state = state;
+}
+
+/* Byte at a time reference, as diag_hdlc_decode() used to be */
+static int diag_hdlc_decode_ref(struct diag_hdlc_decode_type *hdlc)
+{
+	uint8_t *src_ptr, *dest_ptr;
+	unsigned int src_length, dest_length;
+	unsigned int len = 0;
+	unsigned int i;
+	uint8_t src_byte;
+	int pkt_bnd = HDLC_INCOMPLETE;
+	int msg_start;
+
+	if (!(hdlc->src_size > hdlc->src_idx &&
+	      hdlc->dest_size > hdlc->dest_idx))
+		return pkt_bnd;
+
+	msg_start = (hdlc->src_idx == 0) ? 1 : 0;
+	src_ptr = &hdlc->src_ptr[hdlc->src_idx];
+	src_length = hdlc->src_size - hdlc->src_idx;
+	dest_ptr = &hdlc->dest_ptr[hdlc->dest_idx];
+	dest_length = hdlc->dest_size - hdlc->dest_idx;
+
+	for (i = 0; i < src_length; i++) {
+		src_byte = src_ptr[i];
+		if (hdlc->escaping) {
+			dest_ptr[len++] = src_byte ^ ESC_MASK;
+			hdlc->escaping = 0;
+		} else if (src_byte == ESC_CHAR) {
+			if (i == (src_length - 1)) {
+				hdlc->escaping = 1;
+				i++;
+				break;
+			}
+			dest_ptr[len++] = src_ptr[++i] ^ ESC_MASK;
+		} else if (src_byte == CONTROL_CHAR) {
+			if (msg_start && i == 0 && src_length > 1)
+				continue;
+			dest_ptr[len++] = src_byte;
+			i++;
+			pkt_bnd = HDLC_COMPLETE;
+			break;
+		} else {
+			dest_ptr[len++] = src_byte;
+		}
+
+		if (len >= dest_length) {
+			i++;
+			break;
+		}
+	}
+
+	hdlc->src_idx += i;
+	hdlc->dest_idx += len;
+
+	return pkt_bnd;
+}
+
+static void diag_hdlc_test_fill(uint8_t *buf, unsigned int len,
+				unsigned int density)
+{
+	unsigned int i;
+
+	prandom_bytes(buf, len);
+	if (!density)
+		return;
+	/* Sprinkle in bytes that must be escaped */
+	for (i = 0; i < len; i++)
+		if (buf[i] % density == 0)
+			buf[i] = (buf[i] & 0x80) ? CONTROL_CHAR : ESC_CHAR;
+}
+
+typedef void (*diag_hdlc_encode_fn)(struct diag_send_desc_type *,
+				    struct diag_hdlc_dest_type *);
+typedef int (*diag_hdlc_decode_fn)(struct diag_hdlc_decode_type *);
+
+/* Encode @src in @chunk sized output windows; returns the encoded length */
+static int diag_hdlc_test_encode(diag_hdlc_encode_fn encode,
+				 const uint8_t *src, unsigned int len,
+				 unsigned int chunk, uint8_t *out)
+{
+	struct diag_send_desc_type desc;
+	struct diag_hdlc_dest_type enc;
+	uint8_t *pos = out;
+	uint8_t *end = out + HDLC_TEST_ENC_LEN;
+	int iter;
+
+	desc.pkt = src;
+	desc.last = src + len - 1;
+	desc.state = DIAG_STATE_START;
+	desc.terminate = 1;
+	enc.crc = 0;
+
+	for (iter = 0; iter < HDLC_TEST_ITER_MAX; iter++) {
+		enc.dest = pos;
+		enc.dest_last = min(pos + chunk, end) - 1;
+		encode(&desc, &enc);
+		pos = enc.dest;
+		if (desc.state == DIAG_STATE_COMPLETE)
+			return pos - out;
+	}
+
+	return -EIO;
+}
+
+/* Decode @src in @schunk input and @dchunk output windows */
+static int diag_hdlc_test_decode(diag_hdlc_decode_fn decode,
+				 uint8_t *src, unsigned int len,
+				 unsigned int schunk, unsigned int dchunk,
+				 uint8_t *out, struct diag_hdlc_decode_type *hdlc)
+{
+	int iter;
+	int ret = HDLC_INCOMPLETE;
+
+	memset(hdlc, 0, sizeof(*hdlc));
+	hdlc->src_ptr = src;
+	hdlc->dest_ptr = out;
+
+	for (iter = 0; iter < HDLC_TEST_ITER_MAX && hdlc->src_idx < len;
+	     iter++) {
+		hdlc->src_size = min(hdlc->src_idx + schunk, len);
+		hdlc->dest_size = min_t(unsigned int,
+					hdlc->dest_idx + dchunk,
+					HDLC_TEST_ENC_LEN);
+		ret = decode(hdlc);
+		if (ret == HDLC_COMPLETE)
+			break;
+	}
+
+	return ret;
+}
+
+static int diag_hdlc_test_one(struct diag_hdlc_test_buf *b, unsigned int len,
+			      unsigned int density, unsigned int chunk)
+{
+	struct diag_hdlc_decode_type h_ref, h_out;
+	int ref_len, out_len, ret_ref, ret_out;
+	uint8_t *stream;
+	unsigned int stream_len;
+	unsigned int dchunk;
+
+	diag_hdlc_test_fill(b->src, len, density);
+
+	ref_len = diag_hdlc_test_encode(diag_hdlc_encode_ref, b->src, len,
+					chunk, b->ref);
+	out_len = diag_hdlc_test_encode(diag_hdlc_encode, b->src, len,
+					chunk, b->out);
+	if (ref_len < 0 || ref_len != out_len ||
+	    memcmp(b->ref, b->out, ref_len)) {
+		pr_err("encode mismatch len %u density %u chunk %u: %d vs %d\n",
+		       len, density, chunk, ref_len, out_len);
+		return -EINVAL;
+	}
+
+	/* Exercise the leading flag byte skip on every other stream */
+	stream = b->ref;
+	stream_len = ref_len;
+	if (len & 1) {
+		memmove(b->ref + 1, b->ref, ref_len);
+		b->ref[0] = CONTROL_CHAR;
+		stream_len++;
+	}
+
+	dchunk = chunk > 3 ? chunk - 3 : chunk;
+	ret_ref = diag_hdlc_test_decode(diag_hdlc_decode_ref, stream,
+					stream_len, chunk, dchunk, b->dec_ref,
+					&h_ref);
+	ret_out = diag_hdlc_test_decode(diag_hdlc_decode, stream,
+					stream_len, chunk, dchunk, b->dec_out,
+					&h_out);
+	if (ret_ref != ret_out || h_ref.src_idx != h_out.src_idx ||
+	    h_ref.dest_idx != h_out.dest_idx ||
+	    h_ref.escaping != h_out.escaping ||
+	    memcmp(b->dec_ref, b->dec_out, h_ref.dest_idx)) {
+		pr_err("decode mismatch len %u density %u chunk %u\n",
+		       len, density, chunk);
+		return -EINVAL;
+	}
+
+	/* The decoded frame must carry the original data and a good CRC */
+	if (ret_out != HDLC_COMPLETE || h_out.dest_idx != len + 3 ||
+	    memcmp(b->dec_out, b->src, len) ||
+	    crc_check(b->dec_out, h_out.dest_idx)) {
+		pr_err("decode roundtrip failed len %u density %u chunk %u\n",
+		       len, density, chunk);
+		return -EINVAL;
+	}
+
+	return 0;
+}
+
+/**
+ * diag_hdlc_selftest() - compare the HDLC fast paths to byte-wise copies
+ *
+ * Encodes random frames with varying escape density through both
+ * implementations in output windows of several sizes, then decodes the
+ * result in split input and output windows, checking that outputs and
+ * decoder state match exactly and that the frame round-trips.
+ */
+void diag_hdlc_selftest(void)
+{
+	static const unsigned int densities[] = { 0, 2, 7, 61 };
+	struct diag_hdlc_test_buf *b;
+	unsigned int l, d, c;
+	int failures = 0;
+
+	b = kzalloc(sizeof(*b), GFP_KERNEL);
+	if (!b)
+		return;
+
+	for (l = 0; l < ARRAY_SIZE(diag_hdlc_test_lens); l++)
+		for (d = 0; d < ARRAY_SIZE(densities); d++)
+			for (c = 0; c < ARRAY_SIZE(diag_hdlc_test_chunks); c++)
+				if (diag_hdlc_test_one(b,
+						diag_hdlc_test_lens[l],
+						densities[d],
+						diag_hdlc_test_chunks[c]))
+					failures++;
+
+	kfree(b);
+
+	if (failures)
+		pr_err("%d failures\n", failures);
+	else
+		pr_info("passed\n");
+}
@@ -32,17 +32,43 @@ struct cpu_sync {
 	int cpu;
 	unsigned int input_boost_min;
 	unsigned int input_boost_freq;
+	unsigned int fling_boost_freq;
 };
 
 static DEFINE_PER_CPU(struct cpu_sync, sync_info);
 
 static struct kthread_work input_boost_work;
+static struct kthread_work fling_boost_work;
 
 static bool input_boost_enabled;
+static bool fling_boost_enabled;
 
 static unsigned int input_boost_ms = 40;
 module_param(input_boost_ms, uint, 0644);
 
+static unsigned int fling_boost_ms = 500;
+module_param(fling_boost_ms, uint, 0644);
+
+/* Distance the first finger must travel for its release to count as fling */
+static unsigned int fling_min_dist = 100;
+module_param(fling_min_dist, uint, 0644);
+
+static unsigned int input_boost_count;
+module_param(input_boost_count, uint, 0444);
+
+static unsigned int fling_boost_count;
+module_param(fling_boost_count, uint, 0444);
+
+struct fling_track {
+	int slot;
+	bool down;
+	bool have_x, have_y;
+	int x0, y0;
+	int x, y;
+};
+
+static struct fling_track fling_track;
+
 static unsigned int sched_boost_on_input;
 module_param(sched_boost_on_input, uint, 0644);
 
@@ -58,7 +84,14 @@ static struct task_struct *cpu_boost_worker_thread;
 
 #define MIN_INPUT_INTERVAL (100 * USEC_PER_MSEC)
 
-static int set_input_boost_freq(const char *buf, const struct kernel_param *kp)
+static unsigned int *boost_freq_ptr(unsigned int cpu, bool fling)
+{
+	struct cpu_sync *s = &per_cpu(sync_info, cpu);
+
+	return fling ? &s->fling_boost_freq : &s->input_boost_freq;
+}
+
+static int set_boost_freq(const char *buf, bool fling)
 {
 	int i, ntokens = 0;
 	unsigned int val, cpu;
@@ -73,7 +106,7 @@ static int set_input_boost_freq(const char *buf, const struct kernel_param *kp)
 		if (sscanf(buf, "%u\n", &val) != 1)
 			return -EINVAL;
 		for_each_possible_cpu(i)
-			per_cpu(sync_info, i).input_boost_freq = val;
+			*boost_freq_ptr(i, fling) = val;
 		goto check_enable;
 	}
 
@@ -88,43 +121,69 @@ static int set_input_boost_freq(const char *buf, const struct kernel_param *kp)
 		if (cpu >= num_possible_cpus())
 			return -EINVAL;
 
-		per_cpu(sync_info, cpu).input_boost_freq = val;
+		*boost_freq_ptr(cpu, fling) = val;
 		cp = strchr(cp, ' ');
 		cp++;
 	}
 
 check_enable:
 	for_each_possible_cpu(i) {
-		if (per_cpu(sync_info, i).input_boost_freq) {
+		if (*boost_freq_ptr(i, fling)) {
 			enabled = true;
 			break;
 		}
 	}
-	input_boost_enabled = enabled;
+	if (fling)
+		fling_boost_enabled = enabled;
+	else
+		input_boost_enabled = enabled;
 
 	return 0;
 }
 
-static int get_input_boost_freq(char *buf, const struct kernel_param *kp)
+static int get_boost_freq(char *buf, bool fling)
 {
 	int cnt = 0, cpu;
-	struct cpu_sync *s;
 
-	for_each_possible_cpu(cpu) {
-		s = &per_cpu(sync_info, cpu);
+	for_each_possible_cpu(cpu)
 		cnt += snprintf(buf + cnt, PAGE_SIZE - cnt,
-				"%d:%u ", cpu, s->input_boost_freq);
-	}
+				"%d:%u ", cpu, *boost_freq_ptr(cpu, fling));
 	cnt += snprintf(buf + cnt, PAGE_SIZE - cnt, "\n");
 	return cnt;
 }
 
+static int set_input_boost_freq(const char *buf, const struct kernel_param *kp)
+{
+	return set_boost_freq(buf, false);
+}
+
+static int get_input_boost_freq(char *buf, const struct kernel_param *kp)
+{
+	return get_boost_freq(buf, false);
+}
+
 static const struct kernel_param_ops param_ops_input_boost_freq = {
 	.set = set_input_boost_freq,
 	.get = get_input_boost_freq,
 };
 module_param_cb(input_boost_freq, &param_ops_input_boost_freq, NULL, 0644);
 
+static int set_fling_boost_freq(const char *buf, const struct kernel_param *kp)
+{
+	return set_boost_freq(buf, true);
+}
+
+static int get_fling_boost_freq(char *buf, const struct kernel_param *kp)
+{
+	return get_boost_freq(buf, true);
+}
+
+static const struct kernel_param_ops param_ops_fling_boost_freq = {
+	.set = set_fling_boost_freq,
+	.get = get_fling_boost_freq,
+};
+module_param_cb(fling_boost_freq, &param_ops_fling_boost_freq, NULL, 0644);
+
 /*
  * The CPUFREQ_ADJUST notifier is used to override the current policy min to
  * make sure policy min >= boost_min. The cpufreq framework then does the job
@@ -197,9 +256,9 @@ static void do_input_boost_rem(struct work_struct *work)
 	}
 }
 
-static void do_input_boost(struct kthread_work *work)
+static void do_boost(bool fling)
 {
-	unsigned int i, ret;
+	unsigned int i, ret, freq;
 	struct cpu_sync *i_sync_info;
 
 	cancel_delayed_work_sync(&input_boost_rem);
@@ -212,7 +271,9 @@ static void do_input_boost(struct kthread_work *work)
 	pr_debug("Setting input boost min for all CPUs\n");
 	for_each_possible_cpu(i) {
 		i_sync_info = &per_cpu(sync_info, i);
-		i_sync_info->input_boost_min = i_sync_info->input_boost_freq;
+		freq = fling ? i_sync_info->fling_boost_freq : 0;
+		i_sync_info->input_boost_min =
+			max(freq, i_sync_info->input_boost_freq);
 	}
 
 	/* Update policies for all online CPUs */
@@ -227,7 +288,88 @@ static void do_input_boost(struct kthread_work *work)
 			sched_boost_active = true;
 	}
 
-	schedule_delayed_work(&input_boost_rem, msecs_to_jiffies(input_boost_ms));
+	if (fling) {
+		fling_boost_count++;
+		schedule_delayed_work(&input_boost_rem,
+				msecs_to_jiffies(fling_boost_ms));
+	} else {
+		input_boost_count++;
+		schedule_delayed_work(&input_boost_rem,
+				msecs_to_jiffies(input_boost_ms));
+	}
+}
+
+static void do_input_boost(struct kthread_work *work)
+{
+	do_boost(false);
+}
+
+static void do_fling_boost(struct kthread_work *work)
+{
+	do_boost(true);
+}
+
+/*
+ * Follow the first finger between touch down and release; if it travelled
+ * far enough the content usually keeps scrolling after the lift, so hold
+ * the fling boost for that animation.
+ */
+static bool cpuboost_track_fling(unsigned int type, unsigned int code,
+		int value)
+{
+	struct fling_track *t = &fling_track;
+	unsigned int dist = 0;
+
+	if (type == EV_ABS) {
+		switch (code) {
+		case ABS_MT_SLOT:
+			t->slot = value;
+			break;
+		case ABS_MT_POSITION_X:
+			if (t->slot || !t->down)
+				break;
+			if (!t->have_x)
+				t->x0 = value;
+			t->x = value;
+			t->have_x = true;
+			break;
+		case ABS_MT_POSITION_Y:
+			if (t->slot || !t->down)
+				break;
+			if (!t->have_y)
+				t->y0 = value;
+			t->y = value;
+			t->have_y = true;
+			break;
+		}
+		return false;
+	}
+
+	if (type != EV_KEY || code != BTN_TOUCH)
+		return false;
+
+	if (value) {
+		t->down = true;
+		t->have_x = t->have_y = false;
+		return false;
+	}
+
+	if (!t->down)
+		return false;
+	t->down = false;
+
+	if (t->have_x)
+		dist += abs(t->x - t->x0);
+	if (t->have_y)
+		dist += abs(t->y - t->y0);
+	if (dist < fling_min_dist)
+		return false;
+
+	if (queuing_blocked(&cpu_boost_worker, &fling_boost_work))
+		return false;
+
+	kthread_queue_work(&cpu_boost_worker, &fling_boost_work);
+	return true;
 }
 
 static void cpuboost_input_event(struct input_handle *handle,
@@ -235,6 +377,10 @@ static void cpuboost_input_event(struct input_handle *handle,
 {
 	u64 now;
 
+	/* The release must not replace a fling boost with the short one */
+	if (fling_boost_enabled && cpuboost_track_fling(type, code, value))
+		return;
+
 	if (!input_boost_enabled)
 		return;
 
@@ -354,6 +500,7 @@ static int cpu_boost_init(void)
 	wake_up_process(cpu_boost_worker_thread);
 
 	kthread_init_work(&input_boost_work, do_input_boost);
+	kthread_init_work(&fling_boost_work, do_fling_boost);
 	// alex.naidis@paranoidandroid.co Rework scheduling setup - end
 	INIT_DELAYED_WORK(&input_boost_rem, do_input_boost_rem);
 
@@ -37,6 +37,45 @@
 
 static DEFINE_PER_CPU(struct update_util_data, update_util);
 
+/* What decided the outcome of one evaluation */
+enum interactive_reason {
+	REASON_LOAD,		/* choose_freq() on the policy load */
+	REASON_HISPEED,		/* go_hispeed_load or max_freq_hysteresis */
+	REASON_BOOST,		/* boost or boostpulse */
+	REASON_MAX,		/* heavy new task or predicted load */
+	REASON_HISPEED_DELAY,	/* raise held back by above_hispeed_delay */
+	REASON_MIN_SAMPLE,	/* drop held back by min_sample_time */
+	REASON_ALREADY,		/* already at the chosen frequency */
+	REASON_NR,
+};
+
+static const char * const reason_names[REASON_NR] = {
+	[REASON_LOAD] = "load",
+	[REASON_HISPEED] = "hispeed",
+	[REASON_BOOST] = "boost",
+	[REASON_MAX] = "max",
+	[REASON_HISPEED_DELAY] = "hispeed_delay",
+	[REASON_MIN_SAMPLE] = "min_sample",
+	[REASON_ALREADY] = "already",
+};
+
+#define DECISION_RING_SIZE 32
+
+struct interactive_decision {
+	u64 time;
+	unsigned int load;
+	unsigned int cur;
+	unsigned int target;
+	unsigned int new_freq;
+	enum interactive_reason reason;
+};
+
+/* Upper bounds in usecs of the transition latency buckets */
+static const unsigned int trans_lat_bounds[] = {
+	100, 500, 1000, 2000, 5000, 10000,
+};
+#define TRANS_LAT_BUCKETS (ARRAY_SIZE(trans_lat_bounds) + 1)
+
 struct cpufreq_interactive_policyinfo {
 	bool work_in_progress;
 	struct irq_work irq_work;
@@ -62,6 +101,13 @@ struct cpufreq_interactive_policyinfo {
 	int governor_enabled;
 	struct cpufreq_interactive_tunables *cached_tunables;
 	struct sched_load *sl;
+
+	/* Protected by target_freq_lock */
+	struct interactive_decision decisions[DECISION_RING_SIZE];
+	unsigned int ndecisions;
+	u64 target_set_time;
+	unsigned int trans_lat[TRANS_LAT_BUCKETS];
+	unsigned int trans_lat_max;
 };
 
 /* Protected by per-policy load_lock */
@@ -164,6 +210,13 @@ struct cpufreq_interactive_tunables {
 
 	/* Whether to enable prediction or not */
 	bool enable_prediction;
+
+	/*
+	 * Take the load from the scheduler's current CPU utilisation on
+	 * every update_util kick instead of from idle time since the last
+	 * evaluation.
+	 */
+	bool use_sched_util;
 };
 
 /* For cases where we have single governor instance for system */
@@ -238,14 +291,20 @@ static void update_util_handler(struct update_util_data *data, u64 time,
 	struct cpufreq_interactive_policyinfo *ppol;
 	unsigned long flags;
 
+	struct cpufreq_interactive_tunables *tunables;
+
 	ppol = *this_cpu_ptr(&polinfo);
+	tunables = ppol->policy->governor_data;
 	spin_lock_irqsave(&ppol->irq_work_lock, flags);
 	/*
 	 * The irq-work may not be allowed to be queued up right now
 	 * because work has already been queued up or is in progress.
+	 * Utilisation moves with a migrating task, so in sched_util mode
+	 * both clusters want to re-evaluate after an inter-cluster move.
 	 */
 	if (ppol->work_in_progress ||
-	    sched_flags & SCHED_CPUFREQ_INTERCLUSTER_MIG)
+	    (sched_flags & SCHED_CPUFREQ_INTERCLUSTER_MIG &&
+	     !tunables->use_sched_util))
 		goto out;
 
 	ppol->work_in_progress = true;
@@ -485,6 +544,22 @@ static unsigned int sl_busy_to_laf(struct cpufreq_interactive_policyinfo *ppol,
 	return prev_load;
 }
 
+/* Called with target_freq_lock held */
+static void record_decision(struct cpufreq_interactive_policyinfo *ppol,
+			    u64 now, unsigned int load, unsigned int new_freq,
+			    enum interactive_reason reason)
+{
+	struct interactive_decision *d;
+
+	d = &ppol->decisions[ppol->ndecisions++ % DECISION_RING_SIZE];
+	d->time = now;
+	d->load = load;
+	d->cur = ppol->policy->cur;
+	d->target = ppol->target_freq;
+	d->new_freq = new_freq;
+	d->reason = reason;
+}
+
 #define NEW_TASK_RATIO 75
 #define PRED_TOLERANCE_PCT 10
 static void cpufreq_interactive_timer(int data)
@@ -509,10 +584,12 @@ static void cpufreq_interactive_timer(int data)
 	int i, cpu;
 	int new_load_pct = 0;
 	int prev_l, pred_l = 0;
+	unsigned int util, timer_l;
 	struct cpufreq_govinfo govinfo;
 	bool skip_hispeed_logic, skip_min_sample_time;
 	bool jump_to_max_no_ts = false;
 	bool jump_to_max = false;
+	enum interactive_reason reason = REASON_LOAD;
 
 	if (!down_read_trylock(&ppol->enable_sem))
 		return;
@@ -537,7 +614,31 @@ static void cpufreq_interactive_timer(int data)
 	i = 0;
 	for_each_cpu(cpu, ppol->policy->cpus) {
 		pcpu = &per_cpu(cpuinfo, cpu);
-		if (tunables->use_sched_load) {
+		if (tunables->use_sched_util) {
+			/*
+			 * sched_get_cpu_util() is a percentage of the CPU's
+			 * capacity at its highest frequency. It follows a
+			 * task that moves between CPUs of the policy, so
+			 * no load is left behind on the CPU it came from.
+			 */
+			util = sched_get_cpu_util(cpu);
+			t_prevlaf = util * ppol->policy->cpuinfo.max_freq;
+			prev_l = t_prevlaf / ppol->target_freq;
+
+			/* Keep the idle based load going for A/B traces */
+			now = update_load(cpu);
+			delta_time = (unsigned int)
+				(now - pcpu->cputime_speedadj_timestamp);
+			cputime_speedadj = pcpu->cputime_speedadj;
+			if (delta_time)
+				do_div(cputime_speedadj, delta_time);
+			else
+				cputime_speedadj = 0;
+			timer_l = (unsigned int)cputime_speedadj * 100 /
+					ppol->target_freq;
+			trace_cpufreq_interactive_util(cpu, util, prev_l,
+						       timer_l);
+		} else if (tunables->use_sched_load) {
 			t_prevlaf = sl_busy_to_laf(ppol, sl[i].prev_load);
 			prev_l = t_prevlaf / ppol->target_freq;
 			if (tunables->enable_prediction) {
@@ -610,6 +711,7 @@ static void cpufreq_interactive_timer(int data)
 	new_freq = chosen_freq;
 	if (jump_to_max_no_ts || jump_to_max) {
 		new_freq = ppol->policy->cpuinfo.max_freq;
+		reason = REASON_MAX;
 	} else if (!skip_hispeed_logic) {
 		if (pol_load >= tunables->go_hispeed_load ||
 		    tunables->boosted) {
@@ -618,12 +720,18 @@ static void cpufreq_interactive_timer(int data)
 			else
 				new_freq = max(new_freq,
 					       tunables->hispeed_freq);
+			if (new_freq != chosen_freq)
+				reason = pol_load >= tunables->go_hispeed_load ?
+					 REASON_HISPEED : REASON_BOOST;
 		}
 	}
 
 	if (now - ppol->max_freq_hyst_start_time <
-	    tunables->max_freq_hysteresis)
-		new_freq = max(tunables->hispeed_freq, new_freq);
+	    tunables->max_freq_hysteresis &&
+	    new_freq < tunables->hispeed_freq) {
+		new_freq = tunables->hispeed_freq;
+		reason = REASON_HISPEED;
+	}
 
 	if (!skip_hispeed_logic &&
 	    ppol->target_freq >= tunables->hispeed_freq &&
@@ -633,6 +741,8 @@ static void cpufreq_interactive_timer(int data)
 		trace_cpufreq_interactive_notyet(
 			max_cpu, pol_load, ppol->target_freq,
 			ppol->policy->cur, new_freq);
+		record_decision(ppol, now, pol_load, ppol->target_freq,
+				REASON_HISPEED_DELAY);
 		spin_unlock_irqrestore(&ppol->target_freq_lock, flags);
 		goto rearm;
 	}
@@ -653,6 +763,8 @@ static void cpufreq_interactive_timer(int data)
 			trace_cpufreq_interactive_notyet(
 				max_cpu, pol_load, ppol->target_freq,
 				ppol->policy->cur, new_freq);
+			record_decision(ppol, now, pol_load, ppol->target_freq,
+					REASON_MIN_SAMPLE);
 			spin_unlock_irqrestore(&ppol->target_freq_lock, flags);
 			goto rearm;
 		}
@@ -683,14 +795,17 @@ static void cpufreq_interactive_timer(int data)
 		trace_cpufreq_interactive_already(
 			max_cpu, pol_load, ppol->target_freq,
 			ppol->policy->cur, new_freq);
+		record_decision(ppol, now, pol_load, new_freq, REASON_ALREADY);
 		spin_unlock_irqrestore(&ppol->target_freq_lock, flags);
 		goto rearm;
 	}
 
 	trace_cpufreq_interactive_target(max_cpu, pol_load, ppol->target_freq,
 					 ppol->policy->cur, new_freq);
+	record_decision(ppol, now, pol_load, new_freq, reason);
 
 	ppol->target_freq = new_freq;
+	ppol->target_set_time = now;
 	spin_unlock_irqrestore(&ppol->target_freq_lock, flags);
 	spin_lock_irqsave(&speedchange_cpumask_lock, flags);
 	cpumask_set_cpu(max_cpu, &speedchange_cpumask);
@@ -722,6 +837,21 @@ static void cpufreq_interactive_timer(int data)
 	return;
 }
 
+static void update_trans_lat(struct cpufreq_interactive_policyinfo *ppol)
+{
+	unsigned long flags;
+	unsigned int lat, i;
+
+	spin_lock_irqsave(&ppol->target_freq_lock, flags);
+	lat = ktime_to_us(ktime_get()) - ppol->target_set_time;
+	for (i = 0; i < ARRAY_SIZE(trans_lat_bounds); i++)
+		if (lat < trans_lat_bounds[i])
+			break;
+	ppol->trans_lat[i]++;
+	ppol->trans_lat_max = max(ppol->trans_lat_max, lat);
+	spin_unlock_irqrestore(&ppol->target_freq_lock, flags);
+}
+
 static int cpufreq_interactive_speedchange_task(void *data)
 {
 	unsigned int cpu;
@@ -758,10 +888,12 @@ static int cpufreq_interactive_speedchange_task(void *data)
 				continue;
 			}
 
-			if (ppol->target_freq != ppol->policy->cur)
+			if (ppol->target_freq != ppol->policy->cur) {
 				__cpufreq_driver_target(ppol->policy,
 							ppol->target_freq,
 							CPUFREQ_RELATION_H);
+				update_trans_lat(ppol);
+			}
 			trace_cpufreq_interactive_setspeed(cpu,
 						     ppol->target_freq,
 						     ppol->policy->cur);
@@ -790,10 +922,13 @@ static void cpufreq_interactive_boost(struct cpufreq_interactive_tunables *tunab
 
 		spin_lock_irqsave(&ppol->target_freq_lock, flags[1]);
 		if (ppol->target_freq < tunables->hispeed_freq) {
-			ppol->target_freq = tunables->hispeed_freq;
-			cpumask_set_cpu(i, &speedchange_cpumask);
 			ppol->hispeed_validate_time =
 				ktime_to_us(ktime_get());
+			record_decision(ppol, ppol->hispeed_validate_time, 0,
+					tunables->hispeed_freq, REASON_BOOST);
+			ppol->target_freq = tunables->hispeed_freq;
+			ppol->target_set_time = ppol->hispeed_validate_time;
+			cpumask_set_cpu(i, &speedchange_cpumask);
 			anyboost = 1;
 		}
 
@@ -1081,6 +1216,7 @@ show_store_one(align_windows);
 show_store_one(ignore_hispeed_on_notif);
 show_store_one(fast_ramp_down);
 show_store_one(enable_prediction);
+show_store_one(use_sched_util);
 
 static ssize_t show_go_hispeed_load(struct cpufreq_interactive_tunables
 		*tunables, char *buf)
@@ -1422,6 +1558,81 @@ static ssize_t store_use_migration_notif(
 	return count;
 }
 
+static ssize_t show_ppol_decisions(struct cpufreq_interactive_policyinfo *ppol,
+				   char *buf, ssize_t cnt)
+{
+	struct interactive_decision *d;
+	unsigned long flags;
+	unsigned int i, n;
+
+	spin_lock_irqsave(&ppol->target_freq_lock, flags);
+	n = min_t(unsigned int, ppol->ndecisions, DECISION_RING_SIZE);
+	for (i = ppol->ndecisions - n; i != ppol->ndecisions; i++) {
+		d = &ppol->decisions[i % DECISION_RING_SIZE];
+		cnt += scnprintf(buf + cnt, PAGE_SIZE - cnt,
+				 "%llu %u %u %u %u %s\n", d->time, d->load,
+				 d->cur, d->target, d->new_freq,
+				 reason_names[d->reason]);
+	}
+	spin_unlock_irqrestore(&ppol->target_freq_lock, flags);
+
+	return cnt;
+}
+
+static ssize_t show_ppol_trans_lat(struct cpufreq_interactive_policyinfo *ppol,
+				   char *buf, ssize_t cnt)
+{
+	unsigned long flags;
+	unsigned int i;
+
+	spin_lock_irqsave(&ppol->target_freq_lock, flags);
+	for (i = 0; i < ARRAY_SIZE(trans_lat_bounds); i++)
+		cnt += scnprintf(buf + cnt, PAGE_SIZE - cnt, "<%u: %u\n",
+				 trans_lat_bounds[i], ppol->trans_lat[i]);
+	cnt += scnprintf(buf + cnt, PAGE_SIZE - cnt, ">=%u: %u\nmax: %u\n",
+			 trans_lat_bounds[i - 1], ppol->trans_lat[i],
+			 ppol->trans_lat_max);
+	spin_unlock_irqrestore(&ppol->target_freq_lock, flags);
+
+	return cnt;
+}
+
+/*
+ * decisions: the latest evaluations of each policy, oldest first, as
+ * "time_us load cur_freq old_target new_target reason".
+ * transition_latency: usecs from a new target to the driver having
+ * switched to it.
+ */
+#define show_ppol_gov_pol_sys(file_name)				\
+static ssize_t show_##file_name##_gov_sys				\
+(struct kobject *kobj, struct kobj_attribute *attr, char *buf)		\
+{									\
+	struct cpufreq_interactive_policyinfo *ppol;			\
+	ssize_t cnt = 0;						\
+	int cpu;							\
+									\
+	for_each_possible_cpu(cpu) {					\
+		ppol = per_cpu(polinfo, cpu);				\
+		if (!ppol || !ppol->policy ||				\
+		    cpu != cpumask_first(ppol->policy->related_cpus))	\
+			continue;					\
+		cnt += scnprintf(buf + cnt, PAGE_SIZE - cnt,		\
+				 "policy%d:\n", cpu);			\
+		cnt = show_ppol_##file_name(ppol, buf, cnt);		\
+	}								\
+	return cnt;							\
+}									\
+									\
+static ssize_t show_##file_name##_gov_pol				\
+(struct cpufreq_policy *policy, char *buf)				\
+{									\
+	return show_ppol_##file_name(per_cpu(polinfo, policy->cpu),	\
+				     buf, 0);				\
+}
+
+show_ppol_gov_pol_sys(decisions);
+show_ppol_gov_pol_sys(trans_lat);
+
 /*
  * Create show/store routines
  * - sys: One governor instance for complete SYSTEM
@@ -1476,6 +1687,7 @@ show_store_gov_pol_sys(align_windows);
 show_store_gov_pol_sys(ignore_hispeed_on_notif);
 show_store_gov_pol_sys(fast_ramp_down);
 show_store_gov_pol_sys(enable_prediction);
+show_store_gov_pol_sys(use_sched_util);
 
 #define gov_sys_attr_rw(_name)						\
 static struct kobj_attribute _name##_gov_sys =				\
@@ -1506,6 +1718,7 @@ gov_sys_pol_attr_rw(align_windows);
 gov_sys_pol_attr_rw(ignore_hispeed_on_notif);
 gov_sys_pol_attr_rw(fast_ramp_down);
 gov_sys_pol_attr_rw(enable_prediction);
+gov_sys_pol_attr_rw(use_sched_util);
 
 static struct kobj_attribute boostpulse_gov_sys =
 	__ATTR(boostpulse, 0200, NULL, store_boostpulse_gov_sys);
@@ -1513,6 +1726,18 @@ static struct kobj_attribute boostpulse_gov_sys =
 static struct freq_attr boostpulse_gov_pol =
 	__ATTR(boostpulse, 0200, NULL, store_boostpulse_gov_pol);
 
+static struct kobj_attribute decisions_gov_sys =
+	__ATTR(decisions, 0444, show_decisions_gov_sys, NULL);
+
+static struct freq_attr decisions_gov_pol =
+	__ATTR(decisions, 0444, show_decisions_gov_pol, NULL);
+
+static struct kobj_attribute transition_latency_gov_sys =
+	__ATTR(transition_latency, 0444, show_trans_lat_gov_sys, NULL);
+
+static struct freq_attr transition_latency_gov_pol =
+	__ATTR(transition_latency, 0444, show_trans_lat_gov_pol, NULL);
+
 /* One Governor instance for entire system */
 static struct attribute *interactive_attributes_gov_sys[] = {
 	&target_loads_gov_sys.attr,
@@ -1533,6 +1758,9 @@ static struct attribute *interactive_attributes_gov_sys[] = {
 	&ignore_hispeed_on_notif_gov_sys.attr,
 	&fast_ramp_down_gov_sys.attr,
 	&enable_prediction_gov_sys.attr,
+	&use_sched_util_gov_sys.attr,
+	&decisions_gov_sys.attr,
+	&transition_latency_gov_sys.attr,
 	NULL,
 };
 
@@ -1561,6 +1789,9 @@ static struct attribute *interactive_attributes_gov_pol[] = {
 	&ignore_hispeed_on_notif_gov_pol.attr,
 	&fast_ramp_down_gov_pol.attr,
 	&enable_prediction_gov_pol.attr,
+	&use_sched_util_gov_pol.attr,
+	&decisions_gov_pol.attr,
+	&transition_latency_gov_pol.attr,
 	NULL,
 };
 
@@ -35,6 +35,9 @@
 #include <linux/sched.h>
 #include <linux/cpu_pm.h>
 #include <linux/cpuhotplug.h>
+#include <linux/debugfs.h>
+#include <linux/kernel_stat.h>
+#include <linux/seq_file.h>
 #include <soc/qcom/pm.h>
 #include <soc/qcom/event_timer.h>
 #include <soc/qcom/lpm_levels.h>
@@ -95,6 +98,20 @@ module_param_named(lpm_prediction, lpm_prediction, bool, 0664);
 static uint32_t bias_hyst;
 module_param_named(bias_hyst, bias_hyst, uint, 0664);
 
+/*
+ * Cluster level selection: 0 walks the residency thresholds, 1 picks the
+ * level with the least expected energy, 2 keeps the thresholds but traces
+ * the energy of every candidate next to both choices.
+ */
+enum {
+	LPM_SELECT_RESIDENCY,
+	LPM_SELECT_ENERGY,
+	LPM_SELECT_VALIDATE,
+};
+
+static uint32_t cluster_energy_select;
+module_param_named(cluster_energy_select, cluster_energy_select, uint, 0664);
+
 struct lpm_history {
 	uint32_t resi[MAXSAMPLES];
 	int mode[MAXSAMPLES];
@@ -107,6 +124,41 @@ struct lpm_history {
 
 static DEFINE_PER_CPU(struct lpm_history, hist);
 
+/*
+ * Periodic device interrupts (storage, WLAN, sensors) are not timer
+ * events, so neither the next timer nor the residency history sees them
+ * coming. Follow the interval of a few chosen IRQs on every CPU and
+ * predict the next one when it has been regular.
+ */
+#define LPM_PRED_IRQS 8
+#define LPM_PRED_IRQ_MAX_US (USEC_PER_SEC)
+
+static unsigned int pred_irqs[LPM_PRED_IRQS];
+static int nr_pred_irqs;
+module_param_array_named(prediction_irqs, pred_irqs, uint, &nr_pred_irqs,
+			 0664);
+
+struct lpm_irq_hist {
+	unsigned int count;
+	uint64_t last;
+	uint32_t avg;
+	uint32_t dev;
+};
+
+struct lpm_irq_pred {
+	struct lpm_irq_hist irq[LPM_PRED_IRQS];
+	uint64_t wake_time;
+	uint32_t residency;
+	uint32_t predicted;
+	bool used;
+	uint32_t hit;
+	uint32_t early;
+	uint32_t late;
+	uint32_t premature;
+};
+
+static DEFINE_PER_CPU(struct lpm_irq_pred, irq_pred);
+
 static DEFINE_PER_CPU(struct lpm_cpu*, cpu_lpm);
 static bool suspend_in_progress;
 static struct hrtimer lpm_hrtimer;
@@ -604,6 +656,75 @@ static inline bool is_cpu_biased(int cpu)
 	return (now - last) < BIAS_HYST;
 }
 
+/*
+ * Account the tracked IRQs handled since the last idle exit, as having
+ * fired at that exit, and grade the last IRQ based prediction. Returns
+ * the usecs until the earliest regular IRQ is due, or 0.
+ */
+static uint32_t lpm_irq_predict(struct cpuidle_device *dev)
+{
+	struct lpm_irq_pred *pred = &per_cpu(irq_pred, dev->cpu);
+	struct lpm_history *history = &per_cpu(hist, dev->cpu);
+	struct lpm_irq_hist *h;
+	uint64_t now = ktime_to_us(ktime_get());
+	uint64_t next, best = 0;
+	unsigned int count;
+	uint32_t interval;
+	int i;
+
+	if (pred->used) {
+		if (history->hinvalid)
+			pred->late++;
+		else if (pred->residency < pred->predicted / 2)
+			pred->early++;
+		else
+			pred->hit++;
+		pred->used = false;
+	}
+
+	for (i = 0; i < nr_pred_irqs; i++) {
+		h = &pred->irq[i];
+		count = kstat_irqs_cpu(pred_irqs[i], dev->cpu);
+		if (count != h->count) {
+			interval = pred->wake_time - h->last;
+			if (!h->last || interval > LPM_PRED_IRQ_MAX_US) {
+				h->avg = h->dev = 0;
+			} else if (!h->avg) {
+				h->avg = interval;
+			} else {
+				h->dev = (h->dev * 7 +
+					  abs((int32_t)(interval - h->avg))) / 8;
+				h->avg = (h->avg * 7 + interval) / 8;
+			}
+			h->count = count;
+			h->last = pred->wake_time;
+		}
+
+		/* Only trust IRQs whose interval varies by under a quarter */
+		if (!h->avg || h->dev > h->avg / 4)
+			continue;
+
+		next = h->last + h->avg;
+		if (next <= now)
+			continue;
+		if (!best || next < best)
+			best = next;
+	}
+
+	return best ? best - now : 0;
+}
+
+static void lpm_irq_pred_exit(struct cpuidle_device *dev, int idx)
+{
+	struct lpm_irq_pred *pred = &per_cpu(irq_pred, dev->cpu);
+	uint32_t *min_residency = get_per_cpu_min_residency(dev->cpu);
+
+	pred->wake_time = ktime_to_us(ktime_get());
+	pred->residency = dev->last_residency;
+	if (idx && dev->last_residency < min_residency[idx])
+		pred->premature++;
+}
+
 static int cpu_power_select(struct cpuidle_device *dev,
 		struct lpm_cpu *cpu)
 {
@@ -617,6 +738,7 @@ static int cpu_power_select(struct cpuidle_device *dev,
 	uint32_t lvl_latency_us = 0;
 	uint64_t predicted = 0;
 	uint32_t htime = 0, idx_restrict_time = 0;
+	uint32_t irq_us = 0;
 	uint32_t next_wakeup_us = (uint32_t)sleep_us;
 	uint32_t *min_residency = get_per_cpu_min_residency(dev->cpu);
 	uint32_t *max_residency = get_per_cpu_max_residency(dev->cpu);
@@ -628,6 +750,9 @@ static int cpu_power_select(struct cpuidle_device *dev,
 
 	next_event_us = (uint32_t)(ktime_to_us(get_next_event_time(dev->cpu)));
 
+	if (lpm_prediction && cpu->lpm_prediction && nr_pred_irqs)
+		irq_us = lpm_irq_predict(dev);
+
 	if (is_cpu_biased(dev->cpu) && (!cpu_isolated(dev->cpu)))
 		goto done_select;
 
@@ -664,6 +789,18 @@ static int cpu_power_select(struct cpuidle_device *dev,
 			if (next_wakeup_us > max_residency[i]) {
 				predicted = lpm_cpuidle_predict(dev, cpu,
 					&idx_restrict, &idx_restrict_time);
+				if (irq_us && irq_us < next_wakeup_us &&
+				    (!predicted || irq_us < predicted)) {
+					struct lpm_irq_pred *pred =
+						&per_cpu(irq_pred, dev->cpu);
+
+					predicted = irq_us;
+					pred->predicted = irq_us;
+					pred->used = true;
+					per_cpu(hist, dev->cpu).stime =
+						ktime_to_us(ktime_get()) +
+						irq_us;
+				}
 				if (predicted && (predicted < min_residency[i]))
 					predicted = min_residency[i];
 			} else
@@ -935,10 +1072,31 @@ static void clear_cl_predict_history(void)
 	}
 }
 
+/*
+ * Expected energy of idling @idle_us in a level: the entry and exit cost,
+ * then steady state power for the rest of the period.
+ */
+static uint64_t lpm_level_energy(struct power_params *pwr, uint32_t idle_us)
+{
+	uint64_t energy = pwr->energy_overhead;
+
+	if (idle_us > pwr->time_overhead_us)
+		energy += (uint64_t)pwr->ss_power *
+				(idle_us - pwr->time_overhead_us);
+
+	return energy;
+}
+
 static int cluster_select(struct lpm_cluster *cluster, bool from_idle,
 							int *ispred)
 {
 	int best_level = -1;
+	int energy_level = -1, residency_level = -1;
+	uint64_t energy, best_energy = 0;
+	uint32_t idle_us;
+	uint64_t level_energy[NR_LPM_LEVELS];
+	unsigned long evaluated = 0;
+	bool energy_mode, residency_done = false;
 	int i;
 	struct cpumask mask;
 	uint32_t latency_us = ~0U;
@@ -969,6 +1127,10 @@ static int cluster_select(struct lpm_cluster *cluster, bool from_idle,
 		latency_us = pm_qos_request_for_cpumask(PM_QOS_CPU_DMA_LATENCY,
 							&mask);
 
+	energy_mode = from_idle &&
+		cluster_energy_select != LPM_SELECT_RESIDENCY;
+	idle_us = predicted ? pred_us : sleep_us;
+
 	for (i = 0; i < cluster->nlevels; i++) {
 		struct lpm_cluster_level *level = &cluster->levels[i];
 		struct power_params *pwr_params = &level->pwr;
@@ -996,14 +1158,40 @@ static int cluster_select(struct lpm_cluster *cluster, bool from_idle,
 				continue;
 		}
 
-		best_level = i;
+		if (energy_mode) {
+			energy = lpm_level_energy(pwr_params, idle_us);
+			level_energy[i] = energy;
+			evaluated |= BIT(i);
+			if (energy_level < 0 || energy < best_energy) {
+				energy_level = i;
+				best_energy = energy;
+			}
+		}
 
-		if (from_idle &&
-			(predicted ? (pred_us <= pwr_params->max_residency)
-			: (sleep_us <= pwr_params->max_residency)))
+		if (!residency_done) {
+			residency_level = i;
+			if (from_idle &&
+				(predicted ? (pred_us <= pwr_params->max_residency)
+				: (sleep_us <= pwr_params->max_residency)))
+				residency_done = true;
+		}
+
+		if (residency_done && !energy_mode)
 			break;
 	}
 
+	best_level = residency_level;
+	if (energy_mode) {
+		if (cluster_energy_select == LPM_SELECT_ENERGY)
+			best_level = energy_level;
+		for (i = 0; i < cluster->nlevels; i++)
+			if (evaluated & BIT(i))
+				trace_cluster_energy_select(
+					cluster->cluster_name, i, idle_us,
+					level_energy[i], energy_level,
+					residency_level);
+	}
+
 	if ((best_level == (cluster->nlevels - 1)) && (pred_mode == 2))
 		cluster->history.flag = 2;
 
@@ -1428,6 +1616,7 @@ static int lpm_cpuidle_enter(struct cpuidle_device *dev,
 	cpu_unprepare(cpu, idx, true);
 	dev->last_residency = ktime_us_delta(ktime_get(), start);
 	update_history(dev, idx);
+	lpm_irq_pred_exit(dev, idx);
 	trace_cpu_idle_exit(idx, success);
 	if (lpm_prediction && cpu->lpm_prediction) {
 		histtimer_cancel();
@@ -1705,6 +1894,50 @@ static const struct platform_freeze_ops lpm_freeze_ops = {
 	.restore = lpm_suspend_wake,
 };
 
+static int lpm_prediction_show(struct seq_file *m, void *unused)
+{
+	struct lpm_irq_pred *pred;
+	int cpu, i;
+
+	for_each_possible_cpu(cpu) {
+		pred = &per_cpu(irq_pred, cpu);
+		seq_printf(m, "cpu%d: irq_hit=%u irq_early=%u irq_late=%u premature=%u\n",
+			   cpu, pred->hit, pred->early, pred->late,
+			   pred->premature);
+		for (i = 0; i < nr_pred_irqs; i++)
+			if (pred->irq[i].avg)
+				seq_printf(m, "\tirq%u: interval=%u dev=%u\n",
+					   pred_irqs[i], pred->irq[i].avg,
+					   pred->irq[i].dev);
+	}
+
+	return 0;
+}
+
+static int lpm_prediction_open(struct inode *inode, struct file *file)
+{
+	return single_open(file, lpm_prediction_show, NULL);
+}
+
+static const struct file_operations lpm_prediction_fops = {
+	.open = lpm_prediction_open,
+	.read = seq_read,
+	.llseek = seq_lseek,
+	.release = single_release,
+};
+
+static void lpm_debugfs_init(void)
+{
+	struct dentry *dir;
+
+	dir = debugfs_create_dir("lpm_levels", NULL);
+	if (IS_ERR_OR_NULL(dir))
+		return;
+
+	debugfs_create_file("prediction", 0444, dir, NULL,
+			    &lpm_prediction_fops);
+}
+
 static int lpm_probe(struct platform_device *pdev)
 {
 	int ret;
@@ -1774,6 +2007,8 @@ static int lpm_probe(struct platform_device *pdev)
 		goto failed;
 	}
 
+	lpm_debugfs_init();
+
 	/* Add lpm_debug to Minidump*/
 	strlcpy(md_entry.name, "KLPMDEBUG", sizeof(md_entry.name));
 	md_entry.virt_addr = (uintptr_t)lpm_debug;
@@ -171,6 +171,49 @@ static int qce_dummy_req(struct qce_device *pce_dev);
 
 static int _qce50_disp_stats;
 
+/*
+ * Bunch mode tunables.  Once bunch_threshold requests are outstanding, only
+ * every bunch_intr_reqs-th request raises a completion interrupt (by default,
+ * fewer for larger requests), and a request left without one is flushed by a
+ * dummy request after bunch_timeout_ms.
+ */
+static unsigned int bunch_threshold = MAX_BUNCH_MODE_REQ;
+module_param(bunch_threshold, uint, 0644);
+MODULE_PARM_DESC(bunch_threshold,
+	"Outstanding requests that switch an engine to bunch mode");
+
+static unsigned int bunch_intr_reqs;
+module_param(bunch_intr_reqs, uint, 0644);
+MODULE_PARM_DESC(bunch_intr_reqs,
+	"Requests per completion interrupt in bunch mode, 0 to scale by size");
+
+static unsigned int bunch_timeout_ms;
+module_param(bunch_timeout_ms, uint, 0644);
+MODULE_PARM_DESC(bunch_timeout_ms,
+	"Delay before flushing unsignalled requests, 0 for the default");
+
+static unsigned long qce_bunch_delay(void)
+{
+	unsigned int ms = READ_ONCE(bunch_timeout_ms);
+
+	return ms ? msecs_to_jiffies(ms) : DELAY_IN_JIFFIES;
+}
+
+static unsigned int qce_intr_cadence(unsigned int req_len)
+{
+	unsigned int cadence = READ_ONCE(bunch_intr_reqs);
+
+	if (!cadence) {
+		cadence = (req_len >> 7) + 1;
+		return min_t(unsigned int, cadence, SET_INTR_AT_REQ);
+	}
+	/*
+	 * One more request may go unsignalled every other round, and all of
+	 * them must fit in the request slots until the interrupt frees them.
+	 */
+	return min_t(unsigned int, cadence, MAX_QCE_BAM_REQ - 1);
+}
+
 /* Standard initialization vector for SHA-1, source: FIPS 180-2 */
 static uint32_t  _std_init_vector_sha1[] =   {
 	0x67452301, 0xEFCDAB89, 0x98BADCFE, 0x10325476, 0xC3D2E1F0
@@ -3069,7 +3112,7 @@ static void qce_multireq_timeout(unsigned long data)
 	if (last_seq == 0 ||
 		last_seq != atomic_read(&pce_dev->last_intr_seq)) {
 		atomic_set(&pce_dev->last_intr_seq, last_seq);
-		mod_timer(&(pce_dev->timer), (jiffies + DELAY_IN_JIFFIES));
+		mod_timer(&(pce_dev->timer), (jiffies + qce_bunch_delay()));
 		return;
 	}
 	/* last bunch mode command time out */
@@ -3085,7 +3128,7 @@ static void qce_multireq_timeout(unsigned long data)
 	if (cmpxchg(&pce_dev->owner, QCE_OWNER_NONE, QCE_OWNER_TIMEOUT)
 							!= QCE_OWNER_NONE) {
 		local_irq_restore(flags);
-		mod_timer(&(pce_dev->timer), (jiffies + DELAY_IN_JIFFIES));
+		mod_timer(&(pce_dev->timer), (jiffies + qce_bunch_delay()));
 		return;
 	}
 
@@ -4666,7 +4709,7 @@ static int select_mode(struct qce_device *pce_dev,
 	}
 	no_of_queued_req = atomic_inc_return(&pce_dev->no_of_queued_req);
 	if (pce_dev->mode == IN_INTERRUPT_MODE) {
-		if (no_of_queued_req >= MAX_BUNCH_MODE_REQ) {
+		if (no_of_queued_req >= max(READ_ONCE(bunch_threshold), 1U)) {
 			pce_dev->mode = IN_BUNCH_MODE;
 			pr_debug("pcedev %d mode switch to BUNCH\n",
 					pce_dev->dev_no);
@@ -4676,16 +4719,14 @@ static int select_mode(struct qce_device *pce_dev,
 			atomic_set(&pce_dev->bunch_cmd_seq, 1);
 			atomic_set(&pce_dev->last_intr_seq, 1);
 			mod_timer(&(pce_dev->timer),
-					(jiffies + DELAY_IN_JIFFIES));
+					(jiffies + qce_bunch_delay()));
 		} else {
 			_qce_set_flag(&pce_sps_data->out_transfer,
 					SPS_IOVEC_FLAG_INT);
 		}
 	} else {
 		pce_dev->intr_cadence++;
-		cadence = (preq_info->req_len >> 7) + 1;
-		if (cadence > SET_INTR_AT_REQ)
-			cadence = SET_INTR_AT_REQ;
+		cadence = qce_intr_cadence(preq_info->req_len);
 		if (pce_dev->intr_cadence < cadence || ((pce_dev->intr_cadence
 					== cadence) && pce_dev->cadence_flag))
 			atomic_inc(&pce_dev->bunch_cmd_seq);
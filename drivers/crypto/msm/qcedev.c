@@ -230,6 +230,8 @@ struct qcedev_stat {
 	u32 qcedev_enc_fail;
 	u32 qcedev_sha_success;
 	u32 qcedev_sha_fail;
+	u32 qcedev_zero_copy;
+	u32 qcedev_pin_cache_hit;
 };
 
 static struct qcedev_stat _qcedev_stat;
@@ -237,6 +239,16 @@ static struct dentry *_debug_dent;
 static char _debug_read_buf[DEBUG_MAX_RW_BUF];
 static int _debug_qcedev;
 
+/* Largest cipher request that is served from pinned user pages */
+#define QCEDEV_ZERO_COPY_MAX_LEN	(1024 * 1024)
+/* Covers the CE BAM burst size as well as DMA cache line alignment */
+#define QCEDEV_ZERO_COPY_ALIGN		64
+
+static unsigned int zero_copy_min = 16 * 1024;
+module_param(zero_copy_min, uint, 0644);
+MODULE_PARM_DESC(zero_copy_min,
+	"Smallest cipher request in bytes the CE reads and writes in user memory directly, 0 disables");
+
 static struct qcedev_control *qcedev_minor_to_control(unsigned int n)
 {
 	int i;
@@ -271,6 +283,7 @@ static int qcedev_open(struct inode *inode, struct file *file)
 
 	mutex_init(&handle->registeredbufs.lock);
 	INIT_LIST_HEAD(&handle->registeredbufs.list);
+	qcedev_pin_cache_init(&handle->pin_cache);
 	return 0;
 }
 
@@ -285,6 +298,7 @@ static int qcedev_release(struct inode *inode, struct file *file)
 		pr_err("%s: invalid handle %pK\n",
 					__func__, podev);
 	}
+	qcedev_pin_cache_release(&handle->pin_cache);
 	kzfree(handle);
 	file->private_data = NULL;
 	if (podev != NULL && podev->platform_support.bus_scale_table != NULL)
@@ -1264,6 +1278,101 @@ static int qcedev_vbuf_ablk_cipher_max_xfer(struct qcedev_async_req *areq,
 	return err;
 };
 
+static bool qcedev_zero_copy_eligible(struct qcedev_cipher_op_req *creq)
+{
+	unsigned int align = max_t(unsigned int, dma_get_cache_alignment(),
+					QCEDEV_ZERO_COPY_ALIGN);
+
+	if (!zero_copy_min || creq->data_len < zero_copy_min ||
+			creq->data_len > QCEDEV_ZERO_COPY_MAX_LEN)
+		return false;
+	if (creq->entries != 1 || creq->vbuf.src[0].len != creq->data_len ||
+			creq->vbuf.dst[0].len != creq->data_len)
+		return false;
+	if (creq->mode == QCEDEV_AES_MODE_CTR && creq->byteoffset)
+		return false;
+	/* partial cache lines would be shared with unrelated user data */
+	return IS_ALIGNED((unsigned long)creq->vbuf.src[0].vaddr, align) &&
+		IS_ALIGNED((unsigned long)creq->vbuf.dst[0].vaddr, align) &&
+		IS_ALIGNED(creq->data_len, align);
+}
+
+/*
+ * Run a single buffer cipher request on the user pages themselves, which
+ * the CE maps for DMA through its own (SMMU) device. Returns -EAGAIN,
+ * before anything was submitted, if the pages cannot be pinned.
+ */
+static int qcedev_zero_copy_ablk_cipher(struct qcedev_async_req *areq,
+						struct qcedev_handle *handle)
+{
+	struct qcedev_cipher_op_req *creq = &areq->cipher_op_req;
+	unsigned long src_va = (unsigned long)creq->vbuf.src[0].vaddr;
+	unsigned long dst_va = (unsigned long)creq->vbuf.dst[0].vaddr;
+	uint32_t total = creq->data_len;
+	struct qcedev_pinned_buf *src, *dst;
+	struct sg_table src_sgt, dst_sgt;
+	uint32_t off, len;
+	bool in_place = src_va == dst_va;
+	bool src_hit, dst_hit;
+	int err = 0;
+
+	dst = qcedev_pin_user_buf(handle, dst_va, total, true, &dst_hit);
+	if (!dst)
+		return -EAGAIN;
+	src = dst;
+	src_hit = dst_hit;
+	if (!in_place) {
+		src = qcedev_pin_user_buf(handle, src_va, total, false,
+						&src_hit);
+		if (!src) {
+			qcedev_unpin_user_buf(handle, dst, dst_va, 0);
+			return -EAGAIN;
+		}
+	}
+
+	_qcedev_stat.qcedev_zero_copy++;
+	if (src_hit && dst_hit)
+		_qcedev_stat.qcedev_pin_cache_hit++;
+
+	for (off = 0; off < total && !err; off += len) {
+		len = min_t(uint32_t, total - off, QCE_MAX_OPER_DATA);
+
+		err = qcedev_pinned_buf_sg(src, src_va + off, len, &src_sgt);
+		if (err)
+			break;
+		if (!in_place) {
+			err = qcedev_pinned_buf_sg(dst, dst_va + off, len,
+							&dst_sgt);
+			if (err) {
+				sg_free_table(&src_sgt);
+				break;
+			}
+		}
+
+		creq->data_len = len;
+		areq->cipher_req.creq.src = src_sgt.sgl;
+		areq->cipher_req.creq.dst = in_place ? src_sgt.sgl :
+							dst_sgt.sgl;
+		areq->cipher_req.creq.nbytes = len;
+		areq->cipher_req.creq.info = creq->iv;
+
+		err = submit_req(areq, handle);
+
+		sg_free_table(&src_sgt);
+		if (!in_place)
+			sg_free_table(&dst_sgt);
+	}
+
+	creq->data_len = total;
+	areq->cipher_req.creq.src = NULL;
+	areq->cipher_req.creq.dst = NULL;
+
+	qcedev_unpin_user_buf(handle, dst, dst_va, total);
+	if (!in_place)
+		qcedev_unpin_user_buf(handle, src, src_va, total);
+	return err;
+}
+
 static int qcedev_vbuf_ablk_cipher(struct qcedev_async_req *areq,
 						struct qcedev_handle *handle)
 {
@@ -1282,6 +1391,13 @@ static int qcedev_vbuf_ablk_cipher(struct qcedev_async_req *areq,
 	struct qcedev_cipher_op_req *saved_req;
 	struct	qcedev_cipher_op_req *creq = &areq->cipher_op_req;
 
+	if (qcedev_zero_copy_eligible(creq)) {
+		err = qcedev_zero_copy_ablk_cipher(areq, handle);
+		if (err != -EAGAIN)
+			return err;
+		err = 0;
+	}
+
 	total = 0;
 
 	if (areq->cipher_op_req.mode == QCEDEV_AES_MODE_CTR)
@@ -2218,6 +2334,12 @@ static int _disp_stats(int id)
 	len += scnprintf(_debug_read_buf + len, DEBUG_MAX_RW_BUF - len - 1,
 			"   Encryption operation fail          : %d\n",
 					pstat->qcedev_dec_fail);
+	len += scnprintf(_debug_read_buf + len, DEBUG_MAX_RW_BUF - len - 1,
+			"   Zero copy cipher requests          : %d\n",
+					pstat->qcedev_zero_copy);
+	len += scnprintf(_debug_read_buf + len, DEBUG_MAX_RW_BUF - len - 1,
+			"   Zero copy pin cache hits           : %d\n",
+					pstat->qcedev_pin_cache_hit);
 
 	return len;
 }
@@ -0,0 +1,335 @@
+/* Qti (or) Qualcomm Technologies Inc CE device driver.
+ *
+ * Pinned user buffer cache for zero copy cipher requests.
+ *
+ * Copyright (c) 2018, The Linux Foundation. All rights reserved.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 and
+ * only version 2 as published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ */
+#include <linux/mm.h>
+#include <linux/sched.h>
+#include <linux/slab.h>
+#include <linux/scatterlist.h>
+#include <linux/mmu_notifier.h>
+#include "qcedevi.h"
+
+static inline unsigned long qcedev_pinned_buf_end(
+				struct qcedev_pinned_buf *buf)
+{
+	return buf->start + ((unsigned long)buf->nr_pages << PAGE_SHIFT);
+}
+
+static void qcedev_free_pinned_buf(struct qcedev_pinned_buf *buf)
+{
+	unsigned int i;
+
+	if (!buf)
+		return;
+	for (i = 0; i < buf->nr_pages; i++)
+		put_page(buf->pages[i]);
+	kfree(buf->pages);
+	kfree(buf);
+}
+
+/*
+ * The mmu notifier only flags entries; the pages stay pinned until the next
+ * lookup, unpin or handle release drops them in process context.
+ */
+static void qcedev_pin_cache_invalidate(struct qcedev_pin_cache *cache,
+				unsigned long start, unsigned long end)
+{
+	struct qcedev_pinned_buf *buf;
+	unsigned long flags;
+	int i;
+
+	spin_lock_irqsave(&cache->lock, flags);
+	for (i = 0; i < QCEDEV_PIN_CACHE_SIZE; i++) {
+		buf = cache->bufs[i];
+		if (buf && buf->start < end &&
+				qcedev_pinned_buf_end(buf) > start)
+			buf->stale = true;
+	}
+	spin_unlock_irqrestore(&cache->lock, flags);
+}
+
+static void qcedev_pin_mn_release(struct mmu_notifier *mn,
+				struct mm_struct *mm)
+{
+	struct qcedev_pin_cache *cache =
+		container_of(mn, struct qcedev_pin_cache, mn);
+
+	qcedev_pin_cache_invalidate(cache, 0, ULONG_MAX);
+}
+
+static void qcedev_pin_mn_invalidate_page(struct mmu_notifier *mn,
+				struct mm_struct *mm, unsigned long address)
+{
+	struct qcedev_pin_cache *cache =
+		container_of(mn, struct qcedev_pin_cache, mn);
+
+	qcedev_pin_cache_invalidate(cache, address, address + PAGE_SIZE);
+}
+
+static void qcedev_pin_mn_invalidate_range_start(struct mmu_notifier *mn,
+				struct mm_struct *mm,
+				unsigned long start, unsigned long end)
+{
+	struct qcedev_pin_cache *cache =
+		container_of(mn, struct qcedev_pin_cache, mn);
+
+	qcedev_pin_cache_invalidate(cache, start, end);
+}
+
+static const struct mmu_notifier_ops qcedev_pin_mn_ops = {
+	.release = qcedev_pin_mn_release,
+	.invalidate_page = qcedev_pin_mn_invalidate_page,
+	.invalidate_range_start = qcedev_pin_mn_invalidate_range_start,
+};
+
+void qcedev_pin_cache_init(struct qcedev_pin_cache *cache)
+{
+	memset(cache, 0, sizeof(*cache));
+	spin_lock_init(&cache->lock);
+	mutex_init(&cache->mn_lock);
+	cache->mn.ops = &qcedev_pin_mn_ops;
+}
+
+void qcedev_pin_cache_release(struct qcedev_pin_cache *cache)
+{
+	int i;
+
+	if (cache->mm)
+		mmu_notifier_unregister(&cache->mn, cache->mm);
+	cache->mm = NULL;
+
+	for (i = 0; i < QCEDEV_PIN_CACHE_SIZE; i++) {
+		qcedev_free_pinned_buf(cache->bufs[i]);
+		cache->bufs[i] = NULL;
+	}
+}
+
+/*
+ * Only the process that first pins through a handle gets its buffers
+ * cached; a handle passed to another process pins per request.
+ */
+static bool qcedev_pin_cache_usable(struct qcedev_pin_cache *cache)
+{
+	bool usable;
+
+	if (!current->mm)
+		return false;
+	if (READ_ONCE(cache->mm))
+		return READ_ONCE(cache->mm) == current->mm;
+
+	mutex_lock(&cache->mn_lock);
+	if (!cache->mm && !cache->mn_failed) {
+		if (mmu_notifier_register(&cache->mn, current->mm))
+			cache->mn_failed = true;
+		else
+			WRITE_ONCE(cache->mm, current->mm);
+	}
+	usable = cache->mm == current->mm;
+	mutex_unlock(&cache->mn_lock);
+	return usable;
+}
+
+static struct qcedev_pinned_buf *qcedev_pin_cache_lookup(
+				struct qcedev_pin_cache *cache,
+				unsigned long start, unsigned long end,
+				bool write)
+{
+	struct qcedev_pinned_buf *buf;
+	unsigned long flags;
+	int i;
+
+	spin_lock_irqsave(&cache->lock, flags);
+	for (i = 0; i < QCEDEV_PIN_CACHE_SIZE; i++) {
+		buf = cache->bufs[i];
+		if (!buf || buf->stale || (write && !buf->write))
+			continue;
+		if (buf->start <= start && qcedev_pinned_buf_end(buf) >= end) {
+			buf->users++;
+			buf->last_use = ++cache->clock;
+			spin_unlock_irqrestore(&cache->lock, flags);
+			return buf;
+		}
+	}
+	spin_unlock_irqrestore(&cache->lock, flags);
+	return NULL;
+}
+
+/*
+ * Take a slot for @buf, preferring an empty one, then a stale one, then the
+ * least recently used buffer nobody is using. Returns the evicted buffer,
+ * which the caller frees outside the lock.
+ */
+static struct qcedev_pinned_buf *qcedev_pin_cache_insert(
+				struct qcedev_pin_cache *cache,
+				struct qcedev_pinned_buf *buf)
+{
+	struct qcedev_pinned_buf *old;
+	unsigned long flags;
+	int i, victim = -1;
+
+	spin_lock_irqsave(&cache->lock, flags);
+	for (i = 0; i < QCEDEV_PIN_CACHE_SIZE; i++) {
+		old = cache->bufs[i];
+		if (!old) {
+			victim = i;
+			break;
+		}
+		if (old->users)
+			continue;
+		if (old->stale) {
+			victim = i;
+			break;
+		}
+		if (victim < 0 || old->last_use <
+				cache->bufs[victim]->last_use)
+			victim = i;
+	}
+
+	old = NULL;
+	if (victim >= 0) {
+		old = cache->bufs[victim];
+		buf->cached = true;
+		buf->last_use = ++cache->clock;
+		cache->bufs[victim] = buf;
+	}
+	spin_unlock_irqrestore(&cache->lock, flags);
+	return old;
+}
+
+/**
+ * qcedev_pin_user_buf() - pin a user buffer for direct DMA by the CE
+ * @handle:	qcedev handle the request came in on
+ * @vaddr:	user address of the buffer
+ * @len:	length of the buffer
+ * @write:	the CE writes to the buffer
+ * @hit:	set when the pages came from the handle's pin cache
+ *
+ * Returns the pinned buffer, to be released with qcedev_unpin_user_buf(),
+ * or NULL if the range could not be pinned.
+ */
+struct qcedev_pinned_buf *qcedev_pin_user_buf(struct qcedev_handle *handle,
+				unsigned long vaddr, unsigned int len,
+				bool write, bool *hit)
+{
+	struct qcedev_pin_cache *cache = &handle->pin_cache;
+	unsigned long start = vaddr & PAGE_MASK;
+	unsigned long end = PAGE_ALIGN(vaddr + len);
+	struct qcedev_pinned_buf *buf, *old = NULL;
+	bool cacheable;
+	int nr_pages, pinned;
+
+	*hit = false;
+	cacheable = qcedev_pin_cache_usable(cache);
+	if (cacheable) {
+		buf = qcedev_pin_cache_lookup(cache, start, end, write);
+		if (buf) {
+			*hit = true;
+			return buf;
+		}
+	}
+
+	nr_pages = (end - start) >> PAGE_SHIFT;
+	buf = kzalloc(sizeof(*buf), GFP_KERNEL);
+	if (!buf)
+		return NULL;
+	buf->pages = kcalloc(nr_pages, sizeof(struct page *), GFP_KERNEL);
+	if (!buf->pages) {
+		kfree(buf);
+		return NULL;
+	}
+
+	pinned = get_user_pages_fast(start, nr_pages, write, buf->pages);
+	if (pinned > 0)
+		buf->nr_pages = pinned;
+	if (pinned != nr_pages) {
+		qcedev_free_pinned_buf(buf);
+		return NULL;
+	}
+	buf->start = start;
+	buf->write = write;
+	buf->users = 1;
+
+	if (cacheable)
+		old = qcedev_pin_cache_insert(cache, buf);
+	qcedev_free_pinned_buf(old);
+	return buf;
+}
+
+/**
+ * qcedev_unpin_user_buf() - release a buffer from qcedev_pin_user_buf()
+ * @handle:	qcedev handle the buffer was pinned on
+ * @buf:	the pinned buffer
+ * @vaddr:	user address the CE accessed
+ * @len:	length the CE accessed
+ *
+ * Pages the CE wrote to are dirtied. The pins stay in the handle's cache
+ * unless the mapping changed underneath them.
+ */
+void qcedev_unpin_user_buf(struct qcedev_handle *handle,
+				struct qcedev_pinned_buf *buf,
+				unsigned long vaddr, unsigned int len)
+{
+	struct qcedev_pin_cache *cache = &handle->pin_cache;
+	unsigned long flags;
+	unsigned long i, first, last;
+	bool release = false;
+	int j;
+
+	if (buf->write) {
+		first = ((vaddr & PAGE_MASK) - buf->start) >> PAGE_SHIFT;
+		last = (PAGE_ALIGN(vaddr + len) - buf->start) >> PAGE_SHIFT;
+		for (i = first; i < last; i++)
+			set_page_dirty_lock(buf->pages[i]);
+	}
+
+	spin_lock_irqsave(&cache->lock, flags);
+	buf->users--;
+	if (!buf->cached) {
+		release = true;
+	} else if (buf->stale && !buf->users) {
+		for (j = 0; j < QCEDEV_PIN_CACHE_SIZE; j++) {
+			if (cache->bufs[j] == buf) {
+				cache->bufs[j] = NULL;
+				break;
+			}
+		}
+		release = true;
+	}
+	spin_unlock_irqrestore(&cache->lock, flags);
+
+	if (release)
+		qcedev_free_pinned_buf(buf);
+}
+
+/**
+ * qcedev_pinned_buf_sg() - build a scatterlist over part of a pinned buffer
+ * @buf:	the pinned buffer
+ * @vaddr:	user address of the first byte
+ * @len:	number of bytes
+ * @sgt:	table to fill, freed by the caller with sg_free_table()
+ */
+int qcedev_pinned_buf_sg(struct qcedev_pinned_buf *buf, unsigned long vaddr,
+				unsigned int len, struct sg_table *sgt)
+{
+	unsigned long first = ((vaddr & PAGE_MASK) - buf->start) >> PAGE_SHIFT;
+	unsigned long last = (PAGE_ALIGN(vaddr + len) - buf->start) >>
+								PAGE_SHIFT;
+
+	if (vaddr < buf->start || last > buf->nr_pages)
+		return -EINVAL;
+
+	return sg_alloc_table_from_pages(sgt, &buf->pages[first],
+				last - first, offset_in_page(vaddr), len,
+				GFP_KERNEL);
+}
@@ -17,6 +17,7 @@
 
 #include <linux/interrupt.h>
 #include <linux/miscdevice.h>
+#include <linux/mmu_notifier.h>
 #include <crypto/hash.h>
 #include <linux/platform_data/qcom_crypto_device.h>
 #include <linux/fips_status.h>
@@ -112,6 +113,34 @@ struct qcedev_control {
 	struct qcedev_mem_client *mem_client;
 };
 
+/* Pinned user buffers kept per handle for zero copy cipher requests */
+#define QCEDEV_PIN_CACHE_SIZE	4
+
+struct qcedev_pinned_buf {
+	unsigned long start;
+	unsigned int nr_pages;
+	struct page **pages;
+	bool write;
+	/* user mapping changed since the pages were pinned */
+	bool stale;
+	/* owned by the handle's pin cache */
+	bool cached;
+	unsigned int users;
+	unsigned long last_use;
+};
+
+struct qcedev_pin_cache {
+	/* protects bufs and their stale/users/last_use fields */
+	spinlock_t lock;
+	struct qcedev_pinned_buf *bufs[QCEDEV_PIN_CACHE_SIZE];
+	unsigned long clock;
+	/* mm the cached pins belong to, set once the notifier is registered */
+	struct mm_struct *mm;
+	struct mmu_notifier mn;
+	struct mutex mn_lock;
+	bool mn_failed;
+};
+
 struct qcedev_handle {
 	/* qcedev control handle */
 	struct qcedev_control *cntl;
@@ -119,6 +148,8 @@ struct qcedev_handle {
 	struct qcedev_sha_ctxt sha_ctxt;
 	/* qcedev mapped buffer list */
 	struct qcedev_buffer_list registeredbufs;
+	/* pinned user buffers for zero copy requests */
+	struct qcedev_pin_cache pin_cache;
 };
 
 void qcedev_cipher_req_cb(void *cookie, unsigned char *icv,
@@ -127,4 +158,15 @@ void qcedev_cipher_req_cb(void *cookie, unsigned char *icv,
 void qcedev_sha_req_cb(void *cookie, unsigned char *digest,
 	unsigned char *authdata, int ret);
 
+void qcedev_pin_cache_init(struct qcedev_pin_cache *cache);
+void qcedev_pin_cache_release(struct qcedev_pin_cache *cache);
+struct qcedev_pinned_buf *qcedev_pin_user_buf(struct qcedev_handle *handle,
+				unsigned long vaddr, unsigned int len,
+				bool write, bool *hit);
+void qcedev_unpin_user_buf(struct qcedev_handle *handle,
+				struct qcedev_pinned_buf *buf,
+				unsigned long vaddr, unsigned int len);
+int qcedev_pinned_buf_sg(struct qcedev_pinned_buf *buf, unsigned long vaddr,
+				unsigned int len, struct sg_table *sgt);
+
 #endif  /* __CRYPTO_MSM_QCEDEVI_H */
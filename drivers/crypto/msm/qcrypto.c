@@ -136,6 +136,7 @@ struct qcrypto_req_control {
 	struct crypto_async_request *req;
 	struct qcrypto_resp_ctx *arsp;
 	int res; /* execution result */
+	unsigned int nbytes; /* payload, for the engine load */
 };
 
 struct crypto_engine {
@@ -176,6 +177,16 @@ struct crypto_engine {
 	bool first_engine;	/* this engine is the first engine or not */
 	unsigned int irq_cpu;	/* the cpu running the irq of this engine */
 	unsigned int max_req_used; /* debug stats */
+
+	/* load seen by the scheduler: bytes on req_queue and bytes issued */
+	u64 queued_bytes;
+	atomic64_t inflight_bytes;
+
+	/* debug stats */
+	u64 queue_ns;		/* total time requests waited to be issued */
+	u64 busy_ns;		/* total time with requests outstanding */
+	u64 busy_start;
+	u64 stats_start;
 };
 
 #define MAX_SMP_CPU    8
@@ -250,6 +261,8 @@ static struct qcrypto_req_control *qcrypto_alloc_req_control(
 			req_count = atomic_inc_return(&pce->req_count);
 			if (req_count > pce->max_req_used)
 				pce->max_req_used = req_count;
+			if (req_count == 1)
+				pce->busy_start = ktime_get_ns();
 			return pqcrypto_req_control;
 		}
 		pqcrypto_req_control++;
@@ -264,10 +277,13 @@ static void qcrypto_free_req_control(struct crypto_engine *pce,
 	preq->req = NULL;
 	preq->arsp = NULL;
 	/* free req */
-	if (xchg(&preq->in_use, false) == false)
+	if (xchg(&preq->in_use, false) == false) {
 		pr_warn("request info %pK free already\n", preq);
-	else
-		atomic_dec(&pce->req_count);
+		return;
+	}
+	atomic64_sub(preq->nbytes, &pce->inflight_bytes);
+	if (atomic_dec_and_test(&pce->req_count))
+		pce->busy_ns += ktime_get_ns() - pce->busy_start;
 }
 
 static struct qcrypto_req_control *find_req_control_for_areq(
@@ -402,9 +418,21 @@ struct qcrypto_alg {
 
 #define	QCRYPTO_CCM4309_NONCE_LEN	3
 
+/*
+ * Without a fixed engine, a tfm keeps sending its requests to the engine it
+ * last used, for key reuse, until another engine is clearly less loaded.  It
+ * only moves while none of its requests wait on the old engine's queue, so
+ * that they are still issued in order.
+ */
+struct qcrypto_sched_ctx {
+	struct crypto_engine *pengine;	/* engine last used by this tfm */
+	unsigned int queued;		/* requests waiting on its queue */
+};
+
 struct qcrypto_cipher_ctx {
 	struct list_head rsp_queue;     /* response queue */
 	struct crypto_engine *pengine;  /* fixed engine assigned to this tfm */
+	struct qcrypto_sched_ctx sched;
 	struct crypto_priv *cp;
 	unsigned int flags;
 
@@ -430,6 +458,7 @@ struct qcrypto_resp_ctx {
 	struct llist_node llist;
 	struct crypto_async_request *async_req; /* async req */
 	int res;                                /* execution result */
+	u64 queued_ns;                          /* time of enqueue */
 };
 
 struct qcrypto_cipher_req_ctx {
@@ -491,6 +520,7 @@ static uint8_t _std_init_vector_sha256_uint8[] = {
 struct qcrypto_sha_ctx {
 	struct list_head rsp_queue;     /* response queue */
 	struct crypto_engine *pengine;  /* fixed engine assigned to this tfm */
+	struct qcrypto_sched_ctx sched;
 	struct crypto_priv *cp;
 	unsigned int flags;
 	enum qce_hash_alg_enum  alg;
@@ -883,6 +913,8 @@ static int _qcrypto_cipher_ctx_init(struct qcrypto_cipher_ctx *ctx,
 			return -ENODEV;
 	} else
 		ctx->pengine = NULL;
+	ctx->sched.pengine = NULL;
+	ctx->sched.queued = 0;
 	INIT_LIST_HEAD(&ctx->rsp_queue);
 	ctx->auth_alg = QCE_HASH_LAST;
 	return 0;
@@ -918,6 +950,8 @@ static int _qcrypto_ahash_cra_init(struct crypto_tfm *tfm)
 			return -ENODEV;
 	} else
 		sha_ctx->pengine = NULL;
+	sha_ctx->sched.pengine = NULL;
+	sha_ctx->sched.queued = 0;
 	INIT_LIST_HEAD(&sha_ctx->rsp_queue);
 	return 0;
 };
@@ -1307,6 +1341,24 @@ static int _disp_stats(int id)
 			pe->unit,
 			pe->err_req
 		);
+		len += scnprintf(
+			_debug_read_buf + len,
+			DEBUG_MAX_RW_BUF - len - 1,
+			"   Engine %4d Bytes queued, issued    : %llu %lld\n",
+			pe->unit,
+			pe->queued_bytes,
+			(long long)atomic64_read(&pe->inflight_bytes)
+		);
+		len += scnprintf(
+			_debug_read_buf + len,
+			DEBUG_MAX_RW_BUF - len - 1,
+			"   Engine %4d Busy %%, avg queue us    : %llu %llu\n",
+			pe->unit,
+			div64_u64(pe->busy_ns * 100,
+				max_t(u64, ktime_get_ns() - pe->stats_start, 1)),
+			pe->total_req ? div64_u64(pe->queue_ns,
+				pe->total_req * NSEC_PER_USEC) : 0
+		);
 		qce_get_driver_stats(pe->qce);
 	}
 	spin_unlock_irqrestore(&cp->lock, flags);
@@ -2210,6 +2262,59 @@ static int _qcrypto_process_aead(struct  crypto_engine *pengine,
 	return ret;
 }
 
+static unsigned int _qcrypto_req_nbytes(struct crypto_async_request *req)
+{
+	struct aead_request *aead_req;
+
+	switch (crypto_tfm_alg_type(req->tfm)) {
+	case CRYPTO_ALG_TYPE_AHASH:
+		return container_of(req, struct ahash_request, base)->nbytes;
+	case CRYPTO_ALG_TYPE_ABLKCIPHER:
+		return container_of(req, struct ablkcipher_request,
+				    base)->nbytes;
+	case CRYPTO_ALG_TYPE_AEAD:
+	default:
+		aead_req = container_of(req, struct aead_request, base);
+		return aead_req->cryptlen + aead_req->assoclen;
+	}
+}
+
+static struct qcrypto_resp_ctx *_qcrypto_req_rsp(
+					struct crypto_async_request *req)
+{
+	struct qcrypto_cipher_req_ctx *cipher_rctx;
+	struct qcrypto_sha_req_ctx *ahash_rctx;
+
+	switch (crypto_tfm_alg_type(req->tfm)) {
+	case CRYPTO_ALG_TYPE_AHASH:
+		ahash_rctx = ahash_request_ctx(
+			container_of(req, struct ahash_request, base));
+		return &ahash_rctx->rsp_entry;
+	case CRYPTO_ALG_TYPE_ABLKCIPHER:
+		cipher_rctx = ablkcipher_request_ctx(
+			container_of(req, struct ablkcipher_request, base));
+		return &cipher_rctx->rsp_entry;
+	case CRYPTO_ALG_TYPE_AEAD:
+	default:
+		cipher_rctx = aead_request_ctx(
+			container_of(req, struct aead_request, base));
+		return &cipher_rctx->rsp_entry;
+	}
+}
+
+/* scheduler state of the tfm, NULL if it has a fixed engine */
+static struct qcrypto_sched_ctx *_qcrypto_sched_ctx(
+					struct crypto_async_request *req)
+{
+	void *tfm_ctx = crypto_tfm_ctx(req->tfm);
+	struct qcrypto_cipher_ctx *ctx = tfm_ctx;
+	struct qcrypto_sha_ctx *sha_ctx = tfm_ctx;
+
+	if (crypto_tfm_alg_type(req->tfm) == CRYPTO_ALG_TYPE_AHASH)
+		return sha_ctx->pengine ? NULL : &sha_ctx->sched;
+	return ctx->pengine ? NULL : &ctx->sched;
+}
+
 static struct crypto_engine *_qcrypto_static_assign_engine(
 					struct crypto_priv *cp)
 {
@@ -2282,7 +2387,13 @@ static int _start_qcrypto_process(struct crypto_priv *cp,
 
 	/* try to get request from request queue of the engine first */
 	async_req = crypto_dequeue_request(&pengine->req_queue);
-	if (!async_req) {
+	if (async_req) {
+		struct qcrypto_sched_ctx *sched = _qcrypto_sched_ctx(async_req);
+
+		pengine->queued_bytes -= _qcrypto_req_nbytes(async_req);
+		if (sched)
+			sched->queued--;
+	} else {
 		/*
 		 * if no request from the engine,
 		 * try to  get from request queue of driver
@@ -2343,6 +2454,9 @@ static int _start_qcrypto_process(struct crypto_priv *cp,
 	pqcrypto_req_control->pce = pengine;
 	pqcrypto_req_control->req = async_req;
 	pqcrypto_req_control->arsp = arsp;
+	pqcrypto_req_control->nbytes = _qcrypto_req_nbytes(async_req);
+	atomic64_add(pqcrypto_req_control->nbytes, &pengine->inflight_bytes);
+	pengine->queue_ns += ktime_get_ns() - arsp->queued_ns;
 	pengine->active_seq++;
 	pengine->check_flag = true;
 
@@ -2431,17 +2545,91 @@ static struct crypto_engine *_avail_eng(struct crypto_priv *cp)
 	return q;
 }
 
+/* Engines that first need a bus vote look this much busier */
+#define QCRYPTO_SCHED_BW_PENALTY	(16 * 1024)
+/* A tfm stays on its engine unless it is this much busier than the least */
+#define QCRYPTO_SCHED_IMBALANCE		(64 * 1024)
+
+static u64 _eng_load(struct crypto_engine *p)
+{
+	u64 load = p->queued_bytes + atomic64_read(&p->inflight_bytes);
+
+	if (p->bw_state != BUS_HAS_BANDWIDTH)
+		load += QCRYPTO_SCHED_BW_PENALTY;
+	return load;
+}
+
+static struct crypto_engine *_sched_eng(struct crypto_priv *cp,
+					struct qcrypto_sched_ctx *sched)
+{
+	/* call this function with spinlock set */
+	struct crypto_engine *p = cp->scheduled_eng;
+	struct crypto_engine *best = NULL;
+	u64 load, best_load = U64_MAX;
+	int eng_cnt = cp->total_units;
+
+	if (unlikely(list_empty(&cp->engine_list)))
+		return NULL;
+
+	/* keep the tfm's requests in order behind those it has queued */
+	if (sched->pengine && sched->queued)
+		return sched->pengine;
+
+	/* start after the last scheduled engine, so that ties rotate */
+	while (eng_cnt-- > 0) {
+		p = _next_eng(cp, p);
+		if (p->bw_state == BUS_SUSPENDED ||
+				p->bw_state == BUS_SUSPENDING)
+			continue;
+		load = _eng_load(p);
+		if (load < best_load) {
+			best = p;
+			best_load = load;
+		}
+	}
+	if (!best)
+		return NULL;
+	cp->scheduled_eng = best;
+
+	if (sched->pengine && sched->pengine != best &&
+	    sched->pengine->bw_state != BUS_SUSPENDED &&
+	    sched->pengine->bw_state != BUS_SUSPENDING &&
+	    _eng_load(sched->pengine) <= best_load + QCRYPTO_SCHED_IMBALANCE)
+		return sched->pengine;
+
+	sched->pengine = best;
+	return best;
+}
+
+static bool _qcrypto_enqueued(struct crypto_async_request *req, int ret)
+{
+	return ret == -EINPROGRESS ||
+		(ret == -EBUSY && (req->flags & CRYPTO_TFM_REQ_MAY_BACKLOG));
+}
+
 static int _qcrypto_queue_req(struct crypto_priv *cp,
 				struct crypto_engine *pengine,
 				struct crypto_async_request *req)
 {
 	int ret;
 	unsigned long flags;
+	struct qcrypto_sched_ctx *sched = NULL;
 
+	_qcrypto_req_rsp(req)->queued_ns = ktime_get_ns();
 	spin_lock_irqsave(&cp->lock, flags);
 
+	if (!pengine) {
+		sched = _qcrypto_sched_ctx(req);
+		if (sched)
+			pengine = _sched_eng(cp, sched);
+	}
 	if (pengine) {
 		ret = crypto_enqueue_request(&pengine->req_queue, req);
+		if (_qcrypto_enqueued(req, ret)) {
+			pengine->queued_bytes += _qcrypto_req_nbytes(req);
+			if (sched)
+				sched->queued++;
+		}
 	} else {
 		ret = crypto_enqueue_request(&cp->req_queue, req);
 		pengine = _avail_eng(cp);
@@ -4979,6 +5167,9 @@ static int  _qcrypto_probe(struct platform_device *pdev)
 	pengine->check_flag = false;
 	pengine->max_req_used = 0;
 	pengine->issue_req = false;
+	pengine->queued_bytes = 0;
+	atomic64_set(&pengine->inflight_bytes, 0);
+	pengine->stats_start = ktime_get_ns();
 
 	crypto_init_queue(&pengine->req_queue, MSM_QCRYPTO_REQ_QUEUE_LENGTH);
 
@@ -5500,6 +5691,9 @@ static ssize_t _debug_stats_write(struct file *file, const char __user *buf,
 		pe->err_req = 0;
 		qce_clear_driver_stats(pe->qce);
 		pe->max_req_used = 0;
+		pe->queue_ns = 0;
+		pe->busy_ns = 0;
+		pe->stats_start = ktime_get_ns();
 	}
 	cp->max_qlen = 0;
 	cp->resp_start = 0;
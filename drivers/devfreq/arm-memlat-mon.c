@@ -38,12 +38,18 @@ enum ev_index {
 	CM_IDX,
 	CYC_IDX,
 	STALL_CYC_IDX,
+	WB_IDX,
 	NUM_EVENTS
 };
 #define INST_EV		0x08
 #define L2DM_EV		0x17
 #define CYC_EV		0x11
 
+/* Devices (e.g. DDR and CCI) that one monitor can vote on */
+#define MAX_TARGETS	2
+/* Reads closer together than this reuse the last sample */
+#define MIN_READ_US	(5 * USEC_PER_MSEC)
+
 struct event_data {
 	struct perf_event *pevent;
 	unsigned long prev_count;
@@ -54,12 +60,24 @@ struct cpu_pmu_stats {
 	ktime_t prev_ts;
 };
 
+struct cpu_grp_info;
+
+struct memlat_target {
+	struct memlat_hwmon hw;
+	struct cpu_grp_info *cpu_grp;
+};
+
 struct cpu_grp_info {
 	cpumask_t cpus;
 	cpumask_t inited_cpus;
 	unsigned int event_ids[NUM_EVENTS];
 	struct cpu_pmu_stats *cpustats;
-	struct memlat_hwmon hw;
+	struct dev_stats *core_stats;
+	struct memlat_target targets[MAX_TARGETS];
+	int num_targets;
+	int users;
+	ktime_t last_read;
+	struct mutex read_lock;
 	struct notifier_block arm_memlat_cpu_notif;
 	struct list_head mon_list;
 };
@@ -71,8 +89,9 @@ struct memlat_mon_spec {
 #define to_cpustats(cpu_grp, cpu) \
 	(&cpu_grp->cpustats[cpu - cpumask_first(&cpu_grp->cpus)])
 #define to_devstats(cpu_grp, cpu) \
-	(&cpu_grp->hw.core_stats[cpu - cpumask_first(&cpu_grp->cpus)])
-#define to_cpu_grp(hwmon) container_of(hwmon, struct cpu_grp_info, hw)
+	(&cpu_grp->core_stats[cpu - cpumask_first(&cpu_grp->cpus)])
+#define to_cpu_grp(hwmon) \
+	(container_of(hwmon, struct memlat_target, hw)->cpu_grp)
 
 static LIST_HEAD(memlat_mon_list);
 static DEFINE_MUTEX(list_lock);
@@ -118,6 +137,7 @@ static void read_perf_counters(int cpu, struct cpu_grp_info *cpu_grp)
 
 	devstats->inst_count = read_event(&cpustats->events[INST_IDX]);
 	devstats->mem_count = read_event(&cpustats->events[CM_IDX]);
+	devstats->wb_count = read_event(&cpustats->events[WB_IDX]);
 	cyc_cnt = read_event(&cpustats->events[CYC_IDX]);
 	devstats->freq = compute_freq(cpustats, cyc_cnt);
 	if (cpustats->events[STALL_CYC_IDX].pevent) {
@@ -129,13 +149,26 @@ static void read_perf_counters(int cpu, struct cpu_grp_info *cpu_grp)
 	}
 }
 
+/*
+ * All targets of a group share one set of counters; when they are polled
+ * back to back the later ones see the sample the first one took.
+ */
 static unsigned long get_cnt(struct memlat_hwmon *hw)
 {
 	int cpu;
 	struct cpu_grp_info *cpu_grp = to_cpu_grp(hw);
+	ktime_t now = ktime_get();
+
+	mutex_lock(&cpu_grp->read_lock);
+	if (cpu_grp->num_targets > 1 &&
+	    ktime_us_delta(now, cpu_grp->last_read) < MIN_READ_US)
+		goto out;
+	cpu_grp->last_read = now;
 
 	for_each_cpu(cpu, &cpu_grp->inited_cpus)
 		read_perf_counters(cpu, cpu_grp);
+out:
+	mutex_unlock(&cpu_grp->read_lock);
 
 	return 0;
 }
@@ -159,6 +192,13 @@ static void stop_hwmon(struct memlat_hwmon *hw)
 	struct cpu_grp_info *cpu_grp = to_cpu_grp(hw);
 	struct dev_stats *devstats;
 
+	mutex_lock(&cpu_grp->read_lock);
+	if (--cpu_grp->users) {
+		mutex_unlock(&cpu_grp->read_lock);
+		return;
+	}
+	mutex_unlock(&cpu_grp->read_lock);
+
 	get_online_cpus();
 	for_each_cpu(cpu, &cpu_grp->inited_cpus) {
 		delete_events(to_cpustats(cpu_grp, cpu));
@@ -167,6 +207,7 @@ static void stop_hwmon(struct memlat_hwmon *hw)
 		devstats = to_devstats(cpu_grp, cpu);
 		devstats->inst_count = 0;
 		devstats->mem_count = 0;
+		devstats->wb_count = 0;
 		devstats->freq = 0;
 		devstats->stall_pct = 0;
 	}
@@ -264,6 +305,13 @@ static int start_hwmon(struct memlat_hwmon *hw)
 	int cpu, ret = 0;
 	struct cpu_grp_info *cpu_grp = to_cpu_grp(hw);
 
+	mutex_lock(&cpu_grp->read_lock);
+	if (cpu_grp->users++) {
+		mutex_unlock(&cpu_grp->read_lock);
+		return 0;
+	}
+	mutex_unlock(&cpu_grp->read_lock);
+
 	register_cpu_notifier(&cpu_grp->arm_memlat_cpu_notif);
 
 	get_online_cpus();
@@ -288,6 +336,12 @@ static int start_hwmon(struct memlat_hwmon *hw)
 
 	put_online_cpus();
 
+	if (ret) {
+		mutex_lock(&cpu_grp->read_lock);
+		cpu_grp->users--;
+		mutex_unlock(&cpu_grp->read_lock);
+	}
+
 	return ret;
 }
 
@@ -323,34 +377,29 @@ static int arm_memlat_mon_driver_probe(struct platform_device *pdev)
 	struct memlat_hwmon *hw;
 	struct cpu_grp_info *cpu_grp;
 	const struct memlat_mon_spec *spec;
-	int cpu, ret;
+	struct device_node *of_node;
+	unsigned int num_cores;
+	int cpu, ret, i;
 	u32 event_id;
 
 	cpu_grp = devm_kzalloc(dev, sizeof(*cpu_grp), GFP_KERNEL);
 	if (!cpu_grp)
 		return -ENOMEM;
 	cpu_grp->arm_memlat_cpu_notif.notifier_call = arm_memlat_cpu_callback;
-	hw = &cpu_grp->hw;
-
-	hw->dev = dev;
-	hw->of_node = of_parse_phandle(dev->of_node, "qcom,target-dev", 0);
-	if (!hw->of_node) {
-		dev_err(dev, "Couldn't find a target device\n");
-		return -ENODEV;
-	}
+	mutex_init(&cpu_grp->read_lock);
 
 	if (get_mask_from_dev_handle(pdev, &cpu_grp->cpus)) {
 		dev_err(dev, "CPU list is empty\n");
 		return -ENODEV;
 	}
 
-	hw->num_cores = cpumask_weight(&cpu_grp->cpus);
-	hw->core_stats = devm_kzalloc(dev, hw->num_cores *
-				sizeof(*(hw->core_stats)), GFP_KERNEL);
-	if (!hw->core_stats)
+	num_cores = cpumask_weight(&cpu_grp->cpus);
+	cpu_grp->core_stats = devm_kzalloc(dev, num_cores *
+				sizeof(*(cpu_grp->core_stats)), GFP_KERNEL);
+	if (!cpu_grp->core_stats)
 		return -ENOMEM;
 
-	cpu_grp->cpustats = devm_kzalloc(dev, hw->num_cores *
+	cpu_grp->cpustats = devm_kzalloc(dev, num_cores *
 			sizeof(*(cpu_grp->cpustats)), GFP_KERNEL);
 	if (!cpu_grp->cpustats)
 		return -ENOMEM;
@@ -360,13 +409,35 @@ static int arm_memlat_mon_driver_probe(struct platform_device *pdev)
 	for_each_cpu(cpu, &cpu_grp->cpus)
 		to_devstats(cpu_grp, cpu)->id = cpu;
 
-	hw->start_hwmon = &start_hwmon;
-	hw->stop_hwmon = &stop_hwmon;
-	hw->get_cnt = &get_cnt;
+	/*
+	 * Additional qcom,target-dev phandles get their own governor node
+	 * fed from the same counters, each with its qcom,core-dev-table-<n>.
+	 */
+	for (i = 0; i < MAX_TARGETS; i++) {
+		of_node = of_parse_phandle(dev->of_node, "qcom,target-dev", i);
+		if (!of_node)
+			break;
+
+		hw = &cpu_grp->targets[i].hw;
+		cpu_grp->targets[i].cpu_grp = cpu_grp;
+		hw->dev = i ? NULL : dev;
+		hw->of_node = of_node;
+		hw->num_cores = num_cores;
+		hw->core_stats = cpu_grp->core_stats;
+		hw->start_hwmon = &start_hwmon;
+		hw->stop_hwmon = &stop_hwmon;
+		hw->get_cnt = &get_cnt;
+		hw->target_idx = i;
+	}
+	cpu_grp->num_targets = i;
+	if (!cpu_grp->num_targets) {
+		dev_err(dev, "Couldn't find a target device\n");
+		return -ENODEV;
+	}
 
 	spec = of_device_get_match_data(dev);
 	if (spec && spec->is_compute) {
-		ret = register_compute(dev, hw);
+		ret = register_compute(dev, &cpu_grp->targets[0].hw);
 		if (ret)
 			pr_err("Compute Gov registration failed\n");
 
@@ -397,9 +468,20 @@ static int arm_memlat_mon_driver_probe(struct platform_device *pdev)
 	else
 		cpu_grp->event_ids[STALL_CYC_IDX] = event_id;
 
-	ret = register_memlat(dev, hw);
+	ret = of_property_read_u32(dev->of_node, "qcom,writeback-ev",
+				   &event_id);
 	if (ret)
-		pr_err("Mem Latency Gov registration failed\n");
+		dev_dbg(dev, "Writeback event not specified. Event ignored.\n");
+	else
+		cpu_grp->event_ids[WB_IDX] = event_id;
+
+	for (i = 0; i < cpu_grp->num_targets; i++) {
+		ret = register_memlat(dev, &cpu_grp->targets[i].hw);
+		if (ret) {
+			pr_err("Mem Latency Gov registration failed\n");
+			break;
+		}
+	}
 
 	return ret;
 }
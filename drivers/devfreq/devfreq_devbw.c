@@ -26,6 +26,9 @@
 #include <linux/interrupt.h>
 #include <linux/devfreq.h>
 #include <linux/of.h>
+#include <linux/list.h>
+#include <linux/debugfs.h>
+#include <linux/seq_file.h>
 #include <trace/events/power.h>
 #include <linux/msm-bus.h>
 #include <linux/msm-bus-board.h>
@@ -47,15 +50,79 @@ struct dev_data {
 	long gov_ab;
 	struct devfreq *df;
 	struct devfreq_dev_profile dp;
+
+	/* Vote aggregation bookkeeping, protected by devbw_lock */
+	struct list_head list;
+	u32 dst;
+	int req_ib;
+	int req_ab;
+	ktime_t last_up;
+	ktime_t last_change;
+	unsigned long num_votes;
+	unsigned long num_held;
+	unsigned long num_final;
 };
 
+/*
+ * All devbw devices vote into msm_bus independently, which aggregates
+ * them per slave port: IB is the max and AB the sum of all clients. Keep
+ * the same view here so it is clear which governor sets the final level,
+ * and hold back decreases for down_delay_ms after the last increase of a
+ * client to keep governors racing each other from oscillating the bus.
+ */
+static LIST_HEAD(devbw_list);
+static DEFINE_MUTEX(devbw_lock);
+
+static unsigned int down_delay_ms;
+module_param(down_delay_ms, uint, 0644);
+
+/* Returns true if the client setting the max IB on @d's port is @d */
+static bool devbw_owns_ib(struct dev_data *d)
+{
+	struct dev_data *o;
+
+	list_for_each_entry(o, &devbw_list, list)
+		if (o != d && o->dst == d->dst && o->cur_ib > d->cur_ib)
+			return false;
+
+	return true;
+}
+
+/* Returns true if the decrease to @new_ib/@new_ab should be held back */
+static bool devbw_hold_down(struct dev_data *d, int new_ib, int new_ab)
+{
+	ktime_t now = ktime_get();
+
+	if (new_ib > d->cur_ib || new_ab > d->cur_ab) {
+		d->last_up = now;
+		return false;
+	}
+
+	if (!down_delay_ms)
+		return false;
+
+	return ktime_ms_delta(now, d->last_up) < down_delay_ms;
+}
+
 static int set_bw(struct device *dev, int new_ib, int new_ab)
 {
 	struct dev_data *d = dev_get_drvdata(dev);
 	int i, ret;
 
-	if (d->cur_ib == new_ib && d->cur_ab == new_ab)
+	mutex_lock(&devbw_lock);
+	d->req_ib = new_ib;
+	d->req_ab = new_ab;
+	d->num_votes++;
+	if (d->cur_ib == new_ib && d->cur_ab == new_ab) {
+		mutex_unlock(&devbw_lock);
 		return 0;
+	}
+	if (devbw_hold_down(d, new_ib, new_ab)) {
+		d->num_held++;
+		mutex_unlock(&devbw_lock);
+		return 0;
+	}
+	mutex_unlock(&devbw_lock);
 
 	i = (d->cur_idx + 1) % DBL_BUF;
 
@@ -71,8 +138,13 @@ static int set_bw(struct device *dev, int new_ib, int new_ab)
 		dev_err(dev, "bandwidth request failed (%d)\n", ret);
 	} else {
 		d->cur_idx = i;
+		mutex_lock(&devbw_lock);
 		d->cur_ib = new_ib;
 		d->cur_ab = new_ab;
+		d->last_change = ktime_get();
+		if (devbw_owns_ib(d))
+			d->num_final++;
+		mutex_unlock(&devbw_lock);
 	}
 
 	return ret;
@@ -168,6 +240,7 @@ int devfreq_add_devbw(struct device *dev)
 	d->bw_levels[0].num_paths = num_paths;
 	d->bw_levels[1].num_paths = num_paths;
 	d->num_paths = num_paths;
+	d->dst = ports[1];
 
 	p = &d->dp;
 	p->polling_ms = 50;
@@ -205,8 +278,15 @@ int devfreq_add_devbw(struct device *dev)
 	if (of_property_read_string(dev->of_node, "governor", &gov_name))
 		gov_name = "performance";
 
+	mutex_lock(&devbw_lock);
+	list_add_tail(&d->list, &devbw_list);
+	mutex_unlock(&devbw_lock);
+
 	d->df = devfreq_add_device(dev, p, gov_name, NULL);
 	if (IS_ERR(d->df)) {
+		mutex_lock(&devbw_lock);
+		list_del(&d->list);
+		mutex_unlock(&devbw_lock);
 		msm_bus_scale_unregister_client(d->bus_client);
 		return PTR_ERR(d->df);
 	}
@@ -220,6 +300,10 @@ int devfreq_remove_devbw(struct device *dev)
 
 	msm_bus_scale_unregister_client(d->bus_client);
 	devfreq_remove_device(d->df);
+
+	mutex_lock(&devbw_lock);
+	list_del(&d->list);
+	mutex_unlock(&devbw_lock);
 	return 0;
 }
 
@@ -262,6 +346,86 @@ static struct platform_driver devbw_driver = {
 	},
 };
 
-module_platform_driver(devbw_driver);
+static int devbw_votes_show(struct seq_file *m, void *unused)
+{
+	struct dev_data *d, *o;
+	ktime_t now = ktime_get();
+	bool seen;
+	int ib, ab;
+
+	mutex_lock(&devbw_lock);
+	list_for_each_entry(d, &devbw_list, list) {
+		/* Print each port once, at its first client */
+		seen = false;
+		list_for_each_entry(o, &devbw_list, list) {
+			if (o == d)
+				break;
+			if (o->dst == d->dst)
+				seen = true;
+		}
+		if (seen)
+			continue;
+
+		ib = ab = 0;
+		list_for_each_entry(o, &devbw_list, list) {
+			if (o->dst != d->dst)
+				continue;
+			ib = max(ib, o->cur_ib);
+			ab += o->cur_ab;
+		}
+		seq_printf(m, "port %u: IB %d MBps AB %d MBps\n",
+			   d->dst, ib, ab);
+
+		list_for_each_entry(o, &devbw_list, list) {
+			if (o->dst != d->dst)
+				continue;
+			seq_printf(m,
+				"  %c %s (%s): req %d/%d cur %d/%d votes %lu held %lu final %lu last %lld ms ago\n",
+				o->cur_ib == ib && ib ? '*' : ' ',
+				o->bw_data.name,
+				o->df && !IS_ERR(o->df) ?
+					o->df->governor_name : "-",
+				o->req_ib, o->req_ab, o->cur_ib, o->cur_ab,
+				o->num_votes, o->num_held, o->num_final,
+				ktime_to_ns(o->last_change) ?
+					ktime_ms_delta(now, o->last_change) :
+					-1LL);
+		}
+	}
+	mutex_unlock(&devbw_lock);
+
+	return 0;
+}
+
+static int devbw_votes_open(struct inode *inode, struct file *file)
+{
+	return single_open(file, devbw_votes_show, NULL);
+}
+
+static const struct file_operations devbw_votes_fops = {
+	.open		= devbw_votes_open,
+	.read		= seq_read,
+	.llseek		= seq_lseek,
+	.release	= single_release,
+};
+
+static struct dentry *devbw_debugfs;
+
+static int __init devbw_init(void)
+{
+	devbw_debugfs = debugfs_create_file("devbw_votes", 0444, NULL, NULL,
+					    &devbw_votes_fops);
+
+	return platform_driver_register(&devbw_driver);
+}
+module_init(devbw_init);
+
+static void __exit devbw_exit(void)
+{
+	platform_driver_unregister(&devbw_driver);
+	debugfs_remove(devbw_debugfs);
+}
+module_exit(devbw_exit);
+
 MODULE_DESCRIPTION("Device DDR bandwidth voting driver MSM SoCs");
 MODULE_LICENSE("GPL v2");
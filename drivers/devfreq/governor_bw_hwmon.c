@@ -25,6 +25,8 @@
 #include <linux/errno.h>
 #include <linux/mutex.h>
 #include <linux/interrupt.h>
+#include <linux/hrtimer.h>
+#include <linux/workqueue.h>
 #include <linux/spinlock.h>
 #include <linux/platform_device.h>
 #include <linux/of.h>
@@ -49,6 +51,9 @@ struct hwmon_node {
 	unsigned int hyst_length;
 	unsigned int idle_mbps;
 	unsigned int mbps_zones[NUM_MBPS_ZONES];
+	unsigned int pred_en;
+	unsigned int pred_lead_ms;
+	unsigned int pred_tol;
 
 	unsigned long prev_ab;
 	unsigned long *dev_ab;
@@ -69,6 +74,25 @@ struct hwmon_node {
 	ktime_t hist_max_ts;
 	bool sampled;
 	bool mon_started;
+
+	/* Periodic burst prediction */
+	ktime_t pred_onset;
+	ktime_t pred_next;
+	ktime_t vote_ts;
+	unsigned long pred_period_us;
+	unsigned long pred_peak;
+	unsigned long pred_burst_max;
+	unsigned int pred_conf;
+	bool pred_in_burst;
+	bool pred_armed;
+	unsigned long pred_votes;
+	unsigned long pred_hits;
+	unsigned long pred_misses;
+	u64 over_vote_mb;
+	u64 under_vote_mb;
+	struct hrtimer pred_timer;
+	struct work_struct pred_work;
+
 	struct list_head list;
 	void *orig_data;
 	struct bw_hwmon *hw;
@@ -307,11 +331,163 @@ unsigned long to_mbps_zone(struct hwmon_node *node, unsigned long mbps)
 
 #define MIN_MBPS	500UL
 #define HIST_PEAK_TOL	60
+
+/*
+ * Periodic burst prediction. Onsets of traffic bursts (e.g. per frame
+ * camera or GPU traffic) are timestamped and, once enough consecutive
+ * intervals agree within pred_tol percent, the learned peak is voted
+ * pred_lead_ms before the next expected onset. The vote is dropped once
+ * the burst is seen or the window passes and decay_rate takes over.
+ */
+#define PRED_MIN_CONF		2
+#define PRED_MAX_CONF		8
+#define PRED_MIN_PERIOD_US	(4 * USEC_PER_MSEC)
+#define PRED_MAX_PERIOD_US	(200 * USEC_PER_MSEC)
+
+static void reset_prediction(struct hwmon_node *node)
+{
+	node->pred_onset = ktime_set(0, 0);
+	node->pred_period_us = 0;
+	node->pred_peak = 0;
+	node->pred_burst_max = 0;
+	node->pred_conf = 0;
+	node->pred_in_burst = false;
+	node->pred_armed = false;
+}
+
+static void learn_burst_onset(struct hwmon_node *node, ktime_t ts)
+{
+	unsigned long period = node->pred_period_us;
+	s64 us;
+
+	if (!ktime_to_ns(node->pred_onset))
+		goto out;
+
+	us = ktime_us_delta(ts, node->pred_onset);
+	if (us < PRED_MIN_PERIOD_US || us > PRED_MAX_PERIOD_US) {
+		node->pred_period_us = 0;
+		node->pred_conf = 0;
+		goto out;
+	}
+
+	if (period && abs(us - (s64)period) <= period * node->pred_tol / 100) {
+		node->pred_period_us = (3 * period + us) / 4;
+		if (node->pred_conf < PRED_MAX_CONF)
+			node->pred_conf++;
+	} else {
+		node->pred_period_us = us;
+		node->pred_conf = 0;
+	}
+out:
+	node->pred_onset = ts;
+}
+
+/* Returns the MBps to vote in anticipation of a burst, or 0. Needs irq_lock */
+static unsigned long predict_burst(struct hwmon_node *node,
+				   unsigned long meas_mbps, ktime_t ts)
+{
+	bool burst = meas_mbps > max(MIN_MBPS, (unsigned long)node->idle_mbps);
+	s64 lead_us = node->pred_lead_ms * USEC_PER_MSEC;
+	s64 tol_us, us;
+
+	tol_us = node->pred_period_us * node->pred_tol / 100;
+
+	if (burst && !node->pred_in_burst) {
+		if (node->pred_armed) {
+			us = ktime_us_delta(ts, node->pred_next);
+			if (us >= -lead_us && us <= tol_us)
+				node->pred_hits++;
+			else
+				node->pred_misses++;
+			node->pred_armed = false;
+		}
+		learn_burst_onset(node, ts);
+		node->pred_burst_max = 0;
+	}
+
+	if (burst) {
+		node->pred_burst_max = max(node->pred_burst_max, meas_mbps);
+	} else if (node->pred_in_burst) {
+		if (node->pred_conf)
+			node->pred_peak = (3 * node->pred_peak
+					   + node->pred_burst_max) / 4;
+		else
+			node->pred_peak = node->pred_burst_max;
+	}
+	node->pred_in_burst = burst;
+
+	if (!node->pred_en || node->pred_conf < PRED_MIN_CONF || burst)
+		return 0;
+
+	node->pred_next = ktime_add_us(node->pred_onset, node->pred_period_us);
+	us = ktime_us_delta(node->pred_next, ts);
+
+	/* The expected burst never showed up, look for the next one */
+	if (us < -tol_us) {
+		if (node->pred_armed)
+			node->pred_misses++;
+		node->pred_armed = false;
+		node->pred_onset = node->pred_next;
+		node->pred_conf--;
+		return 0;
+	}
+
+	if (us > lead_us) {
+		hrtimer_start(&node->pred_timer,
+			      ktime_sub_us(node->pred_next, lead_us),
+			      HRTIMER_MODE_ABS);
+		return 0;
+	}
+
+	if (!node->pred_armed) {
+		node->pred_armed = true;
+		node->pred_votes++;
+	}
+
+	return node->pred_peak;
+}
+
+static enum hrtimer_restart pred_timer_fn(struct hrtimer *timer)
+{
+	struct hwmon_node *node = container_of(timer, struct hwmon_node,
+					       pred_timer);
+
+	queue_work(system_highpri_wq, &node->pred_work);
+	return HRTIMER_NORESTART;
+}
+
+static void pred_work_fn(struct work_struct *work)
+{
+	struct hwmon_node *node = container_of(work, struct hwmon_node,
+					       pred_work);
+
+	update_bw_hwmon(node->hw);
+}
+
+/* Accumulates how far the vote in the last window was off the traffic */
+static void account_vote(struct hwmon_node *node, unsigned long meas_mbps,
+			 ktime_t ts)
+{
+	s64 us = ktime_us_delta(ts, node->vote_ts);
+	unsigned long vote = node->prev_ab;
+
+	node->vote_ts = ts;
+	if (us <= 0)
+		return;
+
+	if (vote > meas_mbps)
+		node->over_vote_mb += div_s64((vote - meas_mbps) * us,
+					      USEC_PER_SEC);
+	else
+		node->under_vote_mb += div_s64((meas_mbps - vote) * us,
+					       USEC_PER_SEC);
+}
+
 static unsigned long get_bw_and_set_irq(struct hwmon_node *node,
 					unsigned long *freq, unsigned long *ab)
 {
 	unsigned long meas_mbps, thres, flags, req_mbps, adj_mbps;
-	unsigned long meas_mbps_zone;
+	unsigned long meas_mbps_zone, pred_mbps;
 	unsigned long hist_lo_tol, hyst_lo_tol;
 	struct bw_hwmon *hw = node->hw;
 	unsigned int new_bw, io_percent = node->io_percent;
@@ -320,10 +496,9 @@ static unsigned long get_bw_and_set_irq(struct hwmon_node *node,
 
 	spin_lock_irqsave(&irq_lock, flags);
 
-	if (!hw->set_hw_events) {
-		ts = ktime_get();
+	ts = ktime_get();
+	if (!hw->set_hw_events)
 		ms = ktime_to_ms(ktime_sub(ts, node->prev_ts));
-	}
 	if (!node->sampled || ms >= node->sample_ms)
 		__bw_hwmon_sample_end(node->hw);
 	node->sampled = false;
@@ -418,6 +593,10 @@ static unsigned long get_bw_and_set_irq(struct hwmon_node *node,
 			req_mbps = max(req_mbps, node->hyst_mbps);
 	}
 
+	pred_mbps = predict_burst(node, meas_mbps, ts);
+	req_mbps = max(req_mbps, pred_mbps);
+	account_vote(node, meas_mbps, ts);
+
 	/* Stretch the short sample window size, if the traffic is too low */
 	if (meas_mbps < MIN_MBPS) {
 		hw->up_wake_mbps = (max(MIN_MBPS, req_mbps)
@@ -543,8 +722,10 @@ static int start_monitor(struct devfreq *df, bool init)
 	int ret;
 
 	node->prev_ts = ktime_get();
+	node->vote_ts = node->prev_ts;
 
 	if (init) {
+		reset_prediction(node);
 		node->prev_ab = 0;
 		node->resume_freq = 0;
 		node->resume_ab = 0;
@@ -581,6 +762,9 @@ static void stop_monitor(struct devfreq *df, bool init)
 	node->mon_started = false;
 	mutex_unlock(&node->mon_lock);
 
+	hrtimer_cancel(&node->pred_timer);
+	cancel_work_sync(&node->pred_work);
+
 	if (init) {
 		devfreq_monitor_stop(df);
 		hw->stop_hwmon(hw);
@@ -778,6 +962,32 @@ gov_attr(hyst_trigger_count, 0U, 90U);
 gov_attr(hyst_length, 0U, 90U);
 gov_attr(idle_mbps, 0U, 2000U);
 gov_list_attr(mbps_zones, NUM_MBPS_ZONES, 0U, UINT_MAX);
+gov_attr(pred_en, 0U, 1U);
+gov_attr(pred_lead_ms, 0U, 20U);
+gov_attr(pred_tol, 1U, 50U);
+
+static ssize_t show_pred_stats(struct device *dev,
+			struct device_attribute *attr, char *buf)
+{
+	struct devfreq *df = to_devfreq(dev);
+	struct hwmon_node *node = df->data;
+	unsigned long flags;
+	ssize_t cnt;
+
+	spin_lock_irqsave(&irq_lock, flags);
+	cnt = snprintf(buf, PAGE_SIZE,
+		"period_us: %lu\nconfidence: %u\npeak_mbps: %lu\n"
+		"prevotes: %lu\nhits: %lu\nmisses: %lu\n"
+		"over_vote_mb: %llu\nunder_vote_mb: %llu\n",
+		node->pred_period_us, node->pred_conf, node->pred_peak,
+		node->pred_votes, node->pred_hits, node->pred_misses,
+		node->over_vote_mb, node->under_vote_mb);
+	spin_unlock_irqrestore(&irq_lock, flags);
+
+	return cnt;
+}
+
+static DEVICE_ATTR(pred_stats, 0444, show_pred_stats, NULL);
 
 static struct attribute *dev_attr[] = {
 	&dev_attr_guard_band_mbps.attr,
@@ -795,6 +1005,10 @@ static struct attribute *dev_attr[] = {
 	&dev_attr_idle_mbps.attr,
 	&dev_attr_mbps_zones.attr,
 	&dev_attr_throttle_adj.attr,
+	&dev_attr_pred_en.attr,
+	&dev_attr_pred_lead_ms.attr,
+	&dev_attr_pred_tol.attr,
+	&dev_attr_pred_stats.attr,
 	NULL,
 };
 
@@ -937,9 +1151,15 @@ int register_bw_hwmon(struct device *dev, struct bw_hwmon *hwmon)
 	node->hyst_length = 0;
 	node->idle_mbps = 400;
 	node->mbps_zones[0] = 0;
+	node->pred_en = 0;
+	node->pred_lead_ms = 2;
+	node->pred_tol = 10;
 	node->hw = hwmon;
 
 	mutex_init(&node->mon_lock);
+	hrtimer_init(&node->pred_timer, CLOCK_MONOTONIC, HRTIMER_MODE_ABS);
+	node->pred_timer.function = pred_timer_fn;
+	INIT_WORK(&node->pred_work, pred_work_fn);
 
 	mutex_lock(&list_lock);
 	list_add_tail(&node->list, &hwmon_list);
@@ -33,9 +33,28 @@
 
 #include <trace/events/power.h>
 
+#define MEMLAT_HIST_LEN	16
+
+struct memlat_sample {
+	int cpu;
+	unsigned long core_mhz;
+	unsigned int ratio;
+	unsigned int wb_ratio;
+	unsigned long stall_pct;
+	unsigned long vote;
+	char reason;
+};
+
 struct memlat_node {
 	unsigned int ratio_ceil;
 	unsigned int stall_floor;
+	unsigned int wb_ratio_ceil;
+	unsigned int stall_ceil;
+	unsigned int hyst_length;
+	unsigned int hyst_cnt;
+	unsigned long prev_vote;
+	struct memlat_sample hist[MEMLAT_HIST_LEN];
+	unsigned int hist_cnt;
 	bool mon_started;
 	bool already_zero;
 	struct list_head list;
@@ -107,6 +126,39 @@ static ssize_t show_map(struct device *dev, struct device_attribute *attr,
 
 static DEVICE_ATTR(freq_map, 0444, show_map, NULL);
 
+/*
+ * Latest decisions, oldest first. reason is the signal that marked the
+ * core as latency bound: r(atio), w(riteback), s(tall), h(ysteresis) or
+ * - when no core was.
+ */
+static ssize_t show_history(struct device *dev, struct device_attribute *attr,
+			    char *buf)
+{
+	struct devfreq *df = to_devfreq(dev);
+	struct memlat_node *n = df->data;
+	struct memlat_sample *h;
+	unsigned int i, nr;
+	ssize_t cnt;
+
+	cnt = scnprintf(buf, PAGE_SIZE,
+			"cpu core_mhz ratio wb_ratio stall vote reason\n");
+
+	mutex_lock(&df->lock);
+	nr = min_t(unsigned int, n->hist_cnt, MEMLAT_HIST_LEN);
+	for (i = n->hist_cnt - nr; i != n->hist_cnt; i++) {
+		h = &n->hist[i % MEMLAT_HIST_LEN];
+		cnt += scnprintf(buf + cnt, PAGE_SIZE - cnt,
+				 "%d %lu %u %u %lu %lu %c\n", h->cpu,
+				 h->core_mhz, h->ratio, h->wb_ratio,
+				 h->stall_pct, h->vote, h->reason);
+	}
+	mutex_unlock(&df->lock);
+
+	return cnt;
+}
+
+static DEVICE_ATTR(history, 0444, show_history, NULL);
+
 static unsigned long core_to_dev_freq(struct memlat_node *node,
 		unsigned long coref)
 {
@@ -158,6 +210,10 @@ static int start_monitor(struct devfreq *df)
 		return ret;
 	}
 
+	node->prev_vote = 0;
+	node->hyst_cnt = 0;
+	node->hist_cnt = 0;
+
 	devfreq_monitor_start(df);
 
 	node->mon_started = true;
@@ -224,14 +280,35 @@ static void gov_stop(struct devfreq *df)
 	hw->df = NULL;
 }
 
+/*
+ * A core is latency bound when its instructions per L2 miss or per
+ * writeback fall under their ceilings, or when it spends at least
+ * stall_ceil percent of its cycles stalled. The two ceilings count
+ * separately since writebacks cost bus bandwidth rather than load latency.
+ */
+static char memlat_bound(struct memlat_node *node, struct dev_stats *st,
+			 unsigned int ratio, unsigned int wb_ratio)
+{
+	if (ratio <= node->ratio_ceil && st->stall_pct >= node->stall_floor)
+		return 'r';
+	if (node->wb_ratio_ceil && st->wb_count &&
+	    wb_ratio <= node->wb_ratio_ceil)
+		return 'w';
+	if (node->stall_ceil && st->stall_pct >= node->stall_ceil)
+		return 's';
+	return 0;
+}
+
 static int devfreq_memlat_get_freq(struct devfreq *df,
 					unsigned long *freq)
 {
 	int i, lat_dev = 0;
 	struct memlat_node *node = df->data;
 	struct memlat_hwmon *hw = node->hw;
+	struct memlat_sample *h;
 	unsigned long max_freq = 0;
-	unsigned int ratio;
+	unsigned int ratio, wb_ratio, lat_ratio = 0, lat_wb_ratio = 0;
+	char reason, lat_reason = '-';
 
 	hw->get_cnt(hw);
 
@@ -241,6 +318,10 @@ static int devfreq_memlat_get_freq(struct devfreq *df,
 		if (hw->core_stats[i].mem_count)
 			ratio /= hw->core_stats[i].mem_count;
 
+		wb_ratio = hw->core_stats[i].inst_count;
+		if (hw->core_stats[i].wb_count)
+			wb_ratio /= hw->core_stats[i].wb_count;
+
 		if (!hw->core_stats[i].freq)
 			continue;
 
@@ -251,17 +332,40 @@ static int devfreq_memlat_get_freq(struct devfreq *df,
 					hw->core_stats[i].freq,
 					hw->core_stats[i].stall_pct, ratio);
 
-		if (ratio <= node->ratio_ceil
-		    && hw->core_stats[i].stall_pct >= node->stall_floor
-		    && hw->core_stats[i].freq > max_freq) {
+		reason = memlat_bound(node, &hw->core_stats[i], ratio,
+				      wb_ratio);
+		if (reason && hw->core_stats[i].freq > max_freq) {
 			lat_dev = i;
 			max_freq = hw->core_stats[i].freq;
+			lat_ratio = ratio;
+			lat_wb_ratio = wb_ratio;
+			lat_reason = reason;
 		}
 	}
 
+	h = &node->hist[node->hist_cnt++ % MEMLAT_HIST_LEN];
+	h->cpu = hw->core_stats[lat_dev].id;
+	h->core_mhz = max_freq;
+	h->ratio = lat_ratio;
+	h->wb_ratio = lat_wb_ratio;
+	h->stall_pct = hw->core_stats[lat_dev].stall_pct;
+
 	if (max_freq)
 		max_freq = core_to_dev_freq(node, max_freq);
 
+	/* Hold a higher vote for hyst_length samples before dropping it */
+	if (max_freq >= node->prev_vote ||
+	    node->hyst_cnt >= node->hyst_length) {
+		node->hyst_cnt = 0;
+		node->prev_vote = max_freq;
+	} else {
+		node->hyst_cnt++;
+		max_freq = node->prev_vote;
+		lat_reason = 'h';
+	}
+	h->vote = max_freq;
+	h->reason = lat_reason;
+
 	if (max_freq || !node->already_zero) {
 		trace_memlat_dev_update(dev_name(df->dev.parent),
 					hw->core_stats[lat_dev].id,
@@ -279,16 +383,25 @@ static int devfreq_memlat_get_freq(struct devfreq *df,
 
 gov_attr(ratio_ceil, 1U, 10000U);
 gov_attr(stall_floor, 0U, 100U);
+gov_attr(wb_ratio_ceil, 0U, 10000U);
+gov_attr(stall_ceil, 0U, 100U);
+gov_attr(hyst_length, 0U, 100U);
 
 static struct attribute *memlat_dev_attr[] = {
 	&dev_attr_ratio_ceil.attr,
 	&dev_attr_stall_floor.attr,
+	&dev_attr_wb_ratio_ceil.attr,
+	&dev_attr_stall_ceil.attr,
+	&dev_attr_hyst_length.attr,
 	&dev_attr_freq_map.attr,
+	&dev_attr_history.attr,
 	NULL,
 };
 
 static struct attribute *compute_dev_attr[] = {
 	&dev_attr_freq_map.attr,
+	&dev_attr_hyst_length.attr,
+	&dev_attr_history.attr,
 	NULL,
 };
 
@@ -400,6 +513,7 @@ static struct memlat_node *register_common(struct device *dev,
 					   struct memlat_hwmon *hw)
 {
 	struct memlat_node *node;
+	char prop_name[32];
 
 	if (!hw->dev && !hw->of_node)
 		return ERR_PTR(-EINVAL);
@@ -411,7 +525,12 @@ static struct memlat_node *register_common(struct device *dev,
 	node->ratio_ceil = 10;
 	node->hw = hw;
 
-	hw->freq_map = init_core_dev_map(dev, "qcom,core-dev-table");
+	if (hw->target_idx)
+		snprintf(prop_name, sizeof(prop_name),
+			 "qcom,core-dev-table-%u", hw->target_idx);
+	else
+		strlcpy(prop_name, "qcom,core-dev-table", sizeof(prop_name));
+	hw->freq_map = init_core_dev_map(dev, prop_name);
 	if (!hw->freq_map) {
 		dev_err(dev, "Couldn't find the core-dev freq table!\n");
 		return ERR_PTR(-EINVAL);
@@ -21,13 +21,17 @@
  * struct dev_stats - Device stats
  * @inst_count:			Number of instructions executed.
  * @mem_count:			Number of memory accesses made.
+ * @wb_count:			Number of cache writebacks made.
  * @freq:			Effective frequency of the device in the
  *				last interval.
+ * @stall_pct:			Percentage of cycles stalled in the last
+ *				interval.
  */
 struct dev_stats {
 	int id;
 	unsigned long inst_count;
 	unsigned long mem_count;
+	unsigned long wb_count;
 	unsigned long freq;
 	unsigned long stall_pct;
 };
@@ -54,6 +58,8 @@ struct core_dev_map {
  *				hardware monitor.
  * @core_stats:			Array containing instruction count, memory
  *				accesses and effective frequency for each core.
+ * @target_idx:			Index of the target device when one monitor
+ *				votes on several; selects the core-dev table.
  *
  * One of dev or of_node needs to be specified for a successful registration.
  *
@@ -67,6 +73,7 @@ struct memlat_hwmon {
 
 	unsigned int num_cores;
 	struct dev_stats *core_stats;
+	unsigned int target_idx;
 
 	struct devfreq *df;
 	struct core_dev_map *freq_map;
@@ -624,6 +624,9 @@ int dma_buf_begin_cpu_access(struct dma_buf *dmabuf,
 	if (WARN_ON(!dmabuf))
 		return -EINVAL;
 
+	if (direction != DMA_FROM_DEVICE)
+		atomic_inc(&dmabuf->cpu_write_seq);
+
 	if (dmabuf->ops->begin_cpu_access)
 		ret = dmabuf->ops->begin_cpu_access(dmabuf, direction);
 
@@ -655,6 +658,9 @@ int dma_buf_end_cpu_access(struct dma_buf *dmabuf,
 
 	WARN_ON(!dmabuf);
 
+	if (direction != DMA_FROM_DEVICE)
+		atomic_inc(&dmabuf->cpu_write_seq);
+
 	if (dmabuf->ops->end_cpu_access)
 		ret = dmabuf->ops->end_cpu_access(dmabuf, direction);
 
@@ -18,11 +18,24 @@
  */
 
 #include <linux/export.h>
+#include <linux/init.h>
 #include <linux/slab.h>
 #include <linux/fence-array.h>
 
+/* Arrays of up to this many fences come from fence_array_cache */
+#define FENCE_ARRAY_CACHED	8
+
+static struct kmem_cache *fence_array_cache;
+
 static void fence_array_cb_func(struct fence *f, struct fence_cb *cb);
 
+/* The callbacks follow the array, then the fence pointers */
+static size_t fence_array_size(int num_fences)
+{
+	return sizeof(struct fence_array) + num_fences *
+		(sizeof(struct fence_array_cb) + sizeof(struct fence *));
+}
+
 static const char *fence_array_get_driver_name(struct fence *fence)
 {
 	return "fence_array";
@@ -79,6 +92,13 @@ static bool fence_array_signaled(struct fence *fence)
 	return atomic_read(&array->num_pending) <= 0;
 }
 
+static void fence_array_free_rcu(struct rcu_head *rcu)
+{
+	struct fence *fence = container_of(rcu, struct fence, rcu);
+
+	kmem_cache_free(fence_array_cache, to_fence_array(fence));
+}
+
 static void fence_array_release(struct fence *fence)
 {
 	struct fence_array *array = to_fence_array(fence);
@@ -87,8 +107,10 @@ static void fence_array_release(struct fence *fence)
 	for (i = 0; i < array->num_fences; ++i)
 		fence_put(array->fences[i]);
 
-	kfree(array->fences);
-	fence_free(fence);
+	if (array->cached)
+		call_rcu(&fence->rcu, fence_array_free_rcu);
+	else
+		fence_free(fence);
 }
 
 const struct fence_ops fence_array_ops = {
@@ -101,6 +123,73 @@ const struct fence_ops fence_array_ops = {
 };
 EXPORT_SYMBOL(fence_array_ops);
 
+/**
+ * fence_array_alloc - Allocate a fence array and its fence storage
+ * @num_fences:		[in]	maximum number of fences the array will hold
+ *
+ * Returns a zeroed fence_array whose @fences points at room for @num_fences
+ * fences, to be filled by the caller before fence_array_init(). Small
+ * arrays come from a slab cache. In case of error it returns NULL.
+ */
+struct fence_array *fence_array_alloc(int num_fences)
+{
+	struct fence_array *array;
+	bool cached = num_fences <= FENCE_ARRAY_CACHED && fence_array_cache;
+	int capacity = cached ? FENCE_ARRAY_CACHED : num_fences;
+
+	if (cached)
+		array = kmem_cache_zalloc(fence_array_cache, GFP_KERNEL);
+	else
+		array = kzalloc(fence_array_size(num_fences), GFP_KERNEL);
+	if (!array)
+		return NULL;
+
+	array->cached = cached;
+	array->fences = (void *)((struct fence_array_cb *)&array[1] +
+				 capacity);
+
+	return array;
+}
+EXPORT_SYMBOL(fence_array_alloc);
+
+/**
+ * fence_array_init - Initialize a fence array from fence_array_alloc()
+ * @array:		[in]	the fence array
+ * @num_fences:		[in]	number of fences stored in @array->fences
+ * @context:		[in]	fence context to use
+ * @seqno:		[in]	sequence number to use
+ * @signal_on_any:	[in]	signal on any fence in the array
+ *
+ * The array takes over the references to the fences it holds and drops
+ * them on release.
+ */
+void fence_array_init(struct fence_array *array, int num_fences,
+		      u64 context, unsigned seqno, bool signal_on_any)
+{
+	spin_lock_init(&array->lock);
+	fence_init(&array->base, &fence_array_ops, &array->lock,
+		   context, seqno);
+
+	array->num_fences = num_fences;
+	atomic_set(&array->num_pending, signal_on_any ? 1 : num_fences);
+}
+EXPORT_SYMBOL(fence_array_init);
+
+/**
+ * fence_array_free - Free a fence array that was never initialized
+ * @array:		[in]	array from fence_array_alloc()
+ *
+ * Any fences stored in the array are left alone.
+ */
+void fence_array_free(struct fence_array *array)
+{
+	if (array->cached)
+		kmem_cache_free(fence_array_cache, array);
+	else
+		kfree(array);
+}
+EXPORT_SYMBOL(fence_array_free);
+
 /**
  * fence_array_create - Create a custom fence array
  * @num_fences:		[in]	number of fences to add in the array
@@ -114,7 +203,9 @@ EXPORT_SYMBOL(fence_array_ops);
  *
  * The caller should allocate the fences array with num_fences size
  * and fill it with the fences it wants to add to the object. Ownership of this
- * array is taken and fence_put() is used on each fence on release.
+ * array is taken and fence_put() is used on each fence on release. The
+ * pointers are copied into storage allocated with the fence_array, and
+ * @fences is freed immediately on success.
  *
  * If @signal_on_any is true the fence array signals if any fence in the array
  * signals, otherwise it signals when all fences in the array signal.
@@ -124,22 +215,26 @@ struct fence_array *fence_array_create(int num_fences, struct fence **fences,
 				       bool signal_on_any)
 {
 	struct fence_array *array;
-	size_t size = sizeof(*array);
 
-	/* Allocate the callback structures behind the array. */
-	size += num_fences * sizeof(struct fence_array_cb);
-	array = kzalloc(size, GFP_KERNEL);
+	array = fence_array_alloc(num_fences);
 	if (!array)
 		return NULL;
 
-	spin_lock_init(&array->lock);
-	fence_init(&array->base, &fence_array_ops, &array->lock,
-		   context, seqno);
+	memcpy(array->fences, fences, num_fences * sizeof(*fences));
+	kfree(fences);
 
-	array->num_fences = num_fences;
-	atomic_set(&array->num_pending, signal_on_any ? 1 : num_fences);
-	array->fences = fences;
+	fence_array_init(array, num_fences, context, seqno, signal_on_any);
 
 	return array;
 }
 EXPORT_SYMBOL(fence_array_create);
+
+static int __init fence_array_cache_init(void)
+{
+	/* Without the cache every array is a plain allocation */
+	fence_array_cache = kmem_cache_create("fence_array",
+				fence_array_size(FENCE_ARRAY_CACHED),
+				0, SLAB_HWCACHE_ALIGN, NULL);
+	return 0;
+}
+core_initcall(fence_array_cache_init);
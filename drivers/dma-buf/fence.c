@@ -28,6 +28,7 @@
 
 EXPORT_TRACEPOINT_SYMBOL(fence_annotate_wait_on);
 EXPORT_TRACEPOINT_SYMBOL(fence_emit);
+EXPORT_TRACEPOINT_SYMBOL(fence_woken);
 
 /*
  * fence context counter: each execution context should have its own
@@ -241,6 +241,33 @@ static void sync_timeline_signal(struct sync_timeline *obj, unsigned int inc)
 	spin_unlock_irq(&obj->lock);
 }
 
+/**
+ * sync_timeline_record_wake() - account a waiter wakeup on a sw_sync fence
+ * @fence:	fence the waiter saw signaled
+ * @latency_ns:	time since @fence signaled
+ *
+ * Fences from other drivers are ignored.
+ */
+void sync_timeline_record_wake(struct fence *fence, s64 latency_ns)
+{
+	struct sync_timeline *obj;
+	unsigned long flags;
+	int bucket = 0;
+	s64 us;
+
+	if (!fence_to_sync_pt(fence))
+		return;
+
+	us = div_s64(latency_ns, NSEC_PER_USEC);
+	if (us > 0)
+		bucket = min_t(int, ilog2(us) + 1, SYNC_WAKE_HIST_BUCKETS - 1);
+
+	obj = fence_parent(fence);
+	spin_lock_irqsave(&obj->lock, flags);
+	obj->wake_hist[bucket]++;
+	spin_unlock_irqrestore(&obj->lock, flags);
+}
+
 /**
  * sync_pt_create() - creates a sync pt
  * @parent:	fence's parent sync_timeline
@@ -113,6 +113,28 @@ static void sync_print_fence(struct seq_file *s,
 	seq_puts(s, "\n");
 }
 
+/* Bucket 0 is under 1us, bucket n covers [2^(n-1), 2^n) us */
+static void sync_print_wake_hist(struct seq_file *s, struct sync_timeline *obj)
+{
+	int i, last = -1;
+
+	for (i = 0; i < SYNC_WAKE_HIST_BUCKETS; i++)
+		if (obj->wake_hist[i])
+			last = i;
+	if (last < 0)
+		return;
+
+	seq_puts(s, "  wake latency:");
+	for (i = 0; i <= last; i++) {
+		if (i < SYNC_WAKE_HIST_BUCKETS - 1)
+			seq_printf(s, " <%luus:%u", 1UL << i, obj->wake_hist[i]);
+		else
+			seq_printf(s, " >=%luus:%u", 1UL << (i - 1),
+				   obj->wake_hist[i]);
+	}
+	seq_puts(s, "\n");
+}
+
 static void sync_print_obj(struct seq_file *s, struct sync_timeline *obj)
 {
 	struct list_head *pos;
@@ -120,6 +142,7 @@ static void sync_print_obj(struct seq_file *s, struct sync_timeline *obj)
 	seq_printf(s, "%s: %d\n", obj->name, obj->value);
 
 	spin_lock_irq(&obj->lock);
+	sync_print_wake_hist(s, obj);
 	list_for_each(pos, &obj->pt_list) {
 		struct sync_pt *pt = container_of(pos, struct sync_pt, link);
 		sync_print_fence(s, &pt->base, false);
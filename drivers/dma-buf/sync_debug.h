@@ -21,6 +21,8 @@
 #include <linux/sync_file.h>
 #include <uapi/linux/sync_file.h>
 
+#define SYNC_WAKE_HIST_BUCKETS	16
+
 /**
  * struct sync_timeline - sync object
  * @kref:		reference count on fence.
@@ -29,6 +31,7 @@
  * @pt_tree:		rbtree of active (unsignaled/errored) sync_pts
  * @pt_list:		list of active (unsignaled/errored) sync_pts
  * @sync_timeline_list:	membership in global sync_timeline_list
+ * @wake_hist:		signal to waiter wake latency, in log2(us) buckets
  */
 struct sync_timeline {
 	struct kref		kref;
@@ -43,6 +46,9 @@ struct sync_timeline {
 	spinlock_t		lock;
 
 	struct list_head	sync_timeline_list;
+
+	/* protected by lock */
+	u32			wake_hist[SYNC_WAKE_HIST_BUCKETS];
 };
 
 static inline struct sync_timeline *fence_parent(struct fence *fence)
@@ -71,6 +77,7 @@ void sync_timeline_debug_remove(struct sync_timeline *obj);
 void sync_file_debug_add(struct sync_file *fence);
 void sync_file_debug_remove(struct sync_file *fence);
 void sync_dump(void);
+void sync_timeline_record_wake(struct fence *fence, s64 latency_ns);
 
 #else
 # define sync_timeline_debug_add(obj)
@@ -78,6 +85,7 @@ void sync_dump(void);
 # define sync_file_debug_add(fence)
 # define sync_file_debug_remove(fence)
 # define sync_dump()
+# define sync_timeline_record_wake(fence, latency_ns)
 #endif
 
 #endif /* _LINUX_SYNC_H */
@@ -25,6 +25,9 @@
 #include <linux/anon_inodes.h>
 #include <linux/sync_file.h>
 #include <uapi/linux/sync_file.h>
+#include <trace/events/fence.h>
+
+#include "sync_debug.h"
 
 static const struct file_operations sync_file_fops;
 
@@ -131,38 +134,6 @@ struct fence *sync_file_get_fence(int fd)
 }
 EXPORT_SYMBOL(sync_file_get_fence);
 
-static int sync_file_set_fence(struct sync_file *sync_file,
-			       struct fence **fences, int num_fences)
-{
-	struct fence_array *array;
-
-	/*
-	 * The reference for the fences in the new sync_file and held
-	 * in add_fence() during the merge procedure, so for num_fences == 1
-	 * we already own a new reference to the fence. For num_fence > 1
-	 * we own the reference of the fence_array creation.
-	 */
-	if (num_fences == 1) {
-		sync_file->fence = fences[0];
-		kfree(fences);
-	} else {
-		array = fence_array_create(num_fences, fences,
-					   fence_context_alloc(1), 1, false);
-		if (!array)
-			return -ENOMEM;
-
-		sync_file->fence = &array->base;
-
-		/*
-		 * Register for callbacks so that we know when each fence
-		 * in the array is signaled
-		 */
-		fence_enable_sw_signaling(sync_file->fence);
-	}
-
-	return 0;
-}
-
 static struct fence **get_fences(struct sync_file *sync_file, int *num_fences)
 {
 	if (fence_is_array(sync_file->fence)) {
@@ -186,37 +157,44 @@ static void add_fence(struct fence **fences, int *i, struct fence *fence)
 	}
 }
 
-/**
- * sync_file_merge() - merge two sync_files
- * @name:	name of new fence
- * @a:		sync_file a
- * @b:		sync_file b
- *
- * Creates a new sync_file which contains copies of all the fences in both
- * @a and @b.  @a and @b remain valid, independent sync_file. Returns the
- * new merged sync_file or NULL in case of error.
+static bool fences_equal(struct fence **fences, int num_fences,
+			 struct fence **other, int other_num_fences)
+{
+	return num_fences == other_num_fences &&
+	       !memcmp(fences, other, num_fences * sizeof(*fences));
+}
+
+/*
+ * Returns a new reference to a fence that signals once everything in @a
+ * and @b has. When one side adds nothing the other side's fence is reused
+ * as is, and otherwise the merged fences are written straight into a
+ * freshly allocated fence_array.
  */
-static struct sync_file *sync_file_merge(const char *name, struct sync_file *a,
-					 struct sync_file *b)
+static struct fence *sync_file_merge_fences(struct sync_file *a,
+					    struct sync_file *b)
 {
-	struct sync_file *sync_file;
-	struct fence **fences, **nfences, **a_fences, **b_fences;
+	struct fence_array *array;
+	struct fence *fence;
+	struct fence **fences, **a_fences, **b_fences;
 	int i, i_a, i_b, num_fences, a_num_fences, b_num_fences;
 
-	sync_file = sync_file_alloc();
-	if (!sync_file)
-		return NULL;
+	if (a->fence == b->fence || fence_is_signaled(b->fence))
+		return fence_get(a->fence);
+	if (fence_is_signaled(a->fence))
+		return fence_get(b->fence);
 
 	a_fences = get_fences(a, &a_num_fences);
 	b_fences = get_fences(b, &b_num_fences);
 	if (a_num_fences > INT_MAX - b_num_fences)
-		goto err;
+		return NULL;
 
 	num_fences = a_num_fences + b_num_fences;
 
-	fences = kcalloc(num_fences, sizeof(*fences), GFP_KERNEL);
-	if (!fences)
-		goto err;
+	array = fence_array_alloc(num_fences);
+	if (!array)
+		return NULL;
+
+	fences = array->fences;
 
 	/*
 	 * Assume sync_file a and b are both ordered and have no
@@ -257,27 +235,62 @@ static struct sync_file *sync_file_merge(const char *name, struct sync_file *a,
 	if (i == 0)
 		fences[i++] = fence_get(a_fences[0]);
 
-	if (num_fences > i) {
-		nfences = krealloc(fences, i * sizeof(*fences),
-				  GFP_KERNEL);
-		if (!nfences)
-			goto err;
+	/*
+	 * The references taken by add_fence() either move into the
+	 * fence_array or are dropped in favour of a single existing fence.
+	 */
+	if (i == 1) {
+		fence = fences[0];
+	} else if (fences_equal(fences, i, a_fences, a_num_fences)) {
+		fence = fence_get(a->fence);
+	} else if (fences_equal(fences, i, b_fences, b_num_fences)) {
+		fence = fence_get(b->fence);
+	} else {
+		fence_array_init(array, i, fence_context_alloc(1), 1, false);
 
-		fences = nfences;
+		/*
+		 * Register for callbacks so that we know when each fence
+		 * in the array is signaled
+		 */
+		fence_enable_sw_signaling(&array->base);
+		return &array->base;
 	}
 
-	if (sync_file_set_fence(sync_file, fences, i) < 0) {
-		kfree(fences);
-		goto err;
+	if (i > 1)
+		while (i--)
+			fence_put(fences[i]);
+	fence_array_free(array);
+
+	return fence;
+}
+
+/**
+ * sync_file_merge() - merge two sync_files
+ * @name:	name of new fence
+ * @a:		sync_file a
+ * @b:		sync_file b
+ *
+ * Creates a new sync_file which contains copies of all the fences in both
+ * @a and @b.  @a and @b remain valid, independent sync_file. Returns the
+ * new merged sync_file or NULL in case of error.
+ */
+static struct sync_file *sync_file_merge(const char *name, struct sync_file *a,
+					 struct sync_file *b)
+{
+	struct sync_file *sync_file;
+
+	sync_file = sync_file_alloc();
+	if (!sync_file)
+		return NULL;
+
+	sync_file->fence = sync_file_merge_fences(a, b);
+	if (!sync_file->fence) {
+		fput(sync_file->file);
+		return NULL;
 	}
 
 	strlcpy(sync_file->name, name, sizeof(sync_file->name));
 	return sync_file;
-
-err:
-	fput(sync_file->file);
-	return NULL;
-
 }
 
 static void sync_file_free(struct kref *kref)
@@ -299,6 +312,38 @@ static int sync_file_release(struct inode *inode, struct file *file)
 	return 0;
 }
 
+static void sync_file_fence_woken(struct fence *fence, ktime_t now)
+{
+	s64 latency;
+
+	if (!ktime_to_ns(fence->timestamp))
+		return;
+
+	latency = ktime_to_ns(ktime_sub(now, fence->timestamp));
+	trace_fence_woken(fence, latency);
+	sync_timeline_record_wake(fence, latency);
+}
+
+/*
+ * Account the time from each fence signaling to the first poll that saw the
+ * sync_file signaled. Fences that only latch their timestamp when checked
+ * report close to zero here.
+ */
+static void sync_file_woken(struct sync_file *sync_file)
+{
+	ktime_t now = ktime_get();
+	int i;
+
+	if (fence_is_array(sync_file->fence)) {
+		struct fence_array *array = to_fence_array(sync_file->fence);
+
+		for (i = 0; i < array->num_fences; ++i)
+			sync_file_fence_woken(array->fences[i], now);
+	} else {
+		sync_file_fence_woken(sync_file->fence, now);
+	}
+}
+
 static unsigned int sync_file_poll(struct file *file, poll_table *wait)
 {
 	struct sync_file *sync_file = file->private_data;
@@ -312,7 +357,13 @@ static unsigned int sync_file_poll(struct file *file, poll_table *wait)
 			wake_up_all(&sync_file->wq);
 	}
 
-	return fence_is_signaled(sync_file->fence) ? POLLIN : 0;
+	if (!fence_is_signaled(sync_file->fence))
+		return 0;
+
+	if (!test_and_set_bit(POLL_WOKEN, &sync_file->flags))
+		sync_file_woken(sync_file);
+
+	return POLLIN;
 }
 
 static long sync_file_ioctl_merge(struct sync_file *sync_file,
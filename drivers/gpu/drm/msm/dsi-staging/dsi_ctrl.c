@@ -1160,6 +1160,15 @@ static int dsi_message_tx(struct dsi_ctrl *dsi_ctrl,
 
 		cmdbuf = (u8 *)(dsi_ctrl->vaddr);
 
+		if ((dsi_ctrl->cmd_len + length) > dsi_ctrl->cmd_buffer_size) {
+			pr_err("[%s] cmd batch of %d bytes overflows buffer\n",
+					dsi_ctrl->name,
+					dsi_ctrl->cmd_len + length);
+			dsi_ctrl->cmd_len = 0;
+			rc = -ENOSPC;
+			goto error;
+		}
+
 		msm_gem_sync(dsi_ctrl->tx_cmd_buf);
 		for (cnt = 0; cnt < length; cnt++)
 			cmdbuf[dsi_ctrl->cmd_len + cnt] = buffer[cnt];
@@ -56,6 +56,9 @@
  */
 #define DSI_EMBEDDED_MODE_DMA_MAX_SIZE_BYTES 256
 
+/* max size of a batch of packed commands sent in one command DMA */
+#define DSI_CTRL_CMD_BATCH_MAX_BYTES 4096
+
 /* max size supported for dsi cmd transfer using TPG */
 #define DSI_CTRL_MAX_CMD_FIFO_STORE_SIZE 64
 
@@ -1368,6 +1368,65 @@ static ssize_t debugfs_read_esd_check_mode(struct file *file,
 	return len;
 }
 
+static ssize_t debugfs_roi_stats_read(struct file *file,
+				      char __user *user_buf,
+				      size_t user_len,
+				      loff_t *ppos)
+{
+	struct dsi_display *display = file->private_data;
+	struct dsi_display_roi_stats *stats;
+	u64 frames, avg_xfer_us = 0;
+	char *buf;
+	u32 len = 0;
+	int i;
+
+	if (!display)
+		return -ENODEV;
+
+	if (*ppos)
+		return 0;
+
+	buf = kzalloc(SZ_4K, GFP_KERNEL);
+	if (!buf)
+		return -ENOMEM;
+
+	stats = &display->roi_stats;
+	frames = stats->full_frames + stats->partial_frames;
+	if (frames)
+		avg_xfer_us = div64_u64(stats->total_xfer_us, frames);
+
+	len += snprintf(buf + len, (SZ_4K - len),
+			"full_frames = %llu\npartial_frames = %llu\n",
+			stats->full_frames, stats->partial_frames);
+	len += snprintf(buf + len, (SZ_4K - len),
+			"pixels = %llu\nfull_pixels = %llu\n",
+			stats->pixels, stats->full_pixels);
+	len += snprintf(buf + len, (SZ_4K - len),
+			"xfer_us last = %u max = %u avg = %llu\n",
+			stats->last_xfer_us, stats->max_xfer_us, avg_xfer_us);
+
+	for (i = 0; i < display->ctrl_count; i++) {
+		struct dsi_rect *roi = &display->ctrl[i].ctrl->roi;
+
+		len += snprintf(buf + len, (SZ_4K - len),
+				"CTRL_%d roi = (%d,%d,%d,%d)\n",
+				i, roi->x, roi->y, roi->w, roi->h);
+	}
+
+	if (len > user_len)
+		len = user_len;
+
+	if (copy_to_user(user_buf, buf, len)) {
+		kfree(buf);
+		return -EFAULT;
+	}
+
+	*ppos += len;
+
+	kfree(buf);
+	return len;
+}
+
 static const struct file_operations dump_info_fops = {
 	.open = simple_open,
 	.read = debugfs_dump_info_read,
@@ -1379,6 +1438,11 @@ static const struct file_operations misr_data_fops = {
 	.write = debugfs_misr_setup,
 };
 
+static const struct file_operations roi_stats_fops = {
+	.open = simple_open,
+	.read = debugfs_roi_stats_read,
+};
+
 static const struct file_operations esd_trigger_fops = {
 	.open = simple_open,
 	.write = debugfs_esd_trigger_check,
@@ -1417,6 +1481,18 @@ static int dsi_display_debugfs_init(struct dsi_display *display)
 		goto error_remove_dir;
 	}
 
+	dump_file = debugfs_create_file("roi_stats",
+					0400,
+					dir,
+					display,
+					&roi_stats_fops);
+	if (IS_ERR_OR_NULL(dump_file)) {
+		rc = PTR_ERR(dump_file);
+		pr_err("[%s] debugfs create roi stats file failed, rc=%d\n",
+		       display->name, rc);
+		goto error_remove_dir;
+	}
+
 	dump_file = debugfs_create_file("esd_trigger",
 					0644,
 					dir,
@@ -6408,6 +6484,52 @@ int dsi_display_prepare(struct dsi_display *display)
 	return rc;
 }
 
+/*
+ * Grow @roi, in panel coordinates, to the panel's partial update alignment.
+ * A dimension that cannot be aligned inside @bounds falls back to the full
+ * extent of the bounds, which is always a valid update.
+ */
+static void dsi_display_align_roi(struct dsi_rect *roi,
+		const struct dsi_rect *bounds,
+		const struct msm_roi_alignment *align)
+{
+	u32 x1, y1, x2, y2;
+
+	if (!roi->w || !roi->h)
+		return;
+
+	x1 = roi->x;
+	x2 = roi->x + roi->w;
+	if (align->xstart_pix_align)
+		x1 = rounddown(x1, align->xstart_pix_align);
+	if (align->width_pix_align)
+		x2 = x1 + roundup(x2 - x1, align->width_pix_align);
+	if (x2 - x1 < align->min_width)
+		x2 = x1 + align->min_width;
+	if (x1 < bounds->x || x2 > bounds->x + bounds->w) {
+		x1 = bounds->x;
+		x2 = bounds->x + bounds->w;
+	}
+
+	y1 = roi->y;
+	y2 = roi->y + roi->h;
+	if (align->ystart_pix_align)
+		y1 = rounddown(y1, align->ystart_pix_align);
+	if (align->height_pix_align)
+		y2 = y1 + roundup(y2 - y1, align->height_pix_align);
+	if (y2 - y1 < align->min_height)
+		y2 = y1 + align->min_height;
+	if (y1 < bounds->y || y2 > bounds->y + bounds->h) {
+		y1 = bounds->y;
+		y2 = bounds->y + bounds->h;
+	}
+
+	roi->x = x1;
+	roi->y = y1;
+	roi->w = x2 - x1;
+	roi->h = y2 - y1;
+}
+
 static int dsi_display_calc_ctrl_roi(const struct dsi_display *display,
 		const struct dsi_display_ctrl *ctrl,
 		const struct msm_roi_list *req_rois,
@@ -6418,6 +6540,7 @@ static int dsi_display_calc_ctrl_roi(const struct dsi_display *display,
 	struct msm_roi_caps *roi_caps;
 	struct dsi_rect req_roi = { 0 };
 	int rc = 0;
+	int i;
 
 	if (dsi_display_has_ext_bridge(display))
 		return 0;
@@ -6444,12 +6567,23 @@ static int dsi_display_calc_ctrl_roi(const struct dsi_display *display,
 		goto exit;
 	}
 
-	/* intersect with the bounds */
+	/* intersect the bounding box of the requested rois with the bounds */
 	req_roi.x = req_rois->roi[0].x1;
 	req_roi.y = req_rois->roi[0].y1;
 	req_roi.w = req_rois->roi[0].x2 - req_rois->roi[0].x1;
 	req_roi.h = req_rois->roi[0].y2 - req_rois->roi[0].y1;
+	for (i = 1; i < req_rois->num_rects; i++) {
+		const struct drm_clip_rect *r = &req_rois->roi[i];
+		u32 x2 = max_t(u32, req_roi.x + req_roi.w, r->x2);
+		u32 y2 = max_t(u32, req_roi.y + req_roi.h, r->y2);
+
+		req_roi.x = min_t(u32, req_roi.x, r->x1);
+		req_roi.y = min_t(u32, req_roi.y, r->y1);
+		req_roi.w = x2 - req_roi.x;
+		req_roi.h = y2 - req_roi.y;
+	}
 	dsi_rect_intersect(&req_roi, bounds, out_roi);
+	dsi_display_align_roi(out_roi, bounds, &roi_caps->align);
 
 exit:
 	/* adjust the ctrl origin to be top left within the ctrl */
@@ -6464,6 +6598,50 @@ static int dsi_display_calc_ctrl_roi(const struct dsi_display *display,
 	return rc;
 }
 
+/*
+ * Account the region each controller sends this frame. The links transfer
+ * in parallel, so the frame takes as long as the busiest one, at the
+ * mode's per lane bit clock.
+ */
+static void dsi_display_update_roi_stats(struct dsi_display *display,
+		struct dsi_display_mode *cur_mode)
+{
+	struct dsi_display_roi_stats *stats = &display->roi_stats;
+	struct dsi_host_common_cfg *host = &display->panel->host_config;
+	u64 rate, bits, pixels = 0, full_pixels = 0, xfer_us = 0;
+	u32 bpp;
+	int i;
+
+	if (cur_mode->priv_info->dsc_enabled)
+		bpp = cur_mode->priv_info->dsc.bpp;
+	else
+		bpp = dsi_pixel_format_to_bpp(host->dst_format);
+	rate = cur_mode->priv_info->clk_rate_hz * hweight32(host->data_lanes);
+
+	for (i = 0; i < display->ctrl_count; i++) {
+		struct dsi_ctrl *ctrl = display->ctrl[i].ctrl;
+		u64 ctrl_pixels = (u64)ctrl->roi.w * ctrl->roi.h;
+
+		pixels += ctrl_pixels;
+		full_pixels += (u64)ctrl->mode_bounds.w * ctrl->mode_bounds.h;
+
+		if (rate) {
+			bits = ctrl_pixels * bpp * USEC_PER_SEC;
+			xfer_us = max(xfer_us, div64_u64(bits, rate));
+		}
+	}
+
+	if (pixels < full_pixels)
+		stats->partial_frames++;
+	else
+		stats->full_frames++;
+	stats->pixels += pixels;
+	stats->full_pixels += full_pixels;
+	stats->last_xfer_us = xfer_us;
+	stats->max_xfer_us = max_t(u32, stats->max_xfer_us, xfer_us);
+	stats->total_xfer_us += xfer_us;
+}
+
 static int dsi_display_set_roi(struct dsi_display *display,
 		struct msm_roi_list *rois)
 {
@@ -6521,6 +6699,8 @@ static int dsi_display_set_roi(struct dsi_display *display,
 		}
 	}
 
+	dsi_display_update_roi_stats(display, cur_mode);
+
 	return rc;
 }
 
@@ -92,6 +92,26 @@ struct dsi_display_ctrl {
 
 	bool phy_enabled;
 };
+/**
+ * struct dsi_display_roi_stats - partial update accounting
+ * @full_frames:      Kickoffs that sent the whole panel.
+ * @partial_frames:   Kickoffs that sent only a region of interest.
+ * @pixels:           Pixels sent, summed over all kickoffs.
+ * @full_pixels:      Pixels full updates would have sent over all kickoffs.
+ * @last_xfer_us:     Link time of the last kickoff's frame transfer.
+ * @max_xfer_us:      Longest frame transfer seen.
+ * @total_xfer_us:    Link time, summed over all kickoffs.
+ */
+struct dsi_display_roi_stats {
+	u64 full_frames;
+	u64 partial_frames;
+	u64 pixels;
+	u64 full_pixels;
+	u32 last_xfer_us;
+	u32 max_xfer_us;
+	u64 total_xfer_us;
+};
+
 /**
  * struct dsi_display_boot_param - defines DSI boot display selection
  * @name:Name of DSI display selected as a boot param.
@@ -166,6 +186,7 @@ struct dsi_display_clk_info {
  * @misr_enable       Frame MISR enable/disable
  * @misr_frame_count  Number of frames to accumulate the MISR value
  * @esd_trigger       field indicating ESD trigger through debugfs
+ * @roi_stats:        Partial update statistics, exposed in debugfs
  */
 struct dsi_display {
 	struct platform_device *pdev;
@@ -232,6 +253,7 @@ struct dsi_display {
 	bool misr_enable;
 	u32 misr_frame_count;
 	u32 esd_trigger;
+	struct dsi_display_roi_stats roi_stats;
 	/* multiple dsi error handlers */
 	struct workqueue_struct *err_workq;
 	struct work_struct fifo_underflow_work;
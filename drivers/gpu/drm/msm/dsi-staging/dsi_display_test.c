@@ -13,6 +13,7 @@
  */
 
 #include <linux/delay.h>
+#include <linux/ktime.h>
 #include <linux/slab.h>
 
 #include "dsi_display_test.h"
@@ -28,6 +29,7 @@ static void dsi_display_test_work(struct work_struct *work)
 	struct dsi_display *display;
 	struct dsi_display_mode *modes;
 	u32 count = 0;
+	ktime_t start;
 	int rc = 0;
 
 	test = container_of(work, struct dsi_display_test, test_work);
@@ -53,6 +55,8 @@ static void dsi_display_test_work(struct work_struct *work)
 		goto test_fail_free_modes;
 	}
 
+	/* panel on latency covers the power up and the panel on commands */
+	start = ktime_get();
 	rc = dsi_display_prepare(display);
 	if (rc) {
 		pr_err("failed to prepare display, rc=%d\n", rc);
@@ -64,6 +68,10 @@ static void dsi_display_test_work(struct work_struct *work)
 		pr_err("failed to enable display, rc=%d\n", rc);
 		goto test_fail_unprep_disp;
 	}
+
+	test->panel_on_us = ktime_us_delta(ktime_get(), start);
+	pr_info("[%s] panel on took %lld us\n", display->name,
+		test->panel_on_us);
 	return;
 
 test_fail_unprep_disp:
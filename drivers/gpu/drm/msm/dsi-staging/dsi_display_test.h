@@ -23,6 +23,8 @@ struct dsi_display_test {
 	struct dsi_display *display;
 
 	struct work_struct test_work;
+
+	s64 panel_on_us;
 };
 
 int dsi_display_test_init(struct dsi_display *display);
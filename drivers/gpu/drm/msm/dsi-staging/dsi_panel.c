@@ -22,6 +22,7 @@
 
 #include "dsi_panel.h"
 #include "dsi_ctrl_hw.h"
+#include "dsi_ctrl.h"
 
 /**
  * topology is currently defined by a set of following 3 values:
@@ -730,10 +731,44 @@ static int dsi_panel_power_off(struct dsi_panel *panel)
 
 	return rc;
 }
+/* Bytes a command takes in the command DMA buffer once packed */
+static u32 dsi_panel_cmd_packed_len(const struct mipi_dsi_msg *msg)
+{
+	if (!mipi_dsi_packet_format_is_long(msg->type))
+		return 4;
+
+	return 4 + ALIGN(msg->tx_len, 4);
+}
+
+/*
+ * Commands are packed into one command DMA and triggered together. A batch
+ * ends at the end of the set, at a command that needs a delay after it, and
+ * before a command that does not fit the batch or needs non-embedded mode.
+ */
+static bool dsi_panel_cmd_ends_batch(struct dsi_panel *panel,
+		const struct dsi_cmd_desc *cmd, u32 remaining, u32 batch_len)
+{
+	const struct dsi_cmd_desc *next = cmd + 1;
+
+	if (panel->cmd_batch_disable)
+		return cmd->last_command;
+
+	if (!remaining || cmd->post_wait_ms)
+		return true;
+
+	if ((cmd->msg.tx_len + 4) > DSI_EMBEDDED_MODE_DMA_MAX_SIZE_BYTES ||
+	    (next->msg.tx_len + 4) > DSI_EMBEDDED_MODE_DMA_MAX_SIZE_BYTES)
+		return true;
+
+	return (batch_len + dsi_panel_cmd_packed_len(&next->msg)) >
+			DSI_CTRL_CMD_BATCH_MAX_BYTES;
+}
+
 static int dsi_panel_tx_cmd_set(struct dsi_panel *panel,
 				enum dsi_cmd_set_type type)
 {
 	int rc = 0, i = 0;
+	u32 batch_len = 0;
 	ssize_t len;
 	struct dsi_cmd_desc *cmds;
 	u32 count;
@@ -763,8 +798,14 @@ static int dsi_panel_tx_cmd_set(struct dsi_panel *panel,
 		if (state == DSI_CMD_SET_STATE_LP)
 			cmds->msg.flags |= MIPI_DSI_MSG_USE_LPM;
 
-		if (cmds->last_command)
+		batch_len += dsi_panel_cmd_packed_len(&cmds->msg);
+		if (dsi_panel_cmd_ends_batch(panel, cmds, count - i - 1,
+					     batch_len)) {
 			cmds->msg.flags |= MIPI_DSI_MSG_LASTCOMMAND;
+			batch_len = 0;
+		} else {
+			cmds->msg.flags &= ~MIPI_DSI_MSG_LASTCOMMAND;
+		}
 
 		len = ops->transfer(panel->host, &cmds->msg);
 		if (len < 0) {
@@ -2059,6 +2100,9 @@ static int dsi_panel_parse_misc_features(struct dsi_panel *panel,
 
 	panel->lp11_init = of_property_read_bool(of_node,
 			"qcom,mdss-dsi-lp11-init");
+
+	panel->cmd_batch_disable = of_property_read_bool(of_node,
+			"qcom,mdss-dsi-cmd-batch-disable");
 	return 0;
 }
 
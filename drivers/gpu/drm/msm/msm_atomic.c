@@ -33,6 +33,13 @@ struct msm_commit {
 	uint32_t crtc_mask;
 	bool nonblock;
 	struct kthread_work commit_work;
+
+	/* for the commit latency stats, see msm_atomic_commit_account() */
+	ktime_t start;
+	struct drm_crtc *crtc;
+	int thread;
+	bool deadline;
+	u32 target_vblank;
 };
 
 static BLOCKING_NOTIFIER_HEAD(msm_drm_notifier_list);
@@ -536,6 +543,48 @@ static void msm_atomic_helper_commit_modeset_enables(struct drm_device *dev,
 	SDE_ATRACE_END("msm_enable");
 }
 
+/**
+ * msm_atomic_commit_account - account a commit that reached the hw flush
+ * @c: the commit
+ *
+ * A commit that does not change the mode of an active CRTC is expected to
+ * be flushed before the vblank that follows its ioctl, so that it shows up
+ * on the next frame; one that is late is counted as missed.
+ */
+static void msm_atomic_commit_account(struct msm_commit *c)
+{
+	struct msm_drm_private *priv = c->dev->dev_private;
+	struct msm_commit_stats *stats;
+	bool missed = false;
+	u32 us, ms;
+	int bucket;
+
+	if (c->thread < 0)
+		return;
+
+	us = (u32)min_t(s64, ktime_us_delta(ktime_get(), c->start), U32_MAX);
+	if (c->deadline)
+		missed = (s32)(drm_crtc_vblank_count(c->crtc) -
+			       c->target_vblank) >= 0;
+
+	ms = us / USEC_PER_MSEC;
+	bucket = ms < 4 ? 0 : min(ilog2(ms) - 1, MSM_COMMIT_HIST_BUCKETS - 1);
+
+	stats = &priv->commit_stats[c->thread];
+	spin_lock(&priv->commit_stats_lock);
+	stats->commits++;
+	stats->missed += missed;
+	stats->last_us = us;
+	stats->max_us = max(stats->max_us, us);
+	stats->total_us += us;
+	stats->hist[bucket]++;
+	spin_unlock(&priv->commit_stats_lock);
+
+	if (missed)
+		DRM_DEBUG_ATOMIC("crtc%d commit missed vblank %u, %u us\n",
+				c->crtc->base.id, c->target_vblank, us);
+}
+
 /* The (potentially) asynchronous part of the commit.  At this point
  * nothing can fail short of armageddon.
  */
@@ -556,6 +605,8 @@ static void complete_commit(struct msm_commit *c)
 
 	msm_atomic_helper_commit_modeset_enables(dev, state);
 
+	msm_atomic_commit_account(c);
+
 	/* NOTE: _wait_for_vblanks() only waits for vblank on
 	 * enabled CRTCs.  So we end up faulting when disabling
 	 * due to (potentially) unref'ing the outgoing fb's
@@ -607,6 +658,7 @@ static struct msm_commit *commit_init(struct drm_atomic_state *state,
 	c->dev = state->dev;
 	c->state = state;
 	c->nonblock = nonblock;
+	c->thread = -1;
 
 	kthread_init_work(&c->commit_work, _msm_drm_commit_work_cb);
 
@@ -631,6 +683,7 @@ static void msm_atomic_commit_dispatch(struct drm_device *dev,
 			if (priv->disp_thread[j].crtc_id ==
 						crtc->base.id) {
 				if (priv->disp_thread[j].thread) {
+					commit->thread = j;
 					kthread_queue_work(
 						&priv->disp_thread[j].worker,
 							&commit->commit_work);
@@ -694,6 +747,7 @@ int msm_atomic_commit(struct drm_device *dev,
 	struct drm_crtc_state *crtc_state;
 	struct drm_plane *plane;
 	struct drm_plane_state *plane_state;
+	ktime_t start = ktime_get();
 	int i, ret;
 
 	if (!priv || priv->shutdown_in_progress) {
@@ -715,10 +769,19 @@ int msm_atomic_commit(struct drm_device *dev,
 	}
 
 	/*
-	 * Figure out what crtcs we have:
+	 * Figure out what crtcs we have, and the vblank the first one, which
+	 * the commit is dispatched to, should make:
 	 */
-	for_each_crtc_in_state(state, crtc, crtc_state, i)
+	c->start = start;
+	for_each_crtc_in_state(state, crtc, crtc_state, i) {
 		c->crtc_mask |= drm_crtc_mask(crtc);
+		if (c->crtc)
+			continue;
+		c->crtc = crtc;
+		c->deadline = crtc_state->active &&
+			!drm_atomic_crtc_needs_modeset(crtc_state);
+		c->target_vblank = drm_crtc_vblank_count(crtc) + 1;
+	}
 
 	/*
 	 * Figure out what fence to wait for:
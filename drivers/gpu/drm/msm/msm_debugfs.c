@@ -18,6 +18,7 @@
 #ifdef CONFIG_DEBUG_FS
 #include "msm_drv.h"
 #include "msm_gpu.h"
+#include "msm_mmu.h"
 
 static int msm_gpu_show(struct drm_device *dev, struct seq_file *m)
 {
@@ -48,6 +49,81 @@ static int msm_gem_show(struct drm_device *dev, struct seq_file *m)
 	return 0;
 }
 
+static int msm_shrinker_show(struct drm_device *dev, struct seq_file *m)
+{
+	struct msm_drm_private *priv = dev->dev_private;
+
+	seq_printf(m, "scans:         %lu\n", priv->shrinker_stats.scans);
+	seq_printf(m, "purged objs:   %lu\n", priv->shrinker_stats.purged_objs);
+	seq_printf(m, "purged pages:  %lu\n", priv->shrinker_stats.purged_pages);
+	seq_printf(m, "evicted objs:  %lu\n", priv->shrinker_stats.evicted_objs);
+	seq_printf(m, "evicted pages: %lu\n",
+			priv->shrinker_stats.evicted_pages);
+	seq_printf(m, "vunmapped:     %lu\n", priv->shrinker_stats.vunmapped);
+
+	return 0;
+}
+
+static int msm_mmu_show(struct drm_device *dev, struct seq_file *m)
+{
+	struct msm_drm_private *priv = dev->dev_private;
+	struct msm_gpu *gpu = priv->gpu;
+	struct msm_mmu *mmu;
+	unsigned int i;
+
+	if (gpu && gpu->aspace && gpu->aspace->mmu->funcs->show) {
+		seq_printf(m, "%s:\n", gpu->aspace->name);
+		gpu->aspace->mmu->funcs->show(gpu->aspace->mmu, m);
+	}
+
+	for (i = 0; i < priv->num_aspaces; i++) {
+		if (!priv->aspace[i])
+			continue;
+		mmu = priv->aspace[i]->mmu;
+		if (mmu->funcs->show) {
+			seq_printf(m, "%s:\n", priv->aspace[i]->name);
+			mmu->funcs->show(mmu, m);
+		}
+	}
+
+	return 0;
+}
+
+static int msm_fence_latency_show(struct drm_device *dev, struct seq_file *m)
+{
+	struct msm_drm_private *priv = dev->dev_private;
+	struct msm_gpu *gpu = priv->gpu;
+
+	if (gpu)
+		msm_fence_show(gpu->fctx, m);
+
+	return 0;
+}
+
+static int msm_commit_latency_show(struct drm_device *dev, struct seq_file *m)
+{
+	struct msm_drm_private *priv = dev->dev_private;
+	struct msm_commit_stats stats;
+	unsigned int i;
+
+	seq_puts(m, "crtc commits missed last_us max_us avg_us <4ms <8ms <16ms <32ms >=32ms\n");
+	for (i = 0; i < priv->num_crtcs; i++) {
+		spin_lock(&priv->commit_stats_lock);
+		stats = priv->commit_stats[i];
+		spin_unlock(&priv->commit_stats_lock);
+
+		seq_printf(m, "%u %llu %llu %u %u %llu %llu %llu %llu %llu %llu\n",
+			   priv->disp_thread[i].crtc_id, stats.commits,
+			   stats.missed, stats.last_us, stats.max_us,
+			   stats.commits ?
+			   div64_u64(stats.total_us, stats.commits) : 0,
+			   stats.hist[0], stats.hist[1], stats.hist[2],
+			   stats.hist[3], stats.hist[4]);
+	}
+
+	return 0;
+}
+
 static int msm_mm_show(struct drm_device *dev, struct seq_file *m)
 {
 	return drm_mm_dump_table(m, &dev->vma_offset_manager->vm_addr_space_mm);
@@ -99,6 +175,10 @@ static int show_locked(struct seq_file *m, void *arg)
 static struct drm_info_list msm_debugfs_list[] = {
 		{"gpu", show_locked, 0, msm_gpu_show},
 		{"gem", show_locked, 0, msm_gem_show},
+		{"shrinker", show_locked, 0, msm_shrinker_show},
+		{"mmu", show_locked, 0, msm_mmu_show},
+		{"fence_latency", show_locked, 0, msm_fence_latency_show},
+		{"commit_latency", show_locked, 0, msm_commit_latency_show},
 		{ "mm", show_locked, 0, msm_mm_show },
 		{ "fb", show_locked, 0, msm_fb_show },
 };
@@ -735,6 +735,7 @@ static int msm_drm_init(struct device *dev, struct drm_driver *drv)
 	 * other real time and normal priority task
 	 */
 	param.sched_priority = 16;
+	spin_lock_init(&priv->commit_stats_lock);
 	for (i = 0; i < priv->num_crtcs; i++) {
 
 		/* initialize display thread */
@@ -745,15 +746,15 @@ static int msm_drm_init(struct device *dev, struct drm_driver *drv)
 			kthread_run(kthread_worker_fn,
 				&priv->disp_thread[i].worker,
 				"crtc_commit:%d", priv->disp_thread[i].crtc_id);
-		ret = sched_setscheduler(priv->disp_thread[i].thread,
-							SCHED_FIFO, &param);
-		if (ret)
-			pr_warn("display thread priority update failed: %d\n",
-									ret);
-
 		if (IS_ERR(priv->disp_thread[i].thread)) {
 			dev_err(dev, "failed to create crtc_commit kthread\n");
 			priv->disp_thread[i].thread = NULL;
+		} else {
+			ret = sched_setscheduler(priv->disp_thread[i].thread,
+							SCHED_FIFO, &param);
+			if (ret)
+				pr_warn("display thread priority update failed: %d\n",
+									ret);
 		}
 
 		/* initialize event thread */
@@ -771,15 +772,15 @@ static int msm_drm_init(struct device *dev, struct drm_driver *drv)
 		 * frame_pending counters beyond 2. This can lead to commit
 		 * failure at crtc commit level.
 		 */
-		ret = sched_setscheduler(priv->event_thread[i].thread,
-							SCHED_FIFO, &param);
-		if (ret)
-			pr_warn("display event thread priority update failed: %d\n",
-									ret);
-
 		if (IS_ERR(priv->event_thread[i].thread)) {
 			dev_err(dev, "failed to create crtc_event kthread\n");
 			priv->event_thread[i].thread = NULL;
+		} else {
+			ret = sched_setscheduler(priv->event_thread[i].thread,
+							SCHED_FIFO, &param);
+			if (ret)
+				pr_warn("display event thread priority update failed: %d\n",
+									ret);
 		}
 
 		if ((!priv->disp_thread[i].thread) ||
@@ -934,6 +935,7 @@ static void load_gpu(struct drm_device *dev)
 
 static int msm_open(struct drm_device *dev, struct drm_file *file)
 {
+	static atomic_t next_ctx_id = ATOMIC_INIT(0);
 	struct msm_file_private *ctx;
 
 	/* For now, load gpu on open.. to avoid the requirement of having
@@ -945,6 +947,7 @@ static int msm_open(struct drm_device *dev, struct drm_file *file)
 	if (!ctx)
 		return -ENOMEM;
 
+	ctx->id = atomic_inc_return(&next_ctx_id);
 	file->driver_priv = ctx;
 
 	if (dev && dev->dev_private) {
@@ -979,6 +982,7 @@ static void msm_postclose(struct drm_device *dev, struct drm_file *file)
 	mutex_lock(&dev->struct_mutex);
 	if (ctx == priv->lastctx)
 		priv->lastctx = NULL;
+	msm_gem_submit_bo_cache_fini(ctx);
 	mutex_unlock(&dev->struct_mutex);
 
 	kfree(ctx);
@@ -1736,6 +1740,7 @@ static struct drm_driver msm_driver = {
 	.enable_vblank      = msm_enable_vblank,
 	.disable_vblank     = msm_disable_vblank,
 	.gem_free_object    = msm_gem_free_object,
+	.gem_close_object   = msm_gem_close_object,
 	.gem_vm_ops         = &vm_ops,
 	.dumb_create        = msm_gem_dumb_create,
 	.dumb_map_offset    = msm_gem_dumb_map_offset,
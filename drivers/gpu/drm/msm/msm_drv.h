@@ -74,12 +74,34 @@ struct msm_gem_vma;
 
 #define TEARDOWN_DEADLOCK_RETRY_MAX 5
 
+/* The bo list of the last submit on a file, with the iova's they were
+ * pinned at.  A submit naming the same handles, with no handle closed and
+ * no iova torn down in between, can reuse it instead of looking up and
+ * pinning each bo again.  Protected by struct_mutex.
+ */
+struct msm_submit_bo_cache {
+	uint32_t nr_bos;
+	uint32_t size;
+	unsigned int handle_gen;
+	unsigned int iova_gen;
+	uint32_t *handles;
+	struct msm_gem_object **objs;
+	uint32_t *iovas;
+};
+
 struct msm_file_private {
 	/* currently we don't do anything useful with this.. but when
 	 * per-context address spaces are supported we'd keep track of
 	 * the context's page-tables here.
 	 */
 	int dummy;
+
+	/* id to tag this context's submits with in perf samples: */
+	uint32_t id;
+
+	/* bumped whenever one of the file's gem handles is closed: */
+	atomic_t handle_gen;
+	struct msm_submit_bo_cache bo_cache;
 };
 
 enum msm_mdp_plane_property {
@@ -506,6 +528,9 @@ struct msm_drm_event {
 	u8 data[];
 };
 
+/* Commit latency histogram: < 4, 8, 16, 32 ms and above */
+#define MSM_COMMIT_HIST_BUCKETS	5
+
 /* Commit/Event thread specific structure */
 struct msm_drm_thread {
 	struct drm_device *dev;
@@ -514,6 +539,24 @@ struct msm_drm_thread {
 	struct kthread_worker worker;
 };
 
+/**
+ * struct msm_commit_stats - latency of the commits run on a crtc_commit thread
+ * @commits: number of commits that reached the hardware flush
+ * @missed: commits flushed after the vblank following their ioctl
+ * @last_us: ioctl to flush time of the last commit
+ * @max_us: largest ioctl to flush time seen
+ * @total_us: sum of the ioctl to flush times, for the average
+ * @hist: commits by ioctl to flush time, see MSM_COMMIT_HIST_BUCKETS
+ */
+struct msm_commit_stats {
+	u64 commits;
+	u64 missed;
+	u32 last_us;
+	u32 max_us;
+	u64 total_us;
+	u64 hist[MSM_COMMIT_HIST_BUCKETS];
+};
+
 struct msm_idle {
 	u32 timeout_ms;
 	u32 encoder_mask;
@@ -586,6 +629,8 @@ struct msm_drm_private {
 
 	struct msm_drm_thread disp_thread[MAX_CRTCS];
 	struct msm_drm_thread event_thread[MAX_CRTCS];
+	struct msm_commit_stats commit_stats[MAX_CRTCS];
+	spinlock_t commit_stats_lock;
 
 	struct task_struct *pp_event_thread;
 	struct kthread_worker pp_event_worker;
@@ -620,6 +665,19 @@ struct msm_drm_private {
 	struct notifier_block vmap_notifier;
 	struct shrinker shrinker;
 
+	/* bumped, under struct_mutex, whenever a bo loses an iova: */
+	unsigned int iova_gen;
+
+	/* reclaim statistics, protected by struct_mutex: */
+	struct {
+		unsigned long scans;
+		unsigned long purged_objs;
+		unsigned long purged_pages;
+		unsigned long evicted_objs;
+		unsigned long evicted_pages;
+		unsigned long vunmapped;
+	} shrinker_stats;
+
 	/* task holding struct_mutex.. currently only used in submit path
 	 * to detect and reject faults from copy_from_user() for submit
 	 * ioctl.
@@ -775,6 +833,7 @@ void msm_gem_put_vaddr_locked(struct drm_gem_object *obj);
 void msm_gem_put_vaddr(struct drm_gem_object *obj);
 int msm_gem_madvise(struct drm_gem_object *obj, unsigned madv);
 void msm_gem_purge(struct drm_gem_object *obj);
+void msm_gem_evict(struct drm_gem_object *obj);
 void msm_gem_vunmap(struct drm_gem_object *obj);
 int msm_gem_sync_object(struct drm_gem_object *obj,
 		struct msm_fence_context *fctx, bool exclusive);
@@ -784,6 +843,8 @@ void msm_gem_move_to_inactive(struct drm_gem_object *obj);
 int msm_gem_cpu_prep(struct drm_gem_object *obj, uint32_t op, ktime_t *timeout);
 int msm_gem_cpu_fini(struct drm_gem_object *obj);
 void msm_gem_free_object(struct drm_gem_object *obj);
+void msm_gem_close_object(struct drm_gem_object *obj, struct drm_file *file);
+void msm_gem_submit_bo_cache_fini(struct msm_file_private *ctx);
 int msm_gem_new_handle(struct drm_device *dev, struct drm_file *file,
 		uint32_t size, uint32_t flags, uint32_t *handle);
 struct drm_gem_object *msm_gem_new(struct drm_device *dev,
@@ -19,6 +19,7 @@
 
 #include "msm_drv.h"
 #include "msm_fence.h"
+#include "msm_gpu_trace.h"
 
 
 struct msm_fence_context *
@@ -49,6 +50,33 @@ static inline bool fence_completed(struct msm_fence_context *fctx, uint32_t fenc
 	return (int32_t)(fctx->completed_fence - fence) >= 0;
 }
 
+static int msm_fence_hist_bucket(s64 latency_ns)
+{
+	s64 us = div_s64(latency_ns, NSEC_PER_USEC);
+
+	if (us <= 0)
+		return 0;
+
+	return min_t(int, ilog2(us) + 1, MSM_FENCE_HIST_BUCKETS - 1);
+}
+
+/*
+ * A waiter that actually slept ran this long after the completion that
+ * woke it. Fences retired together share one completion time.
+ */
+static void msm_fence_woken(struct msm_fence_context *fctx, uint32_t fence)
+{
+	unsigned long flags;
+	s64 latency;
+
+	spin_lock_irqsave(&fctx->spinlock, flags);
+	latency = ktime_to_ns(ktime_sub(ktime_get(), fctx->completed_time));
+	fctx->wake_hist[msm_fence_hist_bucket(latency)]++;
+	spin_unlock_irqrestore(&fctx->spinlock, flags);
+
+	trace_msm_fence_woken(fctx->context, fence, latency);
+}
+
 /* legacy path for WAIT_FENCE ioctl: */
 int msm_wait_fence(struct msm_fence_context *fctx, uint32_t fence,
 		ktime_t *timeout, bool interruptible)
@@ -66,6 +94,7 @@ int msm_wait_fence(struct msm_fence_context *fctx, uint32_t fence,
 		ret = fence_completed(fctx, fence) ? 0 : -EBUSY;
 	} else {
 		unsigned long remaining_jiffies = timeout_to_jiffies(timeout);
+		bool completed = fence_completed(fctx, fence);
 
 		if (interruptible)
 			ret = wait_event_interruptible_timeout(fctx->event,
@@ -81,6 +110,8 @@ int msm_wait_fence(struct msm_fence_context *fctx, uint32_t fence,
 					fence, fctx->completed_fence);
 			ret = -ETIMEDOUT;
 		} else if (ret != -ERESTARTSYS) {
+			if (!completed)
+				msm_fence_woken(fctx, fence);
 			ret = 0;
 		}
 	}
@@ -92,12 +123,33 @@ int msm_wait_fence(struct msm_fence_context *fctx, uint32_t fence,
 void msm_update_fence(struct msm_fence_context *fctx, uint32_t fence)
 {
 	spin_lock(&fctx->spinlock);
-	fctx->completed_fence = max(fence, fctx->completed_fence);
+	if (fence > fctx->completed_fence) {
+		fctx->completed_time = ktime_get();
+		fctx->completed_fence = fence;
+		trace_msm_fence_signaled(fctx->context, fence);
+	}
 	spin_unlock(&fctx->spinlock);
 
 	wake_up_all(&fctx->event);
 }
 
+/* Bucket 0 is under 1us, bucket n covers [2^(n-1), 2^n) us */
+void msm_fence_show(struct msm_fence_context *fctx, struct seq_file *m)
+{
+	uint32_t hist[MSM_FENCE_HIST_BUCKETS];
+	int i;
+
+	spin_lock_irq(&fctx->spinlock);
+	memcpy(hist, fctx->wake_hist, sizeof(hist));
+	spin_unlock_irq(&fctx->spinlock);
+
+	seq_printf(m, "%s: last %u, completed %u\n", fctx->name,
+			fctx->last_fence, fctx->completed_fence);
+	for (i = 0; i < MSM_FENCE_HIST_BUCKETS - 1; i++)
+		seq_printf(m, "  <%6luus: %u\n", 1UL << i, hist[i]);
+	seq_printf(m, "  >=%5luus: %u\n", 1UL << (i - 1), hist[i]);
+}
+
 struct msm_fence {
 	struct msm_fence_context *fctx;
 	struct fence base;
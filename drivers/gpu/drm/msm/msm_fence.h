@@ -20,6 +20,8 @@
 
 #include "msm_drv.h"
 
+#define MSM_FENCE_HIST_BUCKETS	16
+
 struct msm_fence_context {
 	struct drm_device *dev;
 	const char *name;
@@ -29,6 +31,10 @@ struct msm_fence_context {
 	uint32_t completed_fence;     /* last completed fence */
 	wait_queue_head_t event;
 	spinlock_t spinlock;
+	/* when completed_fence last advanced, protected by spinlock */
+	ktime_t completed_time;
+	/* WAIT_FENCE signal to wake latency, log2(us) buckets */
+	uint32_t wake_hist[MSM_FENCE_HIST_BUCKETS];
 };
 
 struct msm_fence_context * msm_fence_context_alloc(struct drm_device *dev,
@@ -40,6 +46,7 @@ int msm_wait_fence(struct msm_fence_context *fctx, uint32_t fence,
 int msm_queue_fence_cb(struct msm_fence_context *fctx,
 		struct msm_fence_cb *cb, uint32_t fence);
 void msm_update_fence(struct msm_fence_context *fctx, uint32_t fence);
+void msm_fence_show(struct msm_fence_context *fctx, struct seq_file *m);
 
 struct fence * msm_fence_alloc(struct msm_fence_context *fctx);
 
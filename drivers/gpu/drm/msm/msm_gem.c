@@ -361,11 +361,15 @@ static void obj_remove_domain(struct msm_gem_vma *domain)
 static void put_iova(struct drm_gem_object *obj)
 {
 	struct drm_device *dev = obj->dev;
+	struct msm_drm_private *priv = dev->dev_private;
 	struct msm_gem_object *msm_obj = to_msm_bo(obj);
 	struct msm_gem_vma *domain, *tmp;
 
 	WARN_ON(!mutex_is_locked(&dev->struct_mutex));
 
+	if (!list_empty(&msm_obj->domains))
+		priv->iova_gen++;
+
 	list_for_each_entry_safe(domain, tmp, &msm_obj->domains, list) {
 		if (iommu_present(&platform_bus_type)) {
 			msm_gem_unmap_vma(domain->aspace, domain,
@@ -686,6 +690,26 @@ void msm_gem_purge(struct drm_gem_object *obj)
 			0, (loff_t)-1);
 }
 
+/* Drop the mappings and pages of an idle bo, but unlike purge keep the
+ * contents: the pages are released dirty to shmem, which can then swap
+ * them out.  The next get_iova/get_pages/fault brings them back in.
+ */
+void msm_gem_evict(struct drm_gem_object *obj)
+{
+	struct drm_device *dev = obj->dev;
+	struct msm_gem_object *msm_obj = to_msm_bo(obj);
+
+	WARN_ON(!mutex_is_locked(&dev->struct_mutex));
+	WARN_ON(!is_evictable(msm_obj));
+
+	put_iova(obj);
+	msm_gem_remove_obj_from_aspace_active_list(msm_obj->aspace, obj);
+
+	drm_vma_node_unmap(&obj->vma_node, dev->anon_inode->i_mapping);
+
+	put_pages(obj);
+}
+
 void msm_gem_vunmap(struct drm_gem_object *obj)
 {
 	struct msm_gem_object *msm_obj = to_msm_bo(obj);
@@ -771,6 +795,7 @@ void msm_gem_move_to_inactive(struct drm_gem_object *obj)
 	WARN_ON(!mutex_is_locked(&dev->struct_mutex));
 
 	msm_obj->gpu = NULL;
+	msm_obj->inactive_since = jiffies;
 	list_del_init(&msm_obj->mm_list);
 	list_add_tail(&msm_obj->mm_list, &priv->inactive_list);
 }
@@ -884,6 +909,17 @@ void msm_gem_describe_objects(struct list_head *list, struct seq_file *m)
 }
 #endif
 
+/* A closed handle may be handed out again for a different bo, so any
+ * submit bo list cached on the file can no longer be trusted:
+ */
+void msm_gem_close_object(struct drm_gem_object *obj, struct drm_file *file)
+{
+	struct msm_file_private *ctx = file->driver_priv;
+
+	if (ctx)
+		atomic_inc(&ctx->handle_gen);
+}
+
 void msm_gem_free_object(struct drm_gem_object *obj)
 {
 	struct drm_device *dev = obj->dev;
@@ -1008,6 +1044,7 @@ static int msm_gem_new_impl(struct drm_device *dev,
 	msm_obj->aspace = NULL;
 	msm_obj->in_active_list = false;
 
+	msm_obj->inactive_since = jiffies;
 	list_add_tail(&msm_obj->mm_list, &priv->inactive_list);
 
 	*obj = &msm_obj->base;
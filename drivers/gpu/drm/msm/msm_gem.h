@@ -100,6 +100,12 @@ struct msm_gem_object {
 	struct list_head mm_list;
 	struct msm_gpu *gpu;     /* non-null if active */
 
+	/* jiffies when the object last went (or was created) inactive.
+	 * priv->inactive_list is kept in this order, oldest first, which
+	 * lets the shrinker age objects without sorting.
+	 */
+	unsigned long inactive_since;
+
 	/* Transiently in the process of submit ioctl, objects associated
 	 * with the submit are on submit->bo_list.. this only lasts for
 	 * the duration of the ioctl, so one bo can never be on multiple
@@ -144,6 +150,23 @@ static inline bool is_vunmapable(struct msm_gem_object *msm_obj)
 	return (msm_obj->vmap_count == 0) && msm_obj->vaddr;
 }
 
+/* Idle shmem backed userspace bo's whose pages can go back to shmem (and
+ * from there to swap), to be faulted back in on next use.  Anything the
+ * kernel holds a vmap of, that is shared with another device, that may be
+ * scanned out, or that is part of a submit in progress is left alone since
+ * iova's are not refcounted yet.
+ */
+static inline bool is_evictable(struct msm_gem_object *msm_obj)
+{
+	return (msm_obj->madv == MSM_MADV_WILLNEED) && msm_obj->pages &&
+			!msm_obj->vram_node && !is_active(msm_obj) &&
+			list_empty(&msm_obj->submit_entry) &&
+			!msm_obj->vaddr && !msm_obj->base.dma_buf &&
+			!msm_obj->base.import_attach &&
+			msm_obj->base.handle_count &&
+			!(msm_obj->flags & MSM_BO_SCANOUT);
+}
+
 /* Created per submit-ioctl, to track bo's and cmdstream bufs, etc,
  * associated with the cmdstream submission for synchronization (and
  * make it easier to unwind when things go wrong, etc).  This only
@@ -158,6 +181,7 @@ struct msm_gem_submit {
 	struct fence *fence;
 	struct pid *pid;    /* submitting process */
 	bool valid;         /* true if no cmdstream patching needed */
+	bool bo_cached;     /* bos[] came from the file's bo cache */
 	unsigned int nr_cmds;
 	unsigned int nr_bos;
 	struct {
@@ -17,6 +17,7 @@
 
 #include "msm_drv.h"
 #include "msm_gem.h"
+#include "msm_gpu.h"
 
 static bool mutex_is_locked_by(struct mutex *mutex, struct task_struct *task)
 {
@@ -45,6 +46,45 @@ static bool msm_gem_shrinker_lock(struct drm_device *dev, bool *unlock)
 }
 
 
+/* DONTNEED bo's idle for less than this are likely to be reused from the
+ * userspace bo cache, so they are only purged once older ones are gone:
+ */
+static unsigned int purge_age_ms = 100;
+MODULE_PARM_DESC(purge_age_ms, "Min idle time before a purgeable bo is preferred for purging");
+module_param(purge_age_ms, uint, 0600);
+
+/* Idle non-purgeable bo's are only evicted to shmem after this long, so a
+ * background app gives memory back without thrashing the foreground one:
+ */
+static unsigned int evict_age_ms = 2000;
+MODULE_PARM_DESC(evict_age_ms, "Min idle time before a bo is evicted to swap (0 to disable)");
+module_param(evict_age_ms, uint, 0600);
+
+static bool is_aged(struct msm_gem_object *msm_obj, unsigned int age_ms)
+{
+	return time_after_eq(jiffies, msm_obj->inactive_since +
+			msecs_to_jiffies(age_ms));
+}
+
+/* The gpu re-pins (and reloc's) every bo on each submit, so only gpu
+ * mappings can be torn down behind userspace's back:
+ */
+static bool can_evict(struct msm_drm_private *priv,
+		struct msm_gem_object *msm_obj)
+{
+	struct msm_gem_vma *domain;
+
+	if (!evict_age_ms || !is_evictable(msm_obj))
+		return false;
+
+	list_for_each_entry(domain, &msm_obj->domains, list) {
+		if (!priv->gpu || domain->aspace != priv->gpu->aspace)
+			return false;
+	}
+
+	return true;
+}
+
 static unsigned long
 msm_gem_shrinker_count(struct shrinker *shrinker, struct shrink_control *sc)
 {
@@ -53,13 +93,16 @@ msm_gem_shrinker_count(struct shrinker *shrinker, struct shrink_control *sc)
 	struct drm_device *dev = priv->dev;
 	struct msm_gem_object *msm_obj;
 	unsigned long count = 0;
+	bool evict = sc->gfp_mask & __GFP_IO;
 	bool unlock;
 
 	if (!msm_gem_shrinker_lock(dev, &unlock))
 		return 0;
 
 	list_for_each_entry(msm_obj, &priv->inactive_list, mm_list) {
-		if (is_purgeable(msm_obj))
+		if (is_purgeable(msm_obj) || (evict &&
+				can_evict(priv, msm_obj) &&
+				is_aged(msm_obj, evict_age_ms)))
 			count += msm_obj->base.size >> PAGE_SHIFT;
 	}
 
@@ -69,26 +112,83 @@ msm_gem_shrinker_count(struct shrinker *shrinker, struct shrink_control *sc)
 	return count;
 }
 
+enum msm_shrink_pass {
+	SHRINK_PURGE_AGED,
+	SHRINK_PURGE_ALL,
+	SHRINK_EVICT_AGED,
+	SHRINK_PASSES,
+};
+
+/* Walk the inactive list oldest first.  Since the list is in LRU order,
+ * an aged pass can stop at the first bo that is too young.
+ */
+static unsigned long
+msm_gem_shrink_pass(struct msm_drm_private *priv, enum msm_shrink_pass pass,
+		unsigned long nr_to_scan)
+{
+	struct msm_gem_object *msm_obj;
+	unsigned long freed = 0, pages;
+
+	list_for_each_entry(msm_obj, &priv->inactive_list, mm_list) {
+		if (freed >= nr_to_scan)
+			break;
+
+		pages = msm_obj->base.size >> PAGE_SHIFT;
+
+		switch (pass) {
+		case SHRINK_PURGE_AGED:
+			if (!is_aged(msm_obj, purge_age_ms))
+				return freed;
+			/* fallthrough */
+		case SHRINK_PURGE_ALL:
+			if (!is_purgeable(msm_obj))
+				break;
+			msm_gem_purge(&msm_obj->base);
+			priv->shrinker_stats.purged_objs++;
+			priv->shrinker_stats.purged_pages += pages;
+			freed += pages;
+			break;
+		case SHRINK_EVICT_AGED:
+			if (!is_aged(msm_obj, evict_age_ms))
+				return freed;
+			if (!can_evict(priv, msm_obj))
+				break;
+			msm_gem_evict(&msm_obj->base);
+			priv->shrinker_stats.evicted_objs++;
+			priv->shrinker_stats.evicted_pages += pages;
+			freed += pages;
+			break;
+		default:
+			break;
+		}
+	}
+
+	return freed;
+}
+
 static unsigned long
 msm_gem_shrinker_scan(struct shrinker *shrinker, struct shrink_control *sc)
 {
 	struct msm_drm_private *priv =
 		container_of(shrinker, struct msm_drm_private, shrinker);
 	struct drm_device *dev = priv->dev;
-	struct msm_gem_object *msm_obj;
 	unsigned long freed = 0;
+	enum msm_shrink_pass pass;
 	bool unlock;
 
 	if (!msm_gem_shrinker_lock(dev, &unlock))
 		return SHRINK_STOP;
 
-	list_for_each_entry(msm_obj, &priv->inactive_list, mm_list) {
+	priv->shrinker_stats.scans++;
+
+	for (pass = SHRINK_PURGE_AGED; pass < SHRINK_PASSES; pass++) {
 		if (freed >= sc->nr_to_scan)
 			break;
-		if (is_purgeable(msm_obj)) {
-			msm_gem_purge(&msm_obj->base);
-			freed += msm_obj->base.size >> PAGE_SHIFT;
-		}
+		/* evicted pages need to be written out to swap */
+		if (pass == SHRINK_EVICT_AGED && !(sc->gfp_mask & __GFP_IO))
+			break;
+		freed += msm_gem_shrink_pass(priv, pass,
+				sc->nr_to_scan - freed);
 	}
 
 	if (unlock)
@@ -125,6 +225,8 @@ msm_gem_shrinker_vmap(struct notifier_block *nb, unsigned long event, void *ptr)
 		}
 	}
 
+	priv->shrinker_stats.vunmapped += unmapped;
+
 	if (unlock)
 		mutex_unlock(&dev->struct_mutex);
 
@@ -20,6 +20,7 @@
 #include "msm_drv.h"
 #include "msm_gpu.h"
 #include "msm_gem.h"
+#include "msm_gpu_trace.h"
 
 /*
  * Cmdstream submission:
@@ -30,6 +31,9 @@
 #define BO_LOCKED   0x4000
 #define BO_PINNED   0x2000
 
+/* larger bo lists are looked up every time rather than cached: */
+#define BO_CACHE_MAX 512
+
 static struct msm_gem_submit *submit_create(struct drm_device *dev,
 		struct msm_gpu *gpu, uint32_t nr_bos, uint32_t nr_cmds)
 {
@@ -49,6 +53,8 @@ static struct msm_gem_submit *submit_create(struct drm_device *dev,
 	submit->fence = NULL;
 	submit->pid = get_pid(task_pid(current));
 	submit->cmd = (void *)&submit->bos[nr_bos];
+	submit->bo_cached = false;
+	submit->valid = false;
 
 	/* initially, until copy_from_user() and bo lookup succeeds: */
 	submit->nr_bos = 0;
@@ -77,8 +83,136 @@ copy_from_user_inatomic(void *to, const void __user *from, unsigned long n)
 	return -EFAULT;
 }
 
+static void submit_bo_cache_drop(struct msm_submit_bo_cache *cache)
+{
+	uint32_t i;
+
+	for (i = 0; i < cache->nr_bos; i++)
+		drm_gem_object_unreference(&cache->objs[i]->base);
+
+	cache->nr_bos = 0;
+}
+
+void msm_gem_submit_bo_cache_fini(struct msm_file_private *ctx)
+{
+	struct msm_submit_bo_cache *cache = &ctx->bo_cache;
+
+	submit_bo_cache_drop(cache);
+	kfree(cache->handles);
+	kfree(cache->objs);
+	kfree(cache->iovas);
+	cache->size = 0;
+}
+
+/* Empty the cache and make room for @nr_bos entries; returns where the
+ * handles should be recorded, or NULL if this list won't be cached.
+ */
+static uint32_t *submit_bo_cache_reserve(struct msm_submit_bo_cache *cache,
+		uint32_t nr_bos)
+{
+	submit_bo_cache_drop(cache);
+
+	if (!nr_bos || nr_bos > BO_CACHE_MAX)
+		return NULL;
+
+	if (nr_bos > cache->size) {
+		kfree(cache->handles);
+		kfree(cache->objs);
+		kfree(cache->iovas);
+		cache->size = 0;
+
+		cache->handles = kmalloc_array(nr_bos,
+				sizeof(*cache->handles), GFP_KERNEL);
+		cache->objs = kmalloc_array(nr_bos,
+				sizeof(*cache->objs), GFP_KERNEL);
+		cache->iovas = kmalloc_array(nr_bos,
+				sizeof(*cache->iovas), GFP_KERNEL);
+		if (!cache->handles || !cache->objs || !cache->iovas) {
+			kfree(cache->handles);
+			kfree(cache->objs);
+			kfree(cache->iovas);
+			cache->handles = NULL;
+			cache->objs = NULL;
+			cache->iovas = NULL;
+			return NULL;
+		}
+		cache->size = nr_bos;
+	}
+
+	return cache->handles;
+}
+
+/* Remember the bo list of a submit that has been looked up and pinned: */
+static void submit_bo_cache_fill(struct msm_gem_submit *submit,
+		struct msm_file_private *ctx, unsigned int handle_gen)
+{
+	struct msm_drm_private *priv = submit->dev->dev_private;
+	struct msm_submit_bo_cache *cache = &ctx->bo_cache;
+	uint32_t i;
+
+	for (i = 0; i < submit->nr_bos; i++) {
+		cache->objs[i] = submit->bos[i].obj;
+		cache->iovas[i] = submit->bos[i].iova;
+		drm_gem_object_reference(&cache->objs[i]->base);
+	}
+
+	cache->nr_bos = submit->nr_bos;
+	cache->handle_gen = handle_gen;
+	cache->iova_gen = priv->iova_gen;
+}
+
+/* Returns 1 if the submit names the same handles as the cached list and
+ * the bo's were taken from it, 0 if they need to be looked up.
+ */
+static int submit_lookup_cached(struct msm_gem_submit *submit,
+		struct drm_msm_gem_submit *args, struct msm_file_private *ctx,
+		unsigned int handle_gen)
+{
+	struct msm_submit_bo_cache *cache = &ctx->bo_cache;
+	unsigned i;
+
+	if (!cache->nr_bos || cache->nr_bos != args->nr_bos ||
+			cache->handle_gen != handle_gen)
+		return 0;
+
+	for (i = 0; i < args->nr_bos; i++) {
+		struct drm_msm_gem_submit_bo submit_bo;
+		void __user *userptr =
+			u64_to_user_ptr(args->bos + (i * sizeof(submit_bo)));
+
+		if (copy_from_user(&submit_bo, userptr, sizeof(submit_bo)))
+			return -EFAULT;
+
+		if ((submit_bo.flags & ~MSM_SUBMIT_BO_FLAGS) ||
+			!(submit_bo.flags & MSM_SUBMIT_BO_FLAGS)) {
+			DRM_ERROR("invalid flags: %x\n", submit_bo.flags);
+			return -EINVAL;
+		}
+
+		if (submit_bo.handle != cache->handles[i])
+			return 0;
+
+		submit->bos[i].flags = submit_bo.flags;
+		submit->bos[i].iova  = submit_bo.presumed;
+	}
+
+	for (i = 0; i < args->nr_bos; i++) {
+		struct msm_gem_object *msm_obj = cache->objs[i];
+
+		drm_gem_object_reference(&msm_obj->base);
+		submit->bos[i].obj = msm_obj;
+		list_add_tail(&msm_obj->submit_entry, &submit->bo_list);
+	}
+
+	submit->nr_bos = i;
+	submit->bo_cached = true;
+
+	return 1;
+}
+
 static int submit_lookup_objects(struct msm_gem_submit *submit,
-		struct drm_msm_gem_submit *args, struct drm_file *file)
+		struct drm_msm_gem_submit *args, struct drm_file *file,
+		uint32_t *handles)
 {
 	unsigned i;
 	int ret = 0;
@@ -142,6 +276,8 @@ static int submit_lookup_objects(struct msm_gem_submit *submit,
 		drm_gem_object_reference(obj);
 
 		submit->bos[i].obj = msm_obj;
+		if (handles)
+			handles[i] = submit_bo.handle;
 
 		list_add_tail(&msm_obj->submit_entry, &submit->bo_list);
 	}
@@ -237,23 +373,36 @@ static int submit_fence_sync(struct msm_gem_submit *submit)
 	return ret;
 }
 
-static int submit_pin_objects(struct msm_gem_submit *submit)
+static int submit_pin_objects(struct msm_gem_submit *submit,
+		struct msm_file_private *ctx)
 {
+	struct msm_drm_private *priv = submit->dev->dev_private;
+	struct msm_submit_bo_cache *cache = &ctx->bo_cache;
+	bool pinned;
 	int i, ret = 0;
 
 	submit->valid = true;
 
+	/* no iova was torn down since the cached list was pinned: */
+	pinned = submit->bo_cached && cache->iova_gen == priv->iova_gen;
+
 	for (i = 0; i < submit->nr_bos; i++) {
 		struct msm_gem_object *msm_obj = submit->bos[i].obj;
 		uint32_t iova;
 
 		/* if locking succeeded, pin bo: */
-		ret = msm_gem_get_iova_locked(&msm_obj->base,
-				submit->gpu->aspace, &iova);
+		if (pinned)
+			iova = cache->iovas[i];
+		else
+			ret = msm_gem_get_iova_locked(&msm_obj->base,
+					submit->gpu->aspace, &iova);
 
 		if (ret)
 			break;
 
+		if (submit->bo_cached)
+			cache->iovas[i] = iova;
+
 		submit->bos[i].flags |= BO_PINNED;
 
 		if (iova == submit->bos[i].iova) {
@@ -266,6 +415,9 @@ static int submit_pin_objects(struct msm_gem_submit *submit)
 		}
 	}
 
+	if (!ret && submit->bo_cached)
+		cache->iova_gen = priv->iova_gen;
+
 	return ret;
 }
 
@@ -390,12 +542,18 @@ int msm_ioctl_gem_submit(struct drm_device *dev, void *data,
 	struct fence *in_fence = NULL;
 	struct sync_file *sync_file = NULL;
 	int out_fence_fd = -1;
+	uint32_t *handles = NULL;
+	unsigned int handle_gen;
+	ktime_t start;
 	unsigned i;
 	int ret;
 
 	if (!gpu)
 		return -ENXIO;
 
+	start = ktime_get();
+	trace_msm_gem_submit_begin(args->nr_bos, args->nr_cmds);
+
 	/* for now, we just have 3d pipe.. eventually this would need to
 	 * be more clever to dispatch to appropriate gpu module:
 	 */
@@ -424,10 +582,21 @@ int msm_ioctl_gem_submit(struct drm_device *dev, void *data,
 		goto out_unlock;
 	}
 
-	ret = submit_lookup_objects(submit, args, file);
-	if (ret)
+	/* sampled before lookup, so a handle closed meanwhile misses later: */
+	handle_gen = atomic_read(&ctx->handle_gen);
+
+	ret = submit_lookup_cached(submit, args, ctx, handle_gen);
+	if (ret < 0)
 		goto out;
 
+	if (!ret) {
+		handles = submit_bo_cache_reserve(&ctx->bo_cache,
+				args->nr_bos);
+		ret = submit_lookup_objects(submit, args, file, handles);
+		if (ret)
+			goto out;
+	}
+
 	ret = submit_lock_objects(submit);
 	if (ret)
 		goto out;
@@ -459,10 +628,13 @@ int msm_ioctl_gem_submit(struct drm_device *dev, void *data,
 			goto out;
 	}
 
-	ret = submit_pin_objects(submit);
+	ret = submit_pin_objects(submit, ctx);
 	if (ret)
 		goto out;
 
+	if (handles)
+		submit_bo_cache_fill(submit, ctx, handle_gen);
+
 	for (i = 0; i < args->nr_cmds; i++) {
 		struct drm_msm_gem_submit_cmd submit_cmd;
 		void __user *userptr =
@@ -538,6 +710,9 @@ int msm_ioctl_gem_submit(struct drm_device *dev, void *data,
 		}
 	}
 
+	WRITE_ONCE(gpu->perf_tag.ctx_id, ctx->id);
+	WRITE_ONCE(gpu->perf_tag.seqno, submit->fence->seqno);
+
 	msm_gpu_submit(gpu, submit, ctx);
 
 	args->fence = submit->fence->seqno;
@@ -550,6 +725,9 @@ int msm_ioctl_gem_submit(struct drm_device *dev, void *data,
 out:
 	if (in_fence)
 		fence_put(in_fence);
+	trace_msm_gem_submit_end(ret ? 0 : args->fence, submit->bo_cached,
+			submit->valid, ret,
+			ktime_to_ns(ktime_sub(ktime_get(), start)));
 	submit_cleanup(submit);
 	if (ret)
 		msm_gem_submit_free(submit);
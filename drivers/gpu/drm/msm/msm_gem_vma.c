@@ -195,6 +195,8 @@ msm_gem_smmu_address_space_create(struct drm_device *dev, struct msm_mmu *mmu,
 struct msm_iommu_aspace {
 	struct msm_gem_address_space base;
 	struct drm_mm mm;
+	/* block sizes the iommu can map, beyond the base page size: */
+	unsigned long pgsize_bitmap;
 };
 
 #define to_iommu_aspace(aspace) \
@@ -221,6 +223,7 @@ static int iommu_aspace_map_vma(struct msm_gem_address_space *aspace,
 {
 	struct msm_iommu_aspace *local = to_iommu_aspace(aspace);
 	size_t size = 0;
+	unsigned long align;
 	struct scatterlist *sg;
 	int ret = 0, i;
 
@@ -230,8 +233,18 @@ static int iommu_aspace_map_vma(struct msm_gem_address_space *aspace,
 	for_each_sg(sgt->sgl, sg, sgt->nents, i)
 		size += sg->length + sg->offset;
 
+	/* Align the iova to the largest block size the buffer fills, so
+	 * that physically contiguous runs can use 64K/2M block mappings.
+	 * Fall back to page alignment if the aspace is too fragmented.
+	 */
+	align = local->pgsize_bitmap & GENMASK(__fls(size), 0);
+	align = align ? __rounddown_pow_of_two(align) >> PAGE_SHIFT : 0;
+
 	ret = drm_mm_insert_node(&local->mm, &vma->node, size >> PAGE_SHIFT,
-			0, DRM_MM_SEARCH_DEFAULT);
+			align, DRM_MM_SEARCH_DEFAULT);
+	if (ret && align)
+		ret = drm_mm_insert_node(&local->mm, &vma->node,
+				size >> PAGE_SHIFT, 0, DRM_MM_SEARCH_DEFAULT);
 	if (ret)
 		return ret;
 
@@ -260,7 +273,7 @@ static const struct msm_gem_aspace_ops msm_iommu_aspace_ops = {
 
 static struct msm_gem_address_space *
 msm_gem_address_space_new(struct msm_mmu *mmu, const char *name,
-		uint64_t start, uint64_t end)
+		uint64_t start, uint64_t end, unsigned long pgsize_bitmap)
 {
 	struct msm_iommu_aspace *local;
 
@@ -277,6 +290,8 @@ msm_gem_address_space_new(struct msm_mmu *mmu, const char *name,
 	local->base.name = name;
 	local->base.mmu = mmu;
 	local->base.ops = &msm_iommu_aspace_ops;
+	local->pgsize_bitmap = pgsize_bitmap & ~(PAGE_SIZE | (PAGE_SIZE - 1)) &
+		(SZ_2M | (SZ_2M - 1));
 
 	return &local->base;
 }
@@ -309,7 +324,8 @@ msm_gem_address_space_create(struct device *dev, struct iommu_domain *domain,
 
 	return msm_gem_address_space_new(mmu, name,
 		domain->geometry.aperture_start,
-		domain->geometry.aperture_end);
+		domain->geometry.aperture_end,
+		domain->pgsize_bitmap);
 }
 
 void
@@ -425,6 +425,9 @@ int msm_gpu_perfcntr_sample(struct msm_gpu *gpu, uint32_t *activetime,
 	unsigned long flags;
 	int ret;
 
+	/* account busy time up to now, not just to the last submit/retire: */
+	update_sw_cntrs(gpu);
+
 	spin_lock_irqsave(&gpu->perf_lock, flags);
 
 	if (!gpu->perfcntr_active) {
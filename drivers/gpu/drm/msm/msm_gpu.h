@@ -77,6 +77,10 @@ struct msm_gpu {
 	uint32_t last_cntrs[5];            /* hw counters */
 	const struct msm_gpu_perfcntr *perfcntrs;
 	uint32_t num_perfcntrs;
+	struct {
+		uint32_t seqno;    /* fence of the last submit */
+		uint32_t ctx_id;   /* context that made it */
+	} perf_tag;
 
 	/* ringbuffer: */
 	struct msm_ringbuffer *rb;
@@ -0,0 +1,111 @@
+/*
+ * Copyright (c) 2018, The Linux Foundation. All rights reserved.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 and
+ * only version 2 as published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ */
+
+#if !defined(_MSM_GPU_TRACE_H_) || defined(TRACE_HEADER_MULTI_READ)
+#define _MSM_GPU_TRACE_H_
+
+#include <linux/types.h>
+#include <linux/tracepoint.h>
+
+#undef TRACE_SYSTEM
+#define TRACE_SYSTEM msm_gpu
+#define TRACE_INCLUDE_FILE msm_gpu_trace
+
+TRACE_EVENT(msm_gem_submit_begin,
+	    TP_PROTO(u32 nr_bos, u32 nr_cmds),
+	    TP_ARGS(nr_bos, nr_cmds),
+
+	    TP_STRUCT__entry(
+			     __field(u32, nr_bos)
+			     __field(u32, nr_cmds)
+			     ),
+
+	    TP_fast_assign(
+			   __entry->nr_bos = nr_bos;
+			   __entry->nr_cmds = nr_cmds;
+			   ),
+
+	    TP_printk("nr_bos=%u, nr_cmds=%u",
+		      __entry->nr_bos, __entry->nr_cmds)
+);
+
+TRACE_EVENT(msm_gem_submit_end,
+	    TP_PROTO(u32 seqno, bool bo_cached, bool valid, int ret,
+		     u64 elapsed_ns),
+	    TP_ARGS(seqno, bo_cached, valid, ret, elapsed_ns),
+
+	    TP_STRUCT__entry(
+			     __field(u32, seqno)
+			     __field(bool, bo_cached)
+			     __field(bool, valid)
+			     __field(int, ret)
+			     __field(u64, elapsed_ns)
+			     ),
+
+	    TP_fast_assign(
+			   __entry->seqno = seqno;
+			   __entry->bo_cached = bo_cached;
+			   __entry->valid = valid;
+			   __entry->ret = ret;
+			   __entry->elapsed_ns = elapsed_ns;
+			   ),
+
+	    TP_printk("seqno=%u, bo_cached=%d, valid=%d, ret=%d, elapsed_ns=%llu",
+		      __entry->seqno, __entry->bo_cached, __entry->valid,
+		      __entry->ret, __entry->elapsed_ns)
+);
+
+TRACE_EVENT(msm_fence_signaled,
+	    TP_PROTO(unsigned int context, u32 seqno),
+	    TP_ARGS(context, seqno),
+
+	    TP_STRUCT__entry(
+			     __field(unsigned int, context)
+			     __field(u32, seqno)
+			     ),
+
+	    TP_fast_assign(
+			   __entry->context = context;
+			   __entry->seqno = seqno;
+			   ),
+
+	    TP_printk("context=%u, seqno=%u",
+		      __entry->context, __entry->seqno)
+);
+
+TRACE_EVENT(msm_fence_woken,
+	    TP_PROTO(unsigned int context, u32 seqno, s64 latency_ns),
+	    TP_ARGS(context, seqno, latency_ns),
+
+	    TP_STRUCT__entry(
+			     __field(unsigned int, context)
+			     __field(u32, seqno)
+			     __field(s64, latency_ns)
+			     ),
+
+	    TP_fast_assign(
+			   __entry->context = context;
+			   __entry->seqno = seqno;
+			   __entry->latency_ns = latency_ns;
+			   ),
+
+	    TP_printk("context=%u, seqno=%u, latency_ns=%lld",
+		      __entry->context, __entry->seqno, __entry->latency_ns)
+);
+
+#endif /* _MSM_GPU_TRACE_H_ */
+
+/* This part must be outside protection */
+#undef TRACE_INCLUDE_PATH
+#define TRACE_INCLUDE_PATH .
+#include <trace/define_trace.h>
@@ -15,12 +15,25 @@
  * this program.  If not, see <http://www.gnu.org/licenses/>.
  */
 
+#include <linux/seq_file.h>
 #include "msm_drv.h"
 #include "msm_mmu.h"
 
+/* page sizes tracked in the mapping stats, up to 1G blocks: */
+#define MSM_IOMMU_PGSIZE_SHIFT_MAX	30
+
 struct msm_iommu {
 	struct msm_mmu base;
 	struct iommu_domain *domain;
+
+	/* live mappings by page size, and time spent mapping.  Updated
+	 * under struct_mutex like the mappings themselves:
+	 */
+	struct {
+		unsigned long pages[MSM_IOMMU_PGSIZE_SHIFT_MAX + 1];
+		unsigned long maps;
+		u64 map_ns;
+	} stats;
 };
 #define to_msm_iommu(x) container_of(x, struct msm_iommu, base)
 
@@ -45,6 +58,37 @@ static void msm_iommu_detach(struct msm_mmu *mmu, const char * const *names,
 	iommu_detach_device(iommu->domain, mmu->dev);
 }
 
+/* Account for a mapping the way iommu_map() splits it: the largest
+ * supported page size that both addresses are aligned to and that fits.
+ */
+static void msm_iommu_account(struct msm_iommu *iommu, unsigned long iova,
+		phys_addr_t pa, size_t size, bool map)
+{
+	unsigned long pgsizes, addr_merge;
+	unsigned int shift;
+
+	while (size) {
+		addr_merge = iova | (unsigned long)pa;
+		pgsizes = iommu->domain->pgsize_bitmap & GENMASK(__fls(size), 0);
+		if (addr_merge)
+			pgsizes &= GENMASK(__ffs(addr_merge), 0);
+		if (WARN_ON(!pgsizes))
+			return;
+
+		shift = __fls(pgsizes);
+		if (shift <= MSM_IOMMU_PGSIZE_SHIFT_MAX) {
+			if (map)
+				iommu->stats.pages[shift]++;
+			else if (iommu->stats.pages[shift])
+				iommu->stats.pages[shift]--;
+		}
+
+		iova += 1UL << shift;
+		pa += 1UL << shift;
+		size -= 1UL << shift;
+	}
+}
+
 static int msm_iommu_map(struct msm_mmu *mmu, uint32_t iova,
 		struct sg_table *sgt, int prot)
 {
@@ -53,11 +97,17 @@ static int msm_iommu_map(struct msm_mmu *mmu, uint32_t iova,
 	struct scatterlist *sg;
 	unsigned int da = iova;
 	unsigned int i, j;
+	ktime_t start;
 	int ret;
 
 	if (!domain || !sgt)
 		return -EINVAL;
 
+	start = ktime_get();
+
+	/* Each sg entry is a physically contiguous run, which iommu_map()
+	 * maps with block entries wherever the iova and pa line up.
+	 */
 	for_each_sg(sgt->sgl, sg, sgt->nents, i) {
 		dma_addr_t pa = sg_phys(sg) - sg->offset;
 		size_t bytes = sg->length + sg->offset;
@@ -68,17 +118,24 @@ static int msm_iommu_map(struct msm_mmu *mmu, uint32_t iova,
 		if (ret)
 			goto fail;
 
+		msm_iommu_account(iommu, da, pa, bytes, true);
 		da += bytes;
 	}
 
+	iommu->stats.maps++;
+	iommu->stats.map_ns += ktime_to_ns(ktime_sub(ktime_get(), start));
+
 	return 0;
 
 fail:
 	da = iova;
 
 	for_each_sg(sgt->sgl, sg, i, j) {
+		dma_addr_t pa = sg_phys(sg) - sg->offset;
 		size_t bytes = sg->length + sg->offset;
+
 		iommu_unmap(domain, da, bytes);
+		msm_iommu_account(iommu, da, pa, bytes, false);
 		da += bytes;
 	}
 	return ret;
@@ -94,6 +151,7 @@ static int msm_iommu_unmap(struct msm_mmu *mmu, uint32_t iova,
 	int i;
 
 	for_each_sg(sgt->sgl, sg, sgt->nents, i) {
+		dma_addr_t pa = sg_phys(sg) - sg->offset;
 		size_t bytes = sg->length + sg->offset;
 		size_t unmapped;
 
@@ -101,6 +159,8 @@ static int msm_iommu_unmap(struct msm_mmu *mmu, uint32_t iova,
 		if (unmapped < bytes)
 			return unmapped;
 
+		msm_iommu_account(iommu, da, pa, bytes, false);
+
 		VERB("unmap[%d]: %08x(%zx)", i, da, bytes);
 
 		BUG_ON(!PAGE_ALIGNED(bytes));
@@ -111,6 +171,23 @@ static int msm_iommu_unmap(struct msm_mmu *mmu, uint32_t iova,
 	return 0;
 }
 
+static void msm_iommu_show(struct msm_mmu *mmu, struct seq_file *m)
+{
+	struct msm_iommu *iommu = to_msm_iommu(mmu);
+	unsigned int shift;
+
+	seq_printf(m, "maps: %lu, avg map time: %llu ns\n", iommu->stats.maps,
+			iommu->stats.maps ? div64_u64(iommu->stats.map_ns,
+				iommu->stats.maps) : 0);
+
+	for (shift = 0; shift <= MSM_IOMMU_PGSIZE_SHIFT_MAX; shift++) {
+		if (!(iommu->domain->pgsize_bitmap & BIT(shift)))
+			continue;
+		seq_printf(m, "%8luK pages: %lu\n", BIT(shift) >> 10,
+				iommu->stats.pages[shift]);
+	}
+}
+
 static void msm_iommu_destroy(struct msm_mmu *mmu)
 {
 	struct msm_iommu *iommu = to_msm_iommu(mmu);
@@ -124,6 +201,7 @@ static const struct msm_mmu_funcs funcs = {
 		.map = msm_iommu_map,
 		.unmap = msm_iommu_unmap,
 		.destroy = msm_iommu_destroy,
+		.show = msm_iommu_show,
 };
 
 struct msm_mmu *msm_iommu_new(struct device *dev, struct iommu_domain *domain)
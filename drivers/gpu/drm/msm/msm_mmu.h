@@ -21,6 +21,7 @@
 #include <linux/iommu.h>
 
 struct msm_mmu;
+struct seq_file;
 
 enum msm_mmu_domain_type {
 	MSM_SMMU_DOMAIN_UNSECURE,
@@ -52,6 +53,7 @@ struct msm_mmu_funcs {
 			uint32_t dest_address, uint32_t size, int prot);
 	int (*one_to_one_unmap)(struct msm_mmu *mmu, uint32_t dest_address,
 					uint32_t size);
+	void (*show)(struct msm_mmu *mmu, struct seq_file *m);
 };
 
 struct msm_mmu {
@@ -21,15 +21,52 @@
  *
  * This will enable performance counters/profiling to track the busy time
  * and any gpu specific performance counters that are supported.
+ *
+ * For continuous sampling, tools can instead open and mmap() the
+ * perf_ring file.  That samples the counters selected in perf_ring_mask
+ * at perf_ring_hz (up to 1kHz) into a ring of struct msm_perf_sample,
+ * following a struct msm_perf_ring_hdr in the first page.  hdr->head
+ * counts the samples written; sample n is at index n % hdr->nr_samples
+ * and is complete once head has moved past it.  Each sample is tagged
+ * with the fence and context of the last submit, so it can be attributed
+ * to frames.  Only one of perf and perf_ring can be open at a time.
  */
 
 #ifdef CONFIG_DEBUG_FS
 
 #include <linux/debugfs.h>
+#include <linux/hrtimer.h>
+#include <linux/mm.h>
+#include <linux/vmalloc.h>
 
 #include "msm_drv.h"
 #include "msm_gpu.h"
 
+#define MSM_PERF_RING_VERSION	1
+#define MSM_PERF_RING_PAGES	64
+#define MSM_PERF_RING_MAX_HZ	1000
+#define MSM_PERF_MAX_CNTRS	5
+
+struct msm_perf_ring_hdr {
+	u32 version;
+	u32 sample_size;
+	u32 nr_samples;
+	u32 rate_hz;
+	u32 cntr_mask;       /* which of the gpu's counters are sampled */
+	u32 pad;
+	u64 head;
+};
+
+struct msm_perf_sample {
+	u64 timestamp_ns;    /* CLOCK_MONOTONIC */
+	u32 submit_seqno;    /* fence of the last submit */
+	u32 retired_seqno;   /* last fence the gpu completed */
+	u32 ctx_id;          /* context of the last submit */
+	u32 activetime;      /* us busy since the previous sample */
+	u32 totaltime;       /* us since the previous sample */
+	u32 cntrs[MSM_PERF_MAX_CNTRS];
+};
+
 struct msm_perf_state {
 	struct drm_device *dev;
 
@@ -44,6 +81,13 @@ struct msm_perf_state {
 
 	struct dentry *ent;
 	struct drm_info_node *node;
+
+	/* continuous sampling: */
+	struct msm_perf_ring_hdr *ring;
+	struct hrtimer ring_timer;
+	ktime_t ring_period;
+	u32 ring_hz, ring_mask;
+	struct dentry *ring_ent, *ring_hz_ent, *ring_mask_ent;
 };
 
 #define SAMPLE_TIME (HZ/4)
@@ -204,6 +248,124 @@ static const struct file_operations perf_debugfs_fops = {
 	.release = perf_release,
 };
 
+static enum hrtimer_restart perf_ring_sample(struct hrtimer *timer)
+{
+	struct msm_perf_state *perf =
+		container_of(timer, struct msm_perf_state, ring_timer);
+	struct msm_drm_private *priv = perf->dev->dev_private;
+	struct msm_gpu *gpu = priv->gpu;
+	struct msm_perf_ring_hdr *hdr = perf->ring;
+	struct msm_perf_sample *samples = (void *)hdr + PAGE_SIZE;
+	struct msm_perf_sample *sample;
+	uint32_t cntrs[MSM_PERF_MAX_CNTRS];
+	u64 head = hdr->head;
+	int i, n;
+
+	sample = &samples[do_div(head, hdr->nr_samples)];
+
+	n = msm_gpu_perfcntr_sample(gpu, &sample->activetime,
+			&sample->totaltime, ARRAY_SIZE(cntrs), cntrs);
+	if (n >= 0) {
+		sample->timestamp_ns = ktime_get_ns();
+		sample->submit_seqno = READ_ONCE(gpu->perf_tag.seqno);
+		sample->ctx_id = READ_ONCE(gpu->perf_tag.ctx_id);
+		sample->retired_seqno = gpu->funcs->last_fence(gpu);
+
+		for (i = 0; i < ARRAY_SIZE(cntrs); i++)
+			sample->cntrs[i] = (i < n && (hdr->cntr_mask & BIT(i))) ?
+				cntrs[i] : 0;
+
+		/* publish the sample before moving head past it: */
+		smp_wmb();
+		WRITE_ONCE(hdr->head, hdr->head + 1);
+	}
+
+	hrtimer_forward_now(timer, perf->ring_period);
+
+	return HRTIMER_RESTART;
+}
+
+static int perf_ring_open(struct inode *inode, struct file *file)
+{
+	struct msm_perf_state *perf = inode->i_private;
+	struct drm_device *dev = perf->dev;
+	struct msm_drm_private *priv = dev->dev_private;
+	struct msm_gpu *gpu = priv->gpu;
+	struct msm_perf_ring_hdr *hdr;
+	u32 hz;
+	int ret = 0;
+
+	mutex_lock(&dev->struct_mutex);
+
+	if (perf->open || !gpu) {
+		ret = -EBUSY;
+		goto out;
+	}
+
+	hdr = vmalloc_user(MSM_PERF_RING_PAGES << PAGE_SHIFT);
+	if (!hdr) {
+		ret = -ENOMEM;
+		goto out;
+	}
+
+	hz = clamp_t(u32, perf->ring_hz, 1, MSM_PERF_RING_MAX_HZ);
+
+	hdr->version = MSM_PERF_RING_VERSION;
+	hdr->sample_size = sizeof(struct msm_perf_sample);
+	hdr->nr_samples = ((MSM_PERF_RING_PAGES - 1) << PAGE_SHIFT) /
+		sizeof(struct msm_perf_sample);
+	hdr->rate_hz = hz;
+	hdr->cntr_mask = perf->ring_mask &
+		(BIT(min_t(u32, gpu->num_perfcntrs, MSM_PERF_MAX_CNTRS)) - 1);
+	hdr->head = 0;
+
+	file->private_data = perf;
+	perf->ring = hdr;
+	perf->open = true;
+	perf->ring_period = ns_to_ktime(NSEC_PER_SEC / hz);
+
+	msm_gpu_perfcntr_start(gpu);
+	hrtimer_start(&perf->ring_timer, perf->ring_period, HRTIMER_MODE_REL);
+
+out:
+	mutex_unlock(&dev->struct_mutex);
+	return ret;
+}
+
+static int perf_ring_mmap(struct file *file, struct vm_area_struct *vma)
+{
+	struct msm_perf_state *perf = file->private_data;
+
+	if (vma->vm_flags & VM_WRITE)
+		return -EPERM;
+	vma->vm_flags &= ~VM_MAYWRITE;
+
+	return remap_vmalloc_range(vma, perf->ring, vma->vm_pgoff);
+}
+
+static int perf_ring_release(struct inode *inode, struct file *file)
+{
+	struct msm_perf_state *perf = inode->i_private;
+	struct msm_drm_private *priv = perf->dev->dev_private;
+
+	hrtimer_cancel(&perf->ring_timer);
+	msm_gpu_perfcntr_stop(priv->gpu);
+
+	/* existing mappings hold their own reference to the pages: */
+	vfree(perf->ring);
+	perf->ring = NULL;
+	perf->open = false;
+	return 0;
+}
+
+static const struct file_operations perf_ring_debugfs_fops = {
+	.owner = THIS_MODULE,
+	.open = perf_ring_open,
+	.mmap = perf_ring_mmap,
+	.llseek = no_llseek,
+	.release = perf_ring_release,
+};
+
 int msm_perf_debugfs_init(struct drm_minor *minor)
 {
 	struct msm_drm_private *priv = minor->dev->dev_private;
@@ -220,6 +382,10 @@ int msm_perf_debugfs_init(struct drm_minor *minor)
 	perf->dev = minor->dev;
 
 	mutex_init(&perf->read_lock);
+	hrtimer_init(&perf->ring_timer, CLOCK_MONOTONIC, HRTIMER_MODE_REL);
+	perf->ring_timer.function = perf_ring_sample;
+	perf->ring_hz = 100;
+	perf->ring_mask = BIT(MSM_PERF_MAX_CNTRS) - 1;
 	priv->perf = perf;
 
 	perf->node = kzalloc(sizeof(*perf->node), GFP_KERNEL);
@@ -234,6 +400,13 @@ int msm_perf_debugfs_init(struct drm_minor *minor)
 		goto fail;
 	}
 
+	perf->ring_ent = debugfs_create_file("perf_ring", S_IFREG | S_IRUGO,
+			minor->debugfs_root, perf, &perf_ring_debugfs_fops);
+	perf->ring_hz_ent = debugfs_create_u32("perf_ring_hz",
+			S_IRUGO | S_IWUSR, minor->debugfs_root, &perf->ring_hz);
+	perf->ring_mask_ent = debugfs_create_x32("perf_ring_mask",
+			S_IRUGO | S_IWUSR, minor->debugfs_root, &perf->ring_mask);
+
 	perf->node->minor = minor;
 	perf->node->dent  = perf->ent;
 	perf->node->info_ent = NULL;
@@ -259,6 +432,9 @@ void msm_perf_debugfs_cleanup(struct drm_minor *minor)
 
 	priv->perf = NULL;
 
+	debugfs_remove(perf->ring_mask_ent);
+	debugfs_remove(perf->ring_hz_ent);
+	debugfs_remove(perf->ring_ent);
 	debugfs_remove(perf->ent);
 
 	if (perf->node) {
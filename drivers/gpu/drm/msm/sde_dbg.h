@@ -16,6 +16,7 @@
 #include <stdarg.h>
 #include <linux/debugfs.h>
 #include <linux/list.h>
+#include <linux/atomic.h>
 
 /* select an uncommon hex value for the limiter */
 #define SDE_EVTLOG_DATA_LIMITER	(0xC0DEBEEF)
@@ -63,11 +64,11 @@ enum sde_dbg_dump_flag {
 #define SDE_EVTLOG_PRINT_ENTRY	256
 
 /*
- * evtlog keeps this number of entries in memory for debug purpose. This
- * number must be greater than print entry to prevent out of bound evtlog
- * entry array access.
+ * evtlog keeps this number of entries in memory per cpu for debug purpose.
+ * This number must be a power of two and greater than print entry, so a
+ * dump of a single busy cpu is not cut short.
  */
-#define SDE_EVTLOG_ENTRY	(SDE_EVTLOG_PRINT_ENTRY * 8)
+#define SDE_EVTLOG_ENTRY	(SDE_EVTLOG_PRINT_ENTRY * 2)
 #define SDE_EVTLOG_MAX_DATA 15
 #define SDE_EVTLOG_BUF_MAX 512
 #define SDE_EVTLOG_BUF_ALIGN 32
@@ -79,25 +80,43 @@ struct sde_dbg_power_ctrl {
 };
 
 struct sde_dbg_evtlog_log {
+	u64 seq;
 	s64 time;
 	const char *name;
 	int line;
 	u32 data[SDE_EVTLOG_MAX_DATA];
 	u32 data_cnt;
 	int pid;
+	int cpu;
 };
 
 /**
- * @last_dump: Index of last entry to be output during evtlog dumps
- * @filter_list: Linked list of currently active filter strings
+ * struct sde_dbg_evtlog_ring - per cpu ring of event log entries
+ * @logs: Entries, in increasing sequence number order
+ * @head: Count of slots ever reserved, only touched by the owning cpu
+ * @dump_idx: Next slot to be output during the current dump
  */
-struct sde_dbg_evtlog {
+struct sde_dbg_evtlog_ring {
 	struct sde_dbg_evtlog_log logs[SDE_EVTLOG_ENTRY];
-	u32 first;
-	u32 last;
-	u32 last_dump;
-	u32 curr;
-	u32 next;
+	u32 head;
+	u32 dump_idx;
+};
+
+/**
+ * @rings: Per possible cpu rings, written without locks
+ * @seq: Global sequence number, used to merge the rings at dump time
+ * @dump_seq: Sequence number of the last entry output during evtlog dumps
+ * @last_dump: Sequence number of last entry to be output during evtlog dumps
+ * @dump_prev_time: Timestamp of the last entry output, for time deltas
+ * @spin_lock: Protects the dump state and filter list updates
+ * @filter_list: RCU list of currently active filter strings
+ */
+struct sde_dbg_evtlog {
+	struct sde_dbg_evtlog_ring **rings;
+	atomic64_t seq;
+	u64 dump_seq;
+	u64 last_dump;
+	s64 dump_prev_time;
 	u32 enable;
 	spinlock_t spin_lock;
 	struct list_head filter_list;
@@ -19,17 +19,23 @@
 #include <linux/uaccess.h>
 #include <linux/dma-buf.h>
 #include <linux/slab.h>
+#include <linux/vmalloc.h>
+#include <linux/rculist.h>
 
 #include "sde_dbg.h"
 #include "sde_trace.h"
 
 #define SDE_EVTLOG_FILTER_STRSIZE	64
 
+#define SDE_EVTLOG_IDX(i)	((i) & (SDE_EVTLOG_ENTRY - 1))
+
 struct sde_evtlog_filter {
 	struct list_head list;
+	struct rcu_head rcu;
 	char filter[SDE_EVTLOG_FILTER_STRSIZE];
 };
 
+/* called under rcu_read_lock, or with spin_lock held */
 static bool _sde_evtlog_is_filtered_no_lock(
 		struct sde_dbg_evtlog *evtlog, const char *str)
 {
@@ -47,7 +53,7 @@ static bool _sde_evtlog_is_filtered_no_lock(
 	 * a matching entry is not in the list.
 	 */
 	rc = !list_empty(&evtlog->filter_list);
-	list_for_each_entry(filter_node, &evtlog->filter_list, list)
+	list_for_each_entry_rcu(filter_node, &evtlog->filter_list, list)
 		if (strnstr(str, filter_node->filter, len)) {
 			rc = false;
 			break;
@@ -61,13 +67,23 @@ bool sde_evtlog_is_enabled(struct sde_dbg_evtlog *evtlog, u32 flag)
 	return evtlog && (evtlog->enable & flag);
 }
 
+/*
+ * Entries go to the ring of the local cpu without taking any lock. Only the
+ * slot and sequence number are claimed with interrupts off, so each ring
+ * stays in sequence order even when an irq logs in the middle of a task's
+ * entry. The sequence number is published last, so a concurrent dump can
+ * tell a complete entry from one still being written.
+ */
 void sde_evtlog_log(struct sde_dbg_evtlog *evtlog, const char *name, int line,
 		int flag, ...)
 {
 	unsigned long flags;
-	int i, val = 0;
+	int i, val = 0, cpu;
 	va_list args;
+	struct sde_dbg_evtlog_ring *ring;
 	struct sde_dbg_evtlog_log *log;
+	u64 seq;
+	bool filtered;
 
 	if (!evtlog)
 		return;
@@ -75,17 +91,29 @@ void sde_evtlog_log(struct sde_dbg_evtlog *evtlog, const char *name, int line,
 	if (!sde_evtlog_is_enabled(evtlog, flag))
 		return;
 
-	spin_lock_irqsave(&evtlog->spin_lock, flags);
+	rcu_read_lock();
+	filtered = _sde_evtlog_is_filtered_no_lock(evtlog, name);
+	rcu_read_unlock();
+	if (filtered)
+		return;
 
-	if (_sde_evtlog_is_filtered_no_lock(evtlog, name))
-		goto exit;
+	cpu = get_cpu();
+	ring = evtlog->rings[cpu];
+
+	local_irq_save(flags);
+	log = &ring->logs[SDE_EVTLOG_IDX(ring->head++)];
+	seq = atomic64_inc_return(&evtlog->seq);
+	local_irq_restore(flags);
+
+	WRITE_ONCE(log->seq, 0);
+	smp_wmb();
 
-	log = &evtlog->logs[evtlog->curr];
 	log->time = ktime_to_us(ktime_get());
 	log->name = name;
 	log->line = line;
 	log->data_cnt = 0;
 	log->pid = current->pid;
+	log->cpu = cpu;
 
 	va_start(args, flag);
 	for (i = 0; i < SDE_EVTLOG_MAX_DATA; i++) {
@@ -98,12 +126,54 @@ void sde_evtlog_log(struct sde_dbg_evtlog *evtlog, const char *name, int line,
 	}
 	va_end(args);
 	log->data_cnt = i;
-	evtlog->curr = (evtlog->curr + 1) % SDE_EVTLOG_ENTRY;
-	evtlog->last++;
+
+	smp_wmb();
+	WRITE_ONCE(log->seq, seq);
 
 	trace_sde_evtlog(name, line, log->data_cnt, log->data);
-exit:
-	spin_unlock_irqrestore(&evtlog->spin_lock, flags);
+
+	put_cpu();
+}
+
+/*
+ * Copy out the entry at @idx of @ring if it is complete and still within
+ * (@after, @until]; returns false if it is not, or was overwritten.
+ */
+static bool _sde_evtlog_read_entry(struct sde_dbg_evtlog_ring *ring, u32 idx,
+		u64 after, u64 until, struct sde_dbg_evtlog_log *out)
+{
+	struct sde_dbg_evtlog_log *log = &ring->logs[SDE_EVTLOG_IDX(idx)];
+	u64 seq = READ_ONCE(log->seq);
+
+	if (!seq || seq <= after || seq > until)
+		return false;
+
+	smp_rmb();
+	*out = *log;
+	smp_rmb();
+
+	return READ_ONCE(log->seq) == seq;
+}
+
+/* position each ring's dump cursor at its first entry after @after */
+static void _sde_evtlog_dump_seek(struct sde_dbg_evtlog *evtlog, u64 after)
+{
+	struct sde_dbg_evtlog_ring *ring;
+	struct sde_dbg_evtlog_log log;
+	u32 head, idx;
+	int cpu;
+
+	for_each_possible_cpu(cpu) {
+		ring = evtlog->rings[cpu];
+		head = READ_ONCE(ring->head);
+		idx = head > SDE_EVTLOG_ENTRY ? head - SDE_EVTLOG_ENTRY : 0;
+
+		/* skip what was already dumped, or is being overwritten */
+		while (idx != head && !_sde_evtlog_read_entry(ring, idx,
+					after, evtlog->last_dump, &log))
+			idx++;
+		ring->dump_idx = idx;
+	}
 }
 
 /* always dump the last entries which are not dumped yet */
@@ -113,28 +183,68 @@ static bool _sde_evtlog_dump_calc_range(struct sde_dbg_evtlog *evtlog,
 	if (!evtlog)
 		return false;
 
-	evtlog->first = evtlog->next;
-
-	if (update_last_entry)
-		evtlog->last_dump = evtlog->last;
+	if (!update_last_entry)
+		return evtlog->dump_seq < evtlog->last_dump;
 
-	if (evtlog->last_dump == evtlog->first)
+	evtlog->last_dump = atomic64_read(&evtlog->seq);
+	if (evtlog->last_dump == evtlog->dump_seq)
 		return false;
 
-	if (evtlog->last_dump < evtlog->first) {
-		evtlog->first %= SDE_EVTLOG_ENTRY;
-		if (evtlog->last_dump < evtlog->first)
-			evtlog->last_dump += SDE_EVTLOG_ENTRY;
+	if ((evtlog->last_dump - evtlog->dump_seq) > SDE_EVTLOG_PRINT_ENTRY) {
+		pr_info("evtlog skipping %llu entries, last=%llu\n",
+			evtlog->last_dump - evtlog->dump_seq -
+			SDE_EVTLOG_PRINT_ENTRY,
+			evtlog->last_dump);
+		evtlog->dump_seq = evtlog->last_dump - SDE_EVTLOG_PRINT_ENTRY;
 	}
 
-	if ((evtlog->last_dump - evtlog->first) > SDE_EVTLOG_PRINT_ENTRY) {
-		pr_info("evtlog skipping %d entries, last=%d\n",
-			evtlog->last_dump - evtlog->first -
-			SDE_EVTLOG_PRINT_ENTRY,
-			evtlog->last_dump - 1);
-		evtlog->first = evtlog->last_dump - SDE_EVTLOG_PRINT_ENTRY;
+	_sde_evtlog_dump_seek(evtlog, evtlog->dump_seq);
+
+	return true;
+}
+
+/* merge the rings: the oldest pending entry over all cpus is next */
+static bool _sde_evtlog_dump_next(struct sde_dbg_evtlog *evtlog,
+		struct sde_dbg_evtlog_log *out)
+{
+	struct sde_dbg_evtlog_ring *ring, *next_ring = NULL;
+	struct sde_dbg_evtlog_log log;
+	int cpu;
+
+	for_each_possible_cpu(cpu) {
+		ring = evtlog->rings[cpu];
+
+		/* entries lost to wrap around are skipped over */
+		while (ring->dump_idx != READ_ONCE(ring->head) &&
+				!_sde_evtlog_read_entry(ring, ring->dump_idx,
+					evtlog->dump_seq, evtlog->last_dump,
+					&log)) {
+			if (READ_ONCE(ring->logs[SDE_EVTLOG_IDX(
+					ring->dump_idx)].seq) >
+					evtlog->last_dump)
+				break;
+			ring->dump_idx++;
+		}
+
+		if (ring->dump_idx == READ_ONCE(ring->head) ||
+				!_sde_evtlog_read_entry(ring, ring->dump_idx,
+					evtlog->dump_seq, evtlog->last_dump,
+					&log))
+			continue;
+
+		if (!next_ring || log.seq < out->seq) {
+			*out = log;
+			next_ring = ring;
+		}
 	}
-	evtlog->next = evtlog->first + 1;
+
+	if (!next_ring) {
+		evtlog->dump_seq = evtlog->last_dump;
+		return false;
+	}
+
+	next_ring->dump_idx++;
+	evtlog->dump_seq = out->seq;
 
 	return true;
 }
@@ -145,8 +255,9 @@ ssize_t sde_evtlog_dump_to_buffer(struct sde_dbg_evtlog *evtlog,
 {
 	int i;
 	ssize_t off = 0;
-	struct sde_dbg_evtlog_log *log, *prev_log;
+	struct sde_dbg_evtlog_log log;
 	unsigned long flags;
+	s64 prev_time;
 
 	if (!evtlog || !evtlog_buf)
 		return 0;
@@ -157,12 +268,16 @@ ssize_t sde_evtlog_dump_to_buffer(struct sde_dbg_evtlog *evtlog,
 	if (!_sde_evtlog_dump_calc_range(evtlog, update_last_entry))
 		goto exit;
 
-	log = &evtlog->logs[evtlog->first % SDE_EVTLOG_ENTRY];
+	prev_time = evtlog->dump_prev_time;
+	if (!_sde_evtlog_dump_next(evtlog, &log))
+		goto exit;
 
-	prev_log = &evtlog->logs[(evtlog->first - 1) % SDE_EVTLOG_ENTRY];
+	if (update_last_entry)
+		prev_time = log.time;
+	evtlog->dump_prev_time = log.time;
 
 	off = snprintf((evtlog_buf + off), (evtlog_buf_size - off), "%s:%-4d",
-		log->name, log->line);
+		log.name, log.line);
 
 	if (off < SDE_EVTLOG_BUF_ALIGN) {
 		memset((evtlog_buf + off), 0x20, (SDE_EVTLOG_BUF_ALIGN - off));
@@ -170,12 +285,12 @@ ssize_t sde_evtlog_dump_to_buffer(struct sde_dbg_evtlog *evtlog,
 	}
 
 	off += snprintf((evtlog_buf + off), (evtlog_buf_size - off),
-		"=>[%-8d:%-11llu:%9llu][%-4d]:", evtlog->first,
-		log->time, (log->time - prev_log->time), log->pid);
+		"=>[%-8llu:%-11llu:%9llu][%-4d][%d]:", log.seq,
+		log.time, (log.time - prev_time), log.pid, log.cpu);
 
-	for (i = 0; i < log->data_cnt; i++)
+	for (i = 0; i < log.data_cnt; i++)
 		off += snprintf((evtlog_buf + off), (evtlog_buf_size - off),
-			"%x ", log->data[i]);
+			"%x ", log.data[i]);
 
 	off += snprintf((evtlog_buf + off), (evtlog_buf_size - off), "\n");
 exit:
@@ -199,20 +314,51 @@ void sde_evtlog_dump_all(struct sde_dbg_evtlog *evtlog)
 	}
 }
 
+static void _sde_evtlog_free_rings(struct sde_dbg_evtlog *evtlog)
+{
+	int cpu;
+
+	if (!evtlog->rings)
+		return;
+
+	for_each_possible_cpu(cpu)
+		vfree(evtlog->rings[cpu]);
+	kfree(evtlog->rings);
+	evtlog->rings = NULL;
+}
+
 struct sde_dbg_evtlog *sde_evtlog_init(void)
 {
 	struct sde_dbg_evtlog *evtlog;
+	int cpu;
 
 	evtlog = kzalloc(sizeof(*evtlog), GFP_KERNEL);
 	if (!evtlog)
 		return ERR_PTR(-ENOMEM);
 
+	evtlog->rings = kcalloc(nr_cpu_ids, sizeof(*evtlog->rings),
+			GFP_KERNEL);
+	if (!evtlog->rings)
+		goto fail;
+
+	for_each_possible_cpu(cpu) {
+		evtlog->rings[cpu] = vzalloc(sizeof(*evtlog->rings[cpu]));
+		if (!evtlog->rings[cpu])
+			goto fail;
+	}
+
+	atomic64_set(&evtlog->seq, 0);
 	spin_lock_init(&evtlog->spin_lock);
 	evtlog->enable = SDE_EVTLOG_DEFAULT_ENABLE;
 
 	INIT_LIST_HEAD(&evtlog->filter_list);
 
 	return evtlog;
+
+fail:
+	_sde_evtlog_free_rings(evtlog);
+	kfree(evtlog);
+	return ERR_PTR(-ENOMEM);
 }
 
 int sde_evtlog_get_filter(struct sde_dbg_evtlog *evtlog, int index,
@@ -243,64 +389,43 @@ int sde_evtlog_get_filter(struct sde_dbg_evtlog *evtlog, int index,
 void sde_evtlog_set_filter(struct sde_dbg_evtlog *evtlog, char *filter)
 {
 	struct sde_evtlog_filter *filter_node, *tmp;
-	struct list_head free_list;
 	unsigned long flags;
 	char *flt;
 
 	if (!evtlog)
 		return;
 
-	INIT_LIST_HEAD(&free_list);
-
 	/*
-	 * Clear active filter list and cache filter_nodes locally
-	 * to reduce memory fragmentation.
+	 * Clear active filter list. Loggers walk it without the lock, so
+	 * the nodes are only freed after a grace period.
 	 */
 	spin_lock_irqsave(&evtlog->spin_lock, flags);
 	list_for_each_entry_safe(filter_node, tmp, &evtlog->filter_list, list) {
-		list_del_init(&filter_node->list);
-		list_add_tail(&filter_node->list, &free_list);
+		list_del_rcu(&filter_node->list);
+		kfree_rcu(filter_node, rcu);
 	}
 	spin_unlock_irqrestore(&evtlog->spin_lock, flags);
 
 	/*
 	 * Parse incoming filter request string and build up a new
-	 * filter list. New filter nodes are taken from the local
-	 * free list, if available, and allocated from the system
-	 * heap once the free list is empty.
+	 * filter list.
 	 */
 	while (filter && (flt = strsep(&filter, "|\r\n\t ")) != NULL) {
 		if (!*flt)
 			continue;
 
-		if (list_empty(&free_list)) {
-			filter_node = kzalloc(sizeof(*filter_node), GFP_KERNEL);
-			if (!filter_node)
-				break;
-
-			INIT_LIST_HEAD(&filter_node->list);
-		} else {
-			filter_node = list_first_entry(&free_list,
-					struct sde_evtlog_filter, list);
-			list_del_init(&filter_node->list);
-		}
+		filter_node = kzalloc(sizeof(*filter_node), GFP_KERNEL);
+		if (!filter_node)
+			break;
 
 		/* don't care if copy truncated */
 		(void)strlcpy(filter_node->filter, flt,
 				SDE_EVTLOG_FILTER_STRSIZE);
 
 		spin_lock_irqsave(&evtlog->spin_lock, flags);
-		list_add_tail(&filter_node->list, &evtlog->filter_list);
+		list_add_tail_rcu(&filter_node->list, &evtlog->filter_list);
 		spin_unlock_irqrestore(&evtlog->spin_lock, flags);
 	}
-
-	/*
-	 * Free any unused filter_nodes back to the system.
-	 */
-	list_for_each_entry_safe(filter_node, tmp, &free_list, list) {
-		list_del(&filter_node->list);
-		kfree(filter_node);
-	}
 }
 
 void sde_evtlog_destroy(struct sde_dbg_evtlog *evtlog)
@@ -314,5 +439,6 @@ void sde_evtlog_destroy(struct sde_dbg_evtlog *evtlog)
 		list_del(&filter_node->list);
 		kfree(filter_node);
 	}
+	_sde_evtlog_free_rings(evtlog);
 	kfree(evtlog);
 }
@@ -13,6 +13,8 @@
 #include <linux/device.h>
 #include <linux/bitmap.h>
 #include <linux/io.h>
+#include <linux/percpu.h>
+#include <linux/trace_events.h>
 #include "coresight-ost.h"
 #include <linux/coresight-stm.h>
 
@@ -30,6 +32,20 @@
 
 #define STM_TRACE_BUF_SIZE		4096
 
+/* task, softirq, irq and nmi may each be building an event */
+#define STM_FTRACE_NEST_MAX		4
+#define STM_FTRACE_BUF_SIZE		1024
+
+struct stm_ftrace_buf {
+	int	nest;
+	char	buf[STM_FTRACE_NEST_MAX][STM_FTRACE_BUF_SIZE] __aligned(8);
+};
+
+static DEFINE_PER_CPU(struct stm_ftrace_buf, stm_ftrace_buf);
+
+DEFINE_STATIC_KEY_FALSE(trace_stm_bypass_key);
+EXPORT_SYMBOL(trace_stm_bypass_key);
+
 static struct stm_drvdata *stmdrvdata;
 
 static uint32_t stm_channel_alloc(void)
@@ -281,6 +297,86 @@ ssize_t stm_ost_packet(struct stm_data *stm_data,
 }
 EXPORT_SYMBOL(stm_ost_packet);
 
+/*
+ * trace_event_stm_reserve - reserve room for an ftrace event sent over STM
+ * @fbuffer: event buffer descriptor, filled in for trace_event_stm_commit()
+ * @trace_file: the event being recorded
+ * @len: size of the event record
+ *
+ * Returns a per-cpu scratch record with the common fields filled in, or
+ * NULL if the event has to go to the ring buffer as usual: STM disabled,
+ * ftrace events not selected as an OST entity, record too large or too
+ * deeply nested.
+ */
+void *trace_event_stm_reserve(struct trace_event_buffer *fbuffer,
+			      struct trace_event_file *trace_file,
+			      unsigned long len)
+{
+	struct stm_drvdata *drvdata = stmdrvdata;
+	struct trace_entry *ent;
+	int nest;
+
+	if (unlikely(!drvdata || !drvdata->enable ||
+		     !test_bit(OST_ENTITY_FTRACE_EVENTS, drvdata->entities) ||
+		     len > STM_FTRACE_BUF_SIZE))
+		return NULL;
+
+	local_save_flags(fbuffer->flags);
+	fbuffer->pc = preempt_count();
+
+	preempt_disable_notrace();
+	nest = this_cpu_inc_return(stm_ftrace_buf.nest) - 1;
+	if (unlikely(nest >= STM_FTRACE_NEST_MAX)) {
+		this_cpu_dec(stm_ftrace_buf.nest);
+		preempt_enable_notrace();
+		return NULL;
+	}
+
+	ent = (struct trace_entry *)this_cpu_ptr(&stm_ftrace_buf)->buf[nest];
+	tracing_generic_entry_update(ent, fbuffer->flags, fbuffer->pc);
+	ent->type = trace_file->event_call->event.type;
+
+	fbuffer->buffer = NULL;
+	fbuffer->event = NULL;
+	fbuffer->trace_file = trace_file;
+	fbuffer->entry = ent;
+
+	return ent;
+}
+EXPORT_SYMBOL(trace_event_stm_reserve);
+
+/*
+ * trace_event_stm_commit - send an event built by trace_event_stm_reserve()
+ *
+ * The record is sent as an OST packet of the ftrace events entity; the STM
+ * timestamps the packet itself so no trace clock read is needed here.
+ */
+void trace_event_stm_commit(struct trace_event_buffer *fbuffer,
+			    unsigned long len)
+{
+	stm_trace(STM_FLAG_TIMESTAMPED, OST_ENTITY_FTRACE_EVENTS, 0,
+		  fbuffer->entry, len);
+
+	this_cpu_dec(stm_ftrace_buf.nest);
+	preempt_enable_notrace();
+}
+EXPORT_SYMBOL(trace_event_stm_commit);
+
+void stm_set_ftrace_bypass(bool enable)
+{
+	if (enable)
+		static_branch_enable(&trace_stm_bypass_key);
+	else
+		static_branch_disable(&trace_stm_bypass_key);
+}
+EXPORT_SYMBOL(stm_set_ftrace_bypass);
+
+bool stm_ftrace_bypass(void)
+{
+	return static_key_enabled(&trace_stm_bypass_key);
+}
+EXPORT_SYMBOL(stm_ftrace_bypass);
+
 int stm_set_ost_params(struct stm_drvdata *drvdata, size_t bitmap_size)
 {
 	drvdata->chs.bitmap = devm_kzalloc(drvdata->dev, bitmap_size,
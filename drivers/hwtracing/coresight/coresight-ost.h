@@ -25,6 +25,9 @@ extern ssize_t stm_ost_packet(struct stm_data *stm_data,
 
 extern int stm_set_ost_params(struct stm_drvdata *drvdata,
 			      size_t bitmap_size);
+
+extern void stm_set_ftrace_bypass(bool enable);
+extern bool stm_ftrace_bypass(void);
 #else
 static inline bool stm_ost_configured(void) { return 0; }
 
@@ -40,5 +43,8 @@ static inline int stm_set_ost_params(struct stm_drvdata *drvdata,
 {
 	return 0;
 }
+
+static inline void stm_set_ftrace_bypass(bool enable) {}
+static inline bool stm_ftrace_bypass(void) { return false; }
 #endif
 #endif
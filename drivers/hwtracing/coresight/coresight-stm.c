@@ -621,6 +621,36 @@ static ssize_t entities_store(struct device *dev,
 }
 static DEVICE_ATTR_RW(entities);
 
+static ssize_t ftrace_bypass_show(struct device *dev,
+				  struct device_attribute *attr, char *buf)
+{
+	return scnprintf(buf, PAGE_SIZE, "%d\n", stm_ftrace_bypass());
+}
+
+/*
+ * When set, ftrace events selected through the usual event controls are
+ * no longer recorded in the ring buffer but sent only over STM, as the
+ * OST_ENTITY_FTRACE_EVENTS entity, to whatever sink (typically the ETR)
+ * the STM is routed to.
+ */
+static ssize_t ftrace_bypass_store(struct device *dev,
+				   struct device_attribute *attr,
+				   const char *buf, size_t size)
+{
+	bool val;
+
+	if (strtobool(buf, &val))
+		return -EINVAL;
+
+	if (!stm_ost_configured())
+		return -EPERM;
+
+	stm_set_ftrace_bypass(val);
+
+	return size;
+}
+static DEVICE_ATTR_RW(ftrace_bypass);
+
 #define coresight_stm_simple_func(name, offset)	\
 	coresight_simple_func(struct stm_drvdata, NULL, name, offset)
 
@@ -644,6 +674,7 @@ static struct attribute *coresight_stm_attrs[] = {
 	&dev_attr_port_select.attr,
 	&dev_attr_traceid.attr,
 	&dev_attr_entities.attr,
+	&dev_attr_ftrace_bypass.attr,
 	NULL,
 };
 
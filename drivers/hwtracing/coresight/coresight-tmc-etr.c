@@ -15,7 +15,6 @@
  * this program.  If not, see <http://www.gnu.org/licenses/>.
  */
 
-#include <linux/circ_buf.h>
 #include <linux/coresight.h>
 #include <linux/dma-mapping.h>
 #include <linux/slab.h>
@@ -422,38 +421,34 @@ static void tmc_etr_mem_reset(struct tmc_drvdata *drvdata)
 /**
  * struct cs_etr_buffer - keep track of a recording session' specifics
  * @tmc:	generic portion of the TMC buffers
- * @paddr:	the physical address of a DMA'able contiguous memory area
- * @vaddr:	the virtual address associated to @paddr
- * @size:	how much memory we have, starting at @paddr
- * @dev:	the device @vaddr has been tied to
+ * @sg_tbls:	scatter gather tables pointing the ETR at the perf AUX pages
+ * @nr_tbls:	number of table pages in @sg_tbls
+ * @size:	size of the AUX area, in bytes
  */
 struct cs_etr_buffers {
 	struct cs_buffers	tmc;
-	dma_addr_t		paddr;
-	void __iomem		*vaddr;
+	uint32_t		**sg_tbls;
+	int			nr_tbls;
 	u32			size;
-	struct device		*dev;
 };
 
-void tmc_etr_enable_hw(struct tmc_drvdata *drvdata)
+static void __tmc_etr_enable_hw(struct tmc_drvdata *drvdata, dma_addr_t paddr,
+				u32 size, bool sg, phys_addr_t rwp)
 {
 	u32 axictl;
 
-	/* Zero out the memory to help with debug */
-	tmc_etr_mem_reset(drvdata);
-
 	CS_UNLOCK(drvdata->base);
 
 	/* Wait for TMCSReady bit to be set */
 	tmc_wait_for_tmcready(drvdata);
 
-	writel_relaxed(drvdata->size / 4, drvdata->base + TMC_RSZ);
+	writel_relaxed(size / 4, drvdata->base + TMC_RSZ);
 	writel_relaxed(TMC_MODE_CIRCULAR_BUFFER, drvdata->base + TMC_MODE);
 
 	axictl = readl_relaxed(drvdata->base + TMC_AXICTL);
 	axictl |= TMC_AXICTL_WR_BURST_16;
 	writel_relaxed(axictl, drvdata->base + TMC_AXICTL);
-	if (drvdata->memtype == TMC_ETR_MEM_TYPE_CONTIG)
+	if (!sg)
 		axictl &= ~TMC_AXICTL_SCT_GAT_MODE;
 	else
 		axictl |= TMC_AXICTL_SCT_GAT_MODE;
@@ -466,9 +461,15 @@ void tmc_etr_enable_hw(struct tmc_drvdata *drvdata)
 		  TMC_AXICTL_CACHE_CTL_B0 | TMC_AXICTL_CACHE_CTL_B1;
 	writel_relaxed(axictl, drvdata->base + TMC_AXICTL);
 
-	writel_relaxed(drvdata->paddr, drvdata->base + TMC_DBALO);
-	writel_relaxed(((u64)drvdata->paddr >> 32) & 0xFF,
-		       drvdata->base + TMC_DBAHI);
+	writel_relaxed(paddr, drvdata->base + TMC_DBALO);
+	writel_relaxed(((u64)paddr >> 32) & 0xFF, drvdata->base + TMC_DBAHI);
+
+	/* Start writing somewhere else than at the beginning of the buffer */
+	if (rwp) {
+		writel_relaxed(lower_32_bits(rwp), drvdata->base + TMC_RWP);
+		writel_relaxed(upper_32_bits(rwp) & 0xFF,
+			       drvdata->base + TMC_RWPHI);
+	}
 
 	writel_relaxed(TMC_FFCR_EN_FMT | TMC_FFCR_EN_TI |
 		       TMC_FFCR_FON_FLIN | TMC_FFCR_FON_TRIG_EVT |
@@ -480,6 +481,70 @@ void tmc_etr_enable_hw(struct tmc_drvdata *drvdata)
 	CS_LOCK(drvdata->base);
 }
 
+void tmc_etr_enable_hw(struct tmc_drvdata *drvdata)
+{
+	/* Zero out the memory to help with debug */
+	tmc_etr_mem_reset(drvdata);
+
+	__tmc_etr_enable_hw(drvdata, drvdata->paddr, drvdata->size,
+			    drvdata->memtype != TMC_ETR_MEM_TYPE_CONTIG, 0);
+}
+
+static phys_addr_t tmc_etr_perf_page_phys(struct cs_etr_buffers *buf, int i)
+{
+	i = (buf->tmc.cur + i) & (buf->tmc.nr_pages - 1);
+
+	return virt_to_phys(buf->tmc.data_pages[i]);
+}
+
+/*
+ * Point the ETR straight at the perf AUX pages, following the scatter
+ * gather layout of tmc_etr_sg_tbl_alloc(). The table starts with the page
+ * holding the current head, so TMC_STS_FULL is only raised once the whole
+ * AUX area has been written during this run.
+ */
+static void tmc_etr_perf_sg_build(struct cs_etr_buffers *buf)
+{
+	int i = 0, n, t;
+	int nr_pages = buf->tmc.nr_pages;
+	int ents_per_blk = PAGE_SIZE/sizeof(uint32_t);
+	uint32_t *virt_st_tbl;
+
+	for (t = 0; t < buf->nr_tbls; t++) {
+		virt_st_tbl = buf->sg_tbls[t];
+
+		for (n = 0; n < ents_per_blk - 1 && i < nr_pages - 1; n++, i++)
+			virt_st_tbl[n] =
+			     TMC_ETR_SG_ENT(tmc_etr_perf_page_phys(buf, i));
+
+		if (t < buf->nr_tbls - 1)
+			virt_st_tbl[n] =
+			     TMC_ETR_SG_NXT_TBL(virt_to_phys(buf->sg_tbls[t + 1]));
+		else
+			virt_st_tbl[n] =
+			     TMC_ETR_SG_LST_ENT(tmc_etr_perf_page_phys(buf, i));
+
+		dmac_flush_range((void *)virt_st_tbl,
+				 (void *)virt_st_tbl + PAGE_SIZE);
+	}
+}
+
+/* Offset of @rwp from the start of the page holding the session's head */
+static long tmc_etr_perf_rwp_offset(struct cs_etr_buffers *buf,
+				    phys_addr_t rwp)
+{
+	int i;
+	phys_addr_t phys;
+
+	for (i = 0; i < buf->tmc.nr_pages; i++) {
+		phys = tmc_etr_perf_page_phys(buf, i);
+		if (phys <= rwp && rwp < (phys + PAGE_SIZE))
+			return i * PAGE_SIZE + (rwp - phys);
+	}
+
+	return -EINVAL;
+}
+
 static void tmc_etr_dump_hw(struct tmc_drvdata *drvdata)
 {
 	u32 rwp, val;
@@ -870,6 +935,7 @@ static int tmc_enable_etr_sink_perf(struct coresight_device *csdev)
 {
 	int ret = 0;
 	unsigned long flags;
+	struct cs_etr_buffers *buf;
 	struct tmc_drvdata *drvdata = dev_get_drvdata(csdev->dev.parent);
 
 	spin_lock_irqsave(&drvdata->spinlock, flags);
@@ -883,13 +949,16 @@ static int tmc_enable_etr_sink_perf(struct coresight_device *csdev)
 	 * is also no need to continue if the ETR is already operated
 	 * from sysFS.
 	 */
-	if (drvdata->mode != CS_MODE_DISABLED) {
+	if (drvdata->mode != CS_MODE_DISABLED || !drvdata->perf_buf) {
 		ret = -EINVAL;
 		goto out;
 	}
 
+	buf = drvdata->perf_buf;
 	drvdata->mode = CS_MODE_PERF;
-	tmc_etr_enable_hw(drvdata);
+	__tmc_etr_enable_hw(drvdata, virt_to_phys(buf->sg_tbls[0]), buf->size,
+			    true, tmc_etr_perf_page_phys(buf, 0) +
+			    buf->tmc.offset);
 out:
 	spin_unlock_irqrestore(&drvdata->spinlock, flags);
 
@@ -970,9 +1039,9 @@ static void tmc_abort_etr_sink(struct coresight_device *csdev)
 static void *tmc_alloc_etr_buffer(struct coresight_device *csdev, int cpu,
 				  void **pages, int nr_pages, bool overwrite)
 {
-	int node;
+	int node, i;
 	struct cs_etr_buffers *buf;
-	struct tmc_drvdata *drvdata = dev_get_drvdata(csdev->dev.parent);
+	int ents_per_blk = PAGE_SIZE/sizeof(uint32_t);
 
 	if (cpu == -1)
 		cpu = smp_processor_id();
@@ -983,27 +1052,50 @@ static void *tmc_alloc_etr_buffer(struct coresight_device *csdev, int cpu,
 	if (!buf)
 		return NULL;
 
-	buf->dev = drvdata->dev;
-	buf->size = drvdata->size;
-	buf->vaddr = dma_alloc_coherent(buf->dev, buf->size,
-					&buf->paddr, GFP_KERNEL);
-	if (!buf->vaddr) {
+	/*
+	 * The ETR writes the trace straight into the AUX pages through a
+	 * scatter gather table, only the table itself is allocated here.
+	 */
+	buf->size = nr_pages << PAGE_SHIFT;
+	buf->nr_tbls = max(1, DIV_ROUND_UP(nr_pages - 1, ents_per_blk - 1));
+	buf->sg_tbls = kcalloc(buf->nr_tbls, sizeof(*buf->sg_tbls),
+			       GFP_KERNEL);
+	if (!buf->sg_tbls) {
 		kfree(buf);
 		return NULL;
 	}
 
+	for (i = 0; i < buf->nr_tbls; i++) {
+		buf->sg_tbls[i] = (uint32_t *)get_zeroed_page(GFP_KERNEL);
+		if (!buf->sg_tbls[i])
+			goto err;
+	}
+
+	/* perf zeroed the pages, write that back before the ETR owns them */
+	for (i = 0; i < nr_pages; i++)
+		dmac_flush_range(pages[i], pages[i] + PAGE_SIZE);
+
 	buf->tmc.snapshot = overwrite;
 	buf->tmc.nr_pages = nr_pages;
 	buf->tmc.data_pages = pages;
 
 	return buf;
+err:
+	while (--i >= 0)
+		free_page((unsigned long)buf->sg_tbls[i]);
+	kfree(buf->sg_tbls);
+	kfree(buf);
+	return NULL;
 }
 
 static void tmc_free_etr_buffer(void *config)
 {
+	int i;
 	struct cs_etr_buffers *buf = config;
 
-	dma_free_coherent(buf->dev, buf->size, buf->vaddr, buf->paddr);
+	for (i = 0; i < buf->nr_tbls; i++)
+		free_page((unsigned long)buf->sg_tbls[i]);
+	kfree(buf->sg_tbls);
 	kfree(buf);
 }
 
@@ -1017,7 +1109,7 @@ static int tmc_set_etr_buffer(struct coresight_device *csdev,
 	struct tmc_drvdata *drvdata = dev_get_drvdata(csdev->dev.parent);
 
 	/* wrap head around to the amount of space we have */
-	head = handle->head & ((buf->tmc.nr_pages << PAGE_SHIFT) - 1);
+	head = handle->head & (buf->size - 1);
 
 	/* find the page to write to */
 	buf->tmc.cur = head / PAGE_SIZE;
@@ -1028,9 +1120,8 @@ static int tmc_set_etr_buffer(struct coresight_device *csdev,
 	local_set(&buf->tmc.data_size, 0);
 
 	/* Tell the HW where to put the trace data */
-	drvdata->vaddr = buf->vaddr;
-	drvdata->paddr = buf->paddr;
-	memset(drvdata->vaddr, 0, drvdata->size);
+	tmc_etr_perf_sg_build(buf);
+	drvdata->perf_buf = buf;
 
 	return ret;
 }
@@ -1066,8 +1157,7 @@ static unsigned long tmc_reset_etr_buffer(struct coresight_device *csdev,
 	}
 
 	/* Get ready for another run */
-	drvdata->vaddr = NULL;
-	drvdata->paddr = 0;
+	drvdata->perf_buf = NULL;
 
 	return size;
 }
@@ -1076,12 +1166,13 @@ static void tmc_update_etr_buffer(struct coresight_device *csdev,
 				  struct perf_output_handle *handle,
 				  void *sink_config)
 {
-	int i, cur;
-	u32 *buf_ptr;
-	u32 read_ptr, write_ptr;
-	u32 status, to_read;
-	unsigned long offset;
-	struct cs_buffers *buf = sink_config;
+	int i, nr_pages;
+	long pos;
+	u32 status;
+	phys_addr_t rwp;
+	unsigned long to_read;
+	void *page;
+	struct cs_etr_buffers *buf = sink_config;
 	struct tmc_drvdata *drvdata = dev_get_drvdata(csdev->dev.parent);
 
 	if (!buf)
@@ -1095,95 +1186,55 @@ static void tmc_update_etr_buffer(struct coresight_device *csdev,
 
 	tmc_flush_and_stop(drvdata);
 
-	read_ptr = readl_relaxed(drvdata->base + TMC_RRP);
-	write_ptr = readl_relaxed(drvdata->base + TMC_RWP);
-
-	/*
-	 * Get a hold of the status register and see if a wrap around
-	 * has occurred.  If so adjust things accordingly.
-	 */
+	rwp = readl_relaxed(drvdata->base + TMC_RWP) |
+	      ((u64)(readl_relaxed(drvdata->base + TMC_RWPHI) & 0xFF) << 32);
 	status = readl_relaxed(drvdata->base + TMC_STS);
-	if (status & TMC_STS_FULL) {
-		local_inc(&buf->lost);
-		to_read = drvdata->size;
-	} else {
-		to_read = CIRC_CNT(write_ptr, read_ptr, drvdata->size);
+
+	CS_LOCK(drvdata->base);
+
+	pos = tmc_etr_perf_rwp_offset(buf, rwp);
+	if (WARN_ON_ONCE(pos < 0)) {
+		local_inc(&buf->tmc.lost);
+		return;
 	}
 
 	/*
-	 * The TMC RAM buffer may be bigger than the space available in the
-	 * perf ring buffer (handle->size).  If so advance the RRP so that we
-	 * get the latest trace data.
+	 * The trace went straight to the AUX pages, all that is left to do
+	 * is to work out how much of it there is. A full buffer means the
+	 * ETR came around past the session's head and overwrote some of it.
 	 */
-	if (to_read > handle->size) {
-		u32 buffer_start, mask = 0;
-
-		/* Read buffer start address in system memory */
-		buffer_start = readl_relaxed(drvdata->base + TMC_DBALO);
-
-		/*
-		 * The value written to RRP must be byte-address aligned to
-		 * the width of the trace memory databus _and_ to a frame
-		 * boundary (16 byte), whichever is the biggest. For example,
-		 * for 32-bit, 64-bit and 128-bit wide trace memory, the four
-		 * LSBs must be 0s. For 256-bit wide trace memory, the five
-		 * LSBs must be 0s.
-		 */
-		switch (drvdata->memwidth) {
-		case TMC_MEM_INTF_WIDTH_32BITS:
-		case TMC_MEM_INTF_WIDTH_64BITS:
-		case TMC_MEM_INTF_WIDTH_128BITS:
-			mask = GENMASK(31, 5);
-			break;
-		case TMC_MEM_INTF_WIDTH_256BITS:
-			mask = GENMASK(31, 6);
-			break;
-		}
-
-		/*
-		 * Make sure the new size is aligned in accordance with the
-		 * requirement explained above.
-		 */
-		to_read = handle->size & mask;
-		/* Move the RAM read pointer up */
-		read_ptr = (write_ptr + drvdata->size) - to_read;
-		/* Make sure we are still within our limits */
-		if (read_ptr > (buffer_start + (drvdata->size - 1)))
-			read_ptr -= drvdata->size;
-		/* Tell the HW */
-		writel_relaxed(read_ptr, drvdata->base + TMC_RRP);
-		local_inc(&buf->lost);
+	if (status & TMC_STS_FULL || pos < buf->tmc.offset) {
+		local_inc(&buf->tmc.lost);
+		to_read = buf->size;
+		nr_pages = buf->tmc.nr_pages;
+	} else {
+		to_read = pos - buf->tmc.offset;
+		nr_pages = DIV_ROUND_UP(pos, PAGE_SIZE);
 	}
 
-	cur = buf->cur;
-	offset = buf->offset;
-
-	/* for every byte to read */
-	for (i = 0; i < to_read; i += 4) {
-		buf_ptr = buf->data_pages[cur] + offset;
-		*buf_ptr = readl_relaxed(drvdata->base + TMC_RRD);
-
-		offset += 4;
-		if (offset >= PAGE_SIZE) {
-			offset = 0;
-			cur++;
-			/* wrap around at the end of the buffer */
-			cur &= buf->nr_pages - 1;
-		}
+	/* The ETR isn't coherent, drop whatever the CPU cached meanwhile */
+	for (i = 0; i < nr_pages; i++) {
+		page = buf->tmc.data_pages[(buf->tmc.cur + i) &
+					   (buf->tmc.nr_pages - 1)];
+		dmac_inv_range(page, page + PAGE_SIZE);
 	}
 
 	/*
 	 * In snapshot mode all we have to do is communicate to
 	 * perf_aux_output_end() the address of the current head.  In full
 	 * trace mode the same function expects a size to move rb->aux_head
-	 * forward.
+	 * forward, which can't go past the space perf gave us.
 	 */
-	if (buf->snapshot)
-		local_set(&buf->data_size, (cur * PAGE_SIZE) + offset);
-	else
-		local_add(to_read, &buf->data_size);
-
-	CS_LOCK(drvdata->base);
+	if (buf->tmc.snapshot) {
+		local_set(&buf->tmc.data_size,
+			  (buf->tmc.cur * PAGE_SIZE + pos) & (buf->size - 1));
+	} else {
+		if (to_read > handle->size) {
+			local_inc(&buf->tmc.lost);
+			to_read = handle->size;
+		}
+		local_add(to_read, &buf->tmc.data_size);
+	}
 }
 
 static const struct coresight_ops_sink tmc_etr_sink_ops = {
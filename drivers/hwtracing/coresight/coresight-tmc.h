@@ -129,6 +129,8 @@ static const char * const str_tmc_etr_out_mode[] = {
 	[TMC_ETR_OUT_MODE_USB]		= "usb",
 };
 
+struct cs_etr_buffers;
+
 struct tmc_etr_bam_data {
 	struct sps_bam_props	props;
 	unsigned long		handle;
@@ -193,6 +195,7 @@ struct tmc_drvdata {
 	const char		*csr_name;
 	struct byte_cntr	*byte_cntr;
 	bool			force_reg_dump;
+	struct cs_etr_buffers	*perf_buf;
 };
 
 /* Generic functions */
@@ -643,6 +643,9 @@ static int fts_read_touchdata(struct fts_ts_data *data)
 	u8 pointid = FTS_MAX_ID;
 	int ret = -1;
 	int i;
+#if !FTS_READ_TOUCH_BUFFER_DIVIDED
+	int slots, len, point_num;
+#endif
 	struct ts_event *event = &(data->event);
 
 #if FTS_GESTURE_EN
@@ -684,12 +687,35 @@ static int fts_read_touchdata(struct fts_ts_data *data)
 				(event->point_num - 1) * FTS_ONE_TCH_LEN);
 	}
 #else
-	ret = fts_i2c_read(data->client, buf, 1, buf, POINT_READ_BUF);
+	/*
+	 * Only fetch as many points as were present last time, which also
+	 * covers the slots of fingers lifted since; the rest of the buffer
+	 * is read only when more fingers came down.
+	 */
+	slots = clamp_t(int, data->read_points, 1,
+			data->pdata->max_touch_number);
+	len = 3 + FTS_ONE_TCH_LEN * slots;
+	memset(buf + len, 0xFF, POINT_READ_BUF - len);
+
+	ret = fts_i2c_read(data->client, buf, 1, buf, len);
 	if (ret < 0) {
 		FTS_ERROR("[B]Read touchdata failed, ret: %d", ret);
 		return ret;
 	}
 
+	point_num = buf[FTS_TOUCH_POINT_NUM] & 0x0F;
+	if (point_num > data->pdata->max_touch_number)
+		point_num = data->pdata->max_touch_number;
+	if (point_num > slots) {
+		buf[len] = len;
+		ret = fts_i2c_read(data->client, buf + len, 1, buf + len,
+				(point_num - slots) * FTS_ONE_TCH_LEN);
+		if (ret < 0) {
+			FTS_ERROR("[B]Read touchdata failed, ret: %d", ret);
+			return ret;
+		}
+	}
+
 #if FTS_POINT_REPORT_CHECK_EN
 	fts_point_report_check_queue_work();
 #endif
@@ -743,6 +769,7 @@ static int fts_read_touchdata(struct fts_ts_data *data)
 		}
 	}
 
+	data->read_points = event->touch_point;
 	if (event->touch_point == 0)
 		return -EINVAL;
 
@@ -778,6 +805,42 @@ static void fts_report_value(struct fts_ts_data *data)
 
 }
 
+/*****************************************************************************
+ *  Name: fts_ts_update_latency
+ *  Brief: account the time from the hard irq to the reported frame
+ *  Input:
+ *  Output:
+ *  Return:
+ *****************************************************************************/
+static void fts_ts_update_latency(struct fts_ts_data *data)
+{
+	struct fts_ts_latency *lat = &data->latency;
+	s64 us = ktime_us_delta(ktime_get(), data->irq_time);
+
+	lat->count++;
+	lat->last_us = us;
+	lat->total_us += us;
+	if (us > lat->max_us)
+		lat->max_us = us;
+}
+
+/*****************************************************************************
+ *  Name: fts_ts_hardirq
+ *  Brief: timestamp the interrupt before the threaded handler runs
+ *  Input:
+ *  Output:
+ *  Return:
+ *****************************************************************************/
+static irqreturn_t fts_ts_hardirq(int irq, void *dev_id)
+{
+	struct fts_ts_data *fts_ts = dev_id;
+
+	if (fts_ts)
+		fts_ts->irq_time = ktime_get();
+
+	return IRQ_WAKE_THREAD;
+}
+
 /*****************************************************************************
  *  Name: fts_ts_interrupt
  *  Brief:
@@ -804,6 +867,7 @@ static irqreturn_t fts_ts_interrupt(int irq, void *dev_id)
 	if (ret == 0) {
 		mutex_lock(&fts_wq_data->report_mutex);
 		fts_report_value(fts_wq_data);
+		fts_ts_update_latency(fts_wq_data);
 		mutex_unlock(&fts_wq_data->report_mutex);
 	}
 
@@ -992,6 +1056,13 @@ static int fts_parse_dt(struct device *dev, struct fts_ts_platform_data *pdata)
 	pdata->wakeup_gestures_en = of_property_read_bool(np,
 			"focaltech,wakeup-gestures-en");
 
+	rc = of_property_read_u32(np, "focaltech,irq-cpu", &temp_val);
+	if (!rc && temp_val < nr_cpu_ids) {
+		pdata->irq_cpu = temp_val;
+		pdata->have_irq_cpu = true;
+		FTS_DEBUG("irq_cpu=%d", pdata->irq_cpu);
+	}
+
 	FTS_FUNC_EXIT();
 	return 0;
 }
@@ -1148,7 +1219,8 @@ static int fts_ts_probe(struct i2c_client *client,
 	fts_reset_proc(200);
 	fts_wait_tp_to_valid(client);
 
-	err = request_threaded_irq(client->irq, NULL, fts_ts_interrupt,
+	err = request_threaded_irq(client->irq, fts_ts_hardirq,
+				fts_ts_interrupt,
 				pdata->irq_gpio_flags | IRQF_ONESHOT |
 				IRQF_TRIGGER_FALLING,
 				client->dev.driver->name, data);
@@ -1157,6 +1229,9 @@ static int fts_ts_probe(struct i2c_client *client,
 		goto free_gpio;
 	}
 
+	if (pdata->have_irq_cpu && cpu_online(pdata->irq_cpu))
+		irq_set_affinity_hint(client->irq, cpumask_of(pdata->irq_cpu));
+
 	fts_irq_disable();
 
 #if FTS_PSENSOR_EN
@@ -1266,6 +1341,7 @@ static int fts_ts_remove(struct i2c_client *client)
 #elif defined(CONFIG_HAS_EARLYSUSPEND)
 	unregister_early_suspend(&data->early_suspend);
 #endif
+	irq_set_affinity_hint(client->irq, NULL);
 	free_irq(client->irq, data);
 
 	if (gpio_is_valid(data->pdata->reset_gpio))
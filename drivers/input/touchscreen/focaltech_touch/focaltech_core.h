@@ -49,6 +49,7 @@
 #include <linux/mutex.h>
 #include <linux/wait.h>
 #include <linux/time.h>
+#include <linux/ktime.h>
 #include <linux/workqueue.h>
 #include <linux/fs.h>
 #include <linux/proc_fs.h>
@@ -123,6 +124,15 @@ struct fts_ts_platform_data {
 	u32 y_min;
 	u32 max_touch_number;
 	bool wakeup_gestures_en;
+	bool have_irq_cpu;
+	u32 irq_cpu;
+};
+
+struct fts_ts_latency {
+	u64 count;
+	s64 last_us;
+	s64 max_us;
+	s64 total_us;
 };
 
 struct ts_event {
@@ -160,6 +170,9 @@ struct fts_ts_data {
 	u8 fw_vendor_id;
 	int touchs;
 	int irq_disable;
+	int read_points;
+	ktime_t irq_time;
+	struct fts_ts_latency latency;
 
 #if defined(CONFIG_FB)
 	struct notifier_block fb_notif;
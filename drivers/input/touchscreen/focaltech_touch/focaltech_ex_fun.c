@@ -392,6 +392,36 @@ static ssize_t fts_irq_show(struct device *dev,
 	return -EPERM;
 }
 
+/*
+ * fts_latency interface
+ *   show: hard irq to reported frame latency in us
+ *   store: any write clears the statistics
+ */
+static ssize_t fts_latency_store(struct device *dev,
+		struct device_attribute *attr, const char *buf, size_t count)
+{
+	mutex_lock(&fts_wq_data->report_mutex);
+	memset(&fts_wq_data->latency, 0, sizeof(fts_wq_data->latency));
+	mutex_unlock(&fts_wq_data->report_mutex);
+
+	return count;
+}
+
+static ssize_t fts_latency_show(struct device *dev,
+		struct device_attribute *attr, char *buf)
+{
+	struct fts_ts_latency lat;
+
+	mutex_lock(&fts_wq_data->report_mutex);
+	lat = fts_wq_data->latency;
+	mutex_unlock(&fts_wq_data->report_mutex);
+
+	return snprintf(buf, PAGE_SIZE,
+			"frames:%llu last:%lld max:%lld avg:%lld\n",
+			lat.count, lat.last_us, lat.max_us,
+			lat.count ? div64_s64(lat.total_us, lat.count) : 0);
+}
+
 /************************************************************************
  * Name: fts_tpfwver_show
  * Brief:  show tp fw vwersion
@@ -1081,6 +1111,8 @@ static DEVICE_ATTR(fts_hw_reset, 0644,
 		fts_hw_reset_show, fts_hw_reset_store);
 static DEVICE_ATTR(fts_irq, 0644,
 		fts_irq_show, fts_irq_store);
+static DEVICE_ATTR(fts_latency, 0644,
+		fts_latency_show, fts_latency_store);
 
 #if FTS_ESDCHECK_EN
 static DEVICE_ATTR(fts_esd_check, 0644,
@@ -1099,6 +1131,7 @@ static struct attribute *fts_attributes[] = {
 	&dev_attr_fts_module_config.attr,
 	&dev_attr_fts_hw_reset.attr,
 	&dev_attr_fts_irq.attr,
+	&dev_attr_fts_latency.attr,
 #if FTS_ESDCHECK_EN
 	&dev_attr_fts_esd_check.attr,
 #endif
@@ -114,13 +114,39 @@ struct req_dm_crypt_io {
 struct req_dm_split_req_io {
 	struct work_struct work;
 	struct scatterlist *req_split_sg_read;
+	struct scatterlist *req_split_sg_out;
 	struct req_crypt_result result;
 	struct crypto_engine_entry *engine;
 	u8 IV[AES_XTS_IV_LEN];
 	int size;
+	bool encrypt;
 	struct request *clone;
 };
 
+struct req_crypt_cpu_stats {
+	u64 fragments;
+	u64 bytes;
+	u64 busy_ns;
+};
+
+static DEFINE_PER_CPU(struct req_crypt_cpu_stats, req_crypt_stats);
+static atomic_t req_crypt_pending_reqs = ATOMIC_INIT(0);
+static atomic_t req_crypt_inflight_frags = ATOMIC_INIT(0);
+static DECLARE_WAIT_QUEUE_HEAD(req_crypt_frag_wait);
+
+/*
+ * Number of fragments a request is split into for the crypto workers,
+ * 0 means one fragment per crypto engine of the key.
+ */
+static unsigned int req_crypt_max_fragments;
+module_param_named(max_fragments, req_crypt_max_fragments, uint, 0644);
+MODULE_PARM_DESC(max_fragments, "Maximum number of fragments per request");
+
+/* Fragments queued to the crypto workers at once, 0 for no limit */
+static unsigned int req_crypt_max_inflight;
+module_param_named(max_inflight, req_crypt_max_inflight, uint, 0644);
+MODULE_PARM_DESC(max_inflight, "Maximum number of fragments in flight");
+
 #ifdef CONFIG_FIPS_ENABLE
 static struct qcrypto_func_set dm_qcrypto_func;
 #else
@@ -136,7 +162,7 @@ static void req_crypt_cipher_complete
 static void req_cryptd_split_req_queue_cb
 		(struct work_struct *work);
 static void req_cryptd_split_req_queue
-		(struct req_dm_split_req_io *io);
+		(struct req_dm_split_req_io *io, int cpu);
 static void req_crypt_split_io_complete
 		(struct req_crypt_result *res, int err);
 
@@ -273,6 +299,153 @@ static void req_crypt_dec_pending_decrypt(struct req_dm_crypt_io *io)
 	mempool_free(io, req_io_pool);
 }
 
+static bool req_crypt_get_frag_slot(void)
+{
+	unsigned int max = READ_ONCE(req_crypt_max_inflight);
+
+	if (atomic_inc_return(&req_crypt_inflight_frags) <= max || !max)
+		return true;
+
+	atomic_dec(&req_crypt_inflight_frags);
+	return false;
+}
+
+static void req_crypt_put_frag_slot(void)
+{
+	atomic_dec(&req_crypt_inflight_frags);
+	wake_up(&req_crypt_frag_wait);
+}
+
+static int req_crypt_next_cpu(int cpu)
+{
+	cpu = cpumask_next(cpu, cpu_online_mask);
+	if (cpu >= nr_cpu_ids)
+		cpu = cpumask_first(cpu_online_mask);
+	return cpu;
+}
+
+/* Fragments are cut at the same entries of both lists */
+static bool req_crypt_sg_match(struct scatterlist *sg_in,
+			       struct scatterlist *sg_out)
+{
+	for (; sg_in && sg_out; sg_in = sg_next(sg_in), sg_out = sg_next(sg_out))
+		if (sg_in->length != sg_out->length)
+			return false;
+
+	return !sg_in && !sg_out;
+}
+
+/*
+ * Split a request into fragments on scatterlist entry boundaries and run
+ * them on the per-cpu split workers, spreading them over the online CPUs
+ * and over the crypto engines of the key. This only returns once every
+ * fragment has completed so the caller still completes or dispatches the
+ * request as a whole.
+ */
+static int req_crypt_convert_fragments(struct request *clone, u32 key_id,
+				       struct scatterlist *sg_in,
+				       struct scatterlist *sg_out,
+				       unsigned int total_bytes, bool encrypt)
+{
+	struct req_dm_split_req_io *split_io;
+	struct crypto_engine_entry *curr_engine_list = NULL;
+	unsigned int engine_list_total = 0, engine_start = 0;
+	unsigned int *engine_cursor = NULL;
+	unsigned int nr, i, done = 0;
+	struct scatterlist *in = sg_in, *out = sg_out;
+	sector_t tempiv;
+	int cpu, error = 0;
+
+	mutex_lock(&engine_list_mutex);
+	engine_list_total = (key_id == FDE_KEY_ID ? num_engines_fde :
+						   (key_id == PFE_KEY_ID ?
+							num_engines_pfe : 0));
+
+	curr_engine_list = (key_id == FDE_KEY_ID ? fde_eng :
+						(key_id == PFE_KEY_ID ?
+						pfe_eng : NULL));
+
+	engine_cursor = (key_id == FDE_KEY_ID ? &fde_cursor :
+					(key_id == PFE_KEY_ID ? &pfe_cursor
+					: NULL));
+	if (engine_list_total && curr_engine_list && engine_cursor) {
+		engine_start = *engine_cursor;
+		(*engine_cursor)++;
+		(*engine_cursor) %= engine_list_total;
+	}
+	mutex_unlock(&engine_list_mutex);
+
+	if ((engine_list_total < 1) || (curr_engine_list == NULL)) {
+		DMERR("%s Unknown Key ID!\n", __func__);
+		return DM_REQ_CRYPT_ERROR;
+	}
+
+	nr = READ_ONCE(req_crypt_max_fragments);
+	if (!nr)
+		nr = engine_list_total;
+	nr = clamp_t(unsigned int, total_bytes / MIN_CRYPTO_TRANSFER_SIZE,
+		     1, nr);
+	if (nr > 1 && sg_in != sg_out && !req_crypt_sg_match(sg_in, sg_out))
+		nr = 1;
+
+	split_io = kcalloc(nr, sizeof(struct req_dm_split_req_io), GFP_NOIO);
+	if (!split_io) {
+		DMERR("%s split_io allocation failed\n", __func__);
+		return DM_REQ_CRYPT_ERROR;
+	}
+
+	cpu = raw_smp_processor_id();
+	for (i = 0; i < nr && in; i++) {
+		struct req_dm_split_req_io *frag = &split_io[i];
+		unsigned int target = (total_bytes - done) / (nr - i);
+
+		frag->req_split_sg_read = in;
+		frag->req_split_sg_out = out;
+		while (in) {
+			struct scatterlist *next_in = sg_next(in);
+			struct scatterlist *next_out = sg_next(out);
+
+			frag->size += in->length;
+			if (i < nr - 1 && frag->size >= target) {
+				sg_mark_end(in);
+				sg_mark_end(out);
+				in = next_in;
+				out = next_out;
+				break;
+			}
+			in = next_in;
+			out = next_out;
+		}
+
+		frag->engine = &curr_engine_list[(engine_start + i) %
+						 engine_list_total];
+		frag->encrypt = encrypt;
+		frag->clone = clone;
+		init_completion(&frag->result.completion);
+		tempiv = clone->__sector + (done / SECTOR_SIZE);
+		memcpy(&frag->IV, &tempiv, sizeof(sector_t));
+		done += frag->size;
+
+		wait_event(req_crypt_frag_wait, req_crypt_get_frag_slot());
+		req_cryptd_split_req_queue(frag, cpu);
+		cpu = req_crypt_next_cpu(cpu);
+	}
+	nr = i;
+
+	/* wait for all of them, they still reference the request */
+	for (i = 0; i < nr; i++) {
+		wait_for_completion_io(&split_io[i].result.completion);
+		if (split_io[i].result.err && !error) {
+			DMERR("%s error = %d for fragment %u\n",
+			      __func__, split_io[i].result.err, i);
+			error = DM_REQ_CRYPT_ERROR;
+		}
+	}
+
+	kfree(split_io);
+	return error;
+}
+
 /*
  * The callback that will be called by the worker queue to perform Decryption
  * for reads and use the dm function to complete the bios and requests.
@@ -281,16 +454,9 @@ static void req_cryptd_crypt_read_convert(struct req_dm_crypt_io *io)
 {
 	struct request *clone = NULL;
 	int error = DM_REQ_CRYPT_ERROR;
-	int total_sg_len = 0, total_bytes_in_req = 0, temp_size = 0, i = 0;
-	struct scatterlist *sg = NULL;
+	int total_sg_len = 0, total_bytes_in_req = 0;
 	struct scatterlist *req_sg_read = NULL;
 
-	unsigned int engine_list_total = 0;
-	struct crypto_engine_entry *curr_engine_list = NULL;
-	bool split_transfers = 0;
-	sector_t tempiv;
-	struct req_dm_split_req_io *split_io = NULL;
-
 	if (io) {
 		error = io->error;
 		if (io->cloned_request) {
@@ -310,18 +476,6 @@ static void req_cryptd_crypt_read_convert(struct req_dm_crypt_io *io)
 
 	req_crypt_inc_pending(io);
 
-	mutex_lock(&engine_list_mutex);
-
-	engine_list_total = (io->key_id == FDE_KEY_ID ? num_engines_fde :
-						   (io->key_id == PFE_KEY_ID ?
-							num_engines_pfe : 0));
-
-	curr_engine_list = (io->key_id == FDE_KEY_ID ? fde_eng :
-						   (io->key_id == PFE_KEY_ID ?
-							pfe_eng : NULL));
-
-	mutex_unlock(&engine_list_mutex);
-
 	req_sg_read = (struct scatterlist *)mempool_alloc(req_scatterlist_pool,
 								GFP_KERNEL);
 	if (!req_sg_read) {
@@ -347,89 +501,12 @@ static void req_cryptd_crypt_read_convert(struct req_dm_crypt_io *io)
 		goto skcipher_req_alloc_failure;
 	}
 
-
-	if ((clone->__data_len >= (MIN_CRYPTO_TRANSFER_SIZE *
-		engine_list_total))
-		&& (engine_list_total > 1))
-		split_transfers = 1;
-
-	if (split_transfers) {
-		split_io = kzalloc(sizeof(struct req_dm_split_req_io)
-				* engine_list_total, GFP_KERNEL);
-		if (!split_io) {
-			DMERR("%s split_io allocation failed\n", __func__);
-			error = DM_REQ_CRYPT_ERROR;
-			goto skcipher_req_alloc_failure;
-		}
-
-		split_io[0].req_split_sg_read = sg = req_sg_read;
-		split_io[engine_list_total - 1].size = total_bytes_in_req;
-		for (i = 0; i < (engine_list_total); i++) {
-			while ((sg) && i < (engine_list_total - 1)) {
-				split_io[i].size += sg->length;
-				split_io[engine_list_total - 1].size -=
-						sg->length;
-				if (split_io[i].size >=
-						(total_bytes_in_req /
-							engine_list_total)) {
-					split_io[i + 1].req_split_sg_read =
-							sg_next(sg);
-					sg_mark_end(sg);
-					break;
-				}
-				sg = sg_next(sg);
-			}
-			split_io[i].engine = &curr_engine_list[i];
-			init_completion(&split_io[i].result.completion);
-			memset(&split_io[i].IV, 0, AES_XTS_IV_LEN);
-			tempiv = clone->__sector + (temp_size / SECTOR_SIZE);
-			memcpy(&split_io[i].IV, &tempiv, sizeof(sector_t));
-			temp_size +=  split_io[i].size;
-			split_io[i].clone = clone;
-			req_cryptd_split_req_queue(&split_io[i]);
-		}
-	} else {
-		split_io = kzalloc(sizeof(struct req_dm_split_req_io),
-				GFP_KERNEL);
-		if (!split_io) {
-			DMERR("%s split_io allocation failed\n", __func__);
-			error = DM_REQ_CRYPT_ERROR;
-			goto skcipher_req_alloc_failure;
-		}
-		split_io->engine = &curr_engine_list[0];
-		init_completion(&split_io->result.completion);
-		memcpy(split_io->IV, &clone->__sector, sizeof(sector_t));
-		split_io->req_split_sg_read = req_sg_read;
-		split_io->size = total_bytes_in_req;
-		split_io->clone = clone;
-		req_cryptd_split_req_queue(split_io);
-	}
-
-	if (!split_transfers) {
-		wait_for_completion_interruptible(&split_io->result.completion);
-		if (split_io->result.err) {
-			DMERR("%s error = %d for request\n",
-				 __func__, split_io->result.err);
-			error = DM_REQ_CRYPT_ERROR;
-			goto skcipher_req_alloc_failure;
-		}
-	} else {
-		for (i = 0; i < (engine_list_total); i++) {
-			wait_for_completion_interruptible(
-					&split_io[i].result.completion);
-			if (split_io[i].result.err) {
-				DMERR("%s error = %d for %dst request\n",
-					 __func__, split_io[i].result.err, i);
-				error = DM_REQ_CRYPT_ERROR;
-				goto skcipher_req_alloc_failure;
-			}
-		}
-	}
-	error = 0;
+	error = req_crypt_convert_fragments(clone, io->key_id, req_sg_read,
+					    req_sg_read, total_bytes_in_req,
+					    false);
 skcipher_req_alloc_failure:
 
 	mempool_free(req_sg_read, req_scatterlist_pool);
-	kfree(split_io);
 submit_request:
 	if (io)
 		io->error = error;
@@ -469,21 +546,13 @@ static void req_cryptd_crypt_write_convert(struct req_dm_crypt_io *io)
 		total_bytes_in_req = 0, error = DM_MAPIO_REMAPPED, rc = 0;
 	struct req_iterator iter;
 	struct req_iterator iter1;
-	struct skcipher_request *req = NULL;
-	struct req_crypt_result result;
 	struct bio_vec bvec;
 	struct scatterlist *req_sg_in = NULL;
 	struct scatterlist *req_sg_out = NULL;
 	int copy_bio_sector_to_req = 0;
 	gfp_t gfp_mask = GFP_NOIO | __GFP_HIGHMEM;
 	struct page *page = NULL;
-	u8 IV[AES_XTS_IV_LEN];
-	int remaining_size = 0, err = 0;
-	struct crypto_engine_entry engine;
-	unsigned int engine_list_total = 0;
-	struct crypto_engine_entry *curr_engine_list = NULL;
-	unsigned int *engine_cursor = NULL;
-
+	int remaining_size = 0;
 
 	if (io) {
 		if (io->cloned_request) {
@@ -503,58 +572,6 @@ static void req_cryptd_crypt_write_convert(struct req_dm_crypt_io *io)
 
 	req_crypt_inc_pending(io);
 
-	req = skcipher_request_alloc(tfm, GFP_KERNEL);
-	if (!req) {
-		DMERR("%s skcipher request allocation failed\n",
-					__func__);
-		error = DM_REQ_CRYPT_ERROR;
-		goto skcipher_req_alloc_failure;
-	}
-
-	skcipher_request_set_callback(req, CRYPTO_TFM_REQ_MAY_BACKLOG,
-				req_crypt_cipher_complete, &result);
-
-	mutex_lock(&engine_list_mutex);
-	engine_list_total = (io->key_id == FDE_KEY_ID ? num_engines_fde :
-						   (io->key_id == PFE_KEY_ID ?
-							num_engines_pfe : 0));
-
-	curr_engine_list = (io->key_id == FDE_KEY_ID ? fde_eng :
-						(io->key_id == PFE_KEY_ID ?
-						pfe_eng : NULL));
-
-	engine_cursor = (io->key_id == FDE_KEY_ID ? &fde_cursor :
-					(io->key_id == PFE_KEY_ID ? &pfe_cursor
-					: NULL));
-	if ((engine_list_total < 1) || (curr_engine_list == NULL) ||
-				(engine_cursor == NULL)) {
-		DMERR("%s Unknown Key ID!\n", __func__);
-		error = DM_REQ_CRYPT_ERROR;
-		mutex_unlock(&engine_list_mutex);
-		goto skcipher_req_alloc_failure;
-	}
-
-	engine = curr_engine_list[*engine_cursor];
-	(*engine_cursor)++;
-	(*engine_cursor) %= engine_list_total;
-
-	err = (dm_qcrypto_func.cipher_set)(req, engine.ce_device,
-				   engine.hw_instance);
-	if (err) {
-		DMERR("%s qcrypto_cipher_set_device_hw failed with err %d\n",
-				__func__, err);
-		mutex_unlock(&engine_list_mutex);
-		goto skcipher_req_alloc_failure;
-	}
-	mutex_unlock(&engine_list_mutex);
-
-	init_completion(&result.completion);
-
-	(dm_qcrypto_func.cipher_flag)(req,
-		QCRYPTO_CTX_USE_PIPE_KEY | QCRYPTO_CTX_XTS_DU_SIZE_512B);
-	crypto_skcipher_clear_flags(tfm, ~0);
-	crypto_skcipher_setkey(tfm, NULL, KEY_SIZE_XTS);
-
 	req_sg_in = (struct scatterlist *)mempool_alloc(req_scatterlist_pool,
 								GFP_KERNEL);
 	if (!req_sg_in) {
@@ -623,34 +640,9 @@ static void req_cryptd_crypt_write_convert(struct req_dm_crypt_io *io)
 		goto skcipher_req_alloc_failure;
 	}
 
-	memset(IV, 0, AES_XTS_IV_LEN);
-	memcpy(IV, &clone->__sector, sizeof(sector_t));
-
-	skcipher_request_set_crypt(req, req_sg_in, req_sg_out,
-			total_bytes_in_req, (void *) IV);
-
-	rc = crypto_skcipher_encrypt(req);
-
-	switch (rc) {
-	case 0:
-		break;
-
-	case -EBUSY:
-		/*
-		 * Lets make this synchronous request by waiting on
-		 * in progress as well
-		 */
-	case -EINPROGRESS:
-		wait_for_completion_interruptible(&result.completion);
-		if (result.err) {
-			DMERR("%s error = %d encrypting the request\n",
-				 __func__, result.err);
-			error = DM_REQ_CRYPT_ERROR_AFTER_PAGE_MALLOC;
-			goto skcipher_req_alloc_failure;
-		}
-		break;
-
-	default:
+	rc = req_crypt_convert_fragments(clone, io->key_id, req_sg_in,
+					 req_sg_out, total_bytes_in_req, true);
+	if (rc) {
 		error = DM_REQ_CRYPT_ERROR_AFTER_PAGE_MALLOC;
 		goto skcipher_req_alloc_failure;
 	}
@@ -668,9 +660,6 @@ static void req_cryptd_crypt_write_convert(struct req_dm_crypt_io *io)
 	blk_recalc_rq_segments(clone);
 
 skcipher_req_alloc_failure:
-	if (req)
-		skcipher_request_free(req);
-
 	if (error == DM_REQ_CRYPT_ERROR_AFTER_PAGE_MALLOC) {
 		rq_for_each_segment(bvec, clone, iter1) {
 			if (bvec.bv_offset == 0) {
@@ -728,6 +717,8 @@ static void req_cryptd_crypt(struct work_struct *work)
 		DMERR("%s received non-write request for Clone 0x%p\n",
 				__func__, io->cloned_request);
 	}
+
+	atomic_dec(&req_crypt_pending_reqs);
 }
 
 static void req_cryptd_split_req_queue_cb(struct work_struct *work)
@@ -738,6 +729,7 @@ static void req_cryptd_split_req_queue_cb(struct work_struct *work)
 	struct req_crypt_result result;
 	int err = 0;
 	struct crypto_engine_entry *engine = NULL;
+	u64 start = ktime_get_ns();
 
 	if ((!io) || (!io->req_split_sg_read) || (!io->engine)) {
 		DMERR("%s Input invalid\n",
@@ -774,9 +766,12 @@ static void req_cryptd_split_req_queue_cb(struct work_struct *work)
 	crypto_skcipher_setkey(tfm, NULL, KEY_SIZE_XTS);
 
 	skcipher_request_set_crypt(req, io->req_split_sg_read,
-			io->req_split_sg_read, io->size, (void *) io->IV);
+			io->req_split_sg_out, io->size, (void *) io->IV);
 
-	err = crypto_skcipher_decrypt(req);
+	if (io->encrypt)
+		err = crypto_skcipher_encrypt(req);
+	else
+		err = crypto_skcipher_decrypt(req);
 	switch (err) {
 	case 0:
 		break;
@@ -801,21 +796,27 @@ static void req_cryptd_split_req_queue_cb(struct work_struct *work)
 		goto skcipher_req_alloc_failure;
 	}
 	err = 0;
+	this_cpu_add(req_crypt_stats.bytes, io->size);
 skcipher_req_alloc_failure:
 	if (req)
 		skcipher_request_free(req);
 
+	this_cpu_inc(req_crypt_stats.fragments);
+	this_cpu_add(req_crypt_stats.busy_ns, ktime_get_ns() - start);
+	req_crypt_put_frag_slot();
 	req_crypt_split_io_complete(&io->result, err);
 }
 
-static void req_cryptd_split_req_queue(struct req_dm_split_req_io *io)
+static void req_cryptd_split_req_queue(struct req_dm_split_req_io *io,
+				       int cpu)
 {
 	INIT_WORK(&io->work, req_cryptd_split_req_queue_cb);
-	queue_work(req_crypt_split_io_queue, &io->work);
+	queue_work_on(cpu, req_crypt_split_io_queue, &io->work);
 }
 
 static void req_cryptd_queue_crypt(struct req_dm_crypt_io *io)
 {
+	atomic_inc(&req_crypt_pending_reqs);
 	INIT_WORK(&io->work, req_cryptd_crypt);
 	queue_work(req_crypt_queue, &io->work);
 }
@@ -1157,8 +1158,8 @@ static int configure_qcrypto(void)
 		goto exit_err;
 	}
 
+	/* bound so that fragments of one request run on different CPUs */
 	req_crypt_split_io_queue = alloc_workqueue("req_crypt_split",
-					WQ_UNBOUND |
 					WQ_CPU_INTENSIVE |
 					WQ_MEM_RECLAIM,
 					0);
@@ -1319,6 +1320,39 @@ static int req_crypt_iterate_devices(struct dm_target *ti,
 {
 	return fn(ti, dev, start_sector_orig, ti->len, data);
 }
+
+/*
+ * Info status is the number of requests queued for crypto, the number of
+ * fragments in flight, then cpu:fragments:bytes:busy_us for each CPU that
+ * ran a fragment.
+ */
+static void req_crypt_status(struct dm_target *ti, status_type_t type,
+			     unsigned int status_flags, char *result,
+			     unsigned int maxlen)
+{
+	unsigned int sz = 0;
+	int cpu;
+
+	switch (type) {
+	case STATUSTYPE_INFO:
+		DMEMIT("%d %d", atomic_read(&req_crypt_pending_reqs),
+		       atomic_read(&req_crypt_inflight_frags));
+		for_each_possible_cpu(cpu) {
+			struct req_crypt_cpu_stats *stats =
+				per_cpu_ptr(&req_crypt_stats, cpu);
+
+			if (!stats->fragments)
+				continue;
+			DMEMIT(" %d:%llu:%llu:%llu", cpu, stats->fragments,
+			       stats->bytes,
+			       div_u64(stats->busy_ns, NSEC_PER_USEC));
+		}
+		break;
+	case STATUSTYPE_TABLE:
+		result[0] = '\0';
+		break;
+	}
+}
 void set_qcrypto_func_dm(void *dev,
 			void *flag,
 			void *engines,
@@ -1333,13 +1367,14 @@ EXPORT_SYMBOL(set_qcrypto_func_dm);
 
 static struct target_type req_crypt_target = {
 	.name   = "req-crypt",
-	.version = {1, 0, 0},
+	.version = {1, 1, 0},
 	.module = THIS_MODULE,
 	.ctr    = req_crypt_ctr,
 	.dtr    = req_crypt_dtr,
 	.map_rq = req_crypt_map,
 	.rq_end_io = req_crypt_endio,
 	.iterate_devices = req_crypt_iterate_devices,
+	.status = req_crypt_status,
 };
 
 static int __init req_dm_crypt_init(void)
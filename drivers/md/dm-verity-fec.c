@@ -10,6 +10,7 @@
  */
 
 #include "dm-verity-fec.h"
+#include <linux/cpu.h>
 #include <linux/math64.h>
 #include <linux/sysfs.h>
 
@@ -46,8 +47,8 @@ static inline u64 fec_interleave(struct dm_verity *v, u64 offset)
 /*
  * Decode an RS block using Reed-Solomon.
  */
-static int fec_decode_rs8(struct dm_verity *v, struct dm_verity_fec_io *fio,
-			  u8 *data, u8 *fec, int neras)
+static int fec_decode_rs8(struct dm_verity *v, struct rs_control *rs,
+			  int *erasures, u8 *data, u8 *fec, int neras)
 {
 	int i;
 	uint16_t par[DM_VERITY_FEC_RSM - DM_VERITY_FEC_MIN_RSN];
@@ -55,8 +56,8 @@ static int fec_decode_rs8(struct dm_verity *v, struct dm_verity_fec_io *fio,
 	for (i = 0; i < v->fec->roots; i++)
 		par[i] = fec[i];
 
-	return decode_rs8(fio->rs, data, par, v->fec->rsn, NULL, neras,
-			  fio->erasures, 0, NULL);
+	return decode_rs8(rs, data, par, v->fec->rsn, NULL, neras,
+			  erasures, 0, NULL);
 }
 
 /*
@@ -123,32 +124,38 @@ static inline unsigned fec_buffer_rs_index(unsigned i, unsigned j)
 }
 
 /*
- * Decode all RS blocks from buffers and copy corrected bytes into fio->output
- * starting from block_offset.
+ * Decode RS blocks [first, last) from buffers and copy the corrected bytes
+ * into fio->output, RS block first going to block_offset + first.  Each RS
+ * block results in one corrected target byte and consumes fec->roots
+ * parity bytes.  Returns the number of corrected errors.
  */
-static int fec_decode_bufs(struct dm_verity *v, struct dm_verity_fec_io *fio,
-			   u64 rsb, int byte_index, unsigned block_offset,
-			   int neras)
+static int fec_decode_range(struct dm_verity *v, struct rs_control *rs,
+			    int *erasures, struct dm_verity_fec_io *fio,
+			    u64 rsb, int byte_index, unsigned block_offset,
+			    unsigned first, unsigned last, int neras)
 {
-	int r, corrected = 0, res;
+	int corrected = 0, res;
 	struct dm_buffer *buf;
-	unsigned n, i, offset;
+	unsigned idx, offset;
 	u8 *par, *block;
 
+	block_offset += first;
+	if (block_offset >= 1 << v->data_dev_block_bits)
+		return 0;
+
 	par = fec_read_parity(v, rsb, block_offset, &offset, &buf);
 	if (IS_ERR(par))
 		return PTR_ERR(par);
 
-	/*
-	 * Decode the RS blocks we have in bufs. Each RS block results in
-	 * one corrected target byte and consumes fec->roots parity bytes.
-	 */
-	fec_for_each_buffer_rs_block(fio, n, i) {
-		block = fec_buffer_rs_block(v, fio, n, i);
-		res = fec_decode_rs8(v, fio, block, &par[offset], neras);
+	for (idx = first; idx < last; idx++) {
+		block = fec_buffer_rs_block(v, fio,
+				idx >> DM_VERITY_FEC_BUF_RS_BITS,
+				idx & ((1 << DM_VERITY_FEC_BUF_RS_BITS) - 1));
+		res = fec_decode_rs8(v, rs, erasures, block, &par[offset],
+				     neras);
 		if (res < 0) {
-			r = res;
-			goto error;
+			corrected = res;
+			break;
 		}
 
 		corrected += res;
@@ -156,11 +163,11 @@ static int fec_decode_bufs(struct dm_verity *v, struct dm_verity_fec_io *fio,
 
 		block_offset++;
 		if (block_offset >= 1 << v->data_dev_block_bits)
-			goto done;
+			break;
 
 		/* read the next block when we run out of parity bytes */
 		offset += v->fec->roots;
-		if (offset >= 1 << v->data_dev_block_bits) {
+		if (offset >= 1 << v->data_dev_block_bits && idx + 1 < last) {
 			dm_bufio_release(buf);
 
 			par = fec_read_parity(v, rsb, block_offset, &offset, &buf);
@@ -168,10 +175,107 @@ static int fec_decode_bufs(struct dm_verity *v, struct dm_verity_fec_io *fio,
 				return PTR_ERR(par);
 		}
 	}
-done:
-	r = corrected;
-error:
+
 	dm_bufio_release(buf);
+	return corrected;
+}
+
+static void fec_decode_work(struct work_struct *work)
+{
+	struct dm_verity_fec_worker *w =
+		container_of(work, struct dm_verity_fec_worker, work);
+
+	w->result = fec_decode_range(w->v, w->rs, w->erasures, w->fio, w->rsb,
+				     w->byte_index, w->block_offset, w->first,
+				     w->last, w->neras);
+}
+
+/*
+ * Split the RS blocks of a pass evenly over the online CPUs and wait for
+ * all of them.  Called with workers_lock held.
+ */
+static int fec_decode_parallel(struct dm_verity *v,
+			       struct dm_verity_fec_io *fio, u64 rsb,
+			       int byte_index, unsigned block_offset,
+			       unsigned nblocks, int neras)
+{
+	struct dm_verity_fec *f = v->fec;
+	struct dm_verity_fec_worker *w;
+	unsigned first = 0, chunk;
+	int cpu, r = 0;
+
+	get_online_cpus();
+
+	chunk = DIV_ROUND_UP(nblocks, num_online_cpus());
+
+	for_each_online_cpu(cpu) {
+		if (first >= nblocks)
+			break;
+
+		w = per_cpu_ptr(f->workers, cpu);
+		w->v = v;
+		w->fio = fio;
+		w->rsb = rsb;
+		w->byte_index = byte_index;
+		w->neras = neras;
+		w->block_offset = block_offset;
+		w->first = first;
+		w->last = min(first + chunk, nblocks);
+		memcpy(w->erasures, fio->erasures, sizeof(w->erasures));
+		w->queued = true;
+		queue_work_on(cpu, f->decode_wq, &w->work);
+
+		first = w->last;
+	}
+
+	for_each_online_cpu(cpu) {
+		w = per_cpu_ptr(f->workers, cpu);
+		if (!w->queued)
+			continue;
+
+		flush_work(&w->work);
+		w->queued = false;
+
+		if (w->result < 0)
+			r = w->result;
+		else if (r >= 0)
+			r += w->result;
+	}
+
+	put_online_cpus();
+
+	return r;
+}
+
+/*
+ * Decode all RS blocks from buffers and copy corrected bytes into fio->output
+ * starting from block_offset.
+ */
+static int fec_decode_bufs(struct dm_verity *v, struct dm_verity_fec_io *fio,
+			   u64 rsb, int byte_index, unsigned block_offset,
+			   int neras)
+{
+	struct dm_verity_fec *f = v->fec;
+	unsigned nblocks = fio->nbufs << DM_VERITY_FEC_BUF_RS_BITS;
+	int r;
+
+	nblocks = min(nblocks, (1U << v->data_dev_block_bits) - block_offset);
+
+	/*
+	 * A fully corrupted block takes tens of milliseconds to decode on a
+	 * single CPU.  If there's enough of it, and no other decode is using
+	 * the workers, spread it out.
+	 */
+	if (f->workers && nblocks >= DM_VERITY_FEC_PARALLEL_MIN &&
+	    num_online_cpus() > 1 && mutex_trylock(&f->workers_lock)) {
+		r = fec_decode_parallel(v, fio, rsb, byte_index, block_offset,
+					nblocks, neras);
+		mutex_unlock(&f->workers_lock);
+	} else {
+		r = fec_decode_range(v, fio->rs, fio->erasures, fio, rsb,
+				     byte_index, block_offset, 0, nblocks,
+				     neras);
+	}
 
 	if (r < 0 && neras)
 		DMERR_LIMIT("%s: FEC %llu: failed to correct: %d",
@@ -416,6 +520,27 @@ static int fec_bv_copy(struct dm_verity *v, struct dm_verity_io *io, u8 *data,
 	return 0;
 }
 
+/*
+ * Account the time a read spent in FEC, including any recursion into
+ * metadata blocks.
+ */
+static void fec_account_decode(struct dm_verity_fec *f, u64 ns)
+{
+	s64 us = div_u64(ns, NSEC_PER_USEC);
+	s64 max = atomic64_read(&f->decode_max_us);
+
+	atomic64_inc(&f->decodes);
+	atomic64_add(us, &f->decode_us);
+
+	while (us > max) {
+		s64 old = atomic64_cmpxchg(&f->decode_max_us, max, us);
+
+		if (old == max)
+			break;
+		max = old;
+	}
+}
+
 /*
  * Correct errors in a block. Copies corrected block to dest if non-NULL,
  * otherwise to a bio_vec starting from iter.
@@ -426,7 +551,7 @@ int verity_fec_decode(struct dm_verity *v, struct dm_verity_io *io,
 {
 	int r;
 	struct dm_verity_fec_io *fio = fec_io(io);
-	u64 offset, res, rsb;
+	u64 offset, res, rsb, start_ns = 0;
 
 	if (!verity_fec_is_enabled(v))
 		return -EOPNOTSUPP;
@@ -436,6 +561,8 @@ int verity_fec_decode(struct dm_verity *v, struct dm_verity_io *io,
 		return -EIO;
 	}
 
+	if (!fio->level)
+		start_ns = ktime_get_ns();
 	fio->level++;
 
 	if (type == DM_VERITY_BLOCK_TYPE_METADATA)
@@ -481,6 +608,8 @@ int verity_fec_decode(struct dm_verity *v, struct dm_verity_io *io,
 
 done:
 	fio->level--;
+	if (!fio->level)
+		fec_account_decode(v->fec, ktime_get_ns() - start_ns);
 	return r;
 }
 
@@ -553,6 +682,21 @@ void verity_fec_dtr(struct dm_verity *v)
 	if (!verity_fec_is_enabled(v))
 		goto out;
 
+	if (f->decode_wq)
+		destroy_workqueue(f->decode_wq);
+
+	if (f->workers) {
+		int cpu;
+
+		for_each_possible_cpu(cpu) {
+			struct rs_control *rs = per_cpu_ptr(f->workers, cpu)->rs;
+
+			if (rs)
+				free_rs(rs);
+		}
+		free_percpu(f->workers);
+	}
+
 	mempool_destroy(f->rs_pool);
 	mempool_destroy(f->prealloc_pool);
 	mempool_destroy(f->extra_pool);
@@ -671,8 +815,45 @@ static ssize_t corrected_show(struct kobject *kobj, struct kobj_attribute *attr,
 
 static struct kobj_attribute attr_corrected = __ATTR_RO(corrected);
 
+static ssize_t decodes_show(struct kobject *kobj, struct kobj_attribute *attr,
+			    char *buf)
+{
+	struct dm_verity_fec *f = container_of(kobj, struct dm_verity_fec,
+					       kobj_holder.kobj);
+
+	return sprintf(buf, "%lld\n", (long long)atomic64_read(&f->decodes));
+}
+
+static struct kobj_attribute attr_decodes = __ATTR_RO(decodes);
+
+static ssize_t decode_us_show(struct kobject *kobj,
+			      struct kobj_attribute *attr, char *buf)
+{
+	struct dm_verity_fec *f = container_of(kobj, struct dm_verity_fec,
+					       kobj_holder.kobj);
+
+	return sprintf(buf, "%lld\n", (long long)atomic64_read(&f->decode_us));
+}
+
+static struct kobj_attribute attr_decode_us = __ATTR_RO(decode_us);
+
+static ssize_t decode_max_us_show(struct kobject *kobj,
+				  struct kobj_attribute *attr, char *buf)
+{
+	struct dm_verity_fec *f = container_of(kobj, struct dm_verity_fec,
+					       kobj_holder.kobj);
+
+	return sprintf(buf, "%lld\n",
+		       (long long)atomic64_read(&f->decode_max_us));
+}
+
+static struct kobj_attribute attr_decode_max_us = __ATTR_RO(decode_max_us);
+
 static struct attribute *fec_attrs[] = {
 	&attr_corrected.attr,
+	&attr_decodes.attr,
+	&attr_decode_us.attr,
+	&attr_decode_max_us.attr,
 	NULL
 };
 
@@ -682,6 +863,48 @@ static struct kobj_type fec_ktype = {
 	.release = dm_kobject_release
 };
 
+/*
+ * Preallocate a decoder with its own rs_control for each CPU, used to
+ * spread the RS blocks of a large decode.
+ */
+static int fec_alloc_workers(struct dm_verity *v)
+{
+	struct dm_verity_fec *f = v->fec;
+	struct dm_target *ti = v->ti;
+	int cpu;
+
+	if (num_possible_cpus() < 2)
+		return 0;
+
+	mutex_init(&f->workers_lock);
+
+	f->workers = alloc_percpu(struct dm_verity_fec_worker);
+	if (!f->workers) {
+		ti->error = "Cannot allocate FEC workers";
+		return -ENOMEM;
+	}
+
+	for_each_possible_cpu(cpu) {
+		struct dm_verity_fec_worker *w = per_cpu_ptr(f->workers, cpu);
+
+		INIT_WORK(&w->work, fec_decode_work);
+		w->rs = init_rs(8, 0x11d, 0, 1, f->roots);
+		if (!w->rs) {
+			ti->error = "Cannot allocate FEC worker RS state";
+			return -ENOMEM;
+		}
+	}
+
+	f->decode_wq = alloc_workqueue("kverityd_fec",
+				       WQ_MEM_RECLAIM | WQ_CPU_INTENSIVE, 0);
+	if (!f->decode_wq) {
+		ti->error = "Cannot allocate FEC workqueue";
+		return -ENOMEM;
+	}
+
+	return 0;
+}
+
 /*
  * Allocate dm_verity_fec for v->fec. Must be called before verity_fec_ctr.
  */
@@ -853,6 +1076,10 @@ int verity_fec_ctr(struct dm_verity *v)
 		return -ENOMEM;
 	}
 
+	r = fec_alloc_workers(v);
+	if (r)
+		return r;
+
 	/* Reserve space for our per-bio data */
 	ti->per_io_data_size += sizeof(struct dm_verity_fec_io);
 
@@ -32,11 +32,35 @@
 /* maximum recursion level for verity_fec_decode */
 #define DM_VERITY_FEC_MAX_RECURSION	4
 
+/* fewer RS blocks than this per pass are decoded by the calling thread */
+#define DM_VERITY_FEC_PARALLEL_MIN	256
+
 #define DM_VERITY_OPT_FEC_DEV		"use_fec_from_device"
 #define DM_VERITY_OPT_FEC_BLOCKS	"fec_blocks"
 #define DM_VERITY_OPT_FEC_START		"fec_start"
 #define DM_VERITY_OPT_FEC_ROOTS		"fec_roots"
 
+/*
+ * Per-CPU decoder, decodes the RS blocks [first, last) of a pass when the
+ * work is spread over CPUs.  Each worker owns its rs_control and its copy
+ * of the erasures, which decode_rs8 overwrites.
+ */
+struct dm_verity_fec_worker {
+	struct work_struct work;
+	struct rs_control *rs;
+	int erasures[DM_VERITY_FEC_MAX_RSN];
+	struct dm_verity *v;
+	struct dm_verity_fec_io *fio;
+	u64 rsb;
+	int byte_index;
+	int neras;
+	unsigned block_offset;
+	unsigned first;
+	unsigned last;
+	bool queued;
+	int result;
+};
+
 /* configuration */
 struct dm_verity_fec {
 	struct dm_dev *dev;	/* parity data device */
@@ -54,6 +78,12 @@ struct dm_verity_fec {
 	mempool_t *output_pool;	/* mempool for output */
 	struct kmem_cache *cache;	/* cache for buffers */
 	atomic_t corrected;		/* corrected errors */
+	atomic64_t decodes;		/* blocks that went through FEC */
+	atomic64_t decode_us;		/* total time spent decoding */
+	atomic64_t decode_max_us;	/* slowest single block */
+	struct workqueue_struct *decode_wq;	/* for parallel decoding */
+	struct dm_verity_fec_worker __percpu *workers;
+	struct mutex workers_lock;	/* one parallel decode at a time */
 	struct dm_kobject_holder kobj_holder;	/* for sysfs attributes */
 };
 
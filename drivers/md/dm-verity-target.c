@@ -11,7 +11,18 @@
  * default prefetch value. Data are read in "prefetch_cluster" chunks from the
  * hash device. Setting this greatly improves performance when data and hash
  * are on the same disk on different partitions on devices with poor random
- * access behavior.
+ * access behavior.  prefetch_cluster is an upper bound: the actual window
+ * grows while reads are sequential and shrinks back on random reads.
+ *
+ * "/sys/module/dm_verity/parameters/pin_levels_max_kb" bounds the memory
+ * used to keep the upper levels of the hash tree resident.
+ *
+ * "/sys/module/dm_verity/parameters/at_most_once_max_kb" bounds the memory
+ * used for the bitset of validated blocks by check_at_most_once.
+ *
+ * With the low_latency option, reads of up to
+ * "/sys/module/dm_verity/parameters/low_latency_max_kb" are verified on a
+ * high priority workqueue on the CPU that completed them.
  */
 
 #include "dm-verity.h"
@@ -31,18 +42,40 @@
 
 #define DM_VERITY_MAX_CORRUPTED_ERRS	100
 
+#define DM_VERITY_DEFAULT_AT_MOST_ONCE_MAX_KB	4096
+
+#define DM_VERITY_DEFAULT_LOW_LATENCY_MAX_KB	16
+
+#define DM_VERITY_DEFAULT_PIN_LEVELS_MAX_KB	512
+
 #define DM_VERITY_OPT_DEVICE_WAIT	"device_wait"
 #define DM_VERITY_OPT_LOGGING		"ignore_corruption"
 #define DM_VERITY_OPT_RESTART		"restart_on_corruption"
 #define DM_VERITY_OPT_IGN_ZEROES	"ignore_zero_blocks"
 #define DM_VERITY_OPT_AT_MOST_ONCE	"check_at_most_once"
+#define DM_VERITY_OPT_LOW_LATENCY	"low_latency"
 
-#define DM_VERITY_OPTS_MAX		(3 + DM_VERITY_OPTS_FEC)
+#define DM_VERITY_OPTS_MAX		(4 + DM_VERITY_OPTS_FEC)
 
 static unsigned dm_verity_prefetch_cluster = DM_VERITY_DEFAULT_PREFETCH_SIZE;
 
 module_param_named(prefetch_cluster, dm_verity_prefetch_cluster, uint, S_IRUGO | S_IWUSR);
 
+static unsigned dm_verity_at_most_once_max_kb =
+	DM_VERITY_DEFAULT_AT_MOST_ONCE_MAX_KB;
+
+module_param_named(at_most_once_max_kb, dm_verity_at_most_once_max_kb, uint, S_IRUGO | S_IWUSR);
+
+static unsigned dm_verity_low_latency_max_kb =
+	DM_VERITY_DEFAULT_LOW_LATENCY_MAX_KB;
+
+module_param_named(low_latency_max_kb, dm_verity_low_latency_max_kb, uint, S_IRUGO | S_IWUSR);
+
+static unsigned dm_verity_pin_levels_max_kb =
+	DM_VERITY_DEFAULT_PIN_LEVELS_MAX_KB;
+
+module_param_named(pin_levels_max_kb, dm_verity_pin_levels_max_kb, uint, S_IRUGO | S_IWUSR);
+
 static int dm_device_wait;
 
 struct dm_verity_prefetch_work {
@@ -50,6 +83,7 @@ struct dm_verity_prefetch_work {
 	struct dm_verity *v;
 	sector_t block;
 	unsigned n_blocks;
+	unsigned cluster;
 };
 
 /*
@@ -258,6 +292,13 @@ static int verity_handle_err(struct dm_verity *v, enum verity_block_type type,
 	/* Corruption should be visible in device status in all modes */
 	v->hash_failed = 1;
 
+	/*
+	 * Once anything is found corrupted, don't trust earlier results:
+	 * go back to verifying every block on read.
+	 */
+	if (v->validated_blocks)
+		bitmap_zero(v->validated_blocks, v->data_blocks);
+
 	if (v->corrupted_errs >= DM_VERITY_MAX_CORRUPTED_ERRS)
 		goto out;
 
@@ -323,7 +364,13 @@ static int verity_verify_level(struct dm_verity *v, struct dm_verity_io *io,
 
 	verity_hash_at_level(v, block, level, &hash_block, &offset);
 
-	data = dm_bufio_read(v->bufio, hash_block, &buf);
+	data = dm_bufio_get(v->bufio, hash_block, &buf);
+	if (likely(data)) {
+		atomic64_inc(&v->prefetch_hits);
+	} else {
+		atomic64_inc(&v->prefetch_misses);
+		data = dm_bufio_read(v->bufio, hash_block, &buf);
+	}
 	if (IS_ERR(data))
 		return PTR_ERR(data);
 
@@ -503,6 +550,115 @@ static inline void verity_bv_skip_block(struct dm_verity *v,
 	bio_advance_iter(bio, iter, 1 << v->data_dev_block_bits);
 }
 
+/*
+ * Compares the digest of a data block with the one from the tree, and tries
+ * error correction and then the configured error mode when they differ.
+ */
+static int verity_check_data_block(struct dm_verity_io *io, sector_t block,
+				   const u8 *real, const u8 *want,
+				   struct bvec_iter *start)
+{
+	struct dm_verity *v = io->v;
+	struct bio *bio = dm_bio_from_per_bio_data(io, v->ti->per_io_data_size);
+
+	if (likely(memcmp(real, want, v->digest_size) == 0)) {
+		if (v->validated_blocks)
+			set_bit(block, v->validated_blocks);
+		return 0;
+	}
+
+	/* FEC checks its result against the digest in the io */
+	if (want != verity_io_want_digest(v, io))
+		memcpy(verity_io_want_digest(v, io), want, v->digest_size);
+
+	if (verity_fec_decode(v, io, DM_VERITY_BLOCK_TYPE_DATA,
+			      block, NULL, start) == 0)
+		return 0;
+
+	if (bio->bi_error) {
+		/*
+		 * Error correction failed; Just return error
+		 */
+		return -EIO;
+	}
+
+	if (verity_handle_err(v, DM_VERITY_BLOCK_TYPE_DATA, block))
+		return -EIO;
+
+	return 0;
+}
+
+/* a data block waiting to be hashed together with the next ones */
+struct verity_mb_block {
+	sector_t block;
+	struct bvec_iter start;
+	u8 want[DM_VERITY_MB_MAX_DIGEST];
+	u8 real[DM_VERITY_MB_MAX_DIGEST];
+};
+
+/*
+ * Blocks that lie within one bio_vec can be handed to the hash as they are,
+ * others go through verity_for_io_block().
+ */
+static bool verity_mb_contiguous(struct dm_verity *v, struct dm_verity_io *io,
+				 struct bvec_iter *iter)
+{
+	struct bio *bio = dm_bio_from_per_bio_data(io, v->ti->per_io_data_size);
+
+	return bio_iter_iovec(bio, *iter).bv_len >= 1 << v->data_dev_block_bits;
+}
+
+static int verity_verify_mb(struct dm_verity_io *io,
+			    struct verity_mb_block *blocks, unsigned n)
+{
+	struct dm_verity *v = io->v;
+	struct bio *bio = dm_bio_from_per_bio_data(io, v->ti->per_io_data_size);
+	SHASH_DESC_ON_STACK(desc, v->mb_tfm);
+	const u8 *data[DM_VERITY_MB_MAX_BLOCKS];
+	u8 *outs[DM_VERITY_MB_MAX_BLOCKS];
+	unsigned i;
+	int r;
+
+	desc->tfm = v->mb_tfm;
+	desc->flags = 0;
+	r = crypto_shash_init(desc);
+	if (likely(!r) && v->salt_size)
+		r = crypto_shash_update(desc, v->salt, v->salt_size);
+	if (unlikely(r < 0)) {
+		DMERR("verity_verify_mb salting failed: %d", r);
+		return r;
+	}
+
+	for (i = 0; i < n; i++) {
+		struct bio_vec bv = bio_iter_iovec(bio, blocks[i].start);
+
+		data[i] = (u8 *)kmap_atomic(bv.bv_page) + bv.bv_offset;
+		outs[i] = blocks[i].real;
+	}
+
+	r = crypto_shash_finup_mb(desc, data, 1 << v->data_dev_block_bits,
+				  outs, n);
+
+	while (i--)
+		kunmap_atomic((void *)data[i]);
+
+	if (unlikely(r < 0)) {
+		DMERR("verity_verify_mb crypto op failed: %d", r);
+		return r;
+	}
+	atomic64_add(n, &v->mb_hashed);
+
+	for (i = 0; i < n; i++) {
+		r = verity_check_data_block(io, blocks[i].block,
+					    blocks[i].real, blocks[i].want,
+					    &blocks[i].start);
+		if (unlikely(r))
+			return r;
+	}
+
+	return 0;
+}
+
 /*
  * Verify one "dm_verity_io" structure.
  */
@@ -513,7 +669,8 @@ static int verity_verify_io(struct dm_verity_io *io)
 	struct bvec_iter start;
 	unsigned b;
 	struct verity_result res;
-	struct bio *bio = dm_bio_from_per_bio_data(io, v->ti->per_io_data_size);
+	struct verity_mb_block pending[DM_VERITY_MB_MAX_BLOCKS];
+	unsigned n_pending = 0;
 
 	for (b = 0; b < io->n_blocks; b++) {
 		int r;
@@ -545,6 +702,24 @@ static int verity_verify_io(struct dm_verity_io *io)
 			continue;
 		}
 
+		if (v->mb_tfm && verity_mb_contiguous(v, io, &io->iter)) {
+			struct verity_mb_block *mb = &pending[n_pending++];
+
+			mb->block = cur_block;
+			mb->start = io->iter;
+			memcpy(mb->want, verity_io_want_digest(v, io),
+			       v->digest_size);
+			verity_bv_skip_block(v, io, &io->iter);
+
+			if (n_pending == v->mb_max_blocks) {
+				r = verity_verify_mb(io, pending, n_pending);
+				n_pending = 0;
+				if (unlikely(r))
+					return r;
+			}
+			continue;
+		}
+
 		r = verity_hash_init(v, req, &res);
 		if (unlikely(r < 0))
 			return r;
@@ -559,28 +734,16 @@ static int verity_verify_io(struct dm_verity_io *io)
 		if (unlikely(r < 0))
 			return r;
 
-		if (likely(memcmp(verity_io_real_digest(v, io),
-				  verity_io_want_digest(v, io), v->digest_size) == 0)) {
-			if (v->validated_blocks)
-				set_bit(cur_block, v->validated_blocks);
-			continue;
-		}
-		else if (verity_fec_decode(v, io, DM_VERITY_BLOCK_TYPE_DATA,
-					   cur_block, NULL, &start) == 0)
-			continue;
-		else {
-			if (bio->bi_error) {
-				/*
-				 * Error correction failed; Just return error
-				 */
-				return -EIO;
-			}
-			if (verity_handle_err(v, DM_VERITY_BLOCK_TYPE_DATA,
-					   cur_block))
-				return -EIO;
-		}
+		r = verity_check_data_block(io, cur_block,
+					    verity_io_real_digest(v, io),
+					    verity_io_want_digest(v, io), &start);
+		if (unlikely(r))
+			return r;
 	}
 
+	if (n_pending)
+		return verity_verify_mb(io, pending, n_pending);
+
 	return 0;
 }
 
@@ -600,11 +763,61 @@ static void verity_finish_io(struct dm_verity_io *io, int error)
 	bio_endio(bio);
 }
 
+static void verity_account_latency(struct dm_verity_io *io)
+{
+	struct dm_verity_lat_stats *st = &io->v->lat_stats[io->path];
+
+	atomic64_inc(&st->ios);
+	atomic64_add(ktime_get_ns() - io->end_io_ns, &st->total_ns);
+}
+
 static void verity_work(struct work_struct *w)
 {
 	struct dm_verity_io *io = container_of(w, struct dm_verity_io, work);
+	int r = verity_verify_io(io);
+
+	if (io->v->low_latency_wq)
+		verity_account_latency(io);
+
+	verity_finish_io(io, r);
+}
+
+/*
+ * Small reads are what foreground tasks wait on.  With low_latency they
+ * skip the unbound queue, whose workers get scheduled like any other task,
+ * and are verified by a high priority worker on the completing CPU.
+ */
+static struct workqueue_struct *verity_select_wq(struct dm_verity_io *io)
+{
+	struct dm_verity *v = io->v;
+	unsigned max_blocks;
+
+	io->path = DM_VERITY_PATH_WQ;
+	if (!v->low_latency_wq)
+		return v->verify_wq;
+
+	io->end_io_ns = ktime_get_ns();
+	max_blocks = (ACCESS_ONCE(dm_verity_low_latency_max_kb) << 10) >>
+		v->data_dev_block_bits;
+	if (io->n_blocks > max_blocks)
+		return v->verify_wq;
 
-	verity_finish_io(io, verity_verify_io(io));
+	io->path = DM_VERITY_PATH_LOW_LATENCY;
+	return v->low_latency_wq;
+}
+
+/*
+ * Returns true if every block of the io was already validated, with
+ * check_at_most_once.
+ */
+static bool verity_io_validated(struct dm_verity *v, struct dm_verity_io *io)
+{
+	sector_t end = io->block + io->n_blocks;
+
+	if (!v->validated_blocks)
+		return false;
+
+	return find_next_zero_bit(v->validated_blocks, end, io->block) >= end;
 }
 
 static void verity_end_io(struct bio *bio)
@@ -617,14 +830,20 @@ static void verity_end_io(struct bio *bio)
 		return;
 	}
 
+	/* nothing to hash, don't bounce through verify_wq */
+	if (!bio->bi_error && verity_io_validated(io->v, io)) {
+		verity_finish_io(io, 0);
+		return;
+	}
+
 	INIT_WORK(&io->work, verity_work);
-	queue_work(io->v->verify_wq, &io->work);
+	queue_work(verity_select_wq(io), &io->work);
 }
 
 /*
  * Prefetch buffers for the specified io.
  * The root buffer is not prefetched, it is assumed that it will be cached
- * all the time.
+ * all the time.  Neither are the pinned levels.
  */
 static void verity_prefetch_io(struct work_struct *work)
 {
@@ -633,27 +852,19 @@ static void verity_prefetch_io(struct work_struct *work)
 	struct dm_verity *v = pw->v;
 	int i;
 
-	for (i = v->levels - 2; i >= 0; i--) {
+	for (i = min_t(int, v->levels - 2, v->pin_level - 1); i >= 0; i--) {
 		sector_t hash_block_start;
 		sector_t hash_block_end;
 		verity_hash_at_level(v, pw->block, i, &hash_block_start, NULL);
 		verity_hash_at_level(v, pw->block + pw->n_blocks - 1, i, &hash_block_end, NULL);
-		if (!i) {
-			unsigned cluster = ACCESS_ONCE(dm_verity_prefetch_cluster);
-
-			cluster >>= v->data_dev_block_bits;
-			if (unlikely(!cluster))
-				goto no_prefetch_cluster;
-
-			if (unlikely(cluster & (cluster - 1)))
-				cluster = 1 << __fls(cluster);
+		if (!i && pw->cluster > 1) {
+			unsigned cluster = pw->cluster;
 
 			hash_block_start &= ~(sector_t)(cluster - 1);
 			hash_block_end |= cluster - 1;
 			if (unlikely(hash_block_end >= v->hash_blocks))
 				hash_block_end = v->hash_blocks - 1;
 		}
-no_prefetch_cluster:
 		dm_bufio_prefetch(v->bufio, hash_block_start,
 				  hash_block_end - hash_block_start + 1);
 	}
@@ -661,9 +872,45 @@ static void verity_prefetch_io(struct work_struct *work)
 	kfree(pw);
 }
 
+/*
+ * Size the level 0 prefetch cluster from the access pattern: double it
+ * for each read that follows the previous one (or lands within the
+ * window past it), halve it on every other read.  Random reads then only
+ * fetch the hash blocks they need instead of a whole prefetch_cluster
+ * each.  Racing readers may update the window concurrently, that only
+ * makes the estimate a bit noisier.
+ */
+static unsigned verity_prefetch_window(struct dm_verity *v,
+				       struct dm_verity_io *io)
+{
+	unsigned max = ACCESS_ONCE(dm_verity_prefetch_cluster) >>
+		v->data_dev_block_bits;
+	unsigned window = ACCESS_ONCE(v->prefetch_window);
+	sector_t next = ACCESS_ONCE(v->prefetch_next);
+
+	if (unlikely(max & (max - 1)))
+		max = 1 << __fls(max);
+
+	if (io->block >= next && io->block <= next + window)
+		window = window ? window << 1 : 1;
+	else
+		window >>= 1;
+	window = min(window, max);
+
+	v->prefetch_window = window;
+	v->prefetch_next = io->block + io->n_blocks;
+
+	return window;
+}
+
 static void verity_submit_prefetch(struct dm_verity *v, struct dm_verity_io *io)
 {
 	struct dm_verity_prefetch_work *pw;
+	unsigned cluster = verity_prefetch_window(v, io);
+
+	/* every level that would be prefetched is resident */
+	if (v->levels < 2 || !v->pin_level)
+		return;
 
 	pw = kmalloc(sizeof(struct dm_verity_prefetch_work),
 		GFP_NOIO | __GFP_NORETRY | __GFP_NOMEMALLOC | __GFP_NOWARN);
@@ -675,6 +922,7 @@ static void verity_submit_prefetch(struct dm_verity *v, struct dm_verity_io *io)
 	pw->v = v;
 	pw->block = io->block;
 	pw->n_blocks = io->n_blocks;
+	pw->cluster = cluster;
 	queue_work(v->verify_wq, &pw->work);
 }
 
@@ -717,7 +965,8 @@ int verity_map(struct dm_target *ti, struct bio *bio)
 
 	verity_fec_init_io(io);
 
-	verity_submit_prefetch(v, io);
+	if (!verity_io_validated(v, io))
+		verity_submit_prefetch(v, io);
 
 	generic_make_request(bio);
 
@@ -725,6 +974,32 @@ int verity_map(struct dm_target *ti, struct bio *bio)
 }
 EXPORT_SYMBOL_GPL(verity_map);
 
+/*
+ * With low_latency, the number of reads verified on each path and their
+ * average completion to verified latency follow the V/C status.
+ */
+static unsigned verity_status_latency(struct dm_verity *v, unsigned sz,
+				      char *result, unsigned maxlen)
+{
+	static const char * const names[DM_VERITY_PATHS] = {
+		[DM_VERITY_PATH_WQ]		= "wq",
+		[DM_VERITY_PATH_LOW_LATENCY]	= "ll",
+	};
+	int i;
+
+	for (i = 0; i < DM_VERITY_PATHS; i++) {
+		u64 ios = atomic64_read(&v->lat_stats[i].ios);
+		u64 total_ns = atomic64_read(&v->lat_stats[i].total_ns);
+
+		DMEMIT(" %s_ios=%llu %s_avg_us=%llu", names[i],
+		       (unsigned long long)ios, names[i],
+		       (unsigned long long)(ios ?
+			div64_u64(total_ns, ios * NSEC_PER_USEC) : 0));
+	}
+
+	return sz;
+}
+
 /*
  * Status: V (valid) or C (corruption found)
  */
@@ -739,6 +1014,16 @@ void verity_status(struct dm_target *ti, status_type_t type,
 	switch (type) {
 	case STATUSTYPE_INFO:
 		DMEMIT("%c", v->hash_failed ? 'C' : 'V');
+		DMEMIT(" prefetch_hits=%llu prefetch_misses=%llu",
+		       (unsigned long long)atomic64_read(&v->prefetch_hits),
+		       (unsigned long long)atomic64_read(&v->prefetch_misses));
+		DMEMIT(" prefetch_window=%u pinned_blocks=%u",
+		       v->prefetch_window, v->n_pinned);
+		if (v->mb_tfm)
+			DMEMIT(" mb_hashed=%llu",
+			       (unsigned long long)atomic64_read(&v->mb_hashed));
+		if (v->low_latency_wq)
+			sz = verity_status_latency(v, sz, result, maxlen);
 		break;
 	case STATUSTYPE_TABLE:
 		DMEMIT("%u %s %s %u %u %llu %llu %s ",
@@ -767,6 +1052,8 @@ void verity_status(struct dm_target *ti, status_type_t type,
 			args++;
 		if (v->validated_blocks)
 			args++;
+		if (v->low_latency)
+			args++;
 		if (!args)
 			return;
 		DMEMIT(" %u", args);
@@ -787,6 +1074,8 @@ void verity_status(struct dm_target *ti, status_type_t type,
 			DMEMIT(" " DM_VERITY_OPT_IGN_ZEROES);
 		if (v->validated_blocks)
 			DMEMIT(" " DM_VERITY_OPT_AT_MOST_ONCE);
+		if (v->low_latency)
+			DMEMIT(" " DM_VERITY_OPT_LOW_LATENCY);
 		sz = verity_fec_status_table(v, sz, result, maxlen);
 		break;
 	}
@@ -837,6 +1126,13 @@ void verity_dtr(struct dm_target *ti)
 	if (v->verify_wq)
 		destroy_workqueue(v->verify_wq);
 
+	if (v->low_latency_wq)
+		destroy_workqueue(v->low_latency_wq);
+
+	while (v->n_pinned)
+		dm_bufio_release(v->pinned[--v->n_pinned]);
+	kfree(v->pinned);
+
 	if (v->bufio)
 		dm_bufio_client_destroy(v->bufio);
 
@@ -845,6 +1141,9 @@ void verity_dtr(struct dm_target *ti)
 	kfree(v->root_digest);
 	kfree(v->zero_digest);
 
+	if (v->mb_tfm)
+		crypto_free_shash(v->mb_tfm);
+
 	if (v->tfm)
 		crypto_free_ahash(v->tfm);
 
@@ -867,7 +1166,9 @@ static int verity_alloc_most_once(struct dm_verity *v)
 	struct dm_target *ti = v->ti;
 
 	/* the bitset can only handle INT_MAX blocks */
-	if (v->data_blocks > INT_MAX) {
+	if (v->data_blocks > INT_MAX ||
+	    BITS_TO_LONGS(v->data_blocks) * sizeof(unsigned long) >
+	    (size_t)ACCESS_ONCE(dm_verity_at_most_once_max_kb) << 10) {
 		ti->error = "device too large to use check_at_most_once";
 		return -E2BIG;
 	}
@@ -882,6 +1183,55 @@ static int verity_alloc_most_once(struct dm_verity *v)
 	return 0;
 }
 
+/*
+ * Keep the upper levels of the hash tree resident: every read walks them,
+ * and they are small.  Levels are taken from the root down for as long as
+ * they fit in pin_levels_max_kb.  They are laid out from hash_start in
+ * that same order, so the pinned blocks are a single range.
+ */
+static void verity_pin_hash_levels(struct dm_verity *v)
+{
+	size_t max_bytes = (size_t)ACCESS_ONCE(dm_verity_pin_levels_max_kb) << 10;
+	sector_t end = v->hash_start;
+	sector_t block;
+	int i;
+
+	v->pin_level = v->levels;
+
+	for (i = v->levels - 1; i >= 0; i--) {
+		sector_t level_end = i ? v->hash_level_block[i - 1] :
+					 v->hash_blocks;
+
+		if ((level_end - v->hash_start) << v->hash_dev_block_bits >
+		    max_bytes)
+			break;
+		end = level_end;
+	}
+	if (end == v->hash_start)
+		return;
+
+	v->pinned = kcalloc(end - v->hash_start, sizeof(*v->pinned),
+			    GFP_KERNEL);
+	if (!v->pinned)
+		return;
+
+	dm_bufio_prefetch(v->bufio, v->hash_start, end - v->hash_start);
+	for (block = v->hash_start; block < end; block++) {
+		struct dm_buffer *buf;
+		u8 *data = dm_bufio_read(v->bufio, block, &buf);
+
+		if (IS_ERR(data)) {
+			DMWARN("%s: cannot pin hash block %llu: %ld",
+			       v->hash_dev->name, (unsigned long long)block,
+			       PTR_ERR(data));
+			return;
+		}
+		v->pinned[v->n_pinned++] = buf;
+	}
+
+	v->pin_level = i + 1;
+}
+
 static int verity_alloc_zero_digest(struct dm_verity *v)
 {
 	int r = -ENOMEM;
@@ -989,6 +1339,10 @@ static int verity_parse_opt_args(struct dm_arg_set *as, struct dm_verity *v)
 				return r;
 			continue;
 
+		} else if (!strcasecmp(arg_name, DM_VERITY_OPT_LOW_LATENCY)) {
+			v->low_latency = true;
+			continue;
+
 		} else if (verity_is_fec_opt_arg(arg_name)) {
 			r = verity_fec_parse_opt_args(as, v, &argc, arg_name);
 			if (r)
@@ -1005,6 +1359,34 @@ static int verity_parse_opt_args(struct dm_arg_set *as, struct dm_verity *v)
 	return r;
 }
 
+/*
+ * Use a synchronous instance of the hash for data blocks if it can hash
+ * several of them at once. Hash blocks are still verified one at a time
+ * through the ahash.
+ */
+static void verity_setup_mb(struct dm_verity *v)
+{
+	struct crypto_shash *tfm;
+
+	tfm = crypto_alloc_shash(v->alg_name, 0, 0);
+	if (IS_ERR(tfm))
+		return;
+
+	if (crypto_shash_mb_max_msgs(tfm) < 2 ||
+	    crypto_shash_digestsize(tfm) != v->digest_size ||
+	    v->digest_size > DM_VERITY_MB_MAX_DIGEST) {
+		crypto_free_shash(tfm);
+		return;
+	}
+
+	v->mb_tfm = tfm;
+	v->mb_max_blocks = min_t(unsigned, crypto_shash_mb_max_msgs(tfm),
+				 DM_VERITY_MB_MAX_BLOCKS);
+	DMINFO("%s hashing %u data blocks at once using \"%s\"", v->alg_name,
+	       v->mb_max_blocks,
+	       crypto_tfm_alg_driver_name(crypto_shash_tfm(tfm)));
+}
+
 /*
  * Target parameters:
  *	<version>	The current format is version 1.
@@ -1198,6 +1580,10 @@ int verity_ctr(struct dm_target *ti, unsigned argc, char **argv)
 		}
 	}
 
+	/* version 0 appends the salt, which finup_mb cannot do */
+	if (v->version || !v->salt_size)
+		verity_setup_mb(v);
+
 	argv += 10;
 	argc -= 10;
 
@@ -1214,8 +1600,13 @@ int verity_ctr(struct dm_target *ti, unsigned argc, char **argv)
 #ifdef CONFIG_DM_ANDROID_VERITY_AT_MOST_ONCE_DEFAULT_ENABLED
 	if (!v->validated_blocks) {
 		r = verity_alloc_most_once(v);
-		if (r)
+		if (r == -E2BIG) {
+			/* not asked for explicitly, verify every read instead */
+			DMWARN("%s: %s", v->data_dev->name, ti->error);
+			ti->error = NULL;
+		} else if (r) {
 			goto bad;
+		}
 	}
 #endif
 
@@ -1274,6 +1665,16 @@ int verity_ctr(struct dm_target *ti, unsigned argc, char **argv)
 		goto bad;
 	}
 
+	if (v->low_latency) {
+		v->low_latency_wq = alloc_workqueue("kverityd_ll",
+					WQ_HIGHPRI | WQ_MEM_RECLAIM, 0);
+		if (!v->low_latency_wq) {
+			ti->error = "Cannot allocate low latency workqueue";
+			r = -ENOMEM;
+			goto bad;
+		}
+	}
+
 	ti->per_io_data_size = sizeof(struct dm_verity_io) +
 				v->ahash_reqsize + v->digest_size * 2;
 
@@ -1281,6 +1682,8 @@ int verity_ctr(struct dm_target *ti, unsigned argc, char **argv)
 	if (r)
 		goto bad;
 
+	verity_pin_hash_levels(v);
+
 	ti->per_io_data_size = roundup(ti->per_io_data_size,
 				       __alignof__(struct dm_verity_io));
 
@@ -18,6 +18,10 @@
 
 #define DM_VERITY_MAX_LEVELS		63
 
+/* data blocks hashed together when the hash supports it */
+#define DM_VERITY_MB_MAX_BLOCKS		4
+#define DM_VERITY_MB_MAX_DIGEST		64
+
 enum verity_mode {
 	DM_VERITY_MODE_EIO,
 	DM_VERITY_MODE_LOGGING,
@@ -31,6 +35,18 @@ enum verity_block_type {
 
 struct dm_verity_fec;
 
+/* completion to verified latency, per verification path */
+struct dm_verity_lat_stats {
+	atomic64_t ios;
+	atomic64_t total_ns;
+};
+
+enum verity_verify_path {
+	DM_VERITY_PATH_WQ,
+	DM_VERITY_PATH_LOW_LATENCY,
+	DM_VERITY_PATHS
+};
+
 struct dm_verity {
 	struct dm_dev *data_dev;
 	struct dm_dev *hash_dev;
@@ -38,6 +54,10 @@ struct dm_verity {
 	struct dm_bufio_client *bufio;
 	char *alg_name;
 	struct crypto_ahash *tfm;
+	/* for hashing several data blocks at once; NULL if not supported */
+	struct crypto_shash *mb_tfm;
+	unsigned mb_max_blocks;
+	atomic64_t mb_hashed;	/* data blocks hashed by mb_tfm */
 	u8 *root_digest;	/* digest of the root block */
 	u8 *salt;		/* salt: its size is salt_size */
 	u8 *zero_digest;	/* digest for a zero block */
@@ -58,6 +78,21 @@ struct dm_verity {
 	unsigned corrupted_errs;/* Number of errors for corrupted blocks */
 
 	struct workqueue_struct *verify_wq;
+	/* high priority, per-cpu queue for small I/Os; NULL if disabled */
+	struct workqueue_struct *low_latency_wq;
+	bool low_latency;
+	struct dm_verity_lat_stats lat_stats[DM_VERITY_PATHS];
+
+	/* adaptive hash prefetch, see verity_submit_prefetch() */
+	sector_t prefetch_next;		/* data block after the last read */
+	unsigned prefetch_window;	/* level 0 prefetch cluster, in blocks */
+	atomic64_t prefetch_hits;	/* hash block found in dm-bufio */
+	atomic64_t prefetch_misses;	/* hash block read synchronously */
+
+	/* hash levels from pin_level up are held resident in dm-bufio */
+	unsigned char pin_level;
+	unsigned n_pinned;
+	struct dm_buffer **pinned;
 
 	/* starting blocks for each tree level. 0 is the lowest level. */
 	sector_t hash_level_block[DM_VERITY_MAX_LEVELS];
@@ -79,6 +114,10 @@ struct dm_verity_io {
 
 	struct work_struct work;
 
+	/* for low_latency stats */
+	enum verity_verify_path path;
+	u64 end_io_ns;
+
 	/*
 	 * Three variably-size fields follow this struct:
 	 *
@@ -455,8 +455,6 @@ static int msm_isp_get_buf_by_index(struct msm_isp_buf_mgr *buf_mgr,
 	int rc = -EINVAL;
 	unsigned long flags;
 	struct msm_isp_bufq *bufq = NULL;
-	struct msm_isp_buffer *temp_buf_info;
-	uint32_t i = 0;
 
 	bufq = msm_isp_get_bufq(buf_mgr, bufq_handle);
 	if (!bufq) {
@@ -472,19 +470,10 @@ static int msm_isp_get_buf_by_index(struct msm_isp_buf_mgr *buf_mgr,
 		return rc;
 	}
 
-	*buf_info = NULL;
-	for (i = 0; bufq->num_bufs; i++) {
-		temp_buf_info = &bufq->bufs[i];
-		if (temp_buf_info && temp_buf_info->buf_idx == buf_index) {
-			*buf_info = temp_buf_info;
-			break;
-		}
-	}
-
-	if (*buf_info) {
-		pr_debug("Found buf in isp buf mgr");
-		rc = 0;
-	}
+	/* bufs[] is indexed by buf_idx, see msm_isp_request_bufq() */
+	*buf_info = &bufq->bufs[buf_index];
+	pr_debug("Found buf in isp buf mgr");
+	rc = 0;
 	spin_unlock_irqrestore(&bufq->bufq_lock, flags);
 	return rc;
 }
@@ -628,24 +617,13 @@ static int msm_isp_get_buf(struct msm_isp_buf_mgr *buf_mgr, uint32_t id,
 	return rc;
 }
 
+/* Called with bufq_lock held, @buf_info belongs to @bufq */
 static int msm_isp_put_buf_unsafe(struct msm_isp_buf_mgr *buf_mgr,
-	uint32_t bufq_handle, uint32_t buf_index)
+	struct msm_isp_bufq *bufq, struct msm_isp_buffer *buf_info)
 {
+	uint32_t bufq_handle = bufq->bufq_handle;
+	uint32_t buf_index = buf_info->buf_idx;
 	int rc = -1;
-	struct msm_isp_bufq *bufq = NULL;
-	struct msm_isp_buffer *buf_info = NULL;
-
-	bufq = msm_isp_get_bufq(buf_mgr, bufq_handle);
-	if (!bufq) {
-		pr_err("%s: Invalid bufq\n", __func__);
-		return rc;
-	}
-
-	buf_info = msm_isp_get_buf_ptr(buf_mgr, bufq_handle, buf_index);
-	if (!buf_info) {
-		pr_err("%s: buf not found\n", __func__);
-		return rc;
-	}
 
 	switch (buf_info->state) {
 	case MSM_ISP_BUFFER_STATE_PREPARED:
@@ -712,7 +690,7 @@ static int msm_isp_put_buf(struct msm_isp_buf_mgr *buf_mgr,
 
 	spin_lock_irqsave(&bufq->bufq_lock, flags);
 
-	rc = msm_isp_put_buf_unsafe(buf_mgr, bufq_handle, buf_index);
+	rc = msm_isp_put_buf_unsafe(buf_mgr, bufq, buf_info);
 
 	spin_unlock_irqrestore(&bufq->bufq_lock, flags);
 
@@ -723,7 +701,6 @@ static int msm_isp_buf_divert(struct msm_isp_buf_mgr *buf_mgr,
 	uint32_t bufq_handle, uint32_t buf_index,
 	struct timeval *tv, uint32_t frame_id)
 {
-	unsigned long flags;
 	struct msm_isp_bufq *bufq = NULL;
 	struct msm_isp_buffer *buf_info = NULL;
 
@@ -739,21 +716,24 @@ static int msm_isp_buf_divert(struct msm_isp_buf_mgr *buf_mgr,
 		return -EINVAL;
 	}
 
-	spin_lock_irqsave(&bufq->bufq_lock, flags);
-
+	/*
+	 * Runs from the ISP irq path for every frame, so it stays off
+	 * bufq_lock. The frame info is only consumed once the divert has
+	 * been reported to userspace, and the state change itself is a
+	 * single atomic store.
+	 */
 	buf_info->frame_id = frame_id;
 #ifdef CONFIG_MSM_ISP_V1
-	if (buf_info->state == MSM_ISP_BUFFER_STATE_DEQUEUED) {
-		buf_info->state = MSM_ISP_BUFFER_STATE_DIVERTED;
+	if (cmpxchg(&buf_info->state, MSM_ISP_BUFFER_STATE_DEQUEUED,
+			MSM_ISP_BUFFER_STATE_DIVERTED) ==
+			MSM_ISP_BUFFER_STATE_DEQUEUED)
 		buf_info->tv = tv;
-	}
 #else
 	if (BUF_SRC(bufq->stream_id) == MSM_ISP_BUFFER_SRC_NATIVE) {
-		buf_info->state = MSM_ISP_BUFFER_STATE_DIVERTED;
 		buf_info->tv = tv;
+		WRITE_ONCE(buf_info->state, MSM_ISP_BUFFER_STATE_DIVERTED);
 	}
 #endif
-	spin_unlock_irqrestore(&bufq->bufq_lock, flags);
 	return 0;
 }
 
@@ -807,8 +787,7 @@ static int msm_isp_buf_done(struct msm_isp_buf_mgr *buf_mgr,
 	 */
 	if (state == MSM_ISP_BUFFER_STATE_DIVERTED) {
 		buf_info->state = MSM_ISP_BUFFER_STATE_PREPARED;
-		rc = msm_isp_put_buf_unsafe(buf_mgr, buf_info->bufq_handle,
-			buf_info->buf_idx);
+		rc = msm_isp_put_buf_unsafe(buf_mgr, bufq, buf_info);
 		if (rc < 0)
 			pr_err("%s: Buf put failed\n", __func__);
 	}
@@ -834,19 +813,14 @@ static int msm_isp_flush_buf(struct msm_isp_buf_mgr *buf_mgr,
 
 	spin_lock_irqsave(&bufq->bufq_lock, flags);
 	for (i = 0; i < bufq->num_bufs; i++) {
-		buf_info = msm_isp_get_buf_ptr(buf_mgr, bufq_handle, i);
-		if (!buf_info) {
-			pr_err("%s: buf not found\n", __func__);
-			continue;
-		}
+		buf_info = &bufq->bufs[i];
 		switch (flush_type) {
 		case MSM_ISP_BUFFER_FLUSH_DIVERTED:
 			if (buf_info->state !=
 				MSM_ISP_BUFFER_STATE_DIVERTED)
 				continue;
 			buf_info->state = MSM_ISP_BUFFER_STATE_PREPARED;
-			msm_isp_put_buf_unsafe(buf_mgr,
-				bufq_handle, buf_info->buf_idx);
+			msm_isp_put_buf_unsafe(buf_mgr, bufq, buf_info);
 			break;
 		case MSM_ISP_BUFFER_FLUSH_ALL:
 			if (buf_info->state ==
@@ -855,8 +829,7 @@ static int msm_isp_flush_buf(struct msm_isp_buf_mgr *buf_mgr,
 			if (buf_info->state !=
 				MSM_ISP_BUFFER_STATE_DEQUEUED)
 				continue;
-			msm_isp_put_buf_unsafe(buf_mgr,
-				bufq_handle, buf_info->buf_idx);
+			msm_isp_put_buf_unsafe(buf_mgr, bufq, buf_info);
 			break;
 		default:
 			WARN(1, "Invalid flush type %d\n", flush_type);
@@ -70,6 +70,35 @@ static int msm_isp_composite_stats_irq(struct vfe_device *vfe_dev,
 	return 0;
 }
 
+/*
+ * Return the buffers userspace released through isp_kstate to the free
+ * list before picking the next one. Called with stream_info->lock held.
+ */
+static void msm_isp_stats_reclaim_released(
+	struct msm_vfe_stats_stream *stream_info)
+{
+	struct vfe_device *vfe_dev = stream_info->vfe_dev[0];
+	struct msm_isp_bufq *bufq;
+	unsigned long released = 0;
+	int k, idx;
+
+	for (k = 0; k < stream_info->num_isp; k++)
+		released |= xchg(&stream_info->vfe_dev[k]->isp_page->
+			stats_release[stream_info->stats_type], 0);
+	if (!released)
+		return;
+
+	bufq = vfe_dev->buf_mgr->ops->get_bufq(vfe_dev->buf_mgr,
+			stream_info->bufq_handle);
+	if (!bufq || BUF_SRC(bufq->stream_id) != MSM_ISP_BUFFER_SRC_NATIVE)
+		return;
+
+	/* buf_done() puts a diverted native buffer back, others are left */
+	for_each_set_bit(idx, &released, min_t(uint32_t, bufq->num_bufs, 32))
+		vfe_dev->buf_mgr->ops->buf_done(vfe_dev->buf_mgr,
+			stream_info->bufq_handle, idx, NULL, 0, 0);
+}
+
 static int msm_isp_stats_cfg_ping_pong_address(
 	struct msm_vfe_stats_stream *stream_info, uint32_t pingpong_status)
 {
@@ -94,6 +123,8 @@ static int msm_isp_stats_cfg_ping_pong_address(
 	if (stream_info->buf[pingpong_bit])
 		return 0;
 
+	msm_isp_stats_reclaim_released(stream_info);
+
 	rc = vfe_dev->buf_mgr->ops->get_buf(vfe_dev->buf_mgr,
 			vfe_dev->pdev->id, bufq_handle,
 			MSM_ISP_INVALID_BUF_INDEX, &buf);
@@ -445,6 +476,9 @@ int msm_isp_stats_create_stream(struct vfe_device *vfe_dev,
 			return rc;
 		}
 	}
+	/* the page outlives the session, drop releases left by the last one */
+	xchg(&vfe_dev->isp_page->stats_release[stream_req_cmd->stats_type], 0);
+
 	stream_info->buffer_offset[stream_info->num_isp] =
 					stream_req_cmd->buffer_offset;
 	stream_info->vfe_dev[stream_info->num_isp] = vfe_dev;
@@ -12,11 +12,13 @@
 
 #include <linux/delay.h>
 #include <linux/clk.h>
+#include <linux/debugfs.h>
 #include <linux/io.h>
 #include <linux/module.h>
 #include <linux/of.h>
 #include <linux/of_gpio.h>
 #include <linux/of_platform.h>
+#include <linux/seq_file.h>
 #include "msm_sd.h"
 #include "msm_cci.h"
 #include "msm_cam_cci_hwreg.h"
@@ -372,14 +374,28 @@ static int32_t msm_cci_data_to_num_bytes(
 	return retVal;
 }
 
+/*
+ * Whether the register after @cmd can go into the same I2C write as @cmd:
+ * the sensor increments its register address by one for every data byte
+ * of a write, and a delay has to be issued right after @cmd.
+ */
+static bool msm_cci_reg_contiguous(struct msm_camera_i2c_reg_array *cmd,
+	uint8_t data_len)
+{
+	return !cmd->delay && (cmd + 1)->reg_addr == cmd->reg_addr + data_len;
+}
+
+/*
+ * Length in queue words of the next write packet, which packs as many of
+ * the registers from @i2c_cmd on as msm_cci_data_queue() will. @en_seq_write
+ * is set when the packet continues a burst and so carries no address.
+ */
 static int32_t msm_cci_calc_cmd_len(struct cci_device *cci_dev,
 	struct msm_camera_cci_ctrl *c_ctrl, uint32_t cmd_size,
-	 struct msm_camera_i2c_reg_array *i2c_cmd, uint32_t *pack)
+	 struct msm_camera_i2c_reg_array *i2c_cmd, int32_t en_seq_write)
 {
-	uint8_t i;
 	uint32_t len = 0;
 	uint8_t data_len = 0, addr_len = 0;
-	uint8_t pack_max_len;
 	struct msm_camera_i2c_reg_setting *msg;
 	struct msm_camera_i2c_reg_array *cmd = i2c_cmd;
 	uint32_t size = cmd_size;
@@ -390,32 +406,18 @@ static int32_t msm_cci_calc_cmd_len(struct cci_device *cci_dev,
 	}
 
 	msg = &c_ctrl->cfg.cci_i2c_write_cfg;
-	*pack = 0;
+	addr_len = en_seq_write ? 0 :
+		msm_cci_addr_to_num_bytes(msg->addr_type);
 
 	if (c_ctrl->cmd == MSM_CCI_I2C_WRITE_SEQ) {
-		addr_len = msm_cci_addr_to_num_bytes(msg->addr_type);
 		len = (size + addr_len) <= (cci_dev->payload_size) ?
 			(size + addr_len):cci_dev->payload_size;
 	} else {
-		addr_len = msm_cci_addr_to_num_bytes(msg->addr_type);
 		data_len = msm_cci_data_to_num_bytes(msg->data_type);
 		len = data_len + addr_len;
-		pack_max_len = size < (cci_dev->payload_size-len) ?
-			size : (cci_dev->payload_size-len);
-		for (i = 0; i < pack_max_len;) {
-			if (cmd->delay || ((cmd - i2c_cmd) >= (cmd_size - 1)))
-				break;
-			if (cmd->reg_addr + 1 ==
-				(cmd+1)->reg_addr) {
-				len += data_len;
-				if (len > cci_dev->payload_size) {
-					len = len - data_len;
-					break;
-				}
-				*pack += data_len;
-			} else
-				break;
-			i += data_len;
+		while (--size && len + data_len <= cci_dev->payload_size &&
+			msm_cci_reg_contiguous(cmd, data_len)) {
+			len += data_len;
 			cmd++;
 		}
 	}
@@ -583,26 +585,16 @@ static int32_t msm_cci_transfer_end(struct cci_device *cci_dev,
 	return rc;
 }
 
-static int32_t msm_cci_get_queue_free_size(struct cci_device *cci_dev,
-	enum cci_i2c_master_t master,
-	enum cci_i2c_queue_t queue)
-{
-	uint32_t read_val = 0;
-	uint32_t reg_offset = master * 0x200 + queue * 0x100;
-
-	read_val = msm_camera_io_r_mb(cci_dev->base +
-		CCI_I2C_M0_Q0_CUR_WORD_CNT_ADDR + reg_offset);
-	CDBG("%s line %d CCI_I2C_M0_Q0_CUR_WORD_CNT_ADDR %d max %d\n",
-		__func__, __LINE__, read_val,
-		cci_dev->cci_i2c_queue_info[master][queue].max_queue_size);
-	return (cci_dev->
-		cci_i2c_queue_info[master][queue].max_queue_size) -
-		read_val;
-}
-
+/*
+ * Loads the register table of @c_ctrl into the queue. Runs of registers at
+ * consecutive addresses are packed into one write packet, and when a run
+ * does not fit into one packet it is continued as a burst, without
+ * resending the address, as long as the queue has room for it. Once the
+ * queue is half full it is started, and refilled while it executes.
+ */
 static int32_t msm_cci_data_queue(struct cci_device *cci_dev,
 	struct msm_camera_cci_ctrl *c_ctrl, enum cci_i2c_queue_t queue,
-	enum cci_i2c_sync sync_en)
+	enum cci_i2c_sync sync_en, struct msm_cci_write_stat *stat)
 {
 	uint16_t i = 0, j = 0, k = 0, h = 0, len = 0;
 	int32_t rc = 0, free_size = 0, en_seq_write = 0;
@@ -620,6 +612,7 @@ static int32_t msm_cci_data_queue(struct cci_device *cci_dev,
 	uint32_t val = 0;
 	uint32_t max_queue_size;
 	unsigned long flags;
+	uint8_t data_len;
 
 	if (i2c_cmd == NULL) {
 		pr_err("%s:%d Failed line\n", __func__,
@@ -647,6 +640,8 @@ static int32_t msm_cci_data_queue(struct cci_device *cci_dev,
 		return -EINVAL;
 	}
 	reg_offset = master * 0x200 + queue * 0x100;
+	data_len = c_ctrl->cmd == MSM_CCI_I2C_WRITE_SEQ ? 1 :
+		msm_cci_data_to_num_bytes(i2c_msg->data_type);
 
 	msm_camera_io_w_mb(cci_dev->cci_wait_sync_cfg.cid,
 		cci_dev->base + CCI_SET_CID_SYNC_TIMER_ADDR +
@@ -689,10 +684,8 @@ static int32_t msm_cci_data_queue(struct cci_device *cci_dev,
 	}
 
 	while (cmd_size) {
-		uint32_t pack = 0;
-
 		len = msm_cci_calc_cmd_len(cci_dev, c_ctrl, cmd_size,
-			i2c_cmd, &pack);
+			i2c_cmd, en_seq_write);
 		if (len <= 0) {
 			pr_err("%s failed line %d\n", __func__, __LINE__);
 			return -EINVAL;
@@ -719,7 +712,6 @@ static int32_t msm_cci_data_queue(struct cci_device *cci_dev,
 
 		CDBG("%s cmd_size %d addr 0x%x data 0x%x\n", __func__,
 			cmd_size, i2c_cmd->reg_addr, i2c_cmd->reg_data);
-		delay = i2c_cmd->delay;
 		i = 0;
 		data[i++] = CCI_I2C_WRITE_CMD;
 
@@ -762,38 +754,52 @@ static int32_t msm_cci_data_queue(struct cci_device *cci_dev,
 			}
 			i2c_cmd++;
 			--cmd_size;
-		} while (((c_ctrl->cmd == MSM_CCI_I2C_WRITE_SEQ) || pack--) &&
-				(cmd_size > 0) && (i <= cci_dev->payload_size));
-		free_size = msm_cci_get_queue_free_size(cci_dev, master,
-				queue);
-		if ((c_ctrl->cmd == MSM_CCI_I2C_WRITE_SEQ) &&
+		} while ((cmd_size > 0) &&
+			((i - 1) + data_len <= cci_dev->payload_size) &&
+			((c_ctrl->cmd == MSM_CCI_I2C_WRITE_SEQ) ||
+			 msm_cci_reg_contiguous(i2c_cmd - 1, data_len)));
+		/* only the last register of a packet can have a delay */
+		delay = (i2c_cmd - 1)->delay;
+
+		read_val = msm_camera_io_r_mb(cci_dev->base +
+			CCI_I2C_M0_Q0_CUR_WORD_CNT_ADDR + reg_offset);
+		free_size = max_queue_size - read_val;
+		/*
+		 * A full packet whose run goes on is continued by the next
+		 * one; that is only done for byte data, so that no register
+		 * is split across packets.
+		 */
+		if ((cmd_size > 0) &&
+			((c_ctrl->cmd == MSM_CCI_I2C_WRITE_SEQ) ||
+			 (data_len == 1 &&
+			  msm_cci_reg_contiguous(i2c_cmd - 1, data_len))) &&
 			((i-1) == MSM_CCI_WRITE_DATA_PAYLOAD_SIZE_11) &&
-			cci_dev->support_seq_write && cmd_size > 0 &&
+			cci_dev->support_seq_write &&
 			free_size > BURST_MIN_FREE_SIZE) {
 			data[0] |= 0xF0;
 			en_seq_write = 1;
+			stat->bursts++;
 		} else {
 			data[0] |= ((i-1) << 4);
 			en_seq_write = 0;
 		}
+		stat->packets++;
 		len = ((i-1)/4) + 1;
 
-		read_val = msm_camera_io_r_mb(cci_dev->base +
-			CCI_I2C_M0_Q0_CUR_WORD_CNT_ADDR + reg_offset);
+		/* the packet is executed once all of its words are loaded */
 		for (h = 0, k = 0; h < len; h++) {
 			cmd = 0;
 			for (j = 0; (j < 4 && k < i); j++)
 				cmd |= (data[k++] << (j * 8));
 			CDBG("%s LOAD_DATA_ADDR 0x%x, q: %d, len:%d, cnt: %d\n",
 				__func__, cmd, queue, len, read_val);
-			msm_camera_io_w_mb(cmd, cci_dev->base +
+			msm_camera_io_w(cmd, cci_dev->base +
 				CCI_I2C_M0_Q0_LOAD_DATA_ADDR +
 				master * 0x200 + queue * 0x100);
-
-			read_val += 1;
-			msm_camera_io_w_mb(read_val, cci_dev->base +
-				CCI_I2C_M0_Q0_EXEC_WORD_CNT_ADDR + reg_offset);
 		}
+		read_val += len;
+		msm_camera_io_w_mb(read_val, cci_dev->base +
+			CCI_I2C_M0_Q0_EXEC_WORD_CNT_ADDR + reg_offset);
 
 		if ((delay > 0) && (delay < CCI_MAX_DELAY) &&
 			en_seq_write == 0) {
@@ -1061,6 +1067,22 @@ static int32_t msm_cci_i2c_read_bytes(struct v4l2_subdev *sd,
 	return rc;
 }
 
+static void msm_cci_account_write(struct cci_device *cci_dev,
+	struct msm_cci_write_stat *stat)
+{
+	struct msm_cci_write_stats *stats = &cci_dev->write_stats;
+
+	spin_lock(&stats->lock);
+	stats->recent[stats->next++ % CCI_WRITE_STATS_NUM] = *stat;
+	stats->tables++;
+	stats->regs += stat->regs;
+	stats->packets += stat->packets;
+	stats->bursts += stat->bursts;
+	stats->total_us += stat->us;
+	stats->max_us = max(stats->max_us, stat->us);
+	spin_unlock(&stats->lock);
+}
+
 static int32_t msm_cci_i2c_write(struct v4l2_subdev *sd,
 	struct msm_camera_cci_ctrl *c_ctrl, enum cci_i2c_queue_t queue,
 	enum cci_i2c_sync sync_en)
@@ -1068,6 +1090,8 @@ static int32_t msm_cci_i2c_write(struct v4l2_subdev *sd,
 	int32_t rc = 0;
 	struct cci_device *cci_dev;
 	enum cci_i2c_master_t master;
+	struct msm_cci_write_stat stat = { 0 };
+	ktime_t start;
 
 	cci_dev = v4l2_get_subdevdata(sd);
 	if (cci_dev->cci_state != CCI_STATE_ENABLED) {
@@ -1105,7 +1129,18 @@ static int32_t msm_cci_i2c_write(struct v4l2_subdev *sd,
 			__LINE__);
 		goto ERROR;
 	}
-	rc = msm_cci_data_queue(cci_dev, c_ctrl, queue, sync_en);
+	start = ktime_get();
+	rc = msm_cci_data_queue(cci_dev, c_ctrl, queue, sync_en, &stat);
+
+	stat.sid = c_ctrl->cci_info->sid;
+	stat.master = master;
+	stat.queue = queue;
+	stat.cmd = c_ctrl->cmd;
+	stat.regs = c_ctrl->cfg.cci_i2c_write_cfg.size;
+	stat.us = (uint32_t)ktime_us_delta(ktime_get(), start);
+	stat.rc = rc;
+	msm_cci_account_write(cci_dev, &stat);
+
 	if (rc < 0) {
 		CDBG("%s failed line %d\n", __func__, __LINE__);
 		goto ERROR;
@@ -2092,6 +2127,60 @@ struct v4l2_subdev *msm_cci_get_subdev(void)
 	return g_cci_subdev;
 }
 
+static int msm_cci_write_stats_show(struct seq_file *m, void *unused)
+{
+	struct cci_device *cci_dev = m->private;
+	struct msm_cci_write_stats *stats = &cci_dev->write_stats;
+	struct msm_cci_write_stat *stat;
+	uint32_t i, n;
+
+	spin_lock(&stats->lock);
+	seq_printf(m, "tables %llu regs %llu packets %llu bursts %llu total_us %llu max_us %u\n",
+		stats->tables, stats->regs, stats->packets, stats->bursts,
+		stats->total_us, stats->max_us);
+	seq_puts(m, "master queue sid cmd regs packets bursts us rc\n");
+	n = min_t(uint32_t, stats->next, CCI_WRITE_STATS_NUM);
+	for (i = stats->next - n; i != stats->next; i++) {
+		stat = &stats->recent[i % CCI_WRITE_STATS_NUM];
+		seq_printf(m, "%u %u 0x%x %u %u %u %u %u %d\n",
+			stat->master, stat->queue, stat->sid, stat->cmd,
+			stat->regs, stat->packets, stat->bursts, stat->us,
+			stat->rc);
+	}
+	spin_unlock(&stats->lock);
+
+	return 0;
+}
+
+static int msm_cci_write_stats_open(struct inode *inode, struct file *file)
+{
+	return single_open(file, msm_cci_write_stats_show, inode->i_private);
+}
+
+static const struct file_operations msm_cci_write_stats_fops = {
+	.open = msm_cci_write_stats_open,
+	.read = seq_read,
+	.llseek = seq_lseek,
+	.release = single_release,
+};
+
+static void msm_cci_debugfs_init(struct cci_device *cci_dev)
+{
+	char name[16];
+
+	spin_lock_init(&cci_dev->write_stats.lock);
+
+	snprintf(name, sizeof(name), "msm_cci%d", cci_dev->pdev->id);
+	cci_dev->debugfs_root = debugfs_create_dir(name, NULL);
+	if (IS_ERR_OR_NULL(cci_dev->debugfs_root)) {
+		cci_dev->debugfs_root = NULL;
+		return;
+	}
+
+	debugfs_create_file("write_stats", 0444, cci_dev->debugfs_root,
+		cci_dev, &msm_cci_write_stats_fops);
+}
+
 static int msm_cci_probe(struct platform_device *pdev)
 {
 	struct cci_device *new_cci_dev;
@@ -2184,6 +2273,7 @@ static int msm_cci_probe(struct platform_device *pdev)
 	if (rc)
 		pr_err("%s: failed to add child nodes, rc=%d\n", __func__, rc);
 	new_cci_dev->cci_state = CCI_STATE_DISABLED;
+	msm_cci_debugfs_init(new_cci_dev);
 	g_cci_subdev = &new_cci_dev->msm_sd.sd;
 	for (i = 0; i < MASTER_MAX; i++) {
 		new_cci_dev->write_wq[i] = create_singlethread_workqueue(
@@ -2210,6 +2300,7 @@ static int msm_cci_exit(struct platform_device *pdev)
 	struct cci_device *cci_dev =
 		v4l2_get_subdevdata(subdev);
 
+	debugfs_remove_recursive(cci_dev->debugfs_root);
 	msm_camera_put_clk_info_and_rates(pdev,
 		&cci_dev->cci_clk_info, &cci_dev->cci_clk,
 		&cci_dev->cci_clk_rates, cci_dev->num_clk_cases,
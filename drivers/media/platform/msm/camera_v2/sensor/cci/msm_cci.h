@@ -38,6 +38,7 @@
 #define MSM_CCI_WRITE_DATA_PAYLOAD_SIZE_10 10
 #define MSM_CCI_WRITE_DATA_PAYLOAD_SIZE_11 11
 #define BURST_MIN_FREE_SIZE 8
+#define CCI_WRITE_STATS_NUM 16
 
 enum cci_i2c_sync {
 	MSM_SYNC_DISABLE,
@@ -142,6 +143,31 @@ struct msm_cci_clk_params_t {
 	uint32_t cci_clk_src;
 };
 
+/* One register table written by msm_cci_i2c_write() */
+struct msm_cci_write_stat {
+	uint16_t sid;
+	uint8_t master;
+	uint8_t queue;
+	uint8_t cmd;
+	uint16_t regs;
+	uint16_t packets;
+	uint16_t bursts;
+	uint32_t us;
+	int32_t rc;
+};
+
+struct msm_cci_write_stats {
+	spinlock_t lock;
+	uint32_t next;
+	struct msm_cci_write_stat recent[CCI_WRITE_STATS_NUM];
+	uint64_t tables;
+	uint64_t regs;
+	uint64_t packets;
+	uint64_t bursts;
+	uint64_t total_us;
+	uint32_t max_us;
+};
+
 enum msm_cci_state_t {
 	CCI_STATE_ENABLED,
 	CCI_STATE_DISABLED,
@@ -181,6 +207,8 @@ struct cci_device {
 	struct workqueue_struct *write_wq[MASTER_MAX];
 	struct msm_camera_cci_wait_sync_cfg cci_wait_sync_cfg;
 	uint8_t valid_sync;
+	struct msm_cci_write_stats write_stats;
+	struct dentry *debugfs_root;
 };
 
 enum msm_cci_i2c_cmd_type {
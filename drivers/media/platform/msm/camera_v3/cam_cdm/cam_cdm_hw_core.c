@@ -423,6 +423,77 @@ int cam_hw_cdm_submit_gen_irq(struct cam_hw_info *cdm_hw,
 	return rc;
 }
 
+/* Mem handles resolved to a HW VA for the duration of one submission */
+#define CAM_CDM_BL_HDL_CACHE_SIZE 4
+
+struct cam_cdm_bl_hdl_cache {
+	int32_t hdl[CAM_CDM_BL_HDL_CACHE_SIZE];
+	uint64_t hw_vaddr[CAM_CDM_BL_HDL_CACHE_SIZE];
+	size_t len[CAM_CDM_BL_HDL_CACHE_SIZE];
+	int count;
+	int next;
+};
+
+/*
+ * A request usually alternates between a handful of command buffers, most
+ * often the KMD buffer and a UMD buffer, so remember the last few lookups
+ * instead of taking the mem manager and SMMU locks for every BL.
+ */
+static int cam_hw_cdm_get_bl_hw_vaddr(struct cam_cdm *core,
+	struct cam_cdm_bl_hdl_cache *cache, int32_t hdl,
+	uint64_t *hw_vaddr_ptr, size_t *len)
+{
+	int i, rc;
+
+	for (i = 0; i < cache->count; i++) {
+		if (cache->hdl[i] == hdl) {
+			*hw_vaddr_ptr = cache->hw_vaddr[i];
+			*len = cache->len[i];
+			return 0;
+		}
+	}
+
+	rc = cam_mem_get_io_buf(hdl, core->iommu_hdl.non_secure,
+		hw_vaddr_ptr, len);
+	if (rc)
+		return rc;
+
+	i = cache->next;
+	cache->hdl[i] = hdl;
+	cache->hw_vaddr[i] = *hw_vaddr_ptr;
+	cache->len[i] = *len;
+	cache->next = (i + 1) % CAM_CDM_BL_HDL_CACHE_SIZE;
+	if (cache->count < CAM_CDM_BL_HDL_CACHE_SIZE)
+		cache->count++;
+
+	return 0;
+}
+
+/*
+ * BLs that continue where the previous one in the same buffer ended are
+ * fetched as one, which saves a FIFO slot and a commit per merged BL.
+ */
+static bool cam_hw_cdm_bl_can_merge(struct cam_cdm_bl_request *cdm_cmd,
+	int i, uint32_t offset, uint32_t len, size_t buf_len)
+{
+	struct cam_cdm_bl_cmd *next;
+
+	if (i + 1 >= cdm_cmd->cmd_arrary_count)
+		return false;
+
+	next = &cdm_cmd->cmd[i + 1];
+	if (!next->len || next->offset != offset + len ||
+		(uint64_t)len + next->len > CAM_CDM_BL_MAX_LEN)
+		return false;
+
+	if (cdm_cmd->type == CAM_CDM_BL_CMD_TYPE_MEM_HANDLE)
+		return next->bl_addr.mem_handle ==
+			cdm_cmd->cmd[i].bl_addr.mem_handle &&
+			buf_len - offset >= (size_t)len + next->len;
+
+	return next->bl_addr.hw_iova == cdm_cmd->cmd[i].bl_addr.hw_iova;
+}
+
 int cam_hw_cdm_submit_bl(struct cam_hw_info *cdm_hw,
 	struct cam_cdm_hw_intf_cmd_submit_bl *req,
 	struct cam_cdm_client *client)
@@ -430,7 +501,9 @@ int cam_hw_cdm_submit_bl(struct cam_hw_info *cdm_hw,
 	int i, rc;
 	struct cam_cdm_bl_request *cdm_cmd = req->data;
 	struct cam_cdm *core = (struct cam_cdm *)cdm_hw->core_info;
+	struct cam_cdm_bl_hdl_cache hdl_cache = { .count = 0 };
 	uint32_t pending_bl = 0;
+	uint32_t bl_offset, bl_len;
 	int write_count = 0;
 
 	if (req->data->cmd_arrary_count > CAM_CDM_HWFIFO_SIZE) {
@@ -455,8 +528,8 @@ int cam_hw_cdm_submit_bl(struct cam_hw_info *cdm_hw,
 		uint64_t hw_vaddr_ptr = 0;
 		size_t len = 0;
 
-		if ((!cdm_cmd->cmd[i].len) &&
-			(cdm_cmd->cmd[i].len > 0x100000)) {
+		if ((!cdm_cmd->cmd[i].len) ||
+			(cdm_cmd->cmd[i].len > CAM_CDM_BL_MAX_LEN)) {
 			CAM_ERR(CAM_CDM,
 				"cmd len(%d) is invalid cnt=%d total cnt=%d",
 				cdm_cmd->cmd[i].len, i,
@@ -486,10 +559,9 @@ int cam_hw_cdm_submit_bl(struct cam_hw_info *cdm_hw,
 		}
 
 		if (req->data->type == CAM_CDM_BL_CMD_TYPE_MEM_HANDLE) {
-			rc = cam_mem_get_io_buf(
+			rc = cam_hw_cdm_get_bl_hw_vaddr(core, &hdl_cache,
 				cdm_cmd->cmd[i].bl_addr.mem_handle,
-				core->iommu_hdl.non_secure, &hw_vaddr_ptr,
-				&len);
+				&hw_vaddr_ptr, &len);
 		} else if (req->data->type == CAM_CDM_BL_CMD_TYPE_HW_IOVA) {
 			if (!cdm_cmd->cmd[i].bl_addr.hw_iova) {
 				CAM_ERR(CAM_CDM,
@@ -520,14 +592,19 @@ int cam_hw_cdm_submit_bl(struct cam_hw_info *cdm_hw,
 				break;
 			}
 
+			bl_offset = cdm_cmd->cmd[i].offset;
+			bl_len = cdm_cmd->cmd[i].len;
+			while (cam_hw_cdm_bl_can_merge(cdm_cmd, i, bl_offset,
+				bl_len, len))
+				bl_len += cdm_cmd->cmd[++i].len;
+
 			CAM_DBG(CAM_CDM, "Got the HW VA");
 			if (core->bl_tag >=
 				(CAM_CDM_HWFIFO_SIZE - 1))
 				core->bl_tag = 0;
 			rc = cam_hw_cdm_bl_write(cdm_hw,
-				((uint32_t)hw_vaddr_ptr +
-					cdm_cmd->cmd[i].offset),
-				(cdm_cmd->cmd[i].len - 1), core->bl_tag);
+				((uint32_t)hw_vaddr_ptr + bl_offset),
+				(bl_len - 1), core->bl_tag);
 			if (rc) {
 				CAM_ERR(CAM_CDM, "Hw bl write failed %d:%d",
 					i, req->data->cmd_arrary_count);
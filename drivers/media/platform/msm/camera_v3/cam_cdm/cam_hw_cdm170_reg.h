@@ -17,6 +17,8 @@
 #define CAM_CDM_REG_OFFSET_LAST 0x200
 #define CAM_CDM_REGS_COUNT 0x30
 #define CAM_CDM_HWFIFO_SIZE 0x40
+/* The BL length field holds len - 1 in 20 bits */
+#define CAM_CDM_BL_MAX_LEN 0x100000
 
 #define CAM_CDM_OFFSET_HW_VERSION 0x0
 #define CAM_CDM_OFFSET_TITAN_VERSION 0x4
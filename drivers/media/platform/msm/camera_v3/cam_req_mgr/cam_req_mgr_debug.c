@@ -10,7 +10,9 @@
  * GNU General Public License for more details.
  */
 
+#include <linux/seq_file.h>
 #include "cam_req_mgr_debug.h"
+#include "cam_req_mgr_workq.h"
 
 #define MAX_SESS_INFO_LINE_BUFF_LEN 256
 
@@ -117,6 +119,40 @@ static const struct file_operations session_info = {
 	.write = session_info_write,
 };
 
+static int workq_latency_show(struct seq_file *s, void *unused)
+{
+	struct cam_req_mgr_core_device *core_dev = s->private;
+	struct cam_req_mgr_core_session *session;
+	struct cam_req_mgr_core_link *link;
+	int i;
+
+	mutex_lock(&core_dev->crm_lock);
+	list_for_each_entry(session, &core_dev->session_head, entry) {
+		for (i = 0; i < session->num_links; i++) {
+			link = session->links[i];
+			if (!link || !link->workq)
+				continue;
+			seq_printf(s, "link_hdl 0x%x:\n", link->link_hdl);
+			cam_req_mgr_workq_show_latency(link->workq, s);
+		}
+	}
+	mutex_unlock(&core_dev->crm_lock);
+
+	return 0;
+}
+
+static int workq_latency_open(struct inode *inode, struct file *file)
+{
+	return single_open(file, workq_latency_show, inode->i_private);
+}
+
+static const struct file_operations workq_latency = {
+	.open = workq_latency_open,
+	.read = seq_read,
+	.llseek = seq_lseek,
+	.release = single_release,
+};
+
 int cam_req_mgr_debug_register(struct cam_req_mgr_core_device *core_dev)
 {
 	struct dentry *debugfs_root;
@@ -135,5 +171,9 @@ int cam_req_mgr_debug_register(struct cam_req_mgr_core_device *core_dev)
 		debugfs_root, core_dev, &bubble_recovery))
 		return -ENOMEM;
 
+	if (!debugfs_create_file("workq_latency", 0444,
+		debugfs_root, core_dev, &workq_latency))
+		return -ENOMEM;
+
 	return 0;
 }
@@ -91,6 +91,54 @@ static int cam_req_mgr_process_task(struct crm_workq_task *task)
 	return 0;
 }
 
+static void cam_req_mgr_workq_record_latency(
+	struct cam_req_mgr_core_workq *workq, struct crm_workq_task *task)
+{
+	s64 us = ktime_us_delta(ktime_get(), task->enq_time);
+	int bucket = 0;
+
+	if (us > 0)
+		bucket = min_t(int, ilog2((u64)us) + 1,
+			CRM_WORKQ_HIST_BUCKETS - 1);
+	workq->task.latency_hist[task->priority][bucket]++;
+}
+
+/**
+ * cam_req_mgr_process_tasks() - drain pending tasks in priority order
+ * @workq: workq to drain
+ *
+ * The lists are rescanned from the highest priority after every task, so
+ * a task enqueued at priority 0 runs next even while a backlog of lower
+ * priority tasks is being processed.
+ */
+static void cam_req_mgr_process_tasks(struct cam_req_mgr_core_workq *workq)
+{
+	struct crm_workq_task         *task;
+	int32_t                        i;
+	unsigned long                  flags = 0;
+
+	WORKQ_ACQUIRE_LOCK(workq, flags);
+	for (;;) {
+		for (i = CRM_TASK_PRIORITY_0; i < CRM_TASK_PRIORITY_MAX; i++)
+			if (!list_empty(&workq->task.process_head[i]))
+				break;
+		if (i == CRM_TASK_PRIORITY_MAX)
+			break;
+
+		task = list_first_entry(&workq->task.process_head[i],
+			struct crm_workq_task, entry);
+		atomic_sub(1, &workq->task.pending_cnt);
+		list_del_init(&task->entry);
+		cam_req_mgr_workq_record_latency(workq, task);
+		WORKQ_RELEASE_LOCK(workq, flags);
+		cam_req_mgr_process_task(task);
+		CAM_DBG(CAM_CRM, "processed task %pK free_cnt %d",
+			task, atomic_read(&workq->task.free_cnt));
+		WORKQ_ACQUIRE_LOCK(workq, flags);
+	}
+	WORKQ_RELEASE_LOCK(workq, flags);
+}
+
 /**
  * cam_req_mgr_process_workq() - main loop handling
  * @w: workqueue task pointer
@@ -98,9 +146,6 @@ static int cam_req_mgr_process_task(struct crm_workq_task *task)
 static void cam_req_mgr_process_workq(struct work_struct *w)
 {
 	struct cam_req_mgr_core_workq *workq = NULL;
-	struct crm_workq_task         *task;
-	int32_t                        i = CRM_TASK_PRIORITY_0;
-	unsigned long                  flags = 0;
 
 	if (!w) {
 		CAM_ERR(CAM_CRM, "NULL task pointer can not schedule");
@@ -109,22 +154,19 @@ static void cam_req_mgr_process_workq(struct work_struct *w)
 	workq = (struct cam_req_mgr_core_workq *)
 		container_of(w, struct cam_req_mgr_core_workq, work);
 
-	while (i < CRM_TASK_PRIORITY_MAX) {
-		WORKQ_ACQUIRE_LOCK(workq, flags);
-		while (!list_empty(&workq->task.process_head[i])) {
-			task = list_first_entry(&workq->task.process_head[i],
-				struct crm_workq_task, entry);
-			atomic_sub(1, &workq->task.pending_cnt);
-			list_del_init(&task->entry);
-			WORKQ_RELEASE_LOCK(workq, flags);
-			cam_req_mgr_process_task(task);
-			CAM_DBG(CAM_CRM, "processed task %pK free_cnt %d",
-				task, atomic_read(&workq->task.free_cnt));
-			WORKQ_ACQUIRE_LOCK(workq, flags);
-		}
-		WORKQ_RELEASE_LOCK(workq, flags);
-		i++;
-	}
+	cam_req_mgr_process_tasks(workq);
+}
+
+/**
+ * cam_req_mgr_process_kwork() - main loop handling for RT workers
+ * @w: kthread work pointer
+ */
+static void cam_req_mgr_process_kwork(struct kthread_work *w)
+{
+	struct cam_req_mgr_core_workq *workq =
+		container_of(w, struct cam_req_mgr_core_workq, kwork);
+
+	cam_req_mgr_process_tasks(workq);
 }
 
 int cam_req_mgr_workq_enqueue_task(struct crm_workq_task *task,
@@ -158,12 +200,13 @@ int cam_req_mgr_workq_enqueue_task(struct crm_workq_task *task,
 		? prio : CRM_TASK_PRIORITY_0;
 
 	WORKQ_ACQUIRE_LOCK(workq, flags);
-		if (!workq->job) {
+		if (!workq->job && !workq->worker) {
 			rc = -EINVAL;
 			WORKQ_RELEASE_LOCK(workq, flags);
 			goto end;
 		}
 
+	task->enq_time = ktime_get();
 	list_add_tail(&task->entry,
 		&workq->task.process_head[task->priority]);
 
@@ -171,17 +214,45 @@ int cam_req_mgr_workq_enqueue_task(struct crm_workq_task *task,
 	CAM_DBG(CAM_CRM, "enq task %pK pending_cnt %d",
 		task, atomic_read(&workq->task.pending_cnt));
 
-	queue_work(workq->job, &workq->work);
+	if (workq->worker)
+		kthread_queue_work(workq->worker, &workq->kwork);
+	else
+		queue_work(workq->job, &workq->work);
 	WORKQ_RELEASE_LOCK(workq, flags);
 end:
 	return rc;
 }
 
+static int cam_req_mgr_workq_create_worker(
+	struct cam_req_mgr_core_workq *crm_workq, const char *name)
+{
+	struct sched_param param = { .sched_priority = CRM_WORKQ_RT_PRIO };
+	struct kthread_worker *worker;
+	int rc;
+
+	worker = kthread_create_worker(0, "%s", name);
+	if (IS_ERR(worker)) {
+		CAM_ERR(CAM_CRM, "unable to create worker %s", name);
+		return PTR_ERR(worker);
+	}
+
+	rc = sched_setscheduler(worker->task, SCHED_FIFO, &param);
+	if (rc)
+		CAM_WARN(CAM_CRM, "%s: unable to set SCHED_FIFO rc %d",
+			name, rc);
+
+	kthread_init_work(&crm_workq->kwork, cam_req_mgr_process_kwork);
+	crm_workq->worker = worker;
+
+	return 0;
+}
+
 int cam_req_mgr_workq_create(char *name, int32_t num_tasks,
 	struct cam_req_mgr_core_workq **workq, enum crm_workq_context in_irq,
 	int flags)
 {
 	int32_t i, wq_flags = 0, max_active_tasks = 0;
+	int rc;
 	struct crm_workq_task  *task;
 	struct cam_req_mgr_core_workq *crm_workq = NULL;
 	char buf[128] = "crm_workq-";
@@ -202,11 +273,19 @@ int cam_req_mgr_workq_create(char *name, int32_t num_tasks,
 
 		strlcat(buf, name, sizeof(buf));
 		CAM_DBG(CAM_CRM, "create workque crm_workq-%s", name);
-		crm_workq->job = alloc_workqueue(buf,
-			wq_flags, max_active_tasks, NULL);
-		if (!crm_workq->job) {
-			kfree(crm_workq);
-			return -ENOMEM;
+		if (flags & CAM_WORKQ_FLAG_RT) {
+			rc = cam_req_mgr_workq_create_worker(crm_workq, buf);
+			if (rc) {
+				kfree(crm_workq);
+				return rc;
+			}
+		} else {
+			crm_workq->job = alloc_workqueue(buf,
+				wq_flags, max_active_tasks, NULL);
+			if (!crm_workq->job) {
+				kfree(crm_workq);
+				return -ENOMEM;
+			}
 		}
 
 		/* Workq attributes initialization */
@@ -231,6 +310,10 @@ int cam_req_mgr_workq_create(char *name, int32_t num_tasks,
 			CAM_WARN(CAM_CRM, "Insufficient memory %zu",
 				sizeof(struct crm_workq_task) *
 				crm_workq->task.num_task);
+			if (crm_workq->worker)
+				kthread_destroy_worker(crm_workq->worker);
+			else
+				destroy_workqueue(crm_workq->job);
 			kfree(crm_workq);
 			return -ENOMEM;
 		}
@@ -254,11 +337,17 @@ void cam_req_mgr_workq_destroy(struct cam_req_mgr_core_workq **crm_workq)
 {
 	unsigned long flags = 0;
 	struct workqueue_struct   *job;
+	struct kthread_worker     *worker;
 
 	CAM_DBG(CAM_CRM, "destroy workque %pK", crm_workq);
 	if (*crm_workq) {
 		WORKQ_ACQUIRE_LOCK(*crm_workq, flags);
-		if ((*crm_workq)->job) {
+		if ((*crm_workq)->worker) {
+			worker = (*crm_workq)->worker;
+			(*crm_workq)->worker = NULL;
+			WORKQ_RELEASE_LOCK(*crm_workq, flags);
+			kthread_destroy_worker(worker);
+		} else if ((*crm_workq)->job) {
 			job = (*crm_workq)->job;
 			(*crm_workq)->job = NULL;
 			WORKQ_RELEASE_LOCK(*crm_workq, flags);
@@ -275,3 +364,25 @@ void cam_req_mgr_workq_destroy(struct cam_req_mgr_core_workq **crm_workq)
 		*crm_workq = NULL;
 	}
 }
+
+void cam_req_mgr_workq_show_latency(struct cam_req_mgr_core_workq *workq,
+	struct seq_file *s)
+{
+	int32_t i, j;
+	uint32_t count;
+
+	for (i = CRM_TASK_PRIORITY_0; i < CRM_TASK_PRIORITY_MAX; i++) {
+		seq_printf(s, "  prio %d:", i);
+		for (j = 0; j < CRM_WORKQ_HIST_BUCKETS; j++) {
+			count = READ_ONCE(workq->task.latency_hist[i][j]);
+			if (!count)
+				continue;
+			if (j == CRM_WORKQ_HIST_BUCKETS - 1)
+				seq_printf(s, " >=%uus:%u", 1U << (j - 1),
+					count);
+			else
+				seq_printf(s, " <%uus:%u", 1U << j, count);
+		}
+		seq_puts(s, "\n");
+	}
+}
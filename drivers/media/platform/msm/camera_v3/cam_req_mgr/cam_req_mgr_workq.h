@@ -18,8 +18,11 @@
 #include<linux/init.h>
 #include<linux/sched.h>
 #include <linux/workqueue.h>
+#include <linux/kthread.h>
 #include <linux/slab.h>
 #include <linux/timer.h>
+#include <linux/ktime.h>
+#include <linux/seq_file.h>
 
 #include "cam_req_mgr_core.h"
 
@@ -33,6 +36,15 @@
  */
 #define CAM_WORKQ_FLAG_SERIAL                    (1 << 1)
 
+/* Flag to run the workq on a dedicated SCHED_FIFO kthread worker */
+#define CAM_WORKQ_FLAG_RT                        (1 << 2)
+
+/* SCHED_FIFO priority of CAM_WORKQ_FLAG_RT workers */
+#define CRM_WORKQ_RT_PRIO                        16
+
+/* Bucket 0 is under 1us, bucket n covers [2^(n-1), 2^n) us */
+#define CRM_WORKQ_HIST_BUCKETS                   16
+
 /* Task priorities, lower the number higher the priority*/
 enum crm_task_priority {
 	CRM_TASK_PRIORITY_0,
@@ -59,6 +71,7 @@ enum crm_workq_context {
  * @priv       : when task is enqueuer caller can attach priv along which
  *               it will get in process callback
  * @ret        : return value in future to use for blocking calls
+ * @enq_time   : time the task was enqueued, for queueing latency stats
  */
 struct crm_workq_task {
 	int32_t                  priority;
@@ -69,11 +82,14 @@ struct crm_workq_task {
 	uint8_t                  cancel;
 	void                    *priv;
 	int32_t                  ret;
+	ktime_t                  enq_time;
 };
 
 /** struct cam_req_mgr_core_workq
  * @work       : work token used by workqueue
  * @job        : workqueue internal job struct
+ * @kwork      : work token used by the kthread worker
+ * @worker     : dedicated SCHED_FIFO worker, if CAM_WORKQ_FLAG_RT
  * task -
  * @lock_bh    : lock for task structs
  * @in_irq     : set true if workque can be used in irq context
@@ -82,11 +98,14 @@ struct crm_workq_task {
  *               or acquired in order to enqueue a task to workq
  * @pool       : pool of tasks used for handling events in workq context
  * @num_task   : size of tasks pool
+ * @latency_hist : per priority histogram of enqueue to dequeue latency
  * -
  */
 struct cam_req_mgr_core_workq {
 	struct work_struct         work;
 	struct workqueue_struct   *job;
+	struct kthread_work        kwork;
+	struct kthread_worker     *worker;
 	spinlock_t                 lock_bh;
 	uint32_t                   in_irq;
 
@@ -100,6 +119,8 @@ struct cam_req_mgr_core_workq {
 		struct list_head       empty_head;
 		struct crm_workq_task *pool;
 		uint32_t               num_task;
+		uint32_t               latency_hist[CRM_TASK_PRIORITY_MAX]
+					[CRM_WORKQ_HIST_BUCKETS];
 	} task;
 };
 
@@ -113,6 +134,8 @@ struct cam_req_mgr_core_workq {
  * @in_irq   : Set to one if workq might be used in irq context
  * @flags    : Bitwise OR of Flags for workq behavior.
  *             e.g. CAM_REQ_MGR_WORKQ_HIGH_PRIORITY | CAM_REQ_MGR_WORKQ_SERIAL
+ *             CAM_WORKQ_FLAG_RT uses a SCHED_FIFO kthread worker instead
+ *             of a workqueue and implies serial execution
  * This function will allocate and create workqueue and pass
  * the workq pointer to caller.
  */
@@ -148,4 +171,13 @@ int cam_req_mgr_workq_enqueue_task(struct crm_workq_task *task,
 struct crm_workq_task *cam_req_mgr_workq_get_task(
 	struct cam_req_mgr_core_workq *workq);
 
+/**
+ * cam_req_mgr_workq_show_latency()
+ * @brief: Print the queueing latency histograms of a workq
+ * @workq: workque to report on
+ * @s    : seq_file to print to
+ */
+void cam_req_mgr_workq_show_latency(struct cam_req_mgr_core_workq *workq,
+	struct seq_file *s);
+
 #endif
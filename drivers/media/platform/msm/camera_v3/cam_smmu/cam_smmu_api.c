@@ -25,6 +25,7 @@
 #include <soc/qcom/secure_buffer.h>
 #include <uapi/media/cam_req_mgr.h>
 #include <linux/debugfs.h>
+#include <linux/seq_file.h>
 #include "cam_smmu_api.h"
 #include "cam_debug_util.h"
 
@@ -44,6 +45,10 @@
 static int g_num_pf_handled = 4;
 module_param(g_num_pf_handled, int, 0644);
 
+/* Released user mappings kept alive per context bank, 0 disables */
+static int g_map_cache_size = 16;
+module_param(g_map_cache_size, int, 0644);
+
 struct firmware_alloc_info {
 	struct device *fw_dev;
 	void *fw_kva;
@@ -130,6 +135,11 @@ struct cam_context_bank_info {
 
 	struct list_head smmu_buf_list;
 	struct list_head smmu_buf_kernel_list;
+	/* Released IO region mappings, most recently released first */
+	struct list_head smmu_buf_cache_list;
+	int cache_count;
+	u32 cache_hits;
+	u32 cache_misses;
 	struct mutex lock;
 	int handle;
 	enum cam_smmu_ops_param state;
@@ -252,6 +262,8 @@ static void cam_smmu_clean_user_buffer_list(int idx);
 
 static void cam_smmu_clean_kernel_buffer_list(int idx);
 
+static void cam_smmu_clean_buffer_cache(int idx);
+
 static void cam_smmu_print_user_list(int idx);
 
 static void cam_smmu_print_kernel_list(int idx);
@@ -302,6 +314,37 @@ static void cam_smmu_page_fault_work(struct work_struct *work)
 	kfree(payload);
 }
 
+static int cam_smmu_map_cache_show(struct seq_file *s, void *unused)
+{
+	struct cam_context_bank_info *cb;
+	unsigned int i;
+
+	for (i = 0; i < iommu_cb_set.cb_num; i++) {
+		cb = &iommu_cb_set.cb_info[i];
+		if (!cb->name)
+			continue;
+		mutex_lock(&cb->lock);
+		seq_printf(s, "%s: cached %d hits %u misses %u\n",
+			cb->name, cb->cache_count, cb->cache_hits,
+			cb->cache_misses);
+		mutex_unlock(&cb->lock);
+	}
+
+	return 0;
+}
+
+static int cam_smmu_map_cache_open(struct inode *inode, struct file *file)
+{
+	return single_open(file, cam_smmu_map_cache_show, NULL);
+}
+
+static const struct file_operations cam_smmu_map_cache_fops = {
+	.open = cam_smmu_map_cache_open,
+	.read = seq_read,
+	.llseek = seq_lseek,
+	.release = single_release,
+};
+
 static int cam_smmu_create_debugfs_entry(void)
 {
 	int rc = 0;
@@ -319,6 +362,13 @@ static int cam_smmu_create_debugfs_entry(void)
 		goto err;
 	}
 
+	if (!debugfs_create_file("map_cache", 0444, smmu_dentry, NULL,
+		&cam_smmu_map_cache_fops)) {
+		CAM_ERR(CAM_SMMU, "failed to create map_cache entry");
+		rc = -ENOMEM;
+		goto err;
+	}
+
 	return rc;
 err:
 	debugfs_remove_recursive(smmu_dentry);
@@ -633,6 +683,10 @@ void cam_smmu_reset_iommu_table(enum cam_smmu_init_dir ops)
 		iommu_cb_set.cb_info[i].handle = HANDLE_INIT;
 		INIT_LIST_HEAD(&iommu_cb_set.cb_info[i].smmu_buf_list);
 		INIT_LIST_HEAD(&iommu_cb_set.cb_info[i].smmu_buf_kernel_list);
+		INIT_LIST_HEAD(&iommu_cb_set.cb_info[i].smmu_buf_cache_list);
+		iommu_cb_set.cb_info[i].cache_count = 0;
+		iommu_cb_set.cb_info[i].cache_hits = 0;
+		iommu_cb_set.cb_info[i].cache_misses = 0;
 		iommu_cb_set.cb_info[i].state = CAM_SMMU_DETACH;
 		iommu_cb_set.cb_info[i].dev = NULL;
 		iommu_cb_set.cb_info[i].cb_count = 0;
@@ -1836,6 +1890,66 @@ static int cam_smmu_map_buffer_validate(struct dma_buf *buf,
 }
 
 
+/*
+ * A released IO region mapping is parked on the context bank's cache list
+ * with its dma_buf reference, attachment and IOVA intact, so that mapping
+ * the same dma_buf again skips the attach and SMMU map. The list is bounded
+ * by g_map_cache_size and dropped when the handle is destroyed.
+ */
+static struct cam_dma_buff_info *cam_smmu_reuse_cached_mapping(int idx,
+	struct dma_buf *buf, enum dma_data_direction dma_dir)
+{
+	struct cam_context_bank_info *cb = &iommu_cb_set.cb_info[idx];
+	struct cam_dma_buff_info *mapping;
+
+	list_for_each_entry(mapping, &cb->smmu_buf_cache_list, list) {
+		if (mapping->buf == buf && mapping->dir == dma_dir) {
+			list_del_init(&mapping->list);
+			cb->cache_count--;
+			cb->cache_hits++;
+			return mapping;
+		}
+	}
+
+	cb->cache_misses++;
+	return NULL;
+}
+
+static void cam_smmu_cache_mapping(struct cam_dma_buff_info *mapping_info,
+	int idx)
+{
+	struct cam_context_bank_info *cb = &iommu_cb_set.cb_info[idx];
+	struct cam_dma_buff_info *victim;
+
+	if (mapping_info->region_id != CAM_SMMU_REGION_IO ||
+		g_map_cache_size <= 0) {
+		cam_smmu_unmap_buf_and_remove_from_list(mapping_info, idx);
+		return;
+	}
+
+	list_move(&mapping_info->list, &cb->smmu_buf_cache_list);
+	mapping_info->ion_fd = -1;
+	cb->cache_count++;
+
+	while (cb->cache_count > g_map_cache_size) {
+		victim = list_last_entry(&cb->smmu_buf_cache_list,
+			struct cam_dma_buff_info, list);
+		cam_smmu_unmap_buf_and_remove_from_list(victim, idx);
+		cb->cache_count--;
+	}
+}
+
+static void cam_smmu_clean_buffer_cache(int idx)
+{
+	struct cam_context_bank_info *cb = &iommu_cb_set.cb_info[idx];
+	struct cam_dma_buff_info *mapping_info, *temp;
+
+	list_for_each_entry_safe(mapping_info, temp,
+			&cb->smmu_buf_cache_list, list)
+		cam_smmu_unmap_buf_and_remove_from_list(mapping_info, idx);
+	cb->cache_count = 0;
+}
+
 static int cam_smmu_map_buffer_and_add_to_list(int idx, int ion_fd,
 	 enum dma_data_direction dma_dir, dma_addr_t *paddr_ptr,
 	 size_t *len_ptr, enum cam_smmu_region_id region_id)
@@ -1847,6 +1961,18 @@ static int cam_smmu_map_buffer_and_add_to_list(int idx, int ion_fd,
 	/* returns the dma_buf structure related to an fd */
 	buf = dma_buf_get(ion_fd);
 
+	if (!IS_ERR_OR_NULL(buf) && region_id == CAM_SMMU_REGION_IO) {
+		mapping_info = cam_smmu_reuse_cached_mapping(idx, buf,
+			dma_dir);
+		if (mapping_info) {
+			/* the cached mapping already holds a reference */
+			dma_buf_put(buf);
+			*paddr_ptr = mapping_info->paddr;
+			*len_ptr = mapping_info->len;
+			goto add_to_list;
+		}
+	}
+
 	rc = cam_smmu_map_buffer_validate(buf, idx, dma_dir, paddr_ptr, len_ptr,
 		region_id, &mapping_info);
 
@@ -1855,6 +1981,7 @@ static int cam_smmu_map_buffer_and_add_to_list(int idx, int ion_fd,
 		return rc;
 	}
 
+add_to_list:
 	mapping_info->ion_fd = ion_fd;
 	/* add to the list */
 	list_add(&mapping_info->list,
@@ -2949,11 +3076,9 @@ int cam_smmu_unmap_user_iova(int handle,
 		goto unmap_end;
 	}
 
-	/* Unmapping one buffer from device */
-	CAM_DBG(CAM_SMMU, "SMMU: removing buffer idx = %d", idx);
-	rc = cam_smmu_unmap_buf_and_remove_from_list(mapping_info, idx);
-	if (rc < 0)
-		CAM_ERR(CAM_SMMU, "Error: unmap or remove list fail");
+	/* Park the mapping for reuse, the cache unmaps what it evicts */
+	CAM_DBG(CAM_SMMU, "SMMU: releasing buffer idx = %d", idx);
+	cam_smmu_cache_mapping(mapping_info, idx);
 
 unmap_end:
 	mutex_unlock(&iommu_cb_set.cb_info[idx].lock);
@@ -3099,6 +3224,8 @@ int cam_smmu_destroy_handle(int handle)
 		cam_smmu_clean_kernel_buffer_list(idx);
 	}
 
+	cam_smmu_clean_buffer_cache(idx);
+
 	if (iommu_cb_set.cb_info[idx].is_secure) {
 		if (iommu_cb_set.cb_info[idx].secure_count == 0) {
 			mutex_unlock(&iommu_cb_set.cb_info[idx].lock);
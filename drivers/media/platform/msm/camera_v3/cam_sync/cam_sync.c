@@ -16,6 +16,7 @@
 #include <linux/module.h>
 #include <linux/platform_device.h>
 #include <linux/debugfs.h>
+#include <linux/seq_file.h>
 #include "cam_sync_util.h"
 #include "cam_debug_util.h"
 #include "cam_common_util.h"
@@ -82,8 +83,8 @@ int cam_sync_create(int32_t *sync_obj, const char *name)
 	return rc;
 }
 
-int cam_sync_register_callback(sync_callback cb_func,
-	void *userdata, int32_t sync_obj)
+static int __cam_sync_register_callback(sync_callback cb_func,
+	void *userdata, int32_t sync_obj, bool inline_cb)
 {
 	struct sync_callback_info *sync_cb;
 	struct sync_table_row *row = NULL;
@@ -92,6 +93,16 @@ int cam_sync_register_callback(sync_callback cb_func,
 	if (sync_obj >= CAM_SYNC_MAX_OBJS || sync_obj <= 0 || !cb_func)
 		return -EINVAL;
 
+	sync_cb = kzalloc(sizeof(*sync_cb), GFP_ATOMIC);
+	if (!sync_cb)
+		return -ENOMEM;
+
+	sync_cb->callback_func = cb_func;
+	sync_cb->cb_data = userdata;
+	sync_cb->sync_obj = sync_obj;
+	sync_cb->inline_cb = inline_cb;
+	INIT_WORK(&sync_cb->cb_dispatch_work, cam_sync_util_cb_dispatch);
+
 	spin_lock_bh(&sync_dev->row_spinlocks[sync_obj]);
 	row = sync_dev->sync_table + sync_obj;
 
@@ -100,20 +111,15 @@ int cam_sync_register_callback(sync_callback cb_func,
 			"Error: accessing an uninitialized sync obj %d",
 			sync_obj);
 		spin_unlock_bh(&sync_dev->row_spinlocks[sync_obj]);
+		kfree(sync_cb);
 		return -EINVAL;
 	}
 
-	sync_cb = kzalloc(sizeof(*sync_cb), GFP_ATOMIC);
-	if (!sync_cb) {
-		spin_unlock_bh(&sync_dev->row_spinlocks[sync_obj]);
-		return -ENOMEM;
-	}
-
 	/* Trigger callback if sync object is already in SIGNALED state */
 	if ((row->state == CAM_SYNC_STATE_SIGNALED_SUCCESS ||
 		row->state == CAM_SYNC_STATE_SIGNALED_ERROR) &&
 		(!row->remaining)) {
-		if (trigger_cb_without_switch) {
+		if (trigger_cb_without_switch || inline_cb) {
 			CAM_DBG(CAM_SYNC, "Invoke callback for sync object:%d",
 				sync_obj);
 			status = row->state;
@@ -121,12 +127,8 @@ int cam_sync_register_callback(sync_callback cb_func,
 			spin_unlock_bh(&sync_dev->row_spinlocks[sync_obj]);
 			cb_func(sync_obj, status, userdata);
 		} else {
-			sync_cb->callback_func = cb_func;
-			sync_cb->cb_data = userdata;
-			sync_cb->sync_obj = sync_obj;
-			INIT_WORK(&sync_cb->cb_dispatch_work,
-				cam_sync_util_cb_dispatch);
 			sync_cb->status = row->state;
+			sync_cb->signal_time = ktime_get();
 			CAM_DBG(CAM_SYNC, "Enqueue callback for sync object:%d",
 				sync_cb->sync_obj);
 			queue_work(sync_dev->work_queue,
@@ -137,16 +139,26 @@ int cam_sync_register_callback(sync_callback cb_func,
 		return 0;
 	}
 
-	sync_cb->callback_func = cb_func;
-	sync_cb->cb_data = userdata;
-	sync_cb->sync_obj = sync_obj;
-	INIT_WORK(&sync_cb->cb_dispatch_work, cam_sync_util_cb_dispatch);
 	list_add_tail(&sync_cb->list, &row->callback_list);
 	spin_unlock_bh(&sync_dev->row_spinlocks[sync_obj]);
 
 	return 0;
 }
 
+int cam_sync_register_callback(sync_callback cb_func,
+	void *userdata, int32_t sync_obj)
+{
+	return __cam_sync_register_callback(cb_func, userdata, sync_obj,
+		false);
+}
+
+int cam_sync_register_inline_callback(sync_callback cb_func,
+	void *userdata, int32_t sync_obj)
+{
+	return __cam_sync_register_callback(cb_func, userdata, sync_obj,
+		true);
+}
+
 int cam_sync_deregister_callback(sync_callback cb_func,
 	void *userdata, int32_t sync_obj)
 {
@@ -183,7 +195,8 @@ int cam_sync_deregister_callback(sync_callback cb_func,
 	return found ? 0 : -ENOENT;
 }
 
-int cam_sync_signal(int32_t sync_obj, uint32_t status)
+static int __cam_sync_signal(int32_t sync_obj, uint32_t status,
+	struct list_head *inline_cbs)
 {
 	struct sync_table_row *row = NULL;
 	struct sync_table_row *parent_row = NULL;
@@ -237,7 +250,7 @@ int cam_sync_signal(int32_t sync_obj, uint32_t status)
 	}
 
 	row->state = status;
-	cam_sync_util_dispatch_signaled_cb(sync_obj, status);
+	cam_sync_util_dispatch_signaled_cb(sync_obj, status, inline_cbs);
 
 	/* copy parent list to local and release child lock */
 	INIT_LIST_HEAD(&parents_list);
@@ -273,7 +286,8 @@ int cam_sync_signal(int32_t sync_obj, uint32_t status)
 
 		if (!parent_row->remaining)
 			cam_sync_util_dispatch_signaled_cb(
-				parent_info->sync_id, parent_row->state);
+				parent_info->sync_id, parent_row->state,
+				inline_cbs);
 
 		spin_unlock_bh(&sync_dev->row_spinlocks[parent_info->sync_id]);
 		list_del_init(&parent_info->list);
@@ -283,6 +297,38 @@ int cam_sync_signal(int32_t sync_obj, uint32_t status)
 	return 0;
 }
 
+int cam_sync_signal(int32_t sync_obj, uint32_t status)
+{
+	LIST_HEAD(inline_cbs);
+	int rc;
+
+	rc = __cam_sync_signal(sync_obj, status, &inline_cbs);
+	cam_sync_util_run_inline_cbs(&inline_cbs);
+
+	return rc;
+}
+
+int cam_sync_signal_multiple(struct cam_sync_signal *signals,
+	uint32_t num_signals)
+{
+	LIST_HEAD(inline_cbs);
+	int rc = 0, ret;
+	uint32_t i;
+
+	if (!signals || !num_signals)
+		return -EINVAL;
+
+	for (i = 0; i < num_signals; i++) {
+		ret = __cam_sync_signal(signals[i].sync_obj,
+			signals[i].sync_state, &inline_cbs);
+		if (ret && !rc)
+			rc = ret;
+	}
+	cam_sync_util_run_inline_cbs(&inline_cbs);
+
+	return rc;
+}
+
 int cam_sync_merge(int32_t *sync_obj, uint32_t num_objs, int32_t *merged_obj)
 {
 	int rc;
@@ -513,6 +559,62 @@ static int cam_sync_handle_signal(struct cam_private_ioctl_arg *k_ioctl)
 		sync_signal.sync_state);
 }
 
+static int cam_sync_handle_signal_multiple(
+	struct cam_private_ioctl_arg *k_ioctl)
+{
+	struct cam_sync_signal_multiple sync_signal;
+	struct cam_sync_signal *signals;
+	uint32_t i, num_signals = 0;
+	int rc;
+
+	if (k_ioctl->size != sizeof(struct cam_sync_signal_multiple))
+		return -EINVAL;
+
+	if (!k_ioctl->ioctl_ptr)
+		return -EINVAL;
+
+	if (copy_from_user(&sync_signal,
+		u64_to_user_ptr(k_ioctl->ioctl_ptr),
+		k_ioctl->size))
+		return -EFAULT;
+
+	if (!sync_signal.num_signals ||
+		sync_signal.num_signals >= CAM_SYNC_MAX_OBJS)
+		return -EINVAL;
+
+	signals = kcalloc(sync_signal.num_signals, sizeof(*signals),
+		GFP_KERNEL);
+	if (!signals)
+		return -ENOMEM;
+
+	if (copy_from_user(signals,
+		u64_to_user_ptr(sync_signal.signals),
+		sizeof(*signals) * sync_signal.num_signals)) {
+		kfree(signals);
+		return -EFAULT;
+	}
+
+	/* need to get ref for UMD signaled fences, skip the ones we can't */
+	for (i = 0; i < sync_signal.num_signals; i++) {
+		if (cam_sync_get_obj_ref(signals[i].sync_obj)) {
+			CAM_DBG(CAM_SYNC,
+				"Error: cannot signal an uninitialized sync obj = %d",
+				signals[i].sync_obj);
+			continue;
+		}
+		signals[num_signals++] = signals[i];
+	}
+
+	rc = num_signals ? cam_sync_signal_multiple(signals, num_signals) :
+		-EINVAL;
+	if (!rc && num_signals != sync_signal.num_signals)
+		rc = -EINVAL;
+
+	kfree(signals);
+
+	return rc;
+}
+
 static int cam_sync_handle_merge(struct cam_private_ioctl_arg *k_ioctl)
 {
 	struct cam_sync_merge sync_merge;
@@ -780,6 +882,9 @@ static long cam_sync_dev_ioctl(struct file *filep, void *fh,
 	case CAM_SYNC_MERGE:
 		rc = cam_sync_handle_merge(&k_ioctl);
 		break;
+	case CAM_SYNC_SIGNAL_MULTIPLE:
+		rc = cam_sync_handle_signal_multiple(&k_ioctl);
+		break;
 	case CAM_SYNC_WAIT:
 		rc = cam_sync_handle_wait(&k_ioctl);
 		((struct cam_private_ioctl_arg *)arg)->result =
@@ -998,6 +1103,44 @@ static void cam_sync_init_entity(struct sync_device *sync_dev)
 }
 #endif
 
+static int cam_sync_cb_latency_show(struct seq_file *s, void *unused)
+{
+	static const char * const names[SYNC_CB_DISPATCH_MAX] = {
+		[SYNC_CB_QUEUED] = "queued",
+		[SYNC_CB_INLINE] = "inline",
+	};
+	int i, j, count;
+
+	for (i = 0; i < SYNC_CB_DISPATCH_MAX; i++) {
+		seq_printf(s, "%s:", names[i]);
+		for (j = 0; j < CAM_SYNC_CB_HIST_BUCKETS; j++) {
+			count = atomic_read(&sync_dev->cb_latency_hist[i][j]);
+			if (!count)
+				continue;
+			if (j == CAM_SYNC_CB_HIST_BUCKETS - 1)
+				seq_printf(s, " >=%uus:%d", 1U << (j - 1),
+					count);
+			else
+				seq_printf(s, " <%uus:%d", 1U << j, count);
+		}
+		seq_puts(s, "\n");
+	}
+
+	return 0;
+}
+
+static int cam_sync_cb_latency_open(struct inode *inode, struct file *file)
+{
+	return single_open(file, cam_sync_cb_latency_show, NULL);
+}
+
+static const struct file_operations cam_sync_cb_latency_fops = {
+	.open = cam_sync_cb_latency_open,
+	.read = seq_read,
+	.llseek = seq_lseek,
+	.release = single_release,
+};
+
 static int cam_sync_create_debugfs(void)
 {
 	sync_dev->dentry = debugfs_create_dir("camera_sync", NULL);
@@ -1015,6 +1158,12 @@ static int cam_sync_create_debugfs(void)
 		return -ENOMEM;
 	}
 
+	if (!debugfs_create_file("cb_latency", 0444, sync_dev->dentry,
+		NULL, &cam_sync_cb_latency_fops)) {
+		CAM_ERR(CAM_SYNC, "failed to create cb_latency entry");
+		return -ENOMEM;
+	}
+
 	return 0;
 }
 
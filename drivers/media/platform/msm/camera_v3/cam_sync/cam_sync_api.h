@@ -57,6 +57,23 @@ int cam_sync_create(int32_t *sync_obj, const char *name);
 int cam_sync_register_callback(sync_callback cb_func,
 	void *userdata, int32_t sync_obj);
 
+/**
+ * @brief: Registers a callback to be run in the signaling context
+ *
+ * Unlike cam_sync_register_callback(), the callback is not bounced through
+ * the sync work queue but invoked directly by whoever signals the object,
+ * after the sync driver has dropped its locks. It may run in softirq or
+ * interrupt context and must not sleep.
+ *
+ * @param cb_func:  Pointer to callback to be registered
+ * @param userdata: Opaque pointer which will be passed back with callback.
+ * @param sync_obj: int referencing the sync object.
+ *
+ * @return Status of operation. Zero in case of success.
+ */
+int cam_sync_register_inline_callback(sync_callback cb_func,
+	void *userdata, int32_t sync_obj);
+
 /**
  * @brief: De-registers a callback with a sync object
  *
@@ -88,6 +105,20 @@ int cam_sync_deregister_callback(sync_callback cb_func,
  */
 int cam_sync_signal(int32_t sync_obj, uint32_t status);
 
+/**
+ * @brief: Signals several sync objects in one call.
+ *
+ * Equivalent to calling cam_sync_signal() on each entry, except that
+ * inline callbacks are only run once every object has been signaled.
+ *
+ * @param signals: Array of sync objects and the status to signal each with
+ * @param num_signals: Number of entries in the array
+ *
+ * @return Status of operation. The first error seen, zero otherwise.
+ */
+int cam_sync_signal_multiple(struct cam_sync_signal *signals,
+	uint32_t num_signals);
+
 /**
  * @brief: Merges multiple sync objects
  *
@@ -18,6 +18,7 @@
 #include <linux/workqueue.h>
 #include <linux/interrupt.h>
 #include <linux/debugfs.h>
+#include <linux/ktime.h>
 #include <media/v4l2-fh.h>
 #include <media/v4l2-device.h>
 #include <media/v4l2-subdev.h>
@@ -39,6 +40,8 @@
 #define CAM_SYNC_PAYLOAD_WORDS          2
 #define CAM_SYNC_NAME                   "cam_sync"
 #define CAM_SYNC_WORKQUEUE_NAME         "HIPRIO_SYNC_WORK_QUEUE"
+/* Bucket 0 is under 1us, bucket n covers [2^(n-1), 2^n) us */
+#define CAM_SYNC_CB_HIST_BUCKETS        16
 
 #define CAM_SYNC_TYPE_INDV              0
 #define CAM_SYNC_TYPE_GROUP             1
@@ -67,6 +70,18 @@ enum sync_list_clean_type {
 	SYNC_LIST_CLEAN_ALL
 };
 
+/**
+ * enum sync_cb_dispatch - How a kernel callback was run
+ *
+ * @SYNC_CB_QUEUED : Callback ran from the sync work queue
+ * @SYNC_CB_INLINE : Callback ran in the signaling context
+ */
+enum sync_cb_dispatch {
+	SYNC_CB_QUEUED,
+	SYNC_CB_INLINE,
+	SYNC_CB_DISPATCH_MAX
+};
+
 /**
  * struct sync_parent_info - Single node of information about a parent
  * of a sync object, usually part of the parents linked list
@@ -102,6 +117,9 @@ struct sync_child_info {
  * @sync_obj         : Sync id of the object for which callback is registered
  * @cb_dispatch_work : Work representing the call dispatch
  * @list             : List member used to append this node to a linked list
+ * @inline_cb        : Run the callback in the signaling context rather than
+ *                     from the work queue
+ * @signal_time      : Time the sync object was signaled, for latency stats
  */
 struct sync_callback_info {
 	sync_callback callback_func;
@@ -110,6 +128,8 @@ struct sync_callback_info {
 	int32_t sync_obj;
 	struct work_struct cb_dispatch_work;
 	struct list_head list;
+	bool inline_cb;
+	ktime_t signal_time;
 };
 
 /**
@@ -185,6 +205,7 @@ struct cam_signalable_info {
  * @cam_sync_eventq : Event queue used to dispatch user payloads to user space
  * @bitmap          : Bitmap representation of all sync objects
  * @err_cnt         : Error counter to dump fence table
+ * @cb_latency_hist : Signal to callback latency, per dispatch type
  */
 struct sync_device {
 	struct video_device *vdev;
@@ -199,6 +220,8 @@ struct sync_device {
 	spinlock_t cam_sync_eventq_lock;
 	DECLARE_BITMAP(bitmap, CAM_SYNC_MAX_OBJS);
 	int err_cnt;
+	atomic_t cb_latency_hist[SYNC_CB_DISPATCH_MAX]
+		[CAM_SYNC_CB_HIST_BUCKETS];
 };
 
 
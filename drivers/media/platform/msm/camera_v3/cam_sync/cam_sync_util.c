@@ -297,6 +297,7 @@ void cam_sync_util_cb_dispatch(struct work_struct *cb_dispatch_work)
 		struct sync_callback_info,
 		cb_dispatch_work);
 
+	cam_sync_util_record_cb_latency(cb_info, SYNC_CB_QUEUED);
 	cb_info->callback_func(cb_info->sync_obj,
 		cb_info->status,
 		cb_info->cb_data);
@@ -304,9 +305,36 @@ void cam_sync_util_cb_dispatch(struct work_struct *cb_dispatch_work)
 	kfree(cb_info);
 }
 
+void cam_sync_util_record_cb_latency(struct sync_callback_info *cb_info,
+	enum sync_cb_dispatch dispatch)
+{
+	s64 us = ktime_us_delta(ktime_get(), cb_info->signal_time);
+	int bucket = 0;
+
+	if (us > 0)
+		bucket = min_t(int, ilog2((u64)us) + 1,
+			CAM_SYNC_CB_HIST_BUCKETS - 1);
+	atomic_inc(&sync_dev->cb_latency_hist[dispatch][bucket]);
+}
+
+void cam_sync_util_run_inline_cbs(struct list_head *inline_cbs)
+{
+	struct sync_callback_info *cb_info, *temp;
+
+	list_for_each_entry_safe(cb_info, temp, inline_cbs, list) {
+		list_del_init(&cb_info->list);
+		cam_sync_util_record_cb_latency(cb_info, SYNC_CB_INLINE);
+		cb_info->callback_func(cb_info->sync_obj,
+			cb_info->status,
+			cb_info->cb_data);
+		kfree(cb_info);
+	}
+}
+
 void cam_sync_util_dispatch_signaled_cb(int32_t sync_obj,
-	uint32_t status)
+	uint32_t status, struct list_head *inline_cbs)
 {
+	ktime_t                     now = ktime_get();
 	struct sync_callback_info  *sync_cb;
 	struct sync_user_payload   *payload_info;
 	struct sync_callback_info  *temp_sync_cb;
@@ -324,9 +352,13 @@ void cam_sync_util_dispatch_signaled_cb(int32_t sync_obj,
 	list_for_each_entry_safe(sync_cb,
 		temp_sync_cb, &signalable_row->callback_list, list) {
 		sync_cb->status = status;
+		sync_cb->signal_time = now;
 		list_del_init(&sync_cb->list);
-		queue_work(sync_dev->work_queue,
-			&sync_cb->cb_dispatch_work);
+		if (sync_cb->inline_cb)
+			list_add_tail(&sync_cb->list, inline_cbs);
+		else
+			queue_work(sync_dev->work_queue,
+				&sync_cb->cb_dispatch_work);
 	}
 
 	/* Dispatch user payloads if any were registered earlier */
@@ -89,13 +89,37 @@ void cam_sync_util_cb_dispatch(struct work_struct *cb_dispatch_work);
 /**
  * @brief: Function to dispatch callbacks for a signaled sync object
  *
- * @sync_obj : Sync object that is signaled
- * @status   : Status of the signaled object
+ * @sync_obj   : Sync object that is signaled
+ * @status     : Status of the signaled object
+ * @inline_cbs : List collecting callbacks registered to run inline; the
+ *               caller runs them with cam_sync_util_run_inline_cbs() once
+ *               the row lock is dropped
  *
  * @return None
  */
 void cam_sync_util_dispatch_signaled_cb(int32_t sync_obj,
-	uint32_t status);
+	uint32_t status, struct list_head *inline_cbs);
+
+/**
+ * @brief: Function to run and free callbacks collected for inline dispatch
+ *
+ * @inline_cbs : List filled by cam_sync_util_dispatch_signaled_cb()
+ *
+ * @return None
+ */
+void cam_sync_util_run_inline_cbs(struct list_head *inline_cbs);
+
+/**
+ * @brief: Function to account the signal to callback latency of a callback
+ *         about to run
+ *
+ * @cb_info  : Callback about to be invoked
+ * @dispatch : How the callback is being run
+ *
+ * @return None
+ */
+void cam_sync_util_record_cb_latency(struct sync_callback_info *cb_info,
+	enum sync_cb_dispatch dispatch);
 
 /**
  * @brief: Function to send V4L event to user space
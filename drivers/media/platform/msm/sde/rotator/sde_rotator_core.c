@@ -749,6 +749,27 @@ static int sde_rotator_map_and_check_data(struct sde_rot_entry *entry)
 	return ret;
 }
 
+/*
+ * sde_rotator_can_premap - check if an entry can be mapped ahead of the hw
+ * @entry: Pointer to rotation entry
+ *
+ * Mapping may switch the secure camera context, which must wait until the
+ * hw has been acquired for the entry.
+ */
+static bool sde_rotator_can_premap(struct sde_rot_entry *entry)
+{
+	struct sde_rot_data_type *mdata = sde_rot_get_mdata();
+	bool secure;
+
+	if (!test_bit(SDE_CAPS_SEC_ATTACH_DETACH_SMMU, mdata->sde_caps_map))
+		return true;
+
+	secure = (entry->item.flags & SDE_ROTATION_SECURE_CAMERA) ?
+			true : false;
+
+	return secure == !!mdata->sec_cam_en;
+}
+
 static struct sde_rot_perf *__sde_rotator_find_session(
 	struct sde_rot_file_private *private,
 	u32 session_id)
@@ -1505,6 +1526,7 @@ static void sde_rotator_commit_handler(struct kthread_work *work)
 	struct sde_rot_hw_resource *hw;
 	struct sde_rot_mgr *mgr;
 	struct sched_param param = { .sched_priority = 5 };
+	bool premapped;
 	int ret;
 
 	entry = container_of(work, struct sde_rot_entry, commit_work);
@@ -1544,10 +1566,32 @@ static void sde_rotator_commit_handler(struct kthread_work *work)
 
 	sde_rot_mgr_lock(mgr);
 
+	ATRACE_INT("sde_smmu_ctrl", 0);
+	ret = sde_smmu_ctrl(1);
+	if (ret < 0) {
+		SDEROT_ERR("IOMMU attach failed\n");
+		goto smmu_error;
+	}
+	ATRACE_INT("sde_smmu_ctrl", 1);
+
+	/*
+	 * Map and check the buffers while the previous entry still owns
+	 * the hw, so only hw programming is left once the hw frees up.
+	 */
+	premapped = sde_rotator_can_premap(entry);
+	if (premapped) {
+		ret = sde_rotator_map_and_check_data(entry);
+		if (ret) {
+			SDEROT_ERR("fail to prepare input/output data %d\n",
+					ret);
+			goto map_error;
+		}
+	}
+
 	hw = sde_rotator_get_hw_resource(entry->commitq, entry);
 	if (!hw) {
 		SDEROT_ERR("no hw for the queue\n");
-		goto get_hw_res_err;
+		goto map_error;
 	}
 
 	if (entry->item.ts)
@@ -1565,18 +1609,13 @@ static void sde_rotator_commit_handler(struct kthread_work *work)
 		entry->item.dst_rect.x, entry->item.dst_rect.y,
 		entry->item.dst_rect.w, entry->item.dst_rect.h);
 
-	ATRACE_INT("sde_smmu_ctrl", 0);
-	ret = sde_smmu_ctrl(1);
-	if (ret < 0) {
-		SDEROT_ERR("IOMMU attach failed\n");
-		goto smmu_error;
-	}
-	ATRACE_INT("sde_smmu_ctrl", 1);
-
-	ret = sde_rotator_map_and_check_data(entry);
-	if (ret) {
-		SDEROT_ERR("fail to prepare input/output data %d\n", ret);
-		goto error;
+	if (!premapped) {
+		ret = sde_rotator_map_and_check_data(entry);
+		if (ret) {
+			SDEROT_ERR("fail to prepare input/output data %d\n",
+					ret);
+			goto error;
+		}
 	}
 
 	ret = mgr->ops_config_hw(hw, entry);
@@ -1620,10 +1659,10 @@ static void sde_rotator_commit_handler(struct kthread_work *work)
 	sde_rotator_req_wait_for_idle(mgr, request);
 	mgr->ops_cancel_hw(hw, entry);
 error:
+	sde_rotator_put_hw_resource(entry->commitq, entry, hw);
+map_error:
 	sde_smmu_ctrl(0);
 smmu_error:
-	sde_rotator_put_hw_resource(entry->commitq, entry, hw);
-get_hw_res_err:
 	sde_rotator_signal_output(entry);
 	sde_rotator_release_entry(mgr, entry);
 	atomic_dec(&request->pending_count);
@@ -2341,6 +2380,8 @@ static int sde_rotator_config_session(struct sde_rot_mgr *mgr,
 {
 	int ret = 0;
 	struct sde_rot_perf *perf;
+	unsigned long clk_rate;
+	u64 bw;
 
 	ret = sde_rotator_verify_config_all(mgr, config);
 	if (ret) {
@@ -2355,6 +2396,9 @@ static int sde_rotator_config_session(struct sde_rot_mgr *mgr,
 		return -EINVAL;
 	}
 
+	clk_rate = perf->clk_rate;
+	bw = perf->bw;
+
 	perf->config = *config;
 	ret = sde_rotator_calc_perf(mgr, perf);
 
@@ -2363,16 +2407,22 @@ static int sde_rotator_config_session(struct sde_rot_mgr *mgr,
 		goto done;
 	}
 
-	ret = sde_rotator_update_perf(mgr);
-	if (ret) {
-		SDEROT_ERR("error in updating perf: %d\n", ret);
-		goto done;
+	/* votes only need to move when the session needs change */
+	if (perf->bw != bw) {
+		ret = sde_rotator_update_perf(mgr);
+		if (ret) {
+			SDEROT_ERR("error in updating perf: %d\n", ret);
+			goto done;
+		}
 	}
 
-	ret = sde_rotator_update_clk(mgr);
-	if (ret) {
-		SDEROT_ERR("error in updating the rotator clk: %d\n", ret);
-		goto done;
+	if (perf->clk_rate != clk_rate) {
+		ret = sde_rotator_update_clk(mgr);
+		if (ret) {
+			SDEROT_ERR("error in updating the rotator clk: %d\n",
+					ret);
+			goto done;
+		}
 	}
 
 	if (config->output.sbuf && mgr->sbuf_ctx != private && mgr->sbuf_ctx) {
@@ -4443,6 +4443,36 @@ int msm_comm_qbuf(struct msm_vidc_inst *inst, struct msm_vidc_buffer *mbuf)
 		}
 	}
 
+	/*
+	 * Several buffers at once (deferred ones, or everything held back
+	 * until streamon) go to the queue under one lock and one interrupt.
+	 */
+	if (!batch_mode && etbs.count + ftbs.count > 1 &&
+			!is_heic_encode_session(inst)) {
+		int c = 0;
+
+		rc = call_hfi_op(hdev, session_queue_buffers, inst->session,
+				etbs.count, etbs.data, ftbs.count, ftbs.data);
+		if (rc) {
+			dprintk(VIDC_ERR,
+				"Failed to queue %d ETBs and %d FTBs\n",
+				etbs.count, ftbs.count);
+			goto err_bad_input;
+		}
+
+		for (c = 0; c < ftbs.count; ++c) {
+			log_frame(inst, &ftbs.data[c],
+					V4L2_BUF_TYPE_VIDEO_CAPTURE_MPLANE);
+		}
+
+		for (c = 0; c < etbs.count; ++c) {
+			log_frame(inst, &etbs.data[c],
+					V4L2_BUF_TYPE_VIDEO_OUTPUT_MPLANE);
+		}
+
+		goto err_bad_input;
+	}
+
 	if (!batch_mode && etbs.count) {
 		int c = 0;
 
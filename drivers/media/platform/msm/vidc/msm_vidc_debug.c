@@ -66,6 +66,7 @@ static ssize_t core_info_read(struct file *file, char __user *buf,
 	struct msm_vidc_core *core = file->private_data;
 	struct hfi_device *hdev;
 	struct hal_fw_info fw_info = { {0} };
+	struct hal_cmdq_stats cmdq_stats = {0};
 	char *dbuf, *cur, *end;
 	int i = 0, rc = 0;
 	ssize_t len = 0;
@@ -105,6 +106,19 @@ static ssize_t core_info_read(struct file *file, char __user *buf,
 	cur += write_str(cur, end - cur, "irq: %u\n", fw_info.irq);
 
 err_fw_info:
+	rc = call_hfi_op(hdev, get_cmdq_stats, hdev->hfi_device_data,
+			&cmdq_stats);
+	if (!rc) {
+		cur += write_str(cur, end - cur,
+			"cmdq packets: %llu interrupts: %llu\n",
+			cmdq_stats.packets, cmdq_stats.interrupts);
+		cur += write_str(cur, end - cur,
+			"cmdq packets per interrupt: 1:%llu 2:%llu 3-4:%llu 5-8:%llu 9-16:%llu >16:%llu\n",
+			cmdq_stats.batch_hist[0], cmdq_stats.batch_hist[1],
+			cmdq_stats.batch_hist[2], cmdq_stats.batch_hist[3],
+			cmdq_stats.batch_hist[4], cmdq_stats.batch_hist[5]);
+	}
+
 	for (i = SYS_MSG_START; i < SYS_MSG_END; i++) {
 		cur += write_str(cur, end - cur, "completions[%d]: %s\n", i,
 			completion_done(&core->completions[SYS_MSG_INDEX(i)]) ?
@@ -1224,6 +1224,8 @@ static int __iface_cmdq_write_relaxed(struct venus_hfi_device *device,
 	}
 
 	if (!__write_queue(q_info, (u8 *)pkt, requires_interrupt)) {
+		device->cmdq_pending++;
+		device->cmdq_stats.packets++;
 		if (device->res->sw_power_collapsible) {
 			cancel_delayed_work(&venus_hfi_pm_work);
 			if (!queue_delayed_work(device->venus_pm_workq,
@@ -1245,17 +1247,31 @@ static int __iface_cmdq_write_relaxed(struct venus_hfi_device *device,
 	return result;
 }
 
+/* Tells venus about every packet written since the last interrupt */
+static void __raise_cmdq_interrupt(struct venus_hfi_device *device)
+{
+	struct hal_cmdq_stats *stats = &device->cmdq_stats;
+	int bucket = 0;
+
+	if (device->cmdq_pending > 1)
+		bucket = min_t(int, ilog2(device->cmdq_pending - 1) + 1,
+				HAL_CMDQ_BATCH_BUCKETS - 1);
+	stats->batch_hist[bucket]++;
+	stats->interrupts++;
+	device->cmdq_pending = 0;
+
+	__write_register(device, VIDC_CPU_IC_SOFTINT,
+			1 << VIDC_CPU_IC_SOFTINT_H2A_SHFT);
+}
+
 static int __iface_cmdq_write(struct venus_hfi_device *device, void *pkt)
 {
 	bool needs_interrupt = false;
 	int rc = __iface_cmdq_write_relaxed(device, pkt, &needs_interrupt);
 
-	if (!rc && needs_interrupt) {
-		/* Consumer of cmdq prefers that we raise an interrupt */
-		rc = 0;
-		__write_register(device, VIDC_CPU_IC_SOFTINT,
-				1 << VIDC_CPU_IC_SOFTINT_H2A_SHFT);
-	}
+	/* Consumer of cmdq prefers that we raise an interrupt */
+	if (!rc && needs_interrupt)
+		__raise_cmdq_interrupt(device);
 
 	return rc;
 }
@@ -2441,8 +2457,28 @@ static int venus_hfi_session_stop(void *session)
 	return rc;
 }
 
+static int __session_cmdq_write(struct venus_hfi_device *device, void *pkt,
+		bool *needs_interrupt)
+{
+	bool interrupt = false;
+	int rc;
+
+	if (!needs_interrupt)
+		return __iface_cmdq_write(device, pkt);
+
+	rc = __iface_cmdq_write_relaxed(device, pkt, &interrupt);
+	if (!rc)
+		*needs_interrupt |= interrupt;
+
+	return rc;
+}
+
+/*
+ * With @needs_interrupt the packet is only written to the queue and
+ * whether venus asked for an interrupt is accumulated for the caller.
+ */
 static int __session_etb(struct hal_session *session,
-		struct vidc_frame_data *input_frame, bool relaxed)
+		struct vidc_frame_data *input_frame, bool *needs_interrupt)
 {
 	int rc = 0;
 	struct venus_hfi_device *device = session->device;
@@ -2461,11 +2497,8 @@ static int __session_etb(struct hal_session *session,
 			goto err_create_pkt;
 		}
 
-		if (!relaxed)
-			rc = __iface_cmdq_write(session->device, &pkt);
-		else
-			rc = __iface_cmdq_write_relaxed(session->device,
-					&pkt, NULL);
+		rc = __session_cmdq_write(session->device, &pkt,
+				needs_interrupt);
 		if (rc)
 			goto err_create_pkt;
 	} else {
@@ -2480,11 +2513,8 @@ static int __session_etb(struct hal_session *session,
 			goto err_create_pkt;
 		}
 
-		if (!relaxed)
-			rc = __iface_cmdq_write(session->device, &pkt);
-		else
-			rc = __iface_cmdq_write_relaxed(session->device,
-					&pkt, NULL);
+		rc = __session_cmdq_write(session->device, &pkt,
+				needs_interrupt);
 		if (rc)
 			goto err_create_pkt;
 	}
@@ -2507,13 +2537,13 @@ static int venus_hfi_session_etb(void *sess,
 
 	device = session->device;
 	mutex_lock(&device->lock);
-	rc = __session_etb(session, input_frame, false);
+	rc = __session_etb(session, input_frame, NULL);
 	mutex_unlock(&device->lock);
 	return rc;
 }
 
 static int __session_ftb(struct hal_session *session,
-		struct vidc_frame_data *output_frame, bool relaxed)
+		struct vidc_frame_data *output_frame, bool *needs_interrupt)
 {
 	int rc = 0;
 	struct venus_hfi_device *device = session->device;
@@ -2529,11 +2559,7 @@ static int __session_ftb(struct hal_session *session,
 		goto err_create_pkt;
 	}
 
-	if (!relaxed)
-		rc = __iface_cmdq_write(session->device, &pkt);
-	else
-		rc = __iface_cmdq_write_relaxed(session->device,
-				&pkt, NULL);
+	rc = __session_cmdq_write(session->device, &pkt, needs_interrupt);
 
 err_create_pkt:
 	return rc;
@@ -2553,7 +2579,7 @@ static int venus_hfi_session_ftb(void *sess,
 
 	device = session->device;
 	mutex_lock(&device->lock);
-	rc = __session_ftb(session, output_frame, false);
+	rc = __session_ftb(session, output_frame, NULL);
 	mutex_unlock(&device->lock);
 	return rc;
 }
@@ -2566,6 +2592,7 @@ static int venus_hfi_session_process_batch(void *sess,
 	struct hal_session *session = sess;
 	struct venus_hfi_device *device;
 	struct hfi_cmd_session_sync_process_packet pkt;
+	bool needs_interrupt = false;
 
 	if (!session || !session->device) {
 		dprintk(VIDC_ERR, "%s: Invalid Params\n", __func__);
@@ -2582,7 +2609,7 @@ static int venus_hfi_session_process_batch(void *sess,
 	}
 
 	for (c = 0; c < num_ftbs; ++c) {
-		rc = __session_ftb(session, &ftbs[c], true);
+		rc = __session_ftb(session, &ftbs[c], &needs_interrupt);
 		if (rc) {
 			dprintk(VIDC_ERR, "Failed to queue batched ftb: %d\n",
 					rc);
@@ -2591,7 +2618,7 @@ static int venus_hfi_session_process_batch(void *sess,
 	}
 
 	for (c = 0; c < num_etbs; ++c) {
-		rc = __session_etb(session, &etbs[c], true);
+		rc = __session_etb(session, &etbs[c], &needs_interrupt);
 		if (rc) {
 			dprintk(VIDC_ERR, "Failed to queue batched etb: %d\n",
 					rc);
@@ -2605,10 +2632,67 @@ static int venus_hfi_session_process_batch(void *sess,
 		goto err_etbs_and_ftbs;
 	}
 
-	if (__iface_cmdq_write(session->device, &pkt))
+	if (__iface_cmdq_write_relaxed(session->device, &pkt,
+				&needs_interrupt))
 		rc = -ENOTEMPTY;
 
 err_etbs_and_ftbs:
+	if (needs_interrupt)
+		__raise_cmdq_interrupt(device);
+	mutex_unlock(&device->lock);
+	return rc;
+}
+
+/*
+ * Writes the FTBs and then the ETBs to the command queue under one lock,
+ * raising a single interrupt at the end if venus asked for one. Unlike
+ * session_process_batch() the buffers are processed as they arrive.
+ */
+static int venus_hfi_session_queue_buffers(void *sess,
+		int num_etbs, struct vidc_frame_data etbs[],
+		int num_ftbs, struct vidc_frame_data ftbs[])
+{
+	int rc = 0, c = 0;
+	struct hal_session *session = sess;
+	struct venus_hfi_device *device;
+	bool needs_interrupt = false;
+
+	if (!session || !session->device) {
+		dprintk(VIDC_ERR, "%s: Invalid Params\n", __func__);
+		return -EINVAL;
+	}
+
+	device = session->device;
+
+	mutex_lock(&device->lock);
+
+	if (!__is_session_valid(device, session, __func__)) {
+		rc = -EINVAL;
+		goto err_etbs_and_ftbs;
+	}
+
+	for (c = 0; c < num_ftbs; ++c) {
+		rc = __session_ftb(session, &ftbs[c], &needs_interrupt);
+		if (rc) {
+			dprintk(VIDC_ERR, "Failed to queue ftb %d: %d\n",
+					c, rc);
+			goto err_etbs_and_ftbs;
+		}
+	}
+
+	for (c = 0; c < num_etbs; ++c) {
+		rc = __session_etb(session, &etbs[c], &needs_interrupt);
+		if (rc) {
+			dprintk(VIDC_ERR, "Failed to queue etb %d: %d\n",
+					c, rc);
+			goto err_etbs_and_ftbs;
+		}
+	}
+
+err_etbs_and_ftbs:
+	/* Packets that made it into the queue still need to be picked up */
+	if (needs_interrupt)
+		__raise_cmdq_interrupt(device);
 	mutex_unlock(&device->lock);
 	return rc;
 }
@@ -4337,6 +4421,23 @@ static void __unload_fw(struct venus_hfi_device *device)
 	dprintk(VIDC_PROF, "Firmware unloaded successfully\n");
 }
 
+static int venus_hfi_get_cmdq_stats(void *dev, struct hal_cmdq_stats *stats)
+{
+	struct venus_hfi_device *device = dev;
+
+	if (!device || !stats) {
+		dprintk(VIDC_ERR, "%s Invalid parameter: %pK %pK\n",
+			__func__, device, stats);
+		return -EINVAL;
+	}
+
+	mutex_lock(&device->lock);
+	*stats = device->cmdq_stats;
+	mutex_unlock(&device->lock);
+
+	return 0;
+}
+
 static int venus_hfi_get_fw_info(void *dev, struct hal_fw_info *fw_info)
 {
 	int i = 0, j = 0;
@@ -4651,6 +4752,7 @@ static void venus_init_hfi_callbacks(struct hfi_device *hdev)
 	hdev->session_etb = venus_hfi_session_etb;
 	hdev->session_ftb = venus_hfi_session_ftb;
 	hdev->session_process_batch = venus_hfi_session_process_batch;
+	hdev->session_queue_buffers = venus_hfi_session_queue_buffers;
 	hdev->session_get_buf_req = venus_hfi_session_get_buf_req;
 	hdev->session_flush = venus_hfi_session_flush;
 	hdev->session_set_property = venus_hfi_session_set_property;
@@ -4658,6 +4760,7 @@ static void venus_init_hfi_callbacks(struct hfi_device *hdev)
 	hdev->scale_clocks = venus_hfi_scale_clocks;
 	hdev->vote_bus = venus_hfi_vote_buses;
 	hdev->get_fw_info = venus_hfi_get_fw_info;
+	hdev->get_cmdq_stats = venus_hfi_get_cmdq_stats;
 	hdev->get_core_capabilities = venus_hfi_get_core_capabilities;
 	hdev->suspend = venus_hfi_suspend;
 	hdev->flush_debug_queue = venus_hfi_flush_debug_queue;
@@ -257,6 +257,8 @@ struct venus_hfi_device {
 	struct pm_qos_request qos;
 	unsigned int skip_pc_count;
 	struct msm_vidc_capability *sys_init_capabilities;
+	u32 cmdq_pending;
+	struct hal_cmdq_stats cmdq_stats;
 };
 
 void venus_hfi_delete_device(void *device);
@@ -992,6 +992,15 @@ struct hal_fw_info {
 	int irq;
 };
 
+/* 1, 2, 3-4, 5-8, 9-16 and more than 16 packets per interrupt */
+#define HAL_CMDQ_BATCH_BUCKETS 6
+
+struct hal_cmdq_stats {
+	u64 packets;
+	u64 interrupts;
+	u64 batch_hist[HAL_CMDQ_BATCH_BUCKETS];
+};
+
 enum hal_flush {
 	HAL_FLUSH_INPUT,
 	HAL_FLUSH_OUTPUT,
@@ -1470,6 +1479,9 @@ struct hfi_device {
 	int (*session_process_batch)(void *sess,
 		int num_etbs, struct vidc_frame_data etbs[],
 		int num_ftbs, struct vidc_frame_data ftbs[]);
+	int (*session_queue_buffers)(void *sess,
+		int num_etbs, struct vidc_frame_data etbs[],
+		int num_ftbs, struct vidc_frame_data ftbs[]);
 	int (*session_get_buf_req)(void *sess);
 	int (*session_flush)(void *sess, enum hal_flush flush_mode);
 	int (*session_set_property)(void *sess, enum hal_property ptype,
@@ -1479,6 +1491,7 @@ struct hfi_device {
 	int (*vote_bus)(void *dev, struct vidc_bus_vote_data *data,
 			int num_data);
 	int (*get_fw_info)(void *dev, struct hal_fw_info *fw_info);
+	int (*get_cmdq_stats)(void *dev, struct hal_cmdq_stats *stats);
 	int (*session_clean)(void *sess);
 	int (*get_core_capabilities)(void *dev);
 	int (*suspend)(void *dev);
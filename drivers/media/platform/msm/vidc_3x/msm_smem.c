@@ -21,13 +21,25 @@
 #include <linux/types.h>
 #include "media/msm_vidc.h"
 #include "msm_vidc_debug.h"
+#include "msm_vidc_internal.h"
 #include "msm_vidc_resources.h"
 
+/* A user buffer mapping, in use or kept for re-registration */
+struct smem_map {
+	struct list_head list;
+	struct msm_smem mem;
+};
+
 struct smem_client {
 	int mem_type;
 	void *clnt;
 	struct msm_vidc_platform_resources *res;
 	enum session_type session_type;
+	struct mutex map_lock;
+	struct list_head mapped;
+	/* Released mappings, most recently used first */
+	struct list_head map_cache;
+	struct msm_smem_map_stats map_stats;
 };
 
 static int get_device_address(struct smem_client *smem_client,
@@ -430,25 +442,139 @@ static void ion_delete_client(struct smem_client *client)
 	ion_client_destroy(client->clnt);
 }
 
+static void smem_map_free(struct smem_client *client, struct smem_map *map)
+{
+	free_ion_mem(client, &map->mem);
+	kfree(map);
+}
+
+/*
+ * Codec reconfiguration and seeks register the same gralloc buffers
+ * again; hand back their existing mapping instead of importing,
+ * attaching and mapping them into the SMMU once more.
+ */
+static struct smem_map *smem_map_lookup(struct smem_client *client, int fd,
+		enum hal_buffer buffer_type)
+{
+	struct smem_map *map, *found = NULL;
+	struct dma_buf *dbuf;
+
+	dbuf = dma_buf_get(fd);
+	if (IS_ERR_OR_NULL(dbuf))
+		return NULL;
+
+	mutex_lock(&client->map_lock);
+	list_for_each_entry(map, &client->mapped, list) {
+		if (map->mem.mapping_info.buf == dbuf &&
+			map->mem.buffer_type == buffer_type) {
+			map->mem.refcount++;
+			found = map;
+			goto exit;
+		}
+	}
+
+	list_for_each_entry(map, &client->map_cache, list) {
+		if (map->mem.mapping_info.buf == dbuf &&
+			map->mem.buffer_type == buffer_type) {
+			list_move(&map->list, &client->mapped);
+			client->map_stats.cached--;
+			map->mem.refcount = 1;
+			found = map;
+			goto exit;
+		}
+	}
+exit:
+	if (found)
+		client->map_stats.hits++;
+	mutex_unlock(&client->map_lock);
+	dma_buf_put(dbuf);
+
+	return found;
+}
+
+/* Drops mappings of buffers nobody but the cache holds anymore */
+static void smem_map_cache_prune(struct smem_client *client,
+		struct list_head *victims)
+{
+	struct smem_map *map, *temp;
+
+	list_for_each_entry_safe(map, temp, &client->map_cache, list) {
+		if (file_count(map->mem.mapping_info.buf->file) == 1) {
+			list_move(&map->list, victims);
+			client->map_stats.cached--;
+		}
+	}
+
+	while (client->map_stats.cached > msm_vidc_map_cache_size) {
+		map = list_last_entry(&client->map_cache, struct smem_map,
+				list);
+		list_move(&map->list, victims);
+		client->map_stats.cached--;
+	}
+}
+
+/* Returns false if @mem is not a user buffer mapping */
+static bool smem_map_put(struct smem_client *client, struct msm_smem *mem)
+{
+	struct smem_map *map, *temp;
+	bool found = false;
+	LIST_HEAD(victims);
+
+	mutex_lock(&client->map_lock);
+	list_for_each_entry(map, &client->mapped, list) {
+		if (&map->mem == mem) {
+			found = true;
+			break;
+		}
+	}
+
+	if (found && !--mem->refcount) {
+		list_move(&map->list, &client->map_cache);
+		client->map_stats.cached++;
+		smem_map_cache_prune(client, &victims);
+	}
+	mutex_unlock(&client->map_lock);
+
+	list_for_each_entry_safe(map, temp, &victims, list)
+		smem_map_free(client, map);
+
+	return found;
+}
+
 struct msm_smem *msm_smem_user_to_kernel(void *clt, int fd, u32 offset,
 		enum hal_buffer buffer_type)
 {
 	struct smem_client *client = clt;
 	int rc = 0;
-	struct msm_smem *mem;
+	struct smem_map *map;
+	ktime_t start;
+	s64 map_us;
 
 	if (fd < 0) {
 		dprintk(VIDC_ERR, "Invalid fd: %d\n", fd);
 		return NULL;
 	}
-	mem = kzalloc(sizeof(*mem), GFP_KERNEL);
-	if (!mem) {
+
+	if (client->mem_type == SMEM_ION && is_iommu_present(client->res)) {
+		map = smem_map_lookup(client, fd, buffer_type);
+		if (map) {
+			dprintk(VIDC_DBG,
+				"%s: reusing mapping of fd %d at %pa\n",
+				__func__, fd, &map->mem.device_addr);
+			return &map->mem;
+		}
+	}
+
+	map = kzalloc(sizeof(*map), GFP_KERNEL);
+	if (!map) {
 		dprintk(VIDC_ERR, "Failed to allocate shared mem\n");
 		return NULL;
 	}
+	start = ktime_get();
 	switch (client->mem_type) {
 	case SMEM_ION:
-		rc = ion_user_to_kernel(clt, fd, offset, mem, buffer_type);
+		rc = ion_user_to_kernel(clt, fd, offset, &map->mem,
+				buffer_type);
 		break;
 	default:
 		dprintk(VIDC_ERR, "Mem type not supported\n");
@@ -457,10 +583,36 @@ struct msm_smem *msm_smem_user_to_kernel(void *clt, int fd, u32 offset,
 	}
 	if (rc) {
 		dprintk(VIDC_ERR, "Failed to allocate shared memory\n");
-		kfree(mem);
-		mem = NULL;
+		kfree(map);
+		return NULL;
 	}
-	return mem;
+	map_us = ktime_us_delta(ktime_get(), start);
+	dprintk(VIDC_PROF, "%s: mapped fd %d in %lld us\n",
+		__func__, fd, map_us);
+
+	map->mem.refcount = 1;
+	mutex_lock(&client->map_lock);
+	list_add(&map->list, &client->mapped);
+	client->map_stats.misses++;
+	client->map_stats.map_time_us += map_us;
+	mutex_unlock(&client->map_lock);
+
+	return &map->mem;
+}
+
+void msm_smem_get_map_stats(void *clt, struct msm_smem_map_stats *stats)
+{
+	struct smem_client *client = clt;
+
+	if (!client || !stats) {
+		dprintk(VIDC_ERR, "%s: Invalid params: %pK %pK\n",
+			__func__, client, stats);
+		return;
+	}
+
+	mutex_lock(&client->map_lock);
+	*stats = client->map_stats;
+	mutex_unlock(&client->map_lock);
 }
 
 bool msm_smem_compare_buffers(void *clt, int fd, void *priv)
@@ -577,6 +729,9 @@ void *msm_smem_new_client(enum smem_type mtype,
 			client->clnt = clnt;
 			client->res = res;
 			client->session_type = stype;
+			mutex_init(&client->map_lock);
+			INIT_LIST_HEAD(&client->mapped);
+			INIT_LIST_HEAD(&client->map_cache);
 		}
 	} else {
 		dprintk(VIDC_ERR, "Failed to create new client: mtype = %d\n",
@@ -635,6 +790,8 @@ void msm_smem_free(void *clt, struct msm_smem *mem)
 	}
 	switch (client->mem_type) {
 	case SMEM_ION:
+		if (smem_map_put(client, mem))
+			return;
 		free_ion_mem(client, mem);
 		break;
 	default:
@@ -647,11 +804,26 @@ void msm_smem_free(void *clt, struct msm_smem *mem)
 void msm_smem_delete_client(void *clt)
 {
 	struct smem_client *client = clt;
+	struct smem_map *map, *temp;
 
 	if (!client) {
 		dprintk(VIDC_ERR, "Invalid  client passed\n");
 		return;
 	}
+
+	/* The session is gone, so are the buffers it could register again */
+	list_for_each_entry_safe(map, temp, &client->map_cache, list) {
+		list_del(&map->list);
+		smem_map_free(client, map);
+	}
+
+	list_for_each_entry_safe(map, temp, &client->mapped, list) {
+		dprintk(VIDC_WARN, "%s: fd mapping at %pa still in use\n",
+			__func__, &map->mem.device_addr);
+		list_del(&map->list);
+		smem_map_free(client, map);
+	}
+
 	switch (client->mem_type) {
 	case SMEM_ION:
 		ion_delete_client(client);
@@ -2177,6 +2177,12 @@ static void handle_fbd(enum hal_command_response cmd, void *data)
 			break;
 		}
 
+		if (inst->session_type == MSM_VIDC_ENCODER)
+			msm_dcvs_record_frame_size(inst,
+				fill_buf_done->filled_len1);
+		else if (fill_buf_done->filled_len1)
+			msm_dcvs_record_fbd(inst);
+
 		inst->count.fbd++;
 
 		if (extra_idx && extra_idx < VIDEO_MAX_PLANES) {
@@ -2615,6 +2621,16 @@ int msm_comm_check_core_init(struct msm_vidc_core *core)
 		core->state = VIDC_CORE_INIT_DONE;
 		rc = 0;
 	}
+	if (ktime_to_ns(core->boot_start)) {
+		core->last_boot_us = ktime_us_delta(ktime_get(),
+				core->boot_start);
+		core->max_boot_us = max(core->max_boot_us,
+				core->last_boot_us);
+		core->boots++;
+		core->boot_start = ktime_set(0, 0);
+		dprintk(VIDC_PROF, "Video core %d ready in %lld us\n",
+				core->id, core->last_boot_us);
+	}
 	dprintk(VIDC_DBG, "SYS_INIT_DONE!!!\n");
 exit:
 	mutex_unlock(&core->lock);
@@ -2668,10 +2684,12 @@ static int msm_comm_init_core(struct msm_vidc_inst *inst)
 			__func__);
 	}
 
+	core->boot_start = ktime_get();
 	rc = call_hfi_op(hdev, core_init, hdev->hfi_device_data);
 	if (rc) {
 		dprintk(VIDC_ERR, "Failed to init core, id = %d\n",
 				core->id);
+		core->boot_start = ktime_set(0, 0);
 		goto fail_core_init;
 	}
 	core->state = VIDC_CORE_INIT;
@@ -2715,7 +2733,14 @@ static int msm_vidc_deinit_core(struct msm_vidc_inst *inst)
 
 	mutex_lock(&core->lock);
 
-	if (!core->resources.never_unload_fw) {
+	/*
+	 * Keeping the firmware resident leaves the core power collapsed
+	 * between sessions, so the next one resumes instead of waiting
+	 * for PIL to load and authenticate the image again.
+	 */
+	if (!core->resources.never_unload_fw &&
+		(!msm_vidc_fw_keep_resident ||
+		core->state == VIDC_CORE_INVALID)) {
 		cancel_delayed_work(&core->fw_unload_work);
 
 		/*
@@ -3766,6 +3791,9 @@ static void log_frame(struct msm_vidc_inst *inst, struct vidc_frame_data *data,
 				data->timestamp, data->flags);
 		msm_vidc_debugfs_update(inst, MSM_VIDC_DEBUGFS_EVENT_ETB);
 
+		if (inst->session_type == MSM_VIDC_DECODER)
+			msm_dcvs_record_frame_size(inst, data->filled_len);
+
 		if (msm_vidc_bitrate_clock_scaling &&
 			inst->session_type == MSM_VIDC_DECODER &&
 			!inst->dcvs_mode)
@@ -205,6 +205,115 @@ static inline void msm_dcvs_print_dcvs_stats(struct dcvs_stats *dcvs)
 		dcvs->min_threshold, dcvs->max_threshold);
 }
 
+/* Size of the last frames relative to the running average, in percent */
+static int msm_dcvs_get_complexity(struct dcvs_stats *dcvs)
+{
+	u64 sum = 0;
+	int i;
+
+	if (dcvs->frame_count < DCVS_FRAME_WINDOW || !dcvs->frame_size_avg)
+		return 100;
+
+	for (i = 0; i < DCVS_FRAME_WINDOW; i++)
+		sum += dcvs->frame_size[i];
+
+	return div64_u64(sum * 100,
+		(u64)dcvs->frame_size_avg * DCVS_FRAME_WINDOW);
+}
+
+static void msm_dcvs_log_decision(struct dcvs_stats *dcvs, const char *reason,
+		int complexity, int buffers)
+{
+	struct dcvs_decision *d = &dcvs->log[dcvs->log_index];
+
+	d->time = ktime_get();
+	d->reason = reason;
+	d->load = dcvs->load;
+	d->complexity = complexity;
+	d->buffers = buffers;
+	d->missed_deadlines = dcvs->missed_deadlines;
+
+	dcvs->log_index = (dcvs->log_index + 1) % DCVS_DECISION_LOG_SIZE;
+	if (dcvs->log_count < DCVS_DECISION_LOG_SIZE)
+		dcvs->log_count++;
+}
+
+/*
+ * Bitstream size is the best per frame cost estimate available here: the
+ * firmware does not report cycles. Decoders record it at ETB, encoders at
+ * FBD.
+ */
+void msm_dcvs_record_frame_size(struct msm_vidc_inst *inst, u32 size)
+{
+	struct dcvs_stats *dcvs;
+
+	if (!inst) {
+		dprintk(VIDC_ERR, "%s Invalid args: %pK\n", __func__, inst);
+		return;
+	}
+
+	dcvs = &inst->dcvs;
+	if (!size)
+		return;
+
+	dcvs->frame_size[dcvs->frame_index] = size;
+	dcvs->frame_index = (dcvs->frame_index + 1) % DCVS_FRAME_WINDOW;
+
+	/* Running average over roughly the last 32 frames */
+	if (!dcvs->frame_size_avg)
+		dcvs->frame_size_avg = size;
+	else
+		dcvs->frame_size_avg = div_u64(
+			(u64)dcvs->frame_size_avg * 31 + size, 32);
+
+	if (dcvs->frame_count < DCVS_FRAME_WINDOW)
+		dcvs->frame_count++;
+}
+
+/*
+ * A decoded frame is late when it comes out more than 1.5 frame periods
+ * after the previous one while the firmware still had input and another
+ * output buffer to work with, i.e. the clock rather than the client held
+ * it back.
+ */
+void msm_dcvs_record_fbd(struct msm_vidc_inst *inst)
+{
+	struct dcvs_stats *dcvs;
+	ktime_t now = ktime_get();
+	s64 interval_us, period_us;
+	bool fw_starved;
+
+	if (!inst) {
+		dprintk(VIDC_ERR, "%s Invalid args: %pK\n", __func__, inst);
+		return;
+	}
+
+	dcvs = &inst->dcvs;
+	if (!inst->dcvs_mode || !inst->prop.fps ||
+		!ktime_to_ns(dcvs->last_fbd)) {
+		dcvs->last_fbd = now;
+		return;
+	}
+
+	interval_us = ktime_us_delta(now, dcvs->last_fbd);
+	period_us = USEC_PER_SEC / inst->prop.fps;
+	dcvs->last_fbd = now;
+
+	mutex_lock(&inst->lock);
+	fw_starved = inst->count.etb == inst->count.ebd ||
+		inst->count.ftb - inst->count.fbd <= 1;
+	mutex_unlock(&inst->lock);
+
+	if (interval_us > period_us * 3 / 2 && !fw_starved)
+		dcvs->missed_deadlines++;
+	else if (interval_us <= period_us && dcvs->missed_deadlines)
+		dcvs->missed_deadlines--;
+
+	dprintk(VIDC_PROF,
+		"DCVS: fbd interval %lld us period %lld us missed %d\n",
+		interval_us, period_us, dcvs->missed_deadlines);
+}
+
 void msm_dcvs_init_load(struct msm_vidc_inst *inst)
 {
 	struct msm_vidc_core *core;
@@ -384,6 +493,8 @@ void msm_dcvs_monitor_buffer(struct msm_vidc_inst *inst)
 static int msm_dcvs_enc_scale_clocks(struct msm_vidc_inst *inst)
 {
 	int rc = 0, fw_pending_bufs = 0, total_input_buf = 0;
+	int complexity;
+	const char *reason = NULL;
 	struct msm_vidc_core *core;
 	struct dcvs_stats *dcvs;
 
@@ -415,27 +526,39 @@ static int msm_dcvs_enc_scale_clocks(struct msm_vidc_inst *inst)
 		total_input_buf, fw_pending_bufs,
 		dcvs->etb_counter, dcvs->load);
 
+	complexity = msm_dcvs_get_complexity(dcvs);
+
+	/* Hold the high load while recent frames are costlier than usual */
 	if (fw_pending_bufs <= DCVS_ENC_LOW_THR &&
+		complexity < DCVS_COMPLEXITY_HIGH &&
 		dcvs->load > dcvs->load_low) {
 		dcvs->load = dcvs->load_low;
 		dcvs->prev_freq_lowered = true;
+		reason = "buffers";
 	} else {
 		dcvs->prev_freq_lowered = false;
 	}
 
-	if (fw_pending_bufs >= DCVS_ENC_HIGH_THR &&
-		dcvs->load <= dcvs->load_low) {
+	if (dcvs->load <= dcvs->load_low &&
+		(fw_pending_bufs >= DCVS_ENC_HIGH_THR ||
+		(complexity >= DCVS_COMPLEXITY_HIGH &&
+		fw_pending_bufs > DCVS_ENC_LOW_THR))) {
 		dcvs->load = dcvs->load_high;
 		dcvs->prev_freq_increased = true;
+		reason = fw_pending_bufs >= DCVS_ENC_HIGH_THR ?
+			"buffers" : "complexity";
 	} else {
 		dcvs->prev_freq_increased = false;
 	}
 
 	if (dcvs->prev_freq_lowered || dcvs->prev_freq_increased) {
 		dprintk(VIDC_PROF,
-			"DCVS: (Scaling Clock %s)  etb clock set = %d total_input_buf = %d fw_pending_bufs %d\n",
+			"DCVS: (Scaling Clock %s)  etb clock set = %d total_input_buf = %d fw_pending_bufs %d complexity %d\n",
 			dcvs->prev_freq_lowered ? "Lower" : "Higher",
-			dcvs->load, total_input_buf, fw_pending_bufs);
+			dcvs->load, total_input_buf, fw_pending_bufs,
+			complexity);
+		msm_dcvs_log_decision(dcvs, reason, complexity,
+			fw_pending_bufs);
 
 		rc = msm_comm_scale_clocks_load(core, dcvs->load,
 				LOAD_CALC_NO_QUIRKS);
@@ -466,6 +589,9 @@ static int msm_dcvs_dec_scale_clocks(struct msm_vidc_inst *inst, bool fbd)
 	int fw_pending_bufs = 0;
 	int total_output_buf = 0;
 	int buffers_outside_fw = 0;
+	int complexity;
+	bool busy, idle;
+	const char *reason = NULL;
 	struct msm_vidc_core *core;
 	struct hal_buffer_requirements *output_buf_req;
 	struct dcvs_stats *dcvs;
@@ -495,16 +621,39 @@ static int msm_dcvs_dec_scale_clocks(struct msm_vidc_inst *inst, bool fbd)
 	/* Buffers outside FW are with display */
 	buffers_outside_fw = total_output_buf - fw_pending_bufs;
 
-	if (buffers_outside_fw >= dcvs->threshold_disp_buf_high &&
-		!dcvs->prev_freq_increased &&
+	/*
+	 * The display queue says how much slack there is now; the recent
+	 * frame sizes and late frames say what the next frames will need.
+	 * Costly frames or missed deadlines keep or bring back the high
+	 * load, and cheap frames let the low load in before the display
+	 * queue fills all the way.
+	 */
+	complexity = msm_dcvs_get_complexity(dcvs);
+	busy = complexity >= DCVS_COMPLEXITY_HIGH ||
+		dcvs->missed_deadlines >= DCVS_DEADLINE_MISS_THR;
+	idle = complexity <= DCVS_COMPLEXITY_LOW &&
+		buffers_outside_fw > dcvs->threshold_disp_buf_low +
+			DCVS_BUFFER_SAFEGUARD;
+
+	if ((buffers_outside_fw >= dcvs->threshold_disp_buf_high || idle) &&
+		!busy && !dcvs->prev_freq_increased &&
 		dcvs->load > dcvs->load_low) {
 		dcvs->load = dcvs->load_low;
 		dcvs->prev_freq_lowered = true;
 		dcvs->prev_freq_increased = false;
-	} else if (dcvs->transition_turbo && dcvs->load == dcvs->load_low) {
+		reason = buffers_outside_fw >= dcvs->threshold_disp_buf_high ?
+			"buffers" : "complexity";
+	} else if ((dcvs->transition_turbo || busy) &&
+		dcvs->load == dcvs->load_low) {
 		dcvs->load = dcvs->load_high;
 		dcvs->prev_freq_increased = true;
 		dcvs->prev_freq_lowered = false;
+		if (dcvs->transition_turbo)
+			reason = "buffers";
+		else if (dcvs->missed_deadlines >= DCVS_DEADLINE_MISS_THR)
+			reason = "deadline";
+		else
+			reason = "complexity";
 		dcvs->transition_turbo = false;
 	} else {
 		dcvs->prev_freq_increased = false;
@@ -513,9 +662,13 @@ static int msm_dcvs_dec_scale_clocks(struct msm_vidc_inst *inst, bool fbd)
 
 	if (dcvs->prev_freq_lowered || dcvs->prev_freq_increased) {
 		dprintk(VIDC_PROF,
-			"DCVS: clock set = %d tot_output_buf = %d buffers_outside_fw %d threshold_high %d transition_turbo %d\n",
+			"DCVS: clock set = %d tot_output_buf = %d buffers_outside_fw %d threshold_high %d transition_turbo %d complexity %d missed %d\n",
 			dcvs->load, total_output_buf, buffers_outside_fw,
-			dcvs->threshold_disp_buf_high, dcvs->transition_turbo);
+			dcvs->threshold_disp_buf_high, dcvs->transition_turbo,
+			complexity, dcvs->missed_deadlines);
+		msm_dcvs_log_decision(dcvs, reason, complexity,
+			buffers_outside_fw);
+		dcvs->missed_deadlines = 0;
 
 		rc = msm_comm_scale_clocks_load(core, dcvs->load,
 				LOAD_CALC_NO_QUIRKS);
@@ -31,11 +31,20 @@
 /* Considering one safeguard buffer */
 #define DCVS_BUFFER_SAFEGUARD (DCVS_DEC_EXTRA_OUTPUT_BUFFERS - 1)
 
+/* Recent frames this much bigger than average (in %) need the high load */
+#define DCVS_COMPLEXITY_HIGH 125
+/* Recent frames this much smaller than average (in %) allow the low load */
+#define DCVS_COMPLEXITY_LOW 75
+/* Frames later than 1.5 frame periods that force the high load */
+#define DCVS_DEADLINE_MISS_THR 2
+
 void msm_dcvs_init(struct msm_vidc_inst *inst);
 void msm_dcvs_init_load(struct msm_vidc_inst *inst);
 void msm_dcvs_monitor_buffer(struct msm_vidc_inst *inst);
 void msm_dcvs_check_and_scale_clocks(struct msm_vidc_inst *inst, bool is_etb);
 int  msm_dcvs_get_extra_buff_count(struct msm_vidc_inst *inst);
+void msm_dcvs_record_frame_size(struct msm_vidc_inst *inst, u32 size);
+void msm_dcvs_record_fbd(struct msm_vidc_inst *inst);
 void msm_dcvs_enc_set_power_save_mode(struct msm_vidc_inst *inst,
 		bool is_power_save_mode);
 #endif
@@ -31,6 +31,8 @@ int msm_vidc_firmware_unload_delay = 15000;
 bool msm_vidc_thermal_mitigation_disabled = true;
 bool msm_vidc_bitrate_clock_scaling = 1;
 bool msm_vidc_debug_timeout = true;
+int msm_vidc_map_cache_size = 16;
+bool msm_vidc_fw_keep_resident;
 
 #define MAX_DBG_BUF_SIZE 4096
 
@@ -67,6 +69,7 @@ static ssize_t core_info_read(struct file *file, char __user *buf,
 	struct msm_vidc_core *core = file->private_data;
 	struct hfi_device *hdev;
 	struct hal_fw_info fw_info = { {0} };
+	struct hal_boot_stats boot_stats = {0};
 	char *dbuf, *cur, *end;
 	int i = 0, rc = 0;
 	ssize_t len = 0;
@@ -106,6 +109,22 @@ static ssize_t core_info_read(struct file *file, char __user *buf,
 	cur += write_str(cur, end - cur, "irq: %u\n", fw_info.irq);
 
 err_fw_info:
+	cur += write_str(cur, end - cur,
+		"boot to ready: %u boots, last %lld us, max %lld us\n",
+		core->boots, core->last_boot_us, core->max_boot_us);
+	rc = call_hfi_op(hdev, get_boot_stats, hdev->hfi_device_data,
+			&boot_stats);
+	if (!rc) {
+		cur += write_str(cur, end - cur,
+			"fw load: %u loads, last %lld us, max %lld us\n",
+			boot_stats.fw_loads, boot_stats.last_load_us,
+			boot_stats.max_load_us);
+		cur += write_str(cur, end - cur,
+			"power collapse resume: %u resumes, last %lld us, max %lld us\n",
+			boot_stats.resumes, boot_stats.last_resume_us,
+			boot_stats.max_resume_us);
+	}
+
 	for (i = SYS_MSG_START; i < SYS_MSG_END; i++) {
 		cur += write_str(cur, end - cur, "completions[%d]: %s\n", i,
 			completion_done(&core->completions[SYS_MSG_INDEX(i)]) ?
@@ -208,7 +227,11 @@ struct dentry *msm_vidc_debugfs_init_drv(void)
 	__debugfs_create(bool, "bitrate_clock_scaling",
 			&msm_vidc_bitrate_clock_scaling) &&
 	__debugfs_create(bool, "debug_timeout",
-			&msm_vidc_debug_timeout);
+			&msm_vidc_debug_timeout) &&
+	__debugfs_create(u32, "map_cache_size",
+			&msm_vidc_map_cache_size) &&
+	__debugfs_create(bool, "fw_keep_resident",
+			&msm_vidc_fw_keep_resident);
 
 #undef __debugfs_create
 
@@ -295,6 +318,37 @@ static int publish_unreleased_reference(struct msm_vidc_inst *inst,
 	return 0;
 }
 
+static void publish_dcvs_decisions(struct msm_vidc_inst *inst,
+		char **dbuf, char *end)
+{
+	char *cur = *dbuf;
+	struct dcvs_stats *dcvs = &inst->dcvs;
+	struct dcvs_decision *d;
+	int i, idx;
+
+	cur += write_str(cur, end - cur, "-------------DCVS--------------\n");
+	cur += write_str(cur, end - cur, "mode: %d\n", inst->dcvs_mode);
+	cur += write_str(cur, end - cur, "load: %d (low %d high %d)\n",
+		dcvs->load, dcvs->load_low, dcvs->load_high);
+	cur += write_str(cur, end - cur, "avg frame size: %u\n",
+		dcvs->frame_size_avg);
+	cur += write_str(cur, end - cur, "missed deadlines: %d\n",
+		dcvs->missed_deadlines);
+
+	/* Oldest decision first */
+	for (i = 0; i < dcvs->log_count; i++) {
+		idx = (dcvs->log_index - dcvs->log_count + i +
+			DCVS_DECISION_LOG_SIZE) % DCVS_DECISION_LOG_SIZE;
+		d = &dcvs->log[idx];
+		cur += write_str(cur, end - cur,
+			"%lld us: load %d (%s) complexity %d%% buffers %d missed %d\n",
+			ktime_to_us(d->time), d->load, d->reason,
+			d->complexity, d->buffers, d->missed_deadlines);
+	}
+
+	*dbuf = cur;
+}
+
 static void put_inst_helper(struct kref *kref)
 {
 	struct msm_vidc_inst *inst = container_of(kref,
@@ -309,6 +363,7 @@ static ssize_t inst_info_read(struct file *file, char __user *buf,
 	struct core_inst_pair *idata = file->private_data;
 	struct msm_vidc_core *core;
 	struct msm_vidc_inst *inst, *temp = NULL;
+	struct msm_smem_map_stats map_stats = {0};
 	char *dbuf, *cur, *end;
 	int i, j;
 	ssize_t len = 0;
@@ -410,6 +465,13 @@ static ssize_t inst_info_read(struct file *file, char __user *buf,
 	cur += write_str(cur, end - cur, "FTB Count: %d\n", inst->count.ftb);
 	cur += write_str(cur, end - cur, "FBD Count: %d\n", inst->count.fbd);
 
+	msm_smem_get_map_stats(inst->mem_client, &map_stats);
+	cur += write_str(cur, end - cur,
+		"buffer maps: %u reused, %u new (%llu us), %u cached\n",
+		map_stats.hits, map_stats.misses, map_stats.map_time_us,
+		map_stats.cached);
+
+	publish_dcvs_decisions(inst, &cur, end);
 	publish_unreleased_reference(inst, &cur, end);
 	len = simple_read_from_buffer(buf, count, ppos,
 		dbuf, cur - dbuf);
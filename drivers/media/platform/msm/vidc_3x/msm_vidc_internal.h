@@ -24,6 +24,7 @@
 #include <linux/msm-bus.h>
 #include <linux/msm-bus-board.h>
 #include <linux/kref.h>
+#include <linux/ktime.h>
 #include <media/v4l2-dev.h>
 #include <media/v4l2-device.h>
 #include <media/v4l2-ioctl.h>
@@ -50,6 +51,10 @@
 
 /* Maintains the number of FTB's between each FBD over a window */
 #define DCVS_FTB_WINDOW 32
+/* Bitstream sizes the next frames' complexity is predicted from */
+#define DCVS_FRAME_WINDOW 8
+/* Recent DCVS clock changes kept for the instance debugfs info */
+#define DCVS_DECISION_LOG_SIZE 8
 
 #define V4L2_EVENT_VIDC_BASE  10
 
@@ -202,6 +207,15 @@ struct buf_count {
 	int ebd;
 };
 
+struct dcvs_decision {
+	ktime_t time;
+	const char *reason;
+	int load;
+	int complexity;
+	int buffers;
+	int missed_deadlines;
+};
+
 struct dcvs_stats {
 	int num_ftb[DCVS_FTB_WINDOW];
 	bool transition_turbo;
@@ -220,6 +234,15 @@ struct dcvs_stats {
 	int etb_counter;
 	bool is_power_save_mode;
 	u32 supported_codecs;
+	u32 frame_size[DCVS_FRAME_WINDOW];
+	int frame_index;
+	int frame_count;
+	u32 frame_size_avg;
+	ktime_t last_fbd;
+	int missed_deadlines;
+	struct dcvs_decision log[DCVS_DECISION_LOG_SIZE];
+	int log_index;
+	int log_count;
 };
 
 struct profile_data {
@@ -264,6 +287,10 @@ struct msm_vidc_core {
 	struct msm_vidc_capability *capabilities;
 	struct delayed_work fw_unload_work;
 	bool smmu_fault_handled;
+	ktime_t boot_start;
+	u32 boots;
+	s64 last_boot_us;
+	s64 max_boot_us;
 };
 
 struct msm_vidc_inst {
@@ -384,6 +411,14 @@ int unmap_and_deregister_buf(struct msm_vidc_inst *inst,
 			struct buffer_info *binfo);
 
 void msm_comm_handle_thermal_event(void);
+
+struct msm_smem_map_stats {
+	u32 hits;
+	u32 misses;
+	u32 cached;
+	u64 map_time_us;
+};
+
 void *msm_smem_new_client(enum smem_type mtype,
 		void *platform_resources, enum session_type stype);
 struct msm_smem *msm_smem_alloc(void *clt, size_t size, u32 align, u32 flags,
@@ -398,6 +433,7 @@ struct context_bank_info *msm_smem_get_context_bank(void *clt,
 		bool is_secure, enum hal_buffer buffer_type);
 void msm_vidc_fw_unload_handler(struct work_struct *work);
 bool msm_smem_compare_buffers(void *clt, int fd, void *priv);
+void msm_smem_get_map_stats(void *clt, struct msm_smem_map_stats *stats);
 /* XXX: normally should be in msm_vidc.h, but that's meant for public APIs,
  * whereas this is private
  */
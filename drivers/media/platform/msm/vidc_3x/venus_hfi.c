@@ -4375,9 +4375,18 @@ static inline int __suspend(struct venus_hfi_device *device)
 	return rc;
 }
 
+static void __update_boot_time(u32 *count, s64 *last_us, s64 *max_us,
+		ktime_t start)
+{
+	*last_us = ktime_us_delta(ktime_get(), start);
+	*max_us = max(*max_us, *last_us);
+	(*count)++;
+}
+
 static inline int __resume(struct venus_hfi_device *device)
 {
 	int rc = 0;
+	ktime_t start;
 
 	if (!device) {
 		dprintk(VIDC_ERR, "Invalid params: %pK\n", device);
@@ -4391,6 +4400,7 @@ static inline int __resume(struct venus_hfi_device *device)
 	}
 
 	dprintk(VIDC_DBG, "Resuming from power collapse\n");
+	start = ktime_get();
 	rc = __venus_power_on(device);
 	if (rc) {
 		dprintk(VIDC_ERR, "Failed to power on venus\n");
@@ -4431,7 +4441,11 @@ static inline int __resume(struct venus_hfi_device *device)
 		pm_qos_add_request(&device->qos, PM_QOS_CPU_DMA_LATENCY,
 				device->res->pm_qos_latency_us);
 	}
-	dprintk(VIDC_INFO, "Resumed from power collapse\n");
+	__update_boot_time(&device->boot_stats.resumes,
+		&device->boot_stats.last_resume_us,
+		&device->boot_stats.max_resume_us, start);
+	dprintk(VIDC_INFO, "Resumed from power collapse in %lld us\n",
+		device->boot_stats.last_resume_us);
 exit:
 	device->skip_pc_count = 0;
 	return rc;
@@ -4447,6 +4461,8 @@ static inline int __resume(struct venus_hfi_device *device)
 static int __load_fw(struct venus_hfi_device *device)
 {
 	int rc = 0;
+	ktime_t start = ktime_get();
+
 	/* Initialize resources */
 	rc = __init_resources(device, device->res);
 	if (rc) {
@@ -4490,6 +4506,11 @@ static int __load_fw(struct venus_hfi_device *device)
 		}
 	}
 	trace_msm_v4l2_vidc_fw_load_end("msm_v4l2_vidc venus_fw load end");
+	__update_boot_time(&device->boot_stats.fw_loads,
+		&device->boot_stats.last_load_us,
+		&device->boot_stats.max_load_us, start);
+	dprintk(VIDC_PROF, "Venus FW loaded in %lld us\n",
+		device->boot_stats.last_load_us);
 	return rc;
 fail_protect_mem:
 	if (device->resources.fw.cookie)
@@ -4522,6 +4543,23 @@ static void __unload_fw(struct venus_hfi_device *device)
 	__deinit_resources(device);
 }
 
+static int venus_hfi_get_boot_stats(void *dev, struct hal_boot_stats *stats)
+{
+	struct venus_hfi_device *device = dev;
+
+	if (!device || !stats) {
+		dprintk(VIDC_ERR, "%s Invalid parameter: %pK %pK\n",
+			__func__, device, stats);
+		return -EINVAL;
+	}
+
+	mutex_lock(&device->lock);
+	*stats = device->boot_stats;
+	mutex_unlock(&device->lock);
+
+	return 0;
+}
+
 static int venus_hfi_get_fw_info(void *dev, struct hal_fw_info *fw_info)
 {
 	int i = 0, j = 0;
@@ -4788,6 +4826,7 @@ static void venus_init_hfi_callbacks(struct hfi_device *hdev)
 	hdev->scale_clocks = venus_hfi_scale_clocks;
 	hdev->vote_bus = venus_hfi_vote_buses;
 	hdev->get_fw_info = venus_hfi_get_fw_info;
+	hdev->get_boot_stats = venus_hfi_get_boot_stats;
 	hdev->get_core_capabilities = venus_hfi_get_core_capabilities;
 	hdev->suspend = venus_hfi_suspend;
 	hdev->get_core_clock_rate = venus_hfi_get_core_clock_rate;
@@ -250,6 +250,7 @@ struct venus_hfi_device {
 	struct pm_qos_request qos;
 	unsigned int skip_pc_count;
 	struct msm_vidc_capability *sys_init_capabilities;
+	struct hal_boot_stats boot_stats;
 };
 
 void venus_hfi_delete_device(void *device);
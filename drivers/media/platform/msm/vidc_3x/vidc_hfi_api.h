@@ -1085,6 +1085,15 @@ struct hal_fw_info {
 	int irq;
 };
 
+struct hal_boot_stats {
+	u32 fw_loads;
+	s64 last_load_us;
+	s64 max_load_us;
+	u32 resumes;
+	s64 last_resume_us;
+	s64 max_resume_us;
+};
+
 enum hal_flush {
 	HAL_FLUSH_INPUT,
 	HAL_FLUSH_OUTPUT,
@@ -1526,6 +1535,7 @@ struct hfi_device {
 	int (*vote_bus)(void *dev, struct vidc_bus_vote_data *data,
 			int num_data);
 	int (*get_fw_info)(void *dev, struct hal_fw_info *fw_info);
+	int (*get_boot_stats)(void *dev, struct hal_boot_stats *stats);
 	int (*session_clean)(void *sess);
 	int (*get_core_capabilities)(void *dev);
 	int (*suspend)(void *dev);
@@ -561,6 +561,13 @@ long compat_qseecom_ioctl(struct file *file,
 		return qseecom_ioctl(file, convert_cmd(cmd), 0);
 	}
 	break;
+	/* Same layout for 32 and 64 bit callers */
+	case QSEECOM_IOCTL_REGISTER_MODFD_BUF_REQ:
+	case QSEECOM_IOCTL_DEREGISTER_MODFD_BUF_REQ: {
+		return qseecom_ioctl(file, cmd,
+				(unsigned long)compat_ptr(arg));
+	}
+	break;
 	case COMPAT_QSEECOM_IOCTL_REGISTER_LISTENER_REQ: {
 		struct compat_qseecom_register_listener_req __user *data32;
 		struct qseecom_register_listener_req __user *data;
@@ -37,6 +37,9 @@
 #include <linux/scatterlist.h>
 #include <linux/regulator/consumer.h>
 #include <linux/dma-mapping.h>
+#include <linux/dma-buf.h>
+#include <linux/seq_file.h>
+#include <linux/ktime.h>
 #include <soc/qcom/subsystem_restart.h>
 #include <soc/qcom/scm.h>
 #include <soc/qcom/socinfo.h>
@@ -89,6 +92,10 @@
 
 #define QSEECOM_SEND_CMD_CRYPTO_TIMEOUT	2000
 #define QSEECOM_LOAD_APP_CRYPTO_TIMEOUT	2000
+/* Longest a client's command pattern may hold the crypto votes */
+#define QSEECOM_SEND_CMD_HOLD_MAX	6000
+/* Command gaps longer than this end a client's session */
+#define QSEECOM_SESSION_GAP_MAX		10000
 #define TWO 2
 #define QSEECOM_UFS_ICE_CE_NUM 10
 #define QSEECOM_SDCC_ICE_CE_NUM 20
@@ -187,6 +194,12 @@ struct sglist_info {
 
 #define FEATURE_ID_WHITELIST	15	/*whitelist feature id*/
 
+/* Modfd buffers a client can keep registered at once */
+#define QSEECOM_MAX_REG_BUF	8
+
+#define QSEECOM_MODFD_BUF_FLAGS	(QSEECOM_MODFD_BUF_TA_READ_ONLY | \
+				 QSEECOM_MODFD_BUF_TA_WRITE_ONLY)
+
 #define MAKE_WHITELIST_VERSION(major, minor, patch) \
 	(((major & 0x3FF) << 22) | ((minor & 0x3FF) << 12) | (patch & 0xFFF))
 
@@ -216,6 +229,21 @@ struct qseecom_unregister_pending_list {
 	struct qseecom_dev_handle	*data;
 };
 
+enum qseecom_send_phase {
+	QSEECOM_PHASE_MAP,
+	QSEECOM_PHASE_SEND,
+	QSEECOM_PHASE_UNMAP,
+	QSEECOM_PHASE_MAX,
+};
+
+struct qseecom_send_stats {
+	u64 count;
+	u64 phase_us[QSEECOM_PHASE_MAX];
+	u64 max_us;
+	u64 fd_imported;
+	u64 fd_reused;
+};
+
 struct qseecom_registered_app_list {
 	struct list_head                 list;
 	u32  app_id;
@@ -225,6 +253,7 @@ struct qseecom_registered_app_list {
 	bool app_blocked;
 	u32  check_block;
 	u32  blocked_on_listener_id;
+	struct qseecom_send_stats send_stats;
 };
 
 struct qseecom_registered_kclient_list {
@@ -318,6 +347,18 @@ struct qseecom_control {
 	struct task_struct *unload_app_kthread_task;
 	wait_queue_head_t unload_app_kthread_wq;
 	atomic_t unload_app_kthread_state;
+
+	struct dentry *debugfs_dir;
+
+	struct qseecom_vote_stats {
+		u64 vote_on;
+		u64 vote_off;
+		u64 vote_reused;
+		u64 vote_on_us;
+		u64 vote_on_us_max;
+		u64 voted_us;
+		ktime_t voted_since;
+	} vote_stats;
 };
 
 struct qseecom_unload_app_pending_list {
@@ -332,6 +373,22 @@ struct qseecom_sec_buf_fd_info {
 	dma_addr_t pbase;
 };
 
+/*
+ * A modfd buffer registered by a client: the ion handle and sg table stay
+ * resolved, and tables too large to patch into the command buffer keep
+ * their out of line sg list, until the client deregisters or closes.
+ */
+struct qseecom_reg_buf {
+	struct dma_buf *dmabuf;
+	struct ion_handle *ihandle;
+	struct sg_table *sg_ptr;
+	uint32_t len;
+	uint32_t flags;
+	void *sg_vbase;
+	dma_addr_t sg_pbase;
+	size_t sg_size;
+};
+
 struct qseecom_param_memref {
 	uint32_t buffer;
 	uint32_t size;
@@ -349,6 +406,10 @@ struct qseecom_client_handle {
 	struct qseecom_sec_buf_fd_info sec_buf_fd[MAX_ION_FD];
 	bool from_smcinvoke;
 	bool unload_pending;
+	struct qseecom_reg_buf reg_buf[QSEECOM_MAX_REG_BUF];
+	u32 reg_buf_cnt;
+	u32 fd_imported;
+	u32 fd_reused;
 };
 
 struct qseecom_listener_handle {
@@ -375,6 +436,8 @@ struct qseecom_dev_handle {
 	struct sglist_info sglistinfo_ptr[MAX_ION_FD];
 	uint32_t sglist_cnt;
 	bool use_legacy_cmd;
+	ktime_t last_cmd;
+	u32 cmd_gap_avg_ms;
 };
 
 struct qseecom_key_id_usage_desc {
@@ -1457,6 +1520,21 @@ static int __qseecom_unregister_listener_kthread_func(void *data)
 	return 0;
 }
 
+/* Called with qsee_bw_mutex held when the bus vote changes */
+static void __qseecom_account_vote(uint32_t mode)
+{
+	struct qseecom_vote_stats *st = &qseecom.vote_stats;
+	ktime_t now = ktime_get();
+
+	if (qseecom.current_mode == INACTIVE) {
+		st->vote_on++;
+		st->voted_since = now;
+	} else if (mode == INACTIVE) {
+		st->vote_off++;
+		st->voted_us += ktime_us_delta(now, st->voted_since);
+	}
+}
+
 static int __qseecom_set_msm_bus_request(uint32_t mode)
 {
 	int ret = 0;
@@ -1488,6 +1566,8 @@ static int __qseecom_set_msm_bus_request(uint32_t mode)
 				} else
 					__qseecom_disable_clk(CLK_QSEE);
 			}
+		} else {
+			__qseecom_account_vote(mode);
 		}
 		qseecom.current_mode = mode;
 	}
@@ -1541,6 +1621,9 @@ static int qseecom_scale_bus_bandwidth_timer(uint32_t mode)
 {
 	int32_t ret = 0;
 	int32_t request_mode = INACTIVE;
+	struct qseecom_vote_stats *st = &qseecom.vote_stats;
+	bool cold = false;
+	ktime_t start;
 
 	mutex_lock(&qsee_bw_mutex);
 	if (mode == 0) {
@@ -1552,12 +1635,35 @@ static int qseecom_scale_bus_bandwidth_timer(uint32_t mode)
 		request_mode = mode;
 	}
 
+	/*
+	 * The scale down timer holds a clock reference and the bus vote of
+	 * the last burst. If that vote is what we need anyway, keep it and
+	 * just stop the timer instead of voting and dropping the extra
+	 * reference again.
+	 */
+	if (qseecom.timer_running && qseecom.current_mode == request_mode &&
+		(qseecom.qsee.ce_core_src_clk == NULL ||
+		 qseecom.qsee.clk_access_cnt)) {
+		del_timer_sync(&(qseecom.bw_scale_down_timer));
+		qseecom.timer_running = false;
+		st->vote_reused++;
+		goto err_scale_timer;
+	}
+
+	cold = qseecom.current_mode == INACTIVE && request_mode != INACTIVE;
+	start = ktime_get();
 	ret = __qseecom_set_msm_bus_request(request_mode);
 	if (ret) {
 		pr_err("set msm bus request failed (%d),request_mode (%d)\n",
 			ret, request_mode);
 		goto err_scale_timer;
 	}
+	if (cold) {
+		u64 delta = ktime_us_delta(ktime_get(), start);
+
+		st->vote_on_us += delta;
+		st->vote_on_us_max = max(st->vote_on_us_max, delta);
+	}
 
 	if (qseecom.timer_running) {
 		ret = __qseecom_decrease_clk_ref_count(CLK_QSEE);
@@ -1669,18 +1775,51 @@ static int qseecom_scale_bus_bandwidth(struct qseecom_dev_handle *data,
 
 static void __qseecom_add_bw_scale_down_timer(uint32_t duration)
 {
+	unsigned long expires;
+
 	if (qseecom.no_clock_support)
 		return;
 
 	mutex_lock(&qsee_bw_mutex);
-	qseecom.bw_scale_down_timer.expires = jiffies +
-		msecs_to_jiffies(duration);
+	expires = jiffies + msecs_to_jiffies(duration);
+	/* Never cut short a longer hold asked for by another client */
+	if (qseecom.timer_running &&
+		time_after(qseecom.bw_scale_down_timer.expires, expires))
+		expires = qseecom.bw_scale_down_timer.expires;
+	qseecom.bw_scale_down_timer.expires = expires;
 	mod_timer(&(qseecom.bw_scale_down_timer),
 		qseecom.bw_scale_down_timer.expires);
 	qseecom.timer_running = true;
 	mutex_unlock(&qsee_bw_mutex);
 }
 
+/*
+ * Clients like fingerprint send bursts of commands a few hundred ms to a
+ * few seconds apart. While a client keeps coming back within
+ * QSEECOM_SESSION_GAP_MAX, track the average gap between its commands and
+ * hold the votes long enough to cover the next one, so that the clocks
+ * are not dropped and enabled again in the middle of a sequence.
+ */
+static uint32_t __qseecom_client_hold_ms(struct qseecom_dev_handle *data)
+{
+	ktime_t now = ktime_get();
+	s64 gap = ktime_ms_delta(now, data->last_cmd);
+	uint32_t hold;
+
+	if (!ktime_to_ns(data->last_cmd) || gap > QSEECOM_SESSION_GAP_MAX)
+		data->cmd_gap_avg_ms = 0;
+	else if (!data->cmd_gap_avg_ms)
+		data->cmd_gap_avg_ms = gap;
+	else
+		data->cmd_gap_avg_ms = (3 * data->cmd_gap_avg_ms + gap) / 4;
+	data->last_cmd = now;
+
+	hold = data->cmd_gap_avg_ms + data->cmd_gap_avg_ms / 2;
+
+	return clamp_t(uint32_t, hold, QSEECOM_SEND_CMD_CRYPTO_TIMEOUT,
+		       QSEECOM_SEND_CMD_HOLD_MAX);
+}
+
 static void __qseecom_disable_clk_scale_down(struct qseecom_dev_handle *data)
 {
 	if (!qseecom.support_bus_scaling)
@@ -3415,8 +3554,17 @@ static int __qseecom_send_cmd(struct qseecom_dev_handle *data,
 	void *cmd_buf = NULL;
 	size_t cmd_len;
 	struct sglist_info *table = data->sglistinfo_ptr;
+	uintptr_t sb_end;
 
-	reqd_len_sb_in = req->cmd_req_len + req->resp_len;
+	/*
+	 * QSEE only touches the request and response, so the shared buffer
+	 * needs cache maintenance up to whichever of the two ends last
+	 * rather than over its whole length.
+	 */
+	sb_end = max((uintptr_t)req->cmd_req_buf + req->cmd_req_len,
+		     (uintptr_t)req->resp_buf + req->resp_len);
+	reqd_len_sb_in = min_t(size_t, sb_end - data->client.user_virt_sb_base,
+			       data->client.sb_length);
 	/* find app_id & img_name from list */
 	spin_lock_irqsave(&qseecom.registered_app_list_lock, flags);
 	list_for_each_entry(ptr_app, &qseecom.registered_app_list_head,
@@ -3536,7 +3684,7 @@ static int __qseecom_send_cmd(struct qseecom_dev_handle *data,
 	}
 exit:
 	ret2 = msm_ion_do_cache_op(qseecom.ion_clnt, data->client.ihandle,
-				data->client.sb_virt, data->client.sb_length,
+				data->client.sb_virt, reqd_len_sb_in,
 				ION_IOC_INV_CACHES);
 	if (ret2) {
 		pr_err("cache operation failed %d\n", ret2);
@@ -3545,10 +3693,45 @@ static int __qseecom_send_cmd(struct qseecom_dev_handle *data,
 	return ret;
 }
 
+static void __qseecom_account_send(struct qseecom_dev_handle *data,
+				   ktime_t *ts)
+{
+	struct qseecom_registered_app_list *ptr_app;
+	struct qseecom_send_stats *st;
+	unsigned long flags;
+	u64 total = 0;
+	int i;
+
+	spin_lock_irqsave(&qseecom.registered_app_list_lock, flags);
+	list_for_each_entry(ptr_app, &qseecom.registered_app_list_head,
+							list) {
+		if (ptr_app->app_id != data->client.app_id)
+			continue;
+
+		st = &ptr_app->send_stats;
+		for (i = 0; i < QSEECOM_PHASE_MAX; i++) {
+			u64 delta = ktime_us_delta(ts[i + 1], ts[i]);
+
+			st->phase_us[i] += delta;
+			total += delta;
+		}
+		st->max_us = max(st->max_us, total);
+		st->fd_imported += data->client.fd_imported;
+		st->fd_reused += data->client.fd_reused;
+		st->count++;
+		break;
+	}
+	spin_unlock_irqrestore(&qseecom.registered_app_list_lock, flags);
+
+	data->client.fd_imported = 0;
+	data->client.fd_reused = 0;
+}
+
 static int qseecom_send_cmd(struct qseecom_dev_handle *data, void __user *argp)
 {
 	int ret = 0;
 	struct qseecom_send_cmd_req req;
+	ktime_t ts[QSEECOM_PHASE_MAX + 1];
 
 	ret = copy_from_user(&req, argp, sizeof(req));
 	if (ret) {
@@ -3559,11 +3742,15 @@ static int qseecom_send_cmd(struct qseecom_dev_handle *data, void __user *argp)
 	if (__validate_send_cmd_inputs(data, &req))
 		return -EINVAL;
 
+	ts[QSEECOM_PHASE_MAP] = ts[QSEECOM_PHASE_SEND] = ktime_get();
 	ret = __qseecom_send_cmd(data, &req);
 
 	if (ret)
 		return ret;
 
+	ts[QSEECOM_PHASE_UNMAP] = ts[QSEECOM_PHASE_MAX] = ktime_get();
+	__qseecom_account_send(data, ts);
+
 	return ret;
 }
 
@@ -3627,6 +3814,72 @@ int __boundary_checks_offset(struct qseecom_send_modfd_cmd_req *req,
 	return 0;
 }
 
+static struct qseecom_reg_buf *__qseecom_find_reg_buf(
+			struct qseecom_dev_handle *data, int fd)
+{
+	struct qseecom_reg_buf *reg = NULL;
+	struct dma_buf *dmabuf;
+	int i;
+
+	if (!data->client.reg_buf_cnt)
+		return NULL;
+
+	dmabuf = dma_buf_get(fd);
+	if (IS_ERR_OR_NULL(dmabuf))
+		return NULL;
+
+	for (i = 0; i < QSEECOM_MAX_REG_BUF; i++) {
+		if (data->client.reg_buf[i].dmabuf == dmabuf) {
+			reg = &data->client.reg_buf[i];
+			break;
+		}
+	}
+	dma_buf_put(dmabuf);
+
+	return reg;
+}
+
+/* Resolve a modfd fd, reusing the mapping of a registered buffer */
+static struct ion_handle *__qseecom_get_modfd_handle(
+			struct qseecom_dev_handle *data, int fd, bool cleanup,
+			struct qseecom_reg_buf **reg)
+{
+	*reg = NULL;
+	if (data->type == QSEECOM_CLIENT_APP)
+		*reg = __qseecom_find_reg_buf(data, fd);
+
+	if (*reg) {
+		if (!cleanup)
+			data->client.fd_reused++;
+		return (*reg)->ihandle;
+	}
+
+	if (data->type == QSEECOM_CLIENT_APP && !cleanup)
+		data->client.fd_imported++;
+	return ion_import_dma_buf_fd(qseecom.ion_clnt, fd);
+}
+
+/*
+ * Registered buffers are only maintained over the range shared with the
+ * trusted app, and only in the directions their access hints need.
+ */
+static int __qseecom_modfd_cache_op(struct ion_handle *ihandle,
+			struct qseecom_reg_buf *reg, uint32_t len, bool cleanup)
+{
+	unsigned int cmd = cleanup ? ION_IOC_INV_CACHES :
+				     ION_IOC_CLEAN_INV_CACHES;
+
+	if (reg) {
+		if (cleanup && (reg->flags & QSEECOM_MODFD_BUF_TA_READ_ONLY))
+			return 0;
+		if (!cleanup && (reg->flags & QSEECOM_MODFD_BUF_TA_WRITE_ONLY))
+			cmd = ION_IOC_INV_CACHES;
+		len = reg->len;
+	}
+
+	return msm_ion_do_cache_op(qseecom.ion_clnt, ihandle, NULL, len, cmd);
+}
+
 static int __qseecom_update_cmd_buf(void *msg, bool cleanup,
 			struct qseecom_dev_handle *data)
 {
@@ -3641,6 +3894,7 @@ static int __qseecom_update_cmd_buf(void *msg, bool cleanup,
 	struct qseecom_registered_listener_list *this_lstnr = NULL;
 	uint32_t offset;
 	struct sg_table *sg_ptr;
+	struct qseecom_reg_buf *reg = NULL;
 
 	if ((data->type != QSEECOM_LISTENER_SERVICE) &&
 			(data->type != QSEECOM_CLIENT_APP))
@@ -3664,8 +3918,8 @@ static int __qseecom_update_cmd_buf(void *msg, bool cleanup,
 	for (i = 0; i < MAX_ION_FD; i++) {
 		if ((data->type != QSEECOM_LISTENER_SERVICE) &&
 						(req->ifd_data[i].fd > 0)) {
-			ihandle = ion_import_dma_buf_fd(qseecom.ion_clnt,
-					req->ifd_data[i].fd);
+			ihandle = __qseecom_get_modfd_handle(data,
+					req->ifd_data[i].fd, cleanup, &reg);
 			if (IS_ERR_OR_NULL(ihandle)) {
 				pr_err("Ion client can't retrieve the handle\n");
 				return -ENOMEM;
@@ -3674,8 +3928,9 @@ static int __qseecom_update_cmd_buf(void *msg, bool cleanup,
 				req->ifd_data[i].cmd_buf_offset;
 		} else if ((data->type == QSEECOM_LISTENER_SERVICE) &&
 				(lstnr_resp->ifd_data[i].fd > 0)) {
-			ihandle = ion_import_dma_buf_fd(qseecom.ion_clnt,
-						lstnr_resp->ifd_data[i].fd);
+			ihandle = __qseecom_get_modfd_handle(data,
+					lstnr_resp->ifd_data[i].fd, cleanup,
+					&reg);
 			if (IS_ERR_OR_NULL(ihandle)) {
 				pr_err("Ion client can't retrieve the handle\n");
 				return -ENOMEM;
@@ -3686,7 +3941,8 @@ static int __qseecom_update_cmd_buf(void *msg, bool cleanup,
 			continue;
 		}
 		/* Populate the cmd data structure with the phys_addr */
-		sg_ptr = ion_sg_table(qseecom.ion_clnt, ihandle);
+		sg_ptr = reg ? reg->sg_ptr :
+			ion_sg_table(qseecom.ion_clnt, ihandle);
 		if (IS_ERR_OR_NULL(sg_ptr)) {
 			pr_err("IOn client could not retrieve sg table\n");
 			goto err;
@@ -3777,22 +4033,12 @@ static int __qseecom_update_cmd_buf(void *msg, bool cleanup,
 			}
 		}
 
-		if (cleanup) {
-			ret = msm_ion_do_cache_op(qseecom.ion_clnt,
-					ihandle, NULL, len,
-					ION_IOC_INV_CACHES);
-			if (ret) {
-				pr_err("cache operation failed %d\n", ret);
-				goto err;
-			}
-		} else {
-			ret = msm_ion_do_cache_op(qseecom.ion_clnt,
-					ihandle, NULL, len,
-					ION_IOC_CLEAN_INV_CACHES);
-			if (ret) {
-				pr_err("cache operation failed %d\n", ret);
-				goto err;
-			}
+		ret = __qseecom_modfd_cache_op(ihandle, reg, len, cleanup);
+		if (ret) {
+			pr_err("cache operation failed %d\n", ret);
+			goto err;
+		}
+		if (!cleanup) {
 			if (data->type == QSEECOM_CLIENT_APP) {
 				offset = req->ifd_data[i].cmd_buf_offset;
 				data->sglistinfo_ptr[i].indexAndFlags =
@@ -3816,46 +4062,33 @@ static int __qseecom_update_cmd_buf(void *msg, bool cleanup,
 			}
 		}
 		/* Deallocate the handle */
-		if (!IS_ERR_OR_NULL(ihandle))
+		if (!reg && !IS_ERR_OR_NULL(ihandle))
 			ion_free(qseecom.ion_clnt, ihandle);
 	}
 	return ret;
 err:
-	if (!IS_ERR_OR_NULL(ihandle))
+	if (!reg && !IS_ERR_OR_NULL(ihandle))
 		ion_free(qseecom.ion_clnt, ihandle);
 	return -ENOMEM;
 }
 
-static int __qseecom_allocate_sg_list_buffer(struct qseecom_dev_handle *data,
-		char *field, uint32_t fd_idx, struct sg_table *sg_ptr)
+static void *__qseecom_build_sg_list_buffer(struct sg_table *sg_ptr,
+		dma_addr_t *coh_pmem, size_t *size)
 {
 	struct scatterlist *sg = sg_ptr->sgl;
 	struct qseecom_sg_entry_64bit *sg_entry;
-	struct qseecom_sg_list_buf_hdr_64bit *buf_hdr;
 	void *buf;
 	uint i;
-	size_t size;
-	dma_addr_t coh_pmem;
 
-	if (fd_idx >= MAX_ION_FD) {
-		pr_err("fd_idx [%d] is invalid\n", fd_idx);
-		return -ENOMEM;
-	}
-	buf_hdr = (struct qseecom_sg_list_buf_hdr_64bit *)field;
-	memset((void *)buf_hdr, 0, QSEECOM_SG_LIST_BUF_HDR_SZ_64BIT);
 	/* Allocate a contiguous kernel buffer */
-	size = sg_ptr->nents * SG_ENTRY_SZ_64BIT;
-	size = (size + PAGE_SIZE) & PAGE_MASK;
+	*size = sg_ptr->nents * SG_ENTRY_SZ_64BIT;
+	*size = (*size + PAGE_SIZE) & PAGE_MASK;
 	buf = dma_alloc_coherent(qseecom.pdev,
-			size, &coh_pmem, GFP_KERNEL);
+			*size, coh_pmem, GFP_KERNEL);
 	if (buf == NULL) {
 		pr_err("failed to alloc memory for sg buf\n");
-		return -ENOMEM;
+		return NULL;
 	}
-	/* update qseecom_sg_list_buf_hdr_64bit */
-	buf_hdr->version = QSEECOM_SG_LIST_BUF_FORMAT_VERSION_2;
-	buf_hdr->new_buf_phys_addr = coh_pmem;
-	buf_hdr->nents_total = sg_ptr->nents;
 	/* save the left sg entries into new allocated buf */
 	sg_entry = (struct qseecom_sg_entry_64bit *)buf;
 	for (i = 0; i < sg_ptr->nents; i++) {
@@ -3865,6 +4098,38 @@ static int __qseecom_allocate_sg_list_buffer(struct qseecom_dev_handle *data,
 		sg = sg_next(sg);
 	}
 
+	return buf;
+}
+
+static void __qseecom_set_sg_list_buf_hdr(char *field, dma_addr_t coh_pmem,
+		uint32_t nents)
+{
+	struct qseecom_sg_list_buf_hdr_64bit *buf_hdr;
+
+	buf_hdr = (struct qseecom_sg_list_buf_hdr_64bit *)field;
+	memset((void *)buf_hdr, 0, QSEECOM_SG_LIST_BUF_HDR_SZ_64BIT);
+	/* update qseecom_sg_list_buf_hdr_64bit */
+	buf_hdr->version = QSEECOM_SG_LIST_BUF_FORMAT_VERSION_2;
+	buf_hdr->new_buf_phys_addr = coh_pmem;
+	buf_hdr->nents_total = nents;
+}
+
+static int __qseecom_allocate_sg_list_buffer(struct qseecom_dev_handle *data,
+		char *field, uint32_t fd_idx, struct sg_table *sg_ptr)
+{
+	void *buf;
+	size_t size;
+	dma_addr_t coh_pmem;
+
+	if (fd_idx >= MAX_ION_FD) {
+		pr_err("fd_idx [%d] is invalid\n", fd_idx);
+		return -ENOMEM;
+	}
+	buf = __qseecom_build_sg_list_buffer(sg_ptr, &coh_pmem, &size);
+	if (!buf)
+		return -ENOMEM;
+	__qseecom_set_sg_list_buf_hdr(field, coh_pmem, sg_ptr->nents);
+
 	data->client.sec_buf_fd[fd_idx].is_sec_buf_fd = true;
 	data->client.sec_buf_fd[fd_idx].vbase = buf;
 	data->client.sec_buf_fd[fd_idx].pbase = coh_pmem;
@@ -3887,6 +4152,7 @@ static int __qseecom_update_cmd_buf_64(void *msg, bool cleanup,
 	struct qseecom_registered_listener_list *this_lstnr = NULL;
 	uint32_t offset;
 	struct sg_table *sg_ptr;
+	struct qseecom_reg_buf *reg = NULL;
 
 	if ((data->type != QSEECOM_LISTENER_SERVICE) &&
 			(data->type != QSEECOM_CLIENT_APP))
@@ -3910,8 +4176,8 @@ static int __qseecom_update_cmd_buf_64(void *msg, bool cleanup,
 	for (i = 0; i < MAX_ION_FD; i++) {
 		if ((data->type != QSEECOM_LISTENER_SERVICE) &&
 						(req->ifd_data[i].fd > 0)) {
-			ihandle = ion_import_dma_buf_fd(qseecom.ion_clnt,
-					req->ifd_data[i].fd);
+			ihandle = __qseecom_get_modfd_handle(data,
+					req->ifd_data[i].fd, cleanup, &reg);
 			if (IS_ERR_OR_NULL(ihandle)) {
 				pr_err("Ion client can't retrieve the handle\n");
 				return -ENOMEM;
@@ -3920,8 +4186,9 @@ static int __qseecom_update_cmd_buf_64(void *msg, bool cleanup,
 				req->ifd_data[i].cmd_buf_offset;
 		} else if ((data->type == QSEECOM_LISTENER_SERVICE) &&
 				(lstnr_resp->ifd_data[i].fd > 0)) {
-			ihandle = ion_import_dma_buf_fd(qseecom.ion_clnt,
-						lstnr_resp->ifd_data[i].fd);
+			ihandle = __qseecom_get_modfd_handle(data,
+					lstnr_resp->ifd_data[i].fd, cleanup,
+					&reg);
 			if (IS_ERR_OR_NULL(ihandle)) {
 				pr_err("Ion client can't retrieve the handle\n");
 				return -ENOMEM;
@@ -3932,7 +4199,8 @@ static int __qseecom_update_cmd_buf_64(void *msg, bool cleanup,
 			continue;
 		}
 		/* Populate the cmd data structure with the phys_addr */
-		sg_ptr = ion_sg_table(qseecom.ion_clnt, ihandle);
+		sg_ptr = reg ? reg->sg_ptr :
+			ion_sg_table(qseecom.ion_clnt, ihandle);
 		if (IS_ERR_OR_NULL(sg_ptr)) {
 			pr_err("IOn client could not retrieve sg table\n");
 			goto err;
@@ -3945,7 +4213,11 @@ static int __qseecom_update_cmd_buf_64(void *msg, bool cleanup,
 			pr_warn("Num of scattered entries");
 			pr_warn(" (%d) is greater than %d\n",
 				sg_ptr->nents, QSEECOM_MAX_SG_ENTRY);
-			if (cleanup) {
+			if (reg) {
+				if (!cleanup)
+					__qseecom_set_sg_list_buf_hdr(field,
+						reg->sg_pbase, sg_ptr->nents);
+			} else if (cleanup) {
 				if (data->client.sec_buf_fd[i].is_sec_buf_fd &&
 					data->client.sec_buf_fd[i].vbase)
 					dma_free_coherent(qseecom.pdev,
@@ -3997,22 +4269,12 @@ static int __qseecom_update_cmd_buf_64(void *msg, bool cleanup,
 			}
 		}
 cleanup:
-		if (cleanup) {
-			ret = msm_ion_do_cache_op(qseecom.ion_clnt,
-					ihandle, NULL, len,
-					ION_IOC_INV_CACHES);
-			if (ret) {
-				pr_err("cache operation failed %d\n", ret);
-				goto err;
-			}
-		} else {
-			ret = msm_ion_do_cache_op(qseecom.ion_clnt,
-					ihandle, NULL, len,
-					ION_IOC_CLEAN_INV_CACHES);
-			if (ret) {
-				pr_err("cache operation failed %d\n", ret);
-				goto err;
-			}
+		ret = __qseecom_modfd_cache_op(ihandle, reg, len, cleanup);
+		if (ret) {
+			pr_err("cache operation failed %d\n", ret);
+			goto err;
+		}
+		if (!cleanup) {
 			if (data->type == QSEECOM_CLIENT_APP) {
 				offset = req->ifd_data[i].cmd_buf_offset;
 				data->sglistinfo_ptr[i].indexAndFlags =
@@ -4036,7 +4298,7 @@ static int __qseecom_update_cmd_buf_64(void *msg, bool cleanup,
 			}
 		}
 		/* Deallocate the handle */
-		if (!IS_ERR_OR_NULL(ihandle))
+		if (!reg && !IS_ERR_OR_NULL(ihandle))
 			ion_free(qseecom.ion_clnt, ihandle);
 	}
 	return ret;
@@ -4048,7 +4310,7 @@ static int __qseecom_update_cmd_buf_64(void *msg, bool cleanup,
 				data->client.sec_buf_fd[i].size,
 				data->client.sec_buf_fd[i].vbase,
 				data->client.sec_buf_fd[i].pbase);
-	if (!IS_ERR_OR_NULL(ihandle))
+	if (!reg && !IS_ERR_OR_NULL(ihandle))
 		ion_free(qseecom.ion_clnt, ihandle);
 	return -ENOMEM;
 }
@@ -4061,6 +4323,7 @@ static int __qseecom_send_modfd_cmd(struct qseecom_dev_handle *data,
 	int i;
 	struct qseecom_send_modfd_cmd_req req;
 	struct qseecom_send_cmd_req send_cmd_req;
+	ktime_t ts[QSEECOM_PHASE_MAX + 1];
 
 	ret = copy_from_user(&req, argp, sizeof(req));
 	if (ret) {
@@ -4089,13 +4352,16 @@ static int __qseecom_send_modfd_cmd(struct qseecom_dev_handle *data,
 	req.resp_buf = (void *)__qseecom_uvirt_to_kvirt(data,
 						(uintptr_t)req.resp_buf);
 
+	ts[QSEECOM_PHASE_MAP] = ktime_get();
 	if (!is_64bit_addr) {
 		ret = __qseecom_update_cmd_buf(&req, false, data);
 		if (ret)
 			return ret;
+		ts[QSEECOM_PHASE_SEND] = ktime_get();
 		ret = __qseecom_send_cmd(data, &send_cmd_req);
 		if (ret)
 			return ret;
+		ts[QSEECOM_PHASE_UNMAP] = ktime_get();
 		ret = __qseecom_update_cmd_buf(&req, true, data);
 		if (ret)
 			return ret;
@@ -4103,13 +4369,17 @@ static int __qseecom_send_modfd_cmd(struct qseecom_dev_handle *data,
 		ret = __qseecom_update_cmd_buf_64(&req, false, data);
 		if (ret)
 			return ret;
+		ts[QSEECOM_PHASE_SEND] = ktime_get();
 		ret = __qseecom_send_cmd(data, &send_cmd_req);
 		if (ret)
 			return ret;
+		ts[QSEECOM_PHASE_UNMAP] = ktime_get();
 		ret = __qseecom_update_cmd_buf_64(&req, true, data);
 		if (ret)
 			return ret;
 	}
+	ts[QSEECOM_PHASE_MAX] = ktime_get();
+	__qseecom_account_send(data, ts);
 
 	return ret;
 }
@@ -4126,6 +4396,127 @@ static int qseecom_send_modfd_cmd_64(struct qseecom_dev_handle *data,
 	return __qseecom_send_modfd_cmd(data, argp, true);
 }
 
+static void __qseecom_free_reg_buf(struct qseecom_dev_handle *data,
+					struct qseecom_reg_buf *reg)
+{
+	if (reg->sg_vbase)
+		dma_free_coherent(qseecom.pdev, reg->sg_size, reg->sg_vbase,
+				  reg->sg_pbase);
+	ion_free(qseecom.ion_clnt, reg->ihandle);
+	dma_buf_put(reg->dmabuf);
+	memset(reg, 0, sizeof(*reg));
+	data->client.reg_buf_cnt--;
+}
+
+static void __qseecom_free_reg_bufs(struct qseecom_dev_handle *data)
+{
+	int i;
+
+	for (i = 0; i < QSEECOM_MAX_REG_BUF; i++)
+		if (data->client.reg_buf[i].dmabuf)
+			__qseecom_free_reg_buf(data, &data->client.reg_buf[i]);
+}
+
+static int qseecom_register_modfd_buf(struct qseecom_dev_handle *data,
+					void __user *argp)
+{
+	struct qseecom_modfd_buf_req req;
+	struct qseecom_reg_buf *reg = NULL;
+	struct scatterlist *sg;
+	struct dma_buf *dmabuf;
+	uint64_t total = 0;
+	int i, ret;
+
+	if (copy_from_user(&req, argp, sizeof(req))) {
+		pr_err("copy_from_user failed\n");
+		return -EFAULT;
+	}
+	if (req.fd <= 0 || (req.flags & ~QSEECOM_MODFD_BUF_FLAGS) ||
+		(req.flags == QSEECOM_MODFD_BUF_FLAGS)) {
+		pr_err("invalid modfd buf fd %d flags 0x%x\n",
+			req.fd, req.flags);
+		return -EINVAL;
+	}
+
+	dmabuf = dma_buf_get(req.fd);
+	if (IS_ERR_OR_NULL(dmabuf)) {
+		pr_err("modfd buf fd %d is not a dma buf\n", req.fd);
+		return -EBADF;
+	}
+
+	for (i = 0; i < QSEECOM_MAX_REG_BUF; i++) {
+		if (data->client.reg_buf[i].dmabuf == dmabuf) {
+			ret = -EEXIST;
+			goto err_put;
+		}
+		if (!reg && !data->client.reg_buf[i].dmabuf)
+			reg = &data->client.reg_buf[i];
+	}
+	if (!reg) {
+		ret = -ENOSPC;
+		goto err_put;
+	}
+
+	reg->ihandle = ion_import_dma_buf(qseecom.ion_clnt, dmabuf);
+	if (IS_ERR_OR_NULL(reg->ihandle)) {
+		pr_err("Ion client can't retrieve the handle\n");
+		reg->ihandle = NULL;
+		ret = -ENOMEM;
+		goto err_put;
+	}
+	reg->sg_ptr = ion_sg_table(qseecom.ion_clnt, reg->ihandle);
+	if (IS_ERR_OR_NULL(reg->sg_ptr) || !reg->sg_ptr->nents) {
+		pr_err("Ion client could not retrieve sg table\n");
+		ret = -EINVAL;
+		goto err_free;
+	}
+	if (reg->sg_ptr->nents > QSEECOM_MAX_SG_ENTRY) {
+		reg->sg_vbase = __qseecom_build_sg_list_buffer(reg->sg_ptr,
+					&reg->sg_pbase, &reg->sg_size);
+		if (!reg->sg_vbase) {
+			ret = -ENOMEM;
+			goto err_free;
+		}
+	}
+
+	for_each_sg(reg->sg_ptr->sgl, sg, reg->sg_ptr->nents, i)
+		total += sg->length;
+	total = min_t(uint64_t, total, UINT_MAX);
+	reg->len = req.len ? min_t(uint64_t, req.len, total) : total;
+	reg->flags = req.flags;
+	reg->dmabuf = dmabuf;
+	data->client.reg_buf_cnt++;
+
+	return 0;
+
+err_free:
+	ion_free(qseecom.ion_clnt, reg->ihandle);
+	memset(reg, 0, sizeof(*reg));
+err_put:
+	dma_buf_put(dmabuf);
+	return ret;
+}
+
+static int qseecom_deregister_modfd_buf(struct qseecom_dev_handle *data,
+					void __user *argp)
+{
+	struct qseecom_modfd_buf_req req;
+	struct qseecom_reg_buf *reg;
+
+	if (copy_from_user(&req, argp, sizeof(req))) {
+		pr_err("copy_from_user failed\n");
+		return -EFAULT;
+	}
+
+	reg = __qseecom_find_reg_buf(data, req.fd);
+	if (!reg)
+		return -ENOENT;
+
+	__qseecom_free_reg_buf(data, reg);
+
+	return 0;
+}
+
 
 
 static int __qseecom_listener_has_rcvd_req(struct qseecom_dev_handle *data,
@@ -5047,7 +5438,7 @@ int qseecom_send_command(struct qseecom_handle *handle, void *send_buf,
 	data->use_legacy_cmd = false;
 	if (qseecom.support_bus_scaling)
 		__qseecom_add_bw_scale_down_timer(
-			QSEECOM_SEND_CMD_CRYPTO_TIMEOUT);
+			__qseecom_client_hold_ms(data));
 
 	if (perf_enabled) {
 		qsee_disable_clock_vote(data, CLK_DFAB);
@@ -7427,7 +7818,7 @@ static long qseecom_ioctl(struct file *file,
 		ret = qseecom_send_cmd(data, argp);
 		if (qseecom.support_bus_scaling)
 			__qseecom_add_bw_scale_down_timer(
-				QSEECOM_SEND_CMD_CRYPTO_TIMEOUT);
+				__qseecom_client_hold_ms(data));
 		if (perf_enabled) {
 			qsee_disable_clock_vote(data, CLK_DFAB);
 			qsee_disable_clock_vote(data, CLK_SFPB);
@@ -7491,7 +7882,7 @@ static long qseecom_ioctl(struct file *file,
 			ret = qseecom_send_modfd_cmd_64(data, argp);
 		if (qseecom.support_bus_scaling)
 			__qseecom_add_bw_scale_down_timer(
-				QSEECOM_SEND_CMD_CRYPTO_TIMEOUT);
+				__qseecom_client_hold_ms(data));
 		if (perf_enabled) {
 			qsee_disable_clock_vote(data, CLK_DFAB);
 			qsee_disable_clock_vote(data, CLK_SFPB);
@@ -7504,6 +7895,29 @@ static long qseecom_ioctl(struct file *file,
 		__qseecom_clean_data_sglistinfo(data);
 		break;
 	}
+	case QSEECOM_IOCTL_REGISTER_MODFD_BUF_REQ:
+	case QSEECOM_IOCTL_DEREGISTER_MODFD_BUF_REQ: {
+		if ((data->client.app_id == 0) ||
+			(data->type != QSEECOM_CLIENT_APP)) {
+			pr_err("modfd buf req: invalid handle (%d) appid(%d)\n",
+					data->type, data->client.app_id);
+			ret = -EINVAL;
+			break;
+		}
+		/* Sends walk the registered buffers under this lock */
+		mutex_lock(&app_access_lock);
+		atomic_inc(&data->ioctl_count);
+		if (cmd == QSEECOM_IOCTL_REGISTER_MODFD_BUF_REQ)
+			ret = qseecom_register_modfd_buf(data, argp);
+		else
+			ret = qseecom_deregister_modfd_buf(data, argp);
+		atomic_dec(&data->ioctl_count);
+		wake_up_all(&data->abort_wq);
+		mutex_unlock(&app_access_lock);
+		if (ret)
+			pr_err("failed modfd buf req: %d\n", ret);
+		break;
+	}
 	case QSEECOM_IOCTL_RECEIVE_REQ: {
 		if ((data->listener.id == 0) ||
 			(data->type != QSEECOM_LISTENER_SERVICE)) {
@@ -8087,6 +8501,9 @@ static int qseecom_release(struct inode *inode, struct file *file)
 		case QSEECOM_CLIENT_APP:
 			pr_debug("release app %d (%s)\n",
 				data->client.app_id, data->client.app_name);
+			mutex_lock(&app_access_lock);
+			__qseecom_free_reg_bufs(data);
+			mutex_unlock(&app_access_lock);
 			if (data->client.app_id) {
 				free_private_data = false;
 				mutex_lock(&unload_app_pending_list_lock);
@@ -8872,6 +9289,119 @@ static int qseecom_check_whitelist_feature(void)
 	return version >= MAKE_WHITELIST_VERSION(1, 0, 0);
 }
 
+static int qseecom_send_stats_show(struct seq_file *s, void *unused)
+{
+	static const char * const phase_names[QSEECOM_PHASE_MAX] = {
+		[QSEECOM_PHASE_MAP] = "map",
+		[QSEECOM_PHASE_SEND] = "send",
+		[QSEECOM_PHASE_UNMAP] = "unmap",
+	};
+	struct qseecom_registered_app_list *ptr_app;
+	struct qseecom_send_stats *st;
+	unsigned long flags;
+	int i;
+
+	seq_printf(s, "%-24s %6s %10s", "app", "id", "sends");
+	for (i = 0; i < QSEECOM_PHASE_MAX; i++)
+		seq_printf(s, " %8s_us", phase_names[i]);
+	seq_printf(s, " %10s %10s %10s\n", "max_us", "imported", "reused");
+
+	spin_lock_irqsave(&qseecom.registered_app_list_lock, flags);
+	list_for_each_entry(ptr_app, &qseecom.registered_app_list_head,
+							list) {
+		st = &ptr_app->send_stats;
+		seq_printf(s, "%-24.24s %6u %10llu", ptr_app->app_name,
+			   ptr_app->app_id, st->count);
+		/* Average round trip cost of each phase */
+		for (i = 0; i < QSEECOM_PHASE_MAX; i++)
+			seq_printf(s, " %11llu", st->count ?
+				   div64_u64(st->phase_us[i], st->count) : 0);
+		seq_printf(s, " %10llu %10llu %10llu\n", st->max_us,
+			   st->fd_imported, st->fd_reused);
+	}
+	spin_unlock_irqrestore(&qseecom.registered_app_list_lock, flags);
+
+	return 0;
+}
+
+static int qseecom_send_stats_open(struct inode *inode, struct file *file)
+{
+	return single_open(file, qseecom_send_stats_show, inode->i_private);
+}
+
+static ssize_t qseecom_send_stats_write(struct file *file,
+		const char __user *buf, size_t count, loff_t *ppos)
+{
+	struct qseecom_registered_app_list *ptr_app;
+	unsigned long flags;
+
+	spin_lock_irqsave(&qseecom.registered_app_list_lock, flags);
+	list_for_each_entry(ptr_app, &qseecom.registered_app_list_head,
+							list)
+		memset(&ptr_app->send_stats, 0, sizeof(ptr_app->send_stats));
+	spin_unlock_irqrestore(&qseecom.registered_app_list_lock, flags);
+
+	return count;
+}
+
+static const struct file_operations qseecom_send_stats_fops = {
+	.open = qseecom_send_stats_open,
+	.read = seq_read,
+	.write = qseecom_send_stats_write,
+	.llseek = seq_lseek,
+	.release = single_release,
+};
+
+static int qseecom_vote_stats_show(struct seq_file *s, void *unused)
+{
+	struct qseecom_vote_stats st;
+	u64 voted_us;
+
+	mutex_lock(&qsee_bw_mutex);
+	st = qseecom.vote_stats;
+	voted_us = st.voted_us;
+	if (qseecom.current_mode != INACTIVE)
+		voted_us += ktime_us_delta(ktime_get(), st.voted_since);
+	mutex_unlock(&qsee_bw_mutex);
+
+	seq_printf(s, "vote_on: %llu\n", st.vote_on);
+	seq_printf(s, "vote_off: %llu\n", st.vote_off);
+	seq_printf(s, "vote_reused: %llu\n", st.vote_reused);
+	seq_printf(s, "voted_ms: %llu\n", div_u64(voted_us, USEC_PER_MSEC));
+	/* Cost a command pays when it has to bring the votes up */
+	seq_printf(s, "first_cmd_avg_us: %llu\n",
+		   st.vote_on ? div64_u64(st.vote_on_us, st.vote_on) : 0);
+	seq_printf(s, "first_cmd_max_us: %llu\n", st.vote_on_us_max);
+
+	return 0;
+}
+
+static int qseecom_vote_stats_open(struct inode *inode, struct file *file)
+{
+	return single_open(file, qseecom_vote_stats_show, inode->i_private);
+}
+
+static const struct file_operations qseecom_vote_stats_fops = {
+	.open = qseecom_vote_stats_open,
+	.read = seq_read,
+	.llseek = seq_lseek,
+	.release = single_release,
+};
+
+static void qseecom_debugfs_init(void)
+{
+	qseecom.debugfs_dir = debugfs_create_dir("qseecom", NULL);
+	if (IS_ERR_OR_NULL(qseecom.debugfs_dir)) {
+		qseecom.debugfs_dir = NULL;
+		return;
+	}
+
+	debugfs_create_file("send_stats", 0600, qseecom.debugfs_dir, NULL,
+			    &qseecom_send_stats_fops);
+	debugfs_create_file("bw_vote_stats", 0400, qseecom.debugfs_dir, NULL,
+			    &qseecom_vote_stats_fops);
+}
+
 static int qseecom_probe(struct platform_device *pdev)
 {
 	int rc;
@@ -9176,6 +9706,8 @@ static int qseecom_probe(struct platform_device *pdev)
 	atomic_set(&qseecom.unload_app_kthread_state,
 						UNLOAD_APP_KT_SLEEP);
 
+	qseecom_debugfs_init();
+
 	atomic_set(&qseecom.qseecom_state, QSEECOM_STATE_READY);
 	return 0;
 
@@ -9293,6 +9825,8 @@ static int qseecom_remove(struct platform_device *pdev)
 			__qseecom_deinit_clk(CLK_CE_DRV);
 	}
 
+	debugfs_remove_recursive(qseecom.debugfs_dir);
+
 	ion_client_destroy(qseecom.ion_clnt);
 
 	kthread_stop(qseecom.unload_app_kthread_task);
@@ -21,12 +21,14 @@
 #include <linux/kernel.h>
 #include <linux/list.h>
 #include <linux/mm.h>
+#include <linux/percpu.h>
 #include <linux/proc_fs.h>
 #include <linux/profile.h>
 #include <linux/rtmutex.h>
 #include <linux/sched.h>
 #include <linux/seq_file.h>
 #include <linux/slab.h>
+#include <linux/spinlock.h>
 #include <linux/uaccess.h>
 
 
@@ -46,6 +48,26 @@ struct io_stats {
 	u64 fsync;
 };
 
+/*
+ * I/O is charged as it happens to the user_struct of the current task, so
+ * reading the stats only has to fold the per-cpu counters of the users that
+ * exist instead of walking every task in the system. Users that went away
+ * since the last read are parked on dead_users until they are folded.
+ */
+struct uid_io_pcpu {
+	u64 io[UID_IO_ITEMS];
+};
+
+struct uid_sys_stats_user {
+	struct list_head link;
+	kuid_t uid;
+	struct uid_io_pcpu __percpu *pcpu;
+};
+
+static LIST_HEAD(live_users);
+static LIST_HEAD(dead_users);
+static DEFINE_SPINLOCK(users_lock);
+
 #define UID_STATE_FOREGROUND	0
 #define UID_STATE_BACKGROUND	1
 #define UID_STATE_BUCKET_SIZE	2
@@ -55,6 +77,13 @@ struct io_stats {
 #define UID_STATE_DEAD_TASKS	4
 #define UID_STATE_SIZE		5
 
+/* Record layout of /proc/uid_io/stats_bin, one per uid in host order */
+struct uid_io_record {
+	u32 uid;
+	u32 reserved;
+	struct io_stats io[UID_STATE_BUCKET_SIZE];
+};
+
 #define MAX_TASK_COMM_LEN 256
 
 struct task_entry {
@@ -78,14 +107,6 @@ struct uid_entry {
 #endif
 };
 
-static u64 compute_write_bytes(struct task_struct *task)
-{
-	if (task->ioac.write_bytes <= task->ioac.cancelled_write_bytes)
-		return 0;
-
-	return task->ioac.write_bytes - task->ioac.cancelled_write_bytes;
-}
-
 static void compute_io_bucket_stats(struct io_stats *io_bucket,
 					struct io_stats *io_curr,
 					struct io_stats *io_last,
@@ -119,7 +140,84 @@ static void compute_io_bucket_stats(struct io_stats *io_bucket,
 	memset(io_dead, 0, sizeof(struct io_stats));
 }
 
+void uid_sys_stats_account_io(enum uid_io_item item, u64 amt)
+{
+	struct uid_sys_stats_user *stats = current_user()->sys_stats;
+
+	if (stats)
+		this_cpu_add(stats->pcpu->io[item], amt);
+}
+EXPORT_SYMBOL_GPL(uid_sys_stats_account_io);
+
+void uid_sys_stats_user_init(struct user_struct *up)
+{
+	struct uid_sys_stats_user *stats;
+	unsigned long flags;
+
+	stats = kzalloc(sizeof(*stats), GFP_KERNEL);
+	if (!stats)
+		return;
+
+	stats->pcpu = alloc_percpu(struct uid_io_pcpu);
+	if (!stats->pcpu) {
+		kfree(stats);
+		return;
+	}
+	stats->uid = up->uid;
+
+	spin_lock_irqsave(&users_lock, flags);
+	list_add_tail(&stats->link, &live_users);
+	spin_unlock_irqrestore(&users_lock, flags);
+
+	up->sys_stats = stats;
+}
+
+void uid_sys_stats_user_release(struct user_struct *up)
+{
+	struct uid_sys_stats_user *stats = up->sys_stats;
+	unsigned long flags;
+
+	if (!stats)
+		return;
+
+	spin_lock_irqsave(&users_lock, flags);
+	list_move_tail(&stats->link, &dead_users);
+	spin_unlock_irqrestore(&users_lock, flags);
+
+	up->sys_stats = NULL;
+}
+
+static void add_user_io_stats(struct io_stats *io_slot,
+		struct uid_sys_stats_user *stats)
+{
+	u64 io[UID_IO_ITEMS] = { 0 };
+	int cpu, i;
+
+	for_each_possible_cpu(cpu) {
+		struct uid_io_pcpu *pcpu = per_cpu_ptr(stats->pcpu, cpu);
+
+		for (i = 0; i < UID_IO_ITEMS; i++)
+			io[i] += pcpu->io[i];
+	}
+
+	io_slot->read_bytes += io[UID_IO_READ_BYTES];
+	if (io[UID_IO_WRITE_BYTES] > io[UID_IO_CANCELLED_WRITE_BYTES])
+		io_slot->write_bytes += io[UID_IO_WRITE_BYTES] -
+			io[UID_IO_CANCELLED_WRITE_BYTES];
+	io_slot->rchar += io[UID_IO_RCHAR];
+	io_slot->wchar += io[UID_IO_WCHAR];
+	io_slot->fsync += io[UID_IO_FSYNC];
+}
+
 #ifdef CONFIG_UID_SYS_STATS_DEBUG
+static u64 compute_write_bytes(struct task_struct *task)
+{
+	if (task->ioac.write_bytes <= task->ioac.cancelled_write_bytes)
+		return 0;
+
+	return task->ioac.write_bytes - task->ioac.cancelled_write_bytes;
+}
+
 static void get_full_task_comm(struct task_entry *task_entry,
 		struct task_struct *task)
 {
@@ -253,6 +351,39 @@ static void add_uid_tasks_io_stats(struct uid_entry *uid_entry,
 	task_io_slot->fsync += task->ioac.syscfs;
 }
 
+static struct uid_entry *find_or_register_uid(uid_t uid);
+
+/* per-task entries have no counters of their own, so they still walk tasks */
+static void update_io_uid_tasks_locked(struct uid_entry *only)
+{
+	struct uid_entry *uid_entry = NULL;
+	struct task_struct *task, *temp;
+	struct user_namespace *user_ns = current_user_ns();
+	unsigned long bkt;
+	uid_t uid;
+
+	if (only)
+		set_io_uid_tasks_zero(only);
+	else
+		hash_for_each(hash_table, bkt, uid_entry, hash)
+			set_io_uid_tasks_zero(uid_entry);
+
+	rcu_read_lock();
+	do_each_thread(temp, task) {
+		uid = from_kuid_munged(user_ns, task_uid(task));
+		if (only && only->uid != uid)
+			continue;
+		if (only)
+			uid_entry = only;
+		else if (!uid_entry || uid_entry->uid != uid)
+			uid_entry = find_or_register_uid(uid);
+		if (!uid_entry)
+			continue;
+		add_uid_tasks_io_stats(uid_entry, task, UID_STATE_TOTAL_CURR);
+	} while_each_thread(temp, task);
+	rcu_read_unlock();
+}
+
 static void compute_io_uid_tasks(struct uid_entry *uid_entry)
 {
 	struct task_entry *task_entry;
@@ -290,9 +421,9 @@ static void show_io_uid_tasks(struct seq_file *m, struct uid_entry *uid_entry)
 }
 #else
 static void remove_uid_tasks(struct uid_entry *uid_entry) {};
-static void set_io_uid_tasks_zero(struct uid_entry *uid_entry) {};
 static void add_uid_tasks_io_stats(struct uid_entry *uid_entry,
 		struct task_struct *task, int slot) {};
+static void update_io_uid_tasks_locked(struct uid_entry *only) {};
 static void compute_io_uid_tasks(struct uid_entry *uid_entry) {};
 static void show_io_uid_tasks(struct seq_file *m,
 		struct uid_entry *uid_entry) {}
@@ -451,46 +582,53 @@ static const struct file_operations uid_remove_fops = {
 };
 
 
-static void add_uid_io_stats(struct uid_entry *uid_entry,
-			struct task_struct *task, int slot)
-{
-	struct io_stats *io_slot = &uid_entry->io[slot];
-
-	io_slot->read_bytes += task->ioac.read_bytes;
-	io_slot->write_bytes += compute_write_bytes(task);
-	io_slot->rchar += task->ioac.rchar;
-	io_slot->wchar += task->ioac.wchar;
-	io_slot->fsync += task->ioac.syscfs;
-
-	add_uid_tasks_io_stats(uid_entry, task, slot);
-}
-
-static void update_io_stats_all_locked(void)
+static void update_io_stats_locked(struct uid_entry *only)
 {
-	struct uid_entry *uid_entry = NULL;
-	struct task_struct *task, *temp;
+	struct uid_entry *uid_entry;
+	struct uid_sys_stats_user *stats, *tmp;
 	struct user_namespace *user_ns = current_user_ns();
-	unsigned long bkt;
+	unsigned long bkt, flags;
+	LIST_HEAD(dead);
 	uid_t uid;
 
-	hash_for_each(hash_table, bkt, uid_entry, hash) {
-		memset(&uid_entry->io[UID_STATE_TOTAL_CURR], 0,
+	if (only)
+		memset(&only->io[UID_STATE_TOTAL_CURR], 0,
 			sizeof(struct io_stats));
-		set_io_uid_tasks_zero(uid_entry);
-	}
-
-	rcu_read_lock();
-	do_each_thread(temp, task) {
-		uid = from_kuid_munged(user_ns, task_uid(task));
-		if (!uid_entry || uid_entry->uid != uid)
-			uid_entry = find_or_register_uid(uid);
+	else
+		hash_for_each(hash_table, bkt, uid_entry, hash)
+			memset(&uid_entry->io[UID_STATE_TOTAL_CURR], 0,
+				sizeof(struct io_stats));
+
+	spin_lock_irqsave(&users_lock, flags);
+	list_splice_init(&dead_users, &dead);
+	list_for_each_entry(stats, &live_users, link) {
+		uid = from_kuid_munged(user_ns, stats->uid);
+		if (only && only->uid != uid)
+			continue;
+		uid_entry = only ? only : find_or_register_uid(uid);
 		if (!uid_entry)
 			continue;
-		add_uid_io_stats(uid_entry, task, UID_STATE_TOTAL_CURR);
-	} while_each_thread(temp, task);
-	rcu_read_unlock();
+		add_user_io_stats(&uid_entry->io[UID_STATE_TOTAL_CURR], stats);
+	}
+	spin_unlock_irqrestore(&users_lock, flags);
+
+	/* users that went away keep their uid's totals monotonic */
+	list_for_each_entry_safe(stats, tmp, &dead, link) {
+		uid = from_kuid_munged(user_ns, stats->uid);
+		uid_entry = find_or_register_uid(uid);
+		if (uid_entry)
+			add_user_io_stats(&uid_entry->io[UID_STATE_DEAD_TASKS],
+				stats);
+		list_del(&stats->link);
+		free_percpu(stats->pcpu);
+		kfree(stats);
+	}
+
+	update_io_uid_tasks_locked(only);
 
 	hash_for_each(hash_table, bkt, uid_entry, hash) {
+		if (only && uid_entry != only)
+			continue;
 		compute_io_bucket_stats(&uid_entry->io[uid_entry->state],
 					&uid_entry->io[UID_STATE_TOTAL_CURR],
 					&uid_entry->io[UID_STATE_TOTAL_LAST],
@@ -499,31 +637,6 @@ static void update_io_stats_all_locked(void)
 	}
 }
 
-static void update_io_stats_uid_locked(struct uid_entry *uid_entry)
-{
-	struct task_struct *task, *temp;
-	struct user_namespace *user_ns = current_user_ns();
-
-	memset(&uid_entry->io[UID_STATE_TOTAL_CURR], 0,
-		sizeof(struct io_stats));
-	set_io_uid_tasks_zero(uid_entry);
-
-	rcu_read_lock();
-	do_each_thread(temp, task) {
-		if (from_kuid_munged(user_ns, task_uid(task)) != uid_entry->uid)
-			continue;
-		add_uid_io_stats(uid_entry, task, UID_STATE_TOTAL_CURR);
-	} while_each_thread(temp, task);
-	rcu_read_unlock();
-
-	compute_io_bucket_stats(&uid_entry->io[uid_entry->state],
-				&uid_entry->io[UID_STATE_TOTAL_CURR],
-				&uid_entry->io[UID_STATE_TOTAL_LAST],
-				&uid_entry->io[UID_STATE_DEAD_TASKS]);
-	compute_io_uid_tasks(uid_entry);
-}
-
-
 static int uid_io_show(struct seq_file *m, void *v)
 {
 	struct uid_entry *uid_entry;
@@ -531,7 +644,7 @@ static int uid_io_show(struct seq_file *m, void *v)
 
 	rt_mutex_lock(&uid_lock);
 
-	update_io_stats_all_locked();
+	update_io_stats_locked(NULL);
 
 	hash_for_each(hash_table, bkt, uid_entry, hash) {
 		seq_printf(m, "%d %llu %llu %llu %llu %llu %llu %llu %llu %llu %llu\n",
@@ -566,6 +679,38 @@ static const struct file_operations uid_io_fops = {
 	.release	= single_release,
 };
 
+static int uid_io_bin_show(struct seq_file *m, void *v)
+{
+	struct uid_entry *uid_entry;
+	struct uid_io_record rec = { 0 };
+	unsigned long bkt;
+
+	rt_mutex_lock(&uid_lock);
+
+	update_io_stats_locked(NULL);
+
+	hash_for_each(hash_table, bkt, uid_entry, hash) {
+		rec.uid = uid_entry->uid;
+		memcpy(rec.io, uid_entry->io, sizeof(rec.io));
+		seq_write(m, &rec, sizeof(rec));
+	}
+
+	rt_mutex_unlock(&uid_lock);
+	return 0;
+}
+
+static int uid_io_bin_open(struct inode *inode, struct file *file)
+{
+	return single_open(file, uid_io_bin_show, PDE_DATA(inode));
+}
+
+static const struct file_operations uid_io_bin_fops = {
+	.open		= uid_io_bin_open,
+	.read		= seq_read,
+	.llseek		= seq_lseek,
+	.release	= single_release,
+};
+
 static int uid_procstat_open(struct inode *inode, struct file *file)
 {
 	return single_open(file, NULL, NULL);
@@ -607,7 +752,7 @@ static ssize_t uid_procstat_write(struct file *file,
 		return count;
 	}
 
-	update_io_stats_uid_locked(uid_entry);
+	update_io_stats_locked(uid_entry);
 
 	uid_entry->state = state;
 
@@ -645,7 +790,7 @@ static int process_notifier(struct notifier_block *self,
 	uid_entry->utime += utime;
 	uid_entry->stime += stime;
 
-	add_uid_io_stats(uid_entry, task, UID_STATE_DEAD_TASKS);
+	add_uid_tasks_io_stats(uid_entry, task, UID_STATE_DEAD_TASKS);
 
 exit:
 	rt_mutex_unlock(&uid_lock);
@@ -659,6 +804,7 @@ static struct notifier_block process_notifier_block = {
 static int __init proc_uid_sys_stats_init(void)
 {
 	hash_init(hash_table);
+	uid_sys_stats_user_init(&root_user);
 
 	cpu_parent = proc_mkdir("uid_cputime", NULL);
 	if (!cpu_parent) {
@@ -681,6 +827,8 @@ static int __init proc_uid_sys_stats_init(void)
 
 	proc_create_data("stats", 0444, io_parent,
 		&uid_io_fops, NULL);
+	proc_create_data("stats_bin", 0444, io_parent,
+		&uid_io_bin_fops, NULL);
 
 	proc_parent = proc_mkdir("uid_procstat", NULL);
 	if (!proc_parent) {
@@ -3692,6 +3692,8 @@ void mmc_blk_cmdq_complete_rq(struct request *rq)
 	bool is_dcmd = false;
 	bool err_rwsem = false;
 
+	mmc_lat_hist_done(host, mrq);
+
 	if (down_read_trylock(&ctx_info->err_rwsem)) {
 		err_rwsem = true;
 	} else {
@@ -3780,6 +3782,7 @@ void mmc_blk_cmdq_req_done(struct mmc_request *mrq)
 {
 	struct request *req = mrq->req;
 
+	mmc_lat_hist_complete(mrq->host, mrq);
 	blk_complete_request(req);
 }
 EXPORT_SYMBOL(mmc_blk_cmdq_req_done);
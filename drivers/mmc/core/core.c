@@ -1121,6 +1121,7 @@ void mmc_request_done(struct mmc_host *host, struct mmc_request *mrq)
 				mrq->stop->resp[2], mrq->stop->resp[3]);
 		}
 
+		mmc_lat_hist_complete(host, mrq);
 		if (mrq->done)
 			mrq->done(mrq);
 
@@ -1170,6 +1171,7 @@ static void __mmc_start_request(struct mmc_host *host, struct mmc_request *mrq)
 
 	trace_mmc_request_start(host, mrq);
 
+	mmc_lat_hist_issue(mrq);
 	host->ops->request(host, mrq);
 }
 
@@ -1324,6 +1326,7 @@ static int mmc_start_cmdq_request(struct mmc_host *host,
 	mmc_host_clk_hold(host);
 	mmc_cmdq_check_retune(host);
 	if (likely(host->cmdq_ops->request)) {
+		mmc_lat_hist_issue(mrq);
 		ret = host->cmdq_ops->request(host, mrq);
 	} else {
 		ret = -ENOENT;
@@ -1657,6 +1660,7 @@ static int mmc_wait_for_data_req_done(struct mmc_host *host,
 			    mmc_card_removed(host->card)) {
 				err = host->areq->err_check(host->card,
 							    host->areq);
+				mmc_lat_hist_done(host, mrq);
 				break; /* return err */
 			} else {
 				mmc_retune_recheck(host);
@@ -1723,6 +1727,7 @@ void mmc_wait_for_req_done(struct mmc_host *host, struct mmc_request *mrq)
 		__mmc_start_request(host, mrq);
 	}
 
+	mmc_lat_hist_done(host, mrq);
 	mmc_retune_release(host);
 }
 EXPORT_SYMBOL(mmc_wait_for_req_done);
@@ -52,6 +52,39 @@ static const struct file_operations mmc_ring_buffer_fops = {
 	.release	= single_release,
 };
 
+static int mmc_lat_hist_show(struct seq_file *s, void *data)
+{
+	struct mmc_host *mmc = s->private;
+
+	mmc_dump_lat_hist(mmc, s);
+	return 0;
+}
+
+static int mmc_lat_hist_open(struct inode *inode, struct file *file)
+{
+	return single_open(file, mmc_lat_hist_show, inode->i_private);
+}
+
+static ssize_t mmc_lat_hist_write(struct file *filp, const char __user *ubuf,
+				  size_t cnt, loff_t *ppos)
+{
+	struct mmc_host *host = filp->f_mapping->host->i_private;
+
+	if (!host)
+		return -EINVAL;
+
+	mmc_reset_lat_hist(host);
+	return cnt;
+}
+
+static const struct file_operations mmc_lat_hist_fops = {
+	.open		= mmc_lat_hist_open,
+	.read		= seq_read,
+	.write		= mmc_lat_hist_write,
+	.llseek		= seq_lseek,
+	.release	= single_release,
+};
+
 static int mmc_ios_show(struct seq_file *s, void *data)
 {
 	static const char *vdd_str[] = {
@@ -498,6 +531,10 @@ void mmc_add_host_debugfs(struct mmc_host *host)
 	if (!debugfs_create_file("ring_buffer", S_IRUSR,
 				root, host, &mmc_ring_buffer_fops))
 		goto err_node;
+
+	if (!debugfs_create_file("lat_hist", 0600,
+				root, host, &mmc_lat_hist_fops))
+		goto err_node;
 #endif
 	if (!debugfs_create_file("err_state", S_IRUSR | S_IWUSR, root, host,
 		&mmc_err_state))
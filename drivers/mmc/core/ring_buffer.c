@@ -13,6 +13,8 @@
 
 #include <linux/mmc/ring_buffer.h>
 #include <linux/mmc/host.h>
+#include <linux/mmc/mmc.h>
+#include <linux/slab.h>
 
 void mmc_stop_tracing(struct mmc_host *mmc)
 {
@@ -78,6 +80,11 @@ void mmc_trace_init(struct mmc_host *mmc)
 
 	spin_lock_init(&mmc->trace_buf.trace_lock);
 	mmc->trace_buf.wr_idx = -1;
+
+	mmc->trace_buf.lat = kzalloc(sizeof(*mmc->trace_buf.lat), GFP_KERNEL);
+	if (!mmc->trace_buf.lat)
+		pr_err("%s: %s: Unable to allocate latency histograms\n",
+			__func__, mmc_hostname(mmc));
 }
 
 void mmc_trace_free(struct mmc_host *mmc)
@@ -85,6 +92,8 @@ void mmc_trace_free(struct mmc_host *mmc)
 	if (mmc->trace_buf.data)
 		free_pages((unsigned long)mmc->trace_buf.data,
 			MMC_TRACE_RBUF_SZ_ORDER);
+	kfree(mmc->trace_buf.lat);
+	mmc->trace_buf.lat = NULL;
 }
 
 void mmc_dump_trace_buffer(struct mmc_host *mmc, struct seq_file *s)
@@ -121,3 +130,157 @@ void mmc_dump_trace_buffer(struct mmc_host *mmc, struct seq_file *s)
 	} while (1);
 	spin_unlock_irqrestore(&mmc->trace_buf.trace_lock, flags);
 }
+
+static const char * const mmc_lat_op_names[MMC_LAT_NR_OPS] = {
+	[MMC_LAT_READ_SINGLE]	= "read_single",
+	[MMC_LAT_READ_MULTI]	= "read_multi",
+	[MMC_LAT_WRITE_SINGLE]	= "write_single",
+	[MMC_LAT_WRITE_MULTI]	= "write_multi",
+	[MMC_LAT_CMDQ_READ]	= "cmdq_read",
+	[MMC_LAT_CMDQ_WRITE]	= "cmdq_write",
+	[MMC_LAT_FLUSH]		= "flush",
+	[MMC_LAT_DISCARD]	= "discard",
+	[MMC_LAT_OTHER]		= "other",
+};
+
+static const char * const mmc_lat_phase_names[MMC_LAT_NR_PHASES] = {
+	[MMC_LAT_ISSUE_TO_COMPLETE]	= "issue_to_complete",
+	[MMC_LAT_COMPLETE_TO_DONE]	= "complete_to_done",
+};
+
+static enum mmc_lat_op mmc_lat_op(struct mmc_request *mrq)
+{
+	struct mmc_cmdq_req *cmdq_req = mrq->cmdq_req;
+	struct mmc_command *cmd = mrq->cmd;
+
+	if (cmdq_req && !(cmdq_req->cmdq_req_flags & DCMD))
+		return (cmdq_req->cmdq_req_flags & DIR) ?
+			MMC_LAT_CMDQ_READ : MMC_LAT_CMDQ_WRITE;
+
+	if (!cmd)
+		return MMC_LAT_OTHER;
+
+	switch (cmd->opcode) {
+	case MMC_READ_SINGLE_BLOCK:
+		return MMC_LAT_READ_SINGLE;
+	case MMC_READ_MULTIPLE_BLOCK:
+		return MMC_LAT_READ_MULTI;
+	case MMC_WRITE_BLOCK:
+		return MMC_LAT_WRITE_SINGLE;
+	case MMC_WRITE_MULTIPLE_BLOCK:
+		return MMC_LAT_WRITE_MULTI;
+	case MMC_ERASE:
+		return MMC_LAT_DISCARD;
+	case MMC_SWITCH:
+		if (((cmd->arg >> 16) & 0xff) == EXT_CSD_FLUSH_CACHE)
+			return MMC_LAT_FLUSH;
+		/* fall through */
+	default:
+		return MMC_LAT_OTHER;
+	}
+}
+
+static void mmc_lat_hist_add(struct mmc_host *mmc, enum mmc_lat_op op,
+			     enum mmc_lat_phase phase, s64 delta_us)
+{
+	struct mmc_lat_hist *hist;
+	unsigned long flags;
+	unsigned int bucket;
+	u64 us = delta_us > 0 ? delta_us : 0;
+
+	bucket = min_t(unsigned int, fls64(us), MMC_LAT_NR_BUCKETS - 1);
+
+	spin_lock_irqsave(&mmc->trace_buf.trace_lock, flags);
+	hist = &mmc->trace_buf.lat->hist[op][phase];
+	hist->count++;
+	hist->sum_us += us;
+	if (us > hist->max_us)
+		hist->max_us = us;
+	hist->buckets[bucket]++;
+	spin_unlock_irqrestore(&mmc->trace_buf.trace_lock, flags);
+}
+
+/*
+ * Called when the host controller signals that @mrq has finished, either
+ * from mmc_request_done() or from the CMDQ completion callback.
+ */
+void mmc_lat_hist_complete(struct mmc_host *mmc, struct mmc_request *mrq)
+{
+	ktime_t now;
+
+	if (!mmc->trace_buf.lat || !ktime_to_ns(mrq->lat_issue))
+		return;
+
+	now = ktime_get();
+	mrq->lat_complete = now;
+	mmc_lat_hist_add(mmc, mmc_lat_op(mrq), MMC_LAT_ISSUE_TO_COMPLETE,
+			 ktime_us_delta(now, mrq->lat_issue));
+}
+EXPORT_SYMBOL(mmc_lat_hist_complete);
+
+/*
+ * Called once the issuer has picked up the completion of @mrq, i.e. the
+ * point where the result is handed back to the block layer or the caller.
+ */
+void mmc_lat_hist_done(struct mmc_host *mmc, struct mmc_request *mrq)
+{
+	if (!mmc->trace_buf.lat || !ktime_to_ns(mrq->lat_complete))
+		return;
+
+	mmc_lat_hist_add(mmc, mmc_lat_op(mrq), MMC_LAT_COMPLETE_TO_DONE,
+			 ktime_us_delta(ktime_get(), mrq->lat_complete));
+	mrq->lat_issue = ktime_set(0, 0);
+	mrq->lat_complete = ktime_set(0, 0);
+}
+EXPORT_SYMBOL(mmc_lat_hist_done);
+
+void mmc_dump_lat_hist(struct mmc_host *mmc, struct seq_file *s)
+{
+	struct mmc_lat_stats *stats;
+	struct mmc_lat_hist *hist;
+	unsigned long flags;
+	int op, phase, i;
+
+	if (!mmc->trace_buf.lat)
+		return;
+
+	stats = kmalloc(sizeof(*stats), GFP_KERNEL);
+	if (!stats)
+		return;
+
+	spin_lock_irqsave(&mmc->trace_buf.trace_lock, flags);
+	memcpy(stats, mmc->trace_buf.lat, sizeof(*stats));
+	spin_unlock_irqrestore(&mmc->trace_buf.trace_lock, flags);
+
+	seq_puts(s, "# bucket n counts latencies in [2^(n-1), 2^n) us\n");
+	for (op = 0; op < MMC_LAT_NR_OPS; op++) {
+		for (phase = 0; phase < MMC_LAT_NR_PHASES; phase++) {
+			hist = &stats->hist[op][phase];
+			if (!hist->count)
+				continue;
+
+			seq_printf(s, "%s %s: count %llu avg_us %llu max_us %llu\n",
+				mmc_lat_op_names[op],
+				mmc_lat_phase_names[phase], hist->count,
+				div64_u64(hist->sum_us, hist->count),
+				hist->max_us);
+			for (i = 0; i < MMC_LAT_NR_BUCKETS; i++)
+				seq_printf(s, " %u", hist->buckets[i]);
+			seq_puts(s, "\n");
+		}
+	}
+
+	kfree(stats);
+}
+
+void mmc_reset_lat_hist(struct mmc_host *mmc)
+{
+	unsigned long flags;
+
+	if (!mmc->trace_buf.lat)
+		return;
+
+	spin_lock_irqsave(&mmc->trace_buf.trace_lock, flags);
+	memset(mmc->trace_buf.lat, 0, sizeof(*mmc->trace_buf.lat));
+	spin_unlock_irqrestore(&mmc->trace_buf.trace_lock, flags);
+}
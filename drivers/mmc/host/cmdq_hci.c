@@ -769,6 +769,7 @@ static void cmdq_pm_qos_vote(struct sdhci_host *host, struct mmc_request *mrq)
 
 static void cmdq_pm_qos_unvote(struct sdhci_host *host, struct mmc_request *mrq)
 {
+	sdhci_msm_pm_qos_cmdq_complete(host, mrq->req->cpu);
 	/* use async as we're inside an atomic context (soft-irq) */
 	sdhci_msm_pm_qos_cpu_unvote(host, mrq->req->cpu, true);
 }
@@ -830,6 +831,7 @@ static int cmdq_request(struct mmc_host *mmc, struct mmc_request *mrq)
 	cq_host->mrq_slot[tag] = mrq;
 
 	/* PM QoS */
+	sdhci_msm_pm_qos_cmdq_issue(host);
 	sdhci_msm_pm_qos_irq_vote(host);
 	cmdq_pm_qos_vote(host, mrq);
 ring_doorbell:
@@ -1363,6 +1365,7 @@ static int cmdq_late_init(struct mmc_host *mmc)
 	if (msm_host->pdata->pm_qos_data.cmdq_valid)
 		sdhci_msm_pm_qos_cpu_init(host,
 			msm_host->pdata->pm_qos_data.cmdq_latency);
+	sdhci_msm_pm_qos_adapt_init(host);
 	return 0;
 }
 
@@ -40,6 +40,7 @@
 #include <linux/msm-bus.h>
 #include <linux/pm_runtime.h>
 #include <linux/nvmem-consumer.h>
+#include <linux/thermal.h>
 #include <trace/events/mmc.h>
 
 #include "sdhci-msm.h"
@@ -47,6 +48,11 @@
 #include "cmdq_hci.h"
 
 #define QOS_REMOVE_DELAY_MS	10
+/* CMDQ adaptive unvote: light I/O releases at once, bursts hold the vote */
+#define QOS_LIGHT_GAP_US	20000
+#define QOS_MIN_HOLD_US		1000
+#define QOS_MAX_HOLD_US		40000
+#define QOS_DEEP_QUEUE		4
 #define CORE_POWER		0x0
 #define CORE_SW_RST		(1 << 7)
 
@@ -1207,6 +1213,130 @@ static void sdhci_msm_set_mmc_drv_type(struct sdhci_host *host, u32 opcode,
 			drv_type);
 }
 
+static int sdhci_msm_tuning_temp_band(struct sdhci_msm_host *msm_host)
+{
+	const char *tz_name = msm_host->pdata->tuning_tz_name;
+	int temp;
+
+	if (!tz_name)
+		return 0;
+
+	/* the thermal zone may register after us, look it up lazily */
+	if (IS_ERR_OR_NULL(msm_host->tuning_tz))
+		msm_host->tuning_tz = thermal_zone_get_zone_by_name(tz_name);
+	if (IS_ERR(msm_host->tuning_tz) ||
+	    thermal_zone_get_temp(msm_host->tuning_tz, &temp))
+		return 0;
+
+	return temp / SDHCI_MSM_TUNING_TEMP_BAND;
+}
+
+static u32 sdhci_msm_tuning_crc_errs(struct mmc_host *mmc)
+{
+	return mmc->err_stats[MMC_ERR_CMD_CRC] +
+		mmc->err_stats[MMC_ERR_DAT_CRC];
+}
+
+/*
+ * Look up the tuning cache for the current card and bus setting. Any CRC
+ * error since the last tuning drops all entries, as the phases they hold
+ * can no longer be trusted.
+ */
+static struct sdhci_msm_tuning_cache *sdhci_msm_tuning_cache_find(
+		struct sdhci_host *host, bool alloc)
+{
+	struct sdhci_pltfm_host *pltfm_host = sdhci_priv(host);
+	struct sdhci_msm_host *msm_host = pltfm_host->priv;
+	struct mmc_host *mmc = host->mmc;
+	struct mmc_card *card = mmc->card;
+	struct sdhci_msm_tuning_cache *entry;
+	int temp_band, i;
+
+	if (!card)
+		return NULL;
+
+	if (sdhci_msm_tuning_crc_errs(mmc) != msm_host->tuning_crc_errs) {
+		memset(msm_host->tuning_cache, 0,
+			sizeof(msm_host->tuning_cache));
+		msm_host->tuning_crc_errs = sdhci_msm_tuning_crc_errs(mmc);
+	}
+
+	temp_band = sdhci_msm_tuning_temp_band(msm_host);
+	for (i = 0; i < SDHCI_MSM_TUNING_CACHE_SIZE; i++) {
+		entry = &msm_host->tuning_cache[i];
+		if (entry->valid && entry->clock == host->clock &&
+		    entry->timing == mmc->ios.timing &&
+		    entry->signal_voltage == mmc->ios.signal_voltage &&
+		    entry->temp_band == temp_band &&
+		    !memcmp(entry->cid, card->raw_cid, sizeof(entry->cid)))
+			return entry;
+	}
+
+	if (!alloc)
+		return NULL;
+
+	entry = &msm_host->tuning_cache[msm_host->tuning_cache_next];
+	msm_host->tuning_cache_next = (msm_host->tuning_cache_next + 1) %
+					SDHCI_MSM_TUNING_CACHE_SIZE;
+	memcpy(entry->cid, card->raw_cid, sizeof(entry->cid));
+	entry->clock = host->clock;
+	entry->timing = mmc->ios.timing;
+	entry->signal_voltage = mmc->ios.signal_voltage;
+	entry->temp_band = temp_band;
+	entry->valid = false;
+	return entry;
+}
+
+/*
+ * Try the cached phase with a single tuning block transfer. Returns 0 if
+ * the block reads back correctly at that phase.
+ */
+static int sdhci_msm_try_cached_phase(struct sdhci_host *host, u32 opcode,
+		u8 phase, u8 *data_buf, const u32 *pattern, int size)
+{
+	struct mmc_host *mmc = host->mmc;
+	struct mmc_command cmd = {0};
+	struct mmc_data data = {0};
+	struct mmc_request mrq = {
+		.cmd = &cmd,
+		.data = &data
+	};
+	struct scatterlist sg;
+	int rc;
+
+	rc = msm_init_cm_dll(host, DLL_INIT_NORMAL);
+	if (rc)
+		return rc;
+	rc = msm_config_cm_dll_phase(host, phase);
+	if (rc)
+		return rc;
+
+	cmd.opcode = opcode;
+	cmd.flags = MMC_RSP_R1 | MMC_CMD_ADTC;
+
+	data.blksz = size;
+	data.blocks = 1;
+	data.flags = MMC_DATA_READ;
+	data.timeout_ns = 1000 * 1000 * 1000; /* 1 sec */
+
+	data.sg = &sg;
+	data.sg_len = 1;
+	sg_init_one(&sg, data_buf, size);
+	memset(data_buf, 0, size);
+	mmc_wait_for_req(mmc, &mrq);
+
+	/* Ignore crc errors occurred during tuning */
+	if (cmd.error)
+		mmc->err_stats[MMC_ERR_CMD_CRC]--;
+	else if (data.error)
+		mmc->err_stats[MMC_ERR_DAT_CRC]--;
+
+	if (cmd.error || data.error || memcmp(data_buf, pattern, size))
+		return -EIO;
+
+	return 0;
+}
+
 int sdhci_msm_execute_tuning(struct sdhci_host *host, u32 opcode)
 {
 	unsigned long flags;
@@ -1222,6 +1352,7 @@ int sdhci_msm_execute_tuning(struct sdhci_host *host, u32 opcode)
 	u8 drv_type = 0;
 	bool drv_type_changed = false;
 	struct mmc_card *card = host->mmc->card;
+	struct sdhci_msm_tuning_cache *cached;
 	int sts_retry;
 	u8 last_good_phase = 0;
 
@@ -1270,6 +1401,22 @@ int sdhci_msm_execute_tuning(struct sdhci_host *host, u32 opcode)
 		goto out;
 	}
 
+	/*
+	 * After resume or a clock change the card is usually back in a
+	 * setting tuned before; try that phase instead of a full search.
+	 */
+	cached = sdhci_msm_tuning_cache_find(host, false);
+	if (cached) {
+		if (!sdhci_msm_try_cached_phase(host, opcode, cached->phase,
+				data_buf, tuning_block_pattern, size)) {
+			msm_host->saved_tuning_phase = cached->phase;
+			pr_debug("%s: %s: reusing cached tuning phase %d\n",
+				mmc_hostname(mmc), __func__, cached->phase);
+			goto kfree;
+		}
+		cached->valid = false;
+	}
+
 retry:
 	tuned_phase_cnt = 0;
 
@@ -1423,6 +1570,12 @@ int sdhci_msm_execute_tuning(struct sdhci_host *host, u32 opcode)
 		msm_host->saved_tuning_phase = phase;
 		pr_debug("%s: %s: finally setting the tuning phase to %d\n",
 				mmc_hostname(mmc), __func__, phase);
+
+		cached = sdhci_msm_tuning_cache_find(host, true);
+		if (cached) {
+			cached->phase = phase;
+			cached->valid = true;
+		}
 	} else {
 		if (--tuning_seq_cnt)
 			goto retry;
@@ -2206,6 +2359,9 @@ struct sdhci_msm_pltfm_data *sdhci_msm_populate_pdata(struct device *dev,
 	if (of_get_property(np, "qcom,nonremovable", NULL))
 		pdata->nonremovable = true;
 
+	of_property_read_string(np, "qcom,tuning-thermal-zone",
+				&pdata->tuning_tz_name);
+
 	if (of_get_property(np, "qcom,nonhotplug", NULL))
 		pdata->nonhotplug = true;
 
@@ -4069,6 +4225,74 @@ void sdhci_msm_reset_workaround(struct sdhci_host *host, u32 enable)
 	}
 }
 
+/*
+ * Return how long to keep a vote once the last outstanding request has
+ * completed. Without adaptation, or outside of CMDQ, this is the fixed
+ * QOS_REMOVE_DELAY_MS.
+ */
+static unsigned long sdhci_msm_pm_qos_unvote_delay(
+		struct sdhci_msm_host *msm_host)
+{
+	struct sdhci_msm_pm_qos_adapt *adapt = &msm_host->pm_qos_adapt;
+	unsigned long flags;
+	u32 hold_us;
+
+	if (!adapt->enabled)
+		return msecs_to_jiffies(QOS_REMOVE_DELAY_MS);
+
+	spin_lock_irqsave(&adapt->lock, flags);
+	if (adapt->avg_gap_us >= QOS_LIGHT_GAP_US) {
+		/* light I/O, holding the vote would only keep CPUs awake */
+		spin_unlock_irqrestore(&adapt->lock, flags);
+		return 0;
+	}
+	hold_us = 2 * adapt->avg_gap_us;
+	if (adapt->peak_depth >= QOS_DEEP_QUEUE)
+		hold_us *= 2;
+	spin_unlock_irqrestore(&adapt->lock, flags);
+
+	return usecs_to_jiffies(clamp_t(u32, hold_us, QOS_MIN_HOLD_US,
+					QOS_MAX_HOLD_US));
+}
+
+/* Called from cmdq_request() before the request votes */
+void sdhci_msm_pm_qos_cmdq_issue(struct sdhci_host *host)
+{
+	struct sdhci_pltfm_host *pltfm_host = sdhci_priv(host);
+	struct sdhci_msm_host *msm_host = pltfm_host->priv;
+	struct sdhci_msm_pm_qos_adapt *adapt = &msm_host->pm_qos_adapt;
+	int depth = atomic_read(&msm_host->pm_qos_irq.counter) + 1;
+	unsigned long flags;
+	ktime_t now;
+	s64 gap_us;
+
+	if (!adapt->enabled)
+		return;
+
+	now = ktime_get();
+	spin_lock_irqsave(&adapt->lock, flags);
+	if (ktime_to_ns(adapt->last_req)) {
+		gap_us = min_t(s64, ktime_us_delta(now, adapt->last_req),
+			       2 * QOS_LIGHT_GAP_US);
+		/* moving average, each new gap weighs 1/8 */
+		adapt->avg_gap_us = (u32)((7 * (s64)adapt->avg_gap_us +
+					   gap_us) >> 3);
+	}
+	adapt->last_req = now;
+
+	if (depth == 1) {
+		/* first request of a burst, was the previous vote still held? */
+		if (msm_host->pm_qos_irq.latency == PM_QOS_DEFAULT_VALUE)
+			adapt->nr_cold_vote++;
+		else
+			adapt->nr_warm_vote++;
+		adapt->peak_depth = 1;
+	} else if (depth > adapt->peak_depth) {
+		adapt->peak_depth = depth;
+	}
+	spin_unlock_irqrestore(&adapt->lock, flags);
+}
+
 static void sdhci_msm_pm_qos_irq_unvote_work(struct work_struct *work)
 {
 	struct sdhci_msm_pm_qos_irq *pm_qos_irq =
@@ -4109,6 +4333,7 @@ void sdhci_msm_pm_qos_irq_unvote(struct sdhci_host *host, bool async)
 {
 	struct sdhci_pltfm_host *pltfm_host = sdhci_priv(host);
 	struct sdhci_msm_host *msm_host = pltfm_host->priv;
+	unsigned long flags;
 	int counter;
 
 	if (!msm_host->pm_qos_irq.enabled)
@@ -4125,9 +4350,16 @@ void sdhci_msm_pm_qos_irq_unvote(struct sdhci_host *host, bool async)
 		return;
 
 	if (async) {
+		unsigned long delay = sdhci_msm_pm_qos_unvote_delay(msm_host);
+
+		if (!delay && msm_host->pm_qos_adapt.enabled) {
+			spin_lock_irqsave(&msm_host->pm_qos_adapt.lock, flags);
+			msm_host->pm_qos_adapt.nr_light_release++;
+			spin_unlock_irqrestore(&msm_host->pm_qos_adapt.lock,
+					       flags);
+		}
 		queue_delayed_work(msm_host->pm_qos_wq,
-				&msm_host->pm_qos_irq.unvote_work,
-				msecs_to_jiffies(QOS_REMOVE_DELAY_MS));
+				&msm_host->pm_qos_irq.unvote_work, delay);
 		return;
 	}
 
@@ -4381,6 +4613,33 @@ static int sdhci_msm_get_cpu_group(struct sdhci_msm_host *msm_host, int cpu)
 	return -EINVAL;
 }
 
+/*
+ * Called on CMDQ request completion, before the request unvotes. Counts
+ * completions whose issuing CPU had no latency vote and may have been
+ * power collapsed.
+ */
+void sdhci_msm_pm_qos_cmdq_complete(struct sdhci_host *host, int cpu)
+{
+	struct sdhci_pltfm_host *pltfm_host = sdhci_priv(host);
+	struct sdhci_msm_host *msm_host = pltfm_host->priv;
+	struct sdhci_msm_pm_qos_adapt *adapt = &msm_host->pm_qos_adapt;
+	int group = -EINVAL;
+	unsigned long flags;
+
+	if (!adapt->enabled)
+		return;
+
+	if (msm_host->pm_qos_group_enable)
+		group = sdhci_msm_get_cpu_group(msm_host, cpu);
+
+	if (group < 0 ||
+	    msm_host->pm_qos[group].latency == PM_QOS_DEFAULT_VALUE) {
+		spin_lock_irqsave(&adapt->lock, flags);
+		adapt->nr_cmpl_unvoted++;
+		spin_unlock_irqrestore(&adapt->lock, flags);
+	}
+}
+
 void sdhci_msm_pm_qos_cpu_vote(struct sdhci_host *host,
 		struct sdhci_msm_pm_qos_latency *latency, int cpu)
 {
@@ -4433,7 +4692,7 @@ bool sdhci_msm_pm_qos_cpu_unvote(struct sdhci_host *host, int cpu, bool async)
 	if (async) {
 		queue_delayed_work(msm_host->pm_qos_wq,
 				&msm_host->pm_qos[group].unvote_work,
-				msecs_to_jiffies(QOS_REMOVE_DELAY_MS));
+				sdhci_msm_pm_qos_unvote_delay(msm_host));
 		return true;
 	}
 
@@ -4508,6 +4767,97 @@ void sdhci_msm_pm_qos_cpu_init(struct sdhci_host *host,
 			__func__, ret);
 }
 
+static ssize_t sdhci_msm_pm_qos_adapt_show(struct device *dev,
+		struct device_attribute *attr, char *buf)
+{
+	struct sdhci_host *host = dev_get_drvdata(dev);
+	struct sdhci_pltfm_host *pltfm_host = sdhci_priv(host);
+	struct sdhci_msm_host *msm_host = pltfm_host->priv;
+	struct sdhci_msm_pm_qos_adapt *adapt = &msm_host->pm_qos_adapt;
+
+	return snprintf(buf, PAGE_SIZE,
+		"CMDQ PM QoS: enabled=%d, avg_gap_us=%u, peak_depth=%d, warm_votes=%llu, cold_votes=%llu, light_releases=%llu, unvoted_completions=%llu\n",
+		adapt->enabled, adapt->avg_gap_us, adapt->peak_depth,
+		adapt->nr_warm_vote, adapt->nr_cold_vote,
+		adapt->nr_light_release, adapt->nr_cmpl_unvoted);
+}
+
+static ssize_t sdhci_msm_pm_qos_adapt_enable_show(struct device *dev,
+		struct device_attribute *attr, char *buf)
+{
+	struct sdhci_host *host = dev_get_drvdata(dev);
+	struct sdhci_pltfm_host *pltfm_host = sdhci_priv(host);
+	struct sdhci_msm_host *msm_host = pltfm_host->priv;
+
+	return snprintf(buf, PAGE_SIZE, "%u\n",
+			msm_host->pm_qos_adapt.enabled);
+}
+
+static ssize_t sdhci_msm_pm_qos_adapt_enable_store(struct device *dev,
+		struct device_attribute *attr, const char *buf, size_t count)
+{
+	struct sdhci_host *host = dev_get_drvdata(dev);
+	struct sdhci_pltfm_host *pltfm_host = sdhci_priv(host);
+	struct sdhci_msm_host *msm_host = pltfm_host->priv;
+	struct sdhci_msm_pm_qos_adapt *adapt = &msm_host->pm_qos_adapt;
+	unsigned long flags;
+	uint32_t value;
+
+	if (kstrtou32(buf, 0, &value))
+		goto out;
+
+	spin_lock_irqsave(&adapt->lock, flags);
+	if (!!value != adapt->enabled) {
+		adapt->enabled = !!value;
+		adapt->last_req = ktime_set(0, 0);
+		adapt->avg_gap_us = 0;
+		adapt->peak_depth = 0;
+	}
+	spin_unlock_irqrestore(&adapt->lock, flags);
+
+out:
+	return count;
+}
+
+void sdhci_msm_pm_qos_adapt_init(struct sdhci_host *host)
+{
+	struct sdhci_pltfm_host *pltfm_host = sdhci_priv(host);
+	struct sdhci_msm_host *msm_host = pltfm_host->priv;
+	struct sdhci_msm_pm_qos_adapt *adapt = &msm_host->pm_qos_adapt;
+	int ret;
+
+	/* adaptation only drives the IRQ and CPU group votes */
+	if (!msm_host->pm_qos_irq.enabled && !msm_host->pm_qos_group_enable)
+		return;
+
+	/* Initialize only once as this gets called per partition */
+	if (adapt->enable_attr.attr.name)
+		return;
+
+	spin_lock_init(&adapt->lock);
+	adapt->enabled = true;
+
+	adapt->enable_attr.show = sdhci_msm_pm_qos_adapt_enable_show;
+	adapt->enable_attr.store = sdhci_msm_pm_qos_adapt_enable_store;
+	sysfs_attr_init(&adapt->enable_attr.attr);
+	adapt->enable_attr.attr.name = "pm_qos_cmdq_adapt_enable";
+	adapt->enable_attr.attr.mode = S_IRUGO | S_IWUSR;
+	ret = device_create_file(&msm_host->pdev->dev, &adapt->enable_attr);
+	if (ret)
+		pr_err("%s: fail to create pm_qos_cmdq_adapt_enable (%d)\n",
+			__func__, ret);
+
+	adapt->status_attr.show = sdhci_msm_pm_qos_adapt_show;
+	adapt->status_attr.store = NULL;
+	sysfs_attr_init(&adapt->status_attr.attr);
+	adapt->status_attr.attr.name = "pm_qos_cmdq_adapt_status";
+	adapt->status_attr.attr.mode = S_IRUGO;
+	ret = device_create_file(&msm_host->pdev->dev, &adapt->status_attr);
+	if (ret)
+		pr_err("%s: fail to create pm_qos_cmdq_adapt_status (%d)\n",
+			__func__, ret);
+}
+
 static void sdhci_msm_pre_req(struct sdhci_host *host,
 		struct mmc_request *mmc_req)
 {
@@ -5416,6 +5766,13 @@ static int sdhci_msm_remove(struct platform_device *pdev)
 		pm_qos_remove_request(&msm_host->pm_qos_irq.req);
 	}
 
+	if (msm_host->pm_qos_adapt.enable_attr.attr.name) {
+		device_remove_file(&pdev->dev,
+				&msm_host->pm_qos_adapt.enable_attr);
+		device_remove_file(&pdev->dev,
+				&msm_host->pm_qos_adapt.status_attr);
+	}
+
 	if (msm_host->pm_qos_wq)
 		destroy_workqueue(msm_host->pm_qos_wq);
 
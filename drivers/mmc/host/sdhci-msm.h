@@ -131,6 +131,25 @@ struct sdhci_msm_pm_qos_irq {
 	bool enabled;
 };
 
+/*
+ * PM QoS unvote delay adaptation for CMDQ - the vote is held across the
+ * expected gap to the next request, derived from a moving average of the
+ * request inter-arrival time and the depth the queue reached.
+ */
+struct sdhci_msm_pm_qos_adapt {
+	spinlock_t lock;
+	bool enabled;
+	ktime_t last_req;
+	u32 avg_gap_us;
+	int peak_depth;
+	u64 nr_warm_vote;
+	u64 nr_cold_vote;
+	u64 nr_light_release;
+	u64 nr_cmpl_unvoted;
+	struct device_attribute enable_attr;
+	struct device_attribute status_attr;
+};
+
 struct sdhci_msm_pltfm_data {
 	/* Supported UHS-I Modes */
 	u32 caps;
@@ -161,6 +180,25 @@ struct sdhci_msm_pltfm_data {
 	bool rclk_wa;
 	u32 *bus_clk_table;
 	unsigned char bus_clk_cnt;
+	const char *tuning_tz_name;
+};
+
+#define SDHCI_MSM_TUNING_CACHE_SIZE	4
+/* temperature band width, in millidegrees, for tuning cache lookups */
+#define SDHCI_MSM_TUNING_TEMP_BAND	20000
+
+/*
+ * Last good tuning phase for one (card, clock, timing, voltage,
+ * temperature band) combination, tried before a full phase search.
+ */
+struct sdhci_msm_tuning_cache {
+	bool valid;
+	u32 cid[4];
+	unsigned int clock;
+	unsigned char timing;
+	unsigned char signal_voltage;
+	int temp_band;
+	u8 phase;
 };
 
 struct sdhci_msm_bus_vote {
@@ -247,6 +285,10 @@ struct sdhci_msm_host {
 	bool tuning_done;
 	bool calibration_done;
 	u8 saved_tuning_phase;
+	struct sdhci_msm_tuning_cache tuning_cache[SDHCI_MSM_TUNING_CACHE_SIZE];
+	int tuning_cache_next;
+	u32 tuning_crc_errs;
+	struct thermal_zone_device *tuning_tz;
 	bool en_auto_cmd21;
 	struct device_attribute auto_cmd21_attr;
 	bool is_sdiowakeup_enabled;
@@ -266,6 +308,7 @@ struct sdhci_msm_host {
 	struct device_attribute pm_qos_group_status_attr;
 	bool pm_qos_group_enable;
 	struct sdhci_msm_pm_qos_irq pm_qos_irq;
+	struct sdhci_msm_pm_qos_adapt pm_qos_adapt;
 	bool tuning_in_progress;
 	bool mci_removed;
 	const struct sdhci_msm_offset *offset;
@@ -290,5 +333,9 @@ void sdhci_msm_pm_qos_cpu_vote(struct sdhci_host *host,
 		struct sdhci_msm_pm_qos_latency *latency, int cpu);
 bool sdhci_msm_pm_qos_cpu_unvote(struct sdhci_host *host, int cpu, bool async);
 
+void sdhci_msm_pm_qos_adapt_init(struct sdhci_host *host);
+void sdhci_msm_pm_qos_cmdq_issue(struct sdhci_host *host);
+void sdhci_msm_pm_qos_cmdq_complete(struct sdhci_host *host, int cpu);
+
 
 #endif /* __SDHCI_MSM_H__ */
@@ -0,0 +1,97 @@
+/* Copyright (c) 2016, The Linux Foundation. All rights reserved.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 and
+ * only version 2 as published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ */
+
+/* Qualcomm Technologies, Inc. EMAC Ethernet Controller ethtool support */
+
+#include <linux/ethtool.h>
+#include <linux/netdevice.h>
+#include "emac.h"
+#include "emac-ethtool.h"
+
+/* The moderation timers count in 2us units */
+#define EMAC_MAX_COAL_USECS	(IRQ_MODERATOR_INIT_BMSK << 1)
+
+static u32 emac_get_msglevel(struct net_device *netdev)
+{
+	struct emac_adapter *adpt = netdev_priv(netdev);
+
+	return adpt->msg_enable;
+}
+
+static void emac_set_msglevel(struct net_device *netdev, u32 data)
+{
+	struct emac_adapter *adpt = netdev_priv(netdev);
+
+	adpt->msg_enable = data;
+}
+
+static int emac_get_coalesce(struct net_device *netdev,
+			     struct ethtool_coalesce *ec)
+{
+	struct emac_adapter *adpt = netdev_priv(netdev);
+
+	memset(ec, 0, sizeof(*ec));
+
+	ec->cmd = ETHTOOL_GCOALESCE;
+	ec->rx_coalesce_usecs = adpt->rx_coal_usecs;
+	ec->tx_coalesce_usecs = adpt->tx_coal_usecs;
+	ec->use_adaptive_rx_coalesce = adpt->rx_adaptive;
+	ec->use_adaptive_tx_coalesce = adpt->tx_adaptive;
+
+	return 0;
+}
+
+static int emac_set_coalesce(struct net_device *netdev,
+			     struct ethtool_coalesce *ec)
+{
+	struct emac_adapter *adpt = netdev_priv(netdev);
+
+	/* Only the timers are backed by hardware */
+	if (ec->rx_max_coalesced_frames || ec->tx_max_coalesced_frames ||
+	    ec->rx_coalesce_usecs_irq || ec->tx_coalesce_usecs_irq ||
+	    ec->rx_max_coalesced_frames_irq ||
+	    ec->tx_max_coalesced_frames_irq ||
+	    ec->stats_block_coalesce_usecs || ec->pkt_rate_low ||
+	    ec->pkt_rate_high || ec->rate_sample_interval)
+		return -EOPNOTSUPP;
+
+	if (ec->rx_coalesce_usecs > EMAC_MAX_COAL_USECS ||
+	    ec->tx_coalesce_usecs > EMAC_MAX_COAL_USECS)
+		return -EINVAL;
+
+	if (ec->use_adaptive_rx_coalesce && !adpt->rx_adaptive)
+		emac_dim_init(&adpt->rx_dim);
+	if (ec->use_adaptive_tx_coalesce && !adpt->tx_adaptive)
+		emac_dim_init(&adpt->tx_dim);
+
+	adpt->rx_adaptive = !!ec->use_adaptive_rx_coalesce;
+	adpt->tx_adaptive = !!ec->use_adaptive_tx_coalesce;
+	adpt->rx_coal_usecs = ec->rx_coalesce_usecs;
+	adpt->tx_coal_usecs = ec->tx_coalesce_usecs;
+
+	emac_irq_mod_set(adpt);
+
+	return 0;
+}
+
+static const struct ethtool_ops emac_ethtool_ops = {
+	.get_msglevel	= emac_get_msglevel,
+	.set_msglevel	= emac_set_msglevel,
+	.get_link	= ethtool_op_get_link,
+	.get_coalesce	= emac_get_coalesce,
+	.set_coalesce	= emac_set_coalesce,
+};
+
+void emac_set_ethtool_ops(struct net_device *netdev)
+{
+	netdev->ethtool_ops = &emac_ethtool_ops;
+}
@@ -1015,6 +1015,7 @@ int emac_mac_up(struct emac_adapter *adpt)
 	phy_start(adpt->phydev);
 
 	napi_enable(&adpt->rx_q.napi);
+	napi_enable(&adpt->tx_q.napi);
 	netif_start_queue(netdev);
 
 	return 0;
@@ -1027,6 +1028,7 @@ void emac_mac_down(struct emac_adapter *adpt)
 
 	netif_stop_queue(netdev);
 	napi_disable(&adpt->rx_q.napi);
+	napi_disable(&adpt->tx_q.napi);
 
 	phy_stop(adpt->phydev);
 
@@ -1238,8 +1240,9 @@ static unsigned int emac_tpd_num_free_descs(struct emac_tx_queue *tx_q)
 		(tx_q->tpd.count + consume_idx - produce_idx - 1);
 }
 
-/* Process transmit event */
-void emac_mac_tx_process(struct emac_adapter *adpt, struct emac_tx_queue *tx_q)
+/* Process transmit event, returns the number of packets completed */
+int emac_mac_tx_process(struct emac_adapter *adpt, struct emac_tx_queue *tx_q,
+			int budget)
 {
 	u32 reg = readl_relaxed(adpt->base + tx_q->consume_reg);
 	u32 hw_consume_idx, pkts_compl = 0, bytes_compl = 0;
@@ -1259,7 +1262,7 @@ void emac_mac_tx_process(struct emac_adapter *adpt, struct emac_tx_queue *tx_q)
 		if (tpbuf->skb) {
 			pkts_compl++;
 			bytes_compl += tpbuf->skb->len;
-			dev_kfree_skb_irq(tpbuf->skb);
+			napi_consume_skb(tpbuf->skb, budget);
 			tpbuf->skb = NULL;
 		}
 
@@ -1272,6 +1275,8 @@ void emac_mac_tx_process(struct emac_adapter *adpt, struct emac_tx_queue *tx_q)
 	if (netif_queue_stopped(adpt->netdev))
 		if (emac_tpd_num_free_descs(tx_q) > (MAX_SKB_FRAGS + 1))
 			netif_wake_queue(adpt->netdev);
+
+	return pkts_compl;
 }
 
 /* Initialize all queue data structures */
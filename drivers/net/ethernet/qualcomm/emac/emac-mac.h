@@ -223,6 +223,8 @@ struct emac_tx_queue {
 
 	u8			produce_shift;
 	u8			consume_shift;
+
+	struct napi_struct	napi;
 };
 
 struct emac_adapter;
@@ -237,7 +239,8 @@ void emac_mac_rx_process(struct emac_adapter *adpt, struct emac_rx_queue *rx_q,
 			 int *num_pkts, int max_pkts);
 int emac_mac_tx_buf_send(struct emac_adapter *adpt, struct emac_tx_queue *tx_q,
 			 struct sk_buff *skb);
-void emac_mac_tx_process(struct emac_adapter *adpt, struct emac_tx_queue *tx_q);
+int emac_mac_tx_process(struct emac_adapter *adpt, struct emac_tx_queue *tx_q,
+			int budget);
 void emac_mac_rx_tx_ring_init_all(struct platform_device *pdev,
 				  struct emac_adapter *adpt);
 int  emac_mac_rx_tx_rings_alloc_all(struct emac_adapter *adpt);
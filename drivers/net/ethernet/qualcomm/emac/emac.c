@@ -24,6 +24,7 @@
 #include <linux/platform_device.h>
 #include <linux/acpi.h>
 #include "emac.h"
+#include "emac-ethtool.h"
 #include "emac-mac.h"
 #include "emac-phy.h"
 #include "emac-sgmii.h"
@@ -117,27 +118,147 @@ int emac_reinit_locked(struct emac_adapter *adpt)
 	return ret;
 }
 
+/* Adaptive moderation timer values stepped through, in usecs */
+static const u16 emac_dim_usecs[] = { 8, 16, 32, 64, 128, 250 };
+
+/* NAPI completions that make up one moderation sample */
+#define EMAC_DIM_EVENTS		64
+
+void emac_dim_init(struct emac_dim *dim)
+{
+	memset(dim, 0, sizeof(*dim));
+	dim->profile = ARRAY_SIZE(emac_dim_usecs) - 1;
+}
+
+/* Account one NAPI completion; returns true if the profile moved.
+ *
+ * Every EMAC_DIM_EVENTS completions the packet rate is compared with the
+ * previous sample.  While the rate improves the timer keeps moving in the
+ * same direction, when it drops the direction is reversed, and when it
+ * holds steady the timer stays where it is.  Samples averaging less than
+ * two packets per interrupt mean the link is mostly idle, so the timer
+ * falls back to the lowest setting for latency.
+ */
+static bool emac_dim_update(struct emac_dim *dim, unsigned int pkts)
+{
+	ktime_t now;
+	s64 usecs;
+	u32 rate;
+	int profile;
+
+	dim->pkts += pkts;
+	if (++dim->events < EMAC_DIM_EVENTS)
+		return false;
+
+	now = ktime_get();
+	usecs = ktime_us_delta(now, dim->start);
+	rate = usecs > 0 ? div64_u64(dim->pkts * USEC_PER_MSEC, usecs) : 0;
+
+	profile = dim->profile;
+	if (dim->pkts < 2 * dim->events) {
+		dim->step = 0;
+		profile = 0;
+	} else if (rate > dim->prev_rate + dim->prev_rate / 8) {
+		if (!dim->step)
+			dim->step = 1;
+		profile += dim->step;
+	} else if (rate + rate / 8 < dim->prev_rate) {
+		dim->step = dim->step ? -dim->step : -1;
+		profile += dim->step;
+	} else {
+		dim->step = 0;
+	}
+
+	profile = clamp_t(int, profile, 0, ARRAY_SIZE(emac_dim_usecs) - 1);
+
+	dim->prev_rate = rate;
+	dim->pkts = 0;
+	dim->events = 0;
+	dim->start = now;
+
+	if (profile == dim->profile)
+		return false;
+
+	dim->profile = profile;
+	return true;
+}
+
+/* Program the moderation timers from the current usec settings */
+void emac_irq_mod_set(struct emac_adapter *adpt)
+{
+	adpt->irq_mod =
+		((adpt->rx_coal_usecs >> 1) << IRQ_MODERATOR2_INIT_SHFT) |
+		((adpt->tx_coal_usecs >> 1) << IRQ_MODERATOR_INIT_SHFT);
+
+	if (netif_running(adpt->netdev))
+		writel_relaxed(adpt->irq_mod,
+			       adpt->base + EMAC_IRQ_MOD_TIM_INIT);
+}
+
+static void emac_irq_unmask(struct emac_adapter *adpt, u32 bits)
+{
+	struct emac_irq *irq = &adpt->irq;
+	unsigned long flags;
+
+	spin_lock_irqsave(&irq->lock, flags);
+	irq->mask |= bits;
+	writel(irq->mask, adpt->base + EMAC_INT_MASK);
+	spin_unlock_irqrestore(&irq->lock, flags);
+}
+
 /* NAPI */
 static int emac_napi_rtx(struct napi_struct *napi, int budget)
 {
 	struct emac_rx_queue *rx_q =
 		container_of(napi, struct emac_rx_queue, napi);
 	struct emac_adapter *adpt = netdev_priv(rx_q->netdev);
-	struct emac_irq *irq = rx_q->irq;
 	int work_done = 0;
 
 	emac_mac_rx_process(adpt, rx_q, &work_done, budget);
 
+	if (adpt->rx_adaptive)
+		adpt->rx_dim.pkts += work_done;
+
 	if (work_done < budget) {
 		napi_complete(napi);
 
-		irq->mask |= rx_q->intr;
-		writel(irq->mask, adpt->base + EMAC_INT_MASK);
+		if (adpt->rx_adaptive && emac_dim_update(&adpt->rx_dim, 0)) {
+			adpt->rx_coal_usecs =
+				emac_dim_usecs[adpt->rx_dim.profile];
+			emac_irq_mod_set(adpt);
+		}
+
+		emac_irq_unmask(adpt, rx_q->intr);
 	}
 
 	return work_done;
 }
 
+/* Transmit completions are reaped in their own NAPI context rather than in
+ * the hard irq handler.
+ */
+static int emac_napi_tx(struct napi_struct *napi, int budget)
+{
+	struct emac_tx_queue *tx_q =
+		container_of(napi, struct emac_tx_queue, napi);
+	struct emac_adapter *adpt =
+		container_of(tx_q, struct emac_adapter, tx_q);
+	int pkts;
+
+	pkts = emac_mac_tx_process(adpt, tx_q, budget);
+
+	napi_complete(napi);
+
+	if (adpt->tx_adaptive && emac_dim_update(&adpt->tx_dim, pkts)) {
+		adpt->tx_coal_usecs = emac_dim_usecs[adpt->tx_dim.profile];
+		emac_irq_mod_set(adpt);
+	}
+
+	emac_irq_unmask(adpt, TX_PKT_INT);
+
+	return 0;
+}
+
 /* Transmit the packet */
 static int emac_start_xmit(struct sk_buff *skb, struct net_device *netdev)
 {
@@ -154,6 +275,8 @@ irqreturn_t emac_isr(int _irq, void *data)
 	struct emac_rx_queue *rx_q = &adpt->rx_q;
 	u32 isr, status;
 
+	spin_lock(&irq->lock);
+
 	/* disable the interrupt */
 	writel(0, adpt->base + EMAC_INT_MASK);
 
@@ -181,8 +304,12 @@ irqreturn_t emac_isr(int _irq, void *data)
 		}
 	}
 
-	if (status & TX_PKT_INT)
-		emac_mac_tx_process(adpt, &adpt->tx_q);
+	if (status & TX_PKT_INT) {
+		if (napi_schedule_prep(&adpt->tx_q.napi)) {
+			irq->mask &= ~TX_PKT_INT;
+			__napi_schedule(&adpt->tx_q.napi);
+		}
+	}
 
 	if (status & ISR_OVER)
 		net_warn_ratelimited("warning: TX/RX overflow\n");
@@ -195,6 +322,8 @@ irqreturn_t emac_isr(int _irq, void *data)
 	/* enable the interrupt */
 	writel(irq->mask, adpt->base + EMAC_INT_MASK);
 
+	spin_unlock(&irq->lock);
+
 	return IRQ_HANDLED;
 }
 
@@ -414,8 +543,6 @@ static void emac_work_thread(struct work_struct *work)
 /* Initialize various data structures  */
 static void emac_init_adapter(struct emac_adapter *adpt)
 {
-	u32 reg;
-
 	/* descriptors */
 	adpt->tx_desc_cnt = EMAC_DEF_TX_DESCS;
 	adpt->rx_desc_cnt = EMAC_DEF_RX_DESCS;
@@ -430,9 +557,11 @@ static void emac_init_adapter(struct emac_adapter *adpt)
 	adpt->rfd_burst = RXQ0_NUM_RFD_PREF_DEF;
 
 	/* irq moderator */
-	reg = ((EMAC_DEF_RX_IRQ_MOD >> 1) << IRQ_MODERATOR2_INIT_SHFT) |
-	      ((EMAC_DEF_TX_IRQ_MOD >> 1) << IRQ_MODERATOR_INIT_SHFT);
-	adpt->irq_mod = reg;
+	adpt->rx_coal_usecs = EMAC_DEF_RX_IRQ_MOD;
+	adpt->tx_coal_usecs = EMAC_DEF_TX_IRQ_MOD;
+	emac_dim_init(&adpt->rx_dim);
+	emac_dim_init(&adpt->tx_dim);
+	emac_irq_mod_set(adpt);
 
 	/* others */
 	adpt->preamble = EMAC_PREAMBLE_DEF;
@@ -638,6 +767,7 @@ static int emac_probe(struct platform_device *pdev)
 
 	mutex_init(&adpt->reset_lock);
 	spin_lock_init(&adpt->stats.lock);
+	spin_lock_init(&adpt->irq.lock);
 
 	adpt->irq.mask = RX_PKT_INT0 | IMR_NORMAL_MASK;
 
@@ -660,6 +790,7 @@ static int emac_probe(struct platform_device *pdev)
 	adpt->rfd_size = EMAC_RFD_SIZE;
 
 	netdev->netdev_ops = &emac_netdev_ops;
+	emac_set_ethtool_ops(netdev);
 
 	emac_init_adapter(adpt);
 
@@ -698,6 +829,8 @@ static int emac_probe(struct platform_device *pdev)
 
 	netif_napi_add(netdev, &adpt->rx_q.napi, emac_napi_rtx,
 		       NAPI_POLL_WEIGHT);
+	netif_tx_napi_add(netdev, &adpt->tx_q.napi, emac_napi_tx,
+			  NAPI_POLL_WEIGHT);
 
 	ret = register_netdev(netdev);
 	if (ret) {
@@ -720,6 +853,7 @@ static int emac_probe(struct platform_device *pdev)
 	return 0;
 
 err_undo_napi:
+	netif_napi_del(&adpt->tx_q.napi);
 	netif_napi_del(&adpt->rx_q.napi);
 err_undo_mdiobus:
 	if (!has_acpi_companion(&pdev->dev))
@@ -739,6 +873,7 @@ static int emac_remove(struct platform_device *pdev)
 	struct emac_adapter *adpt = netdev_priv(netdev);
 
 	unregister_netdev(netdev);
+	netif_napi_del(&adpt->tx_q.napi);
 	netif_napi_del(&adpt->rx_q.napi);
 
 	emac_clks_teardown(adpt);
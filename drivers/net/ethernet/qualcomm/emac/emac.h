@@ -280,6 +280,17 @@ struct emac_stats {
 struct emac_irq {
 	unsigned int	irq;
 	u32		mask;
+	spinlock_t	lock;	/* serializes mask updates */
+};
+
+/* Adaptive interrupt moderation state, one per direction */
+struct emac_dim {
+	u64		pkts;		/* packets in the current sample */
+	u16		events;		/* NAPI completions in the sample */
+	ktime_t		start;		/* when the sample began */
+	u32		prev_rate;	/* packets per msec of the last sample */
+	u8		profile;	/* index into the moderation table */
+	s8		step;		/* direction of the last move */
 };
 
 /* The device's main data structure */
@@ -319,6 +330,12 @@ struct emac_adapter {
 	enum emac_dma_order		dma_order;
 
 	u32				irq_mod;
+	u32				rx_coal_usecs;
+	u32				tx_coal_usecs;
+	bool				rx_adaptive;
+	bool				tx_adaptive;
+	struct emac_dim			rx_dim;
+	struct emac_dim			tx_dim;
 	u32				preamble;
 
 	struct work_struct		work_thread;
@@ -331,5 +348,7 @@ struct emac_adapter {
 int emac_reinit_locked(struct emac_adapter *adpt);
 void emac_reg_update32(void __iomem *addr, u32 mask, u32 val);
 irqreturn_t emac_isr(int irq, void *data);
+void emac_irq_mod_set(struct emac_adapter *adpt);
+void emac_dim_init(struct emac_dim *dim);
 
 #endif /* _EMAC_H_ */
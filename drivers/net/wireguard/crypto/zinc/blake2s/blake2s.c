@@ -17,6 +17,8 @@
 #include <linux/module.h>
 #include <linux/init.h>
 #include <linux/bug.h>
+#include <linux/ktime.h>
+#include <linux/slab.h>
 #include <asm/unaligned.h>
 
 static const u32 blake2s_iv[8] = {
@@ -83,6 +85,8 @@ void blake2s_init_key(struct blake2s_state *state, const size_t outlen,
 
 #if defined(CONFIG_ZINC_ARCH_X86_64)
 #include "blake2s-x86_64-glue.c"
+#elif defined(CONFIG_ZINC_ARCH_ARM64)
+#include "blake2s-arm64-glue.c"
 #else
 static bool *const blake2s_nobs[] __initconst = { };
 static void __init blake2s_fpu_init(void)
@@ -254,6 +258,7 @@ static int __init mod_init(void)
 	if (!selftest_run("blake2s", blake2s_selftest, blake2s_nobs,
 			  ARRAY_SIZE(blake2s_nobs)))
 		return -ENOTRECOVERABLE;
+	blake2s_benchmark(blake2s_nobs, ARRAY_SIZE(blake2s_nobs));
 	return 0;
 }
 
@@ -0,0 +1,37 @@
+// SPDX-License-Identifier: GPL-2.0 OR MIT
+/*
+ * Copyright (C) 2015-2019 Jason A. Donenfeld <Jason@zx2c4.com>. All Rights Reserved.
+ */
+
+#include <asm/unaligned.h>
+
+#include "curve25519-arm64.c"
+
+static bool curve25519_use_arm64 __ro_after_init;
+static bool *const curve25519_nobs[] __initconst = { &curve25519_use_arm64 };
+
+static void __init curve25519_fpu_init(void)
+{
+	curve25519_use_arm64 = true;
+}
+
+static inline bool curve25519_arch(u8 mypublic[CURVE25519_KEY_SIZE],
+				   const u8 secret[CURVE25519_KEY_SIZE],
+				   const u8 basepoint[CURVE25519_KEY_SIZE])
+{
+	if (curve25519_use_arm64) {
+		curve25519_arm64(mypublic, secret, basepoint);
+		return true;
+	}
+	return false;
+}
+
+static inline bool curve25519_base_arch(u8 pub[CURVE25519_KEY_SIZE],
+					const u8 secret[CURVE25519_KEY_SIZE])
+{
+	if (curve25519_use_arm64) {
+		curve25519_arm64_base(pub, secret);
+		return true;
+	}
+	return false;
+}
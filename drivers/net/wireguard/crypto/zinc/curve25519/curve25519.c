@@ -17,12 +17,15 @@
 #include <linux/random.h>
 #include <linux/module.h>
 #include <linux/init.h>
+#include <linux/ktime.h>
 #include <crypto/algapi.h> // For crypto_memneq.
 
 #if defined(CONFIG_ZINC_ARCH_X86_64)
 #include "curve25519-x86_64-glue.c"
 #elif defined(CONFIG_ZINC_ARCH_ARM)
 #include "curve25519-arm-glue.c"
+#elif defined(CONFIG_ZINC_ARCH_ARM64)
+#include "curve25519-arm64-glue.c"
 #else
 static bool *const curve25519_nobs[] __initconst = { };
 static void __init curve25519_fpu_init(void)
@@ -92,6 +95,7 @@ static int __init mod_init(void)
 	if (!selftest_run("curve25519", curve25519_selftest, curve25519_nobs,
 			  ARRAY_SIZE(curve25519_nobs)))
 		return -ENOTRECOVERABLE;
+	curve25519_benchmark(curve25519_nobs, ARRAY_SIZE(curve25519_nobs));
 	return 0;
 }
 
@@ -1313,3 +1313,48 @@ static bool __init curve25519_selftest(void)
 
 	return success;
 }
+
+static u64 __init curve25519_bench_run(void)
+{
+	enum { ITERATIONS = 200 };
+	u8 secret[CURVE25519_KEY_SIZE], point[CURVE25519_KEY_SIZE];
+	u64 start, elapsed;
+	int i;
+
+	get_random_bytes(secret, sizeof(secret));
+	curve25519_generate_public(point, secret);
+
+	start = ktime_get_ns();
+	for (i = 0; i < ITERATIONS; ++i)
+		curve25519(point, secret, point);
+	elapsed = ktime_get_ns() - start;
+
+	return div64_u64((u64)ITERATIONS * NSEC_PER_SEC, elapsed ?: 1);
+}
+
+/*
+ * Print how many scalar multiplications per second the generic code and
+ * the usable arch implementations manage, four of which make a handshake.
+ */
+static void __init curve25519_benchmark(bool *const nobs[],
+					unsigned int nobs_len)
+{
+	bool saved[BITS_PER_LONG];
+	unsigned int i;
+
+	if (!IS_ENABLED(CONFIG_ZINC_SELFTEST))
+		return;
+
+	for (i = 0; i < nobs_len; ++i) {
+		saved[i] = *nobs[i];
+		*nobs[i] = false;
+	}
+	pr_info("curve25519 benchmark: %llu ops/s (generic)\n",
+		curve25519_bench_run());
+
+	for (i = 0; i < nobs_len; ++i)
+		*nobs[i] = saved[i];
+	if (nobs_len)
+		pr_info("curve25519 benchmark: %llu ops/s (arch)\n",
+			curve25519_bench_run());
+}
@@ -19,6 +19,8 @@
 #include <linux/if_arp.h>
 #include <linux/icmp.h>
 #include <linux/suspend.h>
+#include <linux/debugfs.h>
+#include <linux/seq_file.h>
 #include <net/dst_metadata.h>
 #include <net/icmp.h>
 #include <net/rtnetlink.h>
@@ -435,6 +437,101 @@ static struct pernet_operations pernet_ops = {
 	.pre_exit = wg_netns_pre_exit
 };
 
+#ifdef CONFIG_DEBUG_FS
+static struct dentry *wg_debugfs_dir;
+
+static void wg_debugfs_show_queue(struct seq_file *m, const char *name,
+				  struct crypt_queue *queue)
+{
+	u64 runs = 0, packets = 0;
+	unsigned int max_batch = 0;
+	struct multicore_worker *worker;
+	int cpu;
+
+	for_each_possible_cpu(cpu) {
+		worker = per_cpu_ptr(queue->worker, cpu);
+		runs += READ_ONCE(worker->runs);
+		packets += READ_ONCE(worker->packets);
+		max_batch = max(max_batch, READ_ONCE(worker->max_batch));
+	}
+	seq_printf(m, "\t%s: size %d runs %llu packets %llu max_batch %u\n",
+		   name, queue->ring.size, runs, packets, max_batch);
+
+	for_each_possible_cpu(cpu) {
+		worker = per_cpu_ptr(queue->worker, cpu);
+		if (READ_ONCE(worker->runs))
+			seq_printf(m, "\t\tcpu%d: runs %llu packets %llu max_batch %u\n",
+				   cpu, READ_ONCE(worker->runs),
+				   READ_ONCE(worker->packets),
+				   READ_ONCE(worker->max_batch));
+	}
+}
+
+static int wg_debugfs_queues_show(struct seq_file *m, void *v)
+{
+	struct wg_device *wg;
+	struct wg_peer *peer;
+
+	seq_printf(m, "crypt_cpus: %*pbl\n", cpumask_pr_args(wg_crypt_cpus()));
+
+	rtnl_lock();
+	list_for_each_entry(wg, &device_list, device_list) {
+		seq_printf(m, "%s:\n", wg->dev->name);
+		wg_debugfs_show_queue(m, "encrypt", &wg->encrypt_queue);
+		wg_debugfs_show_queue(m, "decrypt", &wg->decrypt_queue);
+		wg_debugfs_show_queue(m, "handshake", &wg->handshake_queue);
+		seq_printf(m, "\thandshake_queued: %d\n",
+			   atomic_read(&wg->handshake_queue_len));
+
+		mutex_lock(&wg->device_update_lock);
+		list_for_each_entry(peer, &wg->peer_list, peer_list)
+			seq_printf(m, "\tpeer %llu: staged %u tx %d rx %d\n",
+				   peer->internal_id,
+				   skb_queue_len(&peer->staged_packet_queue),
+				   atomic_read(&peer->tx_queue.count),
+				   atomic_read(&peer->rx_queue.count));
+		mutex_unlock(&wg->device_update_lock);
+	}
+	rtnl_unlock();
+	return 0;
+}
+
+static int wg_debugfs_queues_open(struct inode *inode, struct file *file)
+{
+	return single_open(file, wg_debugfs_queues_show, NULL);
+}
+
+static const struct file_operations wg_debugfs_queues_fops = {
+	.owner = THIS_MODULE,
+	.open = wg_debugfs_queues_open,
+	.read = seq_read,
+	.llseek = seq_lseek,
+	.release = single_release,
+};
+
+static void __init wg_debugfs_init(void)
+{
+	wg_debugfs_dir = debugfs_create_dir("wireguard", NULL);
+	if (IS_ERR_OR_NULL(wg_debugfs_dir))
+		return;
+	debugfs_create_file("queues", 0400, wg_debugfs_dir, NULL,
+			    &wg_debugfs_queues_fops);
+}
+
+static void wg_debugfs_uninit(void)
+{
+	debugfs_remove_recursive(wg_debugfs_dir);
+}
+#else
+static inline void wg_debugfs_init(void)
+{
+}
+
+static inline void wg_debugfs_uninit(void)
+{
+}
+#endif
+
 int __init wg_device_init(void)
 {
 	int ret;
@@ -453,6 +550,7 @@ int __init wg_device_init(void)
 	if (ret)
 		goto error_pernet;
 
+	wg_debugfs_init();
 	return 0;
 
 error_pernet:
@@ -466,6 +564,7 @@ int __init wg_device_init(void)
 
 void wg_device_uninit(void)
 {
+	wg_debugfs_uninit();
 	rtnl_link_unregister(&link_ops);
 	unregister_pernet_device(&pernet_ops);
 #ifdef CONFIG_PM_SLEEP
@@ -23,6 +23,9 @@ struct wg_device;
 struct multicore_worker {
 	void *ptr;
 	struct work_struct work;
+	/* Occupancy seen by this CPU's worker, only ever written by it */
+	u64 runs, packets;
+	unsigned int max_batch;
 };
 
 struct crypt_queue {
@@ -5,6 +5,40 @@
 
 #include "queueing.h"
 #include <linux/skb_array.h>
+#include <linux/moduleparam.h>
+
+struct cpumask wg_crypt_cpumask = CPU_MASK_ALL;
+
+/* Parsed here first so that a bad list leaves the mask alone; the param lock
+ * serialises writers, and early boot parsing cannot allocate.
+ */
+static struct cpumask wg_crypt_cpumask_parsed;
+
+static int wg_crypt_cpus_set(const char *val, const struct kernel_param *kp)
+{
+	int ret = cpulist_parse(val, &wg_crypt_cpumask_parsed);
+
+	if (ret)
+		return ret;
+	if (!cpumask_intersects(&wg_crypt_cpumask_parsed, cpu_possible_mask))
+		return -EINVAL;
+	cpumask_copy(&wg_crypt_cpumask, &wg_crypt_cpumask_parsed);
+	return 0;
+}
+
+static int wg_crypt_cpus_get(char *buffer, const struct kernel_param *kp)
+{
+	return scnprintf(buffer, PAGE_SIZE, "%*pbl\n",
+			 cpumask_pr_args(&wg_crypt_cpumask));
+}
+
+static const struct kernel_param_ops wg_crypt_cpus_ops = {
+	.set = wg_crypt_cpus_set,
+	.get = wg_crypt_cpus_get,
+};
+
+module_param_cb(crypt_cpus, &wg_crypt_cpus_ops, NULL, 0644);
+MODULE_PARM_DESC(crypt_cpus, "CPU list encryption, decryption and handshake work runs on, e.g. 4-7 for the big cores (default: all)");
 
 struct multicore_worker __percpu *
 wg_packet_percpu_multicore_worker_alloc(work_func_t function, void *ptr)
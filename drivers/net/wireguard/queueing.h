@@ -26,6 +26,7 @@ int wg_packet_queue_init(struct crypt_queue *queue, work_func_t function,
 void wg_packet_queue_free(struct crypt_queue *queue, bool purge);
 struct multicore_worker __percpu *
 wg_packet_percpu_multicore_worker_alloc(work_func_t function, void *ptr);
+extern struct cpumask wg_crypt_cpumask;
 
 /* receive.c APIs: */
 void wg_packet_receive(struct wg_device *wg, struct sk_buff *skb);
@@ -107,16 +108,38 @@ static inline void wg_reset_packet(struct sk_buff *skb, bool encapsulating)
 	skb_reset_inner_headers(skb);
 }
 
+/* The CPUs crypt work may run on: the crypt_cpus module parameter, or every
+ * online CPU if none of those is online.
+ */
+static inline const struct cpumask *wg_crypt_cpus(void)
+{
+	if (likely(cpumask_intersects(&wg_crypt_cpumask, cpu_online_mask)))
+		return &wg_crypt_cpumask;
+	return cpu_online_mask;
+}
+
+static inline bool wg_crypt_cpu_usable(int cpu, const struct cpumask *allowed)
+{
+	return cpumask_test_cpu(cpu, cpu_online_mask) &&
+	       cpumask_test_cpu(cpu, allowed);
+}
+
 static inline int wg_cpumask_choose_online(int *stored_cpu, unsigned int id)
 {
-	unsigned int cpu = *stored_cpu, cpu_index, i;
+	const struct cpumask *allowed = wg_crypt_cpus();
+	unsigned int cpu = *stored_cpu, cpu_index, i, weight = 0;
+	int online;
 
 	if (unlikely(cpu == nr_cpumask_bits ||
-		     !cpumask_test_cpu(cpu, cpu_online_mask))) {
-		cpu_index = id % cpumask_weight(cpu_online_mask);
-		cpu = cpumask_first(cpu_online_mask);
+		     !wg_crypt_cpu_usable(cpu, allowed))) {
+		for_each_cpu_and(online, allowed, cpu_online_mask)
+			++weight;
+		cpu_index = id % (weight ?: 1);
+		cpu = cpumask_first_and(allowed, cpu_online_mask);
 		for (i = 0; i < cpu_index; ++i)
-			cpu = cpumask_next(cpu, cpu_online_mask);
+			cpu = cpumask_next_and(cpu, allowed, cpu_online_mask);
+		if (unlikely(cpu >= nr_cpu_ids))
+			cpu = cpumask_first(cpu_online_mask);
 		*stored_cpu = cpu;
 	}
 	return cpu;
@@ -131,11 +154,14 @@ static inline int wg_cpumask_choose_online(int *stored_cpu, unsigned int id)
  */
 static inline int wg_cpumask_next_online(int *next)
 {
+	const struct cpumask *allowed = wg_crypt_cpus();
 	int cpu = *next;
 
-	while (unlikely(!cpumask_test_cpu(cpu, cpu_online_mask)))
-		cpu = cpumask_next(cpu, cpu_online_mask) % nr_cpumask_bits;
-	*next = cpumask_next(cpu, cpu_online_mask) % nr_cpumask_bits;
+	while (unlikely(!wg_crypt_cpu_usable(cpu, allowed))) {
+		cpu = cpumask_next_and(cpu, allowed, cpu_online_mask) % nr_cpumask_bits;
+		allowed = wg_crypt_cpus();
+	}
+	*next = cpumask_next_and(cpu, allowed, cpu_online_mask) % nr_cpumask_bits;
 	return cpu;
 }
 
@@ -210,6 +236,80 @@ static inline void wg_queue_enqueue_per_peer_rx(struct sk_buff *skb, enum packet
 	wg_peer_put(peer);
 }
 
+/* Crypt workers hand packets for the same peer to its serial worker or NAPI
+ * in batches of up to this many, instead of kicking it, and taking a peer
+ * reference, for every packet.
+ */
+#define WG_CRYPT_BATCH 16
+
+struct wg_crypt_batch {
+	struct wg_peer *peer;
+	unsigned int len;
+};
+
+static inline void wg_crypt_batch_flush_tx(struct wg_crypt_batch *batch)
+{
+	struct wg_peer *peer = batch->peer;
+
+	if (!peer)
+		return;
+	queue_work_on(wg_cpumask_choose_online(&peer->serial_work_cpu, peer->internal_id),
+		      peer->device->packet_crypt_wq, &peer->transmit_packet_work);
+	wg_peer_put(peer);
+	batch->peer = NULL;
+	batch->len = 0;
+}
+
+static inline void wg_crypt_batch_flush_rx(struct wg_crypt_batch *batch)
+{
+	struct wg_peer *peer = batch->peer;
+
+	if (!peer)
+		return;
+	napi_schedule(&peer->napi);
+	wg_peer_put(peer);
+	batch->peer = NULL;
+	batch->len = 0;
+}
+
+/* Like wg_queue_enqueue_per_peer_{tx,rx}, but the peer is only kicked when the
+ * batch fills up, moves on to another peer or is flushed. The batch holds the
+ * peer reference, so the skb must not be touched once its state is set.
+ */
+static inline void wg_crypt_batch_add(struct wg_crypt_batch *batch,
+				      struct sk_buff *skb,
+				      enum packet_state state, bool tx)
+{
+	struct wg_peer *peer = PACKET_PEER(skb);
+
+	if (batch->peer != peer) {
+		if (tx)
+			wg_crypt_batch_flush_tx(batch);
+		else
+			wg_crypt_batch_flush_rx(batch);
+		batch->peer = wg_peer_get(peer);
+	}
+	atomic_set_release(&PACKET_CB(skb)->state, state);
+	if (++batch->len >= WG_CRYPT_BATCH) {
+		if (tx)
+			wg_crypt_batch_flush_tx(batch);
+		else
+			wg_crypt_batch_flush_rx(batch);
+	}
+}
+
+static inline void wg_multicore_worker_account(struct work_struct *work,
+					       unsigned int packets)
+{
+	struct multicore_worker *worker =
+		container_of(work, struct multicore_worker, work);
+
+	++worker->runs;
+	worker->packets += packets;
+	if (packets > worker->max_batch)
+		worker->max_batch = packets;
+}
+
 #ifdef DEBUG
 bool wg_packet_counter_selftest(void);
 #endif
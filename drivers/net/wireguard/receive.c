@@ -215,14 +215,17 @@ void wg_packet_handshake_receive_worker(struct work_struct *work)
 {
 	struct crypt_queue *queue = container_of(work, struct multicore_worker, work)->ptr;
 	struct wg_device *wg = container_of(queue, struct wg_device, handshake_queue);
+	unsigned int packets = 0;
 	struct sk_buff *skb;
 
 	while ((skb = ptr_ring_consume_bh(&queue->ring)) != NULL) {
 		wg_receive_handshake_packet(wg, skb);
 		dev_kfree_skb(skb);
 		atomic_dec(&wg->handshake_queue_len);
+		++packets;
 		cond_resched();
 	}
+	wg_multicore_worker_account(work, packets);
 }
 
 static void keep_key_fresh(struct wg_peer *peer)
@@ -506,7 +509,9 @@ void wg_packet_decrypt_worker(struct work_struct *work)
 {
 	struct crypt_queue *queue = container_of(work, struct multicore_worker,
 						 work)->ptr;
+	struct wg_crypt_batch batch = { 0 };
 	simd_context_t simd_context;
+	unsigned int packets = 0;
 	struct sk_buff *skb;
 
 	simd_get(&simd_context);
@@ -515,11 +520,14 @@ void wg_packet_decrypt_worker(struct work_struct *work)
 			likely(decrypt_packet(skb, PACKET_CB(skb)->keypair,
 					      &simd_context)) ?
 				PACKET_STATE_CRYPTED : PACKET_STATE_DEAD;
-		wg_queue_enqueue_per_peer_rx(skb, state);
+		wg_crypt_batch_add(&batch, skb, state, false);
+		++packets;
 		simd_relax(&simd_context);
 	}
 
 	simd_put(&simd_context);
+	wg_crypt_batch_flush_rx(&batch);
+	wg_multicore_worker_account(work, packets);
 }
 
 static void wg_packet_consume_data(struct wg_device *wg, struct sk_buff *skb)
@@ -291,8 +291,10 @@ void wg_packet_encrypt_worker(struct work_struct *work)
 {
 	struct crypt_queue *queue = container_of(work, struct multicore_worker,
 						 work)->ptr;
+	struct wg_crypt_batch batch = { 0 };
 	struct sk_buff *first, *skb, *next;
 	simd_context_t simd_context;
+	unsigned int packets = 0;
 
 	simd_get(&simd_context);
 	while ((first = ptr_ring_consume_bh(&queue->ring)) != NULL) {
@@ -308,11 +310,14 @@ void wg_packet_encrypt_worker(struct work_struct *work)
 				break;
 			}
 		}
-		wg_queue_enqueue_per_peer_tx(first, state);
+		wg_crypt_batch_add(&batch, first, state, true);
+		++packets;
 
 		simd_relax(&simd_context);
 	}
 	simd_put(&simd_context);
+	wg_crypt_batch_flush_tx(&batch);
+	wg_multicore_worker_account(work, packets);
 }
 
 static void wg_packet_create_data(struct wg_peer *peer, struct sk_buff *first)
@@ -140,6 +140,46 @@ static const struct file_operations cnss_stats_fops = {
 	.llseek		= seq_lseek,
 };
 
+static int cnss_pm_stats_show(struct seq_file *s, void *data)
+{
+	struct cnss_plat_data *plat_priv = s->private;
+	struct cnss_pci_data *pci_priv = plat_priv->bus_priv;
+	struct cnss_pci_pm_stats *stats;
+
+	if (!pci_priv)
+		return -ENODEV;
+
+	stats = &pci_priv->pm_stats;
+
+	seq_printf(s, "no_soft_reset: %d\n", pci_priv->no_soft_reset);
+	seq_printf(s, "suspend: %u, last %lld us\n",
+		   stats->suspend_cnt, stats->suspend_us);
+	seq_printf(s, "resume: fast %u, full %u, last %lld us, max %lld us\n",
+		   stats->fast_resume_cnt, stats->full_resume_cnt,
+		   stats->resume_us, stats->max_resume_us);
+	seq_printf(s, "  d0: %lld us\n", stats->d0_us);
+	seq_printf(s, "  config_restore: %lld us\n", stats->restore_us);
+	seq_printf(s, "  mhi_resume: %lld us\n", stats->mhi_resume_us);
+	seq_printf(s, "  driver_resume: %lld us\n", stats->driver_resume_us);
+	seq_printf(s, "link_resume: %u, last %lld us\n",
+		   stats->link_resume_cnt, stats->link_resume_us);
+
+	return 0;
+}
+
+static int cnss_pm_stats_open(struct inode *inode, struct file *file)
+{
+	return single_open(file, cnss_pm_stats_show, inode->i_private);
+}
+
+static const struct file_operations cnss_pm_stats_fops = {
+	.read		= seq_read,
+	.release	= single_release,
+	.open		= cnss_pm_stats_open,
+	.owner		= THIS_MODULE,
+	.llseek		= seq_lseek,
+};
+
 static ssize_t cnss_dev_boot_debug_write(struct file *fp,
 					 const char __user *user_buf,
 					 size_t count, loff_t *off)
@@ -609,6 +649,9 @@ static int cnss_show_quirks_state(struct seq_file *s,
 		case IGNORE_PCI_LINK_FAILURE:
 			seq_puts(s, "IGNORE_PCI_LINK_FAILURE");
 			continue;
+		case DISABLE_FAST_RESUME:
+			seq_puts(s, "DISABLE_FAST_RESUME");
+			continue;
 		}
 
 		seq_printf(s, "UNKNOWN-%d", i);
@@ -695,6 +738,8 @@ int cnss_debugfs_create(struct cnss_plat_data *plat_priv)
 			    &cnss_pin_connect_fops);
 	debugfs_create_file("stats", 0644, root_dentry, plat_priv,
 			    &cnss_stats_fops);
+	debugfs_create_file("pm_stats", 0444, root_dentry, plat_priv,
+			    &cnss_pm_stats_fops);
 
 	cnss_create_debug_only_node(plat_priv);
 
@@ -232,6 +232,7 @@ enum cnss_debug_quirks {
 	FBC_BYPASS,
 	ENABLE_DAEMON_SUPPORT,
 	IGNORE_PCI_LINK_FAILURE,
+	DISABLE_FAST_RESUME,
 };
 
 enum cnss_bdf_type {
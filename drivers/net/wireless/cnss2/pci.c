@@ -348,6 +348,7 @@ static int cnss_set_pci_config_space(struct cnss_pci_data *pci_priv, bool save)
 		(test_bit(CNSS_DRIVER_RECOVERY, &plat_priv->driver_state));
 
 	if (save) {
+		kfree(pci_priv->saved_state);
 		if (link_down_or_recovery) {
 			pci_priv->saved_state = NULL;
 		} else {
@@ -370,6 +371,42 @@ static int cnss_set_pci_config_space(struct cnss_pci_data *pci_priv, bool save)
 	return 0;
 }
 
+/*
+ * A device which reports No_Soft_Reset keeps its configuration space over
+ * a D3hot to D0 transition as long as the link stays up, so the config
+ * space saved at suspend and the BARs mapped at probe are still valid on
+ * resume and the device does not need to be disabled and re-enabled.
+ */
+static bool cnss_pci_can_retain_state(struct cnss_pci_data *pci_priv)
+{
+	struct cnss_plat_data *plat_priv = pci_priv->plat_priv;
+
+	if (!pci_priv->no_soft_reset || !pci_priv->saved_state)
+		return false;
+
+	if (test_bit(DISABLE_FAST_RESUME, &plat_priv->ctrl_params.quirks))
+		return false;
+
+	return true;
+}
+
+static bool cnss_pci_state_retained(struct cnss_pci_data *pci_priv)
+{
+	struct pci_dev *pci_dev = pci_priv->pci_dev;
+	u32 *saved = pci_dev->saved_config_space;
+	u32 val;
+
+	pci_read_config_dword(pci_dev, PCI_COMMAND, &val);
+	if (!(val & PCI_COMMAND_MEMORY))
+		return false;
+
+	pci_read_config_dword(pci_dev, PCI_BASE_ADDRESS_0, &val);
+	if (val != saved[PCI_BASE_ADDRESS_0 / 4])
+		return false;
+
+	return true;
+}
+
 static int cnss_set_pci_link(struct cnss_pci_data *pci_priv, bool link_up)
 {
 	int ret = 0;
@@ -437,6 +474,7 @@ int cnss_suspend_pci_link(struct cnss_pci_data *pci_priv)
 int cnss_resume_pci_link(struct cnss_pci_data *pci_priv)
 {
 	int ret = 0;
+	ktime_t start;
 
 	if (!pci_priv)
 		return -ENODEV;
@@ -447,12 +485,15 @@ int cnss_resume_pci_link(struct cnss_pci_data *pci_priv)
 		goto out;
 	}
 
+	start = ktime_get();
 	ret = cnss_set_pci_link(pci_priv, PCI_LINK_UP);
 	if (ret) {
 		ret = -EAGAIN;
 		goto out;
 	}
 
+	pci_priv->pm_stats.link_resume_us = ktime_us_delta(ktime_get(), start);
+	pci_priv->pm_stats.link_resume_cnt++;
 	pci_priv->pci_link_state = PCI_LINK_UP;
 
 	if (pci_priv->pci_dev->device != QCA6174_DEVICE_ID) {
@@ -1548,6 +1589,7 @@ static int cnss_pci_suspend(struct device *dev)
 	struct cnss_pci_data *pci_priv = cnss_get_pci_priv(pci_dev);
 	struct cnss_wlan_driver *driver_ops;
 	struct cnss_plat_data *plat_priv;
+	ktime_t start;
 
 	pm_message_t state = { .event = PM_EVENT_SUSPEND };
 
@@ -1559,6 +1601,7 @@ static int cnss_pci_suspend(struct device *dev)
 		goto out;
 
 	set_bit(CNSS_IN_SUSPEND_RESUME, &plat_priv->driver_state);
+	start = ktime_get();
 
 	driver_ops = pci_priv->driver_ops;
 	if (driver_ops && driver_ops->suspend) {
@@ -1583,7 +1626,10 @@ static int cnss_pci_suspend(struct device *dev)
 		pci_clear_master(pci_dev);
 		cnss_set_pci_config_space(pci_priv,
 					  SAVE_PCI_CONFIG_SPACE);
-		pci_disable_device(pci_dev);
+
+		pci_priv->state_retained = cnss_pci_can_retain_state(pci_priv);
+		if (!pci_priv->state_retained)
+			pci_disable_device(pci_dev);
 
 		ret = pci_set_power_state(pci_dev, PCI_D3hot);
 		if (ret)
@@ -1593,6 +1639,9 @@ static int cnss_pci_suspend(struct device *dev)
 
 	cnss_pci_set_monitor_wake_intr(pci_priv, false);
 
+	pci_priv->pm_stats.suspend_us = ktime_us_delta(ktime_get(), start);
+	pci_priv->pm_stats.suspend_cnt++;
+
 	return 0;
 
 clear_flag:
@@ -1608,6 +1657,8 @@ static int cnss_pci_resume(struct device *dev)
 	struct cnss_pci_data *pci_priv = cnss_get_pci_priv(pci_dev);
 	struct cnss_plat_data *plat_priv;
 	struct cnss_wlan_driver *driver_ops;
+	struct cnss_pci_pm_stats *stats;
+	ktime_t start, t;
 
 	if (!pci_priv)
 		goto out;
@@ -1619,20 +1670,47 @@ static int cnss_pci_resume(struct device *dev)
 	if (pci_priv->pci_link_down_ind)
 		goto out;
 
+	stats = &pci_priv->pm_stats;
+	start = ktime_get();
+
 	if (pci_priv->pci_link_state == PCI_LINK_UP && !pci_priv->disable_pc) {
-		ret = pci_enable_device(pci_dev);
-		if (ret)
-			cnss_pr_err("Failed to enable PCI device, err = %d\n",
-				    ret);
+		if (pci_priv->state_retained) {
+			/* PCI core has normally moved the device to D0 already */
+			ret = pci_set_power_state(pci_dev, PCI_D0);
+			if (ret)
+				cnss_pr_err("Failed to set D0, err = %d\n", ret);
+		} else {
+			ret = pci_enable_device(pci_dev);
+			if (ret)
+				cnss_pr_err("Failed to enable PCI device, err = %d\n",
+					    ret);
+		}
 
-		if (pci_priv->saved_state)
-			cnss_set_pci_config_space(pci_priv,
-						  RESTORE_PCI_CONFIG_SPACE);
+		t = ktime_get();
+		stats->d0_us = ktime_us_delta(t, start);
+
+		if (pci_priv->state_retained &&
+		    cnss_pci_state_retained(pci_priv)) {
+			stats->fast_resume_cnt++;
+		} else {
+			if (pci_priv->state_retained)
+				cnss_pr_dbg("PCI config space was not retained, restoring\n");
+			if (pci_priv->saved_state)
+				cnss_set_pci_config_space(pci_priv,
+							  RESTORE_PCI_CONFIG_SPACE);
+			stats->full_resume_cnt++;
+		}
+		pci_priv->state_retained = false;
 
 		pci_set_master(pci_dev);
+		stats->restore_us = ktime_us_delta(ktime_get(), t);
+
+		t = ktime_get();
 		cnss_pci_set_mhi_state(pci_priv, CNSS_MHI_RESUME);
+		stats->mhi_resume_us = ktime_us_delta(ktime_get(), t);
 	}
 
+	t = ktime_get();
 	driver_ops = pci_priv->driver_ops;
 	if (driver_ops && driver_ops->resume) {
 		ret = driver_ops->resume(pci_dev);
@@ -1640,6 +1718,11 @@ static int cnss_pci_resume(struct device *dev)
 			cnss_pr_err("Failed to resume host driver, err = %d\n",
 				    ret);
 	}
+	stats->driver_resume_us = ktime_us_delta(ktime_get(), t);
+
+	stats->resume_us = ktime_us_delta(ktime_get(), start);
+	if (stats->resume_us > stats->max_resume_us)
+		stats->max_resume_us = stats->resume_us;
 
 	clear_bit(CNSS_IN_SUSPEND_RESUME, &plat_priv->driver_state);
 
@@ -3390,6 +3473,14 @@ static int cnss_pci_probe(struct pci_dev *pci_dev,
 	pci_save_state(pci_dev);
 	pci_priv->default_state = pci_store_saved_state(pci_dev);
 
+	if (pci_dev->pm_cap) {
+		u16 pmcsr;
+
+		pci_read_config_word(pci_dev, pci_dev->pm_cap + PCI_PM_CTRL,
+				     &pmcsr);
+		pci_priv->no_soft_reset = !!(pmcsr & PCI_PM_CTRL_NO_SOFT_RESET);
+	}
+
 	switch (pci_dev->device) {
 	case QCA6174_DEVICE_ID:
 		pci_read_config_word(pci_dev, QCA6174_REV_ID_OFFSET,
@@ -56,6 +56,21 @@ struct cnss_pci_debug_reg {
 	u32 val;
 };
 
+struct cnss_pci_pm_stats {
+	u32 suspend_cnt;
+	u32 fast_resume_cnt;
+	u32 full_resume_cnt;
+	u32 link_resume_cnt;
+	s64 suspend_us;
+	s64 d0_us;
+	s64 restore_us;
+	s64 mhi_resume_us;
+	s64 driver_resume_us;
+	s64 resume_us;
+	s64 max_resume_us;
+	s64 link_resume_us;
+};
+
 struct cnss_pci_data {
 	struct pci_dev *pci_dev;
 	struct cnss_plat_data *plat_priv;
@@ -67,6 +82,9 @@ struct cnss_pci_data {
 	bool pci_link_down_ind;
 	struct pci_saved_state *saved_state;
 	struct pci_saved_state *default_state;
+	bool no_soft_reset;
+	bool state_retained;
+	struct cnss_pci_pm_stats pm_stats;
 	struct msm_pcie_register_event msm_pci_event;
 	atomic_t auto_suspended;
 	u8 drv_connected_last;
@@ -196,6 +196,11 @@
 #define PCIE_CLEAR				0xDEADBEEF
 #define PCIE_LINK_DOWN				0xFFFFFFFF
 
+/* adaptive L1ss: sampling period, busy threshold and idle periods to re-enter */
+#define L1SS_SAMPLE_MS 100
+#define L1SS_BUSY_EVENTS 32
+#define L1SS_IDLE_PERIODS 3
+
 #define MSM_PCIE_MAX_RESET 5
 #define MSM_PCIE_MAX_PIPE_RESET 1
 
@@ -404,6 +409,8 @@ enum msm_pcie_debugfs_option {
 	MSM_PCIE_DEASSERT_PERST,
 	MSM_PCIE_KEEP_RESOURCES_ON,
 	MSM_PCIE_FORCE_GEN1,
+	MSM_PCIE_DISABLE_L1SS_ADAPTIVE,
+	MSM_PCIE_ENABLE_L1SS_ADAPTIVE,
 	MSM_PCIE_MAX_DEBUGFS_OPTION
 };
 
@@ -439,7 +446,9 @@ static const char * const
 	"ASSERT PERST",
 	"DE-ASSERT PERST",
 	"SET KEEP_RESOURCES_ON FLAG",
-	"FORCE GEN 1 SPEED FOR LINK TRAINING"
+	"FORCE GEN 1 SPEED FOR LINK TRAINING",
+	"DISABLE ADAPTIVE L1SS",
+	"ENABLE ADAPTIVE L1SS"
 };
 
 /* gpio info structure */
@@ -574,6 +583,18 @@ struct msm_pcie_dev_t {
 	bool				l0s_supported;
 	bool				l1_supported;
 	bool				 l1ss_supported;
+	bool				l1ss_adaptive;
+	bool				l1ss_active;
+	struct delayed_work		l1ss_work;
+	atomic_t			l1ss_events;
+	unsigned long			l1ss_busy_until;
+	u32				l1ss_idle_periods;
+	u32				l1ss_exit_latency_us;
+	ulong				l1ss_enable_counter;
+	ulong				l1ss_disable_counter;
+	ulong				l1ss_hint_counter;
+	ulong				l1sub_timeout_counter;
+	struct cpumask			msi_affinity;
 	bool				common_clk_en;
 	bool				clk_power_manage_en;
 	bool				 aux_clk_sync;
@@ -879,6 +900,7 @@ static int msm_pcie_config_l1ss_disable(struct pci_dev *dev, void *pdev);
 static int msm_pcie_config_l1ss_enable(struct pci_dev *dev, void *pdev);
 static void msm_pcie_config_link_pm_rc(struct msm_pcie_dev_t *dev,
 				struct pci_dev *pdev, bool enable);
+static void msm_pcie_l1ss_adaptive_start(struct msm_pcie_dev_t *dev);
 
 #ifdef CONFIG_ARM
 static inline void msm_pcie_fixup_irqs(struct msm_pcie_dev_t *dev)
@@ -1208,6 +1230,8 @@ static void msm_pcie_show_status(struct msm_pcie_dev_t *dev)
 		dev->l1_supported ? "" : "not");
 	PCIE_DBG_FS(dev, "l1ss_supported is %s supported\n",
 		dev->l1ss_supported ? "" : "not");
+	PCIE_DBG_FS(dev, "l1ss_adaptive is %d\n",
+		dev->l1ss_adaptive);
 	PCIE_DBG_FS(dev, "common_clk_en is %d\n",
 		dev->common_clk_en);
 	PCIE_DBG_FS(dev, "clk_power_manage_en is %d\n",
@@ -1480,6 +1504,7 @@ static void msm_pcie_sel_debug_testcase(struct msm_pcie_dev_t *dev,
 					&msm_pcie_config_l1ss_disable, dev);
 		}
 		dev->l1ss_supported = false;
+		dev->l1ss_active = false;
 		break;
 	case MSM_PCIE_ENABLE_L1SS:
 		PCIE_DBG_FS(dev, "\n\nPCIe: RC%d: enable L1ss\n\n",
@@ -1494,6 +1519,7 @@ static void msm_pcie_sel_debug_testcase(struct msm_pcie_dev_t *dev,
 					&msm_pcie_config_l1ss_enable, dev);
 
 			msm_pcie_config_l1ss_enable(dev->dev, dev);
+			dev->l1ss_active = true;
 		}
 		break;
 	case MSM_PCIE_ENUMERATION:
@@ -1947,6 +1973,17 @@ static void msm_pcie_sel_debug_testcase(struct msm_pcie_dev_t *dev,
 			dev->rc_idx);
 		msm_pcie_force_gen1 |= BIT(dev->rc_idx);
 		break;
+	case MSM_PCIE_DISABLE_L1SS_ADAPTIVE:
+		PCIE_DBG_FS(dev, "\n\nPCIe: RC%d: disable adaptive L1ss\n\n",
+			dev->rc_idx);
+		dev->l1ss_adaptive = false;
+		break;
+	case MSM_PCIE_ENABLE_L1SS_ADAPTIVE:
+		PCIE_DBG_FS(dev, "\n\nPCIe: RC%d: enable adaptive L1ss\n\n",
+			dev->rc_idx);
+		dev->l1ss_adaptive = true;
+		msm_pcie_l1ss_adaptive_start(dev);
+		break;
 	default:
 		PCIE_DBG_FS(dev, "Invalid testcase: %d.\n", testcase);
 		break;
@@ -2055,6 +2092,7 @@ static struct dentry *dfile_wr_value;
 static struct dentry *dfile_boot_option;
 static struct dentry *dfile_aer_enable;
 static struct dentry *dfile_corr_counter_limit;
+static struct dentry *dfile_l1ss_stats;
 
 static u32 rc_sel_max;
 
@@ -2372,6 +2410,40 @@ static const struct file_operations msm_pcie_debugfs_corr_counter_limit_ops = {
 	.write = msm_pcie_debugfs_corr_counter_limit,
 };
 
+static int msm_pcie_debugfs_l1ss_stats_show(struct seq_file *m, void *v)
+{
+	int i;
+
+	for (i = 0; i < MAX_RC_NUM; i++) {
+		struct msm_pcie_dev_t *dev = &msm_pcie_dev[i];
+
+		if (!dev->drv_ready)
+			continue;
+
+		seq_printf(m,
+			"RC%d: adaptive:%d active:%d enter:%lu exit:%lu hints:%lu l1sub_timeout:%lu exit_latency_us:%u msi_cpus:%*pbl\n",
+			i, dev->l1ss_adaptive, dev->l1ss_active,
+			dev->l1ss_enable_counter, dev->l1ss_disable_counter,
+			dev->l1ss_hint_counter, dev->l1sub_timeout_counter,
+			dev->l1ss_exit_latency_us,
+			cpumask_pr_args(&dev->msi_affinity));
+	}
+
+	return 0;
+}
+
+static int msm_pcie_debugfs_l1ss_stats_open(struct inode *inode,
+						struct file *file)
+{
+	return single_open(file, msm_pcie_debugfs_l1ss_stats_show, NULL);
+}
+
+static const struct file_operations msm_pcie_debugfs_l1ss_stats_ops = {
+	.open = msm_pcie_debugfs_l1ss_stats_open,
+	.release = single_release,
+	.read = seq_read,
+};
+
 static void msm_pcie_debugfs_init(void)
 {
 	rc_sel_max = (0x1 << MAX_RC_NUM) - 1;
@@ -2462,8 +2534,18 @@ static void msm_pcie_debugfs_init(void)
 		pr_err("PCIe: fail to create the file for debug_fs corr_counter_limit.\n");
 		goto corr_counter_limit_error;
 	}
+
+	dfile_l1ss_stats = debugfs_create_file("l1ss_stats", 0444,
+				dent_msm_pcie, NULL,
+				&msm_pcie_debugfs_l1ss_stats_ops);
+	if (!dfile_l1ss_stats || IS_ERR(dfile_l1ss_stats)) {
+		pr_err("PCIe: fail to create the file for debug_fs l1ss_stats.\n");
+		goto l1ss_stats_error;
+	}
 	return;
 
+l1ss_stats_error:
+	debugfs_remove(dfile_corr_counter_limit);
 corr_counter_limit_error:
 	debugfs_remove(dfile_aer_enable);
 aer_enable_error:
@@ -2498,6 +2580,7 @@ static void msm_pcie_debugfs_exit(void)
 	debugfs_remove(dfile_boot_option);
 	debugfs_remove(dfile_aer_enable);
 	debugfs_remove(dfile_corr_counter_limit);
+	debugfs_remove(dfile_l1ss_stats);
 }
 #else
 static void msm_pcie_debugfs_init(void)
@@ -4016,6 +4099,7 @@ static int msm_pcie_enable(struct msm_pcie_dev_t *dev, u32 options)
 	if (dev->enumerated) {
 		pci_walk_bus(dev->dev->bus, &msm_pcie_config_device, dev);
 		msm_pcie_config_link_pm_rc(dev, dev->dev, true);
+		msm_pcie_l1ss_adaptive_start(dev);
 	}
 
 	goto out;
@@ -4065,6 +4149,9 @@ static void msm_pcie_disable(struct msm_pcie_dev_t *dev, u32 options)
 	dev->power_on = false;
 	dev->link_turned_off_counter++;
 
+	/* the work bails out on a disabled link, no need to wait for it */
+	cancel_delayed_work(&dev->l1ss_work);
+
 	PCIE_INFO(dev, "PCIe: Assert the reset of endpoint of RC%d.\n",
 		dev->rc_idx);
 
@@ -4412,6 +4499,7 @@ int msm_pcie_enumerate(u32 rc_idx)
 			}
 
 			msm_pcie_config_link_pm_rc(dev, dev->dev, true);
+			msm_pcie_l1ss_adaptive_start(dev);
 		} else {
 			PCIE_ERR(dev, "PCIe: failed to enable RC%d.\n",
 				dev->rc_idx);
@@ -4775,6 +4863,7 @@ static irqreturn_t handle_msi_irq(int irq, void *data)
 			writel_relaxed(BIT(j), ctrl_status);
 			/* ensure that interrupt is cleared (acked) */
 			wmb();
+			atomic_inc(&dev->l1ss_events);
 			generic_handle_irq(
 			   irq_find_mapping(dev->irq_domain, (j + (32*i)))
 			   );
@@ -4831,6 +4920,9 @@ static irqreturn_t handle_global_irq(int irq, void *data)
 					dev->rc_idx);
 				handle_aer_irq(irq, data);
 				break;
+			case MSM_PCIE_INT_EVT_L1SUB_TIMEOUT:
+				dev->l1sub_timeout_counter++;
+				break;
 			default:
 				PCIE_DUMP(dev,
 					"PCIe: RC%d: Unexpected event %d is caught!\n",
@@ -5150,6 +5242,8 @@ static int arch_setup_msi_irq_qgic(struct pci_dev *pdev,
 			firstirq = irq;
 
 		irq_set_irq_type(irq, IRQ_TYPE_EDGE_RISING);
+		if (!cpumask_empty(&dev->msi_affinity))
+			irq_set_affinity_hint(irq, &dev->msi_affinity);
 	}
 
 	/* write msi vector and data */
@@ -5265,6 +5359,11 @@ static int32_t msm_pcie_irq_init(struct msm_pcie_dev_t *dev)
 				dev->rc_idx);
 			return rc;
 		}
+
+		/* all default MSIs are demuxed from this line */
+		if (!cpumask_empty(&dev->msi_affinity))
+			irq_set_affinity_hint(dev->irq[MSM_PCIE_INT_MSI].num,
+					&dev->msi_affinity);
 	}
 
 	/* register handler for AER interrupt */
@@ -5475,6 +5574,15 @@ static void msm_pcie_config_l1ss(struct msm_pcie_dev_t *dev,
 	l1ss_ctl1_offset = l1ss_cap_id_offset + PCI_L1SS_CTL1;
 
 	pci_read_config_dword(pdev, l1ss_cap_offset, &val);
+	if (enable) {
+		/* Port T_POWER_ON: value in bits 23:19, 2/10/100us scale in 17:16 */
+		static const u32 t_power_on_scale[] = {2, 10, 100, 0};
+		u32 t_power_on = ((val >> 19) & 0x1f) *
+				t_power_on_scale[(val >> 16) & 0x3];
+
+		dev->l1ss_exit_latency_us = max(dev->l1ss_exit_latency_us,
+						t_power_on);
+	}
 	l1_1_pcipm_support = !!(val & (PCI_L1SS_CAP_PCIPM_L1_1));
 	l1_2_pcipm_support = !!(val & (PCI_L1SS_CAP_PCIPM_L1_2));
 	l1_1_aspm_support = !!(val & (PCI_L1SS_CAP_ASPM_L1_1));
@@ -5539,6 +5647,72 @@ static int msm_pcie_config_l1ss_enable(struct pci_dev *pdev, void *dev)
 	return 0;
 }
 
+static void msm_pcie_l1ss_set(struct msm_pcie_dev_t *dev, bool enable)
+{
+	struct pci_bus *bus, *c_bus;
+	struct list_head *children = &dev->dev->bus->children;
+
+	if (enable) {
+		list_for_each_entry_safe(bus, c_bus, children, node)
+			pci_walk_bus(bus, &msm_pcie_config_l1ss_enable, dev);
+		msm_pcie_config_l1ss_enable(dev->dev, dev);
+		dev->l1ss_enable_counter++;
+	} else {
+		msm_pcie_config_l1ss_disable(dev->dev, dev);
+		list_for_each_entry_safe(bus, c_bus, children, node)
+			pci_walk_bus(bus, &msm_pcie_config_l1ss_disable, dev);
+		dev->l1ss_disable_counter++;
+	}
+
+	dev->l1ss_active = enable;
+}
+
+/*
+ * Keep L1ss off while the link carries bursts of traffic, so that the
+ * endpoint does not pay the L1.2 exit latency on every transfer, and turn
+ * it back on once the link has been quiet for a few sampling periods.
+ * Traffic is counted from the MSIs demuxed here and from client hints.
+ */
+static void msm_pcie_l1ss_work(struct work_struct *work)
+{
+	struct msm_pcie_dev_t *dev = container_of(to_delayed_work(work),
+					struct msm_pcie_dev_t, l1ss_work);
+	u32 events = atomic_xchg(&dev->l1ss_events, 0);
+	bool busy;
+
+	mutex_lock(&dev->setup_lock);
+
+	if (!dev->l1ss_adaptive || !dev->l1ss_supported || !dev->enumerated ||
+		dev->link_status != MSM_PCIE_LINK_ENABLED || dev->suspending)
+		goto out;
+
+	busy = events >= L1SS_BUSY_EVENTS ||
+		time_before(jiffies, dev->l1ss_busy_until);
+	if (busy) {
+		dev->l1ss_idle_periods = 0;
+		if (dev->l1ss_active)
+			msm_pcie_l1ss_set(dev, false);
+	} else if (!dev->l1ss_active &&
+		++dev->l1ss_idle_periods >= L1SS_IDLE_PERIODS) {
+		msm_pcie_l1ss_set(dev, true);
+	}
+
+	schedule_delayed_work(&dev->l1ss_work,
+			msecs_to_jiffies(L1SS_SAMPLE_MS));
+out:
+	mutex_unlock(&dev->setup_lock);
+}
+
+static void msm_pcie_l1ss_adaptive_start(struct msm_pcie_dev_t *dev)
+{
+	dev->l1ss_active = dev->l1ss_supported;
+	dev->l1ss_idle_periods = 0;
+
+	if (dev->l1ss_adaptive && dev->l1ss_supported)
+		mod_delayed_work(system_wq, &dev->l1ss_work,
+				msecs_to_jiffies(L1SS_SAMPLE_MS));
+}
+
 static void msm_pcie_config_clock_power_management(struct msm_pcie_dev_t *dev,
 				struct pci_dev *pdev)
 {
@@ -5690,7 +5864,7 @@ static int msm_pcie_probe(struct platform_device *pdev)
 {
 	int ret = 0;
 	int rc_idx = -1;
-	int i, j;
+	int i, j, msi_cpus;
 
 	PCIE_GEN_DBG("%s\n", __func__);
 
@@ -5782,6 +5956,25 @@ static int msm_pcie_probe(struct platform_device *pdev)
 			msm_pcie_dev[rc_idx].rc_idx,
 			msm_pcie_dev[rc_idx].smmu_sid_base);
 
+	msm_pcie_dev[rc_idx].l1ss_adaptive =
+		of_property_read_bool((&pdev->dev)->of_node,
+				"qcom,l1ss-adaptive");
+	PCIE_DBG(&msm_pcie_dev[rc_idx], "RC%d: adaptive L1ss is %s.\n",
+		rc_idx, msm_pcie_dev[rc_idx].l1ss_adaptive ?
+		"enabled" : "disabled");
+
+	cpumask_clear(&msm_pcie_dev[rc_idx].msi_affinity);
+	msi_cpus = of_property_count_u32_elems((&pdev->dev)->of_node,
+				"qcom,msi-cpus");
+	for (i = 0; i < msi_cpus; i++) {
+		u32 cpu;
+
+		if (!of_property_read_u32_index((&pdev->dev)->of_node,
+				"qcom,msi-cpus", i, &cpu) &&
+			cpu < nr_cpu_ids)
+			cpumask_set_cpu(cpu, &msm_pcie_dev[rc_idx].msi_affinity);
+	}
+
 	msm_pcie_dev[rc_idx].boot_option = 0;
 	ret = of_property_read_u32((&pdev->dev)->of_node, "qcom,boot-option",
 				&msm_pcie_dev[rc_idx].boot_option);
@@ -6248,6 +6441,8 @@ static int __init pcie_init(void)
 		mutex_init(&msm_pcie_dev[i].recovery_lock);
 		spin_lock_init(&msm_pcie_dev[i].wakeup_lock);
 		spin_lock_init(&msm_pcie_dev[i].irq_lock);
+		INIT_DELAYED_WORK(&msm_pcie_dev[i].l1ss_work,
+				msm_pcie_l1ss_work);
 		msm_pcie_dev[i].drv_ready = false;
 	}
 	for (i = 0; i < MAX_RC_NUM * MAX_DEVICE_NUM; i++) {
@@ -6890,3 +7085,31 @@ int msm_pcie_shadow_control(struct pci_dev *dev, bool enable)
 	return ret;
 }
 EXPORT_SYMBOL(msm_pcie_shadow_control);
+
+int msm_pcie_l1ss_hint(struct pci_dev *dev, u32 busy_ms)
+{
+	struct msm_pcie_dev_t *pcie_dev;
+
+	if (!dev) {
+		pr_err("PCIe: the input pci dev is NULL.\n");
+		return -ENODEV;
+	}
+
+	pcie_dev = PCIE_BUS_PRIV_DATA(dev->bus);
+	if (!pcie_dev->l1ss_adaptive || !pcie_dev->l1ss_supported)
+		return -EPERM;
+
+	atomic_inc(&pcie_dev->l1ss_events);
+	if (!busy_ms)
+		return 0;
+
+	pcie_dev->l1ss_hint_counter++;
+	pcie_dev->l1ss_busy_until = jiffies + msecs_to_jiffies(busy_ms);
+
+	/* leave L1ss now rather than at the end of the sampling period */
+	if (pcie_dev->l1ss_active)
+		mod_delayed_work(system_wq, &pcie_dev->l1ss_work, 0);
+
+	return 0;
+}
+EXPORT_SYMBOL(msm_pcie_l1ss_hint);
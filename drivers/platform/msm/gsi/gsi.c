@@ -29,6 +29,21 @@
 #define GSI_RESET_WA_MIN_SLEEP 1000
 #define GSI_RESET_WA_MAX_SLEEP 2000
 #define GSI_CHNL_STATE_MAX_RETRYCNT 10
+
+/*
+ * Adaptive moderation: once per window, pick the packet counter that keeps
+ * the IEOB rate near the target for the measured event rate.
+ */
+#define GSI_MOD_WINDOW_MS 100
+#define GSI_MOD_TARGET_IRQ_RATE 4000
+#define GSI_MOD_MAX_MODC 64
+
+/*
+ * A deferred doorbell is rung anyway once this fraction of the channel
+ * ring is waiting, so a client that never flushes cannot starve HW.
+ */
+#define GSI_MAX_DEFERRED_RE_SHIFT 2
+
 static const struct of_device_id msm_gsi_match[] = {
 	{ .compatible = "qcom,msm_gsi", },
 	{ },
@@ -411,6 +426,66 @@ static void gsi_ring_evt_doorbell(struct gsi_evt_ctx *ctx)
 	gsi_writel(val, gsi_ctx->base +
 			GSI_EE_n_EV_CH_k_DOORBELL_0_OFFS(ctx->id,
 				gsi_ctx->per.ee));
+	ctx->stats.doorbells++;
+}
+
+static void gsi_write_evt_ring_mod(uint8_t evt_id, uint16_t modt,
+		uint8_t modc)
+{
+	uint32_t val;
+
+	val = (((modt << GSI_EE_n_EV_CH_k_CNTXT_8_INT_MODT_SHFT) &
+		GSI_EE_n_EV_CH_k_CNTXT_8_INT_MODT_BMSK) |
+		((modc << GSI_EE_n_EV_CH_k_CNTXT_8_INT_MODC_SHFT) &
+		 GSI_EE_n_EV_CH_k_CNTXT_8_INT_MODC_BMSK));
+	gsi_writel(val, gsi_ctx->base +
+			GSI_EE_n_EV_CH_k_CNTXT_8_OFFS(evt_id, gsi_ctx->per.ee));
+}
+
+/* called whenever CNTXT_8 is (re)programmed from the ring properties */
+static void gsi_init_evt_ring_mod(struct gsi_evt_ctx *ctx)
+{
+	ctx->mod.win_start = jiffies;
+	ctx->mod.win_events = 0;
+	ctx->mod.modc = ctx->props.int_modc;
+}
+
+static void gsi_adapt_evt_ring_mod(struct gsi_evt_ctx *ctx,
+		unsigned long events)
+{
+	unsigned long elapsed;
+	unsigned long rate;
+	unsigned long target;
+
+	if (!ctx->props.adaptive_mod || !ctx->props.int_modt ||
+			!ctx->props.int_modc)
+		return;
+
+	ctx->mod.win_events += events;
+	elapsed = jiffies_to_msecs(jiffies - ctx->mod.win_start);
+	if (elapsed < GSI_MOD_WINDOW_MS)
+		return;
+
+	rate = ctx->mod.win_events * MSEC_PER_SEC / elapsed;
+	target = clamp_t(unsigned long, rate / GSI_MOD_TARGET_IRQ_RATE,
+			ctx->props.int_modc, GSI_MOD_MAX_MODC);
+	/* move half way per window so a single burst does not overshoot */
+	if (target > ctx->mod.modc)
+		target = DIV_ROUND_UP(ctx->mod.modc + target, 2);
+	else
+		target = (ctx->mod.modc + target) / 2;
+
+	ctx->mod.win_start = jiffies;
+	ctx->mod.win_events = 0;
+
+	if (target == ctx->mod.modc)
+		return;
+
+	GSIDBG_LOW("evt_id=%u rate=%lu/s modc %u->%lu\n", ctx->id, rate,
+			ctx->mod.modc, target);
+	ctx->mod.modc = target;
+	gsi_write_evt_ring_mod(ctx->id, ctx->props.int_modt, ctx->mod.modc);
+	ctx->stats.mod_updates++;
 }
 
 static void gsi_ring_chan_doorbell(struct gsi_chan_ctx *ctx)
@@ -441,6 +516,20 @@ static void gsi_ring_chan_doorbell(struct gsi_chan_ctx *ctx)
 	gsi_writel(val, gsi_ctx->base +
 			GSI_EE_n_GSI_CH_k_DOORBELL_0_OFFS(ctx->props.ch_id,
 				gsi_ctx->per.ee));
+	ctx->stats.doorbells++;
+}
+
+/* number of REs written to the ring but not yet announced to HW */
+static uint16_t gsi_chan_pending_re(struct gsi_chan_ctx *ctx)
+{
+	uint64_t bytes;
+
+	if (ctx->ring.wp_local >= ctx->ring.wp)
+		bytes = ctx->ring.wp_local - ctx->ring.wp;
+	else
+		bytes = ctx->ring.len - (ctx->ring.wp - ctx->ring.wp_local);
+
+	return bytes / ctx->ring.elem_sz;
 }
 
 static void gsi_handle_ieob(int ee)
@@ -452,6 +541,7 @@ static void gsi_handle_ieob(int ee)
 	struct gsi_chan_xfer_notify notify;
 	unsigned long flags;
 	unsigned long cntr;
+	unsigned long events;
 	uint32_t msk;
 
 	ch = gsi_readl(gsi_ctx->base +
@@ -478,6 +568,8 @@ static void gsi_handle_ieob(int ee)
 
 			BUG_ON(ctx->props.intf != GSI_EVT_CHTYPE_GPI_EV);
 			spin_lock_irqsave(&ctx->ring.slock, flags);
+			ctx->stats.irqs++;
+			events = 0;
 check_again:
 			cntr = 0;
 			rp = gsi_readl(gsi_ctx->base +
@@ -495,8 +587,10 @@ static void gsi_handle_ieob(int ee)
 				gsi_process_evt_re(ctx, &notify, true);
 			}
 			gsi_ring_evt_doorbell(ctx);
+			events += cntr;
 			if (cntr != 0)
 				goto check_again;
+			gsi_adapt_evt_ring_mod(ctx, events);
 			spin_unlock_irqrestore(&ctx->ring.slock, flags);
 		}
 	}
@@ -1107,12 +1201,7 @@ static void gsi_program_evt_ring_ctx(struct gsi_evt_ring_props *props,
 	gsi_writel(val, gsi_ctx->base +
 			GSI_EE_n_EV_CH_k_CNTXT_3_OFFS(evt_id, ee));
 
-	val = (((props->int_modt << GSI_EE_n_EV_CH_k_CNTXT_8_INT_MODT_SHFT) &
-		GSI_EE_n_EV_CH_k_CNTXT_8_INT_MODT_BMSK) |
-		((props->int_modc << GSI_EE_n_EV_CH_k_CNTXT_8_INT_MODC_SHFT) &
-		 GSI_EE_n_EV_CH_k_CNTXT_8_INT_MODC_BMSK));
-	gsi_writel(val, gsi_ctx->base +
-			GSI_EE_n_EV_CH_k_CNTXT_8_OFFS(evt_id, ee));
+	gsi_write_evt_ring_mod(evt_id, props->int_modt, props->int_modc);
 
 	val = (props->intvec & GSI_EE_n_EV_CH_k_CNTXT_9_INTVEC_BMSK) <<
 		GSI_EE_n_EV_CH_k_CNTXT_9_INTVEC_SHFT;
@@ -1303,6 +1392,7 @@ int gsi_alloc_evt_ring(struct gsi_evt_ring_props *props, unsigned long dev_hdl,
 
 	spin_lock_init(&ctx->ring.slock);
 	gsi_init_evt_ring(props, &ctx->ring);
+	gsi_init_evt_ring_mod(ctx);
 
 	ctx->id = evt_id;
 	*evt_ring_hdl = evt_id;
@@ -1548,6 +1638,7 @@ int gsi_reset_evt_ring(unsigned long evt_ring_hdl)
 
 	gsi_program_evt_ring_ctx(&ctx->props, evt_ring_hdl, gsi_ctx->per.ee);
 	gsi_init_evt_ring(&ctx->props, &ctx->ring);
+	gsi_init_evt_ring_mod(ctx);
 
 	/* restore scratch */
 	__gsi_write_evt_ring_scratch(evt_ring_hdl, ctx->scratch);
@@ -2658,12 +2749,21 @@ int gsi_queue_xfer(unsigned long chan_hdl, uint16_t num_xfers,
 	}
 
 	ctx->stats.queued += num_xfers;
+	ctx->stats.queue_calls++;
+
+	if (!ring_db && gsi_chan_pending_re(ctx) >=
+			(ctx->ring.max_num_elem >> GSI_MAX_DEFERRED_RE_SHIFT)) {
+		ring_db = true;
+		ctx->stats.db_forced++;
+	}
 
 	/* ensure TRE is set before ringing doorbell */
 	wmb();
 
 	if (ring_db)
 		gsi_ring_chan_doorbell(ctx);
+	else
+		ctx->stats.db_deferred++;
 
 	spin_unlock_irqrestore(slock, flags);
 
@@ -2674,6 +2774,8 @@ EXPORT_SYMBOL(gsi_queue_xfer);
 int gsi_start_xfer(unsigned long chan_hdl)
 {
 	struct gsi_chan_ctx *ctx;
+	spinlock_t *slock;
+	unsigned long flags;
 
 	if (!gsi_ctx) {
 		pr_err("%s:%d gsi context not allocated\n", __func__, __LINE__);
@@ -2697,10 +2799,16 @@ int gsi_start_xfer(unsigned long chan_hdl)
 		return -GSI_STATUS_UNSUPPORTED_OP;
 	}
 
-	if (ctx->ring.wp == ctx->ring.wp_local)
-		return GSI_STATUS_SUCCESS;
+	if (ctx->evtr)
+		slock = &ctx->evtr->ring.slock;
+	else
+		slock = &ctx->ring.slock;
 
-	gsi_ring_chan_doorbell(ctx);
+	/* serialize against gsi_queue_xfer() moving wp_local */
+	spin_lock_irqsave(slock, flags);
+	if (ctx->ring.wp != ctx->ring.wp_local)
+		gsi_ring_chan_doorbell(ctx);
+	spin_unlock_irqrestore(slock, flags);
 
 	return GSI_STATUS_SUCCESS;
 };
@@ -2761,6 +2869,73 @@ int gsi_poll_channel(unsigned long chan_hdl,
 }
 EXPORT_SYMBOL(gsi_poll_channel);
 
+int gsi_poll_n_channel(unsigned long chan_hdl,
+		struct gsi_chan_xfer_notify *notify,
+		int expected_num, int *actual_num)
+{
+	struct gsi_chan_ctx *ctx;
+	uint64_t rp;
+	int ee;
+	int i;
+	unsigned long flags;
+
+	if (!gsi_ctx) {
+		pr_err("%s:%d gsi context not allocated\n", __func__, __LINE__);
+		return -GSI_STATUS_NODEV;
+	}
+	ee = gsi_ctx->per.ee;
+
+	if (chan_hdl >= gsi_ctx->max_ch || !notify ||
+			expected_num <= 0 || !actual_num) {
+		GSIERR("bad params chan_hdl=%lu notify=%p num=%d\n",
+			chan_hdl, notify, expected_num);
+		return -GSI_STATUS_INVALID_PARAMS;
+	}
+
+	ctx = &gsi_ctx->chan[chan_hdl];
+
+	if (ctx->props.prot != GSI_CHAN_PROT_GPI) {
+		GSIERR("op not supported for protocol %u\n", ctx->props.prot);
+		return -GSI_STATUS_UNSUPPORTED_OP;
+	}
+
+	if (!ctx->evtr) {
+		GSIERR("no event ring associated chan_hdl=%lu\n", chan_hdl);
+		return -GSI_STATUS_UNSUPPORTED_OP;
+	}
+
+	spin_lock_irqsave(&ctx->evtr->ring.slock, flags);
+	if (ctx->evtr->ring.rp == ctx->evtr->ring.rp_local) {
+		/* update rp to see if we have anything new to process */
+		rp = gsi_readl(gsi_ctx->base +
+			GSI_EE_n_EV_CH_k_CNTXT_4_OFFS(ctx->evtr->id, ee));
+		rp |= ctx->evtr->ring.rp & 0xFFFFFFFF00000000;
+
+		ctx->evtr->ring.rp = rp;
+	}
+
+	for (i = 0; i < expected_num; i++) {
+		if (ctx->evtr->ring.rp == ctx->evtr->ring.rp_local)
+			break;
+		gsi_process_evt_re(ctx->evtr, &notify[i], false);
+	}
+
+	/* hand the whole batch of elements back to HW at once */
+	if (i)
+		gsi_ring_evt_doorbell(ctx->evtr);
+	spin_unlock_irqrestore(&ctx->evtr->ring.slock, flags);
+
+	*actual_num = i;
+	if (!i) {
+		ctx->stats.poll_empty++;
+		return GSI_STATUS_POLL_EMPTY;
+	}
+	ctx->stats.poll_ok++;
+
+	return GSI_STATUS_SUCCESS;
+}
+EXPORT_SYMBOL(gsi_poll_n_channel);
+
 int gsi_config_channel_mode(unsigned long chan_hdl, enum gsi_chan_mode mode)
 {
 	struct gsi_chan_ctx *ctx;
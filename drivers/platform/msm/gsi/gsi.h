@@ -123,6 +123,10 @@ struct gsi_chan_stats {
 	unsigned long invalid_tre_error;
 	unsigned long poll_ok;
 	unsigned long poll_empty;
+	unsigned long queue_calls;
+	unsigned long doorbells;
+	unsigned long db_deferred;
+	unsigned long db_forced;
 	struct gsi_chan_dp_stats dp;
 };
 
@@ -145,6 +149,19 @@ struct gsi_chan_ctx {
 
 struct gsi_evt_stats {
 	unsigned long completed;
+	unsigned long irqs;
+	unsigned long doorbells;
+	unsigned long mod_updates;
+};
+
+/*
+ * Adaptive interrupt moderation state, sampled from the IEOB handler
+ * under ring.slock.
+ */
+struct gsi_evt_mod_ctx {
+	unsigned long win_start;
+	unsigned long win_events;
+	uint8_t modc;
 };
 
 struct gsi_evt_ctx {
@@ -157,6 +174,7 @@ struct gsi_evt_ctx {
 	struct gsi_chan_ctx *chan;
 	atomic_t chan_ref_cnt;
 	union __packed gsi_evt_scratch scratch;
+	struct gsi_evt_mod_ctx mod;
 	struct gsi_evt_stats stats;
 };
 
@@ -277,9 +277,20 @@ static void gsi_dump_ch_stats(struct gsi_chan_ctx *ctx)
 		ctx->stats.invalid_tre_error);
 	PRT_STAT("poll_ok=%lu poll_empty=%lu\n",
 		ctx->stats.poll_ok, ctx->stats.poll_empty);
-	if (ctx->evtr)
+	PRT_STAT("db=%lu db_deferred=%lu db_forced=%lu\n",
+		ctx->stats.doorbells, ctx->stats.db_deferred,
+		ctx->stats.db_forced);
+	if (ctx->stats.queue_calls)
+		PRT_STAT("db_per_100_queue=%lu\n",
+			ctx->stats.doorbells * 100 / ctx->stats.queue_calls);
+	if (ctx->evtr) {
 		PRT_STAT("compl_evt=%lu\n",
 			ctx->evtr->stats.completed);
+		PRT_STAT("evt_irqs=%lu evt_db=%lu\n",
+			ctx->evtr->stats.irqs, ctx->evtr->stats.doorbells);
+		PRT_STAT("modc=%u mod_updates=%lu\n",
+			ctx->evtr->mod.modc, ctx->evtr->stats.mod_updates);
+	}
 
 	PRT_STAT("ch_below_lo=%lu\n", ctx->stats.dp.ch_below_lo);
 	PRT_STAT("ch_below_hi=%lu\n", ctx->stats.dp.ch_below_hi);
@@ -18,6 +18,7 @@
 #include "ipahal_fltrt.h"
 #include "ipahal_fltrt_i.h"
 #include "ipahal_i.h"
+#include "ipahal_reg.h"
 #include "../../ipa_common_i.h"
 
 #define IPA_MAC_FLT_BITS (IPA_FLT_MAC_DST_ADDR_ETHER_II | \
@@ -3776,3 +3777,140 @@ int ipahal_flt_parse_hw_rule(u8 *rule_addr,
 		rule_addr, rule);
 }
 
+/* Attributes a cached hash lookup result stays correct for */
+#define IPA_FLTRT_HASH_PROTOCOL_BITS (IPA_FLT_PROTOCOL | IPA_FLT_NEXT_HDR)
+#define IPA_FLTRT_HASH_SRC_PORT_BITS (IPA_FLT_SRC_PORT | IPA_FLT_SRC_PORT_RANGE)
+#define IPA_FLTRT_HASH_DST_PORT_BITS (IPA_FLT_DST_PORT | IPA_FLT_DST_PORT_RANGE)
+
+/*
+ * ipahal_fltrt_rule_hashable() - Can the rule be placed in a hashable table
+ *  IPA caches hashable rule hits by the hash tuple of the packet, so a rule
+ *  may only be hashed if everything it matches on is part of the tuple.
+ * @attrib: Rule attributes
+ * @tuple: Hash tuple configured for the flt or rt tables of the pipe
+ */
+bool ipahal_fltrt_rule_hashable(const struct ipa_rule_attrib *attrib,
+	const struct ipahal_reg_hash_tuple *tuple)
+{
+	u32 covered = 0;
+
+	if (!attrib || !tuple) {
+		IPAHAL_ERR("Input err: attrib=%p tuple=%p\n", attrib, tuple);
+		return false;
+	}
+
+	if (!ipahal_fltrt_objs[ipahal_ctx->hw_type].support_hash)
+		return false;
+
+	if (tuple->protocol)
+		covered |= IPA_FLTRT_HASH_PROTOCOL_BITS;
+	if (tuple->src_ip_addr)
+		covered |= IPA_FLT_SRC_ADDR;
+	if (tuple->dst_ip_addr)
+		covered |= IPA_FLT_DST_ADDR;
+	if (tuple->src_port)
+		covered |= IPA_FLTRT_HASH_SRC_PORT_BITS;
+	if (tuple->dst_port)
+		covered |= IPA_FLTRT_HASH_DST_PORT_BITS;
+	if (tuple->meta_data)
+		covered |= IPA_FLT_META_DATA;
+
+	return !(attrib->attrib_mask & ~covered);
+}
+
+/*
+ * ipahal_fltrt_tbl_next_dirty() - Find the next changed range of a tbl body
+ *  Compares a newly generated table body against the image currently in
+ *  SRAM so that only the rule blocks that changed need to be written.
+ *  Ranges are rounded out to the rules block size alignment.
+ * @old_bdy: Body image the H/W currently has
+ * @new_bdy: Newly generated body image
+ * @size: Size of both images
+ * @ofst: IN: offset to start looking from. OUT: start of the changed range
+ * @len: OUT: length of the changed range, 0 if nothing changed after @ofst
+ */
+int ipahal_fltrt_tbl_next_dirty(const u8 *old_bdy, const u8 *new_bdy,
+	u32 size, u32 *ofst, u32 *len)
+{
+	u32 blk, start, end;
+
+	if (!old_bdy || !new_bdy || !ofst || !len) {
+		IPAHAL_ERR("Input err: old=%p new=%p ofst=%p len=%p\n",
+			old_bdy, new_bdy, ofst, len);
+		return -EINVAL;
+	}
+
+	if (*ofst >= size) {
+		*len = 0;
+		return 0;
+	}
+
+	blk = ipahal_fltrt_objs[ipahal_ctx->hw_type].blk_sz_alignment + 1;
+	start = round_down(*ofst, blk);
+
+	while (start < size) {
+		end = min(start + blk, size);
+		if (memcmp(old_bdy + start, new_bdy + start, end - start))
+			break;
+		start = end;
+	}
+
+	end = start;
+	while (end < size) {
+		blk = min(blk, size - end);
+		if (!memcmp(old_bdy + end, new_bdy + end, blk))
+			break;
+		end += blk;
+	}
+
+	*ofst = start;
+	*len = end - start;
+	return 0;
+}
+
+/*
+ * ipahal_fltrt_tbl_depth() - Count the rules the H/W walks in a tbl body
+ *  The lookup depth is what a packet missing every rule of the table costs,
+ *  and is what grows when rules that could be hashed are not.
+ * @is_flt: Filter table body, otherwise routing
+ * @bdy: Table body, starting at its first rule
+ * @size: Size of the body, for bounds checking
+ * @depth: OUT: number of rules before the terminator
+ */
+int ipahal_fltrt_tbl_depth(bool is_flt, u8 *bdy, u32 size, u32 *depth)
+{
+	union {
+		struct ipahal_flt_rule_entry flt;
+		struct ipahal_rt_rule_entry rt;
+	} rule;
+	u32 rule_size, ofst = 0;
+	int res;
+
+	if (!bdy || !depth) {
+		IPAHAL_ERR("Input err: bdy=%p depth=%p\n", bdy, depth);
+		return -EINVAL;
+	}
+
+	*depth = 0;
+	while (ofst < size) {
+		if (is_flt) {
+			res = ipahal_flt_parse_hw_rule(bdy + ofst, &rule.flt);
+			rule_size = rule.flt.rule_size;
+		} else {
+			res = ipahal_rt_parse_hw_rule(bdy + ofst, &rule.rt);
+			rule_size = rule.rt.rule_size;
+		}
+		if (res) {
+			IPAHAL_ERR("fail to parse rule at ofst %u\n", ofst);
+			return res;
+		}
+		/* table terminator */
+		if (!rule_size)
+			return 0;
+		(*depth)++;
+		ofst += rule_size;
+	}
+
+	IPAHAL_ERR("tbl body of size %u has no terminator\n", size);
+	return -EFAULT;
+}
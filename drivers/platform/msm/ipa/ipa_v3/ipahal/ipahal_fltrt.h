@@ -13,6 +13,8 @@
 #ifndef _IPAHAL_FLTRT_H_
 #define _IPAHAL_FLTRT_H_
 
+struct ipahal_reg_hash_tuple;
+
 /*
  * struct ipahal_fltrt_alloc_imgs_params - Params for tbls imgs allocations
  *  The allocation logic will allocate DMA memory representing the header.
@@ -287,5 +289,37 @@ int ipahal_rt_parse_hw_rule(u8 *rule_addr,
 int ipahal_flt_parse_hw_rule(u8 *rule_addr,
 	struct ipahal_flt_rule_entry *rule);
 
+/*
+ * ipahal_fltrt_rule_hashable() - Can the rule be placed in a hashable table
+ *  True if every attribute the rule matches on is part of the hash tuple,
+ *  so a cached hit for the tuple is valid for the rule.
+ * @attrib: Rule attributes
+ * @tuple: Hash tuple configured for the flt or rt tables of the pipe
+ */
+bool ipahal_fltrt_rule_hashable(const struct ipa_rule_attrib *attrib,
+	const struct ipahal_reg_hash_tuple *tuple);
+
+/*
+ * ipahal_fltrt_tbl_next_dirty() - Find the next changed range of a tbl body
+ *  Lets commit write only the SRAM blocks whose rules changed. Call with
+ *  @ofst at 0 and then at the end of each returned range until @len is 0.
+ * @old_bdy: Body image the H/W currently has
+ * @new_bdy: Newly generated body image
+ * @size: Size of both images
+ * @ofst: IN: offset to start looking from. OUT: start of the changed range
+ * @len: OUT: length of the changed range, 0 if nothing changed after @ofst
+ */
+int ipahal_fltrt_tbl_next_dirty(const u8 *old_bdy, const u8 *new_bdy,
+	u32 size, u32 *ofst, u32 *len);
+
+/*
+ * ipahal_fltrt_tbl_depth() - Count the rules the H/W walks in a tbl body
+ * @is_flt: Filter table body, otherwise routing
+ * @bdy: Table body, starting at its first rule
+ * @size: Size of the body, for bounds checking
+ * @depth: OUT: number of rules before the terminator
+ */
+int ipahal_fltrt_tbl_depth(bool is_flt, u8 *bdy, u32 size, u32 *depth);
+
 
 #endif /* _IPAHAL_FLTRT_H_ */
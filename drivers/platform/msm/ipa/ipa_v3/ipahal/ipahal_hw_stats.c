@@ -10,10 +10,16 @@
  * GNU General Public License for more details.
  */
 
+#include <linux/ktime.h>
+#include <linux/mm.h>
+#include <linux/vmalloc.h>
 #include "ipahal_hw_stats.h"
 #include "ipahal_hw_stats_i.h"
 #include "ipahal_i.h"
 
+/* Idle periods stretch the sampling period up to this factor */
+#define IPAHAL_STATS_SAMPLER_MAX_BACKOFF 8
+
 struct ipahal_hw_stats_obj {
 	struct ipahal_stats_init_pyld *(*generate_init_pyld)(void *params,
 		bool is_atomic_ctx);
@@ -555,3 +561,234 @@ int ipahal_parse_stats(enum ipahal_hw_stats_type type, void *init_params,
 	return ipahal_hw_stats_objs[ipahal_ctx->hw_type][type].parse_stats(
 		init_params, raw_stats, parsed_stats);
 }
+
+static int ipahal_stats_sampler_read(struct ipahal_stats_sampler *s,
+	enum ipahal_hw_stats_type type, void *init_params, void *parsed)
+{
+	struct ipahal_stats_get_offset_quota quota_get;
+	struct ipahal_stats_get_offset_drop drop_get;
+	struct ipahal_stats_offset ofst;
+	int res;
+
+	if (type == IPAHAL_HW_STATS_QUOTA) {
+		quota_get.init = s->quota_init;
+		res = ipahal_stats_get_offset(type, &quota_get, &ofst);
+	} else {
+		drop_get.init = s->drop_init;
+		res = ipahal_stats_get_offset(type, &drop_get, &ofst);
+	}
+	if (res)
+		return res;
+
+	if (ofst.size) {
+		res = s->read(type, ofst.offset, ofst.size, s->raw, s->priv);
+		if (res)
+			return res;
+	}
+
+	return ipahal_parse_stats(type, init_params, s->raw, parsed);
+}
+
+/* The IPA driver clears the counters on its own reads; count from zero */
+static inline u64 ipahal_stats_delta(u64 cur, u64 prev)
+{
+	return cur >= prev ? cur - prev : cur;
+}
+
+static bool ipahal_stats_sampler_fill(struct ipahal_stats_sampler *s,
+	struct ipa_hw_stats_ring_sample *sample)
+{
+	struct ipa_hw_stats_ring_pipe *pipe;
+	struct ipahal_stats_quota *qc, *qp;
+	struct ipahal_stats_drop *dc, *dp;
+	bool traffic = false;
+	int i;
+
+	for (i = 0; i < IPAHAL_MAX_PIPES; i++) {
+		qc = &s->quota_cur.stats[i];
+		qp = &s->quota_prev.stats[i];
+		dc = &s->drop_cur.stats[i];
+		dp = &s->drop_prev.stats[i];
+		pipe = &sample->pipe[i];
+
+		pipe->ipv4_bytes = ipahal_stats_delta(qc->num_ipv4_bytes,
+			qp->num_ipv4_bytes);
+		pipe->ipv6_bytes = ipahal_stats_delta(qc->num_ipv6_bytes,
+			qp->num_ipv6_bytes);
+		pipe->ipv4_pkts = ipahal_stats_delta(qc->num_ipv4_pkts,
+			qp->num_ipv4_pkts);
+		pipe->ipv6_pkts = ipahal_stats_delta(qc->num_ipv6_pkts,
+			qp->num_ipv6_pkts);
+		pipe->drop_pkts = ipahal_stats_delta(dc->drop_packet_cnt,
+			dp->drop_packet_cnt);
+		pipe->drop_bytes = ipahal_stats_delta(dc->drop_byte_cnt,
+			dp->drop_byte_cnt);
+
+		if (pipe->ipv4_pkts || pipe->ipv6_pkts || pipe->drop_pkts)
+			traffic = true;
+	}
+
+	return traffic;
+}
+
+/*
+ * Take one sample. The ring has a single writer, so a slot is published by
+ * invalidating its seq, filling it and then setting seq and head.
+ */
+static void ipahal_stats_sampler_work(struct work_struct *work)
+{
+	struct ipahal_stats_sampler *s = container_of(to_delayed_work(work),
+		struct ipahal_stats_sampler, work);
+	struct ipa_hw_stats_ring_hdr *ring = s->ring;
+	struct ipa_hw_stats_ring_sample *sample, *tmp = &s->sample;
+	u64 now, seq;
+
+	now = ktime_get_ns();
+
+	if (s->quota_init.enabled_bitmask &&
+		ipahal_stats_sampler_read(s, IPAHAL_HW_STATS_QUOTA,
+			&s->quota_init, &s->quota_cur))
+		goto resched;
+	if (s->drop_init.enabled_bitmask &&
+		ipahal_stats_sampler_read(s, IPAHAL_HW_STATS_DROP,
+			&s->drop_init, &s->drop_cur))
+		goto resched;
+
+	if (!s->primed) {
+		s->primed = true;
+		goto done;
+	}
+
+	seq = ring->head;
+	sample = (void *)ring + ring->data_offset +
+		(seq % ring->nr_slots) * ring->slot_size;
+
+	if (!ipahal_stats_sampler_fill(s, tmp)) {
+		WRITE_ONCE(ring->idle_periods, ring->idle_periods + 1);
+		s->backoff = min_t(unsigned int, s->backoff * 2,
+			IPAHAL_STATS_SAMPLER_MAX_BACKOFF);
+		goto done;
+	}
+	s->backoff = 1;
+
+	tmp->seq = seq;
+	tmp->timestamp_ns = now;
+	tmp->period_ns = now - s->last_ns;
+	tmp->pipe_mask = s->quota_init.enabled_bitmask |
+		s->drop_init.enabled_bitmask;
+	tmp->reserved = 0;
+
+	WRITE_ONCE(sample->seq, ~0ULL);
+	smp_wmb();
+	memcpy(&sample->timestamp_ns, &tmp->timestamp_ns,
+		sizeof(*tmp) - offsetof(struct ipa_hw_stats_ring_sample,
+			timestamp_ns));
+	smp_wmb();
+	WRITE_ONCE(sample->seq, seq);
+	smp_wmb();
+	WRITE_ONCE(ring->head, seq + 1);
+
+done:
+	s->last_ns = now;
+	s->quota_prev = s->quota_cur;
+	s->drop_prev = s->drop_cur;
+resched:
+	if (READ_ONCE(s->period_ms))
+		queue_delayed_work(system_power_efficient_wq, &s->work,
+			msecs_to_jiffies(s->period_ms * s->backoff));
+}
+
+int ipahal_stats_sampler_init(struct ipahal_stats_sampler *s,
+	const struct ipahal_stats_init_quota *quota_init,
+	const struct ipahal_stats_init_drop *drop_init,
+	u32 nr_slots, ipahal_stats_read_cb read, void *priv)
+{
+	size_t raw_size;
+	u32 data_offset;
+
+	if (!s || !quota_init || !drop_init || !read || !nr_slots) {
+		IPAHAL_ERR("Null arg\n");
+		WARN_ON(1);
+		return -EFAULT;
+	}
+
+	memset(s, 0, sizeof(*s));
+	s->read = read;
+	s->priv = priv;
+	s->backoff = 1;
+	s->quota_init = *quota_init;
+	s->drop_init = *drop_init;
+	INIT_DEFERRABLE_WORK(&s->work, ipahal_stats_sampler_work);
+
+	raw_size = IPAHAL_MAX_PIPES * max(sizeof(struct ipahal_stats_quota_hw),
+		sizeof(struct ipahal_stats_drop_hw));
+	s->raw = kzalloc(raw_size, GFP_KERNEL);
+	if (!s->raw)
+		return -ENOMEM;
+
+	data_offset = ALIGN(sizeof(*s->ring), L1_CACHE_BYTES);
+	s->ring_size = PAGE_ALIGN(data_offset +
+		(size_t)nr_slots * sizeof(struct ipa_hw_stats_ring_sample));
+	s->ring = vmalloc_user(s->ring_size);
+	if (!s->ring) {
+		IPAHAL_ERR("fail to alloc stats ring of size %zu\n",
+			s->ring_size);
+		kfree(s->raw);
+		s->raw = NULL;
+		return -ENOMEM;
+	}
+
+	s->ring->version = IPA_HW_STATS_RING_VERSION;
+	s->ring->nr_slots = nr_slots;
+	s->ring->slot_size = sizeof(struct ipa_hw_stats_ring_sample);
+	s->ring->data_offset = data_offset;
+
+	return 0;
+}
+
+void ipahal_stats_sampler_start(struct ipahal_stats_sampler *s,
+	unsigned int period_ms)
+{
+	if (!s || !s->ring || !period_ms)
+		return;
+
+	cancel_delayed_work_sync(&s->work);
+	s->period_ms = period_ms;
+	s->backoff = 1;
+	s->primed = false;
+	queue_delayed_work(system_power_efficient_wq, &s->work, 0);
+}
+
+void ipahal_stats_sampler_stop(struct ipahal_stats_sampler *s)
+{
+	if (!s)
+		return;
+
+	WRITE_ONCE(s->period_ms, 0);
+	cancel_delayed_work_sync(&s->work);
+}
+
+void ipahal_stats_sampler_destroy(struct ipahal_stats_sampler *s)
+{
+	if (!s)
+		return;
+
+	ipahal_stats_sampler_stop(s);
+	vfree(s->ring);
+	s->ring = NULL;
+	kfree(s->raw);
+	s->raw = NULL;
+}
+
+int ipahal_stats_sampler_mmap(struct ipahal_stats_sampler *s,
+	struct vm_area_struct *vma)
+{
+	if (!s || !s->ring || !vma)
+		return -EINVAL;
+
+	if (vma->vm_flags & VM_WRITE)
+		return -EPERM;
+	vma->vm_flags &= ~VM_MAYWRITE;
+
+	return remap_vmalloc_range(vma, s->ring, vma->vm_pgoff);
+}
@@ -14,6 +14,8 @@
 #define _IPAHAL_HW_STATS_H_
 
 #include <linux/ipa.h>
+#include <linux/msm_ipa.h>
+#include <linux/workqueue.h>
 
 #define IPAHAL_MAX_PIPES 32
 #define IPAHAL_MAX_RULE_ID_32 (1024 / 32) /* 10 bits of rule id */
@@ -244,5 +246,101 @@ int ipahal_stats_get_offset(enum ipahal_hw_stats_type type, void *params,
 int ipahal_parse_stats(enum ipahal_hw_stats_type type, void *init_params,
 	void *raw_stats, void *parsed_stats);
 
+/*
+ * ipahal_stats_read_cb - Read raw stats from IPA SRAM for the sampler
+ * @type: type of stats
+ * @offset: offset of the stats in the stats table, from get_offset
+ * @size: bytes to read
+ * @raw_stats: buffer to read into
+ * @priv: sampler owner data
+ *
+ * Return: 0 on success and negative on failure
+ */
+typedef int (*ipahal_stats_read_cb)(enum ipahal_hw_stats_type type,
+	u32 offset, u16 size, void *raw_stats, void *priv);
+
+/*
+ * struct ipahal_stats_sampler - Periodic quota and drop stats sampler
+ * @work: sampling work, deferrable so it does not wake idle CPUs
+ * @read: reads the raw stats from SRAM
+ * @priv: passed to @read
+ * @period_ms: configured sampling period
+ * @backoff: current period multiplier, grows while there is no traffic
+ * @quota_init: quota stats the H/W was initialized with
+ * @drop_init: drop stats the H/W was initialized with
+ * @quota_prev/drop_prev: counters of the previous sample
+ * @quota_cur/drop_cur: counters being sampled
+ * @raw: buffer for raw stats
+ * @sample: sample being built before it is copied into the ring
+ * @last_ns: time of the previous sample
+ * @primed: a previous sample exists to compute deltas against
+ * @ring: the ring, header first
+ * @ring_size: size of the ring mapping
+ */
+struct ipahal_stats_sampler {
+	struct delayed_work work;
+	ipahal_stats_read_cb read;
+	void *priv;
+	unsigned int period_ms;
+	unsigned int backoff;
+	struct ipahal_stats_init_quota quota_init;
+	struct ipahal_stats_init_drop drop_init;
+	struct ipahal_stats_quota_all quota_prev;
+	struct ipahal_stats_quota_all quota_cur;
+	struct ipahal_stats_drop_all drop_prev;
+	struct ipahal_stats_drop_all drop_cur;
+	void *raw;
+	struct ipa_hw_stats_ring_sample sample;
+	u64 last_ns;
+	bool primed;
+	struct ipa_hw_stats_ring_hdr *ring;
+	size_t ring_size;
+};
+
+/*
+ * ipahal_stats_sampler_init() - Set up a sampler and its ring
+ * @s: sampler to init
+ * @quota_init: quota stats the H/W was initialized with
+ * @drop_init: drop stats the H/W was initialized with
+ * @nr_slots: number of samples the ring holds
+ * @read: reads the raw stats from SRAM, called from process context
+ * @priv: passed to @read
+ *
+ * Return: 0 on success and negative on failure
+ */
+int ipahal_stats_sampler_init(struct ipahal_stats_sampler *s,
+	const struct ipahal_stats_init_quota *quota_init,
+	const struct ipahal_stats_init_drop *drop_init,
+	u32 nr_slots, ipahal_stats_read_cb read, void *priv);
+
+/*
+ * ipahal_stats_sampler_start() - Start or re-period sampling
+ * @s: the sampler
+ * @period_ms: sampling period while there is traffic
+ */
+void ipahal_stats_sampler_start(struct ipahal_stats_sampler *s,
+	unsigned int period_ms);
+
+/*
+ * ipahal_stats_sampler_stop() - Stop sampling, the ring stays readable
+ * @s: the sampler
+ */
+void ipahal_stats_sampler_stop(struct ipahal_stats_sampler *s);
+
+/*
+ * ipahal_stats_sampler_destroy() - Stop sampling and free the ring
+ * @s: the sampler
+ */
+void ipahal_stats_sampler_destroy(struct ipahal_stats_sampler *s);
+
+/*
+ * ipahal_stats_sampler_mmap() - Map the ring read-only to userspace
+ * @s: the sampler
+ * @vma: vma from the owner's mmap file operation
+ *
+ * Return: 0 on success and negative on failure
+ */
+int ipahal_stats_sampler_mmap(struct ipahal_stats_sampler *s,
+	struct vm_area_struct *vma);
 
 #endif /* _IPAHAL_HW_STATS_H_ */
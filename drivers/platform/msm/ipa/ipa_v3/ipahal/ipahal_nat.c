@@ -11,6 +11,8 @@
  */
 
 #include <linux/debugfs.h>
+#include <linux/log2.h>
+#include <linux/slab.h>
 #include "ipahal_nat.h"
 #include "ipahal_nat_i.h"
 #include "ipahal_i.h"
@@ -18,6 +20,9 @@
 #define IPA_64_LOW_32_MASK (0xFFFFFFFF)
 #define IPA_64_HIGH_32_MASK (0xFFFFFFFF00000000ULL)
 
+#define IPA_NAT_TIME_STAMP_MASK (0xFFFFFF)
+#define IPA_NAT_MAX_ENTRY_SIZE (sizeof(struct ipa_nat_hw_ipv6ct_entry))
+
 static const char *ipahal_nat_type_to_str[IPA_NAT_MAX] = {
 	__stringify(IPAHAL_NAT_IPV4),
 	__stringify(IPAHAL_NAT_IPV4_INDEX),
@@ -420,3 +425,318 @@ int ipahal_nat_stringify_entry(enum ipahal_nat_type nat_type, void *entry,
 	return result;
 }
 
+/*
+ * NAT table manager
+ *
+ * IPv4 NAT and IPv6CT entries share the chain layout: next/prev indices
+ * that address base entries directly and expansion entries after them.
+ */
+
+static inline void *ipahal_nat_tbl_entry(struct ipahal_nat_tbl *tbl,
+	u32 index)
+{
+	if (index < tbl->base_entries)
+		return tbl->base + index * tbl->entry_size;
+	return tbl->expn + (index - tbl->base_entries) * tbl->entry_size;
+}
+
+static u16 ipahal_nat_entry_next(struct ipahal_nat_tbl *tbl, void *entry)
+{
+	if (tbl->nat_type == IPAHAL_NAT_IPV4)
+		return ((struct ipa_nat_hw_ipv4_entry *)entry)->next_index;
+	return ((struct ipa_nat_hw_ipv6ct_entry *)entry)->next_index;
+}
+
+static void ipahal_nat_entry_set_next(struct ipahal_nat_tbl *tbl,
+	void *entry, u16 next)
+{
+	if (tbl->nat_type == IPAHAL_NAT_IPV4)
+		((struct ipa_nat_hw_ipv4_entry *)entry)->next_index = next;
+	else
+		((struct ipa_nat_hw_ipv6ct_entry *)entry)->next_index = next;
+}
+
+static u16 ipahal_nat_entry_prev(struct ipahal_nat_tbl *tbl, void *entry)
+{
+	if (tbl->nat_type == IPAHAL_NAT_IPV4)
+		return ((struct ipa_nat_hw_ipv4_entry *)entry)->prev_index;
+	return ((struct ipa_nat_hw_ipv6ct_entry *)entry)->prev_index;
+}
+
+static void ipahal_nat_entry_set_prev(struct ipahal_nat_tbl *tbl,
+	void *entry, u16 prev)
+{
+	if (tbl->nat_type == IPAHAL_NAT_IPV4)
+		((struct ipa_nat_hw_ipv4_entry *)entry)->prev_index = prev;
+	else
+		((struct ipa_nat_hw_ipv6ct_entry *)entry)->prev_index = prev;
+}
+
+static void ipahal_nat_entry_set_enable(struct ipahal_nat_tbl *tbl,
+	void *entry, bool enable)
+{
+	if (tbl->nat_type == IPAHAL_NAT_IPV4)
+		((struct ipa_nat_hw_ipv4_entry *)entry)->enable = enable;
+	else
+		((struct ipa_nat_hw_ipv6ct_entry *)entry)->enable = enable;
+}
+
+static void ipahal_nat_entry_invalidate(struct ipahal_nat_tbl *tbl,
+	void *entry)
+{
+	ipahal_nat_entry_set_enable(tbl, entry, false);
+	if (tbl->nat_type == IPAHAL_NAT_IPV4)
+		((struct ipa_nat_hw_ipv4_entry *)entry)->protocol =
+			IPAHAL_NAT_INVALID_PROTOCOL;
+	else
+		((struct ipa_nat_hw_ipv6ct_entry *)entry)->protocol =
+			IPAHAL_NAT_INVALID_PROTOCOL;
+}
+
+static u32 ipahal_nat_entry_time_stamp(struct ipahal_nat_tbl *tbl,
+	void *entry)
+{
+	if (tbl->nat_type == IPAHAL_NAT_IPV4)
+		return ((struct ipa_nat_hw_ipv4_entry *)entry)->time_stamp;
+	return ((struct ipa_nat_hw_ipv6ct_entry *)entry)->time_stamp;
+}
+
+static bool ipahal_nat_tbl_entry_valid(struct ipahal_nat_tbl *tbl,
+	void *entry)
+{
+	return ipahal_nat_objs[ipahal_ctx->hw_type][tbl->nat_type].
+		is_entry_valid(entry);
+}
+
+/*
+ * Write @entry to @dst with @next/@prev as links. The entry is enabled
+ * only after the rest of it is visible.
+ */
+static void ipahal_nat_tbl_write(struct ipahal_nat_tbl *tbl, void *dst,
+	const void *entry, u16 next, u16 prev)
+{
+	u64 buf[IPA_NAT_MAX_ENTRY_SIZE / sizeof(u64)];
+
+	memcpy(buf, entry, tbl->entry_size);
+	ipahal_nat_entry_set_next(tbl, buf, next);
+	ipahal_nat_entry_set_prev(tbl, buf, prev);
+	ipahal_nat_entry_set_enable(tbl, buf, false);
+	memcpy(dst, buf, tbl->entry_size);
+	wmb();
+	ipahal_nat_entry_set_enable(tbl, dst, true);
+}
+
+int ipahal_nat_tbl_init(struct ipahal_nat_tbl *tbl,
+	enum ipahal_nat_type nat_type, void *base, u32 base_entries,
+	void *expn, u32 expn_entries)
+{
+	if (WARN(tbl == NULL || base == NULL || (expn_entries && !expn),
+		"NULL pointer received\n"))
+		return -EINVAL;
+	if (nat_type != IPAHAL_NAT_IPV4 && nat_type != IPAHAL_NAT_IPV6CT) {
+		IPAHAL_ERR("NAT type %s has no chains\n",
+			ipahal_nat_type_str(nat_type));
+		return -EINVAL;
+	}
+	if (!is_power_of_2(base_entries) || base_entries < 2 ||
+		base_entries + expn_entries > U16_MAX) {
+		IPAHAL_ERR("invalid table sizes base=%u expn=%u\n",
+			base_entries, expn_entries);
+		return -EINVAL;
+	}
+
+	memset(tbl, 0, sizeof(*tbl));
+	tbl->expn_map = kcalloc(BITS_TO_LONGS(expn_entries),
+		sizeof(unsigned long), GFP_KERNEL);
+	if (!tbl->expn_map)
+		return -ENOMEM;
+
+	tbl->nat_type = nat_type;
+	tbl->base = base;
+	tbl->expn = expn;
+	tbl->base_entries = base_entries;
+	tbl->expn_entries = expn_entries;
+	tbl->entry_size = ipahal_nat_objs[ipahal_ctx->hw_type][nat_type].
+		entry_size();
+	tbl->sweep_pos = 1;
+
+	IPAHAL_DBG("NAT type=%s base=%u expn=%u entries\n",
+		ipahal_nat_type_str(nat_type), base_entries, expn_entries);
+
+	return 0;
+}
+
+void ipahal_nat_tbl_destroy(struct ipahal_nat_tbl *tbl)
+{
+	if (!tbl)
+		return;
+	kfree(tbl->expn_map);
+	tbl->expn_map = NULL;
+}
+
+int ipahal_nat_tbl_add(struct ipahal_nat_tbl *tbl, u16 hash,
+	const void *entry, u16 *index)
+{
+	struct ipahal_nat_tbl_stats *stats;
+	u32 idx, slot, chain = 1;
+	void *cur, *tail;
+	u16 next;
+
+	if (WARN(tbl == NULL || entry == NULL || index == NULL,
+		"NULL pointer received\n"))
+		return -EINVAL;
+
+	stats = &tbl->stats;
+	idx = hash & (tbl->base_entries - 1);
+	if (!idx)
+		idx = tbl->base_entries - 1;
+
+	cur = ipahal_nat_tbl_entry(tbl, idx);
+	if (!ipahal_nat_tbl_entry_valid(tbl, cur)) {
+		/* A deleted head keeps linking the rest of its chain */
+		ipahal_nat_tbl_write(tbl, cur, entry,
+			ipahal_nat_entry_next(tbl, cur), 0);
+		goto added;
+	}
+
+	stats->collisions++;
+	for (next = ipahal_nat_entry_next(tbl, cur); next;
+		next = ipahal_nat_entry_next(tbl, cur)) {
+		idx = next;
+		cur = ipahal_nat_tbl_entry(tbl, idx);
+		chain++;
+	}
+	tail = cur;
+
+	slot = find_first_zero_bit(tbl->expn_map, tbl->expn_entries);
+	if (slot >= tbl->expn_entries) {
+		stats->expn_full++;
+		IPAHAL_DBG("no free expansion entry\n");
+		return -ENOSPC;
+	}
+	set_bit(slot, tbl->expn_map);
+
+	cur = ipahal_nat_tbl_entry(tbl, tbl->base_entries + slot);
+	ipahal_nat_tbl_write(tbl, cur, entry, 0, idx);
+	wmb();
+	idx = tbl->base_entries + slot;
+	ipahal_nat_entry_set_next(tbl, tail, idx);
+	chain++;
+
+	if (++stats->expn_in_use > stats->expn_high_water)
+		stats->expn_high_water = stats->expn_in_use;
+
+added:
+	if (++stats->in_use > stats->high_water)
+		stats->high_water = stats->in_use;
+	if (chain > stats->max_chain)
+		stats->max_chain = chain;
+	stats->chain_hist[min_t(u32, ilog2(chain),
+		IPAHAL_NAT_CHAIN_HIST - 1)]++;
+	stats->inserts++;
+
+	*index = idx;
+	return 0;
+}
+
+int ipahal_nat_tbl_del(struct ipahal_nat_tbl *tbl, u16 index)
+{
+	void *cur;
+	u16 next, prev;
+
+	if (WARN(tbl == NULL, "NULL pointer received\n"))
+		return -EINVAL;
+	if (!index || index >= tbl->base_entries + tbl->expn_entries) {
+		IPAHAL_ERR("invalid NAT index %u\n", index);
+		return -EINVAL;
+	}
+
+	cur = ipahal_nat_tbl_entry(tbl, index);
+	if (!ipahal_nat_tbl_entry_valid(tbl, cur)) {
+		IPAHAL_ERR("NAT index %u is not in use\n", index);
+		return -ENOENT;
+	}
+
+	next = ipahal_nat_entry_next(tbl, cur);
+	if (index < tbl->base_entries) {
+		if (next)
+			ipahal_nat_entry_invalidate(tbl, cur);
+		else
+			memset(cur, 0, tbl->entry_size);
+	} else {
+		prev = ipahal_nat_entry_prev(tbl, cur);
+		ipahal_nat_entry_set_next(tbl,
+			ipahal_nat_tbl_entry(tbl, prev), next);
+		if (next)
+			ipahal_nat_entry_set_prev(tbl,
+				ipahal_nat_tbl_entry(tbl, next), prev);
+		wmb();
+		memset(cur, 0, tbl->entry_size);
+		clear_bit(index - tbl->base_entries, tbl->expn_map);
+		tbl->stats.expn_in_use--;
+	}
+
+	tbl->stats.in_use--;
+	tbl->stats.deletes++;
+	return 0;
+}
+
+int ipahal_nat_tbl_age(struct ipahal_nat_tbl *tbl, u32 now, u32 max_age,
+	u32 batch)
+{
+	u32 total, age;
+	int aged = 0;
+	void *cur;
+
+	if (WARN(tbl == NULL, "NULL pointer received\n"))
+		return -EINVAL;
+
+	total = tbl->base_entries + tbl->expn_entries;
+	batch = min(batch, total - 1);
+	while (batch--) {
+		cur = ipahal_nat_tbl_entry(tbl, tbl->sweep_pos);
+		if (ipahal_nat_tbl_entry_valid(tbl, cur)) {
+			age = (now - ipahal_nat_entry_time_stamp(tbl, cur)) &
+				IPA_NAT_TIME_STAMP_MASK;
+			if (age > max_age &&
+				!ipahal_nat_tbl_del(tbl, tbl->sweep_pos))
+				aged++;
+		}
+		if (++tbl->sweep_pos >= total)
+			tbl->sweep_pos = 1;
+	}
+
+	tbl->stats.aged += aged;
+	return aged;
+}
+
+int ipahal_nat_tbl_stringify_stats(struct ipahal_nat_tbl *tbl,
+	char *buff, size_t buff_size)
+{
+	struct ipahal_nat_tbl_stats *stats;
+	int i, length;
+
+	if (WARN(tbl == NULL || buff == NULL, "NULL pointer received\n"))
+		return -EINVAL;
+	if (WARN(!buff_size, "The output buff size is zero\n"))
+		return -EINVAL;
+
+	stats = &tbl->stats;
+	length = scnprintf(buff, buff_size,
+		"%s: in_use=%u high_water=%u\n"
+		"\texpn_in_use=%u/%u expn_high_water=%u\n"
+		"\tinserts=%llu deletes=%llu aged=%llu\n"
+		"\tcollisions=%llu expn_full=%llu max_chain=%u\n"
+		"\tchain_hist:",
+		ipahal_nat_type_str(tbl->nat_type),
+		stats->in_use, stats->high_water,
+		stats->expn_in_use, tbl->expn_entries, stats->expn_high_water,
+		stats->inserts, stats->deletes, stats->aged,
+		stats->collisions, stats->expn_full, stats->max_chain);
+	for (i = 0; i < IPAHAL_NAT_CHAIN_HIST; i++)
+		length += scnprintf(buff + length, buff_size - length,
+			" %llu", stats->chain_hist[i]);
+	length += scnprintf(buff + length, buff_size - length, "\n");
+
+	return length;
+}
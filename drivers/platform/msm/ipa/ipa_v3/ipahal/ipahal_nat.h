@@ -76,4 +76,129 @@ int ipahal_nat_is_entry_valid(enum ipahal_nat_type nat_type, void *entry,
 int ipahal_nat_stringify_entry(enum ipahal_nat_type nat_type, void *entry,
 	char *buff, size_t buff_size);
 
+/* Chain lengths histogram buckets: 1, 2-3, 4-7, ... */
+#define IPAHAL_NAT_CHAIN_HIST 8
+
+/*
+ * struct ipahal_nat_tbl_stats - NAT table manager statistics
+ * @in_use: Entries in use, base and expansion
+ * @high_water: Highest @in_use seen
+ * @expn_in_use: Expansion table entries in use
+ * @expn_high_water: Highest @expn_in_use seen
+ * @max_chain: Longest collision chain an insert walked
+ * @inserts: Successful inserts
+ * @deletes: Deletes, including aged entries
+ * @collisions: Inserts whose base entry was taken
+ * @expn_full: Inserts failed for lack of an expansion entry
+ * @aged: Entries removed by aging sweeps
+ * @chain_hist: Inserts by chain length, in powers of two
+ */
+struct ipahal_nat_tbl_stats {
+	u32 in_use;
+	u32 high_water;
+	u32 expn_in_use;
+	u32 expn_high_water;
+	u32 max_chain;
+	u64 inserts;
+	u64 deletes;
+	u64 collisions;
+	u64 expn_full;
+	u64 aged;
+	u64 chain_hist[IPAHAL_NAT_CHAIN_HIST];
+};
+
+/*
+ * struct ipahal_nat_tbl - NAT base and expansion table manager
+ *  Entries are addressed the way the H/W links them: base entries by
+ *  their index and expansion entries by base_entries + their index.
+ *  Index 0 ends a chain, so base entry 0 is never used.
+ * @nat_type: IPAHAL_NAT_IPV4 or IPAHAL_NAT_IPV6CT
+ * @base: Base table memory
+ * @expn: Expansion table memory
+ * @base_entries: Number of base entries, a power of 2
+ * @expn_entries: Number of expansion entries
+ * @entry_size: Size of an entry
+ * @expn_map: Expansion entries in use
+ * @sweep_pos: Where the next aging sweep starts
+ * @stats: Statistics
+ */
+struct ipahal_nat_tbl {
+	enum ipahal_nat_type nat_type;
+	u8 *base;
+	u8 *expn;
+	u32 base_entries;
+	u32 expn_entries;
+	size_t entry_size;
+	unsigned long *expn_map;
+	u32 sweep_pos;
+	struct ipahal_nat_tbl_stats stats;
+};
+
+/*
+ * ipahal_nat_tbl_init() - Start managing NAT tables
+ *  The tables are expected to be zeroed. Callers serialize all calls on a
+ *  table.
+ * @tbl: [in] Manager to init
+ * @nat_type: [in] IPAHAL_NAT_IPV4 or IPAHAL_NAT_IPV6CT
+ * @base: [in] Base table memory
+ * @base_entries: [in] Number of base entries, a power of 2
+ * @expn: [in] Expansion table memory
+ * @expn_entries: [in] Number of expansion entries
+ */
+int ipahal_nat_tbl_init(struct ipahal_nat_tbl *tbl,
+	enum ipahal_nat_type nat_type, void *base, u32 base_entries,
+	void *expn, u32 expn_entries);
+
+/*
+ * ipahal_nat_tbl_destroy() - Stop managing NAT tables
+ * @tbl: [in] Manager to destroy
+ */
+void ipahal_nat_tbl_destroy(struct ipahal_nat_tbl *tbl);
+
+/*
+ * ipahal_nat_tbl_add() - Insert a NAT entry
+ *  The entry goes to its base entry if free, otherwise to a free expansion
+ *  entry linked to the end of the collision chain. The entry is written
+ *  before it is linked so the H/W never walks into a partial entry.
+ * @tbl: [in] The table manager
+ * @hash: [in] H/W lookup hash of the entry
+ * @entry: [in] The entry to insert, its link fields are ignored
+ * @index: [out] The index the entry was put at
+ */
+int ipahal_nat_tbl_add(struct ipahal_nat_tbl *tbl, u16 hash,
+	const void *entry, u16 *index);
+
+/*
+ * ipahal_nat_tbl_del() - Delete a NAT entry
+ *  An expansion entry is unlinked and freed. A base entry heading a chain
+ *  is only invalidated so the chain stays reachable.
+ * @tbl: [in] The table manager
+ * @index: [in] Index returned by ipahal_nat_tbl_add()
+ */
+int ipahal_nat_tbl_del(struct ipahal_nat_tbl *tbl, u16 index);
+
+/*
+ * ipahal_nat_tbl_age() - Delete idle entries, a batch at a time
+ *  Each call looks at up to @batch entries after where the previous call
+ *  stopped, so a full pass is spread over several calls.
+ * @tbl: [in] The table manager
+ * @now: [in] Current H/W NAT timestamp
+ * @max_age: [in] Entries idle for longer than this are deleted
+ * @batch: [in] Number of entries to look at
+ * @return the number of entries deleted
+ */
+int ipahal_nat_tbl_age(struct ipahal_nat_tbl *tbl, u32 now, u32 max_age,
+	u32 batch);
+
+/*
+ * ipahal_nat_tbl_stringify_stats() - Creates a string for the statistics
+ * @tbl: [in] The table manager
+ * @buff: [out] Output buffer for the result string
+ * @buff_size: [in] The size of the output buffer
+ * @return the number of characters written into buff not including
+ *         the trailing '\0'
+ */
+int ipahal_nat_tbl_stringify_stats(struct ipahal_nat_tbl *tbl,
+	char *buff, size_t buff_size);
+
 #endif /* _IPAHAL_NAT_H_ */
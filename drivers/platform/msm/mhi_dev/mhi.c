@@ -2430,6 +2430,78 @@ static int mhi_dev_check_tre_bytes_left(struct mhi_dev_channel *ch,
 	return td_done;
 }
 
+/*
+ * mhi_dev_read_tre_run() - Read a run of chained TREs with one DMA.
+ *
+ * Consecutive TREs of a TD often point at consecutive host memory. When
+ * they do, and they fit in the user buffer and the read bounce buffer,
+ * fetch their data with a single synchronous DMA and then retire the TREs
+ * one by one so the host still gets every EOB/EOT event it asked for.
+ *
+ * @ch - channel to read from, ch_lock held and no TRE partially consumed
+ * @mreq - read request
+ * @usr_buf_remaining - space left in the request buffer
+ * @td_done - set when the run ended a TD
+ *
+ * Returns the number of bytes read, 0 if there is no run of at least two
+ * TREs to coalesce, or a negative error.
+ */
+static int mhi_dev_read_tre_run(struct mhi_dev_channel *ch,
+		struct mhi_req *mreq, size_t usr_buf_remaining,
+		int *td_done)
+{
+	struct mhi_dev_ring *ring = ch->ring;
+	union mhi_dev_ring_element_type *el;
+	uint32_t offset = ring->rd_offset;
+	uint64_t next_loc = 0;
+	uint32_t write_to_loc;
+	size_t bytes = 0;
+	int num = 0, i, rc;
+
+	while (offset != ring->wr_offset) {
+		el = &ring->ring_cache[offset];
+		if (num && el->tre.data_buf_ptr != next_loc)
+			break;
+		if (bytes + el->tre.len > usr_buf_remaining ||
+			bytes + el->tre.len > MHI_DEV_READ_BUF_SIZE)
+			break;
+
+		bytes += el->tre.len;
+		next_loc = el->tre.data_buf_ptr + el->tre.len;
+		num++;
+		if (!el->tre.chain)
+			break;
+
+		offset++;
+		if (offset == ring->ring_size)
+			offset = 0;
+	}
+
+	if (num < 2)
+		return 0;
+
+	el = &ring->ring_cache[ring->rd_offset];
+	write_to_loc = (uint32_t) mreq->buf + (mreq->len - usr_buf_remaining);
+	mreq->el = el;
+	mreq->transfer_len = bytes;
+	mreq->rd_offset = ring->rd_offset;
+	mhi_log(MHI_MSG_VERBOSE, "reading %d bytes in %d TREs from chan %d\n",
+			(int) bytes, num, mreq->chan);
+	rc = mhi_transfer_host_to_device((void *) write_to_loc,
+			el->tre.data_buf_ptr, bytes, mhi_ctx, mreq);
+	if (rc)
+		return rc;
+
+	for (i = 0; i < num; i++) {
+		el = &ring->ring_cache[ring->rd_offset];
+		ch->tre_bytes_left = 0;
+		*td_done = mhi_dev_check_tre_bytes_left(ch, ring, el,
+				&mreq->chain);
+	}
+
+	return bytes;
+}
+
 int mhi_dev_read_channel(struct mhi_req *mreq)
 {
 	struct mhi_dev_channel *ch;
@@ -2466,6 +2538,24 @@ int mhi_dev_read_channel(struct mhi_req *mreq)
 	mutex_lock(&ch->ch_lock);
 
 	do {
+		if (mreq->mode == IPA_DMA_SYNC && !ch->tre_loc &&
+				ch->state != MHI_DEV_CH_STOPPED) {
+			rc = mhi_dev_read_tre_run(ch, mreq, usr_buf_remaining,
+					&td_done);
+			if (rc < 0) {
+				mhi_log(MHI_MSG_ERROR,
+					"Error while reading chan (%d) rc %d\n",
+					mreq->chan, rc);
+				mutex_unlock(&ch->ch_lock);
+				return rc;
+			}
+			if (rc > 0) {
+				bytes_read += rc;
+				usr_buf_remaining -= rc;
+				continue;
+			}
+		}
+
 		el = &ring->ring_cache[ring->rd_offset];
 		mhi_log(MHI_MSG_VERBOSE, "evtptr : 0x%llx\n",
 						el->tre.data_buf_ptr);
@@ -3373,7 +3463,7 @@ static int mhi_dev_resume_mmio_mhi_init(struct mhi_dev *mhi_ctx)
 		return -ENOMEM;
 
 	mhi_ctx->read_handle = dma_alloc_coherent(&pdev->dev,
-			(TRB_MAX_DATA_SIZE * 4),
+			MHI_DEV_READ_BUF_SIZE,
 			&mhi_ctx->read_dma_handle,
 			GFP_KERNEL);
 	if (!mhi_ctx->read_handle)
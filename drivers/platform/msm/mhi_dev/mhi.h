@@ -276,6 +276,8 @@ struct mhi_config {
 #define MHI_ENV_VALUE			2
 #define MHI_MASK_ROWS_CH_EV_DB		4
 #define TRB_MAX_DATA_SIZE		8192
+/* bounce buffer for synchronous host to device reads */
+#define MHI_DEV_READ_BUF_SIZE		(TRB_MAX_DATA_SIZE * 4)
 #define MHI_CTRL_STATE			100
 
 /* maximum transfer completion events buffer */
@@ -75,6 +75,11 @@ module_param(pkt_threshold, uint, 0664); /* S_IRUGO | S_IWUSR | S_IWGRP */
 #define HEADROOM_FOR_QOS    8
 #define TAILROOM            8 /* for padding by mux layer */
 
+/* UL aggregation defaults, used until userspace sets its own limits */
+#define RMNET_BAM_AGG_COUNT_DEFAULT	8
+#define RMNET_BAM_AGG_SIZE_DEFAULT	8192
+#define RMNET_BAM_AGG_SIZE_MAX		16384
+
 struct rmnet_private {
 	struct net_device_stats stats;
 	uint32_t ch_id;
@@ -91,6 +96,24 @@ struct rmnet_private {
 	u32 operation_mode; /* IOCTL specified mode (protocol, QoS header) */
 	uint8_t device_up;
 	uint8_t in_reset;
+
+	/* UL aggregation of MAP frames, see rmnet_agg_xmit() */
+	u32 egress_format;
+	u32 agg_count_limit;
+	u32 agg_size_limit;
+	u32 ul_max_size;	/* transmit size negotiated by BAM-DMUX */
+	struct sk_buff *agg_skb;	/* pending aggregate, holds a UL vote */
+	unsigned int agg_count;
+	atomic_t tx_agg_extra;	/* packets beyond one per written aggregate */
+
+	/* UL packets per BAM-DMUX write */
+	unsigned long ul_transactions;
+	unsigned long ul_packets;
+	unsigned int ul_max_packets;
+
+	/* TX completions, freed from NAPI context */
+	struct napi_struct tx_napi;
+	struct sk_buff_head tx_done;
 };
 
 struct rmnet_free_bam_work {
@@ -167,6 +190,23 @@ static ssize_t timeout_show(struct device *d, struct device_attribute *attr,
 DEVICE_ATTR(timeout, 0664, timeout_show, timeout_store);
 #endif
 
+static ssize_t ul_aggregation_show(struct device *d,
+				   struct device_attribute *attr, char *buf)
+{
+	struct rmnet_private *p = netdev_priv(to_net_dev(d));
+	unsigned long trans = READ_ONCE(p->ul_transactions);
+	unsigned long pkts = READ_ONCE(p->ul_packets);
+	unsigned long avg = trans ? pkts * 100 / trans : 0;
+
+	return snprintf(buf, PAGE_SIZE,
+			"transactions %lu\npackets %lu\n"
+			"pkts_per_transaction %lu.%02lu\nmax_pkts %u\n",
+			trans, pkts, avg / 100, avg % 100,
+			READ_ONCE(p->ul_max_packets));
+}
+
+DEVICE_ATTR(ul_aggregation, 0444, ul_aggregation_show, NULL);
+
 
 /* Forward declaration */
 static int rmnet_ioctl(struct net_device *dev, struct ifreq *ifr, int cmd);
@@ -269,6 +309,14 @@ static struct sk_buff *_rmnet_add_headroom(struct sk_buff **skb,
 	return skbn;
 }
 
+static void rmnet_account_ul(struct rmnet_private *p, unsigned int pkts)
+{
+	p->ul_transactions++;
+	p->ul_packets += pkts;
+	if (pkts > p->ul_max_packets)
+		p->ul_max_packets = pkts;
+}
+
 static int _rmnet_xmit(struct sk_buff *skb, struct net_device *dev)
 {
 	struct rmnet_private *p = netdev_priv(dev);
@@ -297,6 +345,8 @@ static int _rmnet_xmit(struct sk_buff *skb, struct net_device *dev)
 	//Mayank dev->trans_start = jiffies;
 	/* if write() succeeds, skb access is unsafe in this process */
 	bam_ret = msm_bam_dmux_write(p->ch_id, skb);
+	if (bam_ret == 0)
+		rmnet_account_ul(p, 1);
 
 	if (bam_ret != 0 && bam_ret != -EAGAIN && bam_ret != -EFAULT) {
 		pr_err("[%s] %s: write returned error %d",
@@ -309,34 +359,67 @@ static int _rmnet_xmit(struct sk_buff *skb, struct net_device *dev)
 	return bam_ret;
 }
 
-static void bam_write_done(void *dev, struct sk_buff *skb)
+static int rmnet_tx_poll(struct napi_struct *napi, int budget)
 {
+	struct net_device *dev = napi->dev;
 	struct rmnet_private *p = netdev_priv(dev);
 	u32 opmode = p->operation_mode;
+	struct sk_buff *skb;
 	unsigned long flags;
+	int done = 0;
 
-	DBG1("%s: write complete\n", __func__);
-	if (RMNET_IS_MODE_IP(opmode) ||
-				count_this_packet(skb->data, skb->len)) {
-		p->stats.tx_packets++;
-		p->stats.tx_bytes += skb->len;
+	while (done < budget && (skb = skb_dequeue(&p->tx_done))) {
+		DBG1("%s: write complete\n", __func__);
+		if (RMNET_IS_MODE_IP(opmode) ||
+		    count_this_packet(skb->data, skb->len)) {
+			p->stats.tx_packets++;
+			p->stats.tx_bytes += skb->len;
 #ifdef CONFIG_MSM_RMNET_DEBUG
-		p->wakeups_xmit += rmnet_cause_wakeup(p);
+			p->wakeups_xmit += rmnet_cause_wakeup(p);
 #endif
+		}
+		DBG1("[%s] Tx packet #%lu len=%d mark=0x%x\n",
+		     dev->name, p->stats.tx_packets, skb->len, skb->mark);
+		napi_consume_skb(skb, budget);
+		done++;
 	}
-	DBG1("[%s] Tx packet #%lu len=%d mark=0x%x\n",
-	    ((struct net_device *)(dev))->name, p->stats.tx_packets,
-	    skb->len, skb->mark);
-	dev_kfree_skb_any(skb);
+	p->stats.tx_packets += atomic_xchg(&p->tx_agg_extra, 0);
 
 	spin_lock_irqsave(&p->tx_queue_lock, flags);
 	if (netif_queue_stopped(dev) &&
 	    msm_bam_dmux_is_ch_low(p->ch_id)) {
-		DBG0("%s: Low WM hit, waking queue=%pK\n",
-		      __func__, skb);
+		DBG0("%s: Low WM hit, waking queue\n", __func__);
 		netif_wake_queue(dev);
 	}
 	spin_unlock_irqrestore(&p->tx_queue_lock, flags);
+
+	if (done < budget) {
+		napi_complete(napi);
+		/* A completion queued after the last dequeue */
+		if (!skb_queue_empty(&p->tx_done))
+			napi_schedule(napi);
+	}
+
+	return done;
+}
+
+/*
+ * Completions are queued and freed in batches from NAPI context, which
+ * also checks the low watermark once per batch rather than per packet.
+ */
+static void bam_write_done(void *dev, struct sk_buff *skb)
+{
+	struct rmnet_private *p = netdev_priv(dev);
+
+	skb_queue_tail(&p->tx_done, skb);
+
+	if (in_interrupt() || irqs_disabled()) {
+		napi_schedule(&p->tx_napi);
+	} else {
+		local_bh_disable();
+		napi_schedule(&p->tx_napi);
+		local_bh_enable();
+	}
 }
 
 static void bam_notify(void *dev, int event, unsigned long data)
@@ -373,6 +456,9 @@ static void bam_notify(void *dev, int event, unsigned long data)
 		break;
 	case BAM_DMUX_UL_DISCONNECTED:
 		break;
+	case BAM_DMUX_TRANSMIT_SIZE:
+		p->ul_max_size = data;
+		break;
 	}
 }
 
@@ -427,6 +513,20 @@ static int __rmnet_close(struct net_device *dev)
 }
 
 
+static void rmnet_agg_drop(struct net_device *dev)
+{
+	struct rmnet_private *p = netdev_priv(dev);
+
+	if (!p->agg_skb)
+		return;
+
+	p->stats.tx_dropped += p->agg_count;
+	dev_kfree_skb_any(p->agg_skb);
+	p->agg_skb = NULL;
+	p->agg_count = 0;
+	msm_bam_dmux_ul_power_unvote();
+}
+
 static int rmnet_stop(struct net_device *dev)
 {
 	DBG0("[%s] rmnet_stop()\n", dev->name);
@@ -434,6 +534,10 @@ static int rmnet_stop(struct net_device *dev)
 	__rmnet_close(dev);
 	netif_stop_queue(dev);
 
+	netif_tx_lock_bh(dev);
+	rmnet_agg_drop(dev);
+	netif_tx_unlock_bh(dev);
+
 	return 0;
 }
 
@@ -449,6 +553,115 @@ static int rmnet_change_mtu(struct net_device *dev, int new_mtu)
 	return 0;
 }
 
+static bool rmnet_agg_enabled(struct rmnet_private *p, struct sk_buff *skb)
+{
+	u32 opmode = p->operation_mode;
+
+	return (p->egress_format & RMNET_IOCTL_EGRESS_FORMAT_AGGREGATION) &&
+	       p->agg_count_limit > 1 && RMNET_IS_MODE_IP(opmode) &&
+	       !RMNET_IS_MODE_QOS(opmode) &&
+	       skb->protocol == htons(ETH_P_MAP);
+}
+
+static u32 rmnet_agg_size(struct rmnet_private *p)
+{
+	u32 size = p->agg_size_limit;
+
+	if (p->ul_max_size)
+		size = min(size, p->ul_max_size);
+
+	return size;
+}
+
+/*
+ * Writes the pending aggregate. It has already been consumed from the
+ * stack's point of view, so it is dropped rather than requeued on error.
+ */
+static void rmnet_agg_flush(struct net_device *dev)
+{
+	struct rmnet_private *p = netdev_priv(dev);
+	struct sk_buff *agg = p->agg_skb;
+	unsigned int count = p->agg_count;
+	unsigned long flags;
+	int ret;
+
+	p->agg_skb = NULL;
+	p->agg_count = 0;
+
+	ret = _rmnet_xmit(agg, dev);
+	if (ret) {
+		if (ret == -EFAULT)
+			netif_carrier_off(dev);
+		else if (ret == -EAGAIN)
+			netif_stop_queue(dev);
+		p->stats.tx_dropped += count;
+		dev_kfree_skb_any(agg);
+	} else {
+		/* the completion counts the aggregate as one packet */
+		atomic_add(count - 1, &p->tx_agg_extra);
+		p->ul_packets += count - 1;
+		if (count > p->ul_max_packets)
+			p->ul_max_packets = count;
+
+		spin_lock_irqsave(&p->tx_queue_lock, flags);
+		if (msm_bam_dmux_is_ch_full(p->ch_id))
+			netif_stop_queue(dev);
+		spin_unlock_irqrestore(&p->tx_queue_lock, flags);
+	}
+
+	/* The vote taken when the aggregate was started */
+	msm_bam_dmux_ul_power_unvote();
+}
+
+/*
+ * MAP frames handed down in one xmit_more batch are concatenated into a
+ * single BAM-DMUX write, the same way rmnet_map_aggregate() builds its
+ * aggregates, so that a burst of small uplink packets such as TCP ACKs costs
+ * one transaction. Nothing is held back past the end of a batch.
+ *
+ * Returns true if @skb was consumed.
+ */
+static bool rmnet_agg_xmit(struct sk_buff *skb, struct net_device *dev)
+{
+	struct rmnet_private *p = netdev_priv(dev);
+	struct sk_buff *agg = p->agg_skb;
+	bool eligible = rmnet_agg_enabled(p, skb);
+	bool more = skb->xmit_more;
+	u32 size = rmnet_agg_size(p);
+
+	if (agg) {
+		/* the tailroom was sized for @size when agg was allocated */
+		if (eligible && p->agg_count < p->agg_count_limit &&
+		    agg->len + skb->len <= size) {
+			skb_copy_bits(skb, 0, skb_put(agg, skb->len), skb->len);
+			p->agg_count++;
+			dev_consume_skb_any(skb);
+			if (!more)
+				rmnet_agg_flush(dev);
+			return true;
+		}
+		rmnet_agg_flush(dev);
+		if (netif_queue_stopped(dev))
+			return false;
+	}
+
+	if (!eligible || !more || skb->len >= size)
+		return false;
+
+	agg = skb_copy_expand(skb, dev->needed_headroom,
+			      size - skb->len + dev->needed_tailroom,
+			      GFP_ATOMIC);
+	if (!agg)
+		return false;
+
+	/* Keep the UL powered while the aggregate is pending */
+	msm_bam_dmux_ul_power_vote();
+	p->agg_skb = agg;
+	p->agg_count = 1;
+	dev_consume_skb_any(skb);
+	return true;
+}
+
 static int rmnet_xmit(struct sk_buff *skb, struct net_device *dev)
 {
 	struct rmnet_private *p = netdev_priv(dev);
@@ -467,13 +680,34 @@ static int rmnet_xmit(struct sk_buff *skb, struct net_device *dev)
 	if (!awake) {
 		/* send SKB once wakeup is complete */
 		netif_stop_queue(dev);
-		p->waiting_for_ul_skb = skb;
+		if (p->agg_skb) {
+			/* send the aggregate first, the stack requeues skb */
+			p->waiting_for_ul_skb = p->agg_skb;
+			atomic_add(p->agg_count - 1, &p->tx_agg_extra);
+			p->agg_skb = NULL;
+			p->agg_count = 0;
+			msm_bam_dmux_ul_power_unvote();
+			ret = NETDEV_TX_BUSY;
+		} else {
+			p->waiting_for_ul_skb = skb;
+			ret = 0;
+		}
 		spin_unlock_irqrestore(&p->lock, flags);
-		ret = 0;
 		goto exit;
 	}
 	spin_unlock_irqrestore(&p->lock, flags);
 
+	if (p->agg_skb || rmnet_agg_enabled(p, skb)) {
+		if (rmnet_agg_xmit(skb, dev)) {
+			ret = NETDEV_TX_OK;
+			goto exit;
+		}
+		if (netif_queue_stopped(dev)) {
+			ret = NETDEV_TX_BUSY;
+			goto exit;
+		}
+	}
+
 	ret = _rmnet_xmit(skb, dev);
 	if (ret == -EPERM) {
 		ret = NETDEV_TX_BUSY;
@@ -594,7 +828,31 @@ static int rmnet_ioctl_extended(struct net_device *dev, struct ifreq *ifr)
 		ext_cmd.u.data = p->ch_id;
 		break;
 	case RMNET_IOCTL_GET_SUPPORTED_FEATURES:
-		ext_cmd.u.data = 0;
+		ext_cmd.u.data = RMNET_IOCTL_FEAT_SET_EGRESS_DATA_FORMAT |
+				 RMNET_IOCTL_FEAT_SET_AGGREGATION_COUNT |
+				 RMNET_IOCTL_FEAT_GET_AGGREGATION_COUNT |
+				 RMNET_IOCTL_FEAT_SET_AGGREGATION_SIZE |
+				 RMNET_IOCTL_FEAT_GET_AGGREGATION_SIZE;
+		break;
+	case RMNET_IOCTL_SET_EGRESS_DATA_FORMAT:
+		netif_tx_lock_bh(dev);
+		p->egress_format = ext_cmd.u.data;
+		if (!(p->egress_format & RMNET_IOCTL_EGRESS_FORMAT_AGGREGATION))
+			rmnet_agg_drop(dev);
+		netif_tx_unlock_bh(dev);
+		break;
+	case RMNET_IOCTL_SET_AGGREGATION_COUNT:
+		p->agg_count_limit = ext_cmd.u.data;
+		break;
+	case RMNET_IOCTL_GET_AGGREGATION_COUNT:
+		ext_cmd.u.data = p->agg_count_limit;
+		break;
+	case RMNET_IOCTL_SET_AGGREGATION_SIZE:
+		p->agg_size_limit = min_t(u32, ext_cmd.u.data,
+					  RMNET_BAM_AGG_SIZE_MAX);
+		break;
+	case RMNET_IOCTL_GET_AGGREGATION_SIZE:
+		ext_cmd.u.data = p->agg_size_limit;
 		break;
 	case RMNET_IOCTL_GET_DRIVER_NAME:
 		strlcpy(ext_cmd.u.if_name, RMNET_BAM_DRIVER_NAME,
@@ -846,19 +1104,27 @@ static int bam_rmnet_probe(struct platform_device *pdev)
 	p->ch_id = i;
 	p->waiting_for_ul_skb = NULL;
 	p->device_up = DEVICE_UNINITIALIZED;
+	p->agg_count_limit = RMNET_BAM_AGG_COUNT_DEFAULT;
+	p->agg_size_limit = RMNET_BAM_AGG_SIZE_DEFAULT;
 	spin_lock_init(&p->lock);
 	spin_lock_init(&p->tx_queue_lock);
+	skb_queue_head_init(&p->tx_done);
+	netif_tx_napi_add(dev, &p->tx_napi, rmnet_tx_poll, NAPI_POLL_WEIGHT);
+	napi_enable(&p->tx_napi);
 
 	ret = register_netdev(dev);
 	if (ret) {
 		pr_err("%s: unable to register netdev %d rc=%d\n",
 			__func__, i, ret);
+		napi_disable(&p->tx_napi);
+		netif_napi_del(&p->tx_napi);
 		netdevs[i] = NULL;
 		free_netdev(dev);
 		return ret;
 	}
 
 	rmnet_debug_init(dev);
+	device_create_file(d, &dev_attr_ul_aggregation);
 
 	return 0;
 }
@@ -890,6 +1156,13 @@ static int bam_rmnet_remove(struct platform_device *pdev)
 	netif_carrier_off(netdevs[i]);
 	netif_stop_queue(netdevs[i]);
 
+	netif_tx_lock_bh(netdevs[i]);
+	rmnet_agg_drop(netdevs[i]);
+	netif_tx_unlock_bh(netdevs[i]);
+	napi_disable(&p->tx_napi);
+	netif_napi_del(&p->tx_napi);
+	skb_queue_purge(&p->tx_done);
+
 	unregister_netdev(netdevs[i]);
 	free_netdev(netdevs[i]);
 
@@ -22,10 +22,12 @@
 #include <linux/slab.h>
 #include <linux/msm-bus.h>
 #include <linux/msm-bus-board.h>
+#include <linux/msm_gpi.h>
 #include <linux/of.h>
 #include <linux/of_platform.h>
 #include <linux/pm_runtime.h>
 #include <linux/qcom-geni-se.h>
+#include <linux/seq_file.h>
 #include <linux/spinlock.h>
 
 #define GENI_SE_IOMMU_VA_START	(0x40000000)
@@ -435,6 +437,166 @@ int geni_se_select_mode(void __iomem *base, int mode)
 }
 EXPORT_SYMBOL(geni_se_select_mode);
 
+/**
+ * geni_se_xfer_policy_init() - Initialize the transfer mode policy of an SE
+ * @rsc:	Resource of the serial engine.
+ * @base:	Base address of the serial engine's register block.
+ * @cur_mode:	Transfer mode the SE has been configured in.
+ * @gsi:	Whether the protocol driver can submit transfers through GSI.
+ *
+ * Transfers that fit in the TX FIFO are cheapest in FIFO mode, larger ones
+ * in SE DMA mode, and a queue of transfers is cheapest chained through GSI
+ * where it completes with a single interrupt.
+ */
+void geni_se_xfer_policy_init(struct se_geni_rsc *rsc, void __iomem *base,
+			      int cur_mode, bool gsi)
+{
+	struct se_geni_xfer_policy *pol = &rsc->xfer;
+
+	memset(pol, 0, sizeof(*pol));
+	pol->cur_mode = cur_mode;
+	pol->fifo_bytes = get_tx_fifo_depth(base) *
+				get_tx_fifo_width(base) / BITS_PER_BYTE;
+	pol->fifo_disabled = !!(geni_read_reg(base, GENI_IF_FIFO_DISABLE_RO) &
+				FIFO_IF_DISABLE);
+	if (gsi)
+		pol->gsi_queue = GENI_SE_GSI_MIN_QUEUE;
+}
+EXPORT_SYMBOL(geni_se_xfer_policy_init);
+
+/**
+ * geni_se_xfer_mode_pick() - Pick the transfer mode for a transfer
+ * @rsc:	Resource of the serial engine.
+ * @len:	Length of the transfer in bytes.
+ * @queued:	Number of transfers queued behind and including this one.
+ *
+ * Return:	Transfer mode to be used for the transfer.
+ */
+int geni_se_xfer_mode_pick(struct se_geni_rsc *rsc, size_t len,
+			   unsigned int queued)
+{
+	struct se_geni_xfer_policy *pol = &rsc->xfer;
+
+	if (pol->fifo_disabled)
+		return GSI_DMA;
+	if (pol->gsi_queue && queued >= pol->gsi_queue)
+		return GSI_DMA;
+	if (len <= pol->fifo_bytes)
+		return FIFO_MODE;
+	return SE_DMA;
+}
+EXPORT_SYMBOL(geni_se_xfer_mode_pick);
+
+/**
+ * geni_se_xfer_mode_set() - Switch the SE to a transfer mode if needed
+ * @rsc:	Resource of the serial engine.
+ * @base:	Base address of the serial engine's register block.
+ * @mode:	Transfer mode to be selected.
+ *
+ * Return:	0 on success, standard Linux error codes on failure.
+ */
+int geni_se_xfer_mode_set(struct se_geni_rsc *rsc, void __iomem *base,
+			  int mode)
+{
+	struct se_geni_xfer_policy *pol = &rsc->xfer;
+	int ret;
+
+	if (mode == pol->cur_mode)
+		return 0;
+
+	ret = geni_se_select_mode(base, mode);
+	if (ret)
+		return ret;
+
+	pol->cur_mode = mode;
+	pol->stats.switches++;
+	return 0;
+}
+EXPORT_SYMBOL(geni_se_xfer_mode_set);
+
+/**
+ * geni_se_xfer_done() - Account a completed transfer
+ * @rsc:	Resource of the serial engine.
+ * @mode:	Transfer mode the transfer was done in.
+ * @len:	Length of the transfer in bytes.
+ * @start:	Time at which the transfer was started.
+ */
+void geni_se_xfer_done(struct se_geni_rsc *rsc, int mode, size_t len,
+		       ktime_t start)
+{
+	struct se_geni_xfer_stats *stats = &rsc->xfer.stats;
+	u64 lat_ns = ktime_to_ns(ktime_sub(ktime_get(), start));
+
+	if (mode <= INVALID || mode >= SE_XFER_MODES)
+		return;
+
+	stats->xfers[mode]++;
+	stats->bytes[mode] += len;
+	stats->lat_ns[mode] += lat_ns;
+	if (lat_ns > stats->max_lat_ns[mode])
+		stats->max_lat_ns[mode] = lat_ns;
+}
+EXPORT_SYMBOL(geni_se_xfer_done);
+
+/**
+ * geni_se_xfer_stats_show() - Print the transfer statistics of an SE
+ * @s:		Sequence file to print the statistics into.
+ * @rsc:	Resource of the serial engine.
+ */
+void geni_se_xfer_stats_show(struct seq_file *s, struct se_geni_rsc *rsc)
+{
+	static const char * const names[SE_XFER_MODES] = {
+		[FIFO_MODE] = "fifo",
+		[GSI_DMA] = "gsi",
+		[SE_DMA] = "dma",
+	};
+	struct se_geni_xfer_stats *stats = &rsc->xfer.stats;
+	int mode;
+
+	seq_printf(s, "mode:%s switches:%llu\n",
+		   names[rsc->xfer.cur_mode] ? : "invalid", stats->switches);
+	for (mode = FIFO_MODE; mode < SE_XFER_MODES; mode++)
+		seq_printf(s, "%s: xfers:%llu bytes:%llu avg_ns:%llu max_ns:%llu\n",
+			   names[mode], stats->xfers[mode], stats->bytes[mode],
+			   stats->xfers[mode] ?
+			   div64_u64(stats->lat_ns[mode], stats->xfers[mode]) :
+			   0, stats->max_lat_ns[mode]);
+}
+EXPORT_SYMBOL(geni_se_xfer_stats_show);
+
+/**
+ * geni_se_gsi_chain_tres() - Fill the DMA TREs of a chain of transfers
+ * @tre:	Array of at least @n TREs to be filled.
+ * @iova:	DMA addresses of the transfer buffers.
+ * @len:	Lengths of the transfer buffers.
+ * @n:		Number of transfers.
+ *
+ * The TREs are chained and only the last one raises an interrupt, so the
+ * whole chain can be submitted as a single descriptor.
+ *
+ * Return:	Number of TREs filled, standard Linux error codes on failure.
+ */
+int geni_se_gsi_chain_tres(struct msm_gpi_tre *tre, const dma_addr_t *iova,
+			   const u32 *len, int n)
+{
+	int i;
+
+	if (unlikely(!tre || !iova || !len || n <= 0))
+		return -EINVAL;
+
+	for (i = 0; i < n; i++) {
+		bool last = (i == n - 1);
+
+		tre[i].dword[0] = MSM_GPI_DMA_W_BUFFER_TRE_DWORD0(iova[i]);
+		tre[i].dword[1] = MSM_GPI_DMA_W_BUFFER_TRE_DWORD1(iova[i]);
+		tre[i].dword[2] = MSM_GPI_DMA_W_BUFFER_TRE_DWORD2(len[i]);
+		tre[i].dword[3] = MSM_GPI_DMA_W_BUFFER_TRE_DWORD3(!last, last,
+								  0, !last);
+	}
+	return n;
+}
+EXPORT_SYMBOL(geni_se_gsi_chain_tres);
+
 /**
  * geni_setup_m_cmd() - Setup the primary sequencer
  * @base:	Base address of the serial engine's register block.
@@ -2393,6 +2393,39 @@ int sps_get_iovec(struct sps_pipe *h, struct sps_iovec *iovec)
 }
 EXPORT_SYMBOL(sps_get_iovec);
 
+/**
+ * Get a batch of processed I/O vectors (completed transfers)
+ *
+ */
+int sps_get_iovecs(struct sps_pipe *h, struct sps_iovec *iovec, u32 max,
+		   u32 *num)
+{
+	struct sps_pipe *pipe = h;
+	struct sps_bam *bam;
+	int result;
+
+	if (h == NULL) {
+		SPS_ERR(sps, "sps:%s:pipe is NULL.\n", __func__);
+		return SPS_ERROR;
+	} else if (iovec == NULL || num == NULL || max == 0) {
+		SPS_ERR(sps, "sps:%s:invalid iovec array.\n", __func__);
+		return SPS_ERROR;
+	}
+
+	bam = sps_bam_lock(pipe);
+	if (bam == NULL) {
+		SPS_ERR(sps, "sps:%s:BAM is not found by handle.\n", __func__);
+		return SPS_ERROR;
+	}
+
+	result = sps_bam_pipe_get_iovecs(bam, pipe->pipe_index, iovec, max,
+					 num);
+	sps_bam_unlock(bam);
+
+	return result;
+}
+EXPORT_SYMBOL(sps_get_iovecs);
+
 /**
  * Perform timer control
  *
@@ -693,6 +693,7 @@ static void pipe_clear(struct sps_pipe *pipe)
 	pipe->desc_size = 0;
 	pipe->disconnecting = false;
 	pipe->late_eot = false;
+	pipe->batch_done = false;
 	memset(&pipe->sys, 0, sizeof(pipe->sys));
 	INIT_LIST_HEAD(&pipe->sys.events_q);
 }
@@ -1224,6 +1225,7 @@ int sps_bam_pipe_set_params(struct sps_bam *dev, u32 pipe_index, u32 options)
 
 	pipe->hybrid = options & SPS_O_HYBRID;
 	pipe->late_eot = options & SPS_O_LATE_EOT;
+	pipe->batch_done = options & SPS_O_BATCH_DONE;
 
 	/* Create interrupt source mask */
 	mask = 0;
@@ -1812,6 +1814,82 @@ static void pipe_handler_wakeup(struct sps_bam *dev, struct sps_pipe *pipe)
  * @pipe - pointer to pipe state
  *
  */
+/**
+ * Deliver a run of completed descriptors as one event
+ *
+ * This function notifies the client once for the contiguous cached
+ * descriptors [offset, stop), for pipes using SPS_O_BATCH_DONE.
+ *
+ * @dev - pointer to BAM device descriptor
+ *
+ * @pipe - pointer to pipe state
+ *
+ * @offset - byte offset of the first descriptor of the run
+ *
+ * @stop - byte offset just past the last descriptor of the run
+ *
+ * @update_offset - software offset to advance past the run
+ *
+ * @enabled - descriptor flags the client asked to be notified for
+ *
+ */
+static void pipe_handler_eot_batch(struct sps_bam *dev,
+				   struct sps_pipe *pipe, u32 offset, u32 stop,
+				   u32 *update_offset, u32 enabled)
+{
+	struct sps_bam_event_reg *event_reg;
+	struct sps_q_event *event;
+	struct sps_iovec *cache;
+	void **user;
+	u32 num;
+	u32 flags = 0;
+	bool notify = false;
+	enum sps_event event_id;
+	u32 n;
+
+	cache = (struct sps_iovec *) (pipe->sys.desc_cache + offset);
+	user = &pipe->sys.user_ptrs[offset / sizeof(struct sps_iovec)];
+	num = (stop - offset) / sizeof(struct sps_iovec);
+
+	for (n = 0; n < num; n++) {
+		flags |= cache[n].flags & enabled;
+		if (user[n] != NULL)
+			notify = true;
+	}
+
+	/* Advance first so a client callback can fetch the I/O vectors */
+	*update_offset = (stop >= pipe->desc_size) ? 0 : stop;
+#ifdef SPS_BAM_STATISTICS
+	pipe->sys.desc_rd_count += num;
+#endif /* SPS_BAM_STATISTICS */
+
+	if (!notify && !flags)
+		return;
+
+	if ((flags & SPS_IOVEC_FLAG_EOT))
+		event_id = SPS_EVENT_EOT;
+	else
+		event_id = SPS_EVENT_DESC_DONE;
+
+	event_reg = &pipe->sys.event_regs[SPS_EVENT_INDEX(event_id)];
+	event = alloc_event(pipe, event_reg);
+	if (event == NULL) {
+		SPS_ERR(dev, "sps: %s: pipe %d: event is NULL.\n",
+			__func__, pipe->pipe_index);
+		return;
+	}
+
+	event->notify.data.batch.iovec = cache;
+	event->notify.data.batch.user = user;
+	event->notify.data.batch.num = num;
+	event->notify.event_id = event_id;
+	event->notify.user = event_reg->user;
+#ifdef SPS_BAM_STATISTICS
+	pipe->sys.batch_events++;
+#endif /* SPS_BAM_STATISTICS */
+	trigger_event(dev, pipe, event_reg, event);
+}
+
 static void pipe_handler_eot(struct sps_bam *dev, struct sps_pipe *pipe)
 {
 	struct sps_bam_event_reg *event_reg;
@@ -1947,6 +2025,24 @@ static void pipe_handler_eot(struct sps_bam *dev, struct sps_pipe *pipe)
 			*cache++ = *desc++;
 	}
 
+	/*
+	 * In batch mode hand each contiguous run to the client at once:
+	 * one run, or two when the completed range wraps the FIFO.
+	 */
+	if (pipe->batch_done) {
+		if (end_offset < offset) {
+			pipe_handler_eot_batch(dev, pipe, offset,
+					       pipe->desc_size, update_offset,
+					       enabled);
+			offset = 0;
+		}
+		if (offset != end_offset)
+			pipe_handler_eot_batch(dev, pipe, offset, end_offset,
+					       update_offset, enabled);
+		pipe->sys.handler_eot = false;
+		return;
+	}
+
 	/* Process all completed descriptors */
 	cache = (struct sps_iovec *) (pipe->sys.desc_cache + offset);
 	user = &pipe->sys.user_ptrs[offset / sizeof(struct sps_iovec)];
@@ -2248,6 +2344,59 @@ int sps_bam_pipe_get_iovec(struct sps_bam *dev, u32 pipe_index,
 	return 0;
 }
 
+/**
+ * Get a batch of processed I/O vectors
+ *
+ */
+int sps_bam_pipe_get_iovecs(struct sps_bam *dev, u32 pipe_index,
+			    struct sps_iovec *iovec, u32 max, u32 *num)
+{
+	struct sps_pipe *pipe = dev->pipes[pipe_index];
+	struct sps_iovec *desc;
+	u32 read_offset;
+	u32 n = 0;
+
+	*num = 0;
+
+	/* Is this a valid pipe configured for get_iovec use? */
+	if (!pipe->sys.ack_xfers ||
+	    (pipe->state & BAM_STATE_BAM2BAM) != 0 ||
+	    (pipe->state & BAM_STATE_REMOTE)) {
+		return SPS_ERROR;
+	}
+
+	/* If pipe is polled and queue is enabled, perform polling operation */
+	if ((pipe->polled || pipe->hybrid) && !pipe->sys.no_queue)
+		pipe_handler_eot(dev, pipe);
+
+	/* Read the completion point once for the whole batch */
+	if (pipe->sys.no_queue)
+		read_offset =
+		bam_pipe_get_desc_read_offset(&dev->base, pipe_index);
+	else
+		read_offset = pipe->sys.cache_offset;
+
+	while (n < max && read_offset != pipe->sys.acked_offset) {
+		desc = (struct sps_iovec *) (pipe->sys.desc_buf +
+					     pipe->sys.acked_offset);
+		iovec[n++] = *desc;
+
+		pipe->sys.acked_offset += sizeof(struct sps_iovec);
+		if (pipe->sys.acked_offset >= pipe->desc_size)
+			pipe->sys.acked_offset = 0;
+	}
+#ifdef SPS_BAM_STATISTICS
+	pipe->sys.get_iovecs += n;
+#endif /* SPS_BAM_STATISTICS */
+
+	SPS_DBG(dev,
+		"sps:%s; pipe index:%d; fetched %u iovecs; acked_offset:0x%x.\n",
+		__func__, pipe->pipe_index, n, pipe->sys.acked_offset);
+
+	*num = n;
+	return 0;
+}
+
 /**
  * Determine whether a BAM pipe descriptor FIFO is empty
  *
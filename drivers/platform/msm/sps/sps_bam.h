@@ -159,6 +159,7 @@ struct sps_bam_sys_mode {
 	u32 queued_events;
 	u32 get_events;
 	u32 get_iovecs;
+	u32 batch_events;
 #endif /* SPS_BAM_STATISTICS */
 };
 
@@ -180,6 +181,7 @@ struct sps_pipe {
 	int polled;
 	int hybrid;
 	bool late_eot;
+	bool batch_done;
 	u32 irq_gen_addr;
 	enum sps_mode mode;
 	u32 num_descs; /* Size (number of elements) of descriptor FIFO */
@@ -495,6 +497,27 @@ int sps_bam_pipe_get_event(struct sps_bam *dev, u32 pipe_index,
 int sps_bam_pipe_get_iovec(struct sps_bam *dev, u32 pipe_index,
 			   struct sps_iovec *iovec);
 
+/**
+ * Get a batch of processed I/O vectors
+ *
+ * This function fetches up to max processed I/O vectors, reading the
+ * pipe's descriptor offset once.
+ *
+ * @dev - pointer to BAM device descriptor
+ *
+ * @pipe_index - pipe index
+ *
+ * @iovec - array of at least max I/O vector structs (output)
+ *
+ * @max - maximum number of I/O vectors to fetch
+ *
+ * @num - number of I/O vectors fetched (output)
+ *
+ * @return 0 on success, negative value on error
+ */
+int sps_bam_pipe_get_iovecs(struct sps_bam *dev, u32 pipe_index,
+			    struct sps_iovec *iovec, u32 max, u32 *num);
+
 /**
  * Determine whether a BAM pipe descriptor FIFO is empty
  *
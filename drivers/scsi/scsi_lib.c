@@ -1542,6 +1542,9 @@ static void scsi_softirq_done(struct request *rq)
 
 	INIT_LIST_HEAD(&cmd->eh_entry);
 
+	if (cmd->device->host->hostt->softirq_done)
+		cmd->device->host->hostt->softirq_done(cmd);
+
 	atomic_inc(&cmd->device->iodone_cnt);
 	if (cmd->result)
 		atomic_inc(&cmd->device->ioerr_cnt);
@@ -926,6 +926,66 @@ static int ufsdbg_dump_device_desc_show(struct seq_file *file, void *data)
 	return err;
 }
 
+static int ufsdbg_wb_show(struct seq_file *file, void *data)
+{
+	struct ufs_hba *hba = (struct ufs_hba *)file->private;
+	struct ufs_dev_info *dev_info = &hba->dev_info;
+	static const struct {
+		const char *name;
+		enum attr_idn idn;
+	} attrs[] = {
+		{ "bAvailableWriteBoosterBufferSize",
+		  QUERY_ATTR_IDN_AVAIL_WB_BUFF_SIZE },
+		{ "bWriteBoosterBufferLifeTimeEst",
+		  QUERY_ATTR_IDN_WB_BUFF_LIFE_TIME_EST },
+		{ "dCurrentWriteBoosterBufferSize",
+		  QUERY_ATTR_IDN_CURR_WB_BUFF_SIZE },
+		{ "bWriteBoosterBufferFlushStatus",
+		  QUERY_ATTR_IDN_WB_FLUSH_STATUS },
+	};
+	int i, err;
+	u32 val;
+
+	seq_printf(file, "supported: %d\n", ufshcd_is_wb_allowed(hba));
+	if (!ufshcd_is_wb_allowed(hba))
+		return 0;
+
+	seq_printf(file, "enabled: %d\n", dev_info->wb_enabled);
+	seq_printf(file, "buffer type: %s\n",
+		   dev_info->b_wb_buffer_type == WB_BUF_MODE_SHARED ?
+		   "shared" : "LU dedicated");
+	seq_printf(file, "flush during hibern8: %d\n",
+		   dev_info->wb_flush_in_h8);
+	seq_printf(file, "hibern8 flush entries: %u\n",
+		   dev_info->wb_h8_flush_cnt);
+
+	pm_runtime_get_sync(hba->dev);
+	for (i = 0; i < ARRAY_SIZE(attrs); i++) {
+		err = ufshcd_query_attr(hba, UPIU_QUERY_OPCODE_READ_ATTR,
+					attrs[i].idn,
+					ufshcd_wb_query_index(hba), 0, &val);
+		if (err)
+			seq_printf(file, "%s: read failed %d\n",
+				   attrs[i].name, err);
+		else
+			seq_printf(file, "%s: 0x%x\n", attrs[i].name, val);
+	}
+	pm_runtime_put_sync(hba->dev);
+
+	return 0;
+}
+
+static int ufsdbg_wb_open(struct inode *inode, struct file *file)
+{
+	return single_open(file, ufsdbg_wb_show, inode->i_private);
+}
+
+static const struct file_operations ufsdbg_wb_fops = {
+	.open		= ufsdbg_wb_open,
+	.read		= seq_read,
+	.release	= single_release,
+};
+
 static int ufsdbg_show_hba_show(struct seq_file *file, void *data)
 {
 	struct ufs_hba *hba = (struct ufs_hba *)file->private;
@@ -1705,6 +1765,16 @@ void ufsdbg_add_debugfs(struct ufs_hba *hba)
 		goto err;
 	}
 
+	hba->debugfs_files.write_booster =
+		debugfs_create_file("write_booster", S_IRUSR,
+			hba->debugfs_files.debugfs_root, hba,
+			&ufsdbg_wb_fops);
+	if (!hba->debugfs_files.write_booster) {
+		dev_err(hba->dev,
+		     "%s: failed create write_booster debugfs entry", __func__);
+		goto err;
+	}
+
 	ufsdbg_setup_fault_injection(hba);
 
 	ufshcd_vops_add_debugfs(hba, hba->debugfs_files.debugfs_root);
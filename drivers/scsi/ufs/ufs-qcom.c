@@ -1526,6 +1526,10 @@ static void ufs_qcom_set_caps(struct ufs_hba *hba)
 		hba->caps |= UFSHCD_CAP_HIBERN8_WITH_CLK_GATING;
 	}
 	hba->caps |= UFSHCD_CAP_AUTO_BKOPS_SUSPEND;
+	hba->caps |= UFSHCD_CAP_WB_EN;
+	if (of_property_read_bool(hba->dev->of_node,
+				  "qcom,adaptive-intr-aggr"))
+		hba->caps |= UFSHCD_CAP_INTR_AGGR_ADAPTIVE;
 
 	if (host->hw_ver.major >= 0x2) {
 		if (!host->disable_lpm)
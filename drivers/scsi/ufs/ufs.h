@@ -175,8 +175,15 @@ enum unit_desc_param {
 	UNIT_DESC_PARAM_PHY_MEM_RSRC_CNT	= 0x18,
 	UNIT_DESC_PARAM_CTX_CAPABILITIES	= 0x20,
 	UNIT_DESC_PARAM_LARGE_UNIT_SIZE_M1	= 0x22,
+	UNIT_DESC_PARAM_HPB_LU_MAX_ACTIVE_RGNS	= 0x23,
+	UNIT_DESC_PARAM_HPB_PIN_RGN_START_OFF	= 0x25,
+	UNIT_DESC_PARAM_HPB_NUM_PIN_RGNS	= 0x27,
+	UNIT_DESC_PARAM_WB_BUF_ALLOC_UNITS	= 0x29,
 };
 
+/* bLUEnable value of a logical unit with HPB enabled */
+#define UFS_LU_HPB_ENABLE	0x02
+
 /* Device descriptor parameters offsets in bytes*/
 enum device_desc_param {
 	DEVICE_DESC_PARAM_LEN			= 0x0,
@@ -206,6 +213,38 @@ enum device_desc_param {
 	DEVICE_DESC_PARAM_UD_LEN		= 0x1B,
 	DEVICE_DESC_PARAM_RTT_CAP		= 0x1C,
 	DEVICE_DESC_PARAM_FRQ_RTC		= 0x1D,
+	DEVICE_DESC_PARAM_UFS_FEAT		= 0x1F,
+	DEVICE_DESC_PARAM_HPB_VER		= 0x40,
+	DEVICE_DESC_PARAM_HPB_CONTROL		= 0x42,
+	DEVICE_DESC_PARAM_EXT_UFS_FEATURE_SUP	= 0x4F,
+	DEVICE_DESC_PARAM_WB_PRESRV_USRSPC_EN	= 0x53,
+	DEVICE_DESC_PARAM_WB_TYPE		= 0x54,
+	DEVICE_DESC_PARAM_WB_SHARED_ALLOC_UNITS	= 0x55,
+};
+
+/* bUFSFeaturesSupport bits */
+#define UFS_DEV_HPB_SUPPORT	(1 << 7)
+
+/* dExtendedUFSFeaturesSupport bits */
+#define UFS_DEV_WRITE_BOOSTER_SUP	(1 << 8)
+
+/* bWriteBoosterBufferType */
+enum ufs_wb_buf_type {
+	WB_BUF_MODE_LU_DEDICATED	= 0x0,
+	WB_BUF_MODE_SHARED		= 0x1,
+};
+
+/* bWriteBoosterBufferLifeTimeEst value once the buffer is worn out */
+#define UFS_WB_LIFETIME_EXCEEDED	0x0B
+
+/* Geometry descriptor parameters offsets in bytes */
+enum geometry_desc_param {
+	GEOMETRY_DESC_PARAM_LEN			= 0x0,
+	GEOMETRY_DESC_PARAM_TYPE		= 0x1,
+	GEOMETRY_DESC_PARAM_HPB_REGION_SIZE	= 0x48,
+	GEOMETRY_DESC_PARAM_HPB_NUMBER_LU	= 0x49,
+	GEOMETRY_DESC_PARAM_HPB_SUBREGION_SIZE	= 0x4A,
+	GEOMETRY_DESC_PARAM_HPB_MAX_ACTIVE_REGS	= 0x4B,
 };
 /*
  * Logical Unit Write Protect
@@ -510,6 +549,16 @@ struct ufs_dev_info {
 	/* query flags */
 	bool f_power_on_wp_en;
 
+	/* WriteBooster */
+	u32 d_ext_ufs_feature_sup;
+	u8 b_wb_buffer_type;
+	u8 wb_dedicated_lu;
+	bool wb_supported;
+	bool wb_enabled;
+	bool wb_flush_in_h8;
+	/* hibern8 entries on idle that let the device flush the buffer */
+	u32 wb_h8_flush_cnt;
+
 	/* Keeps information if any of the LU is power on write protected */
 	bool is_lu_power_on_wp;
 	/* is Unit Attention Condition cleared on UFS Device LUN? */
@@ -43,6 +43,7 @@
 #include <linux/nls.h>
 #include <linux/of.h>
 #include <linux/blkdev.h>
+#include <asm/unaligned.h>
 #include "ufshcd.h"
 #include "ufshci.h"
 #include "ufs_quirks.h"
@@ -172,6 +173,90 @@ void ufshcd_update_query_stats(struct ufs_hba *hba,
 }
 #endif
 
+static enum ufs_lat_op ufshcd_lat_op(struct scsi_cmnd *cmd)
+{
+	switch (cmd->cmnd[0]) {
+	case READ_6:
+	case READ_10:
+	case READ_16:
+		return UFS_LAT_OP_READ;
+	case WRITE_6:
+	case WRITE_10:
+	case WRITE_16:
+		return UFS_LAT_OP_WRITE;
+	case UNMAP:
+		return UFS_LAT_OP_UNMAP;
+	case SYNCHRONIZE_CACHE:
+	case SYNCHRONIZE_CACHE_16:
+		return UFS_LAT_OP_SYNC_CACHE;
+	default:
+		return UFS_LAT_OP_OTHER;
+	}
+}
+
+static enum ufs_lat_size ufshcd_lat_size(struct scsi_cmnd *cmd)
+{
+	/* for UNMAP this is the discarded range, not the parameter list */
+	unsigned int bytes = cmd->request ? blk_rq_bytes(cmd->request) :
+					    scsi_bufflen(cmd);
+
+	if (bytes <= 4 * 1024)
+		return UFS_LAT_SZ_4K;
+	if (bytes <= 16 * 1024)
+		return UFS_LAT_SZ_16K;
+	if (bytes <= 64 * 1024)
+		return UFS_LAT_SZ_64K;
+	if (bytes <= 256 * 1024)
+		return UFS_LAT_SZ_256K;
+	return UFS_LAT_SZ_LARGE;
+}
+
+static inline int ufshcd_lat_bucket(s64 us)
+{
+	if (us < UFS_LAT_MIN_US)
+		return 0;
+	return min_t(int, ilog2(us / UFS_LAT_MIN_US) + 1, UFS_LAT_BUCKETS - 1);
+}
+
+/* Called with the host lock held, right after the completion interrupt */
+static void ufshcd_update_lat_hist(struct ufs_hba *hba,
+				   struct ufshcd_lrb *lrbp)
+{
+	struct ufs_lat_hist *hist = hba->cmd_lat_hist;
+	s64 us;
+
+	if (!hist || !hist->enabled)
+		return;
+
+	us = ktime_us_delta(lrbp->complete_time_stamp, lrbp->issue_time_stamp);
+	hist->dbr_to_cmpl[ufshcd_lat_op(lrbp->cmd)][ufshcd_lat_size(lrbp->cmd)]
+			 [ufshcd_lat_bucket(us)]++;
+}
+
+/*
+ * Called from the block completion softirq. The request still owns its
+ * tag, so the completion time stamp in its lrb is intact.
+ */
+static void ufshcd_softirq_done(struct scsi_cmnd *cmd)
+{
+	struct ufs_hba *hba = shost_priv(cmd->device->host);
+	struct ufs_lat_hist *hist = hba->cmd_lat_hist;
+	struct ufshcd_lrb *lrbp;
+	int tag = cmd->request->tag;
+	s64 us;
+
+	if (!hist || !hist->enabled || tag < 0 || tag >= hba->nutrs)
+		return;
+
+	lrbp = &hba->lrb[tag];
+	if (!ktime_to_ns(lrbp->complete_time_stamp))
+		return;
+
+	us = ktime_us_delta(ktime_get(), lrbp->complete_time_stamp);
+	this_cpu_inc(hist->cmpl_to_softirq->cnt[ufshcd_lat_op(cmd)]
+					       [ufshcd_lat_bucket(us)]);
+}
+
 static void ufshcd_update_uic_error_cnt(struct ufs_hba *hba, u32 reg, int type)
 {
 	unsigned long err_bits;
@@ -250,6 +335,11 @@ static void ufshcd_update_uic_error_cnt(struct ufs_hba *hba, u32 reg, int type)
 #define UFSHCD_CLK_GATING_DELAY_MS_PWR_SAVE	10
 #define UFSHCD_CLK_GATING_DELAY_MS_PERF		50
 
+/* idle gaps collected between two evaluations of the idle delays */
+#define UFSHCD_IDLE_TUNE_SAMPLES		256
+/* default share of the idle time the link may be kept active */
+#define UFSHCD_IDLE_TUNE_BUDGET_PCT		10
+
 /* IOCTL opcode for command - ufs set device read only */
 #define UFS_IOCTL_BLKROSET      BLKROSET
 
@@ -1305,6 +1395,51 @@ ufshcd_config_intr_aggr(struct ufs_hba *hba, u8 cnt, u8 tmout)
 		      REG_UTP_TRANSFER_REQ_INT_AGG_CONTROL);
 }
 
+/**
+ * ufshcd_adapt_intr_aggr - follow the queue depth with the aggregation counter
+ * @hba: per adapter instance
+ *
+ * Called with the host lock held right before a request is issued. The
+ * threshold is only moved while nothing is outstanding, when the
+ * aggregation counter is idle; it is set to half the average depth, so
+ * deep queues (streaming writes, GC) share interrupts while shallow ones
+ * get almost one interrupt per request.
+ */
+static void ufshcd_adapt_intr_aggr(struct ufs_hba *hba)
+{
+	struct ufs_intr_aggr *aggr = &hba->intr_aggr;
+	int depth = hweight_long(hba->outstanding_reqs) + 1;
+	u8 cnt;
+
+	/* moving average over the last ~8 requests */
+	aggr->depth_avg += (depth << 1) - (aggr->depth_avg >> 3);
+
+	if (depth > 1)
+		return;
+
+	cnt = clamp_t(unsigned int, aggr->depth_avg >> 5, 1,
+		      min(hba->nutrs - 1, 0x1F));
+	if (cnt == aggr->cnt)
+		return;
+
+	ufshcd_config_intr_aggr(hba, cnt, INT_AGGR_DEF_TO);
+	aggr->cnt = cnt;
+}
+
+/*
+ * A request bypasses aggregation if aggregation is off or, in adaptive
+ * mode, if it is issued to an idle queue: that is the synchronous read a
+ * caller is waiting on. The check is racy, which only costs an extra or
+ * a delayed interrupt.
+ */
+static inline bool ufshcd_intr_cmd_needed(struct ufs_hba *hba)
+{
+	if (!ufshcd_is_intr_aggr_allowed(hba))
+		return true;
+	return ufshcd_is_intr_aggr_adaptive(hba) &&
+	       !READ_ONCE(hba->outstanding_reqs);
+}
+
 /**
  * ufshcd_disable_intr_aggr - Disables interrupt aggregation.
  * @hba: per adapter instance
@@ -2139,6 +2274,9 @@ static void ufshcd_hibern8_enter_work(struct work_struct *work)
 		goto out;
 	}
 	ufshcd_set_link_hibern8(hba);
+	/* with fWBBufferFlushDuringHibernate set the device flushes now */
+	if (hba->dev_info.wb_flush_in_h8)
+		hba->dev_info.wb_h8_flush_cnt++;
 
 	/*
 	 * In case you are here to cancel this work the hibern8_on_idle.state
@@ -2197,6 +2335,8 @@ static void ufshcd_hibern8_exit_work(struct work_struct *work)
 
 	/* Exit from hibern8 */
 	if (ufshcd_is_link_hibern8(hba)) {
+		ktime_t start = ktime_get();
+
 		hba->ufs_stats.clk_hold.ctx = H8_EXIT_WORK;
 		ufshcd_hold(hba, false);
 		ret = ufshcd_uic_hibern8_exit(hba);
@@ -2204,6 +2344,10 @@ static void ufshcd_hibern8_exit_work(struct work_struct *work)
 		ufshcd_release(hba, false);
 		if (!ret) {
 			spin_lock_irqsave(hba->host->host_lock, flags);
+			/* a request has been waiting for this exit */
+			hba->hibern8_on_idle.tune.exit_cnt++;
+			hba->hibern8_on_idle.tune.exit_us +=
+				ktime_us_delta(ktime_get(), start);
 			ufshcd_set_link_active(hba);
 			hba->hibern8_on_idle.state = HIBERN8_EXITED;
 			trace_ufshcd_hibern8_on_idle(dev_name(hba->dev),
@@ -2307,6 +2451,262 @@ static ssize_t ufshcd_hibern8_on_idle_enable_store(struct device *dev,
 	return count;
 }
 
+/* Must be called with host lock acquired, once the doorbell is empty */
+static void ufshcd_idle_tune_start(struct ufs_hba *hba)
+{
+	struct ufs_idle_tune *tune = &hba->hibern8_on_idle.tune;
+
+	if (tune->enabled)
+		tune->idle_start = ktime_get();
+}
+
+/* Must be called with host lock acquired, before ringing the doorbell */
+static void ufshcd_idle_tune_end(struct ufs_hba *hba)
+{
+	struct ufs_idle_tune *tune = &hba->hibern8_on_idle.tune;
+	s64 gap;
+	int bucket = 0;
+
+	if (!tune->enabled || hba->outstanding_reqs ||
+	    !ktime_to_ns(tune->idle_start))
+		return;
+
+	gap = ktime_us_delta(ktime_get(), tune->idle_start);
+	tune->idle_start = ktime_set(0, 0);
+	if (gap >> UFS_IDLE_GAP_MIN_SHIFT)
+		bucket = min_t(int, ilog2(gap >> UFS_IDLE_GAP_MIN_SHIFT),
+			       UFS_IDLE_GAP_BUCKETS - 1);
+	tune->gap_hist[bucket]++;
+
+	if (++tune->gap_cnt >= UFSHCD_IDLE_TUNE_SAMPLES &&
+	    !hba->hibern8_on_idle.is_suspended) {
+		tune->gap_cnt = 0;
+		schedule_work(&tune->work);
+	}
+}
+
+/* representative idle gap, in us, of a histogram bucket */
+static inline u64 ufshcd_idle_gap_us(int bucket)
+{
+	return bucket ? 384ULL << bucket : 256;
+}
+
+/*
+ * Pick the hibern8 enter delay that avoids the most hibern8 exits while
+ * keeping the link active for no more than power_budget_pct of the idle
+ * time. A gap shorter than the delay keeps the link active for its whole
+ * length, a longer one for the delay and then costs an exit. Candidate
+ * delays of 1 << k ms line up with the lower edge of bucket k + 2.
+ */
+static unsigned int ufshcd_idle_tune_pick(struct ufs_hba *hba, u32 *hist)
+{
+	struct ufs_idle_tune *tune = &hba->hibern8_on_idle.tune;
+	u64 total = 0, best_exits = U64_MAX;
+	unsigned int best = 0;
+	int i, k;
+
+	for (i = 0; i < UFS_IDLE_GAP_BUCKETS; i++)
+		total += hist[i] * ufshcd_idle_gap_us(i);
+
+	for (k = 0; k < UFS_IDLE_TUNE_DELAYS; k++) {
+		u64 delay_us = 1024ULL << k, active = 0, exits = 0;
+
+		for (i = 0; i < UFS_IDLE_GAP_BUCKETS; i++) {
+			if (i < k + 2) {
+				active += hist[i] * ufshcd_idle_gap_us(i);
+			} else {
+				active += hist[i] * delay_us;
+				exits += hist[i];
+			}
+		}
+
+		if (active * 100 > total * tune->power_budget_pct)
+			break;
+		if (exits < best_exits) {
+			best_exits = exits;
+			best = k;
+		}
+	}
+
+	return best;
+}
+
+static void ufshcd_idle_tune_work(struct work_struct *work)
+{
+	struct ufs_hba *hba = container_of(work, struct ufs_hba,
+					   hibern8_on_idle.tune.work);
+	struct ufs_idle_tune *tune = &hba->hibern8_on_idle.tune;
+	u32 hist[UFS_IDLE_GAP_BUCKETS];
+	unsigned long flags, h8_delay_ms;
+	bool change;
+	int i;
+
+	spin_lock_irqsave(hba->host->host_lock, flags);
+	/* halve the history so that the delays follow workload changes */
+	for (i = 0; i < UFS_IDLE_GAP_BUCKETS; i++) {
+		hist[i] = tune->gap_hist[i];
+		tune->gap_hist[i] >>= 1;
+	}
+	spin_unlock_irqrestore(hba->host->host_lock, flags);
+
+	h8_delay_ms = 1UL << ufshcd_idle_tune_pick(hba, hist);
+
+	spin_lock_irqsave(hba->host->host_lock, flags);
+	if (!tune->enabled) {
+		spin_unlock_irqrestore(hba->host->host_lock, flags);
+		return;
+	}
+	change = h8_delay_ms != hba->hibern8_on_idle.delay_ms;
+	tune->h8_delay_ms = h8_delay_ms;
+	/*
+	 * Clocks are gated behind hibern8, so ungating hides behind the
+	 * hibern8 exit; gate at the next candidate delay.
+	 */
+	tune->gate_delay_ms = 2 * h8_delay_ms;
+	hba->hibern8_on_idle.delay_ms = h8_delay_ms;
+	if (ufshcd_is_clkgating_allowed(hba))
+		hba->clk_gating.delay_ms = tune->gate_delay_ms;
+	if (change)
+		tune->tunes++;
+	spin_unlock_irqrestore(hba->host->host_lock, flags);
+
+	if (change && ufshcd_is_auto_hibern8_supported(hba) &&
+	    hba->hibern8_on_idle.is_enabled)
+		__ufshcd_set_auto_hibern8_timer(hba, h8_delay_ms);
+}
+
+static ssize_t ufshcd_idle_tune_enable_show(struct device *dev,
+		struct device_attribute *attr, char *buf)
+{
+	struct ufs_hba *hba = dev_get_drvdata(dev);
+
+	return snprintf(buf, PAGE_SIZE, "%d\n",
+			hba->hibern8_on_idle.tune.enabled);
+}
+
+static ssize_t ufshcd_idle_tune_enable_store(struct device *dev,
+		struct device_attribute *attr, const char *buf, size_t count)
+{
+	struct ufs_hba *hba = dev_get_drvdata(dev);
+	struct ufs_idle_tune *tune = &hba->hibern8_on_idle.tune;
+	unsigned long flags;
+	bool restore = false;
+	u32 value;
+
+	if (kstrtou32(buf, 0, &value))
+		return -EINVAL;
+
+	value = !!value;
+	if (value == tune->enabled)
+		return count;
+
+	if (!value)
+		cancel_work_sync(&tune->work);
+
+	spin_lock_irqsave(hba->host->host_lock, flags);
+	if (value) {
+		memset(tune->gap_hist, 0, sizeof(tune->gap_hist));
+		tune->gap_cnt = 0;
+		tune->idle_start = ktime_set(0, 0);
+		tune->saved_delay_ms = hba->hibern8_on_idle.delay_ms;
+	} else {
+		restore = hba->hibern8_on_idle.delay_ms !=
+			  tune->saved_delay_ms;
+		hba->hibern8_on_idle.delay_ms = tune->saved_delay_ms;
+		if (hba->clk_scaling.is_scaled_up)
+			hba->clk_gating.delay_ms =
+				hba->clk_gating.delay_ms_perf;
+		else
+			hba->clk_gating.delay_ms =
+				hba->clk_gating.delay_ms_pwr_save;
+	}
+	tune->enabled = value;
+	spin_unlock_irqrestore(hba->host->host_lock, flags);
+
+	if (restore && ufshcd_is_auto_hibern8_supported(hba) &&
+	    hba->hibern8_on_idle.is_enabled)
+		__ufshcd_set_auto_hibern8_timer(hba,
+						hba->hibern8_on_idle.delay_ms);
+
+	return count;
+}
+
+static ssize_t ufshcd_idle_tune_budget_show(struct device *dev,
+		struct device_attribute *attr, char *buf)
+{
+	struct ufs_hba *hba = dev_get_drvdata(dev);
+
+	return snprintf(buf, PAGE_SIZE, "%u\n",
+			hba->hibern8_on_idle.tune.power_budget_pct);
+}
+
+static ssize_t ufshcd_idle_tune_budget_store(struct device *dev,
+		struct device_attribute *attr, const char *buf, size_t count)
+{
+	struct ufs_hba *hba = dev_get_drvdata(dev);
+	u32 value;
+
+	if (kstrtou32(buf, 0, &value) || !value || value > 100)
+		return -EINVAL;
+
+	hba->hibern8_on_idle.tune.power_budget_pct = value;
+	return count;
+}
+
+static ssize_t ufshcd_idle_tune_stats_show(struct device *dev,
+		struct device_attribute *attr, char *buf)
+{
+	struct ufs_hba *hba = dev_get_drvdata(dev);
+	struct ufs_idle_tune *tune = &hba->hibern8_on_idle.tune;
+	unsigned long flags;
+	int i, len;
+
+	spin_lock_irqsave(hba->host->host_lock, flags);
+	len = snprintf(buf, PAGE_SIZE,
+		       "h8_delay_ms: %lu\ngate_delay_ms: %lu\nh8_exits: %llu\nh8_exit_penalty_us: %llu\ntunes: %u\ngaps:",
+		       hba->hibern8_on_idle.delay_ms,
+		       hba->clk_gating.delay_ms, tune->exit_cnt,
+		       tune->exit_us, tune->tunes);
+	for (i = 0; i < UFS_IDLE_GAP_BUCKETS; i++)
+		len += snprintf(buf + len, PAGE_SIZE - len, " %u",
+				tune->gap_hist[i]);
+	spin_unlock_irqrestore(hba->host->host_lock, flags);
+	len += snprintf(buf + len, PAGE_SIZE - len, "\n");
+
+	return len;
+}
+
+static void ufshcd_init_idle_tune(struct ufs_hba *hba)
+{
+	struct ufs_idle_tune *tune = &hba->hibern8_on_idle.tune;
+
+	tune->power_budget_pct = UFSHCD_IDLE_TUNE_BUDGET_PCT;
+	INIT_WORK(&tune->work, ufshcd_idle_tune_work);
+
+	tune->enable_attr.show = ufshcd_idle_tune_enable_show;
+	tune->enable_attr.store = ufshcd_idle_tune_enable_store;
+	sysfs_attr_init(&tune->enable_attr.attr);
+	tune->enable_attr.attr.name = "hibern8_on_idle_autotune";
+	tune->enable_attr.attr.mode = S_IRUGO | S_IWUSR;
+	if (device_create_file(hba->dev, &tune->enable_attr))
+		dev_err(hba->dev, "Failed to create sysfs for hibern8_on_idle_autotune\n");
+
+	tune->budget_attr.show = ufshcd_idle_tune_budget_show;
+	tune->budget_attr.store = ufshcd_idle_tune_budget_store;
+	sysfs_attr_init(&tune->budget_attr.attr);
+	tune->budget_attr.attr.name = "hibern8_on_idle_power_budget";
+	tune->budget_attr.attr.mode = S_IRUGO | S_IWUSR;
+	if (device_create_file(hba->dev, &tune->budget_attr))
+		dev_err(hba->dev, "Failed to create sysfs for hibern8_on_idle_power_budget\n");
+
+	tune->stats_attr.show = ufshcd_idle_tune_stats_show;
+	sysfs_attr_init(&tune->stats_attr.attr);
+	tune->stats_attr.attr.name = "hibern8_on_idle_autotune_stats";
+	tune->stats_attr.attr.mode = S_IRUGO;
+	if (device_create_file(hba->dev, &tune->stats_attr))
+		dev_err(hba->dev, "Failed to create sysfs for hibern8_on_idle_autotune_stats\n");
+}
+
 static void ufshcd_init_hibern8_on_idle(struct ufs_hba *hba)
 {
 	/* initialize the state variable here */
@@ -2353,6 +2753,8 @@ static void ufshcd_init_hibern8_on_idle(struct ufs_hba *hba)
 	hba->hibern8_on_idle.enable_attr.attr.mode = S_IRUGO | S_IWUSR;
 	if (device_create_file(hba->dev, &hba->hibern8_on_idle.enable_attr))
 		dev_err(hba->dev, "Failed to create sysfs for hibern8_on_idle_enable\n");
+
+	ufshcd_init_idle_tune(hba);
 }
 
 static void ufshcd_exit_hibern8_on_idle(struct ufs_hba *hba)
@@ -2362,6 +2764,10 @@ static void ufshcd_exit_hibern8_on_idle(struct ufs_hba *hba)
 		return;
 	device_remove_file(hba->dev, &hba->hibern8_on_idle.delay_attr);
 	device_remove_file(hba->dev, &hba->hibern8_on_idle.enable_attr);
+	device_remove_file(hba->dev, &hba->hibern8_on_idle.tune.enable_attr);
+	device_remove_file(hba->dev, &hba->hibern8_on_idle.tune.budget_attr);
+	device_remove_file(hba->dev, &hba->hibern8_on_idle.tune.stats_attr);
+	cancel_work_sync(&hba->hibern8_on_idle.tune.work);
 }
 
 static void ufshcd_hold_all(struct ufs_hba *hba)
@@ -2406,6 +2812,74 @@ static void ufshcd_clk_scaling_start_busy(struct ufs_hba *hba)
 	}
 }
 
+/*
+ * Queue depth mode thresholds. A burst at low gear scales up at once; a
+ * window with a deep queue or high bandwidth counts as fully loaded, and
+ * one with only a trickle of writes and flushes counts as idle.
+ */
+#define UFSHCD_QD_FAST_UP_DEPTH		8
+#define UFSHCD_QD_FAST_UP_BYTES		(1024 * 1024)
+#define UFSHCD_QD_HIGH_DEPTH		4
+#define UFSHCD_QD_HIGH_KBPS		(100 * 1024)
+#define UFSHCD_QD_TRICKLE_KBPS		(2 * 1024)
+
+/* Must be called with host lock acquired, before outstanding_reqs changes */
+static void ufshcd_clk_scaling_account_depth(struct ufs_hba *hba)
+{
+	struct ufs_clk_scaling *scaling = &hba->clk_scaling;
+	ktime_t now;
+
+	if (!ufshcd_is_clkscaling_supported(hba))
+		return;
+
+	now = ktime_get();
+	if (hba->outstanding_reqs)
+		scaling->depth_area += hweight_long(hba->outstanding_reqs) *
+				       ktime_us_delta(now, scaling->depth_t);
+	scaling->depth_t = now;
+}
+
+/* Must be called with host lock acquired, once @cmd has been issued */
+static void ufshcd_clk_scaling_qd_issue(struct ufs_hba *hba,
+					struct scsi_cmnd *cmd)
+{
+	struct ufs_clk_scaling *scaling = &hba->clk_scaling;
+	unsigned int bytes = scsi_bufflen(cmd);
+
+	if (!ufshcd_is_clkscaling_supported(hba))
+		return;
+
+	scaling->in_flight_bytes += bytes;
+	if (cmd->sc_data_direction == DMA_FROM_DEVICE)
+		scaling->read_bytes += bytes;
+	else
+		scaling->write_bytes += bytes;
+
+	if (!scaling->qd_mode || scaling->is_scaled_up ||
+	    scaling->fast_up_pending || !scaling->is_allowed ||
+	    scaling->is_suspended || hba->pm_op_in_progress)
+		return;
+
+	if (hweight_long(hba->outstanding_reqs) >= UFSHCD_QD_FAST_UP_DEPTH ||
+	    scaling->in_flight_bytes >= UFSHCD_QD_FAST_UP_BYTES) {
+		scaling->fast_up_pending = true;
+		queue_work(scaling->workq, &scaling->fast_up_work);
+	}
+}
+
+/* Must be called with host lock acquired */
+static void ufshcd_clk_scaling_qd_complete(struct ufs_hba *hba,
+					   struct scsi_cmnd *cmd)
+{
+	struct ufs_clk_scaling *scaling = &hba->clk_scaling;
+
+	if (!ufshcd_is_clkscaling_supported(hba))
+		return;
+
+	scaling->in_flight_bytes -= min_t(u64, scaling->in_flight_bytes,
+					  scsi_bufflen(cmd));
+}
+
 static void ufshcd_clk_scaling_update_busy(struct ufs_hba *hba)
 {
 	struct ufs_clk_scaling *scaling = &hba->clk_scaling;
@@ -2434,6 +2908,10 @@ int ufshcd_send_command(struct ufs_hba *hba, unsigned int task_tag)
 	hba->lrb[task_tag].issue_time_stamp = ktime_get();
 	hba->lrb[task_tag].complete_time_stamp = ktime_set(0, 0);
 	ufshcd_clk_scaling_start_busy(hba);
+	if (ufshcd_is_intr_aggr_adaptive(hba))
+		ufshcd_adapt_intr_aggr(hba);
+	ufshcd_clk_scaling_account_depth(hba);
+	ufshcd_idle_tune_end(hba);
 	__set_bit(task_tag, &hba->outstanding_reqs);
 	ufshcd_writel(hba, 1 << task_tag, REG_UTP_TRANSFER_REQ_DOOR_BELL);
 	/* Make sure that doorbell is committed immediately */
@@ -3198,7 +3676,7 @@ static int ufshcd_queuecommand(struct Scsi_Host *host, struct scsi_cmnd *cmd)
 	lrbp->sense_buffer = cmd->sense_buffer;
 	lrbp->task_tag = tag;
 	lrbp->lun = ufshcd_scsi_to_upiu_lun(cmd->device->lun);
-	lrbp->intr_cmd = !ufshcd_is_intr_aggr_allowed(hba) ? true : false;
+	lrbp->intr_cmd = ufshcd_intr_cmd_needed(hba);
 	lrbp->command_type = UTP_CMD_TYPE_SCSI;
 	lrbp->req_abort_skip = false;
 
@@ -3216,6 +3694,8 @@ static int ufshcd_queuecommand(struct Scsi_Host *host, struct scsi_cmnd *cmd)
 		goto out;
 	}
 
+	ufshpb_prep(hba, lrbp);
+
 	err = ufshcd_map_sg(hba, lrbp);
 	if (err) {
 		lrbp->cmd = NULL;
@@ -3260,6 +3740,7 @@ static int ufshcd_queuecommand(struct Scsi_Host *host, struct scsi_cmnd *cmd)
 		err = DID_ERROR;
 		goto out;
 	}
+	ufshcd_clk_scaling_qd_issue(hba, cmd);
 
 out_unlock:
 	spin_unlock_irqrestore(hba->host->host_lock, flags);
@@ -3546,21 +4027,12 @@ static int ufshcd_query_flag_retry(struct ufs_hba *hba,
 	return ret;
 }
 
-/**
- * ufshcd_query_flag() - API function for sending flag query requests
- * hba: per-adapter instance
- * query_opcode: flag query to perform
- * idn: flag idn to access
- * flag_res: the flag value after the query request completes
- *
- * Returns 0 for success, non-zero in case of failure
- */
-int ufshcd_query_flag(struct ufs_hba *hba, enum query_opcode opcode,
-			enum flag_idn idn, bool *flag_res)
+static int __ufshcd_query_flag(struct ufs_hba *hba, enum query_opcode opcode,
+			       enum flag_idn idn, u8 index, bool *flag_res)
 {
 	struct ufs_query_req *request = NULL;
 	struct ufs_query_res *response = NULL;
-	int err, index = 0, selector = 0;
+	int err, selector = 0;
 	int timeout = QUERY_REQ_TIMEOUT;
 	bool has_read_lock = false;
 
@@ -3619,6 +4091,21 @@ int ufshcd_query_flag(struct ufs_hba *hba, enum query_opcode opcode,
 	ufshcd_release_all(hba);
 	return err;
 }
+
+/**
+ * ufshcd_query_flag() - API function for sending flag query requests
+ * hba: per-adapter instance
+ * query_opcode: flag query to perform
+ * idn: flag idn to access
+ * flag_res: the flag value after the query request completes
+ *
+ * Returns 0 for success, non-zero in case of failure
+ */
+int ufshcd_query_flag(struct ufs_hba *hba, enum query_opcode opcode,
+			enum flag_idn idn, bool *flag_res)
+{
+	return __ufshcd_query_flag(hba, opcode, idn, 0, flag_res);
+}
 EXPORT_SYMBOL(ufshcd_query_flag);
 
 /**
@@ -3939,12 +4426,12 @@ EXPORT_SYMBOL(ufshcd_map_desc_id_to_length);
  *
  * Return 0 in case of success, non-zero otherwise
  */
-static int ufshcd_read_desc_param(struct ufs_hba *hba,
-				  enum desc_idn desc_id,
-				  int desc_index,
-				  u8 param_offset,
-				  u8 *param_read_buf,
-				  u8 param_size)
+int ufshcd_read_desc_param(struct ufs_hba *hba,
+			   enum desc_idn desc_id,
+			   int desc_index,
+			   u8 param_offset,
+			   u8 *param_read_buf,
+			   u8 param_size)
 {
 	int ret;
 	u8 *desc_buf;
@@ -5039,6 +5526,137 @@ static int ufshcd_complete_dev_init(struct ufs_hba *hba)
 	return err;
 }
 
+static int ufshcd_wb_set_flag(struct ufs_hba *hba, enum flag_idn idn,
+			      bool set)
+{
+	enum query_opcode opcode = set ? UPIU_QUERY_OPCODE_SET_FLAG :
+					 UPIU_QUERY_OPCODE_CLEAR_FLAG;
+	int retries;
+	int ret;
+
+	for (retries = 0; retries < QUERY_REQ_RETRIES; retries++) {
+		ret = __ufshcd_query_flag(hba, opcode, idn,
+					  ufshcd_wb_query_index(hba), NULL);
+		if (!ret)
+			break;
+	}
+
+	if (ret)
+		dev_err(hba->dev, "%s: %s flag idn %d failed %d\n",
+			__func__, set ? "setting" : "clearing", idn, ret);
+	return ret;
+}
+
+/**
+ * ufshcd_wb_probe - check whether the device has a usable WriteBooster buffer
+ * @hba: per-adapter instance
+ *
+ * WriteBooster is optional from UFS 2.2 on; a device that supports it but
+ * has no buffer allocated, shared or dedicated to a LU, is left alone.
+ */
+static void ufshcd_wb_probe(struct ufs_hba *hba)
+{
+	struct ufs_dev_info *dev_info = &hba->dev_info;
+	int len = hba->desc_size.dev_desc;
+	u8 *desc_buf;
+	u32 units;
+	int lun;
+
+	if (!(hba->caps & UFSHCD_CAP_WB_EN) ||
+	    dev_info->w_spec_version < 0x220 ||
+	    len < DEVICE_DESC_PARAM_WB_SHARED_ALLOC_UNITS + 4)
+		return;
+
+	desc_buf = kmalloc(len, GFP_KERNEL);
+	if (!desc_buf)
+		return;
+
+	if (ufshcd_read_device_desc(hba, desc_buf, len))
+		goto out;
+
+	dev_info->d_ext_ufs_feature_sup = get_unaligned_be32(
+			&desc_buf[DEVICE_DESC_PARAM_EXT_UFS_FEATURE_SUP]);
+	if (!(dev_info->d_ext_ufs_feature_sup & UFS_DEV_WRITE_BOOSTER_SUP))
+		goto out;
+
+	dev_info->b_wb_buffer_type = desc_buf[DEVICE_DESC_PARAM_WB_TYPE];
+	if (dev_info->b_wb_buffer_type == WB_BUF_MODE_SHARED) {
+		units = get_unaligned_be32(
+			&desc_buf[DEVICE_DESC_PARAM_WB_SHARED_ALLOC_UNITS]);
+		if (!units)
+			goto out;
+	} else {
+		for (lun = 0; lun < UFS_UPIU_MAX_GENERAL_LUN; lun++) {
+			__be32 val = 0;
+
+			if (ufshcd_read_unit_desc_param(hba, lun,
+					UNIT_DESC_PARAM_WB_BUF_ALLOC_UNITS,
+					(u8 *)&val, sizeof(val)))
+				continue;
+			if (be32_to_cpu(val)) {
+				dev_info->wb_dedicated_lu = lun;
+				break;
+			}
+		}
+		if (lun == UFS_UPIU_MAX_GENERAL_LUN)
+			goto out;
+	}
+
+	dev_info->wb_supported = true;
+out:
+	kfree(desc_buf);
+}
+
+/**
+ * ufshcd_wb_ctrl - turn WriteBooster on or off
+ * @hba: per-adapter instance
+ * @enable: new state
+ *
+ * Returns 0 on success or if WriteBooster is not in use, non-zero otherwise
+ */
+static int ufshcd_wb_ctrl(struct ufs_hba *hba, bool enable)
+{
+	int ret;
+
+	if (!ufshcd_is_wb_allowed(hba) || hba->dev_info.wb_enabled == enable)
+		return 0;
+
+	ret = ufshcd_wb_set_flag(hba, QUERY_FLAG_IDN_WB_EN, enable);
+	if (ret)
+		return ret;
+
+	hba->dev_info.wb_enabled = enable;
+	dev_dbg(hba->dev, "WriteBooster %s\n", enable ? "enabled" : "disabled");
+	return 0;
+}
+
+/**
+ * ufshcd_wb_config - enable WriteBooster once the device is initialized
+ * @hba: per-adapter instance
+ *
+ * The WriteBooster flags are volatile, so this has to run after every
+ * device reset. The buffer is flushed by the device whenever the link
+ * sits in hibern8, which covers both hibern8 on idle and auto hibern8.
+ */
+static void ufshcd_wb_config(struct ufs_hba *hba)
+{
+	ufshcd_wb_probe(hba);
+	if (!ufshcd_is_wb_allowed(hba))
+		return;
+
+	if (ufshcd_wb_ctrl(hba, true))
+		return;
+
+	if (!ufshcd_wb_set_flag(hba,
+			QUERY_FLAG_IDN_WB_BUFF_FLUSH_DURING_HIBERN8, true))
+		hba->dev_info.wb_flush_in_h8 = true;
+
+	dev_info(hba->dev, "WriteBooster enabled, %s buffer%s\n",
+		 hba->dev_info.b_wb_buffer_type == WB_BUF_MODE_SHARED ?
+		 "shared" : "LU dedicated",
+		 hba->dev_info.wb_flush_in_h8 ? ", flushed in hibern8" : "");
+}
+
 /**
  * ufshcd_make_hba_operational - Make UFS controller operational
  * @hba: per adapter instance
@@ -5060,9 +5678,10 @@ static int ufshcd_make_hba_operational(struct ufs_hba *hba)
 	ufshcd_enable_intr(hba, UFSHCD_ENABLE_INTRS);
 
 	/* Configure interrupt aggregation */
-	if (ufshcd_is_intr_aggr_allowed(hba))
+	if (ufshcd_is_intr_aggr_allowed(hba)) {
 		ufshcd_config_intr_aggr(hba, hba->nutrs - 1, INT_AGGR_DEF_TO);
-	else
+		hba->intr_aggr.cnt = hba->nutrs - 1;
+	} else
 		ufshcd_disable_intr_aggr(hba);
 
 	/* Configure UTRL and UTMRL base address registers */
@@ -5514,6 +6133,8 @@ static int ufshcd_slave_configure(struct scsi_device *sdev)
 	sdev->autosuspend_delay = UFSHCD_AUTO_SUSPEND_DELAY_MS;
 	sdev->use_rpm_auto = 1;
 
+	ufshpb_lu_init(hba, sdev, ufshcd_scsi_to_upiu_lun(sdev->lun));
+
 	return 0;
 }
 
@@ -5526,6 +6147,8 @@ static void ufshcd_slave_destroy(struct scsi_device *sdev)
 	struct ufs_hba *hba;
 
 	hba = shost_priv(sdev->host);
+	ufshpb_lu_destroy(hba, sdev, ufshcd_scsi_to_upiu_lun(sdev->lun));
+
 	/* Drop the reference as it won't be needed anymore */
 	if (ufshcd_scsi_to_upiu_lun(sdev->lun) == UFS_UPIU_UFS_DEVICE_WLUN) {
 		unsigned long flags;
@@ -5861,11 +6484,14 @@ static void __ufshcd_transfer_req_compl(struct ufs_hba *hba,
 			ufshcd_cond_add_cmd_trace(hba, index, "scsi_cmpl");
 			ufshcd_update_tag_stats_completion(hba, cmd);
 			result = ufshcd_transfer_rsp_status(hba, lrbp);
+			ufshpb_rsp(hba, lrbp, result);
 			scsi_dma_unmap(cmd);
 			cmd->result = result;
 			clear_bit_unlock(index, &hba->lrb_in_use);
 			lrbp->complete_time_stamp = ktime_get();
 			update_req_stats(hba, lrbp);
+			ufshcd_update_lat_hist(hba, lrbp);
+			ufshcd_clk_scaling_qd_complete(hba, cmd);
 			/* Mark completed command as NULL in LRB */
 			lrbp->cmd = NULL;
 			hba->ufs_stats.clk_rel.ctx = XFR_REQ_COMPL;
@@ -5913,7 +6539,10 @@ static void __ufshcd_transfer_req_compl(struct ufs_hba *hba,
 	}
 
 	/* clear corresponding bits of completed commands */
+	ufshcd_clk_scaling_account_depth(hba);
 	hba->outstanding_reqs ^= completed_reqs;
+	if (!hba->outstanding_reqs)
+		ufshcd_idle_tune_start(hba);
 
 	ufshcd_clk_scaling_update_busy(hba);
 
@@ -8029,6 +8658,9 @@ static int ufshcd_probe_hba(struct ufs_hba *hba)
 	int ret;
 	ktime_t start = ktime_get();
 
+	/* the device forgets its active HPB regions across a reset */
+	ufshpb_reset(hba);
+
 	ret = ufshcd_link_startup(hba);
 	if (ret)
 		goto out;
@@ -8060,6 +8692,7 @@ static int ufshcd_probe_hba(struct ufs_hba *hba)
 
 	/* Init check for device descriptor sizes */
 	ufshcd_init_desc_sizes(hba);
+	ufshcd_wb_config(hba);
 	ufs_advertise_fixup_device(hba);
 	ufshcd_tune_unipro_params(hba);
 
@@ -8139,6 +8772,7 @@ static int ufshcd_probe_hba(struct ufs_hba *hba)
 			hba->clk_scaling.is_allowed = true;
 		}
 
+		ufshpb_init(hba);
 		scsi_scan_host(hba->host);
 		pm_runtime_put_sync(hba->dev);
 	}
@@ -8616,6 +9250,7 @@ static struct scsi_host_template ufshcd_driver_template = {
 	.eh_device_reset_handler = ufshcd_eh_device_reset_handler,
 	.eh_host_reset_handler   = ufshcd_eh_host_reset_handler,
 	.eh_timed_out		= ufshcd_eh_timed_out,
+	.softirq_done		= ufshcd_softirq_done,
 	.ioctl			= ufshcd_ioctl,
 #ifdef CONFIG_COMPAT
 	.compat_ioctl		= ufshcd_ioctl,
@@ -8626,6 +9261,9 @@ static struct scsi_host_template ufshcd_driver_template = {
 	.can_queue		= UFSHCD_CAN_QUEUE,
 	.max_host_blocked	= 1,
 	.track_queue_depth	= 1,
+#ifdef CONFIG_SCSI_UFS_HPB
+	.sdev_attrs		= ufshpb_sdev_attrs,
+#endif
 };
 
 static int ufshcd_config_vreg_load(struct device *dev, struct ufs_vreg *vreg,
@@ -9404,6 +10042,7 @@ static int ufshcd_suspend(struct ufs_hba *hba, enum ufs_pm_op pm_op)
 	if (hba->clk_scaling.is_allowed) {
 		cancel_work_sync(&hba->clk_scaling.suspend_work);
 		cancel_work_sync(&hba->clk_scaling.resume_work);
+		cancel_work_sync(&hba->clk_scaling.fast_up_work);
 		ufshcd_suspend_clkscaling(hba);
 	}
 
@@ -9936,6 +10575,7 @@ static void __ufshcd_shutdown_clkscaling(struct ufs_hba *hba)
 	if (ufshcd_is_clkscaling_supported(hba)) {
 		cancel_work_sync(&hba->clk_scaling.suspend_work);
 		cancel_work_sync(&hba->clk_scaling.resume_work);
+		cancel_work_sync(&hba->clk_scaling.fast_up_work);
 		if (suspend)
 			ufshcd_suspend_clkscaling(hba);
 	}
@@ -9953,6 +10593,7 @@ static void ufshcd_shutdown_clkscaling(struct ufs_hba *hba)
 		return;
 	__ufshcd_shutdown_clkscaling(hba);
 	device_remove_file(hba->dev, &hba->clk_scaling.enable_attr);
+	device_remove_file(hba->dev, &hba->clk_scaling.qd_mode_attr);
 }
 
 /**
@@ -10043,17 +10684,178 @@ latency_hist_show(struct device *dev, struct device_attribute *attr,
 static DEVICE_ATTR(latency_hist, S_IRUGO | S_IWUSR,
 		   latency_hist_show, latency_hist_store);
 
+static ssize_t ufshcd_cmd_lat_hist_show(struct ufs_hba *hba,
+					enum ufs_lat_op op, char *buf)
+{
+	static const char * const sizes[UFS_LAT_SZ_MAX] = {
+		"4k", "16k", "64k", "256k", "large",
+	};
+	struct ufs_lat_hist *hist = hba->cmd_lat_hist;
+	u64 softirq[UFS_LAT_BUCKETS] = { };
+	int len, i, b, cpu;
+
+	len = scnprintf(buf, PAGE_SIZE, "%-8s", "lt_us");
+	for (b = 0; b < UFS_LAT_BUCKETS - 1; b++)
+		len += scnprintf(buf + len, PAGE_SIZE - len, " %u",
+				 UFS_LAT_MIN_US << b);
+	len += scnprintf(buf + len, PAGE_SIZE - len, " inf\n");
+
+	for (i = 0; i < UFS_LAT_SZ_MAX; i++) {
+		len += scnprintf(buf + len, PAGE_SIZE - len, "%-8s", sizes[i]);
+		for (b = 0; b < UFS_LAT_BUCKETS; b++)
+			len += scnprintf(buf + len, PAGE_SIZE - len, " %llu",
+					 hist->dbr_to_cmpl[op][i][b]);
+		len += scnprintf(buf + len, PAGE_SIZE - len, "\n");
+	}
+
+	for_each_possible_cpu(cpu)
+		for (b = 0; b < UFS_LAT_BUCKETS; b++)
+			softirq[b] += per_cpu_ptr(hist->cmpl_to_softirq,
+						  cpu)->cnt[op][b];
+	len += scnprintf(buf + len, PAGE_SIZE - len, "%-8s", "softirq");
+	for (b = 0; b < UFS_LAT_BUCKETS; b++)
+		len += scnprintf(buf + len, PAGE_SIZE - len, " %llu",
+				 softirq[b]);
+	len += scnprintf(buf + len, PAGE_SIZE - len, "\n");
+
+	return len;
+}
+
+#define UFSHCD_CMD_LAT_HIST_ATTR(_name, _op)				\
+static ssize_t ufshcd_cmd_lat_hist_##_name##_show(struct device *dev,	\
+		struct device_attribute *attr, char *buf)		\
+{									\
+	return ufshcd_cmd_lat_hist_show(dev_get_drvdata(dev), _op, buf);\
+}									\
+static struct device_attribute ufshcd_cmd_lat_hist_##_name =		\
+	__ATTR(_name, S_IRUGO, ufshcd_cmd_lat_hist_##_name##_show, NULL)
+
+UFSHCD_CMD_LAT_HIST_ATTR(read, UFS_LAT_OP_READ);
+UFSHCD_CMD_LAT_HIST_ATTR(write, UFS_LAT_OP_WRITE);
+UFSHCD_CMD_LAT_HIST_ATTR(unmap, UFS_LAT_OP_UNMAP);
+UFSHCD_CMD_LAT_HIST_ATTR(sync_cache, UFS_LAT_OP_SYNC_CACHE);
+UFSHCD_CMD_LAT_HIST_ATTR(other, UFS_LAT_OP_OTHER);
+
+static ssize_t ufshcd_cmd_lat_hist_enable_show(struct device *dev,
+		struct device_attribute *attr, char *buf)
+{
+	struct ufs_hba *hba = dev_get_drvdata(dev);
+
+	return snprintf(buf, PAGE_SIZE, "%d\n", hba->cmd_lat_hist->enabled);
+}
+
+static ssize_t ufshcd_cmd_lat_hist_enable_store(struct device *dev,
+		struct device_attribute *attr, const char *buf, size_t count)
+{
+	struct ufs_hba *hba = dev_get_drvdata(dev);
+	bool value;
+
+	if (strtobool(buf, &value))
+		return -EINVAL;
+
+	hba->cmd_lat_hist->enabled = value;
+	return count;
+}
+
+static struct device_attribute ufshcd_cmd_lat_hist_enable =
+	__ATTR(enable, S_IRUGO | S_IWUSR, ufshcd_cmd_lat_hist_enable_show,
+	       ufshcd_cmd_lat_hist_enable_store);
+
+/* Any write zeroes the histogram */
+static ssize_t ufshcd_cmd_lat_hist_reset_store(struct device *dev,
+		struct device_attribute *attr, const char *buf, size_t count)
+{
+	struct ufs_hba *hba = dev_get_drvdata(dev);
+	struct ufs_lat_hist *hist = hba->cmd_lat_hist;
+	unsigned long flags;
+	int cpu;
+
+	spin_lock_irqsave(hba->host->host_lock, flags);
+	memset(hist->dbr_to_cmpl, 0, sizeof(hist->dbr_to_cmpl));
+	spin_unlock_irqrestore(hba->host->host_lock, flags);
+
+	for_each_possible_cpu(cpu)
+		memset(per_cpu_ptr(hist->cmpl_to_softirq, cpu), 0,
+		       sizeof(struct ufs_lat_softirq_hist));
+
+	return count;
+}
+
+static struct device_attribute ufshcd_cmd_lat_hist_reset =
+	__ATTR(reset, S_IWUSR, NULL, ufshcd_cmd_lat_hist_reset_store);
+
+static struct attribute *ufshcd_cmd_lat_hist_attrs[] = {
+	&ufshcd_cmd_lat_hist_enable.attr,
+	&ufshcd_cmd_lat_hist_reset.attr,
+	&ufshcd_cmd_lat_hist_read.attr,
+	&ufshcd_cmd_lat_hist_write.attr,
+	&ufshcd_cmd_lat_hist_unmap.attr,
+	&ufshcd_cmd_lat_hist_sync_cache.attr,
+	&ufshcd_cmd_lat_hist_other.attr,
+	NULL,
+};
+
+/*
+ * Per opcode latency histograms, always built in and enabled by default.
+ * Each opcode file has one row per transfer size with the doorbell to
+ * completion times, followed by a row with the completion interrupt to
+ * softirq times.
+ */
+static const struct attribute_group ufshcd_cmd_lat_hist_group = {
+	.name	= "cmd_lat_hist",
+	.attrs	= ufshcd_cmd_lat_hist_attrs,
+};
+
+static void ufshcd_init_cmd_lat_hist(struct ufs_hba *hba)
+{
+	struct ufs_lat_hist *hist;
+
+	hist = devm_kzalloc(hba->dev, sizeof(*hist), GFP_KERNEL);
+	if (!hist)
+		goto err;
+
+	hist->cmpl_to_softirq = alloc_percpu(struct ufs_lat_softirq_hist);
+	if (!hist->cmpl_to_softirq) {
+		devm_kfree(hba->dev, hist);
+		goto err;
+	}
+
+	hist->enabled = true;
+	hba->cmd_lat_hist = hist;
+
+	if (sysfs_create_group(&hba->dev->kobj, &ufshcd_cmd_lat_hist_group))
+		dev_err(hba->dev, "Failed to create cmd_lat_hist sysfs group\n");
+	return;
+err:
+	dev_err(hba->dev, "Failed to allocate command latency histogram\n");
+}
+
+static void ufshcd_exit_cmd_lat_hist(struct ufs_hba *hba)
+{
+	struct ufs_lat_hist *hist = hba->cmd_lat_hist;
+
+	if (!hist)
+		return;
+
+	sysfs_remove_group(&hba->dev->kobj, &ufshcd_cmd_lat_hist_group);
+	hba->cmd_lat_hist = NULL;
+	free_percpu(hist->cmpl_to_softirq);
+	devm_kfree(hba->dev, hist);
+}
+
 static void
 ufshcd_init_latency_hist(struct ufs_hba *hba)
 {
 	if (device_create_file(hba->dev, &dev_attr_latency_hist))
 		dev_err(hba->dev, "Failed to create latency_hist sysfs entry\n");
+	ufshcd_init_cmd_lat_hist(hba);
 }
 
 static void
 ufshcd_exit_latency_hist(struct ufs_hba *hba)
 {
 	device_create_file(hba->dev, &dev_attr_latency_hist);
+	ufshcd_exit_cmd_lat_hist(hba);
 }
 
 /**
@@ -10073,6 +10875,8 @@ void ufshcd_remove(struct ufs_hba *hba)
 	ufshcd_exit_latency_hist(hba);
 	if (ufshcd_is_clkscaling_supported(hba)) {
 		device_remove_file(hba->dev, &hba->clk_scaling.enable_attr);
+		device_remove_file(hba->dev, &hba->clk_scaling.qd_mode_attr);
+		cancel_work_sync(&hba->clk_scaling.fast_up_work);
 		if (hba->devfreq)
 			devfreq_remove_device(hba->devfreq);
 	}
@@ -10360,6 +11164,9 @@ static int ufshcd_devfreq_scale(struct ufs_hba *hba, bool scale_up)
 
 	if (!ret) {
 		hba->clk_scaling.is_scaled_up = scale_up;
+		/* a self-tuned gating delay applies at either gear */
+		if (hba->hibern8_on_idle.tune.enabled)
+			goto clk_scaling_unprepare;
 		if (scale_up)
 			hba->clk_gating.delay_ms =
 				hba->clk_gating.delay_ms_perf;
@@ -10375,6 +11182,12 @@ static int ufshcd_devfreq_scale(struct ufs_hba *hba, bool scale_up)
 		ufshcd_scale_gear(hba, true);
 clk_scaling_unprepare:
 	ufshcd_clock_scaling_unprepare(hba);
+	/*
+	 * WriteBooster follows the gear. The query needs hba->lock, so this
+	 * can only be done once scaling has released it.
+	 */
+	if (!ret)
+		ufshcd_wb_ctrl(hba, scale_up);
 out:
 	hba->ufs_stats.clk_rel.ctx = CLK_SCALE_WORK;
 	ufshcd_release_all(hba);
@@ -10511,6 +11324,25 @@ static void ufshcd_clk_scaling_resume_work(struct work_struct *work)
 	devfreq_resume_device(hba->devfreq);
 }
 
+static void ufshcd_clk_scaling_fast_up_work(struct work_struct *work)
+{
+	struct ufs_hba *hba = container_of(work, struct ufs_hba,
+					   clk_scaling.fast_up_work);
+	struct devfreq *devfreq = hba->devfreq;
+	unsigned long irq_flags;
+
+	/* the load reported while fast_up_pending is set scales up */
+	if (devfreq) {
+		mutex_lock(&devfreq->lock);
+		update_devfreq(devfreq);
+		mutex_unlock(&devfreq->lock);
+	}
+
+	spin_lock_irqsave(hba->host->host_lock, irq_flags);
+	hba->clk_scaling.fast_up_pending = false;
+	spin_unlock_irqrestore(hba->host->host_lock, irq_flags);
+}
+
 static int ufshcd_devfreq_target(struct device *dev,
 				unsigned long *freq, u32 flags)
 {
@@ -10559,6 +11391,61 @@ static int ufshcd_devfreq_target(struct device *dev,
 	return ret;
 }
 
+/*
+ * Must be called with host lock acquired. Traces the load of the window
+ * that just ended and, in queue depth mode, replaces the busy time handed
+ * to the governor with one that also reflects queue depth, bandwidth and
+ * the read/write mix.
+ */
+static void ufshcd_clk_scaling_shape_load(struct ufs_hba *hba,
+					  struct devfreq_dev_status *stat)
+{
+	struct ufs_clk_scaling *scaling = &hba->clk_scaling;
+	u64 bytes = scaling->read_bytes + scaling->write_bytes;
+	u32 busy_pct, depth16, kbps, read_pct, load;
+	const char *reason;
+
+	if (!stat->total_time)
+		return;
+
+	busy_pct = min_t(u64, div_u64((u64)stat->busy_time * 100,
+				      stat->total_time), 100);
+	depth16 = div_u64(scaling->depth_area << 4, stat->total_time);
+	kbps = div_u64((bytes * USEC_PER_SEC) >> 10, stat->total_time);
+	read_pct = bytes ? div64_u64(scaling->read_bytes * 100, bytes) : 0;
+
+	if (!scaling->qd_mode) {
+		reason = "busy_time";
+		load = busy_pct;
+	} else if (scaling->fast_up_pending) {
+		reason = "burst";
+		load = 100;
+	} else if (depth16 >= UFSHCD_QD_HIGH_DEPTH << 4) {
+		reason = "depth";
+		load = 100;
+	} else if (kbps >= UFSHCD_QD_HIGH_KBPS) {
+		reason = "bandwidth";
+		load = 100;
+	} else if (read_pct >= 50) {
+		/* reads are latency bound, leave them to busy time */
+		reason = "reads";
+		load = busy_pct;
+	} else if (depth16 <= 1 << 4 && kbps < UFSHCD_QD_TRICKLE_KBPS) {
+		/* e.g. a trickle of fsyncs: busy, but low gear keeps up */
+		reason = "trickle";
+		load = 0;
+	} else {
+		reason = "busy_time";
+		load = busy_pct;
+	}
+
+	trace_ufshcd_clk_scaling_load(dev_name(hba->dev), reason, busy_pct,
+				      depth16, kbps, read_pct, load);
+
+	if (scaling->qd_mode)
+		stat->busy_time = div_u64((u64)stat->total_time * load, 100);
+}
+
 static int ufshcd_devfreq_get_dev_status(struct device *dev,
 		struct devfreq_dev_status *stat)
 {
@@ -10582,9 +11469,17 @@ static int ufshcd_devfreq_get_dev_status(struct device *dev,
 	stat->total_time = jiffies_to_usecs((long)jiffies -
 				(long)scaling->window_start_t);
 	stat->busy_time = scaling->tot_busy_t;
+	ufshcd_clk_scaling_account_depth(hba);
+	ufshcd_clk_scaling_shape_load(hba, stat);
 start_window:
 	scaling->window_start_t = jiffies;
 	scaling->tot_busy_t = 0;
+	scaling->depth_area = 0;
+	scaling->depth_t = ktime_get();
+	scaling->read_bytes = 0;
+	scaling->write_bytes = 0;
+	if (!hba->outstanding_reqs)
+		scaling->in_flight_bytes = 0;
 
 	if (hba->outstanding_reqs) {
 		scaling->busy_start_t = ktime_get();
@@ -10597,6 +11492,30 @@ static int ufshcd_devfreq_get_dev_status(struct device *dev,
 	return 0;
 }
 
+static ssize_t ufshcd_clkscale_qd_mode_show(struct device *dev,
+		struct device_attribute *attr, char *buf)
+{
+	struct ufs_hba *hba = dev_get_drvdata(dev);
+
+	return snprintf(buf, PAGE_SIZE, "%d\n", hba->clk_scaling.qd_mode);
+}
+
+static ssize_t ufshcd_clkscale_qd_mode_store(struct device *dev,
+		struct device_attribute *attr, const char *buf, size_t count)
+{
+	struct ufs_hba *hba = dev_get_drvdata(dev);
+	unsigned long flags;
+	u32 value;
+
+	if (kstrtou32(buf, 0, &value))
+		return -EINVAL;
+
+	spin_lock_irqsave(hba->host->host_lock, flags);
+	hba->clk_scaling.qd_mode = !!value;
+	spin_unlock_irqrestore(hba->host->host_lock, flags);
+	return count;
+}
+
 static void ufshcd_clkscaling_init_sysfs(struct ufs_hba *hba)
 {
 	hba->clk_scaling.enable_attr.show = ufshcd_clkscale_enable_show;
@@ -10606,6 +11525,14 @@ static void ufshcd_clkscaling_init_sysfs(struct ufs_hba *hba)
 	hba->clk_scaling.enable_attr.attr.mode = S_IRUGO | S_IWUSR;
 	if (device_create_file(hba->dev, &hba->clk_scaling.enable_attr))
 		dev_err(hba->dev, "Failed to create sysfs for clkscale_enable\n");
+
+	hba->clk_scaling.qd_mode_attr.show = ufshcd_clkscale_qd_mode_show;
+	hba->clk_scaling.qd_mode_attr.store = ufshcd_clkscale_qd_mode_store;
+	sysfs_attr_init(&hba->clk_scaling.qd_mode_attr.attr);
+	hba->clk_scaling.qd_mode_attr.attr.name = "clkscale_qd_mode";
+	hba->clk_scaling.qd_mode_attr.attr.mode = S_IRUGO | S_IWUSR;
+	if (device_create_file(hba->dev, &hba->clk_scaling.qd_mode_attr))
+		dev_err(hba->dev, "Failed to create sysfs for clkscale_qd_mode\n");
 }
 
 static void ufshcd_init_lanes_per_dir(struct ufs_hba *hba)
@@ -10787,6 +11714,8 @@ int ufshcd_init(struct ufs_hba *hba, void __iomem *mmio_base, unsigned int irq)
 			  ufshcd_clk_scaling_suspend_work);
 		INIT_WORK(&hba->clk_scaling.resume_work,
 			  ufshcd_clk_scaling_resume_work);
+		INIT_WORK(&hba->clk_scaling.fast_up_work,
+			  ufshcd_clk_scaling_fast_up_work);
 
 		snprintf(wq_name, ARRAY_SIZE(wq_name), "ufs_clkscaling_%d",
 			 host->host_no);
@@ -72,6 +72,7 @@
 #include <linux/fault-inject.h>
 #include "ufs.h"
 #include "ufshci.h"
+#include "ufshpb.h"
 
 #define UFSHCD "ufshcd"
 #define UFSHCD_DRIVER_VERSION "0.3"
@@ -195,6 +196,7 @@ struct ufs_pm_lvl_states {
  * @issue_time_stamp: time stamp for debug purposes
  * @complete_time_stamp: time stamp for statistics
  * @req_abort_skip: skip request abort task flag
+ * @hpb_read: command was issued as an HPB READ
  */
 struct ufshcd_lrb {
 	struct utp_transfer_req_desc *utr_descriptor_ptr;
@@ -220,6 +222,9 @@ struct ufshcd_lrb {
 	ktime_t complete_time_stamp;
 
 	bool req_abort_skip;
+#ifdef CONFIG_SCSI_UFS_HPB
+	bool hpb_read;
+#endif
 };
 
 /**
@@ -458,6 +463,48 @@ enum ufshcd_hibern8_on_idle_state {
 	AUTO_HIBERN8,
 };
 
+/* idle gap histogram: bucket 0 is < 512us, bucket i is [256 << i, 512 << i) */
+#define UFS_IDLE_GAP_MIN_SHIFT		8
+#define UFS_IDLE_GAP_BUCKETS		16
+/* candidate delays are 1, 2, 4, ... 64 ms */
+#define UFS_IDLE_TUNE_DELAYS		7
+
+/**
+ * struct ufs_idle_tune - self-tuning of hibern8 on idle and clock gating delays
+ * @enabled: pick delays from @gap_hist instead of using the sysfs values
+ * @power_budget_pct: share of the idle time the link may stay active
+ * @saved_delay_ms: hibern8 enter delay to restore when self-tuning stops
+ * @idle_start: when the doorbell last became empty, 0 while busy
+ * @gap_hist: histogram of the time between doorbell empty and the next request
+ * @gap_cnt: gaps recorded since the last evaluation
+ * @h8_delay_ms: hibern8 enter delay picked by the last evaluation
+ * @gate_delay_ms: clock gating delay picked by the last evaluation
+ * @exit_cnt: hibern8 exits a request had to wait for
+ * @exit_us: accumulated time spent in those exits
+ * @tunes: number of evaluations that changed the delays
+ * @work: evaluates @gap_hist and applies the result
+ * @enable_attr: sysfs attribute to enable/disable self-tuning
+ * @budget_attr: sysfs attribute to control @power_budget_pct
+ * @stats_attr: sysfs attribute exporting the chosen delays and penalties
+ */
+struct ufs_idle_tune {
+	bool enabled;
+	u32 power_budget_pct;
+	unsigned long saved_delay_ms;
+	ktime_t idle_start;
+	u32 gap_hist[UFS_IDLE_GAP_BUCKETS];
+	u32 gap_cnt;
+	unsigned long h8_delay_ms;
+	unsigned long gate_delay_ms;
+	u64 exit_cnt;
+	u64 exit_us;
+	u32 tunes;
+	struct work_struct work;
+	struct device_attribute enable_attr;
+	struct device_attribute budget_attr;
+	struct device_attribute stats_attr;
+};
+
 /**
  * struct ufs_hibern8_on_idle - UFS Hibern8 on idle related data
  * @enter_work: worker to put UFS link in hibern8 after some delay as
@@ -472,6 +519,7 @@ enum ufshcd_hibern8_on_idle_state {
  * @delay_attr: sysfs attribute to control delay_attr
  * @enable_attr: sysfs attribute to enable/disable hibern8 on idle
  * @is_enabled: Indicates the current status of hibern8
+ * @tune: idle gap statistics used to pick hibern8 and clock gating delays
  */
 struct ufs_hibern8_on_idle {
 	struct delayed_work enter_work;
@@ -483,6 +531,7 @@ struct ufs_hibern8_on_idle {
 	struct device_attribute delay_attr;
 	struct device_attribute enable_attr;
 	bool is_enabled;
+	struct ufs_idle_tune tune;
 };
 
 struct ufs_saved_pwr_info {
@@ -508,6 +557,18 @@ struct ufs_saved_pwr_info {
  * @is_busy_started: tracks if busy period has started or not
  * @is_suspended: tracks if devfreq is suspended or not
  * @is_scaled_up: tracks if we are currently scaled up or scaled down
+ * @qd_mode: let queue depth, bandwidth and read/write mix shape the load
+ * reported to devfreq, instead of busy time alone
+ * @fast_up_pending: @fast_up_work is queued or running
+ * @qd_mode_attr: sysfs attribute for @qd_mode
+ * @fast_up_work: re-evaluates devfreq right away when a burst of requests
+ * arrives at low gear
+ * @depth_area: outstanding requests integrated over the current polling
+ * window, in request-microseconds
+ * @depth_t: last time @depth_area was brought up to date
+ * @in_flight_bytes: bytes of the SCSI requests currently outstanding
+ * @read_bytes: bytes read in the current polling window
+ * @write_bytes: bytes written in the current polling window
  */
 struct ufs_clk_scaling {
 	int active_reqs;
@@ -523,6 +584,15 @@ struct ufs_clk_scaling {
 	bool is_busy_started;
 	bool is_suspended;
 	bool is_scaled_up;
+	bool qd_mode;
+	bool fast_up_pending;
+	struct device_attribute qd_mode_attr;
+	struct work_struct fast_up_work;
+	u64 depth_area;
+	ktime_t depth_t;
+	u64 in_flight_bytes;
+	u64 read_bytes;
+	u64 write_bytes;
 };
 
 #define UIC_ERR_REG_HIST_LENGTH 20
@@ -557,6 +627,7 @@ struct debugfs_files {
 	u32 dme_peer_attr_id;
 	struct dentry *reset_controller;
 	struct dentry *err_state;
+	struct dentry *write_booster;
 	bool err_occurred;
 #ifdef CONFIG_UFS_FAULT_INJECTION
 	struct dentry *err_inj_scenario;
@@ -610,6 +681,63 @@ struct ufshcd_clk_ctx {
 	enum ufshcd_ctx ctx;
 };
 
+/**
+ * struct ufs_intr_aggr - adaptive interrupt aggregation state
+ * @depth_avg: average queue depth seen by new requests, in 1/16 units
+ * @cnt: counter threshold currently programmed
+ *
+ * Both are protected by the host lock.
+ */
+struct ufs_intr_aggr {
+	unsigned int depth_avg;
+	u8 cnt;
+};
+
+/* Opcode classes of the command latency histogram */
+enum ufs_lat_op {
+	UFS_LAT_OP_READ,
+	UFS_LAT_OP_WRITE,
+	UFS_LAT_OP_UNMAP,
+	UFS_LAT_OP_SYNC_CACHE,
+	UFS_LAT_OP_OTHER,
+	UFS_LAT_OP_MAX,
+};
+
+/* Transfer size classes of the command latency histogram */
+enum ufs_lat_size {
+	UFS_LAT_SZ_4K,
+	UFS_LAT_SZ_16K,
+	UFS_LAT_SZ_64K,
+	UFS_LAT_SZ_256K,
+	UFS_LAT_SZ_LARGE,
+	UFS_LAT_SZ_MAX,
+};
+
+/*
+ * Bucket 0 counts latencies below UFS_LAT_MIN_US, bucket n those below
+ * UFS_LAT_MIN_US << n, and the last bucket everything slower.
+ */
+#define UFS_LAT_MIN_US		16
+#define UFS_LAT_BUCKETS		16
+
+struct ufs_lat_softirq_hist {
+	u64 cnt[UFS_LAT_OP_MAX][UFS_LAT_BUCKETS];
+};
+
+/**
+ * struct ufs_lat_hist - command latency histogram
+ * @dbr_to_cmpl: doorbell to completion interrupt, by opcode and size.
+ *	Updated under the host lock.
+ * @cmpl_to_softirq: completion interrupt to the block completion softirq,
+ *	by opcode. Per cpu, as the softirq runs without the host lock.
+ * @enabled: histogram is being updated
+ */
+struct ufs_lat_hist {
+	u64 dbr_to_cmpl[UFS_LAT_OP_MAX][UFS_LAT_SZ_MAX][UFS_LAT_BUCKETS];
+	struct ufs_lat_softirq_hist __percpu *cmpl_to_softirq;
+	bool enabled;
+};
+
 /**
  * struct ufs_stats - keeps usage/err statistics
  * @enabled: enable tag stats for debugfs
@@ -970,6 +1098,16 @@ struct ufs_hba {
 	 * in hibern8 then enable this cap.
 	 */
 #define UFSHCD_CAP_POWER_COLLAPSE_DURING_HIBERN8 (1 << 7)
+	/*
+	 * Allow WriteBooster on devices that support it. WriteBooster is
+	 * kept on at high gear and off at low gear when clocks are scaled.
+	 */
+#define UFSHCD_CAP_WB_EN (1 << 8)
+	/*
+	 * Interrupt aggregation whose counter threshold follows the average
+	 * queue depth; a request issued to an idle queue is never aggregated.
+	 */
+#define UFSHCD_CAP_INTR_AGGR_ADAPTIVE (1 << 9)
 
 	struct devfreq *devfreq;
 	struct ufs_clk_scaling clk_scaling;
@@ -994,8 +1132,15 @@ struct ufs_hba {
 	int latency_hist_enabled;
 	struct io_latency_state io_lat_read;
 	struct io_latency_state io_lat_write;
+	struct ufs_lat_hist *cmd_lat_hist;
+	struct ufs_intr_aggr intr_aggr;
 	struct ufs_desc_size desc_size;
 	bool restore_needed;
+
+#ifdef CONFIG_SCSI_UFS_HPB
+	struct ufshpb_dev_info hpb_dev;
+	struct ufshpb_lu *hpb_lup[UFS_UPIU_MAX_GENERAL_LUN];
+#endif
 };
 
 static inline void ufshcd_mark_shutdown_ongoing(struct ufs_hba *hba)
@@ -1042,15 +1187,35 @@ static inline bool ufshcd_keep_autobkops_enabled_except_suspend(
 	return hba->caps & UFSHCD_CAP_KEEP_AUTO_BKOPS_ENABLED_EXCEPT_SUSPEND;
 }
 
+static inline bool ufshcd_is_wb_allowed(struct ufs_hba *hba)
+{
+	return (hba->caps & UFSHCD_CAP_WB_EN) && hba->dev_info.wb_supported;
+}
+
+/* WriteBooster flags and attributes address the buffer's LU, if dedicated */
+static inline u8 ufshcd_wb_query_index(struct ufs_hba *hba)
+{
+	if (hba->dev_info.b_wb_buffer_type == WB_BUF_MODE_LU_DEDICATED)
+		return hba->dev_info.wb_dedicated_lu;
+	return 0;
+}
+
 static inline bool ufshcd_is_intr_aggr_allowed(struct ufs_hba *hba)
 {
-	if ((hba->caps & UFSHCD_CAP_INTR_AGGR) &&
+	if ((hba->caps &
+	     (UFSHCD_CAP_INTR_AGGR | UFSHCD_CAP_INTR_AGGR_ADAPTIVE)) &&
 	    !(hba->quirks & UFSHCD_QUIRK_BROKEN_INTR_AGGR))
 		return true;
 	else
 		return false;
 }
 
+static inline bool ufshcd_is_intr_aggr_adaptive(struct ufs_hba *hba)
+{
+	return ufshcd_is_intr_aggr_allowed(hba) &&
+	       (hba->caps & UFSHCD_CAP_INTR_AGGR_ADAPTIVE);
+}
+
 static inline bool ufshcd_is_auto_hibern8_supported(struct ufs_hba *hba)
 {
 	return !!((hba->capabilities & MASK_AUTO_HIBERN8_SUPPORT) &&
@@ -1248,6 +1413,8 @@ void ufshcd_abort_outstanding_transfer_requests(struct ufs_hba *hba,
 
 int ufshcd_map_desc_id_to_length(struct ufs_hba *hba, enum desc_idn desc_id,
 	int *desc_length);
+int ufshcd_read_desc_param(struct ufs_hba *hba, enum desc_idn desc_id,
+	int desc_index, u8 param_offset, u8 *param_read_buf, u8 param_size);
 
 u32 ufshcd_get_local_unipro_ver(struct ufs_hba *hba);
 
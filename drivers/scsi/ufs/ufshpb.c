@@ -0,0 +1,806 @@
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 and
+ * only version 2 as published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * UFS Host Performance Booster (HPB) in host control mode.
+ *
+ * The logical space of an HPB enabled LU is split into regions, which are
+ * split further into subregions. Once a subregion was read often enough,
+ * its part of the device's L2P map is fetched with HPB READ BUFFER and
+ * kept in host memory; single block reads that hit a clean entry of a
+ * loaded map are then sent as HPB READ carrying the physical page number.
+ * Writes and discards only mark the entries they touch dirty, so those
+ * blocks go back to plain READ until the subregion is reloaded.
+ *
+ * Regions are activated on demand and evicted in LRU order once either the
+ * LU's active region limit or the host memory budget for maps is reached.
+ * Pinned regions from the unit descriptor are loaded up front and never
+ * evicted. All map loading and eviction happens from a per-LU work item;
+ * the I/O path only looks entries up under the LU spinlock.
+ */
+
+#include <linux/module.h>
+#include <linux/slab.h>
+#include <linux/vmalloc.h>
+#include <linux/bitmap.h>
+#include <asm/unaligned.h>
+#include <scsi/scsi_device.h>
+#include <scsi/scsi_eh.h>
+
+#include "ufshcd.h"
+
+static unsigned int ufshpb_map_budget_kb = 16 * 1024;
+module_param_named(map_budget_kb, ufshpb_map_budget_kb, uint, 0444);
+MODULE_PARM_DESC(map_budget_kb,
+		 "Host memory in KB each LU may spend on cached HPB maps");
+
+static unsigned int ufshpb_activate_reads = 4;
+module_param_named(activate_reads, ufshpb_activate_reads, uint, 0644);
+MODULE_PARM_DESC(activate_reads,
+		 "Missed reads of a subregion before its map is loaded");
+
+#define UFSHPB_CMD_TIMEOUT	(10 * HZ)
+#define UFSHPB_CMD_RETRIES	3
+
+/**
+ * struct ufshpb_srgn - one subregion of the L2P map
+ * @map: cached entries, NULL unless loaded
+ * @dirty: entries written since @map was fetched
+ * @new_map: buffer of a load in flight
+ * @new_dirty: entries written while that load was in flight
+ * @load_node: entry in ufshpb_lu.load_list
+ * @reads: missed reads since the last load
+ * @queued: on the load list
+ */
+struct ufshpb_srgn {
+	__be64 *map;
+	unsigned long *dirty;
+	__be64 *new_map;
+	unsigned long *new_dirty;
+	struct list_head load_node;
+	unsigned int reads;
+	bool queued;
+};
+
+/**
+ * struct ufshpb_rgn - one region, the unit of activation
+ * @srgns: first subregion of this region
+ * @nr_srgns: number of subregions, smaller for the last region
+ * @lru_node: entry in ufshpb_lu.lru while active and not pinned
+ * @active: region is active on the device
+ * @pinned: region is never evicted
+ */
+struct ufshpb_rgn {
+	struct ufshpb_srgn *srgns;
+	unsigned int nr_srgns;
+	struct list_head lru_node;
+	bool active;
+	bool pinned;
+};
+
+/**
+ * struct ufshpb_lu - HPB state of one logical unit
+ * @sdev: SCSI device of the LU
+ * @lock: protects everything below except the work item
+ * @rgns: all regions
+ * @srgns: all subregions, in LBA order
+ * @nr_rgns: number of regions
+ * @nr_srgns: number of subregions
+ * @rgn_shift: log2 of blocks per region
+ * @srgn_shift: log2 of blocks per subregion
+ * @max_active_rgns: active region limit of the LU
+ * @max_loaded_srgns: subregion maps the memory budget allows
+ * @nr_active_rgns: regions currently active
+ * @nr_loaded_srgns: subregion maps currently held
+ * @lru: active unpinned regions, most recently used first
+ * @load_list: subregions waiting for their map
+ * @load_work: loads maps and evicts regions
+ * @gen: bumped whenever the device may have dropped its active regions
+ * @stopping: LU is going away, no new loads
+ */
+struct ufshpb_lu {
+	struct scsi_device *sdev;
+	spinlock_t lock;
+
+	struct ufshpb_rgn *rgns;
+	struct ufshpb_srgn *srgns;
+	unsigned int nr_rgns;
+	unsigned int nr_srgns;
+	unsigned int rgn_shift;
+	unsigned int srgn_shift;
+
+	unsigned int max_active_rgns;
+	unsigned int max_loaded_srgns;
+	unsigned int nr_active_rgns;
+	unsigned int nr_loaded_srgns;
+	struct list_head lru;
+	struct list_head load_list;
+	struct work_struct load_work;
+	unsigned int gen;
+	bool stopping;
+
+	/* statistics */
+	u64 hit_cnt;
+	u64 miss_cnt;
+	u64 map_req_cnt;
+	u64 rb_fail_cnt;
+	u64 evict_cnt;
+	u64 read_fail_cnt;
+};
+
+static inline unsigned int ufshpb_srgn_entries(struct ufshpb_lu *hpb)
+{
+	return 1U << hpb->srgn_shift;
+}
+
+static inline unsigned int ufshpb_srgn_idx(struct ufshpb_lu *hpb,
+					   struct ufshpb_srgn *srgn)
+{
+	return srgn - hpb->srgns;
+}
+
+static inline struct ufshpb_rgn *ufshpb_srgn_rgn(struct ufshpb_lu *hpb,
+						 unsigned int idx)
+{
+	return &hpb->rgns[idx >> (hpb->rgn_shift - hpb->srgn_shift)];
+}
+
+static inline struct ufshpb_lu *ufshpb_get_lu(struct ufs_hba *hba, u8 lun)
+{
+	if (lun >= UFS_UPIU_MAX_GENERAL_LUN)
+		return NULL;
+	return READ_ONCE(hba->hpb_lup[lun]);
+}
+
+/* Called with hpb->lock held */
+static void ufshpb_set_dirty(struct ufshpb_lu *hpb, u64 lba, u64 cnt)
+{
+	unsigned int entries = ufshpb_srgn_entries(hpb);
+
+	while (cnt) {
+		u64 idx = lba >> hpb->srgn_shift;
+		unsigned int off = lba & (entries - 1);
+		unsigned int len = min_t(u64, cnt, entries - off);
+		struct ufshpb_srgn *srgn;
+
+		if (idx >= hpb->nr_srgns)
+			break;
+
+		srgn = &hpb->srgns[idx];
+		if (srgn->map)
+			bitmap_set(srgn->dirty, off, len);
+		if (srgn->new_map)
+			bitmap_set(srgn->new_dirty, off, len);
+
+		lba += len;
+		cnt -= len;
+	}
+}
+
+/* Called with hpb->lock held */
+static void ufshpb_queue_srgn(struct ufshpb_lu *hpb, struct ufshpb_srgn *srgn)
+{
+	if (srgn->queued || hpb->stopping)
+		return;
+
+	srgn->queued = true;
+	list_add_tail(&srgn->load_node, &hpb->load_list);
+}
+
+/* Called with hpb->lock held */
+static void ufshpb_drop_rgn(struct ufshpb_lu *hpb, struct ufshpb_rgn *rgn)
+{
+	unsigned int i;
+
+	for (i = 0; i < rgn->nr_srgns; i++) {
+		struct ufshpb_srgn *srgn = &rgn->srgns[i];
+
+		if (srgn->map) {
+			kfree(srgn->map);
+			kfree(srgn->dirty);
+			srgn->map = NULL;
+			srgn->dirty = NULL;
+			hpb->nr_loaded_srgns--;
+		}
+		srgn->reads = 0;
+	}
+
+	if (rgn->active) {
+		rgn->active = false;
+		hpb->nr_active_rgns--;
+		list_del_init(&rgn->lru_node);
+	}
+}
+
+static void ufshpb_set_read_cdb(struct ufshcd_lrb *lrbp, u64 lba, __be64 ppn)
+{
+	u8 *cdb = lrbp->ucd_req_ptr->sc.cdb;
+
+	memset(cdb, 0, MAX_CDB_SIZE);
+	cdb[0] = UFSHPB_READ;
+	put_unaligned_be32((u32)lba, &cdb[2]);
+	memcpy(&cdb[6], &ppn, sizeof(ppn));
+	cdb[14] = 1;	/* transfer length in blocks */
+
+	lrbp->hpb_read = true;
+}
+
+/**
+ * ufshpb_prep - rewrite a read as HPB READ if its map entry is cached
+ * @hba: per adapter instance
+ * @lrbp: command whose UPIU has just been composed
+ *
+ * Writes and discards mark the blocks they cover dirty instead.
+ */
+void ufshpb_prep(struct ufs_hba *hba, struct ufshcd_lrb *lrbp)
+{
+	struct scsi_cmnd *cmd = lrbp->cmd;
+	struct request *rq = cmd->request;
+	struct ufshpb_lu *hpb;
+	struct ufshpb_srgn *srgn;
+	unsigned long flags;
+	unsigned int off;
+	bool queue = false;
+	u64 lba, idx;
+	__be64 ppn;
+
+	lrbp->hpb_read = false;
+
+	hpb = ufshpb_get_lu(hba, lrbp->lun);
+	if (!hpb || !rq || rq->cmd_type != REQ_TYPE_FS)
+		return;
+
+	lba = blk_rq_pos(rq) >> (UFSHPB_BLOCK_SHIFT - 9);
+
+	if (req_op(rq) != REQ_OP_READ) {
+		if (!blk_rq_sectors(rq))
+			return;
+		spin_lock_irqsave(&hpb->lock, flags);
+		ufshpb_set_dirty(hpb, lba, DIV_ROUND_UP(blk_rq_sectors(rq),
+				 1 << (UFSHPB_BLOCK_SHIFT - 9)));
+		spin_unlock_irqrestore(&hpb->lock, flags);
+		return;
+	}
+
+	/* HPB READ carries a single entry and has no FUA bit */
+	if ((cmd->cmnd[0] != READ_10 && cmd->cmnd[0] != READ_16) ||
+	    (cmd->cmnd[1] & 0x08) ||
+	    blk_rq_bytes(rq) != (1 << UFSHPB_BLOCK_SHIFT))
+		return;
+
+	idx = lba >> hpb->srgn_shift;
+	if (idx >= hpb->nr_srgns)
+		return;
+	off = lba & (ufshpb_srgn_entries(hpb) - 1);
+
+	spin_lock_irqsave(&hpb->lock, flags);
+	srgn = &hpb->srgns[idx];
+	if (srgn->map && !test_bit(off, srgn->dirty)) {
+		struct ufshpb_rgn *rgn = ufshpb_srgn_rgn(hpb, idx);
+
+		ppn = srgn->map[off];
+		if (!rgn->pinned)
+			list_move(&rgn->lru_node, &hpb->lru);
+		hpb->hit_cnt++;
+		spin_unlock_irqrestore(&hpb->lock, flags);
+
+		ufshpb_set_read_cdb(lrbp, lba, ppn);
+		return;
+	}
+
+	hpb->miss_cnt++;
+	if (!srgn->queued && !srgn->new_map &&
+	    ++srgn->reads >= ufshpb_activate_reads) {
+		ufshpb_queue_srgn(hpb, srgn);
+		queue = srgn->queued;
+	}
+	spin_unlock_irqrestore(&hpb->lock, flags);
+
+	if (queue)
+		schedule_work(&hpb->load_work);
+}
+
+/**
+ * ufshpb_rsp - account for a completed command
+ * @hba: per adapter instance
+ * @lrbp: completed command
+ * @result: SCSI result of the command
+ *
+ * A failed HPB READ stops using the entry it carried; the retry issued by
+ * the midlayer then goes out as a plain READ.
+ */
+void ufshpb_rsp(struct ufs_hba *hba, struct ufshcd_lrb *lrbp, int result)
+{
+	struct ufshpb_lu *hpb;
+	struct ufshpb_srgn *srgn;
+	unsigned long flags;
+	u64 lba, idx;
+
+	if (!lrbp->hpb_read)
+		return;
+	lrbp->hpb_read = false;
+
+	if (likely(!result))
+		return;
+
+	hpb = ufshpb_get_lu(hba, lrbp->lun);
+	if (!hpb)
+		return;
+
+	lba = blk_rq_pos(lrbp->cmd->request) >> (UFSHPB_BLOCK_SHIFT - 9);
+	idx = lba >> hpb->srgn_shift;
+
+	spin_lock_irqsave(&hpb->lock, flags);
+	srgn = &hpb->srgns[idx];
+	if (srgn->map)
+		set_bit(lba & (ufshpb_srgn_entries(hpb) - 1), srgn->dirty);
+	hpb->read_fail_cnt++;
+	spin_unlock_irqrestore(&hpb->lock, flags);
+}
+
+static int ufshpb_read_buffer(struct ufshpb_lu *hpb, unsigned int idx,
+			      void *buf, unsigned int len)
+{
+	unsigned int per_rgn_shift = hpb->rgn_shift - hpb->srgn_shift;
+	unsigned char cdb[UFSHPB_READ_BUFFER_CMD_LEN] = { };
+	struct scsi_sense_hdr sshdr;
+	int ret;
+
+	cdb[0] = UFSHPB_READ_BUFFER;
+	cdb[1] = UFSHPB_READ_BUFFER_ID;
+	put_unaligned_be16(idx >> per_rgn_shift, &cdb[2]);
+	put_unaligned_be16(idx & ((1U << per_rgn_shift) - 1), &cdb[4]);
+	cdb[6] = (len >> 16) & 0xff;
+	cdb[7] = (len >> 8) & 0xff;
+	cdb[8] = len & 0xff;
+
+	ret = scsi_execute_req(hpb->sdev, cdb, DMA_FROM_DEVICE, buf, len,
+			       &sshdr, UFSHPB_CMD_TIMEOUT, UFSHPB_CMD_RETRIES,
+			       NULL);
+	if (ret)
+		sdev_printk(KERN_DEBUG, hpb->sdev,
+			    "HPB READ BUFFER %u failed: 0x%x (sense %x/%x/%x)\n",
+			    idx, ret, sshdr.sense_key, sshdr.asc, sshdr.ascq);
+	return ret;
+}
+
+static void ufshpb_inactivate(struct ufshpb_lu *hpb, unsigned int rgn_idx)
+{
+	unsigned char cdb[UFSHPB_WRITE_BUFFER_CMD_LEN] = { };
+	struct scsi_sense_hdr sshdr;
+	int ret;
+
+	cdb[0] = UFSHPB_WRITE_BUFFER;
+	cdb[1] = UFSHPB_WRITE_BUFFER_INACT_ID;
+	put_unaligned_be16(rgn_idx, &cdb[2]);
+
+	ret = scsi_execute_req(hpb->sdev, cdb, DMA_NONE, NULL, 0, &sshdr,
+			       UFSHPB_CMD_TIMEOUT, UFSHPB_CMD_RETRIES, NULL);
+	if (ret)
+		sdev_printk(KERN_DEBUG, hpb->sdev,
+			    "HPB inactivate region %u failed: 0x%x\n",
+			    rgn_idx, ret);
+}
+
+/*
+ * Evict least recently used regions until @rgn may be active and @srgn
+ * may hold a map. Returns -ENOSPC if only pinned regions, or @rgn itself,
+ * are left to evict.
+ */
+static int ufshpb_make_room(struct ufshpb_lu *hpb, struct ufshpb_rgn *rgn,
+			    struct ufshpb_srgn *srgn)
+{
+	for (;;) {
+		struct ufshpb_rgn *victim;
+		bool need_rgn, need_srgn;
+
+		spin_lock_irq(&hpb->lock);
+		need_rgn = !rgn->active &&
+			   hpb->nr_active_rgns >= hpb->max_active_rgns;
+		need_srgn = !srgn->map &&
+			    hpb->nr_loaded_srgns >= hpb->max_loaded_srgns;
+		if (!need_rgn && !need_srgn) {
+			spin_unlock_irq(&hpb->lock);
+			return 0;
+		}
+
+		if (list_empty(&hpb->lru)) {
+			spin_unlock_irq(&hpb->lock);
+			return -ENOSPC;
+		}
+		victim = list_last_entry(&hpb->lru, struct ufshpb_rgn,
+					 lru_node);
+		if (victim == rgn) {
+			spin_unlock_irq(&hpb->lock);
+			return -ENOSPC;
+		}
+		ufshpb_drop_rgn(hpb, victim);
+		hpb->evict_cnt++;
+		spin_unlock_irq(&hpb->lock);
+
+		ufshpb_inactivate(hpb, victim - hpb->rgns);
+	}
+}
+
+static void ufshpb_load_srgn(struct ufshpb_lu *hpb, struct ufshpb_srgn *srgn)
+{
+	unsigned int entries = ufshpb_srgn_entries(hpb);
+	unsigned int idx = ufshpb_srgn_idx(hpb, srgn);
+	struct ufshpb_rgn *rgn = ufshpb_srgn_rgn(hpb, idx);
+	unsigned int len = entries * UFSHPB_ENTRY_SIZE;
+	unsigned long *dirty = NULL;
+	__be64 *map = NULL;
+	unsigned int gen;
+	int ret;
+
+	if (ufshpb_make_room(hpb, rgn, srgn))
+		goto out;
+
+	map = kmalloc(len, GFP_KERNEL | __GFP_NOWARN);
+	dirty = kcalloc(BITS_TO_LONGS(entries), sizeof(*dirty),
+			GFP_KERNEL | __GFP_NOWARN);
+	if (!map || !dirty)
+		goto out;
+
+	spin_lock_irq(&hpb->lock);
+	if (!rgn->active) {
+		rgn->active = true;
+		hpb->nr_active_rgns++;
+		if (!rgn->pinned)
+			list_add(&rgn->lru_node, &hpb->lru);
+	}
+	srgn->new_map = map;
+	srgn->new_dirty = dirty;
+	gen = hpb->gen;
+	spin_unlock_irq(&hpb->lock);
+
+	ret = ufshpb_read_buffer(hpb, idx, map, len);
+
+	spin_lock_irq(&hpb->lock);
+	srgn->new_map = NULL;
+	srgn->new_dirty = NULL;
+	srgn->reads = 0;
+	if (ret || gen != hpb->gen) {
+		if (ret)
+			hpb->rb_fail_cnt++;
+		spin_unlock_irq(&hpb->lock);
+		goto out;
+	}
+
+	swap(srgn->map, map);
+	swap(srgn->dirty, dirty);
+	if (!map)
+		hpb->nr_loaded_srgns++;
+	hpb->map_req_cnt++;
+	spin_unlock_irq(&hpb->lock);
+out:
+	/* the buffers of a failed load, or the map just replaced */
+	kfree(map);
+	kfree(dirty);
+}
+
+static void ufshpb_load_work(struct work_struct *work)
+{
+	struct ufshpb_lu *hpb = container_of(work, struct ufshpb_lu,
+					     load_work);
+	struct ufshpb_srgn *srgn;
+
+	for (;;) {
+		spin_lock_irq(&hpb->lock);
+		if (hpb->stopping || list_empty(&hpb->load_list)) {
+			spin_unlock_irq(&hpb->lock);
+			break;
+		}
+		srgn = list_first_entry(&hpb->load_list, struct ufshpb_srgn,
+					load_node);
+		list_del_init(&srgn->load_node);
+		srgn->queued = false;
+		spin_unlock_irq(&hpb->lock);
+
+		ufshpb_load_srgn(hpb, srgn);
+		cond_resched();
+	}
+}
+
+/* Called with hpb->lock held */
+static void ufshpb_queue_pinned(struct ufshpb_lu *hpb)
+{
+	unsigned int i, j;
+
+	for (i = 0; i < hpb->nr_rgns; i++) {
+		struct ufshpb_rgn *rgn = &hpb->rgns[i];
+
+		if (!rgn->pinned)
+			continue;
+		for (j = 0; j < rgn->nr_srgns; j++)
+			ufshpb_queue_srgn(hpb, &rgn->srgns[j]);
+	}
+}
+
+/**
+ * ufshpb_reset - forget all maps after the device was reset
+ * @hba: per adapter instance
+ *
+ * The device drops its active regions on reset and power loss; maps of
+ * pinned regions are fetched again.
+ */
+void ufshpb_reset(struct ufs_hba *hba)
+{
+	int lun;
+
+	for (lun = 0; lun < UFS_UPIU_MAX_GENERAL_LUN; lun++) {
+		struct ufshpb_lu *hpb = hba->hpb_lup[lun];
+		unsigned long flags;
+		unsigned int i;
+
+		if (!hpb)
+			continue;
+
+		spin_lock_irqsave(&hpb->lock, flags);
+		hpb->gen++;
+		for (i = 0; i < hpb->nr_rgns; i++)
+			ufshpb_drop_rgn(hpb, &hpb->rgns[i]);
+		ufshpb_queue_pinned(hpb);
+		spin_unlock_irqrestore(&hpb->lock, flags);
+
+		schedule_work(&hpb->load_work);
+	}
+}
+
+/**
+ * ufshpb_init - read the device's HPB capabilities
+ * @hba: per adapter instance
+ */
+void ufshpb_init(struct ufs_hba *hba)
+{
+	struct ufshpb_dev_info *info = &hba->hpb_dev;
+	u8 rgn_size, srgn_size;
+	u8 *desc;
+	int len;
+
+	if (info->probed)
+		return;
+	info->probed = true;
+
+	if (hba->desc_size.dev_desc <= DEVICE_DESC_PARAM_HPB_CONTROL ||
+	    hba->desc_size.geom_desc <=
+			GEOMETRY_DESC_PARAM_HPB_MAX_ACTIVE_REGS + 1)
+		return;
+
+	len = max(hba->desc_size.dev_desc, hba->desc_size.geom_desc);
+	desc = kzalloc(len, GFP_KERNEL);
+	if (!desc)
+		return;
+
+	if (ufshcd_read_device_desc(hba, desc, hba->desc_size.dev_desc))
+		goto out;
+	if (!(desc[DEVICE_DESC_PARAM_UFS_FEAT] & UFS_DEV_HPB_SUPPORT))
+		goto out;
+
+	info->version = get_unaligned_be16(&desc[DEVICE_DESC_PARAM_HPB_VER]);
+	if (info->version < UFSHPB_VER_HOST_CONTROL ||
+	    desc[DEVICE_DESC_PARAM_HPB_CONTROL] != UFSHPB_CONTROL_HOST) {
+		dev_info(hba->dev, "HPB %x in device control mode, not using it\n",
+			 info->version);
+		goto out;
+	}
+
+	if (ufshcd_read_desc_param(hba, QUERY_DESC_IDN_GEOMETRY, 0, 0, desc,
+				   hba->desc_size.geom_desc))
+		goto out;
+
+	/* sizes are 512 << n bytes, map entries cover 4KB each */
+	rgn_size = desc[GEOMETRY_DESC_PARAM_HPB_REGION_SIZE];
+	srgn_size = desc[GEOMETRY_DESC_PARAM_HPB_SUBREGION_SIZE];
+	if (srgn_size < UFSHPB_BLOCK_SHIFT - 9 || rgn_size < srgn_size ||
+	    rgn_size - srgn_size > 16) {
+		dev_err(hba->dev, "HPB: bad region/subregion size %u/%u\n",
+			rgn_size, srgn_size);
+		goto out;
+	}
+
+	info->rgn_shift = rgn_size - (UFSHPB_BLOCK_SHIFT - 9);
+	info->srgn_shift = srgn_size - (UFSHPB_BLOCK_SHIFT - 9);
+	info->max_active_rgns = get_unaligned_be16(
+			&desc[GEOMETRY_DESC_PARAM_HPB_MAX_ACTIVE_REGS]);
+	info->enabled = true;
+
+	dev_info(hba->dev, "HPB %x: region %u KB, subregion %u KB, %u active regions\n",
+		 info->version, 4U << info->rgn_shift, 4U << info->srgn_shift,
+		 info->max_active_rgns);
+out:
+	kfree(desc);
+}
+
+static void ufshpb_free_lu(struct ufshpb_lu *hpb)
+{
+	unsigned int i;
+
+	for (i = 0; i < hpb->nr_srgns; i++) {
+		kfree(hpb->srgns[i].map);
+		kfree(hpb->srgns[i].dirty);
+	}
+	vfree(hpb->srgns);
+	vfree(hpb->rgns);
+	kfree(hpb);
+}
+
+/**
+ * ufshpb_lu_init - set up HPB for a logical unit that has it enabled
+ * @hba: per adapter instance
+ * @sdev: SCSI device of the LU
+ * @lun: UPIU LUN of @sdev
+ */
+void ufshpb_lu_init(struct ufs_hba *hba, struct scsi_device *sdev, u8 lun)
+{
+	struct ufshpb_dev_info *info = &hba->hpb_dev;
+	unsigned int per_rgn, pin_start, pin_num, lu_max_active;
+	struct ufshpb_lu *hpb;
+	u64 nr_blocks;
+	unsigned int i;
+	u8 *desc;
+	int len;
+
+	if (!info->enabled || lun >= UFS_UPIU_MAX_GENERAL_LUN ||
+	    hba->hpb_lup[lun])
+		return;
+
+	len = hba->desc_size.unit_desc;
+	if (len <= UNIT_DESC_PARAM_HPB_NUM_PIN_RGNS + 1)
+		return;
+
+	desc = kzalloc(len, GFP_KERNEL);
+	if (!desc)
+		return;
+
+	if (ufshcd_read_desc_param(hba, QUERY_DESC_IDN_UNIT, lun, 0, desc, len))
+		goto out;
+	if (desc[UNIT_DESC_PARAM_LU_ENABLE] != UFS_LU_HPB_ENABLE ||
+	    desc[UNIT_DESC_PARAM_LOGICAL_BLK_SIZE] != UFSHPB_BLOCK_SHIFT)
+		goto out;
+
+	nr_blocks = get_unaligned_be64(&desc[UNIT_DESC_PARAM_LOGICAL_BLK_COUNT]);
+	lu_max_active = get_unaligned_be16(
+			&desc[UNIT_DESC_PARAM_HPB_LU_MAX_ACTIVE_RGNS]);
+	pin_start = get_unaligned_be16(
+			&desc[UNIT_DESC_PARAM_HPB_PIN_RGN_START_OFF]);
+	pin_num = get_unaligned_be16(&desc[UNIT_DESC_PARAM_HPB_NUM_PIN_RGNS]);
+	if (!nr_blocks)
+		goto out;
+
+	hpb = kzalloc(sizeof(*hpb), GFP_KERNEL);
+	if (!hpb)
+		goto out;
+
+	hpb->sdev = sdev;
+	spin_lock_init(&hpb->lock);
+	INIT_LIST_HEAD(&hpb->lru);
+	INIT_LIST_HEAD(&hpb->load_list);
+	INIT_WORK(&hpb->load_work, ufshpb_load_work);
+	hpb->rgn_shift = info->rgn_shift;
+	hpb->srgn_shift = info->srgn_shift;
+	hpb->nr_rgns = DIV_ROUND_UP_ULL(nr_blocks, 1ULL << hpb->rgn_shift);
+	hpb->nr_srgns = DIV_ROUND_UP_ULL(nr_blocks, 1ULL << hpb->srgn_shift);
+
+	hpb->rgns = vzalloc(hpb->nr_rgns * sizeof(*hpb->rgns));
+	hpb->srgns = vzalloc(hpb->nr_srgns * sizeof(*hpb->srgns));
+	if (!hpb->rgns || !hpb->srgns) {
+		ufshpb_free_lu(hpb);
+		goto out;
+	}
+
+	per_rgn = 1U << (hpb->rgn_shift - hpb->srgn_shift);
+	for (i = 0; i < hpb->nr_srgns; i++)
+		INIT_LIST_HEAD(&hpb->srgns[i].load_node);
+	for (i = 0; i < hpb->nr_rgns; i++) {
+		struct ufshpb_rgn *rgn = &hpb->rgns[i];
+
+		rgn->srgns = &hpb->srgns[i * per_rgn];
+		rgn->nr_srgns = min(per_rgn, hpb->nr_srgns - i * per_rgn);
+		INIT_LIST_HEAD(&rgn->lru_node);
+		rgn->pinned = i >= pin_start && i - pin_start < pin_num;
+	}
+
+	hpb->max_active_rgns = lu_max_active ? : info->max_active_rgns;
+	if (!hpb->max_active_rgns || hpb->max_active_rgns > hpb->nr_rgns)
+		hpb->max_active_rgns = hpb->nr_rgns;
+	hpb->max_loaded_srgns = max_t(unsigned int, 1,
+			(ufshpb_map_budget_kb * 1024ULL) /
+			(ufshpb_srgn_entries(hpb) * UFSHPB_ENTRY_SIZE));
+
+	spin_lock_irq(&hpb->lock);
+	ufshpb_queue_pinned(hpb);
+	spin_unlock_irq(&hpb->lock);
+
+	WRITE_ONCE(hba->hpb_lup[lun], hpb);
+	schedule_work(&hpb->load_work);
+
+	sdev_printk(KERN_INFO, sdev,
+		    "HPB: %u regions, %u active, %u maps in %u KB, %u pinned\n",
+		    hpb->nr_rgns, hpb->max_active_rgns, hpb->max_loaded_srgns,
+		    ufshpb_map_budget_kb, pin_num);
+out:
+	kfree(desc);
+}
+
+/**
+ * ufshpb_lu_destroy - tear down HPB for a logical unit
+ * @hba: per adapter instance
+ * @sdev: SCSI device of the LU
+ * @lun: UPIU LUN of @sdev
+ */
+void ufshpb_lu_destroy(struct ufs_hba *hba, struct scsi_device *sdev, u8 lun)
+{
+	struct ufshpb_lu *hpb = ufshpb_get_lu(hba, lun);
+
+	if (!hpb || hpb->sdev != sdev)
+		return;
+
+	spin_lock_irq(&hpb->lock);
+	hpb->stopping = true;
+	spin_unlock_irq(&hpb->lock);
+	cancel_work_sync(&hpb->load_work);
+
+	WRITE_ONCE(hba->hpb_lup[lun], NULL);
+	ufshpb_free_lu(hpb);
+}
+
+static struct ufshpb_lu *ufshpb_dev_to_lu(struct device *dev)
+{
+	struct scsi_device *sdev = to_scsi_device(dev);
+	struct ufs_hba *hba = shost_priv(sdev->host);
+	int lun;
+
+	for (lun = 0; lun < UFS_UPIU_MAX_GENERAL_LUN; lun++)
+		if (hba->hpb_lup[lun] && hba->hpb_lup[lun]->sdev == sdev)
+			return hba->hpb_lup[lun];
+	return NULL;
+}
+
+#define UFSHPB_STAT_ATTR(_name, _val)					\
+static ssize_t _name##_show(struct device *dev,				\
+			    struct device_attribute *attr, char *buf)	\
+{									\
+	struct ufshpb_lu *hpb = ufshpb_dev_to_lu(dev);			\
+	unsigned long flags;						\
+	u64 val;							\
+									\
+	if (!hpb)							\
+		return -ENODEV;						\
+	spin_lock_irqsave(&hpb->lock, flags);				\
+	val = (_val);							\
+	spin_unlock_irqrestore(&hpb->lock, flags);			\
+	return snprintf(buf, PAGE_SIZE, "%llu\n", val);			\
+}									\
+static DEVICE_ATTR_RO(_name)
+
+UFSHPB_STAT_ATTR(hpb_hit_cnt, hpb->hit_cnt);
+UFSHPB_STAT_ATTR(hpb_miss_cnt, hpb->miss_cnt);
+UFSHPB_STAT_ATTR(hpb_hit_rate, hpb->hit_cnt + hpb->miss_cnt ?
+		 div64_u64(hpb->hit_cnt * 100,
+			   hpb->hit_cnt + hpb->miss_cnt) : 0);
+UFSHPB_STAT_ATTR(hpb_map_req_cnt, hpb->map_req_cnt);
+UFSHPB_STAT_ATTR(hpb_rb_fail_cnt, hpb->rb_fail_cnt);
+UFSHPB_STAT_ATTR(hpb_read_fail_cnt, hpb->read_fail_cnt);
+UFSHPB_STAT_ATTR(hpb_evict_cnt, hpb->evict_cnt);
+UFSHPB_STAT_ATTR(hpb_active_rgns, hpb->nr_active_rgns);
+UFSHPB_STAT_ATTR(hpb_loaded_srgns, hpb->nr_loaded_srgns);
+
+struct device_attribute *ufshpb_sdev_attrs[] = {
+	&dev_attr_hpb_hit_cnt,
+	&dev_attr_hpb_miss_cnt,
+	&dev_attr_hpb_hit_rate,
+	&dev_attr_hpb_map_req_cnt,
+	&dev_attr_hpb_rb_fail_cnt,
+	&dev_attr_hpb_read_fail_cnt,
+	&dev_attr_hpb_evict_cnt,
+	&dev_attr_hpb_active_rgns,
+	&dev_attr_hpb_loaded_srgns,
+	NULL,
+};
@@ -0,0 +1,85 @@
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 and
+ * only version 2 as published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * UFS Host Performance Booster (HPB) - cache the device's logical to
+ * physical map in host memory and send it along with reads, so that the
+ * device can skip its own L2P lookup.
+ */
+
+#ifndef _UFSHPB_H
+#define _UFSHPB_H
+
+#include <linux/types.h>
+
+/* HPB command opcodes and buffer ids */
+#define UFSHPB_READ			0xF8
+#define UFSHPB_READ_BUFFER		0xF9
+#define UFSHPB_WRITE_BUFFER		0xFA
+#define UFSHPB_READ_BUFFER_ID		0x01
+#define UFSHPB_WRITE_BUFFER_INACT_ID	0x01
+
+#define UFSHPB_READ_BUFFER_CMD_LEN	10
+#define UFSHPB_WRITE_BUFFER_CMD_LEN	10
+
+/* Host control mode was introduced with HPB 2.0 */
+#define UFSHPB_VER_HOST_CONTROL		0x200
+#define UFSHPB_CONTROL_HOST		0x0
+
+/* Every map entry describes one 4KB logical block */
+#define UFSHPB_ENTRY_SIZE		sizeof(__be64)
+#define UFSHPB_BLOCK_SHIFT		12
+
+struct ufs_hba;
+struct ufshcd_lrb;
+struct ufshpb_lu;
+struct scsi_device;
+struct device_attribute;
+
+/**
+ * struct ufshpb_dev_info - HPB capabilities of the device
+ * @probed: descriptors have been read
+ * @enabled: device supports HPB in host control mode
+ * @version: wHPBVersion
+ * @rgn_shift: log2 of the region size in 4KB blocks
+ * @srgn_shift: log2 of the subregion size in 4KB blocks
+ * @max_active_rgns: device wide limit on active regions
+ */
+struct ufshpb_dev_info {
+	bool probed;
+	bool enabled;
+	u16 version;
+	unsigned int rgn_shift;
+	unsigned int srgn_shift;
+	unsigned int max_active_rgns;
+};
+
+#ifdef CONFIG_SCSI_UFS_HPB
+extern struct device_attribute *ufshpb_sdev_attrs[];
+
+void ufshpb_init(struct ufs_hba *hba);
+void ufshpb_reset(struct ufs_hba *hba);
+void ufshpb_lu_init(struct ufs_hba *hba, struct scsi_device *sdev, u8 lun);
+void ufshpb_lu_destroy(struct ufs_hba *hba, struct scsi_device *sdev, u8 lun);
+void ufshpb_prep(struct ufs_hba *hba, struct ufshcd_lrb *lrbp);
+void ufshpb_rsp(struct ufs_hba *hba, struct ufshcd_lrb *lrbp, int result);
+#else
+static inline void ufshpb_init(struct ufs_hba *hba) {}
+static inline void ufshpb_reset(struct ufs_hba *hba) {}
+static inline void ufshpb_lu_init(struct ufs_hba *hba,
+				  struct scsi_device *sdev, u8 lun) {}
+static inline void ufshpb_lu_destroy(struct ufs_hba *hba,
+				     struct scsi_device *sdev, u8 lun) {}
+static inline void ufshpb_prep(struct ufs_hba *hba,
+			       struct ufshcd_lrb *lrbp) {}
+static inline void ufshpb_rsp(struct ufs_hba *hba, struct ufshcd_lrb *lrbp,
+			      int result) {}
+#endif
+
+#endif /* End of Header */
@@ -18,6 +18,9 @@
 #include <linux/of_device.h>
 #include <linux/platform_device.h>
 #include <linux/notifier.h>
+#include <linux/debugfs.h>
+#include <linux/seq_file.h>
+#include <linux/ktime.h>
 #include <soc/qcom/subsystem_restart.h>
 #include <soc/qcom/subsystem_notif.h>
 #include <soc/qcom/msm_qmi_interface.h>
@@ -41,6 +44,20 @@ static uint64_t bootup_request;
 static bool ramdump_event;
 static void *memshare_ramdump_dev[MAX_CLIENTS];
 static struct device *memshare_dev[MAX_CLIENTS];
+static void memshare_release_worker(struct work_struct *work);
+static DECLARE_DELAYED_WORK(memshare_release_work, memshare_release_worker);
+static struct dentry *memshare_dentry;
+static uint64_t memshare_total_bytes;
+static uint64_t memshare_peak_bytes;
+
+/*
+ * Blocks of clients allocated on request are kept for this long after the
+ * client frees them, so that a request that follows shortly after is served
+ * without going back to CMA. 0 releases them immediately.
+ */
+static unsigned int release_delay_ms = 2000;
+module_param(release_delay_ms, uint, 0644);
+MODULE_PARM_DESC(release_delay_ms, "Delay before freed client memory is released");
 
 /* Memshare Driver Structure */
 struct memshare_driver {
@@ -217,6 +234,58 @@ static void free_client(int id)
 
 }
 
+/* Give the block of client @id back to the system, mem_share held */
+static void memshare_release_block(int id)
+{
+	int size = memblock[id].size;
+
+	if (memblock[id].client_id == 1) {
+		/*
+		 *	Check if the client id
+		 *	is of diag so that free
+		 *	the memory region of
+		 *	client's size + guard
+		 *	bytes of 4K.
+		 */
+		size += MEMSHARE_GUARD_BYTES;
+	}
+	dma_free_attrs(memsh_drv->dev, size,
+		memblock[id].virtual_addr,
+		memblock[id].phy_addr,
+		attrs);
+	memshare_total_bytes -= memblock[id].size;
+	memblock[id].free_count++;
+	memblock[id].release_pending = 0;
+	free_client(id);
+}
+
+static void memshare_release_worker(struct work_struct *work)
+{
+	unsigned long now = jiffies, next = 0;
+	bool more = false;
+	int i;
+
+	mutex_lock(&memsh_drv->mem_share);
+	for (i = 0; i < MAX_CLIENTS; i++) {
+		if (!memblock[i].release_pending)
+			continue;
+
+		if (time_after_eq(now, memblock[i].release_at)) {
+			pr_debug("memshare: %s: releasing memory of client id: %d\n",
+				__func__, memblock[i].client_id);
+			memshare_release_block(i);
+		} else if (!more || time_before(memblock[i].release_at,
+						next)) {
+			next = memblock[i].release_at;
+			more = true;
+		}
+	}
+	if (more)
+		queue_delayed_work(system_wq, &memshare_release_work,
+				   next - now);
+	mutex_unlock(&memsh_drv->mem_share);
+}
+
 static void fill_alloc_response(struct mem_alloc_generic_resp_msg_v01 *resp,
 						int id, int *flag)
 {
@@ -446,6 +515,8 @@ static int modem_notifier_cb(struct notifier_block *this, unsigned long code,
 					size, memblock[i].virtual_addr,
 					memblock[i].phy_addr,
 					attrs);
+				memshare_total_bytes -= memblock[i].size;
+				memblock[i].free_count++;
 				free_client(i);
 			}
 		}
@@ -564,7 +635,15 @@ static int handle_alloc_generic_req(void *req_h, void *req, void *conn_h)
 		return -EINVAL;
 	}
 
+	/* still held from a recent free, hand the same block back */
+	if (memblock[client_id].release_pending) {
+		memblock[client_id].release_pending = 0;
+		memblock[client_id].reuse_count++;
+	}
+
 	if (!memblock[client_id].allotted && alloc_req->num_bytes > 0) {
+		ktime_t start;
+		uint32_t delta;
 
 		if (alloc_req->num_bytes > memblock[client_id].size)
 			alloc_req->num_bytes = memblock[client_id].size;
@@ -573,6 +652,7 @@ static int handle_alloc_generic_req(void *req_h, void *req, void *conn_h)
 			size = alloc_req->num_bytes + MEMSHARE_GUARD_BYTES;
 		else
 			size = alloc_req->num_bytes;
+		start = ktime_get();
 		rc = memshare_alloc(memsh_drv->dev, size,
 					&memblock[client_id]);
 		if (rc) {
@@ -581,10 +661,21 @@ static int handle_alloc_generic_req(void *req_h, void *req, void *conn_h)
 			resp = 1;
 		}
 		if (!resp) {
+			delta = ktime_us_delta(ktime_get(), start);
 			memblock[client_id].free_memory += 1;
 			memblock[client_id].allotted = 1;
 			memblock[client_id].size = alloc_req->num_bytes;
 			memblock[client_id].peripheral = alloc_req->proc_id;
+			memblock[client_id].alloc_count++;
+			memblock[client_id].alloc_last_us = delta;
+			memblock[client_id].alloc_max_us =
+				max(memblock[client_id].alloc_max_us, delta);
+			memblock[client_id].peak_size =
+				max(memblock[client_id].peak_size,
+				    memblock[client_id].size);
+			memshare_total_bytes += memblock[client_id].size;
+			memshare_peak_bytes = max(memshare_peak_bytes,
+						  memshare_total_bytes);
 		}
 	}
 	pr_debug("memshare: In %s, free memory count for client id: %d = %d",
@@ -650,7 +741,7 @@ static int handle_free_generic_req(void *req_h, void *req, void *conn_h)
 {
 	struct mem_free_generic_req_msg_v01 *free_req;
 	struct mem_free_generic_resp_msg_v01 free_resp;
-	int rc, flag = 0, ret = 0, size = 0;
+	int rc, flag = 0, ret = 0;
 	uint32_t client_id;
 	u32 source_vmlist[1] = {VMID_MSS_MSA};
 	int dest_vmids[1] = {VMID_HLOS};
@@ -670,10 +761,11 @@ static int handle_free_generic_req(void *req_h, void *req, void *conn_h)
 					__func__);
 		flag = 1;
 	} else if (!memblock[client_id].guarantee &&
-				!memblock[client_id].client_request &&
-				memblock[client_id].allotted) {
+				memblock[client_id].allotted &&
+				!memblock[client_id].release_pending) {
 		pr_debug("memshare: %s:client_id:%d - size: %d",
 				__func__, client_id, memblock[client_id].size);
+		mutex_lock(&memsh_drv->mem_share);
 		ret = hyp_assign_phys(memblock[client_id].phy_addr,
 				memblock[client_id].size, source_vmlist, 1,
 				dest_vmids, dest_perms, 1);
@@ -684,23 +776,23 @@ static int handle_free_generic_req(void *req_h, void *req, void *conn_h)
 		 */
 			pr_err("memshare: %s, failed to unmap the region for client id:%d\n",
 				__func__, client_id);
+		} else {
+			memblock[client_id].hyp_mapping = 0;
 		}
-		size = memblock[client_id].size;
-		if (memblock[client_id].client_id == 1) {
-			/*
-			 *	Check if the client id
-			 *	is of diag so that free
-			 *	the memory region of
-			 *	client's size + guard
-			 *	bytes of 4K.
-			 */
-			size += MEMSHARE_GUARD_BYTES;
+
+		/*
+		 * Clients allocated on request tend to ask again soon after,
+		 * keep their block around for a while before releasing it.
+		 */
+		if (memblock[client_id].client_request && release_delay_ms) {
+			memblock[client_id].release_pending = 1;
+			memblock[client_id].release_at = jiffies +
+				msecs_to_jiffies(release_delay_ms);
+			mod_delayed_work(system_wq, &memshare_release_work, 0);
+		} else {
+			memshare_release_block(client_id);
 		}
-		dma_free_attrs(memsh_drv->dev, size,
-			memblock[client_id].virtual_addr,
-			memblock[client_id].phy_addr,
-			attrs);
-		free_client(client_id);
+		mutex_unlock(&memsh_drv->mem_share);
 	} else {
 		pr_err("memshare: %s, Request came for a guaranteed client (client_id: %d) cannot free up the memory\n",
 						__func__, client_id);
@@ -1035,6 +1127,11 @@ static int memshare_child_probe(struct platform_device *pdev)
 			return rc;
 		}
 		memblock[num_clients].allotted = 1;
+		memblock[num_clients].alloc_count++;
+		memblock[num_clients].peak_size = memblock[num_clients].size;
+		memshare_total_bytes += memblock[num_clients].size;
+		memshare_peak_bytes = max(memshare_peak_bytes,
+					  memshare_total_bytes);
 		shared_hyp_mapping(num_clients);
 	}
 
@@ -1060,6 +1157,41 @@ static int memshare_child_probe(struct platform_device *pdev)
 	return 0;
 }
 
+static int memshare_stats_show(struct seq_file *s, void *unused)
+{
+	int i;
+
+	mutex_lock(&memsh_drv->mem_share);
+	seq_printf(s, "total: %llu peak: %llu\n",
+		   memshare_total_bytes, memshare_peak_bytes);
+	for (i = 0; i < MAX_CLIENTS; i++) {
+		if (memblock[i].client_id == DHMS_MEM_CLIENT_INVALID)
+			continue;
+		seq_printf(s, "client %u proc %u: size %u peak %u allotted %u pending %u allocs %u frees %u reuses %u alloc_us %u max_us %u\n",
+			   memblock[i].client_id, memblock[i].peripheral,
+			   memblock[i].size, memblock[i].peak_size,
+			   memblock[i].allotted, memblock[i].release_pending,
+			   memblock[i].alloc_count, memblock[i].free_count,
+			   memblock[i].reuse_count, memblock[i].alloc_last_us,
+			   memblock[i].alloc_max_us);
+	}
+	mutex_unlock(&memsh_drv->mem_share);
+
+	return 0;
+}
+
+static int memshare_stats_open(struct inode *inode, struct file *file)
+{
+	return single_open(file, memshare_stats_show, NULL);
+}
+
+static const struct file_operations memshare_stats_fops = {
+	.open		= memshare_stats_open,
+	.read		= seq_read,
+	.llseek		= seq_lseek,
+	.release	= single_release,
+};
+
 static int memshare_probe(struct platform_device *pdev)
 {
 	int rc;
@@ -1094,6 +1226,11 @@ static int memshare_probe(struct platform_device *pdev)
 	}
 
 	subsys_notif_register_notifier("modem", &nb);
+
+	memshare_dentry = debugfs_create_dir("memshare", NULL);
+	if (!IS_ERR_OR_NULL(memshare_dentry))
+		debugfs_create_file("stats", 0444, memshare_dentry, NULL,
+				    &memshare_stats_fops);
 	pr_debug("memshare: %s, Memshare inited\n", __func__);
 
 	return 0;
@@ -1104,10 +1241,12 @@ static int memshare_remove(struct platform_device *pdev)
 	if (!memsh_drv)
 		return 0;
 
+	debugfs_remove_recursive(memshare_dentry);
 	qmi_svc_unregister(mem_share_svc_handle);
 	flush_workqueue(mem_share_svc_workqueue);
 	qmi_handle_destroy(mem_share_svc_handle);
 	destroy_workqueue(mem_share_svc_workqueue);
+	cancel_delayed_work_sync(&memshare_release_work);
 
 	return 0;
 }
@@ -58,7 +58,16 @@ struct mem_blocks {
 	uint8_t hyp_mapping;
 	/* Status flag which checks if ramdump file is created*/
 	int file_created;
-
+	/* Freed by the client, release at release_at unless requested again */
+	uint8_t release_pending;
+	unsigned long release_at;
+	/* Usage statistics */
+	uint32_t alloc_count;
+	uint32_t free_count;
+	uint32_t reuse_count;
+	uint32_t peak_size;
+	uint32_t alloc_last_us;
+	uint32_t alloc_max_us;
 };
 
 int memshare_alloc(struct device *dev,
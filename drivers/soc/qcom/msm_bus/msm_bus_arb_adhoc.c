@@ -16,6 +16,9 @@
 #include <linux/slab.h>
 #include <linux/rtmutex.h>
 #include <linux/clk.h>
+#include <linux/sched.h>
+#include <linux/ktime.h>
+#include <linux/workqueue.h>
 #include <linux/msm-bus.h>
 #include "msm_bus_core.h"
 #include "msm_bus_adhoc.h"
@@ -42,6 +45,23 @@ static LIST_HEAD(commit_list);
 
 DEFINE_RT_MUTEX(msm_bus_adhoc_lock);
 
+/*
+ * Commits of dirty nodes can be held back while a client task has a batch
+ * open, or for up to coalesce_ms for votes that only lower bandwidth, so
+ * several votes in a row touching the same fabrics result in one commit.
+ * Protected by msm_bus_adhoc_lock.
+ */
+static struct task_struct *batch_owner;
+static unsigned int batch_depth;
+static ktime_t pending_since;
+static bool votes_deferred;
+
+static unsigned int coalesce_ms;
+module_param(coalesce_ms, uint, 0644);
+
+static void coalesce_work_fn(struct work_struct *work);
+static DECLARE_DELAYED_WORK(coalesce_work, coalesce_work_fn);
+
 static bool chk_bl_list(struct list_head *black_list, unsigned int id)
 {
 	struct msm_bus_node_device_type *bus_node = NULL;
@@ -659,6 +679,90 @@ static void commit_data(void)
 	INIT_LIST_HEAD(&commit_list);
 }
 
+/* Commits whatever is dirty and accounts the latency of the oldest vote */
+static void flush_votes(void)
+{
+	if (list_empty(&commit_list))
+		return;
+
+	commit_data();
+	msm_bus_dbg_rec_commit(ktime_us_delta(ktime_get(), pending_since),
+			       votes_deferred);
+	pending_since = ktime_set(0, 0);
+	votes_deferred = false;
+}
+
+static void commit_or_defer(bool urgent)
+{
+	if (list_empty(&commit_list))
+		return;
+
+	if (!ktime_to_ns(pending_since))
+		pending_since = ktime_get();
+
+	if (batch_depth && batch_owner == current) {
+		votes_deferred = true;
+		return;
+	}
+
+	if (!urgent && coalesce_ms) {
+		if (!delayed_work_pending(&coalesce_work))
+			schedule_delayed_work(&coalesce_work,
+					      msecs_to_jiffies(coalesce_ms));
+		votes_deferred = true;
+		return;
+	}
+
+	flush_votes();
+	cancel_delayed_work(&coalesce_work);
+}
+
+static void coalesce_work_fn(struct work_struct *work)
+{
+	rt_mutex_lock(&msm_bus_adhoc_lock);
+	if (!batch_depth)
+		flush_votes();
+	rt_mutex_unlock(&msm_bus_adhoc_lock);
+}
+
+static int batch_begin_adhoc(void)
+{
+	int ret = 0;
+
+	rt_mutex_lock(&msm_bus_adhoc_lock);
+	if (batch_depth && batch_owner != current) {
+		ret = -EBUSY;
+	} else {
+		batch_owner = current;
+		batch_depth++;
+	}
+	rt_mutex_unlock(&msm_bus_adhoc_lock);
+
+	return ret;
+}
+
+static int batch_commit_adhoc(void)
+{
+	int ret = 0;
+
+	rt_mutex_lock(&msm_bus_adhoc_lock);
+	if (!batch_depth || batch_owner != current) {
+		ret = -EINVAL;
+		goto exit_batch_commit;
+	}
+
+	if (--batch_depth)
+		goto exit_batch_commit;
+
+	batch_owner = NULL;
+	flush_votes();
+	cancel_delayed_work(&coalesce_work);
+exit_batch_commit:
+	rt_mutex_unlock(&msm_bus_adhoc_lock);
+
+	return ret;
+}
+
 static void add_node_to_clist(struct msm_bus_node_device_type *node)
 {
 	struct msm_bus_node_device_type *node_parent =
@@ -889,7 +993,7 @@ static void unregister_client_adhoc(uint32_t cl)
 		remove_path(src_dev, dest, cur_clk, cur_bw, lnode,
 						pdata->active_only);
 	}
-	commit_data();
+	flush_votes();
 	msm_bus_dbg_client_data(client->pdata, MSM_BUS_DBG_UNREGISTER, cl);
 	kfree(client->src_pnode);
 	kfree(client->src_devs);
@@ -1049,6 +1153,7 @@ static int update_client_paths(struct msm_bus_client *client, bool log_trns,
 	int i, ret = 0;
 	struct msm_bus_scale_pdata *pdata;
 	struct device *src_dev;
+	bool urgent = false;
 
 	if (!client) {
 		MSM_BUS_ERR("Client handle  Null");
@@ -1092,6 +1197,9 @@ static int update_client_paths(struct msm_bus_client *client, bool log_trns,
 			slp_bw = req_bw;
 		}
 
+		if (req_clk > curr_clk || req_bw > curr_bw)
+			urgent = true;
+
 		ret = update_path(src_dev, dest, req_clk, req_bw, slp_clk,
 			slp_bw, curr_clk, curr_bw, lnode, pdata->active_only);
 
@@ -1104,7 +1212,7 @@ static int update_client_paths(struct msm_bus_client *client, bool log_trns,
 		if (log_trns)
 			getpath_debug(src, lnode, pdata->active_only);
 	}
-	commit_data();
+	commit_or_defer(urgent);
 exit_update_client_paths:
 	return ret;
 }
@@ -1278,7 +1386,7 @@ static int update_bw_adhoc(struct msm_bus_client_handle *cl, u64 ab, u64 ib)
 		goto exit_update_request;
 	}
 
-	commit_data();
+	commit_or_defer(ib > cl->cur_act_ib || ab > cl->cur_act_ab);
 	cl->cur_act_ib = ib;
 	cl->cur_act_ab = ab;
 	cl->cur_dual_ib = slp_ib;
@@ -1324,7 +1432,8 @@ static int update_bw_context(struct msm_bus_client_handle *cl, u64 act_ab,
 				__func__, ret, cl->active_only);
 		goto exit_change_context;
 	}
-	commit_data();
+	commit_or_defer(act_ib > cl->cur_act_ib || act_ab > cl->cur_act_ab ||
+			slp_ib > cl->cur_dual_ib || slp_ab > cl->cur_dual_ab);
 	cl->cur_act_ib = act_ib;
 	cl->cur_act_ab = act_ab;
 	cl->cur_dual_ib = slp_ib;
@@ -1348,7 +1457,7 @@ static void unregister_adhoc(struct msm_bus_client_handle *cl)
 
 	remove_path(cl->mas_dev, cl->slv, cl->cur_act_ib, cl->cur_act_ab,
 				cl->first_hop, cl->active_only);
-	commit_data();
+	flush_votes();
 	msm_bus_dbg_remove_client(cl);
 	kfree(cl->name);
 	kfree(cl);
@@ -1429,4 +1538,6 @@ void msm_bus_arb_setops_adhoc(struct msm_bus_arb_ops *arb_ops)
 	arb_ops->unregister = unregister_adhoc;
 	arb_ops->update_bw = update_bw_adhoc;
 	arb_ops->update_bw_context = update_bw_context;
+	arb_ops->batch_begin = batch_begin_adhoc;
+	arb_ops->batch_commit = batch_commit_adhoc;
 }
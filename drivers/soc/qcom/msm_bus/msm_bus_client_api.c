@@ -212,3 +212,36 @@ int msm_bus_scale_query_tcs_cmd_all(struct msm_bus_tcs_handle *tcs_handle,
 	return -EPROBE_DEFER;
 }
 EXPORT_SYMBOL(msm_bus_scale_query_tcs_cmd_all);
+
+/**
+ * msm_bus_scale_batch_begin() - Start a batch of client votes
+ *
+ * Votes updated by the calling task until the matching
+ * msm_bus_scale_batch_commit() are aggregated as usual, but the fabric
+ * nodes they touch are only committed once, when the batch ends. Batches
+ * nest within a task. Returns -EBUSY if another task has a batch open, in
+ * which case the caller's votes are committed one by one as usual.
+ */
+int msm_bus_scale_batch_begin(void)
+{
+	if (arb_ops.batch_begin)
+		return arb_ops.batch_begin();
+
+	return 0;
+}
+EXPORT_SYMBOL(msm_bus_scale_batch_begin);
+
+/**
+ * msm_bus_scale_batch_commit() - End a batch of client votes
+ *
+ * Commits every node dirtied since the outermost msm_bus_scale_batch_begin()
+ * of the calling task.
+ */
+int msm_bus_scale_batch_commit(void)
+{
+	if (arb_ops.batch_commit)
+		return arb_ops.batch_commit();
+
+	return 0;
+}
+EXPORT_SYMBOL(msm_bus_scale_batch_commit);
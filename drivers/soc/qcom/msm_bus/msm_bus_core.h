@@ -73,7 +73,8 @@ struct msm_bus_arb_ops {
 				uint32_t cl, unsigned int index);
 	int (*query_usecase_all)(struct msm_bus_tcs_handle *tcs_handle,
 				uint32_t cl);
-
+	int (*batch_begin)(void);
+	int (*batch_commit)(void);
 };
 
 enum {
@@ -336,6 +337,8 @@ int msm_bus_dbg_add_client(const struct msm_bus_client_handle *pdata);
 int msm_bus_dbg_rec_transaction(const struct msm_bus_client_handle *pdata,
 						u64 ab, u64 ib);
 void msm_bus_dbg_remove_client(const struct msm_bus_client_handle *pdata);
+void msm_bus_dbg_rec_rpm_msg(void);
+void msm_bus_dbg_rec_commit(u64 latency_us, bool deferred);
 
 #else
 static inline void msm_bus_dbg_client_data(struct msm_bus_scale_pdata *pdata,
@@ -364,6 +367,14 @@ msm_bus_dbg_add_client(const struct msm_bus_client_handle *pdata)
 {
 	return 0;
 }
+
+static inline void msm_bus_dbg_rec_rpm_msg(void)
+{
+}
+
+static inline void msm_bus_dbg_rec_commit(u64 latency_us, bool deferred)
+{
+}
 #endif
 
 #ifdef CONFIG_CORESIGHT
@@ -23,6 +23,7 @@
 #include <linux/string.h>
 #include <linux/uaccess.h>
 #include <linux/hrtimer.h>
+#include <linux/spinlock.h>
 #include <linux/msm-bus-board.h>
 #include <linux/msm-bus.h>
 #include <linux/msm_bus_rules.h>
@@ -857,6 +858,108 @@ void msm_bus_dbg_commit_data(const char *fabname, void *cdata,
 }
 EXPORT_SYMBOL(msm_bus_dbg_commit_data);
 
+/* Statistics on RPM traffic and on how long votes take to be committed */
+static struct msm_bus_dbg_stats {
+	u64 rpm_msgs;
+	u64 rpm_win_start;
+	unsigned int rpm_win_cnt;
+	unsigned int rpm_last_sec;
+	unsigned int rpm_max_sec;
+	u64 commits;
+	u64 deferred_commits;
+	u64 lat_total_us;
+	u64 lat_max_us;
+} dbg_stats;
+static DEFINE_SPINLOCK(dbg_stats_lock);
+
+/**
+ * msm_bus_dbg_rec_rpm_msg() - Account one message sent to the RPM
+ */
+void msm_bus_dbg_rec_rpm_msg(void)
+{
+	u64 now = ktime_get_ns();
+	unsigned long flags;
+
+	spin_lock_irqsave(&dbg_stats_lock, flags);
+	dbg_stats.rpm_msgs++;
+	if (now - dbg_stats.rpm_win_start >= NSEC_PER_SEC) {
+		if (now - dbg_stats.rpm_win_start < 2 * NSEC_PER_SEC)
+			dbg_stats.rpm_last_sec = dbg_stats.rpm_win_cnt;
+		else
+			dbg_stats.rpm_last_sec = 0;
+		dbg_stats.rpm_max_sec = max(dbg_stats.rpm_max_sec,
+					    dbg_stats.rpm_win_cnt);
+		dbg_stats.rpm_win_start = now;
+		dbg_stats.rpm_win_cnt = 0;
+	}
+	dbg_stats.rpm_win_cnt++;
+	spin_unlock_irqrestore(&dbg_stats_lock, flags);
+}
+
+/**
+ * msm_bus_dbg_rec_commit() - Account one commit of dirty fabric nodes
+ * @latency_us: Time since the oldest vote in the commit was made
+ * @deferred: The commit was held back by a batch or the coalescing window
+ */
+void msm_bus_dbg_rec_commit(u64 latency_us, bool deferred)
+{
+	unsigned long flags;
+
+	spin_lock_irqsave(&dbg_stats_lock, flags);
+	dbg_stats.commits++;
+	if (deferred)
+		dbg_stats.deferred_commits++;
+	dbg_stats.lat_total_us += latency_us;
+	dbg_stats.lat_max_us = max(dbg_stats.lat_max_us, latency_us);
+	spin_unlock_irqrestore(&dbg_stats_lock, flags);
+}
+
+static int msm_bus_dbg_stats_show(struct seq_file *m, void *unused)
+{
+	struct msm_bus_dbg_stats st;
+	unsigned long flags;
+
+	spin_lock_irqsave(&dbg_stats_lock, flags);
+	st = dbg_stats;
+	spin_unlock_irqrestore(&dbg_stats_lock, flags);
+
+	seq_printf(m, "rpm_msgs: %llu\n", st.rpm_msgs);
+	seq_printf(m, "rpm_msgs_last_sec: %u\n", st.rpm_last_sec);
+	seq_printf(m, "rpm_msgs_max_sec: %u\n", st.rpm_max_sec);
+	seq_printf(m, "commits: %llu\n", st.commits);
+	seq_printf(m, "deferred_commits: %llu\n", st.deferred_commits);
+	seq_printf(m, "vote_latency_avg_us: %llu\n", st.commits ?
+		   div64_u64(st.lat_total_us, st.commits) : 0);
+	seq_printf(m, "vote_latency_max_us: %llu\n", st.lat_max_us);
+
+	return 0;
+}
+
+static ssize_t msm_bus_dbg_stats_write(struct file *file,
+	const char __user *ubuf, size_t cnt, loff_t *ppos)
+{
+	unsigned long flags;
+
+	spin_lock_irqsave(&dbg_stats_lock, flags);
+	memset(&dbg_stats, 0, sizeof(dbg_stats));
+	spin_unlock_irqrestore(&dbg_stats_lock, flags);
+
+	return cnt;
+}
+
+static int msm_bus_dbg_stats_open(struct inode *inode, struct file *file)
+{
+	return single_open(file, msm_bus_dbg_stats_show, NULL);
+}
+
+static const struct file_operations msm_bus_dbg_stats_fops = {
+	.open		= msm_bus_dbg_stats_open,
+	.read		= seq_read,
+	.write		= msm_bus_dbg_stats_write,
+	.llseek		= seq_lseek,
+	.release	= single_release,
+};
+
 static int __init msm_bus_debugfs_init(void)
 {
 	struct dentry *commit, *shell_client, *rules_dbg;
@@ -949,6 +1052,10 @@ static int __init msm_bus_debugfs_init(void)
 		clients, NULL, &msm_bus_dbg_dump_clients_fops) == NULL)
 		goto err;
 
+	if (debugfs_create_file("stats", S_IRUGO | S_IWUSR, dir, NULL,
+		&msm_bus_dbg_stats_fops) == NULL)
+		goto err;
+
 	mutex_lock(&msm_bus_dbg_fablist_lock);
 	list_for_each_entry(fablist, &fabdata_list, list) {
 		fablist->file = debugfs_create_file(fablist->name, S_IRUGO,
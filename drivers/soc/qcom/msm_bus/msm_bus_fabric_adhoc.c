@@ -268,6 +268,7 @@ static int send_rpm_msg(struct msm_bus_node_device_type *ndev, int ctx)
 		rsc_type = RPM_BUS_MASTER_REQ;
 		ret = msm_rpm_send_message(rpm_ctx, rsc_type,
 			ndev->node_info->mas_rpm_id, &rpm_kvp, 1);
+		msm_bus_dbg_rec_rpm_msg();
 		if (ret) {
 			MSM_BUS_ERR("%s: Failed to send RPM message:",
 					__func__);
@@ -285,6 +286,7 @@ static int send_rpm_msg(struct msm_bus_node_device_type *ndev, int ctx)
 		rsc_type = RPM_BUS_SLAVE_REQ;
 		ret = msm_rpm_send_message(rpm_ctx, rsc_type,
 			ndev->node_info->slv_rpm_id, &rpm_kvp, 1);
+		msm_bus_dbg_rec_rpm_msg();
 		if (ret) {
 			MSM_BUS_ERR("%s: Failed to send RPM message:",
 						__func__);
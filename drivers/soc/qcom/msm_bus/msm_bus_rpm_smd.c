@@ -117,6 +117,7 @@ static int msm_bus_rpm_req(int ctx, uint32_t rsc_type, uint32_t key,
 	}
 
 	msg_id = msm_rpm_send_request(rpm_req);
+	msm_bus_dbg_rec_rpm_msg();
 	if (!msg_id) {
 		MSM_BUS_WARN("RPM: No message ID for req\n");
 		ret = -ENXIO;
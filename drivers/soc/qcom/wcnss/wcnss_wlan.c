@@ -39,6 +39,9 @@
 #include <linux/bitops.h>
 #include <linux/cdev.h>
 #include <linux/ipc_logging.h>
+#include <linux/vmalloc.h>
+#include <linux/crc32.h>
+#include <linux/ktime.h>
 #include <soc/qcom/socinfo.h>
 
 #include <soc/qcom/subsystem_restart.h>
@@ -271,9 +274,15 @@ static struct notifier_block wnb = {
 #define NVBIN_FILE "wlan/prima/WCNSS_qcom_wlan_nv.bin"
 
 /* On SMD channel 4K of maximum data can be transferred, including message
- * header, so NV fragment size as next multiple of 1Kb is 3Kb.
+ * header, so each NV and cal data fragment fills a frame up to that limit.
  */
-#define NV_FRAGMENT_SIZE  3072
+#define WCNSS_SMD_MAX_FRAME_SIZE  4096
+#define NV_FRAGMENT_SIZE \
+	(WCNSS_SMD_MAX_FRAME_SIZE - sizeof(struct nvbin_dnld_req_msg))
+#define CAL_FRAGMENT_SIZE \
+	(WCNSS_SMD_MAX_FRAME_SIZE - sizeof(struct cal_data_msg))
+/* How long a fragment may wait for room in the SMD FIFO */
+#define WCNSS_SMD_TX_TIMEOUT_MS   100
 #define MAX_CALIBRATED_DATA_SIZE  (64 * 1024)
 #define LAST_FRAGMENT        BIT(0)
 #define MESSAGE_TO_FOLLOW    BIT(1)
@@ -281,9 +290,8 @@ static struct notifier_block wnb = {
 #define WCNSS_RESP_SUCCESS   1
 #define WCNSS_RESP_FAIL      0
 
-/* Macro to find the total number fragments of the NV bin Image */
-#define TOTALFRAGMENTS(x) ((((x) % NV_FRAGMENT_SIZE) == 0) ? \
-	((x) / NV_FRAGMENT_SIZE) : (((x) / NV_FRAGMENT_SIZE) + 1))
+/* Macro to find the total number fragments of a download image */
+#define TOTALFRAGMENTS(x, frag) DIV_ROUND_UP(x, frag)
 
 struct nvbin_dnld_req_params {
 	/* Fragment sequence number of the NV bin Image. NV Bin Image
@@ -416,6 +424,13 @@ static struct {
 	int	user_cal_available;
 	u32	user_cal_rcvd;
 	u32	user_cal_exp_size;
+	/* NV blob kept from the first load, valid for nv_cache_version */
+	unsigned char *nv_cache;
+	unsigned int nv_cache_size;
+	u32	nv_cache_crc;
+	unsigned char nv_cache_version[WCNSS_VERSION_LEN];
+	ktime_t	dnld_start;
+	wait_queue_head_t smd_tx_wait;
 	int	iris_xo_mode_set;
 	int	fw_vbatt_state;
 	char	wlan_nv_mac_addr[WLAN_MAC_ADDR_SIZE];
@@ -1303,6 +1318,7 @@ static void wcnss_smd_notify_event(void *data, unsigned int event)
 	}
 	switch (event) {
 	case SMD_EVENT_DATA:
+		wake_up(&penv->smd_tx_wait);
 		len = smd_read_avail(penv->smd_ch);
 		if (len < 0) {
 			wcnss_log(ERR, "failed to read from smd %d\n", len);
@@ -1939,6 +1955,26 @@ static int wcnss_smd_tx(void *data, int len)
 	return ret;
 }
 
+/* Send a download fragment, waiting for the remote side to drain the FIFO
+ * when it is full, so that fragments go out back to back.
+ */
+static int wcnss_smd_tx_wait(void *data, int len)
+{
+	unsigned long timeout = jiffies +
+				msecs_to_jiffies(WCNSS_SMD_TX_TIMEOUT_MS);
+	int ret;
+
+	for (;;) {
+		ret = wcnss_smd_tx(data, len);
+		if (ret != -ENOSPC || time_after(jiffies, timeout))
+			return ret;
+
+		wait_event_timeout(penv->smd_tx_wait,
+				   smd_write_avail(penv->smd_ch) >= len,
+				   msecs_to_jiffies(2));
+	}
+}
+
 static int wcnss_get_battery_volt(int *result_uv)
 {
 	int rc = -1;
@@ -2325,6 +2361,8 @@ static void wcnss_process_smd_msg(int len)
 		fw_status = wcnss_fw_status();
 		wcnss_log(DBG, "received WCNSS_NVBIN_DNLD_RSP from ccpu %u\n",
 			 fw_status);
+		wcnss_log(INFO, "NV download done in %lld us\n",
+			  ktime_us_delta(ktime_get(), penv->dnld_start));
 		if (fw_status != WAIT_FOR_CBC_IND)
 			penv->is_cbc_done = 1;
 		wcnss_setup_vbat_monitoring();
@@ -2438,47 +2476,88 @@ static void wcnss_pm_qos_enable_pc(struct work_struct *worker)
 
 static DECLARE_RWSEM(wcnss_pm_sem);
 
-static void wcnss_nvbin_dnld(void)
+/* The NV blob only changes with the firmware, so it is read from the
+ * filesystem once and then sent from memory on every WLAN start for as long
+ * as WCNSS reports the same version.
+ */
+static int wcnss_nv_cache_load(void)
 {
-	int ret = 0;
-	struct nvbin_dnld_req_msg *dnld_req_msg;
-	unsigned short total_fragments = 0;
-	unsigned short count = 0;
-	unsigned short retry_count = 0;
-	unsigned short cur_frag_size = 0;
-	unsigned char *outbuffer = NULL;
-	const void *nv_blob_addr = NULL;
-	unsigned int nv_blob_size = 0;
 	const struct firmware *nv = NULL;
 	struct device *dev = &penv->pdev->dev;
+	int ret;
 
-	down_read(&wcnss_pm_sem);
+	if (penv->nv_cache) {
+		if (!strncmp(penv->nv_cache_version, penv->wcnss_version,
+			     WCNSS_VERSION_LEN) &&
+		    crc32(0, penv->nv_cache, penv->nv_cache_size) ==
+		    penv->nv_cache_crc)
+			return 0;
+
+		wcnss_log(INFO, "NV cache for %s is stale, reloading\n",
+			  penv->nv_cache_version);
+		vfree(penv->nv_cache);
+		penv->nv_cache = NULL;
+	}
 
 	ret = request_firmware(&nv, NVBIN_FILE, dev);
 
-	if (ret || !nv || !nv->data || !nv->size) {
+	if (ret || !nv || !nv->data || nv->size <= 4) {
 		wcnss_log(ERR,
 			  "%s: request_firmware failed for %s (ret = %d)\n",
 		       __func__, NVBIN_FILE, ret);
-		goto out;
+		release_firmware(nv);
+		return ret ? ret : -EINVAL;
 	}
 
 	/* First 4 bytes in nv blob is validity bitmap.
 	 * We cannot validate nv, so skip those 4 bytes.
 	 */
-	nv_blob_addr = nv->data + 4;
-	nv_blob_size = nv->size - 4;
+	penv->nv_cache_size = nv->size - 4;
+	penv->nv_cache = vmalloc(penv->nv_cache_size);
+	if (!penv->nv_cache) {
+		release_firmware(nv);
+		return -ENOMEM;
+	}
 
-	total_fragments = TOTALFRAGMENTS(nv_blob_size);
+	memcpy(penv->nv_cache, nv->data + 4, penv->nv_cache_size);
+	release_firmware(nv);
+
+	penv->nv_cache_crc = crc32(0, penv->nv_cache, penv->nv_cache_size);
+	memcpy(penv->nv_cache_version, penv->wcnss_version, WCNSS_VERSION_LEN);
 
-	wcnss_log(INFO, "NV bin size: %d, total_fragments: %d\n",
-		nv_blob_size, total_fragments);
+	return 0;
+}
+
+static void wcnss_nvbin_dnld(void)
+{
+	int ret = 0;
+	struct nvbin_dnld_req_msg *dnld_req_msg;
+	unsigned short total_fragments = 0;
+	unsigned short count = 0;
+	unsigned short cur_frag_size = 0;
+	unsigned char *outbuffer = NULL;
+	const void *nv_blob_addr = NULL;
+	unsigned int nv_blob_size = 0;
+	ktime_t start = ktime_get();
+
+	down_read(&wcnss_pm_sem);
+
+	if (wcnss_nv_cache_load())
+		goto out;
+
+	nv_blob_addr = penv->nv_cache;
+	nv_blob_size = penv->nv_cache_size;
+
+	total_fragments = TOTALFRAGMENTS(nv_blob_size, NV_FRAGMENT_SIZE);
+
+	wcnss_log(INFO, "NV bin size: %d, total_fragments: %d, load %lld us\n",
+		  nv_blob_size, total_fragments,
+		  ktime_us_delta(ktime_get(), start));
 
 	/* get buffer for nv bin dnld req message */
-	outbuffer = kmalloc((sizeof(struct nvbin_dnld_req_msg) +
-			     NV_FRAGMENT_SIZE), GFP_KERNEL);
+	outbuffer = kmalloc(WCNSS_SMD_MAX_FRAME_SIZE, GFP_KERNEL);
 	if (!outbuffer)
-		goto err_free_nv;
+		goto out;
 
 	dnld_req_msg = (struct nvbin_dnld_req_msg *)outbuffer;
 
@@ -2515,42 +2594,23 @@ static void wcnss_nvbin_dnld(void)
 		       (nv_blob_addr + count * NV_FRAGMENT_SIZE),
 		       cur_frag_size);
 
-		ret = wcnss_smd_tx(outbuffer, dnld_req_msg->hdr.msg_len);
-
-		retry_count = 0;
-		while ((ret == -ENOSPC) && (retry_count <= 3)) {
-			wcnss_log(DBG, "%s: smd tx failed, ENOSPC\n",
-				 __func__);
-			wcnss_log(DBG, "fragment %d, len: %d,", count,
-				  dnld_req_msg->hdr.msg_len);
-			wcnss_log(DBG, "TotFragments: %d, retry_count: %d\n",
-				  total_fragments, retry_count);
-
-			/* wait and try again */
-			msleep(20);
-			retry_count++;
-			ret = wcnss_smd_tx(outbuffer,
-					   dnld_req_msg->hdr.msg_len);
-		}
-
+		ret = wcnss_smd_tx_wait(outbuffer, dnld_req_msg->hdr.msg_len);
 		if (ret < 0) {
 			wcnss_log(ERR, "%s: smd tx failed\n", __func__);
 			wcnss_log(ERR, "fragment %d, len: %d,", count,
 				  dnld_req_msg->hdr.msg_len);
-			wcnss_log(ERR, "TotFragments: %d, retry_count: %d\n",
-				  total_fragments, retry_count);
+			wcnss_log(ERR, "TotFragments: %d\n", total_fragments);
 			goto err_dnld;
 		}
 	}
 
+	wcnss_log(INFO, "NV download sent in %lld us\n",
+		  ktime_us_delta(ktime_get(), start));
+
 err_dnld:
 	/* free buffer */
 	kfree(outbuffer);
 
-err_free_nv:
-	/* release firmware */
-	release_firmware(nv);
-
 out:
 	up_read(&wcnss_pm_sem);
 }
@@ -2562,14 +2622,12 @@ static void wcnss_caldata_dnld(const void *cal_data,
 	struct cal_data_msg *cal_msg;
 	unsigned short total_fragments = 0;
 	unsigned short count = 0;
-	unsigned short retry_count = 0;
 	unsigned short cur_frag_size = 0;
 	unsigned char *outbuffer = NULL;
 
-	total_fragments = TOTALFRAGMENTS(cal_data_size);
+	total_fragments = TOTALFRAGMENTS(cal_data_size, CAL_FRAGMENT_SIZE);
 
-	outbuffer = kmalloc((sizeof(struct cal_data_msg) +
-			     NV_FRAGMENT_SIZE), GFP_KERNEL);
+	outbuffer = kmalloc(WCNSS_SMD_MAX_FRAME_SIZE, GFP_KERNEL);
 	if (!outbuffer)
 		return;
 
@@ -2582,9 +2640,9 @@ static void wcnss_caldata_dnld(const void *cal_data,
 		cal_msg->cal_params.frag_number = count;
 
 		if (count == (total_fragments - 1)) {
-			cur_frag_size = cal_data_size % NV_FRAGMENT_SIZE;
+			cur_frag_size = cal_data_size % CAL_FRAGMENT_SIZE;
 			if (!cur_frag_size)
-				cur_frag_size = NV_FRAGMENT_SIZE;
+				cur_frag_size = CAL_FRAGMENT_SIZE;
 
 			cal_msg->cal_params.msg_flags
 			    |= LAST_FRAGMENT;
@@ -2592,7 +2650,7 @@ static void wcnss_caldata_dnld(const void *cal_data,
 				cal_msg->cal_params.msg_flags |=
 					MESSAGE_TO_FOLLOW;
 		} else {
-			cur_frag_size = NV_FRAGMENT_SIZE;
+			cur_frag_size = CAL_FRAGMENT_SIZE;
 			cal_msg->cal_params.msg_flags &=
 				~LAST_FRAGMENT;
 		}
@@ -2605,32 +2663,14 @@ static void wcnss_caldata_dnld(const void *cal_data,
 			sizeof(struct cal_data_msg) + cur_frag_size;
 
 		memcpy((outbuffer + sizeof(struct cal_data_msg)),
-		       (cal_data + count * NV_FRAGMENT_SIZE),
+		       (cal_data + count * CAL_FRAGMENT_SIZE),
 		       cur_frag_size);
 
-		ret = wcnss_smd_tx(outbuffer, cal_msg->hdr.msg_len);
-
-		retry_count = 0;
-		while ((ret == -ENOSPC) && (retry_count <= 3)) {
-			wcnss_log(DBG, "%s: smd tx failed, ENOSPC\n",
-				 __func__);
-			wcnss_log(DBG, "fragment: %d, len: %d",
-				  count, cal_msg->hdr.msg_len);
-			wcnss_log(DBG, " TotFragments: %d, retry_count: %d\n",
-				  total_fragments, retry_count);
-
-			/* wait and try again */
-			msleep(20);
-			retry_count++;
-			ret = wcnss_smd_tx(outbuffer,
-					   cal_msg->hdr.msg_len);
-		}
-
+		ret = wcnss_smd_tx_wait(outbuffer, cal_msg->hdr.msg_len);
 		if (ret < 0) {
 			wcnss_log(ERR, "%s: smd tx failed: fragment %d, len:%d",
-				  count, cal_msg->hdr.msg_len, __func__);
-			wcnss_log(ERR, " TotFragments: %d, retry_count: %d\n",
-				  total_fragments, retry_count);
+				  __func__, count, cal_msg->hdr.msg_len);
+			wcnss_log(ERR, " TotFragments: %d\n", total_fragments);
 			goto err_dnld;
 		}
 	}
@@ -2644,6 +2684,8 @@ static void wcnss_nvbin_dnld_main(struct work_struct *worker)
 {
 	int retry = 0;
 
+	penv->dnld_start = ktime_get();
+
 	if (!FW_CALDATA_CAPABLE())
 		goto nv_download;
 
@@ -2662,6 +2704,10 @@ static void wcnss_nvbin_dnld_main(struct work_struct *worker)
 				   penv->user_cal_rcvd, true);
 	}
 
+	if (penv->fw_cal_available || penv->user_cal_available)
+		wcnss_log(INFO, "cal download sent in %lld us\n",
+			  ktime_us_delta(ktime_get(), penv->dnld_start));
+
 nv_download:
 	wcnss_log(INFO, "NV download");
 	wcnss_nvbin_dnld();
@@ -3603,6 +3649,7 @@ wcnss_wlan_probe(struct platform_device *pdev)
 	mutex_init(&penv->vbat_monitor_mutex);
 	mutex_init(&penv->pm_qos_mutex);
 	init_waitqueue_head(&penv->read_wait);
+	init_waitqueue_head(&penv->smd_tx_wait);
 
 	penv->user_cal_rcvd = 0;
 	penv->user_cal_read = 0;
@@ -3629,6 +3676,7 @@ wcnss_wlan_remove(struct platform_device *pdev)
 		subsys_notif_unregister_notifier(penv->wcnss_notif_hdle, &wnb);
 	wcnss_cdev_unregister(pdev);
 	wcnss_remove_sysfs(&pdev->dev);
+	vfree(penv->nv_cache);
 	penv = NULL;
 	return 0;
 }
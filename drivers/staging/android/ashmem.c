@@ -32,6 +32,9 @@
 #include <linux/bitops.h>
 #include <linux/mutex.h>
 #include <linux/shmem_fs.h>
+#include <linux/interval_tree_generic.h>
+#include <linux/wait.h>
+#include <linux/sort.h>
 #include "ashmem.h"
 
 #define ASHMEM_NAME_PREFIX "dev/ashmem/"
@@ -41,19 +44,25 @@
 /**
  * struct ashmem_area - The anonymous shared memory area
  * @name:		The optional name in /proc/pid/maps
- * @unpinned_list:	The list of all ashmem areas
+ * @unpinned:		Interval tree of the unpinned ranges of this area
+ * @unpinned_lock:	Protects @unpinned
+ * @purge_inflight:	Purges of this area's ranges still being punched out
  * @file:		The shmem-based backing file
  * @size:		The size of the mapping, in bytes
  * @prot_mask:		The allowed protection bits, as vm_flags
  *
  * The lifecycle of this structure is from our parent file's open() until
- * its release(). It is also protected by 'ashmem_mutex'
+ * its release(). @name, @file, @size and @prot_mask are protected by
+ * 'ashmem_mutex'; @file is only ever set once, with @size fixed from then
+ * on, so pin and unpin read it without that mutex.
  *
  * Warning: Mappings do NOT pin this structure; It dies on close()
  */
 struct ashmem_area {
 	char name[ASHMEM_FULL_NAME_LEN];
-	struct list_head unpinned_list;
+	struct rb_root unpinned;
+	struct mutex unpinned_lock;
+	atomic_t purge_inflight;
 	struct file *file;
 	size_t size;
 	unsigned long prot_mask;
@@ -62,40 +71,59 @@ struct ashmem_area {
 /**
  * struct ashmem_range - A range of unpinned/evictable pages
  * @lru:	         The entry in the LRU list
- * @unpinned:	         The entry in its area's unpinned list
+ * @rb:		         The node in its area's unpinned interval tree
+ * @__subtree_last:      Largest @pgend in the subtree below @rb
  * @asma:	         The associated anonymous shared memory area.
  * @pgstart:	         The starting page (inclusive)
  * @pgend:	         The ending page (inclusive)
  * @purged:	         The purge status (ASHMEM_NOT or ASHMEM_WAS_PURGED)
  *
- * The lifecycle of this structure is from unpin to pin.
- * It is protected by 'ashmem_mutex'
+ * The lifecycle of this structure is from unpin to pin.  It is protected
+ * by its area's 'unpinned_lock'; @lru and @purged are also protected by
+ * 'ashmem_lru_lock', and @pgstart/@pgend may only change under both.
  */
 struct ashmem_range {
 	struct list_head lru;
-	struct list_head unpinned;
+	struct rb_node rb;
+	size_t __subtree_last;
 	struct ashmem_area *asma;
 	size_t pgstart;
 	size_t pgend;
 	unsigned int purged;
 };
 
-/* LRU list of unpinned pages, protected by ashmem_mutex */
+#define range_start(range)	((range)->pgstart)
+#define range_last(range)	((range)->pgend)
+
+INTERVAL_TREE_DEFINE(struct ashmem_range, rb, size_t, __subtree_last,
+		     range_start, range_last, static, range_tree)
+
+/* LRU list of unpinned pages, protected by ashmem_lru_lock */
 static LIST_HEAD(ashmem_lru_list);
 
 /*
  * long lru_count - The count of pages on our LRU list.
  *
- * This is protected by ashmem_mutex.
+ * This is protected by ashmem_lru_lock.
  */
 static unsigned long lru_count;
 
 /*
- * ashmem_mutex - protects the list of and each individual ashmem_area
+ * ashmem_mutex - protects the name, size, file and protection mask of
+ * each individual ashmem_area
  *
  * Lock Ordering: ashmex_mutex -> i_mutex -> i_alloc_sem
+ *		  asma->unpinned_lock -> ashmem_lru_lock
  */
 static DEFINE_MUTEX(ashmem_mutex);
+static DEFINE_SPINLOCK(ashmem_lru_lock);
+
+/*
+ * Purges punch their holes with no lock held.  Pinning a range that was
+ * picked for purging, and releasing an area, wait on this queue until
+ * the area's purges have completed.
+ */
+static DECLARE_WAIT_QUEUE_HEAD(ashmem_purge_wait);
 
 static struct kmem_cache *ashmem_area_cachep __read_mostly;
 static struct kmem_cache *ashmem_range_cachep __read_mostly;
@@ -118,23 +146,6 @@ static inline int page_range_subsumed_by_range(struct ashmem_range *range,
 	return (((range)->pgstart <= (start)) && ((range)->pgend >= (end)));
 }
 
-static inline int page_in_range(struct ashmem_range *range, size_t page)
-{
-	return (((range)->pgstart <= (page)) && ((range)->pgend >= (page)));
-}
-
-static inline int page_range_in_range(struct ashmem_range *range,
-				      size_t start, size_t end)
-{
-	return (page_in_range(range, start) || page_in_range(range, end) ||
-		page_range_subsumes_range(range, start, end));
-}
-
-static inline int range_before_page(struct ashmem_range *range, size_t page)
-{
-	return ((range)->pgend < (page));
-}
-
 #define PROT_MASK		(PROT_EXEC | PROT_READ | PROT_WRITE)
 
 /**
@@ -143,6 +154,8 @@ static inline int range_before_page(struct ashmem_range *range, size_t page)
  *
  * The range is first added to the end (tail) of the LRU list.
  * After this, the size of the range is added to @lru_count
+ *
+ * Caller must hold ashmem_lru_lock.
  */
 static inline void lru_add(struct ashmem_range *range)
 {
@@ -156,6 +169,8 @@ static inline void lru_add(struct ashmem_range *range)
  *
  * The range is first deleted from the LRU list.
  * After this, the size of the range is removed from @lru_count
+ *
+ * Caller must hold ashmem_lru_lock.
  */
 static inline void lru_del(struct ashmem_range *range)
 {
@@ -166,17 +181,15 @@ static inline void lru_del(struct ashmem_range *range)
 /**
  * range_alloc() - Allocates and initializes a new ashmem_range structure
  * @asma:	   The associated ashmem_area
- * @prev_range:	   The previous ashmem_range in the sorted asma->unpinned list
  * @purged:	   Initial purge status (ASMEM_NOT_PURGED or ASHMEM_WAS_PURGED)
  * @start:	   The starting page (inclusive)
  * @end:	   The ending page (inclusive)
  *
- * This function is protected by ashmem_mutex.
+ * Caller must hold asma->unpinned_lock.
  *
  * Return: 0 if successful, or -ENOMEM if there is an error
  */
-static int range_alloc(struct ashmem_area *asma,
-		       struct ashmem_range *prev_range, unsigned int purged,
+static int range_alloc(struct ashmem_area *asma, unsigned int purged,
 		       size_t start, size_t end)
 {
 	struct ashmem_range *range;
@@ -190,10 +203,12 @@ static int range_alloc(struct ashmem_area *asma,
 	range->pgend = end;
 	range->purged = purged;
 
-	list_add_tail(&range->unpinned, &prev_range->unpinned);
+	range_tree_insert(range, &asma->unpinned);
 
+	spin_lock(&ashmem_lru_lock);
 	if (range_on_lru(range))
 		lru_add(range);
+	spin_unlock(&ashmem_lru_lock);
 
 	return 0;
 }
@@ -201,13 +216,25 @@ static int range_alloc(struct ashmem_area *asma,
 /**
  * range_del() - Deletes and dealloctes an ashmem_range structure
  * @range:	 The associated ashmem_range that has previously been allocated
+ *
+ * Caller must hold range->asma->unpinned_lock.
+ *
+ * Return: the purge status the range had when it was removed
  */
-static void range_del(struct ashmem_range *range)
+static unsigned int range_del(struct ashmem_range *range)
 {
-	list_del(&range->unpinned);
+	unsigned int purged;
+
+	range_tree_remove(range, &range->asma->unpinned);
+
+	spin_lock(&ashmem_lru_lock);
+	purged = range->purged;
 	if (range_on_lru(range))
 		lru_del(range);
+	spin_unlock(&ashmem_lru_lock);
+
 	kmem_cache_free(ashmem_range_cachep, range);
+	return purged;
 }
 
 /**
@@ -221,17 +248,31 @@ static void range_del(struct ashmem_range *range)
  *
  * Theoretically, with a little tweaking, this could eventually be changed
  * to range_resize, and expand the lru_count if the new range is larger.
+ *
+ * Caller must hold range->asma->unpinned_lock.
+ *
+ * Return: the purge status of the range
  */
-static inline void range_shrink(struct ashmem_range *range,
-				size_t start, size_t end)
+static unsigned int range_shrink(struct ashmem_range *range,
+				 size_t start, size_t end)
 {
-	size_t pre = range_size(range);
+	struct rb_root *root = &range->asma->unpinned;
+	unsigned int purged;
+	size_t pre;
 
+	range_tree_remove(range, root);
+
+	spin_lock(&ashmem_lru_lock);
+	pre = range_size(range);
 	range->pgstart = start;
 	range->pgend = end;
-
+	purged = range->purged;
 	if (range_on_lru(range))
 		lru_count -= pre - range_size(range);
+	spin_unlock(&ashmem_lru_lock);
+
+	range_tree_insert(range, root);
+	return purged;
 }
 
 /**
@@ -257,7 +298,9 @@ static int ashmem_open(struct inode *inode, struct file *file)
 	if (unlikely(!asma))
 		return -ENOMEM;
 
-	INIT_LIST_HEAD(&asma->unpinned_list);
+	asma->unpinned = RB_ROOT;
+	mutex_init(&asma->unpinned_lock);
+	atomic_set(&asma->purge_inflight, 0);
 	memcpy(asma->name, ASHMEM_NAME_PREFIX, ASHMEM_NAME_PREFIX_LEN);
 	asma->prot_mask = PROT_MASK;
 	file->private_data = asma;
@@ -276,12 +319,15 @@ static int ashmem_open(struct inode *inode, struct file *file)
 static int ashmem_release(struct inode *ignored, struct file *file)
 {
 	struct ashmem_area *asma = file->private_data;
-	struct ashmem_range *range, *next;
+	struct rb_node *node;
 
-	mutex_lock(&ashmem_mutex);
-	list_for_each_entry_safe(range, next, &asma->unpinned_list, unpinned)
-		range_del(range);
-	mutex_unlock(&ashmem_mutex);
+	mutex_lock(&asma->unpinned_lock);
+	while ((node = rb_first(&asma->unpinned)))
+		range_del(rb_entry(node, struct ashmem_range, rb));
+	mutex_unlock(&asma->unpinned_lock);
+
+	/* a purge in flight still uses asma */
+	wait_event(ashmem_purge_wait, !atomic_read(&asma->purge_inflight));
 
 	if (asma->file)
 		fput(asma->file);
@@ -426,7 +472,6 @@ static int ashmem_mmap(struct file *file, struct vm_area_struct *vma)
 			goto out;
 		}
 		vmfile->f_mode |= FMODE_LSEEK;
-		asma->file = vmfile;
 		/*
 		 * override mmap operation of the vmfile so that it can't be
 		 * remapped which would lead to creation of a new vma with no
@@ -440,6 +485,8 @@ static int ashmem_mmap(struct file *file, struct vm_area_struct *vma)
 					ashmem_vmfile_get_unmapped_area;
 		}
 		vmfile->f_op = &vmfile_fops;
+		/* pairs with the smp_load_acquire() in ashmem_pin_unpin() */
+		smp_store_release(&asma->file, vmfile);
 	}
 	get_file(asma->file);
 
@@ -456,6 +503,61 @@ static int ashmem_mmap(struct file *file, struct vm_area_struct *vma)
 	return ret;
 }
 
+/*
+ * Ranges taken off the LRU in one go by the shrinker.  Their holes are
+ * punched after ashmem_lru_lock is dropped, sorted so that neighbouring
+ * ranges of the same file become a single fallocate() call.
+ */
+#define ASHMEM_PURGE_BATCH	32
+
+struct ashmem_purge {
+	struct ashmem_area *asma;
+	struct file *file;
+	loff_t start;
+	loff_t end;
+};
+
+static struct ashmem_purge ashmem_purge_batch[ASHMEM_PURGE_BATCH];
+static DEFINE_MUTEX(ashmem_purge_mutex);	/* protects ashmem_purge_batch */
+
+static int ashmem_purge_cmp(const void *a, const void *b)
+{
+	const struct ashmem_purge *pa = a, *pb = b;
+
+	if (pa->file != pb->file)
+		return pa->file < pb->file ? -1 : 1;
+	if (pa->start != pb->start)
+		return pa->start < pb->start ? -1 : 1;
+	return 0;
+}
+
+static void ashmem_purge_ranges(struct ashmem_purge *batch, unsigned int n)
+{
+	unsigned int i, j;
+
+	sort(batch, n, sizeof(*batch), ashmem_purge_cmp, NULL);
+
+	for (i = 0; i < n; i = j) {
+		struct file *file = batch[i].file;
+		loff_t start = batch[i].start;
+		loff_t end = batch[i].end;
+
+		for (j = i + 1; j < n && batch[j].file == file &&
+		     batch[j].start <= end; j++)
+			end = max(end, batch[j].end);
+
+		file->f_op->fallocate(file,
+				FALLOC_FL_PUNCH_HOLE | FALLOC_FL_KEEP_SIZE,
+				start, end - start);
+	}
+
+	for (i = 0; i < n; i++) {
+		fput(batch[i].file);
+		if (atomic_dec_and_test(&batch[i].asma->purge_inflight))
+			wake_up_all(&ashmem_purge_wait);
+	}
+}
+
 /*
  * ashmem_shrink - our cache shrinker, called from mm/vmscan.c
  *
@@ -463,41 +565,62 @@ static int ashmem_mmap(struct file *file, struct vm_area_struct *vma)
  *
  * 'gfp_mask' is the mask of the allocation that got us into this mess.
  *
- * Return value is the number of objects freed or -1 if we cannot
+ * Return value is the number of objects freed or SHRINK_STOP if we cannot
  * proceed without risk of deadlock (due to gfp_mask).
  *
  * We approximate LRU via least-recently-unpinned, jettisoning unpinned partial
- * chunks of ashmem regions LRU-wise one-at-a-time until we hit 'nr_to_scan'
- * pages freed.
+ * chunks of ashmem regions LRU-wise in batches of ASHMEM_PURGE_BATCH until we
+ * hit 'nr_to_scan' pages freed.  Ranges are marked purged and taken off the
+ * LRU under ashmem_lru_lock only; the holes are punched with no lock held.
  */
 static unsigned long
 ashmem_shrink_scan(struct shrinker *shrink, struct shrink_control *sc)
 {
-	struct ashmem_range *range, *next;
+	struct ashmem_purge *batch = ashmem_purge_batch;
+	unsigned long to_scan = sc->nr_to_scan;
 	unsigned long freed = 0;
 
 	/* We might recurse into filesystem code, so bail out if necessary */
 	if (!(sc->gfp_mask & __GFP_FS))
 		return SHRINK_STOP;
 
-	if (!mutex_trylock(&ashmem_mutex))
-		return -1;
+	if (!mutex_trylock(&ashmem_purge_mutex))
+		return SHRINK_STOP;
 
-	list_for_each_entry_safe(range, next, &ashmem_lru_list, lru) {
-		loff_t start = range->pgstart * PAGE_SIZE;
-		loff_t end = (range->pgend + 1) * PAGE_SIZE;
+	while (to_scan) {
+		struct ashmem_range *range;
+		unsigned int n = 0;
 
-		range->asma->file->f_op->fallocate(range->asma->file,
-				FALLOC_FL_PUNCH_HOLE | FALLOC_FL_KEEP_SIZE,
-				start, end - start);
-		range->purged = ASHMEM_WAS_PURGED;
-		lru_del(range);
+		spin_lock(&ashmem_lru_lock);
+		while (n < ASHMEM_PURGE_BATCH && to_scan &&
+		       !list_empty(&ashmem_lru_list)) {
+			struct ashmem_purge *p = &batch[n++];
+			size_t size;
+
+			range = list_first_entry(&ashmem_lru_list,
+						 struct ashmem_range, lru);
+			size = range_size(range);
+
+			p->asma = range->asma;
+			p->file = get_file(range->asma->file);
+			p->start = range->pgstart * PAGE_SIZE;
+			p->end = (range->pgend + 1) * PAGE_SIZE;
+			atomic_inc(&range->asma->purge_inflight);
+
+			lru_del(range);
+			range->purged = ASHMEM_WAS_PURGED;
 
-		freed += range_size(range);
-		if (--sc->nr_to_scan <= 0)
+			freed += size;
+			to_scan -= min_t(unsigned long, to_scan, size);
+		}
+		spin_unlock(&ashmem_lru_lock);
+
+		if (!n)
 			break;
+		ashmem_purge_ranges(batch, n);
 	}
-	mutex_unlock(&ashmem_mutex);
+
+	mutex_unlock(&ashmem_purge_mutex);
 	return freed;
 }
 
@@ -615,126 +738,113 @@ static int get_name(struct ashmem_area *asma, void __user *name)
  * ashmem_pin - pin the given ashmem region, returning whether it was
  * previously purged (ASHMEM_WAS_PURGED) or not (ASHMEM_NOT_PURGED).
  *
- * Caller must hold ashmem_mutex.
+ * Caller must hold asma->unpinned_lock.
  */
 static int ashmem_pin(struct ashmem_area *asma, size_t pgstart, size_t pgend)
 {
-	struct ashmem_range *range, *next;
+	struct ashmem_range *range;
 	int ret = ASHMEM_NOT_PURGED;
+	unsigned int purged;
+	size_t end;
 
-	list_for_each_entry_safe(range, next, &asma->unpinned_list, unpinned) {
-		/* moved past last applicable page; we can short circuit */
-		if (range_before_page(range, pgstart))
-			break;
+	/*
+	 * The user can ask us to pin pages that span multiple ranges,
+	 * or to pin pages that aren't even unpinned, so this is messy.
+	 * Every pass below leaves the range clear of [pgstart, pgend],
+	 * so we simply look up the next overlapping range until none are
+	 * left.
+	 *
+	 * Four cases:
+	 * 1. The requested range subsumes an existing range, so we
+	 *    just remove the entire matching range.
+	 * 2. The requested range overlaps the start of an existing
+	 *    range, so we just update that range.
+	 * 3. The requested range overlaps the end of an existing
+	 *    range, so we just update that range.
+	 * 4. The requested range punches a hole in an existing range,
+	 *    so we have to update one side of the range and then
+	 *    create a new range for the other side.
+	 */
+	while ((range = range_tree_iter_first(&asma->unpinned,
+					      pgstart, pgend))) {
+		/* Case #1: Easy. Just nuke the whole thing. */
+		if (page_range_subsumes_range(range, pgstart, pgend)) {
+			ret |= range_del(range);
+			continue;
+		}
+
+		/* Case #2: We overlap from the start, so adjust it */
+		if (range->pgstart >= pgstart) {
+			ret |= range_shrink(range, pgend + 1, range->pgend);
+			continue;
+		}
+
+		/* Case #3: We overlap from the rear, so adjust it */
+		if (range->pgend <= pgend) {
+			ret |= range_shrink(range, range->pgstart,
+					    pgstart - 1);
+			continue;
+		}
 
 		/*
-		 * The user can ask us to pin pages that span multiple ranges,
-		 * or to pin pages that aren't even unpinned, so this is messy.
-		 *
-		 * Four cases:
-		 * 1. The requested range subsumes an existing range, so we
-		 *    just remove the entire matching range.
-		 * 2. The requested range overlaps the start of an existing
-		 *    range, so we just update that range.
-		 * 3. The requested range overlaps the end of an existing
-		 *    range, so we just update that range.
-		 * 4. The requested range punches a hole in an existing range,
-		 *    so we have to update one side of the range and then
-		 *    create a new range for the other side.
+		 * Case #4: We eat a chunk out of the middle. A bit
+		 * more complicated, we allocate a new range for the
+		 * second half and adjust the first chunk's endpoint.
 		 */
-		if (page_range_in_range(range, pgstart, pgend)) {
-			ret |= range->purged;
-
-			/* Case #1: Easy. Just nuke the whole thing. */
-			if (page_range_subsumes_range(range, pgstart, pgend)) {
-				range_del(range);
-				continue;
-			}
-
-			/* Case #2: We overlap from the start, so adjust it */
-			if (range->pgstart >= pgstart) {
-				range_shrink(range, pgend + 1, range->pgend);
-				continue;
-			}
-
-			/* Case #3: We overlap from the rear, so adjust it */
-			if (range->pgend <= pgend) {
-				range_shrink(range, range->pgstart,
-					     pgstart - 1);
-				continue;
-			}
-
-			/*
-			 * Case #4: We eat a chunk out of the middle. A bit
-			 * more complicated, we allocate a new range for the
-			 * second half and adjust the first chunk's endpoint.
-			 */
-			range_alloc(asma, range, range->purged,
-				    pgend + 1, range->pgend);
-			range_shrink(range, range->pgstart, pgstart - 1);
-			break;
-		}
+		end = range->pgend;
+		purged = range_shrink(range, range->pgstart, pgstart - 1);
+		range_alloc(asma, purged, pgend + 1, end);
+		ret |= purged;
+		break;
 	}
 
+	/* Do not hand back pages a purge is still punching out */
+	if (ret == ASHMEM_WAS_PURGED)
+		wait_event(ashmem_purge_wait,
+			   !atomic_read(&asma->purge_inflight));
+
 	return ret;
 }
 
 /*
  * ashmem_unpin - unpin the given range of pages. Returns zero on success.
  *
- * Caller must hold ashmem_mutex.
+ * Caller must hold asma->unpinned_lock.
  */
 static int ashmem_unpin(struct ashmem_area *asma, size_t pgstart, size_t pgend)
 {
-	struct ashmem_range *range, *next;
+	struct ashmem_range *range;
 	unsigned int purged = ASHMEM_NOT_PURGED;
 
-restart:
-	list_for_each_entry_safe(range, next, &asma->unpinned_list, unpinned) {
-		/* short circuit: this is our insertion point */
-		if (range_before_page(range, pgstart))
-			break;
-
-		/*
-		 * The user can ask us to unpin pages that are already entirely
-		 * or partially pinned. We handle those two cases here.
-		 */
+	/*
+	 * The user can ask us to unpin pages that are already entirely
+	 * or partially pinned. We handle those two cases here.
+	 */
+	while ((range = range_tree_iter_first(&asma->unpinned,
+					      pgstart, pgend))) {
 		if (page_range_subsumed_by_range(range, pgstart, pgend))
 			return 0;
-		if (page_range_in_range(range, pgstart, pgend)) {
-			pgstart = min(range->pgstart, pgstart);
-			pgend = max(range->pgend, pgend);
-			purged |= range->purged;
-			range_del(range);
-			goto restart;
-		}
+		pgstart = min(range->pgstart, pgstart);
+		pgend = max(range->pgend, pgend);
+		purged |= range_del(range);
 	}
 
-	return range_alloc(asma, range, purged, pgstart, pgend);
+	return range_alloc(asma, purged, pgstart, pgend);
 }
 
 /*
  * ashmem_get_pin_status - Returns ASHMEM_IS_UNPINNED if _any_ pages in the
  * given interval are unpinned and ASHMEM_IS_PINNED otherwise.
  *
- * Caller must hold ashmem_mutex.
+ * Caller must hold asma->unpinned_lock.
  */
 static int ashmem_get_pin_status(struct ashmem_area *asma, size_t pgstart,
 				 size_t pgend)
 {
-	struct ashmem_range *range;
-	int ret = ASHMEM_IS_PINNED;
-
-	list_for_each_entry(range, &asma->unpinned_list, unpinned) {
-		if (range_before_page(range, pgstart))
-			break;
-		if (page_range_in_range(range, pgstart, pgend)) {
-			ret = ASHMEM_IS_UNPINNED;
-			break;
-		}
-	}
+	if (range_tree_iter_first(&asma->unpinned, pgstart, pgend))
+		return ASHMEM_IS_UNPINNED;
 
-	return ret;
+	return ASHMEM_IS_PINNED;
 }
 
 static int ashmem_pin_unpin(struct ashmem_area *asma, unsigned long cmd,
@@ -747,10 +857,11 @@ static int ashmem_pin_unpin(struct ashmem_area *asma, unsigned long cmd,
 	if (unlikely(copy_from_user(&pin, p, sizeof(pin))))
 		return -EFAULT;
 
-	mutex_lock(&ashmem_mutex);
+	/* asma->size can no longer change once asma->file is set */
+	if (unlikely(!smp_load_acquire(&asma->file)))
+		return -EINVAL;
 
-	if (unlikely(!asma->file))
-		goto out_unlock;
+	mutex_lock(&asma->unpinned_lock);
 
 	/* per custom, you can pass zero for len to mean "everything onward" */
 	if (!pin.len)
@@ -781,7 +892,7 @@ static int ashmem_pin_unpin(struct ashmem_area *asma, unsigned long cmd,
 	}
 
 out_unlock:
-	mutex_unlock(&ashmem_mutex);
+	mutex_unlock(&asma->unpinned_lock);
 
 	return ret;
 }
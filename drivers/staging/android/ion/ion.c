@@ -135,6 +135,45 @@ bool ion_buffer_cached(struct ion_buffer *buffer)
 	return !!(buffer->flags & ION_FLAG_CACHED);
 }
 
+/*
+ * ion_buffer_cache_state - cache maintenance still owed for a buffer
+ *
+ * Uncached buffers and buffers with a live kernel or userspace mapping can
+ * be written by the CPU at any time, so report them as fully dirty. Must
+ * be called with buffer->lock held.
+ */
+unsigned int ion_buffer_cache_state(struct ion_buffer *buffer)
+{
+	if (!ion_buffer_cached(buffer) ||
+	    (buffer->private_flags & ION_PRIV_FLAG_CPU_UNTRACKED) ||
+	    buffer->kmap_cnt || !list_empty(&buffer->vmas))
+		return ION_BUFFER_CPU_DIRTY | ION_BUFFER_DEVICE_OWNED;
+	return buffer->cache_state;
+}
+
+/*
+ * ion_buffer_cache_done - record that cache maintenance covering @state was
+ * (or is about to be) performed. Must be called with buffer->lock held.
+ */
+void ion_buffer_cache_done(struct ion_buffer *buffer, unsigned int state)
+{
+	buffer->cache_state &= ~state;
+}
+
+static void ion_buffer_cpu_access(struct ion_buffer *buffer,
+				  enum dma_data_direction dir)
+{
+	if (dir != DMA_FROM_DEVICE)
+		buffer->cache_state |= ION_BUFFER_CPU_DIRTY;
+}
+
+static void ion_buffer_device_access(struct ion_buffer *buffer,
+				     enum dma_data_direction dir)
+{
+	if (dir != DMA_TO_DEVICE)
+		buffer->cache_state |= ION_BUFFER_DEVICE_OWNED;
+}
+
 static inline struct page *ion_buffer_page(struct page *page)
 {
 	return (struct page *)((unsigned long)page & ~(1UL));
@@ -248,6 +287,11 @@ static struct ion_buffer *ion_buffer_create(struct ion_heap *heap,
 	}
 
 	mutex_init(&buffer->lock);
+	/*
+	 * Nothing is known about what the heap left in the CPU caches, so the
+	 * first clean and invalidate requests are always honoured.
+	 */
+	buffer->cache_state = ION_BUFFER_CPU_DIRTY | ION_BUFFER_DEVICE_OWNED;
 	/*
 	 * this will set up dma addresses for the sglist -- it is not
 	 * technically correct as per the dma api -- a specific
@@ -807,6 +851,7 @@ static void ion_buffer_kmap_put(struct ion_buffer *buffer)
 	if (!buffer->kmap_cnt) {
 		buffer->heap->ops->unmap_kernel(buffer->heap, buffer);
 		buffer->vaddr = NULL;
+		ion_buffer_cpu_access(buffer, DMA_BIDIRECTIONAL);
 	}
 }
 
@@ -1187,6 +1232,9 @@ static struct sg_table *ion_map_dma_buf(struct dma_buf_attachment *attachment,
 		return NULL;
 
 	ion_buffer_sync_for_device(buffer, attachment->dev, direction);
+	mutex_lock(&buffer->lock);
+	ion_buffer_device_access(buffer, direction);
+	mutex_unlock(&buffer->lock);
 	return table;
 }
 
@@ -1259,6 +1307,7 @@ static int ion_vm_fault(struct vm_area_struct *vma, struct vm_fault *vmf)
 
 	mutex_lock(&buffer->lock);
 	ion_buffer_page_dirty(buffer->pages + vmf->pgoff);
+	ion_buffer_cpu_access(buffer, DMA_BIDIRECTIONAL);
 	BUG_ON(!buffer->pages || !buffer->pages[vmf->pgoff]);
 
 	pfn = page_to_pfn(ion_buffer_page(buffer->pages[vmf->pgoff]));
@@ -1297,6 +1346,7 @@ static void ion_vm_close(struct vm_area_struct *vma)
 		kfree(vma_list);
 		break;
 	}
+	ion_buffer_cpu_access(buffer, DMA_BIDIRECTIONAL);
 	mutex_unlock(&buffer->lock);
 
 	if (buffer->heap->ops->unmap_user)
@@ -1336,6 +1386,8 @@ static int ion_mmap(struct dma_buf *dmabuf, struct vm_area_struct *vma)
 	mutex_lock(&buffer->lock);
 	/* now map it to userspace */
 	ret = buffer->heap->ops->map_user(buffer->heap, buffer, vma);
+	if (!ret && (buffer->flags & ION_FLAG_CACHED))
+		buffer->private_flags |= ION_PRIV_FLAG_CPU_UNTRACKED;
 	mutex_unlock(&buffer->lock);
 
 	if (ret)
@@ -1388,12 +1440,22 @@ static void ion_dma_buf_kunmap(struct dma_buf *dmabuf, unsigned long offset,
 static int ion_dma_buf_begin_cpu_access(struct dma_buf *dmabuf,
 					enum dma_data_direction direction)
 {
+	struct ion_buffer *buffer = dmabuf->priv;
+
+	mutex_lock(&buffer->lock);
+	ion_buffer_cpu_access(buffer, direction);
+	mutex_unlock(&buffer->lock);
 	return 0;
 }
 
 static int ion_dma_buf_end_cpu_access(struct dma_buf *dmabuf,
 				      enum dma_data_direction direction)
 {
+	struct ion_buffer *buffer = dmabuf->priv;
+
+	mutex_lock(&buffer->lock);
+	ion_buffer_cpu_access(buffer, direction);
+	mutex_unlock(&buffer->lock);
 	return 0;
 }
 
@@ -1568,6 +1630,7 @@ static int ion_sync_for_device(struct ion_client *client, int fd)
 {
 	struct dma_buf *dmabuf;
 	struct ion_buffer *buffer;
+	unsigned int state;
 
 	dmabuf = dma_buf_get(fd);
 	if (IS_ERR(dmabuf))
@@ -1587,8 +1650,16 @@ static int ion_sync_for_device(struct ion_client *client, int fd)
 		dma_buf_put(dmabuf);
 		return -EINVAL;
 	}
-	dma_sync_sg_for_device(NULL, buffer->sg_table->sgl,
-			       buffer->sg_table->nents, DMA_BIDIRECTIONAL);
+
+	mutex_lock(&buffer->lock);
+	state = ion_buffer_cache_state(buffer);
+	ion_buffer_cache_done(buffer, ION_BUFFER_CPU_DIRTY);
+	mutex_unlock(&buffer->lock);
+
+	if (state & ION_BUFFER_CPU_DIRTY)
+		dma_sync_sg_for_device(NULL, buffer->sg_table->sgl,
+				       buffer->sg_table->nents,
+				       DMA_BIDIRECTIONAL);
 	dma_buf_put(dmabuf);
 	return 0;
 }
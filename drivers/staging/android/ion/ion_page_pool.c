@@ -21,6 +21,7 @@
 #include <linux/fs.h>
 #include <linux/list.h>
 #include <linux/init.h>
+#include <linux/percpu.h>
 #include <linux/slab.h>
 #include <linux/swap.h>
 #include <linux/vmalloc.h>
@@ -55,9 +56,18 @@ static void ion_page_pool_free_pages(struct ion_page_pool *pool,
 	__free_pages(page, pool->order);
 }
 
-static int ion_page_pool_add(struct ion_page_pool *pool, struct page *page)
+static void ion_page_pool_account(struct ion_page_pool *pool,
+				  struct page *page, bool add)
+{
+	long bytes = 1 << (PAGE_SHIFT + pool->order);
+
+	mod_node_page_state(page_pgdat(page), NR_INDIRECTLY_RECLAIMABLE_BYTES,
+			    add ? bytes : -bytes);
+}
+
+static void ion_page_pool_list_add(struct ion_page_pool *pool,
+				   struct page *page)
 {
-	mutex_lock(&pool->mutex);
 	if (PageHighMem(page)) {
 		list_add_tail(&page->lru, &pool->high_items);
 		pool->high_count++;
@@ -65,11 +75,6 @@ static int ion_page_pool_add(struct ion_page_pool *pool, struct page *page)
 		list_add_tail(&page->lru, &pool->low_items);
 		pool->low_count++;
 	}
-
-	mod_node_page_state(page_pgdat(page), NR_INDIRECTLY_RECLAIMABLE_BYTES,
-			    (1 << (PAGE_SHIFT + pool->order)));
-	mutex_unlock(&pool->mutex);
-	return 0;
 }
 
 static struct page *ion_page_pool_remove(struct ion_page_pool *pool, bool high)
@@ -87,11 +92,162 @@ static struct page *ion_page_pool_remove(struct ion_page_pool *pool, bool high)
 	}
 
 	list_del(&page->lru);
-	mod_node_page_state(page_pgdat(page), NR_INDIRECTLY_RECLAIMABLE_BYTES,
-			    -(1 << (PAGE_SHIFT + pool->order)));
 	return page;
 }
 
+static void ion_page_pool_pcp_push(struct ion_page_pool_pcp *pcp,
+				   struct page *page)
+{
+	pcp->pages[pcp->count++] = page;
+	if (PageHighMem(page))
+		pcp->high_count++;
+}
+
+static struct page *ion_page_pool_pcp_pop(struct ion_page_pool_pcp *pcp)
+{
+	struct page *page = pcp->pages[--pcp->count];
+
+	if (PageHighMem(page))
+		pcp->high_count--;
+	return page;
+}
+
+/*
+ * The per-cpu caches are only ever touched by their own cpu, except when
+ * they are drained, so their locks are practically never contended and
+ * the common alloc and free paths stay off pool->mutex.
+ */
+static struct page *ion_page_pool_pcp_alloc(struct ion_page_pool *pool)
+{
+	struct ion_page_pool_pcp *pcp;
+	struct page *batch[ION_POOL_PCP_MAX];
+	struct page *page = NULL;
+	int nr = 0, i;
+
+	if (!pool->pcp_limit)
+		goto from_pool;
+
+	pcp = raw_cpu_ptr(pool->pcp);
+	spin_lock(&pcp->lock);
+	if (pcp->count)
+		page = ion_page_pool_pcp_pop(pcp);
+	spin_unlock(&pcp->lock);
+	if (page)
+		return page;
+
+from_pool:
+	/* refill the cache with a batch of pages under one lock round trip */
+	if (!mutex_trylock(&pool->mutex))
+		return NULL;
+	while (nr <= pool->pcp_batch && (pool->high_count || pool->low_count))
+		batch[nr++] = ion_page_pool_remove(pool, pool->high_count > 0);
+	mutex_unlock(&pool->mutex);
+	if (!nr)
+		return NULL;
+
+	page = batch[--nr];
+	if (!nr)
+		return page;
+
+	pcp = raw_cpu_ptr(pool->pcp);
+	spin_lock(&pcp->lock);
+	for (i = 0; i < nr && pcp->count < pool->pcp_limit; i++)
+		ion_page_pool_pcp_push(pcp, batch[i]);
+	spin_unlock(&pcp->lock);
+
+	if (i < nr) {
+		mutex_lock(&pool->mutex);
+		for (; i < nr; i++)
+			ion_page_pool_list_add(pool, batch[i]);
+		mutex_unlock(&pool->mutex);
+	}
+	return page;
+}
+
+static int ion_page_pool_add(struct ion_page_pool *pool, struct page *page)
+{
+	struct ion_page_pool_pcp *pcp;
+	struct page *batch[ION_POOL_PCP_MAX];
+	int nr = 0, i;
+
+	ion_page_pool_account(pool, page, true);
+
+	if (pool->pcp_limit) {
+		pcp = raw_cpu_ptr(pool->pcp);
+		spin_lock(&pcp->lock);
+		if (pcp->count < pool->pcp_limit) {
+			ion_page_pool_pcp_push(pcp, page);
+			spin_unlock(&pcp->lock);
+			return 0;
+		}
+		/* cache is full, spill a batch to the pool along with page */
+		while (nr < pool->pcp_batch)
+			batch[nr++] = ion_page_pool_pcp_pop(pcp);
+		spin_unlock(&pcp->lock);
+	}
+
+	mutex_lock(&pool->mutex);
+	for (i = 0; i < nr; i++)
+		ion_page_pool_list_add(pool, batch[i]);
+	ion_page_pool_list_add(pool, page);
+	mutex_unlock(&pool->mutex);
+	return 0;
+}
+
+/**
+ * ion_page_pool_drain_pcp - move all pages in the per-cpu caches to the pool
+ * @pool:		the pool
+ */
+void ion_page_pool_drain_pcp(struct ion_page_pool *pool)
+{
+	struct ion_page_pool_pcp *pcp;
+	struct page *batch[ION_POOL_PCP_MAX];
+	int cpu, nr, i;
+
+	if (!pool->pcp_limit)
+		return;
+
+	for_each_possible_cpu(cpu) {
+		pcp = per_cpu_ptr(pool->pcp, cpu);
+		nr = 0;
+		spin_lock(&pcp->lock);
+		while (pcp->count)
+			batch[nr++] = ion_page_pool_pcp_pop(pcp);
+		spin_unlock(&pcp->lock);
+		if (!nr)
+			continue;
+
+		mutex_lock(&pool->mutex);
+		for (i = 0; i < nr; i++)
+			ion_page_pool_list_add(pool, batch[i]);
+		mutex_unlock(&pool->mutex);
+	}
+}
+
+/**
+ * ion_page_pool_pcp_total - number of items held in the per-cpu caches
+ * @pool:		the pool
+ * @high:		include highmem items
+ *
+ * Since no lock is held, results are approximate.
+ */
+int ion_page_pool_pcp_total(struct ion_page_pool *pool, bool high)
+{
+	struct ion_page_pool_pcp *pcp;
+	int cpu, count = 0;
+
+	if (!pool->pcp_limit)
+		return 0;
+
+	for_each_possible_cpu(cpu) {
+		pcp = per_cpu_ptr(pool->pcp, cpu);
+		count += READ_ONCE(pcp->count);
+		if (!high)
+			count -= READ_ONCE(pcp->high_count);
+	}
+	return count;
+}
+
 void *ion_page_pool_alloc(struct ion_page_pool *pool, bool *from_pool)
 {
 	struct page *page = NULL;
@@ -100,14 +256,10 @@ void *ion_page_pool_alloc(struct ion_page_pool *pool, bool *from_pool)
 
 	*from_pool = true;
 
-	if (mutex_trylock(&pool->mutex)) {
-		if (pool->high_count)
-			page = ion_page_pool_remove(pool, true);
-		else if (pool->low_count)
-			page = ion_page_pool_remove(pool, false);
-		mutex_unlock(&pool->mutex);
-	}
-	if (!page) {
+	page = ion_page_pool_pcp_alloc(pool);
+	if (page) {
+		ion_page_pool_account(pool, page, false);
+	} else {
 		page = ion_page_pool_alloc_pages(pool);
 		*from_pool = false;
 	}
@@ -124,13 +276,9 @@ void *ion_page_pool_alloc_pool_only(struct ion_page_pool *pool)
 	if (!pool)
 		return NULL;
 
-	if (mutex_trylock(&pool->mutex)) {
-		if (pool->high_count)
-			page = ion_page_pool_remove(pool, true);
-		else if (pool->low_count)
-			page = ion_page_pool_remove(pool, false);
-		mutex_unlock(&pool->mutex);
-	}
+	page = ion_page_pool_pcp_alloc(pool);
+	if (page)
+		ion_page_pool_account(pool, page, false);
 
 	return page;
 }
@@ -156,6 +304,8 @@ int ion_page_pool_total(struct ion_page_pool *pool, bool high)
 	if (high)
 		count += pool->high_count;
 
+	count += ion_page_pool_pcp_total(pool, high);
+
 	return count << pool->order;
 }
 
@@ -173,6 +323,8 @@ int ion_page_pool_shrink(struct ion_page_pool *pool, gfp_t gfp_mask,
 	if (nr_to_scan == 0)
 		return ion_page_pool_total(pool, high);
 
+	ion_page_pool_drain_pcp(pool);
+
 	while (freed < nr_to_scan) {
 		struct page *page;
 
@@ -186,6 +338,7 @@ int ion_page_pool_shrink(struct ion_page_pool *pool, gfp_t gfp_mask,
 			break;
 		}
 		mutex_unlock(&pool->mutex);
+		ion_page_pool_account(pool, page, false);
 		ion_page_pool_free_pages(pool, page);
 		freed += (1 << pool->order);
 	}
@@ -197,9 +350,31 @@ struct ion_page_pool *ion_page_pool_create(struct device *dev, gfp_t gfp_mask,
 					   unsigned int order)
 {
 	struct ion_page_pool *pool = kmalloc(sizeof(*pool), GFP_KERNEL);
+	int cpu;
 
 	if (!pool)
 		return NULL;
+
+	/* size the per-cpu caches in bytes so high orders do not hog memory */
+	pool->pcp_limit = min_t(int, ION_POOL_PCP_BYTES >> (PAGE_SHIFT + order),
+				ION_POOL_PCP_MAX);
+	pool->pcp_batch = pool->pcp_limit / 2;
+	pool->pcp = NULL;
+	if (pool->pcp_limit) {
+		pool->pcp = alloc_percpu(struct ion_page_pool_pcp);
+		if (!pool->pcp) {
+			kfree(pool);
+			return NULL;
+		}
+		for_each_possible_cpu(cpu) {
+			struct ion_page_pool_pcp *pcp = per_cpu_ptr(pool->pcp,
+								    cpu);
+
+			spin_lock_init(&pcp->lock);
+			pcp->count = 0;
+			pcp->high_count = 0;
+		}
+	}
 	pool->dev = dev;
 	pool->high_count = 0;
 	pool->low_count = 0;
@@ -215,6 +390,8 @@ struct ion_page_pool *ion_page_pool_create(struct device *dev, gfp_t gfp_mask,
 
 void ion_page_pool_destroy(struct ion_page_pool *pool)
 {
+	ion_page_pool_drain_pcp(pool);
+	free_percpu(pool->pcp);
 	kfree(pool);
 }
 
@@ -29,6 +29,8 @@
 #include "msm_ion_priv.h"
 #include <linux/sched.h>
 #include <linux/shrinker.h>
+#include <linux/sizes.h>
+#include <linux/spinlock.h>
 #include <linux/types.h>
 #ifdef CONFIG_ION_POOL_CACHE_POLICY
 #include <asm/cacheflush.h>
@@ -85,6 +87,9 @@ struct mem_map_data {
  *			handle, used for debugging
  * @pid:		pid of last client to reference this buffer in a
  *			handle, used for debugging
+ * @cache_state:	ION_BUFFER_CPU_DIRTY / ION_BUFFER_DEVICE_OWNED bits
+ *			describing which cache maintenance is still owed,
+ *			protected by @lock
 */
 struct ion_buffer {
 	struct kref ref;
@@ -111,6 +116,7 @@ struct ion_buffer {
 	int handle_count;
 	char task_comm[TASK_COMM_LEN];
 	pid_t pid;
+	unsigned int cache_state;
 };
 void ion_buffer_destroy(struct ion_buffer *buffer);
 
@@ -174,6 +180,24 @@ struct ion_heap_ops {
  */
 #define ION_PRIV_FLAG_SHRINKER_FREE (1 << 0)
 
+/*
+ * Buffer has been mapped cached into userspace without going through the
+ * fault handler, so CPU writes to it can no longer be observed and every
+ * cache maintenance request has to be honoured.
+ */
+#define ION_PRIV_FLAG_CPU_UNTRACKED (1 << 1)
+
+/*
+ * Cache maintenance state of a buffer. With neither bit set the CPU caches
+ * hold no dirty lines for the buffer and no device has written to it since
+ * the last invalidate, so clean and invalidate requests can be skipped.
+ */
+#define ION_BUFFER_CPU_DIRTY	(1 << 0)
+#define ION_BUFFER_DEVICE_OWNED	(1 << 1)
+
+unsigned int ion_buffer_cache_state(struct ion_buffer *buffer);
+void ion_buffer_cache_done(struct ion_buffer *buffer, unsigned int state);
+
 /**
  * struct ion_heap - represents a heap in the system
  * @node:		rb node to put the heap on the device's tree of heaps
@@ -448,6 +472,23 @@ void ion_carveout_free(struct ion_heap *heap, ion_phys_addr_t addr,
  * many systems
  */
 
+#define ION_POOL_PCP_MAX	32
+#define ION_POOL_PCP_BYTES	SZ_256K
+
+/**
+ * struct ion_page_pool_pcp - per-cpu cache in front of a page pool
+ * @lock:		protects this cache, only contended while draining
+ * @count:		number of items in @pages
+ * @high_count:		number of highmem items in @pages
+ * @pages:		cached items, used as a stack
+ */
+struct ion_page_pool_pcp {
+	spinlock_t lock;
+	int count;
+	int high_count;
+	struct page *pages[ION_POOL_PCP_MAX];
+};
+
 /**
  * struct ion_page_pool - pagepool struct
  * @high_count:		number of highmem items in the pool
@@ -459,6 +500,10 @@ void ion_carveout_free(struct ion_heap *heap, ion_phys_addr_t addr,
  * @gfp_mask:		gfp_mask to use from alloc
  * @order:		order of pages in the pool
  * @list:		plist node for list of pools
+ * @pcp:		per-cpu caches refilled from and spilled to the lists
+ *			in batches of @pcp_batch items
+ * @pcp_limit:		capacity of each per-cpu cache, 0 if disabled
+ * @pcp_batch:		number of items moved between a cache and the lists
  *
  * Allows you to keep a pool of pre allocated pages to use from your heap.
  * Keeping a pool of pages that is ready for dma, ie any cached mapping have
@@ -475,6 +520,9 @@ struct ion_page_pool {
 	gfp_t gfp_mask;
 	unsigned int order;
 	struct plist_node list;
+	struct ion_page_pool_pcp __percpu *pcp;
+	int pcp_limit;
+	int pcp_batch;
 };
 
 struct ion_page_pool *ion_page_pool_create(struct device *dev, gfp_t gfp_mask,
@@ -485,6 +533,8 @@ void *ion_page_pool_alloc_pool_only(struct ion_page_pool *a);
 void ion_page_pool_free(struct ion_page_pool *a, struct page *b);
 void ion_page_pool_free_immediate(struct ion_page_pool *, struct page *);
 int ion_page_pool_total(struct ion_page_pool *pool, bool high);
+int ion_page_pool_pcp_total(struct ion_page_pool *pool, bool high);
+void ion_page_pool_drain_pcp(struct ion_page_pool *pool);
 size_t ion_system_heap_secure_page_pool_total(struct ion_heap *heap, int vmid);
 
 #ifdef CONFIG_ION_POOL_CACHE_POLICY
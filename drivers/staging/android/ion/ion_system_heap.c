@@ -18,8 +18,11 @@
 #include <asm/page.h>
 #include <linux/dma-mapping.h>
 #include <linux/err.h>
+#include <linux/freezer.h>
 #include <linux/highmem.h>
+#include <linux/kthread.h>
 #include <linux/mm.h>
+#include <linux/moduleparam.h>
 #include <linux/msm_ion.h>
 #include <linux/scatterlist.h>
 #include <linux/seq_file.h>
@@ -45,7 +48,21 @@ static const unsigned int orders[] = {9, 4, 0};
 static const unsigned int orders[] = {0};
 #endif
 
-static const int num_orders = ARRAY_SIZE(orders);
+#define NUM_ORDERS ARRAY_SIZE(orders)
+static const int num_orders = NUM_ORDERS;
+
+/*
+ * Background pool refill: while no allocation has been made for
+ * refill_idle_ms, a SCHED_IDLE thread tops the cached and uncached pool of
+ * each order up to refill_target_kb[order index], zeroing and cleaning the
+ * pages before they are added so the pools only ever hold zeroed pages.
+ * Unzeroed pages from the buddy allocator never enter the pools. A target
+ * of 0 disables refill for that order.
+ */
+static unsigned int refill_target_kb[NUM_ORDERS];
+module_param_array(refill_target_kb, uint, NULL, 0644);
+static unsigned int refill_idle_ms = 200;
+module_param(refill_idle_ms, uint, 0644);
 static int order_to_index(unsigned int order)
 {
 	int i;
@@ -68,6 +85,13 @@ struct ion_system_heap {
 	struct ion_page_pool **secure_pools[VMID_LAST];
 	/* Prevents unnecessary page splitting */
 	struct mutex split_page_mutex;
+	struct task_struct *refill_task;
+	wait_queue_head_t refill_wait;
+	unsigned long last_alloc;
+	atomic_long_t pool_hits[NUM_ORDERS];
+	atomic_long_t pool_misses[NUM_ORDERS];
+	atomic_long_t refilled[NUM_ORDERS];
+	unsigned long refill_rate;
 };
 
 struct page_info {
@@ -127,6 +151,18 @@ static struct page *alloc_buffer_page(struct ion_system_heap *heap,
 			pool = heap->cached_pools[order_to_index(order)];
 
 		page = ion_page_pool_alloc(pool, from_pool);
+		if (page && *from_pool)
+			trace_ion_page_pool_hit(order, vmid, cached);
+		else
+			trace_ion_page_pool_miss(order, vmid, cached);
+		if (vmid <= 0 && page) {
+			if (*from_pool)
+				atomic_long_inc(
+				    &heap->pool_hits[order_to_index(order)]);
+			else
+				atomic_long_inc(
+				    &heap->pool_misses[order_to_index(order)]);
+		}
 	} else {
 		gfp_t gfp_mask = low_order_gfp_flags;
 
@@ -180,12 +216,18 @@ static struct page *alloc_from_secure_pool_order(struct ion_system_heap *heap,
 {
 	int vmid = get_secure_vmid(buffer->flags);
 	struct ion_page_pool *pool;
+	struct page *page;
 
 	if (!is_secure_vmid_valid(vmid))
 		return NULL;
 
 	pool = heap->secure_pools[vmid][order_to_index(order)];
-	return ion_page_pool_alloc_pool_only(pool);
+	page = ion_page_pool_alloc_pool_only(pool);
+	if (page)
+		trace_ion_page_pool_hit(order, vmid, ion_buffer_cached(buffer));
+	else
+		trace_ion_page_pool_miss(order, vmid, ion_buffer_cached(buffer));
+	return page;
 }
 
 static struct page *split_page_from_secure_pool(struct ion_system_heap *heap,
@@ -214,6 +256,8 @@ static struct page *split_page_from_secure_pool(struct ion_system_heap *heap,
 			continue;
 
 		split_page(page, order);
+		trace_ion_secure_pool_split(get_secure_vmid(buffer->flags),
+					    order);
 		break;
 	}
 	/*
@@ -341,6 +385,96 @@ static unsigned int process_info(struct page_info *info,
 	return i;
 }
 
+static void ion_system_heap_refill_kick(struct ion_system_heap *sys_heap)
+{
+	WRITE_ONCE(sys_heap->last_alloc, jiffies);
+	if (sys_heap->refill_task)
+		wake_up(&sys_heap->refill_wait);
+}
+
+static bool ion_system_heap_idle(struct ion_system_heap *sys_heap)
+{
+	return time_after_eq(jiffies, READ_ONCE(sys_heap->last_alloc) +
+			     msecs_to_jiffies(refill_idle_ms));
+}
+
+/*
+ * Refill must never push the system into reclaim on behalf of a pool, so
+ * stop as soon as the available memory drops below an eighth of RAM.
+ */
+static bool ion_system_heap_refill_allowed(struct ion_system_heap *sys_heap)
+{
+	return !kthread_should_stop() && ion_system_heap_idle(sys_heap) &&
+		si_mem_available() > (long)(totalram_pages >> 3);
+}
+
+static int ion_system_heap_refill_pool(struct ion_system_heap *sys_heap,
+				       struct ion_page_pool *pool,
+				       unsigned long target)
+{
+	struct device *dev = sys_heap->heap.priv;
+	gfp_t gfp = (pool->gfp_mask | __GFP_NOWARN | __GFP_NORETRY) &
+		~__GFP_DIRECT_RECLAIM;
+	struct page *page;
+	int refilled = 0;
+
+	while (((unsigned long)ion_page_pool_total(pool, true) << PAGE_SHIFT) <
+	       target) {
+		if (!ion_system_heap_refill_allowed(sys_heap))
+			break;
+		page = alloc_pages(gfp, pool->order);
+		if (!page)
+			break;
+		if (msm_ion_heap_high_order_page_zero(dev, page, pool->order)) {
+			__free_pages(page, pool->order);
+			break;
+		}
+		ion_page_pool_free(pool, page);
+		refilled++;
+	}
+	return refilled;
+}
+
+static int ion_system_heap_refill_thread(void *data)
+{
+	struct ion_system_heap *sys_heap = data;
+	unsigned long start, pages;
+	int i, nr;
+
+	while (!kthread_should_stop()) {
+		wait_event_freezable_timeout(sys_heap->refill_wait,
+					     kthread_should_stop() ||
+					     ion_system_heap_idle(sys_heap),
+					     msecs_to_jiffies(refill_idle_ms));
+		if (!ion_system_heap_refill_allowed(sys_heap))
+			continue;
+
+		start = jiffies;
+		pages = 0;
+		for (i = 0; i < num_orders; i++) {
+			unsigned long target = refill_target_kb[i] * SZ_1K;
+
+			if (!target)
+				continue;
+			nr = ion_system_heap_refill_pool(sys_heap,
+					sys_heap->uncached_pools[i], target);
+			nr += ion_system_heap_refill_pool(sys_heap,
+					sys_heap->cached_pools[i], target);
+			atomic_long_add(nr, &sys_heap->refilled[i]);
+			pages += nr << orders[i];
+		}
+		if (pages)
+			WRITE_ONCE(sys_heap->refill_rate, pages * HZ /
+				   max_t(unsigned long, jiffies - start, 1));
+
+		/* sleep until the next allocation drains the pools again */
+		wait_event_freezable(sys_heap->refill_wait,
+				     kthread_should_stop() ||
+				     !ion_system_heap_idle(sys_heap));
+	}
+	return 0;
+}
+
 static int ion_system_heap_allocate(struct ion_heap *heap,
 				     struct ion_buffer *buffer,
 				     unsigned long size, unsigned long align,
@@ -379,6 +513,7 @@ static int ion_system_heap_allocate(struct ion_heap *heap,
 	if (size / PAGE_SIZE > totalram_pages / 2)
 		return -ENOMEM;
 
+	trace_ion_system_heap_allocate_start(heap->name, size, flags, 0);
 	data.size = 0;
 	INIT_LIST_HEAD(&pages);
 	INIT_LIST_HEAD(&pages_from_pool);
@@ -481,6 +616,9 @@ static int ion_system_heap_allocate(struct ion_heap *heap,
 	if (nents_sync)
 		sg_free_table(&table_sync);
 	msm_ion_heap_free_pages_mem(&data);
+	if (vmid <= 0)
+		ion_system_heap_refill_kick(sys_heap);
+	trace_ion_system_heap_allocate_end(heap->name, size, flags, 0);
 	return 0;
 
 err_free_sg2:
@@ -510,6 +648,7 @@ static int ion_system_heap_allocate(struct ion_heap *heap,
 		free_buffer_page(sys_heap, buffer, info->page, info->order);
 		kfree(info);
 	}
+	trace_ion_system_heap_allocate_end(heap->name, size, flags, -ENOMEM);
 	return -ENOMEM;
 }
 
@@ -568,6 +707,8 @@ static int ion_secure_page_pool_shrink(
 	if (nr_to_scan == 0)
 		return ion_page_pool_total(pool, true);
 
+	ion_page_pool_drain_pcp(pool);
+
 	while (freed < nr_to_scan) {
 		page = ion_page_pool_alloc_pool_only(pool);
 		if (!page)
@@ -668,6 +809,21 @@ static struct ion_heap_ops system_heap_ops = {
 	.shrink = ion_system_heap_shrink,
 };
 
+/* Returns the bytes held in the per-cpu caches of @pool */
+static unsigned long ion_system_heap_pcp_show(struct seq_file *s,
+					      struct ion_page_pool *pool,
+					      const char *name)
+{
+	int count = ion_page_pool_pcp_total(pool, true);
+	unsigned long total = (1 << pool->order) * PAGE_SIZE * count;
+
+	if (s && pool->pcp_limit)
+		seq_printf(s,
+			   "%d order %u pages in %s per-cpu caches = %lu total\n",
+			   count, pool->order, name, total);
+	return total;
+}
+
 static int ion_system_heap_debug_show(struct ion_heap *heap, struct seq_file *s,
 				      void *unused)
 {
@@ -700,6 +856,8 @@ static int ion_system_heap_debug_show(struct ion_heap *heap, struct seq_file *s,
 			pool->high_count;
 		uncached_total += (1 << pool->order) * PAGE_SIZE *
 			pool->low_count;
+		uncached_total += ion_system_heap_pcp_show(s, pool,
+							   "uncached");
 	}
 
 	for (i = 0; i < num_orders; i++) {
@@ -721,6 +879,7 @@ static int ion_system_heap_debug_show(struct ion_heap *heap, struct seq_file *s,
 			pool->high_count;
 		cached_total += (1 << pool->order) * PAGE_SIZE *
 			pool->low_count;
+		cached_total += ion_system_heap_pcp_show(s, pool, "cached");
 	}
 
 	for (i = 0; i < num_orders; i++) {
@@ -746,11 +905,32 @@ static int ion_system_heap_debug_show(struct ion_heap *heap, struct seq_file *s,
 					 pool->high_count;
 			secure_total += (1 << pool->order) * PAGE_SIZE *
 					 pool->low_count;
+			secure_total += ion_system_heap_pcp_show(s, pool,
+								 "secure");
 		}
 	}
 
 	if (use_seq) {
 		seq_puts(s, "--------------------------------------------\n");
+		for (i = 0; i < num_orders; i++) {
+			unsigned long target = refill_target_kb[i] * SZ_1K;
+
+			seq_printf(s,
+				   "order %u: pool hits %ld misses %ld refilled %ld fill %lu/%lu uncached %lu/%lu cached\n",
+				   orders[i],
+				   atomic_long_read(&sys_heap->pool_hits[i]),
+				   atomic_long_read(&sys_heap->pool_misses[i]),
+				   atomic_long_read(&sys_heap->refilled[i]),
+				   (unsigned long)ion_page_pool_total(
+					sys_heap->uncached_pools[i], true) <<
+					PAGE_SHIFT, target,
+				   (unsigned long)ion_page_pool_total(
+					sys_heap->cached_pools[i], true) <<
+					PAGE_SHIFT, target);
+		}
+		seq_printf(s, "last refill rate = %lu pages/s\n",
+			   READ_ONCE(sys_heap->refill_rate));
+		seq_puts(s, "--------------------------------------------\n");
 		seq_printf(s, "uncached pool = %lu cached pool = %lu secure pool = %lu\n",
 			   uncached_total, cached_total, secure_total);
 		seq_printf(s, "pool total (uncached + cached + secure) = %lu\n",
@@ -847,6 +1027,20 @@ struct ion_heap *ion_system_heap_create(struct ion_platform_heap *data)
 
 	mutex_init(&heap->split_page_mutex);
 
+	init_waitqueue_head(&heap->refill_wait);
+	heap->last_alloc = jiffies;
+	heap->refill_task = kthread_run(ion_system_heap_refill_thread, heap,
+					"ion_sys_refill");
+	if (IS_ERR(heap->refill_task)) {
+		pr_err("%s: creating thread for pool refill failed\n",
+		       __func__);
+		heap->refill_task = NULL;
+	} else {
+		struct sched_param param = { .sched_priority = 0 };
+
+		sched_setscheduler(heap->refill_task, SCHED_IDLE, &param);
+	}
+
 	heap->heap.debug_show = ion_system_heap_debug_show;
 	return &heap->heap;
 
@@ -875,6 +1069,9 @@ void ion_system_heap_destroy(struct ion_heap *heap)
 							heap);
 	int i, j;
 
+	if (sys_heap->refill_task)
+		kthread_stop(sys_heap->refill_task);
+
 	for (i = 0; i < VMID_LAST; i++) {
 		if (!is_secure_vmid_valid(i))
 			continue;
@@ -18,20 +18,28 @@
 #include <linux/dma-buf.h>
 #include <linux/dma-direction.h>
 #include <linux/fs.h>
+#include <linux/ktime.h>
 #include <linux/miscdevice.h>
 #include <linux/mm.h>
 #include <linux/module.h>
 #include <linux/platform_device.h>
+#include <linux/random.h>
 #include <linux/sched.h>
 #include <linux/slab.h>
+#include <linux/sort.h>
 #include <linux/uaccess.h>
 #include <linux/vmalloc.h>
+#include <linux/workqueue.h>
 
 #include "ion.h"
+#include "msm/msm_ion.h"
 #include "../uapi/ion_test.h"
 
 #define u64_to_uptr(x) ((void __user *)(unsigned long)(x))
 
+#define ION_TEST_BENCH_MAX_THREADS	32
+#define ION_TEST_BENCH_MAX_OPS		(1 << 18)
+
 struct ion_test_device {
 	struct miscdevice misc;
 };
@@ -144,6 +152,150 @@ static int ion_handle_test_kernel(struct dma_buf *dma_buf, void __user *ptr,
 	return ret;
 }
 
+struct ion_test_bench_worker {
+	struct work_struct work;
+	struct ion_test_bench_data *args;
+	u64 *alloc_ns;
+	u64 *free_ns;
+	u32 done;
+	u32 failures;
+	u64 bytes;
+};
+
+static size_t ion_test_bench_size(struct ion_test_bench_data *args)
+{
+	unsigned long pages;
+
+	if (args->size_max <= args->size)
+		return args->size;
+
+	pages = (args->size_max - args->size) >> PAGE_SHIFT;
+	return args->size + ((size_t)prandom_u32_max(pages + 1) << PAGE_SHIFT);
+}
+
+static void ion_test_bench_work(struct work_struct *work)
+{
+	struct ion_test_bench_worker *worker =
+		container_of(work, struct ion_test_bench_worker, work);
+	struct ion_test_bench_data *args = worker->args;
+	struct ion_client *client;
+	struct ion_handle *handle;
+	u32 i;
+
+	client = msm_ion_client_create("ion-test-bench");
+	if (IS_ERR_OR_NULL(client)) {
+		worker->failures = args->iterations;
+		return;
+	}
+
+	for (i = 0; i < args->iterations; i++) {
+		size_t len = ion_test_bench_size(args);
+		u64 start = ktime_get_ns();
+
+		handle = ion_alloc(client, len, 0, args->heap_id_mask,
+				   args->flags);
+		if (IS_ERR_OR_NULL(handle)) {
+			worker->failures++;
+			continue;
+		}
+		worker->alloc_ns[worker->done] = ktime_get_ns() - start;
+
+		start = ktime_get_ns();
+		ion_free(client, handle);
+		worker->free_ns[worker->done] = ktime_get_ns() - start;
+		worker->bytes += len;
+		worker->done++;
+		cond_resched();
+	}
+
+	ion_client_destroy(client);
+}
+
+static int ion_test_cmp_u64(const void *a, const void *b)
+{
+	u64 x = *(const u64 *)a, y = *(const u64 *)b;
+
+	return x < y ? -1 : x > y;
+}
+
+/* Sorts @ns in place and fills in p50, p99, p999 and max */
+static void ion_test_bench_percentiles(u64 *ns, u32 n, __u64 *out)
+{
+	static const unsigned int permille[] = { 500, 990, 999, 1000 };
+	int i;
+
+	if (!n)
+		return;
+
+	sort(ns, n, sizeof(*ns), ion_test_cmp_u64, NULL);
+	for (i = 0; i < ARRAY_SIZE(permille); i++)
+		out[i] = ns[div_u64((u64)(n - 1) * permille[i], 1000)];
+}
+
+static int ion_test_bench(struct ion_test_bench_data *args)
+{
+	struct ion_test_bench_worker *workers;
+	u64 *alloc_ns, *free_ns;
+	u64 start, bytes = 0;
+	u32 i, n = 0;
+
+	if (!args->size || !args->threads || !args->iterations ||
+	    args->threads > ION_TEST_BENCH_MAX_THREADS ||
+	    args->iterations > ION_TEST_BENCH_MAX_OPS / args->threads)
+		return -EINVAL;
+
+	args->size = PAGE_ALIGN(args->size);
+	args->size_max = PAGE_ALIGN(args->size_max);
+
+	workers = kcalloc(args->threads, sizeof(*workers), GFP_KERNEL);
+	alloc_ns = vmalloc(sizeof(u64) * args->threads * args->iterations);
+	free_ns = vmalloc(sizeof(u64) * args->threads * args->iterations);
+	if (!workers || !alloc_ns || !free_ns) {
+		kfree(workers);
+		vfree(alloc_ns);
+		vfree(free_ns);
+		return -ENOMEM;
+	}
+
+	start = ktime_get_ns();
+	for (i = 0; i < args->threads; i++) {
+		workers[i].args = args;
+		workers[i].alloc_ns = alloc_ns + i * args->iterations;
+		workers[i].free_ns = free_ns + i * args->iterations;
+		INIT_WORK(&workers[i].work, ion_test_bench_work);
+		queue_work(system_unbound_wq, &workers[i].work);
+	}
+	for (i = 0; i < args->threads; i++)
+		flush_work(&workers[i].work);
+	args->elapsed_ns = max_t(u64, ktime_get_ns() - start, 1);
+
+	/* pack the per-thread samples together before sorting */
+	args->failures = 0;
+	for (i = 0; i < args->threads; i++) {
+		memmove(alloc_ns + n, workers[i].alloc_ns,
+			workers[i].done * sizeof(u64));
+		memmove(free_ns + n, workers[i].free_ns,
+			workers[i].done * sizeof(u64));
+		n += workers[i].done;
+		bytes += workers[i].bytes;
+		args->failures += workers[i].failures;
+	}
+
+	memset(args->alloc_ns, 0, sizeof(args->alloc_ns));
+	memset(args->free_ns, 0, sizeof(args->free_ns));
+	ion_test_bench_percentiles(alloc_ns, n, args->alloc_ns);
+	ion_test_bench_percentiles(free_ns, n, args->free_ns);
+	args->allocs_per_sec = div64_u64((u64)n * NSEC_PER_SEC,
+					 args->elapsed_ns);
+	args->kb_per_sec = div64_u64((bytes >> 10) * NSEC_PER_SEC,
+				     args->elapsed_ns);
+
+	kfree(workers);
+	vfree(alloc_ns);
+	vfree(free_ns);
+	return 0;
+}
+
 static long ion_test_ioctl(struct file *filp, unsigned int cmd,
 			   unsigned long arg)
 {
@@ -152,6 +304,7 @@ static long ion_test_ioctl(struct file *filp, unsigned int cmd,
 
 	union {
 		struct ion_test_rw_data test_rw;
+		struct ion_test_bench_data bench;
 	} data;
 
 	if (_IOC_SIZE(cmd) > sizeof(data))
@@ -195,6 +348,11 @@ static long ion_test_ioctl(struct file *filp, unsigned int cmd,
 					     data.test_rw.write);
 		break;
 	}
+	case ION_IOC_TEST_BENCH:
+	{
+		ret = ion_test_bench(&data.bench);
+		break;
+	}
 	default:
 		return -ENOTTY;
 	}
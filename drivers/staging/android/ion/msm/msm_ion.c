@@ -339,6 +339,8 @@ static int ion_do_cache_op(struct ion_client *client, struct ion_handle *handle,
 {
 	int ret = -EINVAL;
 	unsigned long flags;
+	unsigned int owed;
+	bool full;
 	struct sg_table *table;
 	struct page *page;
 	struct ion_buffer *buffer;
@@ -365,6 +367,25 @@ static int ion_do_cache_op(struct ion_client *client, struct ion_handle *handle,
 	if (IS_ERR_OR_NULL(table))
 		return PTR_ERR(table);
 
+	mutex_lock(&buffer->lock);
+	/*
+	 * A clean is only owed when the CPU may have dirtied the buffer, an
+	 * invalidate only once a device may have written to it or the CPU
+	 * wants its own writes dropped. The state is cleared up front so that
+	 * CPU accesses racing with the operation are not forgotten; partial
+	 * operations leave the rest of the buffer as it was.
+	 */
+	owed = ion_buffer_cache_state(buffer);
+	if (cmd == ION_IOC_CLEAN_CACHES)
+		owed &= ION_BUFFER_CPU_DIRTY;
+	full = !offset && len >= buffer->size;
+	if (full)
+		ion_buffer_cache_done(buffer, owed);
+	mutex_unlock(&buffer->lock);
+
+	if (!owed)
+		return 0;
+
 	page = sg_page(table->sgl);
 
 	if (page)
@@ -374,6 +395,12 @@ static int ion_do_cache_op(struct ion_client *client, struct ion_handle *handle,
 		ret = ion_no_pages_cache_ops(client, handle, uaddr,
 					     offset, len, cmd);
 
+	if (ret && full) {
+		mutex_lock(&buffer->lock);
+		buffer->cache_state |= owed;
+		mutex_unlock(&buffer->lock);
+	}
+
 	return ret;
 }
 
@@ -49,6 +49,9 @@
 #include <linux/cpuset.h>
 #include <linux/vmpressure.h>
 #include <linux/freezer.h>
+#include <linux/ktime.h>
+#include <linux/rculist_nulls.h>
+#include <linux/workqueue.h>
 
 #define CREATE_TRACE_POINTS
 #include <trace/events/almk.h>
@@ -122,16 +125,41 @@ struct lmk_event {
 	short oom_score_adj;
 	short min_score_adj;
 	unsigned long long start_time;
+	u64 select_ns;		/* time spent choosing this victim */
+	long exit_ms;		/* kill to address space drained, -1 if not */
+	unsigned long rss_freed;	/* resident pages released */
+	unsigned long swap_freed;	/* swap (zram) slots released */
+	unsigned long free_after;	/* free pages once measured */
 	struct list_head list;
 };
 
-void handle_lmk_event(struct task_struct *selected, int selected_tasksize,
-		      short min_score_adj)
+/*
+ * A kill whose outcome is still being measured. The event is published
+ * once the victim's address space has drained or LMK_OUTCOME_TIMEOUT_MS
+ * has passed, whichever comes first.
+ */
+struct lmk_pending {
+	struct lmk_event event;
+	struct mm_struct *mm;		/* pinned with mm_count */
+	unsigned long rss;		/* rss at kill time */
+	unsigned long swap;		/* swap entries at kill time */
+	ktime_t kill_time;
+	bool busy;
+};
+
+#define LMK_OUTCOME_POLL	msecs_to_jiffies(20)
+#define LMK_OUTCOME_TIMEOUT_MS	2000
+
+static struct lmk_pending lmk_pending[MAX_BUFFERED_EVENTS];
+static DEFINE_SPINLOCK(lmk_pending_lock);
+static void lmk_outcome_fn(struct work_struct *work);
+static DECLARE_DELAYED_WORK(lmk_outcome_work, lmk_outcome_fn);
+
+static void lmk_event_publish(const struct lmk_event *ev)
 {
 	int head;
 	int tail;
 	struct lmk_event *events;
-	struct lmk_event *event;
 
 	spin_lock(&lmk_event_lock);
 
@@ -145,28 +173,120 @@ void handle_lmk_event(struct task_struct *selected, int selected_tasksize,
 	}
 
 	events = (struct lmk_event *) event_buffer.buf;
-	event = &events[head];
+	events[head] = *ev;
+
+	event_buffer.head = (head + 1) & (MAX_BUFFERED_EVENTS - 1);
+
+	spin_unlock(&lmk_event_lock);
+
+	wake_up_interruptible(&event_wait);
+}
+
+static void lmk_outcome_fn(struct work_struct *work)
+{
+	bool again = false;
+	int i;
 
-	strncpy(event->taskname, selected->comm, MAX_TASKNAME);
+	spin_lock(&lmk_pending_lock);
+	for (i = 0; i < MAX_BUFFERED_EVENTS; i++) {
+		struct lmk_pending *pending = &lmk_pending[i];
+		struct lmk_event *ev = &pending->event;
+		struct mm_struct *mm = pending->mm;
+		unsigned long rss, swap;
+		s64 elapsed_ms;
+		bool exited;
 
-	event->pid = selected->pid;
-	event->uid = from_kuid_munged(current_user_ns(), task_uid(selected));
+		if (!pending->busy)
+			continue;
+
+		rss = get_mm_rss(mm);
+		swap = get_mm_counter(mm, MM_SWAPENTS);
+		exited = !atomic_read(&mm->mm_users) && !rss && !swap;
+		elapsed_ms = ktime_ms_delta(ktime_get(), pending->kill_time);
+		if (!exited && elapsed_ms < LMK_OUTCOME_TIMEOUT_MS) {
+			again = true;
+			continue;
+		}
+
+		ev->exit_ms = exited ? elapsed_ms : -1;
+		ev->rss_freed = pending->rss > rss ? pending->rss - rss : 0;
+		ev->swap_freed = pending->swap > swap ? pending->swap - swap : 0;
+		ev->free_after = global_page_state(NR_FREE_PAGES);
+		lmk_event_publish(ev);
+
+		mmdrop(mm);
+		pending->busy = false;
+	}
+	spin_unlock(&lmk_pending_lock);
+
+	if (again)
+		schedule_delayed_work(&lmk_outcome_work, LMK_OUTCOME_POLL);
+}
+
+void handle_lmk_event(struct task_struct *selected, int selected_tasksize,
+		      short min_score_adj, u64 select_ns)
+{
+	struct lmk_event event = { };
+	struct lmk_pending *pending = NULL;
+	struct mm_struct *mm = NULL;
+	unsigned long rss = 0, swap = 0;
+	struct task_struct *p;
+	int i;
+
+	strncpy(event.taskname, selected->comm, MAX_TASKNAME);
+
+	event.pid = selected->pid;
+	event.uid = from_kuid_munged(current_user_ns(), task_uid(selected));
 	if (selected->group_leader)
-		event->group_leader_pid = selected->group_leader->pid;
+		event.group_leader_pid = selected->group_leader->pid;
 	else
-		event->group_leader_pid = -1;
-	event->min_flt = selected->min_flt;
-	event->maj_flt = selected->maj_flt;
-	event->oom_score_adj = selected->signal->oom_score_adj;
-	event->start_time = nsec_to_clock_t(selected->real_start_time);
-	event->rss_in_pages = selected_tasksize;
-	event->min_score_adj = min_score_adj;
+		event.group_leader_pid = -1;
+	event.min_flt = selected->min_flt;
+	event.maj_flt = selected->maj_flt;
+	event.oom_score_adj = selected->signal->oom_score_adj;
+	event.start_time = nsec_to_clock_t(selected->real_start_time);
+	event.rss_in_pages = selected_tasksize;
+	event.min_score_adj = min_score_adj;
+	event.select_ns = select_ns;
+	event.exit_ms = -1;
+
+	/* Follow the address space, it outlives the task's own exit */
+	p = find_lock_task_mm(selected);
+	if (p) {
+		mm = p->mm;
+		atomic_inc(&mm->mm_count);
+		rss = get_mm_rss(mm);
+		swap = get_mm_counter(mm, MM_SWAPENTS);
+		task_unlock(p);
+	}
 
-	event_buffer.head = (head + 1) & (MAX_BUFFERED_EVENTS - 1);
+	spin_lock(&lmk_pending_lock);
+	for (i = 0; mm && i < MAX_BUFFERED_EVENTS; i++) {
+		if (!lmk_pending[i].busy) {
+			pending = &lmk_pending[i];
+			break;
+		}
+	}
+	if (pending) {
+		pending->event = event;
+		pending->mm = mm;
+		pending->rss = rss;
+		pending->swap = swap;
+		pending->kill_time = ktime_get();
+		pending->busy = true;
+	}
+	spin_unlock(&lmk_pending_lock);
 
-	spin_unlock(&lmk_event_lock);
+	if (pending) {
+		schedule_delayed_work(&lmk_outcome_work, LMK_OUTCOME_POLL);
+		return;
+	}
 
-	wake_up_interruptible(&event_wait);
+	/* Already gone, or too many kills in flight: report it as is */
+	event.free_after = global_page_state(NR_FREE_PAGES);
+	lmk_event_publish(&event);
+	if (mm)
+		mmdrop(mm);
 }
 
 static int lmk_event_show(struct seq_file *s, void *unused)
@@ -188,11 +308,14 @@ static int lmk_event_show(struct seq_file *s, void *unused)
 
 	event = &events[tail];
 
-	seq_printf(s, "%lu %lu %lu %lu %lu %lu %hd %hd %llu\n%s\n",
+	seq_printf(s,
+		"%lu %lu %lu %lu %lu %lu %hd %hd %llu %llu %ld %lu %lu %lu\n%s\n",
 		(unsigned long) event->pid, (unsigned long) event->uid,
 		(unsigned long) event->group_leader_pid, event->min_flt,
 		event->maj_flt, event->rss_in_pages, event->oom_score_adj,
-		event->min_score_adj, event->start_time, event->taskname);
+		event->min_score_adj, event->start_time, event->select_ns,
+		event->exit_ms, event->rss_freed, event->swap_freed,
+		event->free_after, event->taskname);
 
 	event_buffer.tail = (tail + 1) & (MAX_BUFFERED_EVENTS - 1);
 
@@ -616,12 +739,219 @@ static int get_free_ram(int *other_free, int *other_file,
 }
 #endif
 
-static unsigned long lowmem_scan(struct shrinker *s, struct shrink_control *sc)
+/*
+ * Consider @tsk as a victim of at least @min_score_adj, replacing *@selected
+ * if it has a higher oom_score_adj or the same one and a bigger rss. Returns
+ * true if a previous victim is still dying and the scan should back off.
+ * Called under rcu_read_lock().
+ */
+static bool lowmem_consider(struct task_struct *tsk, short min_score_adj,
+			    struct task_struct **selected,
+			    int *selected_tasksize,
+			    short *selected_oom_score_adj)
+{
+	struct task_struct *p;
+	short oom_score_adj;
+	int tasksize;
+
+	if (tsk->flags & PF_KTHREAD)
+		return false;
+
+	/* if task no longer has any memory ignore it */
+	if (test_task_flag(tsk, TIF_MM_RELEASED))
+		return false;
+
+	if (oom_reaper) {
+		p = find_lock_task_mm(tsk);
+		if (!p)
+			return false;
+
+		if (test_bit(MMF_OOM_VICTIM, &p->mm->flags)) {
+			if (test_bit(MMF_OOM_SKIP, &p->mm->flags)) {
+				task_unlock(p);
+				return false;
+			} else if (time_before_eq(jiffies,
+					lowmem_deathpending_timeout)) {
+				task_unlock(p);
+				return true;
+			}
+		}
+	} else {
+		if (time_before_eq(jiffies, lowmem_deathpending_timeout))
+			if (test_task_lmk_waiting(tsk))
+				return true;
+
+		p = find_lock_task_mm(tsk);
+		if (!p)
+			return false;
+	}
+
+	oom_score_adj = p->signal->oom_score_adj;
+	if (oom_score_adj < min_score_adj) {
+		task_unlock(p);
+		return false;
+	}
+	tasksize = get_mm_rss(p->mm);
+	task_unlock(p);
+	if (tasksize <= 0)
+		return false;
+	if (*selected) {
+		if (oom_score_adj < *selected_oom_score_adj)
+			return false;
+		if (oom_score_adj == *selected_oom_score_adj &&
+		    tasksize <= *selected_tasksize)
+			return false;
+	}
+	*selected = p;
+	*selected_tasksize = tasksize;
+	*selected_oom_score_adj = oom_score_adj;
+	lowmem_print(3, "select '%s' (%d), adj %hd, size %d, to kill\n",
+		     p->comm, p->pid, oom_score_adj, tasksize);
+	return false;
+}
+
+#ifdef CONFIG_ANDROID_LMK_ADJ_INDEX
+/*
+ * Processes bucketed by oom_score_adj, kept current from fork, exit and
+ * /proc/<pid>/oom_score_adj writes. Updates serialize on lmk_adj_lock while
+ * lowmem_scan() walks the buckets under RCU alone; every bucket ends in a
+ * nulls marker holding its index so that a walk dragged onto another bucket
+ * by a concurrent update notices and restarts.
+ */
+#define LMK_ADJ_BUCKETS	(OOM_SCORE_ADJ_MAX - OOM_SCORE_ADJ_MIN + 1)
+
+static struct hlist_nulls_head lmk_adj_buckets[LMK_ADJ_BUCKETS];
+static DEFINE_SPINLOCK(lmk_adj_lock);
+static bool lmk_adj_index_ready;
+
+static unsigned int lmk_adj_bucket(short adj)
+{
+	return clamp_t(short, adj, OOM_SCORE_ADJ_MIN, OOM_SCORE_ADJ_MAX) -
+		OOM_SCORE_ADJ_MIN;
+}
+
+static void __lowmem_adj_index_add(struct task_struct *p)
+{
+	hlist_nulls_add_head_rcu(&p->lmk_adj_node,
+		&lmk_adj_buckets[lmk_adj_bucket(p->signal->oom_score_adj)]);
+}
+
+/* Called with tasklist_lock held for writing when @p becomes a process */
+void lowmem_adj_index_add(struct task_struct *p)
+{
+	spin_lock(&lmk_adj_lock);
+	if (lmk_adj_index_ready && hlist_nulls_unhashed(&p->lmk_adj_node))
+		__lowmem_adj_index_add(p);
+	spin_unlock(&lmk_adj_lock);
+}
+
+/* Called with tasklist_lock held for writing when @p is unhashed */
+void lowmem_adj_index_unhash(struct task_struct *p)
+{
+	spin_lock(&lmk_adj_lock);
+	if (!hlist_nulls_unhashed(&p->lmk_adj_node)) {
+		hlist_nulls_del_init_rcu(&p->lmk_adj_node);
+		/*
+		 * An old leader released by exec's de_thread() hands its
+		 * place to the thread that took over the group.
+		 */
+		if (p->group_leader != p &&
+		    hlist_nulls_unhashed(&p->group_leader->lmk_adj_node))
+			__lowmem_adj_index_add(p->group_leader);
+	}
+	spin_unlock(&lmk_adj_lock);
+}
+
+/* Move @p's process to the bucket of its current oom_score_adj */
+void lowmem_adj_index_update(struct task_struct *p)
+{
+	struct task_struct *leader;
+
+	spin_lock(&lmk_adj_lock);
+	leader = p->group_leader;
+	if (!hlist_nulls_unhashed(&leader->lmk_adj_node)) {
+		hlist_nulls_del_init_rcu(&leader->lmk_adj_node);
+		__lowmem_adj_index_add(leader);
+	}
+	spin_unlock(&lmk_adj_lock);
+}
+
+static void lowmem_adj_index_init(void)
+{
+	struct task_struct *tsk;
+	int i;
+
+	for (i = 0; i < LMK_ADJ_BUCKETS; i++)
+		INIT_HLIST_NULLS_HEAD(&lmk_adj_buckets[i], i);
+
+	/* fork and exit wait on tasklist_lock until the index is complete */
+	read_lock(&tasklist_lock);
+	spin_lock(&lmk_adj_lock);
+	for_each_process(tsk)
+		__lowmem_adj_index_add(tsk);
+	lmk_adj_index_ready = true;
+	spin_unlock(&lmk_adj_lock);
+	read_unlock(&tasklist_lock);
+}
+
+/*
+ * Walk the buckets from OOM_SCORE_ADJ_MAX down to @min_score_adj. Lower
+ * buckets cannot beat a victim found in a higher one, so the walk stops
+ * there unless a previous victim may still be dying in one of them.
+ */
+static bool lowmem_select(short min_score_adj, struct task_struct **selected,
+			  int *selected_tasksize, short *selected_oom_score_adj)
+{
+	int adj;
+
+	for (adj = OOM_SCORE_ADJ_MAX;
+	     adj >= max_t(int, min_score_adj, OOM_SCORE_ADJ_MIN); adj--) {
+		unsigned int bucket = lmk_adj_bucket(adj);
+		struct hlist_nulls_node *node;
+		struct task_struct *tsk;
+
+restart:
+		hlist_nulls_for_each_entry_rcu(tsk, node,
+				&lmk_adj_buckets[bucket], lmk_adj_node) {
+			if (lowmem_consider(tsk, min_score_adj, selected,
+					    selected_tasksize,
+					    selected_oom_score_adj))
+				return true;
+		}
+		if (get_nulls_value(node) != bucket)
+			goto restart;
+
+		if (*selected &&
+		    time_after(jiffies, lowmem_deathpending_timeout))
+			break;
+	}
+
+	return false;
+}
+#else
+static inline void lowmem_adj_index_init(void)
+{
+}
+
+static bool lowmem_select(short min_score_adj, struct task_struct **selected,
+			  int *selected_tasksize, short *selected_oom_score_adj)
 {
 	struct task_struct *tsk;
+
+	for_each_process(tsk) {
+		if (lowmem_consider(tsk, min_score_adj, selected,
+				    selected_tasksize, selected_oom_score_adj))
+			return true;
+	}
+
+	return false;
+}
+#endif
+
+static unsigned long lowmem_scan(struct shrinker *s, struct shrink_control *sc)
+{
 	struct task_struct *selected = NULL;
 	unsigned long rem = 0;
-	int tasksize;
 	int i;
 	int ret = 0;
 	short min_score_adj = OOM_SCORE_ADJ_MAX + 1;
@@ -631,6 +961,8 @@ static unsigned long lowmem_scan(struct shrinker *s, struct shrink_control *sc)
 	int array_size = ARRAY_SIZE(lowmem_adj);
 	int other_free;
 	int other_file;
+	ktime_t start;
+	u64 select_ns = 0;
 
 	if (!mutex_trylock(&scan_mutex))
 		return 0;
@@ -684,71 +1016,16 @@ static unsigned long lowmem_scan(struct shrinker *s, struct shrink_control *sc)
 
 	selected_oom_score_adj = min_score_adj;
 
+	start = ktime_get();
 	rcu_read_lock();
-	for_each_process(tsk) {
-		struct task_struct *p;
-		short oom_score_adj;
-
-		if (tsk->flags & PF_KTHREAD)
-			continue;
-
-		/* if task no longer has any memory ignore it */
-		if (test_task_flag(tsk, TIF_MM_RELEASED))
-			continue;
-
-		if (oom_reaper) {
-			p = find_lock_task_mm(tsk);
-			if (!p)
-				continue;
-
-			if (test_bit(MMF_OOM_VICTIM, &p->mm->flags)) {
-				if (test_bit(MMF_OOM_SKIP, &p->mm->flags)) {
-					task_unlock(p);
-					continue;
-				} else if (time_before_eq(jiffies,
-						lowmem_deathpending_timeout)) {
-					task_unlock(p);
-					rcu_read_unlock();
-					mutex_unlock(&scan_mutex);
-					return 0;
-				}
-			}
-		} else {
-			if (time_before_eq(jiffies,
-					   lowmem_deathpending_timeout))
-				if (test_task_lmk_waiting(tsk)) {
-					rcu_read_unlock();
-					mutex_unlock(&scan_mutex);
-					return 0;
-				}
-
-			p = find_lock_task_mm(tsk);
-			if (!p)
-				continue;
-		}
-
-		oom_score_adj = p->signal->oom_score_adj;
-		if (oom_score_adj < min_score_adj) {
-			task_unlock(p);
-			continue;
-		}
-		tasksize = get_mm_rss(p->mm);
-		task_unlock(p);
-		if (tasksize <= 0)
-			continue;
-		if (selected) {
-			if (oom_score_adj < selected_oom_score_adj)
-				continue;
-			if (oom_score_adj == selected_oom_score_adj &&
-			    tasksize <= selected_tasksize)
-				continue;
-		}
-		selected = p;
-		selected_tasksize = tasksize;
-		selected_oom_score_adj = oom_score_adj;
-		lowmem_print(3, "select '%s' (%d), adj %hd, size %d, to kill\n",
-			     p->comm, p->pid, oom_score_adj, tasksize);
+	if (lowmem_select(min_score_adj, &selected, &selected_tasksize,
+			  &selected_oom_score_adj)) {
+		rcu_read_unlock();
+		mutex_unlock(&scan_mutex);
+		return 0;
 	}
+	select_ns = ktime_to_ns(ktime_sub(ktime_get(), start));
+
 	if (selected) {
 		long cache_size = other_file * (long)(PAGE_SIZE / 1024);
 		long cache_limit = minfree * (long)(PAGE_SIZE / 1024);
@@ -827,7 +1104,8 @@ static unsigned long lowmem_scan(struct shrinker *s, struct shrink_control *sc)
 	mutex_unlock(&scan_mutex);
 
 	if (selected) {
-		handle_lmk_event(selected, selected_tasksize, min_score_adj);
+		handle_lmk_event(selected, selected_tasksize, min_score_adj,
+				 select_ns);
 		put_task_struct(selected);
 	}
 
@@ -908,6 +1186,7 @@ static int __init lowmem_init(void)
 		return rc;
 	}
 #endif
+	lowmem_adj_index_init();
 	register_shrinker(&lowmem_shrinker);
 	vmpressure_notifier_register(&lmk_vmpr_nb);
 	lmk_event_init();
@@ -35,6 +35,38 @@ struct ion_test_rw_data {
 	int __padding;
 };
 
+/**
+ * struct ion_test_bench_data - parameters and results of an allocation benchmark
+ * @size:		smallest allocation size
+ * @size_max:		largest allocation size, sizes are picked at random
+ *			between @size and @size_max when it is larger
+ * @heap_id_mask:	heaps to allocate from
+ * @flags:		allocation flags
+ * @iterations:		allocate/free cycles per thread
+ * @threads:		number of threads allocating concurrently
+ * @alloc_ns:		allocation latency p50, p99, p999 and max
+ * @free_ns:		free latency p50, p99, p999 and max
+ * @elapsed_ns:		wall time of the whole run
+ * @allocs_per_sec:	successful allocations per second over the run
+ * @kb_per_sec:		kilobytes allocated per second over the run
+ * @failures:		allocations that failed
+ */
+struct ion_test_bench_data {
+	__u64 size;
+	__u64 size_max;
+	__u32 heap_id_mask;
+	__u32 flags;
+	__u32 iterations;
+	__u32 threads;
+	__u64 alloc_ns[4];
+	__u64 free_ns[4];
+	__u64 elapsed_ns;
+	__u64 allocs_per_sec;
+	__u64 kb_per_sec;
+	__u32 failures;
+	__u32 __padding;
+};
+
 #define ION_IOC_MAGIC		'I'
 
 /**
@@ -66,5 +98,15 @@ struct ion_test_rw_data {
 #define ION_IOC_TEST_KERNEL_MAPPING \
 			_IOW(ION_IOC_MAGIC, 0xf2, struct ion_test_rw_data)
 
+/**
+ * DOC: ION_IOC_TEST_BENCH - measure allocation latency and throughput
+ *
+ * Allocates and frees buffers from the given heaps across several kernel
+ * threads and reports latency percentiles and throughput.  Only expected to
+ * be used for debugging and testing, may not always be available.
+ */
+#define ION_IOC_TEST_BENCH \
+			_IOWR(ION_IOC_MAGIC, 0xf3, struct ion_test_bench_data)
+
 
 #endif /* _UAPI_LINUX_ION_H */
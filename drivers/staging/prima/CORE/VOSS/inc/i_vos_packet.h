@@ -48,6 +48,7 @@
 #include <vos_list.h>
 #include <linux/skbuff.h>
 #include <linux/list.h>
+#include <linux/llist.h>
 
 #include <wlan_qct_pal_packet.h>
 #include <wlan_qct_wdi_ds.h>
@@ -89,6 +90,18 @@
 // replenish pool before we attempt to replenish them
 #define VPKT_RX_REPLENISH_THRESHOLD (  VPKT_NUM_RX_RAW_PACKETS >> 2 )
 
+// the Receive pool is at its low watermark once fewer than this share of
+// its packets are free; the condition clears again at twice this level
+#define VPKT_RX_LOW_WATERMARK_SHIFT ( 3 )
+
+// MTRACE codes for the VOSS packet module
+enum
+{
+   TRACE_CODE_VOS_PKT_RX_LOW_WM = 1,
+   TRACE_CODE_VOS_PKT_RX_LOW_RESOURCE,
+   TRACE_CODE_VOS_PKT_RX_REPLENISH_FAIL
+};
+
 // magic number which can be used to verify that a structure pointer being
 // dereferenced is really referencing a struct vos_pkt_t
 #define VPKT_MAGIC_NUMBER 0x56504B54  /* VPKT in ASCII */
@@ -112,6 +125,9 @@ struct vos_pkt_t
    // Node for linking vos packets into a free list
    struct list_head node;
 
+   // Node for the lockless Rx Raw return list
+   struct llist_node freeNode;
+
    // Node for chaining vos packets into a packet chain
    struct vos_pkt_t *pNext;
 
@@ -196,6 +212,17 @@ typedef struct vos_pkt_context_s
    // value to the driver to save the memory usage.
    v_SIZE_t numOfRxRawPackets;
 
+   // RX_RAW packets returned with their skb still attached are pushed here
+   // without taking any lock, and spliced into rxRawFreeList by the
+   // allocating side once that runs empty.
+   struct llist_head rxRawReturnList;
+   atomic_t rxRawReturnListCount;
+
+   // Low watermark state of the Rx Raw pool and the number of times the
+   // pool dropped below it
+   v_BOOL_t rxRawLowWatermark;
+   v_U32_t rxRawLowWatermarkCount;
+
    // These are the structs to keep low-resource callback information.
    // There are separate low-resource callback information blocks for
    // RX_RAW, TX_DATA, and TX_MGMT.
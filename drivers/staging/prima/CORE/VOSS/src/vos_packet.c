@@ -170,12 +170,73 @@ static VOS_STATUS vos_pkti_list_destroy( struct list_head *pList )
 }
 
 
+// number of Rx Raw packets ready for allocation, on the free list or on
+// the lockless return list
+static inline v_SIZE_t vos_pkti_rx_raw_avail(void)
+{
+   int returned = atomic_read(&gpVosPacketContext->rxRawReturnListCount);
+
+   return gpVosPacketContext->rxRawFreeListCount +
+          (returned > 0 ? returned : 0);
+}
+
+
+// move the packets on the lockless return list to the Rx Raw free list.
+// must be called with rxRawFreeListLock held.
+static void vos_pkti_splice_rx_return_list(void)
+{
+   struct llist_node *pFirst;
+   struct vos_pkt_t *pVosPacket;
+   struct vos_pkt_t *pTmp;
+
+   pFirst = llist_del_all(&gpVosPacketContext->rxRawReturnList);
+   llist_for_each_entry_safe(pVosPacket, pTmp, pFirst, freeNode)
+   {
+      list_add_tail(&pVosPacket->node, &gpVosPacketContext->rxRawFreeList);
+      gpVosPacketContext->rxRawFreeListCount++;
+      atomic_dec(&gpVosPacketContext->rxRawReturnListCount);
+   }
+}
+
+
+// track the Rx Raw pool against its low watermark, recording an MTRACE
+// event each time it drops below.  called with rxRawFreeListLock held.
+static void vos_pkti_check_rx_low_watermark(void)
+{
+   v_SIZE_t avail = vos_pkti_rx_raw_avail();
+   v_SIZE_t lowWatermark = gpVosPacketContext->numOfRxRawPackets >>
+                           VPKT_RX_LOW_WATERMARK_SHIFT;
+
+   if (!gpVosPacketContext->rxRawLowWatermark)
+   {
+      if (unlikely(avail < lowWatermark))
+      {
+         gpVosPacketContext->rxRawLowWatermark = VOS_TRUE;
+         gpVosPacketContext->rxRawLowWatermarkCount++;
+         MTRACE(vos_trace(VOS_MODULE_ID_VOSS, TRACE_CODE_VOS_PKT_RX_LOW_WM,
+                          NO_SESSION, avail));
+         VOS_TRACE(VOS_MODULE_ID_VOSS, VOS_TRACE_LEVEL_INFO,
+                   "VPKT [%d]: Rx Raw pool low, %d free", __LINE__, avail);
+      }
+   }
+   else if (avail >= 2 * lowWatermark)
+   {
+      gpVosPacketContext->rxRawLowWatermark = VOS_FALSE;
+   }
+}
+
+
 static void vos_pkti_replenish_raw_pool(void)
 {
    struct sk_buff * pSkb;
    struct vos_pkt_t *pVosPacket;
+   struct vos_pkt_t *pTmp;
    v_BOOL_t didOne = VOS_FALSE;
    vos_pkt_get_packet_callback callback;
+   LIST_HEAD(replenishList);
+   LIST_HEAD(replenishedList);
+   v_SIZE_t replenishCount;
+   v_SIZE_t replenishedCount = 0;
 
    // if there are no packets in the replenish pool then we can't do anything
    mutex_lock(&gpVosPacketContext->rxReplenishListLock);
@@ -191,7 +252,7 @@ static void vos_pkti_replenish_raw_pool(void)
 
    if ((gpVosPacketContext->rxReplenishListCount <
         gpVosPacketContext->numOfRxRawPackets/4) &&
-         (!list_empty(&gpVosPacketContext->rxRawFreeList)))
+         (vos_pkti_rx_raw_avail()))
    {
       mutex_unlock(&gpVosPacketContext->rxRawFreeListLock);
       mutex_unlock(&gpVosPacketContext->rxReplenishListLock);
@@ -201,38 +262,58 @@ static void vos_pkti_replenish_raw_pool(void)
    VOS_TRACE(VOS_MODULE_ID_VOSS, VOS_TRACE_LEVEL_INFO,
              "VPKT [%d]: Packet replenish activated", __LINE__);
 
-   // try to replenish all of the packets in the replenish pool
-   while (gpVosPacketContext->rxReplenishListCount)
+   // take over the whole replenish pool; the skbs are allocated without
+   // holding either lock so returns and allocations are not held up
+   list_splice_init(&gpVosPacketContext->rxReplenishList, &replenishList);
+   replenishCount = gpVosPacketContext->rxReplenishListCount;
+   gpVosPacketContext->rxReplenishListCount = 0;
+   mutex_unlock(&gpVosPacketContext->rxRawFreeListLock);
+   mutex_unlock(&gpVosPacketContext->rxReplenishListLock);
+
+   list_for_each_entry_safe(pVosPacket, pTmp, &replenishList, node)
    {
       // we preallocate a fixed-size skb and reserve the entire buffer
       // as headroom since that is what other components expect
       pSkb = alloc_skb(VPKT_SIZE_BUFFER, GFP_ATOMIC);
       if (unlikely(NULL == pSkb))
       {
-         gpVosPacketContext->rxReplenishFailCount++;
          break;
       }
       skb_reserve(pSkb, VPKT_SIZE_BUFFER);
 
-      // remove a vos packet from the replenish pool
-      pVosPacket = list_first_entry(&gpVosPacketContext->rxReplenishList,
-                                    struct vos_pkt_t, node);
-      list_del(&pVosPacket->node);
-      gpVosPacketContext->rxReplenishListCount--;
-
       // attach the skb to the vos packet
       pVosPacket->pSkb = pSkb;
-
-      // add it to the Rx Raw Free Pool
-      list_add_tail(&pVosPacket->node, &gpVosPacketContext->rxRawFreeList);
-      gpVosPacketContext->rxRawFreeListCount++;
-
-      didOne = VOS_TRUE;
+      list_move_tail(&pVosPacket->node, &replenishedList);
+      replenishedCount++;
 
       VOS_TRACE(VOS_MODULE_ID_VOSS, VOS_TRACE_LEVEL_INFO,
                 "VPKT [%d]: [%pK] Packet replenished",
                 __LINE__, pVosPacket);
+   }
+
+   mutex_lock(&gpVosPacketContext->rxReplenishListLock);
+   mutex_lock(&gpVosPacketContext->rxRawFreeListLock);
 
+   // whatever could not get an skb goes back to the replenish pool
+   if (unlikely(replenishedCount != replenishCount))
+   {
+      gpVosPacketContext->rxReplenishFailCount++;
+      MTRACE(vos_trace(VOS_MODULE_ID_VOSS,
+                       TRACE_CODE_VOS_PKT_RX_REPLENISH_FAIL, NO_SESSION,
+                       replenishCount - replenishedCount));
+      list_splice_tail(&replenishList,
+                       &gpVosPacketContext->rxReplenishList);
+      gpVosPacketContext->rxReplenishListCount +=
+         replenishCount - replenishedCount;
+   }
+
+   // add the replenished packets to the Rx Raw Free Pool
+   if (replenishedCount)
+   {
+      list_splice_tail(&replenishedList,
+                       &gpVosPacketContext->rxRawFreeList);
+      gpVosPacketContext->rxRawFreeListCount += replenishedCount;
+      didOne = VOS_TRUE;
    }
 
    // if we replenished anything and if there is a callback waiting
@@ -273,6 +354,91 @@ static void vos_pkti_replenish_raw_pool(void)
 }
 
 
+// return an Rx Raw packet that still has its skb to the pool without
+// taking the free list lock.  if the allocating side registered a low
+// resource callback in the meantime, hand it a packet from here.
+static void vos_pkti_return_rx_raw_lockless(struct vos_pkt_t *pPacket)
+{
+   vos_pkt_low_resource_info *pLowResourceInfo =
+      &gpVosPacketContext->rxRawLowResourceInfo;
+   vos_pkt_get_packet_callback callback;
+
+   llist_add(&pPacket->freeNode, &gpVosPacketContext->rxRawReturnList);
+   atomic_inc(&gpVosPacketContext->rxRawReturnListCount);
+
+   // pairs with the barrier in vos_pkt_get_packet() after the callback is
+   // registered: either that side sees this packet or this side sees
+   // the callback
+   smp_mb();
+   if (likely(NULL == pLowResourceInfo->callback))
+   {
+      return;
+   }
+
+   mutex_lock(&gpVosPacketContext->rxRawFreeListLock);
+   callback = pLowResourceInfo->callback;
+   pLowResourceInfo->callback = NULL;
+   if (callback)
+   {
+      vos_pkti_splice_rx_return_list();
+   }
+   if (!callback || list_empty(&gpVosPacketContext->rxRawFreeList))
+   {
+      pLowResourceInfo->callback = callback;
+      mutex_unlock(&gpVosPacketContext->rxRawFreeListLock);
+      return;
+   }
+
+   pPacket = list_first_entry(&gpVosPacketContext->rxRawFreeList,
+                              struct vos_pkt_t, node);
+   list_del(&pPacket->node);
+   gpVosPacketContext->rxRawFreeListCount--;
+   mutex_unlock(&gpVosPacketContext->rxRawFreeListLock);
+
+   VOS_TRACE(VOS_MODULE_ID_VOSS, VOS_TRACE_LEVEL_INFO,
+             "VPKT [%d]: [%pK] Packet recycled, type RX_RAW",
+             __LINE__, pPacket);
+
+   // clear out the User Data pointers in the voss packet..
+   memset(&pPacket->pvUserData, 0, sizeof(pPacket->pvUserData));
+
+   // initialize the 'chain' pointer to NULL.
+   pPacket->pNext = NULL;
+
+   // timestamp the vos packet.
+   pPacket->timestamp = vos_timer_get_system_ticks();
+
+   callback(pPacket, pLowResourceInfo->userData);
+}
+
+
+#ifdef TRACE_RECORD
+static char *vos_pkti_trace_code_str(v_U8_t code)
+{
+   switch (code)
+   {
+   case TRACE_CODE_VOS_PKT_RX_LOW_WM:
+      return "RX_LOW_WM";
+   case TRACE_CODE_VOS_PKT_RX_LOW_RESOURCE:
+      return "RX_LOW_RESOURCE";
+   case TRACE_CODE_VOS_PKT_RX_REPLENISH_FAIL:
+      return "RX_REPLENISH_FAIL";
+   default:
+      return "UNKNOWN";
+   }
+}
+
+static void vos_pkti_trace_dump(void *pMac, tpvosTraceRecord pRecord,
+                                v_U16_t recIndex)
+{
+   VOS_TRACE(VOS_MODULE_ID_VOSS, VOS_TRACE_LEVEL_ERROR,
+             "%04d %012u VPKT %s(%d) %u", recIndex, pRecord->time,
+             vos_pkti_trace_code_str(pRecord->code), pRecord->code,
+             pRecord->data);
+}
+#endif
+
+
 #if defined( WLAN_DEBUG )
 static char *vos_pkti_packet_type_str(VOS_PKT_TYPE pktType)
 {
@@ -400,6 +566,10 @@ VOS_STATUS vos_packet_open( v_VOID_t *pVosContext,
 
       pVosPacketContext->numOfRxRawPackets = vos_pkt_get_num_of_rx_raw_pkts();
 
+      // and the lockless return list feeding it (initially empty)
+      init_llist_head(&pVosPacketContext->rxRawReturnList);
+      atomic_set(&pVosPacketContext->rxRawReturnListCount, 0);
+
       // fill the rxRaw free list
       for (idx = 0; idx < pVosPacketContext->numOfRxRawPackets; idx++)
       {
@@ -489,6 +659,10 @@ VOS_STATUS vos_packet_open( v_VOID_t *pVosContext,
          break;
       }
 
+#ifdef TRACE_RECORD
+      vosTraceRegister(VOS_MODULE_ID_VOSS, vos_pkti_trace_dump);
+#endif
+
    } while (0);
 
    return vosStatus;
@@ -546,6 +720,7 @@ VOS_STATUS vos_packet_close( v_PVOID_t pVosContext )
    mutex_unlock(&gpVosPacketContext->txDataFreeListLock);
 
    mutex_lock(&gpVosPacketContext->rxRawFreeListLock);
+   vos_pkti_splice_rx_return_list();
    (void) vos_pkti_list_destroy(&gpVosPacketContext->rxRawFreeList);
    gpVosPacketContext->rxRawFreeListCount    = 0;
    mutex_unlock(&gpVosPacketContext->rxRawFreeListLock);
@@ -718,6 +893,13 @@ VOS_STATUS vos_pkt_get_packet( vos_pkt_t **ppPacket,
    }
 
    mutex_lock(mlock);
+   // Rx Raw packets returned without the lock are only pulled in once
+   // the free pool runs dry, one splice per batch of returns
+   if ((VOS_PKT_TYPE_RX_RAW == pktType) && unlikely(list_empty(pPktFreeList)))
+   {
+      vos_pkti_splice_rx_return_list();
+   }
+
    // are there vos packets on the associated free pool?
    if (unlikely(list_empty(pPktFreeList)))
    {
@@ -737,12 +919,30 @@ VOS_STATUS vos_pkt_get_packet( vos_pkt_t **ppPacket,
       // callback when a packet becomes available
       pLowResourceInfo->callback   = callback;
       pLowResourceInfo->userData   = userData;
-      VOS_TRACE(VOS_MODULE_ID_VOSS, VOS_TRACE_LEVEL_WARN,
-                "VPKT [%d]: Low resource condition for packet type %d[%s]",
-                __LINE__, pktType, vos_pkti_packet_type_str(pktType));
-      mutex_unlock(mlock);
 
-      return VOS_STATUS_E_RESOURCES;
+      // a lockless return that missed the callback must be seen here
+      if (VOS_PKT_TYPE_RX_RAW == pktType)
+      {
+         smp_mb();
+         vos_pkti_splice_rx_return_list();
+      }
+
+      if (likely(list_empty(pPktFreeList)))
+      {
+         VOS_TRACE(VOS_MODULE_ID_VOSS, VOS_TRACE_LEVEL_WARN,
+                   "VPKT [%d]: Low resource condition for packet type %d[%s]",
+                   __LINE__, pktType, vos_pkti_packet_type_str(pktType));
+         if (VOS_PKT_TYPE_RX_RAW == pktType)
+         {
+            MTRACE(vos_trace(VOS_MODULE_ID_VOSS,
+                             TRACE_CODE_VOS_PKT_RX_LOW_RESOURCE, NO_SESSION,
+                             gpVosPacketContext->rxReplenishListCount));
+         }
+         mutex_unlock(mlock);
+
+         return VOS_STATUS_E_RESOURCES;
+      }
+      pLowResourceInfo->callback = NULL;
    }
 
    // remove the first record from the free pool
@@ -752,6 +952,10 @@ VOS_STATUS vos_pkt_get_packet( vos_pkt_t **ppPacket,
    {
       (*pCount)--;
    }
+   if (VOS_PKT_TYPE_RX_RAW == pktType)
+   {
+      vos_pkti_check_rx_low_watermark();
+   }
    mutex_unlock(mlock);
 
    // clear out the User Data pointers in the voss packet..
@@ -1427,6 +1631,12 @@ VOS_STATUS vos_pkt_return_packet( vos_pkt_t *pPacket )
                    "VPKT [%d]: [%pK] Packet returned, type %d[%s]",
                    __LINE__, pPacket, pPacket->packetType,
                    vos_pkti_packet_type_str(pPacket->packetType));
+         if ((VOS_PKT_TYPE_RX_RAW == pPacket->packetType) && pPacket->pSkb)
+         {
+            vos_pkti_return_rx_raw_lockless(pPacket);
+            pPacket = pNext;
+            continue;
+         }
          mutex_lock(mlock);
          list_add_tail(&pPacket->node, pPktFreeList);
 
@@ -2974,8 +3184,9 @@ VOS_STATUS vos_pkt_get_available_buffer_pool (VOS_PKT_TYPE  pktType,
       // then he probably wants as many packets to be available as
       // possible so replenish the raw pool
       vos_pkti_replenish_raw_pool();
-      // Return the pre-calculated count 'rxRawFreeListCount'
-      *vosFreeBuffer = gpVosPacketContext->rxRawFreeListCount;
+      // Return the pre-calculated count 'rxRawFreeListCount' plus the
+      // packets waiting on the lockless return list
+      *vosFreeBuffer = vos_pkti_rx_raw_avail();
       return VOS_STATUS_SUCCESS;
       break;
 
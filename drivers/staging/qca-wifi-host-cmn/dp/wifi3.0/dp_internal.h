@@ -403,6 +403,8 @@ QDF_STATUS dp_h2t_ext_stats_msg_send(struct dp_pdev *pdev,
 		uint8_t mac_id);
 void dp_htt_stats_print_tag(uint8_t tag_type, uint32_t *tag_buf);
 void dp_htt_stats_copy_tag(struct dp_pdev *pdev, uint8_t tag_type, uint32_t *tag_buf);
+void dp_print_rx_buf_pool_stats(struct dp_pdev *pdev);
+void dp_print_tx_desc_pool_stats(struct dp_soc *soc);
 void dp_peer_rxtid_stats(struct dp_peer *peer, void (*callback_fn),
 		void *cb_ctxt);
 void dp_set_pn_check_wifi3(struct cdp_vdev *vdev_handle,
@@ -5174,6 +5174,7 @@ dp_print_pdev_rx_stats(struct dp_pdev *pdev)
 			pdev->stats.buf_freelist);
 	DP_PRINT_STATS("	Low threshold intr = %d",
 			pdev->stats.replenish.low_thresh_intrs);
+	dp_print_rx_buf_pool_stats(pdev);
 	DP_PRINT_STATS("Dropped:");
 	DP_PRINT_STATS("	msdu_not_done = %d",
 			pdev->stats.dropped.msdu_not_done);
@@ -5257,6 +5258,7 @@ dp_print_soc_tx_stats(struct dp_soc *soc)
 
 	DP_PRINT_STATS("Tx Descriptors In Use = %d",
 			soc->stats.tx.desc_in_use);
+	dp_print_tx_desc_pool_stats(soc);
 	DP_PRINT_STATS("Invalid peer:");
 	DP_PRINT_STATS("	Packets = %d",
 			soc->stats.tx.tx_invalid_peer.num);
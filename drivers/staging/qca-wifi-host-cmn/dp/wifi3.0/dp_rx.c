@@ -154,6 +154,11 @@ QDF_STATUS dp_rx_buffers_replenish(struct dp_soc *dp_soc, uint32_t mac_id,
 	count = 0;
 
 	while (count < num_req_buffers) {
+		/* Recycled buffers are already mapped */
+		rx_netbuf = dp_rx_buf_pool_get(&rx_desc_pool->buf_pool);
+		if (rx_netbuf)
+			goto mapped;
+
 		rx_netbuf = qdf_nbuf_alloc(dp_soc->osdev,
 					RX_BUFFER_SIZE,
 					RX_BUFFER_RESERVATION,
@@ -172,6 +177,7 @@ QDF_STATUS dp_rx_buffers_replenish(struct dp_soc *dp_soc, uint32_t mac_id,
 			DP_STATS_INC(dp_pdev, replenish.map_err, 1);
 			continue;
 		}
+mapped:
 
 		paddr = qdf_nbuf_get_frag_paddr(rx_netbuf, 0);
 
@@ -1545,7 +1551,8 @@ dp_rx_process(struct dp_intr *int_ctx, void *hal_ring, uint32_t quota)
 					QDF_TRACE_LEVEL_ERROR,
 					FL("Policy Check Drop pkt"));
 			/* Drop & free packet */
-			qdf_nbuf_free(nbuf);
+			dp_rx_buf_pool_nbuf_free(soc, vdev->pdev->pdev_id,
+						 nbuf);
 			/* Statistics */
 			nbuf = next;
 			continue;
@@ -1558,7 +1565,8 @@ dp_rx_process(struct dp_intr *int_ctx, void *hal_ring, uint32_t quota)
 			DP_STATS_INC(vdev->pdev, dropped.mec, 1);
 
 			/* Drop & free packet */
-			qdf_nbuf_free(nbuf);
+			dp_rx_buf_pool_nbuf_free(soc, vdev->pdev->pdev_id,
+						 nbuf);
 			/* Statistics */
 			nbuf = next;
 			continue;
@@ -1568,7 +1576,8 @@ dp_rx_process(struct dp_intr *int_ctx, void *hal_ring, uint32_t quota)
 			(hal_rx_msdu_end_da_is_mcbc_get(rx_tlv_hdr)) &&
 			(hal_rx_get_mpdu_mac_ad4_valid(rx_tlv_hdr) == false))) {
 			DP_STATS_INC(peer, rx.nawds_mcast_drop, 1);
-			qdf_nbuf_free(nbuf);
+			dp_rx_buf_pool_nbuf_free(soc, vdev->pdev->pdev_id,
+						 nbuf);
 			nbuf = next;
 			continue;
 		}
@@ -1618,7 +1627,8 @@ dp_rx_process(struct dp_intr *int_ctx, void *hal_ring, uint32_t quota)
 			DP_STATS_INC(vdev->pdev, dropped.mesh_filter,
 					1);
 
-				qdf_nbuf_free(nbuf);
+				dp_rx_buf_pool_nbuf_free(soc,
+						vdev->pdev->pdev_id, nbuf);
 				nbuf = next;
 				continue;
 			}
@@ -1692,6 +1702,8 @@ dp_rx_pdev_detach(struct dp_pdev *pdev)
 
 	rx_desc_pool = &soc->rx_desc_buf[pdev_id];
 
+	dp_rx_buf_pool_deinit(soc, &rx_desc_pool->buf_pool);
+
 	if (rx_desc_pool->pool_size != 0) {
 		dp_rx_desc_pool_free(soc, pdev_id, rx_desc_pool);
 	}
@@ -1737,6 +1749,8 @@ dp_rx_pdev_attach(struct dp_pdev *pdev)
 	rx_desc_pool = &soc->rx_desc_buf[pdev_id];
 
 	dp_rx_desc_pool_alloc(soc, pdev_id, rxdma_entries*3, rx_desc_pool);
+	dp_rx_buf_pool_init(&rx_desc_pool->buf_pool,
+			rxdma_entries >> DP_RX_BUF_POOL_RING_SHIFT);
 
 	rx_desc_pool->owner = DP_WBM2SW_RBM;
 	/* For Rx buffers, WBM release ring is SW RING 3,for all pdev's */
@@ -38,6 +38,9 @@
 #define RX_BUFFER_SIZE			2048
 #define RX_BUFFER_RESERVATION   0
 
+/* Recycled RX buffers kept per rxdma ring, as a fraction of its entries */
+#define DP_RX_BUF_POOL_RING_SHIFT	2
+
 #define DP_PEER_METADATA_PEER_ID_MASK	0x0000ffff
 #define DP_PEER_METADATA_PEER_ID_SHIFT	0
 #define DP_PEER_METADATA_VDEV_ID_MASK	0x00070000
@@ -344,6 +347,16 @@ void dp_rx_desc_pool_free(struct dp_soc *soc,
 				uint32_t pool_id,
 				struct rx_desc_pool *rx_desc_pool);
 
+void dp_rx_buf_pool_init(struct dp_rx_buf_pool *buf_pool, uint32_t max_bufs);
+
+void dp_rx_buf_pool_deinit(struct dp_soc *soc,
+				struct dp_rx_buf_pool *buf_pool);
+
+qdf_nbuf_t dp_rx_buf_pool_get(struct dp_rx_buf_pool *buf_pool);
+
+void dp_rx_buf_pool_nbuf_free(struct dp_soc *soc, uint8_t pool_id,
+				qdf_nbuf_t nbuf);
+
 void dp_rx_deliver_raw(struct dp_vdev *vdev, qdf_nbuf_t nbuf_list,
 				struct dp_peer *peer);
 
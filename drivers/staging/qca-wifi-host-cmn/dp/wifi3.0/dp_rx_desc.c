@@ -165,3 +165,113 @@ void dp_rx_add_desc_list_to_free_list(struct dp_soc *soc,
 
 	qdf_spin_unlock_bh(&rx_desc_pool->lock);
 }
+
+/*
+ * dp_rx_buf_pool_init() - set up the recycled RX buffer pool of a ring
+ *
+ * @buf_pool: buffer pool of the ring's rx descriptor pool
+ * @max_bufs: most buffers the pool may hold
+ */
+void dp_rx_buf_pool_init(struct dp_rx_buf_pool *buf_pool, uint32_t max_bufs)
+{
+	qdf_mem_zero(buf_pool, sizeof(*buf_pool));
+	qdf_spinlock_create(&buf_pool->lock);
+	qdf_nbuf_queue_init(&buf_pool->bufs);
+	buf_pool->max_bufs = max_bufs;
+}
+
+/*
+ * dp_rx_buf_pool_deinit() - unmap and free every buffer left in the pool
+ *
+ * @soc: core txrx main context
+ * @buf_pool: buffer pool of the ring's rx descriptor pool
+ */
+void dp_rx_buf_pool_deinit(struct dp_soc *soc,
+				struct dp_rx_buf_pool *buf_pool)
+{
+	qdf_nbuf_t nbuf;
+
+	if (!buf_pool->max_bufs)
+		return;
+
+	qdf_spin_lock_bh(&buf_pool->lock);
+	while ((nbuf = qdf_nbuf_queue_remove(&buf_pool->bufs)) != NULL) {
+		qdf_nbuf_unmap_single(soc->osdev, nbuf,
+				QDF_DMA_BIDIRECTIONAL);
+		qdf_nbuf_free(nbuf);
+	}
+	buf_pool->max_bufs = 0;
+	qdf_spin_unlock_bh(&buf_pool->lock);
+	qdf_spinlock_destroy(&buf_pool->lock);
+}
+
+/*
+ * dp_rx_buf_pool_get() - take a mapped buffer from the pool
+ *
+ * @buf_pool: buffer pool of the ring's rx descriptor pool
+ *
+ * Return: a buffer that is ready for the rxdma ring, or NULL when the
+ *	   caller has to allocate and map one
+ */
+qdf_nbuf_t dp_rx_buf_pool_get(struct dp_rx_buf_pool *buf_pool)
+{
+	qdf_nbuf_t nbuf;
+
+	if (!buf_pool->max_bufs)
+		return NULL;
+
+	qdf_spin_lock_bh(&buf_pool->lock);
+	nbuf = qdf_nbuf_queue_remove(&buf_pool->bufs);
+	if (nbuf)
+		buf_pool->hits++;
+	else
+		buf_pool->misses++;
+	qdf_spin_unlock_bh(&buf_pool->lock);
+
+	return nbuf;
+}
+
+/*
+ * dp_rx_buf_pool_nbuf_free() - free an RX buffer the driver consumed
+ *
+ * @soc: core txrx main context
+ * @pool_id: rx descriptor pool the buffer was replenished from
+ * @nbuf: buffer reaped from the ring, already unmapped
+ *
+ * Buffers dropped in the RX path are reset, mapped again and kept for the
+ * next replenish instead of going back to the allocator. Buffers that are
+ * shared, chained or arrive while the pool is full are freed.
+ */
+void dp_rx_buf_pool_nbuf_free(struct dp_soc *soc, uint8_t pool_id,
+				qdf_nbuf_t nbuf)
+{
+	struct dp_rx_buf_pool *buf_pool = &soc->rx_desc_buf[pool_id].buf_pool;
+	QDF_STATUS ret;
+
+	if (!buf_pool->max_bufs)
+		goto free;
+
+	if (qdf_nbuf_is_cloned(nbuf) || qdf_nbuf_get_users(nbuf) != 1 ||
+	    qdf_nbuf_get_ext_list(nbuf) || qdf_nbuf_get_nr_frags(nbuf))
+		goto release;
+
+	/* Unlocked peek; a racing put only overshoots by a buffer or two */
+	if (qdf_nbuf_queue_len(&buf_pool->bufs) >= buf_pool->max_bufs)
+		goto release;
+
+	qdf_nbuf_reset(nbuf, RX_BUFFER_RESERVATION, RX_BUFFER_ALIGNMENT);
+	ret = qdf_nbuf_map_single(soc->osdev, nbuf, QDF_DMA_BIDIRECTIONAL);
+	if (qdf_unlikely(QDF_IS_STATUS_ERROR(ret)))
+		goto release;
+
+	qdf_spin_lock_bh(&buf_pool->lock);
+	qdf_nbuf_queue_add(&buf_pool->bufs, nbuf);
+	buf_pool->recycled++;
+	qdf_spin_unlock_bh(&buf_pool->lock);
+	return;
+
+release:
+	buf_pool->released++;
+free:
+	qdf_nbuf_free(nbuf);
+}
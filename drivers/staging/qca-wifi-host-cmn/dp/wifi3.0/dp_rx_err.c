@@ -550,7 +550,7 @@ dp_rx_null_q_desc_handle(struct dp_soc *soc,
 		QDF_TRACE(QDF_MODULE_ID_DP, QDF_TRACE_LEVEL_ERROR,
 				FL("INVALID vdev %pK OR osif_rx"), vdev);
 		/* Drop & free packet */
-		qdf_nbuf_free(nbuf);
+		dp_rx_buf_pool_nbuf_free(soc, pool_id, nbuf);
 		DP_STATS_INC(soc, rx.err.invalid_vdev, 1);
 		return;
 	}
@@ -563,7 +563,7 @@ dp_rx_null_q_desc_handle(struct dp_soc *soc,
 
 	if (dp_rx_mcast_echo_check(soc, peer, rx_tlv_hdr, nbuf)) {
 		/* this is a looped back MCBC pkt, drop it */
-		qdf_nbuf_free(nbuf);
+		dp_rx_buf_pool_nbuf_free(soc, pool_id, nbuf);
 		return;
 	}
 	/*
@@ -572,7 +572,7 @@ dp_rx_null_q_desc_handle(struct dp_soc *soc,
 	 * from any proxysta.
 	 */
 	if (check_qwrap_multicast_loopback(vdev, nbuf)) {
-		qdf_nbuf_free(nbuf);
+		dp_rx_buf_pool_nbuf_free(soc, pool_id, nbuf);
 		return;
 	}
 
@@ -584,7 +584,7 @@ dp_rx_null_q_desc_handle(struct dp_soc *soc,
 					"%s free buffer for multicast packet",
 					 __func__);
 		DP_STATS_INC(peer, rx.nawds_mcast_drop, 1);
-		qdf_nbuf_free(nbuf);
+		dp_rx_buf_pool_nbuf_free(soc, pool_id, nbuf);
 		return;
 	}
 
@@ -594,7 +594,7 @@ dp_rx_null_q_desc_handle(struct dp_soc *soc,
 				QDF_TRACE_LEVEL_ERROR,
 				FL("mcast Policy Check Drop pkt"));
 		/* Drop & free packet */
-		qdf_nbuf_free(nbuf);
+		dp_rx_buf_pool_nbuf_free(soc, pool_id, nbuf);
 		return;
 	}
 
@@ -633,7 +633,7 @@ dp_rx_null_q_desc_handle(struct dp_soc *soc,
 					QDF_TRACE_LEVEL_INFO,
 					FL("received pkt with same src MAC"));
 			/* Drop & free packet */
-			qdf_nbuf_free(nbuf);
+			dp_rx_buf_pool_nbuf_free(soc, pool_id, nbuf);
 			return;
 		}
 
@@ -3330,3 +3330,71 @@ void dp_htt_stats_copy_tag(struct dp_pdev *pdev, uint8_t tag_type, uint32_t *tag
 	if (dest_ptr)
 		qdf_mem_copy(dest_ptr, tag_buf, size);
 }
+
+/*
+ * dp_print_rx_buf_pool_stats: Print recycled RX buffer pool stats
+ * @pdev: DP_PDEV handle
+ *
+ * return: void
+ */
+void dp_print_rx_buf_pool_stats(struct dp_pdev *pdev)
+{
+	struct dp_rx_buf_pool *buf_pool =
+		&pdev->soc->rx_desc_buf[pdev->pdev_id].buf_pool;
+	uint32_t total = buf_pool->hits + buf_pool->misses;
+	uint32_t hit_pct = 0;
+
+	if (!buf_pool->max_bufs)
+		return;
+
+	if (total)
+		hit_pct = qdf_do_div((uint64_t)buf_pool->hits * 100, total);
+
+	DP_PRINT_STATS("Recycled Buffer Pool:");
+	DP_PRINT_STATS("	Size = %u / %u",
+			qdf_nbuf_queue_len(&buf_pool->bufs),
+			buf_pool->max_bufs);
+	DP_PRINT_STATS("	Hits = %u Misses = %u Hit Rate = %u%%",
+			buf_pool->hits, buf_pool->misses, hit_pct);
+	DP_PRINT_STATS("	Recycled = %u Released = %u",
+			buf_pool->recycled, buf_pool->released);
+}
+
+#ifndef QCA_LL_TX_FLOW_CONTROL_V2
+/*
+ * dp_print_tx_desc_pool_stats: Print tx descriptor pool lock and cache stats
+ * @soc: DP_SOC handle
+ *
+ * Descriptors parked in the per-CPU caches are counted as in use by the
+ * pool, so they are reported separately here.
+ *
+ * return: void
+ */
+void dp_print_tx_desc_pool_stats(struct dp_soc *soc)
+{
+	struct dp_tx_desc_pool_s *pool;
+	uint32_t cached;
+	uint8_t pool_id;
+	int cpu;
+
+	DP_PRINT_STATS("Tx Descriptor Pools:");
+	for (pool_id = 0;
+	     pool_id < wlan_cfg_get_num_tx_desc_pool(soc->wlan_cfg_ctx);
+	     pool_id++) {
+		pool = &soc->tx_desc[pool_id];
+		cached = 0;
+		for (cpu = 0; cpu < NR_CPUS; cpu++)
+			cached += pool->cache[cpu].count;
+
+		DP_PRINT_STATS("	Pool %u: Free = %u Cached = %u",
+				pool_id, pool->num_free, cached);
+		DP_PRINT_STATS("	Lock Contended = %u", pool->lock_contended);
+		DP_PRINT_STATS("	Cache Refills = %u Flushes = %u",
+				pool->cache_refills, pool->cache_flushes);
+	}
+}
+#else
+void dp_print_tx_desc_pool_stats(struct dp_soc *soc)
+{
+}
+#endif /* !QCA_LL_TX_FLOW_CONTROL_V2 */
@@ -155,17 +155,18 @@ static void dp_tx_tso_desc_release(struct dp_soc *soc,
 }
 #endif
 /**
- * dp_tx_desc_release() - Release Tx Descriptor
+ * dp_tx_desc_release_resources() - Release what a Tx Descriptor holds
  * @tx_desc : Tx Descriptor
  * @desc_pool_id: Descriptor Pool ID
  *
- * Deallocate all resources attached to Tx descriptor and free the Tx
- * descriptor.
+ * Deallocate all resources attached to Tx descriptor, leaving the
+ * descriptor itself to the caller.
  *
  * Return:
  */
 static void
-dp_tx_desc_release(struct dp_tx_desc_s *tx_desc, uint8_t desc_pool_id)
+dp_tx_desc_release_resources(struct dp_tx_desc_s *tx_desc,
+			     uint8_t desc_pool_id)
 {
 	struct dp_pdev *pdev = tx_desc->pdev;
 	struct dp_soc *soc;
@@ -199,9 +200,23 @@ dp_tx_desc_release(struct dp_tx_desc_s *tx_desc, uint8_t desc_pool_id)
 		"Tx Completion Release desc %d status %d outstanding %d",
 		tx_desc->id, comp_status,
 		qdf_atomic_read(&pdev->num_tx_outstanding));
+}
 
-	dp_tx_desc_free(soc, tx_desc, desc_pool_id);
-	return;
+/**
+ * dp_tx_desc_release() - Release Tx Descriptor
+ * @tx_desc : Tx Descriptor
+ * @desc_pool_id: Descriptor Pool ID
+ *
+ * Deallocate all resources attached to Tx descriptor and free the Tx
+ * descriptor.
+ *
+ * Return:
+ */
+static void
+dp_tx_desc_release(struct dp_tx_desc_s *tx_desc, uint8_t desc_pool_id)
+{
+	dp_tx_desc_release_resources(tx_desc, desc_pool_id);
+	dp_tx_desc_free(tx_desc->pdev->soc, tx_desc, desc_pool_id);
 }
 
 /**
@@ -2824,6 +2839,50 @@ static inline void dp_tx_comp_process_tx_status(struct dp_tx_desc_s *tx_desc,
 	return;
 }
 
+/**
+ * dp_tx_comp_defer_buf() - Unmap a completed nbuf and queue it for freeing
+ * @soc: Soc handle
+ * @desc: software Tx descriptor to be processed
+ * @free_list: nbufs to be freed once the whole batch is processed
+ *
+ * Only plain MSDUs whose buffer goes straight back to the OS are deferred;
+ * everything else is left to dp_tx_comp_free_buf().
+ *
+ * Return: true if the nbuf was queued on @free_list
+ */
+static inline bool dp_tx_comp_defer_buf(struct dp_soc *soc,
+		struct dp_tx_desc_s *desc, qdf_nbuf_t *free_list)
+{
+	qdf_nbuf_t nbuf = desc->nbuf;
+
+	if (qdf_unlikely((desc->flags & DP_TX_DESC_FLAG_TDLS_FRAME) ||
+			 desc->msdu_ext_desc || desc->vdev->mesh_vdev))
+		return false;
+
+	qdf_nbuf_unmap(soc->osdev, nbuf, QDF_DMA_TO_DEVICE);
+	qdf_nbuf_set_next(nbuf, *free_list);
+	*free_list = nbuf;
+	return true;
+}
+
+/**
+ * dp_tx_comp_free_buf_list() - Free the nbufs deferred by a completion batch
+ * @nbuf: head of the list built by dp_tx_comp_defer_buf()
+ *
+ * Return: none
+ */
+static inline void dp_tx_comp_free_buf_list(qdf_nbuf_t nbuf)
+{
+	qdf_nbuf_t next;
+
+	while (nbuf) {
+		next = qdf_nbuf_next(nbuf);
+		qdf_nbuf_set_next(nbuf, NULL);
+		qdf_nbuf_free(nbuf);
+		nbuf = next;
+	}
+}
+
 /**
  * dp_tx_comp_process_desc() - Tx complete software descriptor handler
  * @soc: core txrx main context
@@ -2839,9 +2898,14 @@ static void dp_tx_comp_process_desc(struct dp_soc *soc,
 {
 	struct dp_tx_desc_s *desc;
 	struct dp_tx_desc_s *next;
+	struct dp_tx_desc_s *free_head[MAX_TXDESC_POOLS] = {NULL};
+	struct dp_tx_desc_s *free_tail[MAX_TXDESC_POOLS] = {NULL};
+	uint16_t free_count[MAX_TXDESC_POOLS] = {0};
+	qdf_nbuf_t free_nbufs = NULL;
 	struct hal_tx_completion_status ts = {0};
 	uint32_t length;
 	struct dp_peer *peer;
+	uint8_t pool_id;
 
 	DP_HIST_INIT();
 	desc = comp_head;
@@ -2876,16 +2940,33 @@ static void dp_tx_comp_process_desc(struct dp_soc *soc,
 
 			dp_send_completion_to_stack(soc, desc->pdev, ts.peer_id,
 				ts.ppdu_id, desc->nbuf);
-		} else {
+		} else if (!dp_tx_comp_defer_buf(soc, desc, &free_nbufs)) {
 			dp_tx_comp_free_buf(soc, desc);
 		}
 
 		DP_HIST_PACKET_COUNT_INC(desc->pdev->pdev_id);
 
 		next = desc->next;
-		dp_tx_desc_release(desc, desc->pool_id);
+		pool_id = desc->pool_id;
+		dp_tx_desc_release_resources(desc, pool_id);
+
+		/* Descriptors go back to their pools once per batch */
+		desc->flags = 0;
+		desc->next = free_head[pool_id];
+		if (!free_head[pool_id])
+			free_tail[pool_id] = desc;
+		free_head[pool_id] = desc;
+		free_count[pool_id]++;
 		desc = next;
 	}
+
+	for (pool_id = 0; pool_id < MAX_TXDESC_POOLS; pool_id++)
+		if (free_count[pool_id])
+			dp_tx_desc_free_list(soc, free_head[pool_id],
+					     free_tail[pool_id],
+					     free_count[pool_id], pool_id);
+
+	dp_tx_comp_free_buf_list(free_nbufs);
 	DP_TX_HIST_STATS_PER_PDEV();
 }
 
@@ -3260,6 +3341,7 @@ static void dp_tx_delete_static_pools(struct dp_soc *soc, int num_pool)
 	uint8_t i;
 
 	for (i = 0; i < num_pool; i++) {
+		dp_tx_desc_cache_drain(soc, i);
 		qdf_assert_always(!soc->tx_desc[i].num_allocated);
 		if (dp_tx_desc_pool_free(soc, i)) {
 			QDF_TRACE(QDF_MODULE_ID_DP, QDF_TRACE_LEVEL_INFO,
@@ -51,6 +51,15 @@ dp_tx_desc_pool_counter_initialize(struct dp_tx_desc_pool_s *tx_desc_pool,
 				  uint16_t num_elem)
 {
 }
+
+static void dp_tx_desc_pool_cache_init(struct dp_tx_desc_pool_s *tx_desc_pool)
+{
+}
+
+static void
+dp_tx_desc_pool_cache_deinit(struct dp_tx_desc_pool_s *tx_desc_pool)
+{
+}
 #else
 static void
 dp_tx_desc_pool_counter_initialize(struct dp_tx_desc_pool_s *tx_desc_pool,
@@ -58,6 +67,44 @@ dp_tx_desc_pool_counter_initialize(struct dp_tx_desc_pool_s *tx_desc_pool,
 {
 	tx_desc_pool->num_free = num_elem;
 	tx_desc_pool->num_allocated = 0;
+	tx_desc_pool->lock_contended = 0;
+	tx_desc_pool->cache_refills = 0;
+	tx_desc_pool->cache_flushes = 0;
+}
+
+/**
+ * dp_tx_desc_pool_cache_init() - Set up the per CPU descriptor caches
+ * @tx_desc_pool Handle to DP tx_desc_pool structure
+ *
+ * Return: None
+ */
+static void dp_tx_desc_pool_cache_init(struct dp_tx_desc_pool_s *tx_desc_pool)
+{
+	int cpu;
+
+	for (cpu = 0; cpu < NR_CPUS; cpu++) {
+		tx_desc_pool->cache[cpu].freelist = NULL;
+		tx_desc_pool->cache[cpu].count = 0;
+		TX_DESC_LOCK_CREATE(&tx_desc_pool->cache[cpu].lock);
+	}
+}
+
+/**
+ * dp_tx_desc_pool_cache_deinit() - Tear down the per CPU descriptor caches
+ * @tx_desc_pool Handle to DP tx_desc_pool structure
+ *
+ * Return: None
+ */
+static void
+dp_tx_desc_pool_cache_deinit(struct dp_tx_desc_pool_s *tx_desc_pool)
+{
+	int cpu;
+
+	for (cpu = 0; cpu < NR_CPUS; cpu++) {
+		tx_desc_pool->cache[cpu].freelist = NULL;
+		tx_desc_pool->cache[cpu].count = 0;
+		TX_DESC_LOCK_DESTROY(&tx_desc_pool->cache[cpu].lock);
+	}
 }
 #endif
 
@@ -140,6 +187,7 @@ QDF_STATUS dp_tx_desc_pool_alloc(struct dp_soc *soc, uint8_t pool_id,
 
 	dp_tx_desc_pool_counter_initialize(tx_desc_pool, num_elem);
 	TX_DESC_LOCK_CREATE(&tx_desc_pool->lock);
+	dp_tx_desc_pool_cache_init(tx_desc_pool);
 	return QDF_STATUS_SUCCESS;
 
 free_tx_desc:
@@ -165,6 +213,7 @@ QDF_STATUS dp_tx_desc_pool_free(struct dp_soc *soc, uint8_t pool_id)
 
 	qdf_mem_multi_pages_free(soc->osdev,
 		&tx_desc_pool->desc_pages, 0, true);
+	dp_tx_desc_pool_cache_deinit(tx_desc_pool);
 	TX_DESC_LOCK_DESTROY(&tx_desc_pool->lock);
 	TX_DESC_POOL_MEMBER_CLEAN(tx_desc_pool);
 	return QDF_STATUS_SUCCESS;
@@ -242,6 +242,33 @@ dp_tx_desc_free(struct dp_soc *soc, struct dp_tx_desc_s *tx_desc,
 	qdf_spin_unlock_bh(&pool->flow_pool_lock);
 
 }
+
+/**
+ * dp_tx_desc_free_list() - Free a chain of tx descriptors of one pool
+ * @soc: Handle to DP SoC structure
+ * @head: first descriptor of the chain
+ * @tail: last descriptor of the chain
+ * @count: number of descriptors in the chain
+ * @desc_pool_id: pool all of the descriptors belong to
+ *
+ * Flow pools pause and resume queues on every free, so the chain goes back
+ * one descriptor at a time.
+ *
+ * Return: none
+ */
+static inline void
+dp_tx_desc_free_list(struct dp_soc *soc, struct dp_tx_desc_s *head,
+		     struct dp_tx_desc_s *tail, uint16_t count,
+		     uint8_t desc_pool_id)
+{
+	struct dp_tx_desc_s *next;
+
+	while (count--) {
+		next = head->next;
+		dp_tx_desc_free(soc, head, desc_pool_id);
+		head = next;
+	}
+}
 #else /* QCA_LL_TX_FLOW_CONTROL_V2 */
 
 static inline void dp_tx_flow_control_init(struct dp_soc *handle)
@@ -264,6 +291,124 @@ static inline void dp_tx_flow_pool_unmap_handler(struct dp_pdev *pdev,
 {
 }
 
+/*
+ * Each CPU keeps a few free descriptors in front of every pool, so the
+ * transmit and completion paths take the shared pool lock once per
+ * DP_TX_DESC_CACHE_BATCH descriptors instead of once per packet.
+ */
+#define DP_TX_DESC_CACHE_BATCH	16
+#define DP_TX_DESC_CACHE_MAX	(2 * DP_TX_DESC_CACHE_BATCH)
+
+/**
+ * dp_tx_desc_pool_lock() - take the shared pool lock, counting contention
+ * @pool: Tx descriptor pool
+ *
+ * Return: none
+ */
+static inline void dp_tx_desc_pool_lock(struct dp_tx_desc_pool_s *pool)
+{
+	bool contended = !qdf_spin_trylock_bh(&pool->lock);
+
+	if (contended)
+		TX_DESC_LOCK_LOCK(&pool->lock);
+	pool->lock_contended += contended;
+}
+
+/**
+ * dp_tx_desc_cache_refill() - move a batch of free descriptors to a cache
+ * @pool: Tx descriptor pool
+ * @cache: empty CPU cache of @pool, locked by the caller
+ *
+ * Return: none
+ */
+static inline void dp_tx_desc_cache_refill(struct dp_tx_desc_pool_s *pool,
+					   struct dp_tx_desc_cache *cache)
+{
+	struct dp_tx_desc_s *head, *tail = NULL, *desc;
+	uint16_t count = 0;
+
+	dp_tx_desc_pool_lock(pool);
+	head = desc = pool->freelist;
+	while (desc && count < DP_TX_DESC_CACHE_BATCH) {
+		tail = desc;
+		desc = desc->next;
+		count++;
+	}
+	if (count) {
+		pool->freelist = desc;
+		pool->num_free -= count;
+		pool->num_allocated += count;
+		pool->cache_refills++;
+		tail->next = NULL;
+	}
+	TX_DESC_LOCK_UNLOCK(&pool->lock);
+
+	if (count) {
+		cache->freelist = head;
+		cache->count = count;
+	}
+}
+
+/**
+ * dp_tx_desc_cache_flush() - return a batch of descriptors to the pool
+ * @pool: Tx descriptor pool
+ * @cache: CPU cache of @pool holding more than a batch, locked by the caller
+ *
+ * Return: none
+ */
+static inline void dp_tx_desc_cache_flush(struct dp_tx_desc_pool_s *pool,
+					  struct dp_tx_desc_cache *cache)
+{
+	struct dp_tx_desc_s *head = cache->freelist;
+	struct dp_tx_desc_s *tail = head;
+	uint16_t count;
+
+	for (count = 1; count < DP_TX_DESC_CACHE_BATCH; count++)
+		tail = tail->next;
+	cache->freelist = tail->next;
+	cache->count -= DP_TX_DESC_CACHE_BATCH;
+
+	dp_tx_desc_pool_lock(pool);
+	tail->next = pool->freelist;
+	pool->freelist = head;
+	pool->num_free += DP_TX_DESC_CACHE_BATCH;
+	pool->num_allocated -= DP_TX_DESC_CACHE_BATCH;
+	pool->cache_flushes++;
+	TX_DESC_LOCK_UNLOCK(&pool->lock);
+}
+
+/**
+ * dp_tx_desc_cache_drain() - return every cached descriptor to the pool
+ * @soc: Handle to DP SoC structure
+ * @desc_pool_id: pool to drain
+ *
+ * Return: none
+ */
+static inline void dp_tx_desc_cache_drain(struct dp_soc *soc,
+					  uint8_t desc_pool_id)
+{
+	struct dp_tx_desc_pool_s *pool = &soc->tx_desc[desc_pool_id];
+	struct dp_tx_desc_cache *cache;
+	struct dp_tx_desc_s *desc;
+	int cpu;
+
+	for (cpu = 0; cpu < NR_CPUS; cpu++) {
+		cache = &pool->cache[cpu];
+		TX_DESC_LOCK_LOCK(&cache->lock);
+		TX_DESC_LOCK_LOCK(&pool->lock);
+		while ((desc = cache->freelist)) {
+			cache->freelist = desc->next;
+			desc->next = pool->freelist;
+			pool->freelist = desc;
+			pool->num_free++;
+			pool->num_allocated--;
+		}
+		cache->count = 0;
+		TX_DESC_LOCK_UNLOCK(&pool->lock);
+		TX_DESC_LOCK_UNLOCK(&cache->lock);
+	}
+}
+
 /**
  * dp_tx_desc_alloc() - Allocate a Software Tx Descriptor from given pool
  *
@@ -275,26 +420,29 @@ static inline void dp_tx_flow_pool_unmap_handler(struct dp_pdev *pdev,
 static inline struct dp_tx_desc_s *dp_tx_desc_alloc(struct dp_soc *soc,
 						uint8_t desc_pool_id)
 {
-	struct dp_tx_desc_s *tx_desc = NULL;
+	struct dp_tx_desc_pool_s *pool = &soc->tx_desc[desc_pool_id];
+	struct dp_tx_desc_cache *cache = &pool->cache[qdf_get_cpu()];
+	struct dp_tx_desc_s *tx_desc;
+
+	TX_DESC_LOCK_LOCK(&cache->lock);
 
-	TX_DESC_LOCK_LOCK(&soc->tx_desc[desc_pool_id].lock);
+	if (qdf_unlikely(!cache->freelist))
+		dp_tx_desc_cache_refill(pool, cache);
 
-	tx_desc = soc->tx_desc[desc_pool_id].freelist;
+	tx_desc = cache->freelist;
 
 	/* Pool is exhausted */
 	if (!tx_desc) {
-		TX_DESC_LOCK_UNLOCK(&soc->tx_desc[desc_pool_id].lock);
+		TX_DESC_LOCK_UNLOCK(&cache->lock);
 		return NULL;
 	}
 
-	soc->tx_desc[desc_pool_id].freelist =
-		soc->tx_desc[desc_pool_id].freelist->next;
-	soc->tx_desc[desc_pool_id].num_allocated++;
-	soc->tx_desc[desc_pool_id].num_free--;
+	cache->freelist = tx_desc->next;
+	cache->count--;
 
 	tx_desc->flags = DP_TX_DESC_FLAG_ALLOCATED;
 
-	TX_DESC_LOCK_UNLOCK(&soc->tx_desc[desc_pool_id].lock);
+	TX_DESC_LOCK_UNLOCK(&cache->lock);
 
 	return tx_desc;
 }
@@ -316,7 +464,7 @@ static inline struct dp_tx_desc_s *dp_tx_desc_alloc_multiple(
 	struct dp_tx_desc_s *c_desc = NULL, *h_desc = NULL;
 	uint8_t count;
 
-	TX_DESC_LOCK_LOCK(&soc->tx_desc[desc_pool_id].lock);
+	dp_tx_desc_pool_lock(&soc->tx_desc[desc_pool_id]);
 
 	if ((num_requested == 0) ||
 			(soc->tx_desc[desc_pool_id].num_free < num_requested)) {
@@ -358,16 +506,49 @@ static inline void
 dp_tx_desc_free(struct dp_soc *soc, struct dp_tx_desc_s *tx_desc,
 		uint8_t desc_pool_id)
 {
-	TX_DESC_LOCK_LOCK(&soc->tx_desc[desc_pool_id].lock);
+	struct dp_tx_desc_pool_s *pool = &soc->tx_desc[desc_pool_id];
+	struct dp_tx_desc_cache *cache = &pool->cache[qdf_get_cpu()];
+
+	TX_DESC_LOCK_LOCK(&cache->lock);
 
 	tx_desc->flags = 0;
-	tx_desc->next = soc->tx_desc[desc_pool_id].freelist;
-	soc->tx_desc[desc_pool_id].freelist = tx_desc;
-	soc->tx_desc[desc_pool_id].num_allocated--;
-	soc->tx_desc[desc_pool_id].num_free++;
+	tx_desc->next = cache->freelist;
+	cache->freelist = tx_desc;
+	if (qdf_unlikely(++cache->count > DP_TX_DESC_CACHE_MAX))
+		dp_tx_desc_cache_flush(pool, cache);
 
+	TX_DESC_LOCK_UNLOCK(&cache->lock);
+}
 
-	TX_DESC_LOCK_UNLOCK(&soc->tx_desc[desc_pool_id].lock);
+/**
+ * dp_tx_desc_free_list() - Free a chain of tx descriptors of one pool
+ * @soc: Handle to DP SoC structure
+ * @head: first descriptor of the chain
+ * @tail: last descriptor of the chain
+ * @count: number of descriptors in the chain
+ * @desc_pool_id: pool all of the descriptors belong to
+ *
+ * The caller has already cleared the descriptor flags.
+ *
+ * Return: none
+ */
+static inline void
+dp_tx_desc_free_list(struct dp_soc *soc, struct dp_tx_desc_s *head,
+		     struct dp_tx_desc_s *tail, uint16_t count,
+		     uint8_t desc_pool_id)
+{
+	struct dp_tx_desc_pool_s *pool = &soc->tx_desc[desc_pool_id];
+	struct dp_tx_desc_cache *cache = &pool->cache[qdf_get_cpu()];
+
+	TX_DESC_LOCK_LOCK(&cache->lock);
+
+	tail->next = cache->freelist;
+	cache->freelist = head;
+	cache->count += count;
+	while (cache->count > DP_TX_DESC_CACHE_MAX)
+		dp_tx_desc_cache_flush(pool, cache);
+
+	TX_DESC_LOCK_UNLOCK(&cache->lock);
 }
 #endif /* QCA_LL_TX_FLOW_CONTROL_V2 */
 
@@ -207,6 +207,26 @@ enum dp_nss_cfg {
 	dp_nss_cfg_dbdc,
 };
 
+/**
+ * struct dp_rx_buf_pool - recycled RX buffers, kept DMA mapped
+ * @bufs: mapped nbufs ready to be given to the rxdma ring
+ * @lock: Protection for @bufs
+ * @max_bufs: most buffers the pool holds, 0 when the pool is unused
+ * @hits: replenished buffers taken from the pool
+ * @misses: replenished buffers that had to be allocated
+ * @recycled: freed RX buffers taken back into the pool
+ * @released: freed RX buffers that could not be recycled
+ */
+struct dp_rx_buf_pool {
+	qdf_nbuf_queue_t bufs;
+	qdf_spinlock_t lock;
+	uint32_t max_bufs;
+	uint32_t hits;
+	uint32_t misses;
+	uint32_t recycled;
+	uint32_t released;
+};
+
 /**
  * struct rx_desc_pool
  * @pool_size: number of RX descriptor in the pool
@@ -214,6 +234,7 @@ enum dp_nss_cfg {
  * @freelist: pointer to free RX descriptor link list
  * @lock: Protection for the RX descriptor pool
  * @owner: owner for nbuf
+ * @buf_pool: recycled buffers for the ring this pool refills
  */
 struct rx_desc_pool {
 	uint32_t pool_size;
@@ -221,6 +242,7 @@ struct rx_desc_pool {
 	union dp_rx_desc_list_elem_t *freelist;
 	qdf_spinlock_t lock;
 	uint8_t owner;
+	struct dp_rx_buf_pool buf_pool;
 };
 
 /**
@@ -343,18 +365,36 @@ struct dp_tx_tso_num_seg_pool_s {
 	qdf_spinlock_t lock;
 };
 
+/**
+ * struct dp_tx_desc_cache - free Tx descriptors one CPU keeps for a pool
+ * @freelist: Chain of cached free descriptors
+ * @count: Number of descriptors in @freelist
+ * @lock: Serializes the CPU's transmit and completion contexts; only
+ *	  contended when a sender migrates between CPUs
+ */
+struct dp_tx_desc_cache {
+	struct dp_tx_desc_s *freelist;
+	uint16_t count;
+	qdf_spinlock_t lock;
+} __attribute__((aligned(qdf_cache_line_sz)));
+
 /**
  * struct dp_tx_desc_pool_s - Tx Descriptor pool information
  * @elem_size: Size of each descriptor in the pool
  * @pool_size: Total number of descriptors in the pool
- * @num_free: Number of free descriptors
- * @num_allocated: Number of used descriptors
+ * @num_free: Number of free descriptors in the pool freelist
+ * @num_allocated: Number of descriptors taken from the pool freelist,
+ *		   including those sitting in the per CPU caches
  * @freelist: Chain of free descriptors
  * @desc_pages: multiple page allocation information for actual descriptors
  * @num_invalid_bin: Deleted pool with pending Tx completions.
  * @flow_pool_array_lock: Lock when operating on flow_pool_array.
  * @flow_pool_array: List of allocated flow pools
  * @lock- Lock for descriptor allocation/free from/to the pool
+ * @cache: Per CPU caches of free descriptors in front of @freelist
+ * @lock_contended: Times @lock was found held by another CPU
+ * @cache_refills: Batches moved from @freelist to a CPU cache
+ * @cache_flushes: Batches returned from a CPU cache to @freelist
  */
 struct dp_tx_desc_pool_s {
 	uint16_t elem_size;
@@ -378,6 +418,10 @@ struct dp_tx_desc_pool_s {
 	uint16_t elem_count;
 	uint32_t num_free;
 	qdf_spinlock_t lock;
+	struct dp_tx_desc_cache cache[NR_CPUS];
+	uint32_t lock_contended;
+	uint32_t cache_refills;
+	uint32_t cache_flushes;
 #endif
 };
 
@@ -27,6 +27,7 @@ extern "C" {
 #include <qdf_status.h>
 #include "qdf_nbuf.h"
 #include "qdf_lro.h"
+#include "qdf_defer.h"
 #include "ol_if_athvar.h"
 #include <linux/platform_device.h>
 #ifdef HIF_PCI
@@ -183,6 +184,7 @@ struct qca_napi_info {
 	int                  irq;
 	cpumask_t            cpumask;
 	struct qca_napi_stat stats[NR_CPUS];
+	uint32_t             rx_pkts; /* polled msgs, sampled by placement */
 #ifdef RECEIVE_OFFLOAD
 	/* will only be present for data rx CE's */
 	void (*offld_flush_cb)(void *);
@@ -233,6 +235,72 @@ struct qca_napi_cpu {
 	int			cluster_nxt;  /* index, not pointer */
 };
 
+#define QCA_NAPI_PLACE_TRACE_SIZE	16
+#define QCA_NAPI_PLACE_HIST_BUCKETS	5
+
+enum qca_napi_place_action {
+	QCA_NAPI_PLACE_MIGRATE,
+	QCA_NAPI_PLACE_RATE_LIMITED
+};
+
+/**
+ * struct qca_napi_place_trace - one decision of the placement engine
+ * @ts:        time of the decision, in ms
+ * @rate:      EWMA rx rate over all NAPI CEs, in msgs per 100ms
+ * @predicted: rate extrapolated from the current trend
+ * @freq_pct:  current cpufreq of the polling CPU, in % of its max
+ * @cpu:       CPU the decision was taken on
+ * @from:      throughput mode before the decision
+ * @to:        throughput mode asked for
+ * @action:    enum qca_napi_place_action
+ */
+struct qca_napi_place_trace {
+	uint32_t ts;
+	uint32_t rate;
+	uint32_t predicted;
+	uint16_t freq_pct;
+	uint8_t  cpu;
+	uint8_t  from;
+	uint8_t  to;
+	uint8_t  action;
+};
+
+/**
+ * struct qca_napi_placement - rate driven NAPI placement state
+ * @lock:           serializes window evaluation between the NAPI polls
+ * @work:           posts the throughput mode change in process context
+ * @inited:         engine is running
+ * @hold:           NAPIs are serialized by the user, leave them alone
+ * @target:         throughput mode to post from @work
+ * @window_start:   start of the current sampling window, in ms
+ * @last_pkts:      per CE rx_pkts snapshot at @window_start
+ * @ce_rate:        per CE EWMA rx rate, in msgs per 100ms
+ * @rate:           sum of @ce_rate at the last evaluation
+ * @last_migration: time of the last throughput mode change, in ms
+ * @migrations:     number of throughput mode changes
+ * @rate_limited:   changes deferred for being too close to the last one
+ * @migration_hist: histogram of the interval between mode changes
+ * @trace:          ring of the last decisions
+ * @trace_idx:      next slot in @trace
+ */
+struct qca_napi_placement {
+	qdf_spinlock_t   lock;
+	qdf_work_t       work;
+	bool             inited;
+	bool             hold;
+	enum qca_napi_tput_state target;
+	uint32_t         window_start;
+	uint32_t         last_pkts[CE_COUNT_MAX];
+	uint32_t         ce_rate[CE_COUNT_MAX];
+	uint32_t         rate;
+	uint32_t         last_migration;
+	uint32_t         migrations;
+	uint32_t         rate_limited;
+	uint32_t         migration_hist[QCA_NAPI_PLACE_HIST_BUCKETS];
+	struct qca_napi_place_trace trace[QCA_NAPI_PLACE_TRACE_SIZE];
+	uint32_t         trace_idx;
+};
+
 /**
  * struct qca_napi_data - collection of napi data for a single hif context
  * @hif_softc: pointer to the hif context
@@ -246,6 +314,7 @@ struct qca_napi_cpu {
  * @bigcl_head:
  * @napi_mode: irq affinity & clock voting mode
  * @cpuhp_handler: CPU hotplug event registration handle
+ * @place: rate driven placement engine state
  */
 struct qca_napi_data {
 	struct               hif_softc *hif_softc;
@@ -264,6 +333,7 @@ struct qca_napi_data {
 	enum qca_napi_tput_state napi_mode;
 	struct qdf_cpuhp_handler *cpuhp_handler;
 	uint8_t              flags;
+	struct qca_napi_placement place;
 };
 
 /**
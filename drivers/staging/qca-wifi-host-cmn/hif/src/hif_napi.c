@@ -31,6 +31,7 @@
 #include <linux/topology.h>
 #include <linux/interrupt.h>
 #include <linux/irq.h>
+#include <linux/math64.h>
 #ifdef CONFIG_SCHED_CORE_CTL
 #include <linux/sched/core_ctl.h>
 #endif
@@ -457,6 +458,36 @@ struct qca_napi_info *hif_get_napi(int napi_id, struct qca_napi_data *napid)
 	return napid->napis[id];
 }
 
+/**
+ * hnc_place_note_migration() - account a throughput mode change
+ * @napid: pointer to NAPI data
+ *
+ * Called with napid->lock held whenever napi_mode changes, whether the
+ * change came from hdd or from the placement engine, so the engine's rate
+ * limit covers both.
+ *
+ * Return: None
+ */
+static void hnc_place_note_migration(struct qca_napi_data *napid)
+{
+	static const uint32_t hist_ms[QCA_NAPI_PLACE_HIST_BUCKETS - 1] = {
+		250, 1000, 5000, 30000
+	};
+	struct qca_napi_placement *place = &napid->place;
+	uint32_t now = qdf_system_ticks_to_msecs(qdf_system_ticks());
+	uint32_t interval = now - place->last_migration;
+	int bucket;
+
+	for (bucket = 0; bucket < QCA_NAPI_PLACE_HIST_BUCKETS - 1; bucket++)
+		if (interval < hist_ms[bucket])
+			break;
+
+	if (place->migrations)
+		place->migration_hist[bucket]++;
+	place->migrations++;
+	place->last_migration = now;
+}
+
 /**
  *
  * hif_napi_event() - reacts to events that impact NAPI
@@ -610,6 +641,8 @@ int hif_napi_event(struct hif_opaque_softc *hif_ctx, enum qca_napi_event event,
 
 			blacklist_pending = BLACKLIST_ON_PENDING;
 		}
+		if (tput_mode != napid->napi_mode)
+			hnc_place_note_migration(napid);
 		napid->napi_mode = tput_mode;
 		break;
 	}
@@ -620,6 +653,7 @@ int hif_napi_event(struct hif_opaque_softc *hif_ctx, enum qca_napi_event event,
 		NAPI_DEBUG("%s: User forced SERIALIZATION; users=%ld",
 			   __func__, users);
 
+		napid->place.hold = true;
 		rc = hif_napi_cpu_migrate(napid,
 					  HNC_ANY_CPU,
 					  HNC_ACT_COLLAPSE);
@@ -629,6 +663,7 @@ int hif_napi_event(struct hif_opaque_softc *hif_ctx, enum qca_napi_event event,
 	}
 	case NAPI_EVT_USR_NORMAL: {
 		NAPI_DEBUG("%s: User forced DE-SERIALIZATION", __func__);
+		napid->place.hold = false;
 		if (!napid->user_cpu_affin_mask)
 			blacklist_pending = BLACKLIST_OFF_PENDING;
 		/*
@@ -910,6 +945,7 @@ int hif_napi_poll(struct hif_opaque_softc *hif_ctx,
 				bucket, QCA_NAPI_NUM_BUCKETS);
 		}
 		napi_info->stats[cpu].napi_budget_uses[bucket]++;
+		hif_napi_place_sample(&hif->napi_data, napi_info, rc);
 	} else {
 	/* if ce_per engine reports 0, then poll should be terminated */
 		NAPI_DEBUG("%s:%d: nothing processed by CE. Completing NAPI",
@@ -1039,6 +1075,210 @@ void hif_napi_update_yield_stats(struct CE_state *ce_state,
 				      cpu_id);
 }
 
+/**
+ * hnc_place_work() - posts the throughput mode picked by the placement engine
+ * @arg: pointer to NAPI data
+ *
+ * Migration and blacklisting go through hif_napi_event(), exactly as for a
+ * throughput change detected by hdd, but need process context.
+ *
+ * Return: None
+ */
+static void hnc_place_work(void *arg)
+{
+	struct qca_napi_data *napid = arg;
+	struct hif_softc *hif = container_of(napid, struct hif_softc,
+					     napi_data);
+
+	hif_napi_event(GET_HIF_OPAQUE_HDL(hif), NAPI_EVT_TPUT_STATE,
+		       (void *)(unsigned long)napid->place.target);
+}
+
+static void hnc_place_trace(struct qca_napi_placement *place, uint32_t now,
+			    uint32_t predicted, uint32_t freq_pct, int cpu,
+			    enum qca_napi_tput_state from,
+			    enum qca_napi_tput_state to,
+			    enum qca_napi_place_action action)
+{
+	struct qca_napi_place_trace *t;
+
+	t = &place->trace[place->trace_idx++ % QCA_NAPI_PLACE_TRACE_SIZE];
+	t->ts = now;
+	t->rate = place->rate;
+	t->predicted = predicted;
+	t->freq_pct = freq_pct;
+	t->cpu = cpu;
+	t->from = from;
+	t->to = to;
+	t->action = action;
+
+	HIF_DBG("%s: rate %u pred %u freq %u%% cpu %d: %d -> %d (%s)",
+		__func__, place->rate, predicted, freq_pct, cpu, from, to,
+		action == QCA_NAPI_PLACE_MIGRATE ? "migrate" : "rate limited");
+}
+
+/**
+ * hnc_place_evaluate() - close a sampling window and pick a throughput mode
+ * @napid: pointer to NAPI data
+ * @now: current time, in ms
+ * @elapsed: length of the window, in ms
+ *
+ * Folds the rx rate of every NAPI CE over the window into its EWMA and
+ * extrapolates the summed rate HNC_PLACE_LOOKAHEAD windows ahead while it
+ * is rising, so a burst moves to the big cluster before the 100ms bus
+ * bandwidth timer would notice it. A polling CPU already close to its max
+ * frequency halves the threshold, since it will not keep up for long.
+ * Dropping back needs the plain rate to fall below HNC_PLACE_LO_THRESH.
+ *
+ * Called with place->lock held.
+ *
+ * Return: None
+ */
+static void hnc_place_evaluate(struct qca_napi_data *napid, uint32_t now,
+			       uint32_t elapsed)
+{
+	struct qca_napi_placement *place = &napid->place;
+	enum qca_napi_tput_state mode = napid->napi_mode;
+	enum qca_napi_tput_state target = mode;
+	struct qca_napi_info *napii;
+	uint32_t pkts, sample, rate = 0, predicted, hi_thresh;
+	uint32_t cur_freq, max_freq, freq_pct = 0;
+	int cpu = smp_processor_id();
+	int i;
+
+	for (i = 0; i < CE_COUNT_MAX; i++) {
+		napii = napid->napis[i];
+		if (!napii)
+			continue;
+
+		pkts = READ_ONCE(napii->rx_pkts);
+		sample = div_u64((uint64_t)(pkts - place->last_pkts[i]) * 100,
+				 elapsed);
+		place->last_pkts[i] = pkts;
+		place->ce_rate[i] = (place->ce_rate[i] *
+				     ((1 << HNC_PLACE_EWMA_SHIFT) - 1) +
+				     sample) >> HNC_PLACE_EWMA_SHIFT;
+		rate += place->ce_rate[i];
+	}
+	place->window_start = now;
+
+	predicted = rate;
+	if (rate > place->rate)
+		predicted += (rate - place->rate) * HNC_PLACE_LOOKAHEAD;
+	place->rate = rate;
+
+	if (place->hold || mode == QCA_NAPI_TPUT_UNINITIALIZED)
+		return;
+
+	hi_thresh = HNC_PLACE_HI_THRESH;
+	max_freq = napid->napi_cpu[cpu].max_freq;
+	if (max_freq) {
+		cur_freq = cpufreq_quick_get(cpu);
+		freq_pct = cur_freq * 100 / max_freq;
+		if (freq_pct >= HNC_PLACE_FREQ_SAT_PCT)
+			hi_thresh /= 2;
+	}
+
+	if (mode == QCA_NAPI_TPUT_LO && predicted >= hi_thresh)
+		target = QCA_NAPI_TPUT_HI;
+	else if (mode == QCA_NAPI_TPUT_HI && rate < HNC_PLACE_LO_THRESH)
+		target = QCA_NAPI_TPUT_LO;
+
+	if (target == mode)
+		return;
+
+	if (now - place->last_migration < HNC_PLACE_MIN_INTERVAL_MS) {
+		place->rate_limited++;
+		hnc_place_trace(place, now, predicted, freq_pct, cpu, mode,
+				target, QCA_NAPI_PLACE_RATE_LIMITED);
+		return;
+	}
+
+	hnc_place_trace(place, now, predicted, freq_pct, cpu, mode, target,
+			QCA_NAPI_PLACE_MIGRATE);
+	place->target = target;
+	qdf_sched_work(0, &place->work);
+}
+
+/**
+ * hif_napi_place_sample() - feed the work of a NAPI poll to the placement
+ * @napid: pointer to NAPI data
+ * @napii: NAPI instance that polled
+ * @work_done: messages processed by the poll
+ *
+ * Called from hif_napi_poll(). Whichever poll first finds the sampling
+ * window expired evaluates it; the others only count their work.
+ *
+ * Return: None
+ */
+void hif_napi_place_sample(struct qca_napi_data *napid,
+			   struct qca_napi_info *napii, int work_done)
+{
+	struct qca_napi_placement *place = &napid->place;
+	uint32_t now;
+
+	napii->rx_pkts += work_done;
+	if (!place->inited)
+		return;
+
+	now = qdf_system_ticks_to_msecs(qdf_system_ticks());
+	if (now - READ_ONCE(place->window_start) < HNC_PLACE_WINDOW_MS)
+		return;
+
+	if (!qdf_spin_trylock_bh(&place->lock))
+		return;
+	if (now - place->window_start >= HNC_PLACE_WINDOW_MS)
+		hnc_place_evaluate(napid, now, now - place->window_start);
+	qdf_spin_unlock_bh(&place->lock);
+}
+
+static void hnc_place_init(struct qca_napi_data *napid)
+{
+	struct qca_napi_placement *place = &napid->place;
+
+	qdf_spinlock_create(&place->lock);
+	qdf_create_work(0, &place->work, hnc_place_work, napid);
+	place->window_start = qdf_system_ticks_to_msecs(qdf_system_ticks());
+	place->inited = true;
+}
+
+static void hnc_place_deinit(struct qca_napi_data *napid)
+{
+	struct qca_napi_placement *place = &napid->place;
+
+	if (!place->inited)
+		return;
+
+	place->inited = false;
+	qdf_cancel_work(&place->work);
+	qdf_spinlock_destroy(&place->lock);
+}
+
+static void hnc_place_stats(struct qca_napi_data *napid)
+{
+	struct qca_napi_placement *place = &napid->place;
+	struct qca_napi_place_trace *t;
+	uint32_t i, n;
+
+	qdf_debug("NAPI PLACEMENT: rate=%u mode=%d hold=%d migrations=%u rate_limited=%u",
+		  place->rate, napid->napi_mode, place->hold,
+		  place->migrations, place->rate_limited);
+	qdf_debug("migration interval <250ms:%u <1s:%u <5s:%u <30s:%u >=30s:%u",
+		  place->migration_hist[0], place->migration_hist[1],
+		  place->migration_hist[2], place->migration_hist[3],
+		  place->migration_hist[4]);
+
+	n = min_t(uint32_t, place->trace_idx, QCA_NAPI_PLACE_TRACE_SIZE);
+	for (i = place->trace_idx - n; i != place->trace_idx; i++) {
+		t = &place->trace[i % QCA_NAPI_PLACE_TRACE_SIZE];
+		qdf_debug("  [%u] rate=%u pred=%u freq=%u%% cpu=%u %u->%u %s",
+			  t->ts, t->rate, t->predicted, t->freq_pct, t->cpu,
+			  t->from, t->to,
+			  t->action == QCA_NAPI_PLACE_MIGRATE ?
+			  "migrate" : "rate limited");
+	}
+}
+
 /**
  *
  * hif_napi_stats() - display NAPI CPU statistics
@@ -1073,6 +1313,7 @@ void hif_napi_stats(struct qca_napi_data *napid)
 			  cpu[i].max_freq, cpu[i].napis,
 			  cpu[i].cluster_nxt);
 	}
+	hnc_place_stats(napid);
 }
 
 #ifdef FEATURE_NAPI_DEBUG
@@ -1379,8 +1620,10 @@ int hif_napi_cpu_init(struct hif_opaque_softc *hif)
 
 	/* install throughput notifier */
 	rc = hnc_tput_hook(1);
-	if (0 == rc)
+	if (0 == rc) {
+		hnc_place_init(napid);
 		goto lab_rss_init;
+	}
 
 lab_err_hotplug:
 	hnc_tput_hook(0);
@@ -1409,6 +1652,7 @@ int hif_napi_cpu_deinit(struct hif_opaque_softc *hif)
 
 	/* uninstall tput notifier */
 	rc = hnc_tput_hook(0);
+	hnc_place_deinit(napid);
 
 	/* uninstall hotplug notifier */
 	hnc_hotplug_unregister(HIF_GET_SOFTC(hif));
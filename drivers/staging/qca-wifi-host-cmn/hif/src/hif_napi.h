@@ -184,6 +184,18 @@ int hif_napi_poll(struct hif_opaque_softc *hif_ctx,
 #define HNC_ACT_COLLAPSE (1)
 #define HNC_ACT_DISPERSE (-1)
 
+/*
+ * Placement engine tunables. Rates are in rx msgs per 100ms, the unit
+ * of the bus bandwidth timer that drives NAPI_EVT_TPUT_STATE from hdd.
+ */
+#define HNC_PLACE_WINDOW_MS		20
+#define HNC_PLACE_EWMA_SHIFT		2
+#define HNC_PLACE_LOOKAHEAD		4
+#define HNC_PLACE_HI_THRESH		500
+#define HNC_PLACE_LO_THRESH		250
+#define HNC_PLACE_FREQ_SAT_PCT		90
+#define HNC_PLACE_MIN_INTERVAL_MS	200
+
 /**
  * hif_update_napi_max_poll_time() - updates NAPI max poll time
  * @ce_state: ce state
@@ -288,6 +300,8 @@ void hif_napi_stats(struct qca_napi_data *napid);
 void hif_napi_update_yield_stats(struct CE_state *ce_state,
 				 bool time_limit_reached,
 				 bool rxpkt_thresh_reached);
+void hif_napi_place_sample(struct qca_napi_data *napid,
+			   struct qca_napi_info *napii, int work_done);
 #else
 struct qca_napi_data;
 static inline int hif_napi_cpu_init(struct hif_opaque_softc *hif)
@@ -307,6 +321,9 @@ static inline void hif_napi_stats(struct qca_napi_data *napid) { }
 static inline void hif_napi_update_yield_stats(struct CE_state *ce_state,
 					       bool time_limit_reached,
 					       bool rxpkt_thresh_reached) { }
+static inline void hif_napi_place_sample(struct qca_napi_data *napid,
+					 struct qca_napi_info *napii,
+					 int work_done) { }
 
 static inline int hif_napi_cpu_blacklist(struct qca_napi_data *napid,
 			   enum qca_blacklist_op op)
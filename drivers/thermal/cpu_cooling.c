@@ -470,6 +470,43 @@ static int build_dyn_power_table(struct cpufreq_cooling_device *cpufreq_device,
 	return ret;
 }
 
+/**
+ * update_dyn_power_table() - recompute the powers of the dynamic power table
+ * @cpufreq_device:	the cpufreq cooling device whose table is updated
+ * @capacitance: new dynamic power coefficient for these cpus
+ *
+ * The table is updated in place, as the power callbacks read it without
+ * holding any lock.
+ */
+static void update_dyn_power_table(struct cpufreq_cooling_device *cpufreq_device,
+				   u32 capacitance)
+{
+	struct power_table *pt = cpufreq_device->dyn_power_table;
+	struct dev_pm_opp *opp;
+	int i;
+
+	rcu_read_lock();
+
+	for (i = 0; i < cpufreq_device->dyn_power_table_entries; i++) {
+		u32 freq_mhz, voltage_mv;
+		u64 power;
+
+		opp = dev_pm_opp_find_freq_exact(cpufreq_device->cpu_dev,
+					pt[i].frequency * 1000UL, true);
+		if (IS_ERR(opp))
+			continue;
+
+		freq_mhz = pt[i].frequency / 1000;
+		voltage_mv = dev_pm_opp_get_voltage(opp) / 1000;
+
+		power = (u64)capacitance * freq_mhz * voltage_mv * voltage_mv;
+		do_div(power, 1000000000);
+		WRITE_ONCE(pt[i].power, power);
+	}
+
+	rcu_read_unlock();
+}
+
 static u32 cpu_freq_to_power(struct cpufreq_cooling_device *cpufreq_device,
 			     u32 freq)
 {
@@ -994,6 +1031,8 @@ static struct thermal_cooling_device_ops cpufreq_power_cooling_ops = {
 	.get_max_state		= cpufreq_get_max_state,
 	.get_cur_state		= cpufreq_get_cur_state,
 	.set_cur_state		= cpufreq_set_cur_state,
+	.set_min_state		= cpufreq_set_min_state,
+	.get_min_state		= cpufreq_get_min_state,
 	.get_requested_power	= cpufreq_get_requested_power,
 	.state2power		= cpufreq_state2power,
 	.power2state		= cpufreq_power2state,
@@ -1338,6 +1377,52 @@ of_cpufreq_power_cooling_register(struct device_node *np,
 }
 EXPORT_SYMBOL(of_cpufreq_power_cooling_register);
 
+/**
+ * cpufreq_cooling_set_capacitance() - update the power model of a cpu
+ * @cpu:	cpu whose cooling devices take the new coefficient
+ * @capacitance:	dynamic power coefficient for @cpu
+ *
+ * Recompute the dynamic power table of every cpufreq cooling device
+ * covering @cpu. Devices registered without a coefficient, because the
+ * platform had none to offer, get a power table and the power extensions,
+ * so that power allocating governors can start using them.
+ *
+ * Return: 0 on success, -ENODEV if no cooling device covers @cpu or the
+ * error from building the power table.
+ */
+int cpufreq_cooling_set_capacitance(unsigned int cpu, u32 capacitance)
+{
+	struct cpufreq_cooling_device *cpufreq_dev;
+	int ret = -ENODEV;
+
+	if (!capacitance)
+		return -EINVAL;
+
+	mutex_lock(&cooling_list_lock);
+	list_for_each_entry(cpufreq_dev, &cpufreq_dev_list, node) {
+		if (!cpumask_test_cpu(cpu, &cpufreq_dev->allowed_cpus))
+			continue;
+
+		if (cpufreq_dev->dyn_power_table) {
+			update_dyn_power_table(cpufreq_dev, capacitance);
+			ret = 0;
+			continue;
+		}
+
+		ret = build_dyn_power_table(cpufreq_dev, capacitance);
+		if (ret)
+			break;
+
+		/* Publish the table before the ops that read it */
+		smp_wmb();
+		cpufreq_dev->cool_dev->ops = &cpufreq_power_cooling_ops;
+	}
+	mutex_unlock(&cooling_list_lock);
+
+	return ret;
+}
+EXPORT_SYMBOL(cpufreq_cooling_set_capacitance);
+
 /**
  * cpufreq_cooling_unregister - function to remove cpufreq cooling device.
  * @cdev: thermal cooling device pointer.
@@ -21,10 +21,14 @@
 #include <linux/slab.h>
 #include <linux/thermal.h>
 #include "tsens.h"
+#include "thermal_core.h"
 #include "qcom/qti_virtual_sensor.h"
 
 LIST_HEAD(tsens_device_list);
 
+static bool irq_mode = true;
+module_param(irq_mode, bool, 0444);
+
 static int tsens_get_temp(void *data, int *temp)
 {
 	struct tsens_sensor *s = data;
@@ -218,6 +222,33 @@ static int tsens_thermal_zone_register(struct tsens_device *tmdev)
 	return 0;
 }
 
+/*
+ * The thermal core reprograms the upper and lower thresholds around the
+ * current temperature through set_trips, and the threshold interrupts
+ * notify the zones, so polling the sensors is not needed any more. Zones
+ * keep polling if the controller can't interrupt.
+ */
+static void tsens_thermal_zone_irq_mode(struct tsens_device *tmdev)
+{
+	struct tsens_sensor *s;
+	int i;
+
+	if (!irq_mode || !tmdev->ops->set_trips || !tmdev->ops->interrupts_reg)
+		return;
+
+	tmdev->tsens_dbg.irq_mode_start = ktime_get();
+	for (i = 0; i < TSENS_MAX_SENSORS; i++) {
+		s = &tmdev->sensor[i];
+		if (IS_ERR_OR_NULL(s->tzd))
+			continue;
+		tmdev->tsens_dbg.sensor_dbg_info[s->hw_id].poll_ms =
+			of_thermal_set_irq_mode(s->tzd, true);
+	}
+
+	if (tsens_dbg_poll_stats_init(tmdev))
+		pr_debug("Unable to create poll stats\n");
+}
+
 static int tsens_tm_remove(struct platform_device *pdev)
 {
 	struct tsens_device *tmdev = platform_get_drvdata(pdev);
@@ -269,6 +300,8 @@ int tsens_tm_probe(struct platform_device *pdev)
 		return rc;
 	}
 
+	tsens_thermal_zone_irq_mode(tmdev);
+
 	list_add_tail(&tmdev->list, &tsens_device_list);
 	platform_set_drvdata(pdev, tmdev);
 
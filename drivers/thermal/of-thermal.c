@@ -64,6 +64,7 @@ struct __thermal_bind_params {
  * @trip_low: last trip low value programmed in the sensor driver
  * @lock: mutex lock acquired before updating the trip temperatures
  * @first_tz: list head pointing the first thermal zone
+ * @irq_mode: sensor interrupts on leaving the set_trips window, don't poll
  */
 struct __sensor_param {
 	void *sensor_data;
@@ -71,6 +72,7 @@ struct __sensor_param {
 	int trip_high, trip_low;
 	struct mutex lock;
 	struct list_head first_tz;
+	bool irq_mode;
 };
 
 /**
@@ -399,7 +401,8 @@ static int of_thermal_set_mode(struct thermal_zone_device *tz,
 	mutex_lock(&tz->lock);
 
 	if (mode == THERMAL_DEVICE_ENABLED) {
-		tz->polling_delay = data->polling_delay;
+		tz->polling_delay = data->senps->irq_mode ? 0 :
+					data->polling_delay;
 		tz->passive_delay = data->passive_delay;
 	} else {
 		tz->polling_delay = 0;
@@ -633,6 +636,43 @@ void of_thermal_handle_trip(struct thermal_zone_device *tz)
 }
 EXPORT_SYMBOL(of_thermal_handle_trip);
 
+/*
+ * of_thermal_set_irq_mode - Stop or restart polling the zones of a sensor
+ *
+ * @tz: pointer to the primary thermal zone.
+ * @irq_mode: true if the sensor raises an interrupt whenever the window
+ *	      programmed through set_trips is left, so the zones need no
+ *	      polling. Passive polling during mitigation is not affected.
+ *
+ * Return: the shortest polling delay in ms of the sensor's zones, 0 if none
+ * of them polls.
+ */
+int of_thermal_set_irq_mode(struct thermal_zone_device *tz, bool irq_mode)
+{
+	struct thermal_zone_device *zone;
+	struct __thermal_zone *data = tz->devdata;
+	struct __sensor_param *senps = data->senps;
+	int delay = 0;
+
+	senps->irq_mode = irq_mode;
+	list_for_each_entry(data, &senps->first_tz, list) {
+		zone = data->tzd;
+		if (data->polling_delay &&
+		    (!delay || data->polling_delay < delay))
+			delay = data->polling_delay;
+		if (data->mode == THERMAL_DEVICE_DISABLED)
+			continue;
+
+		mutex_lock(&zone->lock);
+		zone->polling_delay = irq_mode ? 0 : data->polling_delay;
+		mutex_unlock(&zone->lock);
+		thermal_zone_device_update(zone, THERMAL_EVENT_UNSPECIFIED);
+	}
+
+	return delay;
+}
+EXPORT_SYMBOL(of_thermal_set_irq_mode);
+
 static struct thermal_zone_device_ops of_thermal_ops = {
 	.get_mode = of_thermal_get_mode,
 	.set_mode = of_thermal_set_mode,
@@ -24,9 +24,11 @@
 #include <linux/interrupt.h>
 #include <linux/timer.h>
 #include <linux/pm_opp.h>
+#include <linux/cpufreq.h>
 #include <linux/cpu_cooling.h>
 #include <linux/atomic.h>
 #include <linux/regulator/consumer.h>
+#include <linux/ktime.h>
 
 #include <asm/smp_plat.h>
 #include <asm/cacheflush.h>
@@ -89,6 +91,16 @@ struct __limits_cdev_data {
 	u32 min_freq;
 };
 
+struct limits_dcvs_stats {
+	ktime_t last_update;
+	u64 throttle_us;
+	/* Sum of frequency lost to throttling over time, in kHz * us */
+	u64 freq_loss;
+	u32 throttle_count;
+	u32 policy_updates;
+	u32 coalesced;
+};
+
 struct limits_dcvs_hw {
 	char sensor_name[THERMAL_NAME_LENGTH];
 	uint32_t affinity;
@@ -103,6 +115,11 @@ struct limits_dcvs_hw {
 	unsigned long min_freq;
 	unsigned long hw_freq_limit;
 	struct device_attribute lmh_freq_attr;
+	struct device_attribute lmh_stats_attr;
+	struct notifier_block policy_nb;
+	struct delayed_work policy_work;
+	unsigned long policy_update_ts;
+	struct limits_dcvs_stats stats;
 	struct list_head list;
 	bool is_irq_enabled;
 	struct mutex access_lock;
@@ -113,6 +130,12 @@ struct limits_dcvs_hw {
 LIST_HEAD(lmh_dcvs_hw_list);
 DEFINE_MUTEX(lmh_dcvs_list_access);
 
+/* Minimum interval between two cpufreq policy updates for a cluster */
+static unsigned int policy_update_ms = LIMITS_POLLING_DELAY_MS;
+module_param(policy_update_ms, uint, 0644);
+MODULE_PARM_DESC(policy_update_ms,
+		 "Rate limit for propagating LMH limits to cpufreq, in ms");
+
 static int limits_dcvs_get_freq_limits(uint32_t cpu, unsigned long *max_freq,
 					 unsigned long *min_freq)
 {
@@ -137,6 +160,78 @@ static int limits_dcvs_get_freq_limits(uint32_t cpu, unsigned long *max_freq,
 	return ret;
 }
 
+/*
+ * Re-evaluating the policy lets the notifier below clamp policy->max to
+ * the hardware limit, which also scales the max frequency capacity seen
+ * by the scheduler, so governors stop asking for frequencies the cluster
+ * cannot run at and task placement sees the reduced capacity.
+ */
+static void limits_dcvs_policy_work(struct work_struct *work)
+{
+	struct limits_dcvs_hw *hw = container_of(work,
+					struct limits_dcvs_hw,
+					policy_work.work);
+	cpumask_t online;
+
+	hw->policy_update_ts = jiffies;
+	cpumask_and(&online, &hw->core_map, cpu_online_mask);
+	if (cpumask_empty(&online))
+		return;
+
+	cpufreq_update_policy(cpumask_first(&online));
+}
+
+static int limits_dcvs_policy_notify(struct notifier_block *nb,
+				     unsigned long val, void *data)
+{
+	struct limits_dcvs_hw *hw = container_of(nb, struct limits_dcvs_hw,
+						 policy_nb);
+	struct cpufreq_policy *policy = data;
+	unsigned long limit = READ_ONCE(hw->hw_freq_limit);
+
+	if (val != CPUFREQ_ADJUST ||
+	    !cpumask_intersects(policy->related_cpus, &hw->core_map))
+		return NOTIFY_DONE;
+
+	if (limit && limit < policy->max)
+		cpufreq_verify_within_limits(policy, 0, limit);
+
+	return NOTIFY_OK;
+}
+
+static void limits_dcvs_queue_policy_update(struct limits_dcvs_hw *hw)
+{
+	unsigned long next = hw->policy_update_ts +
+				msecs_to_jiffies(policy_update_ms);
+	unsigned long delay = 0;
+
+	if (time_before(jiffies, next))
+		delay = next - jiffies;
+
+	/* A pending update reads the latest limit when it runs */
+	if (queue_delayed_work(system_highpri_wq, &hw->policy_work, delay))
+		hw->stats.policy_updates++;
+	else
+		hw->stats.coalesced++;
+}
+
+static void limits_dcvs_account(struct limits_dcvs_hw *hw,
+				 unsigned long new_limit)
+{
+	struct limits_dcvs_stats *st = &hw->stats;
+	ktime_t now = ktime_get();
+	u64 delta_us = ktime_us_delta(now, st->last_update);
+
+	if (hw->hw_freq_limit < hw->max_freq) {
+		st->throttle_us += delta_us;
+		st->freq_loss += (u64)(hw->max_freq - hw->hw_freq_limit) *
+					delta_us;
+	} else if (new_limit < hw->max_freq) {
+		st->throttle_count++;
+	}
+	st->last_update = now;
+}
+
 static unsigned long limits_mitigation_notify(struct limits_dcvs_hw *hw)
 {
 	uint32_t val = 0;
@@ -180,7 +275,11 @@ static unsigned long limits_mitigation_notify(struct limits_dcvs_hw *hw)
 	trace_lmh_dcvs_freq(cpumask_first(&hw->core_map), max_limit);
 
 notify_exit:
-	hw->hw_freq_limit = max_limit;
+	limits_dcvs_account(hw, max_limit);
+	if (max_limit != hw->hw_freq_limit) {
+		WRITE_ONCE(hw->hw_freq_limit, max_limit);
+		limits_dcvs_queue_policy_update(hw);
+	}
 	return max_limit;
 }
 
@@ -505,6 +604,30 @@ lmh_freq_limit_show(struct device *dev, struct device_attribute *devattr,
 	return snprintf(buf, PAGE_SIZE, "%lu\n", hw->hw_freq_limit);
 }
 
+static ssize_t
+lmh_stats_show(struct device *dev, struct device_attribute *devattr,
+	       char *buf)
+{
+	struct limits_dcvs_hw *hw = container_of(devattr,
+						struct limits_dcvs_hw,
+						lmh_stats_attr);
+	struct limits_dcvs_stats st;
+	u64 avg_loss = 0;
+
+	mutex_lock(&hw->access_lock);
+	limits_dcvs_account(hw, hw->hw_freq_limit);
+	st = hw->stats;
+	mutex_unlock(&hw->access_lock);
+
+	if (st.throttle_us)
+		avg_loss = div64_u64(st.freq_loss, st.throttle_us);
+
+	return snprintf(buf, PAGE_SIZE,
+		"throttle_count:%u\nthrottle_time_ms:%llu\navg_freq_loss_khz:%llu\npolicy_updates:%u\ncoalesced:%u\n",
+		st.throttle_count, div_u64(st.throttle_us, USEC_PER_MSEC),
+		avg_loss, st.policy_updates, st.coalesced);
+}
+
 static int limits_dcvs_probe(struct platform_device *pdev)
 {
 	int ret;
@@ -633,6 +756,9 @@ static int limits_dcvs_probe(struct platform_device *pdev)
 
 	mutex_init(&hw->access_lock);
 	INIT_DEFERRABLE_WORK(&hw->freq_poll_work, limits_dcvs_poll);
+	INIT_DELAYED_WORK(&hw->policy_work, limits_dcvs_policy_work);
+	hw->stats.last_update = ktime_get();
+	hw->policy_nb.notifier_call = limits_dcvs_policy_notify;
 	hw->osm_hw_reg = devm_ioremap(&pdev->dev, request_reg, 0x4);
 	if (!hw->osm_hw_reg) {
 		pr_err("register remap failed\n");
@@ -663,6 +789,17 @@ static int limits_dcvs_probe(struct platform_device *pdev)
 	hw->lmh_freq_attr.show = lmh_freq_limit_show;
 	hw->lmh_freq_attr.attr.mode = 0444;
 	device_create_file(&pdev->dev, &hw->lmh_freq_attr);
+	hw->lmh_stats_attr.attr.name = "lmh_stats";
+	hw->lmh_stats_attr.show = lmh_stats_show;
+	hw->lmh_stats_attr.attr.mode = 0444;
+	device_create_file(&pdev->dev, &hw->lmh_stats_attr);
+
+	ret = cpufreq_register_notifier(&hw->policy_nb,
+					CPUFREQ_POLICY_NOTIFIER);
+	if (ret) {
+		pr_err("Error registering policy notifier. err:%d\n", ret);
+		ret = 0;
+	}
 
 probe_exit:
 	mutex_lock(&lmh_dcvs_list_access);
@@ -0,0 +1,414 @@
+/*
+ * Copyright (c) 2018, The Linux Foundation. All rights reserved.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 and
+ * only version 2 as published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ */
+
+/*
+ * Runtime characterisation of the cpu dynamic power coefficient.
+ *
+ * For every OPP of a cluster the frequency is pinned, the battery power
+ * is sampled through the fuel gauge with the cluster idle and then with
+ * all of its online cpus spinning, and the difference is turned into the
+ * coefficient used by the cpufreq cooling power model:
+ *
+ *	P(mW) = C * f(MHz) * V(mV)^2 / 10^9
+ *
+ * The averaged coefficient is handed to the cpufreq cooling devices of
+ * the cluster, so that power allocating governors run on measured rather
+ * than hand tuned or absent numbers.
+ */
+
+#define pr_fmt(fmt) "%s:%s " fmt, KBUILD_MODNAME, __func__
+
+#include <linux/module.h>
+#include <linux/kernel.h>
+#include <linux/err.h>
+#include <linux/slab.h>
+#include <linux/mutex.h>
+#include <linux/delay.h>
+#include <linux/kthread.h>
+#include <linux/cpu.h>
+#include <linux/cpufreq.h>
+#include <linux/cpu_cooling.h>
+#include <linux/pm_opp.h>
+#include <linux/power_supply.h>
+#include <linux/debugfs.h>
+#include <linux/seq_file.h>
+#include <linux/uaccess.h>
+
+#define POWER_CHAR_SAMPLE_US	10000
+#define POWER_CHAR_MAX_OPPS	32
+
+static unsigned int settle_ms = 200;
+module_param(settle_ms, uint, 0644);
+MODULE_PARM_DESC(settle_ms, "Time to settle after a frequency change");
+
+static unsigned int sample_ms = 1000;
+module_param(sample_ms, uint, 0644);
+MODULE_PARM_DESC(sample_ms, "Time to average power over per measurement");
+
+static char *psy_name = "battery";
+module_param(psy_name, charp, 0644);
+MODULE_PARM_DESC(psy_name, "Power supply reporting current and voltage");
+
+struct power_char_opp {
+	unsigned int freq;
+	unsigned long voltage;
+	u64 idle_uw;
+	u64 busy_uw;
+	u32 coeff;
+};
+
+struct power_char_result {
+	unsigned int cpu;
+	unsigned int ncpus;
+	unsigned int nr_opps;
+	u32 coeff;
+	int ret;
+	struct power_char_opp opp[POWER_CHAR_MAX_OPPS];
+};
+
+static DEFINE_MUTEX(power_char_lock);
+static struct power_char_result *power_char_last;
+static struct dentry *power_char_dir;
+
+/* Frequency, in kHz, the running characterisation pins its policy at */
+static unsigned int pin_cpu;
+static unsigned int pin_freq;
+
+static int power_char_policy_notify(struct notifier_block *nb,
+				    unsigned long val, void *data)
+{
+	struct cpufreq_policy *policy = data;
+	unsigned int freq = READ_ONCE(pin_freq);
+
+	if (val != CPUFREQ_ADJUST || !freq ||
+	    !cpumask_test_cpu(READ_ONCE(pin_cpu), policy->related_cpus))
+		return NOTIFY_DONE;
+
+	cpufreq_verify_within_limits(policy, freq, freq);
+
+	return NOTIFY_OK;
+}
+
+static struct notifier_block power_char_policy_nb = {
+	.notifier_call = power_char_policy_notify,
+};
+
+static void power_char_pin(unsigned int cpu, unsigned int freq)
+{
+	WRITE_ONCE(pin_cpu, cpu);
+	WRITE_ONCE(pin_freq, freq);
+	cpufreq_update_policy(cpu);
+}
+
+static int power_char_spin(void *unused)
+{
+	while (!kthread_should_stop())
+		cond_resched();
+
+	return 0;
+}
+
+static int power_char_read_uw(struct power_supply *psy, u64 *uw)
+{
+	union power_supply_propval cur, volt, status;
+	unsigned int n, samples;
+	u64 sum = 0;
+	int ret;
+
+	ret = power_supply_get_property(psy, POWER_SUPPLY_PROP_STATUS, &status);
+	if (!ret && status.intval == POWER_SUPPLY_STATUS_CHARGING)
+		return -EBUSY;
+
+	samples = max_t(unsigned int,
+			sample_ms * USEC_PER_MSEC / POWER_CHAR_SAMPLE_US, 1);
+	for (n = 0; n < samples; n++) {
+		ret = power_supply_get_property(psy,
+				POWER_SUPPLY_PROP_CURRENT_NOW, &cur);
+		if (ret)
+			return ret;
+		ret = power_supply_get_property(psy,
+				POWER_SUPPLY_PROP_VOLTAGE_NOW, &volt);
+		if (ret)
+			return ret;
+
+		/* uA * uV / 10^6 = uW */
+		sum += div_u64((u64)abs(cur.intval) * abs(volt.intval),
+			       USEC_PER_SEC);
+		usleep_range(POWER_CHAR_SAMPLE_US, POWER_CHAR_SAMPLE_US + 1000);
+	}
+
+	*uw = div_u64(sum, samples);
+
+	return 0;
+}
+
+static int power_char_measure(struct power_supply *psy,
+			      struct power_char_opp *opp,
+			      const struct cpumask *cpus)
+{
+	struct task_struct **spinner;
+	unsigned int cpu;
+	int ret;
+
+	msleep(settle_ms);
+	ret = power_char_read_uw(psy, &opp->idle_uw);
+	if (ret)
+		return ret;
+
+	spinner = kcalloc(nr_cpu_ids, sizeof(*spinner), GFP_KERNEL);
+	if (!spinner)
+		return -ENOMEM;
+
+	for_each_cpu(cpu, cpus) {
+		spinner[cpu] = kthread_create_on_cpu(power_char_spin, NULL,
+						     cpu, "power_char/%u");
+		if (IS_ERR(spinner[cpu])) {
+			ret = PTR_ERR(spinner[cpu]);
+			spinner[cpu] = NULL;
+			goto stop;
+		}
+		wake_up_process(spinner[cpu]);
+	}
+
+	msleep(settle_ms);
+	ret = power_char_read_uw(psy, &opp->busy_uw);
+
+stop:
+	for_each_cpu(cpu, cpus)
+		if (spinner[cpu])
+			kthread_stop(spinner[cpu]);
+	kfree(spinner);
+
+	return ret;
+}
+
+/* Invert the cpufreq cooling power model for one OPP */
+static u32 power_char_coeff(struct power_char_opp *opp, unsigned int ncpus)
+{
+	u64 freq_mhz = opp->freq / 1000;
+	u64 mv = opp->voltage / 1000;
+	u64 dyn_mw;
+
+	if (opp->busy_uw <= opp->idle_uw || !freq_mhz || !mv || !ncpus)
+		return 0;
+
+	dyn_mw = div_u64(opp->busy_uw - opp->idle_uw, 1000 * ncpus);
+
+	return div64_u64(dyn_mw * 1000000000ULL, freq_mhz * mv * mv);
+}
+
+static int power_char_run(unsigned int cpu, struct power_char_result *res)
+{
+	struct cpufreq_frequency_table *pos;
+	struct cpufreq_policy *policy;
+	struct power_supply *psy;
+	struct device *cpu_dev;
+	struct dev_pm_opp *opp;
+	cpumask_var_t cpus;
+	unsigned int i, nr = 0;
+	u64 total = 0;
+	int ret = 0;
+
+	psy = power_supply_get_by_name(psy_name);
+	if (!psy)
+		return -ENODEV;
+
+	cpu_dev = get_cpu_device(cpu);
+	policy = cpufreq_cpu_get(cpu);
+	if (!cpu_dev || !policy) {
+		ret = -ENODEV;
+		goto put_psy;
+	}
+
+	if (!zalloc_cpumask_var(&cpus, GFP_KERNEL)) {
+		ret = -ENOMEM;
+		goto put_policy;
+	}
+
+	get_online_cpus();
+	cpumask_and(cpus, policy->related_cpus, cpu_online_mask);
+	res->cpu = cpu;
+	res->ncpus = cpumask_weight(cpus);
+
+	ret = cpufreq_register_notifier(&power_char_policy_nb,
+					CPUFREQ_POLICY_NOTIFIER);
+	if (ret)
+		goto unlock;
+
+	cpufreq_for_each_valid_entry(pos, policy->freq_table) {
+		struct power_char_opp *p;
+
+		if (res->nr_opps >= POWER_CHAR_MAX_OPPS)
+			break;
+
+		p = &res->opp[res->nr_opps];
+		p->freq = pos->frequency;
+
+		rcu_read_lock();
+		opp = dev_pm_opp_find_freq_exact(cpu_dev, p->freq * 1000UL,
+						 true);
+		p->voltage = IS_ERR(opp) ? 0 : dev_pm_opp_get_voltage(opp);
+		rcu_read_unlock();
+		if (!p->voltage)
+			continue;
+
+		power_char_pin(cpu, p->freq);
+		ret = power_char_measure(psy, p, cpus);
+		if (ret)
+			break;
+
+		p->coeff = power_char_coeff(p, res->ncpus);
+		pr_debug("cpu%u %u kHz %lu uV idle %llu uW busy %llu uW C %u\n",
+			 cpu, p->freq, p->voltage, p->idle_uw, p->busy_uw,
+			 p->coeff);
+		res->nr_opps++;
+	}
+
+	power_char_pin(cpu, 0);
+	cpufreq_unregister_notifier(&power_char_policy_nb,
+				    CPUFREQ_POLICY_NOTIFIER);
+	if (ret)
+		goto unlock;
+
+	for (i = 0; i < res->nr_opps; i++) {
+		if (!res->opp[i].coeff)
+			continue;
+		total += res->opp[i].coeff;
+		nr++;
+	}
+	if (!nr) {
+		ret = -ERANGE;
+		goto unlock;
+	}
+	res->coeff = div_u64(total, nr);
+
+	for_each_cpu(i, policy->related_cpus) {
+		ret = cpufreq_cooling_set_capacitance(i, res->coeff);
+		if (ret && ret != -ENODEV)
+			break;
+		ret = 0;
+	}
+	pr_info("cpu%u: dynamic power coefficient %u from %u OPPs\n",
+		cpu, res->coeff, nr);
+
+unlock:
+	put_online_cpus();
+	free_cpumask_var(cpus);
+put_policy:
+	if (policy)
+		cpufreq_cpu_put(policy);
+put_psy:
+	power_supply_put(psy);
+
+	return ret;
+}
+
+static ssize_t power_char_run_write(struct file *file,
+				    const char __user *buf, size_t count,
+				    loff_t *ppos)
+{
+	struct power_char_result *res;
+	unsigned int cpu;
+	int ret;
+
+	ret = kstrtouint_from_user(buf, count, 0, &cpu);
+	if (ret)
+		return ret;
+	if (cpu >= nr_cpu_ids || !cpu_possible(cpu))
+		return -EINVAL;
+
+	res = kzalloc(sizeof(*res), GFP_KERNEL);
+	if (!res)
+		return -ENOMEM;
+
+	mutex_lock(&power_char_lock);
+	res->ret = power_char_run(cpu, res);
+	ret = res->ret;
+	kfree(power_char_last);
+	power_char_last = res;
+	mutex_unlock(&power_char_lock);
+
+	return ret ? ret : count;
+}
+
+static const struct file_operations power_char_run_fops = {
+	.open = simple_open,
+	.write = power_char_run_write,
+	.llseek = noop_llseek,
+};
+
+static int power_char_results_show(struct seq_file *s, void *unused)
+{
+	struct power_char_result *res;
+	unsigned int i;
+
+	mutex_lock(&power_char_lock);
+	res = power_char_last;
+	if (!res) {
+		seq_puts(s, "no characterisation run\n");
+		goto out;
+	}
+
+	seq_printf(s, "cpu %u cpus %u status %d coefficient %u\n",
+		   res->cpu, res->ncpus, res->ret, res->coeff);
+	seq_printf(s, "%10s %10s %12s %12s %8s\n",
+		   "freq_khz", "volt_uv", "idle_uw", "busy_uw", "coeff");
+	for (i = 0; i < res->nr_opps; i++)
+		seq_printf(s, "%10u %10lu %12llu %12llu %8u\n",
+			   res->opp[i].freq, res->opp[i].voltage,
+			   res->opp[i].idle_uw, res->opp[i].busy_uw,
+			   res->opp[i].coeff);
+out:
+	mutex_unlock(&power_char_lock);
+
+	return 0;
+}
+
+static int power_char_results_open(struct inode *inode, struct file *file)
+{
+	return single_open(file, power_char_results_show, inode->i_private);
+}
+
+static const struct file_operations power_char_results_fops = {
+	.open = power_char_results_open,
+	.read = seq_read,
+	.llseek = seq_lseek,
+	.release = single_release,
+};
+
+static int __init power_char_init(void)
+{
+	power_char_dir = debugfs_create_dir("power_char", NULL);
+	if (IS_ERR_OR_NULL(power_char_dir)) {
+		pr_err("Failed to create debugfs dir\n");
+		return -ENODEV;
+	}
+
+	debugfs_create_file("run", 0200, power_char_dir, NULL,
+			    &power_char_run_fops);
+	debugfs_create_file("results", 0444, power_char_dir, NULL,
+			    &power_char_results_fops);
+
+	return 0;
+}
+module_init(power_char_init);
+
+static void __exit power_char_exit(void)
+{
+	debugfs_remove_recursive(power_char_dir);
+	kfree(power_char_last);
+}
+module_exit(power_char_exit);
+
+MODULE_DESCRIPTION("QTI cpu dynamic power characterisation");
+MODULE_LICENSE("GPL v2");
@@ -123,6 +123,7 @@ int of_thermal_aggregate_trip(struct thermal_zone_device *tz,
 void of_thermal_handle_trip(struct thermal_zone_device *tz);
 void of_thermal_handle_trip_temp(struct thermal_zone_device *tz,
 					int trip_temp);
+int of_thermal_set_irq_mode(struct thermal_zone_device *tz, bool irq_mode);
 #else
 static inline int of_parse_thermal_zones(void) { return 0; }
 static inline void of_thermal_destroy_zones(void) { }
@@ -153,6 +154,11 @@ static inline
 void of_thermal_handle_trip_temp(struct thermal_zone_device *tz,
 					int trip_temp)
 { }
+static inline
+int of_thermal_set_irq_mode(struct thermal_zone_device *tz, bool irq_mode)
+{
+	return 0;
+}
 #endif
 
 #endif /* __THERMAL_CORE_H__ */
@@ -391,12 +391,64 @@ static int tsens_dbg_log_bus_id_data(struct tsens_device *data,
 	return 0;
 }
 
+static int tsens_dbg_log_threshold_event(struct tsens_device *data,
+					u32 id, u32 dbg_type, int *val)
+{
+	if (!data || id >= TSENS_MAX_SENSORS)
+		return -EINVAL;
+
+	data->tsens_dbg.sensor_dbg_info[id].thr_events++;
+
+	return 0;
+}
+
+/*
+ * Every threshold interrupt replaces polls of the sensor, so the reads
+ * saved are the polls the fastest zone of the sensor would have done
+ * since the switch to interrupts, less the interrupts taken.
+ */
+static ssize_t
+poll_stats_show(struct device *dev, struct device_attribute *attr, char *buf)
+{
+	struct tsens_device *tmdev = dev_get_drvdata(dev);
+	struct tsens_dbg *dbg;
+	s64 elapsed, saved;
+	int i, cnt = 0;
+
+	if (!tmdev)
+		return -ENODEV;
+
+	elapsed = ktime_ms_delta(ktime_get(), tmdev->tsens_dbg.irq_mode_start);
+	for (i = 0; i < TSENS_MAX_SENSORS; i++) {
+		dbg = &tmdev->tsens_dbg.sensor_dbg_info[i];
+		if (dbg->poll_ms <= 0)
+			continue;
+
+		saved = div_s64(elapsed, dbg->poll_ms) - dbg->thr_events;
+		cnt += scnprintf(buf + cnt, PAGE_SIZE - cnt,
+				"sensor%d: poll_ms=%d irqs=%u wakeups_saved=%lld\n",
+				i, dbg->poll_ms, dbg->thr_events,
+				max_t(s64, saved, 0));
+	}
+
+	return cnt;
+}
+
+static DEVICE_ATTR_RO(poll_stats);
+
+int tsens_dbg_poll_stats_init(struct tsens_device *data)
+{
+	return device_create_file(&data->pdev->dev, &dev_attr_poll_stats);
+}
+EXPORT_SYMBOL(tsens_dbg_poll_stats_init);
+
 static struct tsens_dbg_func dbg_arr[] = {
 	[TSENS_DBG_LOG_TEMP_READS] = {tsens_dbg_log_temp_reads},
 	[TSENS_DBG_LOG_INTERRUPT_TIMESTAMP] = {
 			tsens_dbg_log_interrupt_timestamp},
 	[TSENS_DBG_LOG_BUS_ID_DATA] = {tsens_dbg_log_bus_id_data},
 	[TSENS_DBG_MTC_DATA] = {tsens_dbg_mtc_data},
+	[TSENS_DBG_LOG_THRESHOLD_EVENT] = {tsens_dbg_log_threshold_event},
 };
 
 int tsens2xxx_dbg(struct tsens_device *data, u32 id, u32 dbg_type, int *val)
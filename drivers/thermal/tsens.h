@@ -42,6 +42,7 @@ enum tsens_dbg_type {
 	TSENS_DBG_LOG_INTERRUPT_TIMESTAMP,
 	TSENS_DBG_LOG_BUS_ID_DATA,
 	TSENS_DBG_MTC_DATA,
+	TSENS_DBG_LOG_THRESHOLD_EVENT,
 	TSENS_DBG_LOG_MAX
 };
 
@@ -51,16 +52,22 @@ struct tsens_device;
 
 #if defined(CONFIG_THERMAL_TSENS)
 int tsens2xxx_dbg(struct tsens_device *data, u32 id, u32 dbg_type, int *temp);
+int tsens_dbg_poll_stats_init(struct tsens_device *data);
 #else
 static inline int tsens2xxx_dbg(struct tsens_device *data, u32 id,
 						u32 dbg_type, int *temp)
 { return -ENXIO; }
+static inline int tsens_dbg_poll_stats_init(struct tsens_device *data)
+{ return -ENXIO; }
 #endif
 
 struct tsens_dbg {
 	u32				idx;
 	unsigned long long		time_stmp[DEBUG_SIZE];
 	unsigned long			temp[DEBUG_SIZE];
+	/* Zone polling replaced by threshold interrupts */
+	int				poll_ms;
+	u32				thr_events;
 };
 
 struct tsens_dbg_context {
@@ -70,6 +77,7 @@ struct tsens_dbg_context {
 	u32				irq_idx;
 	unsigned long long		irq_time_stmp[DEBUG_SIZE];
 	struct delayed_work		tsens_critical_poll_test;
+	ktime_t				irq_mode_start;
 };
 
 struct tsens_context {
@@ -421,6 +421,9 @@ static irqreturn_t tsens_irq_thread(int irq, void *data)
 				TSENS_SN_STATUS_TEMP_MASK),
 				tm->sensor));
 			of_thermal_handle_trip(tm->sensor[i].tzd);
+			if (tm->ops->dbg)
+				tm->ops->dbg(tm, tm->sensor[i].hw_id,
+					TSENS_DBG_LOG_THRESHOLD_EVENT, NULL);
 		}
 	}
 
@@ -503,6 +503,9 @@ static irqreturn_t tsens_tm_irq_thread(int irq, void *data)
 			pr_debug("sensor:%d trigger temp (%d degC)\n",
 				tm->sensor[i].hw_id, temp);
 			of_thermal_handle_trip_temp(tm->sensor[i].tzd, temp);
+			if (tm->ops->dbg)
+				tm->ops->dbg(tm, tm->sensor[i].hw_id,
+					TSENS_DBG_LOG_THRESHOLD_EVENT, NULL);
 		}
 	}
 
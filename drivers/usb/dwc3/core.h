@@ -620,6 +620,9 @@ struct dwc3_ep_events {
  * @dbg_ep_events_diff: differential events counter for endpoint
  * @dbg_ep_events_ts: timestamp for previous event counters
  * @fifo_depth: allocated TXFIFO depth
+ * @batch_queued: requests held back on @pending_list for the next batch
+ * @bytes_done: bytes given back to the gadget driver
+ * @ioc_trbs: TRBs prepared with IOC, i.e. completion interrupts requested
  * @ep_cfg_init_params: Used by GSI EP to save EP_CFG init_cmd params
  * @gsi_db_reg_addr: Address of GSI DB register mapped to this EP
  */
@@ -677,6 +680,9 @@ struct dwc3_ep {
 	struct dwc3_ep_events	dbg_ep_events_diff;
 	struct timespec		dbg_ep_events_ts;
 	int			fifo_depth;
+	u32			batch_queued;
+	u64			bytes_done;
+	unsigned int		ioc_trbs;
 	struct dwc3_gadget_ep_cmd_params ep_cfg_init_params;
 	void __iomem		*gsi_db_reg_addr;
 };
@@ -989,6 +995,7 @@ struct dwc3_scratchpad_array {
  * @last_fifo_depth: total TXFIFO depth of all enabled USB IN/INT endpoints
  * @imod_interval: set the interrupt moderation interval in 250ns
  *			increments or 0 to disable.
+ * @trb_batch: max bulk IN requests prepared with a single IOC, 0 to disable
  * @create_reg_debugfs: create debugfs entry to allow dwc3 register dump
  * @xhci_imod_value: imod value to use with xhci
  * @core_id: usb core id to differentiate different controller
@@ -1168,6 +1175,7 @@ struct dwc3 {
 	unsigned int		vbus_draw;
 
 	u16			imod_interval;
+	u8			trb_batch;
 
 	struct workqueue_struct	*dwc_wq;
 	struct work_struct	bh_work;
@@ -25,6 +25,8 @@
 #include <linux/seq_file.h>
 #include <linux/delay.h>
 #include <linux/uaccess.h>
+#include <linux/math64.h>
+#include <linux/sizes.h>
 
 #include <linux/usb/ch9.h>
 
@@ -949,6 +951,8 @@ static ssize_t dwc3_store_int_events(struct file *file,
 		memset(&dep->dbg_ep_events, 0, sizeof(dep->dbg_ep_events));
 		memset(&dep->dbg_ep_events_diff, 0, sizeof(dep->dbg_ep_events));
 		dep->dbg_ep_events_ts = ts;
+		dep->bytes_done = 0;
+		dep->ioc_trbs = 0;
 	}
 	memset(&dwc->dbg_gadget_events, 0, sizeof(dwc->dbg_gadget_events));
 	spin_unlock_irqrestore(&dwc->lock, flags);
@@ -965,6 +969,7 @@ static int dwc3_gadget_int_events_show(struct seq_file *s, void *unused)
 	struct timespec ts_delta;
 	struct timespec ts_current;
 	u32 ts_delta_ms;
+	u64 xfer_irqs;
 
 	spin_lock_irqsave(&dwc->lock, flags);
 	dbg_gadget_events = &dwc->dbg_gadget_events;
@@ -1023,6 +1028,12 @@ static int dwc3_gadget_int_events_show(struct seq_file *s, void *unused)
 			ep_event_rate(total, dep->dbg_ep_events,
 				dep->dbg_ep_events_diff, ts_delta_ms));
 
+		xfer_irqs = dep->dbg_ep_events.xfercomplete +
+			dep->dbg_ep_events.xferinprogress;
+		seq_printf(s, "bytes:%llu ioc_trbs:%u irqs_per_mb:%llu\n",
+			dep->bytes_done, dep->ioc_trbs, dep->bytes_done ?
+			div64_u64(xfer_irqs * SZ_1M, dep->bytes_done) : 0);
+
 		dep->dbg_ep_events_ts = ts_current;
 		dep->dbg_ep_events_diff = dep->dbg_ep_events;
 	}
@@ -322,6 +322,7 @@ struct dwc3_msm {
 	u32			num_gsi_event_buffers;
 	struct dwc3_event_buffer **gsi_ev_buff;
 	int pm_qos_latency;
+	unsigned int imod_val;
 	struct pm_qos_request pm_qos_req_dma;
 	struct delayed_work perf_vote_work;
 	struct delayed_work sdp_check;
@@ -3529,6 +3530,31 @@ static ssize_t mode_store(struct device *dev, struct device_attribute *attr,
 }
 
 static DEVICE_ATTR_RW(mode);
+
+/* Interrupt moderation in usecs, applied on the next peripheral start */
+static ssize_t gadget_imod_val_show(struct device *dev,
+		struct device_attribute *attr, char *buf)
+{
+	struct dwc3_msm *mdwc = dev_get_drvdata(dev);
+
+	return snprintf(buf, PAGE_SIZE, "%u\n", mdwc->imod_val);
+}
+
+static ssize_t gadget_imod_val_store(struct device *dev,
+		struct device_attribute *attr, const char *buf, size_t count)
+{
+	struct dwc3_msm *mdwc = dev_get_drvdata(dev);
+	u32 val;
+
+	if (kstrtou32(buf, 0, &val) || val > IMOD_EE_CNT_MASK)
+		return -EINVAL;
+
+	mdwc->imod_val = val;
+
+	return count;
+}
+
+static DEVICE_ATTR_RW(gadget_imod_val);
 static void msm_dwc3_perf_vote_work(struct work_struct *w);
 
 /* This node only shows max speed supported dwc3 and it should be
@@ -3907,6 +3933,8 @@ static int dwc3_msm_probe(struct platform_device *pdev)
 		goto put_dwc3;
 	}
 
+	of_property_read_u8(node, "qcom,gadget-trb-batch", &dwc->trb_batch);
+
 	mdwc->irq_to_affin = platform_get_irq(mdwc->dwc3, 0);
 	mdwc->dwc3_cpu_notifier.notifier_call = dwc3_cpu_notifier_cb;
 
@@ -3941,8 +3969,9 @@ static int dwc3_msm_probe(struct platform_device *pdev)
 		mdwc->pm_qos_latency = 0;
 	}
 
+	mdwc->imod_val = dwc3_gadget_imod_val;
 	of_property_read_u32(node, "qcom,gadget-imod-val",
-					&dwc3_gadget_imod_val);
+					&mdwc->imod_val);
 
 	mdwc->no_vbus_vote_type_c = of_property_read_bool(node,
 					"qcom,no-vbus-vote-with-type-C");
@@ -3991,6 +4020,7 @@ static int dwc3_msm_probe(struct platform_device *pdev)
 	}
 
 	device_create_file(&pdev->dev, &dev_attr_mode);
+	device_create_file(&pdev->dev, &dev_attr_gadget_imod_val);
 	device_create_file(&pdev->dev, &dev_attr_speed);
 	device_create_file(&pdev->dev, &dev_attr_usb_compliance_mode);
 	device_create_file(&pdev->dev, &dev_attr_xhci_link_compliance);
@@ -4033,6 +4063,7 @@ static int dwc3_msm_remove(struct platform_device *pdev)
 	int ret_pm;
 
 	device_remove_file(&pdev->dev, &dev_attr_mode);
+	device_remove_file(&pdev->dev, &dev_attr_gadget_imod_val);
 	device_remove_file(&pdev->dev, &dev_attr_xhci_link_compliance);
 	if (mdwc->usb_psy)
 		power_supply_put(mdwc->usb_psy);
@@ -4448,11 +4479,11 @@ static int dwc3_otg_start_peripheral(struct dwc3_msm *mdwc, int on)
 		msm_dwc3_perf_vote_update(mdwc, true);
 		schedule_delayed_work(&mdwc->perf_vote_work,
 				msecs_to_jiffies(1000 * PM_QOS_SAMPLE_SEC));
-		if (dwc3_gadget_imod_val > 0) {
+		if (mdwc->imod_val > 0) {
 			dwc3_msm_write_reg(mdwc->base, USEC_CNT, 0x7D);
 			dwc3_msm_write_reg_field(mdwc->base, IMOD(0),
 						 IMOD_EE_CNT_MASK,
-						 dwc3_gadget_imod_val);
+						 mdwc->imod_val);
 			dwc3_msm_write_reg_field(mdwc->base, IMOD(0),
 						 IMOD_EE_EN_MASK, 0x1);
 		}
@@ -272,6 +272,8 @@ void dwc3_gadget_giveback(struct dwc3_ep *dep, struct dwc3_request *req,
 	if (req->request.status == -EINPROGRESS)
 		req->request.status = status;
 
+	dep->bytes_done += req->request.actual;
+
 	/*
 	 * NOTICE we don't want to unmap before calling ->complete() if we're
 	 * dealing with a bounced ep0 request. If we unmap it here, we would end
@@ -947,7 +949,7 @@ static u32 dwc3_calc_trbs_left(struct dwc3_ep *dep);
  */
 static void dwc3_prepare_one_trb(struct dwc3_ep *dep,
 		struct dwc3_request *req, dma_addr_t dma,
-		unsigned length, unsigned chain, unsigned node)
+		unsigned length, unsigned chain, unsigned node, bool batch)
 {
 	struct dwc3_trb		*trb;
 	struct dwc3		*dwc = dep->dwc;
@@ -1048,9 +1050,11 @@ static void dwc3_prepare_one_trb(struct dwc3_ep *dep,
 			trb->ctrl |= DWC3_TRB_CTRL_ISP_IMI;
 	}
 
-	if ((!req->request.no_interrupt && !chain) ||
-			(dwc3_calc_trbs_left(dep) == 0))
+	if ((!req->request.no_interrupt && !chain && !batch) ||
+			(dwc3_calc_trbs_left(dep) == 0)) {
 		trb->ctrl |= DWC3_TRB_CTRL_IOC;
+		dep->ioc_trbs++;
+	}
 
 	if (chain)
 		trb->ctrl |= DWC3_TRB_CTRL_CHN;
@@ -1128,7 +1132,7 @@ static u32 dwc3_calc_trbs_left(struct dwc3_ep *dep)
 }
 
 static void dwc3_prepare_one_trb_sg(struct dwc3_ep *dep,
-		struct dwc3_request *req)
+		struct dwc3_request *req, bool batch)
 {
 	struct scatterlist *sg = req->sg;
 	struct scatterlist *s;
@@ -1146,7 +1150,7 @@ static void dwc3_prepare_one_trb_sg(struct dwc3_ep *dep,
 			chain = false;
 
 		dwc3_prepare_one_trb(dep, req, dma, length,
-				chain, i);
+				chain, i, batch);
 
 		if (!dwc3_calc_trbs_left(dep))
 			break;
@@ -1154,7 +1158,7 @@ static void dwc3_prepare_one_trb_sg(struct dwc3_ep *dep,
 }
 
 static void dwc3_prepare_one_trb_linear(struct dwc3_ep *dep,
-		struct dwc3_request *req)
+		struct dwc3_request *req, bool batch)
 {
 	unsigned int	length;
 	dma_addr_t	dma;
@@ -1163,7 +1167,19 @@ static void dwc3_prepare_one_trb_linear(struct dwc3_ep *dep,
 	length = req->request.length;
 
 	dwc3_prepare_one_trb(dep, req, dma, length,
-			false, 0);
+			false, 0, batch);
+}
+
+/*
+ * Bulk IN requests queued while the endpoint is busy are held back and
+ * prepared together, and only the last one of such a batch interrupts on
+ * completion. OUT endpoints are left alone, as a short packet on a TRB
+ * without IOC would sit unnoticed until the next interrupting TRB.
+ */
+static bool dwc3_gadget_ep_can_batch(struct dwc3_ep *dep)
+{
+	return dep->dwc->trb_batch && dep->direction &&
+		usb_endpoint_xfer_bulk(dep->endpoint.desc);
 }
 
 /*
@@ -1177,17 +1193,26 @@ static void dwc3_prepare_one_trb_linear(struct dwc3_ep *dep,
 static void dwc3_prepare_trbs(struct dwc3_ep *dep)
 {
 	struct dwc3_request	*req, *n;
+	bool			can_batch;
+	bool			batch;
 
 	BUILD_BUG_ON_NOT_POWER_OF_2(DWC3_TRB_NUM);
 
 	if (!dwc3_calc_trbs_left(dep))
 		return;
 
+	can_batch = dwc3_gadget_ep_can_batch(dep);
+	dep->batch_queued = 0;
+
 	list_for_each_entry_safe(req, n, &dep->pending_list, list) {
+		/* the last request prepared always interrupts */
+		batch = can_batch && !list_is_last(&req->list,
+						&dep->pending_list);
+
 		if (req->num_pending_sgs > 0)
-			dwc3_prepare_one_trb_sg(dep, req);
+			dwc3_prepare_one_trb_sg(dep, req, batch);
 		else
-			dwc3_prepare_one_trb_linear(dep, req);
+			dwc3_prepare_one_trb_linear(dep, req, batch);
 
 		if (!dwc3_calc_trbs_left(dep))
 			return;
@@ -1395,6 +1420,15 @@ static int __dwc3_gadget_ep_queue(struct dwc3_ep *dep, struct dwc3_request *req)
 	if (!dwc3_calc_trbs_left(dep))
 		return 0;
 
+	/*
+	 * The completion of the transfer in flight kicks whatever is pending
+	 * by then, so hold requests back until a full batch is queued.
+	 */
+	if (dwc3_gadget_ep_can_batch(dep) && (dep->flags & DWC3_EP_BUSY) &&
+			!list_empty(&dep->started_list) &&
+			++dep->batch_queued < dwc->trb_batch)
+		return 0;
+
 	ret = __dwc3_gadget_kick_transfer(dep, 0);
 	if (ret && ret != -EBUSY)
 		dwc3_trace(trace_dwc3_gadget,
@@ -27,6 +27,7 @@
 
 static void __fscrypt_decrypt_bio(struct bio *bio, bool done)
 {
+	struct skcipher_request *req = NULL;
 	struct bio_vec *bv;
 	int i;
 
@@ -36,8 +37,10 @@ static void __fscrypt_decrypt_bio(struct bio *bio, bool done)
 		if (fscrypt_using_hardware_encryption(page->mapping->host)) {
 			SetPageUptodate(page);
 		} else {
-			int ret = fscrypt_decrypt_pagecache_blocks(page, bv->bv_len,
-								   bv->bv_offset);
+			/* One request serves every page of the bio */
+			int ret = fscrypt_crypt_pagecache_blocks(&req,
+					FS_DECRYPT, page, page, bv->bv_len,
+					bv->bv_offset, GFP_NOFS);
 			if (ret) {
 				SetPageError(page);
 			} else if (done) {
@@ -47,6 +50,7 @@ static void __fscrypt_decrypt_bio(struct bio *bio, bool done)
 		if (done)
 			unlock_page(page);
 	}
+	skcipher_request_free(req);
 }
 
 void fscrypt_decrypt_bio(struct bio *bio)
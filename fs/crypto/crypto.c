@@ -26,12 +26,14 @@
 #include <linux/ratelimit.h>
 #include <linux/dcache.h>
 #include <linux/namei.h>
+#include <linux/random.h>
 #include <crypto/aes.h>
 #include <crypto/skcipher.h>
 #include "fscrypt_private.h"
 
 static unsigned int num_prealloc_crypto_pages = 32;
 static unsigned int num_prealloc_crypto_ctxs = 128;
+static bool percpu_decrypt = true;
 
 module_param(num_prealloc_crypto_pages, uint, 0444);
 MODULE_PARM_DESC(num_prealloc_crypto_pages,
@@ -39,9 +41,26 @@ MODULE_PARM_DESC(num_prealloc_crypto_pages,
 module_param(num_prealloc_crypto_ctxs, uint, 0444);
 MODULE_PARM_DESC(num_prealloc_crypto_ctxs,
 		"Number of crypto contexts to preallocate");
+module_param(percpu_decrypt, bool, 0444);
+MODULE_PARM_DESC(percpu_decrypt,
+		"Decrypt reads on the CPU that completed them");
 
 static mempool_t *fscrypt_bounce_page_pool = NULL;
 
+/*
+ * Bounce pages freed on a CPU are kept here for the next write on that CPU,
+ * once the mempool reserve is full, so that steady writeback doesn't go
+ * through the mempool and the page allocator for every page.
+ */
+#define FSCRYPT_BOUNCE_CACHE_SIZE	16
+
+struct fscrypt_bounce_cache {
+	unsigned int nr;
+	struct page *pages[FSCRYPT_BOUNCE_CACHE_SIZE];
+};
+
+static DEFINE_PER_CPU(struct fscrypt_bounce_cache, fscrypt_bounce_cache);
+
 static LIST_HEAD(fscrypt_free_ctxs);
 static DEFINE_SPINLOCK(fscrypt_ctx_lock);
 
@@ -99,10 +118,49 @@ void fscrypt_free_bounce_page(struct page *bounce_page)
 		return;
 	set_page_private(bounce_page, (unsigned long)NULL);
 	ClearPagePrivate(bounce_page);
+
+	if (READ_ONCE(fscrypt_bounce_page_pool->curr_nr) >=
+	    fscrypt_bounce_page_pool->min_nr) {
+		struct fscrypt_bounce_cache *cache;
+		unsigned long flags;
+
+		/* Bounce pages are freed from bio completion */
+		local_irq_save(flags);
+		cache = this_cpu_ptr(&fscrypt_bounce_cache);
+		if (cache->nr < FSCRYPT_BOUNCE_CACHE_SIZE) {
+			cache->pages[cache->nr++] = bounce_page;
+			bounce_page = NULL;
+		}
+		local_irq_restore(flags);
+		if (!bounce_page)
+			return;
+	}
 	mempool_free(bounce_page, fscrypt_bounce_page_pool);
 }
 EXPORT_SYMBOL(fscrypt_free_bounce_page);
 
+static int fscrypt_do_crypt(struct skcipher_request *req,
+			    fscrypt_direction_t rw, union fscrypt_iv *iv,
+			    struct page *src_page, struct page *dest_page,
+			    unsigned int len, unsigned int offs)
+{
+	DECLARE_CRYPTO_WAIT(wait);
+	struct scatterlist dst, src;
+
+	skcipher_request_set_callback(
+		req, CRYPTO_TFM_REQ_MAY_BACKLOG | CRYPTO_TFM_REQ_MAY_SLEEP,
+		crypto_req_done, &wait);
+
+	sg_init_table(&dst, 1);
+	sg_set_page(&dst, dest_page, len, offs);
+	sg_init_table(&src, 1);
+	sg_set_page(&src, src_page, len, offs);
+	skcipher_request_set_crypt(req, &src, &dst, len, iv);
+	if (rw == FS_DECRYPT)
+		return crypto_wait_req(crypto_skcipher_decrypt(req), &wait);
+	return crypto_wait_req(crypto_skcipher_encrypt(req), &wait);
+}
+
 /* Encrypt or decrypt a single filesystem block of file contents */
 int fscrypt_crypt_block(const struct inode *inode, fscrypt_direction_t rw,
 			u64 lblk_num, struct page *src_page,
@@ -111,8 +169,6 @@ int fscrypt_crypt_block(const struct inode *inode, fscrypt_direction_t rw,
 {
 	union fscrypt_iv iv;
 	struct skcipher_request *req = NULL;
-	DECLARE_CRYPTO_WAIT(wait);
-	struct scatterlist dst, src;
 	struct fscrypt_info *ci = inode->i_crypt_info;
 	struct crypto_skcipher *tfm = ci->ci_key.tfm;
 	int res = 0;
@@ -128,22 +184,57 @@ int fscrypt_crypt_block(const struct inode *inode, fscrypt_direction_t rw,
 	if (!req)
 		return -ENOMEM;
 
-	skcipher_request_set_callback(
-		req, CRYPTO_TFM_REQ_MAY_BACKLOG | CRYPTO_TFM_REQ_MAY_SLEEP,
-		crypto_req_done, &wait);
-
-	sg_init_table(&dst, 1);
-	sg_set_page(&dst, dest_page, len, offs);
-	sg_init_table(&src, 1);
-	sg_set_page(&src, src_page, len, offs);
-	skcipher_request_set_crypt(req, &src, &dst, len, &iv);
-	if (rw == FS_DECRYPT)
-		res = crypto_wait_req(crypto_skcipher_decrypt(req), &wait);
-	else
-		res = crypto_wait_req(crypto_skcipher_encrypt(req), &wait);
+	res = fscrypt_do_crypt(req, rw, &iv, src_page, dest_page, len, offs);
 	skcipher_request_free(req);
-	if (res) {
-		return res;
+	return res;
+}
+
+/**
+ * fscrypt_crypt_pagecache_blocks() - Encrypt or decrypt blocks of a page
+ * @reqp:      Request to use; allocated on first use and reallocated when the
+ *		key changes.  The caller frees it with skcipher_request_free().
+ * @rw:        FS_ENCRYPT or FS_DECRYPT
+ * @page:      The pagecache page containing the block(s)
+ * @dest_page: Where to put the result, at the same offsets
+ * @len:       Total size of the block(s), a multiple of the block size
+ * @offs:      Byte offset within @page of the first block
+ * @gfp_flags: Memory allocation flags
+ *
+ * Every block needs its own IV, so each one is still a separate cipher
+ * operation, but they all share a single request.  Callers that work through
+ * a whole bio pass the same @reqp for all of its pages.
+ *
+ * Return: 0 on success; -errno on failure
+ */
+int fscrypt_crypt_pagecache_blocks(struct skcipher_request **reqp,
+				   fscrypt_direction_t rw, struct page *page,
+				   struct page *dest_page, unsigned int len,
+				   unsigned int offs, gfp_t gfp_flags)
+{
+	const struct inode *inode = page->mapping->host;
+	const unsigned int blockbits = inode->i_blkbits;
+	const unsigned int blocksize = 1 << blockbits;
+	struct fscrypt_info *ci = inode->i_crypt_info;
+	struct crypto_skcipher *tfm = ci->ci_key.tfm;
+	u64 lblk_num = ((u64)page->index << (PAGE_SHIFT - blockbits)) +
+		       (offs >> blockbits);
+	union fscrypt_iv iv;
+	unsigned int i;
+	int err;
+
+	if (!*reqp || crypto_skcipher_reqtfm(*reqp) != tfm) {
+		skcipher_request_free(*reqp);
+		*reqp = skcipher_request_alloc(tfm, gfp_flags);
+		if (!*reqp)
+			return -ENOMEM;
+	}
+
+	for (i = offs; i < offs + len; i += blocksize, lblk_num++) {
+		fscrypt_generate_iv(&iv, lblk_num, ci);
+		err = fscrypt_do_crypt(*reqp, rw, &iv, page, dest_page,
+				       blocksize, i);
+		if (err)
+			return err;
 	}
 	return 0;
 }
@@ -177,6 +268,18 @@ EXPORT_SYMBOL(fscrypt_get_ctx);
 
 struct page *fscrypt_alloc_bounce_page(gfp_t gfp_flags)
 {
+	struct fscrypt_bounce_cache *cache;
+	struct page *page = NULL;
+	unsigned long flags;
+
+	local_irq_save(flags);
+	cache = this_cpu_ptr(&fscrypt_bounce_cache);
+	if (cache->nr)
+		page = cache->pages[--cache->nr];
+	local_irq_restore(flags);
+	if (page)
+		return page;
+
 	return mempool_alloc(fscrypt_bounce_page_pool, gfp_flags);
 }
 
@@ -237,12 +340,9 @@ struct page *fscrypt_encrypt_pagecache_blocks(struct page *page,
 
 {
 	const struct inode *inode = page->mapping->host;
-	const unsigned int blockbits = inode->i_blkbits;
-	const unsigned int blocksize = 1 << blockbits;
+	const unsigned int blocksize = 1 << inode->i_blkbits;
+	struct skcipher_request *req = NULL;
 	struct page *ciphertext_page;
-	u64 lblk_num = ((u64)page->index << (PAGE_SHIFT - blockbits)) +
-		       (offs >> blockbits);
-	unsigned int i;
 	int err;
 
 	if (WARN_ON_ONCE(!PageLocked(page)))
@@ -255,14 +355,13 @@ struct page *fscrypt_encrypt_pagecache_blocks(struct page *page,
 	if (!ciphertext_page)
 		return ERR_PTR(-ENOMEM);
 
-	for (i = offs; i < offs + len; i += blocksize, lblk_num++) {
-		err = fscrypt_crypt_block(inode, FS_ENCRYPT, lblk_num,
-					  page, ciphertext_page,
-					  blocksize, i, gfp_flags);
-		if (err) {
-			fscrypt_free_bounce_page(ciphertext_page);
-			return ERR_PTR(err);
-		}
+	err = fscrypt_crypt_pagecache_blocks(&req, FS_ENCRYPT, page,
+					     ciphertext_page, len, offs,
+					     gfp_flags);
+	skcipher_request_free(req);
+	if (err) {
+		fscrypt_free_bounce_page(ciphertext_page);
+		return ERR_PTR(err);
 	}
 	SetPagePrivate(ciphertext_page);
 	set_page_private(ciphertext_page, (unsigned long)page);
@@ -316,11 +415,8 @@ int fscrypt_decrypt_pagecache_blocks(struct page *page, unsigned int len,
 				     unsigned int offs)
 {
 	const struct inode *inode = page->mapping->host;
-	const unsigned int blockbits = inode->i_blkbits;
-	const unsigned int blocksize = 1 << blockbits;
-	u64 lblk_num = ((u64)page->index << (PAGE_SHIFT - blockbits)) +
-		       (offs >> blockbits);
-	unsigned int i;
+	const unsigned int blocksize = 1 << inode->i_blkbits;
+	struct skcipher_request *req = NULL;
 	int err;
 
 	if (WARN_ON_ONCE(!PageLocked(page)))
@@ -329,13 +425,10 @@ int fscrypt_decrypt_pagecache_blocks(struct page *page, unsigned int len,
 	if (WARN_ON_ONCE(len <= 0 || !IS_ALIGNED(len | offs, blocksize)))
 		return -EINVAL;
 
-	for (i = offs; i < offs + len; i += blocksize, lblk_num++) {
-		err = fscrypt_crypt_block(inode, FS_DECRYPT, lblk_num, page,
-					  page, blocksize, i, GFP_NOFS);
-		if (err)
-			return err;
-	}
-	return 0;
+	err = fscrypt_crypt_pagecache_blocks(&req, FS_DECRYPT, page, page,
+					     len, offs, GFP_NOFS);
+	skcipher_request_free(req);
+	return err;
 }
 EXPORT_SYMBOL(fscrypt_decrypt_pagecache_blocks);
 
@@ -488,6 +581,107 @@ void fscrypt_msg(struct super_block *sb, const char *level,
 	va_end(args);
 }
 
+#ifdef CONFIG_FS_ENCRYPTION_BENCHMARK
+static char fscrypt_benchmark_result[80];
+
+static u64 fscrypt_benchmark_run(struct skcipher_request *req,
+				 fscrypt_direction_t rw, struct page *page,
+				 unsigned int nr_blocks)
+{
+	union fscrypt_iv iv;
+	u64 start = ktime_get_ns();
+	unsigned int i;
+
+	memset(&iv, 0, sizeof(iv));
+	for (i = 0; i < nr_blocks; i++) {
+		iv.lblk_num = cpu_to_le64(i);
+		if (fscrypt_do_crypt(req, rw, &iv, page, page, PAGE_SIZE, 0))
+			return 0;
+		cond_resched();
+	}
+	return ktime_get_ns() - start;
+}
+
+/*
+ * Encrypt and decrypt @nr_blocks pages in place with AES-256-XTS and a random
+ * key, through the same request path as file contents, and record the
+ * throughput of each direction in MB/s.
+ */
+static int fscrypt_benchmark(unsigned int nr_blocks)
+{
+	struct crypto_skcipher *tfm;
+	struct skcipher_request *req = NULL;
+	struct page *page = NULL;
+	u8 key[FSCRYPT_MAX_KEY_SIZE];
+	u64 bytes = (u64)nr_blocks * PAGE_SIZE * NSEC_PER_USEC;
+	u64 enc_ns, dec_ns;
+	int err;
+
+	tfm = crypto_alloc_skcipher("xts(aes)", 0, 0);
+	if (IS_ERR(tfm))
+		return PTR_ERR(tfm);
+
+	get_random_bytes(key, sizeof(key));
+	err = crypto_skcipher_setkey(tfm, key, sizeof(key));
+	memzero_explicit(key, sizeof(key));
+	if (err)
+		goto out;
+
+	err = -ENOMEM;
+	page = alloc_page(GFP_KERNEL);
+	req = skcipher_request_alloc(tfm, GFP_KERNEL);
+	if (!page || !req)
+		goto out;
+
+	err = -EIO;
+	enc_ns = fscrypt_benchmark_run(req, FS_ENCRYPT, page, nr_blocks);
+	dec_ns = fscrypt_benchmark_run(req, FS_DECRYPT, page, nr_blocks);
+	if (!enc_ns || !dec_ns)
+		goto out;
+
+	snprintf(fscrypt_benchmark_result, sizeof(fscrypt_benchmark_result),
+		 "%s: encrypt %llu MB/s, decrypt %llu MB/s\n",
+		 crypto_tfm_alg_driver_name(crypto_skcipher_tfm(tfm)),
+		 div64_u64(bytes, enc_ns), div64_u64(bytes, dec_ns));
+	err = 0;
+out:
+	skcipher_request_free(req);
+	if (page)
+		__free_page(page);
+	crypto_free_skcipher(tfm);
+	return err;
+}
+
+static int fscrypt_benchmark_set(const char *val,
+				 const struct kernel_param *kp)
+{
+	unsigned int nr_blocks;
+	int err;
+
+	err = kstrtouint(val, 0, &nr_blocks);
+	if (err)
+		return err;
+	if (!nr_blocks || nr_blocks > (1 << 18))
+		return -EINVAL;
+
+	return fscrypt_benchmark(nr_blocks);
+}
+
+static int fscrypt_benchmark_get(char *buffer, const struct kernel_param *kp)
+{
+	return scnprintf(buffer, PAGE_SIZE, "%s", fscrypt_benchmark_result);
+}
+
+static const struct kernel_param_ops fscrypt_benchmark_ops = {
+	.set = fscrypt_benchmark_set,
+	.get = fscrypt_benchmark_get,
+};
+
+module_param_cb(benchmark, &fscrypt_benchmark_ops, NULL, 0600);
+MODULE_PARM_DESC(benchmark,
+		"Write a number of pages to measure software en/decryption throughput");
+#endif
+
 /**
  * fscrypt_init() - Set up for fs encryption.
  */
@@ -495,16 +689,23 @@ static int __init fscrypt_init(void)
 {
 	int err = -ENOMEM;
 	/*
-	 * Use an unbound workqueue to allow bios to be decrypted in parallel
-	 * even when they happen to complete on the same CPU.  This sacrifices
-	 * locality, but it's worthwhile since decryption is CPU-intensive.
+	 * By default decrypt each bio on the CPU that completed it, which
+	 * still has the bio and usually the pages in its cache.  Without
+	 * percpu_decrypt, use an unbound workqueue to allow bios to be
+	 * decrypted in parallel even when they happen to complete on the same
+	 * CPU.  That sacrifices locality, which pays off only when completions
+	 * are steered to few CPUs.
 	 *
 	 * Also use a high-priority workqueue to prioritize decryption work,
 	 * which blocks reads from completing, over regular application tasks.
 	 */
-	fscrypt_read_workqueue = alloc_workqueue("fscrypt_read_queue",
-						 WQ_UNBOUND | WQ_HIGHPRI,
-						 num_online_cpus());
+	if (percpu_decrypt)
+		fscrypt_read_workqueue = alloc_workqueue("fscrypt_read_queue",
+							 WQ_HIGHPRI, 0);
+	else
+		fscrypt_read_workqueue = alloc_workqueue("fscrypt_read_queue",
+							 WQ_UNBOUND | WQ_HIGHPRI,
+							 num_online_cpus());
 	if (!fscrypt_read_workqueue)
 		goto fail;
 
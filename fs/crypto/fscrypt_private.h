@@ -16,6 +16,7 @@
 #endif
 #include <linux/fscrypt.h>
 #include <crypto/hash.h>
+#include <crypto/skcipher.h>
 #include <linux/pfk.h>
 #include <linux/atomic.h>
 #include <linux/refcount.h>
@@ -255,6 +256,12 @@ extern int fscrypt_crypt_block(const struct inode *inode,
 			       struct page *src_page, struct page *dest_page,
 			       unsigned int len, unsigned int offs,
 			       gfp_t gfp_flags);
+extern int fscrypt_crypt_pagecache_blocks(struct skcipher_request **reqp,
+					  fscrypt_direction_t rw,
+					  struct page *page,
+					  struct page *dest_page,
+					  unsigned int len, unsigned int offs,
+					  gfp_t gfp_flags);
 extern struct page *fscrypt_alloc_bounce_page(gfp_t gfp_flags);
 extern const struct dentry_operations fscrypt_d_ops;
 
@@ -28,6 +28,7 @@
 #include <linux/slab.h>
 #include <linux/nospec.h>
 #include <linux/backing-dev.h>
+#include <linux/hash.h>
 #include <trace/events/ext4.h>
 
 #ifdef CONFIG_EXT4_DEBUG
@@ -2362,6 +2363,50 @@ const struct file_operations ext4_seq_mb_groups_fops = {
 	.release	= seq_release,
 };
 
+static int ext4_mb_seq_stats_show(struct seq_file *seq, void *v)
+{
+	struct super_block *sb = seq->private;
+	struct ext4_sb_info *sbi = EXT4_SB(sb);
+
+	seq_printf(seq, "mb_stats: %u\n", sbi->s_mb_stats);
+	if (!sbi->s_mb_stats)
+		return 0;
+
+	seq_printf(seq, "reqs: %u\n", atomic_read(&sbi->s_bal_reqs));
+	seq_printf(seq, "success: %u\n", atomic_read(&sbi->s_bal_success));
+	seq_printf(seq, "blocks_allocated: %u\n",
+		   atomic_read(&sbi->s_bal_allocated));
+	seq_printf(seq, "groups_scanned: %u\n",
+		   atomic_read(&sbi->s_bal_groups_scanned));
+	seq_printf(seq, "extents_scanned: %u\n",
+		   atomic_read(&sbi->s_bal_ex_scanned));
+	seq_printf(seq, "goal_hits: %u\n", atomic_read(&sbi->s_bal_goals));
+	seq_printf(seq, "2^n_hits: %u\n", atomic_read(&sbi->s_bal_2orders));
+	seq_printf(seq, "breaks: %u\n", atomic_read(&sbi->s_bal_breaks));
+	seq_printf(seq, "lost: %u\n", atomic_read(&sbi->s_mb_lost_chunks));
+	seq_printf(seq, "prealloc_hits: %u\n",
+		   atomic_read(&sbi->s_bal_pa_hits));
+	seq_printf(seq, "dir_goals: %u\n", atomic_read(&sbi->s_bal_dir_goals));
+	seq_printf(seq, "buddies_generated: %lu\n",
+		   sbi->s_mb_buddies_generated);
+	seq_printf(seq, "preallocated: %u\n",
+		   atomic_read(&sbi->s_mb_preallocated));
+	seq_printf(seq, "discarded: %u\n", atomic_read(&sbi->s_mb_discarded));
+	return 0;
+}
+
+static int ext4_mb_seq_stats_open(struct inode *inode, struct file *file)
+{
+	return single_open(file, ext4_mb_seq_stats_show, PDE_DATA(inode));
+}
+
+const struct file_operations ext4_seq_mb_stats_fops = {
+	.open		= ext4_mb_seq_stats_open,
+	.read		= seq_read,
+	.llseek		= seq_lseek,
+	.release	= single_release,
+};
+
 static struct kmem_cache *get_groupinfo_cache(int blocksize_bits)
 {
 	int cache_index = blocksize_bits - EXT4_MIN_BLOCK_LOG_SIZE;
@@ -3276,6 +3321,9 @@ static void ext4_mb_collect_stats(struct ext4_allocation_context *ac)
 			atomic_inc(&sbi->s_bal_goals);
 		if (ac->ac_found > sbi->s_mb_max_to_scan)
 			atomic_inc(&sbi->s_bal_breaks);
+		atomic_add(ac->ac_groups_scanned, &sbi->s_bal_groups_scanned);
+		if (ac->ac_pa)
+			atomic_inc(&sbi->s_bal_pa_hits);
 	}
 
 	if (ac->ac_op == EXT4_MB_HISTORY_ALLOC)
@@ -4172,6 +4220,47 @@ static inline void ext4_mb_show_ac(struct ext4_allocation_context *ac)
  *
  * One can tune this size via /sys/fs/ext4/<partition>/mb_stream_req
  */
+static unsigned long ext4_mb_parent_dir(struct inode *inode)
+{
+	struct dentry *dentry;
+	unsigned long dir;
+
+	dentry = d_find_any_alias(inode);
+	if (!dentry)
+		return 0;
+
+	spin_lock(&dentry->d_lock);
+	dir = d_inode(dentry->d_parent)->i_ino;
+	spin_unlock(&dentry->d_lock);
+	dput(dentry);
+
+	return dir;
+}
+
+/*
+ * With mb_dir_stream set, small files pick their locality group by parent
+ * directory rather than by CPU. The files of a directory then share the
+ * group preallocation and are laid out one after another, instead of
+ * being spread over the locality groups of whichever CPUs wrote them.
+ */
+static struct ext4_locality_group *
+ext4_mb_locality_group(struct ext4_allocation_context *ac)
+{
+	struct ext4_sb_info *sbi = EXT4_SB(ac->ac_sb);
+	unsigned int cpu;
+
+	if (sbi->s_mb_dir_stream)
+		ac->ac_dir = ext4_mb_parent_dir(ac->ac_inode);
+	if (!ac->ac_dir)
+		return raw_cpu_ptr(sbi->s_locality_groups);
+
+	cpu = hash_long(ac->ac_dir, 32) % nr_cpu_ids;
+	if (!cpu_possible(cpu))
+		cpu = cpumask_first(cpu_possible_mask);
+
+	return per_cpu_ptr(sbi->s_locality_groups, cpu);
+}
+
 static void ext4_mb_group_or_file(struct ext4_allocation_context *ac)
 {
 	struct ext4_sb_info *sbi = EXT4_SB(ac->ac_sb);
@@ -4213,13 +4302,21 @@ static void ext4_mb_group_or_file(struct ext4_allocation_context *ac)
 	 * per cpu locality group is to reduce the contention between block
 	 * request from multiple CPUs.
 	 */
-	ac->ac_lg = raw_cpu_ptr(sbi->s_locality_groups);
+	ac->ac_lg = ext4_mb_locality_group(ac);
 
 	/* we're going to use group allocation */
 	ac->ac_flags |= EXT4_MB_HINT_GROUP_ALLOC;
 
 	/* serialize all allocations in the group */
 	mutex_lock(&ac->ac_lg->lg_mutex);
+
+	/* carry on where the last small file of this directory ended */
+	if (ac->ac_dir && ac->ac_lg->lg_dir == ac->ac_dir) {
+		ac->ac_g_ex.fe_group = ac->ac_lg->lg_goal_group;
+		ac->ac_g_ex.fe_start = ac->ac_lg->lg_goal_start;
+		if (sbi->s_mb_stats)
+			atomic_inc(&sbi->s_bal_dir_goals);
+	}
 }
 
 static noinline_for_stack int
@@ -4275,6 +4372,25 @@ ext4_mb_initialize_context(struct ext4_allocation_context *ac,
 
 }
 
+/* Called under lg_mutex once a mb_dir_stream allocation is done */
+static void ext4_mb_set_dir_goal(struct ext4_allocation_context *ac)
+{
+	struct super_block *sb = ac->ac_sb;
+	struct ext4_locality_group *lg = ac->ac_lg;
+	ext4_group_t group = ac->ac_b_ex.fe_group;
+	ext4_grpblk_t start = ac->ac_b_ex.fe_start + ac->ac_b_ex.fe_len;
+
+	if (start >= EXT4_CLUSTERS_PER_GROUP(sb)) {
+		start = 0;
+		if (++group >= ext4_get_groups_count(sb))
+			group = 0;
+	}
+
+	lg->lg_dir = ac->ac_dir;
+	lg->lg_goal_group = group;
+	lg->lg_goal_start = start;
+}
+
 static noinline_for_stack void
 ext4_mb_discard_lg_preallocations(struct super_block *sb,
 					struct ext4_locality_group *lg,
@@ -4444,8 +4560,11 @@ static int ext4_mb_release_context(struct ext4_allocation_context *ac)
 		put_page(ac->ac_bitmap_page);
 	if (ac->ac_buddy_page)
 		put_page(ac->ac_buddy_page);
-	if (ac->ac_flags & EXT4_MB_HINT_GROUP_ALLOC)
+	if (ac->ac_flags & EXT4_MB_HINT_GROUP_ALLOC) {
+		if (ac->ac_dir && ac->ac_status == AC_STATUS_FOUND)
+			ext4_mb_set_dir_goal(ac);
 		mutex_unlock(&ac->ac_lg->lg_mutex);
+	}
 	ext4_mb_collect_stats(ac);
 	return 0;
 }
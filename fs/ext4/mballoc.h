@@ -144,6 +144,10 @@ struct ext4_locality_group {
 	/* list of preallocations */
 	struct list_head	lg_prealloc_list[PREALLOC_TB_SIZE];
 	spinlock_t		lg_prealloc_lock;
+	/* directory of the last mb_dir_stream allocation and where it ended */
+	unsigned long		lg_dir;
+	ext4_group_t		lg_goal_group;
+	ext4_grpblk_t		lg_goal_start;
 };
 
 struct ext4_allocation_context {
@@ -176,6 +180,7 @@ struct ext4_allocation_context {
 	struct page *ac_buddy_page;
 	struct ext4_prealloc_space *ac_pa;
 	struct ext4_locality_group *ac_lg;
+	unsigned long ac_dir;	/* parent directory, for mb_dir_stream */
 };
 
 #define AC_STATUS_CONTINUE	1
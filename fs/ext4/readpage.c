@@ -43,18 +43,42 @@
 #include <linux/backing-dev.h>
 #include <linux/pagevec.h>
 #include <linux/cleancache.h>
+#include <linux/llist.h>
+#include <linux/mempool.h>
 
 #include "ext4.h"
 #include <trace/events/android_fs.h>
 
-static inline bool ext4_bio_encrypted(struct bio *bio)
-{
-#ifdef CONFIG_FS_ENCRYPTION
-	return unlikely(bio->bi_private != NULL);
-#else
-	return false;
-#endif
-}
+#define NUM_PREALLOC_POST_READ_CTXS	128
+
+static struct kmem_cache *bio_post_read_ctx_cache;
+static mempool_t *bio_post_read_ctx_pool;
+
+/* postprocessing steps for read bios */
+enum bio_post_read_step {
+	STEP_DECRYPT,
+};
+
+struct bio_post_read_ctx {
+	struct bio *bio;
+	struct ext4_sb_info *sbi;
+	struct llist_node node;
+	u64 queued_ns;
+	unsigned int enabled_steps;
+};
+
+/*
+ * Bios that need post-read processing are queued on the CPU that completed
+ * them, and one work item per CPU works through everything queued by the time
+ * it runs, instead of one work item per bio.
+ */
+struct ext4_post_read_queue {
+	struct llist_head bios;
+	struct work_struct work;
+};
+
+static DEFINE_PER_CPU(struct ext4_post_read_queue, ext4_post_read_queue);
+static struct workqueue_struct *ext4_post_read_wq;
 
 static void
 ext4_trace_read_completion(struct bio *bio)
@@ -67,6 +91,72 @@ ext4_trace_read_completion(struct bio *bio)
 					      bio->bi_iter.bi_size);
 }
 
+static void __read_end_io(struct bio *bio)
+{
+	struct bio_vec *bv;
+	int i;
+
+	bio_for_each_segment_all(bv, bio, i) {
+		struct page *page = bv->bv_page;
+
+		/* PG_error was set if any post_read step failed */
+		if (!bio->bi_error && !PageError(page)) {
+			SetPageUptodate(page);
+		} else {
+			ClearPageUptodate(page);
+			SetPageError(page);
+		}
+		unlock_page(page);
+	}
+	if (bio->bi_private)
+		mempool_free(bio->bi_private, bio_post_read_ctx_pool);
+	bio_put(bio);
+}
+
+static void bio_post_read_processing(struct bio_post_read_ctx *ctx)
+{
+	struct ext4_sb_info *sbi = ctx->sbi;
+
+	/* Steps run back to back, in the order their data depends on */
+	if (ctx->enabled_steps & (1 << STEP_DECRYPT))
+		fscrypt_decrypt_bio(ctx->bio);
+
+	atomic64_add(ktime_get_ns() - ctx->queued_ns, &sbi->s_post_read_ns);
+	atomic64_inc(&sbi->s_post_read_bios);
+	__read_end_io(ctx->bio);
+}
+
+static void ext4_post_read_work(struct work_struct *work)
+{
+	struct ext4_post_read_queue *q =
+		container_of(work, struct ext4_post_read_queue, work);
+	struct bio_post_read_ctx *ctx, *next;
+	struct llist_node *batch;
+
+	batch = llist_reverse_order(llist_del_all(&q->bios));
+	llist_for_each_entry_safe(ctx, next, batch, node)
+		bio_post_read_processing(ctx);
+}
+
+static void ext4_queue_post_read(struct bio_post_read_ctx *ctx)
+{
+	int cpu = get_cpu();
+	struct ext4_post_read_queue *q = per_cpu_ptr(&ext4_post_read_queue,
+						     cpu);
+
+	ctx->queued_ns = ktime_get_ns();
+	if (llist_add(&ctx->node, &q->bios))
+		queue_work_on(cpu, ext4_post_read_wq, &q->work);
+	put_cpu();
+}
+
+static bool bio_post_read_required(struct bio *bio)
+{
+	struct bio_post_read_ctx *ctx = bio->bi_private;
+
+	return ctx && ctx->enabled_steps && !bio->bi_error;
+}
+
 /*
  * I/O completion handler for multipage BIOs.
  *
@@ -81,33 +171,33 @@ ext4_trace_read_completion(struct bio *bio)
  */
 static void mpage_end_io(struct bio *bio)
 {
-	struct bio_vec *bv;
-	int i;
-
 	if (trace_android_fs_dataread_start_enabled())
 		ext4_trace_read_completion(bio);
 
-	if (ext4_bio_encrypted(bio)) {
-		if (bio->bi_error) {
-			fscrypt_release_ctx(bio->bi_private);
-		} else {
-			fscrypt_enqueue_decrypt_bio(bio->bi_private, bio);
-			return;
-		}
+	if (bio_post_read_required(bio)) {
+		ext4_queue_post_read(bio->bi_private);
+		return;
 	}
-	bio_for_each_segment_all(bv, bio, i) {
-		struct page *page = bv->bv_page;
+	__read_end_io(bio);
+}
 
-		if (!bio->bi_error) {
-			SetPageUptodate(page);
-		} else {
-			ClearPageUptodate(page);
-			SetPageError(page);
-		}
-		unlock_page(page);
-	}
+static struct bio_post_read_ctx *get_bio_post_read_ctx(struct inode *inode,
+						       struct bio *bio)
+{
+	unsigned int post_read_steps = 0;
+	struct bio_post_read_ctx *ctx = NULL;
 
-	bio_put(bio);
+	if (IS_ENCRYPTED(inode) && S_ISREG(inode->i_mode))
+		post_read_steps |= 1 << STEP_DECRYPT;
+
+	if (post_read_steps) {
+		/* Due to the mempool, this never fails. */
+		ctx = mempool_alloc(bio_post_read_ctx_pool, GFP_NOFS);
+		ctx->bio = bio;
+		ctx->sbi = EXT4_SB(inode->i_sb);
+		ctx->enabled_steps = post_read_steps;
+	}
+	return ctx;
 }
 
 static void
@@ -278,20 +368,13 @@ int ext4_mpage_readpages(struct address_space *mapping,
 			bio = NULL;
 		}
 		if (bio == NULL) {
-			struct fscrypt_ctx *ctx = NULL;
+			struct bio_post_read_ctx *ctx;
 
-			if (IS_ENCRYPTED(inode) && S_ISREG(inode->i_mode)) {
-				ctx = fscrypt_get_ctx(GFP_NOFS);
-				if (IS_ERR(ctx))
-					goto set_error_page;
-			}
 			bio = bio_alloc(GFP_KERNEL,
 				min_t(int, nr_pages, BIO_MAX_PAGES));
-			if (!bio) {
-				if (ctx)
-					fscrypt_release_ctx(ctx);
+			if (!bio)
 				goto set_error_page;
-			}
+			ctx = get_bio_post_read_ctx(inode, bio);
 			bio->bi_bdev = bdev;
 			bio->bi_iter.bi_sector = blocks[0] << (blkbits - 9);
 			bio->bi_end_io = mpage_end_io;
@@ -331,3 +414,45 @@ int ext4_mpage_readpages(struct address_space *mapping,
 		ext4_submit_bio_read(bio);
 	return 0;
 }
+
+int __init ext4_init_post_read_processing(void)
+{
+	int cpu;
+
+	bio_post_read_ctx_cache = KMEM_CACHE(bio_post_read_ctx, 0);
+	if (!bio_post_read_ctx_cache)
+		goto fail;
+	bio_post_read_ctx_pool =
+		mempool_create_slab_pool(NUM_PREALLOC_POST_READ_CTXS,
+					 bio_post_read_ctx_cache);
+	if (!bio_post_read_ctx_pool)
+		goto fail_free_cache;
+
+	/* Bound, so that a bio is processed where it completed */
+	ext4_post_read_wq = alloc_workqueue("ext4_post_read", WQ_HIGHPRI, 0);
+	if (!ext4_post_read_wq)
+		goto fail_free_pool;
+
+	for_each_possible_cpu(cpu) {
+		struct ext4_post_read_queue *q =
+			per_cpu_ptr(&ext4_post_read_queue, cpu);
+
+		init_llist_head(&q->bios);
+		INIT_WORK(&q->work, ext4_post_read_work);
+	}
+	return 0;
+
+fail_free_pool:
+	mempool_destroy(bio_post_read_ctx_pool);
+fail_free_cache:
+	kmem_cache_destroy(bio_post_read_ctx_cache);
+fail:
+	return -ENOMEM;
+}
+
+void ext4_exit_post_read_processing(void)
+{
+	destroy_workqueue(ext4_post_read_wq);
+	mempool_destroy(bio_post_read_ctx_pool);
+	kmem_cache_destroy(bio_post_read_ctx_cache);
+}
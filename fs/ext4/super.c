@@ -5799,6 +5799,10 @@ static int __init ext4_init_fs(void)
 	if (err)
 		goto out5;
 
+	err = ext4_init_post_read_processing();
+	if (err)
+		goto out6;
+
 	err = ext4_init_system_zone();
 	if (err)
 		goto out4;
@@ -5831,6 +5835,8 @@ static int __init ext4_init_fs(void)
 out3:
 	ext4_exit_system_zone();
 out4:
+	ext4_exit_post_read_processing();
+out6:
 	ext4_exit_pageio();
 out5:
 	ext4_exit_es();
@@ -5848,6 +5854,7 @@ static void __exit ext4_exit_fs(void)
 	ext4_exit_mballoc();
 	ext4_exit_sysfs();
 	ext4_exit_system_zone();
+	ext4_exit_post_read_processing();
 	ext4_exit_pageio();
 	ext4_exit_es();
 }
@@ -0,0 +1,1139 @@
+// SPDX-License-Identifier: GPL-2.0
+/*
+ * fs/f2fs/compress.c
+ *
+ * Cluster based transparent compression of regular files.
+ *
+ * A file is split into clusters of 2^i_log_cluster_size pages.  A cluster
+ * which saves at least one block is stored as:
+ *
+ *   slot 0              COMPRESS_ADDR
+ *   slot 1 .. n         compressed data, led by struct compress_data
+ *   slot n + 1 ..       NEW_ADDR
+ *
+ * so every slot of a compressed cluster stays accounted as a valid block,
+ * and a cluster that later turns incompressible can be rewritten in place
+ * without allocating more space.  A cluster which does not compress is
+ * stored as plain data blocks, exactly like a normal file.
+ */
+#include <linux/fs.h>
+#include <linux/sched.h>
+#include <linux/f2fs_fs.h>
+#include <linux/writeback.h>
+#include <linux/backing-dev.h>
+#include <linux/vmalloc.h>
+#include <linux/lz4.h>
+#include <linux/zstd.h>
+
+#include "f2fs.h"
+#include "node.h"
+#include "segment.h"
+#include <trace/events/f2fs.h>
+
+/* zstd parameters are sized for this much input to cap the window */
+#define F2FS_ZSTD_LEVEL		1
+#define F2FS_ZSTD_SRC_HINT	(128 * 1024)
+
+/* one cluster being written or read */
+struct compress_ctx {
+	struct inode *inode;
+	pgoff_t cluster_idx;		/* first page index of the cluster */
+	unsigned int cluster_size;	/* # of pages in a cluster */
+	unsigned int nr_rpages;		/* # of pages within i_size */
+	struct page **rpages;		/* pagecache pages of the cluster */
+	unsigned int nr_cpages;		/* # of compressed pages */
+	struct page **cpages;		/* pages holding compressed data */
+	void *rbuf;			/* virtual mapping of rpages */
+	struct compress_data *cbuf;	/* virtual mapping of cpages */
+	size_t rlen;			/* raw data length */
+	size_t clen;			/* compressed data length */
+};
+
+/* per-bio state of the compressed pages of one cluster */
+struct compress_io_ctx {
+	u32 magic;			/* F2FS_COMPRESSED_PAGE_MAGIC */
+	struct inode *inode;
+	struct page **rpages;		/* pages ending writeback with us */
+	unsigned int nr_rpages;
+	atomic_t pending_pages;		/* compressed pages still in flight */
+};
+
+struct f2fs_compress_ops {
+	int (*compress_pages)(struct compress_ctx *cc, void *ws);
+	int (*decompress_pages)(struct compress_ctx *cc, void *ws);
+};
+
+/* per-cpu workspaces, shared by all mounted instances */
+struct f2fs_compress_ws {
+	void *lz4_wrkmem;
+	ZSTD_CCtx *zstd_cctx;
+	ZSTD_DCtx *zstd_dctx;
+	void *zstd_cwksp;
+	void *zstd_dwksp;
+};
+
+static DEFINE_PER_CPU(struct f2fs_compress_ws, f2fs_compress_ws);
+static DEFINE_MUTEX(f2fs_compress_ws_lock);
+static unsigned int f2fs_compress_ws_users;
+
+static int lz4_compress_pages(struct compress_ctx *cc, void *ws)
+{
+	struct f2fs_compress_ws *cws = ws;
+	int max_len = PAGE_SIZE * cc->nr_cpages - COMPRESS_HEADER_SIZE;
+	int len;
+
+	len = LZ4_compress_default(cc->rbuf, cc->cbuf->cdata, cc->rlen,
+						max_len, cws->lz4_wrkmem);
+	if (!len)
+		return -EAGAIN;
+
+	cc->clen = len;
+	return 0;
+}
+
+static int lz4_decompress_pages(struct compress_ctx *cc, void *ws)
+{
+	int len;
+
+	len = LZ4_decompress_safe(cc->cbuf->cdata, cc->rbuf,
+						cc->clen, cc->rlen);
+	if (len != cc->rlen)
+		return -EIO;
+	return 0;
+}
+
+static int zstd_compress_pages(struct compress_ctx *cc, void *ws)
+{
+	struct f2fs_compress_ws *cws = ws;
+	ZSTD_parameters params = ZSTD_getParams(F2FS_ZSTD_LEVEL,
+						F2FS_ZSTD_SRC_HINT, 0);
+	size_t max_len = PAGE_SIZE * cc->nr_cpages - COMPRESS_HEADER_SIZE;
+	size_t len;
+
+	len = ZSTD_compressCCtx(cws->zstd_cctx, cc->cbuf->cdata, max_len,
+					cc->rbuf, cc->rlen, params);
+	/* an error here mostly means the output did not fit */
+	if (ZSTD_isError(len) || !len)
+		return -EAGAIN;
+
+	cc->clen = len;
+	return 0;
+}
+
+static int zstd_decompress_pages(struct compress_ctx *cc, void *ws)
+{
+	struct f2fs_compress_ws *cws = ws;
+	size_t len;
+
+	len = ZSTD_decompressDCtx(cws->zstd_dctx, cc->rbuf, cc->rlen,
+					cc->cbuf->cdata, cc->clen);
+	if (ZSTD_isError(len) || len != cc->rlen)
+		return -EIO;
+	return 0;
+}
+
+static const struct f2fs_compress_ops *f2fs_cops[COMPRESS_MAX] = {
+	[COMPRESS_LZ4] = &(const struct f2fs_compress_ops) {
+		.compress_pages = lz4_compress_pages,
+		.decompress_pages = lz4_decompress_pages,
+	},
+	[COMPRESS_ZSTD] = &(const struct f2fs_compress_ops) {
+		.compress_pages = zstd_compress_pages,
+		.decompress_pages = zstd_decompress_pages,
+	},
+};
+
+static void free_compress_ws(void)
+{
+	int cpu;
+
+	for_each_possible_cpu(cpu) {
+		struct f2fs_compress_ws *cws = per_cpu_ptr(&f2fs_compress_ws,
+									cpu);
+
+		vfree(cws->lz4_wrkmem);
+		vfree(cws->zstd_cwksp);
+		vfree(cws->zstd_dwksp);
+		memset(cws, 0, sizeof(*cws));
+	}
+}
+
+static int alloc_compress_ws(void)
+{
+	ZSTD_parameters params = ZSTD_getParams(F2FS_ZSTD_LEVEL,
+						F2FS_ZSTD_SRC_HINT, 0);
+	size_t csize = ZSTD_CCtxWorkspaceBound(params.cParams);
+	size_t dsize = ZSTD_DCtxWorkspaceBound();
+	int cpu;
+
+	for_each_possible_cpu(cpu) {
+		struct f2fs_compress_ws *cws = per_cpu_ptr(&f2fs_compress_ws,
+									cpu);
+
+		cws->lz4_wrkmem = vmalloc(LZ4_MEM_COMPRESS);
+		cws->zstd_cwksp = vmalloc(csize);
+		cws->zstd_dwksp = vmalloc(dsize);
+		if (!cws->lz4_wrkmem || !cws->zstd_cwksp || !cws->zstd_dwksp)
+			goto fail;
+
+		cws->zstd_cctx = ZSTD_initCCtx(cws->zstd_cwksp, csize);
+		cws->zstd_dctx = ZSTD_initDCtx(cws->zstd_dwksp, dsize);
+		if (!cws->zstd_cctx || !cws->zstd_dctx)
+			goto fail;
+	}
+	return 0;
+fail:
+	free_compress_ws();
+	return -ENOMEM;
+}
+
+int f2fs_init_compress_ctx(struct f2fs_sb_info *sbi)
+{
+	int err = 0;
+
+	mutex_lock(&f2fs_compress_ws_lock);
+	if (!f2fs_compress_ws_users)
+		err = alloc_compress_ws();
+	if (!err)
+		f2fs_compress_ws_users++;
+	mutex_unlock(&f2fs_compress_ws_lock);
+
+	if (err)
+		f2fs_err(sbi, "Failed to allocate compression workspaces");
+	return err;
+}
+
+void f2fs_destroy_compress_ctx(struct f2fs_sb_info *sbi)
+{
+	mutex_lock(&f2fs_compress_ws_lock);
+	if (!--f2fs_compress_ws_users)
+		free_compress_ws();
+	mutex_unlock(&f2fs_compress_ws_lock);
+}
+
+bool f2fs_is_compressed_page(struct page *page)
+{
+	if (!PagePrivate(page))
+		return false;
+	if (!page_private(page))
+		return false;
+	if (IS_ATOMIC_WRITTEN_PAGE(page) || IS_DUMMY_WRITTEN_PAGE(page))
+		return false;
+	return *((u32 *)page_private(page)) == F2FS_COMPRESSED_PAGE_MAGIC;
+}
+
+static void f2fs_put_rpages(struct compress_ctx *cc)
+{
+	unsigned int i;
+
+	for (i = 0; i < cc->cluster_size; i++) {
+		if (!cc->rpages[i])
+			continue;
+		unlock_page(cc->rpages[i]);
+		put_page(cc->rpages[i]);
+		cc->rpages[i] = NULL;
+	}
+}
+
+static void f2fs_free_cpages(struct compress_ctx *cc)
+{
+	unsigned int i;
+
+	if (!cc->cpages)
+		return;
+
+	for (i = 0; i < cc->nr_cpages; i++)
+		if (cc->cpages[i])
+			__free_page(cc->cpages[i]);
+	kfree(cc->cpages);
+	cc->cpages = NULL;
+}
+
+static int f2fs_alloc_cpages(struct compress_ctx *cc, unsigned int nr)
+{
+	struct f2fs_sb_info *sbi = F2FS_I_SB(cc->inode);
+	unsigned int i;
+
+	cc->nr_cpages = nr;
+	cc->cpages = f2fs_kzalloc(sbi, sizeof(struct page *) * nr, GFP_NOFS);
+	if (!cc->cpages)
+		return -ENOMEM;
+
+	for (i = 0; i < nr; i++) {
+		cc->cpages[i] = alloc_page(GFP_NOFS | __GFP_NOWARN);
+		if (!cc->cpages[i]) {
+			f2fs_free_cpages(cc);
+			return -ENOMEM;
+		}
+	}
+	return 0;
+}
+
+/*
+ * Returns the # of compressed data blocks of the cluster starting at
+ * @cluster_idx and fills @blkaddr with them, 0 if the cluster is not
+ * compressed, or a negative errno.
+ */
+static int f2fs_cluster_blkaddrs(struct inode *inode, pgoff_t cluster_idx,
+							block_t *blkaddr)
+{
+	struct f2fs_sb_info *sbi = F2FS_I_SB(inode);
+	unsigned int cluster_size = F2FS_I(inode)->i_cluster_size;
+	struct dnode_of_data dn;
+	unsigned int i;
+	int nr = 0, err;
+
+	set_new_dnode(&dn, inode, NULL, NULL, 0);
+	err = f2fs_get_dnode_of_data(&dn, cluster_idx, LOOKUP_NODE);
+	if (err)
+		return err == -ENOENT ? 0 : err;
+
+	if (dn.data_blkaddr != COMPRESS_ADDR)
+		goto out;
+
+	for (i = 1; i < cluster_size; i++) {
+		block_t addr = datablock_addr(dn.inode, dn.node_page,
+						dn.ofs_in_node + i);
+
+		if (!__is_valid_data_blkaddr(addr))
+			break;
+		if (!f2fs_is_valid_blkaddr(sbi, addr, DATA_GENERIC_ENHANCE)) {
+			err = -EFSCORRUPTED;
+			goto out;
+		}
+		if (blkaddr)
+			blkaddr[nr] = addr;
+		nr++;
+	}
+
+	if (!nr) {
+		set_sbi_flag(sbi, SBI_NEED_FSCK);
+		f2fs_warn(sbi, "%s: inode (ino=%lx) cluster %lu has no data, run fsck to fix",
+			  __func__, inode->i_ino, cluster_idx);
+		err = -EFSCORRUPTED;
+	}
+out:
+	f2fs_put_dnode(&dn);
+	return err ? err : nr;
+}
+
+bool f2fs_is_compressed_cluster(struct inode *inode, pgoff_t index)
+{
+	pgoff_t cluster_idx = round_down(index, F2FS_I(inode)->i_cluster_size);
+
+	return f2fs_cluster_blkaddrs(inode, cluster_idx, NULL) > 0;
+}
+
+static int f2fs_read_cpages(struct compress_ctx *cc, block_t *blkaddr)
+{
+	struct f2fs_sb_info *sbi = F2FS_I_SB(cc->inode);
+	unsigned int i = 0;
+	int err = 0;
+
+	while (i < cc->nr_cpages) {
+		struct bio *bio = f2fs_bio_alloc(sbi, cc->nr_cpages - i, true);
+		unsigned int start = i;
+
+		f2fs_target_device(sbi, blkaddr[i], bio);
+		bio_set_op_attrs(bio, REQ_OP_READ, 0);
+
+		/* one bio per run of contiguous blocks */
+		do {
+			f2fs_wait_on_block_writeback(cc->inode, blkaddr[i]);
+			if (bio_add_page(bio, cc->cpages[i],
+					PAGE_SIZE, 0) < PAGE_SIZE)
+				break;
+			i++;
+		} while (i < cc->nr_cpages &&
+				blkaddr[i] == blkaddr[i - 1] + 1 &&
+				f2fs_target_device(sbi, blkaddr[i], NULL) ==
+							bio->bi_bdev);
+
+		f2fs_bug_on(sbi, i == start);
+
+		inc_page_count(sbi, F2FS_RD_DATA);
+		err = submit_bio_wait(bio);
+		dec_page_count(sbi, F2FS_RD_DATA);
+		bio_put(bio);
+		if (err)
+			return err;
+	}
+	return 0;
+}
+
+/*
+ * Read the compressed cluster and decompress it into @pages, an array of
+ * cluster_size entries.  Entries which are NULL or already uptodate are
+ * left untouched; the others must be locked and become uptodate.
+ * Returns -EAGAIN if the cluster is not compressed.
+ */
+static int f2fs_read_cluster(struct inode *inode, pgoff_t cluster_idx,
+						struct page **pages)
+{
+	struct f2fs_sb_info *sbi = F2FS_I_SB(inode);
+	const struct f2fs_compress_ops *cops =
+			f2fs_cops[F2FS_I(inode)->i_compress_algorithm];
+	struct compress_ctx cc = {
+		.inode = inode,
+		.cluster_idx = cluster_idx,
+		.cluster_size = F2FS_I(inode)->i_cluster_size,
+	};
+	struct page **dpages;
+	block_t *blkaddr;
+	unsigned int i;
+	struct f2fs_compress_ws *cws;
+	u64 start;
+	int nr, err;
+
+	/* the second half is used to recheck the addresses after the read */
+	blkaddr = f2fs_kzalloc(sbi, sizeof(block_t) * cc.cluster_size * 2,
+								GFP_NOFS);
+	dpages = f2fs_kzalloc(sbi, sizeof(struct page *) * cc.cluster_size,
+								GFP_NOFS);
+	if (!blkaddr || !dpages) {
+		err = -ENOMEM;
+		goto out_free;
+	}
+retry:
+	nr = f2fs_cluster_blkaddrs(inode, cluster_idx, blkaddr);
+	if (nr <= 0) {
+		err = nr ? nr : -EAGAIN;
+		goto out_free;
+	}
+
+	err = f2fs_alloc_cpages(&cc, nr);
+	if (err)
+		goto out_free;
+
+	err = f2fs_read_cpages(&cc, blkaddr);
+	if (err)
+		goto out_cpages;
+
+	/* GC may have moved and reused the blocks while we were reading */
+	if (f2fs_cluster_blkaddrs(inode, cluster_idx,
+				blkaddr + cc.cluster_size) != nr ||
+			memcmp(blkaddr, blkaddr + cc.cluster_size,
+				sizeof(block_t) * nr)) {
+		f2fs_free_cpages(&cc);
+		goto retry;
+	}
+
+	/* decompress straight into the pages that need it */
+	for (i = 0; i < cc.cluster_size; i++) {
+		if (pages[i] && !PageUptodate(pages[i])) {
+			dpages[i] = pages[i];
+			continue;
+		}
+		dpages[i] = alloc_page(GFP_NOFS | __GFP_NOWARN);
+		if (!dpages[i]) {
+			err = -ENOMEM;
+			goto out_dpages;
+		}
+	}
+
+	cc.rlen = PAGE_SIZE << F2FS_I(inode)->i_log_cluster_size;
+	cc.rbuf = vmap(dpages, cc.cluster_size, VM_MAP, PAGE_KERNEL);
+	if (!cc.rbuf) {
+		err = -ENOMEM;
+		goto out_dpages;
+	}
+	cc.cbuf = vmap(cc.cpages, cc.nr_cpages, VM_MAP, PAGE_KERNEL_RO);
+	if (!cc.cbuf) {
+		err = -ENOMEM;
+		goto out_vunmap_rbuf;
+	}
+
+	cc.clen = le32_to_cpu(cc.cbuf->clen);
+	if (cc.clen > PAGE_SIZE * cc.nr_cpages - COMPRESS_HEADER_SIZE) {
+		set_sbi_flag(sbi, SBI_NEED_FSCK);
+		err = -EFSCORRUPTED;
+		goto out_vunmap_cbuf;
+	}
+
+	start = local_clock();
+	cws = get_cpu_ptr(&f2fs_compress_ws);
+	err = cops->decompress_pages(&cc, cws);
+	put_cpu_ptr(&f2fs_compress_ws);
+	stat_inc_decomp_cluster(sbi, local_clock() - start);
+
+	if (err)
+		f2fs_err(sbi, "%s: inode (ino=%lx) cluster %lu failed to decompress, algorithm: %u",
+				__func__, inode->i_ino, cluster_idx,
+				F2FS_I(inode)->i_compress_algorithm);
+out_vunmap_cbuf:
+	vunmap(cc.cbuf);
+out_vunmap_rbuf:
+	vunmap(cc.rbuf);
+out_dpages:
+	for (i = 0; i < cc.cluster_size; i++) {
+		if (!dpages[i])
+			continue;
+		if (dpages[i] == pages[i]) {
+			if (!err) {
+				flush_dcache_page(dpages[i]);
+				SetPageUptodate(dpages[i]);
+			}
+			continue;
+		}
+		__free_page(dpages[i]);
+	}
+out_cpages:
+	f2fs_free_cpages(&cc);
+out_free:
+	kfree(dpages);
+	kfree(blkaddr);
+	return err;
+}
+
+/*
+ * Fill the locked, !uptodate @page from its compressed cluster.  The other
+ * pages of the cluster which can be taken without waiting are filled as
+ * well, so that sequential reads decompress every cluster only once.
+ * @page stays locked; -EAGAIN means the cluster is not compressed.
+ */
+int f2fs_read_compressed_cluster(struct inode *inode, struct page *page)
+{
+	struct f2fs_sb_info *sbi = F2FS_I_SB(inode);
+	struct address_space *mapping = inode->i_mapping;
+	unsigned int cluster_size = F2FS_I(inode)->i_cluster_size;
+	pgoff_t cluster_idx = round_down(page->index, cluster_size);
+	pgoff_t end_idx = DIV_ROUND_UP(i_size_read(inode), PAGE_SIZE);
+	struct page **pages;
+	unsigned int i;
+	int err;
+
+	if (page->index >= end_idx)
+		return -EAGAIN;
+
+	pages = f2fs_kzalloc(sbi, sizeof(struct page *) * cluster_size,
+								GFP_NOFS);
+	if (!pages)
+		return -ENOMEM;
+
+	for (i = 0; i < cluster_size && cluster_idx + i < end_idx; i++) {
+		struct page *p;
+
+		if (cluster_idx + i == page->index) {
+			pages[i] = page;
+			continue;
+		}
+
+		p = pagecache_get_page(mapping, cluster_idx + i,
+				FGP_LOCK | FGP_NOWAIT | FGP_CREAT,
+				readahead_gfp_mask(mapping));
+		if (!p)
+			continue;
+		if (PageUptodate(p)) {
+			f2fs_put_page(p, 1);
+			continue;
+		}
+		pages[i] = p;
+	}
+
+	err = f2fs_read_cluster(inode, cluster_idx, pages);
+
+	for (i = 0; i < cluster_size; i++)
+		if (pages[i] && pages[i] != page)
+			f2fs_put_page(pages[i], 1);
+	kfree(pages);
+	return err;
+}
+
+/* make the pages up to @from of a compressed cluster dirty before truncation */
+int f2fs_truncate_partial_cluster(struct inode *inode, u64 from)
+{
+	unsigned int cluster_size = F2FS_I(inode)->i_cluster_size;
+	pgoff_t index = from >> PAGE_SHIFT;
+	pgoff_t cluster_idx = round_down(index, cluster_size);
+	pgoff_t i;
+
+	if (!(from & ((PAGE_SIZE << F2FS_I(inode)->i_log_cluster_size) - 1)))
+		return 0;
+
+	if (!f2fs_is_compressed_cluster(inode, cluster_idx))
+		return 0;
+
+	/* the tail page is zeroed by truncate_partial_data_page() */
+	for (i = cluster_idx; i < index + !!(from & (PAGE_SIZE - 1)); i++) {
+		struct page *page = read_mapping_page(inode->i_mapping, i, NULL);
+
+		if (IS_ERR(page))
+			return PTR_ERR(page);
+
+		lock_page(page);
+		if (page->mapping == inode->i_mapping) {
+			f2fs_wait_on_page_writeback(page, DATA, true, true);
+			set_page_dirty(page);
+		}
+		f2fs_put_page(page, 1);
+	}
+	return 1;
+}
+
+static void f2fs_set_compressed_page(struct page *page, struct inode *inode,
+				pgoff_t index, struct compress_io_ctx *cic)
+{
+	SetPagePrivate(page);
+	set_page_private(page, (unsigned long)cic);
+
+	/* i_crypto_info and iostat use these fields */
+	page->mapping = inode->i_mapping;
+	page->index = index;
+}
+
+void f2fs_compress_write_end_io(struct bio *bio, struct page *page)
+{
+	struct compress_io_ctx *cic =
+			(struct compress_io_ctx *)page_private(page);
+	struct f2fs_sb_info *sbi = F2FS_I_SB(cic->inode);
+	unsigned int i;
+
+	if (unlikely(bio->bi_error))
+		mapping_set_error(cic->inode->i_mapping, -EIO);
+
+	dec_page_count(sbi, WB_DATA_TYPE(page));
+
+	set_page_private(page, 0);
+	ClearPagePrivate(page);
+	page->mapping = NULL;
+	__free_page(page);
+
+	if (atomic_dec_return(&cic->pending_pages))
+		return;
+
+	for (i = 0; i < cic->nr_rpages; i++) {
+		clear_cold_data(cic->rpages[i]);
+		end_page_writeback(cic->rpages[i]);
+	}
+
+	kfree(cic->rpages);
+	kfree(cic);
+}
+
+/*
+ * Compress the locked, uptodate rpages into cc->cpages.  Returns -EAGAIN
+ * if the cluster does not save at least one block.
+ */
+static int f2fs_compress_pages(struct compress_ctx *cc)
+{
+	struct f2fs_sb_info *sbi = F2FS_I_SB(cc->inode);
+	const struct f2fs_compress_ops *cops =
+			f2fs_cops[F2FS_I(cc->inode)->i_compress_algorithm];
+	struct f2fs_compress_ws *cws;
+	unsigned int i, nr_cpages;
+	u64 start = local_clock();
+	int err;
+
+	err = f2fs_alloc_cpages(cc, cc->cluster_size - 1);
+	if (err)
+		return err;
+
+	cc->rlen = PAGE_SIZE << F2FS_I(cc->inode)->i_log_cluster_size;
+	cc->rbuf = vmap(cc->rpages, cc->cluster_size, VM_MAP, PAGE_KERNEL_RO);
+	if (!cc->rbuf) {
+		err = -ENOMEM;
+		goto out_free;
+	}
+	cc->cbuf = vmap(cc->cpages, cc->nr_cpages, VM_MAP, PAGE_KERNEL);
+	if (!cc->cbuf) {
+		err = -ENOMEM;
+		goto out_vunmap_rbuf;
+	}
+
+	cws = get_cpu_ptr(&f2fs_compress_ws);
+	err = cops->compress_pages(cc, cws);
+	put_cpu_ptr(&f2fs_compress_ws);
+	if (err)
+		goto out_vunmap_cbuf;
+
+	cc->cbuf->clen = cpu_to_le32(cc->clen);
+	memset(cc->cbuf->reserved, 0, sizeof(cc->cbuf->reserved));
+
+	nr_cpages = DIV_ROUND_UP(cc->clen + COMPRESS_HEADER_SIZE, PAGE_SIZE);
+
+	/* zero the tail of the last page so no stale data goes to disk */
+	memset(&cc->cbuf->cdata[cc->clen], 0,
+		nr_cpages * PAGE_SIZE - cc->clen - COMPRESS_HEADER_SIZE);
+
+	vunmap(cc->cbuf);
+	vunmap(cc->rbuf);
+
+	for (i = nr_cpages; i < cc->nr_cpages; i++) {
+		__free_page(cc->cpages[i]);
+		cc->cpages[i] = NULL;
+	}
+	cc->nr_cpages = nr_cpages;
+
+	stat_inc_compr_cluster(sbi, local_clock() - start);
+	return 0;
+
+out_vunmap_cbuf:
+	vunmap(cc->cbuf);
+out_vunmap_rbuf:
+	vunmap(cc->rbuf);
+out_free:
+	f2fs_free_cpages(cc);
+	return err;
+}
+
+/* # of slots of a compressed cluster without a data block of their own */
+static unsigned int f2fs_cluster_saved_blocks(struct dnode_of_data *dn,
+						unsigned int cluster_size)
+{
+	unsigned int i, saved = 0;
+
+	if (datablock_addr(dn->inode, dn->node_page,
+				dn->ofs_in_node) != COMPRESS_ADDR)
+		return 0;
+
+	for (i = 0; i < cluster_size; i++) {
+		block_t addr = datablock_addr(dn->inode, dn->node_page,
+						dn->ofs_in_node + i);
+
+		if (addr == COMPRESS_ADDR || addr == NEW_ADDR)
+			saved++;
+	}
+	return saved;
+}
+
+static int f2fs_write_compressed_pages(struct compress_ctx *cc,
+					bool *submitted,
+					enum iostat_type io_type)
+{
+	struct inode *inode = cc->inode;
+	struct f2fs_sb_info *sbi = F2FS_I_SB(inode);
+	struct f2fs_io_info fio = {
+		.sbi = sbi,
+		.ino = inode->i_ino,
+		.type = DATA,
+		.op = REQ_OP_WRITE,
+		.op_flags = 0,
+		.need_lock = LOCK_DONE,
+		.io_type = io_type,
+		.encrypted_page = NULL,
+		.submitted = false,
+	};
+	struct compress_io_ctx *cic;
+	struct dnode_of_data dn;
+	struct node_info ni;
+	unsigned int i, ofs, nr_null = 0, old_saved, new_saved;
+	int err;
+
+	set_new_dnode(&dn, inode, NULL, NULL, 0);
+	err = f2fs_get_dnode_of_data(&dn, cc->cluster_idx, ALLOC_NODE);
+	if (err)
+		return err;
+
+	err = f2fs_get_node_info(sbi, dn.nid, &ni);
+	if (err)
+		goto out_put_dnode;
+	fio.version = ni.version;
+
+	ofs = dn.ofs_in_node;
+	for (i = 0; i < cc->cluster_size; i++)
+		if (datablock_addr(dn.inode, dn.node_page, ofs + i) == NULL_ADDR)
+			nr_null++;
+
+	if (nr_null) {
+		err = f2fs_reserve_new_blocks(&dn, nr_null);
+		dn.ofs_in_node = ofs;
+		if (err)
+			goto out_put_dnode;
+		for (i = 0; i < cc->cluster_size; i++) {
+			if (datablock_addr(dn.inode, dn.node_page,
+						ofs + i) == NULL_ADDR) {
+				err = -ENOSPC;
+				goto out_put_dnode;
+			}
+		}
+	}
+
+	cic = f2fs_kzalloc(sbi, sizeof(struct compress_io_ctx), GFP_NOFS);
+	if (!cic) {
+		err = -ENOMEM;
+		goto out_put_dnode;
+	}
+	cic->rpages = f2fs_kzalloc(sbi, sizeof(struct page *) *
+					cc->cluster_size, GFP_NOFS);
+	if (!cic->rpages) {
+		kfree(cic);
+		err = -ENOMEM;
+		goto out_put_dnode;
+	}
+	cic->magic = F2FS_COMPRESSED_PAGE_MAGIC;
+	cic->inode = inode;
+	cic->nr_rpages = cc->cluster_size;
+	memcpy(cic->rpages, cc->rpages,
+			sizeof(struct page *) * cc->cluster_size);
+	atomic_set(&cic->pending_pages, cc->nr_cpages);
+
+	old_saved = f2fs_cluster_saved_blocks(&dn, cc->cluster_size);
+	new_saved = cc->cluster_size - cc->nr_cpages;
+
+	for (i = 0; i < cc->cluster_size; i++) {
+		set_page_writeback(cc->rpages[i]);
+		ClearPageError(cc->rpages[i]);
+	}
+	for (i = 0; i < cc->nr_cpages; i++)
+		f2fs_set_compressed_page(cc->cpages[i], inode,
+					cc->rpages[i + 1]->index, cic);
+
+	for (i = 0; i < cc->cluster_size; i++, dn.ofs_in_node++) {
+		block_t blkaddr = datablock_addr(dn.inode, dn.node_page,
+							dn.ofs_in_node);
+
+		dn.data_blkaddr = blkaddr;
+
+		if (i && i <= cc->nr_cpages) {
+			fio.page = cc->rpages[i];
+			fio.compressed_page = cc->cpages[i - 1];
+			fio.old_blkaddr = blkaddr;
+			f2fs_outplace_write_data(&dn, &fio);
+			continue;
+		}
+
+		if (__is_valid_data_blkaddr(blkaddr))
+			f2fs_invalidate_blocks(sbi, blkaddr);
+		f2fs_update_data_blkaddr(&dn, i ? NEW_ADDR : COMPRESS_ADDR);
+	}
+
+	/* the cpages belong to the bios now */
+	cc->nr_cpages = 0;
+	kfree(cc->cpages);
+	cc->cpages = NULL;
+
+	if (new_saved > old_saved)
+		f2fs_i_compr_blocks_update(inode, new_saved - old_saved, true);
+	else if (new_saved < old_saved)
+		f2fs_i_compr_blocks_update(inode, old_saved - new_saved, false);
+
+	*submitted = fio.submitted;
+	trace_f2fs_do_write_data_page(cc->rpages[0], OPU);
+out_put_dnode:
+	f2fs_put_dnode(&dn);
+	return err;
+}
+
+/*
+ * Write the pages of the cluster as plain blocks.  If the cluster is
+ * compressed on disk, its slots are first turned back into per-page ones.
+ */
+static int f2fs_write_raw_cluster(struct compress_ctx *cc, bool compressed,
+				bool *submitted, struct writeback_control *wbc,
+				enum iostat_type io_type)
+{
+	struct inode *inode = cc->inode;
+	struct f2fs_sb_info *sbi = F2FS_I_SB(inode);
+	unsigned int i;
+	int err = 0;
+
+	if (compressed) {
+		struct dnode_of_data dn;
+		unsigned int saved;
+
+		set_new_dnode(&dn, inode, NULL, NULL, 0);
+		err = f2fs_get_dnode_of_data(&dn, cc->cluster_idx, LOOKUP_NODE);
+		if (err)
+			return err;
+
+		saved = f2fs_cluster_saved_blocks(&dn, cc->cluster_size);
+
+		/* slot 0 keeps its block accounted as a reserved one */
+		f2fs_update_data_blkaddr(&dn, NEW_ADDR);
+
+		/* slots beyond i_size go away with the compressed data */
+		if (cc->nr_rpages < cc->cluster_size) {
+			dn.ofs_in_node += cc->nr_rpages;
+			f2fs_truncate_data_blocks_range(&dn,
+					cc->cluster_size - cc->nr_rpages);
+		}
+		f2fs_put_dnode(&dn);
+
+		if (saved)
+			f2fs_i_compr_blocks_update(inode, saved, false);
+	}
+
+	for (i = 0; i < cc->nr_rpages; i++) {
+		struct f2fs_io_info fio = {
+			.sbi = sbi,
+			.ino = inode->i_ino,
+			.type = DATA,
+			.op = REQ_OP_WRITE,
+			.op_flags = wbc_to_write_flags(wbc),
+			.old_blkaddr = NULL_ADDR,
+			.page = cc->rpages[i],
+			.encrypted_page = NULL,
+			.submitted = false,
+			.need_lock = LOCK_DONE,
+			.io_type = io_type,
+			.io_wbc = wbc,
+		};
+
+		err = f2fs_do_write_data_page(&fio);
+		if (err) {
+			/* the remaining pages are written next time */
+			for (; i < cc->nr_rpages; i++)
+				redirty_page_for_writepage(wbc, cc->rpages[i]);
+			break;
+		}
+		if (fio.submitted)
+			*submitted = true;
+	}
+	return err;
+}
+
+/*
+ * Lock the cached pages of the cluster in index order.  Returns false if
+ * nothing in the cluster needs to be written, or if it would have to wait
+ * for WB_SYNC_NONE writeback.
+ */
+static bool f2fs_lock_cluster(struct compress_ctx *cc,
+				struct writeback_control *wbc)
+{
+	struct address_space *mapping = cc->inode->i_mapping;
+	bool dirty = false;
+	unsigned int i;
+
+	for (i = 0; i < cc->cluster_size; i++) {
+		struct page *page = find_get_page(mapping, cc->cluster_idx + i);
+
+		if (!page)
+			continue;
+
+		if (wbc->sync_mode == WB_SYNC_NONE) {
+			if (!trylock_page(page)) {
+				put_page(page);
+				goto out_put;
+			}
+		} else {
+			lock_page(page);
+		}
+
+		if (unlikely(page->mapping != mapping)) {
+			f2fs_put_page(page, 1);
+			continue;
+		}
+		cc->rpages[i] = page;
+		if (PageDirty(page))
+			dirty = true;
+	}
+
+	if (!dirty)
+		goto out_put;
+
+	for (i = 0; i < cc->cluster_size; i++) {
+		if (!cc->rpages[i] || !PageWriteback(cc->rpages[i]))
+			continue;
+		if (wbc->sync_mode == WB_SYNC_NONE)
+			goto out_put;
+		f2fs_wait_on_page_writeback(cc->rpages[i], DATA, true, true);
+	}
+	return true;
+out_put:
+	f2fs_put_rpages(cc);
+	return false;
+}
+
+/* write the dirty pages one by one, as if the file were not compressed */
+static int f2fs_write_raw_pages(struct compress_ctx *cc, bool *submitted,
+				struct bio **bio, sector_t *last_block,
+				struct writeback_control *wbc,
+				enum iostat_type io_type, int *written)
+{
+	unsigned int i;
+	int err = 0;
+
+	for (i = 0; i < cc->cluster_size; i++) {
+		struct page *page = cc->rpages[i];
+		bool _submitted = false;
+		int ret;
+
+		if (!page)
+			continue;
+		cc->rpages[i] = NULL;
+
+		if (err || !PageDirty(page) || !clear_page_dirty_for_io(page)) {
+			f2fs_put_page(page, 1);
+			continue;
+		}
+
+		ret = f2fs_write_single_data_page(page, &_submitted, bio,
+				last_block, wbc, io_type, false);
+		if (ret == AOP_WRITEPAGE_ACTIVATE) {
+			unlock_page(page);
+			ret = 0;
+		}
+		put_page(page);
+
+		if (ret == -EAGAIN) {
+			/* let the caller retry what is still dirty */
+			err = ret;
+			continue;
+		}
+		if (ret) {
+			err = ret;
+			continue;
+		}
+		if (_submitted)
+			*submitted = true;
+		(*written)++;
+	}
+	return err;
+}
+
+/*
+ * ->writepages for a compressed file works on whole clusters.  @index is
+ * any page of the cluster; the pages of the cluster are locked here, so
+ * the caller must not hold any of them.  Returns -EAGAIN when the caller
+ * should retry, like f2fs_write_single_data_page().
+ */
+int f2fs_write_cluster(struct inode *inode, pgoff_t index, bool *submitted,
+				struct bio **bio, sector_t *last_block,
+				struct writeback_control *wbc,
+				enum iostat_type io_type)
+{
+	struct f2fs_sb_info *sbi = F2FS_I_SB(inode);
+	unsigned int cluster_size = F2FS_I(inode)->i_cluster_size;
+	pgoff_t end_idx = DIV_ROUND_UP(i_size_read(inode), PAGE_SIZE);
+	struct compress_ctx cc = {
+		.inode = inode,
+		.cluster_idx = round_down(index, cluster_size),
+		.cluster_size = cluster_size,
+	};
+	unsigned int i, offset;
+	bool compressed = false, need_balance_fs = !wbc->for_reclaim;
+	int written = 0;
+	int err = 0;
+
+	if (cc.cluster_idx < end_idx)
+		cc.nr_rpages = min_t(pgoff_t, cluster_size,
+					end_idx - cc.cluster_idx);
+
+	cc.rpages = f2fs_kzalloc(sbi, sizeof(struct page *) * cluster_size,
+								GFP_NOFS);
+	if (!cc.rpages)
+		return -ENOMEM;
+
+	if (!f2fs_lock_cluster(&cc, wbc))
+		goto out_free;
+
+	if (unlikely(f2fs_cp_error(sbi) ||
+			is_sbi_flag_set(sbi, SBI_POR_DOING) || !cc.nr_rpages))
+		goto write_raw;
+
+	compressed = f2fs_is_compressed_cluster(inode, cc.cluster_idx);
+
+	if (!compressed) {
+		/* only a fully dirty cluster is worth compressing */
+		if (cc.nr_rpages < cluster_size)
+			goto write_raw;
+		for (i = 0; i < cluster_size; i++)
+			if (!cc.rpages[i] || !PageDirty(cc.rpages[i]) ||
+					!PageUptodate(cc.rpages[i]))
+				goto write_raw;
+	} else {
+		/* the whole cluster is rewritten, so bring in what is missing */
+		for (i = 0; i < cc.nr_rpages; i++) {
+			if (cc.rpages[i])
+				continue;
+			cc.rpages[i] = pagecache_get_page(inode->i_mapping,
+					cc.cluster_idx + i, FGP_LOCK | FGP_CREAT |
+					(wbc->sync_mode == WB_SYNC_NONE ?
+					FGP_NOWAIT : 0), GFP_NOFS);
+			if (!cc.rpages[i]) {
+				err = -EAGAIN;
+				goto out_unlock;
+			}
+		}
+		for (i = 0; i < cc.nr_rpages; i++) {
+			if (!PageUptodate(cc.rpages[i])) {
+				err = f2fs_read_cluster(inode, cc.cluster_idx,
+								cc.rpages);
+				if (err)
+					goto out_unlock;
+				break;
+			}
+		}
+	}
+
+	/* pages beyond i_size are simply dropped */
+	for (i = cc.nr_rpages; i < cluster_size; i++) {
+		if (!cc.rpages[i])
+			continue;
+		if (clear_page_dirty_for_io(cc.rpages[i]))
+			inode_dec_dirty_pages(inode);
+		f2fs_put_page(cc.rpages[i], 1);
+		cc.rpages[i] = NULL;
+	}
+
+	for (i = 0; i < cc.nr_rpages; i++)
+		if (clear_page_dirty_for_io(cc.rpages[i]))
+			inode_dec_dirty_pages(inode);
+
+	offset = i_size_read(inode) & (PAGE_SIZE - 1);
+	if (offset && cc.cluster_idx + cc.nr_rpages == end_idx)
+		zero_user_segment(cc.rpages[cc.nr_rpages - 1],
+						offset, PAGE_SIZE);
+
+	if (cc.nr_rpages == cluster_size) {
+		err = f2fs_compress_pages(&cc);
+		if (err == -EAGAIN)
+			stat_inc_compr_raw_cluster(sbi);
+		else if (err)
+			goto out_redirty;
+	}
+
+	if (!f2fs_trylock_op(sbi)) {
+		err = -EAGAIN;
+		goto out_redirty;
+	}
+
+	if (cc.cpages)
+		err = f2fs_write_compressed_pages(&cc, submitted, io_type);
+	else
+		err = f2fs_write_raw_cluster(&cc, compressed, submitted,
+							wbc, io_type);
+	f2fs_unlock_op(sbi);
+
+	if (err) {
+		file_set_keep_isize(inode);
+		if (cc.cpages)
+			goto out_redirty;
+		goto out_unlock;
+	}
+
+	written = cc.nr_rpages;
+	down_write(&F2FS_I(inode)->i_sem);
+	if (F2FS_I(inode)->last_disk_size <
+			(loff_t)(cc.cluster_idx + cc.nr_rpages) << PAGE_SHIFT)
+		F2FS_I(inode)->last_disk_size =
+			(loff_t)(cc.cluster_idx + cc.nr_rpages) << PAGE_SHIFT;
+	up_write(&F2FS_I(inode)->i_sem);
+
+	set_inode_flag(inode, FI_APPEND_WRITE);
+	if (!cc.cluster_idx)
+		set_inode_flag(inode, FI_FIRST_BLOCK_WRITTEN);
+	goto out_unlock;
+
+write_raw:
+	err = f2fs_write_raw_pages(&cc, submitted, bio, last_block, wbc,
+							io_type, &written);
+	goto out_unlock;
+
+out_redirty:
+	for (i = 0; i < cc.nr_rpages; i++)
+		redirty_page_for_writepage(wbc, cc.rpages[i]);
+out_unlock:
+	f2fs_free_cpages(&cc);
+	f2fs_put_rpages(&cc);
+
+	/* the caller accounts one page */
+	if (written > 1)
+		wbc->nr_to_write -= written - 1;
+
+	if (!F2FS_I(inode)->cp_task)
+		f2fs_balance_fs(sbi, need_balance_fs);
+out_free:
+	kfree(cc.rpages);
+	return err;
+}
@@ -239,6 +239,11 @@ static void f2fs_write_end_io(struct bio *bio)
 
 		fscrypt_finalize_bounce_page(&page);
 
+		if (f2fs_is_compressed_page(page)) {
+			f2fs_compress_write_end_io(bio, page);
+			continue;
+		}
+
 		if (unlikely(bio->bi_error)) {
 			mapping_set_error(page->mapping, -EIO);
 			if (type == F2FS_WB_CP_DATA)
@@ -449,6 +454,12 @@ static bool __has_merged_page(struct bio *bio, struct inode *inode,
 			return true;
 		if (page && page == target)
 			return true;
+		/* the pagecache pages of a cluster wait on its compressed pages */
+		if (page && page->mapping && f2fs_is_compressed_page(target) &&
+			page->mapping == target->mapping &&
+			(page->index >> F2FS_I(page->mapping->host)->i_log_cluster_size) ==
+			(target->index >> F2FS_I(page->mapping->host)->i_log_cluster_size))
+			return true;
 		if (ino && ino == ino_of_node(target))
 			return true;
 	}
@@ -809,7 +820,12 @@ void f2fs_submit_page_write(struct f2fs_io_info *fio)
 
 	verify_fio_blkaddr(fio);
 
-	bio_page = fio->encrypted_page ? fio->encrypted_page : fio->page;
+	if (fio->compressed_page)
+		bio_page = fio->compressed_page;
+	else if (fio->encrypted_page)
+		bio_page = fio->encrypted_page;
+	else
+		bio_page = fio->page;
 	fio->op_flags |= fio->encrypted_page ? REQ_NOENCRYPT : 0;
 
 	inode = fio->page->mapping->host;
@@ -1049,6 +1065,16 @@ struct page *f2fs_get_read_data_page(struct inode *inode, pgoff_t index,
 	if (!page)
 		return ERR_PTR(-ENOMEM);
 
+	if (f2fs_compressed_file(inode) && !PageUptodate(page)) {
+		err = f2fs_read_compressed_cluster(inode, page);
+		if (!err) {
+			unlock_page(page);
+			return page;
+		}
+		if (err != -EAGAIN)
+			goto put_err;
+	}
+
 	if (f2fs_lookup_extent_cache(inode, index, &ei)) {
 		dn.data_blkaddr = ei.blk + index - ei.fofs;
 		if (!f2fs_is_valid_blkaddr(F2FS_I_SB(inode), dn.data_blkaddr,
@@ -1345,6 +1371,10 @@ int f2fs_map_blocks(struct inode *inode, struct f2fs_map_blocks *map,
 	struct extent_info ei = {0,0,0};
 	block_t blkaddr;
 	unsigned int start_pgofs;
+	/* a read that missed the extent cache fills it from the dnode */
+	bool fill_cache = flag == F2FS_GET_BLOCK_PRECACHE ||
+			(!create && flag == F2FS_GET_BLOCK_DEFAULT &&
+			!f2fs_readonly(sbi->sb));
 
 	if (!maxblocks)
 		return 0;
@@ -1451,7 +1481,8 @@ int f2fs_map_blocks(struct inode *inode, struct f2fs_map_blocks *map,
 			if (flag == F2FS_GET_BLOCK_PRECACHE)
 				goto sync_out;
 			if (flag == F2FS_GET_BLOCK_FIEMAP &&
-						blkaddr == NULL_ADDR) {
+					(blkaddr == NULL_ADDR ||
+					blkaddr == COMPRESS_ADDR)) {
 				if (map->m_next_pgofs)
 					*map->m_next_pgofs = pgofs + 1;
 				goto sync_out;
@@ -1512,14 +1543,13 @@ int f2fs_map_blocks(struct inode *inode, struct f2fs_map_blocks *map,
 	else if (dn.ofs_in_node < end_offset)
 		goto next_block;
 
-	if (flag == F2FS_GET_BLOCK_PRECACHE) {
-		if (map->m_flags & F2FS_MAP_MAPPED) {
-			unsigned int ofs = start_pgofs - map->m_lblk;
+	if (fill_cache && (map->m_flags & F2FS_MAP_MAPPED) &&
+			map->m_lblk + map->m_len > start_pgofs) {
+		unsigned int ofs = start_pgofs - map->m_lblk;
 
-			f2fs_update_extent_cache_range(&dn,
-				start_pgofs, map->m_pblk + ofs,
-				map->m_len - ofs);
-		}
+		f2fs_update_extent_cache_range(&dn,
+			start_pgofs, map->m_pblk + ofs,
+			map->m_len - ofs);
 	}
 
 	f2fs_put_dnode(&dn);
@@ -1537,17 +1567,16 @@ int f2fs_map_blocks(struct inode *inode, struct f2fs_map_blocks *map,
 		f2fs_wait_on_block_writeback_range(inode,
 						map->m_pblk, map->m_len);
 
-	if (flag == F2FS_GET_BLOCK_PRECACHE) {
-		if (map->m_flags & F2FS_MAP_MAPPED) {
-			unsigned int ofs = start_pgofs - map->m_lblk;
+	if (fill_cache && (map->m_flags & F2FS_MAP_MAPPED) &&
+			map->m_lblk + map->m_len > start_pgofs) {
+		unsigned int ofs = start_pgofs - map->m_lblk;
 
-			f2fs_update_extent_cache_range(&dn,
-				start_pgofs, map->m_pblk + ofs,
-				map->m_len - ofs);
-		}
-		if (map->m_next_extent)
-			*map->m_next_extent = pgofs + 1;
+		f2fs_update_extent_cache_range(&dn,
+			start_pgofs, map->m_pblk + ofs,
+			map->m_len - ofs);
 	}
+	if (flag == F2FS_GET_BLOCK_PRECACHE && map->m_next_extent)
+		*map->m_next_extent = pgofs + 1;
 	f2fs_put_dnode(&dn);
 unlock_out:
 	if (map->m_may_create) {
@@ -1985,9 +2014,20 @@ static int f2fs_mpage_readpages(struct address_space *mapping,
 				goto next_page;
 		}
 
+		if (f2fs_compressed_file(inode)) {
+			ret = f2fs_read_compressed_cluster(inode, page);
+			if (!ret) {
+				unlock_page(page);
+				goto next_page;
+			}
+			if (ret != -EAGAIN)
+				goto set_error_page;
+		}
+
 		ret = f2fs_read_single_page(inode, page, nr_pages, &map, &bio,
 					&last_block_in_bio, is_readahead);
 		if (ret) {
+set_error_page:
 			SetPageError(page);
 			zero_user_segment(page, 0, PAGE_SIZE);
 			unlock_page(page);
@@ -2010,6 +2050,8 @@ static int f2fs_read_data_page(struct file *file, struct page *page)
 
 	trace_f2fs_readpage(page, DATA);
 
+	f2fs_update_fg_io(F2FS_I_SB(inode));
+
 	/* If the file has inline data, try to read it directly */
 	if (f2fs_has_inline_data(inode))
 		ret = f2fs_read_inline_data(inode, page);
@@ -2028,6 +2070,8 @@ static int f2fs_read_data_pages(struct file *file,
 
 	trace_f2fs_readpages(inode, page, nr_pages);
 
+	f2fs_update_fg_io(F2FS_I_SB(inode));
+
 	/* If the file has inline data, skip readpages */
 	if (f2fs_has_inline_data(inode))
 		return 0;
@@ -2137,6 +2181,8 @@ bool f2fs_should_update_outplace(struct inode *inode, struct f2fs_io_info *fio)
 		return true;
 	if (f2fs_is_atomic_file(inode))
 		return true;
+	if (f2fs_compressed_file(inode))
+		return true;
 	if (fio) {
 		if (is_cold_data(fio->page))
 			return true;
@@ -2270,11 +2316,12 @@ int f2fs_do_write_data_page(struct f2fs_io_info *fio)
 	return err;
 }
 
-static int __write_data_page(struct page *page, bool *submitted,
+int f2fs_write_single_data_page(struct page *page, bool *submitted,
 				struct bio **bio,
 				sector_t *last_block,
 				struct writeback_control *wbc,
-				enum iostat_type io_type)
+				enum iostat_type io_type,
+				bool allow_balance)
 {
 	struct inode *inode = page->mapping->host;
 	struct f2fs_sb_info *sbi = F2FS_I_SB(inode);
@@ -2398,7 +2445,7 @@ static int __write_data_page(struct page *page, bool *submitted,
 
 	unlock_page(page);
 	if (!S_ISDIR(inode->i_mode) && !IS_NOQUOTA(inode) &&
-					!F2FS_I(inode)->cp_task)
+			!F2FS_I(inode)->cp_task && allow_balance)
 		f2fs_balance_fs(sbi, need_balance_fs);
 
 	if (unlikely(f2fs_cp_error(sbi))) {
@@ -2429,7 +2476,19 @@ static int __write_data_page(struct page *page, bool *submitted,
 static int f2fs_write_data_page(struct page *page,
 					struct writeback_control *wbc)
 {
-	return __write_data_page(page, NULL, NULL, NULL, wbc, FS_DATA_IO);
+	struct inode *inode = page->mapping->host;
+
+	/* clusters are only written through ->writepages */
+	if (f2fs_compressed_file(inode)) {
+		redirty_page_for_writepage(wbc, page);
+		if (wbc->for_reclaim)
+			return AOP_WRITEPAGE_ACTIVATE;
+		unlock_page(page);
+		return 0;
+	}
+
+	return f2fs_write_single_data_page(page, NULL, NULL, NULL, wbc,
+						FS_DATA_IO, true);
 }
 
 /*
@@ -2456,6 +2515,7 @@ static int f2fs_write_cache_pages(struct address_space *mapping,
 	int range_whole = 0;
 	int tag;
 	int nwritten = 0;
+	pgoff_t last_cluster;
 
 	pagevec_init(&pvec, 0);
 
@@ -2488,6 +2548,7 @@ static int f2fs_write_cache_pages(struct address_space *mapping,
 	if (wbc->sync_mode == WB_SYNC_ALL || wbc->tagged_writepages)
 		tag_pages_for_writeback(mapping, index, end);
 	done_index = index;
+	last_cluster = ULONG_MAX;
 	while (!done && (index <= end)) {
 		int i;
 
@@ -2508,7 +2569,24 @@ static int f2fs_write_cache_pages(struct address_space *mapping,
 			}
 
 			done_index = page->index;
+
+			if (f2fs_compressed_file(mapping->host)) {
+				pgoff_t cluster_idx = page->index >>
+					F2FS_I(mapping->host)->i_log_cluster_size;
+
+				/* the whole cluster went out with its first page */
+				if (cluster_idx == last_cluster)
+					continue;
+				last_cluster = cluster_idx;
+			}
 retry_write:
+			if (f2fs_compressed_file(mapping->host)) {
+				ret = f2fs_write_cluster(mapping->host,
+						page->index, &submitted, &bio,
+						&last_block, wbc, io_type);
+				goto check_result;
+			}
+
 			lock_page(page);
 
 			if (unlikely(page->mapping != mapping)) {
@@ -2533,8 +2611,9 @@ static int f2fs_write_cache_pages(struct address_space *mapping,
 			if (!clear_page_dirty_for_io(page))
 				goto continue_unlock;
 
-			ret = __write_data_page(page, &submitted, &bio,
-					&last_block, wbc, io_type);
+			ret = f2fs_write_single_data_page(page, &submitted,
+					&bio, &last_block, wbc, io_type, true);
+check_result:
 			if (unlikely(ret)) {
 				/*
 				 * keep nr_to_write, since vfs uses this to
@@ -2879,6 +2958,15 @@ static int f2fs_write_begin(struct file *file, struct address_space *mapping,
 		return 0;
 	}
 
+	if (f2fs_compressed_file(inode)) {
+		err = f2fs_read_compressed_cluster(inode, page);
+		if (!err)
+			return 0;
+		if (err != -EAGAIN)
+			goto fail;
+		err = 0;
+	}
+
 	if (blkaddr == NEW_ADDR) {
 		zero_user_segment(page, 0, PAGE_SIZE);
 		SetPageUptodate(page);
@@ -3193,7 +3281,7 @@ static sector_t f2fs_bmap(struct address_space *mapping, sector_t block)
 {
 	struct inode *inode = mapping->host;
 
-	if (f2fs_has_inline_data(inode))
+	if (f2fs_has_inline_data(inode) || f2fs_compressed_file(inode))
 		return 0;
 
 	/* make sure allocating whole blocks */
@@ -3362,6 +3450,9 @@ static int f2fs_swap_activate(struct swap_info_struct *sis, struct file *file,
 	if (f2fs_readonly(F2FS_I_SB(inode)->sb))
 		return -EROFS;
 
+	if (f2fs_compressed_file(inode))
+		return -EINVAL;
+
 	ret = f2fs_convert_inline_inode(inode);
 	if (ret)
 		return ret;
@@ -78,6 +78,10 @@ static void update_general_status(struct f2fs_sb_info *sbi)
 	si->hit_rbtree = atomic64_read(&sbi->read_hit_rbtree);
 	si->hit_total = si->hit_largest + si->hit_cached + si->hit_rbtree;
 	si->total_ext = atomic64_read(&sbi->total_hit_ext);
+	si->nat_hit = atomic64_read(&sbi->nat_hit);
+	si->nat_journal_hit = atomic64_read(&sbi->nat_journal_hit);
+	si->nat_blk_read = atomic64_read(&sbi->nat_blk_read);
+	si->nat_ra = atomic64_read(&sbi->nat_ra);
 	si->ext_tree = atomic_read(&sbi->total_ext_tree);
 	si->zombie_tree = atomic_read(&sbi->total_zombie_tree);
 	si->ext_node = atomic_read(&sbi->total_ext_node);
@@ -103,6 +107,13 @@ static void update_general_status(struct f2fs_sb_info *sbi)
 	si->nr_rd_data = get_pages(sbi, F2FS_RD_DATA);
 	si->nr_rd_node = get_pages(sbi, F2FS_RD_NODE);
 	si->nr_rd_meta = get_pages(sbi, F2FS_RD_META);
+	si->nr_issued_ckpt = atomic_read(&sbi->cprc_info.issued_ckpt);
+	si->nr_total_ckpt = atomic_read(&sbi->cprc_info.total_ckpt);
+	si->nr_queued_ckpt = atomic_read(&sbi->cprc_info.queued_ckpt);
+	spin_lock(&sbi->cprc_info.stat_lock);
+	si->cur_ckpt_time = sbi->cprc_info.cur_time;
+	si->peak_ckpt_time = sbi->cprc_info.peak_time;
+	spin_unlock(&sbi->cprc_info.stat_lock);
 	if (SM_I(sbi)->fcc_info) {
 		si->nr_flushed =
 			atomic_read(&SM_I(sbi)->fcc_info->issued_flush);
@@ -130,6 +141,17 @@ static void update_general_status(struct f2fs_sb_info *sbi)
 	si->inline_xattr = atomic_read(&sbi->inline_xattr);
 	si->inline_inode = atomic_read(&sbi->inline_inode);
 	si->inline_dir = atomic_read(&sbi->inline_dir);
+	si->compr_inode = atomic_read(&sbi->compr_inode);
+	si->compr_blocks = atomic64_read(&sbi->compr_blocks);
+	si->compr_clusters = atomic64_read(&sbi->compr_clusters);
+	si->compr_raw_clusters = atomic64_read(&sbi->compr_raw_clusters);
+	si->compr_avg_ns = si->compr_clusters ?
+		div64_u64(atomic64_read(&sbi->compr_time),
+					si->compr_clusters) : 0;
+	si->decomp_cnt = atomic64_read(&sbi->decomp_cnt);
+	si->decomp_avg_ns = si->decomp_cnt ?
+		div64_u64(atomic64_read(&sbi->decomp_time),
+					si->decomp_cnt) : 0;
 	si->append = sbi->im[APPEND_INO].ino_num;
 	si->update = sbi->im[UPDATE_INO].ino_num;
 	si->orphans = sbi->im[ORPHAN_INO].ino_num;
@@ -152,6 +174,7 @@ static void update_general_status(struct f2fs_sb_info *sbi)
 	si->alloc_nids = NM_I(sbi)->nid_cnt[PREALLOC_NID];
 	si->io_skip_bggc = sbi->io_skip_bggc;
 	si->other_skip_bggc = sbi->other_skip_bggc;
+	si->fg_pause_bggc = sbi->fg_pause_bggc;
 	si->skipped_atomic_files[BG_GC] = sbi->skipped_atomic_files[BG_GC];
 	si->skipped_atomic_files[FG_GC] = sbi->skipped_atomic_files[FG_GC];
 	si->util_free = (int)(free_user_blocks(sbi) >> sbi->log_blocks_per_seg)
@@ -281,6 +304,8 @@ static void update_mem_info(struct f2fs_sb_info *sbi)
 static int stat_show(struct seq_file *s, void *v)
 {
 	struct f2fs_stat_info *si;
+	unsigned long long written, waf;
+	unsigned long long nat_total;
 	int i = 0;
 	int j;
 
@@ -317,6 +342,8 @@ static int stat_show(struct seq_file *s, void *v)
 			   si->inline_inode);
 		seq_printf(s, "  - Inline_dentry Inode: %u\n",
 			   si->inline_dir);
+		seq_printf(s, "  - Compressed Inode: %u, Saved Blocks: %llu\n",
+			   si->compr_inode, si->compr_blocks);
 		seq_printf(s, "  - Orphan/Append/Update Inode: %u, %u, %u\n",
 			   si->orphans, si->append, si->update);
 		seq_printf(s, "\nMain area: %d segs, %d secs %d zones\n",
@@ -379,6 +406,17 @@ static int stat_show(struct seq_file *s, void *v)
 				si->skipped_atomic_files[BG_GC]);
 		seq_printf(s, "BG skip : IO: %u, Other: %u\n",
 				si->io_skip_bggc, si->other_skip_bggc);
+		seq_printf(s, "BG pause : foreground IO: %u\n",
+				si->fg_pause_bggc);
+		seq_printf(s, "ATGC victims: %d, young sections skipped: %d\n",
+				si->atgc_victims, si->atgc_young_skips);
+		seq_puts(s, "\nCompression:\n");
+		seq_printf(s, "  - Clusters: %llu compressed, %llu incompressible\n",
+				si->compr_clusters, si->compr_raw_clusters);
+		seq_printf(s, "  - Avg compress: %llu us, decompress: %llu us (%llu)\n",
+				div_u64(si->compr_avg_ns, NSEC_PER_USEC),
+				div_u64(si->decomp_avg_ns, NSEC_PER_USEC),
+				si->decomp_cnt);
 		seq_puts(s, "\nExtent Cache:\n");
 		seq_printf(s, "  - Hit Count: L1-1:%llu L1-2:%llu L2:%llu\n",
 				si->hit_largest, si->hit_cached,
@@ -387,13 +425,37 @@ static int stat_show(struct seq_file *s, void *v)
 				!si->total_ext ? 0 :
 				div64_u64(si->hit_total * 100, si->total_ext),
 				si->hit_total, si->total_ext);
+		seq_printf(s, "  - Miss Ratio: %llu%% (%llu / %llu)\n",
+				!si->total_ext ? 0 :
+				div64_u64((si->total_ext - si->hit_total) * 100,
+							si->total_ext),
+				si->total_ext - si->hit_total, si->total_ext);
+		seq_printf(s, "  - Memory: %lu KB (budget: %u KB)\n",
+				f2fs_extent_cache_kb(si->sbi),
+				si->sbi->extent_cache_budget);
 		seq_printf(s, "  - Inner Struct Count: tree: %d(%d), node: %d\n",
 				si->ext_tree, si->zombie_tree, si->ext_node);
+		seq_puts(s, "\nNAT Cache:\n");
+		nat_total = si->nat_hit + si->nat_journal_hit + si->nat_blk_read;
+		seq_printf(s, "  - Hit Ratio: %llu%% (%llu / %llu)\n",
+				!nat_total ? 0 :
+				div64_u64(si->nat_hit * 100, nat_total),
+				si->nat_hit, nat_total);
+		seq_printf(s, "  - Journal: %llu, Block Read: %llu, Readahead: %llu\n",
+				si->nat_journal_hit, si->nat_blk_read,
+				si->nat_ra);
 		seq_puts(s, "\nBalancing F2FS Async:\n");
 		seq_printf(s, "  - DIO (R: %4d, W: %4d)\n",
 			   si->nr_dio_read, si->nr_dio_write);
 		seq_printf(s, "  - IO_R (Data: %4d, Node: %4d, Meta: %4d\n",
 			   si->nr_rd_data, si->nr_rd_node, si->nr_rd_meta);
+		if (test_opt(si->sbi, MERGE_CHECKPOINT)) {
+			seq_printf(s, "  - ckpt merge: issued %4d, total %4d, queued %4d\n",
+				   si->nr_issued_ckpt, si->nr_total_ckpt,
+				   si->nr_queued_ckpt);
+			seq_printf(s, "  - ckpt merge wait: avg %4d ms, peak %4d ms\n",
+				   si->cur_ckpt_time, si->peak_ckpt_time);
+		}
 		seq_printf(s, "  - IO_W (CP: %4d, Data: %4d, Flush: (%4d %4d %4d), "
 			"Discard: (%4d %4d)) cmd: %4d undiscard:%4u\n",
 			   si->nr_wb_cp_data, si->nr_wb_data,
@@ -441,6 +503,13 @@ static int stat_show(struct seq_file *s, void *v)
 			   si->block_count[SSR], si->segment_count[SSR]);
 		seq_printf(s, "LFS: %u blocks in %u segments\n",
 			   si->block_count[LFS], si->segment_count[LFS]);
+		written = (unsigned long long)si->block_count[LFS] +
+				si->block_count[SSR] + si->inplace_count;
+		waf = 100;
+		if (written > si->tot_blks)
+			waf = div64_u64(written * 100, written - si->tot_blks);
+		seq_printf(s, "WAF: %llu.%02llu (%llu blocks written, %d moved by GC)\n",
+			   waf / 100, waf % 100, written, si->tot_blks);
 
 		/* segment usage info */
 		f2fs_update_sit_info(si->sbi);
@@ -501,10 +570,21 @@ int f2fs_build_stats(struct f2fs_sb_info *sbi)
 	atomic64_set(&sbi->read_hit_rbtree, 0);
 	atomic64_set(&sbi->read_hit_largest, 0);
 	atomic64_set(&sbi->read_hit_cached, 0);
+	atomic64_set(&sbi->nat_hit, 0);
+	atomic64_set(&sbi->nat_journal_hit, 0);
+	atomic64_set(&sbi->nat_blk_read, 0);
+	atomic64_set(&sbi->nat_ra, 0);
 
 	atomic_set(&sbi->inline_xattr, 0);
 	atomic_set(&sbi->inline_inode, 0);
 	atomic_set(&sbi->inline_dir, 0);
+	atomic_set(&sbi->compr_inode, 0);
+	atomic64_set(&sbi->compr_blocks, 0);
+	atomic64_set(&sbi->compr_clusters, 0);
+	atomic64_set(&sbi->compr_raw_clusters, 0);
+	atomic64_set(&sbi->compr_time, 0);
+	atomic64_set(&sbi->decomp_cnt, 0);
+	atomic64_set(&sbi->decomp_time, 0);
 	atomic_set(&sbi->inplace_count, 0);
 	for (i = META_CP; i < META_MAX; i++)
 		atomic_set(&sbi->meta_count[i], 0);
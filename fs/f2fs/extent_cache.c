@@ -479,6 +479,32 @@ static struct extent_node *__insert_extent_tree(struct f2fs_sb_info *sbi,
 	return en;
 }
 
+unsigned long f2fs_extent_cache_kb(struct f2fs_sb_info *sbi)
+{
+	return (atomic_read(&sbi->total_ext_tree) * sizeof(struct extent_tree) +
+		atomic_read(&sbi->total_ext_node) *
+					sizeof(struct extent_node)) >> 10;
+}
+
+bool f2fs_extent_cache_over_budget(struct f2fs_sb_info *sbi)
+{
+	return sbi->extent_cache_budget &&
+		f2fs_extent_cache_kb(sbi) > sbi->extent_cache_budget;
+}
+
+/*
+ * With a budget in place, a fragmented file keeps its extent tree instead
+ * of dropping it on the first split, and the LRU trims it like any other.
+ * Hot files keep theirs even over budget.
+ */
+static bool __keep_fragmented_tree(struct f2fs_sb_info *sbi,
+						struct inode *inode)
+{
+	if (file_is_hot(inode))
+		return true;
+	return sbi->extent_cache_budget && !f2fs_extent_cache_over_budget(sbi);
+}
+
 static void f2fs_update_extent_tree_range(struct inode *inode,
 				pgoff_t fofs, block_t blkaddr, unsigned int len)
 {
@@ -591,7 +617,8 @@ static void f2fs_update_extent_tree_range(struct inode *inode,
 		/* give up extent_cache, if split and small updates happen */
 		if (dei.len >= 1 &&
 				prev.len < F2FS_MIN_EXTENT_LEN &&
-				et->largest.len < F2FS_MIN_EXTENT_LEN) {
+				et->largest.len < F2FS_MIN_EXTENT_LEN &&
+				!__keep_fragmented_tree(sbi, inode)) {
 			et->largest.len = 0;
 			et->largest_updated = true;
 			set_inode_flag(inode, FI_NO_EXTENT);
@@ -610,6 +637,9 @@ static void f2fs_update_extent_tree_range(struct inode *inode,
 
 	if (updated)
 		f2fs_mark_inode_dirty_sync(inode, true);
+
+	if (f2fs_extent_cache_over_budget(sbi))
+		f2fs_shrink_extent_tree(sbi, EXTENT_CACHE_SHRINK_NUMBER);
 }
 
 unsigned int f2fs_shrink_extent_tree(struct f2fs_sb_info *sbi, int nr_shrink)
@@ -806,6 +836,7 @@ void f2fs_init_extent_cache_info(struct f2fs_sb_info *sbi)
 	INIT_LIST_HEAD(&sbi->zombie_list);
 	atomic_set(&sbi->total_zombie_tree, 0);
 	atomic_set(&sbi->total_ext_node, 0);
+	sbi->extent_cache_budget = DEF_EXTENT_CACHE_BUDGET;
 }
 
 int __init f2fs_create_extent_cache(void)
@@ -101,6 +101,7 @@ extern const char *f2fs_fault_name[FAULT_MAX];
 #define F2FS_MOUNT_INLINE_XATTR_SIZE	0x00800000
 #define F2FS_MOUNT_RESERVE_ROOT		0x01000000
 #define F2FS_MOUNT_DISABLE_CHECKPOINT	0x02000000
+#define F2FS_MOUNT_MERGE_CHECKPOINT	0x04000000
 
 #define F2FS_OPTION(sbi)	((sbi)->mount_opt)
 #define clear_opt(sbi, option)	(F2FS_OPTION(sbi).opt &= ~F2FS_MOUNT_##option)
@@ -117,6 +118,8 @@ typedef u32 block_t;	/*
 			 */
 typedef u32 nid_t;
 
+#define COMPRESS_EXT_NUM		16
+
 struct f2fs_mount_info {
 	unsigned int opt;
 	int write_io_size_bits;		/* Write IO size bits */
@@ -142,6 +145,12 @@ struct f2fs_mount_info {
 	block_t unusable_cap;		/* Amount of space allowed to be
 					 * unusable when disabling checkpoint
 					 */
+
+	/* For compression */
+	unsigned char compress_algorithm;	/* algorithm type */
+	unsigned compress_log_size;		/* cluster log size */
+	unsigned char compress_ext_cnt;		/* extension count */
+	unsigned char extensions[COMPRESS_EXT_NUM][F2FS_EXTENSION_LEN];	/* extensions */
 };
 
 #define F2FS_FEATURE_ENCRYPT		0x0001
@@ -156,6 +165,7 @@ struct f2fs_mount_info {
 #define F2FS_FEATURE_LOST_FOUND		0x0200
 #define F2FS_FEATURE_VERITY		0x0400	/* reserved */
 #define F2FS_FEATURE_SB_CHKSUM		0x0800
+#define F2FS_FEATURE_COMPRESSION	0x2000
 
 #define __F2FS_HAS_FEATURE(raw_super, mask)				\
 	((raw_super->feature & cpu_to_le32(mask)) != 0)
@@ -189,6 +199,7 @@ enum {
 
 #define MAX_DISCARD_BLOCKS(sbi)		BLKS_PER_SEC(sbi)
 #define DEF_MAX_DISCARD_REQUEST		8	/* issue 8 discards per round */
+#define DEF_MAX_DISCARD_REQUEST_IDLE	32	/* per round with the screen off */
 #define DEF_MIN_DISCARD_ISSUE_TIME	50	/* 50 ms, if exists */
 #define DEF_MID_DISCARD_ISSUE_TIME	500	/* 500 ms, if device busy */
 #define DEF_MAX_DISCARD_ISSUE_TIME	60000	/* 60 s, if no candidates */
@@ -198,6 +209,7 @@ enum {
 #define DEF_DISABLE_INTERVAL		5	/* 5 secs */
 #define DEF_DISABLE_QUICK_INTERVAL	1	/* 1 secs */
 #define DEF_UMOUNT_DISCARD_TIMEOUT	5	/* 5 secs */
+#define DEF_FG_IDLE_INTERVAL		200	/* 200 ms without foreground I/O */
 
 struct cp_control {
 	int reason;
@@ -558,6 +570,9 @@ enum {
 /* number of extent info in extent cache we try to shrink */
 #define EXTENT_CACHE_SHRINK_NUMBER	128
 
+/* default memory budget of the extent cache per superblock, in KB */
+#define DEF_EXTENT_CACHE_BUDGET		8192
+
 struct rb_entry {
 	struct rb_node rb_node;		/* rb node located in rb-tree */
 	unsigned int ofs;		/* start offset of the entry */
@@ -694,6 +709,7 @@ enum {
 	FI_VERITY_IN_PROGRESS,	/* building fs-verity Merkle tree */
 	FI_COMPRESSED_FILE,	/* indicate file's data can be compressed */
 	FI_MMAP_FILE,		/* indicate file was mmapped */
+	FI_EXTENT_PRECACHED,	/* extents were preloaded on open */
 	FI_MAX,			/* max flag, never be used */
 };
 
@@ -743,6 +759,12 @@ struct f2fs_inode_info {
 	int i_inline_xattr_size;	/* inline xattr size */
 	struct timespec i_crtime;	/* inode creation time */
 	struct timespec i_disk_time[4];	/* inode disk times */
+
+	/* for file compress */
+	atomic_t i_compr_blocks;		/* # of compressed blocks */
+	unsigned char i_compress_algorithm;	/* algorithm type */
+	unsigned char i_log_cluster_size;	/* log of cluster size */
+	unsigned int i_cluster_size;		/* cluster size */
 };
 
 static inline void get_extent_info(struct extent_info *ext,
@@ -940,6 +962,27 @@ struct flush_cmd_control {
 	struct llist_node *dispatch_list;	/* list for command dispatch */
 };
 
+/* a checkpoint request waiting for the merge thread */
+struct ckpt_req {
+	struct completion wait;		/* completion for checkpoint done */
+	struct llist_node llnode;	/* linked in issue_list */
+	int ret;			/* return code of checkpoint */
+	ktime_t queue_time;		/* request queued time */
+};
+
+struct ckpt_req_control {
+	struct task_struct *f2fs_issue_ckpt;	/* checkpoint merge thread */
+	int ckpt_thread_ioprio;			/* ioprio of the thread */
+	wait_queue_head_t ckpt_wait_queue;	/* waiting queue for wake-up */
+	atomic_t issued_ckpt;			/* # of issued checkpoints */
+	atomic_t total_ckpt;			/* # of served requests */
+	atomic_t queued_ckpt;			/* # of queued requests */
+	struct llist_head issue_list;		/* list for request issue */
+	spinlock_t stat_lock;			/* for the wait time stats */
+	unsigned int cur_time;			/* avg wait of last batch (ms) */
+	unsigned int peak_time;			/* peak of cur_time (ms) */
+};
+
 struct f2fs_sm_info {
 	struct sit_info *sit_info;		/* whole segment information */
 	struct free_segmap_info *free_info;	/* free segment information */
@@ -1087,6 +1130,7 @@ struct f2fs_io_info {
 	block_t old_blkaddr;	/* old block address before Cow */
 	struct page *page;	/* page to be written */
 	struct page *encrypted_page;	/* encrypted page */
+	struct page *compressed_page;	/* compressed page */
 	struct list_head list;		/* serialize IOs */
 	bool submitted;		/* indicate IO submission */
 	int need_lock;		/* indicate we need to lock cp_rwsem */
@@ -1180,6 +1224,7 @@ enum {
 	GC_NORMAL,
 	GC_IDLE_CB,
 	GC_IDLE_GREEDY,
+	GC_IDLE_AT,
 	GC_URGENT,
 };
 
@@ -1240,12 +1285,16 @@ struct f2fs_sb_info {
 	spinlock_t cp_lock;			/* for flag in ckpt */
 	struct inode *meta_inode;		/* cache meta blocks */
 	struct mutex cp_mutex;			/* checkpoint procedure lock */
+	struct ckpt_req_control cprc_info;	/* for checkpoint request control */
 	struct rw_semaphore cp_rwsem;		/* blocking FS operations */
 	struct rw_semaphore node_write;		/* locking node writes */
 	struct rw_semaphore node_change;	/* locking node change */
 	wait_queue_head_t cp_wait;
 	unsigned long last_time[MAX_TIME];	/* to store time in jiffies */
 	long interval_time[MAX_TIME];		/* to store thresholds */
+	unsigned long last_fg_io;		/* last foreground I/O, in jiffies */
+	unsigned int fg_idle_interval;		/* quiet time to be idle, in ms */
+	unsigned int screen_on;			/* screen state hint from userspace */
 
 	struct inode_management im[MAX_INO_ENTRY];      /* manage inode cache */
 
@@ -1271,6 +1320,7 @@ struct f2fs_sb_info {
 	struct list_head zombie_list;		/* extent zombie tree list */
 	atomic_t total_zombie_tree;		/* extent zombie tree count */
 	atomic_t total_ext_node;		/* extent info count */
+	unsigned int extent_cache_budget;	/* memory budget in KB, 0: none */
 
 	/* basic filesystem units */
 	unsigned int log_sectors_per_block;	/* log2 sectors per block */
@@ -1337,6 +1387,12 @@ struct f2fs_sb_info {
 
 	/* maximum # of trials to find a victim segment for SSR and GC */
 	unsigned int max_victim_search;
+	/* age-threshold GC: sections younger than this (sec) are not moved */
+	unsigned int atgc_age_threshold;
+	/* age-threshold GC: weight of age vs. free space in the cost, in % */
+	unsigned int atgc_age_weight;
+	/* age-threshold GC: old enough sections to compare per victim */
+	unsigned int atgc_candidate_count;
 	/* migration granularity of garbage collection, unit: segment */
 	unsigned int migration_granularity;
 
@@ -1354,6 +1410,10 @@ struct f2fs_sb_info {
 	atomic64_t read_hit_rbtree;		/* # of hit rbtree extent node */
 	atomic64_t read_hit_largest;		/* # of hit largest extent node */
 	atomic64_t read_hit_cached;		/* # of hit cached extent node */
+	atomic64_t nat_hit;			/* # of nat cache hits */
+	atomic64_t nat_journal_hit;		/* # of nat journal hits */
+	atomic64_t nat_blk_read;		/* # of nat lookups from blocks */
+	atomic64_t nat_ra;			/* # of nat block readaheads */
 	atomic_t inline_xattr;			/* # of inline_xattr inodes */
 	atomic_t inline_inode;			/* # of inline_data inodes */
 	atomic_t inline_dir;			/* # of inline_dentry inodes */
@@ -1362,7 +1422,15 @@ struct f2fs_sb_info {
 	atomic_t max_vw_cnt;			/* max # of volatile writes */
 	unsigned int io_skip_bggc;		/* skip background gc for in-flight IO */
 	unsigned int other_skip_bggc;		/* skip background gc for other reasons */
+	unsigned int fg_pause_bggc;		/* background gc paused for foreground IO */
 	unsigned int ndirty_inode[NR_INODE_TYPE];	/* # of dirty inodes */
+	atomic_t compr_inode;			/* # of compressed inodes */
+	atomic64_t compr_blocks;		/* # of blocks saved by compression */
+	atomic64_t compr_clusters;		/* # of clusters written compressed */
+	atomic64_t compr_raw_clusters;		/* # of incompressible clusters */
+	atomic64_t compr_time;			/* total compression time in ns */
+	atomic64_t decomp_cnt;			/* # of decompressed clusters */
+	atomic64_t decomp_time;			/* total decompression time in ns */
 #endif
 	spinlock_t stat_lock;			/* lock for stat operations */
 
@@ -2251,11 +2319,71 @@ static inline void *f2fs_kmem_cache_alloc(struct kmem_cache *cachep,
 	return entry;
 }
 
+/*
+ * Reads in flight on the whole disk, including other partitions which
+ * share its queue with us.
+ */
+static inline int f2fs_disk_reads_in_flight(struct f2fs_sb_info *sbi)
+{
+	int i, nr = 0;
+
+	if (!f2fs_is_multi_device(sbi))
+		return atomic_read(&sbi->sb->s_bdev->bd_disk->part0.in_flight[READ]);
+
+	for (i = 0; i < sbi->s_ndevs; i++)
+		nr += atomic_read(&FDEV(i).bdev->bd_disk->part0.in_flight[READ]);
+	return nr;
+}
+
+/*
+ * Foreground I/O is direct I/O through f2fs, or reads on the disk which
+ * f2fs has not submitted itself.  Buffered reads through f2fs are stamped
+ * in ->readpage(s) instead, since they can't be told apart from GC reads
+ * by the page counts.
+ */
+static inline bool f2fs_fg_io_busy(struct f2fs_sb_info *sbi)
+{
+	int own_reads = get_pages(sbi, F2FS_RD_DATA) +
+			get_pages(sbi, F2FS_RD_NODE) +
+			get_pages(sbi, F2FS_RD_META);
+
+	if (get_pages(sbi, F2FS_DIO_READ) || get_pages(sbi, F2FS_DIO_WRITE) ||
+			f2fs_disk_reads_in_flight(sbi) > own_reads) {
+		sbi->last_fg_io = jiffies;
+		return true;
+	}
+	return false;
+}
+
+static inline void f2fs_update_fg_io(struct f2fs_sb_info *sbi)
+{
+	sbi->last_fg_io = jiffies;
+}
+
+/*
+ * No foreground I/O for fg_idle_interval.  With the screen off nobody is
+ * waiting on the device, so a quarter of that is enough.
+ */
+static inline bool f2fs_fg_io_quiet(struct f2fs_sb_info *sbi)
+{
+	unsigned int interval = sbi->fg_idle_interval;
+
+	if (f2fs_fg_io_busy(sbi))
+		return false;
+
+	if (!sbi->screen_on)
+		interval >>= 2;
+	return time_after(jiffies, sbi->last_fg_io + msecs_to_jiffies(interval));
+}
+
 static inline bool is_idle(struct f2fs_sb_info *sbi, int type)
 {
 	if (sbi->gc_mode == GC_URGENT)
 		return true;
 
+	if ((type == GC_TIME || type == DISCARD_TIME) && !f2fs_fg_io_quiet(sbi))
+		return false;
+
 	if (get_pages(sbi, F2FS_RD_DATA) || get_pages(sbi, F2FS_RD_NODE) ||
 		get_pages(sbi, F2FS_RD_META) || get_pages(sbi, F2FS_WB_DATA) ||
 		get_pages(sbi, F2FS_WB_CP_DATA) ||
@@ -2387,6 +2515,7 @@ static inline void f2fs_change_bit(unsigned int nr, char *addr)
 /*
  * On-disk inode flags (f2fs_inode::i_flags)
  */
+#define F2FS_COMPR_FL			0x00000004 /* Compress file */
 #define F2FS_SYNC_FL			0x00000008 /* Synchronous updates */
 #define F2FS_IMMUTABLE_FL		0x00000010 /* Immutable file */
 #define F2FS_APPEND_FL			0x00000020 /* writes to file may only append */
@@ -2577,18 +2706,33 @@ static inline int f2fs_has_inline_xattr(struct inode *inode)
 	return is_inode_flag_set(inode, FI_INLINE_XATTR);
 }
 
+static inline int f2fs_compressed_file(struct inode *inode)
+{
+	return S_ISREG(inode->i_mode) &&
+		is_inode_flag_set(inode, FI_COMPRESSED_FILE);
+}
+
 #define ALIGN_DOWN(x, a)        __ALIGN_KERNEL((x) - ((a) - 1), (a))
 
+/*
+ * A cluster of a compressed file never straddles two node blocks, so the
+ * number of addresses per node is rounded down to the cluster size.
+ */
 static inline unsigned int addrs_per_inode(struct inode *inode)
 {
 	unsigned int addrs = CUR_ADDRS_PER_INODE(inode) -
 				get_inline_xattr_addrs(inode);
-	return ALIGN_DOWN(addrs, 1);
+
+	if (!f2fs_compressed_file(inode))
+		return addrs;
+	return ALIGN_DOWN(addrs, F2FS_I(inode)->i_cluster_size);
 }
 
 static inline unsigned int addrs_per_block(struct inode *inode)
 {
-	return ALIGN_DOWN(DEF_ADDRS_PER_BLOCK, 1);
+	if (!f2fs_compressed_file(inode))
+		return DEF_ADDRS_PER_BLOCK;
+	return ALIGN_DOWN(DEF_ADDRS_PER_BLOCK, F2FS_I(inode)->i_cluster_size);
 }
 
 static inline void *inline_xattr_addr(struct inode *inode, struct page *page)
@@ -2758,6 +2902,10 @@ static inline bool f2fs_may_extent_tree(struct inode *inode)
 	if (list_empty(&sbi->s_list))
 		return false;
 
+	/* a compressed cluster maps to fewer blocks than it has pages */
+	if (f2fs_compressed_file(inode))
+		return false;
+
 	return S_ISREG(inode->i_mode);
 }
 
@@ -2898,7 +3046,8 @@ static inline void verify_blkaddr(struct f2fs_sb_info *sbi,
 
 static inline bool __is_valid_data_blkaddr(block_t blkaddr)
 {
-	if (blkaddr == NEW_ADDR || blkaddr == NULL_ADDR)
+	if (blkaddr == NEW_ADDR || blkaddr == NULL_ADDR ||
+			blkaddr == COMPRESS_ADDR)
 		return false;
 	return true;
 }
@@ -3058,6 +3207,7 @@ int f2fs_remove_inode_page(struct inode *inode);
 struct page *f2fs_new_inode_page(struct inode *inode);
 struct page *f2fs_new_node_page(struct dnode_of_data *dn, unsigned int ofs);
 void f2fs_ra_node_page(struct f2fs_sb_info *sbi, nid_t nid);
+void f2fs_ra_nat_block(struct f2fs_sb_info *sbi, nid_t nid, pgoff_t *last);
 struct page *f2fs_get_node_page(struct f2fs_sb_info *sbi, pgoff_t nid);
 struct page *f2fs_get_node_page_ra(struct page *parent, int start);
 int f2fs_move_node_page(struct page *node_page, int gc_type);
@@ -3190,6 +3340,10 @@ int f2fs_sync_dirty_inodes(struct f2fs_sb_info *sbi, enum inode_type type);
 void f2fs_wait_on_all_pages(struct f2fs_sb_info *sbi, int type);
 int f2fs_write_checkpoint(struct f2fs_sb_info *sbi, struct cp_control *cpc);
 void f2fs_init_ino_entry_info(struct f2fs_sb_info *sbi);
+int f2fs_issue_checkpoint(struct f2fs_sb_info *sbi);
+int f2fs_start_ckpt_thread(struct f2fs_sb_info *sbi);
+void f2fs_stop_ckpt_thread(struct f2fs_sb_info *sbi);
+void f2fs_init_ckpt_req_control(struct f2fs_sb_info *sbi);
 int __init f2fs_create_checkpoint_caches(void);
 void f2fs_destroy_checkpoint_caches(void);
 
@@ -3231,6 +3385,10 @@ struct page *f2fs_get_lock_data_page(struct inode *inode, pgoff_t index,
 struct page *f2fs_get_new_data_page(struct inode *inode,
 			struct page *ipage, pgoff_t index, bool new_i_size);
 int f2fs_do_write_data_page(struct f2fs_io_info *fio);
+int f2fs_write_single_data_page(struct page *page, bool *submitted,
+				struct bio **bio, sector_t *last_block,
+				struct writeback_control *wbc,
+				enum iostat_type io_type, bool allow_balance);
 void __do_map_lock(struct f2fs_sb_info *sbi, int flag, bool lock);
 int f2fs_map_blocks(struct inode *inode, struct f2fs_map_blocks *map,
 			int create, int flag);
@@ -3276,6 +3434,7 @@ struct f2fs_stat_info {
 	int main_area_segs, main_area_sections, main_area_zones;
 	unsigned long long hit_largest, hit_cached, hit_rbtree;
 	unsigned long long hit_total, total_ext;
+	unsigned long long nat_hit, nat_journal_hit, nat_blk_read, nat_ra;
 	int ext_tree, zombie_tree, ext_node;
 	int ndirty_node, ndirty_dent, ndirty_meta, ndirty_imeta;
 	int ndirty_data, ndirty_qdata;
@@ -3287,8 +3446,10 @@ struct f2fs_stat_info {
 	int bg_gc, nr_wb_cp_data, nr_wb_data;
 	int nr_rd_data, nr_rd_node, nr_rd_meta;
 	int nr_dio_read, nr_dio_write;
-	unsigned int io_skip_bggc, other_skip_bggc;
+	unsigned int io_skip_bggc, other_skip_bggc, fg_pause_bggc;
 	int nr_flushing, nr_flushed, flush_list_empty;
+	int nr_issued_ckpt, nr_total_ckpt, nr_queued_ckpt;
+	unsigned int cur_ckpt_time, peak_ckpt_time;
 	int nr_discarding, nr_discarded;
 	int nr_discard_cmd;
 	unsigned int undiscard_blks;
@@ -3304,6 +3465,10 @@ struct f2fs_stat_info {
 	int bg_node_segs, bg_data_segs;
 	int tot_blks, data_blks, node_blks;
 	int bg_data_blks, bg_node_blks;
+	int atgc_victims, atgc_young_skips;
+	int compr_inode;
+	unsigned long long compr_blocks, compr_clusters, compr_raw_clusters;
+	unsigned long long compr_avg_ns, decomp_cnt, decomp_avg_ns;
 	unsigned long long skipped_atomic_files[2];
 	int curseg[NR_CURSEG_TYPE];
 	int cursec[NR_CURSEG_TYPE];
@@ -3327,12 +3492,17 @@ static inline struct f2fs_stat_info *F2FS_STAT(struct f2fs_sb_info *sbi)
 #define stat_inc_bggc_count(si)		((si)->bg_gc++)
 #define stat_io_skip_bggc_count(sbi)	((sbi)->io_skip_bggc++)
 #define stat_other_skip_bggc_count(sbi)	((sbi)->other_skip_bggc++)
+#define stat_fg_pause_bggc_count(sbi)	((sbi)->fg_pause_bggc++)
 #define stat_inc_dirty_inode(sbi, type)	((sbi)->ndirty_inode[type]++)
 #define stat_dec_dirty_inode(sbi, type)	((sbi)->ndirty_inode[type]--)
 #define stat_inc_total_hit(sbi)		(atomic64_inc(&(sbi)->total_hit_ext))
 #define stat_inc_rbtree_node_hit(sbi)	(atomic64_inc(&(sbi)->read_hit_rbtree))
 #define stat_inc_largest_node_hit(sbi)	(atomic64_inc(&(sbi)->read_hit_largest))
 #define stat_inc_cached_node_hit(sbi)	(atomic64_inc(&(sbi)->read_hit_cached))
+#define stat_inc_nat_hit(sbi)		(atomic64_inc(&(sbi)->nat_hit))
+#define stat_inc_nat_journal_hit(sbi)	(atomic64_inc(&(sbi)->nat_journal_hit))
+#define stat_inc_nat_blk_read(sbi)	(atomic64_inc(&(sbi)->nat_blk_read))
+#define stat_inc_nat_ra(sbi)		(atomic64_inc(&(sbi)->nat_ra))
 #define stat_inc_inline_xattr(inode)					\
 	do {								\
 		if (f2fs_has_inline_xattr(inode))			\
@@ -3414,6 +3584,36 @@ static inline struct f2fs_stat_info *F2FS_STAT(struct f2fs_sb_info *sbi)
 #define stat_inc_tot_blk_count(si, blks)				\
 	((si)->tot_blks += (blks))
 
+#define stat_inc_atgc_victim(sbi)	(F2FS_STAT(sbi)->atgc_victims++)
+#define stat_inc_atgc_young_skip(sbi)	(F2FS_STAT(sbi)->atgc_young_skips++)
+
+#define stat_inc_compr_inode(inode)					\
+	do {								\
+		if (f2fs_compressed_file(inode))			\
+			(atomic_inc(&F2FS_I_SB(inode)->compr_inode));	\
+	} while (0)
+#define stat_dec_compr_inode(inode)					\
+	do {								\
+		if (f2fs_compressed_file(inode))			\
+			(atomic_dec(&F2FS_I_SB(inode)->compr_inode));	\
+	} while (0)
+#define stat_add_compr_blocks(inode, blocks)				\
+		(atomic64_add(blocks, &F2FS_I_SB(inode)->compr_blocks))
+#define stat_sub_compr_blocks(inode, blocks)				\
+		(atomic64_sub(blocks, &F2FS_I_SB(inode)->compr_blocks))
+#define stat_inc_compr_cluster(sbi, ns)					\
+	do {								\
+		atomic64_inc(&(sbi)->compr_clusters);			\
+		atomic64_add(ns, &(sbi)->compr_time);			\
+	} while (0)
+#define stat_inc_compr_raw_cluster(sbi)					\
+		(atomic64_inc(&(sbi)->compr_raw_clusters))
+#define stat_inc_decomp_cluster(sbi, ns)				\
+	do {								\
+		atomic64_inc(&(sbi)->decomp_cnt);			\
+		atomic64_add(ns, &(sbi)->decomp_time);			\
+	} while (0)
+
 #define stat_inc_data_blk_count(sbi, blks, gc_type)			\
 	do {								\
 		struct f2fs_stat_info *si = F2FS_STAT(sbi);		\
@@ -3442,12 +3642,17 @@ void f2fs_update_sit_info(struct f2fs_sb_info *sbi);
 #define stat_inc_bggc_count(si)				do { } while (0)
 #define stat_io_skip_bggc_count(sbi)			do { } while (0)
 #define stat_other_skip_bggc_count(sbi)			do { } while (0)
+#define stat_fg_pause_bggc_count(sbi)			do { } while (0)
 #define stat_inc_dirty_inode(sbi, type)			do { } while (0)
 #define stat_dec_dirty_inode(sbi, type)			do { } while (0)
 #define stat_inc_total_hit(sbi)				do { } while (0)
 #define stat_inc_rbtree_node_hit(sbi)			do { } while (0)
 #define stat_inc_largest_node_hit(sbi)			do { } while (0)
 #define stat_inc_cached_node_hit(sbi)			do { } while (0)
+#define stat_inc_nat_hit(sbi)				do { } while (0)
+#define stat_inc_nat_journal_hit(sbi)			do { } while (0)
+#define stat_inc_nat_blk_read(sbi)			do { } while (0)
+#define stat_inc_nat_ra(sbi)				do { } while (0)
 #define stat_inc_inline_xattr(inode)			do { } while (0)
 #define stat_dec_inline_xattr(inode)			do { } while (0)
 #define stat_inc_inline_inode(inode)			do { } while (0)
@@ -3466,6 +3671,15 @@ void f2fs_update_sit_info(struct f2fs_sb_info *sbi);
 #define stat_inc_inplace_blocks(sbi)			do { } while (0)
 #define stat_inc_seg_count(sbi, type, gc_type)		do { } while (0)
 #define stat_inc_tot_blk_count(si, blks)		do { } while (0)
+#define stat_inc_atgc_victim(sbi)			do { } while (0)
+#define stat_inc_atgc_young_skip(sbi)			do { } while (0)
+#define stat_inc_compr_inode(inode)			do { } while (0)
+#define stat_dec_compr_inode(inode)			do { } while (0)
+#define stat_add_compr_blocks(inode, blocks)		do { } while (0)
+#define stat_sub_compr_blocks(inode, blocks)		do { } while (0)
+#define stat_inc_compr_cluster(sbi, ns)			do { } while (0)
+#define stat_inc_compr_raw_cluster(sbi)			do { } while (0)
+#define stat_inc_decomp_cluster(sbi, ns)		do { } while (0)
 #define stat_inc_data_blk_count(sbi, blks, gc_type)	do { } while (0)
 #define stat_inc_node_blk_count(sbi, blks, gc_type)	do { } while (0)
 
@@ -3545,6 +3759,8 @@ struct rb_entry *f2fs_lookup_rb_tree_ret(struct rb_root *root,
 bool f2fs_check_rb_tree_consistence(struct f2fs_sb_info *sbi,
 						struct rb_root *root);
 unsigned int f2fs_shrink_extent_tree(struct f2fs_sb_info *sbi, int nr_shrink);
+unsigned long f2fs_extent_cache_kb(struct f2fs_sb_info *sbi);
+bool f2fs_extent_cache_over_budget(struct f2fs_sb_info *sbi);
 bool f2fs_init_extent_tree(struct inode *inode, struct f2fs_extent *i_ext);
 void f2fs_drop_extent_tree(struct inode *inode);
 unsigned int f2fs_destroy_extent_node(struct inode *inode);
@@ -3607,6 +3823,129 @@ F2FS_FEATURE_FUNCS(quota_ino, QUOTA_INO);
 F2FS_FEATURE_FUNCS(inode_crtime, INODE_CRTIME);
 F2FS_FEATURE_FUNCS(lost_found, LOST_FOUND);
 F2FS_FEATURE_FUNCS(sb_chksum, SB_CHKSUM);
+F2FS_FEATURE_FUNCS(compression, COMPRESSION);
+
+/*
+ * compress.c
+ */
+#define MIN_COMPRESS_LOG_SIZE		2
+#define MAX_COMPRESS_LOG_SIZE		8
+#define DEF_COMPRESS_LOG_SIZE		2
+
+enum compress_algorithm_type {
+	COMPRESS_LZ4,
+	COMPRESS_ZSTD,
+	COMPRESS_MAX,
+};
+
+/* magic stored in page_private of the pages holding compressed data */
+#define F2FS_COMPRESSED_PAGE_MAGIC	0xF5F2C000
+
+/* header of the first block of a compressed cluster */
+struct compress_data {
+	__le32 clen;			/* compressed data size */
+	__le32 reserved[5];		/* reserved */
+	u8 cdata[];			/* compressed data */
+};
+
+#define COMPRESS_HEADER_SIZE	(sizeof(struct compress_data))
+
+static inline bool f2fs_may_compress(struct inode *inode)
+{
+	if (IS_SWAPFILE(inode) || f2fs_is_pinned_file(inode) ||
+				f2fs_is_atomic_file(inode) ||
+				f2fs_is_volatile_file(inode) ||
+				IS_ENCRYPTED(inode))
+		return false;
+	/* the compression fields live in the extra attribute area */
+	if (!f2fs_has_extra_attr(inode) ||
+		!F2FS_FITS_IN_INODE((struct f2fs_inode *)NULL,
+				F2FS_I(inode)->i_extra_isize,
+				i_log_cluster_size))
+		return false;
+	return S_ISREG(inode->i_mode) || S_ISDIR(inode->i_mode);
+}
+
+static inline void set_compress_context(struct inode *inode)
+{
+	struct f2fs_sb_info *sbi = F2FS_I_SB(inode);
+
+	F2FS_I(inode)->i_compress_algorithm =
+			F2FS_OPTION(sbi).compress_algorithm;
+	F2FS_I(inode)->i_log_cluster_size =
+			F2FS_OPTION(sbi).compress_log_size;
+	F2FS_I(inode)->i_cluster_size =
+			1 << F2FS_I(inode)->i_log_cluster_size;
+	F2FS_I(inode)->i_flags |= F2FS_COMPR_FL;
+	set_inode_flag(inode, FI_COMPRESSED_FILE);
+	stat_inc_compr_inode(inode);
+	f2fs_mark_inode_dirty_sync(inode, true);
+}
+
+static inline void clear_compress_context(struct inode *inode)
+{
+	stat_dec_compr_inode(inode);
+	F2FS_I(inode)->i_flags &= ~F2FS_COMPR_FL;
+	clear_inode_flag(inode, FI_COMPRESSED_FILE);
+	F2FS_I(inode)->i_compress_algorithm = 0;
+	F2FS_I(inode)->i_log_cluster_size = 0;
+	F2FS_I(inode)->i_cluster_size = 0;
+	f2fs_mark_inode_dirty_sync(inode, true);
+}
+
+/* @blocks: # of blocks saved by the compressed clusters being changed */
+static inline void f2fs_i_compr_blocks_update(struct inode *inode,
+						u64 blocks, bool add)
+{
+	if (add) {
+		atomic_add(blocks, &F2FS_I(inode)->i_compr_blocks);
+		stat_add_compr_blocks(inode, blocks);
+	} else {
+		atomic_sub(blocks, &F2FS_I(inode)->i_compr_blocks);
+		stat_sub_compr_blocks(inode, blocks);
+	}
+	f2fs_mark_inode_dirty_sync(inode, true);
+}
+
+#ifdef CONFIG_F2FS_FS_COMPRESSION
+bool f2fs_is_compressed_page(struct page *page);
+void f2fs_compress_write_end_io(struct bio *bio, struct page *page);
+bool f2fs_is_compressed_cluster(struct inode *inode, pgoff_t index);
+int f2fs_read_compressed_cluster(struct inode *inode, struct page *page);
+int f2fs_write_cluster(struct inode *inode, pgoff_t index, bool *submitted,
+				struct bio **bio, sector_t *last_block,
+				struct writeback_control *wbc,
+				enum iostat_type io_type);
+int f2fs_truncate_partial_cluster(struct inode *inode, u64 from);
+int f2fs_init_compress_ctx(struct f2fs_sb_info *sbi);
+void f2fs_destroy_compress_ctx(struct f2fs_sb_info *sbi);
+#else
+static inline bool f2fs_is_compressed_page(struct page *page) { return false; }
+static inline void f2fs_compress_write_end_io(struct bio *bio,
+						struct page *page) { }
+static inline bool f2fs_is_compressed_cluster(struct inode *inode,
+						pgoff_t index) { return false; }
+static inline int f2fs_read_compressed_cluster(struct inode *inode,
+						struct page *page)
+{
+	return -EAGAIN;
+}
+static inline int f2fs_write_cluster(struct inode *inode, pgoff_t index,
+				bool *submitted, struct bio **bio,
+				sector_t *last_block,
+				struct writeback_control *wbc,
+				enum iostat_type io_type)
+{
+	return -EOPNOTSUPP;
+}
+static inline int f2fs_truncate_partial_cluster(struct inode *inode,
+						u64 from) { return 0; }
+static inline int f2fs_init_compress_ctx(struct f2fs_sb_info *sbi)
+{
+	return 0;
+}
+static inline void f2fs_destroy_compress_ctx(struct f2fs_sb_info *sbi) { }
+#endif
 
 #ifdef CONFIG_BLK_DEV_ZONED
 static inline bool f2fs_blkz_is_seq(struct f2fs_sb_info *sbi, int devi,
@@ -3722,6 +4061,8 @@ static inline bool f2fs_force_buffered_io(struct inode *inode,
 	if (f2fs_post_read_required(inode) &&
 		!fscrypt_using_hardware_encryption(inode))
 		return true;
+	if (f2fs_compressed_file(inode))
+		return true;
 	if (f2fs_is_multi_device(sbi))
 		return true;
 	/*
@@ -378,6 +378,7 @@ static bool __found_offset(struct f2fs_sb_info *sbi, block_t blkaddr,
 	switch (whence) {
 	case SEEK_DATA:
 		if ((blkaddr == NEW_ADDR && dirty == pgofs) ||
+			blkaddr == COMPRESS_ADDR ||
 			__is_valid_data_blkaddr(blkaddr))
 			return true;
 		break;
@@ -518,7 +519,18 @@ static int f2fs_file_open(struct inode *inode, struct file *filp)
 
 	filp->f_mode |= FMODE_NOWAIT;
 
-	return dquot_file_open(inode, filp);
+	err = dquot_file_open(inode, filp);
+	if (err)
+		return err;
+
+	/* preload the whole mapping of hot files once per inode */
+	if (file_is_hot(inode) && !f2fs_readonly(inode->i_sb) &&
+			f2fs_may_extent_tree(inode) &&
+			!is_inode_flag_set(inode, FI_EXTENT_PRECACHED)) {
+		set_inode_flag(inode, FI_EXTENT_PRECACHED);
+		f2fs_precache_extents(inode);
+	}
+	return 0;
 }
 
 void f2fs_truncate_data_blocks_range(struct dnode_of_data *dn, int count)
@@ -528,6 +540,9 @@ void f2fs_truncate_data_blocks_range(struct dnode_of_data *dn, int count)
 	int nr_free = 0, ofs = dn->ofs_in_node, len = count;
 	__le32 *addr;
 	int base = 0;
+	bool compressed_cluster = false;
+	unsigned int cluster_size = F2FS_I(dn->inode)->i_cluster_size;
+	unsigned int saved_blocks = 0;
 
 	if (IS_INODE(dn->node_page) && f2fs_has_extra_attr(dn->inode))
 		base = get_extra_isize(dn->inode);
@@ -538,9 +553,18 @@ void f2fs_truncate_data_blocks_range(struct dnode_of_data *dn, int count)
 	for (; count > 0; count--, addr++, dn->ofs_in_node++) {
 		block_t blkaddr = le32_to_cpu(*addr);
 
+		/* clusters never span node pages, so slot 0 is aligned */
+		if (f2fs_compressed_file(dn->inode) &&
+				!(dn->ofs_in_node & (cluster_size - 1)))
+			compressed_cluster = (blkaddr == COMPRESS_ADDR);
+
 		if (blkaddr == NULL_ADDR)
 			continue;
 
+		if (compressed_cluster &&
+			(blkaddr == COMPRESS_ADDR || blkaddr == NEW_ADDR))
+			saved_blocks++;
+
 		dn->data_blkaddr = NULL_ADDR;
 		f2fs_set_data_blkaddr(dn);
 
@@ -566,6 +590,8 @@ void f2fs_truncate_data_blocks_range(struct dnode_of_data *dn, int count)
 		f2fs_update_extent_cache_range(dn, fofs, 0, len);
 		dec_valid_block_count(sbi, dn->inode, nr_free);
 	}
+	if (saved_blocks)
+		f2fs_i_compr_blocks_update(dn->inode, saved_blocks, false);
 	dn->ofs_in_node = ofs;
 
 	f2fs_update_time(sbi, REQ_TIME);
@@ -628,6 +654,17 @@ int f2fs_truncate_blocks(struct inode *inode, u64 from, bool lock)
 	if (free_from >= sbi->max_file_blocks)
 		goto free_partial;
 
+	/* a compressed cluster is kept until its remaining pages are rewritten */
+	if (f2fs_compressed_file(inode)) {
+		err = f2fs_truncate_partial_cluster(inode, from);
+		if (err < 0)
+			goto out_trace;
+		if (err)
+			free_from = round_up(free_from,
+					F2FS_I(inode)->i_cluster_size);
+		err = 0;
+	}
+
 	if (lock)
 		f2fs_lock_op(sbi);
 
@@ -672,7 +709,7 @@ int f2fs_truncate_blocks(struct inode *inode, u64 from, bool lock)
 	/* lastly zero out the first data page */
 	if (!err)
 		err = truncate_partial_data_page(inode, from, truncate_page);
-
+out_trace:
 	trace_f2fs_truncate_blocks_exit(inode, err);
 	return err;
 }
@@ -1632,6 +1669,11 @@ static long f2fs_fallocate(struct file *file, int mode,
 		(mode & (FALLOC_FL_COLLAPSE_RANGE | FALLOC_FL_INSERT_RANGE)))
 		return -EOPNOTSUPP;
 
+	if (f2fs_compressed_file(inode) &&
+		(mode & (FALLOC_FL_PUNCH_HOLE | FALLOC_FL_COLLAPSE_RANGE |
+			FALLOC_FL_ZERO_RANGE | FALLOC_FL_INSERT_RANGE)))
+		return -EOPNOTSUPP;
+
 	if (mode & ~(FALLOC_FL_KEEP_SIZE | FALLOC_FL_PUNCH_HOLE |
 			FALLOC_FL_COLLAPSE_RANGE | FALLOC_FL_ZERO_RANGE |
 			FALLOC_FL_INSERT_RANGE))
@@ -1714,6 +1756,28 @@ static int f2fs_setflags_common(struct inode *inode, u32 iflags, u32 mask)
 	if (IS_NOQUOTA(inode))
 		return -EPERM;
 
+	if ((iflags ^ fi->i_flags) & F2FS_COMPR_FL) {
+		if (!f2fs_sb_has_compression(F2FS_I_SB(inode)))
+			return -EOPNOTSUPP;
+		/* only an empty file can switch its block layout */
+		if (S_ISREG(inode->i_mode) && (inode->i_size ||
+				atomic_read(&fi->i_compr_blocks)))
+			return -EINVAL;
+
+		if (iflags & F2FS_COMPR_FL) {
+			int err;
+
+			if (!f2fs_may_compress(inode))
+				return -EINVAL;
+			err = f2fs_convert_inline_inode(inode);
+			if (err)
+				return err;
+			set_compress_context(inode);
+		} else {
+			clear_compress_context(inode);
+		}
+	}
+
 	fi->i_flags = iflags | (fi->i_flags & ~mask);
 
 	if (fi->i_flags & F2FS_PROJINHERIT_FL)
@@ -1748,6 +1812,7 @@ static const struct {
 	{ F2FS_INDEX_FL,	FS_INDEX_FL },
 	{ F2FS_DIRSYNC_FL,	FS_DIRSYNC_FL },
 	{ F2FS_PROJINHERIT_FL,	FS_PROJINHERIT_FL },
+	{ F2FS_COMPR_FL,	FS_COMPR_FL },
 };
 
 #define F2FS_GETTABLE_FS_FL (		\
@@ -1761,7 +1826,8 @@ static const struct {
 		FS_PROJINHERIT_FL |	\
 		FS_ENCRYPT_FL |		\
 		FS_INLINE_DATA_FL |	\
-		FS_NOCOW_FL)
+		FS_NOCOW_FL |		\
+		FS_COMPR_FL)
 
 #define F2FS_SETTABLE_FS_FL (		\
 		FS_SYNC_FL |		\
@@ -1770,7 +1836,8 @@ static const struct {
 		FS_NODUMP_FL |		\
 		FS_NOATIME_FL |		\
 		FS_DIRSYNC_FL |		\
-		FS_PROJINHERIT_FL)
+		FS_PROJINHERIT_FL |	\
+		FS_COMPR_FL)
 
 /* Convert f2fs on-disk i_flags to FS_IOC_{GET,SET}FLAGS flags */
 static inline u32 f2fs_iflags_to_fsflags(u32 iflags)
@@ -1880,6 +1947,9 @@ static int f2fs_ioc_start_atomic_write(struct file *filp)
 	if (filp->f_flags & O_DIRECT)
 		return -EINVAL;
 
+	if (f2fs_compressed_file(inode))
+		return -EINVAL;
+
 	ret = mnt_want_write_file(filp);
 	if (ret)
 		return ret;
@@ -1981,7 +2051,7 @@ static int f2fs_ioc_start_volatile_write(struct file *filp)
 	if (!inode_owner_or_capable(inode))
 		return -EACCES;
 
-	if (!S_ISREG(inode->i_mode))
+	if (!S_ISREG(inode->i_mode) || f2fs_compressed_file(inode))
 		return -EINVAL;
 
 	ret = mnt_want_write_file(filp);
@@ -2517,6 +2587,9 @@ static int f2fs_ioc_defragment(struct file *filp, unsigned long arg)
 	if (!S_ISREG(inode->i_mode) || f2fs_is_atomic_file(inode))
 		return -EINVAL;
 
+	if (f2fs_compressed_file(inode))
+		return -EOPNOTSUPP;
+
 	if (f2fs_readonly(sbi->sb))
 		return -EROFS;
 
@@ -2573,6 +2646,9 @@ static int f2fs_move_file_range(struct file *file_in, loff_t pos_in,
 	if (IS_ENCRYPTED(src) || IS_ENCRYPTED(dst))
 		return -EOPNOTSUPP;
 
+	if (f2fs_compressed_file(src) || f2fs_compressed_file(dst))
+		return -EOPNOTSUPP;
+
 	if (src == dst) {
 		if (pos_in == pos_out)
 			return 0;
@@ -2754,6 +2830,7 @@ static int f2fs_ioc_flush_device(struct file *filp, unsigned long arg)
 		}
 		sm->last_victim[GC_CB] = end_segno + 1;
 		sm->last_victim[GC_GREEDY] = end_segno + 1;
+		sm->last_victim[GC_AT] = end_segno + 1;
 		sm->last_victim[ALLOC_NEXT] = end_segno + 1;
 		ret = f2fs_gc(sbi, true, true, start_segno);
 		if (ret == -EAGAIN)
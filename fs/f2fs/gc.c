@@ -20,6 +20,34 @@
 #include "gc.h"
 #include <trace/events/f2fs.h>
 
+/*
+ * Keep collecting victims while the device stays idle, so that background
+ * GC gets its work done in a few long quiet periods instead of one victim
+ * per wakeup, each of which may collide with foreground I/O.
+ */
+static void gc_idle_rounds(struct f2fs_sb_info *sbi)
+{
+	int rounds = sbi->screen_on ? DEF_GC_IDLE_ROUNDS :
+					DEF_GC_IDLE_ROUNDS_SCREEN_OFF;
+
+	while (--rounds > 0) {
+		if (kthread_should_stop() || freezing(current))
+			break;
+		if (!has_enough_invalid_blocks(sbi) || !is_idle(sbi, GC_TIME))
+			break;
+		if (!down_write_trylock(&sbi->gc_lock))
+			break;
+
+		stat_inc_bggc_count(sbi->stat_info);
+		sbi->gc_thread->fg_paused = false;
+		if (f2fs_gc(sbi, test_opt(sbi, FORCE_FG_GC), true, NULL_SEGNO))
+			break;
+		if (sbi->gc_thread->fg_paused)
+			break;
+		cond_resched();
+	}
+}
+
 static int gc_thread_func(void *data)
 {
 	struct f2fs_sb_info *sbi = data;
@@ -100,10 +128,13 @@ static int gc_thread_func(void *data)
 			increase_sleep_time(gc_th, &wait_ms);
 do_gc:
 		stat_inc_bggc_count(sbi->stat_info);
+		gc_th->fg_paused = false;
 
 		/* if return value is not zero, no victim was selected */
 		if (f2fs_gc(sbi, test_opt(sbi, FORCE_FG_GC), true, NULL_SEGNO))
 			wait_ms = gc_th->no_gc_sleep_time;
+		else if (sbi->gc_mode != GC_URGENT)
+			gc_idle_rounds(sbi);
 
 		trace_f2fs_background_gc(sbi->sb, wait_ms,
 				prefree_segments(sbi), free_segments(sbi));
@@ -135,6 +166,7 @@ int f2fs_start_gc_thread(struct f2fs_sb_info *sbi)
 	gc_th->no_gc_sleep_time = DEF_GC_THREAD_NOGC_SLEEP_TIME;
 
 	gc_th->gc_wake= 0;
+	gc_th->fg_paused = false;
 
 	sbi->gc_thread = gc_th;
 	init_waitqueue_head(&sbi->gc_thread->gc_wait_queue_head);
@@ -171,6 +203,10 @@ static int select_gc_type(struct f2fs_sb_info *sbi, int gc_type)
 	case GC_URGENT:
 		gc_mode = GC_GREEDY;
 		break;
+	case GC_IDLE_AT:
+		/* foreground GC must free space now, whatever its age */
+		gc_mode = (gc_type == BG_GC) ? GC_AT : GC_GREEDY;
+		break;
 	}
 	return gc_mode;
 }
@@ -214,7 +250,7 @@ static unsigned int get_max_cost(struct f2fs_sb_info *sbi,
 		return sbi->blocks_per_seg;
 	if (p->gc_mode == GC_GREEDY)
 		return 2 * sbi->blocks_per_seg * p->ofs_unit;
-	else if (p->gc_mode == GC_CB)
+	else if (p->gc_mode == GC_CB || p->gc_mode == GC_AT)
 		return UINT_MAX;
 	else /* No other gc_mode */
 		return 0;
@@ -239,15 +275,19 @@ static unsigned int check_bg_victims(struct f2fs_sb_info *sbi)
 	return NULL_SEGNO;
 }
 
-static unsigned int get_cb_cost(struct f2fs_sb_info *sbi, unsigned int segno)
+/*
+ * Return the average mtime of the section holding @segno, its utilization
+ * in @u and its age relative to the other sections, 0 (youngest) to 100
+ * (oldest), in @age.
+ */
+static unsigned long long get_sec_age(struct f2fs_sb_info *sbi,
+			unsigned int segno, unsigned char *u, unsigned char *age)
 {
 	struct sit_info *sit_i = SIT_I(sbi);
 	unsigned int secno = GET_SEC_FROM_SEG(sbi, segno);
 	unsigned int start = GET_SEG_FROM_SEC(sbi, secno);
 	unsigned long long mtime = 0;
 	unsigned int vblocks;
-	unsigned char age = 0;
-	unsigned char u;
 	unsigned int i;
 
 	for (i = 0; i < sbi->segs_per_sec; i++)
@@ -257,20 +297,53 @@ static unsigned int get_cb_cost(struct f2fs_sb_info *sbi, unsigned int segno)
 	mtime = div_u64(mtime, sbi->segs_per_sec);
 	vblocks = div_u64(vblocks, sbi->segs_per_sec);
 
-	u = (vblocks * 100) >> sbi->log_blocks_per_seg;
+	*u = (vblocks * 100) >> sbi->log_blocks_per_seg;
 
 	/* Handle if the system time has changed by the user */
 	if (mtime < sit_i->min_mtime)
 		sit_i->min_mtime = mtime;
 	if (mtime > sit_i->max_mtime)
 		sit_i->max_mtime = mtime;
+	*age = 0;
 	if (sit_i->max_mtime != sit_i->min_mtime)
-		age = 100 - div64_u64(100 * (mtime - sit_i->min_mtime),
+		*age = 100 - div64_u64(100 * (mtime - sit_i->min_mtime),
 				sit_i->max_mtime - sit_i->min_mtime);
 
+	return mtime;
+}
+
+static unsigned int get_cb_cost(struct f2fs_sb_info *sbi, unsigned int segno)
+{
+	unsigned char age, u;
+
+	get_sec_age(sbi, segno, &u, &age);
+
 	return UINT_MAX - ((100 * (100 - u) * age) / (100 + u));
 }
 
+/*
+ * Age-threshold cost: sections written to less than atgc_age_threshold
+ * seconds ago hold data that is likely to be overwritten soon, so moving
+ * it would only be wasted writes; they get the maximum cost and are
+ * never picked.  Older sections are ranked by a weighted sum of their
+ * relative age and their free space.
+ */
+static unsigned int get_at_cost(struct f2fs_sb_info *sbi, unsigned int segno)
+{
+	unsigned long long mtime, now = get_mtime(sbi, false);
+	unsigned int weight = sbi->atgc_age_weight;
+	unsigned char age, u;
+
+	mtime = get_sec_age(sbi, segno, &u, &age);
+	if (mtime + sbi->atgc_age_threshold > now) {
+		stat_inc_atgc_young_skip(sbi);
+		return UINT_MAX;
+	}
+
+	/* keep old sections below the UINT_MAX of young ones */
+	return UINT_MAX - 1 - (weight * age + (100 - weight) * (100 - u));
+}
+
 static inline unsigned int get_gc_cost(struct f2fs_sb_info *sbi,
 			unsigned int segno, struct victim_sel_policy *p)
 {
@@ -280,6 +353,8 @@ static inline unsigned int get_gc_cost(struct f2fs_sb_info *sbi,
 	/* alloc_mode == LFS */
 	if (p->gc_mode == GC_GREEDY)
 		return get_valid_blocks(sbi, segno, true);
+	else if (p->gc_mode == GC_AT)
+		return get_at_cost(sbi, segno);
 	else
 		return get_cb_cost(sbi, segno);
 }
@@ -313,6 +388,7 @@ static int get_victim_by_default(struct f2fs_sb_info *sbi,
 	unsigned int secno, last_victim;
 	unsigned int last_segment;
 	unsigned int nsearched = 0;
+	unsigned int ncandidates = 0;
 
 	mutex_lock(&dirty_i->seglist_lock);
 	last_segment = MAIN_SECS(sbi) * sbi->segs_per_sec;
@@ -410,8 +486,14 @@ static int get_victim_by_default(struct f2fs_sb_info *sbi,
 			p.min_segno = segno;
 			p.min_cost = cost;
 		}
+
+		/* bound the search once enough old sections were compared */
+		if (p.gc_mode == GC_AT && cost != UINT_MAX)
+			ncandidates++;
 next:
-		if (nsearched >= p.max_search) {
+		if (nsearched >= p.max_search ||
+				(p.gc_mode == GC_AT &&
+				 ncandidates >= sbi->atgc_candidate_count)) {
 			if (!sm->last_victim[p.gc_mode] && segno <= last_victim)
 				sm->last_victim[p.gc_mode] = last_victim + 1;
 			else
@@ -425,6 +507,8 @@ static int get_victim_by_default(struct f2fs_sb_info *sbi,
 got_it:
 		*result = (p.min_segno / p.ofs_unit) * p.ofs_unit;
 got_result:
+		if (p.gc_mode == GC_AT)
+			stat_inc_atgc_victim(sbi);
 		if (p.alloc_mode == LFS) {
 			secno = GET_SEC_FROM_SEG(sbi, p.min_segno);
 			if (gc_type == FG_GC)
@@ -498,6 +582,28 @@ static int check_valid_map(struct f2fs_sb_info *sbi,
 	return ret;
 }
 
+/*
+ * Background GC from the GC thread backs off as soon as foreground I/O
+ * shows up; the rest of the victim is picked up on a later round.
+ */
+static bool should_pause_bggc(struct f2fs_sb_info *sbi, int gc_type)
+{
+	struct f2fs_gc_kthread *gc_th = sbi->gc_thread;
+
+	if (gc_type != BG_GC || sbi->gc_mode == GC_URGENT)
+		return false;
+	if (!gc_th || current != gc_th->f2fs_gc_task)
+		return false;
+	if (gc_th->fg_paused)
+		return true;
+	if (!f2fs_fg_io_busy(sbi))
+		return false;
+
+	gc_th->fg_paused = true;
+	stat_fg_pause_bggc_count(sbi);
+	return true;
+}
+
 /*
  * This function compares node address got in summary with that in NAT.
  * On validity, copy that node with cold status, otherwise (invalid node)
@@ -512,6 +618,7 @@ static int gc_node_segment(struct f2fs_sb_info *sbi,
 	int phase = 0;
 	bool fggc = (gc_type == FG_GC);
 	int submitted = 0;
+	pgoff_t last_nat = ULONG_MAX;
 
 	start_addr = START_BLOCK(sbi, segno);
 
@@ -531,12 +638,14 @@ static int gc_node_segment(struct f2fs_sb_info *sbi,
 		if (gc_type == BG_GC && has_not_enough_free_secs(sbi, 0, 0))
 			return submitted;
 
+		if (should_pause_bggc(sbi, gc_type))
+			return submitted;
+
 		if (check_valid_map(sbi, segno, off) == 0)
 			continue;
 
 		if (phase == 0) {
-			f2fs_ra_meta_pages(sbi, NAT_BLOCK_OFFSET(nid), 1,
-							META_NAT, true);
+			f2fs_ra_nat_block(sbi, nid, &last_nat);
 			continue;
 		}
 
@@ -998,6 +1107,7 @@ static int gc_data_segment(struct f2fs_sb_info *sbi, struct f2fs_summary *sum,
 	int off;
 	int phase = 0;
 	int submitted = 0;
+	pgoff_t last_nat = ULONG_MAX;
 
 	start_addr = START_BLOCK(sbi, segno);
 
@@ -1022,12 +1132,14 @@ static int gc_data_segment(struct f2fs_sb_info *sbi, struct f2fs_summary *sum,
 							BLKS_PER_SEC(sbi))
 			return submitted;
 
+		if (should_pause_bggc(sbi, gc_type))
+			return submitted;
+
 		if (check_valid_map(sbi, segno, off) == 0)
 			continue;
 
 		if (phase == 0) {
-			f2fs_ra_meta_pages(sbi, NAT_BLOCK_OFFSET(nid), 1,
-							META_NAT, true);
+			f2fs_ra_nat_block(sbi, nid, &last_nat);
 			continue;
 		}
 
@@ -1064,7 +1176,8 @@ static int gc_data_segment(struct f2fs_sb_info *sbi, struct f2fs_summary *sum,
 			start_bidx = f2fs_start_bidx_of_node(nofs, inode) +
 								ofs_in_node;
 
-			if (f2fs_post_read_required(inode)) {
+			if (f2fs_post_read_required(inode) ||
+					f2fs_compressed_file(inode)) {
 				int err = ra_data_block(inode, start_bidx);
 
 				up_write(&F2FS_I(inode)->i_gc_rwsem[WRITE]);
@@ -1113,7 +1226,8 @@ static int gc_data_segment(struct f2fs_sb_info *sbi, struct f2fs_summary *sum,
 
 			start_bidx = f2fs_start_bidx_of_node(nofs, inode)
 								+ ofs_in_node;
-			if (f2fs_post_read_required(inode))
+			if (f2fs_post_read_required(inode) ||
+					f2fs_compressed_file(inode))
 				err = move_data_block(inode, start_bidx,
 							gc_type, segno, off);
 			else
@@ -1121,7 +1235,8 @@ static int gc_data_segment(struct f2fs_sb_info *sbi, struct f2fs_summary *sum,
 								segno, off);
 
 			if (!err && (gc_type == FG_GC ||
-					f2fs_post_read_required(inode)))
+					f2fs_post_read_required(inode) ||
+					f2fs_compressed_file(inode)))
 				submitted++;
 
 			if (locked) {
@@ -1203,6 +1318,8 @@ static int do_garbage_collect(struct f2fs_sb_info *sbi,
 
 		if (get_valid_blocks(sbi, segno, false) == 0)
 			goto freed;
+		if (should_pause_bggc(sbi, gc_type))
+			goto skip;
 		if (__is_large_section(sbi) &&
 				migrated >= sbi->migration_granularity)
 			goto skip;
@@ -14,6 +14,8 @@
 #define DEF_GC_THREAD_MIN_SLEEP_TIME	30000	/* milliseconds */
 #define DEF_GC_THREAD_MAX_SLEEP_TIME	60000
 #define DEF_GC_THREAD_NOGC_SLEEP_TIME	300000	/* wait 5 min */
+#define DEF_GC_IDLE_ROUNDS		4	/* victims per idle wakeup */
+#define DEF_GC_IDLE_ROUNDS_SCREEN_OFF	16
 #define LIMIT_INVALID_BLOCK	40 /* percentage over total user space */
 #define LIMIT_FREE_BLOCK	40 /* percentage over invalid + free space */
 
@@ -22,6 +24,11 @@
 /* Search max. number of dirty segments to select a victim segment */
 #define DEF_MAX_VICTIM_SEARCH 4096 /* covers 8GB */
 
+/* age-threshold GC defaults */
+#define DEF_ATGC_AGE_THRESHOLD		(7 * 24 * 60 * 60)	/* 7 days */
+#define DEF_ATGC_AGE_WEIGHT		60	/* percentage */
+#define DEF_ATGC_CANDIDATE_COUNT	16
+
 struct f2fs_gc_kthread {
 	struct task_struct *f2fs_gc_task;
 	wait_queue_head_t gc_wait_queue_head;
@@ -32,6 +39,9 @@ struct f2fs_gc_kthread {
 	unsigned int max_sleep_time;
 	unsigned int no_gc_sleep_time;
 
+	/* background GC backed off for foreground I/O */
+	bool fg_paused;
+
 	/* for changing gc mode */
 	unsigned int gc_wake;
 };
@@ -27,6 +27,9 @@ bool f2fs_may_inline_data(struct inode *inode)
 	if (f2fs_post_read_required(inode))
 		return false;
 
+	if (f2fs_compressed_file(inode))
+		return false;
+
 	return true;
 }
 
@@ -282,6 +282,17 @@ static bool sanity_check_inode(struct inode *inode, struct page *node_page)
 		return false;
 	}
 
+	if (is_inode_flag_set(inode, FI_COMPRESSED_FILE) &&
+		(fi->i_compress_algorithm >= COMPRESS_MAX ||
+		!fi->i_cluster_size ||
+		(S_ISREG(inode->i_mode) && f2fs_has_inline_data(inode)))) {
+		set_sbi_flag(sbi, SBI_NEED_FSCK);
+		f2fs_warn(sbi, "%s: inode (ino=%lx) has corrupted compress info, algorithm: %u, log_cluster_size: %u, run fsck to fix",
+			  __func__, inode->i_ino, fi->i_compress_algorithm,
+			  fi->i_log_cluster_size);
+		return false;
+	}
+
 	return true;
 }
 
@@ -332,6 +343,22 @@ static int do_read_inode(struct inode *inode)
 	fi->i_pino = le32_to_cpu(ri->i_pino);
 	fi->i_dir_level = ri->i_dir_level;
 
+	/* should be set before the extent tree and node offsets are used */
+	if (f2fs_sb_has_compression(sbi) &&
+			(ri->i_inline & F2FS_EXTRA_ATTR) &&
+			F2FS_FITS_IN_INODE(ri, le16_to_cpu(ri->i_extra_isize),
+						i_log_cluster_size) &&
+			(fi->i_flags & F2FS_COMPR_FL)) {
+		atomic_set(&fi->i_compr_blocks,
+				le64_to_cpu(ri->i_compr_blocks));
+		fi->i_compress_algorithm = ri->i_compress_algorithm;
+		fi->i_log_cluster_size = ri->i_log_cluster_size;
+		if (fi->i_log_cluster_size >= MIN_COMPRESS_LOG_SIZE &&
+			fi->i_log_cluster_size <= MAX_COMPRESS_LOG_SIZE)
+			fi->i_cluster_size = 1 << fi->i_log_cluster_size;
+		set_inode_flag(inode, FI_COMPRESSED_FILE);
+	}
+
 	if (f2fs_init_extent_tree(inode, &ri->i_ext))
 		set_page_dirty(node_page);
 
@@ -412,6 +439,8 @@ static int do_read_inode(struct inode *inode)
 	stat_inc_inline_xattr(inode);
 	stat_inc_inline_inode(inode);
 	stat_inc_inline_dir(inode);
+	stat_inc_compr_inode(inode);
+	stat_add_compr_blocks(inode, atomic_read(&fi->i_compr_blocks));
 
 	return 0;
 }
@@ -565,6 +594,17 @@ void f2fs_update_inode(struct inode *inode, struct page *node_page)
 			ri->i_crtime_nsec =
 				cpu_to_le32(F2FS_I(inode)->i_crtime.tv_nsec);
 		}
+
+		if (f2fs_sb_has_compression(F2FS_I_SB(inode)) &&
+			F2FS_FITS_IN_INODE(ri, F2FS_I(inode)->i_extra_isize,
+							i_log_cluster_size)) {
+			ri->i_compr_blocks = cpu_to_le64(
+				atomic_read(&F2FS_I(inode)->i_compr_blocks));
+			ri->i_compress_algorithm =
+				F2FS_I(inode)->i_compress_algorithm;
+			ri->i_log_cluster_size =
+				F2FS_I(inode)->i_log_cluster_size;
+		}
 	}
 
 	__set_inode_rdev(inode, ri);
@@ -706,6 +746,9 @@ void f2fs_evict_inode(struct inode *inode)
 	stat_dec_inline_xattr(inode);
 	stat_dec_inline_dir(inode);
 	stat_dec_inline_inode(inode);
+	stat_dec_compr_inode(inode);
+	stat_sub_compr_blocks(inode,
+			atomic_read(&F2FS_I(inode)->i_compr_blocks));
 
 	if (likely(!f2fs_cp_error(sbi) &&
 				!is_sbi_flag_set(sbi, SBI_CP_DISABLED)))
@@ -88,6 +88,12 @@ static struct inode *f2fs_new_inode(struct inode *dir, umode_t mode)
 	if (test_opt(sbi, INLINE_XATTR))
 		set_inode_flag(inode, FI_INLINE_XATTR);
 
+	/* should be decided before FI_INLINE_DATA */
+	if (f2fs_sb_has_compression(sbi) &&
+			(F2FS_I(dir)->i_flags & F2FS_COMPR_FL) &&
+			f2fs_may_compress(inode))
+		set_compress_context(inode);
+
 	if (test_opt(sbi, INLINE_DATA) && f2fs_may_inline_data(inode))
 		set_inode_flag(inode, FI_INLINE_DATA);
 	if (f2fs_may_inline_dentry(inode))
@@ -116,6 +122,9 @@ static struct inode *f2fs_new_inode(struct inode *dir, umode_t mode)
 	if (S_ISDIR(inode->i_mode))
 		F2FS_I(inode)->i_flags |= F2FS_INDEX_FL;
 
+	if (is_inode_flag_set(inode, FI_COMPRESSED_FILE))
+		F2FS_I(inode)->i_flags |= F2FS_COMPR_FL;
+
 	if (F2FS_I(inode)->i_flags & F2FS_PROJINHERIT_FL)
 		set_inode_flag(inode, FI_PROJ_INHERIT);
 
@@ -196,6 +205,35 @@ static inline void set_file_temperature(struct f2fs_sb_info *sbi, struct inode *
 		file_set_hot(inode);
 }
 
+/*
+ * Set file's compression context if its name matches one of the
+ * compress_extension mount options
+ */
+static void set_compress_inode(struct f2fs_sb_info *sbi, struct inode *inode,
+						const unsigned char *name)
+{
+	unsigned char (*extlist)[F2FS_EXTENSION_LEN] =
+					F2FS_OPTION(sbi).extensions;
+	unsigned char ext_cnt = F2FS_OPTION(sbi).compress_ext_cnt;
+	int i;
+
+	if (f2fs_compressed_file(inode) || !f2fs_may_compress(inode))
+		return;
+
+	for (i = 0; i < ext_cnt; i++) {
+		if (!is_extension_exist(name, extlist[i]))
+			continue;
+
+		/* the inode is not linked yet, so no inline data exists */
+		if (f2fs_has_inline_data(inode)) {
+			stat_dec_inline_inode(inode);
+			clear_inode_flag(inode, FI_INLINE_DATA);
+		}
+		set_compress_context(inode);
+		return;
+	}
+}
+
 int f2fs_update_extension_list(struct f2fs_sb_info *sbi, const char *name,
 							bool hot, bool set)
 {
@@ -286,6 +324,9 @@ static int f2fs_create(struct inode *dir, struct dentry *dentry, umode_t mode,
 	if (!test_opt(sbi, DISABLE_EXT_IDENTIFY))
 		set_file_temperature(sbi, inode, dentry->d_name.name);
 
+	if (f2fs_sb_has_compression(sbi))
+		set_compress_inode(sbi, inode, dentry->d_name.name);
+
 	inode->i_op = &f2fs_file_inode_operations;
 	inode->i_fop = &f2fs_file_operations;
 	inode->i_mapping->a_ops = &f2fs_dblock_aops;
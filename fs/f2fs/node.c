@@ -85,7 +85,8 @@ bool f2fs_available_free_memory(struct f2fs_sb_info *sbi, int type)
 				sizeof(struct extent_tree) +
 				atomic_read(&sbi->total_ext_node) *
 				sizeof(struct extent_node)) >> PAGE_SHIFT;
-		res = mem_size < ((avail_ram * nm_i->ram_thresh / 100) >> 1);
+		res = mem_size < ((avail_ram * nm_i->ram_thresh / 100) >> 1) &&
+				!f2fs_extent_cache_over_budget(sbi);
 	} else if (type == INMEM_PAGES) {
 		/* it allows 20% / total_ram for inmemory pages */
 		mem_size = get_pages(sbi, F2FS_INMEM_PAGES);
@@ -538,6 +539,7 @@ int f2fs_get_node_info(struct f2fs_sb_info *sbi, nid_t nid,
 		ni->blk_addr = nat_get_blkaddr(e);
 		ni->version = nat_get_version(e);
 		up_read(&nm_i->nat_tree_lock);
+		stat_inc_nat_hit(sbi);
 		return 0;
 	}
 
@@ -553,12 +555,14 @@ int f2fs_get_node_info(struct f2fs_sb_info *sbi, nid_t nid,
 	up_read(&curseg->journal_rwsem);
 	if (i >= 0) {
 		up_read(&nm_i->nat_tree_lock);
+		stat_inc_nat_journal_hit(sbi);
 		goto cache;
 	}
 
 	/* Fill node_info from nat page */
 	index = current_nat_addr(sbi, nid);
 	up_read(&nm_i->nat_tree_lock);
+	stat_inc_nat_blk_read(sbi);
 
 	page = f2fs_get_meta_page(sbi, index);
 	if (IS_ERR(page))
@@ -579,21 +583,63 @@ int f2fs_get_node_info(struct f2fs_sb_info *sbi, nid_t nid,
 	return 0;
 }
 
+/*
+ * Readahead the NAT block holding @nid unless its entry is already cached
+ * or its node page is in memory. @last is the NAT block issued last, so
+ * that a run of nids sharing a block only issues it once.
+ */
+void f2fs_ra_nat_block(struct f2fs_sb_info *sbi, nid_t nid, pgoff_t *last)
+{
+	struct f2fs_nm_info *nm_i = NM_I(sbi);
+	struct page *apage;
+	bool cached;
+
+	if (!nid || f2fs_check_nid_range(sbi, nid))
+		return;
+	if (NAT_BLOCK_OFFSET(nid) == *last)
+		return;
+
+	rcu_read_lock();
+	apage = radix_tree_lookup(&NODE_MAPPING(sbi)->page_tree, nid);
+	rcu_read_unlock();
+	if (apage)
+		return;
+
+	down_read(&nm_i->nat_tree_lock);
+	cached = __lookup_nat_cache(nm_i, nid);
+	up_read(&nm_i->nat_tree_lock);
+	if (cached)
+		return;
+
+	*last = NAT_BLOCK_OFFSET(nid);
+	f2fs_ra_meta_pages(sbi, *last, 1, META_NAT, true);
+	stat_inc_nat_ra(sbi);
+}
+
 /*
  * readahead MAX_RA_NODE number of node pages.
  */
 static void f2fs_ra_node_pages(struct page *parent, int start, int n)
 {
 	struct f2fs_sb_info *sbi = F2FS_P_SB(parent);
+	pgoff_t last_nat = ULONG_MAX;
 	struct blk_plug plug;
 	int i, end;
 	nid_t nid;
 
 	blk_start_plug(&plug);
 
-	/* Then, try readahead for siblings of the desired node */
 	end = start + n;
 	end = min(end, NIDS_PER_BLOCK);
+
+	/*
+	 * Issue the NAT blocks of the siblings first, otherwise looking up
+	 * the address of each sibling below waits for its NAT block in turn.
+	 */
+	for (i = start; i < end; i++)
+		f2fs_ra_nat_block(sbi, get_nid(parent, i, false), &last_nat);
+
+	/* Then, try readahead for siblings of the desired node */
 	for (i = start; i < end; i++) {
 		nid = get_nid(parent, i, false);
 		f2fs_ra_node_page(sbi, nid);
@@ -1335,6 +1381,7 @@ void f2fs_ra_node_page(struct f2fs_sb_info *sbi, nid_t nid)
 static struct page *__get_node_page(struct f2fs_sb_info *sbi, pgoff_t nid,
 					struct page *parent, int start)
 {
+	struct blk_plug plug;
 	struct page *page;
 	int err;
 
@@ -1347,17 +1394,27 @@ static struct page *__get_node_page(struct f2fs_sb_info *sbi, pgoff_t nid,
 	if (!page)
 		return ERR_PTR(-ENOMEM);
 
+	/* let the read of the node and of its siblings go out in one batch */
+	if (parent)
+		blk_start_plug(&plug);
+
 	err = read_node_page(page, 0);
 	if (err < 0) {
+		if (parent)
+			blk_finish_plug(&plug);
 		f2fs_put_page(page, 1);
 		return ERR_PTR(err);
 	} else if (err == LOCKED_PAGE) {
+		if (parent)
+			blk_finish_plug(&plug);
 		err = 0;
 		goto page_hit;
 	}
 
-	if (parent)
+	if (parent) {
 		f2fs_ra_node_pages(parent, start + 1, MAX_RA_NODE);
+		blk_finish_plug(&plug);
+	}
 
 	lock_page(page);
 
@@ -592,6 +592,15 @@ static int do_recover_data(struct f2fs_sb_info *sbi, struct inode *inode,
 			continue;
 		}
 
+		/* dest is the head of a compressed cluster */
+		if (dest == COMPRESS_ADDR) {
+			f2fs_truncate_data_blocks_range(&dn, 1);
+			f2fs_reserve_new_block(&dn);
+			dn.data_blkaddr = COMPRESS_ADDR;
+			f2fs_set_data_blkaddr(&dn);
+			continue;
+		}
+
 		/* dest is valid block, try to recover from src to dest */
 		if (f2fs_is_valid_blkaddr(sbi, dest, META_POR)) {
 
@@ -101,8 +101,9 @@ unsigned long f2fs_shrink_scan(struct shrinker *shrink,
 
 		sbi->shrinker_run_no = run_no;
 
-		/* shrink extent cache entries */
-		freed += f2fs_shrink_extent_tree(sbi, nr >> 1);
+		/* shrink extent cache entries, first to its budget */
+		freed += f2fs_shrink_extent_tree(sbi,
+				f2fs_extent_cache_over_budget(sbi) ? nr : nr >> 1);
 
 		/* shrink clean nat cache entries */
 		if (freed < nr)
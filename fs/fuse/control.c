@@ -10,6 +10,7 @@
 
 #include <linux/init.h>
 #include <linux/module.h>
+#include <linux/slab.h>
 
 #define FUSE_CTL_SUPER_MAGIC 0x65735543
 
@@ -170,6 +171,73 @@ static ssize_t fuse_conn_congestion_threshold_write(struct file *file,
 	return ret;
 }
 
+static size_t fuse_conn_queue_show(char *buf, size_t size, const char *name,
+				   struct fuse_iqueue *fiq)
+{
+	unsigned readers, depth;
+	u64 dispatched, wait_ns;
+
+	spin_lock(&fiq->waitq.lock);
+	readers = fiq->nr_readers;
+	depth = fiq->depth;
+	dispatched = fiq->dispatched;
+	wait_ns = fiq->wait_ns;
+	spin_unlock(&fiq->waitq.lock);
+
+	if (dispatched)
+		wait_ns = div64_u64(wait_ns, dispatched);
+
+	return scnprintf(buf, size, "%-6s %7u %5u %10llu %11llu\n", name,
+			 readers, depth, dispatched, div_u64(wait_ns, 1000));
+}
+
+/*
+ * One line per input queue: devices bound to it, requests pending,
+ * requests handed to userspace and their average time spent pending.
+ * Devices that are not bound read from the main queue.
+ */
+static ssize_t fuse_conn_queues_read(struct file *file, char __user *buf,
+				     size_t len, loff_t *ppos)
+{
+	struct fuse_conn *fc;
+	struct fuse_iqueue *iqs;
+	unsigned i, nr = 0;
+	size_t size, pos;
+	ssize_t ret;
+	char *tmp;
+
+	fc = fuse_ctl_file_conn_get(file);
+	if (!fc)
+		return 0;
+
+	iqs = smp_load_acquire(&fc->iqs);
+	if (iqs)
+		nr = fc->nr_iqs;
+
+	size = (nr + 2) * 80;
+	tmp = kmalloc(size, GFP_KERNEL);
+	if (!tmp) {
+		fuse_conn_put(fc);
+		return -ENOMEM;
+	}
+
+	pos = scnprintf(tmp, size, "queue  readers depth dispatched avg_wait_us\n");
+	pos += fuse_conn_queue_show(tmp + pos, size - pos, "main", &fc->iq);
+	for (i = 0; i < nr; i++) {
+		char name[8];
+
+		snprintf(name, sizeof(name), "%u", i);
+		pos += fuse_conn_queue_show(tmp + pos, size - pos, name,
+					    &iqs[i]);
+	}
+	fuse_conn_put(fc);
+
+	ret = simple_read_from_buffer(buf, len, ppos, tmp, pos);
+	kfree(tmp);
+
+	return ret;
+}
+
 static const struct file_operations fuse_ctl_abort_ops = {
 	.open = nonseekable_open,
 	.write = fuse_conn_abort_write,
@@ -182,6 +250,12 @@ static const struct file_operations fuse_ctl_waiting_ops = {
 	.llseek = no_llseek,
 };
 
+static const struct file_operations fuse_ctl_queues_ops = {
+	.open = nonseekable_open,
+	.read = fuse_conn_queues_read,
+	.llseek = no_llseek,
+};
+
 static const struct file_operations fuse_conn_max_background_ops = {
 	.open = nonseekable_open,
 	.read = fuse_conn_max_background_read,
@@ -264,7 +338,9 @@ int fuse_ctl_add_conn(struct fuse_conn *fc)
 				 1, NULL, &fuse_conn_max_background_ops) ||
 	    !fuse_ctl_add_dentry(parent, fc, "congestion_threshold",
 				 S_IFREG | 0600, 1, NULL,
-				 &fuse_conn_congestion_threshold_ops))
+				 &fuse_conn_congestion_threshold_ops) ||
+	    !fuse_ctl_add_dentry(parent, fc, "queues", S_IFREG | 0400, 1,
+				 NULL, &fuse_ctl_queues_ops))
 		goto err;
 
 	return 0;
@@ -318,18 +318,47 @@ static unsigned len_args(unsigned numargs, struct fuse_arg *args)
 
 static u64 fuse_get_unique(struct fuse_iqueue *fiq)
 {
-	return ++fiq->reqctr;
+	fiq->reqctr += FUSE_MAX_IQUEUES;
+	return fiq->reqctr;
 }
 
 static void queue_request(struct fuse_iqueue *fiq, struct fuse_req *req)
 {
 	req->in.h.len = sizeof(struct fuse_in_header) +
 		len_args(req->in.numargs, (struct fuse_arg *) req->in.args);
+	req->iq = fiq;
+	req->queued_ns = ktime_get_ns();
+	fiq->depth++;
 	list_add_tail(&req->list, &fiq->pending);
 	wake_up_locked(&fiq->waitq);
 	kill_fasync(&fiq->fasync, SIGIO, POLL_IN);
 }
 
+/*
+ * Lock the input queue a new request should go to: the queue of the
+ * current CPU if a device is bound to it, the main queue otherwise.
+ * Interrupts, forgets and notify replies always use the main queue.
+ */
+static struct fuse_iqueue *fuse_lock_iqueue(struct fuse_conn *fc)
+{
+	struct fuse_iqueue *iqs = smp_load_acquire(&fc->iqs);
+	struct fuse_iqueue *fiq;
+
+	if (iqs) {
+		fiq = &iqs[raw_smp_processor_id() % fc->nr_iqs];
+		if (READ_ONCE(fiq->nr_readers)) {
+			spin_lock(&fiq->waitq.lock);
+			if (fiq->nr_readers)
+				return fiq;
+			spin_unlock(&fiq->waitq.lock);
+		}
+	}
+
+	fiq = &fc->iq;
+	spin_lock(&fiq->waitq.lock);
+	return fiq;
+}
+
 void fuse_queue_forget(struct fuse_conn *fc, struct fuse_forget_link *forget,
 		       u64 nodeid, u64 nlookup)
 {
@@ -355,12 +384,12 @@ static void flush_bg_queue(struct fuse_conn *fc)
 	while (fc->active_background < fc->max_background &&
 	       !list_empty(&fc->bg_queue)) {
 		struct fuse_req *req;
-		struct fuse_iqueue *fiq = &fc->iq;
+		struct fuse_iqueue *fiq;
 
 		req = list_entry(fc->bg_queue.next, struct fuse_req, list);
 		list_del(&req->list);
 		fc->active_background++;
-		spin_lock(&fiq->waitq.lock);
+		fiq = fuse_lock_iqueue(fc);
 		req->in.h.unique = fuse_get_unique(fiq);
 		queue_request(fiq, req);
 		spin_unlock(&fiq->waitq.lock);
@@ -462,10 +491,18 @@ static void request_wait_answer(struct fuse_conn *fc, struct fuse_req *req)
 		if (!err)
 			return;
 
-		spin_lock(&fiq->waitq.lock);
+		/* Unbinding a device moves its pending requests elsewhere */
+		for (;;) {
+			fiq = READ_ONCE(req->iq);
+			spin_lock(&fiq->waitq.lock);
+			if (fiq == req->iq)
+				break;
+			spin_unlock(&fiq->waitq.lock);
+		}
 		/* Request is not yet in userspace, bail out */
 		if (test_bit(FR_PENDING, &req->flags)) {
 			list_del(&req->list);
+			fiq->depth--;
 			spin_unlock(&fiq->waitq.lock);
 			__fuse_put_request(req);
 			req->out.h.error = -EINTR;
@@ -485,10 +522,10 @@ static void request_wait_answer(struct fuse_conn *fc, struct fuse_req *req)
 
 static void __fuse_request_send(struct fuse_conn *fc, struct fuse_req *req)
 {
-	struct fuse_iqueue *fiq = &fc->iq;
+	struct fuse_iqueue *fiq;
 
 	BUG_ON(test_bit(FR_BACKGROUND, &req->flags));
-	spin_lock(&fiq->waitq.lock);
+	fiq = fuse_lock_iqueue(fc);
 	if (!fiq->connected) {
 		spin_unlock(&fiq->waitq.lock);
 		req->out.h.error = -ENOTCONN;
@@ -1271,7 +1308,7 @@ static ssize_t fuse_dev_do_read(struct fuse_dev *fud, struct file *file,
 {
 	ssize_t err;
 	struct fuse_conn *fc = fud->fc;
-	struct fuse_iqueue *fiq = &fc->iq;
+	struct fuse_iqueue *fiq = fud->iq ?: &fc->iq;
 	struct fuse_pqueue *fpq = &fud->pq;
 	struct fuse_req *req;
 	struct fuse_in *in;
@@ -1310,6 +1347,9 @@ static ssize_t fuse_dev_do_read(struct fuse_dev *fud, struct file *file,
 	req = list_entry(fiq->pending.next, struct fuse_req, list);
 	clear_bit(FR_PENDING, &req->flags);
 	list_del_init(&req->list);
+	fiq->depth--;
+	fiq->dispatched++;
+	fiq->wait_ns += ktime_get_ns() - req->queued_ns;
 	spin_unlock(&fiq->waitq.lock);
 
 	in = &req->in;
@@ -1362,7 +1402,7 @@ static ssize_t fuse_dev_do_read(struct fuse_dev *fud, struct file *file,
 	/* matches barrier in request_wait_answer() */
 	smp_mb__after_atomic();
 	if (test_bit(FR_INTERRUPTED, &req->flags))
-		queue_interrupt(fiq, req);
+		queue_interrupt(&fc->iq, req);
 	fuse_put_request(fc, req);
 
 	return reqsize;
@@ -2096,7 +2136,7 @@ static unsigned fuse_dev_poll(struct file *file, poll_table *wait)
 	if (!fud)
 		return POLLERR;
 
-	fiq = &fud->fc->iq;
+	fiq = fud->iq ?: &fud->fc->iq;
 	poll_wait(file, &fiq->waitq, wait);
 
 	spin_lock(&fiq->waitq.lock);
@@ -2167,6 +2207,7 @@ void fuse_abort_conn(struct fuse_conn *fc)
 	if (fc->connected) {
 		struct fuse_dev *fud;
 		struct fuse_req *req, *next;
+		unsigned i;
 		LIST_HEAD(to_end1);
 		LIST_HEAD(to_end2);
 
@@ -2195,8 +2236,20 @@ void fuse_abort_conn(struct fuse_conn *fc)
 		fc->max_background = UINT_MAX;
 		flush_bg_queue(fc);
 
+		for (i = 0; i < fc->nr_iqs; i++) {
+			struct fuse_iqueue *cpu_iq = &fc->iqs[i];
+
+			spin_lock(&cpu_iq->waitq.lock);
+			cpu_iq->connected = 0;
+			cpu_iq->depth = 0;
+			list_splice_init(&cpu_iq->pending, &to_end2);
+			wake_up_all_locked(&cpu_iq->waitq);
+			spin_unlock(&cpu_iq->waitq.lock);
+		}
+
 		spin_lock(&fiq->waitq.lock);
 		fiq->connected = 0;
+		fiq->depth = 0;
 		list_splice_init(&fiq->pending, &to_end2);
 		list_for_each_entry(req, &to_end2, list)
 			clear_bit(FR_PENDING, &req->flags);
@@ -2228,6 +2281,34 @@ void fuse_wait_aborted(struct fuse_conn *fc)
 	wait_event(fc->blocked_waitq, atomic_read(&fc->num_waiting) == 0);
 }
 
+/*
+ * Hand the pending requests of a queue back to the main queue when its
+ * last reader goes away, so that they are not stranded.
+ */
+static void fuse_device_unbind(struct fuse_dev *fud)
+{
+	struct fuse_iqueue *fiq = fud->iq;
+	struct fuse_iqueue *main_iq = &fud->fc->iq;
+	struct fuse_req *req;
+
+	if (!fiq)
+		return;
+
+	spin_lock(&fiq->waitq.lock);
+	if (!--fiq->nr_readers && !list_empty(&fiq->pending)) {
+		spin_lock_nested(&main_iq->waitq.lock, SINGLE_DEPTH_NESTING);
+		list_for_each_entry(req, &fiq->pending, list)
+			req->iq = main_iq;
+		main_iq->depth += fiq->depth;
+		fiq->depth = 0;
+		list_splice_tail_init(&fiq->pending, &main_iq->pending);
+		wake_up_locked(&main_iq->waitq);
+		spin_unlock(&main_iq->waitq.lock);
+	}
+	spin_unlock(&fiq->waitq.lock);
+	fud->iq = NULL;
+}
+
 int fuse_dev_release(struct inode *inode, struct file *file)
 {
 	struct fuse_dev *fud = fuse_get_dev(file);
@@ -2244,6 +2325,8 @@ int fuse_dev_release(struct inode *inode, struct file *file)
 
 		end_requests(fc, &to_end);
 
+		fuse_device_unbind(fud);
+
 		/* Are we the last open device? */
 		if (atomic_dec_and_test(&fc->dev_count)) {
 			WARN_ON(fc->iq.fasync != NULL);
@@ -2283,6 +2366,33 @@ static int fuse_device_clone(struct fuse_conn *fc, struct file *new)
 	return 0;
 }
 
+/*
+ * Bind a device to the input queue serving CPU @cpu.  Requests issued
+ * on that CPU are then read through this device (or any other device
+ * bound to the same queue) instead of the main queue.
+ */
+static int fuse_device_bind(struct fuse_dev *fud, u32 cpu)
+{
+	struct fuse_conn *fc = fud->fc;
+	struct fuse_iqueue *fiq;
+	int err;
+
+	if (fud->iq)
+		return -EBUSY;
+
+	err = fuse_conn_alloc_iqueues(fc);
+	if (err)
+		return err;
+
+	fiq = &fc->iqs[cpu % fc->nr_iqs];
+	spin_lock(&fiq->waitq.lock);
+	fiq->nr_readers++;
+	spin_unlock(&fiq->waitq.lock);
+	WRITE_ONCE(fud->iq, fiq);
+
+	return 0;
+}
+
 static long fuse_dev_ioctl(struct file *file, unsigned int cmd,
 			   unsigned long arg)
 {
@@ -2315,6 +2425,19 @@ static long fuse_dev_ioctl(struct file *file, unsigned int cmd,
 				fput(old);
 			}
 		}
+	} else if (cmd == FUSE_DEV_IOC_BIND_QUEUE) {
+		struct fuse_dev *fud = fuse_get_dev(file);
+		u32 cpu;
+
+		err = -EINVAL;
+		if (fud) {
+			err = -EFAULT;
+			if (!get_user(cpu, (__u32 __user *) arg)) {
+				mutex_lock(&fuse_mutex);
+				err = fuse_device_bind(fud, cpu);
+				mutex_unlock(&fuse_mutex);
+			}
+		}
 	}
 	return err;
 }
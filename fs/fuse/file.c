@@ -2121,6 +2121,9 @@ static int fuse_file_mmap(struct file *file, struct vm_area_struct *vma)
 {
 	struct fuse_file *ff = file->private_data;
 
+	if (ff->passthrough_enabled && ff->passthrough_filp)
+		return fuse_passthrough_mmap(file, vma);
+
 	ff->passthrough_enabled = 0;
 	if ((vma->vm_flags & VM_SHARED) && (vma->vm_flags & VM_MAYWRITE))
 		fuse_link_write_file(file);
@@ -2134,6 +2137,9 @@ static int fuse_direct_mmap(struct file *file, struct vm_area_struct *vma)
 {
 	struct fuse_file *ff = file->private_data;
 
+	if (ff->passthrough_enabled && ff->passthrough_filp)
+		return fuse_passthrough_mmap(file, vma);
+
 	ff->passthrough_enabled = 0;
 	/* Can't provide the coherency needed for MAP_SHARED */
 	if (vma->vm_flags & VM_MAYSHARE)
@@ -35,7 +35,10 @@
 #define FUSE_NAME_MAX 1024
 
 /** Number of dentries for each connection in the control filesystem */
-#define FUSE_CTL_NUM_DENTRIES 5
+#define FUSE_CTL_NUM_DENTRIES 6
+
+/** Upper bound on input queues per connection, including the main one */
+#define FUSE_MAX_IQUEUES 64
 
 /** Number of page pointers embedded in fuse_req */
 #define FUSE_REQ_INLINE_PAGES 1
@@ -332,6 +335,12 @@ struct fuse_req {
 	/** Used to wake up the task waiting for completion of request*/
 	wait_queue_head_t waitq;
 
+	/** Input queue the request was put on */
+	struct fuse_iqueue *iq;
+
+	/** Time the request was put on the input queue */
+	u64 queued_ns;
+
 	/** Data for asynchronous requests */
 	union {
 		struct {
@@ -421,6 +430,18 @@ struct fuse_iqueue {
 
 	/** O_ASYNC requests */
 	struct fasync_struct *fasync;
+
+	/** Number of devices bound to this queue  */
+	unsigned nr_readers;
+
+	/** Number of requests on the pending list */
+	unsigned depth;
+
+	/** Number of requests handed to userspace */
+	u64 dispatched;
+
+	/** Total time dispatched requests spent pending, in ns */
+	u64 wait_ns;
 };
 
 struct fuse_pqueue {
@@ -447,6 +468,9 @@ struct fuse_dev {
 	/** Processing queue */
 	struct fuse_pqueue pq;
 
+	/** Input queue this device is bound to, NULL for the main queue */
+	struct fuse_iqueue *iq;
+
 	/** list entry on fc->devices */
 	struct list_head entry;
 };
@@ -485,6 +509,12 @@ struct fuse_conn {
 	/** Input queue */
 	struct fuse_iqueue iq;
 
+	/** Per-CPU input queues, allocated when a device is first bound */
+	struct fuse_iqueue *iqs;
+
+	/** Number of entries in iqs */
+	unsigned nr_iqs;
+
 	/** The next unique kernel file handle */
 	u64 khctr;
 
@@ -557,6 +587,9 @@ struct fuse_conn {
 	/** passthrough IO. */
 	unsigned passthrough:1;
 
+	/** passthrough readdir, OPENDIR may return a passthrough_fd too */
+	unsigned passthrough_readdir:1;
+
 	/*
 	 * The following bitfields are only for optimization purposes
 	 * and hence races in setting them will not cause malfunction
@@ -676,6 +709,13 @@ struct fuse_conn {
 	/** Called on final put */
 	void (*release)(struct fuse_conn *);
 
+	/**
+	 * Permission filter for passthrough readdir, returns false to hide
+	 * an entry of the lower directory.  NULL shows every entry.
+	 */
+	bool (*readdir_filter)(struct file *dir, const char *name, int namelen,
+			       u64 ino, unsigned int d_type);
+
 	/** Super block for this connection. */
 	struct super_block *sb;
 
@@ -909,6 +949,11 @@ void fuse_conn_init(struct fuse_conn *fc);
  */
 void fuse_conn_put(struct fuse_conn *fc);
 
+/**
+ * Allocate the per-CPU input queues of a connection
+ */
+int fuse_conn_alloc_iqueues(struct fuse_conn *fc);
+
 struct fuse_dev *fuse_dev_alloc(struct fuse_conn *fc);
 void fuse_dev_free(struct fuse_dev *fud);
 
@@ -26,6 +26,10 @@ ssize_t fuse_passthrough_read_iter(struct kiocb *iocb, struct iov_iter *to);
 
 ssize_t fuse_passthrough_write_iter(struct kiocb *iocb, struct iov_iter *from);
 
+int fuse_passthrough_mmap(struct file *file, struct vm_area_struct *vma);
+
+int fuse_passthrough_readdir(struct file *file, struct dir_context *ctx);
+
 void fuse_passthrough_release(struct fuse_file *ff);
 
 #endif /* _FS_FUSE_PASSTHROUGH_H */
@@ -603,6 +603,39 @@ static void fuse_iqueue_init(struct fuse_iqueue *fiq)
 	fiq->connected = 1;
 }
 
+/*
+ * Unique ids are handed out in steps of FUSE_MAX_IQUEUES, so that each
+ * input queue can number its requests without a shared counter.  The
+ * main queue uses the multiples of the step, queue i uses i + 1 above
+ * them.
+ */
+int fuse_conn_alloc_iqueues(struct fuse_conn *fc)
+{
+	struct fuse_iqueue *iqs;
+	unsigned nr = min_t(unsigned, nr_cpu_ids, FUSE_MAX_IQUEUES - 1);
+	unsigned i;
+
+	if (fc->iqs)
+		return 0;
+
+	iqs = kcalloc(nr, sizeof(struct fuse_iqueue), GFP_KERNEL);
+	if (!iqs)
+		return -ENOMEM;
+
+	spin_lock(&fc->lock);
+	for (i = 0; i < nr; i++) {
+		fuse_iqueue_init(&iqs[i]);
+		iqs[i].reqctr = i + 1;
+		iqs[i].connected = fc->connected;
+	}
+	fc->nr_iqs = nr;
+	/* Pairs with smp_load_acquire() in fuse_lock_iqueue() */
+	smp_store_release(&fc->iqs, iqs);
+	spin_unlock(&fc->lock);
+
+	return 0;
+}
+
 static void fuse_pqueue_init(struct fuse_pqueue *fpq)
 {
 	memset(fpq, 0, sizeof(struct fuse_pqueue));
@@ -643,6 +676,7 @@ void fuse_conn_put(struct fuse_conn *fc)
 	if (atomic_dec_and_test(&fc->count)) {
 		if (fc->destroy_req)
 			fuse_request_free(fc->destroy_req);
+		kfree(fc->iqs);
 		fc->release(fc);
 	}
 }
@@ -929,6 +963,8 @@ static void process_init_reply(struct fuse_conn *fc, struct fuse_req *req)
 				/* Prevent further stacking */
 				fc->sb->s_stack_depth =
 					FILESYSTEM_MAX_STACK_DEPTH;
+				if (arg->flags & FUSE_PASSTHROUGH_READDIR)
+					fc->passthrough_readdir = 1;
 			}
 			if (arg->time_gran && arg->time_gran <= 1000000000)
 				fc->sb->s_time_gran = arg->time_gran;
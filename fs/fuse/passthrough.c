@@ -15,6 +15,7 @@
 #include "fuse_passthrough.h"
 
 #include <linux/aio.h>
+#include <linux/cred.h>
 #include <linux/fs_stack.h>
 
 void fuse_setup_passthrough(struct fuse_conn *fc, struct fuse_req *req)
@@ -32,7 +33,8 @@ void fuse_setup_passthrough(struct fuse_conn *fc, struct fuse_req *req)
 		return;
 
 	if ((req->in.h.opcode != FUSE_OPEN) &&
-	    (req->in.h.opcode != FUSE_CREATE))
+	    (req->in.h.opcode != FUSE_CREATE) &&
+	    (req->in.h.opcode != FUSE_OPENDIR || !fc->passthrough_readdir))
 		return;
 
 	open_out_index = req->in.numargs - 1;
@@ -124,6 +126,86 @@ ssize_t fuse_passthrough_write_iter(struct kiocb *iocb, struct iov_iter *from)
 	return fuse_passthrough_read_write_iter(iocb, from, 1);
 }
 
+int fuse_passthrough_mmap(struct file *file, struct vm_area_struct *vma)
+{
+	int ret_val;
+	struct fuse_file *ff = file->private_data;
+	struct file *passthrough_filp = ff->passthrough_filp;
+
+	if (!passthrough_filp->f_op->mmap)
+		return -ENODEV;
+
+	if (WARN_ON(file != vma->vm_file))
+		return -EIO;
+
+	/*
+	 * Map the lower file itself, so that faults are served by its own
+	 * vm_ops and page cache and never reach the daemon.
+	 */
+	vma->vm_file = get_file(passthrough_filp);
+	ret_val = passthrough_filp->f_op->mmap(passthrough_filp, vma);
+	if (ret_val) {
+		vma->vm_file = file;
+		fput(passthrough_filp);
+		return ret_val;
+	}
+	fput(file);
+
+	fsstack_copy_attr_atime(file_inode(file), file_inode(passthrough_filp));
+	return 0;
+}
+
+struct fuse_passthrough_getdents {
+	struct dir_context ctx;
+	struct dir_context *caller;
+	struct file *dir;
+	bool (*filter)(struct file *dir, const char *name, int namelen,
+		       u64 ino, unsigned int d_type);
+};
+
+static int fuse_passthrough_filldir(struct dir_context *ctx, const char *name,
+				    int namelen, loff_t offset, u64 ino,
+				    unsigned int d_type)
+{
+	struct fuse_passthrough_getdents *buf =
+		container_of(ctx, struct fuse_passthrough_getdents, ctx);
+
+	buf->caller->pos = buf->ctx.pos;
+	if (buf->filter && !buf->filter(buf->dir, name, namelen, ino, d_type))
+		return 0;
+
+	return !dir_emit(buf->caller, name, namelen, ino, d_type);
+}
+
+int fuse_passthrough_readdir(struct file *file, struct dir_context *ctx)
+{
+	int ret_val;
+	struct fuse_file *ff = file->private_data;
+	struct file *passthrough_filp = ff->passthrough_filp;
+	const struct cred *old_cred;
+	struct fuse_passthrough_getdents buf = {
+		.ctx.actor = fuse_passthrough_filldir,
+		.caller = ctx,
+		.dir = file,
+		.filter = ff->fc->readdir_filter,
+	};
+
+	/* list the lower directory with the daemon's credentials */
+	get_file(passthrough_filp);
+	old_cred = override_creds(passthrough_filp->f_cred);
+	passthrough_filp->f_pos = ctx->pos;
+	ret_val = iterate_dir(passthrough_filp, &buf.ctx);
+	ctx->pos = buf.ctx.pos;
+	revert_creds(old_cred);
+
+	if (ret_val >= 0)
+		fsstack_copy_attr_atime(file_inode(file),
+					file_inode(passthrough_filp));
+	fput(passthrough_filp);
+
+	return ret_val;
+}
+
 void fuse_passthrough_release(struct fuse_file *ff)
 {
 	if (!(ff->passthrough_filp))
@@ -303,7 +303,6 @@ static int proc_map_release(struct inode *inode, struct file *file)
 	if (priv->mm)
 		mmdrop(priv->mm);
 
-	kfree(priv->rollup);
 	return seq_release_private(inode, file);
 }
 
@@ -496,7 +495,6 @@ const struct file_operations proc_tid_maps_operations = {
 
 #ifdef CONFIG_PROC_PAGE_MONITOR
 struct mem_size_stats {
-	bool first;
 	unsigned long resident;
 	unsigned long shared_clean;
 	unsigned long shared_dirty;
@@ -509,7 +507,6 @@ struct mem_size_stats {
 	unsigned long swap;
 	unsigned long shared_hugetlb;
 	unsigned long private_hugetlb;
-	unsigned long first_vma_start;
 	u64 pss;
 	u64 pss_locked;
 	u64 swap_pss;
@@ -791,38 +788,17 @@ void __weak arch_show_smap(struct seq_file *m, struct vm_area_struct *vma)
 {
 }
 
-static int show_smap(struct seq_file *m, void *v, int is_pid)
+static void smap_gather_stats(struct vm_area_struct *vma,
+			      struct mem_size_stats *mss)
 {
-	struct proc_maps_private *priv = m->private;
-	struct vm_area_struct *vma = v;
-	struct mem_size_stats mss_stack;
-	struct mem_size_stats *mss;
 	struct mm_walk smaps_walk = {
 		.pmd_entry = smaps_pte_range,
 #ifdef CONFIG_HUGETLB_PAGE
 		.hugetlb_entry = smaps_hugetlb_range,
 #endif
 		.mm = vma->vm_mm,
+		.private = mss,
 	};
-	int ret = 0;
-	bool rollup_mode;
-	bool last_vma;
-
-	if (priv->rollup) {
-		rollup_mode = true;
-		mss = priv->rollup;
-		if (mss->first) {
-			mss->first_vma_start = vma->vm_start;
-			mss->first = false;
-		}
-		last_vma = !m_next_vma(priv, vma);
-	} else {
-		rollup_mode = false;
-		memset(&mss_stack, 0, sizeof(mss_stack));
-		mss = &mss_stack;
-	}
-
-	smaps_walk.private = mss;
 
 #ifdef CONFIG_SHMEM
 	/* In case of smaps_rollup, reset the value from previous vma */
@@ -849,76 +825,76 @@ static int show_smap(struct seq_file *m, void *v, int is_pid)
 		}
 	}
 #endif
-	/* mmap_sem is held in m_start */
+	/* mmap_sem is held by the caller */
 	walk_page_vma(vma, &smaps_walk);
+}
 
-	if (!rollup_mode) {
-		show_map_vma(m, vma, is_pid);
-	} else if (last_vma) {
-		show_vma_header_prefix(
-			m, mss->first_vma_start, vma->vm_end, 0, 0, 0, 0);
-		seq_pad(m, ' ');
-		seq_puts(m, "[rollup]\n");
-	} else {
-		ret = SEQ_SKIP;
-	}
+static void show_smap_counters(struct seq_file *m, struct mem_size_stats *mss)
+{
+	seq_printf(m,
+		   "Rss:            %8lu kB\n"
+		   "Pss:            %8lu kB\n"
+		   "Shared_Clean:   %8lu kB\n"
+		   "Shared_Dirty:   %8lu kB\n"
+		   "Private_Clean:  %8lu kB\n"
+		   "Private_Dirty:  %8lu kB\n"
+		   "Referenced:     %8lu kB\n"
+		   "Anonymous:      %8lu kB\n"
+		   "AnonHugePages:  %8lu kB\n"
+		   "ShmemPmdMapped: %8lu kB\n"
+		   "Shared_Hugetlb: %8lu kB\n"
+		   "Private_Hugetlb: %7lu kB\n"
+		   "Swap:           %8lu kB\n"
+		   "SwapPss:        %8lu kB\n"
+		   "Locked:         %8lu kB\n",
+		   mss->resident >> 10,
+		   (unsigned long)(mss->pss >> (10 + PSS_SHIFT)),
+		   mss->shared_clean  >> 10,
+		   mss->shared_dirty  >> 10,
+		   mss->private_clean >> 10,
+		   mss->private_dirty >> 10,
+		   mss->referenced >> 10,
+		   mss->anonymous >> 10,
+		   mss->anonymous_thp >> 10,
+		   mss->shmem_thp >> 10,
+		   mss->shared_hugetlb >> 10,
+		   mss->private_hugetlb >> 10,
+		   mss->swap >> 10,
+		   (unsigned long)(mss->swap_pss >> (10 + PSS_SHIFT)),
+		   (unsigned long)(mss->pss_locked >> (10 + PSS_SHIFT)));
+}
 
-	if (!rollup_mode && vma_get_anon_name(vma)) {
+static int show_smap(struct seq_file *m, void *v, int is_pid)
+{
+	struct vm_area_struct *vma = v;
+	struct mem_size_stats mss;
+
+	memset(&mss, 0, sizeof(mss));
+	smap_gather_stats(vma, &mss);
+
+	show_map_vma(m, vma, is_pid);
+
+	if (vma_get_anon_name(vma)) {
 		seq_puts(m, "Name:           ");
 		seq_print_vma_name(m, vma);
 		seq_putc(m, '\n');
 	}
 
-	if (!rollup_mode)
-		seq_printf(m,
-			   "Size:           %8lu kB\n"
-			   "KernelPageSize: %8lu kB\n"
-			   "MMUPageSize:    %8lu kB\n",
-			   (vma->vm_end - vma->vm_start) >> 10,
-			   vma_kernel_pagesize(vma) >> 10,
-			   vma_mmu_pagesize(vma) >> 10);
-
-	if (!rollup_mode || last_vma)
-		seq_printf(m,
-			   "Rss:            %8lu kB\n"
-			   "Pss:            %8lu kB\n"
-			   "Shared_Clean:   %8lu kB\n"
-			   "Shared_Dirty:   %8lu kB\n"
-			   "Private_Clean:  %8lu kB\n"
-			   "Private_Dirty:  %8lu kB\n"
-			   "Referenced:     %8lu kB\n"
-			   "Anonymous:      %8lu kB\n"
-			   "AnonHugePages:  %8lu kB\n"
-			   "ShmemPmdMapped: %8lu kB\n"
-			   "Shared_Hugetlb: %8lu kB\n"
-			   "Private_Hugetlb: %7lu kB\n"
-			   "Swap:           %8lu kB\n"
-			   "SwapPss:        %8lu kB\n"
-			   "Locked:         %8lu kB\n",
-			   mss->resident >> 10,
-			   (unsigned long)(mss->pss >> (10 + PSS_SHIFT)),
-			   mss->shared_clean  >> 10,
-			   mss->shared_dirty  >> 10,
-			   mss->private_clean >> 10,
-			   mss->private_dirty >> 10,
-			   mss->referenced >> 10,
-			   mss->anonymous >> 10,
-			   mss->anonymous_thp >> 10,
-			   mss->shmem_thp >> 10,
-			   mss->shared_hugetlb >> 10,
-			   mss->private_hugetlb >> 10,
-			   mss->swap >> 10,
-			   (unsigned long)(mss->swap_pss >> (10 + PSS_SHIFT)),
-			   (unsigned long)(mss->pss_locked >> (10 + PSS_SHIFT)));
-
-
-	if (!rollup_mode) {
-		arch_show_smap(m, vma);
-		show_smap_vma_flags(m, vma);
-	}
+	seq_printf(m,
+		   "Size:           %8lu kB\n"
+		   "KernelPageSize: %8lu kB\n"
+		   "MMUPageSize:    %8lu kB\n",
+		   (vma->vm_end - vma->vm_start) >> 10,
+		   vma_kernel_pagesize(vma) >> 10,
+		   vma_mmu_pagesize(vma) >> 10);
+
+	show_smap_counters(m, &mss);
+
+	arch_show_smap(m, vma);
+	show_smap_vma_flags(m, vma);
 
 	m_cache_vma(m, vma);
-	return ret;
+	return 0;
 }
 
 static int show_pid_smap(struct seq_file *m, void *v)
@@ -950,25 +926,6 @@ static int pid_smaps_open(struct inode *inode, struct file *file)
 	return do_maps_open(inode, file, &proc_pid_smaps_op);
 }
 
-static int pid_smaps_rollup_open(struct inode *inode, struct file *file)
-{
-	struct seq_file *seq;
-	struct proc_maps_private *priv;
-	int ret = do_maps_open(inode, file, &proc_pid_smaps_op);
-
-	if (ret < 0)
-		return ret;
-	seq = file->private_data;
-	priv = seq->private;
-	priv->rollup = kzalloc(sizeof(*priv->rollup), GFP_KERNEL);
-	if (!priv->rollup) {
-		proc_map_release(inode, file);
-		return -ENOMEM;
-	}
-	priv->rollup->first = true;
-	return 0;
-}
-
 static int tid_smaps_open(struct inode *inode, struct file *file)
 {
 	return do_maps_open(inode, file, &proc_tid_smaps_op);
@@ -981,18 +938,228 @@ const struct file_operations proc_pid_smaps_operations = {
 	.release	= proc_map_release,
 };
 
-const struct file_operations proc_pid_smaps_rollup_operations = {
-	.open		= pid_smaps_rollup_open,
+const struct file_operations proc_tid_smaps_operations = {
+	.open		= tid_smaps_open,
 	.read		= seq_read,
 	.llseek		= seq_lseek,
 	.release	= proc_map_release,
 };
 
-const struct file_operations proc_tid_smaps_operations = {
-	.open		= tid_smaps_open,
+/*
+ * smaps_rollup sums the counters of every VMA in a single walk with
+ * mmap_sem held, and reports how long it was held.
+ *
+ * When vm.smaps_rollup_cache_ms is non-zero, the totals of the last walk of
+ * an mm are kept along with a snapshot of its RSS counters and mapping sizes,
+ * and later reads reuse them without taking mmap_sem for up to that many
+ * milliseconds, as long as the snapshot still matches.  Changes that leave
+ * the snapshot alone, such as pages being dirtied or referenced, or other
+ * processes mapping or unmapping shared pages and so moving the PSS, show up
+ * once the cached totals expire.
+ */
+int sysctl_smaps_rollup_cache_ms;
+
+struct smaps_rollup {
+	struct mem_size_stats mss;
+	unsigned long start;
+	unsigned long end;
+	u64 hold_ns;
+};
+
+struct smaps_rollup_key {
+	unsigned long counters[NR_MM_COUNTERS];
+	unsigned long total_vm;
+	unsigned long locked_vm;
+	unsigned long map_count;
+};
+
+struct smaps_rollup_cache {
+	spinlock_t lock;
+	bool valid;
+	unsigned long expires;
+	struct smaps_rollup_key key;
+	struct smaps_rollup rollup;
+};
+
+static void smaps_rollup_key(struct mm_struct *mm, struct smaps_rollup_key *key)
+{
+	int i;
+
+	for (i = 0; i < NR_MM_COUNTERS; i++)
+		key->counters[i] = get_mm_counter(mm, i);
+	key->total_vm = READ_ONCE(mm->total_vm);
+	key->locked_vm = READ_ONCE(mm->locked_vm);
+	key->map_count = READ_ONCE(mm->map_count);
+}
+
+static bool smaps_rollup_cache_get(struct mm_struct *mm,
+				   const struct smaps_rollup_key *key,
+				   struct smaps_rollup *r)
+{
+	struct smaps_rollup_cache *cache = READ_ONCE(mm->smaps_rollup_cache);
+	bool hit;
+
+	if (!cache)
+		return false;
+
+	spin_lock(&cache->lock);
+	hit = cache->valid && time_before(jiffies, cache->expires) &&
+	      !memcmp(&cache->key, key, sizeof(*key));
+	if (hit)
+		*r = cache->rollup;
+	spin_unlock(&cache->lock);
+
+	return hit;
+}
+
+static void smaps_rollup_cache_put(struct mm_struct *mm,
+				   const struct smaps_rollup_key *key,
+				   const struct smaps_rollup *r,
+				   unsigned int cache_ms)
+{
+	struct smaps_rollup_cache *cache = READ_ONCE(mm->smaps_rollup_cache);
+
+	if (!cache) {
+		cache = kzalloc(sizeof(*cache), GFP_KERNEL);
+		if (!cache)
+			return;
+		spin_lock_init(&cache->lock);
+		if (cmpxchg(&mm->smaps_rollup_cache, NULL, cache)) {
+			kfree(cache);
+			cache = READ_ONCE(mm->smaps_rollup_cache);
+		}
+	}
+
+	spin_lock(&cache->lock);
+	cache->key = *key;
+	cache->rollup = *r;
+	cache->expires = jiffies + msecs_to_jiffies(cache_ms);
+	cache->valid = true;
+	spin_unlock(&cache->lock);
+}
+
+/*
+ * Called once the last user of @mm is gone, so no smaps_rollup reader can
+ * look at the cache any more.
+ */
+void proc_smaps_rollup_cache_free(struct mm_struct *mm)
+{
+	kfree(mm->smaps_rollup_cache);
+	mm->smaps_rollup_cache = NULL;
+}
+
+static void smaps_rollup_walk(struct proc_maps_private *priv,
+			      struct smaps_rollup *r)
+{
+	struct mm_struct *mm = priv->mm;
+	struct vm_area_struct *vma;
+	u64 start;
+
+	down_read(&mm->mmap_sem);
+	start = ktime_get_ns();
+
+	priv->tail_vma = get_gate_vma(mm);
+	vma = mm->mmap ? mm->mmap : priv->tail_vma;
+	if (vma)
+		r->start = vma->vm_start;
+	for (; vma; vma = m_next_vma(priv, vma)) {
+		smap_gather_stats(vma, &r->mss);
+		r->end = vma->vm_end;
+	}
+
+	r->hold_ns = ktime_get_ns() - start;
+	up_read(&mm->mmap_sem);
+}
+
+static int show_smaps_rollup(struct seq_file *m, void *v)
+{
+	struct proc_maps_private *priv = m->private;
+	unsigned int cache_ms = READ_ONCE(sysctl_smaps_rollup_cache_ms);
+	struct mm_struct *mm = priv->mm;
+	struct smaps_rollup_key key;
+	struct smaps_rollup r;
+
+	priv->task = get_proc_task(priv->inode);
+	if (!priv->task)
+		return -ESRCH;
+
+	if (!mm || !mmget_not_zero(mm))
+		goto out_put_task;
+
+	memset(&key, 0, sizeof(key));
+	smaps_rollup_key(mm, &key);
+
+	if (cache_ms && smaps_rollup_cache_get(mm, &key, &r)) {
+		r.hold_ns = 0;
+	} else {
+		memset(&r, 0, sizeof(r));
+		smaps_rollup_walk(priv, &r);
+		if (cache_ms)
+			smaps_rollup_cache_put(mm, &key, &r, cache_ms);
+	}
+
+	mmput(mm);
+
+	if (r.end) {
+		show_vma_header_prefix(m, r.start, r.end, 0, 0, 0, 0);
+		seq_pad(m, ' ');
+		seq_puts(m, "[rollup]\n");
+		show_smap_counters(m, &r.mss);
+		seq_printf(m, "MmapSemHeld:    %8llu us\n",
+			   div_u64(r.hold_ns, NSEC_PER_USEC));
+	}
+
+out_put_task:
+	put_task_struct(priv->task);
+	priv->task = NULL;
+	return 0;
+}
+
+static int pid_smaps_rollup_open(struct inode *inode, struct file *file)
+{
+	struct proc_maps_private *priv;
+	int ret;
+
+	priv = kzalloc(sizeof(*priv), GFP_KERNEL);
+	if (!priv)
+		return -ENOMEM;
+
+	ret = single_open(file, show_smaps_rollup, priv);
+	if (ret)
+		goto out_free;
+
+	priv->inode = inode;
+	priv->mm = proc_mem_open(inode, PTRACE_MODE_READ);
+	if (IS_ERR(priv->mm)) {
+		ret = PTR_ERR(priv->mm);
+		single_release(inode, file);
+		goto out_free;
+	}
+
+	return 0;
+
+out_free:
+	kfree(priv);
+	return ret;
+}
+
+static int pid_smaps_rollup_release(struct inode *inode, struct file *file)
+{
+	struct seq_file *seq = file->private_data;
+	struct proc_maps_private *priv = seq->private;
+
+	if (priv->mm)
+		mmdrop(priv->mm);
+
+	kfree(priv);
+	return single_release(inode, file);
+}
+
+const struct file_operations proc_pid_smaps_rollup_operations = {
+	.open		= pid_smaps_rollup_open,
 	.read		= seq_read,
 	.llseek		= seq_lseek,
-	.release	= proc_map_release,
+	.release	= pid_smaps_rollup_release,
 };
 
 enum clear_refs_types {
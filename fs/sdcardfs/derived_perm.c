@@ -130,8 +130,8 @@ void get_derived_permission_new(struct inode *parent, struct inode *inode,
 	case PERM_ANDROID_DATA:
 	case PERM_ANDROID_MEDIA:
 		info->data->perm = PERM_ANDROID_PACKAGE;
-		appid = get_appid(name->name);
-		if (appid != 0 && !is_excluded(name->name, parent_data->userid))
+		appid = get_appid_for_user(name, parent_data->userid);
+		if (appid != 0)
 			info->data->d_uid =
 				multiuser_get_uid(parent_data->userid, appid);
 		break;
@@ -147,7 +147,19 @@ void get_derived_permission_new(struct inode *parent, struct inode *inode,
 
 void get_derived_permission(struct inode *parent, struct dentry *dentry)
 {
+	struct sdcardfs_dentry_info *di = SDCARDFS_D(dentry);
+	unsigned int gen = packagelist_generation();
+
+	/* nothing changed since this dentry was last derived */
+	if (di && READ_ONCE(di->perm_dir) == parent &&
+			READ_ONCE(di->perm_gen) == gen)
+		return;
+
 	get_derived_permission_new(parent, d_inode(dentry), &dentry->d_name);
+	if (di) {
+		WRITE_ONCE(di->perm_gen, gen);
+		WRITE_ONCE(di->perm_dir, parent);
+	}
 }
 
 static appid_t get_type(const char *name)
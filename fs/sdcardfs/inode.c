@@ -465,6 +465,8 @@ static int sdcardfs_rename(struct inode *old_dir, struct dentry *old_dentry,
 		sdcardfs_copy_and_fix_attrs(old_dir, d_inode(lower_old_dir_dentry));
 		fsstack_copy_inode_size(old_dir, d_inode(lower_old_dir_dentry));
 	}
+	/* the subtree moved, cached derived state below it is stale */
+	packagelist_invalidate();
 	get_derived_permission_new(d_inode(new_dentry->d_parent),
 					d_inode(old_dentry),
 					&new_dentry->d_name);
@@ -45,6 +45,22 @@ static DEFINE_HASHTABLE(ext_to_groupid, 8);
 
 static struct kmem_cache *hashtable_entry_cachep;
 
+/*
+ * Bumped whenever a change may alter derived permissions, so that dentries
+ * know their cached state is stale.
+ */
+static atomic_t packagelist_gen = ATOMIC_INIT(1);
+
+unsigned int packagelist_generation(void)
+{
+	return atomic_read(&packagelist_gen);
+}
+
+void packagelist_invalidate(void)
+{
+	atomic_inc(&packagelist_gen);
+}
+
 static unsigned int full_name_case_hash(const void *salt, const unsigned char *name, unsigned int len)
 {
 	unsigned long hash = init_name_hash(salt);
@@ -145,6 +161,23 @@ appid_t is_excluded(const char *key, userid_t user)
 	return __is_excluded(&q, user);
 }
 
+/*
+ * appid of a package name for the given user, or 0 if the package is
+ * unknown or excluded for that user. The name is only hashed once for
+ * both tables.
+ */
+appid_t get_appid_for_user(const struct qstr *app_name, userid_t user)
+{
+	struct qstr q = QSTR_INIT(app_name->name, app_name->len);
+	appid_t appid;
+
+	q.hash = full_name_case_hash(0, q.name, q.len);
+	appid = __get_appid(&q);
+	if (appid && __is_excluded(&q, user))
+		return 0;
+	return appid;
+}
+
 /* Kernel has already enforced everything we returned through
  * derive_permissions_locked(), so this is used to lock down access
  * even further, such as enforcing that apps hold sdcard_rw.
@@ -202,6 +235,7 @@ static int insert_packagelist_appid_entry_locked(const struct qstr *key, appid_t
 	hash_for_each_possible_rcu(package_to_appid, hash_cur, hlist, hash) {
 		if (qstr_case_eq(key, &hash_cur->key)) {
 			atomic_set(&hash_cur->value, value);
+			packagelist_invalidate();
 			return 0;
 		}
 	}
@@ -209,6 +243,7 @@ static int insert_packagelist_appid_entry_locked(const struct qstr *key, appid_t
 	if (!new_entry)
 		return -ENOMEM;
 	hash_add_rcu(package_to_appid, &new_entry->hlist, hash);
+	packagelist_invalidate();
 	return 0;
 }
 
@@ -246,6 +281,7 @@ static int insert_userid_exclude_entry_locked(const struct qstr *key, userid_t v
 	if (!new_entry)
 		return -ENOMEM;
 	hash_add_rcu(package_to_userid, &new_entry->hlist, hash);
+	packagelist_invalidate();
 	return 0;
 }
 
@@ -361,6 +397,7 @@ static void remove_packagelist_entry(const struct qstr *key)
 {
 	mutex_lock(&sdcardfs_super_list_lock);
 	remove_packagelist_entry_locked(key);
+	packagelist_invalidate();
 	fixup_all_perms_name(key);
 	mutex_unlock(&sdcardfs_super_list_lock);
 }
@@ -410,6 +447,7 @@ static void remove_userid_all_entry(userid_t userid)
 {
 	mutex_lock(&sdcardfs_super_list_lock);
 	remove_userid_all_entry_locked(userid);
+	packagelist_invalidate();
 	fixup_all_perms_userid(userid);
 	mutex_unlock(&sdcardfs_super_list_lock);
 }
@@ -434,6 +472,7 @@ static void remove_userid_exclude_entry(const struct qstr *key, userid_t userid)
 {
 	mutex_lock(&sdcardfs_super_list_lock);
 	remove_userid_exclude_entry_locked(key, userid);
+	packagelist_invalidate();
 	fixup_all_perms_name_userid(key, userid);
 	mutex_unlock(&sdcardfs_super_list_lock);
 }
@@ -190,6 +190,10 @@ struct sdcardfs_dentry_info {
 	spinlock_t lock;	/* protects lower_path */
 	struct path lower_path;
 	struct path orig_path;
+
+	/* derived permissions are up to date for this parent and generation */
+	struct inode *perm_dir;
+	unsigned int perm_gen;
 };
 
 struct sdcardfs_mount_options {
@@ -492,6 +496,9 @@ extern struct list_head sdcardfs_super_list;
 extern appid_t get_appid(const char *app_name);
 extern appid_t get_ext_gid(const char *app_name);
 extern appid_t is_excluded(const char *app_name, userid_t userid);
+extern appid_t get_appid_for_user(const struct qstr *app_name, userid_t userid);
+extern unsigned int packagelist_generation(void);
+extern void packagelist_invalidate(void);
 extern int check_caller_access_to_name(struct inode *parent_node, const struct qstr *name);
 extern int packagelist_init(void);
 extern void packagelist_exit(void);
@@ -714,6 +714,9 @@
 #define INIT_CALLS_LEVEL(level)						\
 		VMLINUX_SYMBOL(__initcall##level##_start) = .;		\
 		KEEP(*(.initcall##level##.init))			\
+		VMLINUX_SYMBOL(__initcall##level##a_start) = .;		\
+		KEEP(*(.initcall##level##a.init))			\
+		VMLINUX_SYMBOL(__initcall##level##a_end) = .;		\
 		KEEP(*(.initcall##level##s.init))			\
 
 #define INIT_CALLS							\
@@ -162,6 +162,11 @@ struct shash_desc {
  * @export: see struct ahash_alg
  * @import: see struct ahash_alg
  * @setkey: see struct ahash_alg
+ * @finup_mb: Finish hashing @num_msgs messages of the same length, all
+ *	      continuing from the state in @desc, which is left unchanged.
+ *	      Only called with 2 <= @num_msgs <= @mb_max_msgs; may return
+ *	      -EOPNOTSUPP to have the messages hashed one at a time.
+ * @mb_max_msgs: Largest number of messages @finup_mb handles at once.
  * @digestsize: see struct ahash_alg
  * @statesize: see struct ahash_alg
  * @descsize: Size of the operational state for the message digest. This state
@@ -182,7 +187,11 @@ struct shash_alg {
 	int (*import)(struct shash_desc *desc, const void *in);
 	int (*setkey)(struct crypto_shash *tfm, const u8 *key,
 		      unsigned int keylen);
+	int (*finup_mb)(struct shash_desc *desc, const u8 * const data[],
+			unsigned int len, u8 * const outs[],
+			unsigned int num_msgs);
 
+	unsigned int mb_max_msgs;
 	unsigned int descsize;
 
 	/* These fields must match hash_alg_common. */
@@ -924,6 +933,37 @@ int crypto_shash_final(struct shash_desc *desc, u8 *out);
 int crypto_shash_finup(struct shash_desc *desc, const u8 *data,
 		       unsigned int len, u8 *out);
 
+/**
+ * crypto_shash_mb_max_msgs() - messages hashed together by finup_mb
+ * @tfm: hash transformation object
+ *
+ * Return: the number of messages crypto_shash_finup_mb() can interleave;
+ *	   1 if the algorithm hashes one message at a time.
+ */
+static inline unsigned int crypto_shash_mb_max_msgs(struct crypto_shash *tfm)
+{
+	return crypto_shash_alg(tfm)->mb_max_msgs;
+}
+
+/**
+ * crypto_shash_finup_mb() - finish hashing several messages at once
+ * @desc: state common to all messages, left unchanged
+ * @data: the messages, all @len bytes long
+ * @len: length of each message
+ * @outs: where to store the digests
+ * @num_msgs: number of messages, at most crypto_shash_mb_max_msgs()
+ *
+ * Computes what crypto_shash_finup() on a copy of @desc would for each
+ * message, but lets the algorithm interleave them to keep its pipeline
+ * busy. Typically used for many same-size blocks hashed after a common
+ * prefix, such as a salt.
+ *
+ * Return: 0 if all message digests were computed; < 0 if an error occurred
+ */
+int crypto_shash_finup_mb(struct shash_desc *desc, const u8 * const data[],
+			  unsigned int len, u8 * const outs[],
+			  unsigned int num_msgs);
+
 static inline void shash_desc_zero(struct shash_desc *desc)
 {
 	memzero_explicit(desc,
@@ -68,6 +68,47 @@
 #define DIAG_IOCTL_HDLC_TOGGLE	38
 #define DIAG_IOCTL_QUERY_PD_LOGGING	39
 #define DIAG_IOCTL_QUERY_MD_PID	41
+#define DIAG_IOCTL_MD_RING_SETUP	42
+
+/*
+ * Memory device ring, set up with DIAG_IOCTL_MD_RING_SETUP and mapped with
+ * mmap() on the diag node. The mapping starts with struct diag_md_ring_hdr,
+ * followed at data_offset by a power of two sized data area. Each packet is
+ * a struct diag_md_ring_rec followed by its payload, padded to
+ * DIAG_MD_RING_ALIGN. A record never wraps; the space left at the end of
+ * the data area is skipped with a DIAG_MD_RING_F_PAD record.
+ *
+ * head and tail are free running byte counts, offsets are taken modulo
+ * size. The driver only advances head and the client only advances tail,
+ * each with release semantics after the data they cover. Packets that do
+ * not fit are dropped and counted per peripheral.
+ */
+#define DIAG_MD_RING_VERSION		1
+#define DIAG_MD_RING_MAX_PERIPH		16
+#define DIAG_MD_RING_ALIGN		8
+#define DIAG_MD_RING_F_PAD		0x01
+
+struct diag_md_ring_setup {
+	uint32_t size;
+	uint32_t data_offset;
+	uint32_t map_size;
+};
+
+struct diag_md_ring_hdr {
+	uint32_t version;
+	uint32_t size;
+	uint32_t data_offset;
+	uint32_t head;
+	uint32_t tail;
+	uint32_t drops[DIAG_MD_RING_MAX_PERIPH];
+};
+
+struct diag_md_ring_rec {
+	uint32_t len;
+	uint16_t proc;
+	uint8_t peripheral;
+	uint8_t flags;
+};
 
 /* PC Tools IDs */
 #define APQ8060_TOOLS_ID	4062
@@ -124,6 +124,9 @@ struct dma_buf_ops {
  * @poll: for userspace poll support
  * @cb_excl: for userspace poll support
  * @cb_shared: for userspace poll support
+ * @cpu_write_seq: bumped whenever cpu access that may write begins or ends,
+ *                 lets importers tell whether the buffer changed since they
+ *                 last did cache maintenance on it.
  */
 struct dma_buf {
 	size_t size;
@@ -148,6 +151,8 @@ struct dma_buf {
 
 		unsigned long active;
 	} cb_excl, cb_shared;
+
+	atomic_t cpu_write_seq;
 };
 
 /**
@@ -39,6 +39,7 @@ struct fence_array_cb {
  * @num_fences: number of fences in the array
  * @num_pending: fences in the array still pending
  * @fences: array of the fences
+ * @cached: allocated from the fence_array slab cache
  */
 struct fence_array {
 	struct fence base;
@@ -47,6 +48,7 @@ struct fence_array {
 	unsigned num_fences;
 	atomic_t num_pending;
 	struct fence **fences;
+	bool cached;
 };
 
 extern const struct fence_ops fence_array_ops;
@@ -80,4 +82,9 @@ struct fence_array *fence_array_create(int num_fences, struct fence **fences,
 				       u64 context, unsigned seqno,
 				       bool signal_on_any);
 
+struct fence_array *fence_array_alloc(int num_fences);
+void fence_array_init(struct fence_array *array, int num_fences,
+		      u64 context, unsigned seqno, bool signal_on_any);
+void fence_array_free(struct fence_array *array);
+
 #endif /* __LINUX_FENCE_ARRAY_H */
@@ -14,6 +14,7 @@
 #include <linux/workqueue.h>
 #include <linux/sched.h>
 #include <linux/capability.h>
+#include <linux/jump_label.h>
 
 #include <net/sch_generic.h>
 
@@ -423,7 +424,15 @@ struct sk_filter {
 	struct bpf_prog	*prog;
 };
 
-#define BPF_PROG_RUN(filter, ctx)  (*(filter)->bpf_func)(ctx, (filter)->insnsi)
+DECLARE_STATIC_KEY_FALSE(bpf_stats_enabled_key);
+
+unsigned int bpf_prog_run_stats(const struct bpf_prog *prog, const void *ctx);
+
+/* Runtime accounting is only paid for while kernel.bpf_stats_enabled is set */
+#define BPF_PROG_RUN(filter, ctx)					\
+	(static_branch_unlikely(&bpf_stats_enabled_key) ?		\
+	 bpf_prog_run_stats(filter, ctx) :				\
+	 (*(filter)->bpf_func)(ctx, (filter)->insnsi))
 
 #define BPF_SKB_CB_LEN QDISC_CB_PRIV_LEN
 
@@ -561,6 +570,7 @@ struct bpf_prog *bpf_prog_alloc(unsigned int size, gfp_t gfp_extra_flags);
 struct bpf_prog *bpf_prog_realloc(struct bpf_prog *fp_old, unsigned int size,
 				  gfp_t gfp_extra_flags);
 void __bpf_prog_free(struct bpf_prog *fp);
+void bpf_prog_get_stats(const struct bpf_prog *prog, u64 *cnt, u64 *nsecs);
 
 static inline void bpf_prog_unlock_free(struct bpf_prog *fp)
 {
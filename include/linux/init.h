@@ -211,6 +211,16 @@ extern bool initcall_debug;
 #define late_initcall(fn)		__define_initcall(fn, 7)
 #define late_initcall_sync(fn)		__define_initcall(fn, 7s)
 
+/*
+ * Async initcalls run on a worker pool, in parallel with the other async
+ * initcalls of their level and after its plain initcalls.  All of them
+ * have finished before the _sync initcalls of the level start.  Only use
+ * these for inits that depend on nothing else in the same level, such as
+ * drivers with long probes that nothing later looks up directly.
+ */
+#define device_initcall_async(fn)	__define_initcall(fn, 6a)
+#define late_initcall_async(fn)		__define_initcall(fn, 7a)
+
 #define __initcall(fn) device_initcall(fn)
 
 #define __exitcall(fn)						\
@@ -35,6 +35,10 @@ struct pt_regs;
  * @affinity_hint:	hint to user space for preferred irq affinity
  * @affinity_notify:	context for notification of affinity changes
  * @pending_mask:	pending rebalanced interrupts
+ * @balance_last:	irq count at the last rate balancer sample
+ * @balance_rate:	interrupts per second seen by the rate balancer
+ * @balance_moves:	number of migrations done by the rate balancer
+ * @balance_cpu:	cpu the rate balancer last moved the irq to, or -1
  * @threads_oneshot:	bitfield to handle shared oneshot threads
  * @threads_active:	number of irqaction threads currently running
  * @wait_for_threads:	wait queue for sync_irq to wait for threaded handlers
@@ -76,6 +80,12 @@ struct irq_desc {
 #ifdef CONFIG_GENERIC_PENDING_IRQ
 	cpumask_var_t		pending_mask;
 #endif
+#ifdef CONFIG_IRQ_RATE_BALANCE
+	unsigned int		balance_last;
+	unsigned int		balance_rate;
+	unsigned int		balance_moves;
+	int			balance_cpu;
+#endif
 #endif
 	unsigned long		threads_oneshot;
 	atomic_t		threads_active;
@@ -409,6 +409,7 @@ struct mm_rss_stat {
 };
 
 struct kioctx_table;
+struct smaps_rollup_cache;
 struct mm_struct {
 	struct vm_area_struct *mmap;		/* list of VMAs */
 	struct rb_root mm_rb;
@@ -467,6 +468,10 @@ struct mm_struct {
 	 */
 	struct mm_rss_stat rss_stat;
 
+#ifdef CONFIG_PROC_PAGE_MONITOR
+	struct smaps_rollup_cache *smaps_rollup_cache; /* for /proc/PID/smaps_rollup */
+#endif
+
 	struct linux_binfmt *binfmt;
 
 	cpumask_var_t cpu_vm_mask_var;
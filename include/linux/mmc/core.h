@@ -118,6 +118,8 @@ struct mmc_request {
 	/* Allow other commands during this ongoing data transfer or busy wait */
 	bool			cap_cmd_during_tfr;
 	ktime_t			io_start;
+	ktime_t			lat_issue;	/* handed to the host */
+	ktime_t			lat_complete;	/* host signalled completion */
 #ifdef CONFIG_BLOCK
 	int			lat_hist_enabled;
 #endif
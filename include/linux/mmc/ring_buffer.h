@@ -17,6 +17,7 @@
 
 #include <linux/mmc/card.h>
 #include <linux/smp.h>
+#include <linux/ktime.h>
 
 #include "core.h"
 
@@ -25,12 +26,51 @@
 #define MMC_TRACE_EVENT_SZ	256
 #define MMC_TRACE_RBUF_NUM_EVENTS	(MMC_TRACE_RBUF_SZ / MMC_TRACE_EVENT_SZ)
 
+/*
+ * Request classes tracked by the latency histograms. CMDQ data tasks are
+ * kept apart from the legacy read/write commands as their issue time is
+ * the time the task was queued, not the time it went out on the bus.
+ */
+enum mmc_lat_op {
+	MMC_LAT_READ_SINGLE,
+	MMC_LAT_READ_MULTI,
+	MMC_LAT_WRITE_SINGLE,
+	MMC_LAT_WRITE_MULTI,
+	MMC_LAT_CMDQ_READ,
+	MMC_LAT_CMDQ_WRITE,
+	MMC_LAT_FLUSH,
+	MMC_LAT_DISCARD,
+	MMC_LAT_OTHER,
+	MMC_LAT_NR_OPS,
+};
+
+enum mmc_lat_phase {
+	MMC_LAT_ISSUE_TO_COMPLETE,
+	MMC_LAT_COMPLETE_TO_DONE,
+	MMC_LAT_NR_PHASES,
+};
+
+/* Bucket 0 is < 1us, bucket n is [2^(n-1), 2^n) us, the last is open */
+#define MMC_LAT_NR_BUCKETS	22
+
+struct mmc_lat_hist {
+	u64	count;
+	u64	sum_us;
+	u64	max_us;
+	u32	buckets[MMC_LAT_NR_BUCKETS];
+};
+
+struct mmc_lat_stats {
+	struct mmc_lat_hist hist[MMC_LAT_NR_OPS][MMC_LAT_NR_PHASES];
+};
+
 struct mmc_host;
 struct mmc_trace_buffer {
 	int	wr_idx;
 	bool stop_tracing;
 	spinlock_t trace_lock;
 	char *data;
+	struct mmc_lat_stats *lat;
 };
 
 #ifdef CONFIG_MMC_RING_BUFFER
@@ -39,6 +79,15 @@ void mmc_trace_write(struct mmc_host *mmc, const char *fmt, ...);
 void mmc_trace_init(struct mmc_host *mmc);
 void mmc_trace_free(struct mmc_host *mmc);
 void mmc_dump_trace_buffer(struct mmc_host *mmc, struct seq_file *s);
+void mmc_lat_hist_complete(struct mmc_host *mmc, struct mmc_request *mrq);
+void mmc_lat_hist_done(struct mmc_host *mmc, struct mmc_request *mrq);
+void mmc_dump_lat_hist(struct mmc_host *mmc, struct seq_file *s);
+void mmc_reset_lat_hist(struct mmc_host *mmc);
+
+static inline void mmc_lat_hist_issue(struct mmc_request *mrq)
+{
+	mrq->lat_issue = ktime_get();
+}
 #else
 static inline void mmc_stop_tracing(struct mmc_host *mmc) {}
 static inline void mmc_trace_write(struct mmc_host *mmc,
@@ -47,6 +96,14 @@ static inline void mmc_trace_init(struct mmc_host *mmc) {}
 static inline void mmc_trace_free(struct mmc_host *mmc) {}
 static inline void mmc_dump_trace_buffer(struct mmc_host *mmc,
 		struct seq_file *s) {}
+static inline void mmc_lat_hist_issue(struct mmc_request *mrq) {}
+static inline void mmc_lat_hist_complete(struct mmc_host *mmc,
+		struct mmc_request *mrq) {}
+static inline void mmc_lat_hist_done(struct mmc_host *mmc,
+		struct mmc_request *mrq) {}
+static inline void mmc_dump_lat_hist(struct mmc_host *mmc,
+		struct seq_file *s) {}
+static inline void mmc_reset_lat_hist(struct mmc_host *mmc) {}
 #endif
 
 #define MMC_TRACE(mmc, fmt, ...) \
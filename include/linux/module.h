@@ -86,6 +86,15 @@ extern void cleanup_module(void);
  */
 #define module_init(x)	__initcall(x);
 
+/**
+ * module_init_async() - driver initialization entry point, run in parallel
+ * @x: function to be run at kernel boot time or module insertion
+ *
+ * Like module_init(), but when built in @x runs as a device_initcall_async()
+ * next to the other independent driver inits of the device level.
+ */
+#define module_init_async(x)	device_initcall_async(x);
+
 /**
  * module_exit() - driver exit entry point
  * @x: function to be run when driver is removed
@@ -122,6 +131,9 @@ extern void cleanup_module(void);
 #define device_initcall_sync(fn)	module_init(fn)
 #define late_initcall(fn)		module_init(fn)
 #define late_initcall_sync(fn)		module_init(fn)
+#define device_initcall_async(fn)	module_init(fn)
+#define late_initcall_async(fn)		module_init(fn)
+#define module_init_async(fn)		module_init(fn)
 
 #define console_initcall(fn)		module_init(fn)
 #define security_initcall(fn)		module_init(fn)
@@ -130,6 +130,8 @@ int msm_bus_scale_query_tcs_cmd(struct msm_bus_tcs_usecase *tcs_usecase,
 					uint32_t cl, unsigned int index);
 int msm_bus_scale_query_tcs_cmd_all(struct msm_bus_tcs_handle *tcs_handle,
 					uint32_t cl);
+int msm_bus_scale_batch_begin(void);
+int msm_bus_scale_batch_commit(void);
 
 /* AXI Port configuration APIs */
 int msm_bus_axi_porthalt(int master_port);
@@ -190,6 +192,16 @@ msm_bus_scale_update_bw(struct msm_bus_client_handle *cl, u64 ab, u64 ib)
 	return 0;
 }
 
+static inline int msm_bus_scale_batch_begin(void)
+{
+	return 0;
+}
+
+static inline int msm_bus_scale_batch_commit(void)
+{
+	return 0;
+}
+
 static inline int
 msm_bus_scale_update_bw_context(struct msm_bus_client_handle *cl, u64 act_ab,
 				u64 act_ib, u64 dual_ib, u64 dual_ab)
@@ -193,6 +193,8 @@ enum sps_option {
 	SPS_O_LATE_EOT   = 0x00080000,
 
 	/* Options to enable software features */
+	/* Deliver completed descriptors in batches, one callback per run */
+	SPS_O_BATCH_DONE      = 0x00400000,
 	/* Do not disable a pipe during disconnection */
 	SPS_O_NO_DISABLE      = 0x00800000,
 	/* Transfer operation should be polled */
@@ -671,6 +673,18 @@ struct sps_event_notify {
 			void *user;
 		} transfer;
 
+		/*
+		 * Data for SPS_EVENT_EOT or SPS_EVENT_DESC_DONE with
+		 * SPS_O_BATCH_DONE: num contiguous completed descriptors and
+		 * their user pointers, valid only during the callback
+		 */
+
+		struct {
+			struct sps_iovec *iovec;
+			void **user;
+			u32 num;
+		} batch;
+
 		/* Data for SPS_EVENT_ERROR */
 
 		struct {
@@ -1038,6 +1052,26 @@ int sps_get_event(struct sps_pipe *h, struct sps_event_notify *event);
  */
 int sps_get_iovec(struct sps_pipe *h, struct sps_iovec *iovec);
 
+/**
+ * Get a batch of processed I/O vectors (completed transfers)
+ *
+ * This function fetches up to @max processed I/O vectors, reading the
+ * pipe's descriptor offset once for the whole batch.
+ *
+ * @h - client context for SPS connection end point
+ *
+ * @iovec - array of at least @max I/O vector structs (output)
+ *
+ * @max - maximum number of I/O vectors to fetch
+ *
+ * @num - number of I/O vectors fetched (0 if there are none)
+ *
+ * @return 0 on success, negative value on error
+ *
+ */
+int sps_get_iovecs(struct sps_pipe *h, struct sps_iovec *iovec, u32 max,
+		   u32 *num);
+
 /**
  * Enable an SPS connection end point
  *
@@ -1509,6 +1543,12 @@ static inline int sps_get_iovec(struct sps_pipe *h, struct sps_iovec *iovec)
 	return -EPERM;
 }
 
+static inline int sps_get_iovecs(struct sps_pipe *h, struct sps_iovec *iovec,
+				 u32 max, u32 *num)
+{
+	return -EPERM;
+}
+
 static inline int sps_flow_on(struct sps_pipe *h)
 {
 	return -EPERM;
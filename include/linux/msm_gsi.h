@@ -178,6 +178,10 @@ enum gsi_evt_ring_elem_size {
  *                   event ring. if false, the event ring can be shared among
  *                   multiple GSI channels but in that case no polling
  *                   (GSI_CHAN_MODE_POLL) is supported on any of those channels
+ * @adaptive_mod:    if true, GSI raises int_modc above the configured value
+ *                   while the measured event rate is high and decays it back
+ *                   as the rate drops. int_modt bounds the added latency, so
+ *                   both int_modt and int_modc must be non-zero
  * @err_cb:          error notification callback
  * @user_data:       cookie used for error notifications
  * @evchid_valid:    is evchid valid?
@@ -198,6 +202,7 @@ struct gsi_evt_ring_props {
 	uint64_t msi_addr;
 	uint64_t rp_update_addr;
 	bool exclusive;
+	bool adaptive_mod;
 	void (*err_cb)(struct gsi_evt_err_notify *notify);
 	void *user_data;
 	bool evchid_valid;
@@ -1021,6 +1026,30 @@ int gsi_set_channel_cfg(unsigned long chan_hdl, struct gsi_chan_props *props,
 int gsi_poll_channel(unsigned long chan_hdl,
 		struct gsi_chan_xfer_notify *notify);
 
+/**
+ * gsi_poll_n_channel - Peripheral should call this function to query for
+ * a batch of completed transfer descriptors.
+ *
+ * @chan_hdl:      Client handle previously obtained from
+ *                 gsi_alloc_channel
+ * @notify:        Array of at least expected_num entries, filled with the
+ *                 completed transfers if any
+ * @expected_num:  Budget: maximum number of completions to return
+ * @actual_num:    Number of completions returned
+ *
+ * The event ring doorbell is rung once per call rather than once per
+ * completion. Meant to be used in GSI_CHAN_MODE_POLL, where IEOB is masked
+ * for the channel's event ring: the client switches to poll mode from its
+ * xfer_cb, polls until fewer than expected_num completions are returned and
+ * then moves back to GSI_CHAN_MODE_CALLBACK.
+ *
+ * @Return gsi_status (GSI_STATUS_POLL_EMPTY is returned if no transfers
+ * completed)
+ */
+int gsi_poll_n_channel(unsigned long chan_hdl,
+		struct gsi_chan_xfer_notify *notify,
+		int expected_num, int *actual_num);
+
 /**
  * gsi_config_channel_mode - Peripheral should call this function
  * to configure the channel mode.
@@ -1044,6 +1073,11 @@ int gsi_config_channel_mode(unsigned long chan_hdl, enum gsi_chan_mode mode);
  * @ring_db:   If true, tell HW about these queued xfers
  *             If false, do not notify HW at this time
  *
+ * All num_xfers TREs are written before the single doorbell write. A
+ * netdev client can pass ring_db = !skb->xmit_more and call
+ * gsi_start_xfer() when it stops batching; GSI rings the doorbell anyway
+ * once a quarter of the ring is waiting.
+ *
  * @Return gsi_status
  */
 int gsi_queue_xfer(unsigned long chan_hdl, uint16_t num_xfers,
@@ -1263,6 +1297,13 @@ static inline int gsi_poll_channel(unsigned long chan_hdl,
 	return -GSI_STATUS_UNSUPPORTED_OP;
 }
 
+static inline int gsi_poll_n_channel(unsigned long chan_hdl,
+		struct gsi_chan_xfer_notify *notify,
+		int expected_num, int *actual_num)
+{
+	return -GSI_STATUS_UNSUPPORTED_OP;
+}
+
 static inline int gsi_config_channel_mode(unsigned long chan_hdl,
 		enum gsi_chan_mode mode)
 {
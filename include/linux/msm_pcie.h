@@ -157,6 +157,21 @@ int msm_pcie_shadow_control(struct pci_dev *dev, bool enable);
 int msm_pcie_debug_info(struct pci_dev *dev, u32 option, u32 base,
 			u32 offset, u32 mask, u32 value);
 
+/**
+ * msm_pcie_l1ss_hint - report link traffic to the adaptive L1ss control.
+ * @dev:	pci device structure
+ * @busy_ms:	time for which L1ss should stay disabled, starting now.
+ *		0 only counts as traffic for the current sampling period.
+ *
+ * This function lets PCIe endpoint device drivers announce a burst of
+ * traffic so that the link leaves L1ss before the burst starts instead of
+ * paying the L1.2 exit latency on its first transfers. It can be called
+ * from atomic context.
+ *
+ * Return: 0 on success, negative value on error
+ */
+int msm_pcie_l1ss_hint(struct pci_dev *dev, u32 busy_ms);
+
 #else /* !CONFIG_PCI_MSM */
 static inline int msm_pcie_pm_control(enum msm_pcie_pm_opt pm_opt, u32 busnr,
 			void *user, void *data, u32 options)
@@ -194,6 +209,11 @@ static inline int msm_pcie_debug_info(struct pci_dev *dev, u32 option, u32 base,
 {
 	return -ENODEV;
 }
+
+static inline int msm_pcie_l1ss_hint(struct pci_dev *dev, u32 busy_ms)
+{
+	return -ENODEV;
+}
 #endif /* CONFIG_PCI_MSM */
 
 #endif /* __MSM_PCIE_H */
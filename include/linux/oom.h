@@ -101,4 +101,14 @@ extern int sysctl_reap_mem_on_sigkill;
 
 /* calls for LMK reaper */
 extern void add_to_oom_reaper(struct task_struct *p);
+
+#ifdef CONFIG_ANDROID_LMK_ADJ_INDEX
+extern void lowmem_adj_index_add(struct task_struct *p);
+extern void lowmem_adj_index_unhash(struct task_struct *p);
+extern void lowmem_adj_index_update(struct task_struct *p);
+#else
+static inline void lowmem_adj_index_add(struct task_struct *p) { }
+static inline void lowmem_adj_index_unhash(struct task_struct *p) { }
+static inline void lowmem_adj_index_update(struct task_struct *p) { }
+#endif
 #endif /* _INCLUDE_LINUX_OOM_H */
@@ -37,6 +37,9 @@ struct arm_pmu_platdata {
  */
 #define ARMPMU_MAX_HWEVENTS		32
 
+/* hw_perf_event::flags: the counter may be read directly from EL0 */
+#define ARMPMU_EVT_EL0_READ		(1 << 0)
+
 #define HW_OP_UNSUPPORTED		0xFFFF
 #define C(_x)				PERF_COUNT_HW_CACHE_##_x
 #define CACHE_OP_UNSUPPORTED		0xFFFF
@@ -86,6 +86,15 @@ extern void proc_register_uid(kuid_t uid);
 static inline void proc_register_uid(kuid_t uid) {}
 #endif
 
+struct mm_struct;
+
+#ifdef CONFIG_PROC_PAGE_MONITOR
+extern int sysctl_smaps_rollup_cache_ms;
+extern void proc_smaps_rollup_cache_free(struct mm_struct *mm);
+#else
+static inline void proc_smaps_rollup_cache_free(struct mm_struct *mm) {}
+#endif
+
 struct net;
 
 static inline struct proc_dir_entry *proc_net_mkdir(
@@ -17,10 +17,14 @@
 #include <linux/clk.h>
 #include <linux/dma-direction.h>
 #include <linux/io.h>
+#include <linux/ktime.h>
 #include <linux/list.h>
 #include <linux/msm-bus.h>
 #include <linux/msm-bus-board.h>
 
+struct msm_gpi_tre;
+struct seq_file;
+
 /* Transfer mode supported by GENI Serial Engines */
 enum se_xfer_mode {
 	INVALID,
@@ -29,6 +33,11 @@ enum se_xfer_mode {
 	SE_DMA,
 };
 
+#define SE_XFER_MODES	(SE_DMA + 1)
+
+/* Queue depth from which transfers are chained through GSI by default */
+#define GENI_SE_GSI_MIN_QUEUE	2
+
 /* Protocols supported by GENI Serial Engines */
 enum se_protocol_types {
 	NONE,
@@ -38,6 +47,42 @@ enum se_protocol_types {
 	I3C
 };
 
+/**
+ * struct se_geni_xfer_stats - Transfer mode accounting of a Serial Engine
+ * @xfers:		Number of transfers done in each mode.
+ * @bytes:		Number of bytes moved in each mode.
+ * @lat_ns:		Sum of the transfer latencies in each mode.
+ * @max_lat_ns:		Worst transfer latency seen in each mode.
+ * @switches:		Number of times the SE changed its transfer mode.
+ */
+struct se_geni_xfer_stats {
+	u64 xfers[SE_XFER_MODES];
+	u64 bytes[SE_XFER_MODES];
+	u64 lat_ns[SE_XFER_MODES];
+	u64 max_lat_ns[SE_XFER_MODES];
+	u64 switches;
+};
+
+/**
+ * struct se_geni_xfer_policy - Transfer mode policy of a Serial Engine
+ * @cur_mode:		Transfer mode the SE is currently configured in.
+ * @fifo_bytes:		Largest transfer that is done in FIFO mode.
+ * @gsi_queue:		Queue depth from which transfers go through GSI,
+			0 if the protocol driver has no GSI channels.
+ * @fifo_disabled:	FIFO interface is disabled, only GSI can be used.
+ * @stats:		Mode usage and latency of the transfers done.
+ *
+ * The protocol drivers serialize the transfers of an SE, which also
+ * serializes the updates of this structure.
+ */
+struct se_geni_xfer_policy {
+	int cur_mode;
+	unsigned int fifo_bytes;
+	unsigned int gsi_queue;
+	bool fifo_disabled;
+	struct se_geni_xfer_stats stats;
+};
+
 /**
  * struct geni_se_rsc - GENI Serial Engine Resource
  * @ctrl_dev		Pointer to controller device.
@@ -59,6 +104,7 @@ enum se_protocol_types {
  * @geni_pinctrl:	Handle to the pinctrl configuration.
  * @geni_gpio_active:	Handle to the default/active pinctrl state.
  * @geni_gpi_sleep:	Handle to the sleep pinctrl state.
+ * @xfer:		Transfer mode policy and statistics.
  */
 struct se_geni_rsc {
 	struct device *ctrl_dev;
@@ -78,6 +124,7 @@ struct se_geni_rsc {
 	struct pinctrl_state *geni_gpio_active;
 	struct pinctrl_state *geni_gpio_sleep;
 	int	clk_freq_out;
+	struct se_geni_xfer_policy xfer;
 };
 
 #define PINCTRL_DEFAULT	"default"
@@ -457,6 +504,70 @@ int geni_se_init(void __iomem *base, unsigned int rx_wm, unsigned int rx_rfr);
  */
 int geni_se_select_mode(void __iomem *base, int mode);
 
+/**
+ * geni_se_xfer_policy_init() - Initialize the transfer mode policy of an SE
+ * @rsc:	Resource of the serial engine.
+ * @base:	Base address of the serial engine's register block.
+ * @cur_mode:	Transfer mode the SE has been configured in.
+ * @gsi:	Whether the protocol driver can submit transfers through GSI.
+ */
+void geni_se_xfer_policy_init(struct se_geni_rsc *rsc, void __iomem *base,
+			      int cur_mode, bool gsi);
+
+/**
+ * geni_se_xfer_mode_pick() - Pick the transfer mode for a transfer
+ * @rsc:	Resource of the serial engine.
+ * @len:	Length of the transfer in bytes.
+ * @queued:	Number of transfers queued behind and including this one.
+ *
+ * Return:	Transfer mode to be used for the transfer.
+ */
+int geni_se_xfer_mode_pick(struct se_geni_rsc *rsc, size_t len,
+			   unsigned int queued);
+
+/**
+ * geni_se_xfer_mode_set() - Switch the SE to a transfer mode if needed
+ * @rsc:	Resource of the serial engine.
+ * @base:	Base address of the serial engine's register block.
+ * @mode:	Transfer mode to be selected.
+ *
+ * Return:	0 on success, standard Linux error codes on failure.
+ */
+int geni_se_xfer_mode_set(struct se_geni_rsc *rsc, void __iomem *base,
+			  int mode);
+
+/**
+ * geni_se_xfer_done() - Account a completed transfer
+ * @rsc:	Resource of the serial engine.
+ * @mode:	Transfer mode the transfer was done in.
+ * @len:	Length of the transfer in bytes.
+ * @start:	Time at which the transfer was started.
+ */
+void geni_se_xfer_done(struct se_geni_rsc *rsc, int mode, size_t len,
+		       ktime_t start);
+
+/**
+ * geni_se_xfer_stats_show() - Print the transfer statistics of an SE
+ * @s:		Sequence file to print the statistics into.
+ * @rsc:	Resource of the serial engine.
+ */
+void geni_se_xfer_stats_show(struct seq_file *s, struct se_geni_rsc *rsc);
+
+/**
+ * geni_se_gsi_chain_tres() - Fill the DMA TREs of a chain of transfers
+ * @tre:	Array of at least @n TREs to be filled.
+ * @iova:	DMA addresses of the transfer buffers.
+ * @len:	Lengths of the transfer buffers.
+ * @n:		Number of transfers.
+ *
+ * The TREs are chained and only the last one raises an interrupt, so the
+ * whole chain can be submitted as a single descriptor.
+ *
+ * Return:	Number of TREs filled, standard Linux error codes on failure.
+ */
+int geni_se_gsi_chain_tres(struct msm_gpi_tre *tre, const dma_addr_t *iova,
+			   const u32 *len, int n);
+
 /**
  * geni_setup_m_cmd() - Setup the primary sequencer
  * @base:	Base address of the serial engine's register block.
@@ -839,6 +950,39 @@ static inline int geni_se_select_mode(void __iomem *base, int mode)
 	return -ENXIO;
 }
 
+static inline void geni_se_xfer_policy_init(struct se_geni_rsc *rsc,
+				void __iomem *base, int cur_mode, bool gsi)
+{
+}
+
+static inline int geni_se_xfer_mode_pick(struct se_geni_rsc *rsc,
+					 size_t len, unsigned int queued)
+{
+	return FIFO_MODE;
+}
+
+static inline int geni_se_xfer_mode_set(struct se_geni_rsc *rsc,
+					void __iomem *base, int mode)
+{
+	return -ENXIO;
+}
+
+static inline void geni_se_xfer_done(struct se_geni_rsc *rsc, int mode,
+				     size_t len, ktime_t start)
+{
+}
+
+static inline void geni_se_xfer_stats_show(struct seq_file *s,
+					   struct se_geni_rsc *rsc)
+{
+}
+
+static inline int geni_se_gsi_chain_tres(struct msm_gpi_tre *tre,
+		const dma_addr_t *iova, const u32 *len, int n)
+{
+	return -ENXIO;
+}
+
 static inline void geni_setup_m_cmd(void __iomem *base, u32 cmd,
 								u32 params)
 {
@@ -43,6 +43,7 @@ struct sched_param {
 #include <linux/seccomp.h>
 #include <linux/rcupdate.h>
 #include <linux/rculist.h>
+#include <linux/list_nulls.h>
 #include <linux/rtmutex.h>
 
 #include <linux/time.h>
@@ -935,6 +936,8 @@ static inline int signal_group_exit(const struct signal_struct *sig)
 /*
  * Some day this will be a full-fledged user tracking system..
  */
+struct uid_sys_stats_user;
+
 struct user_struct {
 	atomic_t __count;	/* reference count */
 	atomic_t processes;	/* How many processes does this user have? */
@@ -969,6 +972,9 @@ struct user_struct {
 #if defined(CONFIG_PERF_EVENTS) || defined(CONFIG_BPF_SYSCALL)
 	atomic_long_t locked_vm;
 #endif
+#ifdef CONFIG_UID_SYS_STATS
+	struct uid_sys_stats_user *sys_stats;	/* per-uid I/O counters */
+#endif
 };
 
 extern int uids_sysfs_init(void);
@@ -1766,6 +1772,10 @@ struct task_struct {
 #endif
 
 	struct list_head tasks;
+#ifdef CONFIG_ANDROID_LMK_ADJ_INDEX
+	/* process entry in the lowmemorykiller oom_score_adj index */
+	struct hlist_nulls_node lmk_adj_node;
+#endif
 #ifdef CONFIG_SMP
 	struct plist_node pushable_tasks;
 	struct rb_node pushable_dl_tasks;
@@ -3866,15 +3876,44 @@ extern struct task_group root_task_group;
 extern int task_can_switch_user(struct user_struct *up,
 					struct task_struct *tsk);
 
+/* I/O charged to the uid of the current task, see uid_sys_stats */
+enum uid_io_item {
+	UID_IO_RCHAR,
+	UID_IO_WCHAR,
+	UID_IO_READ_BYTES,
+	UID_IO_WRITE_BYTES,
+	UID_IO_CANCELLED_WRITE_BYTES,
+	UID_IO_FSYNC,
+	UID_IO_ITEMS,
+};
+
+#ifdef CONFIG_UID_SYS_STATS
+extern void uid_sys_stats_account_io(enum uid_io_item item, u64 amt);
+extern void uid_sys_stats_user_init(struct user_struct *up);
+extern void uid_sys_stats_user_release(struct user_struct *up);
+#else
+static inline void uid_sys_stats_account_io(enum uid_io_item item, u64 amt)
+{
+}
+static inline void uid_sys_stats_user_init(struct user_struct *up)
+{
+}
+static inline void uid_sys_stats_user_release(struct user_struct *up)
+{
+}
+#endif
+
 #ifdef CONFIG_TASK_XACCT
 static inline void add_rchar(struct task_struct *tsk, ssize_t amt)
 {
 	tsk->ioac.rchar += amt;
+	uid_sys_stats_account_io(UID_IO_RCHAR, amt);
 }
 
 static inline void add_wchar(struct task_struct *tsk, ssize_t amt)
 {
 	tsk->ioac.wchar += amt;
+	uid_sys_stats_account_io(UID_IO_WCHAR, amt);
 }
 
 static inline void inc_syscr(struct task_struct *tsk)
@@ -3890,6 +3929,7 @@ static inline void inc_syscw(struct task_struct *tsk)
 static inline void inc_syscfs(struct task_struct *tsk)
 {
 	tsk->ioac.syscfs++;
+	uid_sys_stats_account_io(UID_IO_FSYNC, 1);
 }
 #else
 static inline void add_rchar(struct task_struct *tsk, ssize_t amt)
@@ -47,6 +47,7 @@ struct sync_file {
 };
 
 #define POLL_ENABLED 0
+#define POLL_WOKEN 1
 
 struct sync_file *sync_file_create(struct fence *fence);
 struct fence *sync_file_get_fence(int fd);
@@ -10,6 +10,7 @@
 static inline void task_io_account_read(size_t bytes)
 {
 	current->ioac.read_bytes += bytes;
+	uid_sys_stats_account_io(UID_IO_READ_BYTES, bytes);
 }
 
 /*
@@ -24,6 +25,7 @@ static inline unsigned long task_io_get_inblock(const struct task_struct *p)
 static inline void task_io_account_write(size_t bytes)
 {
 	current->ioac.write_bytes += bytes;
+	uid_sys_stats_account_io(UID_IO_WRITE_BYTES, bytes);
 }
 
 /*
@@ -38,6 +40,7 @@ static inline unsigned long task_io_get_oublock(const struct task_struct *p)
 static inline void task_io_account_cancelled_write(size_t bytes)
 {
 	current->ioac.cancelled_write_bytes += bytes;
+	uid_sys_stats_account_io(UID_IO_CANCELLED_WRITE_BYTES, bytes);
 }
 
 static inline void task_io_accounting_init(struct task_io_accounting *ioac)
@@ -210,6 +210,39 @@ void *trace_event_buffer_reserve(struct trace_event_buffer *fbuffer,
 void trace_event_buffer_commit(struct trace_event_buffer *fbuffer,
 			       unsigned long len);
 
+#ifdef CONFIG_CORESIGHT_OST
+DECLARE_STATIC_KEY_FALSE(trace_stm_bypass_key);
+
+/*
+ * With the ring buffer bypass enabled, enabled events are built in a
+ * per-cpu scratch area and written straight to the STM stimulus ports
+ * instead of being recorded in the ring buffer.
+ */
+#define trace_event_stm_bypass()	\
+	static_branch_unlikely(&trace_stm_bypass_key)
+
+void *trace_event_stm_reserve(struct trace_event_buffer *fbuffer,
+			      struct trace_event_file *trace_file,
+			      unsigned long len);
+void trace_event_stm_commit(struct trace_event_buffer *fbuffer,
+			    unsigned long len);
+#else
+#define trace_event_stm_bypass()	false
+
+static inline void *
+trace_event_stm_reserve(struct trace_event_buffer *fbuffer,
+			struct trace_event_file *trace_file,
+			unsigned long len)
+{
+	return NULL;
+}
+
+static inline void trace_event_stm_commit(struct trace_event_buffer *fbuffer,
+					  unsigned long len)
+{
+}
+#endif
+
 enum {
 	TRACE_EVENT_FL_FILTERED_BIT,
 	TRACE_EVENT_FL_CAP_ANY_BIT,
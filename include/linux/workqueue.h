@@ -131,6 +131,7 @@ struct workqueue_attrs {
 	int			nice;		/* nice level */
 	cpumask_var_t		cpumask;	/* allowed CPUs */
 	bool			no_numa;	/* disable NUMA affinity */
+	bool			prefer_awake;	/* wake workers on busy CPUs */
 };
 
 static inline struct delayed_work *to_delayed_work(struct work_struct *work)
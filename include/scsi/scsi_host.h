@@ -319,6 +319,17 @@ struct scsi_host_template {
 	 */
 	enum blk_eh_timer_return (*eh_timed_out)(struct scsi_cmnd *);
 
+	/*
+	 * This is an optional routine that is called from the completion
+	 * softirq before the mid layer disposes of the command, e.g. to
+	 * account for the time the command waited for the softirq once
+	 * the LLD called scsi_done(). The request tag is still owned by
+	 * the command at this point.
+	 *
+	 * Status: OPTIONAL
+	 */
+	void (*softirq_done)(struct scsi_cmnd *);
+
 	/* This is an optional routine that allows transport to initiate
 	 * LLD adapter or firmware reset using sysfs attribute.
 	 *
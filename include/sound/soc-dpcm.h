@@ -65,6 +65,23 @@ enum snd_soc_dpcm_trigger {
 	SND_SOC_DPCM_TRIGGER_BESPOKE,
 };
 
+/*
+ * FE operations whose duration, BEs included, is tracked for debugfs.
+ */
+enum snd_soc_dpcm_op {
+	SND_SOC_DPCM_OP_HW_PARAMS	= 0,
+	SND_SOC_DPCM_OP_PREPARE,
+	SND_SOC_DPCM_OP_TRIGGER,
+	SND_SOC_DPCM_OP_NUM,
+};
+
+struct snd_soc_dpcm_op_time {
+	u64 last_ns;
+	u64 max_ns;
+	u64 total_ns;
+	unsigned long count;
+};
+
 /*
  * Dynamic PCM link
  * This links together a FE and BE DAI at runtime and stores the link
@@ -99,6 +116,7 @@ struct snd_soc_dpcm_runtime {
 
 	int users;
 	struct snd_pcm_runtime *runtime;
+	/* FE: params from userspace; BE: params last applied by hw_params() */
 	struct snd_pcm_hw_params hw_params;
 
 	/* state and update */
@@ -106,6 +124,10 @@ struct snd_soc_dpcm_runtime {
 	enum snd_soc_dpcm_state state;
 
 	int trigger_pending; /* trigger cmd + 1 if pending, 0 if not */
+
+	/* FE operation timing and BE hw_params() skipped as unchanged */
+	struct snd_soc_dpcm_op_time op_time[SND_SOC_DPCM_OP_NUM];
+	unsigned long be_hw_params_cached;
 };
 
 /* can this BE stop and free */
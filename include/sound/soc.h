@@ -1273,6 +1273,7 @@ struct snd_soc_pcm_runtime {
 #ifdef CONFIG_DEBUG_FS
 	struct dentry *debugfs_dpcm_root;
 	struct dentry *debugfs_dpcm_state;
+	struct dentry *debugfs_dpcm_timing;
 #endif
 
 	unsigned int num; /* 0-based and monotonic increasing */
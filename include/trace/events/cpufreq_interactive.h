@@ -142,6 +142,27 @@ TRACE_EVENT(cpufreq_interactive_cpuload,
 		      __entry->prev, __entry->predicted)
 );
 
+TRACE_EVENT(cpufreq_interactive_util,
+	    TP_PROTO(unsigned long cpu_id, unsigned int util,
+		     unsigned int load, unsigned int timer_load),
+	    TP_ARGS(cpu_id, util, load, timer_load),
+	    TP_STRUCT__entry(
+		__field(unsigned long, cpu_id)
+		__field(unsigned int, util)
+		__field(unsigned int, load)
+		__field(unsigned int, timer_load)
+	    ),
+	    TP_fast_assign(
+		__entry->cpu_id = cpu_id;
+		__entry->util = util;
+		__entry->load = load;
+		__entry->timer_load = timer_load;
+	    ),
+	    TP_printk("cpu=%lu util=%u load=%u timer_load=%u",
+		      __entry->cpu_id, __entry->util, __entry->load,
+		      __entry->timer_load)
+);
+
 #endif /* _TRACE_CPUFREQ_INTERACTIVE_H */
 
 /* This part must be outside protection */
@@ -0,0 +1,62 @@
+/* Copyright (c) 2021, The Linux Foundation. All rights reserved.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 and
+ * only version 2 as published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ */
+#undef TRACE_SYSTEM
+#define TRACE_SYSTEM fastrpc
+
+#if !defined(_TRACE_FASTRPC_H) || defined(TRACE_HEADER_MULTI_READ)
+#define _TRACE_FASTRPC_H
+#include <linux/types.h>
+#include <linux/tracepoint.h>
+
+TRACE_EVENT(fastrpc_invoke_latency,
+
+	TP_PROTO(int tgid, uint32_t handle, uint32_t method, int err,
+		uint64_t getargs, uint64_t invargs, uint64_t send,
+		uint64_t remote, uint64_t putargs),
+
+	TP_ARGS(tgid, handle, method, err, getargs, invargs, send, remote,
+		putargs),
+
+	TP_STRUCT__entry(
+		__field(int, tgid)
+		__field(uint32_t, handle)
+		__field(uint32_t, method)
+		__field(int, err)
+		__field(uint64_t, getargs)
+		__field(uint64_t, invargs)
+		__field(uint64_t, send)
+		__field(uint64_t, remote)
+		__field(uint64_t, putargs)
+	),
+
+	TP_fast_assign(
+		__entry->tgid = tgid;
+		__entry->handle = handle;
+		__entry->method = method;
+		__entry->err = err;
+		__entry->getargs = getargs;
+		__entry->invargs = invargs;
+		__entry->send = send;
+		__entry->remote = remote;
+		__entry->putargs = putargs;
+	),
+
+	TP_printk("tgid=%d handle=0x%x method=%u err=%d getargs=%llu invargs=%llu send=%llu remote=%llu putargs=%llu",
+		__entry->tgid, __entry->handle, __entry->method, __entry->err,
+		__entry->getargs, __entry->invargs, __entry->send,
+		__entry->remote, __entry->putargs)
+);
+
+#endif
+
+#include <trace/define_trace.h>
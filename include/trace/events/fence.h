@@ -122,6 +122,34 @@ DEFINE_EVENT(fence, fence_wait_end,
 	TP_ARGS(fence)
 );
 
+TRACE_EVENT(fence_woken,
+
+	/* latency_ns: time from the fence signaling to its waiter running */
+	TP_PROTO(struct fence *fence, s64 latency_ns),
+
+	TP_ARGS(fence, latency_ns),
+
+	TP_STRUCT__entry(
+		__string(driver, fence->ops->get_driver_name(fence))
+		__string(timeline, fence->ops->get_timeline_name(fence))
+		__field(unsigned int, context)
+		__field(unsigned int, seqno)
+		__field(s64, latency_ns)
+	),
+
+	TP_fast_assign(
+		__assign_str(driver, fence->ops->get_driver_name(fence))
+		__assign_str(timeline, fence->ops->get_timeline_name(fence))
+		__entry->context = fence->context;
+		__entry->seqno = fence->seqno;
+		__entry->latency_ns = latency_ns;
+	),
+
+	TP_printk("driver=%s timeline=%s context=%u seqno=%u latency=%lld ns",
+		  __get_str(driver), __get_str(timeline), __entry->context,
+		  __entry->seqno, __entry->latency_ns)
+);
+
 #endif /*  _TRACE_FENCE_H */
 
 /* This part must be outside protection */
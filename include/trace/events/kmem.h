@@ -955,6 +955,117 @@ DEFINE_EVENT(iommu_sec_ptbl_map_range, iommu_sec_ptbl_map_range_end,
 
 	TP_ARGS(sec_id, num, va, pa, len)
 	);
+DECLARE_EVENT_CLASS(ion_system_heap_allocate,
+
+	TP_PROTO(const char *heap_name,
+		unsigned long len,
+		unsigned long flags,
+		int ret),
+
+	TP_ARGS(heap_name, len, flags, ret),
+
+	TP_STRUCT__entry(
+		__field(const char *, heap_name)
+		__field(unsigned long, len)
+		__field(unsigned long, flags)
+		__field(int, ret)
+		),
+
+	TP_fast_assign(
+		__entry->heap_name = heap_name;
+		__entry->len = len;
+		__entry->flags = flags;
+		__entry->ret = ret;
+		),
+
+	TP_printk("heap_name=%s len=%lx flags=%lx ret=%d",
+		__entry->heap_name,
+		__entry->len,
+		__entry->flags,
+		__entry->ret)
+	);
+
+DEFINE_EVENT(ion_system_heap_allocate, ion_system_heap_allocate_start,
+	TP_PROTO(const char *heap_name,
+		unsigned long len,
+		unsigned long flags,
+		int ret),
+
+	TP_ARGS(heap_name, len, flags, ret)
+	);
+
+DEFINE_EVENT(ion_system_heap_allocate, ion_system_heap_allocate_end,
+	TP_PROTO(const char *heap_name,
+		unsigned long len,
+		unsigned long flags,
+		int ret),
+
+	TP_ARGS(heap_name, len, flags, ret)
+	);
+
+DECLARE_EVENT_CLASS(ion_page_pool_alloc,
+
+	TP_PROTO(unsigned int order,
+		int vmid,
+		bool cached),
+
+	TP_ARGS(order, vmid, cached),
+
+	TP_STRUCT__entry(
+		__field(unsigned int, order)
+		__field(int, vmid)
+		__field(bool, cached)
+		),
+
+	TP_fast_assign(
+		__entry->order = order;
+		__entry->vmid = vmid;
+		__entry->cached = cached;
+		),
+
+	TP_printk("order=%u vmid=%d cached=%d",
+		__entry->order,
+		__entry->vmid,
+		__entry->cached)
+	);
+
+DEFINE_EVENT(ion_page_pool_alloc, ion_page_pool_hit,
+	TP_PROTO(unsigned int order,
+		int vmid,
+		bool cached),
+
+	TP_ARGS(order, vmid, cached)
+	);
+
+DEFINE_EVENT(ion_page_pool_alloc, ion_page_pool_miss,
+	TP_PROTO(unsigned int order,
+		int vmid,
+		bool cached),
+
+	TP_ARGS(order, vmid, cached)
+	);
+
+TRACE_EVENT(ion_secure_pool_split,
+
+	TP_PROTO(int vmid,
+		unsigned int order),
+
+	TP_ARGS(vmid, order),
+
+	TP_STRUCT__entry(
+		__field(int, vmid)
+		__field(unsigned int, order)
+		),
+
+	TP_fast_assign(
+		__entry->vmid = vmid;
+		__entry->order = order;
+		),
+
+	TP_printk("vmid=%d order=%u",
+		__entry->vmid,
+		__entry->order)
+	);
 #endif /* _TRACE_KMEM_H */
 
 /* This part must be outside protection */
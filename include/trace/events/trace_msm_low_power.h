@@ -222,6 +222,36 @@ TRACE_EVENT(cluster_pred_select,
 		__entry->latency, __entry->pred, __entry->pred_us)
 );
 
+TRACE_EVENT(cluster_energy_select,
+
+	TP_PROTO(const char *name, int index, u32 idle_us, u64 energy,
+				int energy_idx, int residency_idx),
+
+	TP_ARGS(name, index, idle_us, energy, energy_idx, residency_idx),
+
+	TP_STRUCT__entry(
+		__field(const char *, name)
+		__field(int, index)
+		__field(u32, idle_us)
+		__field(u64, energy)
+		__field(int, energy_idx)
+		__field(int, residency_idx)
+	),
+
+	TP_fast_assign(
+		__entry->name = name;
+		__entry->index = index;
+		__entry->idle_us = idle_us;
+		__entry->energy = energy;
+		__entry->energy_idx = energy_idx;
+		__entry->residency_idx = residency_idx;
+	),
+
+	TP_printk("name:%s idx:%d idle_us:%u energy:%llu energy_idx:%d residency_idx:%d",
+		__entry->name, __entry->index, __entry->idle_us,
+		__entry->energy, __entry->energy_idx, __entry->residency_idx)
+);
+
 TRACE_EVENT(cluster_pred_hist,
 
 	TP_PROTO(const char *name, int idx, u32 resi,
@@ -92,6 +92,40 @@ TRACE_EVENT(ufshcd_clk_scaling,
 		__entry->prev_state, __entry->curr_state)
 );
 
+TRACE_EVENT(ufshcd_clk_scaling_load,
+
+	TP_PROTO(const char *dev_name, const char *reason, u32 busy_pct,
+		u32 depth16, u32 kbps, u32 read_pct, u32 load),
+
+	TP_ARGS(dev_name, reason, busy_pct, depth16, kbps, read_pct, load),
+
+	TP_STRUCT__entry(
+		__string(dev_name, dev_name)
+		__string(reason, reason)
+		__field(u32, busy_pct)
+		__field(u32, depth16)
+		__field(u32, kbps)
+		__field(u32, read_pct)
+		__field(u32, load)
+	),
+
+	TP_fast_assign(
+		__assign_str(dev_name, dev_name);
+		__assign_str(reason, reason);
+		__entry->busy_pct = busy_pct;
+		__entry->depth16 = depth16;
+		__entry->kbps = kbps;
+		__entry->read_pct = read_pct;
+		__entry->load = load;
+	),
+
+	TP_printk("%s: busy %u%% depth %u.%02u %u KB/s read %u%% -> load %u%% (%s)",
+		__get_str(dev_name), __entry->busy_pct,
+		__entry->depth16 >> 4, (__entry->depth16 & 0xf) * 100 / 16,
+		__entry->kbps, __entry->read_pct, __entry->load,
+		__get_str(reason))
+);
+
 DECLARE_EVENT_CLASS(ufshcd_profiling_template,
 	TP_PROTO(const char *dev_name, const char *profile_info, s64 time_us,
 		 int err),
@@ -668,6 +668,7 @@ trace_event_raw_event_##call(void *__data, proto)			\
 	struct trace_event_data_offsets_##call __maybe_unused __data_offsets;\
 	struct trace_event_buffer fbuffer;				\
 	struct trace_event_raw_##call *entry;				\
+	bool __stm = false;						\
 	int __data_size;						\
 									\
 	if (trace_trigger_soft_disabled(trace_file))			\
@@ -675,7 +676,13 @@ trace_event_raw_event_##call(void *__data, proto)			\
 									\
 	__data_size = trace_event_get_offsets_##call(&__data_offsets, args); \
 									\
-	entry = trace_event_buffer_reserve(&fbuffer, trace_file,	\
+	if (trace_event_stm_bypass()) {					\
+		entry = trace_event_stm_reserve(&fbuffer, trace_file,	\
+				 sizeof(*entry) + __data_size);		\
+		__stm = entry != NULL;					\
+	}								\
+	if (!__stm)							\
+		entry = trace_event_buffer_reserve(&fbuffer, trace_file, \
 				 sizeof(*entry) + __data_size);		\
 									\
 	if (!entry)							\
@@ -685,8 +692,12 @@ trace_event_raw_event_##call(void *__data, proto)			\
 									\
 	{ assign; }							\
 									\
-	trace_event_buffer_commit(&fbuffer,				\
-				  sizeof(*entry) + __data_size);	\
+	if (__stm)							\
+		trace_event_stm_commit(&fbuffer,			\
+				       sizeof(*entry) + __data_size);	\
+	else								\
+		trace_event_buffer_commit(&fbuffer,			\
+					  sizeof(*entry) + __data_size); \
 }
 /*
  * The ftrace_test_probe is compiled out, it is only here as a build time check
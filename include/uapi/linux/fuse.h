@@ -269,6 +269,7 @@ struct fuse_file_lock {
 #define FUSE_HANDLE_KILLPRIV	(1 << 19)
 #define FUSE_POSIX_ACL		(1 << 20)
 #define FUSE_PASSTHROUGH	(1 << 21)
+#define FUSE_PASSTHROUGH_READDIR	(1 << 22)
 
 /**
  * CUSE INIT request/reply flags
@@ -778,6 +779,7 @@ struct fuse_notify_retrieve_in {
 
 /* Device ioctls: */
 #define FUSE_DEV_IOC_CLONE	_IOR(229, 0, uint32_t)
+#define FUSE_DEV_IOC_BIND_QUEUE	_IOW(229, 1, uint32_t)
 
 struct fuse_lseek_in {
 	uint64_t	fh;
@@ -167,6 +167,7 @@ struct tcp_bbr_info {
 	__u32	bbr_min_rtt;		/* min-filtered RTT in uSec */
 	__u32	bbr_pacing_gain;	/* pacing gain shifted left 8 bits */
 	__u32	bbr_cwnd_gain;		/* cwnd gain shifted left 8 bits */
+	__u32	bbr_extra_acked;	/* ACK aggregation cwnd allowance, pkts */
 };
 
 union tcp_cc_info {
@@ -2484,4 +2484,67 @@ enum odu_bridge_mode {
 				ODU_BRIDGE_IOCTL_SET_LLV6_ADDR, \
 				struct in6_addr *)
 
+/*
+ * H/W stats sampling ring, mapped read-only by userspace.
+ *
+ * The kernel is the only writer. A sample is complete when its seq equals
+ * the sequence number it was read at, both before and after copying it;
+ * sample n lives in slot n % nr_slots and head is the next seq to write.
+ */
+#define IPA_HW_STATS_RING_VERSION 1
+#define IPA_HW_STATS_RING_PIPES 32
+
+/**
+ * struct ipa_hw_stats_ring_pipe - per pipe deltas over one period
+ * @ipv4_bytes: quota IPv4 bytes
+ * @ipv6_bytes: quota IPv6 bytes
+ * @ipv4_pkts: quota IPv4 packets
+ * @ipv6_pkts: quota IPv6 packets
+ * @drop_pkts: dropped packets
+ * @drop_bytes: dropped bytes
+ */
+struct ipa_hw_stats_ring_pipe {
+	__u64 ipv4_bytes;
+	__u64 ipv6_bytes;
+	__u32 ipv4_pkts;
+	__u32 ipv6_pkts;
+	__u32 drop_pkts;
+	__u32 drop_bytes;
+};
+
+/**
+ * struct ipa_hw_stats_ring_sample - one sampling period
+ * @seq: sequence number of the sample
+ * @timestamp_ns: CLOCK_MONOTONIC time the sample was taken
+ * @period_ns: time covered by the deltas
+ * @pipe_mask: pipes the deltas are valid for
+ * @pipe: deltas, indexed by pipe
+ */
+struct ipa_hw_stats_ring_sample {
+	__u64 seq;
+	__u64 timestamp_ns;
+	__u64 period_ns;
+	__u32 pipe_mask;
+	__u32 reserved;
+	struct ipa_hw_stats_ring_pipe pipe[IPA_HW_STATS_RING_PIPES];
+};
+
+/**
+ * struct ipa_hw_stats_ring_hdr - start of the mapping
+ * @version: IPA_HW_STATS_RING_VERSION
+ * @nr_slots: number of samples in the ring
+ * @slot_size: size of a sample
+ * @data_offset: offset of the first sample from the start of the mapping
+ * @head: seq of the next sample to be written
+ * @idle_periods: periods without traffic, for which no sample is written
+ */
+struct ipa_hw_stats_ring_hdr {
+	__u32 version;
+	__u32 nr_slots;
+	__u32 slot_size;
+	__u32 data_offset;
+	__u64 head;
+	__u64 idle_periods;
+};
+
 #endif /* _UAPI_MSM_IPA_H_ */
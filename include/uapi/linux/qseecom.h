@@ -67,6 +67,27 @@ struct qseecom_send_modfd_cmd_req {
 	struct qseecom_ion_fd_info ifd_data[MAX_ION_FD];
 };
 
+/* The trusted app only reads the buffer, skip invalidating it after a send */
+#define QSEECOM_MODFD_BUF_TA_READ_ONLY		(1 << 0)
+/* The trusted app only writes the buffer, skip cleaning it before a send */
+#define QSEECOM_MODFD_BUF_TA_WRITE_ONLY		(1 << 1)
+
+/*
+ * struct qseecom_modfd_buf_req - for (de)register modfd buffer ioctl request
+ * @fd - ion handle to memory allocated in user space
+ * @flags - QSEECOM_MODFD_BUF_* access hints
+ * @len - bytes of the buffer shared with the trusted app, 0 for all of it
+ *
+ * Modfd sends naming a registered buffer reuse its mapping and scatter
+ * gather list instead of importing the fd again, and only maintain the
+ * cache over @len bytes in the directions @flags allow.
+ */
+struct qseecom_modfd_buf_req {
+	int32_t fd; /* in */
+	uint32_t flags; /* in */
+	uint32_t len; /* in */
+};
+
 /*
  * struct qseecom_listener_send_resp_req - signal to continue the send_cmd req.
  * Used as a trigger from HLOS service to notify QSEECOM that it's done with its
@@ -392,4 +413,10 @@ struct file;
 #define QSEECOM_IOCTL_SET_ICE_INFO \
 	_IOWR(QSEECOM_IOC_MAGIC, 43, struct qseecom_ice_data_t)
 
+#define QSEECOM_IOCTL_REGISTER_MODFD_BUF_REQ \
+	_IOWR(QSEECOM_IOC_MAGIC, 44, struct qseecom_modfd_buf_req)
+
+#define QSEECOM_IOCTL_DEREGISTER_MODFD_BUF_REQ \
+	_IOWR(QSEECOM_IOC_MAGIC, 45, struct qseecom_modfd_buf_req)
+
 #endif /* _UAPI_QSEECOM_H_ */
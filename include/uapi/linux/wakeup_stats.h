@@ -0,0 +1,38 @@
+#ifndef _UAPI_LINUX_WAKEUP_STATS_H
+#define _UAPI_LINUX_WAKEUP_STATS_H
+
+#include <linux/types.h>
+
+/*
+ * Layout of the wakeup_sources_bin debugfs file: one struct
+ * wakeup_stats_header followed by one struct wakeup_stats_record per
+ * wakeup source, the last record being the one that accumulates the
+ * statistics of deleted sources. All times are in nanoseconds.
+ */
+
+#define WAKEUP_STATS_VERSION	1
+#define WAKEUP_STATS_NAME_LEN	64
+
+struct wakeup_stats_header {
+	__u32	version;
+	__u32	record_size;
+	__u32	wakeup_count;		/* registered wakeup events */
+	__u32	in_progress;		/* wakeup events being processed */
+};
+
+struct wakeup_stats_record {
+	char	name[WAKEUP_STATS_NAME_LEN];
+	__u64	active_count;
+	__u64	event_count;
+	__u64	wakeup_count;
+	__u64	expire_count;
+	__s64	active_time;
+	__s64	total_time;
+	__s64	max_time;
+	__s64	last_change;
+	__s64	prevent_suspend_time;
+	__u32	active;
+	__u32	reserved;
+};
+
+#endif /* _UAPI_LINUX_WAKEUP_STATS_H */
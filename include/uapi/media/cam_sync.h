@@ -64,6 +64,18 @@ struct cam_sync_signal {
 	uint32_t sync_state;
 };
 
+/**
+ * struct cam_sync_signal_multiple - Batch of sync objects to signal
+ * @signals:     Pointer to an array of struct cam_sync_signal
+ * @num_signals: Number of entries in the array
+ * @reserved:    Reserved
+ */
+struct cam_sync_signal_multiple {
+	__u64 signals;
+	__u32 num_signals;
+	__u32 reserved;
+};
+
 /**
  * struct cam_sync_merge - Merge information for sync objects
  *
@@ -130,5 +142,6 @@ struct cam_private_ioctl_arg {
 #define CAM_SYNC_REGISTER_PAYLOAD                4
 #define CAM_SYNC_DEREGISTER_PAYLOAD              5
 #define CAM_SYNC_WAIT                            6
+#define CAM_SYNC_SIGNAL_MULTIPLE                 7
 
 #endif /* __UAPI_CAM_SYNC_H__ */
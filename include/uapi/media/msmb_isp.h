@@ -30,14 +30,6 @@
 
 struct msm_vfe_cfg_cmd_list;
 
-struct isp_kstate {
-	uint32_t kernel_sofid;
-	uint32_t drop_reconfig;
-	uint32_t vfeid;
-	uint32_t dual_cam_drop_detected;
-	uint32_t dual_cam_drop;
-};
-
 enum ISP_START_PIXEL_PATTERN {
 	ISP_BAYER_RGRGRG,
 	ISP_BAYER_GRGRGR,
@@ -122,6 +114,24 @@ enum msm_isp_stats_type {
 	MSM_ISP_STATS_MAX    /* MAX */
 };
 
+/*
+ * Page shared with userspace through mmap() of the vfe subdev node.
+ *
+ * @stats_release: stats buffers userspace is done with, one word per
+ * stats type and one bit per buffer index below 32. Setting a bit with
+ * an atomic or hands a diverted buffer back, as VIDIOC_MSM_ISP_ENQUEUE_BUF
+ * with dirty_buf set would, without a syscall. The kernel collects the
+ * bits when it next programs a buffer for that stats type.
+ */
+struct isp_kstate {
+	uint32_t kernel_sofid;
+	uint32_t drop_reconfig;
+	uint32_t vfeid;
+	uint32_t dual_cam_drop_detected;
+	uint32_t dual_cam_drop;
+	uint32_t stats_release[MSM_ISP_STATS_MAX];
+};
+
 /*
  * @stats_type_mask: Stats type mask (enum msm_isp_stats_type).
  * @stream_src_mask: Stream src mask (enum msm_vfe_axi_stream_src)
@@ -83,6 +83,8 @@
 #include <linux/kaiser.h>
 #include <linux/cache.h>
 #include <linux/jump_label.h>
+#include <linux/debugfs.h>
+#include <linux/seq_file.h>
 
 #include <asm/io.h>
 #include <asm/bugs.h>
@@ -836,6 +838,97 @@ extern initcall_t __initcall6_start[];
 extern initcall_t __initcall7_start[];
 extern initcall_t __initcall_end[];
 
+extern initcall_t __initcall0a_start[], __initcall0a_end[];
+extern initcall_t __initcall1a_start[], __initcall1a_end[];
+extern initcall_t __initcall2a_start[], __initcall2a_end[];
+extern initcall_t __initcall3a_start[], __initcall3a_end[];
+extern initcall_t __initcall4a_start[], __initcall4a_end[];
+extern initcall_t __initcall5a_start[], __initcall5a_end[];
+extern initcall_t __initcall6a_start[], __initcall6a_end[];
+extern initcall_t __initcall7a_start[], __initcall7a_end[];
+
+static initcall_t *initcall_async_starts[] __initdata = {
+	__initcall0a_start,
+	__initcall1a_start,
+	__initcall2a_start,
+	__initcall3a_start,
+	__initcall4a_start,
+	__initcall5a_start,
+	__initcall6a_start,
+	__initcall7a_start,
+};
+
+static initcall_t *initcall_async_ends[] __initdata = {
+	__initcall0a_end,
+	__initcall1a_end,
+	__initcall2a_end,
+	__initcall3a_end,
+	__initcall4a_end,
+	__initcall5a_end,
+	__initcall6a_end,
+	__initcall7a_end,
+};
+
+static bool initcall_async = true;
+core_param(initcall_async, initcall_async, bool, 0444);
+
+static ASYNC_DOMAIN_EXCLUSIVE(initcall_async_domain);
+
+/*
+ * Start time and duration of every boot initcall, kept after boot in
+ * debugfs initcall_times so boot time can be broken down without
+ * initcall_debug and a large enough log buffer.
+ */
+struct initcall_time {
+	initcall_t fn;
+	s64 start_us;
+	s64 usecs;
+	int ret;
+	u8 level;
+	bool async;
+};
+
+static struct initcall_time *initcall_times;
+static unsigned int initcall_times_nr;
+static atomic_t initcall_times_next = ATOMIC_INIT(0);
+
+static int __init do_timed_initcall(initcall_t *fn, int level, bool async)
+{
+	struct initcall_time *t = NULL;
+	unsigned int idx;
+	ktime_t calltime;
+	int ret;
+
+	calltime = ktime_get();
+	ret = do_one_initcall(*fn);
+
+	idx = atomic_inc_return(&initcall_times_next) - 1;
+	if (initcall_times && idx < initcall_times_nr)
+		t = &initcall_times[idx];
+	if (t) {
+		t->fn = *fn;
+		t->start_us = ktime_to_us(calltime);
+		t->usecs = ktime_us_delta(ktime_get(), calltime);
+		t->ret = ret;
+		t->level = level;
+		t->async = async;
+	}
+
+	return ret;
+}
+
+static void __init do_initcall_async(void *data, async_cookie_t cookie)
+{
+	initcall_t *fn = data;
+	int level;
+
+	for (level = ARRAY_SIZE(initcall_async_starts) - 1; level > 0; level--)
+		if (fn >= initcall_async_starts[level])
+			break;
+
+	do_timed_initcall(fn, level, true);
+}
+
 static initcall_t *initcall_levels[] __initdata = {
 	__initcall0_start,
 	__initcall1_start,
@@ -871,18 +964,79 @@ static void __init do_initcall_level(int level)
 		   level, level,
 		   NULL, &repair_env_string);
 
-	for (fn = initcall_levels[level]; fn < initcall_levels[level+1]; fn++)
-		do_one_initcall(*fn);
+	for (fn = initcall_levels[level]; fn < initcall_levels[level+1]; fn++) {
+		if (fn >= initcall_async_starts[level] &&
+		    fn < initcall_async_ends[level]) {
+			if (initcall_async) {
+				async_schedule_domain(do_initcall_async, fn,
+						      &initcall_async_domain);
+				continue;
+			}
+		} else if (fn == initcall_async_ends[level]) {
+			/* the _sync initcalls may need the async ones */
+			async_synchronize_full_domain(&initcall_async_domain);
+		}
+		do_timed_initcall(fn, level, false);
+	}
+
+	async_synchronize_full_domain(&initcall_async_domain);
 }
 
 static void __init do_initcalls(void)
 {
 	int level;
 
+	initcall_times_nr = __initcall_end - __initcall_start;
+	initcall_times = kcalloc(initcall_times_nr, sizeof(*initcall_times),
+				 GFP_KERNEL);
+
 	for (level = 0; level < ARRAY_SIZE(initcall_levels) - 1; level++)
 		do_initcall_level(level);
 }
 
+#ifdef CONFIG_DEBUG_FS
+static int initcall_times_show(struct seq_file *m, void *unused)
+{
+	unsigned int i, nr;
+
+	nr = min_t(unsigned int, atomic_read(&initcall_times_next),
+		   initcall_times_nr);
+	seq_puts(m, "# level async start_us usecs ret initcall\n");
+	for (i = 0; i < nr; i++) {
+		struct initcall_time *t = &initcall_times[i];
+
+		if (!t->fn)
+			continue;
+		seq_printf(m, "%u %c %lld %lld %d %pf\n", t->level,
+			   t->async ? 'a' : '-', t->start_us, t->usecs,
+			   t->ret, t->fn);
+	}
+
+	return 0;
+}
+
+static int initcall_times_open(struct inode *inode, struct file *file)
+{
+	return single_open(file, initcall_times_show, NULL);
+}
+
+static const struct file_operations initcall_times_fops = {
+	.open = initcall_times_open,
+	.read = seq_read,
+	.llseek = seq_lseek,
+	.release = single_release,
+};
+
+static int __init initcall_times_debugfs_init(void)
+{
+	if (initcall_times)
+		debugfs_create_file("initcall_times", S_IRUGO, NULL, NULL,
+				    &initcall_times_fops);
+	return 0;
+}
+late_initcall(initcall_times_debugfs_init);
+#endif
+
 /*
  * Ok, the machine is now initialized. None of the devices
  * have been touched yet, but the CPU subsystem is up and
@@ -79,6 +79,7 @@ struct bpf_prog *bpf_prog_alloc(unsigned int size, gfp_t gfp_extra_flags)
 			  gfp_extra_flags;
 	struct bpf_prog_aux *aux;
 	struct bpf_prog *fp;
+	int cpu;
 
 	size = round_up(size, PAGE_SIZE);
 	fp = __vmalloc(size, gfp_flags, PAGE_KERNEL);
@@ -93,6 +94,20 @@ struct bpf_prog *bpf_prog_alloc(unsigned int size, gfp_t gfp_extra_flags)
 		return NULL;
 	}
 
+	aux->stats = alloc_percpu_gfp(struct bpf_prog_stats,
+				      GFP_KERNEL | gfp_extra_flags);
+	if (!aux->stats) {
+		kfree(aux);
+		vfree(fp);
+		return NULL;
+	}
+
+	for_each_possible_cpu(cpu) {
+		struct bpf_prog_stats *stats = per_cpu_ptr(aux->stats, cpu);
+
+		u64_stats_init(&stats->syncp);
+	}
+
 	fp->pages = size / PAGE_SIZE;
 	fp->aux = aux;
 	fp->aux->prog = fp;
@@ -144,10 +159,61 @@ struct bpf_prog *bpf_prog_realloc(struct bpf_prog *fp_old, unsigned int size,
 
 void __bpf_prog_free(struct bpf_prog *fp)
 {
+	if (fp->aux)
+		free_percpu(fp->aux->stats);
 	kfree(fp->aux);
 	vfree(fp);
 }
 
+DEFINE_STATIC_KEY_FALSE(bpf_stats_enabled_key);
+EXPORT_SYMBOL_GPL(bpf_stats_enabled_key);
+
+/* Slow path of BPF_PROG_RUN() taken while runtime stats are enabled */
+unsigned int bpf_prog_run_stats(const struct bpf_prog *prog, const void *ctx)
+{
+	struct bpf_prog_stats *stats;
+	unsigned int ret;
+	u64 start;
+
+	start = sched_clock();
+	ret = (*prog->bpf_func)(ctx, prog->insnsi);
+
+	/* seccomp and a few others run programs with preemption enabled */
+	stats = get_cpu_ptr(prog->aux->stats);
+	u64_stats_update_begin(&stats->syncp);
+	stats->cnt++;
+	stats->nsecs += sched_clock() - start;
+	u64_stats_update_end(&stats->syncp);
+	put_cpu_ptr(prog->aux->stats);
+
+	return ret;
+}
+EXPORT_SYMBOL_GPL(bpf_prog_run_stats);
+
+void bpf_prog_get_stats(const struct bpf_prog *prog, u64 *cnt, u64 *nsecs)
+{
+	u64 total_cnt = 0, total_nsecs = 0;
+	int cpu;
+
+	for_each_possible_cpu(cpu) {
+		const struct bpf_prog_stats *st;
+		unsigned int start;
+		u64 tcnt, tnsecs;
+
+		st = per_cpu_ptr(prog->aux->stats, cpu);
+		do {
+			start = u64_stats_fetch_begin_irq(&st->syncp);
+			tcnt = st->cnt;
+			tnsecs = st->nsecs;
+		} while (u64_stats_fetch_retry_irq(&st->syncp, start));
+		total_cnt += tcnt;
+		total_nsecs += tnsecs;
+	}
+
+	*cnt = total_cnt;
+	*nsecs = total_nsecs;
+}
+
 static bool bpf_is_jmp_and_has_target(const struct bpf_insn *insn)
 {
 	return BPF_CLASS(insn->code) == BPF_JMP  &&
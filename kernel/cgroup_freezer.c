@@ -22,6 +22,8 @@
 #include <linux/freezer.h>
 #include <linux/seq_file.h>
 #include <linux/mutex.h>
+#include <linux/workqueue.h>
+#include <linux/ktime.h>
 
 /*
  * A cgroup is freezing if any FREEZING flags are set.  FREEZING_SELF is
@@ -40,9 +42,32 @@ enum freezer_state_flags {
 	CGROUP_FREEZING		= CGROUP_FREEZING_SELF | CGROUP_FREEZING_PARENT,
 };
 
+/*
+ * Freezing is asynchronous to the writer of freezer.state: the tasks are
+ * sent their freeze requests from @work, which then keeps checking until
+ * the cgroup is FROZEN and notifies freezer.state when it is.
+ */
+#define FREEZER_POLL_MAX	(HZ / 10)
+
 struct freezer {
 	struct cgroup_subsys_state	css;
 	unsigned int			state;
+
+	struct cgroup_file		state_file;
+	struct delayed_work		work;
+	unsigned long			poll_delay;
+	bool				freeze_pending;
+	ktime_t				freeze_start;
+
+	/* transition stats, protected by freezer_mutex */
+	u64				nr_freeze;
+	u64				freeze_last_us;
+	u64				freeze_max_us;
+	u64				freeze_total_us;
+	u64				nr_thaw;
+	u64				thaw_last_us;
+	u64				thaw_max_us;
+	u64				thaw_total_us;
 };
 
 static DEFINE_MUTEX(freezer_mutex);
@@ -82,6 +107,8 @@ static const char *freezer_state_strs(unsigned int state)
 	return "THAWED";
 };
 
+static void freezer_work_fn(struct work_struct *work);
+
 static struct cgroup_subsys_state *
 freezer_css_alloc(struct cgroup_subsys_state *parent_css)
 {
@@ -91,6 +118,7 @@ freezer_css_alloc(struct cgroup_subsys_state *parent_css)
 	if (!freezer)
 		return ERR_PTR(-ENOMEM);
 
+	INIT_DELAYED_WORK(&freezer->work, freezer_work_fn);
 	return &freezer->css;
 }
 
@@ -143,7 +171,17 @@ static void freezer_css_offline(struct cgroup_subsys_state *css)
 
 static void freezer_css_free(struct cgroup_subsys_state *css)
 {
-	kfree(css_freezer(css));
+	struct freezer *freezer = css_freezer(css);
+
+	cancel_delayed_work_sync(&freezer->work);
+	kfree(freezer);
+}
+
+/* (re)start checking @freezer for completion of its freeze */
+static void freezer_kick(struct freezer *freezer)
+{
+	freezer->poll_delay = 1;
+	mod_delayed_work(system_wq, &freezer->work, 0);
 }
 
 /*
@@ -179,6 +217,7 @@ static void freezer_attach(struct cgroup_taskset *tset)
 			__thaw_task(task);
 		} else {
 			freeze_task(task);
+			freezer_kick(freezer);
 			/* clear FROZEN and propagate upwards */
 			while (freezer && (freezer->state & CGROUP_FROZEN)) {
 				freezer->state &= ~CGROUP_FROZEN;
@@ -225,6 +264,32 @@ static void freezer_fork(struct task_struct *task)
 	mutex_unlock(&freezer_mutex);
 }
 
+/*
+ * @freezer just reached FROZEN: account the freeze latency, let pollers of
+ * freezer.state know and have the parent check whether it is done too.
+ */
+static void freezer_frozen(struct freezer *freezer)
+{
+	struct freezer *parent = parent_freezer(freezer);
+	u64 delta;
+
+	lockdep_assert_held(&freezer_mutex);
+
+	if (ktime_to_ns(freezer->freeze_start)) {
+		delta = ktime_us_delta(ktime_get(), freezer->freeze_start);
+		freezer->freeze_start = ktime_set(0, 0);
+		freezer->freeze_last_us = delta;
+		freezer->freeze_max_us = max(freezer->freeze_max_us, delta);
+		freezer->freeze_total_us += delta;
+	}
+
+	cgroup_file_notify(&freezer->state_file);
+
+	if (parent && (parent->state & CGROUP_FREEZING) &&
+	    !(parent->state & CGROUP_FROZEN))
+		freezer_kick(parent);
+}
+
 /**
  * update_if_frozen - update whether a cgroup finished freezing
  * @css: css of interest
@@ -284,6 +349,7 @@ static void update_if_frozen(struct cgroup_subsys_state *css)
 	}
 
 	freezer->state |= CGROUP_FROZEN;
+	freezer_frozen(freezer);
 out_iter_end:
 	css_task_iter_end(&it);
 }
@@ -337,6 +403,39 @@ static void unfreeze_cgroup(struct freezer *freezer)
 	css_task_iter_end(&it);
 }
 
+/*
+ * Sends the freeze requests of a freezing cgroup and then polls, backing
+ * off up to FREEZER_POLL_MAX, until update_if_frozen() sees every task
+ * frozen.  Children kick their parent when they get there, so the parent
+ * does not have to wait for its next poll.
+ */
+static void freezer_work_fn(struct work_struct *work)
+{
+	struct freezer *freezer = container_of(to_delayed_work(work),
+					       struct freezer, work);
+
+	mutex_lock(&freezer_mutex);
+
+	if (!(freezer->state & CGROUP_FREEZER_ONLINE) ||
+	    !(freezer->state & CGROUP_FREEZING))
+		goto out_unlock;
+
+	if (freezer->freeze_pending) {
+		freezer->freeze_pending = false;
+		freeze_cgroup(freezer);
+	}
+
+	update_if_frozen(&freezer->css);
+	if (freezer->state & CGROUP_FROZEN)
+		goto out_unlock;
+
+	queue_delayed_work(system_wq, &freezer->work, freezer->poll_delay);
+	freezer->poll_delay = min_t(unsigned long, freezer->poll_delay * 2,
+				    FREEZER_POLL_MAX);
+out_unlock:
+	mutex_unlock(&freezer_mutex);
+}
+
 /**
  * freezer_apply_state - apply state change to a single cgroup_freezer
  * @freezer: freezer to apply state change to
@@ -356,20 +455,38 @@ static void freezer_apply_state(struct freezer *freezer, bool freeze,
 		return;
 
 	if (freeze) {
-		if (!(freezer->state & CGROUP_FREEZING))
+		if (!(freezer->state & CGROUP_FREEZING)) {
 			atomic_inc(&system_freezing_cnt);
+			freezer->freeze_start = ktime_get();
+			freezer->nr_freeze++;
+		}
 		freezer->state |= state;
-		freeze_cgroup(freezer);
+		freezer->freeze_pending = true;
+		freezer_kick(freezer);
 	} else {
 		bool was_freezing = freezer->state & CGROUP_FREEZING;
 
 		freezer->state &= ~state;
 
 		if (!(freezer->state & CGROUP_FREEZING)) {
+			ktime_t start = ktime_get();
+			u64 delta;
+
 			if (was_freezing)
 				atomic_dec(&system_freezing_cnt);
 			freezer->state &= ~CGROUP_FROZEN;
+			freezer->freeze_pending = false;
+			freezer->freeze_start = ktime_set(0, 0);
 			unfreeze_cgroup(freezer);
+
+			if (was_freezing) {
+				delta = ktime_us_delta(ktime_get(), start);
+				freezer->nr_thaw++;
+				freezer->thaw_last_us = delta;
+				freezer->thaw_max_us = max(freezer->thaw_max_us,
+							   delta);
+				freezer->thaw_total_us += delta;
+			}
 		}
 	}
 }
@@ -450,13 +567,36 @@ static u64 freezer_parent_freezing_read(struct cgroup_subsys_state *css,
 	return (bool)(freezer->state & CGROUP_FREEZING_PARENT);
 }
 
+static int freezer_stats_show(struct seq_file *m, void *v)
+{
+	struct freezer *freezer = css_freezer(seq_css(m));
+
+	mutex_lock(&freezer_mutex);
+	seq_printf(m, "freeze_count %llu\n", freezer->nr_freeze);
+	seq_printf(m, "freeze_last_us %llu\n", freezer->freeze_last_us);
+	seq_printf(m, "freeze_max_us %llu\n", freezer->freeze_max_us);
+	seq_printf(m, "freeze_total_us %llu\n", freezer->freeze_total_us);
+	seq_printf(m, "thaw_count %llu\n", freezer->nr_thaw);
+	seq_printf(m, "thaw_last_us %llu\n", freezer->thaw_last_us);
+	seq_printf(m, "thaw_max_us %llu\n", freezer->thaw_max_us);
+	seq_printf(m, "thaw_total_us %llu\n", freezer->thaw_total_us);
+	mutex_unlock(&freezer_mutex);
+	return 0;
+}
+
 static struct cftype files[] = {
 	{
 		.name = "state",
 		.flags = CFTYPE_NOT_ON_ROOT,
+		.file_offset = offsetof(struct freezer, state_file),
 		.seq_show = freezer_read,
 		.write = freezer_write,
 	},
+	{
+		.name = "stats",
+		.flags = CFTYPE_NOT_ON_ROOT,
+		.seq_show = freezer_stats_show,
+	},
 	{
 		.name = "self_freezing",
 		.flags = CFTYPE_NOT_ON_ROOT,
@@ -0,0 +1,376 @@
+/*
+ * linux/kernel/irq/balance.c
+ *
+ * Rate based interrupt affinity balancing.
+ *
+ * Every balance interval the per-CPU counters of each interrupt are
+ * summed and turned into a rate. Interrupts above a minimum rate that
+ * may be moved are then reassigned, busiest first, to the least loaded
+ * CPU of the balance mask. The load of a CPU is the rate of the
+ * interrupts it is the target of plus the rate of its network and block
+ * softirqs, since the NAPI and completion work raised by an interrupt
+ * is run on the CPU that took it. CPUs that are in a deep idle state
+ * are not picked as new targets, so that a burst of interrupts does not
+ * keep pulling them out of it.
+ */
+
+#include <linux/irq.h>
+#include <linux/interrupt.h>
+#include <linux/kernel_stat.h>
+#include <linux/moduleparam.h>
+#include <linux/proc_fs.h>
+#include <linux/seq_file.h>
+#include <linux/workqueue.h>
+#include <linux/cpuidle.h>
+#include <linux/cpu.h>
+#include <linux/sched.h>
+
+#include "internals.h"
+
+#undef MODULE_PARAM_PREFIX
+#define MODULE_PARAM_PREFIX "irqbalance."
+
+/* Number of busiest interrupts considered per pass */
+#define IRQ_BALANCE_MAX_CANDIDATES	32
+
+static bool irq_balance_enabled = true;
+static unsigned int irq_balance_interval_ms = 1000;
+static unsigned int irq_balance_min_rate = 1000;
+static unsigned int irq_balance_idle_us = 5000;
+
+module_param_named(interval_ms, irq_balance_interval_ms, uint, 0644);
+module_param_named(min_rate, irq_balance_min_rate, uint, 0644);
+module_param_named(idle_us, irq_balance_idle_us, uint, 0644);
+
+static DEFINE_MUTEX(irq_balance_lock);
+static struct cpumask irq_balance_cpus;
+static unsigned long irq_balance_moves;
+static DEFINE_PER_CPU(unsigned long, irq_balance_load);
+static DEFINE_PER_CPU(unsigned int, irq_balance_softirq_last);
+
+static void irq_balance_work_fn(struct work_struct *work);
+static DECLARE_DELAYED_WORK(irq_balance_work, irq_balance_work_fn);
+
+struct irq_balance_candidate {
+	struct irq_desc		*desc;
+	unsigned int		rate;
+	int			cpu;
+};
+
+static struct irq_balance_candidate
+irq_balance_candidates[IRQ_BALANCE_MAX_CANDIDATES];
+
+static unsigned long irq_balance_interval(void)
+{
+	return msecs_to_jiffies(max(irq_balance_interval_ms, 10U));
+}
+
+static bool irq_balance_cpu_deep_idle(int cpu)
+{
+#ifdef CONFIG_CPU_IDLE
+	struct cpuidle_device *dev = per_cpu(cpuidle_devices, cpu);
+
+	if (!idle_cpu(cpu) || !dev)
+		return false;
+
+	return cpuidle_get_last_residency(dev) >= (int)irq_balance_idle_us;
+#else
+	return false;
+#endif
+}
+
+static unsigned int irq_balance_softirqs(int cpu)
+{
+	return kstat_softirqs_cpu(NET_RX_SOFTIRQ, cpu) +
+	       kstat_softirqs_cpu(NET_TX_SOFTIRQ, cpu) +
+	       kstat_softirqs_cpu(BLOCK_SOFTIRQ, cpu);
+}
+
+/*
+ * An interrupt is left alone when the core or its driver manage the
+ * affinity, or when it was pinned to a single CPU by someone other than
+ * the balancer.
+ */
+static bool irq_balance_movable(struct irq_desc *desc)
+{
+	struct irq_data *data = irq_desc_get_irq_data(desc);
+	const struct cpumask *mask = irq_data_get_affinity_mask(data);
+
+	if (!desc->action || !data->chip || !data->chip->irq_set_affinity)
+		return false;
+	if (!irqd_can_balance(data) || irqd_affinity_is_managed(data))
+		return false;
+	if (cpumask_weight(mask) == 1 &&
+	    cpumask_first(mask) != desc->balance_cpu)
+		return false;
+
+	return true;
+}
+
+static int irq_balance_target(struct irq_desc *desc)
+{
+	const struct cpumask *mask;
+	int cpu;
+
+	mask = irq_data_get_effective_affinity_mask(&desc->irq_data);
+	cpu = cpumask_first_and(mask, cpu_online_mask);
+	if (cpu >= nr_cpu_ids) {
+		mask = irq_data_get_affinity_mask(&desc->irq_data);
+		cpu = cpumask_first_and(mask, cpu_online_mask);
+	}
+
+	return cpu;
+}
+
+static void irq_balance_insert(struct irq_balance_candidate *cand,
+			       unsigned int *nr, struct irq_desc *desc,
+			       unsigned int rate, int cpu)
+{
+	unsigned int i = *nr;
+
+	if (i == IRQ_BALANCE_MAX_CANDIDATES) {
+		if (rate <= cand[i - 1].rate)
+			return;
+		i--;
+	} else {
+		(*nr)++;
+	}
+
+	/* Keep the array sorted by descending rate */
+	for (; i > 0 && cand[i - 1].rate < rate; i--)
+		cand[i] = cand[i - 1];
+
+	cand[i].desc = desc;
+	cand[i].rate = rate;
+	cand[i].cpu = cpu;
+}
+
+static int irq_balance_pick(const struct cpumask *allowed, int cur)
+{
+	unsigned long best_load = ULONG_MAX;
+	int cpu, best = cur;
+
+	for_each_cpu(cpu, allowed) {
+		unsigned long load = per_cpu(irq_balance_load, cpu);
+
+		if (cpu != cur && irq_balance_cpu_deep_idle(cpu))
+			continue;
+		if (load < best_load) {
+			best_load = load;
+			best = cpu;
+		}
+	}
+
+	return best;
+}
+
+static void irq_balance_pass(unsigned int interval_ms)
+{
+	struct irq_balance_candidate *cand = irq_balance_candidates;
+	static struct cpumask allowed;
+	unsigned int i, nr = 0;
+	struct irq_desc *desc;
+	int irq, cpu;
+
+	cpumask_and(&allowed, &irq_balance_cpus, cpu_online_mask);
+
+	for_each_possible_cpu(cpu) {
+		unsigned int count = irq_balance_softirqs(cpu);
+		unsigned int delta = count - per_cpu(irq_balance_softirq_last, cpu);
+
+		per_cpu(irq_balance_softirq_last, cpu) = count;
+		per_cpu(irq_balance_load, cpu) =
+			(unsigned long)delta * MSEC_PER_SEC / interval_ms;
+	}
+
+	irq_lock_sparse();
+
+	for_each_irq_desc(irq, desc) {
+		unsigned int count = kstat_irqs(irq);
+		unsigned int rate;
+
+		rate = (unsigned long)(count - desc->balance_last) *
+			MSEC_PER_SEC / interval_ms;
+		desc->balance_last = count;
+		desc->balance_rate = rate;
+
+		if (irqd_is_per_cpu(&desc->irq_data))
+			continue;
+
+		cpu = irq_balance_target(desc);
+		if (cpu >= nr_cpu_ids)
+			continue;
+		per_cpu(irq_balance_load, cpu) += rate;
+
+		if (rate >= irq_balance_min_rate && irq_balance_movable(desc))
+			irq_balance_insert(cand, &nr, desc, rate, cpu);
+	}
+
+	for (i = 0; i < nr && cpumask_weight(&allowed) > 1; i++) {
+		unsigned long cur_load, new_load;
+		int best;
+
+		cpu = cand[i].cpu;
+		best = irq_balance_pick(&allowed, cpu);
+		if (best == cpu)
+			continue;
+
+		/*
+		 * Only move when it lowers the peak of the two CPUs by more
+		 * than an eighth, so that two similar CPUs do not trade the
+		 * same interrupt back and forth every pass.
+		 */
+		cur_load = per_cpu(irq_balance_load, cpu);
+		new_load = per_cpu(irq_balance_load, best) + cand[i].rate;
+		if (new_load + (cur_load >> 3) >= cur_load)
+			continue;
+
+		desc = cand[i].desc;
+		if (irq_set_affinity(irq_desc_get_irq(desc), cpumask_of(best)))
+			continue;
+
+		per_cpu(irq_balance_load, cpu) -= cand[i].rate;
+		per_cpu(irq_balance_load, best) = new_load;
+		desc->balance_cpu = best;
+		desc->balance_moves++;
+		irq_balance_moves++;
+	}
+
+	irq_unlock_sparse();
+}
+
+static void irq_balance_work_fn(struct work_struct *work)
+{
+	unsigned int interval_ms = max(irq_balance_interval_ms, 10U);
+
+	if (!READ_ONCE(irq_balance_enabled))
+		return;
+
+	get_online_cpus();
+	mutex_lock(&irq_balance_lock);
+	irq_balance_pass(interval_ms);
+	mutex_unlock(&irq_balance_lock);
+	put_online_cpus();
+
+	queue_delayed_work(system_power_efficient_wq, &irq_balance_work,
+			   irq_balance_interval());
+}
+
+static int irq_balance_enabled_set(const char *val,
+				   const struct kernel_param *kp)
+{
+	int ret;
+
+	ret = param_set_bool(val, kp);
+	if (ret)
+		return ret;
+
+	if (irq_balance_enabled)
+		mod_delayed_work(system_power_efficient_wq, &irq_balance_work,
+				 irq_balance_interval());
+
+	return 0;
+}
+
+static const struct kernel_param_ops irq_balance_enabled_ops = {
+	.set = irq_balance_enabled_set,
+	.get = param_get_bool,
+};
+module_param_cb(enabled, &irq_balance_enabled_ops, &irq_balance_enabled,
+		0644);
+
+static int irq_balance_mask_show(struct seq_file *m, void *v)
+{
+	mutex_lock(&irq_balance_lock);
+	seq_printf(m, "%*pb\n", cpumask_pr_args(&irq_balance_cpus));
+	mutex_unlock(&irq_balance_lock);
+	return 0;
+}
+
+static ssize_t irq_balance_mask_write(struct file *file,
+		const char __user *buffer, size_t count, loff_t *ppos)
+{
+	cpumask_var_t new_value;
+	int err;
+
+	if (!alloc_cpumask_var(&new_value, GFP_KERNEL))
+		return -ENOMEM;
+
+	err = cpumask_parse_user(buffer, count, new_value);
+	if (err)
+		goto out;
+
+	if (!cpumask_intersects(new_value, cpu_online_mask)) {
+		err = -EINVAL;
+		goto out;
+	}
+
+	mutex_lock(&irq_balance_lock);
+	cpumask_copy(&irq_balance_cpus, new_value);
+	mutex_unlock(&irq_balance_lock);
+	err = count;
+
+out:
+	free_cpumask_var(new_value);
+	return err;
+}
+
+static int irq_balance_mask_open(struct inode *inode, struct file *file)
+{
+	return single_open(file, irq_balance_mask_show, NULL);
+}
+
+static const struct file_operations irq_balance_mask_fops = {
+	.open		= irq_balance_mask_open,
+	.read		= seq_read,
+	.llseek		= seq_lseek,
+	.release	= single_release,
+	.write		= irq_balance_mask_write,
+};
+
+static int irq_balance_stats_show(struct seq_file *m, void *v)
+{
+	int cpu;
+
+	mutex_lock(&irq_balance_lock);
+	seq_printf(m, "enabled %d\n" "interval_ms %u\n" "min_rate %u\n"
+		   "idle_us %u\n" "moves %lu\n",
+		   irq_balance_enabled, irq_balance_interval_ms,
+		   irq_balance_min_rate, irq_balance_idle_us,
+		   irq_balance_moves);
+	for_each_online_cpu(cpu)
+		seq_printf(m, "cpu%d load %lu%s\n", cpu,
+			   per_cpu(irq_balance_load, cpu),
+			   irq_balance_cpu_deep_idle(cpu) ? " idle" : "");
+	mutex_unlock(&irq_balance_lock);
+	return 0;
+}
+
+static int irq_balance_stats_open(struct inode *inode, struct file *file)
+{
+	return single_open(file, irq_balance_stats_show, NULL);
+}
+
+static const struct file_operations irq_balance_stats_fops = {
+	.open		= irq_balance_stats_open,
+	.read		= seq_read,
+	.llseek		= seq_lseek,
+	.release	= single_release,
+};
+
+void irq_balance_register_proc(struct proc_dir_entry *root)
+{
+	proc_create("balance_mask", 0644, root, &irq_balance_mask_fops);
+	proc_create("balance_stats", 0444, root, &irq_balance_stats_fops);
+}
+
+static int __init irq_balance_init(void)
+{
+	cpumask_copy(&irq_balance_cpus, cpu_possible_mask);
+
+	if (irq_balance_enabled)
+		queue_delayed_work(system_power_efficient_wq,
+				   &irq_balance_work, irq_balance_interval());
+	return 0;
+}
+late_initcall(irq_balance_init);
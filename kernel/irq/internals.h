@@ -109,6 +109,12 @@ static inline void unregister_handler_proc(unsigned int irq,
 
 extern bool irq_can_set_affinity_usr(unsigned int irq);
 
+#ifdef CONFIG_IRQ_RATE_BALANCE
+extern void irq_balance_register_proc(struct proc_dir_entry *root);
+#else
+static inline void irq_balance_register_proc(struct proc_dir_entry *root) { }
+#endif
+
 extern int irq_select_affinity_usr(unsigned int irq, struct cpumask *mask);
 
 extern void irq_set_thread_affinity(struct irq_desc *desc);
@@ -90,6 +90,12 @@ static void desc_smp_init(struct irq_desc *desc, int node,
 #ifdef CONFIG_GENERIC_PENDING_IRQ
 	cpumask_clear(desc->pending_mask);
 #endif
+#ifdef CONFIG_IRQ_RATE_BALANCE
+	desc->balance_last = 0;
+	desc->balance_rate = 0;
+	desc->balance_moves = 0;
+	desc->balance_cpu = -1;
+#endif
 #ifdef CONFIG_NUMA
 	desc->irq_common_data.node = node;
 #endif
@@ -352,6 +352,29 @@ static const struct file_operations irq_spurious_proc_fops = {
 	.release	= single_release,
 };
 
+#ifdef CONFIG_IRQ_RATE_BALANCE
+static int irq_balance_proc_show(struct seq_file *m, void *v)
+{
+	struct irq_desc *desc = irq_to_desc((long) m->private);
+
+	seq_printf(m, "rate %u\n" "moves %u\n" "cpu %d\n",
+		   desc->balance_rate, desc->balance_moves, desc->balance_cpu);
+	return 0;
+}
+
+static int irq_balance_proc_open(struct inode *inode, struct file *file)
+{
+	return single_open(file, irq_balance_proc_show, PDE_DATA(inode));
+}
+
+static const struct file_operations irq_balance_proc_fops = {
+	.open		= irq_balance_proc_open,
+	.read		= seq_read,
+	.llseek		= seq_lseek,
+	.release	= single_release,
+};
+#endif
+
 #define MAX_NAMELEN 128
 
 static int name_unique(unsigned int irq, struct irqaction *new_action)
@@ -438,6 +461,10 @@ void register_irq_proc(unsigned int irq, struct irq_desc *desc)
 	proc_create_data("effective_affinity_list", 0444, desc->dir,
 			 &irq_effective_aff_list_proc_fops, (void *)(long)irq);
 # endif
+# ifdef CONFIG_IRQ_RATE_BALANCE
+	proc_create_data("balance", 0444, desc->dir,
+			 &irq_balance_proc_fops, (void *)(long)irq);
+# endif
 #endif
 
 	proc_create_data("spurious", 0444, desc->dir,
@@ -462,6 +489,9 @@ void unregister_irq_proc(unsigned int irq, struct irq_desc *desc)
 	remove_proc_entry("effective_affinity", desc->dir);
 	remove_proc_entry("effective_affinity_list", desc->dir);
 # endif
+# ifdef CONFIG_IRQ_RATE_BALANCE
+	remove_proc_entry("balance", desc->dir);
+# endif
 #endif
 	remove_proc_entry("spurious", desc->dir);
 
@@ -495,6 +525,7 @@ void init_irq_proc(void)
 		return;
 
 	register_default_affinity_proc();
+	irq_balance_register_proc(root_irq_dir);
 
 	/*
 	 * Create entries for all existing IRQs.
@@ -42,6 +42,7 @@
 #include <linux/rculist.h>
 #include <linux/poll.h>
 #include <linux/irq_work.h>
+#include <linux/kthread.h>
 #include <linux/utsname.h>
 #include <linux/ctype.h>
 #include <linux/uio.h>
@@ -1734,6 +1735,8 @@ static size_t log_output(int facility, int level, enum log_flags lflags, const c
 	return log_store(facility, level, lflags, 0, dict, dictlen, text, text_len);
 }
 
+static bool printk_offload_console(void);
+
 asmlinkage int vprintk_emit(int facility, int level,
 			    const char *dict, size_t dictlen,
 			    const char *fmt, va_list args)
@@ -1858,7 +1861,7 @@ asmlinkage int vprintk_emit(int facility, int level,
 	local_irq_restore(flags);
 
 	/* If called from the scheduler, we can not call up(). */
-	if (!in_sched) {
+	if (!in_sched && !printk_offload_console()) {
 		lockdep_off();
 		/*
 		 * Try to acquire and then immediately release the console
@@ -2300,6 +2303,43 @@ static void console_cont_flush(char *text, size_t size)
 	raw_spin_unlock_irqrestore(&logbuf_lock, flags);
 }
 
+/* records overwritten in the log buffer before reaching the consoles */
+static u64 console_dropped;
+
+static int console_lag_get(char *buffer, const struct kernel_param *kp)
+{
+	unsigned long flags;
+	u64 lag;
+
+	raw_spin_lock_irqsave(&logbuf_lock, flags);
+	lag = log_next_seq - console_seq;
+	raw_spin_unlock_irqrestore(&logbuf_lock, flags);
+
+	return scnprintf(buffer, PAGE_SIZE, "%llu\n", lag);
+}
+
+static const struct kernel_param_ops console_lag_ops = {
+	.get = console_lag_get,
+};
+module_param_cb(console_lag, &console_lag_ops, NULL, S_IRUGO);
+
+static int console_dropped_get(char *buffer, const struct kernel_param *kp)
+{
+	unsigned long flags;
+	u64 dropped;
+
+	raw_spin_lock_irqsave(&logbuf_lock, flags);
+	dropped = console_dropped;
+	raw_spin_unlock_irqrestore(&logbuf_lock, flags);
+
+	return scnprintf(buffer, PAGE_SIZE, "%llu\n", dropped);
+}
+
+static const struct kernel_param_ops console_dropped_ops = {
+	.get = console_dropped_get,
+};
+module_param_cb(console_dropped, &console_dropped_ops, NULL, S_IRUGO);
+
 /**
  * console_unlock - unlock the console system
  *
@@ -2375,6 +2415,7 @@ void console_unlock(void)
 		if (console_seq < log_first_seq) {
 			len = sprintf(text, "** %u printk messages dropped ** ",
 				      (unsigned)(log_first_seq - console_seq));
+			console_dropped += log_first_seq - console_seq;
 
 			/* messages are gone, move to first one */
 			console_seq = log_first_seq;
@@ -2837,13 +2878,31 @@ late_initcall(printk_late_init);
  */
 #define PRINTK_PENDING_WAKEUP	0x01
 #define PRINTK_PENDING_OUTPUT	0x02
+#define PRINTK_PENDING_KTHREAD	0x04
 
 static DEFINE_PER_CPU(int, printk_pending);
 
+/*
+ * Console output is normally printed by a dedicated kthread rather than by
+ * whoever called printk(), so that a slow serial console does not add
+ * milliseconds to irq and atomic paths that log.  It is printed directly
+ * again once an oops or panic is in progress, when the system is going
+ * down, or when printk.synchronous is set.
+ */
+static struct task_struct *printk_kthread;
+static bool printk_kthread_need_flush;
+static bool printk_sync;
+module_param_named(synchronous, printk_sync, bool, S_IRUGO | S_IWUSR);
+
 static void wake_up_klogd_work_func(struct irq_work *irq_work)
 {
 	int pending = __this_cpu_xchg(printk_pending, 0);
 
+	if (pending & PRINTK_PENDING_KTHREAD) {
+		WRITE_ONCE(printk_kthread_need_flush, true);
+		wake_up_process(printk_kthread);
+	}
+
 	if (pending & PRINTK_PENDING_OUTPUT) {
 		/* If trylock fails, someone else is doing the printing */
 		if (console_trylock())
@@ -2859,6 +2918,55 @@ static DEFINE_PER_CPU(struct irq_work, wake_up_klogd_work) = {
 	.flags = IRQ_WORK_LAZY,
 };
 
+static bool printk_offload_console(void)
+{
+	if (!printk_kthread || printk_sync || oops_in_progress ||
+	    system_state > SYSTEM_RUNNING)
+		return false;
+
+	/*
+	 * printk() may be called with runqueue locks held, so the kthread
+	 * is woken from irq_work rather than from here.
+	 */
+	preempt_disable();
+	__this_cpu_or(printk_pending, PRINTK_PENDING_KTHREAD);
+	irq_work_queue(this_cpu_ptr(&wake_up_klogd_work));
+	preempt_enable();
+
+	return true;
+}
+
+static int printk_kthread_func(void *data)
+{
+	for (;;) {
+		set_current_state(TASK_INTERRUPTIBLE);
+		if (!READ_ONCE(printk_kthread_need_flush))
+			schedule();
+		__set_current_state(TASK_RUNNING);
+
+		WRITE_ONCE(printk_kthread_need_flush, false);
+		console_lock();
+		console_unlock();
+	}
+
+	return 0;
+}
+
+static int __init printk_kthread_init(void)
+{
+	struct task_struct *tsk;
+
+	tsk = kthread_run(printk_kthread_func, NULL, "printk");
+	if (IS_ERR(tsk)) {
+		pr_err("printk: failed to start printing thread\n");
+		return PTR_ERR(tsk);
+	}
+	printk_kthread = tsk;
+
+	return 0;
+}
+late_initcall(printk_kthread_init);
+
 void wake_up_klogd(void)
 {
 	preempt_disable();
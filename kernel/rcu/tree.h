@@ -416,6 +416,9 @@ struct rcu_data {
 	struct swait_queue_head nocb_wq; /* For nocb kthreads to sleep on. */
 	struct task_struct *nocb_kthread;
 	int nocb_defer_wakeup;		/* Defer wakeup of nocb_kthread. */
+	unsigned long n_nocb_enqueued;	/* # CBs handed to the kthread. */
+	unsigned long n_nocb_wakes;	/* # leader wakeups issued. */
+	unsigned long n_nocb_deferred;	/* # wakeups deferred, irqs off. */
 
 	/* The following fields are used by the leader, hence own cacheline. */
 	struct rcu_head *nocb_gp_head ____cacheline_internodealigned_in_smp;
@@ -424,6 +427,8 @@ struct rcu_data {
 	bool nocb_leader_sleep;		/* Is the nocb leader thread asleep? */
 	struct rcu_data *nocb_next_follower;
 					/* Next follower in wakeup chain. */
+	unsigned long n_nocb_gp_waits;	/* # GPs waited for by leader. */
+	unsigned long n_nocb_batched;	/* # batching delays by leader. */
 
 	/* The following fields are used by the follower, hence new cachline. */
 	struct rcu_data *nocb_leader ____cacheline_internodealigned_in_smp;
@@ -59,6 +59,8 @@ DEFINE_PER_CPU(char, rcu_cpu_has_work);
 static cpumask_var_t rcu_nocb_mask; /* CPUs to have callbacks offloaded. */
 static bool have_rcu_nocb_mask;	    /* Was rcu_nocb_mask allocated? */
 static bool __read_mostly rcu_nocb_poll;    /* Offload kthread are to poll. */
+static cpumask_var_t rcu_nocb_hk_mask; /* CPUs rcuo kthreads may run on. */
+static bool have_rcu_nocb_hk_mask;  /* Was rcu_nocb_hk_mask allocated? */
 #endif /* #ifdef CONFIG_RCU_NOCB_CPU */
 
 /*
@@ -1724,6 +1726,29 @@ static int __init parse_rcu_nocb_poll(char *arg)
 }
 early_param("rcu_nocb_poll", parse_rcu_nocb_poll);
 
+/*
+ * Parse the boot-time list of housekeeping CPUs that the rcuo kthreads
+ * are confined to, typically the little cluster, so that invoking the
+ * offloaded callbacks does not wake the big cores.
+ */
+static int __init rcu_nocb_housekeeping_setup(char *str)
+{
+	alloc_bootmem_cpumask_var(&rcu_nocb_hk_mask);
+	have_rcu_nocb_hk_mask = true;
+	cpulist_parse(str, rcu_nocb_hk_mask);
+	return 1;
+}
+__setup("rcu_nocb_housekeeping=", rcu_nocb_housekeeping_setup);
+
+/*
+ * How long, in jiffies, a leader that was woken by new callbacks waits
+ * for more of them before starting the grace period.  Callbacks queued
+ * by other CPUs during that window then share a single grace period
+ * instead of each burst waking the leader and starting its own.
+ */
+static int rcu_nocb_gp_batch;
+module_param(rcu_nocb_gp_batch, int, 0644);
+
 /*
  * Wake up any no-CBs CPUs' kthreads that were waiting on the just-ended
  * grace period.
@@ -1778,6 +1803,7 @@ static void wake_nocb_leader(struct rcu_data *rdp, bool force)
 		return;
 	if (READ_ONCE(rdp_leader->nocb_leader_sleep) || force) {
 		/* Prior smp_mb__after_atomic() orders against prior enqueue. */
+		rdp->n_nocb_wakes++;
 		WRITE_ONCE(rdp_leader->nocb_leader_sleep, false);
 		smp_mb(); /* ->nocb_leader_sleep before swake_up(). */
 		swake_up(&rdp_leader->nocb_wq);
@@ -1854,6 +1880,7 @@ static void __call_rcu_nocb_enqueue(struct rcu_data *rdp,
 	old_rhpp = xchg(&rdp->nocb_tail, rhtp);
 	WRITE_ONCE(*old_rhpp, rhp);
 	atomic_long_add(rhcount_lazy, &rdp->nocb_q_count_lazy);
+	rdp->n_nocb_enqueued += rhcount;
 	smp_mb__after_atomic(); /* Store *old_rhpp before _wake test. */
 
 	/* If we are not being polled and there is a kthread, awaken it ... */
@@ -1872,6 +1899,7 @@ static void __call_rcu_nocb_enqueue(struct rcu_data *rdp,
 					    TPS("WakeEmpty"));
 		} else {
 			rdp->nocb_defer_wakeup = RCU_NOGP_WAKE;
+			rdp->n_nocb_deferred++;
 			trace_rcu_nocb_wake(rdp->rsp->name, rdp->cpu,
 					    TPS("WakeEmptyIsDeferred"));
 		}
@@ -1884,6 +1912,7 @@ static void __call_rcu_nocb_enqueue(struct rcu_data *rdp,
 					    TPS("WakeOvf"));
 		} else {
 			rdp->nocb_defer_wakeup = RCU_NOGP_WAKE_FORCE;
+			rdp->n_nocb_deferred++;
 			trace_rcu_nocb_wake(rdp->rsp->name, rdp->cpu,
 					    TPS("WakeOvfIsDeferred"));
 		}
@@ -2004,6 +2033,20 @@ static void rcu_nocb_wait_gp(struct rcu_data *rdp)
 	smp_mb(); /* Ensure that CB invocation happens after GP end. */
 }
 
+/*
+ * Is the leader's group already holding enough callbacks that delaying
+ * the grace period to batch more of them would only grow the backlog?
+ */
+static bool nocb_leader_overloaded(struct rcu_data *my_rdp)
+{
+	struct rcu_data *rdp;
+	long ql = 0;
+
+	for (rdp = my_rdp; rdp; rdp = rdp->nocb_next_follower)
+		ql += atomic_long_read(&rdp->nocb_q_count);
+	return ql > qhimark;
+}
+
 /*
  * Leaders come here to wait for additional callbacks to show up.
  * This function does not return until callbacks appear.
@@ -2012,6 +2055,7 @@ static void nocb_leader_wait(struct rcu_data *my_rdp)
 {
 	bool firsttime = true;
 	bool gotcbs;
+	int batch;
 	struct rcu_data *rdp;
 	struct rcu_head **tail;
 
@@ -2023,6 +2067,18 @@ static void nocb_leader_wait(struct rcu_data *my_rdp)
 		swait_event_interruptible(my_rdp->nocb_wq,
 				!READ_ONCE(my_rdp->nocb_leader_sleep));
 		/* Memory barrier handled by smp_mb() calls below and repoll. */
+
+		/*
+		 * ->nocb_leader_sleep stays false while we linger, so
+		 * callbacks queued meanwhile do not issue more wakeups.
+		 */
+		batch = READ_ONCE(rcu_nocb_gp_batch);
+		if (batch > 0 && !nocb_leader_overloaded(my_rdp)) {
+			trace_rcu_nocb_wake(my_rdp->rsp->name, my_rdp->cpu,
+					    TPS("Batch"));
+			my_rdp->n_nocb_batched++;
+			schedule_timeout_interruptible(batch);
+		}
 	} else if (firsttime) {
 		firsttime = false; /* Don't drown trace log with "Poll"! */
 		trace_rcu_nocb_wake(my_rdp->rsp->name, my_rdp->cpu, "Poll");
@@ -2070,6 +2126,7 @@ static void nocb_leader_wait(struct rcu_data *my_rdp)
 	}
 
 	/* Wait for one grace period. */
+	my_rdp->n_nocb_gp_waits++;
 	rcu_nocb_wait_gp(my_rdp);
 
 	/*
@@ -2265,6 +2322,12 @@ void __init rcu_init_nohz(void)
 		cpumask_pr_args(rcu_nocb_mask));
 	if (rcu_nocb_poll)
 		pr_info("\tPoll for callbacks from no-CBs CPUs.\n");
+	if (have_rcu_nocb_hk_mask) {
+		cpumask_and(rcu_nocb_hk_mask, cpu_possible_mask,
+			    rcu_nocb_hk_mask);
+		pr_info("\tRun offloaded RCU callbacks on CPUs: %*pbl.\n",
+			cpumask_pr_args(rcu_nocb_hk_mask));
+	}
 
 	for_each_rcu_flavor(rsp) {
 		for_each_cpu(cpu, rcu_nocb_mask)
@@ -2323,9 +2386,17 @@ static void rcu_spawn_one_nocb_kthread(struct rcu_state *rsp, int cpu)
 	}
 
 	/* Spawn the kthread for this CPU and RCU flavor. */
-	t = kthread_run(rcu_nocb_kthread, rdp_spawn,
-			"rcuo%c/%d", rsp->abbr, cpu);
+	t = kthread_create(rcu_nocb_kthread, rdp_spawn,
+			   "rcuo%c/%d", rsp->abbr, cpu);
 	BUG_ON(IS_ERR(t));
+	/*
+	 * Confine it to the housekeeping CPUs while any of them is up;
+	 * the affinity is left unbound so userspace may still retune it.
+	 */
+	if (have_rcu_nocb_hk_mask &&
+	    cpumask_intersects(rcu_nocb_hk_mask, cpu_active_mask))
+		set_cpus_allowed_ptr(t, rcu_nocb_hk_mask);
+	wake_up_process(t);
 	WRITE_ONCE(rdp_spawn->nocb_kthread, t);
 }
 
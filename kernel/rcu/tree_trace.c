@@ -180,6 +180,58 @@ static const struct file_operations rcudata_fops = {
 	.release = seq_release,
 };
 
+#ifdef CONFIG_RCU_NOCB_CPU
+
+static void print_one_rcu_nocb(struct seq_file *m, struct rcu_data *rdp)
+{
+	struct task_struct *t = READ_ONCE(rdp->nocb_kthread);
+	long ql, qll;
+
+	if (!rdp->beenonline || !rcu_is_nocb_cpu(rdp->cpu))
+		return;
+	rcu_nocb_q_lengths(rdp, &ql, &qll);
+	seq_printf(m, "%3d%cl=%d kc=%d ql=%ld/%ld",
+		   rdp->cpu,
+		   cpu_is_offline(rdp->cpu) ? '!' : ' ',
+		   rdp->nocb_leader ? rdp->nocb_leader->cpu : -1,
+		   t ? task_cpu(t) : -1,
+		   qll, ql);
+	seq_printf(m, " enq=%lu wk=%lu dwk=%lu",
+		   rdp->n_nocb_enqueued, rdp->n_nocb_wakes,
+		   rdp->n_nocb_deferred);
+	seq_printf(m, " gpw=%lu bat=%lu nci=%lu\n",
+		   rdp->n_nocb_gp_waits, rdp->n_nocb_batched,
+		   rdp->n_nocbs_invoked);
+}
+
+static int show_rcunocb(struct seq_file *m, void *v)
+{
+	print_one_rcu_nocb(m, (struct rcu_data *)v);
+	return 0;
+}
+
+static const struct seq_operations rcunocb_op = {
+	.start = r_start,
+	.next  = r_next,
+	.stop  = r_stop,
+	.show  = show_rcunocb,
+};
+
+static int rcunocb_open(struct inode *inode, struct file *file)
+{
+	return r_open(inode, file, &rcunocb_op);
+}
+
+static const struct file_operations rcunocb_fops = {
+	.owner = THIS_MODULE,
+	.open = rcunocb_open,
+	.read = seq_read,
+	.llseek = no_llseek,
+	.release = seq_release,
+};
+
+#endif /* #ifdef CONFIG_RCU_NOCB_CPU */
+
 static int show_rcuexp(struct seq_file *m, void *v)
 {
 	int cpu;
@@ -453,6 +505,13 @@ static int __init rcutree_trace_init(void)
 		if (!retval)
 			goto free_out;
 
+#ifdef CONFIG_RCU_NOCB_CPU
+		retval = debugfs_create_file("rcunocb", 0444,
+				rspdir, rsp, &rcunocb_fops);
+		if (!retval)
+			goto free_out;
+#endif
+
 		retval = debugfs_create_file("rcu_pending", 0444,
 				rspdir, rsp, &rcu_pending_fops);
 		if (!retval)
@@ -65,6 +65,7 @@
 #include <linux/sched/sysctl.h>
 #include <linux/kexec.h>
 #include <linux/bpf.h>
+#include <linux/filter.h>
 #include <linux/mount.h>
 
 #include <asm/uaccess.h>
@@ -257,6 +258,34 @@ static int bpf_unpriv_handler(struct ctl_table *table, int write,
 
 	return ret;
 }
+
+static int bpf_stats_handler(struct ctl_table *table, int write,
+			     void __user *buffer, size_t *lenp, loff_t *ppos)
+{
+	static DEFINE_MUTEX(bpf_stats_enabled_mutex);
+	int ret, enabled;
+	struct ctl_table tmp = *table;
+
+	if (write && !capable(CAP_SYS_ADMIN))
+		return -EPERM;
+
+	mutex_lock(&bpf_stats_enabled_mutex);
+	enabled = *(int *)table->data;
+	tmp.data = &enabled;
+	ret = proc_dointvec_minmax(&tmp, write, buffer, lenp, ppos);
+	if (write && !ret && enabled != *(int *)table->data) {
+		if (enabled)
+			static_branch_enable(&bpf_stats_enabled_key);
+		else
+			static_branch_disable(&bpf_stats_enabled_key);
+		*(int *)table->data = enabled;
+	}
+	mutex_unlock(&bpf_stats_enabled_mutex);
+
+	return ret;
+}
+
+static int sysctl_bpf_stats_enabled;
 #endif
 
 static struct ctl_table kern_table[];
@@ -1393,6 +1422,15 @@ static struct ctl_table kern_table[] = {
 		.extra1		= &zero,
 		.extra2		= &two,
 	},
+	{
+		.procname	= "bpf_stats_enabled",
+		.data		= &sysctl_bpf_stats_enabled,
+		.maxlen		= sizeof(sysctl_bpf_stats_enabled),
+		.mode		= 0644,
+		.proc_handler	= bpf_stats_handler,
+		.extra1		= &zero,
+		.extra2		= &one,
+	},
 #endif
 #if defined(CONFIG_TREE_RCU) || defined(CONFIG_PREEMPT_RCU)
 	{
@@ -1895,6 +1933,16 @@ static struct ctl_table vm_table[] = {
 		.mode		= 0644,
 		.proc_handler	= proc_dointvec_minmax,
 	},
+#endif
+#ifdef CONFIG_PROC_PAGE_MONITOR
+	{
+		.procname	= "smaps_rollup_cache_ms",
+		.data		= &sysctl_smaps_rollup_cache_ms,
+		.maxlen		= sizeof(sysctl_smaps_rollup_cache_ms),
+		.mode		= 0644,
+		.proc_handler	= proc_dointvec_minmax,
+		.extra1		= &zero,
+	},
 #endif
 	{ }
 };
@@ -52,6 +52,9 @@
 #include <linux/delay.h>
 #include <linux/nmi.h>
 #include <linux/kvm_para.h>
+#include <linux/debugfs.h>
+#include <linux/seq_file.h>
+#include <linux/topology.h>
 
 #include "workqueue_internal.h"
 
@@ -261,6 +264,8 @@ struct workqueue_struct {
 	struct workqueue_attrs	*unbound_attrs;	/* PW: only for unbound wqs */
 	struct pool_workqueue	*dfl_pwq;	/* PW: only for unbound wqs */
 
+	unsigned long __percpu	*cpu_wakeups;	/* L: worker wakeups per CPU */
+
 #ifdef CONFIG_SYSFS
 	struct wq_device	*wq_dev;	/* I: for sysfs interface */
 #endif
@@ -826,18 +831,47 @@ static struct worker *first_idle_worker(struct worker_pool *pool)
 	return list_first_entry(&pool->idle_list, struct worker, entry);
 }
 
+/*
+ * Return an idle worker of a prefer_awake pool, preferring one which last
+ * ran on the local CPU or on a CPU that is not idle, so that waking it is
+ * less likely to pull another CPU out of a deep idle state.  Falls back to
+ * the first idle worker.
+ */
+static struct worker *awake_idle_worker(struct worker_pool *pool)
+{
+	int this_cpu = raw_smp_processor_id();
+	struct worker *worker;
+
+	list_for_each_entry(worker, &pool->idle_list, entry) {
+		int cpu = task_cpu(worker->task);
+
+		if (!cpumask_test_cpu(cpu, pool->attrs->cpumask))
+			continue;
+		if (cpu == this_cpu || !idle_cpu(cpu))
+			return worker;
+	}
+
+	return first_idle_worker(pool);
+}
+
 /**
  * wake_up_worker - wake up an idle worker
  * @pool: worker pool to wake worker from
  *
- * Wake up the first idle worker of @pool.
+ * Wake up the first idle worker of @pool, or for a prefer_awake pool an
+ * idle worker that last ran on a CPU which is already awake.
  *
  * CONTEXT:
  * spin_lock_irq(pool->lock).
  */
 static void wake_up_worker(struct worker_pool *pool)
 {
-	struct worker *worker = first_idle_worker(pool);
+	struct worker *worker;
+
+	if (pool->attrs->prefer_awake)
+		worker = awake_idle_worker(pool);
+	else
+		worker = first_idle_worker(pool);
 
 	if (likely(worker))
 		wake_up_process(worker->task);
@@ -2066,6 +2100,12 @@ __acquires(&pool->lock)
 	WARN_ON_ONCE(!(pool->flags & POOL_DISASSOCIATED) &&
 		     raw_smp_processor_id() != pool->cpu);
 
+	/* charge the wakeup to the workqueue of the first work it runs */
+	if (worker->woken) {
+		worker->woken = false;
+		this_cpu_inc(*pwq->wq->cpu_wakeups);
+	}
+
 	/*
 	 * A single work shouldn't be executed concurrently by
 	 * multiple workers on a single cpu.  Check whether anyone is
@@ -2224,6 +2264,7 @@ static int worker_thread(void *__worker)
 	}
 
 	worker_leave_idle(worker);
+	worker->woken = true;
 recheck:
 	/* no more worker necessary? */
 	if (!need_more_worker(pool))
@@ -3199,6 +3240,7 @@ static void copy_workqueue_attrs(struct workqueue_attrs *to,
 	 * get_unbound_pool() explicitly clears ->no_numa after copying.
 	 */
 	to->no_numa = from->no_numa;
+	to->prefer_awake = from->prefer_awake;
 }
 
 /* hash value of the content of @attr */
@@ -3207,6 +3249,7 @@ static u32 wqattrs_hash(const struct workqueue_attrs *attrs)
 	u32 hash = 0;
 
 	hash = jhash_1word(attrs->nice, hash);
+	hash = jhash_1word(attrs->prefer_awake, hash);
 	hash = jhash(cpumask_bits(attrs->cpumask),
 		     BITS_TO_LONGS(nr_cpumask_bits) * sizeof(long), hash);
 	return hash;
@@ -3218,6 +3261,8 @@ static bool wqattrs_equal(const struct workqueue_attrs *a,
 {
 	if (a->nice != b->nice)
 		return false;
+	if (a->prefer_awake != b->prefer_awake)
+		return false;
 	if (!cpumask_equal(a->cpumask, b->cpumask))
 		return false;
 	return true;
@@ -3276,6 +3321,7 @@ static void rcu_free_wq(struct rcu_head *rcu)
 	else
 		free_workqueue_attrs(wq->unbound_attrs);
 
+	free_percpu(wq->cpu_wakeups);
 	kfree(wq->rescuer);
 	kfree(wq);
 }
@@ -4010,6 +4056,10 @@ struct workqueue_struct *__alloc_workqueue_key(const char *fmt,
 			goto err_free_wq;
 	}
 
+	wq->cpu_wakeups = alloc_percpu(unsigned long);
+	if (!wq->cpu_wakeups)
+		goto err_free_wq;
+
 	va_start(args, lock_name);
 	vsnprintf(wq->name, sizeof(wq->name), fmt, args);
 	va_end(args);
@@ -4079,6 +4129,7 @@ struct workqueue_struct *__alloc_workqueue_key(const char *fmt,
 	return wq;
 
 err_free_wq:
+	free_percpu(wq->cpu_wakeups);
 	free_workqueue_attrs(wq->unbound_attrs);
 	kfree(wq);
 	return NULL;
@@ -5242,11 +5293,111 @@ static ssize_t wq_numa_store(struct device *dev, struct device_attribute *attr,
 	return ret ?: count;
 }
 
+/*
+ * "cluster" restricts the workqueue to the CPUs of one cluster.  Reading
+ * it returns the cluster id if the cpumask is exactly one cluster, -1
+ * otherwise.
+ */
+static ssize_t wq_cluster_show(struct device *dev,
+			       struct device_attribute *attr, char *buf)
+{
+	struct workqueue_struct *wq = dev_to_wq(dev);
+	const struct cpumask *mask;
+	int cpu, cluster = -1;
+	int written;
+
+	mutex_lock(&wq->mutex);
+	mask = wq->unbound_attrs->cpumask;
+	cpu = cpumask_first(mask);
+	if (cpu < nr_cpu_ids &&
+	    cpumask_equal(mask, topology_core_cpumask(cpu)))
+		cluster = topology_physical_package_id(cpu);
+	written = scnprintf(buf, PAGE_SIZE, "%d\n", cluster);
+	mutex_unlock(&wq->mutex);
+
+	return written;
+}
+
+static ssize_t wq_cluster_store(struct device *dev,
+				struct device_attribute *attr,
+				const char *buf, size_t count)
+{
+	struct workqueue_struct *wq = dev_to_wq(dev);
+	struct workqueue_attrs *attrs;
+	int cpu, cluster, ret = -ENOMEM;
+
+	if (kstrtoint(buf, 0, &cluster))
+		return -EINVAL;
+
+	apply_wqattrs_lock();
+
+	attrs = wq_sysfs_prep_attrs(wq);
+	if (!attrs)
+		goto out_unlock;
+
+	cpumask_clear(attrs->cpumask);
+	for_each_possible_cpu(cpu)
+		if (topology_physical_package_id(cpu) == cluster)
+			cpumask_set_cpu(cpu, attrs->cpumask);
+
+	ret = -EINVAL;
+	if (!cpumask_empty(attrs->cpumask))
+		ret = apply_workqueue_attrs_locked(wq, attrs);
+
+out_unlock:
+	apply_wqattrs_unlock();
+	free_workqueue_attrs(attrs);
+	return ret ?: count;
+}
+
+static ssize_t wq_prefer_awake_show(struct device *dev,
+				    struct device_attribute *attr, char *buf)
+{
+	struct workqueue_struct *wq = dev_to_wq(dev);
+	int written;
+
+	mutex_lock(&wq->mutex);
+	written = scnprintf(buf, PAGE_SIZE, "%d\n",
+			    wq->unbound_attrs->prefer_awake);
+	mutex_unlock(&wq->mutex);
+
+	return written;
+}
+
+static ssize_t wq_prefer_awake_store(struct device *dev,
+				     struct device_attribute *attr,
+				     const char *buf, size_t count)
+{
+	struct workqueue_struct *wq = dev_to_wq(dev);
+	struct workqueue_attrs *attrs;
+	int v, ret = -ENOMEM;
+
+	apply_wqattrs_lock();
+
+	attrs = wq_sysfs_prep_attrs(wq);
+	if (!attrs)
+		goto out_unlock;
+
+	ret = -EINVAL;
+	if (sscanf(buf, "%d", &v) == 1) {
+		attrs->prefer_awake = !!v;
+		ret = apply_workqueue_attrs_locked(wq, attrs);
+	}
+
+out_unlock:
+	apply_wqattrs_unlock();
+	free_workqueue_attrs(attrs);
+	return ret ?: count;
+}
+
 static struct device_attribute wq_sysfs_unbound_attrs[] = {
 	__ATTR(pool_ids, 0444, wq_pool_ids_show, NULL),
 	__ATTR(nice, 0644, wq_nice_show, wq_nice_store),
 	__ATTR(cpumask, 0644, wq_cpumask_show, wq_cpumask_store),
 	__ATTR(numa, 0644, wq_numa_show, wq_numa_store),
+	__ATTR(cluster, 0644, wq_cluster_show, wq_cluster_store),
+	__ATTR(prefer_awake, 0644, wq_prefer_awake_show,
+	       wq_prefer_awake_store),
 	__ATTR_NULL,
 };
 
@@ -5396,6 +5547,67 @@ static void workqueue_sysfs_unregister(struct workqueue_struct *wq)
 static void workqueue_sysfs_unregister(struct workqueue_struct *wq)	{ }
 #endif	/* CONFIG_SYSFS */
 
+#ifdef CONFIG_DEBUG_FS
+/*
+ * debugfs workqueue/wakeups lists, for every workqueue that has woken a
+ * worker, how many idle workers it woke on each CPU.  A wakeup is charged
+ * to the workqueue of the first work item the woken worker processes.
+ */
+static int wq_wakeups_show(struct seq_file *m, void *v)
+{
+	struct workqueue_struct *wq;
+	int cpu;
+
+	seq_puts(m, "workqueue");
+	for_each_possible_cpu(cpu)
+		seq_printf(m, " cpu%d", cpu);
+	seq_putc(m, '\n');
+
+	mutex_lock(&wq_pool_mutex);
+	list_for_each_entry(wq, &workqueues, list) {
+		unsigned long total = 0;
+
+		for_each_possible_cpu(cpu)
+			total += *per_cpu_ptr(wq->cpu_wakeups, cpu);
+		if (!total)
+			continue;
+
+		seq_printf(m, "%s", wq->name);
+		for_each_possible_cpu(cpu)
+			seq_printf(m, " %lu", *per_cpu_ptr(wq->cpu_wakeups, cpu));
+		seq_putc(m, '\n');
+	}
+	mutex_unlock(&wq_pool_mutex);
+
+	return 0;
+}
+
+static int wq_wakeups_open(struct inode *inode, struct file *file)
+{
+	return single_open(file, wq_wakeups_show, NULL);
+}
+
+static const struct file_operations wq_wakeups_fops = {
+	.open		= wq_wakeups_open,
+	.read		= seq_read,
+	.llseek		= seq_lseek,
+	.release	= single_release,
+};
+
+static int __init wq_debugfs_init(void)
+{
+	struct dentry *dir;
+
+	dir = debugfs_create_dir("workqueue", NULL);
+	if (!dir)
+		return -ENOMEM;
+
+	debugfs_create_file("wakeups", 0444, dir, NULL, &wq_wakeups_fops);
+	return 0;
+}
+late_initcall(wq_debugfs_init);
+#endif	/* CONFIG_DEBUG_FS */
+
 /*
  * Workqueue watchdog.
  *
@@ -44,6 +44,7 @@ struct worker {
 	unsigned long		last_active;	/* L: last active timestamp */
 	unsigned int		flags;		/* X: flags */
 	int			id;		/* I: worker id */
+	bool			woken;		/* L: woken since last work */
 
 	/*
 	 * Opaque string set with work_set_desc().  Printed out with task
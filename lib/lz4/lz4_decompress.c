@@ -280,7 +280,7 @@ static FORCE_INLINE int LZ4_decompress_generic(
 				break;
 		} else {
 			/* may overwrite up to WILDCOPYLENGTH beyond cpy */
-			LZ4_wildCopy(op, ip, cpy);
+			LZ4_wildCopy16(op, ip, cpy);
 			ip += length;
 			op = cpy;
 		}
@@ -437,8 +437,13 @@ static FORCE_INLINE int LZ4_decompress_generic(
 				*op++ = *match++;
 		} else {
 			LZ4_copy8(op, match);
-			if (length > 16)
-				LZ4_wildCopy(op + 8, match + 8, cpy);
+			if (length > 16) {
+				/* wide steps need the match 16 bytes behind */
+				if (op - match >= 16)
+					LZ4_wildCopy16(op + 8, match + 8, cpy);
+				else
+					LZ4_wildCopy(op + 8, match + 8, cpy);
+			}
 		}
 		op = cpy; /* wildcopy correction */
 	}
@@ -61,6 +61,16 @@ typedef uintptr_t uptrval;
 #define LZ4_ARCH64 0
 #endif
 
+/*
+ * Where unaligned 64-bit accesses are cheap (arm64 LDP/STP), copy 16 bytes
+ * per step in the non-overlapping copies of the decoder.
+ */
+#if LZ4_ARCH64 && defined(CONFIG_HAVE_EFFICIENT_UNALIGNED_ACCESS)
+#define LZ4_WIDE_COPY 1
+#else
+#define LZ4_WIDE_COPY 0
+#endif
+
 #if defined(__LITTLE_ENDIAN)
 #define LZ4_LITTLE_ENDIAN 1
 #else
@@ -181,6 +191,48 @@ static FORCE_INLINE void LZ4_wildCopy(void *dstPtr,
 	} while (d < e);
 }
 
+#if LZ4_WIDE_COPY
+/*
+ * Both words are loaded before either is stored so that the compiler can
+ * pair them; src and dst must not overlap within 16 bytes.
+ */
+static FORCE_INLINE void LZ4_copy16(void *dst, const void *src)
+{
+	U64 a = get_unaligned((const U64 *)src);
+	U64 b = get_unaligned((const U64 *)src + 1);
+
+	put_unaligned(a, (U64 *)dst);
+	put_unaligned(b, (U64 *)dst + 1);
+}
+
+/*
+ * LZ4_wildCopy() for buffers at least 16 bytes apart. It keeps the same
+ * "up to 7 bytes beyond dstEnd" contract: 16 byte steps are only taken
+ * while more than 8 bytes are left, the tail uses the 8 byte copy.
+ */
+static FORCE_INLINE void LZ4_wildCopy16(void *dstPtr,
+	const void *srcPtr, void *dstEnd)
+{
+	BYTE *d = (BYTE *)dstPtr;
+	const BYTE *s = (const BYTE *)srcPtr;
+	BYTE *const e = (BYTE *)dstEnd;
+
+	while (e - d > 8) {
+		LZ4_copy16(d, s);
+		d += 16;
+		s += 16;
+	}
+
+	do {
+		LZ4_copy8(d, s);
+		d += 8;
+		s += 8;
+	} while (d < e);
+}
+#else
+#define LZ4_wildCopy16 LZ4_wildCopy
+#endif
+
 static FORCE_INLINE unsigned int LZ4_NbCommonBytes(register size_t val)
 {
 #if LZ4_LITTLE_ENDIAN
@@ -0,0 +1,290 @@
+/*
+ * Microbenchmarks for in-kernel hot paths
+ *
+ * Times the per-page work done on the zram store and load paths and the
+ * per-block work done by dm-verity, each in a tight loop on a single CPU,
+ * and reports one line of key=value pairs per benchmark so that runs can
+ * be compared between kernels:
+ *
+ *   bench=zram_compress alg=lzo cpu=0 khz=1804800 iters=10000 bytes=4096
+ *   p50_ns=... p99_ns=... max_ns=... kb_per_sec=...
+ *
+ * The khz field is the frequency of the CPU the benchmark ran on as seen
+ * at the end of the run; the numbers are only comparable when it is
+ * pinned, see tools/testing/selftests/hotpath.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 and
+ * only version 2 as published by the Free Software Foundation.
+ */
+
+#define pr_fmt(fmt) KBUILD_MODNAME ": " fmt
+
+#include <linux/init.h>
+#include <linux/module.h>
+#include <linux/moduleparam.h>
+#include <linux/crypto.h>
+#include <crypto/hash.h>
+#include <crypto/sha.h>
+#include <linux/cpufreq.h>
+#include <linux/workqueue.h>
+#include <linux/random.h>
+#include <linux/sched.h>
+#include <linux/slab.h>
+#include <linux/sort.h>
+#include <linux/vmalloc.h>
+#include <linux/ktime.h>
+#include <linux/log2.h>
+
+#define HOTPATH_SALT_SIZE	32
+#define HOTPATH_MAX_DIGEST	SHA512_DIGEST_SIZE
+#define HOTPATH_MAX_ITERATIONS	1000000
+
+static unsigned int iterations = 10000;
+module_param(iterations, uint, 0);
+MODULE_PARM_DESC(iterations, "Operations timed per benchmark");
+
+static unsigned int cpu;
+module_param(cpu, uint, 0);
+MODULE_PARM_DESC(cpu, "CPU the benchmarks run on");
+
+static char comp[CRYPTO_MAX_ALG_NAME] = "lzo";
+module_param_string(comp, comp, sizeof(comp), 0);
+MODULE_PARM_DESC(comp, "Compression algorithm, as for zram comp_algorithm");
+
+static char hash[CRYPTO_MAX_ALG_NAME] = "sha256";
+module_param_string(hash, hash, sizeof(hash), 0);
+MODULE_PARM_DESC(hash, "Hash algorithm, as in the dm-verity table");
+
+static unsigned int block_size = 4096;
+module_param(block_size, uint, 0);
+MODULE_PARM_DESC(block_size, "dm-verity data block size");
+
+struct hotpath_comp_ctx {
+	struct crypto_comp *tfm;
+	u8 *src;
+	u8 *dst;
+	u8 *out;
+	unsigned int clen;
+};
+
+struct hotpath_hash_ctx {
+	struct shash_desc *desc;
+	u8 *block;
+	u8 salt[HOTPATH_SALT_SIZE];
+	u8 digest[HOTPATH_MAX_DIGEST];
+};
+
+static int hotpath_cmp_u64(const void *a, const void *b)
+{
+	u64 x = *(const u64 *)a, y = *(const u64 *)b;
+
+	return x < y ? -1 : x > y;
+}
+
+/*
+ * Runs @op @iterations times and prints the result line. @ns has room
+ * for one sample per iteration.
+ */
+static int hotpath_run(const char *bench, const char *alg,
+		       int (*op)(void *ctx), void *ctx, unsigned int bytes,
+		       u64 *ns)
+{
+	u64 start, total = 0;
+	unsigned int i;
+	int ret;
+
+	for (i = 0; i < iterations; i++) {
+		start = ktime_get_ns();
+		ret = op(ctx);
+		ns[i] = ktime_get_ns() - start;
+		if (ret) {
+			pr_err("bench=%s alg=%s failed at %u: %d\n",
+			       bench, alg, i, ret);
+			return ret;
+		}
+		total += ns[i];
+		cond_resched();
+	}
+
+	sort(ns, iterations, sizeof(*ns), hotpath_cmp_u64, NULL);
+	pr_info("bench=%s alg=%s cpu=%u khz=%u iters=%u bytes=%u p50_ns=%llu p99_ns=%llu max_ns=%llu kb_per_sec=%llu\n",
+		bench, alg, cpu, cpufreq_quick_get(cpu), iterations, bytes,
+		ns[div_u64((u64)(iterations - 1) * 500, 1000)],
+		ns[div_u64((u64)(iterations - 1) * 990, 1000)],
+		ns[iterations - 1],
+		total ? div64_u64((u64)bytes * iterations * NSEC_PER_SEC,
+				  total * 1024) : 0);
+
+	return 0;
+}
+
+/*
+ * A page that compresses about as well as typical anonymous memory: a
+ * random quarter, the rest a short repeating pattern.
+ */
+static void hotpath_fill(u8 *buf, size_t len)
+{
+	size_t i;
+
+	prandom_bytes(buf, len / 4);
+	for (i = len / 4; i < len; i++)
+		buf[i] = (i % 61) ? (u8)(i >> 3) : 0;
+}
+
+/* zram_compress(): the destination may grow to two pages */
+static int hotpath_compress(void *data)
+{
+	struct hotpath_comp_ctx *ctx = data;
+
+	ctx->clen = PAGE_SIZE * 2;
+	return crypto_comp_compress(ctx->tfm, ctx->src, PAGE_SIZE,
+				    ctx->dst, &ctx->clen);
+}
+
+static int hotpath_decompress(void *data)
+{
+	struct hotpath_comp_ctx *ctx = data;
+	unsigned int dlen = PAGE_SIZE;
+
+	return crypto_comp_decompress(ctx->tfm, ctx->dst, ctx->clen,
+				      ctx->out, &dlen);
+}
+
+static int hotpath_bench_comp(u64 *ns)
+{
+	struct hotpath_comp_ctx ctx = { };
+	int ret = -ENOMEM;
+
+	ctx.tfm = crypto_alloc_comp(comp, 0, 0);
+	if (IS_ERR(ctx.tfm)) {
+		pr_err("bench=zram alg=%s unavailable: %ld\n", comp,
+		       PTR_ERR(ctx.tfm));
+		return PTR_ERR(ctx.tfm);
+	}
+
+	ctx.src = kmalloc(PAGE_SIZE, GFP_KERNEL);
+	ctx.dst = kmalloc(PAGE_SIZE * 2, GFP_KERNEL);
+	ctx.out = kmalloc(PAGE_SIZE, GFP_KERNEL);
+	if (!ctx.src || !ctx.dst || !ctx.out)
+		goto out;
+
+	hotpath_fill(ctx.src, PAGE_SIZE);
+
+	ret = hotpath_run("zram_compress", comp, hotpath_compress, &ctx,
+			  PAGE_SIZE, ns);
+	if (ret)
+		goto out;
+
+	ret = hotpath_run("zram_decompress", comp, hotpath_decompress, &ctx,
+			  PAGE_SIZE, ns);
+	if (ret)
+		goto out;
+
+	if (memcmp(ctx.src, ctx.out, PAGE_SIZE)) {
+		pr_err("bench=zram_decompress alg=%s output mismatch\n", comp);
+		ret = -EINVAL;
+	}
+out:
+	kfree(ctx.out);
+	kfree(ctx.dst);
+	kfree(ctx.src);
+	crypto_free_comp(ctx.tfm);
+	return ret;
+}
+
+/* verity_hash() with a salted version 1 hash, salt first */
+static int hotpath_hash(void *data)
+{
+	struct hotpath_hash_ctx *ctx = data;
+	int ret;
+
+	ret = crypto_shash_init(ctx->desc);
+	if (!ret)
+		ret = crypto_shash_update(ctx->desc, ctx->salt,
+					  sizeof(ctx->salt));
+	if (!ret)
+		ret = crypto_shash_update(ctx->desc, ctx->block, block_size);
+	if (!ret)
+		ret = crypto_shash_final(ctx->desc, ctx->digest);
+
+	return ret;
+}
+
+static int hotpath_bench_hash(u64 *ns)
+{
+	struct hotpath_hash_ctx ctx = { };
+	struct crypto_shash *tfm;
+	int ret = -ENOMEM;
+
+	tfm = crypto_alloc_shash(hash, 0, 0);
+	if (IS_ERR(tfm)) {
+		pr_err("bench=verity_hash alg=%s unavailable: %ld\n", hash,
+		       PTR_ERR(tfm));
+		return PTR_ERR(tfm);
+	}
+
+	if (crypto_shash_digestsize(tfm) > sizeof(ctx.digest)) {
+		ret = -EINVAL;
+		goto out;
+	}
+
+	ctx.desc = kmalloc(sizeof(*ctx.desc) + crypto_shash_descsize(tfm),
+			   GFP_KERNEL);
+	ctx.block = kmalloc(block_size, GFP_KERNEL);
+	if (!ctx.desc || !ctx.block)
+		goto out;
+
+	ctx.desc->tfm = tfm;
+	ctx.desc->flags = 0;
+	prandom_bytes(ctx.salt, sizeof(ctx.salt));
+	prandom_bytes(ctx.block, block_size);
+
+	ret = hotpath_run("verity_hash", hash, hotpath_hash, &ctx,
+			  block_size, ns);
+out:
+	kfree(ctx.block);
+	kfree(ctx.desc);
+	crypto_free_shash(tfm);
+	return ret;
+}
+
+static long hotpath_bench(void *unused)
+{
+	u64 *ns;
+	int ret;
+
+	ns = vmalloc(sizeof(*ns) * iterations);
+	if (!ns)
+		return -ENOMEM;
+
+	ret = hotpath_bench_comp(ns);
+	if (!ret)
+		ret = hotpath_bench_hash(ns);
+
+	vfree(ns);
+	return ret;
+}
+
+static int __init test_hotpath_init(void)
+{
+	if (!iterations || iterations > HOTPATH_MAX_ITERATIONS ||
+	    !block_size || block_size > PAGE_SIZE ||
+	    !is_power_of_2(block_size))
+		return -EINVAL;
+
+	if (cpu >= nr_cpu_ids || !cpu_online(cpu))
+		return -ENODEV;
+
+	return work_on_cpu(cpu, hotpath_bench, NULL);
+}
+
+static void __exit test_hotpath_exit(void)
+{
+}
+
+module_init(test_hotpath_init);
+module_exit(test_hotpath_exit);
+
+MODULE_DESCRIPTION("Microbenchmarks for zram and dm-verity hot paths");
+MODULE_LICENSE("GPL v2");
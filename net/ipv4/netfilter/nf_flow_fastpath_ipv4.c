@@ -0,0 +1,734 @@
+/*
+ * Software fast path for forwarded IPv4 conntrack flows
+ *
+ * Once conntrack has seen a forwarded TCP connection reach ESTABLISHED,
+ * or a UDP flow become assured, the packet leaving the FORWARD hook is
+ * used to learn a flow entry: the original tuple and input device as the
+ * key, and the NAT rewrite and route it received as the result. Later
+ * packets of the flow are matched in a per-CPU hash table ahead of
+ * defragmentation and conntrack in PRE_ROUTING, rewritten and handed to
+ * the neighbour layer directly, skipping the rest of the netfilter hooks
+ * and the routing lookup.
+ *
+ * Anything the cached result cannot express goes down the normal path:
+ * fragments, IP options, TCP SYN, FIN and RST (the latter two also drop
+ * the flow), TTL expiry, packets over the path MTU, and flows whose route
+ * went stale or whose conntrack entry is dying. Idle flows are aged out
+ * by a periodic pass, which also keeps the conntrack entries of active
+ * flows from timing out while their packets no longer reach conntrack.
+ *
+ * Offloaded packets are not seen by the FORWARD and POST_ROUTING chains,
+ * so neither their rules nor their counters apply to them. The fast path
+ * is therefore disabled until it is enabled through the "enabled" module
+ * parameter, which is meant to be done by the tethering controller when
+ * hardware offload is not available and the ruleset allows it.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation.
+ */
+
+#define pr_fmt(fmt) KBUILD_MODNAME ": " fmt
+
+#include <linux/types.h>
+#include <linux/ip.h>
+#include <linux/tcp.h>
+#include <linux/udp.h>
+#include <linux/jhash.h>
+#include <linux/module.h>
+#include <linux/moduleparam.h>
+#include <linux/netdevice.h>
+#include <linux/netfilter.h>
+#include <linux/netfilter_ipv4.h>
+#include <linux/percpu.h>
+#include <linux/proc_fs.h>
+#include <linux/random.h>
+#include <linux/seq_file.h>
+#include <linux/skbuff.h>
+#include <linux/slab.h>
+#include <linux/workqueue.h>
+#include <net/checksum.h>
+#include <net/dst.h>
+#include <net/ip.h>
+#include <net/neighbour.h>
+#include <net/route.h>
+#include <net/netfilter/nf_conntrack.h>
+#include <net/netfilter/nf_conntrack_helper.h>
+
+#define NF_FP_HASH_BITS		10
+#define NF_FP_HASH_SIZE		(1 << NF_FP_HASH_BITS)
+
+struct nf_fp_tuple {
+	__be32			saddr;
+	__be32			daddr;
+	__be16			sport;
+	__be16			dport;
+	int			iif;
+	u8			proto;
+};
+
+struct nf_fp_flow {
+	struct hlist_node	node;
+	struct nf_fp_tuple	tuple;
+	struct net		*net;
+	struct nf_conn		*ct;
+	struct dst_entry	*dst;
+	__be32			nat_saddr;
+	__be32			nat_daddr;
+	__be16			nat_sport;
+	__be16			nat_dport;
+	unsigned long		last_used;
+	struct rcu_head		rcu;
+};
+
+struct nf_fp_stats {
+	u64			hits;
+	u64			misses;
+	u64			learned;
+	u64			expired;
+	u64			teardown;
+	u64			full;
+};
+
+/*
+ * One table per CPU: a flow is learned on the CPU its packets are
+ * received on, so lookups and inserts on the fast path only contend with
+ * the aging pass. Lookups run under RCU.
+ */
+struct nf_fp_cpu {
+	spinlock_t		lock;
+	unsigned int		count;
+	struct hlist_head	*hash;
+	struct nf_fp_stats	stats;
+};
+
+static bool nf_fp_enabled;
+static unsigned int nf_fp_timeout_ms = 30000;
+static unsigned int nf_fp_max_flows = 4096;
+
+module_param_named(timeout_ms, nf_fp_timeout_ms, uint, 0644);
+MODULE_PARM_DESC(timeout_ms, "Idle time after which a flow is aged out");
+module_param_named(max_flows, nf_fp_max_flows, uint, 0644);
+MODULE_PARM_DESC(max_flows, "Maximum number of flows per CPU");
+
+static struct nf_fp_cpu __percpu *nf_fp_pcpu;
+static struct kmem_cache *nf_fp_cachep __read_mostly;
+static u32 nf_fp_seed __read_mostly;
+
+static void nf_fp_gc_work(struct work_struct *work);
+static DECLARE_DELAYED_WORK(nf_fp_gc, nf_fp_gc_work);
+
+static unsigned long nf_fp_timeout(void)
+{
+	return msecs_to_jiffies(max(nf_fp_timeout_ms, 1000U));
+}
+
+static u32 nf_fp_hash(const struct nf_fp_tuple *t)
+{
+	return jhash_3words((__force u32)t->saddr,
+			    (__force u32)t->daddr ^ t->iif,
+			    ((__force u32)t->sport << 16 |
+			     (__force u32)t->dport) ^ t->proto,
+			    nf_fp_seed) & (NF_FP_HASH_SIZE - 1);
+}
+
+static bool nf_fp_tuple_equal(const struct nf_fp_tuple *a,
+			      const struct nf_fp_tuple *b)
+{
+	return a->saddr == b->saddr && a->daddr == b->daddr &&
+	       a->sport == b->sport && a->dport == b->dport &&
+	       a->iif == b->iif && a->proto == b->proto;
+}
+
+static struct nf_fp_flow *nf_fp_lookup(struct nf_fp_cpu *fc,
+				       const struct nf_fp_tuple *t,
+				       const struct net *net)
+{
+	struct nf_fp_flow *flow;
+
+	hlist_for_each_entry_rcu(flow, &fc->hash[nf_fp_hash(t)], node) {
+		if (nf_fp_tuple_equal(&flow->tuple, t) &&
+		    net_eq(flow->net, net))
+			return flow;
+	}
+
+	return NULL;
+}
+
+static void nf_fp_flow_free_rcu(struct rcu_head *head)
+{
+	struct nf_fp_flow *flow = container_of(head, struct nf_fp_flow, rcu);
+
+	dst_release(flow->dst);
+	nf_ct_put(flow->ct);
+	kmem_cache_free(nf_fp_cachep, flow);
+}
+
+/* Called with fc->lock held */
+static void nf_fp_flow_del(struct nf_fp_cpu *fc, struct nf_fp_flow *flow)
+{
+	hlist_del_init_rcu(&flow->node);
+	fc->count--;
+	call_rcu(&flow->rcu, nf_fp_flow_free_rcu);
+}
+
+static void nf_fp_teardown(struct nf_fp_cpu *fc, struct nf_fp_flow *flow)
+{
+	spin_lock_bh(&fc->lock);
+	/* The aging pass may have beaten us to it */
+	if (!hlist_unhashed(&flow->node)) {
+		nf_fp_flow_del(fc, flow);
+		fc->stats.teardown++;
+	}
+	spin_unlock_bh(&fc->lock);
+}
+
+/*
+ * Whether the conntrack entry can be handled without conntrack seeing its
+ * packets: no helper or sequence adjustment that needs every packet, and
+ * a state that does not change until the end of the connection.
+ */
+static bool nf_fp_ct_eligible(const struct nf_conn *ct)
+{
+	if (nf_ct_l3num(ct) != AF_INET || !nf_ct_is_confirmed(ct) ||
+	    nf_ct_is_dying(ct) || nfct_help(ct) ||
+	    test_bit(IPS_SEQ_ADJUST_BIT, &ct->status))
+		return false;
+
+	switch (nf_ct_protonum(ct)) {
+	case IPPROTO_TCP:
+		return READ_ONCE(ct->proto.tcp.state) ==
+			TCP_CONNTRACK_ESTABLISHED;
+	case IPPROTO_UDP:
+		return test_bit(IPS_ASSURED_BIT, &ct->status);
+	}
+
+	return false;
+}
+
+/*
+ * Conntrack keeps tracking the TCP window from the packets it still sees,
+ * which are far apart once the flow is offloaded. Stop it from marking
+ * them invalid, the way conntrack itself does when picking up a
+ * connection in the middle.
+ */
+static void nf_fp_ct_tcp_liberal(struct nf_conn *ct)
+{
+	spin_lock_bh(&ct->lock);
+	ct->proto.tcp.seen[0].flags |= IP_CT_TCP_FLAG_BE_LIBERAL;
+	ct->proto.tcp.seen[1].flags |= IP_CT_TCP_FLAG_BE_LIBERAL;
+	spin_unlock_bh(&ct->lock);
+}
+
+/*
+ * Make sure the conntrack entry outlives the flow by at least one timeout.
+ * This only ever extends ct->timeout, so the longer timeouts conntrack
+ * sets for established TCP are left alone.
+ */
+static void nf_fp_ct_refresh(struct nf_conn *ct)
+{
+	u32 want = nfct_time_stamp + nf_fp_timeout() * 2;
+
+	if (test_bit(IPS_FIXED_TIMEOUT_BIT, &ct->status))
+		return;
+
+	if ((s32)(want - READ_ONCE(ct->timeout)) > 0)
+		WRITE_ONCE(ct->timeout, want);
+}
+
+static void nf_fp_learn_flow(struct net *net, struct nf_conn *ct,
+			     enum ip_conntrack_dir dir, int iif,
+			     struct dst_entry *dst)
+{
+	const struct nf_conntrack_tuple *orig = &ct->tuplehash[dir].tuple;
+	const struct nf_conntrack_tuple *repl = &ct->tuplehash[!dir].tuple;
+	struct nf_fp_cpu *fc = raw_cpu_ptr(nf_fp_pcpu);
+	struct nf_fp_tuple t = {
+		.saddr	= orig->src.u3.ip,
+		.daddr	= orig->dst.u3.ip,
+		.sport	= orig->src.u.all,
+		.dport	= orig->dst.u.all,
+		.iif	= iif,
+		.proto	= orig->dst.protonum,
+	};
+	struct nf_fp_flow *flow;
+
+	/* Cheap unlocked check, most packets of a known flow end here */
+	if (nf_fp_lookup(fc, &t, net))
+		return;
+
+	flow = kmem_cache_alloc(nf_fp_cachep, GFP_ATOMIC);
+	if (!flow)
+		return;
+
+	flow->tuple = t;
+	flow->net = net;
+	flow->ct = ct;
+	flow->dst = dst;
+	/* The reply tuple holds the addresses the packet leaves with */
+	flow->nat_saddr = repl->dst.u3.ip;
+	flow->nat_daddr = repl->src.u3.ip;
+	flow->nat_sport = repl->dst.u.all;
+	flow->nat_dport = repl->src.u.all;
+	flow->last_used = jiffies;
+
+	if (t.proto == IPPROTO_TCP)
+		nf_fp_ct_tcp_liberal(ct);
+
+	spin_lock_bh(&fc->lock);
+	if (fc->count >= nf_fp_max_flows) {
+		fc->stats.full++;
+		goto out_free;
+	}
+	if (nf_fp_lookup(fc, &t, net))
+		goto out_free;
+
+	nf_conntrack_get(&ct->ct_general);
+	dst_hold(dst);
+	hlist_add_head_rcu(&flow->node, &fc->hash[nf_fp_hash(&t)]);
+	fc->count++;
+	fc->stats.learned++;
+	spin_unlock_bh(&fc->lock);
+	return;
+
+out_free:
+	spin_unlock_bh(&fc->lock);
+	kmem_cache_free(nf_fp_cachep, flow);
+}
+
+static unsigned int nf_fp_learn(void *priv, struct sk_buff *skb,
+				const struct nf_hook_state *state)
+{
+	enum ip_conntrack_info ctinfo;
+	struct dst_entry *dst;
+	struct nf_conn *ct;
+
+	if (!READ_ONCE(nf_fp_enabled))
+		return NF_ACCEPT;
+
+	ct = nf_ct_get(skb, &ctinfo);
+	if (!ct || (ctinfo != IP_CT_ESTABLISHED &&
+		    ctinfo != IP_CT_ESTABLISHED_REPLY))
+		return NF_ACCEPT;
+
+	if (ip_hdr(skb)->ihl != 5 || !nf_fp_ct_eligible(ct))
+		return NF_ACCEPT;
+
+	dst = skb_dst(skb);
+	if (!dst || dst->xfrm || dst->dev != state->out ||
+	    ((struct rtable *)dst)->rt_type != RTN_UNICAST ||
+	    (IPCB(skb)->flags & IPSKB_DOREDIRECT))
+		return NF_ACCEPT;
+
+#ifdef CONFIG_XFRM
+	if (state->net->xfrm.policy_count[XFRM_POLICY_FWD])
+		return NF_ACCEPT;
+#endif
+
+	nf_fp_learn_flow(state->net, ct, CTINFO2DIR(ctinfo),
+			 state->in->ifindex, dst);
+	return NF_ACCEPT;
+}
+
+static void nf_fp_nat(struct sk_buff *skb, struct iphdr *iph, __be16 *ports,
+		      const struct nf_fp_flow *flow)
+{
+	__sum16 *check = NULL;
+
+	if (iph->protocol == IPPROTO_TCP) {
+		check = &((struct tcphdr *)ports)->check;
+	} else {
+		struct udphdr *uh = (struct udphdr *)ports;
+
+		if (uh->check || skb->ip_summed == CHECKSUM_PARTIAL)
+			check = &uh->check;
+	}
+
+	if (iph->saddr != flow->nat_saddr) {
+		if (check)
+			inet_proto_csum_replace4(check, skb, iph->saddr,
+						 flow->nat_saddr, true);
+		csum_replace4(&iph->check, iph->saddr, flow->nat_saddr);
+		iph->saddr = flow->nat_saddr;
+	}
+	if (iph->daddr != flow->nat_daddr) {
+		if (check)
+			inet_proto_csum_replace4(check, skb, iph->daddr,
+						 flow->nat_daddr, true);
+		csum_replace4(&iph->check, iph->daddr, flow->nat_daddr);
+		iph->daddr = flow->nat_daddr;
+	}
+	if (ports[0] != flow->nat_sport) {
+		if (check)
+			inet_proto_csum_replace2(check, skb, ports[0],
+						 flow->nat_sport, false);
+		ports[0] = flow->nat_sport;
+	}
+	if (ports[1] != flow->nat_dport) {
+		if (check)
+			inet_proto_csum_replace2(check, skb, ports[1],
+						 flow->nat_dport, false);
+		ports[1] = flow->nat_dport;
+	}
+
+	if (check && iph->protocol == IPPROTO_UDP && !*check)
+		*check = CSUM_MANGLED_0;
+}
+
+static unsigned int nf_fp_ingress(void *priv, struct sk_buff *skb,
+				  const struct nf_hook_state *state)
+{
+	struct nf_fp_cpu *fc = raw_cpu_ptr(nf_fp_pcpu);
+	struct nf_fp_flow *flow;
+	struct nf_fp_tuple t;
+	struct dst_entry *dst;
+	unsigned int thoff, hdrsize, mtu;
+	struct iphdr *iph;
+	__be16 *ports;
+	__be32 nexthop;
+
+	if (!READ_ONCE(nf_fp_enabled) || skb->pkt_type != PACKET_HOST ||
+	    skb->nfct)
+		return NF_ACCEPT;
+
+	iph = ip_hdr(skb);
+	if (iph->ihl != 5 || ip_is_fragment(iph))
+		return NF_ACCEPT;
+
+	switch (iph->protocol) {
+	case IPPROTO_TCP:
+		hdrsize = sizeof(struct tcphdr);
+		break;
+	case IPPROTO_UDP:
+		hdrsize = sizeof(struct udphdr);
+		break;
+	default:
+		return NF_ACCEPT;
+	}
+
+	thoff = sizeof(*iph);
+	if (!pskb_may_pull(skb, thoff + hdrsize))
+		return NF_ACCEPT;
+
+	iph = ip_hdr(skb);
+	ports = (__be16 *)(skb_network_header(skb) + thoff);
+	t.saddr = iph->saddr;
+	t.daddr = iph->daddr;
+	t.sport = ports[0];
+	t.dport = ports[1];
+	t.iif = state->in->ifindex;
+	t.proto = iph->protocol;
+
+	flow = nf_fp_lookup(fc, &t, state->net);
+	if (!flow) {
+		this_cpu_inc(nf_fp_pcpu->stats.misses);
+		return NF_ACCEPT;
+	}
+
+	if (iph->protocol == IPPROTO_TCP) {
+		struct tcphdr *th = (struct tcphdr *)ports;
+
+		if (th->fin || th->rst) {
+			nf_fp_teardown(fc, flow);
+			return NF_ACCEPT;
+		}
+		if (th->syn)
+			return NF_ACCEPT;
+	}
+
+	dst = flow->dst;
+	if (nf_ct_is_dying(flow->ct) || !dst_check(dst, 0)) {
+		nf_fp_teardown(fc, flow);
+		return NF_ACCEPT;
+	}
+
+	/* Let ip_forward() send the ICMP errors */
+	mtu = dst_mtu(dst);
+	if (iph->ttl <= 1 ||
+	    (skb->len > mtu &&
+	     !(skb_is_gso(skb) && skb_gso_validate_mtu(skb, mtu))))
+		return NF_ACCEPT;
+
+	if (skb_headroom(skb) < LL_RESERVED_SPACE(dst->dev) ||
+	    skb_ensure_writable(skb, thoff + hdrsize))
+		return NF_ACCEPT;
+
+	iph = ip_hdr(skb);
+	ports = (__be16 *)(skb_network_header(skb) + thoff);
+	nf_fp_nat(skb, iph, ports, flow);
+	ip_decrease_ttl(iph);
+
+	if (flow->last_used != jiffies)
+		WRITE_ONCE(flow->last_used, jiffies);
+	this_cpu_inc(nf_fp_pcpu->stats.hits);
+
+	skb_forward_csum(skb);
+	skb->priority = rt_tos2priority(iph->tos);
+	IPCB(skb)->flags |= IPSKB_FORWARDED;
+	skb_dst_drop(skb);
+	skb_dst_set(skb, dst_clone(dst));
+	skb->dev = dst->dev;
+
+	nexthop = rt_nexthop((struct rtable *)dst, iph->daddr);
+	neigh_xmit(NEIGH_ARP_TABLE, dst->dev, &nexthop, skb);
+
+	return NF_STOLEN;
+}
+
+static struct nf_hook_ops nf_fp_ops[] __read_mostly = {
+	{
+		.hook		= nf_fp_ingress,
+		.pf		= NFPROTO_IPV4,
+		.hooknum	= NF_INET_PRE_ROUTING,
+		.priority	= NF_IP_PRI_CONNTRACK_DEFRAG - 1,
+	},
+	{
+		.hook		= nf_fp_learn,
+		.pf		= NFPROTO_IPV4,
+		.hooknum	= NF_INET_FORWARD,
+		.priority	= NF_IP_PRI_LAST,
+	},
+};
+
+/*
+ * Removes the flows @match returns true for, from the tables of all CPUs.
+ * @match is called with the lock of the table the flow is in held.
+ * Returns the number of flows removed.
+ */
+static unsigned int nf_fp_flush(bool (*match)(struct nf_fp_cpu *fc,
+					      struct nf_fp_flow *flow,
+					      void *data),
+				void *data)
+{
+	unsigned int i, removed = 0;
+	struct nf_fp_flow *flow;
+	struct hlist_node *n;
+	int cpu;
+
+	for_each_possible_cpu(cpu) {
+		struct nf_fp_cpu *fc = per_cpu_ptr(nf_fp_pcpu, cpu);
+
+		spin_lock_bh(&fc->lock);
+		for (i = 0; fc->count && i < NF_FP_HASH_SIZE; i++) {
+			hlist_for_each_entry_safe(flow, n, &fc->hash[i], node) {
+				if (!match(fc, flow, data))
+					continue;
+				nf_fp_flow_del(fc, flow);
+				removed++;
+			}
+		}
+		spin_unlock_bh(&fc->lock);
+	}
+
+	return removed;
+}
+
+static bool nf_fp_match_all(struct nf_fp_cpu *fc, struct nf_fp_flow *flow,
+			    void *data)
+{
+	return true;
+}
+
+/*
+ * Ages out idle flows and flows conntrack no longer wants offloaded, and
+ * refreshes the conntrack entries of the others.
+ */
+static bool nf_fp_match_stale(struct nf_fp_cpu *fc, struct nf_fp_flow *flow,
+			      void *data)
+{
+	struct nf_conn *ct = flow->ct;
+
+	if (time_after(jiffies, READ_ONCE(flow->last_used) + nf_fp_timeout()) ||
+	    nf_ct_is_expired(ct) || !nf_fp_ct_eligible(ct)) {
+		fc->stats.expired++;
+		return true;
+	}
+
+	nf_fp_ct_refresh(ct);
+	return false;
+}
+
+static void nf_fp_gc_work(struct work_struct *work)
+{
+	nf_fp_flush(nf_fp_match_stale, NULL);
+
+	if (READ_ONCE(nf_fp_enabled))
+		queue_delayed_work(system_power_efficient_wq, &nf_fp_gc, HZ);
+}
+
+static bool nf_fp_match_dev(struct nf_fp_cpu *fc, struct nf_fp_flow *flow,
+			    void *data)
+{
+	struct net_device *dev = data;
+
+	return flow->dst->dev == dev ||
+	       (flow->tuple.iif == dev->ifindex &&
+		net_eq(flow->net, dev_net(dev)));
+}
+
+/* The cached routes hold references to the devices they point to */
+static int nf_fp_netdev_event(struct notifier_block *this,
+			      unsigned long event, void *ptr)
+{
+	struct net_device *dev = netdev_notifier_info_to_dev(ptr);
+
+	if (event == NETDEV_DOWN || event == NETDEV_UNREGISTER)
+		nf_fp_flush(nf_fp_match_dev, dev);
+
+	return NOTIFY_DONE;
+}
+
+static struct notifier_block nf_fp_netdev_notifier = {
+	.notifier_call	= nf_fp_netdev_event,
+};
+
+static int nf_fp_enabled_set(const char *val, const struct kernel_param *kp)
+{
+	int ret;
+
+	ret = param_set_bool(val, kp);
+	if (ret)
+		return ret;
+
+	if (nf_fp_enabled)
+		mod_delayed_work(system_power_efficient_wq, &nf_fp_gc, HZ);
+	else
+		nf_fp_flush(nf_fp_match_all, NULL);
+
+	return 0;
+}
+
+static const struct kernel_param_ops nf_fp_enabled_ops = {
+	.set = nf_fp_enabled_set,
+	.get = param_get_bool,
+};
+module_param_cb(enabled, &nf_fp_enabled_ops, &nf_fp_enabled, 0644);
+MODULE_PARM_DESC(enabled, "Offload established forwarded flows");
+
+static int nf_fp_stats_show(struct seq_file *m, void *v)
+{
+	struct nf_fp_stats sum = { };
+	unsigned int flows = 0;
+	u64 lookups;
+	int cpu;
+
+	seq_puts(m, "cpu flows hits misses learned expired teardown full\n");
+	for_each_possible_cpu(cpu) {
+		const struct nf_fp_cpu *fc = per_cpu_ptr(nf_fp_pcpu, cpu);
+		const struct nf_fp_stats *s = &fc->stats;
+
+		seq_printf(m, "%d %u %llu %llu %llu %llu %llu %llu\n", cpu,
+			   READ_ONCE(fc->count), s->hits, s->misses,
+			   s->learned, s->expired, s->teardown, s->full);
+		flows += READ_ONCE(fc->count);
+		sum.hits += s->hits;
+		sum.misses += s->misses;
+		sum.learned += s->learned;
+		sum.expired += s->expired;
+		sum.teardown += s->teardown;
+		sum.full += s->full;
+	}
+	seq_printf(m, "all %u %llu %llu %llu %llu %llu %llu\n", flows,
+		   sum.hits, sum.misses, sum.learned, sum.expired,
+		   sum.teardown, sum.full);
+
+	/* Misses include everything that is not forwarded, too */
+	lookups = sum.hits + sum.misses;
+	seq_printf(m, "hit_rate %llu%%\n",
+		   lookups ? div64_u64(sum.hits * 100, lookups) : 0);
+
+	return 0;
+}
+
+static int nf_fp_stats_open(struct inode *inode, struct file *file)
+{
+	return single_open(file, nf_fp_stats_show, NULL);
+}
+
+static const struct file_operations nf_fp_stats_fops = {
+	.owner		= THIS_MODULE,
+	.open		= nf_fp_stats_open,
+	.read		= seq_read,
+	.llseek		= seq_lseek,
+	.release	= single_release,
+};
+
+static void nf_fp_free_tables(void)
+{
+	int cpu;
+
+	for_each_possible_cpu(cpu)
+		kfree(per_cpu_ptr(nf_fp_pcpu, cpu)->hash);
+	free_percpu(nf_fp_pcpu);
+}
+
+static int __init nf_flow_fastpath_init(void)
+{
+	int cpu, ret = -ENOMEM;
+
+	nf_fp_cachep = KMEM_CACHE(nf_fp_flow, 0);
+	if (!nf_fp_cachep)
+		return -ENOMEM;
+
+	nf_fp_pcpu = alloc_percpu(struct nf_fp_cpu);
+	if (!nf_fp_pcpu)
+		goto err_cache;
+
+	for_each_possible_cpu(cpu) {
+		struct nf_fp_cpu *fc = per_cpu_ptr(nf_fp_pcpu, cpu);
+
+		spin_lock_init(&fc->lock);
+		fc->hash = kcalloc(NF_FP_HASH_SIZE, sizeof(*fc->hash),
+				   GFP_KERNEL);
+		if (!fc->hash)
+			goto err_tables;
+	}
+
+	get_random_bytes(&nf_fp_seed, sizeof(nf_fp_seed));
+
+	if (!proc_create("nf_flow_fastpath", 0444, init_net.proc_net,
+			 &nf_fp_stats_fops))
+		goto err_tables;
+
+	ret = register_netdevice_notifier(&nf_fp_netdev_notifier);
+	if (ret)
+		goto err_proc;
+
+	ret = nf_register_hooks(nf_fp_ops, ARRAY_SIZE(nf_fp_ops));
+	if (ret)
+		goto err_notifier;
+
+	if (nf_fp_enabled)
+		queue_delayed_work(system_power_efficient_wq, &nf_fp_gc, HZ);
+
+	return 0;
+
+err_notifier:
+	unregister_netdevice_notifier(&nf_fp_netdev_notifier);
+err_proc:
+	remove_proc_entry("nf_flow_fastpath", init_net.proc_net);
+err_tables:
+	nf_fp_free_tables();
+err_cache:
+	kmem_cache_destroy(nf_fp_cachep);
+	return ret;
+}
+
+static void __exit nf_flow_fastpath_fini(void)
+{
+	nf_unregister_hooks(nf_fp_ops, ARRAY_SIZE(nf_fp_ops));
+	WRITE_ONCE(nf_fp_enabled, false);
+	cancel_delayed_work_sync(&nf_fp_gc);
+	unregister_netdevice_notifier(&nf_fp_netdev_notifier);
+	remove_proc_entry("nf_flow_fastpath", init_net.proc_net);
+	nf_fp_flush(nf_fp_match_all, NULL);
+	rcu_barrier();
+	nf_fp_free_tables();
+	kmem_cache_destroy(nf_fp_cachep);
+}
+
+module_init(nf_flow_fastpath_init);
+module_exit(nf_flow_fastpath_fini);
+
+MODULE_LICENSE("GPL");
+MODULE_DESCRIPTION("Software fast path for forwarded IPv4 conntrack flows");
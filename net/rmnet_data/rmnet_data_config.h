@@ -23,6 +23,21 @@
 
 #define RMNET_DATA_MAX_LOGICAL_EP 256
 
+/**
+ * struct rmnet_gro_flush_state - Dynamic GRO flush state of one NAPI context
+ *
+ * @last_flush_time: Time of the last forced flush
+ * @curr_time_limit: Current flush interval (ns)
+ * @flush_byte_count: Bytes passed to GRO since the last flush
+ * @curr_byte_threshold: Current byte count at which to stop flushing often
+ */
+struct rmnet_gro_flush_state {
+	struct timespec last_flush_time;
+	long curr_time_limit;
+	unsigned int flush_byte_count;
+	unsigned int curr_byte_threshold;
+};
+
 /**
  * struct rmnet_logical_ep_conf_s - Logical end-point configuration
  *
@@ -33,13 +48,11 @@
  * @mux_id: Virtual channel ID used by MAP protocol
  * @egress_dev: Next device to deliver the packet to. Exact usage of this
  *            parmeter depends on the rmnet_mode
+ * @gro_flush: GRO flush state for packets delivered on the interrupt CPU
  */
 struct rmnet_logical_ep_conf_s {
 	struct net_device *egress_dev;
-	struct timespec last_flush_time;
-	long curr_time_limit;
-	unsigned int flush_byte_count;
-	unsigned int curr_byte_threshold;
+	struct rmnet_gro_flush_state gro_flush;
 	u8 refcount;
 	u8 rmnet_mode;
 	u8 mux_id;
@@ -64,6 +77,10 @@ struct rmnet_logical_ep_conf_s {
  * @tail_spacing: Guaranteed padding (bytes) when de-aggregating ingress frames
  * @agg_time: Wall clock time when aggregated frame was created
  * @agg_last: Last time the aggregation routing was invoked
+ * @agg_gap_avg: Moving average of the time (ns) between egress packets
+ * @agg_len_avg: Moving average of the egress packet length (bytes)
+ * @agg_count_limit: Packet limit chosen for the frame being aggregated
+ * @agg_timeout: Flush timeout (ns) chosen for the frame being aggregated
  */
 struct rmnet_phys_ep_config {
 	struct net_device *dev;
@@ -86,6 +103,10 @@ struct rmnet_phys_ep_config {
 	u8 agg_count;
 	struct timespec agg_time;
 	struct timespec agg_last;
+	u32 agg_gap_avg;
+	u32 agg_len_avg;
+	u16 agg_count_limit;
+	long agg_timeout;
 	struct hrtimer hrtimer;
 };
 
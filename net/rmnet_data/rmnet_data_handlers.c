@@ -28,6 +28,7 @@
 #include "rmnet_data_stats.h"
 #include "rmnet_data_trace.h"
 #include "rmnet_data_handlers.h"
+#include "rmnet_data_steer.h"
 
 RMNET_LOG_MODULE(RMNET_DATA_LOGMASK_HANDLER);
 
@@ -257,7 +258,7 @@ static int rmnet_check_skb_can_gro(struct sk_buff *skb)
  * ratio.
  */
 static void rmnet_optional_gro_flush(struct napi_struct *napi,
-				     struct rmnet_logical_ep_conf_s *ep,
+				     struct rmnet_gro_flush_state *flush,
 					 unsigned int skb_size)
 {
 	struct timespec curr_time, diff;
@@ -265,53 +266,53 @@ static void rmnet_optional_gro_flush(struct napi_struct *napi,
 	if (!gro_flush_logic_on)
 		return;
 
-	if (unlikely(ep->last_flush_time.tv_sec == 0)) {
-		getnstimeofday(&ep->last_flush_time);
-		ep->flush_byte_count = 0;
-		ep->curr_time_limit = lower_flush_time;
-		ep->curr_byte_threshold = lower_byte_limit;
+	if (unlikely(flush->last_flush_time.tv_sec == 0)) {
+		getnstimeofday(&flush->last_flush_time);
+		flush->flush_byte_count = 0;
+		flush->curr_time_limit = lower_flush_time;
+		flush->curr_byte_threshold = lower_byte_limit;
 	} else {
 		getnstimeofday(&(curr_time));
-		diff = timespec_sub(curr_time, ep->last_flush_time);
-		ep->flush_byte_count += skb_size;
+		diff = timespec_sub(curr_time, flush->last_flush_time);
+		flush->flush_byte_count += skb_size;
 
 		if (dynamic_gro_on) {
 			if ((!(diff.tv_sec > 0) || diff.tv_nsec <=
-					ep->curr_time_limit) &&
-					ep->flush_byte_count >=
-					ep->curr_byte_threshold) {
+					flush->curr_time_limit) &&
+					flush->flush_byte_count >=
+					flush->curr_byte_threshold) {
 				/* Processed many bytes in a small time window.
 				 * No longer need to flush so often and we can
 				 * increase our byte limit
 				 */
-				ep->curr_time_limit = upper_flush_time;
-				ep->curr_byte_threshold = upper_byte_limit;
+				flush->curr_time_limit = upper_flush_time;
+				flush->curr_byte_threshold = upper_byte_limit;
 			} else if ((diff.tv_sec > 0 ||
-					diff.tv_nsec > ep->curr_time_limit) &&
-					ep->flush_byte_count <
-					ep->curr_byte_threshold) {
+					diff.tv_nsec > flush->curr_time_limit) &&
+					flush->flush_byte_count <
+					flush->curr_byte_threshold) {
 				/* We have not hit our time limit and we are not
 				 * receive many bytes. Demote ourselves to the
 				 * lowest limits and flush
 				 */
 				napi_gro_flush(napi, false);
-				ep->last_flush_time = curr_time;
-				ep->flush_byte_count = 0;
-				ep->curr_time_limit = lower_flush_time;
-				ep->curr_byte_threshold = lower_byte_limit;
+				flush->last_flush_time = curr_time;
+				flush->flush_byte_count = 0;
+				flush->curr_time_limit = lower_flush_time;
+				flush->curr_byte_threshold = lower_byte_limit;
 			} else if ((diff.tv_sec > 0 ||
-					diff.tv_nsec > ep->curr_time_limit) &&
-					ep->flush_byte_count >=
-					ep->curr_byte_threshold) {
+					diff.tv_nsec > flush->curr_time_limit) &&
+					flush->flush_byte_count >=
+					flush->curr_byte_threshold) {
 				/* Above byte and time limt, therefore we can
 				 * move/maintain our limits to be the max
 				 * and flush
 				 */
 				napi_gro_flush(napi, false);
-				ep->last_flush_time = curr_time;
-				ep->flush_byte_count = 0;
-				ep->curr_time_limit = upper_flush_time;
-				ep->curr_byte_threshold = upper_byte_limit;
+				flush->last_flush_time = curr_time;
+				flush->flush_byte_count = 0;
+				flush->curr_time_limit = upper_flush_time;
+				flush->curr_byte_threshold = upper_byte_limit;
 			}
 			/* else, below time limit and below
 			 * byte thresh, so change nothing
@@ -319,12 +320,38 @@ static void rmnet_optional_gro_flush(struct napi_struct *napi,
 		} else if (diff.tv_sec > 0 ||
 				diff.tv_nsec >= lower_flush_time) {
 			napi_gro_flush(napi, false);
-			ep->last_flush_time = curr_time;
-			ep->flush_byte_count = 0;
+			flush->last_flush_time = curr_time;
+			flush->flush_byte_count = 0;
 		}
 	}
 }
 
+/* rmnet_deliver_vnd_skb() - Hand a VND packet to the network stack
+ * @skb:      Packet, with its VND fixups done
+ * @napi:     NAPI context to use for GRO, or NULL for the current one
+ * @flush:    GRO flush state belonging to that NAPI context
+ */
+void rmnet_deliver_vnd_skb(struct sk_buff *skb, struct napi_struct *napi,
+			   struct rmnet_gro_flush_state *flush)
+{
+	gro_result_t gro_res;
+	unsigned int skb_size;
+
+	if (rmnet_check_skb_can_gro(skb) &&
+	    (skb->dev->features & NETIF_F_GRO)) {
+		if (!napi)
+			napi = get_current_napi_context();
+
+		skb_size = skb->len;
+		skb_get_hash(skb);
+		gro_res = napi_gro_receive(napi, skb);
+		trace_rmnet_gro_downlink(gro_res);
+		rmnet_optional_gro_flush(napi, flush, skb_size);
+	} else{
+		netif_receive_skb(skb);
+	}
+}
+
 /* __rmnet_deliver_skb() - Deliver skb
  *
  * Determines where to deliver skb. Options are: consume by network stack,
@@ -337,10 +364,6 @@ static void rmnet_optional_gro_flush(struct napi_struct *napi,
 static rx_handler_result_t __rmnet_deliver_skb
 	(struct sk_buff *skb, struct rmnet_logical_ep_conf_s *ep)
 {
-	struct napi_struct *napi = NULL;
-	gro_result_t gro_res;
-	unsigned int skb_size;
-
 	trace___rmnet_deliver_skb(skb);
 	switch (ep->rmnet_mode) {
 	case RMNET_EPMODE_VND:
@@ -351,18 +374,8 @@ static rx_handler_result_t __rmnet_deliver_skb
 		skb->pkt_type = PACKET_HOST;
 		skb_set_mac_header(skb, 0);
 
-		if (rmnet_check_skb_can_gro(skb) &&
-		    (skb->dev->features & NETIF_F_GRO)) {
-			napi = get_current_napi_context();
-
-			skb_size = skb->len;
-			skb_get_hash(skb);
-			gro_res = napi_gro_receive(napi, skb);
-			trace_rmnet_gro_downlink(gro_res);
-			rmnet_optional_gro_flush(napi, ep, skb_size);
-		} else{
-			netif_receive_skb(skb);
-		}
+		if (!rmnet_rx_steer_skb(skb))
+			rmnet_deliver_vnd_skb(skb, NULL, &ep->gro_flush);
 		return RX_HANDLER_CONSUMED;
 
 	case RMNET_EPMODE_NONE:
@@ -477,7 +490,8 @@ static rx_handler_result_t _rmnet_map_ingress_handler
 			 ckresult != RMNET_MAP_CHECKSUM_VALIDATION_FAILED &&
 			 ckresult != RMNET_MAP_CHECKSUM_ERR_UNKNOWN_TRANSPORT &&
 			 ckresult != RMNET_MAP_CHECKSUM_VALID_FLAG_NOT_SET &&
-			 ckresult != RMNET_MAP_CHECKSUM_FRAGMENTED_PACKET) {
+			 ckresult != RMNET_MAP_CHECKSUM_FRAGMENTED_PACKET &&
+			 ckresult != RMNET_MAP_CHECKSUM_ERR_EXTHDR) {
 			rmnet_kfree_skb
 			(skb, RMNET_STATS_SKBFREE_INGRESS_BAD_MAP_CKSUM);
 			return RX_HANDLER_CONSUMED;
@@ -20,4 +20,7 @@ void rmnet_egress_handler(struct sk_buff *skb,
 
 rx_handler_result_t rmnet_rx_handler(struct sk_buff **pskb);
 
+void rmnet_deliver_vnd_skb(struct sk_buff *skb, struct napi_struct *napi,
+			   struct rmnet_gro_flush_state *flush);
+
 #endif /* _RMNET_DATA_HANDLERS_H_ */
@@ -19,6 +19,7 @@
 #include <linux/skbuff.h>
 #include <linux/spinlock.h>
 #include <linux/netdevice.h>
+#include <linux/log2.h>
 #include <net/rmnet_config.h>
 #include "rmnet_data_private.h"
 #include "rmnet_data_stats.h"
@@ -28,9 +29,21 @@
 enum rmnet_deagg_e {
 	RMNET_STATS_AGG_BUFF,
 	RMNET_STATS_AGG_PKT,
+	RMNET_STATS_AGG_SKIP_TCP_ACK,
 	RMNET_STATS_AGG_MAX
 };
 
+/* Aggregated frames by packet count: 1, 2-3, 4-7, 8-15, 16-31, 32+ */
+#define RMNET_STATS_AGG_PKTS_HIST_MAX 6
+
+/* Time the first packet of a frame waited: <50us, <100us, <250us, <500us,
+ * <1ms, <2ms, <4ms, 4ms+
+ */
+#define RMNET_STATS_AGG_LAT_HIST_MAX 8
+static const long agg_latency_bounds[RMNET_STATS_AGG_LAT_HIST_MAX - 1] = {
+	50000, 100000, 250000, 500000, 1000000, 2000000, 4000000
+};
+
 static DEFINE_SPINLOCK(rmnet_skb_free_lock);
 unsigned long int skb_free[RMNET_STATS_SKBFREE_MAX];
 module_param_array(skb_free, ulong, 0, 0444);
@@ -46,6 +59,15 @@ unsigned long int agg_count[RMNET_STATS_AGG_MAX];
 module_param_array(agg_count, ulong, 0, 0444);
 MODULE_PARM_DESC(agg_count, "SKBs Aggregated");
 
+unsigned long int agg_pkts_hist[RMNET_STATS_AGG_PKTS_HIST_MAX];
+module_param_array(agg_pkts_hist, ulong, 0, 0444);
+MODULE_PARM_DESC(agg_pkts_hist, "Agg frames by packets: 1,2-3,4-7,8-15,16-31,32+");
+
+unsigned long int agg_latency_hist[RMNET_STATS_AGG_LAT_HIST_MAX];
+module_param_array(agg_latency_hist, ulong, 0, 0444);
+MODULE_PARM_DESC(agg_latency_hist,
+		 "Agg frames by added latency: <50,<100,<250,<500,<1000,<2000,<4000,4000+ us");
+
 static DEFINE_SPINLOCK(rmnet_checksum_dl_stats);
 unsigned long int checksum_dl_stats[RMNET_MAP_CHECKSUM_ENUM_LENGTH];
 module_param_array(checksum_dl_stats, ulong, 0, 0444);
@@ -56,6 +78,11 @@ unsigned long int checksum_ul_stats[RMNET_MAP_CHECKSUM_ENUM_LENGTH];
 module_param_array(checksum_ul_stats, ulong, 0, 0444);
 MODULE_PARM_DESC(checksum_ul_stats, "Uplink Checksum Statistics");
 
+unsigned long int checksum_offload[RMNET_STATS_CSUM_MAX];
+module_param_array(checksum_offload, ulong, 0, 0444);
+MODULE_PARM_DESC(checksum_offload,
+		 "Checksum offload hits and misses: DL hw,hw past IPv6 exthdr,complete,sw UL hw,hw past IPv6 exthdr,sw");
+
 void rmnet_kfree_skb(struct sk_buff *skb, unsigned int reason)
 {
 	unsigned long flags;
@@ -94,15 +121,62 @@ void rmnet_stats_agg_pkts(int aggcount)
 	spin_unlock_irqrestore(&rmnet_agg_count, flags);
 }
 
+/* rmnet_stats_agg_flush() - Account an aggregated frame being shipped
+ * @aggcount:   Number of packets in the frame
+ * @latency_ns: Time since the first packet was put in the frame
+ */
+void rmnet_stats_agg_flush(int aggcount, long latency_ns)
+{
+	unsigned long flags;
+	int pkts, lat;
+
+	pkts = min(aggcount > 0 ? ilog2(aggcount) : 0,
+		   RMNET_STATS_AGG_PKTS_HIST_MAX - 1);
+	for (lat = 0; lat < RMNET_STATS_AGG_LAT_HIST_MAX - 1; lat++)
+		if (latency_ns < agg_latency_bounds[lat])
+			break;
+
+	spin_lock_irqsave(&rmnet_agg_count, flags);
+	agg_pkts_hist[pkts]++;
+	agg_latency_hist[lat]++;
+	spin_unlock_irqrestore(&rmnet_agg_count, flags);
+}
+
+void rmnet_stats_agg_skip_tcp_ack(void)
+{
+	unsigned long flags;
+
+	spin_lock_irqsave(&rmnet_agg_count, flags);
+	agg_count[RMNET_STATS_AGG_SKIP_TCP_ACK]++;
+	spin_unlock_irqrestore(&rmnet_agg_count, flags);
+}
+
 void rmnet_stats_dl_checksum(unsigned int rc)
 {
 	unsigned long flags;
+	unsigned int type;
 
 	if (rc >= RMNET_MAP_CHECKSUM_ENUM_LENGTH)
 		rc = RMNET_MAP_CHECKSUM_ERR_UNKNOWN;
 
+	switch (rc) {
+	case RMNET_MAP_CHECKSUM_OK:
+	case RMNET_MAP_CHECKSUM_SKIPPED:
+		type = RMNET_STATS_CSUM_DL_HW;
+		break;
+	case RMNET_MAP_CHECKSUM_FRAGMENTED_PACKET:
+	case RMNET_MAP_CHECKSUM_ERR_UNKNOWN_TRANSPORT:
+	case RMNET_MAP_CHECKSUM_ERR_EXTHDR:
+		type = RMNET_STATS_CSUM_DL_COMPLETE;
+		break;
+	default:
+		type = RMNET_STATS_CSUM_DL_SW;
+		break;
+	}
+
 	spin_lock_irqsave(&rmnet_checksum_dl_stats, flags);
 	checksum_dl_stats[rc]++;
+	checksum_offload[type]++;
 	spin_unlock_irqrestore(&rmnet_checksum_dl_stats, flags);
 }
 
@@ -115,5 +189,31 @@ void rmnet_stats_ul_checksum(unsigned int rc)
 
 	spin_lock_irqsave(&rmnet_checksum_ul_stats, flags);
 	checksum_ul_stats[rc]++;
+	if (rc == RMNET_MAP_CHECKSUM_OK)
+		checksum_offload[RMNET_STATS_CSUM_UL_HW]++;
+	else
+		checksum_offload[RMNET_STATS_CSUM_UL_SW]++;
 	spin_unlock_irqrestore(&rmnet_checksum_ul_stats, flags);
 }
+
+/* rmnet_stats_csum_offload() - Account a checksum offload detail
+ * @type:       One of the rmnet_csum_offload_e counters
+ *
+ * Used for the exthdr counters, which are a subset of the plain hw hits.
+ * Each direction's counters share that direction's lock.
+ */
+void rmnet_stats_csum_offload(unsigned int type)
+{
+	unsigned long flags;
+
+	spinlock_t *lock = &rmnet_checksum_dl_stats;
+
+	if (type >= RMNET_STATS_CSUM_MAX)
+		return;
+	if (type >= RMNET_STATS_CSUM_UL_HW)
+		lock = &rmnet_checksum_ul_stats;
+
+	spin_lock_irqsave(lock, flags);
+	checksum_offload[type]++;
+	spin_unlock_irqrestore(lock, flags);
+}
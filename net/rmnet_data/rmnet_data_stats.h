@@ -40,6 +40,7 @@ enum rmnet_skb_free_e {
 	RMNET_STATS_SKBFREE_INGRESS_BAD_MAP_CKSUM,
 	RMNET_STATS_SKBFREE_MAPC_UNSUPPORTED,
 	RMNET_STATS_SKBFREE_MAPINGRESS_MUX_NO_EP,
+	RMNET_STATS_SKBFREE_RX_BACKLOG_FULL,
 	RMNET_STATS_SKBFREE_MAX
 };
 
@@ -53,10 +54,24 @@ enum rmnet_queue_xmit_e {
 	RMNET_STATS_QUEUE_XMIT_MAX
 };
 
+enum rmnet_csum_offload_e {
+	RMNET_STATS_CSUM_DL_HW,
+	RMNET_STATS_CSUM_DL_HW_EXTHDR,
+	RMNET_STATS_CSUM_DL_COMPLETE,
+	RMNET_STATS_CSUM_DL_SW,
+	RMNET_STATS_CSUM_UL_HW,
+	RMNET_STATS_CSUM_UL_HW_EXTHDR,
+	RMNET_STATS_CSUM_UL_SW,
+	RMNET_STATS_CSUM_MAX
+};
+
 void rmnet_kfree_skb(struct sk_buff *skb, unsigned int reason);
 void rmnet_stats_queue_xmit(int rc, unsigned int reason);
 void rmnet_stats_deagg_pkts(int aggcount);
 void rmnet_stats_agg_pkts(int aggcount);
+void rmnet_stats_agg_flush(int aggcount, long latency_ns);
+void rmnet_stats_agg_skip_tcp_ack(void);
 void rmnet_stats_dl_checksum(unsigned int rc);
 void rmnet_stats_ul_checksum(unsigned int rc);
+void rmnet_stats_csum_offload(unsigned int type);
 #endif /* _RMNET_DATA_STATS_H_ */
@@ -0,0 +1,272 @@
+/* Copyright (c) 2018, The Linux Foundation. All rights reserved.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 and
+ * only version 2 as published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * RMNET Data downlink flow steering
+ *
+ * Deaggregation runs on the CPU taking the IPA or BAM interrupt. With
+ * steering enabled, that CPU only splits the frame and steers each packet
+ * by flow hash to a backlog on one of the rx_cpus, where a per-CPU NAPI
+ * context runs GRO and the rest of the stack, as RPS would.
+ */
+
+#include <linux/module.h>
+#include <linux/kernel.h>
+#include <linux/skbuff.h>
+#include <linux/netdevice.h>
+#include <linux/percpu.h>
+#include <linux/cpumask.h>
+#include <linux/smp.h>
+#include <linux/spinlock.h>
+#include <net/rmnet_config.h>
+#include "rmnet_data_private.h"
+#include "rmnet_data_config.h"
+#include "rmnet_data_handlers.h"
+#include "rmnet_data_stats.h"
+#include "rmnet_data_steer.h"
+
+RMNET_LOG_MODULE(RMNET_DATA_LOGMASK_HANDLER);
+
+#define RMNET_RX_NAPI_WEIGHT 64
+
+/**
+ * struct rmnet_rx_queue - Per-CPU downlink backlog
+ *
+ * @napi: NAPI context running GRO for this CPU's flows
+ * @backlog: Packets steered to this CPU; its lock also covers the counters
+ *           and @scheduled
+ * @csd: Kicks @napi from the steering CPU
+ * @gro_flush: Dynamic GRO flush state of @napi
+ * @scheduled: @napi has been, or is about to be, scheduled
+ * @enqueued: Packets steered to this CPU
+ * @dropped: Packets dropped as the backlog was full
+ * @kicks: Interrupts sent to schedule @napi
+ * @processed: Packets delivered by @napi, only written by this CPU
+ */
+struct rmnet_rx_queue {
+	struct napi_struct napi;
+	struct sk_buff_head backlog;
+	struct call_single_data csd;
+	struct rmnet_gro_flush_state gro_flush;
+	bool scheduled;
+	unsigned long enqueued;
+	unsigned long dropped;
+	unsigned long kicks;
+	unsigned long processed;
+};
+
+static DEFINE_PER_CPU(struct rmnet_rx_queue, rmnet_rx_queues);
+static struct net_device rmnet_rx_dummy_dev;
+static bool rmnet_rx_steer_ready;
+
+/* Steering targets in order; updated before the count, so a reader racing
+ * with an update always indexes a valid CPU number.
+ */
+static int rmnet_rx_cpu_map[NR_CPUS];
+static unsigned int rmnet_rx_nr_cpus;
+static struct cpumask rmnet_rx_cpumask;
+
+unsigned int rx_backlog_max __read_mostly = 1000;
+module_param(rx_backlog_max, uint, 0644);
+MODULE_PARM_DESC(rx_backlog_max, "Max packets queued for one steering CPU");
+
+static int rmnet_rx_cpus_set(const char *val, const struct kernel_param *kp)
+{
+	static struct cpumask mask;
+	unsigned int n = 0;
+	int cpu, rc;
+
+	rc = cpulist_parse(val, &mask);
+	if (rc)
+		return rc;
+
+	cpumask_and(&mask, &mask, cpu_possible_mask);
+	for_each_cpu(cpu, &mask)
+		rmnet_rx_cpu_map[n++] = cpu;
+	smp_wmb();
+	WRITE_ONCE(rmnet_rx_nr_cpus, n);
+	cpumask_copy(&rmnet_rx_cpumask, &mask);
+	return 0;
+}
+
+static int rmnet_rx_cpus_get(char *buffer, const struct kernel_param *kp)
+{
+	return scnprintf(buffer, PAGE_SIZE, "%*pbl\n",
+			 cpumask_pr_args(&rmnet_rx_cpumask));
+}
+
+static const struct kernel_param_ops rmnet_rx_cpus_ops = {
+	.set = rmnet_rx_cpus_set,
+	.get = rmnet_rx_cpus_get,
+};
+
+module_param_cb(rx_cpus, &rmnet_rx_cpus_ops, NULL, 0644);
+MODULE_PARM_DESC(rx_cpus, "CPUs to steer downlink flows to (empty: off)");
+
+static int rmnet_rx_cpu_stats_get(char *buffer, const struct kernel_param *kp)
+{
+	struct rmnet_rx_queue *q;
+	int cpu, len = 0;
+
+	for_each_possible_cpu(cpu) {
+		q = &per_cpu(rmnet_rx_queues, cpu);
+		len += scnprintf(buffer + len, PAGE_SIZE - len,
+				 "cpu%d: enqueued %lu processed %lu dropped %lu kicks %lu backlog %u\n",
+				 cpu, READ_ONCE(q->enqueued),
+				 READ_ONCE(q->processed),
+				 READ_ONCE(q->dropped), READ_ONCE(q->kicks),
+				 skb_queue_len(&q->backlog));
+	}
+	return len;
+}
+
+static const struct kernel_param_ops rmnet_rx_cpu_stats_ops = {
+	.get = rmnet_rx_cpu_stats_get,
+};
+
+module_param_cb(rx_cpu_stats, &rmnet_rx_cpu_stats_ops, NULL, 0444);
+MODULE_PARM_DESC(rx_cpu_stats, "Per CPU downlink steering counters");
+
+static void rmnet_rx_queue_kick(void *info)
+{
+	struct rmnet_rx_queue *q = info;
+
+	napi_schedule(&q->napi);
+}
+
+/* rmnet_rx_queue_poll() - NAPI poll of a per-CPU backlog
+ *
+ * Completion follows the RPS backlog: the NAPI context is only completed
+ * with the backlog lock held and the backlog empty, so a steering CPU either
+ * sees it still scheduled or kicks it again.
+ */
+static int rmnet_rx_queue_poll(struct napi_struct *napi, int budget)
+{
+	struct rmnet_rx_queue *q =
+		container_of(napi, struct rmnet_rx_queue, napi);
+	unsigned long flags;
+	struct sk_buff *skb;
+	int work = 0;
+
+	while (work < budget) {
+		spin_lock_irqsave(&q->backlog.lock, flags);
+		skb = __skb_dequeue(&q->backlog);
+		spin_unlock_irqrestore(&q->backlog.lock, flags);
+		if (!skb)
+			break;
+
+		rmnet_deliver_vnd_skb(skb, napi, &q->gro_flush);
+		work++;
+	}
+	q->processed += work;
+
+	if (work < budget) {
+		napi_gro_flush(napi, false);
+		spin_lock_irqsave(&q->backlog.lock, flags);
+		if (skb_queue_empty(&q->backlog)) {
+			q->scheduled = false;
+			__napi_complete(napi);
+			spin_unlock_irqrestore(&q->backlog.lock, flags);
+			return work;
+		}
+		spin_unlock_irqrestore(&q->backlog.lock, flags);
+		/* More arrived meanwhile, have net_rx_action() poll again */
+		work = budget;
+	}
+	return work;
+}
+
+/* rmnet_rx_steer_skb() - Steer a downlink packet to a backlog CPU
+ * @skb:      Packet ready for delivery to its VND
+ *
+ * Return:
+ *      - true if the packet was queued on, or dropped for, a steering CPU
+ *      - false if steering is off and the caller should deliver the packet
+ */
+bool rmnet_rx_steer_skb(struct sk_buff *skb)
+{
+	struct rmnet_rx_queue *q;
+	unsigned int n, idx;
+	unsigned long flags;
+	bool kick = false;
+	int cpu;
+
+	n = READ_ONCE(rmnet_rx_nr_cpus);
+	if (!n || !rmnet_rx_steer_ready)
+		return false;
+	smp_rmb();
+
+	idx = reciprocal_scale(skb_get_hash(skb), n);
+	cpu = rmnet_rx_cpu_map[idx];
+	if (unlikely(!cpu_online(cpu)))
+		return false;
+
+	skb_record_rx_queue(skb, idx % RMNET_DATA_VND_RX_QUEUES);
+	q = &per_cpu(rmnet_rx_queues, cpu);
+
+	spin_lock_irqsave(&q->backlog.lock, flags);
+	if (unlikely(skb_queue_len(&q->backlog) >= rx_backlog_max)) {
+		q->dropped++;
+		spin_unlock_irqrestore(&q->backlog.lock, flags);
+		rmnet_kfree_skb(skb, RMNET_STATS_SKBFREE_RX_BACKLOG_FULL);
+		return true;
+	}
+	__skb_queue_tail(&q->backlog, skb);
+	q->enqueued++;
+	if (!q->scheduled) {
+		q->scheduled = true;
+		kick = true;
+		if (cpu != smp_processor_id())
+			q->kicks++;
+	}
+	spin_unlock_irqrestore(&q->backlog.lock, flags);
+
+	if (kick) {
+		if (cpu == smp_processor_id())
+			napi_schedule(&q->napi);
+		else
+			smp_call_function_single_async(cpu, &q->csd);
+	}
+	return true;
+}
+
+void rmnet_rx_steer_init(void)
+{
+	struct rmnet_rx_queue *q;
+	int cpu;
+
+	init_dummy_netdev(&rmnet_rx_dummy_dev);
+	for_each_possible_cpu(cpu) {
+		q = &per_cpu(rmnet_rx_queues, cpu);
+		skb_queue_head_init(&q->backlog);
+		q->csd.func = rmnet_rx_queue_kick;
+		q->csd.info = q;
+		netif_napi_add(&rmnet_rx_dummy_dev, &q->napi,
+			       rmnet_rx_queue_poll, RMNET_RX_NAPI_WEIGHT);
+		napi_enable(&q->napi);
+	}
+	rmnet_rx_steer_ready = true;
+	LOGL("%s", "Downlink steering ready");
+}
+
+void rmnet_rx_steer_exit(void)
+{
+	struct rmnet_rx_queue *q;
+	int cpu;
+
+	rmnet_rx_steer_ready = false;
+	synchronize_net();
+	for_each_possible_cpu(cpu) {
+		q = &per_cpu(rmnet_rx_queues, cpu);
+		napi_disable(&q->napi);
+		netif_napi_del(&q->napi);
+		skb_queue_purge(&q->backlog);
+	}
+}
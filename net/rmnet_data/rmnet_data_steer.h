@@ -0,0 +1,25 @@
+/* Copyright (c) 2018, The Linux Foundation. All rights reserved.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 and
+ * only version 2 as published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * RMNET Data downlink flow steering
+ */
+
+#ifndef _RMNET_DATA_STEER_H_
+#define _RMNET_DATA_STEER_H_
+
+/* Receive queues of each VND, one per possible steering target */
+#define RMNET_DATA_VND_RX_QUEUES 8
+
+bool rmnet_rx_steer_skb(struct sk_buff *skb);
+void rmnet_rx_steer_init(void);
+void rmnet_rx_steer_exit(void);
+
+#endif /* _RMNET_DATA_STEER_H_ */
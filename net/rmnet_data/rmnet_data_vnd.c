@@ -27,6 +27,7 @@
 #include "rmnet_data_private.h"
 #include "rmnet_map.h"
 #include "rmnet_data_vnd.h"
+#include "rmnet_data_steer.h"
 #include "rmnet_data_stats.h"
 #include "rmnet_data_trace.h"
 
@@ -548,10 +549,11 @@ int rmnet_vnd_create_dev(int id, struct net_device **new_device,
 		return RMNET_CONFIG_BAD_ARGUMENTS;
 	}
 
-	dev = alloc_netdev(sizeof(struct rmnet_vnd_private_s),
-			   dev_prefix,
-			   use_name ? NET_NAME_UNKNOWN : NET_NAME_ENUM,
-			   rmnet_vnd_setup);
+	/* One receive queue per downlink steering target, see rx_cpus */
+	dev = alloc_netdev_mqs(sizeof(struct rmnet_vnd_private_s),
+			       dev_prefix,
+			       use_name ? NET_NAME_UNKNOWN : NET_NAME_ENUM,
+			       rmnet_vnd_setup, 1, RMNET_DATA_VND_RX_QUEUES);
 	if (!dev) {
 		LOGE("Failed to to allocate netdev for id %d", id);
 		*new_device = 0;
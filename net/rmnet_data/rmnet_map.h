@@ -105,6 +105,7 @@ enum rmnet_map_checksum_errors_e {
 	RMNET_MAP_CHECKSUM_FRAGMENTED_PACKET,
 	RMNET_MAP_CHECKSUM_SKIPPED,
 	RMNET_MAP_CHECKSUM_SW,
+	RMNET_MAP_CHECKSUM_ERR_EXTHDR,
 	/* This should always be the last element */
 	RMNET_MAP_CHECKSUM_ENUM_LENGTH
 };
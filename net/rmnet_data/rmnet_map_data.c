@@ -29,6 +29,7 @@
 #include <net/ip.h>
 #include <net/checksum.h>
 #include <net/ip6_checksum.h>
+#include <net/ipv6.h>
 #include <net/rmnet_config.h>
 #include "rmnet_data_config.h"
 #include "rmnet_map.h"
@@ -48,11 +49,28 @@ long agg_bypass_time __read_mostly = 10000000L;
 module_param(agg_bypass_time, long, 0644);
 MODULE_PARM_DESC(agg_bypass_time, "Skip agg when apart spaced more than this");
 
+int agg_adaptive __read_mostly = 1;
+module_param(agg_adaptive, int, 0644);
+MODULE_PARM_DESC(agg_adaptive, "Scale agg limits and timeout with packet rate");
+
+long agg_timeout_min __read_mostly = 200000L;
+module_param(agg_timeout_min, long, 0644);
+MODULE_PARM_DESC(agg_timeout_min, "Shortest adaptive agg flush timeout");
+
+int agg_skip_tcp_ack __read_mostly = 1;
+module_param(agg_skip_tcp_ack, int, 0644);
+MODULE_PARM_DESC(agg_skip_tcp_ack, "Send pure TCP ACKs without aggregating");
+
 struct agg_work {
 	struct work_struct work;
 	struct rmnet_phys_ep_config *config;
 };
 
+/* Flush timeout when agg_adaptive is off */
+#define RMNET_MAP_AGG_FLUSH_NS    3000000L
+/* Adaptive timeout, in average packet gaps */
+#define RMNET_MAP_AGG_TIMEOUT_GAPS 4
+
 #define RMNET_MAP_DEAGGR_SPACING  64
 #define RMNET_MAP_DEAGGR_HEADROOM (RMNET_MAP_DEAGGR_SPACING / 2)
 
@@ -165,11 +183,77 @@ struct sk_buff *rmnet_map_deaggregate(struct sk_buff *skb,
 	return skbn;
 }
 
+/* rmnet_map_agg_sample() - Feed one egress packet to the rate estimate
+ * @config:     Physical endpoint configuration of the egress device
+ * @gap:        Time since the previous egress packet
+ * @len:        Length of the packet including its MAP header
+ *
+ * Keeps moving averages (weight 1/8) of the packet spacing and length. Gaps
+ * longer than agg_bypass_time are clipped, as such packets skip agg anyway.
+ * Must be called with agg_lock held.
+ */
+static void rmnet_map_agg_sample(struct rmnet_phys_ep_config *config,
+				 const struct timespec *gap, unsigned int len)
+{
+	u32 gap_ns;
+
+	if (gap->tv_sec > 0 || gap->tv_nsec > agg_bypass_time)
+		gap_ns = (u32)agg_bypass_time;
+	else
+		gap_ns = (u32)gap->tv_nsec;
+
+	config->agg_gap_avg += (gap_ns >> 3) - (config->agg_gap_avg >> 3);
+	config->agg_len_avg += (len >> 3) - (config->agg_len_avg >> 3);
+}
+
+/* rmnet_map_agg_set_limits() - Choose the limits for a new aggregated frame
+ * @config:     Physical endpoint configuration of the egress device
+ * @len:        Length of the first packet of the frame
+ *
+ * The frame is flushed after roughly RMNET_MAP_AGG_TIMEOUT_GAPS average
+ * packet gaps, bounded by agg_timeout_min and agg_time_limit. The packet
+ * limit is what is expected to arrive in that time, so that a frame at a
+ * low rate is shipped once it is as full as it is likely to get, while a
+ * busy link uses the configured egress limits. Must be called with agg_lock
+ * held.
+ *
+ * Return:
+ *      - Tailroom to reserve in the frame for the packets still to come
+ */
+static int rmnet_map_agg_set_limits(struct rmnet_phys_ep_config *config,
+				    unsigned int len)
+{
+	u32 count, size;
+
+	if (!agg_adaptive || !config->agg_gap_avg) {
+		config->agg_count_limit = config->egress_agg_count;
+		config->agg_timeout = agg_time_limit;
+		return config->egress_agg_size - len;
+	}
+
+	config->agg_timeout = clamp((long)config->agg_gap_avg *
+				    RMNET_MAP_AGG_TIMEOUT_GAPS,
+				    agg_timeout_min, agg_time_limit);
+	count = (u32)config->agg_timeout / config->agg_gap_avg + 1;
+	config->agg_count_limit = clamp_t(u32, count, 2,
+					  config->egress_agg_count);
+
+	size = config->agg_count_limit * max(config->agg_len_avg, len);
+	size = min_t(u32, size, config->egress_agg_size);
+	return (int)size - (int)len;
+}
+
+static long rmnet_map_agg_timer_ns(struct rmnet_phys_ep_config *config)
+{
+	return agg_adaptive ? config->agg_timeout : RMNET_MAP_AGG_FLUSH_NS;
+}
+
 static void rmnet_map_flush_packet_work(struct work_struct *work)
 {
 	struct rmnet_phys_ep_config *config;
 	struct agg_work *real_work;
 	int rc, agg_count = 0;
+	struct timespec now, diff;
 	unsigned long flags;
 	struct sk_buff *skb;
 
@@ -183,6 +267,10 @@ static void rmnet_map_flush_packet_work(struct work_struct *work)
 		/* Buffer may have already been shipped out */
 		if (likely(config->agg_skb)) {
 			rmnet_stats_agg_pkts(config->agg_count);
+			getnstimeofday(&now);
+			diff = timespec_sub(now, config->agg_time);
+			rmnet_stats_agg_flush(config->agg_count,
+					      timespec_to_ns(&diff));
 			if (config->agg_count > 1)
 				LOGL("Agg count: %d", config->agg_count);
 			skb = config->agg_skb;
@@ -247,6 +335,7 @@ void rmnet_map_aggregate(struct sk_buff *skb,
 	struct sk_buff *agg_skb;
 	struct timespec diff, last;
 	int size, rc, agg_count = 0;
+	bool sampled = false;
 
 	if (!skb || !config)
 		return;
@@ -255,15 +344,24 @@ void rmnet_map_aggregate(struct sk_buff *skb,
 	spin_lock_irqsave(&config->agg_lock, flags);
 	memcpy(&last, &config->agg_last, sizeof(struct timespec));
 	getnstimeofday(&config->agg_last);
+	if (!sampled) {
+		diff = timespec_sub(config->agg_last, last);
+		rmnet_map_agg_sample(config, &diff, skb->len);
+		sampled = true;
+	}
 
 	if (!config->agg_skb) {
 		/* Check to see if we should agg first. If the traffic is very
 		 * sparse, don't aggregate. We will need to tune this later
 		 */
 		diff = timespec_sub(config->agg_last, last);
-		size = config->egress_agg_size - skb->len;
+		size = rmnet_map_agg_set_limits(config, skb->len);
 
+		/* At rates too low for a second packet to arrive before the
+		 * longest allowed flush, aggregation only adds latency.
+		 */
 		if ((diff.tv_sec > 0) || (diff.tv_nsec > agg_bypass_time) ||
+		    (agg_adaptive && config->agg_gap_avg > agg_time_limit) ||
 		    (size <= 0)) {
 			spin_unlock_irqrestore(&config->agg_lock, flags);
 			LOGL("delta t: %ld.%09lu\tcount: bypass", diff.tv_sec,
@@ -299,9 +397,12 @@ void rmnet_map_aggregate(struct sk_buff *skb,
 	diff = timespec_sub(config->agg_last, config->agg_time);
 
 	if (skb->len > (config->egress_agg_size - config->agg_skb->len) ||
-	    (config->agg_count >= config->egress_agg_count) ||
-	    (diff.tv_sec > 0) || (diff.tv_nsec > agg_time_limit)) {
+	    skb->len > skb_tailroom(config->agg_skb) ||
+	    (config->agg_count >= config->agg_count_limit) ||
+	    (diff.tv_sec > 0) || (diff.tv_nsec > config->agg_timeout)) {
 		rmnet_stats_agg_pkts(config->agg_count);
+		rmnet_stats_agg_flush(config->agg_count,
+				      timespec_to_ns(&diff));
 		agg_skb = config->agg_skb;
 		agg_count = config->agg_count;
 		config->agg_skb = 0;
@@ -327,7 +428,8 @@ void rmnet_map_aggregate(struct sk_buff *skb,
 schedule:
 	if (config->agg_state != RMNET_MAP_TXFER_SCHEDULED) {
 		config->agg_state = RMNET_MAP_TXFER_SCHEDULED;
-		hrtimer_start(&config->hrtimer, ns_to_ktime(3000000),
+		hrtimer_start(&config->hrtimer,
+			      ns_to_ktime(rmnet_map_agg_timer_ns(config)),
 			      HRTIMER_MODE_REL);
 	}
 	spin_unlock_irqrestore(&config->agg_lock, flags);
@@ -466,6 +568,61 @@ static int rmnet_map_validate_ipv4_packet_checksum
 		return RMNET_MAP_CHECKSUM_VALIDATION_FAILED;
 }
 
+/* rmnet_map_ipv6_skip_exthdr() - Find the transport header of an IPv6 packet
+ * @ip6h:	Pointer to the IPv6 header
+ * @len:	Bytes of the packet available after @ip6h
+ * @nexthdr:	Set to the protocol of the transport header
+ *
+ * Walks hop-by-hop, routing, destination options, authentication and atomic
+ * fragment headers. A routing header with segments left is not walked past
+ * since the pseudo header would need the final destination.
+ *
+ * Return: offset of the transport header from @ip6h, or a negated
+ * RMNET_MAP_CHECKSUM_* code if the headers cannot be walked past.
+ */
+static int rmnet_map_ipv6_skip_exthdr(struct ipv6hdr *ip6h, unsigned int len,
+				      u8 *nexthdr)
+{
+	unsigned int off = sizeof(struct ipv6hdr);
+	u8 hdr = ip6h->nexthdr;
+	struct ipv6_opt_hdr *opt;
+	struct frag_hdr *fh;
+	unsigned int optlen;
+
+	while (ipv6_ext_hdr(hdr) && hdr != NEXTHDR_NONE) {
+		if (len < off + sizeof(struct frag_hdr))
+			return -RMNET_MAP_CHECKSUM_ERR_EXTHDR;
+
+		opt = (struct ipv6_opt_hdr *)((unsigned char *)ip6h + off);
+		switch (hdr) {
+		case NEXTHDR_FRAGMENT:
+			fh = (struct frag_hdr *)opt;
+			if (fh->frag_off & htons(IP6_OFFSET | IP6_MF))
+				return -RMNET_MAP_CHECKSUM_FRAGMENTED_PACKET;
+			optlen = sizeof(struct frag_hdr);
+			break;
+
+		case NEXTHDR_AUTH:
+			optlen = ipv6_authlen(opt);
+			break;
+
+		case NEXTHDR_ROUTING:
+			if (((struct ipv6_rt_hdr *)opt)->segments_left)
+				return -RMNET_MAP_CHECKSUM_ERR_EXTHDR;
+			/* fall through */
+		default:
+			optlen = ipv6_optlen(opt);
+			break;
+		}
+
+		hdr = opt->nexthdr;
+		off += optlen;
+	}
+
+	*nexthdr = hdr;
+	return off;
+}
+
 /* rmnet_map_validate_ipv6_packet_checksum() - Validates TCP/UDP checksum
  *	value for IPv6 packet
  * @map_payload:	Pointer to the beginning of the map payload
@@ -484,13 +641,15 @@ static int rmnet_map_validate_ipv4_packet_checksum
  * 5. Compares the value from step 4 to the checksum value from the TCP/UDP
  *    header
  *
- * Fragmentation, extension headers and tunneling are not supported.
+ * Extension headers are included in the header checksum of step 2. Fragments
+ * and tunneling are not supported.
  *
  * Return: 0 is validation succeeded.
  */
 static int rmnet_map_validate_ipv6_packet_checksum
 	(unsigned char *map_payload,
-	 struct rmnet_map_dl_checksum_trailer_s *cksum_trailer)
+	 struct rmnet_map_dl_checksum_trailer_s *cksum_trailer,
+	 unsigned int data_len)
 {
 	struct ipv6hdr *ip6h;
 	u16 *checksum_field;
@@ -502,27 +661,37 @@ static int rmnet_map_validate_ipv6_packet_checksum
 	u16 ip_pseudo_payload_checksum;
 	u16 checksum_value_final;
 	u32 length;
+	u8 nexthdr;
+	int thoff;
 
 	ip6h = (struct ipv6hdr *)map_payload;
 
-	txporthdr = map_payload + sizeof(struct ipv6hdr);
-	checksum_field = rmnet_map_get_checksum_field(ip6h->nexthdr,
-						      txporthdr);
+	thoff = rmnet_map_ipv6_skip_exthdr(ip6h, data_len, &nexthdr);
+	if (thoff < 0)
+		return -thoff;
+
+	txporthdr = map_payload + thoff;
+	checksum_field = rmnet_map_get_checksum_field(nexthdr, txporthdr);
 
 	if (unlikely(!checksum_field))
 		return RMNET_MAP_CHECKSUM_ERR_UNKNOWN_TRANSPORT;
 
+	if (unlikely(data_len < thoff + ((nexthdr == IPPROTO_TCP) ?
+					 sizeof(struct tcphdr) :
+					 sizeof(struct udphdr))))
+		return RMNET_MAP_CHECKSUM_ERR_EXTHDR;
+
 	checksum_value = ~ntohs(cksum_trailer->checksum_value);
 	ip_hdr_checksum = ~ntohs(ip_compute_csum(ip6h,
 				 (int)(txporthdr - (void *)map_payload)));
 	ip_payload_checksum = rmnet_map_subtract_checksums
 				(checksum_value, ip_hdr_checksum);
 
-	length = (ip6h->nexthdr == IPPROTO_UDP) ?
+	length = (nexthdr == IPPROTO_UDP) ?
 		ntohs(((struct udphdr *)txporthdr)->len) :
-		ntohs(ip6h->payload_len);
+		ntohs(ip6h->payload_len) + sizeof(struct ipv6hdr) - thoff;
 	pseudo_checksum = ~ntohs(csum_ipv6_magic(&ip6h->saddr, &ip6h->daddr,
-		length, ip6h->nexthdr, 0));
+		length, nexthdr, 0));
 	ip_pseudo_payload_checksum = rmnet_map_add_checksums(
 		ip_payload_checksum, pseudo_checksum);
 
@@ -530,7 +699,7 @@ static int rmnet_map_validate_ipv6_packet_checksum
 		ip_pseudo_payload_checksum, ntohs(*checksum_field));
 
 	if (unlikely(checksum_value_final == 0)) {
-		switch (ip6h->nexthdr) {
+		switch (nexthdr) {
 		case IPPROTO_UDP:
 			/* RFC 2460 section 8.1 */
 			LOGD("DL6 One's complement rule for UDP checksum 0");
@@ -552,11 +721,13 @@ static int rmnet_map_validate_ipv6_packet_checksum
 	~ntohs(cksum_trailer->checksum_value), ntohs(*checksum_field),
 	pseudo_checksum, checksum_value_final);
 
-	if (checksum_value_final == ntohs(*checksum_field))
-		return RMNET_MAP_CHECKSUM_OK;
-	else
+	if (checksum_value_final != ntohs(*checksum_field))
 		return RMNET_MAP_CHECKSUM_VALIDATION_FAILED;
-	}
+
+	if (thoff != sizeof(struct ipv6hdr))
+		rmnet_stats_csum_offload(RMNET_STATS_CSUM_DL_HW_EXTHDR);
+	return RMNET_MAP_CHECKSUM_OK;
+}
 
 /* rmnet_map_checksum_downlink_packet() - Validates checksum on
  * a downlink packet
@@ -566,7 +737,9 @@ static int rmnet_map_validate_ipv6_packet_checksum
  * the beginning of a buffer which contains the entire MAP
  * frame: MAP header + IP payload + padding + checksum trailer.
  * Currently, only IPv4 and IPv6 are supported along with
- * TCP & UDP. Fragmented or tunneled packets are not supported.
+ * TCP & UDP, including IPv6 packets with extension headers. For fragments
+ * and other transports the sum from the trailer is passed up as
+ * CHECKSUM_COMPLETE so the stack can still skip summing the payload.
  *
  * Return:
  *   - RMNET_MAP_CHECKSUM_OK: Validation of checksum succeeded.
@@ -576,6 +749,8 @@ static int rmnet_map_validate_ipv6_packet_checksum
  *   - RMNET_MAP_CHECKSUM_FRAGMENTED_PACKET: The packet is a fragment.
  *   - RMNET_MAP_CHECKSUM_ERR_UNKNOWN_TRANSPORT: The transport header is
  *						   not TCP/UDP.
+ *   - RMNET_MAP_CHECKSUM_ERR_EXTHDR: The IPv6 extension headers cannot be
+ *				       validated past.
  *   - RMNET_MAP_CHECKSUM_ERR_UNKNOWN_IP_VERSION: Unrecognized IP header.
  *   - RMNET_MAP_CHECKSUM_VALIDATION_FAILED: In case the validation failed.
  */
@@ -585,6 +760,7 @@ int rmnet_map_checksum_downlink_packet(struct sk_buff *skb)
 	unsigned int data_len;
 	unsigned char *map_payload;
 	unsigned char ip_version;
+	int rc;
 
 	data_len = RMNET_MAP_GET_LENGTH(skb);
 
@@ -604,13 +780,28 @@ int rmnet_map_checksum_downlink_packet(struct sk_buff *skb)
 
 	ip_version = (*map_payload & 0xF0) >> 4;
 	if (ip_version == 0x04)
-		return rmnet_map_validate_ipv4_packet_checksum(map_payload,
+		rc = rmnet_map_validate_ipv4_packet_checksum(map_payload,
 			cksum_trailer);
 	else if (ip_version == 0x06)
-		return rmnet_map_validate_ipv6_packet_checksum(map_payload,
-			cksum_trailer);
+		rc = rmnet_map_validate_ipv6_packet_checksum(map_payload,
+			cksum_trailer, data_len);
+	else
+		return RMNET_MAP_CHECKSUM_ERR_UNKNOWN_IP_VERSION;
+
+	switch (rc) {
+	case RMNET_MAP_CHECKSUM_FRAGMENTED_PACKET:
+	case RMNET_MAP_CHECKSUM_ERR_UNKNOWN_TRANSPORT:
+	case RMNET_MAP_CHECKSUM_ERR_EXTHDR:
+		/* The hardware summed the IP packet, which is where skb->data
+		 * will point once the MAP header is pulled.
+		 */
+		skb->csum = (__force __wsum)(u16)
+			    ~(__force u16)cksum_trailer->checksum_value;
+		skb->ip_summed = CHECKSUM_COMPLETE;
+		break;
+	}
 
-	return RMNET_MAP_CHECKSUM_ERR_UNKNOWN_IP_VERSION;
+	return rc;
 }
 
 static void rmnet_map_fill_ipv4_packet_ul_checksum_header
@@ -636,9 +827,8 @@ static void rmnet_map_fill_ipv4_packet_ul_checksum_header
 
 static void rmnet_map_fill_ipv6_packet_ul_checksum_header
 	(void *iphdr, struct rmnet_map_ul_checksum_header_s *ul_header,
-	 struct sk_buff *skb)
+	 struct sk_buff *skb, u8 proto)
 {
-	struct ipv6hdr *ip6h = (struct ipv6hdr *)iphdr;
 	unsigned short *hdr = (unsigned short *)ul_header;
 
 	ul_header->checksum_start_offset = htons((unsigned short)
@@ -646,7 +836,7 @@ static void rmnet_map_fill_ipv6_packet_ul_checksum_header
 	ul_header->checksum_insert_offset = skb->csum_offset;
 	ul_header->cks_en = 1;
 
-	if (ip6h->nexthdr == IPPROTO_UDP)
+	if (proto == IPPROTO_UDP)
 		ul_header->udp_ind = 1;
 	else
 		ul_header->udp_ind = 0;
@@ -672,19 +862,34 @@ static void rmnet_map_complement_ipv4_txporthdr_csum_field(void *iphdr)
 	}
 }
 
-static void rmnet_map_complement_ipv6_txporthdr_csum_field(void *ip6hdr)
+static void rmnet_map_complement_ipv6_txporthdr_csum_field(struct sk_buff *skb,
+							   u8 proto)
 {
-	struct ipv6hdr *ip6h = (struct ipv6hdr *)ip6hdr;
-	void *txporthdr;
 	u16 *csum;
 
-	txporthdr = ip6hdr + sizeof(struct ipv6hdr);
+	csum = rmnet_map_get_checksum_field(proto, skb_transport_header(skb));
+	*csum = ~(*csum);
+}
 
-	if ((ip6h->nexthdr == IPPROTO_TCP) || (ip6h->nexthdr == IPPROTO_UDP)) {
-		csum = (u16 *)rmnet_map_get_checksum_field(ip6h->nexthdr,
-								txporthdr);
-		*csum = ~(*csum);
-	}
+/* Find the transport protocol past any IPv6 extension headers; the transport
+ * header offset the stack set up must agree with the walk.
+ */
+static int rmnet_map_ul_ipv6_proto(struct sk_buff *skb, void *iphdr, u8 *proto)
+{
+	int start = (unsigned char *)iphdr - skb->data;
+	__be16 frag_off;
+	int thoff;
+
+	*proto = ((struct ipv6hdr *)iphdr)->nexthdr;
+	thoff = ipv6_skip_exthdr(skb, start + sizeof(struct ipv6hdr), proto,
+				 &frag_off);
+	if (thoff < 0 || thoff != skb_transport_offset(skb))
+		return RMNET_MAP_CHECKSUM_ERR_EXTHDR;
+	if (*proto != IPPROTO_TCP && *proto != IPPROTO_UDP)
+		return RMNET_MAP_CHECKSUM_ERR_UNKNOWN_TRANSPORT;
+	if (thoff != start + sizeof(struct ipv6hdr))
+		rmnet_stats_csum_offload(RMNET_STATS_CSUM_UL_HW_EXTHDR);
+	return RMNET_MAP_CHECKSUM_OK;
 }
 
 /* rmnet_map_checksum_uplink_packet() - Generates UL checksum
@@ -694,9 +899,16 @@ static void rmnet_map_complement_ipv6_txporthdr_csum_field(void *ip6hdr)
  * Generates UL checksum meta info header for IPv4 and IPv6  over TCP and UDP
  * packets that are supported for UL checksum offload.
  *
+ * Packets that cannot be offloaded but still need a checksum have it
+ * computed here.
+ *
  * Return:
  *   - RMNET_MAP_CHECKSUM_OK: Validation of checksum succeeded.
  *   - RMNET_MAP_CHECKSUM_ERR_UNKNOWN_IP_VERSION: Unrecognized IP header.
+ *   - RMNET_MAP_CHECKSUM_ERR_UNKNOWN_TRANSPORT: IPv6 transport is not
+ *						   TCP/UDP.
+ *   - RMNET_MAP_CHECKSUM_ERR_EXTHDR: IPv6 extension headers do not lead to
+ *				       the transport header.
  *   - RMNET_MAP_CHECKSUM_SW: Unsupported packet for UL checksum offload.
  */
 int rmnet_map_checksum_uplink_packet(struct sk_buff *skb,
@@ -706,6 +918,7 @@ int rmnet_map_checksum_uplink_packet(struct sk_buff *skb,
 	unsigned char ip_version;
 	struct rmnet_map_ul_checksum_header_s *ul_header;
 	void *iphdr;
+	u8 proto;
 	int ret;
 
 	ul_header = (struct rmnet_map_ul_checksum_header_s *)
@@ -731,12 +944,15 @@ int rmnet_map_checksum_uplink_packet(struct sk_buff *skb,
 			ret = RMNET_MAP_CHECKSUM_OK;
 			goto done;
 		} else if (ip_version == 0x06) {
+			ret = rmnet_map_ul_ipv6_proto(skb, iphdr, &proto);
+			if (ret != RMNET_MAP_CHECKSUM_OK)
+				goto sw_checksum;
 			rmnet_map_fill_ipv6_packet_ul_checksum_header
-				(iphdr, ul_header, skb);
+				(iphdr, ul_header, skb, proto);
 			if (egress_data_format &
 			    RMNET_EGRESS_FORMAT_MAP_CKSUMV4)
 				rmnet_map_complement_ipv6_txporthdr_csum_field(
-					iphdr);
+					skb, proto);
 			ret =  RMNET_MAP_CHECKSUM_OK;
 			goto done;
 		} else {
@@ -753,15 +969,62 @@ int rmnet_map_checksum_uplink_packet(struct sk_buff *skb,
 	ul_header->checksum_insert_offset = 0;
 	ul_header->cks_en = 0;
 	ul_header->udp_ind = 0;
+	/* skb_checksum_help() may reallocate; the header is already set */
+	if (skb->ip_summed == CHECKSUM_PARTIAL && skb_checksum_help(skb))
+		LOGD("UL software checksum failed on %s", orig_dev->name);
 done:
 	return ret;
 }
 
+/* rmnet_map_is_tcp_pure_ack() - Check for a TCP segment with only an ACK
+ * @skb:        Egress packet with its MAP header
+ * @offset:     Offset of the IP header
+ *
+ * The peer's sending rate is clocked by these, so they should not wait in
+ * the aggregation buffer.
+ */
+static int rmnet_map_is_tcp_pure_ack(struct sk_buff *skb, int offset)
+{
+	unsigned char *packet_start = skb->data + offset;
+	unsigned int iphlen, len;
+	struct tcphdr *tp;
+
+	if ((skb->data[offset]) >> 4 == 0x04) {
+		struct iphdr *ip4h = (struct iphdr *)(packet_start);
+
+		if (ip4h->protocol != IPPROTO_TCP || ip_is_fragment(ip4h))
+			return 0;
+		iphlen = ip4h->ihl * 4;
+		len = ntohs(ip4h->tot_len);
+	} else if ((skb->data[offset]) >> 4 == 0x06) {
+		struct ipv6hdr *ip6h = (struct ipv6hdr *)(packet_start);
+
+		if (ip6h->nexthdr != IPPROTO_TCP)
+			return 0;
+		iphlen = sizeof(struct ipv6hdr);
+		len = iphlen + ntohs(ip6h->payload_len);
+	} else {
+		return 0;
+	}
+
+	if (skb_headlen(skb) < offset + iphlen + sizeof(struct tcphdr))
+		return 0;
+
+	tp = (struct tcphdr *)(packet_start + iphlen);
+	return tp->ack && !tp->syn && !tp->fin && !tp->rst &&
+	       len == iphlen + tp->doff * 4;
+}
+
 int rmnet_ul_aggregation_skip(struct sk_buff *skb, int offset)
 {
 	unsigned char *packet_start = skb->data + offset;
 	int is_icmp = 0;
 
+	if (agg_skip_tcp_ack && rmnet_map_is_tcp_pure_ack(skb, offset)) {
+		rmnet_stats_agg_skip_tcp_ack();
+		return 1;
+	}
+
 	if ((skb->data[offset]) >> 4 == 0x04) {
 		struct iphdr *ip4h = (struct iphdr *)(packet_start);
 
@@ -33,6 +33,8 @@
 #include <linux/slab.h>
 #include <linux/printk.h>
 #include <linux/sched.h>
+#include <linux/debugfs.h>
+#include <linux/seq_file.h>
 
 #include "pfk_kc.h"
 #include "pfk_ice.h"
@@ -111,6 +113,30 @@ struct kc_entry {
 
 static struct kc_entry kc_table[PFK_KC_TABLE_SIZE];
 
+/**
+ * struct pfk_kc_stats - key slot usage, shared by all ICE users
+ * @hits: key found already programmed in a slot
+ * @loads: key programmed into a slot
+ * @evictions: loads that replaced another key in an inactive slot
+ * @deferred: async lookups that missed and were punted to a sleepable
+ *	      context
+ * @busy: loads with every slot in use
+ * @errors: failed loads
+ *
+ * A high evictions to hits ratio means the slots are thrashing.
+ */
+struct pfk_kc_stats {
+	u64 hits;
+	u64 loads;
+	u64 evictions;
+	u64 deferred;
+	u64 busy;
+	u64 errors;
+};
+
+static struct pfk_kc_stats kc_stats;
+static struct dentry *kc_debugfs;
+
 /**
  * kc_is_ready() - driver is initialized and ready.
  *
@@ -430,6 +456,53 @@ static int kc_update_entry(struct kc_entry *entry, const unsigned char *key,
 	return ret;
 }
 
+static int pfk_kc_stats_show(struct seq_file *s, void *unused)
+{
+	struct pfk_kc_stats stats;
+	int nr_free = 0, nr_active = 0, i;
+
+	kc_spin_lock();
+	stats = kc_stats;
+	for (i = 0; i < PFK_KC_TABLE_SIZE; i++) {
+		switch (kc_entry_at_index(i)->state) {
+		case FREE:
+			nr_free++;
+			break;
+		case ACTIVE_ICE_PRELOAD:
+		case ACTIVE_ICE_LOADED:
+			nr_active++;
+			break;
+		default:
+			break;
+		}
+	}
+	kc_spin_unlock();
+
+	seq_printf(s, "storage:   %s\n", s_type);
+	seq_printf(s, "slots:     %d (%d free, %d active)\n",
+		   PFK_KC_TABLE_SIZE, nr_free, nr_active);
+	seq_printf(s, "hits:      %llu\n", stats.hits);
+	seq_printf(s, "loads:     %llu\n", stats.loads);
+	seq_printf(s, "evictions: %llu\n", stats.evictions);
+	seq_printf(s, "deferred:  %llu\n", stats.deferred);
+	seq_printf(s, "busy:      %llu\n", stats.busy);
+	seq_printf(s, "errors:    %llu\n", stats.errors);
+
+	return 0;
+}
+
+static int pfk_kc_stats_open(struct inode *inode, struct file *file)
+{
+	return single_open(file, pfk_kc_stats_show, NULL);
+}
+
+static const struct file_operations pfk_kc_stats_fops = {
+	.open		= pfk_kc_stats_open,
+	.read		= seq_read,
+	.llseek		= seq_lseek,
+	.release	= single_release,
+};
+
 /**
  * pfk_kc_init() - init function
  *
@@ -448,6 +521,10 @@ int pfk_kc_init(void)
 	kc_ready = true;
 	kc_spin_unlock();
 
+	/* stats are best effort, the cache works without them */
+	kc_debugfs = debugfs_create_file("pfk_kc_stats", 0444, NULL, NULL,
+					 &pfk_kc_stats_fops);
+
 	return 0;
 }
 
@@ -461,6 +538,9 @@ int pfk_kc_deinit(void)
 	int res = pfk_kc_clear();
 	kc_ready = false;
 
+	debugfs_remove(kc_debugfs);
+	kc_debugfs = NULL;
+
 	return res;
 }
 
@@ -520,6 +600,7 @@ int pfk_kc_load_key_start(const unsigned char *key, size_t key_size,
 	if (!entry) {
 		if (async) {
 			pr_debug("%s task will populate entry\n", __func__);
+			kc_stats.deferred++;
 			kc_spin_unlock();
 			return -EAGAIN;
 		}
@@ -530,6 +611,7 @@ int pfk_kc_load_key_start(const unsigned char *key, size_t key_size,
 			 * return EBUSY to upper layers so that the
 			 * request will be rescheduled
 			 */
+			kc_stats.busy++;
 			kc_spin_unlock();
 			return -EBUSY;
 		}
@@ -543,6 +625,7 @@ int pfk_kc_load_key_start(const unsigned char *key, size_t key_size,
 	switch (entry->state) {
 	case (INACTIVE):
 		if (entry_exists) {
+			kc_stats.hits++;
 			kc_update_timestamp(entry);
 			entry->state = ACTIVE_ICE_LOADED;
 
@@ -554,10 +637,14 @@ int pfk_kc_load_key_start(const unsigned char *key, size_t key_size,
 			}
 			break;
 		}
+		kc_stats.evictions++;
+		/* fall through */
 	case (FREE):
 		ret = kc_update_entry(entry, key, key_size, salt, salt_size,
 					data_unit, ice_rev);
+		kc_stats.loads++;
 		if (ret) {
+			kc_stats.errors++;
 			entry->state = SCM_ERROR;
 			entry->scm_error = ret;
 			pr_err("%s: key load error (%d)\n", __func__, ret);
@@ -583,6 +670,7 @@ int pfk_kc_load_key_start(const unsigned char *key, size_t key_size,
 		ret = -EAGAIN;
 		break;
 	case (ACTIVE_ICE_LOADED):
+		kc_stats.hits++;
 		kc_update_timestamp(entry);
 
 		if (!strcmp(s_type, (char *)PFK_UFS)) {
@@ -36,6 +36,7 @@
 
 #define AVC_CACHE_SLOTS			512
 #define AVC_DEF_CACHE_THRESHOLD		512
+#define AVC_MAX_CACHE_THRESHOLD		8192
 #define AVC_CACHE_RECLAIM		16
 
 #ifdef CONFIG_SECURITY_SELINUX_AVC_STATS
@@ -56,6 +57,7 @@ struct avc_node {
 	struct avc_entry	ae;
 	struct hlist_node	list; /* anchored in avc_cache->slots[i] */
 	struct rcu_head		rhead;
+	bool			referenced; /* hit since the last reclaim scan */
 };
 
 struct avc_xperms_decision_node {
@@ -185,6 +187,15 @@ void __init avc_init(void)
 	atomic_set(&avc_cache.active_nodes, 0);
 	atomic_set(&avc_cache.lru_hint, 0);
 
+	/*
+	 * Scale the default threshold with memory, one node per 2MB, so that
+	 * big systems with many domains don't keep evicting hot entries. It
+	 * can still be changed at runtime through selinuxfs.
+	 */
+	avc_cache_threshold = clamp_t(unsigned int, totalram_pages >> 9,
+				      AVC_DEF_CACHE_THRESHOLD,
+				      AVC_MAX_CACHE_THRESHOLD);
+
 	avc_node_cachep = kmem_cache_create("avc_node", sizeof(struct avc_node),
 					0, SLAB_PANIC, NULL);
 	avc_xperms_cachep = kmem_cache_create("avc_xperms_node",
@@ -512,6 +523,11 @@ static void avc_node_replace(struct avc_node *new, struct avc_node *old)
 	atomic_dec(&avc_cache.active_nodes);
 }
 
+/*
+ * Reclaim gives nodes looked up since the previous scan a second chance,
+ * unless the cache has grown to twice its threshold because everything in
+ * it keeps being used.
+ */
 static inline int avc_reclaim_node(void)
 {
 	struct avc_node *node;
@@ -519,6 +535,9 @@ static inline int avc_reclaim_node(void)
 	unsigned long flags;
 	struct hlist_head *head;
 	spinlock_t *lock;
+	bool force;
+
+	force = atomic_read(&avc_cache.active_nodes) > 2 * avc_cache_threshold;
 
 	for (try = 0, ecx = 0; try < AVC_CACHE_SLOTS; try++) {
 		hvalue = atomic_inc_return(&avc_cache.lru_hint) & (AVC_CACHE_SLOTS - 1);
@@ -530,6 +549,10 @@ static inline int avc_reclaim_node(void)
 
 		rcu_read_lock();
 		hlist_for_each_entry(node, head, list) {
+			if (node->referenced && !force) {
+				WRITE_ONCE(node->referenced, false);
+				continue;
+			}
 			avc_node_delete(node);
 			avc_cache_stats_incr(reclaims);
 			ecx++;
@@ -611,8 +634,12 @@ static struct avc_node *avc_lookup(u32 ssid, u32 tsid, u16 tclass)
 	avc_cache_stats_incr(lookups);
 	node = avc_search_node(ssid, tsid, tclass);
 
-	if (node)
+	if (node) {
+		/* only dirty the cacheline when the bit actually changes */
+		if (!READ_ONCE(node->referenced))
+			WRITE_ONCE(node->referenced, true);
 		return node;
+	}
 
 	avc_cache_stats_incr(misses);
 	return NULL;
@@ -1036,8 +1063,10 @@ int avc_has_extended_perms(u32 ssid, u32 tsid, u16 tclass, u32 requested,
 	local_xpd.auditallow = &auditallow;
 	local_xpd.dontaudit = &dontaudit;
 
+	avc_cache_stats_incr(xperms_lookups);
 	xpd = avc_xperms_decision_lookup(driver, xp_node);
 	if (unlikely(!xpd)) {
+		avc_cache_stats_incr(xperms_misses);
 		/*
 		 * Compute the extended_perms_decision only if the driver
 		 * is flagged
@@ -44,6 +44,8 @@ struct avc_cache_stats {
 	unsigned int allocations;
 	unsigned int reclaims;
 	unsigned int frees;
+	unsigned int xperms_lookups;
+	unsigned int xperms_misses;
 };
 
 /*
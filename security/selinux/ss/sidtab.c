@@ -7,6 +7,8 @@
 #include <linux/slab.h>
 #include <linux/spinlock.h>
 #include <linux/errno.h>
+#include <linux/jhash.h>
+#include <linux/rcupdate.h>
 #include "flask.h"
 #include "security.h"
 #include "sidtab.h"
@@ -14,15 +16,42 @@
 #define SIDTAB_HASH(sid) \
 (sid & SIDTAB_HASH_MASK)
 
-int sidtab_init(struct sidtab *s)
+/*
+ * Hash everything context_cmp() looks at, equal ebitmaps have identical
+ * node lists so the category maps can be hashed as they are laid out.
+ */
+static u32 sidtab_context_hash(struct context *c)
 {
+	struct ebitmap_node *n;
+	u32 hash;
 	int i;
 
-	s->htable = kmalloc(sizeof(*(s->htable)) * SIDTAB_SIZE, GFP_ATOMIC);
+	if (c->len)
+		return jhash(c->str, c->len, 0) & SIDTAB_HASH_MASK;
+
+	hash = jhash_3words(c->user, c->role, c->type, 0);
+	for (i = 0; i < 2; i++) {
+		hash = jhash_1word(c->range.level[i].sens, hash);
+		for (n = c->range.level[i].cat.node; n; n = n->next)
+			hash = jhash(n->maps, sizeof(n->maps),
+				     hash ^ n->startbit);
+	}
+
+	return hash & SIDTAB_HASH_MASK;
+}
+
+int sidtab_init(struct sidtab *s)
+{
+	s->htable = kcalloc(SIDTAB_SIZE, sizeof(*(s->htable)), GFP_ATOMIC);
 	if (!s->htable)
 		return -ENOMEM;
-	for (i = 0; i < SIDTAB_SIZE; i++)
-		s->htable[i] = NULL;
+	s->ctx_htable = kcalloc(SIDTAB_SIZE, sizeof(*(s->ctx_htable)),
+				GFP_ATOMIC);
+	if (!s->ctx_htable) {
+		kfree(s->htable);
+		s->htable = NULL;
+		return -ENOMEM;
+	}
 	s->nel = 0;
 	s->next_sid = 1;
 	s->shutdown = 0;
@@ -65,16 +94,19 @@ int sidtab_insert(struct sidtab *s, u32 sid, struct context *context)
 		goto out;
 	}
 
+	/* Lookups walk both chains locklessly, publish fully set up nodes */
 	if (prev) {
 		newnode->next = prev->next;
-		wmb();
-		prev->next = newnode;
+		rcu_assign_pointer(prev->next, newnode);
 	} else {
 		newnode->next = s->htable[hvalue];
-		wmb();
-		s->htable[hvalue] = newnode;
+		rcu_assign_pointer(s->htable[hvalue], newnode);
 	}
 
+	hvalue = sidtab_context_hash(&newnode->context);
+	newnode->ctx_next = s->ctx_htable[hvalue];
+	rcu_assign_pointer(s->ctx_htable[hvalue], newnode);
+
 	s->nel++;
 	if (sid >= s->next_sid)
 		s->next_sid = sid + 1;
@@ -91,9 +123,9 @@ static struct context *sidtab_search_core(struct sidtab *s, u32 sid, int force)
 		return NULL;
 
 	hvalue = SIDTAB_HASH(sid);
-	cur = s->htable[hvalue];
+	cur = rcu_dereference_raw(s->htable[hvalue]);
 	while (cur && sid > cur->sid)
-		cur = cur->next;
+		cur = rcu_dereference_raw(cur->next);
 
 	if (force && cur && sid == cur->sid && cur->context.len)
 		return &cur->context;
@@ -102,9 +134,9 @@ static struct context *sidtab_search_core(struct sidtab *s, u32 sid, int force)
 		/* Remap invalid SIDs to the unlabeled SID. */
 		sid = SECINITSID_UNLABELED;
 		hvalue = SIDTAB_HASH(sid);
-		cur = s->htable[hvalue];
+		cur = rcu_dereference_raw(s->htable[hvalue]);
 		while (cur && sid > cur->sid)
-			cur = cur->next;
+			cur = rcu_dereference_raw(cur->next);
 		if (!cur || sid != cur->sid)
 			return NULL;
 	}
@@ -147,49 +179,48 @@ int sidtab_map(struct sidtab *s,
 	return rc;
 }
 
-static void sidtab_update_cache(struct sidtab *s, struct sidtab_node *n, int loc)
+/*
+ * Contexts are converted in place on policy reload, which changes their
+ * hash. The table isn't visible to anybody else at that point, so the
+ * context chains can simply be rebuilt.
+ */
+int sidtab_convert(struct sidtab *s,
+		   int (*convert) (u32 sid,
+				   struct context *context,
+				   void *args),
+		   void *args)
 {
-	BUG_ON(loc >= SIDTAB_CACHE_LEN);
+	int i, hvalue, rc;
+	struct sidtab_node *cur;
 
-	while (loc > 0) {
-		s->cache[loc] = s->cache[loc - 1];
-		loc--;
-	}
-	s->cache[0] = n;
-}
+	rc = sidtab_map(s, convert, args);
+	if (rc)
+		return rc;
 
-static inline u32 sidtab_search_context(struct sidtab *s,
-						  struct context *context)
-{
-	int i;
-	struct sidtab_node *cur;
+	for (i = 0; i < SIDTAB_SIZE; i++)
+		s->ctx_htable[i] = NULL;
 
 	for (i = 0; i < SIDTAB_SIZE; i++) {
-		cur = s->htable[i];
-		while (cur) {
-			if (context_cmp(&cur->context, context)) {
-				sidtab_update_cache(s, cur, SIDTAB_CACHE_LEN - 1);
-				return cur->sid;
-			}
-			cur = cur->next;
+		for (cur = s->htable[i]; cur; cur = cur->next) {
+			hvalue = sidtab_context_hash(&cur->context);
+			cur->ctx_next = s->ctx_htable[hvalue];
+			s->ctx_htable[hvalue] = cur;
 		}
 	}
+
 	return 0;
 }
 
-static inline u32 sidtab_search_cache(struct sidtab *s, struct context *context)
+static inline u32 sidtab_search_context(struct sidtab *s,
+						  struct context *context)
 {
-	int i;
-	struct sidtab_node *node;
-
-	for (i = 0; i < SIDTAB_CACHE_LEN; i++) {
-		node = s->cache[i];
-		if (unlikely(!node))
-			return 0;
-		if (context_cmp(&node->context, context)) {
-			sidtab_update_cache(s, node, i);
-			return node->sid;
-		}
+	struct sidtab_node *cur;
+
+	cur = rcu_dereference_raw(s->ctx_htable[sidtab_context_hash(context)]);
+	while (cur) {
+		if (context_cmp(&cur->context, context))
+			return cur->sid;
+		cur = rcu_dereference_raw(cur->ctx_next);
 	}
 	return 0;
 }
@@ -204,9 +235,7 @@ int sidtab_context_to_sid(struct sidtab *s,
 
 	*out_sid = SECSID_NULL;
 
-	sid  = sidtab_search_cache(s, context);
-	if (!sid)
-		sid = sidtab_search_context(s, context);
+	sid = sidtab_search_context(s, context);
 	if (!sid) {
 		spin_lock_irqsave(&s->lock, flags);
 		/* Rescan now that we hold the lock. */
@@ -239,11 +268,12 @@ int sidtab_context_to_sid(struct sidtab *s,
 
 void sidtab_hash_eval(struct sidtab *h, char *tag)
 {
-	int i, chain_len, slots_used, max_chain_len;
+	int i, chain_len, slots_used, max_chain_len, max_ctx_chain_len;
 	struct sidtab_node *cur;
 
 	slots_used = 0;
 	max_chain_len = 0;
+	max_ctx_chain_len = 0;
 	for (i = 0; i < SIDTAB_SIZE; i++) {
 		cur = h->htable[i];
 		if (cur) {
@@ -257,11 +287,18 @@ void sidtab_hash_eval(struct sidtab *h, char *tag)
 			if (chain_len > max_chain_len)
 				max_chain_len = chain_len;
 		}
+
+		chain_len = 0;
+		for (cur = h->ctx_htable[i]; cur; cur = cur->ctx_next)
+			chain_len++;
+		if (chain_len > max_ctx_chain_len)
+			max_ctx_chain_len = chain_len;
 	}
 
 	printk(KERN_DEBUG "%s:  %d entries and %d/%d buckets used, longest "
-	       "chain length %d\n", tag, h->nel, slots_used, SIDTAB_SIZE,
-	       max_chain_len);
+	       "chain length %d, longest context chain length %d\n", tag,
+	       h->nel, slots_used, SIDTAB_SIZE, max_chain_len,
+	       max_ctx_chain_len);
 }
 
 void sidtab_destroy(struct sidtab *s)
@@ -284,6 +321,8 @@ void sidtab_destroy(struct sidtab *s)
 	}
 	kfree(s->htable);
 	s->htable = NULL;
+	kfree(s->ctx_htable);
+	s->ctx_htable = NULL;
 	s->nel = 0;
 	s->next_sid = 1;
 }
@@ -291,15 +330,13 @@ void sidtab_destroy(struct sidtab *s)
 void sidtab_set(struct sidtab *dst, struct sidtab *src)
 {
 	unsigned long flags;
-	int i;
 
 	spin_lock_irqsave(&src->lock, flags);
 	dst->htable = src->htable;
+	dst->ctx_htable = src->ctx_htable;
 	dst->nel = src->nel;
 	dst->next_sid = src->next_sid;
 	dst->shutdown = 0;
-	for (i = 0; i < SIDTAB_CACHE_LEN; i++)
-		dst->cache[i] = NULL;
 	spin_unlock_irqrestore(&src->lock, flags);
 }
 
@@ -13,9 +13,10 @@ struct sidtab_node {
 	u32 sid;		/* security identifier */
 	struct context context;	/* security context structure */
 	struct sidtab_node *next;
+	struct sidtab_node *ctx_next;	/* next node with the same context hash */
 };
 
-#define SIDTAB_HASH_BITS 7
+#define SIDTAB_HASH_BITS 9
 #define SIDTAB_HASH_BUCKETS (1 << SIDTAB_HASH_BITS)
 #define SIDTAB_HASH_MASK (SIDTAB_HASH_BUCKETS-1)
 
@@ -23,11 +24,10 @@ struct sidtab_node {
 
 struct sidtab {
 	struct sidtab_node **htable;
+	struct sidtab_node **ctx_htable;	/* the same nodes, by context */
 	unsigned int nel;	/* number of elements */
 	unsigned int next_sid;	/* next SID to allocate */
 	unsigned char shutdown;
-#define SIDTAB_CACHE_LEN	3
-	struct sidtab_node *cache[SIDTAB_CACHE_LEN];
 	spinlock_t lock;
 };
 
@@ -42,6 +42,12 @@ int sidtab_map(struct sidtab *s,
 			     void *args),
 	       void *args);
 
+int sidtab_convert(struct sidtab *s,
+		   int (*convert) (u32 sid,
+				   struct context *context,
+				   void *args),
+		   void *args);
+
 int sidtab_context_to_sid(struct sidtab *s,
 			  struct context *context,
 			  u32 *sid);
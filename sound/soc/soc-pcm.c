@@ -26,6 +26,7 @@
 #include <linux/export.h>
 #include <linux/debugfs.h>
 #include <linux/dma-mapping.h>
+#include <linux/ktime.h>
 #include <sound/core.h>
 #include <sound/pcm.h>
 #include <sound/pcm_params.h>
@@ -2108,6 +2109,19 @@ int dpcm_fe_dai_hw_params_be(struct snd_soc_pcm_runtime *fe,
 	return ret;
 }
 
+static void dpcm_op_time_account(struct snd_soc_pcm_runtime *fe, int stream,
+				 enum snd_soc_dpcm_op op, ktime_t start)
+{
+	struct snd_soc_dpcm_op_time *t = &fe->dpcm[stream].op_time[op];
+	u64 ns = ktime_to_ns(ktime_sub(ktime_get(), start));
+
+	t->last_ns = ns;
+	if (ns > t->max_ns)
+		t->max_ns = ns;
+	t->total_ns += ns;
+	t->count++;
+}
+
 int dpcm_be_dai_hw_params(struct snd_soc_pcm_runtime *fe, int stream)
 {
 	struct snd_soc_dpcm *dpcm;
@@ -2148,6 +2162,21 @@ int dpcm_be_dai_hw_params(struct snd_soc_pcm_runtime *fe, int stream)
 		    (be->dpcm[stream].state != SND_SOC_DPCM_STATE_HW_FREE))
 			continue;
 
+		/*
+		 * Userspace commonly repeats hw_params() before prepare();
+		 * a BE that already runs with these params is left alone.
+		 * Once it has been freed or prepared the state no longer
+		 * matches and the BE is configured again.
+		 */
+		if (be->dpcm[stream].state == SND_SOC_DPCM_STATE_HW_PARAMS &&
+		    !memcmp(&be->dpcm[stream].hw_params, &dpcm->hw_params,
+			    sizeof(struct snd_pcm_hw_params))) {
+			dev_dbg(be->dev, "ASoC: hw_params BE %s unchanged\n",
+				be->dai_link->name);
+			fe->dpcm[stream].be_hw_params_cached++;
+			continue;
+		}
+
 		dev_dbg(be->dev, "ASoC: hw_params BE %s\n",
 			be->dai_link->name);
 
@@ -2158,6 +2187,8 @@ int dpcm_be_dai_hw_params(struct snd_soc_pcm_runtime *fe, int stream)
 			goto unwind;
 		}
 
+		memcpy(&be->dpcm[stream].hw_params, &dpcm->hw_params,
+				sizeof(struct snd_pcm_hw_params));
 		be->dpcm[stream].state = SND_SOC_DPCM_STATE_HW_PARAMS;
 	}
 	return 0;
@@ -2193,8 +2224,10 @@ static int dpcm_fe_dai_hw_params(struct snd_pcm_substream *substream,
 {
 	struct snd_soc_pcm_runtime *fe = substream->private_data;
 	int ret, stream = substream->stream;
+	ktime_t start;
 
 	mutex_lock_nested(&fe->card->mutex, SND_SOC_CARD_CLASS_RUNTIME);
+	start = ktime_get();
 	dpcm_set_fe_update_state(fe, stream, SND_SOC_DPCM_UPDATE_FE);
 
 	memcpy(&fe->dpcm[substream->stream].hw_params, params,
@@ -2219,6 +2252,7 @@ static int dpcm_fe_dai_hw_params(struct snd_pcm_substream *substream,
 
 out:
 	dpcm_set_fe_update_state(fe, stream, SND_SOC_DPCM_UPDATE_NO);
+	dpcm_op_time_account(fe, stream, SND_SOC_DPCM_OP_HW_PARAMS, start);
 	mutex_unlock(&fe->card->mutex);
 	return ret;
 }
@@ -2372,6 +2406,7 @@ static int dpcm_fe_dai_do_trigger(struct snd_pcm_substream *substream, int cmd)
 	int stream = substream->stream;
 	int ret = 0;
 	enum snd_soc_dpcm_trigger trigger = fe->dai_link->trigger[stream];
+	ktime_t start = ktime_get();
 
 	fe->dpcm[stream].runtime_update = SND_SOC_DPCM_UPDATE_FE;
 
@@ -2450,6 +2485,7 @@ static int dpcm_fe_dai_do_trigger(struct snd_pcm_substream *substream, int cmd)
 
 out:
 	fe->dpcm[stream].runtime_update = SND_SOC_DPCM_UPDATE_NO;
+	dpcm_op_time_account(fe, stream, SND_SOC_DPCM_OP_TRIGGER, start);
 	return ret;
 }
 
@@ -2617,8 +2653,10 @@ static int dpcm_fe_dai_prepare(struct snd_pcm_substream *substream)
 	struct snd_soc_dpcm *dpcm;
 	int stream = substream->stream, ret = 0;
 	ASYNC_DOMAIN_EXCLUSIVE(async_domain);
+	ktime_t start;
 
 	mutex_lock_nested(&fe->card->mutex, SND_SOC_CARD_CLASS_RUNTIME);
+	start = ktime_get();
 
 	fe->err_ops = 0;
 
@@ -2683,6 +2721,7 @@ static int dpcm_fe_dai_prepare(struct snd_pcm_substream *substream)
 
 out:
 	dpcm_set_fe_update_state(fe, stream, SND_SOC_DPCM_UPDATE_NO);
+	dpcm_op_time_account(fe, stream, SND_SOC_DPCM_OP_PREPARE, start);
 	mutex_unlock(&fe->card->mutex);
 
 	return ret;
@@ -3434,6 +3473,73 @@ static const struct file_operations dpcm_state_fops = {
 	.llseek = default_llseek,
 };
 
+static const char * const dpcm_op_names[SND_SOC_DPCM_OP_NUM] = {
+	[SND_SOC_DPCM_OP_HW_PARAMS]	= "hw_params",
+	[SND_SOC_DPCM_OP_PREPARE]	= "prepare",
+	[SND_SOC_DPCM_OP_TRIGGER]	= "trigger",
+};
+
+static ssize_t dpcm_show_timing(struct snd_soc_pcm_runtime *fe,
+				int stream, char *buf, size_t size)
+{
+	struct snd_soc_dpcm_runtime *dpcm = &fe->dpcm[stream];
+	ssize_t offset = 0;
+	int op;
+
+	offset += scnprintf(buf + offset, size - offset,
+			"[%s - %s]\n", fe->dai_link->name,
+			stream ? "Capture" : "Playback");
+
+	for (op = 0; op < SND_SOC_DPCM_OP_NUM; op++) {
+		struct snd_soc_dpcm_op_time *t = &dpcm->op_time[op];
+
+		offset += scnprintf(buf + offset, size - offset,
+				"%-10s count %lu last_us %llu max_us %llu avg_us %llu\n",
+				dpcm_op_names[op], t->count,
+				div_u64(t->last_ns, NSEC_PER_USEC),
+				div_u64(t->max_ns, NSEC_PER_USEC),
+				t->count ? div64_u64(t->total_ns,
+					(u64)t->count * NSEC_PER_USEC) : 0);
+	}
+
+	offset += scnprintf(buf + offset, size - offset,
+			"BE hw_params unchanged: %lu\n",
+			dpcm->be_hw_params_cached);
+
+	return offset;
+}
+
+static ssize_t dpcm_timing_read_file(struct file *file, char __user *user_buf,
+				size_t count, loff_t *ppos)
+{
+	struct snd_soc_pcm_runtime *fe = file->private_data;
+	ssize_t out_count = PAGE_SIZE, offset = 0, ret = 0;
+	char *buf;
+
+	buf = kmalloc(out_count, GFP_KERNEL);
+	if (!buf)
+		return -ENOMEM;
+
+	if (fe->cpu_dai->driver->playback.channels_min)
+		offset += dpcm_show_timing(fe, SNDRV_PCM_STREAM_PLAYBACK,
+					buf + offset, out_count - offset);
+
+	if (fe->cpu_dai->driver->capture.channels_min)
+		offset += dpcm_show_timing(fe, SNDRV_PCM_STREAM_CAPTURE,
+					buf + offset, out_count - offset);
+
+	ret = simple_read_from_buffer(user_buf, count, ppos, buf, offset);
+
+	kfree(buf);
+	return ret;
+}
+
+static const struct file_operations dpcm_timing_fops = {
+	.open = simple_open,
+	.read = dpcm_timing_read_file,
+	.llseek = default_llseek,
+};
+
 void soc_dpcm_debugfs_add(struct snd_soc_pcm_runtime *rtd)
 {
 	if (!rtd->dai_link)
@@ -3454,5 +3560,8 @@ void soc_dpcm_debugfs_add(struct snd_soc_pcm_runtime *rtd)
 	rtd->debugfs_dpcm_state = debugfs_create_file("state", 0444,
 						rtd->debugfs_dpcm_root,
 						rtd, &dpcm_state_fops);
+	rtd->debugfs_dpcm_timing = debugfs_create_file("timing", 0444,
+						rtd->debugfs_dpcm_root,
+						rtd, &dpcm_timing_fops);
 }
 #endif
@@ -18,6 +18,7 @@
 #include <linux/printk.h>
 #include <linux/ratelimit.h>
 #include <linux/debugfs.h>
+#include <linux/ktime.h>
 #include <linux/wait.h>
 #include <linux/bitops.h>
 #include <linux/clk.h>
@@ -544,6 +545,16 @@ struct hpf_work {
 	struct delayed_work dwork;
 };
 
+#define TAVIL_ROUTE_STATS_MAX 64
+
+struct tavil_route_stat {
+	const char *name;
+	int event;
+	u32 count;
+	s64 last_us;
+	s64 max_us;
+};
+
 struct tavil_priv {
 	struct device *dev;
 	struct wcd9xxx *wcd9xxx;
@@ -636,8 +647,65 @@ struct tavil_priv {
 	struct platform_device *pdev_child_devices
 		[WCD934X_CHILD_DEVICES_MAX];
 	int child_count;
+
+	/* DAPM output path event timing, protected by the dapm mutex */
+	struct tavil_route_stat route_stats[TAVIL_ROUTE_STATS_MAX];
 };
 
+/* Largest table applied as one multi register write */
+#define TAVIL_REG_SEQ_MAX 32
+
+/*
+ * Apply a table of read-modify-write updates as multi register writes.
+ * Current values come from the register cache and earlier entries for
+ * the same register are folded in, so the codec sees the same writes
+ * in the same order, in one bus transaction instead of one per entry.
+ * With @force every entry is written as regmap_write_bits() would do,
+ * otherwise unchanged registers are skipped like regmap_update_bits().
+ * Entries for which @skip returns true are left out.
+ */
+static int tavil_reg_seq_update(struct tavil_priv *tavil, struct regmap *map,
+				const struct tavil_reg_mask_val *tbl, int size,
+				bool force,
+				bool (*skip)(struct tavil_priv *, u16))
+{
+	struct reg_sequence seq[TAVIL_REG_SEQ_MAX];
+	unsigned int cur, val;
+	int i, j, n = 0, ret;
+
+	for (i = 0; i < size; i++) {
+		if (skip && skip(tavil, tbl[i].reg))
+			continue;
+
+		for (j = n - 1; j >= 0; j--)
+			if (seq[j].reg == tbl[i].reg)
+				break;
+		if (j >= 0) {
+			cur = seq[j].def;
+		} else {
+			ret = regmap_read(map, tbl[i].reg, &cur);
+			if (ret)
+				return ret;
+		}
+
+		val = (cur & ~tbl[i].mask) | (tbl[i].val & tbl[i].mask);
+		if (!force && val == cur)
+			continue;
+
+		seq[n].reg = tbl[i].reg;
+		seq[n].def = val;
+		seq[n].delay_us = 0;
+		if (++n == TAVIL_REG_SEQ_MAX) {
+			ret = regmap_multi_reg_write(map, seq, n);
+			if (ret)
+				return ret;
+			n = 0;
+		}
+	}
+
+	return n ? regmap_multi_reg_write(map, seq, n) : 0;
+}
+
 static const struct tavil_reg_mask_val tavil_spkr_default[] = {
 	{WCD934X_CDC_COMPANDER7_CTL3, 0x80, 0x80},
 	{WCD934X_CDC_COMPANDER8_CTL3, 0x80, 0x80},
@@ -2906,6 +2974,51 @@ static int tavil_codec_lineout_dac_event(struct snd_soc_dapm_widget *w,
 	return 0;
 }
 
+static void tavil_route_stat_update(struct snd_soc_dapm_widget *w, int event,
+				    ktime_t start)
+{
+	struct snd_soc_codec *codec = snd_soc_dapm_to_codec(w->dapm);
+	struct tavil_priv *tavil = snd_soc_codec_get_drvdata(codec);
+	struct tavil_route_stat *st;
+	s64 us = ktime_us_delta(ktime_get(), start);
+	int i;
+
+	for (i = 0; i < TAVIL_ROUTE_STATS_MAX; i++) {
+		st = &tavil->route_stats[i];
+		if (!st->name || (st->name == w->name && st->event == event))
+			break;
+	}
+	if (i == TAVIL_ROUTE_STATS_MAX)
+		return;
+
+	st->name = w->name;
+	st->event = event;
+	st->count++;
+	st->last_us = us;
+	st->max_us = max(st->max_us, us);
+}
+
+/* Time the output path handlers, including their HW settle delays */
+#define TAVIL_TIMED_EVENT(_fn)						\
+static int _fn##_timed(struct snd_soc_dapm_widget *w,			\
+		       struct snd_kcontrol *kcontrol, int event)	\
+{									\
+	ktime_t start = ktime_get();					\
+	int ret = _fn(w, kcontrol, event);				\
+									\
+	tavil_route_stat_update(w, event, start);			\
+	return ret;							\
+}
+
+TAVIL_TIMED_EVENT(tavil_codec_ear_dac_event)
+TAVIL_TIMED_EVENT(tavil_codec_hphl_dac_event)
+TAVIL_TIMED_EVENT(tavil_codec_hphr_dac_event)
+TAVIL_TIMED_EVENT(tavil_codec_lineout_dac_event)
+TAVIL_TIMED_EVENT(tavil_codec_enable_ear_pa)
+TAVIL_TIMED_EVENT(tavil_codec_enable_hphl_pa)
+TAVIL_TIMED_EVENT(tavil_codec_enable_hphr_pa)
+TAVIL_TIMED_EVENT(tavil_codec_enable_lineout_pa)
+
 static int tavil_codec_spk_boost_event(struct snd_soc_dapm_widget *w,
 					struct snd_kcontrol *kcontrol,
 					int event)
@@ -5168,6 +5281,15 @@ static const struct tavil_reg_mask_val tavil_post_pa_en[] = {
 	{ WCD934X_HPH_NEW_INT_HPH_TIMER1, 0x02, 0x02 },
 };
 
+/* Registers tavil 1.1 leaves alone when restoring the HPH PA state */
+static bool tavil_hph_seq_skip(struct tavil_priv *tavil, u16 reg)
+{
+	return TAVIL_IS_1_1(tavil->wcd9xxx) &&
+		((reg == WCD934X_HPH_NEW_INT_RDAC_GAIN_CTL) ||
+		 (reg == WCD934X_HPH_CNP_WG_CTL) ||
+		 (reg == WCD934X_HPH_REFBUFF_LP_CTL));
+}
+
 static void tavil_codec_hph_reg_range_read(struct regmap *map, u8 *buf)
 {
 	regmap_bulk_read(map, WCD934X_HPH_CNP_EN, buf, TAVIL_HPH_REG_RANGE_1);
@@ -5181,9 +5303,6 @@ static void tavil_codec_hph_reg_range_read(struct regmap *map, u8 *buf)
 static void tavil_codec_hph_reg_recover(struct tavil_priv *tavil,
 					struct regmap *map, int pa_status)
 {
-	int i;
-	unsigned int reg;
-
 	blocking_notifier_call_chain(&tavil->mbhc->notifier,
 				     WCD_EVENT_OCP_OFF,
 				     &tavil->mbhc->wcd_mbhc);
@@ -5211,10 +5330,8 @@ static void tavil_codec_hph_reg_recover(struct tavil_priv *tavil,
 		regmap_multi_reg_write(map, tavil_hph_reset_tbl_1_0,
 				ARRAY_SIZE(tavil_hph_reset_tbl_1_0));
 
-	for (i = 0; i < ARRAY_SIZE(tavil_ocp_en_seq); i++)
-		regmap_write_bits(map, tavil_ocp_en_seq[i].reg,
-				  tavil_ocp_en_seq[i].mask,
-				  tavil_ocp_en_seq[i].val);
+	tavil_reg_seq_update(tavil, map, tavil_ocp_en_seq,
+			     ARRAY_SIZE(tavil_ocp_en_seq), true, NULL);
 	goto end;
 
 
@@ -5223,14 +5340,9 @@ static void tavil_codec_hph_reg_recover(struct tavil_priv *tavil,
 		__func__, pa_status);
 
 	/* Disable PA and other registers before restoring */
-	for (i = 0; i < ARRAY_SIZE(tavil_pa_disable); i++) {
-		if (TAVIL_IS_1_1(tavil->wcd9xxx) &&
-		    (tavil_pa_disable[i].reg == WCD934X_HPH_CNP_WG_CTL))
-			continue;
-		regmap_write_bits(map, tavil_pa_disable[i].reg,
-				  tavil_pa_disable[i].mask,
-				  tavil_pa_disable[i].val);
-	}
+	tavil_reg_seq_update(tavil, map, tavil_pa_disable,
+			     ARRAY_SIZE(tavil_pa_disable), true,
+			     tavil_hph_seq_skip);
 
 	regmap_multi_reg_write(map, tavil_hph_reset_tbl,
 			       ARRAY_SIZE(tavil_hph_reset_tbl));
@@ -5241,37 +5353,17 @@ static void tavil_codec_hph_reg_recover(struct tavil_priv *tavil,
 		regmap_multi_reg_write(map, tavil_hph_reset_tbl_1_0,
 				ARRAY_SIZE(tavil_hph_reset_tbl_1_0));
 
-	for (i = 0; i < ARRAY_SIZE(tavil_ocp_en_seq_1); i++)
-		regmap_write_bits(map, tavil_ocp_en_seq_1[i].reg,
-				  tavil_ocp_en_seq_1[i].mask,
-				  tavil_ocp_en_seq_1[i].val);
-
-	if (tavil->hph_mode == CLS_H_LOHIFI) {
-		for (i = 0; i < ARRAY_SIZE(tavil_pre_pa_en_lohifi); i++) {
-			reg = tavil_pre_pa_en_lohifi[i].reg;
-			if ((TAVIL_IS_1_1(tavil->wcd9xxx)) &&
-			    ((reg == WCD934X_HPH_NEW_INT_RDAC_GAIN_CTL) ||
-			     (reg == WCD934X_HPH_CNP_WG_CTL) ||
-			     (reg == WCD934X_HPH_REFBUFF_LP_CTL)))
-				continue;
-			regmap_write_bits(map,
-					  tavil_pre_pa_en_lohifi[i].reg,
-					  tavil_pre_pa_en_lohifi[i].mask,
-					  tavil_pre_pa_en_lohifi[i].val);
-		}
-	} else {
-		for (i = 0; i < ARRAY_SIZE(tavil_pre_pa_en); i++) {
-			reg = tavil_pre_pa_en[i].reg;
-			if ((TAVIL_IS_1_1(tavil->wcd9xxx)) &&
-			    ((reg == WCD934X_HPH_NEW_INT_RDAC_GAIN_CTL) ||
-			     (reg == WCD934X_HPH_CNP_WG_CTL) ||
-			     (reg == WCD934X_HPH_REFBUFF_LP_CTL)))
-				continue;
-			regmap_write_bits(map, tavil_pre_pa_en[i].reg,
-					  tavil_pre_pa_en[i].mask,
-					  tavil_pre_pa_en[i].val);
-		}
-	}
+	tavil_reg_seq_update(tavil, map, tavil_ocp_en_seq_1,
+			     ARRAY_SIZE(tavil_ocp_en_seq_1), true, NULL);
+
+	if (tavil->hph_mode == CLS_H_LOHIFI)
+		tavil_reg_seq_update(tavil, map, tavil_pre_pa_en_lohifi,
+				     ARRAY_SIZE(tavil_pre_pa_en_lohifi), true,
+				     tavil_hph_seq_skip);
+	else
+		tavil_reg_seq_update(tavil, map, tavil_pre_pa_en,
+				     ARRAY_SIZE(tavil_pre_pa_en), true,
+				     tavil_hph_seq_skip);
 
 	if (TAVIL_IS_1_1(tavil->wcd9xxx)) {
 		regmap_write(map, WCD934X_HPH_NEW_INT_RDAC_HD2_CTL_L, 0x84);
@@ -5286,14 +5378,9 @@ static void tavil_codec_hph_reg_recover(struct tavil_priv *tavil,
 	/* Sleep for 7msec after PA is enabled */
 	usleep_range(7000, 7100);
 
-	for (i = 0; i < ARRAY_SIZE(tavil_post_pa_en); i++) {
-		if ((TAVIL_IS_1_1(tavil->wcd9xxx)) &&
-		    (tavil_post_pa_en[i].reg == WCD934X_HPH_CNP_WG_CTL))
-			continue;
-		regmap_write_bits(map, tavil_post_pa_en[i].reg,
-				  tavil_post_pa_en[i].mask,
-				  tavil_post_pa_en[i].val);
-	}
+	tavil_reg_seq_update(tavil, map, tavil_post_pa_en,
+			     ARRAY_SIZE(tavil_post_pa_en), true,
+			     tavil_hph_seq_skip);
 
 end:
 	tavil->mbhc->is_hph_recover = true;
@@ -8005,55 +8092,55 @@ static const struct snd_soc_dapm_widget tavil_dapm_widgets[] = {
 	SND_SOC_DAPM_OUTPUT("MAD_CPE_OUT2"),
 
 	SND_SOC_DAPM_DAC_E("RX INT0 DAC", NULL, SND_SOC_NOPM,
-		0, 0, tavil_codec_ear_dac_event,
+		0, 0, tavil_codec_ear_dac_event_timed,
 		SND_SOC_DAPM_PRE_PMU | SND_SOC_DAPM_POST_PMU |
 		SND_SOC_DAPM_PRE_PMD | SND_SOC_DAPM_POST_PMD),
 	SND_SOC_DAPM_DAC_E("RX INT1 DAC", NULL, WCD934X_ANA_HPH,
-		5, 0, tavil_codec_hphl_dac_event,
+		5, 0, tavil_codec_hphl_dac_event_timed,
 		SND_SOC_DAPM_PRE_PMU | SND_SOC_DAPM_POST_PMU |
 		SND_SOC_DAPM_PRE_PMD | SND_SOC_DAPM_POST_PMD),
 	SND_SOC_DAPM_DAC_E("RX INT2 DAC", NULL, WCD934X_ANA_HPH,
-		4, 0, tavil_codec_hphr_dac_event,
+		4, 0, tavil_codec_hphr_dac_event_timed,
 		SND_SOC_DAPM_PRE_PMU | SND_SOC_DAPM_POST_PMU |
 		SND_SOC_DAPM_PRE_PMD | SND_SOC_DAPM_POST_PMD),
 	SND_SOC_DAPM_DAC_E("RX INT3 DAC", NULL, SND_SOC_NOPM,
-		0, 0, tavil_codec_lineout_dac_event,
+		0, 0, tavil_codec_lineout_dac_event_timed,
 		SND_SOC_DAPM_PRE_PMU | SND_SOC_DAPM_POST_PMD),
 	SND_SOC_DAPM_DAC_E("RX INT4 DAC", NULL, SND_SOC_NOPM,
-		0, 0, tavil_codec_lineout_dac_event,
+		0, 0, tavil_codec_lineout_dac_event_timed,
 		SND_SOC_DAPM_PRE_PMU | SND_SOC_DAPM_POST_PMD),
 
 	SND_SOC_DAPM_PGA_E("EAR PA", WCD934X_ANA_EAR, 7, 0, NULL, 0,
-		tavil_codec_enable_ear_pa,
+		tavil_codec_enable_ear_pa_timed,
 		SND_SOC_DAPM_POST_PMU | SND_SOC_DAPM_POST_PMD),
 	SND_SOC_DAPM_PGA_E("HPHL PA", WCD934X_ANA_HPH, 7, 0, NULL, 0,
-		tavil_codec_enable_hphl_pa,
+		tavil_codec_enable_hphl_pa_timed,
 		SND_SOC_DAPM_PRE_PMU | SND_SOC_DAPM_POST_PMU |
 		SND_SOC_DAPM_PRE_PMD | SND_SOC_DAPM_POST_PMD),
 	SND_SOC_DAPM_PGA_E("HPHR PA", WCD934X_ANA_HPH, 6, 0, NULL, 0,
-		tavil_codec_enable_hphr_pa,
+		tavil_codec_enable_hphr_pa_timed,
 		SND_SOC_DAPM_PRE_PMU | SND_SOC_DAPM_POST_PMU |
 		SND_SOC_DAPM_PRE_PMD | SND_SOC_DAPM_POST_PMD),
 	SND_SOC_DAPM_PGA_E("LINEOUT1 PA", WCD934X_ANA_LO_1_2, 7, 0, NULL, 0,
-		tavil_codec_enable_lineout_pa,
+		tavil_codec_enable_lineout_pa_timed,
 		SND_SOC_DAPM_PRE_PMU | SND_SOC_DAPM_POST_PMU |
 		SND_SOC_DAPM_PRE_PMD | SND_SOC_DAPM_POST_PMD),
 	SND_SOC_DAPM_PGA_E("LINEOUT2 PA", WCD934X_ANA_LO_1_2, 6, 0, NULL, 0,
-		tavil_codec_enable_lineout_pa,
+		tavil_codec_enable_lineout_pa_timed,
 		SND_SOC_DAPM_PRE_PMU | SND_SOC_DAPM_POST_PMU |
 		SND_SOC_DAPM_PRE_PMD | SND_SOC_DAPM_POST_PMD),
 	SND_SOC_DAPM_PGA_E("ANC EAR PA", WCD934X_ANA_EAR, 7, 0, NULL, 0,
-		tavil_codec_enable_ear_pa, SND_SOC_DAPM_POST_PMU |
+		tavil_codec_enable_ear_pa_timed, SND_SOC_DAPM_POST_PMU |
 		SND_SOC_DAPM_PRE_PMD | SND_SOC_DAPM_POST_PMD),
 	SND_SOC_DAPM_PGA_E("ANC SPK1 PA", SND_SOC_NOPM, 0, 0, NULL, 0,
 		tavil_codec_enable_spkr_anc,
 		SND_SOC_DAPM_PRE_PMU | SND_SOC_DAPM_POST_PMD),
 	SND_SOC_DAPM_PGA_E("ANC HPHL PA", SND_SOC_NOPM, 0, 0, NULL, 0,
-		tavil_codec_enable_hphl_pa,
+		tavil_codec_enable_hphl_pa_timed,
 		SND_SOC_DAPM_PRE_PMU | SND_SOC_DAPM_POST_PMU |
 		SND_SOC_DAPM_PRE_PMD | SND_SOC_DAPM_POST_PMD),
 	SND_SOC_DAPM_PGA_E("ANC HPHR PA", SND_SOC_NOPM, 0, 0, NULL, 0,
-		tavil_codec_enable_hphr_pa,
+		tavil_codec_enable_hphr_pa_timed,
 		SND_SOC_DAPM_PRE_PMU | SND_SOC_DAPM_POST_PMU |
 		SND_SOC_DAPM_PRE_PMD | SND_SOC_DAPM_POST_PMD),
 
@@ -9467,22 +9554,16 @@ static const struct tavil_reg_mask_val tavil_codec_reg_init_common_val[] = {
 
 static void tavil_codec_init_reg(struct tavil_priv *priv)
 {
-	struct snd_soc_codec *codec = priv->codec;
-	u32 i;
+	struct regmap *map = priv->wcd9xxx->regmap;
 
-	for (i = 0; i < ARRAY_SIZE(tavil_codec_reg_init_common_val); i++)
-		snd_soc_update_bits(codec,
-				    tavil_codec_reg_init_common_val[i].reg,
-				    tavil_codec_reg_init_common_val[i].mask,
-				    tavil_codec_reg_init_common_val[i].val);
+	tavil_reg_seq_update(priv, map, tavil_codec_reg_init_common_val,
+			     ARRAY_SIZE(tavil_codec_reg_init_common_val),
+			     false, NULL);
 
-	if (TAVIL_IS_1_1(priv->wcd9xxx)) {
-		for (i = 0; i < ARRAY_SIZE(tavil_codec_reg_init_1_1_val); i++)
-			snd_soc_update_bits(codec,
-					tavil_codec_reg_init_1_1_val[i].reg,
-					tavil_codec_reg_init_1_1_val[i].mask,
-					tavil_codec_reg_init_1_1_val[i].val);
-	}
+	if (TAVIL_IS_1_1(priv->wcd9xxx))
+		tavil_reg_seq_update(priv, map, tavil_codec_reg_init_1_1_val,
+				     ARRAY_SIZE(tavil_codec_reg_init_1_1_val),
+				     false, NULL);
 }
 
 static const struct tavil_reg_mask_val tavil_codec_reg_i2c_defaults[] = {
@@ -9503,24 +9584,17 @@ static const struct tavil_reg_mask_val tavil_codec_reg_i2c_defaults[] = {
 
 static void tavil_update_reg_defaults(struct tavil_priv *tavil)
 {
-	u32 i;
 	struct wcd9xxx *wcd9xxx;
 
 	wcd9xxx = tavil->wcd9xxx;
-	for (i = 0; i < ARRAY_SIZE(tavil_codec_reg_defaults); i++)
-		regmap_update_bits(wcd9xxx->regmap,
-				   tavil_codec_reg_defaults[i].reg,
-				   tavil_codec_reg_defaults[i].mask,
-				   tavil_codec_reg_defaults[i].val);
+	tavil_reg_seq_update(tavil, wcd9xxx->regmap, tavil_codec_reg_defaults,
+			     ARRAY_SIZE(tavil_codec_reg_defaults), false, NULL);
 
-	if (tavil->intf_type == WCD9XXX_INTERFACE_TYPE_I2C) {
-		for (i = 0; i < ARRAY_SIZE(tavil_codec_reg_i2c_defaults); i++) {
-			regmap_update_bits(wcd9xxx->regmap,
-					   tavil_codec_reg_i2c_defaults[i].reg,
-					   tavil_codec_reg_i2c_defaults[i].mask,
-					   tavil_codec_reg_i2c_defaults[i].val);
-		}
-	}
+	if (tavil->intf_type == WCD9XXX_INTERFACE_TYPE_I2C)
+		tavil_reg_seq_update(tavil, wcd9xxx->regmap,
+				     tavil_codec_reg_i2c_defaults,
+				     ARRAY_SIZE(tavil_codec_reg_i2c_defaults),
+				     false, NULL);
 }
 
 static void tavil_update_cpr_defaults(struct tavil_priv *tavil)
@@ -10091,6 +10165,89 @@ static int tavil_post_reset_cb(struct wcd9xxx *wcd9xxx)
 	return ret;
 }
 
+#ifdef CONFIG_DEBUG_FS
+static const char *tavil_dapm_event_name(int event)
+{
+	switch (event) {
+	case SND_SOC_DAPM_PRE_PMU:
+		return "PRE_PMU";
+	case SND_SOC_DAPM_POST_PMU:
+		return "POST_PMU";
+	case SND_SOC_DAPM_PRE_PMD:
+		return "PRE_PMD";
+	case SND_SOC_DAPM_POST_PMD:
+		return "POST_PMD";
+	default:
+		return "?";
+	}
+}
+
+static ssize_t tavil_route_timing_read(struct file *file, char __user *ubuf,
+				       size_t count, loff_t *ppos)
+{
+	struct tavil_priv *tavil = file->private_data;
+	struct snd_soc_card *card = tavil->codec->component.card;
+	struct tavil_route_stat *st;
+	const int size = 4096;
+	char *buf;
+	int i, n = 0;
+	ssize_t ret;
+
+	buf = kmalloc(size, GFP_KERNEL);
+	if (!buf)
+		return -ENOMEM;
+
+	n += scnprintf(buf, size, "widget event count last_us max_us\n");
+	mutex_lock_nested(&card->dapm_mutex, SND_SOC_DAPM_CLASS_RUNTIME);
+	for (i = 0; i < TAVIL_ROUTE_STATS_MAX; i++) {
+		st = &tavil->route_stats[i];
+		if (!st->name)
+			break;
+		n += scnprintf(buf + n, size - n, "%s %s %u %lld %lld\n",
+			       st->name, tavil_dapm_event_name(st->event),
+			       st->count, st->last_us, st->max_us);
+	}
+	mutex_unlock(&card->dapm_mutex);
+
+	ret = simple_read_from_buffer(ubuf, count, ppos, buf, n);
+	kfree(buf);
+	return ret;
+}
+
+static ssize_t tavil_route_timing_write(struct file *file,
+					const char __user *ubuf,
+					size_t count, loff_t *ppos)
+{
+	struct tavil_priv *tavil = file->private_data;
+	struct snd_soc_card *card = tavil->codec->component.card;
+
+	mutex_lock_nested(&card->dapm_mutex, SND_SOC_DAPM_CLASS_RUNTIME);
+	memset(tavil->route_stats, 0, sizeof(tavil->route_stats));
+	mutex_unlock(&card->dapm_mutex);
+
+	return count;
+}
+
+static const struct file_operations tavil_route_timing_fops = {
+	.open = simple_open,
+	.read = tavil_route_timing_read,
+	.write = tavil_route_timing_write,
+};
+
+static void tavil_debugfs_init(struct tavil_priv *tavil)
+{
+	struct dentry *root = tavil->codec->component.debugfs_root;
+
+	if (root)
+		debugfs_create_file("route_timing", 0644, root, tavil,
+				    &tavil_route_timing_fops);
+}
+#else
+static void tavil_debugfs_init(struct tavil_priv *tavil)
+{
+}
+#endif
+
 static int tavil_soc_codec_probe(struct snd_soc_codec *codec)
 {
 	struct wcd9xxx *control;
@@ -10151,6 +10308,7 @@ static int tavil_soc_codec_probe(struct snd_soc_codec *codec)
 		tavil->comp_enabled[i] = 0;
 
 	tavil_codec_init_reg(tavil);
+	tavil_debugfs_init(tavil);
 
 	pdata = dev_get_platdata(codec->dev->parent);
 	ret = tavil_handle_pdata(tavil, pdata);
@@ -33,6 +33,27 @@
 static DEFINE_MUTEX(lock);
 #ifdef CONFIG_DEBUG_FS
 
+static int audio_aio_debug_stats(struct q6audio_aio *audio, const char *name,
+				struct audio_aio_buf_stats *stats,
+				char *buf, int size)
+{
+	struct audio_aio_buf_stats s;
+	unsigned long flags;
+	int n;
+
+	spin_lock_irqsave(&audio->dsp_lock, flags);
+	s = *stats;
+	spin_unlock_irqrestore(&audio->dsp_lock, flags);
+
+	n = scnprintf(buf, size, "%s queued %u done %u underruns %u\n",
+			name, s.queued, s.done, s.underruns);
+	n += scnprintf(buf + n, size - n,
+			"%s latency us last %lld max %lld avg %lld\n",
+			name, s.last_latency_us, s.max_latency_us,
+			s.done ? div_s64(s.total_latency_us, s.done) : 0);
+	return n;
+}
+
 int audio_aio_debug_open(struct inode *inode, struct file *file)
 {
 	file->private_data = inode->i_private;
@@ -74,6 +95,10 @@ ssize_t audio_aio_debug_read(struct file *file, char __user *buf,
 		n += scnprintf(buffer + n, debug_bufmax - n,
 				"outqueue empty %d\n",
 				list_empty(&audio->out_queue));
+		n += audio_aio_debug_stats(audio, "write", &audio->write_stats,
+				buffer + n, debug_bufmax - n);
+		n += audio_aio_debug_stats(audio, "read", &audio->read_stats,
+				buffer + n, debug_bufmax - n);
 	}
 	mutex_unlock(&lock);
 	buffer[n] = 0;
@@ -119,13 +144,27 @@ static int insert_meta_data_flush(struct q6audio_aio *audio,
 }
 
 static int audio_aio_ion_lookup_vaddr(struct q6audio_aio *audio, void *addr,
-					unsigned long len,
+					unsigned long len, int dir,
 					struct audio_aio_ion_region **region)
 {
 	struct audio_aio_ion_region *region_elt;
 
 	int match_count = 0;
 
+	/*
+	 * Clients cycle through buffers carved from one registered region,
+	 * so try the region of the previous buffer before walking the list.
+	 * Registered regions never overlap, so a hit here is the only one.
+	 */
+	region_elt = audio->last_region[dir];
+	if (region_elt && addr >= region_elt->vaddr &&
+		addr < region_elt->vaddr + region_elt->len &&
+		addr + len <= region_elt->vaddr + region_elt->len &&
+		addr + len > addr) {
+		*region = region_elt;
+		return 0;
+	}
+
 	*region = NULL;
 
 	/* returns physical address or zero */
@@ -163,17 +202,21 @@ static int audio_aio_ion_lookup_vaddr(struct q6audio_aio *audio, void *addr,
 		}
 	}
 
+	if (*region)
+		audio->last_region[dir] = *region;
+
 	return *region ? 0 : -1;
 }
 
 static phys_addr_t audio_aio_ion_fixup(struct q6audio_aio *audio, void *addr,
-				unsigned long len, int ref_up, void **kvaddr)
+				unsigned long len, int dir, int ref_up,
+				void **kvaddr)
 {
 	struct audio_aio_ion_region *region;
 	phys_addr_t paddr;
 	int ret;
 
-	ret = audio_aio_ion_lookup_vaddr(audio, addr, len, &region);
+	ret = audio_aio_ion_lookup_vaddr(audio, addr, len, dir, &region);
 	if (ret) {
 		pr_err("%s[%pK]:lookup (%pK, %ld) failed\n",
 				__func__, audio, addr, len);
@@ -273,6 +316,19 @@ static int audio_aio_outport_flush(struct q6audio_aio *audio)
 	return rc;
 }
 
+/* Called with dsp_lock held when the DSP returns @buf_node */
+void audio_aio_update_stats(struct audio_aio_buf_stats *stats,
+			struct audio_aio_buffer_node *buf_node, bool drained)
+{
+	stats->done++;
+	stats->last_latency_us = ktime_us_delta(ktime_get(), buf_node->queued);
+	stats->max_latency_us = max(stats->max_latency_us,
+					stats->last_latency_us);
+	stats->total_latency_us += stats->last_latency_us;
+	if (drained)
+		stats->underruns++;
+}
+
 /* Write buffer to DSP / Handle Ack from DSP */
 void audio_aio_async_write_ack(struct q6audio_aio *audio, uint32_t token,
 				uint32_t *payload)
@@ -295,6 +351,9 @@ void audio_aio_async_write_ack(struct q6audio_aio *audio, uint32_t token,
 					struct audio_aio_buffer_node, list);
 	if (token == used_buf->token) {
 		list_del(&used_buf->list);
+		audio_aio_update_stats(&audio->write_stats, used_buf,
+			list_empty(&audio->out_queue) && !audio->eos_flag &&
+			!(audio->drv_status & ADRV_STATUS_FSYNC));
 		spin_unlock_irqrestore(&audio->dsp_lock, flags);
 		pr_debug("%s[%pK]:consumed buffer\n", __func__, audio);
 		event_payload.aio_buf = used_buf->buf;
@@ -423,6 +482,8 @@ void audio_aio_reset_ion_region(struct q6audio_aio *audio)
 		msm_audio_ion_free_legacy(audio->client, region->handle);
 		kfree(region);
 	}
+	audio->last_region[0] = NULL;
+	audio->last_region[1] = NULL;
 }
 
 void audio_aio_reset_event_queue(struct q6audio_aio *audio)
@@ -782,14 +843,14 @@ static long audio_aio_process_event_req_common(struct q6audio_aio *audio,
 			__func__, audio);
 		mutex_lock(&audio->write_lock);
 		audio_aio_ion_fixup(audio, drv_evt->payload.aio_buf.buf_addr,
-		drv_evt->payload.aio_buf.buf_len, 0, 0);
+		drv_evt->payload.aio_buf.buf_len, 1, 0, 0);
 		mutex_unlock(&audio->write_lock);
 	} else if (drv_evt->event_type == AUDIO_EVENT_READ_DONE) {
 		pr_debug("%s[%pK]:posted AUDIO_EVENT_READ_DONE to user\n",
 			__func__, audio);
 		mutex_lock(&audio->read_lock);
 		audio_aio_ion_fixup(audio, drv_evt->payload.aio_buf.buf_addr,
-		drv_evt->payload.aio_buf.buf_len, 0, 0);
+		drv_evt->payload.aio_buf.buf_len, 0, 0, 0);
 		mutex_unlock(&audio->read_lock);
 	}
 
@@ -1049,6 +1110,10 @@ static int audio_aio_ion_remove(struct q6audio_aio *audio,
 					__func__, audio);
 
 			list_del(&region->list);
+			if (audio->last_region[0] == region)
+				audio->last_region[0] = NULL;
+			if (audio->last_region[1] == region)
+				audio->last_region[1] = NULL;
 			msm_audio_ion_free_legacy(audio->client,
 						 region->handle);
 			kfree(region);
@@ -1174,7 +1239,7 @@ static int audio_aio_buf_add_shared(struct q6audio_aio *audio, u32 dir,
 		 __func__, audio, buf_node, dir, buf_node->buf.buf_addr,
 		buf_node->buf.buf_len, buf_node->buf.data_len);
 	buf_node->paddr = audio_aio_ion_fixup(audio, buf_node->buf.buf_addr,
-						buf_node->buf.buf_len, 1,
+						buf_node->buf.buf_len, dir, 1,
 						&buf_node->kvaddr);
 	if (dir) {
 		/* write */
@@ -1188,6 +1253,8 @@ static int audio_aio_buf_add_shared(struct q6audio_aio *audio, u32 dir,
 		/* Not a EOS buffer */
 		if (!(buf_node->meta_info.meta_in.nflags & AUDIO_DEC_EOS_SET)) {
 			spin_lock_irqsave(&audio->dsp_lock, flags);
+			buf_node->queued = ktime_get();
+			audio->write_stats.queued++;
 			ret = audio_aio_async_write(audio, buf_node);
 			/* EOS buffer handled in driver */
 			list_add_tail(&buf_node->list, &audio->out_queue);
@@ -1229,6 +1296,8 @@ static int audio_aio_buf_add_shared(struct q6audio_aio *audio, u32 dir,
 		/* No EOS reached */
 		if (!audio->eos_rsp) {
 			spin_lock_irqsave(&audio->dsp_lock, flags);
+			buf_node->queued = ktime_get();
+			audio->read_stats.queued++;
 			ret = audio_aio_async_read(audio, buf_node);
 			/* EOS buffer handled in driver */
 			list_add_tail(&buf_node->list, &audio->in_queue);
@@ -27,6 +27,7 @@
 #include <linux/msm_ion.h>
 #include <asm/ioctls.h>
 #include <linux/atomic.h>
+#include <linux/ktime.h>
 #include "q6audio_common.h"
 
 #define TUNNEL_MODE     0x0000
@@ -141,6 +142,18 @@ struct audio_aio_buffer_node {
 	uint32_t token;
 	void            *kvaddr;
 	union meta_data meta_info;
+	ktime_t queued;
+};
+
+/* Per direction buffer statistics, protected by dsp_lock */
+struct audio_aio_buf_stats {
+	uint32_t queued;
+	uint32_t done;
+	/* queue drained by the DSP while the stream was running */
+	uint32_t underruns;
+	int64_t last_latency_us;
+	int64_t max_latency_us;
+	int64_t total_latency_us;
 };
 
 struct q6audio_aio;
@@ -182,6 +195,10 @@ struct q6audio_aio {
 	struct list_head free_event_queue;
 	struct list_head event_queue;
 	struct list_head ion_region_queue;     /* protected by lock */
+	/* last region hit per direction, protected by read/write_lock */
+	struct audio_aio_ion_region *last_region[2];
+	struct audio_aio_buf_stats read_stats;
+	struct audio_aio_buf_stats write_stats;
 	struct ion_client *client;
 	struct audio_aio_drv_operations drv_ops;
 	union msm_audio_event_payload eos_write_payload;
@@ -208,6 +225,9 @@ void audio_aio_async_write_ack(struct q6audio_aio *audio, uint32_t token,
 void audio_aio_async_read_ack(struct q6audio_aio *audio, uint32_t token,
 			uint32_t *payload);
 
+void audio_aio_update_stats(struct audio_aio_buf_stats *stats,
+			struct audio_aio_buffer_node *buf_node, bool drained);
+
 int insert_eos_buf(struct q6audio_aio *audio,
 		struct audio_aio_buffer_node *buf_node);
 
@@ -189,6 +189,8 @@ void audio_aio_async_read_ack(struct q6audio_aio *audio, uint32_t token,
 				 __func__, token, filled_buf->token);
 	if (token == (filled_buf->token)) {
 		list_del(&filled_buf->list);
+		audio_aio_update_stats(&audio->read_stats, filled_buf,
+			list_empty(&audio->in_queue) && !audio->eos_rsp);
 		spin_unlock_irqrestore(&audio->dsp_lock, flags);
 		event_payload.aio_buf = filled_buf->buf;
 		/* Read done Buffer due to flush/normal condition
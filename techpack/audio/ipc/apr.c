@@ -20,6 +20,7 @@
 #include <linux/wait.h>
 #include <linux/errno.h>
 #include <linux/fs.h>
+#include <linux/ktime.h>
 #include <linux/delay.h>
 #include <linux/debugfs.h>
 #include <linux/platform_device.h>
@@ -69,6 +70,96 @@ struct apr_private {
 static struct apr_private *apr_priv;
 static bool apr_cf_debug;
 
+/* Service id to svc[] index + 1, so rx does not scan every service */
+static uint8_t svc_idx_map[APR_DEST_MAX][APR_CLIENT_MAX][APR_SVC_MAX];
+
+/*
+ * Round trip of commands acked with APR_BASIC_RSP_RESULT, per opcode.
+ * Buckets are powers of two starting at APR_LAT_BUCKET0_US.
+ */
+#define APR_LAT_OPCODES		48
+#define APR_LAT_PENDING		32
+#define APR_LAT_BUCKETS		10
+#define APR_LAT_BUCKET0_US	64
+
+struct apr_lat_pending {
+	uint32_t opcode;
+	uint32_t token;
+	uint16_t dest_svc;
+	ktime_t sent;
+};
+
+struct apr_lat_stat {
+	uint32_t opcode;
+	uint32_t count;
+	uint32_t max_us;
+	uint64_t total_us;
+	uint32_t hist[APR_LAT_BUCKETS];
+};
+
+static DEFINE_SPINLOCK(apr_lat_lock);
+static struct apr_lat_pending apr_lat_pending[APR_LAT_PENDING];
+static unsigned int apr_lat_next;
+static struct apr_lat_stat apr_lat_stats[APR_LAT_OPCODES];
+
+static void apr_lat_sent(struct apr_hdr *hdr)
+{
+	struct apr_lat_pending *p;
+	unsigned long flags;
+
+	spin_lock_irqsave(&apr_lat_lock, flags);
+	p = &apr_lat_pending[apr_lat_next];
+	apr_lat_next = (apr_lat_next + 1) % APR_LAT_PENDING;
+	p->opcode = hdr->opcode;
+	p->token = hdr->token;
+	p->dest_svc = hdr->dest_svc;
+	p->sent = ktime_get();
+	spin_unlock_irqrestore(&apr_lat_lock, flags);
+}
+
+static void apr_lat_acked(struct apr_hdr *hdr, uint32_t opcode)
+{
+	struct apr_lat_pending *p;
+	struct apr_lat_stat *st = NULL;
+	unsigned long flags;
+	unsigned int i, b;
+	uint32_t us;
+
+	spin_lock_irqsave(&apr_lat_lock, flags);
+	for (i = 0; i < APR_LAT_PENDING; i++) {
+		p = &apr_lat_pending[i];
+		if (p->opcode == opcode && p->token == hdr->token &&
+		    p->dest_svc == hdr->src_svc && ktime_to_ns(p->sent))
+			break;
+	}
+	if (i == APR_LAT_PENDING)
+		goto unlock;
+
+	us = ktime_us_delta(ktime_get(), p->sent);
+	p->sent = ktime_set(0, 0);
+
+	for (i = 0; i < APR_LAT_OPCODES; i++) {
+		if (apr_lat_stats[i].opcode == opcode ||
+		    !apr_lat_stats[i].count) {
+			st = &apr_lat_stats[i];
+			break;
+		}
+	}
+	if (!st)
+		goto unlock;
+
+	st->opcode = opcode;
+	st->count++;
+	st->total_us += us;
+	st->max_us = max(st->max_us, us);
+	for (b = 0; b < APR_LAT_BUCKETS - 1; b++)
+		if (us < (APR_LAT_BUCKET0_US << b))
+			break;
+	st->hist[b]++;
+unlock:
+	spin_unlock_irqrestore(&apr_lat_lock, flags);
+}
+
 #ifdef CONFIG_DEBUG_FS
 static struct dentry *debugfs_apr_debug;
 static ssize_t apr_debug_write(struct file *filp, const char __user *ubuf,
@@ -87,6 +178,65 @@ static ssize_t apr_debug_write(struct file *filp, const char __user *ubuf,
 static const struct file_operations apr_debug_ops = {
 	.write = apr_debug_write,
 };
+
+static struct dentry *debugfs_apr_latency;
+static ssize_t apr_latency_read(struct file *filp, char __user *ubuf,
+				size_t cnt, loff_t *ppos)
+{
+	const int size = 8192;
+	struct apr_lat_stat *stats;
+	unsigned long flags;
+	char *buf;
+	int i, b, n = 0;
+	ssize_t ret;
+
+	stats = kmalloc(sizeof(apr_lat_stats), GFP_KERNEL);
+	buf = kmalloc(size, GFP_KERNEL);
+	if (!stats || !buf) {
+		ret = -ENOMEM;
+		goto done;
+	}
+
+	spin_lock_irqsave(&apr_lat_lock, flags);
+	memcpy(stats, apr_lat_stats, sizeof(apr_lat_stats));
+	spin_unlock_irqrestore(&apr_lat_lock, flags);
+
+	n += scnprintf(buf + n, size - n,
+		       "opcode count avg_us max_us hist(<%dus x2)\n",
+		       APR_LAT_BUCKET0_US);
+	for (i = 0; i < APR_LAT_OPCODES && stats[i].count; i++) {
+		n += scnprintf(buf + n, size - n, "0x%08x %u %llu %u",
+			       stats[i].opcode, stats[i].count,
+			       div_u64(stats[i].total_us, stats[i].count),
+			       stats[i].max_us);
+		for (b = 0; b < APR_LAT_BUCKETS; b++)
+			n += scnprintf(buf + n, size - n, " %u",
+				       stats[i].hist[b]);
+		n += scnprintf(buf + n, size - n, "\n");
+	}
+	ret = simple_read_from_buffer(ubuf, cnt, ppos, buf, n);
+done:
+	kfree(buf);
+	kfree(stats);
+	return ret;
+}
+
+static ssize_t apr_latency_write(struct file *filp, const char __user *ubuf,
+				 size_t cnt, loff_t *ppos)
+{
+	unsigned long flags;
+
+	spin_lock_irqsave(&apr_lat_lock, flags);
+	memset(apr_lat_stats, 0, sizeof(apr_lat_stats));
+	spin_unlock_irqrestore(&apr_lat_lock, flags);
+
+	return cnt;
+}
+
+static const struct file_operations apr_latency_ops = {
+	.read = apr_latency_read,
+	.write = apr_latency_write,
+};
 #endif
 
 #define APR_PKT_INFO(x...) \
@@ -360,7 +510,6 @@ int apr_send_pkt(void *handle, uint32_t *buf)
 	uint16_t client_id;
 	uint16_t w_len;
 	int rc;
-	unsigned long flags;
 
 	if (!handle || !buf) {
 		pr_err("APR: Wrong parameters\n");
@@ -381,14 +530,16 @@ int apr_send_pkt(void *handle, uint32_t *buf)
 		return -ENETRESET;
 	}
 
-	spin_lock_irqsave(&svc->w_lock, flags);
+	/*
+	 * The channel serialises glink_tx() itself, so packets for one
+	 * service are not held behind each other's copy into a tx buffer.
+	 */
 	dest_id = svc->dest_id;
 	client_id = svc->client_id;
 	clnt = &client[dest_id][client_id];
 
 	if (!client[dest_id][client_id].handle) {
 		pr_err("APR: Still service is not yet opened\n");
-		spin_unlock_irqrestore(&svc->w_lock, flags);
 		return -EINVAL;
 	}
 	hdr = (struct apr_hdr *)buf;
@@ -406,6 +557,7 @@ int apr_send_pkt(void *handle, uint32_t *buf)
 		hdr->token);
 	}
 
+	apr_lat_sent(hdr);
 	rc = apr_tal_write(clnt->handle, buf,
 			(struct apr_pkt_priv *)&svc->pkt_owner,
 			hdr->pkt_size);
@@ -420,7 +572,6 @@ int apr_send_pkt(void *handle, uint32_t *buf)
 		pr_err("%s: Write APR pkt failed with error %d\n",
 			__func__, rc);
 	}
-	spin_unlock_irqrestore(&svc->w_lock, flags);
 
 	return rc;
 }
@@ -538,6 +689,7 @@ struct apr_svc *apr_register(char *dest, char *svc_name, apr_fn svc_fn,
 	svc->client_id = client_id;
 	svc->dest_domain = domain_id;
 	svc->pkt_owner = APR_PKT_OWNER_DRIVER;
+	svc_idx_map[dest_id][client_id][svc_id] = svc_idx + 1;
 
 	if (src_port != 0xFFFFFFFF) {
 		temp_port = ((src_port >> 8) * 8) + (src_port & 0xFF);
@@ -674,17 +826,12 @@ void apr_cb_func(void *buf, int len, void *priv)
 
 	pr_debug("src =%d clnt = %d\n", src, clnt);
 	apr_client = &client[src][clnt];
-	for (i = 0; i < APR_SVC_MAX; i++)
-		if (apr_client->svc[i].id == svc) {
-			pr_debug("%d\n", apr_client->svc[i].id);
-			c_svc = &apr_client->svc[i];
-			break;
-		}
-
-	if (i == APR_SVC_MAX) {
+	i = svc_idx_map[src][clnt][svc] - 1;
+	if (i < 0 || apr_client->svc[i].id != svc) {
 		pr_err("APR: service is not registered\n");
 		return;
 	}
+	c_svc = &apr_client->svc[i];
 	pr_debug("svc_idx = %d\n", i);
 	pr_debug("%x %x %x %pK %pK\n", c_svc->id, c_svc->dest_id,
 		 c_svc->client_id, c_svc->fn, c_svc->priv);
@@ -699,6 +846,9 @@ void apr_cb_func(void *buf, int len, void *priv)
 	if (data.payload_size > 0)
 		data.payload = (char *)hdr + hdr_size;
 
+	if (hdr->opcode == APR_BASIC_RSP_RESULT && data.payload_size >= 4)
+		apr_lat_acked(hdr, *(uint32_t *)data.payload);
+
 	if (unlikely(apr_cf_debug)) {
 		if (hdr->opcode == APR_BASIC_RSP_RESULT && data.payload) {
 			uint32_t *ptr = data.payload;
@@ -1052,6 +1202,9 @@ static int apr_debug_init(void)
 	debugfs_apr_debug = debugfs_create_file("msm_apr_debug",
 						 S_IFREG | 0444, NULL, NULL,
 						 &apr_debug_ops);
+	debugfs_apr_latency = debugfs_create_file("msm_apr_latency",
+						 S_IFREG | 0644, NULL, NULL,
+						 &apr_latency_ops);
 	return 0;
 }
 #else
@@ -1079,6 +1232,7 @@ static void apr_cleanup(void)
 		}
 	}
 	debugfs_remove(debugfs_apr_debug);
+	debugfs_remove(debugfs_apr_latency);
 }
 
 static int apr_probe(struct platform_device *pdev)
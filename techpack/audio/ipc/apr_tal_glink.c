@@ -67,7 +67,8 @@ static struct apr_tx_buf *apr_alloc_buf(int len)
 		return ERR_PTR(-EINVAL);
 	}
 
-	return kzalloc(sizeof(struct apr_tx_buf), GFP_ATOMIC);
+	/* Both fields are filled by the caller, only size for the packet */
+	return kmalloc(offsetof(struct apr_tx_buf, buf) + len, GFP_ATOMIC);
 }
 
 static void apr_free_buf(const void *ptr)
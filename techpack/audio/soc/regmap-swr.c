@@ -30,8 +30,10 @@ static int regmap_swr_gather_write(void *context,
 	struct regmap *map = dev_get_regmap(dev, NULL);
 	size_t addr_bytes;
 	size_t val_bytes;
+	size_t num_regs;
 	int i, ret = 0;
 	u16 reg_addr = 0;
+	u16 *regs;
 	u8 *value;
 
 	if (map == NULL) {
@@ -50,8 +52,31 @@ static int regmap_swr_gather_write(void *context,
 	}
 	reg_addr = *(u16 *)reg;
 	val_bytes = map->format.val_bytes;
+	num_regs = val_len / val_bytes;
+
+	/*
+	 * Send a run of consecutive registers as one master transaction
+	 * instead of one command FIFO write per register.
+	 */
+	if (num_regs > 1 && val_bytes == 1) {
+		regs = kmalloc_array(num_regs, sizeof(u16), GFP_KERNEL);
+		if (!regs)
+			return -ENOMEM;
+		for (i = 0; i < num_regs; i++)
+			regs[i] = reg_addr + i;
+		ret = swr_bulk_write(swr, swr->dev_num, regs, val, num_regs);
+		kfree(regs);
+		if (ret != -EOPNOTSUPP) {
+			if (ret)
+				dev_err(dev, "%s: bulk write at 0x%x failed, err %d\n",
+					__func__, reg_addr, ret);
+			return ret;
+		}
+		ret = 0;
+	}
+
 	/* val_len = val_bytes * val_count */
-	for (i = 0; i < (val_len / val_bytes); i++) {
+	for (i = 0; i < num_regs; i++) {
 		value = (u8 *)val + (val_bytes * i);
 		ret = swr_write(swr, swr->dev_num, (reg_addr + i), value);
 		if (ret < 0) {
@@ -99,15 +124,11 @@ static int regmap_swr_raw_multi_reg_write(void *context, const void *data,
 	}
 	num_regs = count / (addr_bytes + val_bytes + pad_bytes);
 
-	reg = kcalloc(num_regs, sizeof(u16), GFP_KERNEL);
+	/* One allocation for both the address and the value arrays */
+	reg = kmalloc_array(num_regs, sizeof(u16) + sizeof(u8), GFP_KERNEL);
 	if (!reg)
 		return -ENOMEM;
-
-	val = kcalloc(num_regs, sizeof(u8), GFP_KERNEL);
-	if (!val) {
-		ret = -ENOMEM;
-		goto mem_fail;
-	}
+	val = (u8 *)(reg + num_regs);
 
 	buf = (u8 *)data;
 	for (i = 0; i < num_regs; i++) {
@@ -120,8 +141,6 @@ static int regmap_swr_raw_multi_reg_write(void *context, const void *data,
 	if (ret)
 		dev_err(dev, "%s: multi reg write failed\n", __func__);
 
-	kfree(val);
-mem_fail:
 	kfree(reg);
 	return ret;
 }
@@ -606,16 +606,13 @@ static int swrm_bulk_write(struct swr_master *master, u8 dev_num, void *reg,
 		return -EINVAL;
 
 	if (dev_num) {
-		swr_fifo_reg = kcalloc(len, sizeof(u32), GFP_KERNEL);
+		/* FIFO register and packed command arrays in one block */
+		swr_fifo_reg = kmalloc_array(len, 2 * sizeof(u32), GFP_KERNEL);
 		if (!swr_fifo_reg) {
 			ret = -ENOMEM;
 			goto err;
 		}
-		val = kcalloc(len, sizeof(u32), GFP_KERNEL);
-		if (!val) {
-			ret = -ENOMEM;
-			goto mem_fail;
-		}
+		val = swr_fifo_reg + len;
 
 		for (i = 0; i < len; i++) {
 			val[i] = swrm_get_packed_reg_val(&swrm->wcmd_id,
@@ -637,8 +634,6 @@ static int swrm_bulk_write(struct swr_master *master, u8 dev_num, void *reg,
 		ret = -EINVAL;
 		goto err;
 	}
-	kfree(val);
-mem_fail:
 	kfree(swr_fifo_reg);
 err:
 	pm_runtime_mark_last_busy(&swrm->pdev->dev);
@@ -0,0 +1,166 @@
+/*
+ * Copyright (C) 2026 The Linux Foundation. All rights reserved.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 and
+ * only version 2 as published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * Check that self-monitoring cycle and instruction counters opened with
+ * config1:1 can be read from EL0 through perf_event_mmap_page, and that
+ * the result agrees with read().
+ */
+
+#define _GNU_SOURCE
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <linux/perf_event.h>
+
+#include "../kselftest.h"
+
+#define barrier()	asm volatile("" ::: "memory")
+
+static uint64_t read_pmevcntr(int counter)
+{
+	uint64_t val;
+
+	if (counter == 31) {
+		asm volatile("mrs %0, pmccntr_el0" : "=r" (val));
+		return val;
+	}
+
+	asm volatile("msr pmselr_el0, %0" : : "r" ((uint64_t)counter));
+	asm volatile("isb");
+	asm volatile("mrs %0, pmxevcntr_el0" : "=r" (val));
+	return val;
+}
+
+/* The sequence documented in include/uapi/linux/perf_event.h */
+static bool mmap_read_self(struct perf_event_mmap_page *pc, uint64_t *count)
+{
+	uint32_t seq, idx, width;
+	uint64_t val, pmc;
+
+	do {
+		seq = pc->lock;
+		barrier();
+
+		idx = pc->index;
+		val = pc->offset;
+		if (!pc->cap_user_rdpmc || !idx)
+			return false;
+
+		width = pc->pmc_width;
+		pmc = read_pmevcntr(idx - 1);
+		pmc <<= 64 - width;
+		pmc = (int64_t)pmc >> (64 - width);
+		val += pmc;
+
+		barrier();
+	} while (pc->lock != seq);
+
+	*count = val;
+	return true;
+}
+
+static int open_event(uint64_t config)
+{
+	struct perf_event_attr attr;
+
+	memset(&attr, 0, sizeof(attr));
+	attr.type = PERF_TYPE_HARDWARE;
+	attr.size = sizeof(attr);
+	attr.config = config;
+	attr.config1 = 1 << 1;	/* rdpmc */
+	attr.exclude_kernel = 1;
+	attr.exclude_hv = 1;
+
+	return syscall(__NR_perf_event_open, &attr, 0, -1, -1, 0);
+}
+
+static int check_event(const char *name, uint64_t config)
+{
+	struct perf_event_mmap_page *pc;
+	uint64_t prev = 0, mmap_val, read_val;
+	long page_size = sysconf(_SC_PAGESIZE);
+	int fd, i, ret = -1;
+
+	fd = open_event(config);
+	if (fd < 0) {
+		perror("perf_event_open");
+		return 1;
+	}
+
+	pc = mmap(NULL, page_size, PROT_READ, MAP_SHARED, fd, 0);
+	if (pc == MAP_FAILED) {
+		perror("mmap");
+		goto out_close;
+	}
+
+	if (!pc->cap_user_rdpmc) {
+		printf("%s: EL0 access not granted, is kernel.perf_user_access set?\n",
+		       name);
+		ret = 1;
+		goto out_unmap;
+	}
+
+	for (i = 0; i < 100000; i++) {
+		if (!mmap_read_self(pc, &mmap_val)) {
+			printf("%s: event not active\n", name);
+			goto out_unmap;
+		}
+		if (mmap_val < prev) {
+			printf("%s: counter went backwards %llu -> %llu\n", name,
+			       (unsigned long long)prev,
+			       (unsigned long long)mmap_val);
+			goto out_unmap;
+		}
+		prev = mmap_val;
+	}
+
+	if (read(fd, &read_val, sizeof(read_val)) != sizeof(read_val)) {
+		perror("read");
+		goto out_unmap;
+	}
+	if (read_val < prev) {
+		printf("%s: read() %llu behind EL0 read %llu\n", name,
+		       (unsigned long long)read_val,
+		       (unsigned long long)prev);
+		goto out_unmap;
+	}
+
+	printf("%s: ok, EL0 %llu read() %llu\n", name,
+	       (unsigned long long)prev, (unsigned long long)read_val);
+	ret = 0;
+
+out_unmap:
+	munmap(pc, page_size);
+out_close:
+	close(fd);
+	return ret;
+}
+
+int main(void)
+{
+	int cycles, instructions;
+
+	cycles = check_event("cycles", PERF_COUNT_HW_CPU_CYCLES);
+	instructions = check_event("instructions",
+				   PERF_COUNT_HW_INSTRUCTIONS);
+
+	if (cycles > 0 && instructions > 0)
+		ksft_exit_skip();
+	if (cycles < 0 || instructions < 0)
+		ksft_exit_fail();
+	ksft_exit_pass();
+}
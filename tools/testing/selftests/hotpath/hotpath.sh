@@ -0,0 +1,67 @@
+#!/bin/sh
+# Runs the hot path microbenchmarks with the CPU frequency pinned and
+# writes one key=value line per benchmark to stdout and $HOTPATH_OUT.
+#
+#   HOTPATH_CPU     CPU the benchmarks run on (0)
+#   HOTPATH_ITERS   operations timed per benchmark (10000)
+#   HOTPATH_KHZ     frequency to pin every CPU to, the maximum if unset
+#   HOTPATH_BLKDEV  block device for the 4K random read benchmark
+#   HOTPATH_OUT     results file (hotpath.results)
+
+CPU=${HOTPATH_CPU:-0}
+ITERS=${HOTPATH_ITERS:-10000}
+OUT=${HOTPATH_OUT:-hotpath.results}
+SYSCPU=/sys/devices/system/cpu
+SAVED=
+
+if [ "$(id -u)" -ne 0 ]; then
+	echo "hotpath: [SKIP] must be run as root"
+	exit 0
+fi
+
+pin_freq()
+{
+	for policy in $SYSCPU/cpu[0-9]*/cpufreq; do
+		[ -w $policy/scaling_governor ] || continue
+		SAVED="$SAVED $policy:$(cat $policy/scaling_governor)"
+		if [ -n "$HOTPATH_KHZ" ]; then
+			echo userspace > $policy/scaling_governor
+			echo $HOTPATH_KHZ > $policy/scaling_setspeed
+		else
+			echo performance > $policy/scaling_governor
+		fi
+	done
+}
+
+restore_freq()
+{
+	for entry in $SAVED; do
+		echo ${entry#*:} > ${entry%:*}/scaling_governor
+	done
+}
+
+trap restore_freq EXIT
+pin_freq
+
+{
+	echo "kernel=$(uname -r) cpu=$CPU khz=$(cat $SYSCPU/cpu$CPU/cpufreq/scaling_cur_freq 2>/dev/null || echo 0) iters=$ITERS"
+
+	echo "hotpath: start $$" > /dev/kmsg
+	if modprobe test_hotpath cpu=$CPU iterations=$ITERS; then
+		dmesg | sed -n "/hotpath: start $$/,\$p" | \
+			grep -o 'bench=.*'
+		modprobe -r test_hotpath
+	else
+		echo "bench=test_hotpath skipped=modprobe"
+	fi
+
+	./hotpath_bench -c $CPU -n $ITERS ${HOTPATH_BLKDEV:+-d $HOTPATH_BLKDEV}
+} | tee $OUT
+
+if grep -q ' failed at\|mismatch' $OUT; then
+	echo "hotpath: [FAIL]"
+	exit 1
+fi
+
+echo "hotpath: [PASS]"
+exit 0
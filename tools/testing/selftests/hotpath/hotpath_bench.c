@@ -0,0 +1,443 @@
+/*
+ * User space half of the hot path microbenchmarks
+ *
+ * Times binder transaction round trips, 4K random direct reads from a
+ * block device and ION allocations (through the ion-test driver), pinned
+ * to one CPU, and prints one key=value line per benchmark in the format
+ * used by the test_hotpath module:
+ *
+ *   bench=binder_roundtrip alg=- cpu=0 khz=1804800 iters=10000 bytes=0
+ *   p50_ns=... p99_ns=... max_ns=... kb_per_sec=...
+ *
+ * Benchmarks whose device is missing or busy are reported as skipped.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 and
+ * only version 2 as published by the Free Software Foundation.
+ */
+
+#define _GNU_SOURCE
+#include <errno.h>
+#include <fcntl.h>
+#include <sched.h>
+#include <signal.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/ioctl.h>
+#include <sys/mman.h>
+#include <sys/wait.h>
+#include <linux/fs.h>
+#include <linux/android/binder.h>
+
+#include "ion_test.h"
+
+#define BINDER_MAP_SIZE		(128 * 1024)
+#define BINDER_QUIT_CODE	1
+#define ION_SYSTEM_HEAP_ID	25
+#define BLK_IO_SIZE		4096
+
+static unsigned int iterations = 10000;
+static int cpu;
+
+static uint64_t now_ns(void)
+{
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return (uint64_t)ts.tv_sec * 1000000000ULL + ts.tv_nsec;
+}
+
+static int pin_cpu(int target)
+{
+	cpu_set_t set;
+
+	CPU_ZERO(&set);
+	CPU_SET(target, &set);
+	return sched_setaffinity(0, sizeof(set), &set);
+}
+
+static unsigned int cpu_khz(int target)
+{
+	char path[96];
+	unsigned int khz = 0;
+	FILE *f;
+
+	snprintf(path, sizeof(path),
+		 "/sys/devices/system/cpu/cpu%d/cpufreq/scaling_cur_freq",
+		 target);
+	f = fopen(path, "r");
+	if (!f)
+		return 0;
+	if (fscanf(f, "%u", &khz) != 1)
+		khz = 0;
+	fclose(f);
+	return khz;
+}
+
+static int cmp_u64(const void *a, const void *b)
+{
+	uint64_t x = *(const uint64_t *)a, y = *(const uint64_t *)b;
+
+	return x < y ? -1 : x > y;
+}
+
+static void report(const char *bench, const char *alg, unsigned int bytes,
+		   uint64_t *ns, unsigned int n)
+{
+	uint64_t total = 0;
+	unsigned int i;
+
+	for (i = 0; i < n; i++)
+		total += ns[i];
+
+	qsort(ns, n, sizeof(*ns), cmp_u64);
+	printf("bench=%s alg=%s cpu=%d khz=%u iters=%u bytes=%u p50_ns=%llu p99_ns=%llu max_ns=%llu kb_per_sec=%llu\n",
+	       bench, alg, cpu, cpu_khz(cpu), n, bytes,
+	       (unsigned long long)ns[(uint64_t)(n - 1) * 500 / 1000],
+	       (unsigned long long)ns[(uint64_t)(n - 1) * 990 / 1000],
+	       (unsigned long long)ns[n - 1],
+	       total ? (unsigned long long)((uint64_t)bytes * n *
+					    1000000000ULL / (total * 1024)) : 0);
+}
+
+static int skip(const char *bench, const char *why)
+{
+	printf("bench=%s skipped=%s\n", bench, why);
+	return 1;
+}
+
+static uint32_t xorshift(uint32_t *state)
+{
+	uint32_t x = *state;
+
+	x ^= x << 13;
+	x ^= x >> 17;
+	x ^= x << 5;
+	return *state = x;
+}
+
+struct binder_conn {
+	int fd;
+	void *map;
+};
+
+static int binder_open(const char *dev, struct binder_conn *conn)
+{
+	struct binder_version version;
+
+	conn->fd = open(dev, O_RDWR | O_CLOEXEC);
+	if (conn->fd < 0)
+		return -errno;
+
+	if (ioctl(conn->fd, BINDER_VERSION, &version) < 0 ||
+	    version.protocol_version != BINDER_CURRENT_PROTOCOL_VERSION) {
+		close(conn->fd);
+		return -EPROTO;
+	}
+
+	conn->map = mmap(NULL, BINDER_MAP_SIZE, PROT_READ, MAP_PRIVATE,
+			 conn->fd, 0);
+	if (conn->map == MAP_FAILED) {
+		close(conn->fd);
+		return -ENOMEM;
+	}
+
+	return 0;
+}
+
+static void binder_close(struct binder_conn *conn)
+{
+	munmap(conn->map, BINDER_MAP_SIZE);
+	close(conn->fd);
+}
+
+static int binder_write_read(struct binder_conn *conn, void *wbuf,
+			     size_t wlen, void *rbuf, size_t rlen,
+			     size_t *consumed)
+{
+	struct binder_write_read bwr = {
+		.write_size = wlen,
+		.write_buffer = (binder_uintptr_t)wbuf,
+		.read_size = rlen,
+		.read_buffer = (binder_uintptr_t)rbuf,
+	};
+
+	if (ioctl(conn->fd, BINDER_WRITE_READ, &bwr) < 0)
+		return -errno;
+	if (consumed)
+		*consumed = bwr.read_consumed;
+	return 0;
+}
+
+/*
+ * Waits for a BR_TRANSACTION or BR_REPLY and returns it in @tr, skipping
+ * the returns that carry nothing of interest.
+ */
+static int binder_wait(struct binder_conn *conn, uint32_t want,
+		       struct binder_transaction_data *tr)
+{
+	uint8_t rbuf[256];
+	size_t len = 0, off;
+	uint32_t cmd;
+	int ret;
+
+	for (;;) {
+		ret = binder_write_read(conn, NULL, 0, rbuf, sizeof(rbuf),
+					&len);
+		if (ret)
+			return ret;
+
+		for (off = 0; off + sizeof(cmd) <= len;
+		     off += sizeof(cmd) + _IOC_SIZE(cmd)) {
+			memcpy(&cmd, rbuf + off, sizeof(cmd));
+			if (cmd == BR_DEAD_REPLY || cmd == BR_FAILED_REPLY)
+				return -EPIPE;
+			if (cmd == want) {
+				memcpy(tr, rbuf + off + sizeof(cmd),
+				       sizeof(*tr));
+				return 0;
+			}
+		}
+	}
+}
+
+/* Sends @tr as @cmd, freeing the buffer of the last received one first */
+static int binder_send(struct binder_conn *conn, uint32_t cmd,
+		       struct binder_transaction_data *tr,
+		       binder_uintptr_t free_buf)
+{
+	uint8_t wbuf[sizeof(uint32_t) * 2 + sizeof(binder_uintptr_t) +
+		     sizeof(*tr)];
+	size_t len = 0;
+	uint32_t c;
+
+	if (free_buf) {
+		c = BC_FREE_BUFFER;
+		memcpy(wbuf + len, &c, sizeof(c));
+		len += sizeof(c);
+		memcpy(wbuf + len, &free_buf, sizeof(free_buf));
+		len += sizeof(free_buf);
+	}
+	memcpy(wbuf + len, &cmd, sizeof(cmd));
+	len += sizeof(cmd);
+	memcpy(wbuf + len, tr, sizeof(*tr));
+	len += sizeof(*tr);
+
+	return binder_write_read(conn, wbuf, len, NULL, 0, NULL);
+}
+
+/* Context manager that answers every transaction with an empty reply */
+static int binder_server(const char *dev, int ready)
+{
+	struct binder_transaction_data tr, reply = { };
+	struct binder_conn conn;
+	uint32_t cmd = BC_ENTER_LOOPER;
+	int ret;
+
+	pin_cpu(cpu);
+	ret = binder_open(dev, &conn);
+	if (!ret && ioctl(conn.fd, BINDER_SET_CONTEXT_MGR, 0) < 0) {
+		ret = -errno;
+		binder_close(&conn);
+	}
+	if (write(ready, &ret, sizeof(ret)) != sizeof(ret) || ret)
+		return 1;
+
+	binder_write_read(&conn, &cmd, sizeof(cmd), NULL, 0, NULL);
+	for (;;) {
+		if (binder_wait(&conn, BR_TRANSACTION, &tr))
+			break;
+		if (binder_send(&conn, BC_REPLY, &reply, tr.data.ptr.buffer))
+			break;
+		if (tr.code == BINDER_QUIT_CODE)
+			break;
+	}
+
+	binder_close(&conn);
+	return 0;
+}
+
+static int bench_binder(const char *dev, uint64_t *ns)
+{
+	struct binder_transaction_data tr = { }, reply;
+	binder_uintptr_t free_buf = 0;
+	struct binder_conn conn;
+	unsigned int i;
+	int pipefd[2], ret = -EIO;
+	pid_t pid;
+
+	if (pipe(pipefd))
+		return skip("binder_roundtrip", "pipe");
+
+	pid = fork();
+	if (pid < 0)
+		return skip("binder_roundtrip", "fork");
+	if (!pid) {
+		close(pipefd[0]);
+		_exit(binder_server(dev, pipefd[1]));
+	}
+
+	close(pipefd[1]);
+	if (read(pipefd[0], &ret, sizeof(ret)) != sizeof(ret) || ret) {
+		close(pipefd[0]);
+		waitpid(pid, NULL, 0);
+		return skip("binder_roundtrip",
+			    ret == -EBUSY ? "context_manager_busy" : "open");
+	}
+	close(pipefd[0]);
+
+	if (binder_open(dev, &conn)) {
+		kill(pid, SIGKILL);
+		waitpid(pid, NULL, 0);
+		return skip("binder_roundtrip", "open");
+	}
+
+	tr.target.handle = 0;
+	for (i = 0; i < iterations; i++) {
+		uint64_t start = now_ns();
+
+		ret = binder_send(&conn, BC_TRANSACTION, &tr, free_buf);
+		if (!ret)
+			ret = binder_wait(&conn, BR_REPLY, &reply);
+		ns[i] = now_ns() - start;
+		if (ret)
+			break;
+		free_buf = reply.data.ptr.buffer;
+	}
+
+	tr.code = BINDER_QUIT_CODE;
+	if (!binder_send(&conn, BC_TRANSACTION, &tr, free_buf))
+		binder_wait(&conn, BR_REPLY, &reply);
+	binder_close(&conn);
+	waitpid(pid, NULL, 0);
+
+	if (ret)
+		return skip("binder_roundtrip", "transaction_failed");
+	report("binder_roundtrip", "-", 0, ns, iterations);
+	return 0;
+}
+
+static int bench_blk(const char *dev, uint64_t *ns)
+{
+	uint64_t size, blocks;
+	uint32_t seed = 0x9e3779b9;
+	unsigned int i;
+	void *buf;
+	int fd;
+
+	fd = open(dev, O_RDONLY | O_DIRECT | O_CLOEXEC);
+	if (fd < 0)
+		return skip("blk_randread_4k", "open");
+
+	if (ioctl(fd, BLKGETSIZE64, &size) < 0 || size < BLK_IO_SIZE ||
+	    posix_memalign(&buf, BLK_IO_SIZE, BLK_IO_SIZE)) {
+		close(fd);
+		return skip("blk_randread_4k", "size");
+	}
+
+	blocks = size / BLK_IO_SIZE;
+	for (i = 0; i < iterations; i++) {
+		off_t off = (off_t)(xorshift(&seed) % blocks) * BLK_IO_SIZE;
+		uint64_t start = now_ns();
+
+		if (pread(fd, buf, BLK_IO_SIZE, off) != BLK_IO_SIZE) {
+			free(buf);
+			close(fd);
+			return skip("blk_randread_4k", "read_failed");
+		}
+		ns[i] = now_ns() - start;
+	}
+
+	free(buf);
+	close(fd);
+	report("blk_randread_4k", dev, BLK_IO_SIZE, ns, iterations);
+	return 0;
+}
+
+static int bench_ion(void)
+{
+	struct ion_test_bench_data data = {
+		.size = 64 * 1024,
+		.heap_id_mask = 1 << ION_SYSTEM_HEAP_ID,
+		.iterations = iterations,
+		.threads = 1,
+	};
+	int fd;
+
+	fd = open("/dev/ion-test", O_RDWR | O_CLOEXEC);
+	if (fd < 0)
+		return skip("ion_alloc", "open");
+
+	if (ioctl(fd, ION_IOC_TEST_BENCH, &data) < 0) {
+		close(fd);
+		return skip("ion_alloc", "ioctl");
+	}
+	close(fd);
+
+	/* the allocations run in kernel threads, report what they saw */
+	printf("bench=ion_alloc alg=system cpu=%d khz=%u iters=%u bytes=%llu p50_ns=%llu p99_ns=%llu max_ns=%llu kb_per_sec=%llu failures=%u\n",
+	       cpu, cpu_khz(cpu), iterations, (unsigned long long)data.size,
+	       (unsigned long long)data.alloc_ns[0],
+	       (unsigned long long)data.alloc_ns[1],
+	       (unsigned long long)data.alloc_ns[3],
+	       (unsigned long long)data.kb_per_sec, data.failures);
+	return 0;
+}
+
+static void usage(const char *prog)
+{
+	fprintf(stderr,
+		"usage: %s [-c cpu] [-n iterations] [-b binder-dev] [-d block-dev]\n",
+		prog);
+	exit(2);
+}
+
+int main(int argc, char **argv)
+{
+	const char *binder_dev = "/dev/binder", *blk_dev = NULL;
+	uint64_t *ns;
+	int opt;
+
+	while ((opt = getopt(argc, argv, "c:n:b:d:")) != -1) {
+		switch (opt) {
+		case 'c':
+			cpu = atoi(optarg);
+			break;
+		case 'n':
+			iterations = strtoul(optarg, NULL, 0);
+			break;
+		case 'b':
+			binder_dev = optarg;
+			break;
+		case 'd':
+			blk_dev = optarg;
+			break;
+		default:
+			usage(argv[0]);
+		}
+	}
+
+	if (!iterations)
+		usage(argv[0]);
+
+	ns = calloc(iterations, sizeof(*ns));
+	if (!ns || pin_cpu(cpu)) {
+		perror("setup");
+		return 1;
+	}
+
+	setvbuf(stdout, NULL, _IOLBF, 0);
+	bench_binder(binder_dev, ns);
+	if (blk_dev)
+		bench_blk(blk_dev, ns);
+	else
+		skip("blk_randread_4k", "no_device");
+	bench_ion();
+
+	free(ns);
+	return 0;
+}
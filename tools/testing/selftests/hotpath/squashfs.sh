@@ -0,0 +1,53 @@
+#!/bin/sh
+# Compares squashfs images of the same tree compressed with zstd, xz and
+# lz4: image size and cold cache read throughput, one key=value line per
+# compressor.
+#
+#   squashfs.sh <source dir> [block size]
+#
+# Needs mksquashfs with zstd support. Pin the CPU frequency first, as
+# hotpath.sh does, for numbers that compare between kernels.
+
+SRC=$1
+BLOCK=${2:-131072}
+TMP=$(mktemp -d /tmp/squashfs-bench.XXXXXX)
+
+if [ "$(id -u)" -ne 0 ] || [ ! -d "$SRC" ]; then
+	echo "usage: $0 <source dir> [block size], as root"
+	exit 0
+fi
+
+if ! which mksquashfs > /dev/null 2>&1; then
+	echo "squashfs: [SKIP] mksquashfs not found"
+	exit 0
+fi
+
+trap 'umount $TMP/mnt 2>/dev/null; rm -rf $TMP' EXIT
+mkdir $TMP/mnt
+bytes=$(du -sb "$SRC" | cut -f1)
+
+for comp in zstd xz lz4; do
+	img=$TMP/$comp.img
+
+	if ! mksquashfs "$SRC" $img -comp $comp -b $BLOCK -noappend \
+			-no-progress > /dev/null 2>&1; then
+		echo "bench=squashfs_read alg=$comp skipped=mksquashfs"
+		continue
+	fi
+
+	if ! mount -t squashfs -o loop,ro $img $TMP/mnt 2> /dev/null; then
+		echo "bench=squashfs_read alg=$comp skipped=mount"
+		continue
+	fi
+
+	sync
+	echo 3 > /proc/sys/vm/drop_caches
+	start=$(date +%s%N)
+	tar -C $TMP/mnt -cf - . > /dev/null
+	end=$(date +%s%N)
+	umount $TMP/mnt
+
+	ns=$((end - start))
+	[ $ns -gt 0 ] || ns=1
+	echo "bench=squashfs_read alg=$comp block=$BLOCK bytes=$bytes image_bytes=$(stat -c %s $img) total_ns=$ns kb_per_sec=$((bytes * 1000000000 / 1024 / ns))"
+done